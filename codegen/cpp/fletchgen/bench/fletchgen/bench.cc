@@ -0,0 +1,156 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Benchmarks of the construction of a design.
+ *
+ * Usage: fletchgen-bench [options]
+ *
+ * Constructs a fletchgen::Design, i.e. the RecordBatch, MMIO, Kernel, Nucleus and Mantle components, for generated
+ * read-mode schemas with an increasing number of fields and nesting depth, and prints the time it takes. Half of the
+ * fields are fixed-width, the other half are strings. With a nesting depth larger than zero, every field is wrapped in
+ * that many levels of structs. Options:
+ *
+ *   --json                Print one JSON object per benchmark, instead of a table.
+ *   --fields <n>          Only construct designs with n fields.
+ *   --depth <n>           Only construct designs with nesting depth n.
+ *   --profile             Profile every field, which also inserts stream probes.
+ */
+
+#include <arrow/api.h>
+#include <cerata/api.h>
+#include <fletcher/common.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fletchgen/design.h"
+#include "fletchgen/options.h"
+
+namespace {
+
+/// The minimum duration of the measurement of a benchmark, in seconds.
+constexpr double kMinSeconds = 0.5;
+
+/// Command-line options.
+struct Options {
+  bool json = false;
+  std::vector<int> fields = {16, 64, 256, 1024};
+  std::vector<int> depths = {0, 1, 2};
+  bool profile = false;
+};
+
+/// @brief Return a field that is wrapped in a number of levels of structs.
+std::shared_ptr<arrow::Field> MakeField(int index, int depth, bool profile) {
+  auto name = "f" + std::to_string(index);
+  std::shared_ptr<arrow::Field> result;
+  if (index % 2 == 0) {
+    result = arrow::field(name, arrow::int64(), false);
+  } else {
+    result = arrow::field(name, arrow::utf8(), false);
+  }
+  for (int d = 0; d < depth; d++) {
+    result = arrow::field(name, arrow::struct_({result, arrow::field("i" + std::to_string(d), arrow::int32(), false)}),
+                          false);
+  }
+  if (profile) {
+    result = fletcher::WithMetaProfile(*result);
+  }
+  return result;
+}
+
+/// @brief Return a read-mode schema with a number of fields of some nesting depth.
+std::shared_ptr<arrow::Schema> MakeSchema(int num_fields, int depth, bool profile) {
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  for (int f = 0; f < num_fields; f++) {
+    fields.push_back(MakeField(f, depth, profile));
+  }
+  return fletcher::WithMetaRequired(*arrow::schema(fields), "Bench", fletcher::Mode::READ);
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options result;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      result.json = true;
+    } else if ((arg == "--fields") && (i + 1 < argc)) {
+      result.fields = {std::atoi(argv[++i])};
+    } else if ((arg == "--depth") && (i + 1 < argc)) {
+      result.depths = {std::atoi(argv[++i])};
+    } else if (arg == "--profile") {
+      result.profile = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--json] [--fields <n>] [--depth <n>] [--profile]" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  auto options = ParseOptions(argc, argv);
+  fletcher::StartLogging("fletchgen-bench", FLETCHER_LOG_WARNING, "fletchgen-bench.log");
+
+  if (!options.json) {
+    std::cout << std::left << std::setw(32) << "Benchmark" << std::right << std::setw(15) << "Time"
+              << std::setw(18) << "Time per field" << std::setw(12) << "Iterations" << std::endl;
+  }
+
+  for (int depth : options.depths) {
+    for (int num_fields : options.fields) {
+      auto fletchgen_options = std::make_shared<fletchgen::Options>();
+      fletchgen_options->schemas = {MakeSchema(num_fields, depth, options.profile)};
+
+      // Construct the design once to warm up, and then as often as fits in kMinSeconds.
+      size_t iterations = 0;
+      double seconds = 0.0;
+      do {
+        cerata::default_component_pool()->Clear();
+        auto start = std::chrono::steady_clock::now();
+        fletchgen::Design design(fletchgen_options);
+        auto stop = std::chrono::steady_clock::now();
+        if (iterations > 0) {
+          seconds += std::chrono::duration<double>(stop - start).count();
+        }
+        iterations++;
+      } while ((seconds < kMinSeconds) || (iterations < 2));
+      iterations--;
+
+      auto ms = seconds / static_cast<double>(iterations) * 1e3;
+      auto us_per_field = ms * 1e3 / num_fields;
+      auto name = "Design/fields:" + std::to_string(num_fields) + "/depth:" + std::to_string(depth);
+      if (options.json) {
+        std::cout << "{\"name\":\"" << name << "\",\"fields\":" << num_fields << ",\"depth\":" << depth
+                  << std::fixed << std::setprecision(3) << ",\"ms\":" << ms << ",\"us_per_field\":" << us_per_field
+                  << ",\"iterations\":" << iterations << "}" << std::endl;
+      } else {
+        std::cout << std::left << std::setw(32) << name << std::right << std::setw(12) << std::fixed
+                  << std::setprecision(2) << ms << " ms" << std::setw(15) << us_per_field << " us"
+                  << std::setw(12) << iterations << std::endl;
+      }
+    }
+  }
+
+  cerata::default_component_pool()->Clear();
+  fletcher::StopLogging();
+  return EXIT_SUCCESS;
+}
@@ -14,9 +14,43 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace arrow {
+class Schema;
+class RecordBatch;
+}  // namespace arrow
+
 namespace fletchgen {
 
 /// @brief Fletchgen main entry. Used to wrap into PyFletchgen.
 int fletchgen(int argc, char **argv);
 
+/**
+ * @brief Generate a design from in-memory Schemas and RecordBatches, without touching the file system. Used by
+ *        PyFletchgen.
+ *
+ * The arguments are the command line options of Fletchgen, excluding the program name and the input and output paths.
+ * The generated sources are returned in \p files, keyed by their path relative to the output directory, e.g.
+ * "vhdl/Mantle.gen.vhd" and "fletchgen.mmio.manifest". Only VHDL, the register file, the register manifest and
+ * header, the performance report, the AXI top level and the Vivado HLS template are generated; the DOT output,
+ * simulation top level, memory models and static VHDL files require the file system.
+ *
+ * Every call generates a design from scratch. Calls from multiple threads are serialized, because the generated
+ * components are kept in a process-wide pool.
+ *
+ * @param[in]  schemas        The Schemas to generate a design for.
+ * @param[in]  recordbatches  The RecordBatches to generate a design for.
+ * @param[in]  arguments      The command line options.
+ * @param[out] files          The generated sources, keyed by their path.
+ * @return 0 if successful, -1 otherwise.
+ */
+int Generate(const std::vector<std::shared_ptr<arrow::Schema>> &schemas,
+             const std::vector<std::shared_ptr<arrow::RecordBatch>> &recordbatches,
+             const std::vector<std::string> &arguments,
+             std::map<std::string, std::string> *files);
+
 }  // namespace fletchgen
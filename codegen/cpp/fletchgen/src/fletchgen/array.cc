@@ -17,6 +17,7 @@
 #include <cerata/api.h>
 #include <cerata/vhdl/vhdl.h>
 #include <fletcher/common.h>
+#include <algorithm>
 #include <utility>
 #include <memory>
 #include <cmath>
@@ -44,9 +45,20 @@ using fletcher::Mode;
 PARAM_FACTORY(index_width)
 PARAM_FACTORY(tag_width)
 
-// The width of the indices or Arrow.
-// TODO(johanpel): support LARGE_LIST, LARGE_BINARY, LARGE_STRING, etc...
+// The width of the offsets of Arrow.
 static const int ARROW_OFFSET_WIDTH = 32;
+// The width of the offsets of Arrow LARGE_LIST, LARGE_BINARY and LARGE_STRING.
+static const int ARROW_LARGE_OFFSET_WIDTH = 64;
+
+/// @brief Return the width of the offsets of an Arrow list-like type.
+static int GetOffsetWidth(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::LARGE_LIST:
+    case arrow::Type::LARGE_BINARY:
+    case arrow::Type::LARGE_STRING: return ARROW_LARGE_OFFSET_WIDTH;
+    default: return ARROW_OFFSET_WIDTH;
+  }
+}
 
 size_t GetCtrlBufferCount(const arrow::Field &field) {
   fletcher::FieldMetadata field_meta;
@@ -55,10 +67,33 @@ size_t GetCtrlBufferCount(const arrow::Field &field) {
   return field_meta.buffers.size();
 }
 
+std::string GetCtrlValidity(const arrow::Field &field) {
+  fletcher::FieldMetadata field_meta;
+  fletcher::FieldAnalyzer fa(&field_meta);
+  fa.Analyze(field);
+  std::string result;
+  for (const auto &b : field_meta.buffers) {
+    result += (!b.desc_.empty() && (b.desc_.back() == "validity")) ? '1' : '0';
+  }
+  return result;
+}
+
+size_t GetCtrlFlagCount(const arrow::Field &field) {
+  auto validity = GetCtrlValidity(field);
+  return static_cast<size_t>(std::count(validity.begin(), validity.end(), '1'));
+}
+
 uint32_t GetTagWidth(const arrow::Field &field) {
   return fletcher::GetUIntMeta(field, fletcher::meta::TAG_WIDTH, 1);
 }
 
+std::shared_ptr<Node> field_tag_width(const arrow::Field &field, const std::shared_ptr<Node> &tag_width) {
+  if (fletcher::GetUIntMeta(field, fletcher::meta::TAG_WIDTH, 0) == 0) {
+    return tag_width;
+  }
+  return cerata::intl(static_cast<int>(GetTagWidth(field)));
+}
+
 std::shared_ptr<Type> cmd_type(const std::shared_ptr<Node> &index_width,
                                const std::shared_ptr<Node> &tag_width,
                                const std::optional<std::shared_ptr<Node>> &ctrl_width) {
@@ -82,6 +117,19 @@ std::shared_ptr<Type> unlock_type(const std::shared_ptr<Node> &tag_width) {
   return unlock_stream;
 }
 
+std::shared_ptr<Type> gather_type(const std::shared_ptr<Node> &index_width, const std::shared_ptr<Node> &tag_width) {
+  auto data = record({field("index", vector(index_width)),
+                      field("last", cerata::bit()),
+                      field("tag", vector(tag_width))});
+  return stream(data);
+}
+
+std::shared_ptr<Type> lookup_type(const std::shared_ptr<Node> &index_width) {
+  auto data = record({field("index", vector(index_width)),
+                      field("last", cerata::bit())});
+  return stream(data);
+}
+
 std::shared_ptr<Type> array_reader_out(uint32_t num_streams, uint32_t full_width) {
   auto data_stream = stream("ar_out", "", record({field(data(full_width)),
                                                   field(dvalid(num_streams, true)),
@@ -185,8 +233,233 @@ Component *array(Mode mode) {
   return result.get();
 }
 
+Component *dictionary_reader() {
+  // Check if the component already exists.
+  auto optional_existing = cerata::default_component_pool()->Get("DictionaryReader");
+  if (optional_existing) {
+    return *optional_existing;
+  }
+  auto result = cerata::component("DictionaryReader");
+
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::READ};
+
+  auto iw = index_width();
+  auto tw = tag_width();
+  tw->SetName("CMD_TAG_WIDTH");
+
+  result->Add({iw,
+               parameter("KEY_WIDTH", 8),
+               parameter("VALUE_WIDTH", 32),
+               parameter("CMD_TAG_ENABLE", true),
+               tw});
+
+  auto bcd = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  // The ctrl field holds the indices buffer address and the dictionary values buffer address.
+  auto cmd = port("cmd", cmd_type(iw, tw, strl("2*BUS_ADDR_WIDTH")), Port::Dir::IN, kernel_cd());
+  auto unlock = port("unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+  auto bus = bus_port("bus", Port::Dir::OUT, spec);
+  // Like for the ArrayReader, the width of the data port is rebound by the instantiating code.
+  auto data = port("out", array_reader_out(), Port::Dir::OUT, kernel_cd());
+
+  result->Add({bcd, kcd, cmd, unlock, bus, data});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
+  return result.get();
+}
+
+Component *lz4_reader() {
+  // Check if the component already exists.
+  auto optional_existing = cerata::default_component_pool()->Get("Lz4Reader");
+  if (optional_existing) {
+    return *optional_existing;
+  }
+  auto result = cerata::component("Lz4Reader");
+
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::READ};
+
+  auto iw = index_width();
+  auto tw = tag_width();
+  tw->SetName("CMD_TAG_WIDTH");
+
+  result->Add({iw,
+               parameter("VALUE_WIDTH", 32),
+               parameter("CMD_TAG_ENABLE", true),
+               tw});
+
+  auto bcd = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  // The ctrl field holds the compressed values buffer address.
+  auto cmd = port("cmd", cmd_type(iw, tw, strl("BUS_ADDR_WIDTH")), Port::Dir::IN, kernel_cd());
+  auto unlock = port("unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+  auto bus = bus_port("bus", Port::Dir::OUT, spec);
+  // Like for the ArrayReader, the width of the data port is rebound by the instantiating code.
+  auto data = port("out", array_reader_out(), Port::Dir::OUT, kernel_cd());
+
+  result->Add({bcd, kcd, cmd, unlock, bus, data});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
+  return result.get();
+}
+
+Component *run_end_reader() {
+  // Check if the component already exists.
+  auto optional_existing = cerata::default_component_pool()->Get("RunEndReader");
+  if (optional_existing) {
+    return *optional_existing;
+  }
+  auto result = cerata::component("RunEndReader");
+
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::READ};
+
+  auto iw = index_width();
+  auto tw = tag_width();
+  tw->SetName("CMD_TAG_WIDTH");
+
+  // Like for the ArrayReader, the CFG string determines the width of the values and the elements per cycle.
+  result->Add({iw,
+               parameter("CFG", std::string("")),
+               parameter("CMD_TAG_ENABLE", true),
+               tw});
+
+  auto bcd = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  // The ctrl field holds the run ends buffer address and the values buffer address.
+  auto cmd = port("cmd", cmd_type(iw, tw, strl("2*BUS_ADDR_WIDTH")), Port::Dir::IN, kernel_cd());
+  auto unlock = port("unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+  auto bus = bus_port("bus", Port::Dir::OUT, spec);
+  // Like for the ArrayReader, the width of the data port is rebound by the instantiating code.
+  auto data = port("out", array_reader_out(), Port::Dir::OUT, kernel_cd());
+
+  result->Add({bcd, kcd, cmd, unlock, bus, data});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
+  return result.get();
+}
+
+Component *parquet_page_reader() {
+  // Check if the component already exists.
+  auto optional_existing = cerata::default_component_pool()->Get("ParquetPageReader");
+  if (optional_existing) {
+    return *optional_existing;
+  }
+  auto result = cerata::component("ParquetPageReader");
+
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::READ};
+
+  auto iw = index_width();
+  auto tw = tag_width();
+  tw->SetName("CMD_TAG_WIDTH");
+
+  result->Add({iw,
+               parameter("VALUE_WIDTH", 32),
+               parameter("NULLABLE", false),
+               parameter("CMD_TAG_ENABLE", true),
+               tw});
+
+  auto bcd = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  // The ctrl field holds the page buffer address.
+  auto cmd = port("cmd", cmd_type(iw, tw, strl("BUS_ADDR_WIDTH")), Port::Dir::IN, kernel_cd());
+  auto unlock = port("unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+  auto bus = bus_port("bus", Port::Dir::OUT, spec);
+  // Like for the ArrayReader, the width of the data port is rebound by the instantiating code.
+  auto data = port("out", array_reader_out(), Port::Dir::OUT, kernel_cd());
+
+  result->Add({bcd, kcd, cmd, unlock, bus, data});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
+  return result.get();
+}
+
+Component *array_gather() {
+  // Check if the component already exists.
+  auto optional_existing = cerata::default_component_pool()->Get("ArrayGather");
+  if (optional_existing) {
+    return *optional_existing;
+  }
+  auto result = cerata::component("ArrayGather");
+
+  auto iw = index_width();
+  auto tw = tag_width();
+  result->Add({iw, tw, parameter("MAX_RUN", 256), parameter("MAX_PENDING", 64)});
+
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  auto kernel_idx = port("kernel_idx", gather_type(iw, tw), Port::Dir::IN, kernel_cd());
+  auto nucleus_cmd = port("nucleus_cmd", cmd_type(iw, tw), Port::Dir::OUT, kernel_cd());
+  auto nucleus_unl = port("nucleus_unl", unlock_type(tw), Port::Dir::IN, kernel_cd());
+  auto kernel_unl = port("kernel_unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+
+  result->Add({kcd, kernel_idx, nucleus_cmd, nucleus_unl, kernel_unl});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
+  return result.get();
+}
+
+Component *array_cache() {
+  // Check if the component already exists.
+  auto optional_existing = cerata::default_component_pool()->Get("ArrayCache");
+  if (optional_existing) {
+    return *optional_existing;
+  }
+  auto result = cerata::component("ArrayCache");
+
+  auto iw = index_width();
+  auto tw = tag_width();
+  auto vw = parameter("VALUE_WIDTH", 32);
+  result->Add({iw, vw, parameter("DEPTH_LOG2", 10), parameter("RAM_CONFIG", std::string("")), tw});
+
+  auto data_type = stream(record({field("dvalid", dvalid()), field("last", last()), field("", vector(vw))}));
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  auto nucleus_data = port("nucleus_data", data_type, Port::Dir::IN, kernel_cd());
+  auto kernel_lookup = port("kernel_lookup", lookup_type(iw), Port::Dir::IN, kernel_cd());
+  auto kernel_data = port("kernel_data", data_type, Port::Dir::OUT, kernel_cd());
+  auto nucleus_unl = port("nucleus_unl", unlock_type(tw), Port::Dir::IN, kernel_cd());
+  auto kernel_unl = port("kernel_unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+
+  result->Add({kcd, nucleus_data, kernel_lookup, kernel_data, nucleus_unl, kernel_unl});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
+  return result.get();
+}
+
+/// @brief Check that a fixed-size list field can be read as a single wide primitive element.
+static void CheckFixedSizeList(const arrow::Field &field) {
+  const auto &fsl = static_cast<const arrow::FixedSizeListType &>(*field.type());
+  auto values = fsl.value_field();
+  if (values->nullable() || (dynamic_cast<const arrow::FixedWidthType *>(values->type().get()) == nullptr)
+      || (values->type()->id() == arrow::Type::BOOL)) {
+    FLETCHER_LOG(FATAL, "Fixed-size list field " << field.name() << " must hold non-nullable, byte-aligned "
+                                                    "fixed-width values.");
+  }
+  // Buffer readers and writers require a power-of-two element width.
+  auto width = GetFixedWidthTypeBitWidth(fsl);
+  if ((width & (width - 1)) != 0) {
+    FLETCHER_LOG(FATAL, "Fixed-size list field " << field.name() << " has a width of " << width
+                                                   << " bits, which is not a power of two.");
+  }
+}
+
 ConfigType GetConfigType(const arrow::DataType &type) {
-  if (type.id() == arrow::Type::LIST) {
+  if (type.id() == arrow::Type::DICTIONARY) return ConfigType::DICTIONARY;
+
+  if ((type.id() == arrow::Type::LIST) || (type.id() == arrow::Type::LARGE_LIST)) {
     // Detect listprim:
     // Elements must be non-nullable.
     if (!type.field(0)->nullable() && (GetConfigType(*type.field(0)->type()) == ConfigType::PRIM)) {
@@ -198,10 +471,15 @@ ConfigType GetConfigType(const arrow::DataType &type) {
   // listprim(8) types:
   if (type.id() == arrow::Type::BINARY) return ConfigType::LIST_PRIM;
   if (type.id() == arrow::Type::STRING) return ConfigType::LIST_PRIM;
+  if (type.id() == arrow::Type::LARGE_BINARY) return ConfigType::LIST_PRIM;
+  if (type.id() == arrow::Type::LARGE_STRING) return ConfigType::LIST_PRIM;
 
   // Structs
   if (type.id() == arrow::Type::STRUCT) return ConfigType::STRUCT;
 
+  // Fixed-size lists have no offsets buffer. The values of a list are read as a single wide primitive element.
+  if (type.id() == arrow::Type::FIXED_SIZE_LIST) return ConfigType::PRIM;
+
   // Anything else should be a primitive.
   return ConfigType::PRIM;
 }
@@ -232,6 +510,9 @@ std::shared_ptr<Node> GetWidthNode(const arrow::DataType &type) {
     case arrow::Type::LIST: return strl("OFFSET_WIDTH");
     case arrow::Type::BINARY: return strl("OFFSET_WIDTH");
     case arrow::Type::STRING: return strl("OFFSET_WIDTH");
+    case arrow::Type::LARGE_LIST: return strl("OFFSET_WIDTH");
+    case arrow::Type::LARGE_BINARY: return strl("OFFSET_WIDTH");
+    case arrow::Type::LARGE_STRING: return strl("OFFSET_WIDTH");
 
       // Others:
     default:
@@ -250,6 +531,7 @@ std::shared_ptr<Node> GetWidthNode(const arrow::DataType &type) {
       const auto *t = dynamic_cast<const arrow::FixedSizeBinaryType *>(&type);
       return intl(t->bit_width());
     }
+    case arrow::Type::FIXED_SIZE_LIST: return intl(GetFixedWidthTypeBitWidth(type));
   }
 }
 
@@ -275,7 +557,9 @@ std::string GenerateConfigString(const arrow::Field &field, int level) {
     ret += "listprim(";
     level++;
     // Binary and string have no child, so we can't inspect it for the width, which is always 8.
-    if ((field.type()->id() == arrow::Type::BINARY) || (field.type()->id() == arrow::Type::STRING)) {
+    auto id = field.type()->id();
+    if ((id == arrow::Type::BINARY) || (id == arrow::Type::STRING) || (id == arrow::Type::LARGE_BINARY)
+        || (id == arrow::Type::LARGE_STRING)) {
       ret += "8";
     } else {
       // Other list of non-nullable primitives:
@@ -291,17 +575,42 @@ std::string GenerateConfigString(const arrow::Field &field, int level) {
     level++;
   }
 
-  if (epc > 1 || lepc > 1) {
-    ret += ";";
-  }
+  std::vector<std::string> params;
   if (epc > 1) {
-    ret += "epc=" + std::to_string(epc);
-    if (lepc > 1) {
-      ret += ",";
-    }
+    params.push_back("epc=" + std::to_string(epc));
   }
   if (lepc > 1) {
-    ret += "lepc=" + std::to_string(epc);
+    params.push_back("lepc=" + std::to_string(lepc));
+  }
+
+  // Buffer sizing only applies to the levels that instantiate BufferReaders/Writers. List primitives have an offsets
+  // buffer as well, which is sized the same as the values buffer.
+  if ((ct == ConfigType::PRIM) || (ct == ConfigType::LIST_PRIM)) {
+    int bus_fifo_depth = fletcher::GetUIntMeta(field, fletcher::meta::BUS_FIFO_DEPTH, 0);
+    int fifo_size = fletcher::GetUIntMeta(field, fletcher::meta::FIFO_SIZE, 0);
+    if (bus_fifo_depth > 0) {
+      params.push_back("bus_fifo_depth=" + std::to_string(bus_fifo_depth));
+      if (ct == ConfigType::LIST_PRIM) {
+        params.push_back("idx_bus_fifo_depth=" + std::to_string(bus_fifo_depth));
+      }
+    }
+    if (fifo_size > 0) {
+      params.push_back("fifo_size=" + std::to_string(fifo_size));
+      if (ct == ConfigType::LIST_PRIM) {
+        params.push_back("idx_fifo_size=" + std::to_string(fifo_size));
+      }
+    }
+    // Only buffer writers coalesce bursts; readers ignore this parameter.
+    if (fletcher::GetBoolMeta(field, fletcher::meta::WRITE_COALESCE)) {
+      params.push_back("coalesce=1");
+      if (ct == ConfigType::LIST_PRIM) {
+        params.push_back("idx_coalesce=1");
+      }
+    }
+  }
+
+  for (size_t i = 0; i < params.size(); i++) {
+    ret += (i == 0 ? ";" : ",") + params[i];
   }
 
   if (has_children) {
@@ -386,22 +695,28 @@ std::shared_ptr<Type> GetStreamType(const arrow::Field &arrow_field, fletcher::M
   // Placeholder for the returning type.
   std::shared_ptr<Type> type;
 
+  // The width of the length stream of list-like types.
+  auto ow = GetOffsetWidth(*arrow_field.type());
+
   // Determine what Cerata type to generate from the Arrow field type.
   switch (arrow_field.type()->id()) {
     // Special case: binary type has a length stream and non-nullable byte stream.
     // The EPC is assumed to relate to the list values.
     // The LEPC can be used for the length stream.
-    case arrow::Type::BINARY: return ListPrimType(epc, lepc, 8, ARROW_OFFSET_WIDTH, "bytes");
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_BINARY: return ListPrimType(epc, lepc, 8, ow, "bytes");
       // Special case: string type has a length stream and non-nullable utf8 character stream.
       // The EPC is assumed to relate to the list values.
       // The LEPC can be used for the length stream.
       // TODO(johanpel): reconsider the name of the chars stream.
-    case arrow::Type::STRING: return ListPrimType(epc, lepc, 8, ARROW_OFFSET_WIDTH, "chars");
+    case arrow::Type::STRING:
+    case arrow::Type::LARGE_STRING: return ListPrimType(epc, lepc, 8, ow, "chars");
 
       // Lists could be either lists of non-nullable primitives, or of something else.
       // If the values are non-nullable primitives, we can use the "listprim" configuration, which has some additional
       // options.
-    case arrow::Type::LIST: {
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
       // Sanity check, a list should only have one child field.
       if (arrow_field.type()->num_fields() != 1) {
         FLETCHER_LOG(FATAL, "Encountered Arrow list type with other than 1 child.");
@@ -413,7 +728,7 @@ std::shared_ptr<Type> GetStreamType(const arrow::Field &arrow_field, fletcher::M
         auto w = GetFixedWidthTypeBitWidth(*child_field->type());
         FLETCHER_LOG(DEBUG, "Using \"listprim\" configuration for list of non-nullable primitives of width " << w);
         auto values_type = ConvertFixedWidthType(arrow_field.type()->field(0)->type(), epc);
-        return ListPrimType(epc, lepc, w, ARROW_OFFSET_WIDTH, child_field->name());
+        return ListPrimType(epc, lepc, w, ow, child_field->name());
       } else {
         // Lists of non-primitive types or nullable primitive types.
         // EPC or LEPC are not supported.
@@ -425,7 +740,7 @@ std::shared_ptr<Type> GetStreamType(const arrow::Field &arrow_field, fletcher::M
                                     field("last", last()),
                                     field("data", values_type),
                                     field("count", count(e_count_width))}));
-        type = record({field("length", length(ARROW_OFFSET_WIDTH)),
+        type = record({field("length", length(ow)),
                        field(child_field->name(), child)});
         e_count_width = l_count_width;
       }
@@ -446,6 +761,26 @@ std::shared_ptr<Type> GetStreamType(const arrow::Field &arrow_field, fletcher::M
       break;
     }
 
+      // Dictionaries deliver the decoded values.
+    case arrow::Type::DICTIONARY: {
+      if (level > 0) {
+        FLETCHER_LOG(FATAL, "Dictionary-encoded fields are only supported at the top level.");
+      }
+      if (epc > 1) {
+        FLETCHER_LOG(FATAL, "Elements-per-cycle > 1 on dictionary-encoded fields is not supported.");
+      }
+      auto dict_type = std::static_pointer_cast<arrow::DictionaryType>(arrow_field.type());
+      type = ConvertFixedWidthType(dict_type->value_type(), 1);
+      break;
+    }
+
+      // Fixed-size lists deliver all values of one list, or of EPC lists, per transfer.
+    case arrow::Type::FIXED_SIZE_LIST: {
+      CheckFixedSizeList(arrow_field);
+      type = cerata::vector(epc * GetFixedWidthTypeBitWidth(*arrow_field.type()));
+      break;
+    }
+
       // Non-nested types
     default: {
       type = ConvertFixedWidthType(arrow_field.type(), epc);
@@ -485,30 +820,35 @@ std::pair<uint32_t, uint32_t> GetArrayDataSpec(const arrow::Field &arrow_field)
 
   uint32_t validity_bit = arrow_field.nullable() ? 1 : 0;
 
+  auto ow = GetOffsetWidth(*arrow_field.type());
+
   switch (arrow_field.type()->id()) {
-    case arrow::Type::BINARY: {
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_BINARY: {
       auto data_width = epc * 8;
-      auto length_width = lepc * 32;
+      auto length_width = lepc * ow;
       return {2, e_count_width + l_count_width + data_width + length_width + validity_bit};
     }
 
-    case arrow::Type::STRING: {
+    case arrow::Type::STRING:
+    case arrow::Type::LARGE_STRING: {
       auto data_width = epc * 8;
-      auto length_width = lepc * 32;
+      auto length_width = lepc * ow;
       return {2, e_count_width + l_count_width + data_width + length_width + validity_bit};
     }
 
       // Lists
-    case arrow::Type::LIST: {
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
       auto child_field = arrow_field.type()->field(0);
       if (GetConfigType(*child_field->type()) == ConfigType::PRIM) {
         auto data_width = GetFixedWidthTypeBitWidth(*child_field->type());
-        return {2, e_count_width + l_count_width + data_width * epc + ARROW_OFFSET_WIDTH * lepc + validity_bit};
+        return {2, e_count_width + l_count_width + data_width * epc + ow * lepc + validity_bit};
       } else {
         auto arrow_child = arrow_field.type()->field(0);
         auto elem_spec = GetArrayDataSpec(*arrow_child);
         // Add a length stream to number of streams, and length width to data width.
-        return {elem_spec.first + 1, elem_spec.second + ARROW_OFFSET_WIDTH + validity_bit};
+        return {elem_spec.first + 1, elem_spec.second + ow + validity_bit};
       }
     }
 
@@ -533,6 +873,19 @@ std::pair<uint32_t, uint32_t> GetArrayDataSpec(const arrow::Field &arrow_field)
       return spec;
     }
 
+      // Dictionaries deliver a single stream of decoded values.
+    case arrow::Type::DICTIONARY: {
+      auto dict_type = std::static_pointer_cast<arrow::DictionaryType>(arrow_field.type());
+      return {1, static_cast<uint32_t>(GetFixedWidthTypeBitWidth(*dict_type->value_type()))};
+    }
+
+      // Fixed-size lists are read like a primitive of the width of a whole list.
+    case arrow::Type::FIXED_SIZE_LIST: {
+      CheckFixedSizeList(arrow_field);
+      auto width = static_cast<uint32_t>(GetFixedWidthTypeBitWidth(*arrow_field.type()));
+      return {1, (epc > 1 ? e_count_width : 0) + epc * (width + validity_bit)};
+    }
+
       // Non-nested types or unsupported types.
     default: {
       auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(arrow_field.type());
@@ -36,8 +36,23 @@ PARAM_DECL_FACTORY(tag_width, 1)
 
 /// @brief Return the number of buffers for the control field.
 size_t GetCtrlBufferCount(const arrow::Field &field);
+/// @brief Return for every buffer of the control field '1' if it is a validity bitmap, and '0' otherwise.
+std::string GetCtrlValidity(const arrow::Field &field);
+/// @brief Return the number of validity bitmaps of the control field, of which each has an all valid flag.
+size_t GetCtrlFlagCount(const arrow::Field &field);
 /// @brief Return the tag width of this field as a literal node. Settable through Arrow metadata. Default: 1.
 uint32_t GetTagWidth(const arrow::Field &field);
+/**
+ * @brief Return the tag width node of the command and unlock streams of a field.
+ *
+ * Fields without tag width metadata share the tag width parameter of the component. Fields with tag width metadata get
+ * a literal of their own, which propagates to the kernel command and unlock ports.
+ *
+ * @param field     The field.
+ * @param tag_width The tag width parameter of the component.
+ * @return The tag width node.
+ */
+std::shared_ptr<Node> field_tag_width(const arrow::Field &field, const std::shared_ptr<Node> &tag_width);
 
 // ArrayReader/Writer types:
 
@@ -47,6 +62,10 @@ std::shared_ptr<Type> cmd_type(const std::shared_ptr<Node> &index_width,
                                const std::optional<std::shared_ptr<Node>> &ctrl_width = std::nullopt);
 /// @brief Fletcher unlock stream
 std::shared_ptr<Type> unlock_type(const std::shared_ptr<Node> &tag_width);
+/// @brief Return a Fletcher gather stream type, of row indices of which the last one of a gather is marked.
+std::shared_ptr<Type> gather_type(const std::shared_ptr<Node> &index_width, const std::shared_ptr<Node> &tag_width);
+/// @brief Return a Fletcher lookup stream type, of row indices into the on-chip cache of a field.
+std::shared_ptr<Type> lookup_type(const std::shared_ptr<Node> &index_width);
 
 /// @brief Fletcher read data
 std::shared_ptr<Type> array_reader_out(uint32_t num_streams = 0, uint32_t full_width = 0);
@@ -65,7 +84,8 @@ enum class ConfigType {
   PRIM,       ///< Primitive (fixed-width) fields.
   LIST,       ///< Variable length fields.
   LIST_PRIM,  ///< List of primitives. Can have EPC > 1.
-  STRUCT      ///< Structs, composed of multiple fields.
+  STRUCT,     ///< Structs, composed of multiple fields.
+  DICTIONARY  ///< Dictionary-encoded fixed-width values, read by a DictionaryReader.
 };
 
 /**
@@ -123,4 +143,66 @@ std::pair<uint32_t, uint32_t> GetArrayDataSpec(const arrow::Field &arrow_field);
  */
 Component *array(fletcher::Mode mode);
 
+/**
+ * @brief Return a Cerata component model of a DictionaryReader.
+ *
+ * The DictionaryReader reads the indices of a dictionary-encoded field and delivers the decoded values through an
+ * ArrayReader-compatible interface. Its command ctrl field holds the indices and dictionary values buffer addresses.
+ *
+ * @return            The component model.
+ */
+Component *dictionary_reader();
+
+/**
+ * @brief Return a Cerata component model of an Lz4Reader.
+ *
+ * The Lz4Reader reads the LZ4-compressed values buffer of a fixed-width field and delivers the decompressed values
+ * through an ArrayReader-compatible interface. Its command ctrl field holds the compressed buffer address.
+ *
+ * @return            The component model.
+ */
+Component *lz4_reader();
+
+/**
+ * @brief Return a Cerata component model of a RunEndReader.
+ *
+ * The RunEndReader reads the run ends and values buffers of a run-end encoded fixed-width field and delivers the
+ * expanded values through an ArrayReader-compatible interface. Its command ctrl field holds the run ends buffer address
+ * in the lower half and the values buffer address in the upper half.
+ *
+ * @return            The component model.
+ */
+Component *run_end_reader();
+
+/**
+ * @brief Return a Cerata component model of a ParquetPageReader.
+ *
+ * The ParquetPageReader reads a Parquet data page of a fixed-width field and delivers the decoded values through an
+ * ArrayReader-compatible interface. Its command ctrl field holds the page buffer address.
+ *
+ * @return            The component model.
+ */
+Component *parquet_page_reader();
+
+/**
+ * @brief Return a Cerata component model of an ArrayGather.
+ *
+ * The ArrayGather turns a stream of row indices of a field read in gather mode into the command stream of its
+ * ArrayReader, coalescing runs of consecutive indices, and passes on a single unlock per gather.
+ *
+ * @return            The component model.
+ */
+Component *array_gather();
+
+/**
+ * @brief Return a Cerata component model of an ArrayCache.
+ *
+ * The ArrayCache stores the values of a field that is preloaded by a command in on-chip memory, and answers a stream
+ * of lookups into them. The types of its data ports are set to the Arrow data stream type of the field on
+ * instantiation.
+ *
+ * @return            The component model.
+ */
+Component *array_cache();
+
 }  // namespace fletchgen
@@ -72,6 +72,6 @@ Axi4LitePort::Axi4LitePort(Port::Dir dir, Axi4LiteSpec spec, std::string name, s
     Port(std::move(name), axi4_lite_type(spec), dir, std::move(domain)), spec_(spec) {}
 
 std::shared_ptr<Object> Axi4LitePort::Copy() const {
-  return axi4_lite(dir_, domain_, spec_);
+  return std::make_shared<Axi4LitePort>(dir_, spec_, name(), domain_);
 }
 }  // namespace fletchgen
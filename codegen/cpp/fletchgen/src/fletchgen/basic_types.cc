@@ -138,6 +138,11 @@ std::shared_ptr<Type> last(int width, bool on_primitive) {
 }
 
 int GetFixedWidthTypeBitWidth(const arrow::DataType &arrow_type) {
+  // A fixed-size list of fixed-width values is transferred as a whole, like a single fixed-width element.
+  if (arrow_type.id() == arrow::Type::FIXED_SIZE_LIST) {
+    const auto &fsl = static_cast<const arrow::FixedSizeListType &>(arrow_type);
+    return fsl.list_size() * GetFixedWidthTypeBitWidth(*fsl.value_type());
+  }
   auto fwt = dynamic_cast<const arrow::FixedWidthType *>(&arrow_type);
   if (fwt == nullptr) {
     FLETCHER_LOG(ERROR, "Not a fixed-width Arrow type: " + arrow_type.ToString());
@@ -107,6 +107,7 @@ Component *bus_arbiter(BusFunction function) {
   auto empty_str = strl("");
 
   result->Add({parameter("ARB_METHOD", std::string("RR-STICKY")),
+               parameter("ARB_WEIGHTS", std::string("")),
                parameter("MAX_OUTSTANDING", 4),
                parameter("RAM_CONFIG", std::string("")),
                parameter("SLV_REQ_SLICES", true),
@@ -135,6 +136,135 @@ Component *bus_arbiter(BusFunction function) {
   return result.get();
 }
 
+static std::string GetBusBufferName(BusFunction function) {
+  return std::string("Bus") + (function == BusFunction::READ ? "Read" : "Write") + "LeafBuffer";
+}
+
+Component *bus_buffer(BusFunction function) {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto name = GetBusBufferName(function);
+
+  // If it already exists, just return the existing component.
+  auto optional_existing_comp = cerata::default_component_pool()->Get(name);
+  if (optional_existing_comp) {
+    return *optional_existing_comp;
+  }
+
+  // Create a new component.
+  auto result = component(name);
+
+  // Parameters.
+  BusDimParams params(result);
+  BusSpecParams spec{params, function};
+
+  // Remove unused params.
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+
+  result->Add({parameter("FIFO_DEPTH", 16),
+               parameter("RAM_CONFIG", std::string(""))});
+
+  // Clock/reset
+  auto clk_rst = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  // Master port
+  auto mst = bus_port("mst", Port::Dir::OUT, spec);
+  // Slave port
+  auto slv = bus_port("slv", Port::Dir::OUT, spec);
+  slv->Reverse();
+  // Add all ports.
+  result->Add({clk_rst, mst, slv});
+
+  // This component is a primitive as far as Cerata is concerned.
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Interconnect_pkg");
+
+  return result.get();
+}
+
+Component *bus_cdc(BusFunction function) {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto name = std::string("Bus") + (function == BusFunction::READ ? "Read" : "Write") + "CDC";
+
+  // If it already exists, just return the existing component.
+  auto optional_existing_comp = cerata::default_component_pool()->Get(name);
+  if (optional_existing_comp) {
+    return *optional_existing_comp;
+  }
+
+  // Create a new component.
+  auto result = component(name);
+
+  // Parameters.
+  BusDimParams params(result);
+  BusSpecParams spec{params, function};
+
+  // Remove unused params.
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+
+  result->Add({parameter("FIFO_DEPTH", 16),
+               parameter("XCLK_STAGES", 2),
+               parameter("RAM_CONFIG", std::string(""))});
+
+  // Clock/reset of the slave and master side.
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  auto bcd = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  // Master port
+  auto mst = bus_port("mst", Port::Dir::OUT, spec);
+  // Slave port
+  auto slv = bus_port("slv", Port::Dir::OUT, spec);
+  slv->Reverse();
+  // Add all ports.
+  result->Add({kcd, bcd, mst, slv});
+
+  // This component is a primitive as far as Cerata is concerned.
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Interconnect_pkg");
+
+  return result.get();
+}
+
+Component *bus_slice(BusFunction function) {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto name = std::string("Bus") + (function == BusFunction::READ ? "Read" : "Write") + "Slice";
+
+  // If it already exists, just return the existing component.
+  auto optional_existing_comp = cerata::default_component_pool()->Get(name);
+  if (optional_existing_comp) {
+    return *optional_existing_comp;
+  }
+
+  // Create a new component.
+  auto result = component(name);
+
+  // Parameters.
+  BusDimParams params(result);
+  BusSpecParams spec{params, function};
+
+  // Remove unused params.
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+
+  // Clock/reset
+  auto clk_rst = port("bcd", cr(), Port::Dir::IN, bus_cd());
+  // Master port
+  auto mst = bus_port("mst", Port::Dir::OUT, spec);
+  // Slave port
+  auto slv = bus_port("slv", Port::Dir::OUT, spec);
+  slv->Reverse();
+  // Add all ports.
+  result->Add({clk_rst, mst, slv});
+
+  // This component is a primitive as far as Cerata is concerned.
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Interconnect_pkg");
+
+  return result.get();
+}
+
 std::shared_ptr<Component> BusReadSerializer() {
   auto aw = parameter("ADDR_WIDTH", integer());
   auto mdw = parameter("MASTER_DATA_WIDTH", integer());
@@ -207,6 +337,9 @@ bool operator==(const BusDim &lhs, const BusDim &rhs) {
 
 std::shared_ptr<cerata::Object> BusPort::Copy() const {
   auto result = bus_port(name(), dir_, spec_);
+  result->channel_ = channel_;
+  result->demand_ = demand_;
+  result->weight_ = weight_;
   // Take shared ownership of the type
   auto typ = type()->shared_from_this();
   result->SetType(typ);
@@ -137,6 +137,12 @@ struct BusPort : public Port {
 
   /// The bus spec to which the type generics of the bus port are bound.
   BusSpecParams spec_;
+  /// The top-level memory interface this bus port must be connected to.
+  uint32_t channel_ = 0;
+  /// Bytes per cycle the master behind this bus port demands at most, or 0 if unknown.
+  double demand_ = 0.0;
+  /// Arbitration weight of this bus port, or 0 if it is not set explicitly.
+  uint32_t weight_ = 0;
 
   /// @brief Deep-copy the BusPort.
   std::shared_ptr<Object> Copy() const override;
@@ -168,6 +174,51 @@ void ConnectBusParam(cerata::Graph *dst,
  */
 Component *bus_arbiter(BusFunction function);
 
+/**
+ * @brief Return a Cerata model of a BusLeafBuffer.
+ * @param function  The function of the bus; either read or write.
+ * @return          A Bus(Read/Write)LeafBuffer Cerata component model.
+ *
+ * This model corresponds to either:
+ *    [`hardware/interconnect/BusReadLeafBuffer.vhd`](https://github.com/johanpel/fletcher/blob/develop/hardware/interconnect/BusReadLeafBuffer.vhd)
+ * or [`hardware/interconnect/BusWriteLeafBuffer.vhd`](https://github.com/johanpel/fletcher/blob/develop/hardware/interconnect/BusWriteLeafBuffer.vhd)
+ * depending on the function parameter.
+ *
+ * Changes to the implementation of this component in the HDL source must be reflected in the implementation of this
+ * function.
+ */
+Component *bus_buffer(BusFunction function);
+
+/**
+ * @brief Return a Cerata model of a BusCDC.
+ * @param function  The function of the bus; either read or write.
+ * @return          A Bus(Read/Write)CDC Cerata component model.
+ *
+ * This model corresponds to either:
+ *    [`hardware/interconnect/BusReadCDC.vhd`](https://github.com/johanpel/fletcher/blob/develop/hardware/interconnect/BusReadCDC.vhd)
+ * or [`hardware/interconnect/BusWriteCDC.vhd`](https://github.com/johanpel/fletcher/blob/develop/hardware/interconnect/BusWriteCDC.vhd)
+ * depending on the function parameter.
+ *
+ * Changes to the implementation of this component in the HDL source must be reflected in the implementation of this
+ * function.
+ */
+Component *bus_cdc(BusFunction function);
+
+/**
+ * @brief Return a Cerata model of a BusSlice.
+ * @param function  The function of the bus; either read or write.
+ * @return          A Bus(Read/Write)Slice Cerata component model.
+ *
+ * This model corresponds to either:
+ *    [`hardware/interconnect/BusReadSlice.vhd`](https://github.com/johanpel/fletcher/blob/develop/hardware/interconnect/BusReadSlice.vhd)
+ * or [`hardware/interconnect/BusWriteSlice.vhd`](https://github.com/johanpel/fletcher/blob/develop/hardware/interconnect/BusWriteSlice.vhd)
+ * depending on the function parameter.
+ *
+ * Changes to the implementation of this component in the HDL source must be reflected in the implementation of this
+ * function.
+ */
+Component *bus_slice(BusFunction function);
+
 /// @brief Return a BusReadSerializer component
 std::shared_ptr<Component> BusReadSerializer();
 
@@ -21,6 +21,8 @@
 #include <regex>
 #include <algorithm>
 #include <thread>
+#include <sstream>
+#include <iomanip>
 
 #include "fletcher/common.h"
 #include "fletchgen/design.h"
@@ -29,6 +31,7 @@
 #include "fletchgen/profiler.h"
 #include "fletchgen/bus.h"
 #include "fletchgen/external.h"
+#include "fletchgen/epc.h"
 
 namespace fletchgen {
 
@@ -47,21 +50,132 @@ static std::optional<std::shared_ptr<arrow::RecordBatch>> GetRecordBatchWithName
   return std::nullopt;
 }
 
+/// @brief Add EPC metadata to a schema if requested, and report the expected throughput of every data stream.
+static std::shared_ptr<arrow::Schema> AutoEPC(const std::shared_ptr<arrow::Schema> &schema, const Options &options) {
+  auto bus = BusDim::FromString(options.bus_dims[0], BusDim());
+  // A filter compares a single element per transfer on every stream, so its fields keep their EPC.
+  if (!fletcher::GetMeta(*schema, fletcher::meta::FILTER).empty()) {
+    if (options.auto_epc != 0) {
+      FLETCHER_LOG(WARNING, "Schema " + fletcher::GetMeta(*schema, fletcher::meta::NAME)
+          + " has a filter expression. Skipping automatic EPC selection.");
+    }
+    return schema;
+  }
+  if (options.auto_epc == 0) {
+    // Booleans are read as a bitmap, so they are always widened to the bus data width.
+    if (fletcher::GetMode(*schema) == fletcher::Mode::READ) {
+      return WithBitPackedEPC(schema, bus);
+    }
+    return schema;
+  }
+  std::vector<EPCChoice> choices;
+  auto result = WithAutoEPC(schema, bus, options.auto_epc, &choices);
+  double total = 0.0;
+  for (const auto &c : choices) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << "  " << c.field << ": epc=" << c.epc << (c.fixed ? " (fixed)" : "")
+       << ", " << c.bytes_per_cycle() << " B/cycle, " << 100.0 * c.utilization(bus) << "% of bus width";
+    FLETCHER_LOG(INFO, ss.str());
+    total += c.utilization(bus);
+  }
+  if (total > 1.0) {
+    FLETCHER_LOG(WARNING, "Data streams of " + fletcher::GetMeta(*schema, fletcher::meta::NAME)
+        + " require more than the bus bandwidth, and will be throttled by the bus arbiter.");
+  }
+  return result;
+}
+
+/// @brief Return whether an Arrow type is or contains a type with 32-bit offsets.
+static bool HasRegularOffsets(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LIST:return true;
+    case arrow::Type::DICTIONARY:
+      return HasRegularOffsets(*static_cast<const arrow::DictionaryType &>(type).value_type());
+    default:break;
+  }
+  for (const auto &child : type.fields()) {
+    if (HasRegularOffsets(*child->type())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @brief Add write coalescing metadata to every field of a write schema that does not have it, if requested.
+static std::shared_ptr<arrow::Schema> WriteCoalesce(const std::shared_ptr<arrow::Schema> &schema,
+                                                    const Options &options) {
+  if (!options.write_coalesce || (fletcher::GetMode(*schema) != fletcher::Mode::WRITE)) {
+    return schema;
+  }
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  for (const auto &f : schema->fields()) {
+    if (fletcher::GetMeta(*f, fletcher::meta::WRITE_COALESCE).empty()) {
+      fields.push_back(fletcher::WithMetaWriteCoalesce(*f));
+    } else {
+      fields.push_back(f);
+    }
+  }
+  return arrow::schema(fields, schema->metadata());
+}
+
+/// @brief Split the lists of structs of a read schema of which the children are read in parallel.
+static std::shared_ptr<arrow::Schema> SplitParallel(const std::shared_ptr<arrow::Schema> &schema) {
+  std::shared_ptr<arrow::Schema> result;
+  if (!fletcher::SplitParallelFields(schema, &result)) {
+    FLETCHER_LOG(FATAL, "Could not split the fields with parallel metadata of schema "
+        << fletcher::GetMeta(*schema, fletcher::meta::NAME) << ".");
+  }
+  if ((result != schema) && (fletcher::GetMode(*schema) == fletcher::Mode::WRITE)) {
+    FLETCHER_LOG(FATAL, "Fields with parallel metadata are not supported in write schema "
+        << fletcher::GetMeta(*schema, fletcher::meta::NAME) << ".");
+  }
+  return result;
+}
+
+/// @brief Expand a partitioned write schema into one write schema per partition.
+static std::vector<std::shared_ptr<arrow::Schema>> Partition(const std::shared_ptr<arrow::Schema> &schema) {
+  std::vector<std::shared_ptr<arrow::Schema>> result;
+  if (!fletcher::PartitionSchemas(schema, &result)) {
+    FLETCHER_LOG(FATAL, "Could not partition schema " << fletcher::GetMeta(*schema, fletcher::meta::NAME) << ".");
+  }
+  return result;
+}
+
 void Design::AnalyzeSchemas() {
   // Attempt to create a SchemaSet from all schemas that can be detected in the options.
   schema_set = SchemaSet::Make(options->kernel_name);
   // Add all schemas from the list of schema files
   for (const auto &arrow_schema : options->schemas) {
-    schema_set->AppendSchema(arrow_schema);
+    for (const auto &partition : Partition(arrow_schema)) {
+      schema_set->AppendSchema(WriteCoalesce(AutoEPC(SplitParallel(partition), *options), *options));
+    }
   }
   // Add all schemas from the recordbatches and add all recordbatches.
   for (const auto &recordbatch : options->recordbatches) {
-    schema_set->AppendSchema(recordbatch->schema());
+    if (!fletcher::GetMeta(*recordbatch->schema(), fletcher::meta::PARTITIONS).empty()) {
+      FLETCHER_LOG(FATAL, "RecordBatch " << fletcher::GetMeta(*recordbatch->schema(), fletcher::meta::NAME)
+                                         << " has a partitioned schema. Supply partitioned schemas as schema files.");
+    }
+    schema_set->AppendSchema(WriteCoalesce(AutoEPC(SplitParallel(recordbatch->schema()), *options), *options));
   }
   // Sort the schema set according to the recordbatch ordering specification.
   // Important for the control flow through MMIO / buffer addresses.
   // First we sort recordbatches by name, then by mode.
   schema_set->Sort();
+  // The ArrayReaders/Writers read offsets at the width of the indices, so 64-bit offsets can not be mixed with 32-bit
+  // offsets in one design.
+  if (schema_set->index_width() == 64) {
+    for (const auto &fs : schema_set->schemas()) {
+      for (const auto &f : fs->arrow_schema()->fields()) {
+        if (HasRegularOffsets(*f->type())) {
+          FLETCHER_LOG(FATAL, "Field " << fs->name() << "." << f->name() << " has 32-bit offsets, while other fields "
+                                       << "have 64-bit offsets. Use the Large variant of its type instead.");
+        }
+      }
+    }
+  }
 }
 
 void Design::AnalyzeRecordBatches() {
@@ -72,8 +186,14 @@ void Design::AnalyzeRecordBatches() {
     auto rb = GetRecordBatchWithName(options->recordbatches, fletcher_schema->name());
     fletcher::RecordBatchDescription rbd;
     if (rb) {
+      // Split the RecordBatch like its schema, such that its buffers match the generated hardware.
+      std::shared_ptr<arrow::RecordBatch> split;
+      if (!fletcher::SplitParallelFields(*rb, &split)) {
+        FLETCHER_LOG(FATAL, "Could not split the fields with parallel metadata of RecordBatch "
+            << fletcher_schema->name() << ".");
+      }
       fletcher::RecordBatchAnalyzer rba(&rbd);
-      rba.Analyze(**rb);
+      rba.Analyze(*split);
     } else {
       fletcher::SchemaAnalyzer sa(&rbd);
       sa.Analyze(*fletcher_schema->arrow_schema());
@@ -82,7 +202,12 @@ void Design::AnalyzeRecordBatches() {
   }
 }
 
-static std::vector<MmioReg> GetDefaultRegs() {
+static std::vector<MmioReg> GetDefaultRegs(const SchemaSet &schema_set, uint32_t kernel_clock_hz) {
+  // The run-time compares this hash to the schemas of the application, see fletcher::SchemaSetHash.
+  std::vector<std::shared_ptr<arrow::Schema>> schemas;
+  for (const auto &fs : schema_set.schemas()) {
+    schemas.push_back(fs->arrow_schema());
+  }
   std::vector<MmioReg> result;
   result.emplace_back(MmioFunction::DEFAULT, MmioBehavior::STROBE, "start", "Start the kernel.", 1, 0, 0);
   result.emplace_back(MmioFunction::DEFAULT, MmioBehavior::STROBE, "stop", "Stop the kernel.", 1, 1, 0);
@@ -91,6 +216,12 @@ static std::vector<MmioReg> GetDefaultRegs() {
   result.emplace_back(MmioFunction::DEFAULT, MmioBehavior::STATUS, "busy", "Kernel busy status.", 1, 1, 4);
   result.emplace_back(MmioFunction::DEFAULT, MmioBehavior::STATUS, "done", "Kernel done status.", 1, 2, 4);
   result.emplace_back(MmioFunction::DEFAULT, MmioBehavior::STATUS, "result", "Result.", 64, 0, 8);
+  result.emplace_back(MmioFunction::DEFAULT, MmioBehavior::CONSTANT, "schema_hash", "Hash of the schemas.", 32, 0, 16,
+                      fletcher::SchemaSetHash(schemas));
+  // The cycles register is driven by a KernelTimer, see Nucleus.
+  result.emplace_back(MmioFunction::TIMER, MmioBehavior::STATUS, "cycles", "Kernel execution cycles.", 64, 0, 20);
+  result.emplace_back(MmioFunction::TIMER, MmioBehavior::CONSTANT, "clock_hz", "Kernel clock frequency in Hz.", 32, 0,
+                      28, kernel_clock_hz);
   return result;
 }
 
@@ -122,7 +253,9 @@ std::vector<MmioReg> Design::ParseCustomRegs(const std::vector<std::string> &reg
 }
 
 /// @brief Generate mmio registers from properly ordered RecordBatchDescriptions.
-std::vector<MmioReg> Design::GetRecordBatchRegs(const std::vector<fletcher::RecordBatchDescription> &batch_desc) {
+std::vector<MmioReg> Design::GetRecordBatchRegs(const std::vector<fletcher::RecordBatchDescription> &batch_desc,
+                                                uint32_t index_width,
+                                                bool all_valid) {
   std::vector<MmioReg> result;
 
   // Get first and last indices.
@@ -131,12 +264,12 @@ std::vector<MmioReg> Design::GetRecordBatchRegs(const std::vector<fletcher::Reco
                         MmioBehavior::CONTROL,
                         r.name + "_firstidx",
                         r.name + " first index.",
-                        32);
+                        index_width);
     result.emplace_back(MmioFunction::BATCH,
                         MmioBehavior::CONTROL,
                         r.name + "_lastidx",
                         r.name + " last index (exclusive).",
-                        32);
+                        index_width);
   }
 
   // Get all buffer addresses.
@@ -153,6 +286,153 @@ std::vector<MmioReg> Design::GetRecordBatchRegs(const std::vector<fletcher::Reco
       }
     }
   }
+
+  // Get the all valid flags of the validity bitmaps, which the run-time sets for bitmaps without nulls.
+  for (const auto &r : batch_desc) {
+    if (!all_valid || (r.mode != fletcher::Mode::READ)) {
+      continue;
+    }
+    for (const auto &f : r.fields) {
+      for (const auto &b : f.buffers) {
+        if (b.desc_.empty() || (b.desc_.back() != "validity")) {
+          continue;
+        }
+        auto name = r.name + "_" + fletcher::ToString(std::vector<std::string>(b.desc_.begin(), b.desc_.end() - 1));
+        result.emplace_back(MmioFunction::VALIDITY,
+                            MmioBehavior::CONTROL,
+                            name + "_all_valid",
+                            "Skip reading the validity bitmap of " + name + ".",
+                            1);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<MmioReg> Design::GetPartitionRegs(const SchemaSet &schema_set) {
+  std::vector<MmioReg> result;
+  for (const auto &s : schema_set.schemas()) {
+    if (fletcher::GetMeta(*s->arrow_schema(), fletcher::meta::PARTITION).empty()) {
+      continue;
+    }
+    // The kernel drives these registers, so they are exposed to it like custom status registers.
+    MmioReg reg(MmioFunction::KERNEL,
+                MmioBehavior::STATUS,
+                s->name() + "_rows",
+                "Number of rows written to partition " + s->name() + ".",
+                schema_set.index_width());
+    reg.meta["kernel"] = "true";
+    result.push_back(reg);
+  }
+  return result;
+}
+
+std::vector<MmioReg> Design::GetRingRegs(const std::vector<MmioReg> &recordbatch_regs, BusDim bus_dim) {
+  // A descriptor holds the 32-bit words of the RecordBatch registers, in the order the run-time writes them.
+  uint32_t desc_regs = 0;
+  for (const auto &r : recordbatch_regs) {
+    desc_regs += (r.width + 31) / 32;
+  }
+  // Descriptors are fetched in a single burst of a power of two beats, such that they never cross a burst boundary.
+  uint32_t beats = 1;
+  while (beats * bus_dim.dw < 32 * desc_regs) {
+    beats *= 2;
+  }
+  if (beats > bus_dim.bm) {
+    FLETCHER_LOG(FATAL, "Descriptors of " << desc_regs << " registers do not fit in a burst of " << bus_dim.bm
+                                          << " beats.");
+  }
+  uint32_t stride = beats * bus_dim.dw / 8;
+
+  std::vector<MmioReg> result;
+  result.emplace_back(MmioFunction::RING, MmioBehavior::CONTROL, "ring_enable", "Enable the descriptor ring.", 1);
+  result.emplace_back(MmioFunction::RING, MmioBehavior::CONTROL, "ring_base",
+                      "Device address of the descriptor ring.", 64);
+  result.emplace_back(MmioFunction::RING, MmioBehavior::CONTROL, "ring_size",
+                      "Number of descriptors of the descriptor ring.", 32);
+  result.emplace_back(MmioFunction::RING, MmioBehavior::CONTROL, "ring_tail",
+                      "Index of the next descriptor written by the host.", 32);
+  result.emplace_back(MmioFunction::RING, MmioBehavior::STATUS, "ring_head",
+                      "Index of the next descriptor processed by the kernel.", 32);
+  result.emplace_back(MmioFunction::RING, MmioBehavior::CONSTANT, "ring_stride",
+                      "Number of bytes of every descriptor in the descriptor ring.", 32, 0, std::nullopt, stride);
+  for (auto &r : result) {
+    r.meta[MMIO_RING_REGS] = std::to_string(desc_regs);
+    r.meta[MMIO_RING_BEATS] = std::to_string(beats);
+  }
+  return result;
+}
+
+std::vector<MmioReg> Design::GetChunkRegs(const std::vector<fletcher::RecordBatchDescription> &batch_desc,
+                                          uint32_t index_width,
+                                          BusDim bus_dim) {
+  std::vector<MmioReg> result;
+  for (const auto &r : batch_desc) {
+    if (r.mode != fletcher::Mode::READ) {
+      continue;
+    }
+    // A descriptor holds the 32-bit words of the first and last index and the buffer addresses of the RecordBatch.
+    uint32_t desc_regs = 2 * (index_width / 32);
+    for (const auto &f : r.fields) {
+      desc_regs += 2 * static_cast<uint32_t>(f.buffers.size());
+    }
+    // Like the descriptors of the descriptor ring, descriptors are fetched in a single burst of a power of two beats.
+    uint32_t beats = 1;
+    while (beats * bus_dim.dw < 32 * desc_regs) {
+      beats *= 2;
+    }
+    if (beats > bus_dim.bm) {
+      FLETCHER_LOG(FATAL, "Chunk descriptors of RecordBatch " << r.name << " of " << desc_regs
+                                                              << " registers do not fit in a burst of " << bus_dim.bm
+                                                              << " beats.");
+    }
+    uint32_t stride = beats * bus_dim.dw / 8;
+    std::vector<MmioReg> regs;
+    regs.emplace_back(MmioFunction::CHUNKS, MmioBehavior::CONTROL, r.name + "_chunks",
+                      "Device address of the chunk list of " + r.name + ".", 64);
+    regs.emplace_back(MmioFunction::CHUNKS, MmioBehavior::CONTROL, r.name + "_num_chunks",
+                      "Number of chunks in the chunk list of " + r.name + ".", 32);
+    regs.emplace_back(MmioFunction::CHUNKS, MmioBehavior::CONSTANT, r.name + "_chunk_stride",
+                      "Number of bytes of every descriptor in the chunk list of " + r.name + ".",
+                      32, 0, std::nullopt, stride);
+    for (auto &reg : regs) {
+      reg.meta[MMIO_CHUNK_BEATS] = std::to_string(beats);
+      result.push_back(reg);
+    }
+  }
+  return result;
+}
+
+std::vector<MmioReg> Design::GetCompletionRegs() {
+  std::vector<MmioReg> result;
+  // The record is written by a CompletionWriter, see Nucleus.
+  result.emplace_back(MmioFunction::COMPLETION, MmioBehavior::CONTROL, "completion_address",
+                      "Host address of the completion record, aligned to 32 bytes. Zero disables it.", 64);
+  return result;
+}
+
+std::vector<MmioReg> Design::GetResultRegs(uint32_t result_bytes) {
+  std::vector<MmioReg> result;
+  // The address is passed to the kernel, which writes its results there through the result bus.
+  result.emplace_back(MmioFunction::KERNEL, MmioBehavior::CONTROL, "result_address",
+                      "Device address of the result scratchpad.", 64);
+  result.emplace_back(MmioFunction::KERNEL, MmioBehavior::CONSTANT, "result_bytes",
+                      "Number of bytes of the result scratchpad.", 32, 0, std::nullopt, result_bytes);
+  return result;
+}
+
+std::vector<MmioReg> Design::GetProjectionRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches) {
+  std::vector<MmioReg> result;
+  for (const auto &r : recordbatches) {
+    for (const auto &cmd : r->GetFieldPorts(FieldPort::Function::COMMAND)) {
+      auto name = cmd->fletcher_schema_->name() + "_" + cmd->field_->name();
+      result.emplace_back(MmioFunction::PROJECTION,
+                          MmioBehavior::CONTROL,
+                          name + "_enable",
+                          "Enable field " + name + ".",
+                          1, 0, std::nullopt, 1);
+    }
+  }
   return result;
 }
 
@@ -180,31 +460,99 @@ Design::Design(const std::shared_ptr<Options> &opts) {
     recordbatch_comps.push_back(rb);
   }
 
-  // Generate the MMIO component model for this. This is based on four things;
-  // 1. The default registers (like control, status, result).
+  // Generate the MMIO component model for this. This is based on eight things;
+  // 1. The default registers (like control, status, result, schema hash).
   // 2. The RecordBatchDescriptions - for every recordbatch we need a first and last index, and every buffer address.
-  // 3. The custom kernel registers, parsed from the command line arguments.
-  // 4. The profiling registers, obtained from inspecting the generated recordbatches.
-  default_regs = GetDefaultRegs();
-  recordbatch_regs = GetRecordBatchRegs(batch_desc);
+  //    Optionally, these are followed by an all valid register for every validity bitmap.
+  // 3. Optionally, an enable register for every field, placed right after the buffer addresses.
+  // 4. The custom kernel registers, parsed from the command line arguments.
+  // 5. The profiling registers, obtained from inspecting the generated recordbatches.
+  // 6. Optionally, a register counting the written elements of every stream of the write-mode recordbatches.
+  // 7. A register holding the number of rows written to every partition of partitioned write-mode recordbatches.
+  // 8. Optionally, the registers of a descriptor ring, of which every descriptor holds the registers of 2.
+  // 9. Optionally, the registers of a result scratchpad in device memory.
+  // 10. Optionally, the registers of a chunk list for every recordbatch in read mode.
+  // 11. Optionally, the registers of a completion record in host memory.
+  // 12. Optionally, the registers of a trace of the requests of the RecordBatch bus ports.
+  default_regs = GetDefaultRegs(*schema_set, opts->kernel_clock_hz);
+  // With a chunk list, the validity bitmaps of chunks without nulls are skipped through their null address instead.
+  if (opts->all_valid && opts->chunk_list) {
+    FLETCHER_LOG(WARNING, "No all valid registers are generated for RecordBatches with a chunk list.");
+  }
+  recordbatch_regs = GetRecordBatchRegs(batch_desc, schema_set->index_width(), opts->all_valid && !opts->chunk_list);
+  if (opts->projection) {
+    projection_regs = GetProjectionRegs(recordbatch_comps);
+  }
   kernel_regs = ParseCustomRegs(opts->regs);
-  profiling_regs = GetProfilingRegs(recordbatch_comps);
+  profiling_regs = GetProfilingRegs(recordbatch_comps, opts->profile_count_width, opts->profile_bus);
+  if (opts->output_counts) {
+    output_regs = GetOutputCountRegs(recordbatch_comps, schema_set->index_width());
+  }
+  if (opts->progress) {
+    progress_regs = GetProgressRegs(recordbatch_comps, schema_set->index_width());
+  }
+  partition_regs = GetPartitionRegs(*schema_set);
 
   // Parse the memory bus specification.
   auto bus_spec = BusDim::FromString(opts->bus_dims[0], BusDim());
+  if (opts->descriptor_ring) {
+    ring_regs = GetRingRegs(recordbatch_regs, bus_spec);
+  }
+  if (opts->result_bytes > 0) {
+    result_regs = GetResultRegs(opts->result_bytes);
+  }
+  if (opts->chunk_list) {
+    chunk_regs = GetChunkRegs(batch_desc, schema_set->index_width(), bus_spec);
+  }
+  if (opts->completion_record) {
+    completion_regs = GetCompletionRegs();
+  }
+  if (opts->bus_trace > 0) {
+    trace_regs = GetBusTraceRegs(recordbatch_comps, opts->bus_trace);
+  }
 
   // Determine width of the AXI4-lite MMIO.
   mmio_spec = Axi4LiteSpec(opts->mmio64 ? 64 : 32, opts->mmio_addr_width, opts->mmio_offset);
 
   // Generate the MMIO component.
-  mmio_comp =
-      mmio(batch_desc, cerata::Merge({default_regs, recordbatch_regs, kernel_regs, profiling_regs}), mmio_spec);
+  mmio_comp = mmio(batch_desc,
+                   cerata::Merge({default_regs, recordbatch_regs, projection_regs, kernel_regs, profiling_regs,
+                                  output_regs, progress_regs, partition_regs, ring_regs, result_regs, chunk_regs,
+                                  completion_regs, trace_regs}),
+                   mmio_spec);
   // Generate the kernel.
-  kernel_comp = kernel(opts->kernel_name, recordbatch_comps, mmio_comp);
+  kernel_comp = kernel(opts->kernel_name, recordbatch_comps, mmio_comp,
+                       opts->result_bytes > 0 ? std::optional<BusDim>(bus_spec) : std::nullopt);
+  if (!opts->kernel_expr.empty()) {
+    kernel_expr = ParseKernelExpr(opts->kernel_expr);
+    if (!kernel_expr) {
+      FLETCHER_LOG(FATAL, "Malformed kernel expression \"" << opts->kernel_expr
+                                                           << "\". Expected \"<func>(<value>) [WHERE <condition> "
+                                                              "[AND <condition>]...]\".");
+    }
+    ImplementKernel(kernel_comp.get(), *kernel_expr);
+  }
+  if (opts->pipelined_kernel) {
+    if (kernel_expr) {
+      FLETCHER_LOG(FATAL, "A kernel is either generated from an expression or from a pipelined template, not both.");
+    }
+    PipelineKernel(kernel_comp.get());
+    pipelined_kernel = true;
+  }
   // Generate the nucleus.
-  nucleus_comp = nucleus(opts->kernel_name + "_Nucleus", recordbatch_comps, kernel_comp, mmio_comp, mmio_spec);
+  nucleus_comp = nucleus(opts->kernel_name + "_Nucleus", recordbatch_comps, kernel_comp, mmio_comp, mmio_spec,
+                         bus_spec);
   // Generate the mantle.
-  mantle_comp = mantle(opts->kernel_name + "_Mantle", recordbatch_comps, nucleus_comp, bus_spec, mmio_spec);
+  ArbiterTopology topology{opts->arbiter_fan_in,
+                           opts->arbiter_buffers,
+                           opts->arbiter_weights,
+                           opts->arbiter_max_outstanding,
+                           opts->xclk_stages,
+                           opts->bus_slices[0],
+                           opts->bus_slices[1],
+                           opts->bus_slices[2],
+                           opts->bus_slice_fan_in};
+  mantle_comp = mantle(opts->kernel_name + "_Mantle", recordbatch_comps, nucleus_comp, bus_spec, mmio_spec, topology);
 }
 
 void Design::RunVhdmmio(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec) {
@@ -221,6 +569,18 @@ void Design::RunVhdmmio(const std::vector<std::vector<MmioReg> *> &regs, Axi4Lit
   }
 }
 
+void Design::GenerateMmio(const std::vector<std::vector<MmioReg> *> &regs,
+                          Axi4LiteSpec axi_spec,
+                          const std::string &dir) {
+  cerata::CreateDir(dir);
+  auto vhd = std::ofstream(dir + "/mmio.gen.vhd");
+  vhd << GenerateMmioVhdl(regs, axi_spec);
+  vhd.close();
+  auto pkg = std::ofstream(dir + "/mmio_pkg.gen.vhd");
+  pkg << GenerateMmioPackage(regs, axi_spec);
+  pkg.close();
+}
+
 std::vector<cerata::OutputSpec> Design::GetOutputSpec() {
   std::vector<OutputSpec> result;
   OutputSpec mantle, kernel, nucleus;
@@ -233,9 +593,12 @@ std::vector<cerata::OutputSpec> Design::GetOutputSpec() {
   nucleus.comp = nucleus_comp.get();
   result.push_back(nucleus);
 
-  // Kernel
-  kernel.comp = kernel_comp.get();
-  result.push_back(kernel);
+  // Kernel, unless its implementation is generated from an expression or a pipelined template, see GenerateKernelVHDL
+  // and GeneratePipelinedKernelVHDL.
+  if (!kernel_expr && !pipelined_kernel) {
+    kernel.comp = kernel_comp.get();
+    result.push_back(kernel);
+  }
 
   // RecordBatchReaders/Writers
   for (const auto &rb : recordbatch_comps) {
@@ -25,6 +25,8 @@
 #include "fletchgen/schema.h"
 #include "fletchgen/options.h"
 #include "fletchgen/kernel.h"
+#include "fletchgen/expression.h"
+#include "fletchgen/pipelined.h"
 #include "fletchgen/mantle.h"
 #include "fletchgen/bus.h"
 #include "fletchgen/recordbatch.h"
@@ -54,12 +56,33 @@ struct Design {
   std::vector<MmioReg> default_regs;
   /// RecordBatch registers.
   std::vector<MmioReg> recordbatch_regs;
+  /// Field enable registers.
+  std::vector<MmioReg> projection_regs;
   /// Custom registers.
   std::vector<MmioReg> kernel_regs;
   /// Profiling registers.
   std::vector<MmioReg> profiling_regs;
+  /// Output element count registers.
+  std::vector<MmioReg> output_regs;
+  /// Consumed row count registers.
+  std::vector<MmioReg> progress_regs;
+  /// Partition row count registers.
+  std::vector<MmioReg> partition_regs;
+  /// Descriptor ring registers.
+  std::vector<MmioReg> ring_regs;
+  /// Result scratchpad registers.
+  std::vector<MmioReg> result_regs;
+  /// Chunk list registers.
+  std::vector<MmioReg> chunk_regs;
+  /// Completion record registers.
+  std::vector<MmioReg> completion_regs;
+  /// Bus trace registers.
+  std::vector<MmioReg> trace_regs;
   /// Pointers to all registers vectors.
-  std::vector<std::vector<MmioReg> *> all_regs = {&default_regs, &recordbatch_regs, &kernel_regs, &profiling_regs};
+  std::vector<std::vector<MmioReg> *> all_regs = {&default_regs, &recordbatch_regs, &projection_regs, &kernel_regs,
+                                                  &profiling_regs, &output_regs, &progress_regs, &partition_regs,
+                                                  &ring_regs, &result_regs, &chunk_regs, &completion_regs,
+                                                  &trace_regs};
 
   Axi4LiteSpec mmio_spec;
 
@@ -73,6 +96,10 @@ struct Design {
   std::vector<std::shared_ptr<RecordBatch>> recordbatch_comps;
   /// The Kernel component of this design.
   std::shared_ptr<Kernel> kernel_comp;
+  /// The expression of which the kernel implementation is generated, if any.
+  std::optional<KernelExpr> kernel_expr;
+  /// Whether a pipelined template of the kernel is generated.
+  bool pipelined_kernel = false;
 
   /// The top-level wrapper (mantle) of the design. This is not called wrapper because this is reserved for future top
   /// levels that instantiate multiple mantles to operate in parallel.
@@ -87,14 +114,50 @@ struct Design {
   /// @brief Obtain a Cerata OutputSpec from this design for Cerata back-ends to generate output.
   std::vector<cerata::OutputSpec> GetOutputSpec();
 
-  /// @brief Obtain requited mmio registers based on the RecordBatch descriptions.
-  static std::vector<MmioReg> GetRecordBatchRegs(const std::vector<fletcher::RecordBatchDescription> &batch_desc);
+  /**
+   * @brief Obtain requited mmio registers based on the RecordBatch descriptions.
+   *
+   * With all_valid, the buffer addresses are followed by an all valid register for every validity bitmap of the
+   * RecordBatches in read mode.
+   */
+  static std::vector<MmioReg> GetRecordBatchRegs(const std::vector<fletcher::RecordBatchDescription> &batch_desc,
+                                                 uint32_t index_width = 32,
+                                                 bool all_valid = false);
+
+  /// @brief Obtain an enable register for every field of a set of RecordBatches, in the order of their commands.
+  static std::vector<MmioReg> GetProjectionRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches);
+
+  /// @brief Obtain a register for the kernel to report the number of rows written to every partition schema.
+  static std::vector<MmioReg> GetPartitionRegs(const SchemaSet &schema_set);
+
+  /// @brief Obtain the registers of a completion record in host memory.
+  static std::vector<MmioReg> GetCompletionRegs();
+  /// @brief Obtain the registers of a descriptor ring, of which every descriptor holds the RecordBatch registers.
+  static std::vector<MmioReg> GetRingRegs(const std::vector<MmioReg> &recordbatch_regs, BusDim bus_dim);
+
+  /**
+   * @brief Obtain the registers of a chunk list for every RecordBatch in read mode.
+   *
+   * Every descriptor of a chunk list holds the registers of its RecordBatch in GetRecordBatchRegs(), i.e. the first
+   * and last index and the buffer addresses, padded to a power of two bus beats.
+   */
+  static std::vector<MmioReg> GetChunkRegs(const std::vector<fletcher::RecordBatchDescription> &batch_desc,
+                                           uint32_t index_width,
+                                           BusDim bus_dim);
+
+  /// @brief Obtain the registers of a result scratchpad of some number of bytes.
+  static std::vector<MmioReg> GetResultRegs(uint32_t result_bytes);
 
   /// @brief Obtain required custom registers based on a vector of strings.
   static std::vector<MmioReg> ParseCustomRegs(const std::vector<std::string> &regs);
 
   /// @brief Generate vhdmmio yaml and run it.
   static void RunVhdmmio(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec);
+
+  /// @brief Generate the mmio component VHDL sources in a directory, without running vhdmmio.
+  static void GenerateMmio(const std::vector<std::vector<MmioReg> *> &regs,
+                           Axi4LiteSpec axi_spec,
+                           const std::string &dir);
 };
 
 }  // namespace fletchgen
@@ -0,0 +1,144 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/epc.h"
+
+#include <fletcher/common.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fletchgen/basic_types.h"
+
+namespace fletchgen {
+
+/// @brief Return the width of the elements that an EPC applies to, if the type supports an EPC.
+static std::optional<uint32_t> ElementWidth(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY: return 8;
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
+      // Only lists of fixed-width types support an EPC.
+      auto values = type.field(0)->type();
+      if (dynamic_cast<const arrow::FixedWidthType *>(values.get()) == nullptr) {
+        return std::nullopt;
+      }
+      return GetFixedWidthTypeBitWidth(*values);
+    }
+      // Every element of a fixed-size list is a whole list.
+    case arrow::Type::FIXED_SIZE_LIST: {
+      auto values = type.field(0)->type();
+      if (dynamic_cast<const arrow::FixedWidthType *>(values.get()) == nullptr) {
+        return std::nullopt;
+      }
+      return GetFixedWidthTypeBitWidth(type);
+    }
+      // The DictionaryReader delivers one value per cycle.
+    case arrow::Type::DICTIONARY: return std::nullopt;
+    default:
+      if (dynamic_cast<const arrow::FixedWidthType *>(&type) == nullptr) {
+        return std::nullopt;
+      }
+      return GetFixedWidthTypeBitWidth(type);
+  }
+}
+
+/// @brief Return true if the field is a non-nullable boolean field, of which the values are read as a bitmap.
+static bool IsBitPacked(const arrow::Field &field) {
+  return (field.type()->id() == arrow::Type::BOOL) && !field.nullable();
+}
+
+std::optional<EPCChoice> DeriveEPC(const arrow::Field &field, const BusDim &bus, uint32_t bytes_per_cycle) {
+  auto width = ElementWidth(*field.type());
+  // The Lz4Reader and the ParquetPageReader deliver one value per cycle. The RunEndReader reads one run per cycle,
+  // which the bus width does not bound, so its elements-per-cycle must be set explicitly.
+  if (!width || *width == 0 || fletcher::GetBoolMeta(field, fletcher::meta::IGNORE, false)
+      || !fletcher::GetMeta(field, fletcher::meta::COMPRESSION).empty() || fletcher::IsRunEndEncoded(field)
+      || fletcher::IsParquetEncoded(field)) {
+    return std::nullopt;
+  }
+  EPCChoice result;
+  result.field = field.name();
+  result.element_width = *width;
+  if (!fletcher::GetMeta(field, fletcher::meta::VALUE_EPC).empty()) {
+    result.epc = fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1);
+    result.fixed = true;
+    return result;
+  }
+  // Bit-packed booleans are cheap to deliver in parallel, so non-nullable booleans use a full bus word per cycle.
+  if (IsBitPacked(field)) {
+    result.epc = bus.dw;
+    return result;
+  }
+  // Round the required EPC up to a power of two, but never exceed the bus width.
+  uint64_t target_bits = 8ull * bytes_per_cycle;
+  while ((static_cast<uint64_t>(result.epc) * *width < target_bits)
+      && (2ull * result.epc * *width <= bus.dw)) {
+    result.epc *= 2;
+  }
+  return result;
+}
+
+/// @brief Return a schema with EPC metadata on the selected fields that support it and do not already have it.
+static std::shared_ptr<arrow::Schema> WithEPC(const std::shared_ptr<arrow::Schema> &schema,
+                                              const BusDim &bus,
+                                              uint32_t bytes_per_cycle,
+                                              bool bit_packed_only,
+                                              std::vector<EPCChoice> *choices) {
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  for (const auto &field : schema->fields()) {
+    if (bit_packed_only && !IsBitPacked(*field)) {
+      fields.push_back(field);
+      continue;
+    }
+    auto choice = DeriveEPC(*field, bus, bytes_per_cycle);
+    if (!choice) {
+      fields.push_back(field);
+      continue;
+    }
+    if (choice->fixed) {
+      fields.push_back(field);
+    } else {
+      // Keep any other metadata of the field.
+      auto meta = field->metadata() != nullptr ? field->metadata()->Copy()
+                                               : std::make_shared<arrow::KeyValueMetadata>();
+      meta->Append(fletcher::meta::VALUE_EPC, std::to_string(choice->epc));
+      fields.push_back(field->WithMetadata(meta));
+    }
+    if (choices != nullptr) {
+      choices->push_back(*choice);
+    }
+  }
+  return arrow::schema(fields, schema->metadata());
+}
+
+std::shared_ptr<arrow::Schema> WithAutoEPC(const std::shared_ptr<arrow::Schema> &schema,
+                                           const BusDim &bus,
+                                           uint32_t bytes_per_cycle,
+                                           std::vector<EPCChoice> *choices) {
+  return WithEPC(schema, bus, bytes_per_cycle, false, choices);
+}
+
+std::shared_ptr<arrow::Schema> WithBitPackedEPC(const std::shared_ptr<arrow::Schema> &schema,
+                                                const BusDim &bus,
+                                                std::vector<EPCChoice> *choices) {
+  return WithEPC(schema, bus, 0, true, choices);
+}
+
+}  // namespace fletchgen
@@ -0,0 +1,86 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fletchgen/bus.h"
+
+namespace fletchgen {
+
+/// @brief The elements-per-cycle selected for a field, and the throughput it is expected to achieve.
+struct EPCChoice {
+  /// Name of the field.
+  std::string field;
+  /// Width of a single (list value) element in bits.
+  uint32_t element_width = 0;
+  /// The selected (list values) elements-per-cycle.
+  uint32_t epc = 1;
+  /// Whether the EPC was already set through the field metadata.
+  bool fixed = false;
+  /// Expected bytes per cycle of the data stream.
+  [[nodiscard]] double bytes_per_cycle() const { return epc * element_width / 8.0; }
+  /// Expected fraction of the bus data width that is used by the data stream.
+  [[nodiscard]] double utilization(const BusDim &bus) const { return static_cast<double>(epc) * element_width / bus.dw; }
+};
+
+/**
+ * @brief Derive the elements-per-cycle for the values of a field.
+ *
+ * The EPC is the smallest power of two that meets the target throughput, limited to what fits the bus data width.
+ * Only fixed-width types, strings, binaries and lists of fixed-width types support an EPC above one. Non-nullable
+ * booleans are read as a bitmap, and always deliver a full bus word of booleans per cycle.
+ *
+ * @param field            The field.
+ * @param bus              The dimensions of the bus the field is read from or written to.
+ * @param bytes_per_cycle  The target throughput of the data stream in bytes per cycle.
+ * @return                 The selected EPC, or std::nullopt if the field does not support an EPC.
+ */
+std::optional<EPCChoice> DeriveEPC(const arrow::Field &field, const BusDim &bus, uint32_t bytes_per_cycle);
+
+/**
+ * @brief Return a schema with EPC metadata on every field that supports it and does not already have it.
+ * @param schema           The schema.
+ * @param bus              The dimensions of the bus the RecordBatch is read from or written to.
+ * @param bytes_per_cycle  The target throughput of every data stream in bytes per cycle.
+ * @param choices          Optionally outputs the EPC of every field.
+ * @return                 The schema with EPC metadata.
+ */
+std::shared_ptr<arrow::Schema> WithAutoEPC(const std::shared_ptr<arrow::Schema> &schema,
+                                           const BusDim &bus,
+                                           uint32_t bytes_per_cycle,
+                                           std::vector<EPCChoice> *choices = nullptr);
+
+/**
+ * @brief Return a schema with EPC metadata on every non-nullable boolean field that does not already have it.
+ *
+ * The values of such fields are bit-packed, so a single bus word delivers a bus data width of booleans.
+ *
+ * @param schema           The schema.
+ * @param bus              The dimensions of the bus the RecordBatch is read from or written to.
+ * @param choices          Optionally outputs the EPC of every boolean field.
+ * @return                 The schema with EPC metadata.
+ */
+std::shared_ptr<arrow::Schema> WithBitPackedEPC(const std::shared_ptr<arrow::Schema> &schema,
+                                                const BusDim &bus,
+                                                std::vector<EPCChoice> *choices = nullptr);
+
+}  // namespace fletchgen
@@ -0,0 +1,438 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/expression.h"
+
+#include <cerata/api.h>
+#include <cerata/vhdl/vhdl.h>
+#include <fletcher/common.h>
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fletchgen/array.h"
+#include "fletchgen/basic_types.h"
+#include "fletchgen/mmio.h"
+#include "fletchgen/utils.h"
+
+namespace fletchgen {
+
+/// Width of the signed values the kernel computes with, such that 64-bit unsigned values and their sums fit.
+static constexpr int VALUE_WIDTH = 66;
+
+std::optional<KernelExpr> ParseKernelExpr(const std::string &str) {
+  std::regex expr(R"(^\s*(SUM|COUNT|MIN|MAX)\s*\(\s*(\*|\w+|\w+\s*[-+*]\s*\w+)\s*\)\s*(WHERE\s+(.*\S))?\s*$)",
+                  std::regex::icase);
+  std::smatch matches;
+  if (!std::regex_match(str, matches, expr)) {
+    return std::nullopt;
+  }
+  KernelExpr result;
+  auto func = matches[1].str();
+  std::transform(func.begin(), func.end(), func.begin(), ::toupper);
+  if (func == "SUM") result.func = AggregateFunc::SUM;
+  else if (func == "COUNT") result.func = AggregateFunc::COUNT;
+  else if (func == "MIN") result.func = AggregateFunc::MIN;
+  else result.func = AggregateFunc::MAX;
+
+  // Split the value into its fields and operator.
+  auto value = matches[2].str();
+  std::smatch operands;
+  if (std::regex_match(value, operands, std::regex(R"((\w+)\s*([-+*])\s*(\w+))"))) {
+    result.fields = {operands[1].str(), operands[3].str()};
+    result.op = operands[2].str()[0];
+  } else if (value != "*") {
+    result.fields = {value};
+  }
+  // Fields are counted rather than combined, and only COUNT takes all rows.
+  if ((result.func == AggregateFunc::COUNT) && (result.fields.size() > 1)) {
+    return std::nullopt;
+  }
+  if ((result.func != AggregateFunc::COUNT) && result.fields.empty()) {
+    return std::nullopt;
+  }
+
+  if (matches[4].matched) {
+    auto conditions = matches[4].str();
+    std::regex separator(R"(\s+AND\s+)", std::regex::icase);
+    for (std::sregex_token_iterator it(conditions.begin(), conditions.end(), separator, -1), end; it != end; ++it) {
+      auto condition = ParseFilterExpr(it->str());
+      if (!condition) {
+        return std::nullopt;
+      }
+      result.conditions.push_back(*condition);
+    }
+  }
+  return result;
+}
+
+namespace {
+
+/// A field of a kernel expression.
+struct ExprStream {
+  /// The name of the Arrow data port of the field.
+  std::string port;
+  /// Whether the field is signed.
+  bool is_signed = false;
+  /// Whether the field is nullable.
+  bool nullable = false;
+};
+
+/// The ports of a kernel that are involved in evaluating an expression.
+struct ExprPorts {
+  /// The name of the schema of the fields of the expression.
+  std::string schema;
+  /// The streams of the fields of the expression, in order of appearance.
+  std::vector<ExprStream> streams;
+  /// The index in streams of every field of the expression.
+  std::map<std::string, size_t> index;
+  /// The Arrow data ports of all other fields.
+  std::vector<std::string> unused;
+  /// The widths of the custom kernel control registers.
+  std::map<std::string, uint32_t> registers;
+  /// The other status registers, which are not driven by the expression.
+  std::vector<const MmioPort *> status;
+};
+
+/// @brief Return whether the right-hand side of a condition is a literal.
+bool IsLiteral(const std::string &str) {
+  return std::regex_match(str, std::regex(R"(\d+)"));
+}
+
+/// @brief Resolve the ports of a kernel involved in an expression. Exits if the expression is not supported.
+ExprPorts Resolve(const Kernel &kernel, const KernelExpr &expr) {
+  ExprPorts result;
+  std::map<std::string, std::vector<const FieldPort *>> data_ports;
+  for (const auto &node : kernel.GetNodes()) {
+    if ((node->name() == "result_bus") || (node->name() == "ext")) {
+      FLETCHER_LOG(FATAL, "Kernel expressions do not support the result scratchpad or external I/O.");
+    }
+    auto mp = dynamic_cast<const MmioPort *>(node);
+    if (mp != nullptr) {
+      if ((mp->dir() == Port::Dir::IN) && (mp->reg.function == MmioFunction::KERNEL)) {
+        result.registers[mp->reg.name] = mp->reg.width;
+      } else if ((mp->dir() == Port::Dir::OUT) && (mp->reg.function != MmioFunction::DEFAULT)) {
+        result.status.push_back(mp);
+      }
+      continue;
+    }
+    auto fp = dynamic_cast<const FieldPort *>(node);
+    if ((fp == nullptr) || (fp->function_ != FieldPort::Function::ARROW)) {
+      continue;
+    }
+    const auto &field = *fp->field_;
+    if (fp->fletcher_schema_->mode() != fletcher::Mode::READ) {
+      FLETCHER_LOG(FATAL, "Kernel expressions only support schemas in read mode, but schema "
+          << fp->fletcher_schema_->name() << " is in write mode.");
+    }
+    if ((GetArrayDataSpec(field).first != 1) || (fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1) != 1)
+        || fletcher::GetBoolMeta(field, fletcher::meta::GATHER, false)
+        || (fletcher::GetUIntMeta(field, fletcher::meta::ONCHIP, 0) > 0)) {
+      FLETCHER_LOG(FATAL, "Kernel expressions require a single stream with one element per transfer for every field, "
+                          "which field " << field.name() << " of schema " << fp->fletcher_schema_->name()
+                                         << " does not have.");
+    }
+    data_ports[field.name()].push_back(fp);
+  }
+
+  // Collect the fields of the expression, in order of appearance.
+  std::vector<std::string> names = expr.fields;
+  for (const auto &c : expr.conditions) {
+    names.push_back(c.field);
+  }
+  if (names.empty()) {
+    FLETCHER_LOG(FATAL, "Kernel expression COUNT(*) without conditions refers to no field, so there are no rows to "
+                        "count.");
+  }
+  for (const auto &name : names) {
+    if (result.index.count(name) > 0) {
+      continue;
+    }
+    auto ports = data_ports.find(name);
+    if ((ports == data_ports.end()) || (ports->second.size() != 1)) {
+      FLETCHER_LOG(FATAL, "Kernel expression refers to field " << name << ", which "
+          << (ports == data_ports.end() ? "does not exist." : "exists in multiple schemas."));
+    }
+    const auto *fp = ports->second[0];
+    if (result.streams.empty()) {
+      result.schema = fp->fletcher_schema_->name();
+    } else if (fp->fletcher_schema_->name() != result.schema) {
+      FLETCHER_LOG(FATAL, "Kernel expression refers to fields of schemas " << result.schema << " and "
+                                                                          << fp->fletcher_schema_->name()
+                                                                          << ", while it evaluates a single schema.");
+    }
+    auto is_signed = IsSignedKey(*fp->field_->type());
+    if (!is_signed) {
+      FLETCHER_LOG(FATAL, "Kernel expression field " << name << " of type " << fp->field_->type()->ToString()
+                                                     << " is not supported. Use an integer, date, time or timestamp.");
+    }
+    result.index[name] = result.streams.size();
+    result.streams.push_back({fp->name(), *is_signed, fp->field_->nullable()});
+  }
+  for (const auto &d : data_ports) {
+    if (result.index.count(d.first) == 0) {
+      for (const auto &fp : d.second) {
+        result.unused.push_back(fp->name());
+      }
+    }
+  }
+
+  for (const auto &c : expr.conditions) {
+    if (IsLiteral(c.reg)) {
+      try {
+        std::stoull(c.reg);
+      } catch (const std::out_of_range &) {
+        FLETCHER_LOG(FATAL, "Kernel expression literal " << c.reg << " does not fit in 64 bits.");
+      }
+    } else if ((result.registers.count(c.reg) == 0) || (result.registers.at(c.reg) < 2)) {
+      FLETCHER_LOG(FATAL, "Kernel expression refers to register " << c.reg << ", which is not a custom kernel "
+                                                                     "control register of at least two bits. Add it "
+                                                                     "with --regs.");
+    }
+  }
+  return result;
+}
+
+/// @brief Return a VHDL expression converting a value of some signedness to the signed width of the kernel.
+std::string Widen(const std::string &value, bool is_signed) {
+  if (is_signed) {
+    return "resize(signed(" + value + "), " + std::to_string(VALUE_WIDTH) + ")";
+  }
+  return "signed(resize(unsigned(" + value + "), " + std::to_string(VALUE_WIDTH) + "))";
+}
+
+/// @brief Return a VHDL literal of the signed width of the kernel holding a non-negative number.
+std::string Literal(const std::string &str) {
+  auto value = std::stoull(str);
+  std::string bits(VALUE_WIDTH, '0');
+  for (int b = 0; b < 64; b++) {
+    if ((value >> b) & 1u) {
+      bits[VALUE_WIDTH - 1 - b] = '1';
+    }
+  }
+  return "signed'(\"" + bits + "\")";
+}
+
+}  // namespace
+
+void ImplementKernel(Kernel *kernel, const KernelExpr &expr) {
+  // Exit early if the design does not support the expression.
+  Resolve(*kernel, expr);
+  // The implementation is generated by GenerateKernelVHDL.
+  kernel->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  kernel->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  kernel->SetMeta(cerata::vhdl::meta::PACKAGE, kernel->name() + "_pkg");
+}
+
+std::string GenerateKernelVHDL(const Kernel &kernel, const KernelExpr &expr) {
+  auto ports = Resolve(kernel, expr);
+  const auto &streams = ports.streams;
+  auto n = streams.size();
+  auto sig = [](const std::string &s, const std::string &suffix) { return s + "_" + suffix; };
+  auto wide = [&](const std::string &field) {
+    const auto &s = streams[ports.index.at(field)];
+    return Widen(s.port, s.is_signed);
+  };
+  auto w = std::to_string(VALUE_WIDTH);
+
+  std::stringstream ss;
+  ss << DEFAULT_NOTICE;
+  ss << "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n"
+        "package " << kernel.name() << "_pkg is\n";
+  ss << cerata::vhdl::Decl::Generate(kernel, false, 1).ToString();
+  ss << "end package;\n"
+        "\n"
+        "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n";
+  ss << cerata::vhdl::Decl::Generate(kernel, true).ToString();
+  ss << "\n"
+        "-- Aggregates the rows of " << ports.schema << " that pass all conditions of the kernel expression.\n"
+        "architecture Implementation of " << kernel.name() << " is\n"
+        "  type state_t is (STATE_IDLE, STATE_STREAM, STATE_UNLOCK, STATE_DONE);\n"
+        "  signal state       : state_t;\n"
+        "  -- Streams of which the command was not yet accepted.\n"
+        "  signal cmd_pending : std_logic_vector(" << n - 1 << " downto 0);\n"
+        "  -- Streams of which the unlock was not yet accepted.\n"
+        "  signal unl_pending : std_logic_vector(" << n - 1 << " downto 0);\n"
+        "  -- All input streams hold the next row.\n"
+        "  signal in_valid    : std_logic;\n"
+        "  -- The next row is accepted from the inputs.\n"
+        "  signal accept      : std_logic;\n"
+        "  -- The next row holds valid values and passes all conditions.\n"
+        "  signal pass        : std_logic;\n"
+        "  -- The value of the next row.\n"
+        "  signal value       : signed(" << VALUE_WIDTH - 1 << " downto 0);\n";
+  if (expr.op == '*') {
+    ss << "  signal product     : signed(" << 2 * VALUE_WIDTH - 1 << " downto 0);\n";
+  }
+  ss << "  -- The value of the row accepted in the previous cycle, and whether it is aggregated.\n"
+        "  signal agg_value   : signed(" << VALUE_WIDTH - 1 << " downto 0);\n"
+        "  signal agg_valid   : std_logic;\n"
+        "  -- The aggregate, and whether any row was aggregated.\n"
+        "  signal acc         : signed(" << VALUE_WIDTH - 1 << " downto 0);\n"
+        "  signal any         : std_logic;\n"
+        "begin\n"
+        "\n";
+
+  // Issue a command for the range of the RecordBatch to every stream, and accept the unlocks.
+  for (size_t i = 0; i < n; i++) {
+    const auto &p = streams[i].port;
+    ss << "  " << sig(p, "cmd_valid") << " <= cmd_pending(" << i << ");\n"
+       << "  " << sig(p, "cmd_firstIdx") << " <= " << ports.schema << "_firstidx;\n"
+       << "  " << sig(p, "cmd_lastIdx") << " <= " << ports.schema << "_lastidx;\n"
+       << "  " << sig(p, "cmd_tag") << " <= (others => '0');\n"
+       << "  " << sig(p, "unl_ready") << " <= unl_pending(" << i << ");\n";
+  }
+  ss << "\n";
+  for (const auto &p : ports.unused) {
+    ss << "  " << sig(p, "ready") << " <= '0';\n"
+       << "  " << sig(p, "cmd_valid") << " <= '0';\n"
+       << "  " << sig(p, "cmd_firstIdx") << " <= (others => '0');\n"
+       << "  " << sig(p, "cmd_lastIdx") << " <= (others => '0');\n"
+       << "  " << sig(p, "cmd_tag") << " <= (others => '0');\n"
+       << "  " << sig(p, "unl_ready") << " <= '0';\n";
+  }
+  for (const auto &mp : ports.status) {
+    ss << "  " << mp->name() << " <= " << (mp->reg.width == 1 ? "'0'" : "(others => '0')") << ";\n";
+  }
+  if (!ports.unused.empty() || !ports.status.empty()) {
+    ss << "\n";
+  }
+
+  ss << "  in_valid <= ";
+  for (size_t i = 0; i < n; i++) {
+    ss << (i > 0 ? " and " : "") << sig(streams[i].port, "valid");
+  }
+  ss << ";\n"
+        "  accept   <= in_valid when state = STATE_STREAM else '0';\n";
+  for (const auto &s : streams) {
+    ss << "  " << sig(s.port, "ready") << " <= accept;\n";
+  }
+  ss << "\n";
+
+  ss << "  pass <= '1' when (" << sig(streams[0].port, "dvalid") << " = '1')";
+  for (const auto &s : streams) {
+    if (s.nullable) {
+      ss << "\n                and (" << sig(s.port, "validity") << " = '1')";
+    }
+  }
+  for (const auto &c : expr.conditions) {
+    const auto &s = streams[ports.index.at(c.field)];
+    auto rhs = IsLiteral(c.reg) ? Literal(c.reg) : Widen(c.reg, s.is_signed);
+    ss << "\n                and (" << wide(c.field) << " " << ToVHDL(c.op) << " " << rhs << ")";
+  }
+  ss << "\n          else '0';\n\n";
+
+  if (expr.fields.empty() || (expr.func == AggregateFunc::COUNT)) {
+    ss << "  value <= to_signed(1, " << w << ");\n";
+  } else if (expr.fields.size() == 1) {
+    ss << "  value <= " << wide(expr.fields[0]) << ";\n";
+  } else if (expr.op == '*') {
+    ss << "  product <= " << wide(expr.fields[0]) << " * " << wide(expr.fields[1]) << ";\n"
+       << "  value   <= product(" << VALUE_WIDTH - 1 << " downto 0);\n";
+  } else {
+    ss << "  value <= " << wide(expr.fields[0]) << " " << expr.op << " " << wide(expr.fields[1]) << ";\n";
+  }
+  ss << "\n"
+        "  result <= std_logic_vector(acc(63 downto 0)) when any = '1' else (others => '0');\n"
+        "  idle   <= '1' when (state = STATE_IDLE) or (state = STATE_DONE) else '0';\n"
+        "  busy   <= '1' when (state = STATE_STREAM) or (state = STATE_UNLOCK) else '0';\n"
+        "  done   <= '1' when state = STATE_DONE else '0';\n"
+        "\n";
+
+  ss << "  seq_proc: process (kcd_clk) is\n"
+        "  begin\n"
+        "    if rising_edge(kcd_clk) then\n"
+        "      -- Aggregate the row accepted in the previous cycle.\n"
+        "      if agg_valid = '1' then\n";
+  switch (expr.func) {
+    case AggregateFunc::SUM:
+    case AggregateFunc::COUNT:
+      ss << "        acc <= acc + agg_value;\n";
+      break;
+    case AggregateFunc::MIN:
+    case AggregateFunc::MAX:
+      ss << "        if (any = '0') or (agg_value " << (expr.func == AggregateFunc::MIN ? "<" : ">")
+         << " acc) then\n"
+            "          acc <= agg_value;\n"
+            "        end if;\n";
+      break;
+  }
+  ss << "        any <= '1';\n"
+        "      end if;\n"
+        "      agg_valid <= accept and pass;\n"
+        "      agg_value <= value;\n"
+        "\n";
+  for (size_t i = 0; i < n; i++) {
+    const auto &p = streams[i].port;
+    ss << "      if " << sig(p, "cmd_ready") << " = '1' then\n"
+          "        cmd_pending(" << i << ") <= '0';\n"
+          "      end if;\n"
+          "      if " << sig(p, "unl_valid") << " = '1' then\n"
+          "        unl_pending(" << i << ") <= '0';\n"
+          "      end if;\n";
+  }
+  ss << "\n"
+        "      case state is\n"
+        "        when STATE_IDLE =>\n"
+        "          if start = '1' then\n"
+        "            cmd_pending <= (others => '1');\n"
+        "            unl_pending <= (others => '1');\n"
+        "            acc         <= (others => '0');\n"
+        "            any         <= '0';\n"
+        "            state       <= STATE_STREAM;\n"
+        "          end if;\n"
+        "\n"
+        "        when STATE_STREAM =>\n"
+        "          if (accept = '1') and (" << sig(streams[0].port, "last") << " = '1') then\n"
+        "            state <= STATE_UNLOCK;\n"
+        "          end if;\n"
+        "\n"
+        "        when STATE_UNLOCK =>\n"
+        "          if unsigned(unl_pending) = 0 then\n"
+        "            state <= STATE_DONE;\n"
+        "          end if;\n"
+        "\n"
+        "        when STATE_DONE =>\n"
+        "          null;\n"
+        "      end case;\n"
+        "\n"
+        "      if (kcd_reset = '1') or (reset = '1') then\n"
+        "        state       <= STATE_IDLE;\n"
+        "        cmd_pending <= (others => '0');\n"
+        "        unl_pending <= (others => '0');\n"
+        "        agg_valid   <= '0';\n"
+        "        acc         <= (others => '0');\n"
+        "        any         <= '0';\n"
+        "      end if;\n"
+        "    end if;\n"
+        "  end process;\n"
+        "\n"
+        "end architecture;\n";
+  return ss.str();
+}
+
+}  // namespace fletchgen
@@ -0,0 +1,79 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fletchgen/filter.h"
+#include "fletchgen/kernel.h"
+
+namespace fletchgen {
+
+/// @brief Aggregate functions of a kernel expression.
+enum class AggregateFunc { SUM, COUNT, MIN, MAX };
+
+/**
+ * @brief A kernel expression that aggregates the rows of a RecordBatch passing some conditions, e.g.
+ *        "SUM(price * quantity) WHERE quantity > min_quantity AND price < 1000".
+ */
+struct KernelExpr {
+  /// The aggregate function.
+  AggregateFunc func = AggregateFunc::SUM;
+  /// The fields of the aggregated value. None for COUNT(*), or two if they are combined by an operator.
+  std::vector<std::string> fields;
+  /// The operator combining two fields, i.e. '+', '-' or '*'.
+  char op = 0;
+  /// The conditions every aggregated row passes. The right-hand side is a custom kernel register or a literal.
+  std::vector<FilterExpr> conditions;
+};
+
+/**
+ * @brief Parse a kernel expression of the form "<func>(<value>) [WHERE <condition> [AND <condition>]...]".
+ *
+ * <func> is SUM, COUNT, MIN or MAX. <value> is a field, or two fields combined by +, - or *, or * for COUNT. Every
+ * <condition> is of the form "<field> <op> <register or literal>", see ParseFilterExpr().
+ *
+ * @param str The expression.
+ * @return The parsed expression, or std::nullopt if it is malformed.
+ */
+std::optional<KernelExpr> ParseKernelExpr(const std::string &str);
+
+/**
+ * @brief Let Fletchgen generate the implementation of a kernel that evaluates an expression, instead of a template.
+ *
+ * The kernel becomes a primitive component with its own VHDL source, see GenerateKernelVHDL(). Exits if the design
+ * does not support the expression.
+ *
+ * @param kernel The kernel.
+ * @param expr   The expression to evaluate.
+ */
+void ImplementKernel(Kernel *kernel, const KernelExpr &expr);
+
+/**
+ * @brief Return the VHDL source of the package and the implementation of a kernel that evaluates an expression.
+ *
+ * Upon start, the kernel issues a command for the range of its RecordBatch to every field in the expression. It
+ * accepts a row every cycle, aggregates the rows that pass all conditions, awaits the unlocks, and returns the
+ * aggregate in the result register. Rows with a null in any field of the expression are skipped.
+ *
+ * @param kernel The kernel, of which the ports are derived from the design.
+ * @param expr   The expression to evaluate.
+ * @return The VHDL source.
+ */
+std::string GenerateKernelVHDL(const Kernel &kernel, const KernelExpr &expr);
+
+}  // namespace fletchgen
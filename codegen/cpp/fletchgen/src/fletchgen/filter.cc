@@ -0,0 +1,258 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/filter.h"
+
+#include <cerata/api.h>
+#include <cerata/vhdl/vhdl.h>
+#include <fletcher/common.h>
+
+#include <memory>
+#include <optional>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fletchgen/array.h"
+#include "fletchgen/basic_types.h"
+#include "fletchgen/utils.h"
+
+namespace fletchgen {
+
+using cerata::port;
+using cerata::vector;
+
+std::string ToVHDL(FilterOp op) {
+  switch (op) {
+    case FilterOp::GT: return ">";
+    case FilterOp::GE: return ">=";
+    case FilterOp::LT: return "<";
+    case FilterOp::LE: return "<=";
+    case FilterOp::EQ: return "=";
+    case FilterOp::NE: return "/=";
+  }
+  return "";
+}
+
+std::optional<FilterExpr> ParseFilterExpr(const std::string &str) {
+  std::regex expr(R"(^\s*(\w+)\s*(>=|<=|==|!=|>|<)\s*(\w+)\s*$)");
+  std::smatch matches;
+  if (!std::regex_match(str, matches, expr)) {
+    return std::nullopt;
+  }
+  FilterExpr result;
+  result.field = matches[1].str();
+  auto op = matches[2].str();
+  if (op == ">") result.op = FilterOp::GT;
+  else if (op == ">=") result.op = FilterOp::GE;
+  else if (op == "<") result.op = FilterOp::LT;
+  else if (op == "<=") result.op = FilterOp::LE;
+  else if (op == "==") result.op = FilterOp::EQ;
+  else result.op = FilterOp::NE;
+  result.reg = matches[3].str();
+  return result;
+}
+
+std::optional<FilterExpr> GetFilterExpr(const arrow::Schema &schema) {
+  auto str = fletcher::GetMeta(schema, fletcher::meta::FILTER);
+  if (str.empty()) {
+    return std::nullopt;
+  }
+  auto result = ParseFilterExpr(str);
+  if (!result) {
+    FLETCHER_LOG(FATAL, "Malformed filter expression \"" << str << "\" of schema "
+                                                         << fletcher::GetMeta(schema, fletcher::meta::NAME)
+                                                         << ". Expected \"<field> <op> <register>\".");
+  }
+  return result;
+}
+
+std::optional<bool> IsSignedKey(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::UINT8:
+    case arrow::Type::UINT16:
+    case arrow::Type::UINT32:
+    case arrow::Type::UINT64: return false;
+    case arrow::Type::INT8:
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::INT64:
+    case arrow::Type::DATE32:
+    case arrow::Type::DATE64:
+    case arrow::Type::TIME32:
+    case arrow::Type::TIME64:
+    case arrow::Type::TIMESTAMP: return true;
+    default: return std::nullopt;
+  }
+}
+
+Filter::Filter(const std::string &name, const RecordBatch &recordbatch, FilterExpr expr, uint32_t threshold_width)
+    : Component(name), expr(std::move(expr)) {
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  Add(kcd);
+  Add(port("threshold", vector(threshold_width), Port::Dir::IN, kernel_cd()));
+
+  std::optional<size_t> key;
+  cerata::NodeMap rebinding;
+  for (const auto &fp : recordbatch.GetFieldPorts(FieldPort::Function::ARROW)) {
+    const auto &field = *fp->field_;
+    auto epc = fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1);
+    if ((GetArrayDataSpec(field).first != 1) || (epc != 1)) {
+      FLETCHER_LOG(FATAL, "Field " << field.name() << " of filtered RecordBatch " << recordbatch.name()
+                                   << " has more than one stream or element per transfer, which is not supported.");
+    }
+    if (field.name() == this->expr.field) {
+      auto is_signed = IsSignedKey(*field.type());
+      if (!is_signed) {
+        FLETCHER_LOG(FATAL, "Filter key field " << field.name() << " of type " << field.type()->ToString()
+                                                << " can not be compared. Use an integer, date, time or timestamp.");
+      }
+      key = streams.size();
+      signed_ = *is_signed;
+      key_width_ = GetFixedWidthTypeBitWidth(*field.type());
+    }
+    // Make a copy of the RecordBatch data port for either side of the filter.
+    auto in = dynamic_cast<FieldPort *>(fp->CopyOnto(this, "in_" + fp->name(), &rebinding));
+    in->Reverse();
+    fp->CopyOnto(this, "out_" + fp->name(), &rebinding);
+    streams.push_back(fp->name());
+    nullable_.push_back(field.nullable());
+  }
+  if (!key) {
+    FLETCHER_LOG(FATAL, "Filter key field " << this->expr.field << " does not exist in RecordBatch "
+                                            << recordbatch.name() << ".");
+  }
+  key_ = *key;
+
+  // The implementation is generated by GenerateVHDL.
+  SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  SetMeta(cerata::vhdl::meta::PACKAGE, name + "_pkg");
+}
+
+std::string Filter::GenerateVHDL() const {
+  auto n = streams.size();
+  auto in = [](const std::string &s, const std::string &sig = "") { return "in_" + s + (sig.empty() ? "" : "_" + sig); };
+  auto out = [](const std::string &s, const std::string &sig = "") {
+    return "out_" + s + (sig.empty() ? "" : "_" + sig);
+  };
+  const auto &key = streams[key_];
+  auto num = signed_ ? std::string("signed") : std::string("unsigned");
+
+  std::stringstream ss;
+  ss << DEFAULT_NOTICE;
+  ss << "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n"
+        "package " << name() << "_pkg is\n";
+  ss << cerata::vhdl::Decl::Generate(*this, false, 1).ToString();
+  ss << "end package;\n"
+        "\n"
+        "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n";
+  ss << cerata::vhdl::Decl::Generate(*this, true).ToString();
+  ss << "\n"
+        "-- Drops all rows for which " << expr.field << " " << ToVHDL(expr.op) << " " << expr.reg << " does not hold.\n"
+        "architecture Implementation of " << name() << " is\n"
+        "  -- Output streams that hold a row that was not yet accepted.\n"
+        "  signal pending : std_logic_vector(" << n - 1 << " downto 0);\n"
+        "  -- All input streams hold the next row.\n"
+        "  signal in_valid : std_logic;\n"
+        "  -- Every output stream will have accepted its row at the end of this cycle.\n"
+        "  signal out_free : std_logic;\n"
+        "  -- The next row is accepted from the inputs.\n"
+        "  signal accept   : std_logic;\n"
+        "  -- The next row passes the filter.\n"
+        "  signal pass     : std_logic;\n"
+        "begin\n"
+        "\n";
+
+  ss << "  in_valid <= ";
+  for (size_t i = 0; i < n; i++) {
+    ss << (i > 0 ? " and " : "") << in(streams[i], "valid");
+  }
+  ss << ";\n\n";
+
+  ss << "  out_free <= '1' when ";
+  for (size_t i = 0; i < n; i++) {
+    ss << (i > 0 ? "\n                  and " : "") << "((pending(" << i << ") = '0') or (" << out(streams[i], "ready")
+       << " = '1'))";
+  }
+  ss << "\n              else '0';\n\n";
+
+  ss << "  pass <= '1' when (" << in(key, "dvalid") << " = '1')";
+  if (nullable_[key_]) {
+    ss << " and (" << in(key, "validity") << " = '1')";
+  }
+  ss << "\n                and (" << num << "(" << in(key) << ") " << ToVHDL(expr.op) << " resize(" << num
+     << "(threshold), " << key_width_ << "))\n"
+        "          else '0';\n\n";
+
+  ss << "  accept <= in_valid and out_free;\n\n";
+  for (const auto &s : streams) {
+    ss << "  " << in(s, "ready") << " <= accept;\n";
+  }
+  ss << "\n";
+
+  ss << "  seq_proc: process (kcd_clk) is\n"
+        "  begin\n"
+        "    if rising_edge(kcd_clk) then\n";
+  for (size_t i = 0; i < n; i++) {
+    ss << "      if " << out(streams[i], "ready") << " = '1' then\n"
+          "        pending(" << i << ") <= '0';\n"
+          "      end if;\n";
+  }
+  ss << "\n"
+        "      -- Forward rows that pass, and the last transfer of a command such that it is closed.\n"
+        "      if (accept = '1') and ((pass = '1') or (" << in(key, "last") << " = '1')) then\n"
+        "        pending <= (others => '1');\n";
+  for (size_t i = 0; i < n; i++) {
+    const auto &s = streams[i];
+    ss << "        " << out(s, "dvalid") << " <= " << in(s, "dvalid") << " and pass;\n";
+    ss << "        " << out(s, "last") << " <= " << in(s, "last") << ";\n";
+    if (nullable_[i]) {
+      ss << "        " << out(s, "validity") << " <= " << in(s, "validity") << ";\n";
+    }
+    ss << "        " << out(s) << " <= " << in(s) << ";\n";
+  }
+  ss << "      end if;\n"
+        "\n"
+        "      if kcd_reset = '1' then\n"
+        "        pending <= (others => '0');\n"
+        "      end if;\n"
+        "    end if;\n"
+        "  end process;\n"
+        "\n";
+  for (size_t i = 0; i < n; i++) {
+    ss << "  " << out(streams[i], "valid") << " <= pending(" << i << ");\n";
+  }
+  ss << "\n"
+        "end architecture;\n";
+  return ss.str();
+}
+
+std::shared_ptr<Filter> filter(const std::string &name,
+                               const RecordBatch &recordbatch,
+                               const FilterExpr &expr,
+                               uint32_t threshold_width) {
+  auto result = std::make_shared<Filter>(name, recordbatch, expr, threshold_width);
+  cerata::default_component_pool()->Add(result);
+  return result;
+}
+
+}  // namespace fletchgen
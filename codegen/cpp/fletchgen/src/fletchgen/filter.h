@@ -0,0 +1,97 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cerata/api.h>
+#include <arrow/api.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fletchgen/recordbatch.h"
+
+namespace fletchgen {
+
+using cerata::Component;
+
+/// @brief Comparison operators of a filter expression.
+enum class FilterOp { GT, GE, LT, LE, EQ, NE };
+
+/// @brief Return the VHDL operator of a filter comparison.
+std::string ToVHDL(FilterOp op);
+
+/// @brief A filter expression that compares a field with a custom kernel register, e.g. "price > min_price".
+struct FilterExpr {
+  /// The name of the field to compare.
+  std::string field;
+  /// The comparison operator.
+  FilterOp op;
+  /// The name of the custom kernel register holding the value to compare against.
+  std::string reg;
+};
+
+/// @brief Parse a filter expression of the form "<field> <op> <register>". Returns std::nullopt if it is malformed.
+std::optional<FilterExpr> ParseFilterExpr(const std::string &str);
+
+/// @brief Return whether a field of some type can be compared, and whether it is signed. Returns std::nullopt if not.
+std::optional<bool> IsSignedKey(const arrow::DataType &type);
+
+/// @brief Return the filter expression of a schema, if it has one.
+std::optional<FilterExpr> GetFilterExpr(const arrow::Schema &schema);
+
+/**
+ * @brief A stage between the Arrow data streams of a RecordBatchReader and the kernel that drops every row failing a
+ *        filter expression.
+ *
+ * Every field must result in a single stream with one element per transfer. The streams are joined, and a row is only
+ * forwarded to all output streams if the key field passes the comparison with the threshold port. The last transfer
+ * of a command is always forwarded, with dvalid cleared if its row fails, such that the kernel still sees the end of
+ * the command. Rows are accepted every cycle as long as the kernel accepts them.
+ *
+ * The implementation depends on the schema, so Fletchgen generates it as a primitive component with its own VHDL
+ * source, see GenerateVHDL().
+ */
+struct Filter : Component {
+  /// @brief Construct a new Filter for the Arrow data ports of a RecordBatch.
+  Filter(const std::string &name, const RecordBatch &recordbatch, FilterExpr expr, uint32_t threshold_width);
+
+  /// @brief Return the VHDL source of the package and entity of this filter.
+  [[nodiscard]] std::string GenerateVHDL() const;
+
+  /// The filter expression.
+  FilterExpr expr;
+  /// The names of the Arrow data ports that pass through this filter, in order.
+  std::vector<std::string> streams;
+
+ private:
+  /// Whether the field of every stream is nullable.
+  std::vector<bool> nullable_;
+  /// The index of the stream of the key field.
+  size_t key_ = 0;
+  /// Whether the key field must be compared as a signed number.
+  bool signed_ = false;
+  /// The width of the key field.
+  int key_width_ = 0;
+};
+
+/// @brief Make a new Filter component for a RecordBatch. Returns a shared pointer to the new Filter.
+std::shared_ptr<Filter> filter(const std::string &name,
+                               const RecordBatch &recordbatch,
+                               const FilterExpr &expr,
+                               uint32_t threshold_width);
+
+}  // namespace fletchgen
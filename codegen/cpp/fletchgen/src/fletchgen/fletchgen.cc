@@ -20,6 +20,7 @@
 #include <fletcher/common.h>
 
 #include <fstream>
+#include <mutex>
 #include <thread>
 
 #include "fletchgen/options.h"
@@ -28,7 +29,10 @@
 #include "fletchgen/srec/recordbatch.h"
 #include "fletchgen/top/sim.h"
 #include "fletchgen/top/axi.h"
+#include "fletchgen/hls/vivado.h"
 #include "fletchgen/static_vhdl.h"
+#include "fletchgen/incremental.h"
+#include "fletchgen/perf.h"
 
 namespace fletchgen {
 
@@ -59,6 +63,17 @@ int fletchgen(int argc, char **argv) {
     return 0;
   }
 
+  // Skip generation if nothing changed since the last run in this output directory, and its output is still there.
+  // Files written by this run are recognized by their modification time, of which file systems may round down.
+  auto run_start = std::filesystem::file_time_type::clock::now() - std::chrono::seconds(2);
+  auto input_hash = HashInputs(*options);
+  if (!options->force && IsUpToDate(options->output_dir, input_hash)) {
+    FLETCHER_LOG(INFO, "Inputs unchanged since the last run in " + options->output_dir
+        + ", skipping generation. Use --force to regenerate.");
+    fletcher::StopLogging();
+    return 0;
+  }
+
   // Load input files
   if (!options->LoadRecordBatches()) return false;
   if (!options->LoadSchemas()) return false;
@@ -74,36 +89,115 @@ int fletchgen(int argc, char **argv) {
 
   // Generate the whole Cerata design.
   fletchgen::Design design(options);
-  // Run vhdmmio to generate the mmio infrastructure.
-  std::thread vhdmmio(Design::RunVhdmmio, design.all_regs, design.mmio_spec);
+  // Generate the register manifest, such that the run-time can locate registers by name.
+  cerata::CreateDir(options->output_dir);
+  auto mmio_manifest = std::ofstream(options->output_dir + "/fletchgen.mmio.manifest");
+  mmio_manifest << fletchgen::GenerateMmioManifest(design.all_regs, design.mmio_spec);
+  mmio_manifest.close();
+  // Generate a header with the register layout, such that host code can access registers without run-time lookups.
+  auto mmio_header = std::ofstream(options->output_dir + "/fletchgen.mmio.h");
+  mmio_header << fletchgen::GenerateMmioHeader(design.all_regs, design.mmio_spec, options->kernel_name);
+  mmio_header.close();
+  // Pass the platform profile on to the run-time, such that it can pick up its hints.
+  if (!options->platform.empty()) {
+    auto profile = std::ofstream(options->output_dir + "/fletchgen.platform.profile");
+    profile << options->profile.ToString();
+    profile.close();
+  }
 
+  // Estimate the throughput of the design, such that bottlenecks can be spotted without running synthesis.
+  if (options->perf_report) {
+    auto report = fletchgen::EstimatePerformance(design.schema_set->schemas(),
+                                                 BusDim::FromString(options->bus_dims[0], BusDim())).ToString();
+    FLETCHER_LOG(INFO, "Estimated throughput:\n" + report);
+    auto perf_out = std::ofstream(options->output_dir + "/fletchgen.perf");
+    perf_out << report;
+    perf_out.close();
+  }
 
-  // Generate SREC output
-  if (options->MustGenerateSREC()) {
-    FLETCHER_LOG(INFO, "Generating SREC output.");
-    auto srec_out = std::ofstream(options->srec_out_path);
-    fletchgen::srec::GenerateReadSREC(design.batch_desc, &srec_batch_desc, &srec_out, 64);
-    srec_out.close();
+  // Generate the mmio infrastructure. The native back-end is fast enough to not bother with running it concurrently,
+  // and assigns the register addresses before the rest of the design uses them.
+  std::thread vhdmmio;
+  if (options->mmio_backend == "vhdmmio") {
+    vhdmmio = std::thread(Design::RunVhdmmio, design.all_regs, design.mmio_spec);
+  } else {
+    FLETCHER_LOG(INFO, "Generating MMIO register file.");
+    Design::GenerateMmio(design.all_regs, design.mmio_spec, options->output_dir + "/vhdl");
   }
 
+
+  // Generate SREC and memory image output. This only depends on the RecordBatches, not on the Cerata design, so it
+  // can run while the HDL output is generated.
+  std::thread memory_models([&]() {
+    if (options->MustGenerateSREC()) {
+      FLETCHER_LOG(INFO, "Generating SREC output.");
+      auto srec_out = std::ofstream(options->srec_out_path);
+      fletchgen::srec::GenerateReadSREC(design.batch_desc, &srec_batch_desc, &srec_out, 64);
+      srec_out.close();
+    }
+
+    if (options->MustGenerateImage()) {
+      FLETCHER_LOG(INFO, "Generating memory image output.");
+      // The layout is identical to the SREC layout, so only keep one set of descriptors.
+      std::vector<fletcher::RecordBatchDescription> image_batch_desc;
+      auto image_out = std::ofstream(options->image_out_path, std::ios::binary);
+      auto manifest_out = std::ofstream(options->image_out_path + ".manifest");
+      fletchgen::srec::GenerateReadImage(design.batch_desc, &image_batch_desc, &image_out, &manifest_out, 64);
+      image_out.close();
+      manifest_out.close();
+      if (srec_batch_desc.empty()) {
+        srec_batch_desc = image_batch_desc;
+      }
+    }
+  });
+
   auto &l = options->languages;
+  auto specs = design.GetOutputSpec();
 
-  // Generate DOT output.
+  // Generate DOT output. Every OutputSpec results in its own file, and DOT generation does not modify the design, so
+  // the files are generated in parallel.
   if (options->MustGenerate("dot")) {
     FLETCHER_LOG(INFO, "Generating DOT output.");
-    auto dot = cerata::dot::DOTOutputGenerator(options->output_dir, design.GetOutputSpec());
-    dot.Generate();
+    cerata::CreateDir(options->output_dir + "/dot");
+    ParallelFor(specs.size(), options->jobs, [&](size_t i) {
+      auto dot = cerata::dot::DOTOutputGenerator(options->output_dir, {specs[i]});
+      dot.Generate();
+    });
     // Remove dot from the list of target languages
     l.erase(std::remove(l.begin(), l.end(), std::string("dot")), l.end());
   }
 
-  // Generate VHDL output
+  // Generate VHDL output. This stays sequential, because Cerata transforms components into VHDL-compatible versions
+  // in place while generating, and those transformations touch the graph shared by all components.
   if (options->MustGenerate("vhdl")) {
     FLETCHER_LOG(INFO, "Generating VHDL output.");
     auto vhdl = cerata::vhdl::VHDLOutputGenerator(options->output_dir,
-                                                  design.GetOutputSpec(),
+                                                  specs,
                                                   fletchgen::DEFAULT_NOTICE);
     vhdl.Generate();
+    // Filters are primitives with a schema-dependent implementation, so they are generated separately.
+    for (const auto &f : design.nucleus_comp->filters) {
+      auto filter_file_path = options->output_dir + "/vhdl/" + f->name() + ".gen.vhd";
+      FLETCHER_LOG(INFO, "Saving filter to: " + filter_file_path);
+      auto filter_file = std::ofstream(filter_file_path);
+      filter_file << f->GenerateVHDL();
+    }
+    if (design.kernel_expr) {
+      auto kernel_file_path = options->output_dir + "/vhdl/" + design.kernel_comp->name() + ".gen.vhd";
+      FLETCHER_LOG(INFO, "Saving kernel implementation to: " + kernel_file_path);
+      auto kernel_file = std::ofstream(kernel_file_path);
+      kernel_file << fletchgen::GenerateKernelVHDL(*design.kernel_comp, *design.kernel_expr);
+    }
+    if (design.pipelined_kernel) {
+      // The template is meant to be edited, so an existing one is kept when backing up, like the default template.
+      auto kernel_file_path = options->output_dir + "/vhdl/" + design.kernel_comp->name() + ".gen.vhd";
+      if (options->backup && cerata::FileExists(kernel_file_path)) {
+        kernel_file_path += ".bak";
+      }
+      FLETCHER_LOG(INFO, "Saving pipelined kernel template to: " + kernel_file_path);
+      auto kernel_file = std::ofstream(kernel_file_path);
+      kernel_file << fletchgen::GeneratePipelinedKernelVHDL(*design.kernel_comp);
+    }
     // Remove vhdl from the list of target languages
     l.erase(std::remove(l.begin(), l.end(), std::string("vhdl")), l.end());
   }
@@ -117,6 +211,9 @@ int fletchgen(int argc, char **argv) {
     }
   }
 
+  // The simulation top level needs the memory model layout.
+  memory_models.join();
+
   // Generate simulation top level
   if (options->MustGenerateDesign() && options->sim_top) {
     std::ofstream sim_file;
@@ -129,11 +226,20 @@ int fletchgen(int argc, char **argv) {
       std::ofstream srec_out(options->srec_sim_dump);
       srec_out.close();
     }
+    fletchgen::top::SimTiming timing;
+    timing.clock_period = options->sim_clock_period;
+    timing.kernel_clock_period = options->sim_kernel_clock_period;
+    timing.latency = options->sim_latency;
+    timing.bandwidth = options->sim_bandwidth;
+    timing.max_outstanding = options->sim_max_outstanding;
     fletchgen::top::GenerateSimTop(design,
                                    {&sim_file},
                                    options->srec_out_path,
                                    options->srec_sim_dump,
-                                   srec_batch_desc);
+                                   srec_batch_desc,
+                                   options->MustGenerateImage() ? options->image_out_path : "",
+                                   timing,
+                                   options->sim_cosim);
     sim_file.close();
   }
 
@@ -143,24 +249,29 @@ int fletchgen(int argc, char **argv) {
     std::string axi_file_path = options->output_dir + "/vhdl/AxiTop.gen.vhd";
     FLETCHER_LOG(INFO, "Saving AXI top-level design to: " + axi_file_path);
     axi_file = std::ofstream(axi_file_path);
+    fletchgen::top::AxiConverterConfig converters;
+    converters.enable_fifo = options->axi_fifo;
+    converters.slv_req_slice_depth = options->axi_slice_depths[0];
+    converters.slv_dat_slice_depth = options->axi_slice_depths[1];
+    converters.mst_req_slice_depth = options->axi_slice_depths[2];
+    converters.mst_dat_slice_depth = options->axi_slice_depths[3];
     fletchgen::top::GenerateAXITop(*design.mantle_comp,
                                    *design.schema_set,
                                    design.mmio_spec,
                                    design.external,
-                                   {&axi_file});
+                                   {&axi_file},
+                                   options->num_instances,
+                                   converters);
     axi_file.close();
   }
 
   // Generate Vivado HLS template
   if (options->vivado_hls) {
-    FLETCHER_LOG(WARNING, "Vivado HLS template output not yet implemented.");
-    /*
     auto hls_template_path = options->output_dir + "/vivado_hls/" + options->kernel_name + ".cpp";
     FLETCHER_LOG(INFO, "Generating Vivado HLS output: " + hls_template_path);
     cerata::CreateDir(options->output_dir + "/vivado_hls");
     auto hls_template_file = std::ofstream(hls_template_path);
-    hls_template_file << fletchgen::hls::GenerateVivadoHLSTemplate(*design.kernel);
-    */
+    hls_template_file << fletchgen::hls::GenerateVivadoHLSTemplate(*design.kernel_comp);
   }
 
   // Write static VHDL support files for Fletcher.
@@ -169,10 +280,13 @@ int fletchgen(int argc, char **argv) {
   }
 
   // Wait for vhdmmio.
-  if (!vhdmmio.joinable()) {
+  if (vhdmmio.joinable()) {
     FLETCHER_LOG(INFO, "Waiting for vhdmmio to complete...");
+    vhdmmio.join();
   }
-  vhdmmio.join();
+
+  // Remember the inputs of this run.
+  WriteManifest(options->output_dir, input_hash, run_start);
 
   FLETCHER_LOG(INFO, program_name + " completed.");
 
@@ -181,4 +295,106 @@ int fletchgen(int argc, char **argv) {
   return 0;
 }
 
+int Generate(const std::vector<std::shared_ptr<arrow::Schema>> &schemas,
+             const std::vector<std::shared_ptr<arrow::RecordBatch>> &recordbatches,
+             const std::vector<std::string> &arguments,
+             std::map<std::string, std::string> *files) {
+  // The component pool is shared by all designs in this process, so designs are generated one at a time.
+  static std::mutex generate_mutex;
+  std::lock_guard<std::mutex> lock(generate_mutex);
+  cerata::default_component_pool()->Clear();
+  cerata::logger().enable(fletchgen::LogCerata);
+
+  // Parse options
+  std::vector<std::string> args = {"pyfletchgen"};
+  args.insert(args.end(), arguments.begin(), arguments.end());
+  std::vector<char *> argv;
+  for (auto &a : args) {
+    argv.push_back(a.data());
+  }
+  auto options = std::make_shared<fletchgen::Options>();
+  if (!fletchgen::Options::Parse(options.get(), static_cast<int>(argv.size()), argv.data())) {
+    FLETCHER_LOG(WARNING, "Error parsing arguments.");
+    return -1;
+  }
+  if (!options->schema_paths.empty() || !options->recordbatch_paths.empty()) {
+    FLETCHER_LOG(WARNING, "Schemas and RecordBatches must be supplied in memory, not as paths.");
+    return -1;
+  }
+  if (options->mmio_backend != "native") {
+    FLETCHER_LOG(WARNING, "Only the native MMIO back-end generates its output in memory.");
+    return -1;
+  }
+  if (schemas.empty() && recordbatches.empty()) {
+    FLETCHER_LOG(WARNING, "No schemas or recordbatches were supplied.");
+    return -1;
+  }
+  options->schemas = schemas;
+  options->recordbatches = recordbatches;
+
+  // Generate the whole Cerata design.
+  fletchgen::Design design(options);
+  (*files)["fletchgen.mmio.manifest"] = fletchgen::GenerateMmioManifest(design.all_regs, design.mmio_spec);
+  (*files)["fletchgen.mmio.h"] = fletchgen::GenerateMmioHeader(design.all_regs, design.mmio_spec, options->kernel_name);
+  (*files)["vhdl/mmio.gen.vhd"] = fletchgen::GenerateMmioVhdl(design.all_regs, design.mmio_spec);
+  (*files)["vhdl/mmio_pkg.gen.vhd"] = fletchgen::GenerateMmioPackage(design.all_regs, design.mmio_spec);
+  if (!options->platform.empty()) {
+    (*files)["fletchgen.platform.profile"] = options->profile.ToString();
+  }
+
+  if (options->perf_report) {
+    (*files)["fletchgen.perf"] = fletchgen::EstimatePerformance(design.schema_set->schemas(),
+                                                                BusDim::FromString(options->bus_dims[0],
+                                                                                   BusDim())).ToString();
+  }
+
+  // The design is supplied in memory, so only check the languages.
+  auto &l = options->languages;
+  if (std::find(l.begin(), l.end(), "vhdl") != l.end()) {
+    for (const auto &spec : design.GetOutputSpec()) {
+      auto source = cerata::vhdl::Design(spec.comp, fletchgen::DEFAULT_NOTICE).Generate().ToString();
+      (*files)["vhdl/" + spec.comp->name() + ".gen.vhd"] = source;
+    }
+    for (const auto &f : design.nucleus_comp->filters) {
+      (*files)["vhdl/" + f->name() + ".gen.vhd"] = f->GenerateVHDL();
+    }
+    if (design.kernel_expr) {
+      (*files)["vhdl/" + design.kernel_comp->name() + ".gen.vhd"] =
+          fletchgen::GenerateKernelVHDL(*design.kernel_comp, *design.kernel_expr);
+    }
+    if (design.pipelined_kernel) {
+      (*files)["vhdl/" + design.kernel_comp->name() + ".gen.vhd"] =
+          fletchgen::GeneratePipelinedKernelVHDL(*design.kernel_comp);
+    }
+  }
+
+  if (options->axi_top) {
+    fletchgen::top::AxiConverterConfig converters;
+    converters.enable_fifo = options->axi_fifo;
+    converters.slv_req_slice_depth = options->axi_slice_depths[0];
+    converters.slv_dat_slice_depth = options->axi_slice_depths[1];
+    converters.mst_req_slice_depth = options->axi_slice_depths[2];
+    converters.mst_dat_slice_depth = options->axi_slice_depths[3];
+    (*files)["vhdl/AxiTop.gen.vhd"] = fletchgen::top::GenerateAXITop(*design.mantle_comp,
+                                                                     *design.schema_set,
+                                                                     design.mmio_spec,
+                                                                     design.external,
+                                                                     {},
+                                                                     options->num_instances,
+                                                                     converters);
+  }
+
+  if (options->vivado_hls) {
+    (*files)["vivado_hls/" + options->kernel_name + ".cpp"] =
+        fletchgen::hls::GenerateVivadoHLSTemplate(*design.kernel_comp);
+  }
+
+  if (options->sim_top || options->static_vhdl) {
+    FLETCHER_LOG(WARNING, "The simulation top level and static VHDL files are not generated in memory.");
+  }
+
+  cerata::default_component_pool()->Clear();
+  return 0;
+}
+
 }  // namespace fletchgen
@@ -14,11 +14,205 @@
 
 #include "fletchgen/hls/vivado.h"
 
+#include <arrow/api.h>
+#include <fletcher/common.h>
+
+#include <map>
+#include <optional>
+#include <sstream>
 #include <vector>
 #include <memory>
 #include <string>
 
 #include "fletchgen/schema.h"
 #include "fletchgen/kernel.h"
+#include "fletchgen/mmio.h"
+
+namespace fletchgen::hls {
+
+/// A stream of HLS packets in the kernel template.
+struct HLSStream {
+  /// The packet type.
+  std::string type;
+  /// The name of the stream within the RecordBatch struct.
+  std::string name;
+  /// Whether the stream is an input of the kernel.
+  bool input;
+};
+
+/// @brief Return the name of the HLS packet type for a fixed-width Arrow type, or std::nullopt if there is none.
+static std::optional<std::string> PacketType(const arrow::DataType &type, uint32_t epc, bool nullable) {
+  std::string name;
+  switch (type.id()) {
+    case arrow::Type::BOOL: name = "bool"; break;
+    case arrow::Type::UINT8: name = "uint8"; break;
+    case arrow::Type::UINT16: name = "uint16"; break;
+    case arrow::Type::UINT32: name = "uint32"; break;
+    case arrow::Type::UINT64: name = "uint64"; break;
+    case arrow::Type::INT8: name = "int8"; break;
+    case arrow::Type::INT16: name = "int16"; break;
+    case arrow::Type::INT32: name = "int32"; break;
+    case arrow::Type::INT64: name = "int64"; break;
+    case arrow::Type::HALF_FLOAT: name = "float16"; break;
+    case arrow::Type::FLOAT: name = "float32"; break;
+    case arrow::Type::DOUBLE: name = "float64"; break;
+    case arrow::Type::DATE32: name = "date32"; break;
+    case arrow::Type::DATE64: name = "date64"; break;
+      // Dictionary-encoded fields deliver the decoded values.
+    case arrow::Type::DICTIONARY:
+      return PacketType(*static_cast<const arrow::DictionaryType &>(type).value_type(), epc, nullable);
+    default: return std::nullopt;
+  }
+  std::string result;
+  if (epc > 1) {
+    result = "f_m" + name + "<" + std::to_string(epc) + ">";
+  } else {
+    result = "f_" + name;
+  }
+  // The nullable wrapper holds a single validity bit, so it only applies to single-element packets.
+  if (nullable && (epc == 1)) {
+    result = "nullable<" + result + ">";
+  }
+  return result;
+}
+
+/// @brief Return the HLS packet type of a length stream.
+static std::string LengthType(uint32_t lepc, bool nullable, bool large) {
+  if (lepc > 1) {
+    return "f_mspacket<" + std::string(large ? "64" : "32") + ", " + std::to_string(lepc) + ">";
+  }
+  auto type = large ? std::string("f_lsize") : std::string("f_size");
+  return nullable ? "nullable<" + type + ">" : type;
+}
+
+/// @brief Append the streams of an Arrow field to a vector of streams. Returns false if the type is not supported.
+static bool AppendFieldStreams(const FieldPort &fp, std::vector<HLSStream> *streams) {
+  const auto &field = *fp.field_;
+  auto epc = static_cast<uint32_t>(fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1));
+  auto lepc = static_cast<uint32_t>(fletcher::GetUIntMeta(field, fletcher::meta::LIST_EPC, 1));
+  bool input = fp.dir() == Port::Dir::IN;
+  switch (field.type()->id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY: {
+      auto id = field.type()->id();
+      auto values = (id == arrow::Type::STRING) || (id == arrow::Type::LARGE_STRING) ? "chars" : "bytes";
+      auto value_type = epc > 1 ? "f_muint8<" + std::to_string(epc) + ">" : std::string("f_uint8");
+      streams->push_back({LengthType(lepc, field.nullable(), fletcher::HasLargeOffsets(*field.type())),
+                          field.name() + "_lengths", input});
+      streams->push_back({value_type, field.name() + "_" + values, input});
+      return true;
+    }
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
+      auto child = field.type()->field(0);
+      auto value_type = PacketType(*child->type(), epc, child->nullable());
+      if (!value_type) {
+        return false;
+      }
+      auto large = field.type()->id() == arrow::Type::LARGE_LIST;
+      streams->push_back({LengthType(lepc, field.nullable(), large), field.name() + "_lengths", input});
+      streams->push_back({*value_type, field.name() + "_" + child->name(), input});
+      return true;
+    }
+    default: {
+      auto type = PacketType(*field.type(), epc, field.nullable());
+      if (!type) {
+        return false;
+      }
+      streams->push_back({*type, field.name(), input});
+      return true;
+    }
+  }
+}
+
+std::string GenerateVivadoHLSTemplate(const Kernel &kernel) {
+  // Gather the streams of every RecordBatch, in order of appearance.
+  std::vector<std::string> batches;
+  std::map<std::string, std::vector<HLSStream>> streams;
+  std::vector<std::string> unsupported;
+  for (const auto &node : kernel.GetNodes()) {
+    auto fp = dynamic_cast<FieldPort *>(node);
+    if ((fp == nullptr) || (fp->function_ != FieldPort::Function::ARROW)) {
+      continue;
+    }
+    auto batch = fp->fletcher_schema_->name();
+    if (streams.count(batch) == 0) {
+      batches.push_back(batch);
+    }
+    if (!AppendFieldStreams(*fp, &streams[batch])) {
+      unsupported.push_back(batch + "." + fp->field_->name() + " (" + fp->field_->type()->ToString() + ")");
+    }
+  }
+
+  // Gather the kernel registers.
+  std::vector<MmioPort *> regs;
+  for (const auto &node : kernel.GetNodes()) {
+    auto p = dynamic_cast<MmioPort *>(node);
+    if ((p != nullptr) && (p->reg.function == MmioFunction::KERNEL)) {
+      regs.push_back(p);
+    }
+  }
+
+  std::stringstream ss;
+  ss << "// This is a Vivado HLS kernel template generated by Fletchgen." << std::endl;
+  ss << "// Streams of fields with an EPC above one carry multi-element packets with a count of valid elements."
+     << std::endl << std::endl;
+  ss << "#include <hls_stream.h>" << std::endl;
+  ss << "#include <ap_int.h>" << std::endl << std::endl;
+  ss << "#include \"fletcher/api.h\"" << std::endl << std::endl;
+
+  for (const auto &u : unsupported) {
+    ss << "// Field " << u << " is not supported by the Vivado HLS integration and was left out." << std::endl;
+  }
+  if (!unsupported.empty()) {
+    ss << std::endl;
+  }
+
+  for (const auto &b : batches) {
+    ss << "struct " << b << " {" << std::endl;
+    for (const auto &s : streams[b]) {
+      ss << "  hls::stream<" << s.type << "> " << s.name << ";  // " << (s.input ? "Input" : "Output") << std::endl;
+    }
+    ss << "};" << std::endl << std::endl;
+  }
+
+  // Function signature.
+  std::vector<std::string> args;
+  for (const auto &b : batches) {
+    args.push_back("RecordBatchMeta " + b + "_meta");
+    args.push_back(b + " &" + b);
+  }
+  for (const auto &r : regs) {
+    auto type = "ap_uint<" + std::to_string(r->reg.width) + ">";
+    args.push_back(r->dir() == Port::Dir::IN ? type + " " + r->reg.name : type + " *" + r->reg.name);
+  }
+  ss << "bool " << kernel.name() << "(";
+  for (size_t i = 0; i < args.size(); i++) {
+    ss << (i > 0 ? "," : "") << std::endl << "    " << args[i];
+  }
+  ss << ") {" << std::endl;
+
+  // Interface pragmas.
+  for (const auto &b : batches) {
+    ss << "#pragma HLS INTERFACE register port=" << b << "_meta.length" << std::endl;
+    for (const auto &s : streams[b]) {
+      ss << "#pragma HLS INTERFACE ap_fifo port=" << b << "." << s.name << std::endl;
+      ss << "#pragma HLS data_pack variable=" << b << "." << s.name << std::endl;
+    }
+  }
+  for (const auto &r : regs) {
+    ss << "#pragma HLS INTERFACE " << (r->dir() == Port::Dir::IN ? "register" : "ap_vld") << " port=" << r->reg.name
+       << std::endl;
+  }
+  ss << std::endl;
+  ss << "  // TODO: Implement your kernel here. Operators on multi-element packets apply to every element," << std::endl;
+  ss << "  //  e.g. a + b adds two f_mint32<N> packets element-wise, and f_sum(a) reduces a packet." << std::endl;
+  ss << std::endl;
+  ss << "  return true;" << std::endl;
+  ss << "}" << std::endl;
+  return ss.str();
+}
 
-// Placeholder for vivado hls support
+}  // namespace fletchgen::hls
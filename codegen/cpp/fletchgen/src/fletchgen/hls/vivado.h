@@ -20,10 +20,19 @@
 #include "fletchgen/schema.h"
 #include "fletchgen/kernel.h"
 
-// Placeholder for vivado hls support
 namespace fletchgen::hls {
 
-/// @brief Generate a Vivado HLS template for a Fletcher kernel.
-[[deprecated("Not yet implemented.")]] std::string GenerateVivadoHLSTemplate(const Kernel& kernel);
+/**
+ * @brief Generate a Vivado HLS template for a Fletcher kernel.
+ *
+ * The template uses the packet types of the Vivado HLS integration of Fletcher. Every RecordBatch results in a struct
+ * with a stream per Arrow data stream of its fields. Fields with an EPC or LEPC above one result in streams of
+ * multi-element packets (f_mpacket) of the same width, such that the kernel can consume or produce all elements that
+ * the generated ArrayReaders and ArrayWriters transfer per cycle.
+ *
+ * @param kernel  The kernel to generate the template for.
+ * @return        The source of the template.
+ */
+std::string GenerateVivadoHLSTemplate(const Kernel &kernel);
 
 }  // namespace fletchgen::hls
@@ -0,0 +1,141 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/incremental.h"
+
+#include <fletcher/common.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+#include "fletchgen/utils.h"
+
+namespace fletchgen {
+
+namespace {
+
+/// Incremental 64-bit FNV-1a hash.
+struct Hasher {
+  uint64_t value = 0xCBF29CE484222325ull;
+
+  void Add(const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      value ^= static_cast<uint8_t>(data[i]);
+      value *= 0x100000001B3ull;
+    }
+  }
+
+  /// @brief Add a string, including its length, such that concatenations of different strings hash differently.
+  void Add(const std::string &str) {
+    auto size = static_cast<uint64_t>(str.size());
+    Add(reinterpret_cast<const char *>(&size), sizeof(size));
+    Add(str.data(), str.size());
+  }
+
+  /// @brief Add the name and contents of a file.
+  void AddFile(const std::string &path) {
+    Add(path);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) {
+      // Make sure a missing file does not hash the same as an empty one.
+      Add("<missing>");
+      return;
+    }
+    std::vector<char> buffer(1 << 16);
+    while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || (file.gcount() > 0)) {
+      Add(buffer.data(), static_cast<size_t>(file.gcount()));
+    }
+  }
+};
+
+}  // namespace
+
+uint64_t HashInputs(const Options &options) {
+  Hasher hash;
+  hash.Add(version());
+  for (const auto &arg : options.arguments) {
+    // Forcing regeneration does not influence the output.
+    if (arg != "--force") {
+      hash.Add(arg);
+    }
+  }
+  for (const auto &path : options.schema_paths) {
+    hash.AddFile(path);
+  }
+  for (const auto &path : options.recordbatch_paths) {
+    hash.AddFile(path);
+  }
+  if (!options.externals_yaml.empty()) {
+    hash.AddFile(options.externals_yaml);
+  }
+  if (!options.platform.empty()) {
+    // A profile file can change without the arguments changing.
+    hash.Add(options.profile.ToString());
+  }
+  return hash.value;
+}
+
+static std::string ToHex(uint64_t hash) {
+  std::stringstream str;
+  str << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return str.str();
+}
+
+bool IsUpToDate(const std::string &output_dir, uint64_t hash) {
+  std::ifstream manifest(output_dir + "/" + MANIFEST_FILE);
+  std::string stored;
+  if (!std::getline(manifest, stored) || (stored != ToHex(hash))) {
+    return false;
+  }
+  std::string file;
+  while (std::getline(manifest, file)) {
+    std::error_code error;
+    if (!file.empty() && !std::filesystem::exists(output_dir + "/" + file, error)) {
+      FLETCHER_LOG(INFO, "Output file " + file + " of the last run in " + output_dir + " was removed.");
+      return false;
+    }
+  }
+  return true;
+}
+
+void WriteManifest(const std::string &output_dir, uint64_t hash, std::filesystem::file_time_type since) {
+  namespace fs = std::filesystem;
+  std::ofstream manifest(output_dir + "/" + MANIFEST_FILE);
+  if (!manifest.good()) {
+    FLETCHER_LOG(WARNING, "Could not write manifest to " + output_dir + ". The next run will regenerate all output.");
+    return;
+  }
+  manifest << ToHex(hash) << std::endl;
+
+  std::error_code error;
+  fs::recursive_directory_iterator it(output_dir, error);
+  for (; !error && (it != fs::recursive_directory_iterator()); it.increment(error)) {
+    std::error_code entry_error;
+    if (it->path().filename().string().front() == '.') {
+      // Skip the manifest itself, and directories of e.g. version control.
+      if (it->is_directory(entry_error)) {
+        it.disable_recursion_pending();
+      }
+      continue;
+    }
+    if (it->is_regular_file(entry_error) && (it->last_write_time(entry_error) >= since)) {
+      manifest << fs::relative(it->path(), output_dir, entry_error).generic_string() << std::endl;
+    }
+  }
+}
+
+}  // namespace fletchgen
@@ -0,0 +1,57 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "fletchgen/options.h"
+
+namespace fletchgen {
+
+/// Name of the manifest file in the output directory that stores the hash of the inputs and the output files of the
+/// last run.
+constexpr char MANIFEST_FILE[] = ".fletchgen.manifest";
+
+/**
+ * @brief Return a hash over everything that determines the output of a run.
+ *
+ * This covers the command line arguments, the contents of all input files (Schemas, RecordBatches and externals) and
+ * the version of Fletchgen.
+ *
+ * @param options The parsed options.
+ * @return        A 64-bit FNV-1a hash.
+ */
+uint64_t HashInputs(const Options &options);
+
+/// @brief Return true if the manifest in an output directory matches some input hash, and all files it lists exist.
+bool IsUpToDate(const std::string &output_dir, uint64_t hash);
+
+/**
+ * @brief Write the manifest for some input hash to an output directory.
+ *
+ * The manifest lists the files in the output directory that were written since some time, i.e. the output of the run,
+ * such that the next run is not skipped when any of them was removed. Hidden files and directories are not listed.
+ *
+ * @param output_dir  The output directory.
+ * @param hash        The hash of the inputs of the run.
+ * @param since       The start of the run.
+ */
+void WriteManifest(const std::string &output_dir,
+                   uint64_t hash,
+                   std::filesystem::file_time_type since = std::filesystem::file_time_type::min());
+
+}  // namespace fletchgen
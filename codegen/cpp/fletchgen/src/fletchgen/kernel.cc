@@ -39,13 +39,14 @@ static void CopyFieldPorts(Component *kernel, const RecordBatch &record_batch, F
 
 Kernel::Kernel(std::string name,
                const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
-               const std::shared_ptr<Component> &mmio)
+               const std::shared_ptr<Component> &mmio,
+               std::optional<BusDim> result_bus)
     : Component(std::move(name)) {
 
   // Add clock/reset
   Add(port("kcd", cr(), Port::Dir::IN, kernel_cd()));
 
-  auto iw = index_width();
+  auto iw = index_width(GetIndexWidth(recordbatches));
   auto tw = tag_width();
 
   Add({iw, tw});
@@ -59,13 +60,27 @@ Kernel::Kernel(std::string name,
     // The command stream at the kernel interface enjoys some simplification towards the user; the buffer addresses
     // in the ctrl field are hidden.
     // We create new command ports based on the command ports of the RecordBatch, but leave out the ctrl field.
+    // Fields read in gather mode get a stream of row indices instead.
     auto rb_cmds = r->GetFieldPorts(FieldPort::Function::COMMAND);
     for (auto &rb_cmd : rb_cmds) {
+      auto ftw = field_tag_width(*rb_cmd->field_, tw);
+      if (fletcher::GetBoolMeta(*rb_cmd->field_, fletcher::meta::GATHER, false)) {
+        auto kernel_idx = gather_port(rb_cmd->fletcher_schema_, rb_cmd->field_, iw, ftw, kernel_cd());
+        kernel_idx->Reverse();
+        Add(kernel_idx);
+        continue;
+      }
       // Next, make a simplified version of the command stream for the kernel user.
       auto kernel_cmd =
-          command_port(rb_cmd->fletcher_schema_, rb_cmd->field_, iw, tw, std::nullopt, kernel_cd());
+          command_port(rb_cmd->fletcher_schema_, rb_cmd->field_, iw, ftw, std::nullopt, kernel_cd());
       kernel_cmd->Reverse();
       Add(kernel_cmd);
+      // Fields cached on-chip are preloaded by the command, after which the kernel looks up their values.
+      if (fletcher::GetUIntMeta(*rb_cmd->field_, fletcher::meta::ONCHIP, 0) > 0) {
+        auto kernel_lookup = lookup_port(rb_cmd->fletcher_schema_, rb_cmd->field_, iw, kernel_cd());
+        kernel_lookup->Reverse();
+        Add(kernel_lookup);
+      }
     }
   }
 
@@ -83,6 +98,12 @@ Kernel::Kernel(std::string name,
     }
   }
 
+  // Add the write bus port to the result scratchpad, of which the address is passed through the MMIO ports.
+  if (result_bus) {
+    auto bus_params = BusDimParams(this, *result_bus, "RESULT");
+    Add(bus_port("result_bus", Port::Dir::OUT, BusSpecParams{bus_params, BusFunction::WRITE}));
+  }
+
   // Add custom I/O
   auto ext = external();
   if (ext) {
@@ -92,8 +113,9 @@ Kernel::Kernel(std::string name,
 
 std::shared_ptr<Kernel> kernel(const std::string &name,
                                const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
-                               const std::shared_ptr<Component> &mmio) {
-  return std::make_shared<Kernel>(name, recordbatches, mmio);
+                               const std::shared_ptr<Component> &mmio,
+                               std::optional<BusDim> result_bus) {
+  return std::make_shared<Kernel>(name, recordbatches, mmio, result_bus);
 }
 
 }  // namespace fletchgen
@@ -20,7 +20,9 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <optional>
 
+#include "fletchgen/bus.h"
 #include "fletchgen/schema.h"
 #include "fletchgen/recordbatch.h"
 
@@ -36,7 +38,8 @@ struct Kernel : Component {
   /// @brief Construct a new kernel.
   explicit Kernel(std::string name,
                   const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
-                  const std::shared_ptr<Component> &mmio);
+                  const std::shared_ptr<Component> &mmio,
+                  std::optional<BusDim> result_bus = std::nullopt);
 };
 
 /**
@@ -44,10 +47,12 @@ struct Kernel : Component {
  * @param name          The name of the kernel.
  * @param recordbatches The recordbatch components to base the kernel on.
  * @param mmio          The MMIO component to base the kernel on.
+ * @param result_bus    The dimensions of a write bus port to the result scratchpad, if the design has one.
  * @return              A shared pointer to the new kernel component.
  */
 std::shared_ptr<Kernel> kernel(const std::string& name,
                                const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
-                               const std::shared_ptr<Component> &mmio);
+                               const std::shared_ptr<Component> &mmio,
+                               std::optional<BusDim> result_bus = std::nullopt);
 
 }  // namespace fletchgen
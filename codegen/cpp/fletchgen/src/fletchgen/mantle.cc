@@ -17,10 +17,15 @@
 #include <cerata/api.h>
 #include <fletcher/common.h>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
+#include <numeric>
 #include <vector>
 #include <utility>
+#include <sstream>
 #include <string>
+#include <map>
 #include <vector>
 
 #include "fletchgen/basic_types.h"
@@ -28,10 +33,54 @@
 #include "fletchgen/nucleus.h"
 #include "fletchgen/axi4_lite.h"
 #include "fletchgen/external.h"
+#include "fletchgen/mmio.h"
+#include "fletchgen/profiler.h"
 
 namespace fletchgen {
 
 using cerata::intl;
+using cerata::strl;
+
+namespace {
+
+/**
+ * @brief Return the arbitration weights of bus ports, or an empty vector if they are arbitrated equally.
+ *
+ * Ports with an explicit weight keep it. If required, the weight of the other ports is their demand relative to the
+ * port with the lowest demand, e.g. a field of 64-bit values weighs eight times a field of 8-bit values. Ports of
+ * which the demand is unknown weigh one.
+ */
+std::vector<uint32_t> GetArbiterWeights(const std::vector<Port *> &ports, bool by_demand) {
+  bool any_explicit = false;
+  double unit = 0.0;
+  for (const auto &p : ports) {
+    auto *bp = dynamic_cast<BusPort *>(p);
+    if (bp == nullptr) {
+      continue;
+    }
+    any_explicit = any_explicit || (bp->weight_ > 0);
+    if ((bp->demand_ > 0.0) && ((unit == 0.0) || (bp->demand_ < unit))) {
+      unit = bp->demand_;
+    }
+  }
+  if (!any_explicit && !by_demand) {
+    return {};
+  }
+  std::vector<uint32_t> result;
+  for (const auto &p : ports) {
+    auto *bp = dynamic_cast<BusPort *>(p);
+    uint32_t weight = 1;
+    if ((bp != nullptr) && (bp->weight_ > 0)) {
+      weight = bp->weight_;
+    } else if (by_demand && (bp != nullptr) && (bp->demand_ > 0.0)) {
+      weight = static_cast<uint32_t>(std::clamp(std::lround(bp->demand_ / unit), 1L, 255L));
+    }
+    result.push_back(weight);
+  }
+  return result;
+}
+
+}  // namespace
 
 //static std::string ArbiterMasterName(BusFunction function) {
 //  return std::string(function == BusFunction::READ ? "rd" : "wr") + "_mst";
@@ -41,13 +90,14 @@ Mantle::Mantle(std::string name,
                const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                const std::shared_ptr<Nucleus> &nucleus,
                BusDim bus_dim,
-               Axi4LiteSpec axi_spec)
-    : Component(std::move(name)), bus_dim_(bus_dim) {
+               Axi4LiteSpec axi_spec,
+               ArbiterTopology topology)
+    : Component(std::move(name)), bus_dim_(bus_dim), topology_(topology) {
 
   using std::pair;
 
   // Add some default parameters.
-  auto iw = index_width();
+  auto iw = index_width(GetIndexWidth(recordbatches));
   auto tw = tag_width();
   Add({iw, tw});
 
@@ -55,8 +105,6 @@ Mantle::Mantle(std::string name,
   auto bus_params = BusDimParams(this, bus_dim);
   auto bus_rd_spec = BusSpecParams{bus_params, BusFunction::READ};
   auto bus_wr_spec = BusSpecParams{bus_params, BusFunction::WRITE};
-  std::shared_ptr<Port> bus_rd = bus_port("rd_mst", Port::OUT, bus_rd_spec);
-  std::shared_ptr<Port> bus_wr = bus_port("wr_mst", Port::OUT, bus_wr_spec);
 
   // Add default ports; bus clock/reset, kernel clock/reset and AXI4-lite port.
   auto bcr = port("bcd", cr(), Port::Dir::IN, bus_cd());
@@ -87,8 +135,9 @@ Mantle::Mantle(std::string name,
     auto rbi = Instantiate(rb.get());
     recordbatch_instances_.push_back(rbi);
 
-    // Connect bus clock/reset and kernel clock/reset.
-    rbi->prt("bcd") <<= bcr;
+    // Connect bus clock/reset and kernel clock/reset. When the clock domains are asynchronous, the RecordBatches run
+    // entirely in the kernel clock domain, and their bus ports cross to the bus clock domain in the bus infrastructure.
+    rbi->prt("bcd") <<= (topology_.xclk_stages > 0 ? kcr : bcr);
     rbi->prt("kcd") <<= kcr;
 
     rbi->par("INDEX_WIDTH")->SetValue(iw);
@@ -128,54 +177,114 @@ Mantle::Mantle(std::string name,
   // ports to bus arbiters. We don't have an elaborate interconnection generation step yet, so we just discern between
   // read and write ports, assuming they will all get the same bus parametrization.
   //
-  // Therefore, we only need a read and/or write arbiter, whatever mode RecordBatch is instantiated.
+  // Therefore, we only need a read and/or write arbiter tree per memory interface channel, whatever mode RecordBatch is
+  // instantiated. Channel 0 connects to the rd_mst and wr_mst ports, other channels get their own ports.
   // We take the following steps.
-  // 1. instantiate them and connect them to the top level ports.
-  // 2. Connect every RecordBatch bus port to the corresponding arbiter.
-
-  // Instantiate and connect arbiters to top level.
-  // Instance *arb_read = nullptr;
-  // Instance *arb_write = nullptr;
+  // 1. Gather all RecordBatch bus ports per channel and bus spec.
+  // 2. Connect them to a tree of arbiters, of which the root is connected to the top level port.
 
-  // Gather all unique bus specs from RecordBatch bus interfaces.
-  std::vector<BusSpec> bus_specs;
+  // Gather all unique bus specs and their RecordBatch bus ports, for every memory interface channel.
+  std::map<uint32_t, std::vector<BusSpec>> bus_specs;
+  std::map<uint32_t, std::unordered_map<BusSpec, std::vector<Port *>>> slaves;
   for (const auto &bp : rb_bus_ports) {
-    bus_specs.push_back(BusSpec(bp->spec_));
+    bus_specs[bp->channel_].push_back(BusSpec(bp->spec_));
+    slaves[bp->channel_][BusSpec(bp->spec_)].push_back(bp);
   }
-  cerata::FilterDuplicates(&bus_specs);
 
-  // For every required bus, instantiate a bus arbiter.
-  std::unordered_map<BusSpec, Instance *> arb_map;
-  for (const auto &b : bus_specs) {
-    auto prefix = b.ToName();
-    Instance *inst = Instantiate(bus_arbiter(b.func), prefix + "_inst");
+  // The descriptor ring of the Nucleus, if any, fetches its descriptors through the first read bus master. It shares
+  // the arbiter tree of the RecordBatches with the same bus spec, which also inserts its clock domain crossing.
+  if (nucleus_inst_->Has("ring_bus")) {
+    ConnectBusParam(nucleus_inst_, "RING_", bus_params, inst_to_comp_map());
+    auto ring_bus = nucleus_inst_->Get<BusPort>("ring_bus");
+    auto spec = BusSpec(ring_bus->spec_);
+    for (const auto &b : bus_specs[0]) {
+      if (b.func == BusFunction::READ) {
+        spec = b;
+        break;
+      }
+    }
+    bus_specs[0].push_back(spec);
+    slaves[0][spec].push_back(ring_bus);
+  }
 
-    // Connect clock and reset
-    inst->prt("bcd") <<= bcr;
+  // The ChunkWalkers of RecordBatches with a chunk list fetch their chunk descriptors through it as well.
+  for (const auto &bp : nucleus_inst_->GetAll<BusPort>()) {
+    const std::string suffix = "_chunk_bus";
+    auto name = bp->name();
+    if ((name.size() <= suffix.size()) || (name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)) {
+      continue;
+    }
+    ConnectBusParam(nucleus_inst_, name.substr(0, name.size() - suffix.size()) + "_CHUNK_", bus_params,
+                    inst_to_comp_map());
+    auto spec = BusSpec(bp->spec_);
+    for (const auto &b : bus_specs[0]) {
+      if (b.func == BusFunction::READ) {
+        spec = b;
+        break;
+      }
+    }
+    bus_specs[0].push_back(spec);
+    slaves[0][spec].push_back(bp);
+  }
 
-    // TODO(johanpel): for now, we only support one top-level bus spec, so we connect all arbiter generics to it.
-    //  Also we just connect the top-level port directly.
-    ConnectBusParam(inst, "", bus_params, this->inst_to_comp_map());
-    if (b.func == BusFunction::READ) {
-      Connect(bus_rd, inst->Get<Port>("mst"));
-      Add(bus_rd);
-    } else {
-      Connect(bus_wr, inst->Get<Port>("mst"));
-      Add(bus_wr);
+  // The result scratchpad of the kernel, if any, is written through the first write bus master, likewise.
+  if (nucleus_inst_->Has("result_bus")) {
+    ConnectBusParam(nucleus_inst_, "RESULT_", bus_params, inst_to_comp_map());
+    auto result_bus = nucleus_inst_->Get<BusPort>("result_bus");
+    auto spec = BusSpec(result_bus->spec_);
+    for (const auto &b : bus_specs[0]) {
+      if (b.func == BusFunction::WRITE) {
+        spec = b;
+        break;
+      }
     }
-    arb_map[b] = inst;
+    bus_specs[0].push_back(spec);
+    slaves[0][spec].push_back(result_bus);
   }
 
-  // Now we loop over all bus ports again and connect them to the arbiters.
-  for (const auto &bp : rb_bus_ports) {
-    // Select the corresponding arbiter.
-    auto arb = arb_map[BusSpec(bp->spec_)];
-    // Get the PortArray.
-    auto array = arb->prt_arr("bsv");
-    // Append the PortArray and connect.
-    Connect(array->Append(), bp);
+  // The completion record of the Nucleus, if any, is written through the first write bus master, likewise.
+  if (nucleus_inst_->Has("completion_bus")) {
+    ConnectBusParam(nucleus_inst_, "COMPLETION_", bus_params, inst_to_comp_map());
+    auto completion_bus = nucleus_inst_->Get<BusPort>("completion_bus");
+    auto spec = BusSpec(completion_bus->spec_);
+    for (const auto &b : bus_specs[0]) {
+      if (b.func == BusFunction::WRITE) {
+        spec = b;
+        break;
+      }
+    }
+    bus_specs[0].push_back(spec);
+    slaves[0][spec].push_back(completion_bus);
   }
 
+  // For every required bus of every channel, instantiate an arbiter tree.
+  std::map<std::string, std::shared_ptr<Port>> masters;
+  for (auto &channel : bus_specs) {
+    cerata::FilterDuplicates(&channel.second);
+    for (const auto &b : channel.second) {
+      auto name = MasterPortName(b.func, channel.first);
+      auto prefix = b.ToName() + (channel.first > 0 ? "_ch" + std::to_string(channel.first) : "");
+      // TODO(johanpel): for now, we only support one top-level bus spec, so we connect all arbiter generics to it.
+      //  Also we just connect the top-level port directly.
+      auto root = ArbiterTree(b, slaves[channel.first][b], prefix, kcr, bcr, bus_params);
+      auto root_mst = SliceBus(b.func, root->prt("mst"), topology_.master_slices, prefix + "_mst", bcr, bus_params);
+      // Add the top-level master port of this channel, if it doesn't exist yet.
+      auto &mst = masters[name];
+      if (mst == nullptr) {
+        auto new_mst = bus_port(name, Port::OUT, b.func == BusFunction::READ ? bus_rd_spec : bus_wr_spec);
+        new_mst->channel_ = channel.first;
+        mst = new_mst;
+        Add(mst);
+        channels_[b.func].push_back(channel.first);
+      }
+      Connect(mst, root_mst);
+    }
+  }
+
+  // Profile the RecordBatch bus ports, now that they are connected to the bus infrastructure.
+  ProfileBusPorts(rb_bus_ports);
+  TraceBusPorts(rb_bus_ports, bus_params);
+
   // Add and connect platform IO
   auto ext = external();
   if (ext) {
@@ -185,13 +294,220 @@ Mantle::Mantle(std::string name,
   }
 }
 
+Instance *Mantle::Arbiter(BusFunction function,
+                          const std::string &name,
+                          const std::shared_ptr<Port> &bcd,
+                          const BusDimParams &bus_params,
+                          const std::vector<uint32_t> &weights) {
+  Instance *inst = Instantiate(bus_arbiter(function), name);
+  inst->prt("bcd") <<= bcd;
+  ConnectBusParam(inst, "", bus_params, this->inst_to_comp_map());
+  inst->par("MAX_OUTSTANDING")->SetValue(intl(static_cast<int>(topology_.max_outstanding)));
+  if (!weights.empty()) {
+    std::stringstream str;
+    for (size_t i = 0; i < weights.size(); i++) {
+      str << (i > 0 ? "," : "") << weights[i];
+    }
+    inst->par("ARB_WEIGHTS")->SetValue(strl(str.str()));
+  }
+  return inst;
+}
+
+Instance *Mantle::ArbiterTree(const BusSpec &spec,
+                              std::vector<Port *> slaves,
+                              const std::string &prefix,
+                              const std::shared_ptr<Port> &kcd,
+                              const std::shared_ptr<Port> &bcd,
+                              const BusDimParams &bus_params) {
+  auto weights = GetArbiterWeights(slaves, topology_.weights);
+
+  // Move every leaf from the kernel to the bus clock domain, if the clock domains are asynchronous.
+  if (topology_.xclk_stages > 0) {
+    for (size_t i = 0; i < slaves.size(); i++) {
+      Instance *cdc = Instantiate(bus_cdc(spec.func), prefix + "_cdc" + std::to_string(i) + "_inst");
+      cdc->prt("kcd") <<= kcd;
+      cdc->prt("bcd") <<= bcd;
+      ConnectBusParam(cdc, "", bus_params, this->inst_to_comp_map());
+      cdc->par("FIFO_DEPTH")->SetValue(bus_params.bm);
+      cdc->par("XCLK_STAGES")->SetValue(intl(static_cast<int>(topology_.xclk_stages)));
+      Connect(cdc->prt("slv"), slaves[i]);
+      slaves[i] = cdc->prt("mst");
+    }
+  }
+
+  // Pipeline the connection of every leaf to the arbiter tree with register slices, if required. Trees with many leaves
+  // spread over a large part of the device, so their leaves get at least one slice if the fan-in is configured.
+  auto leaf_slices = topology_.leaf_slices;
+  if ((topology_.slice_fan_in > 0) && (slaves.size() >= topology_.slice_fan_in)) {
+    leaf_slices = std::max(leaf_slices, 1u);
+  }
+  for (size_t i = 0; i < slaves.size(); i++) {
+    slaves[i] = SliceBus(spec.func, slaves[i], leaf_slices, prefix + "_leaf" + std::to_string(i), bcd, bus_params);
+  }
+
+  // Place a buffer between every leaf and the arbiter it connects to, if required. The buffers only accept requests
+  // when they can absorb the whole burst, such that a slow master cannot stall the other masters on the arbiter.
+  if (topology_.leaf_buffers) {
+    for (size_t i = 0; i < slaves.size(); i++) {
+      Instance *buf = Instantiate(bus_buffer(spec.func), prefix + "_buf" + std::to_string(i) + "_inst");
+      buf->prt("bcd") <<= bcd;
+      ConnectBusParam(buf, "", bus_params, this->inst_to_comp_map());
+      buf->par("FIFO_DEPTH")->SetValue(bus_params.bm);
+      Connect(buf->prt("slv"), slaves[i]);
+      slaves[i] = buf->prt("mst");
+    }
+  }
+
+  // Insert levels of arbiters until the remaining ports fit on a single arbiter. A group with a single port is passed
+  // through to the next level as is.
+  // The master port of an arbiter is weighed by the sum of the weights of its slave ports.
+  size_t level = 0;
+  while ((topology_.fan_in > 1) && (slaves.size() > topology_.fan_in)) {
+    std::vector<Port *> next;
+    std::vector<uint32_t> next_weights;
+    for (size_t i = 0; i < slaves.size(); i += topology_.fan_in) {
+      size_t end = std::min(i + topology_.fan_in, slaves.size());
+      std::vector<uint32_t> group;
+      if (!weights.empty()) {
+        group.assign(weights.begin() + i, weights.begin() + end);
+        next_weights.push_back(std::min(255u, std::accumulate(group.begin(), group.end(), 0u)));
+      }
+      if (end - i == 1) {
+        next.push_back(slaves[i]);
+        continue;
+      }
+      auto name = prefix + "_l" + std::to_string(level) + "_" + std::to_string(i / topology_.fan_in);
+      Instance *arb = Arbiter(spec.func, name + "_inst", bcd, bus_params, group);
+      for (size_t j = i; j < end; j++) {
+        Connect(arb->prt_arr("bsv")->Append(), slaves[j]);
+      }
+      next.push_back(SliceBus(spec.func, arb->prt("mst"), topology_.tree_slices, name, bcd, bus_params));
+    }
+    slaves = next;
+    weights = next_weights;
+    level++;
+  }
+
+  // Connect the remaining ports to the root arbiter.
+  Instance *root = Arbiter(spec.func, prefix + "_inst", bcd, bus_params, weights);
+  for (const auto &slave : slaves) {
+    Connect(root->prt_arr("bsv")->Append(), slave);
+  }
+  return root;
+}
+
+Port *Mantle::SliceBus(BusFunction function,
+                       Port *master,
+                       uint32_t slices,
+                       const std::string &prefix,
+                       const std::shared_ptr<Port> &bcd,
+                       const BusDimParams &bus_params) {
+  for (uint32_t s = 0; s < slices; s++) {
+    Instance *slice = Instantiate(bus_slice(function), prefix + "_slice" + std::to_string(s) + "_inst");
+    slice->prt("bcd") <<= bcd;
+    ConnectBusParam(slice, "", bus_params, this->inst_to_comp_map());
+    Connect(slice->prt("slv"), master);
+    master = slice->prt("mst");
+  }
+  return master;
+}
+
+void Mantle::ProfileBusPorts(const std::vector<BusPort *> &bus_ports) {
+  if (!nucleus_inst_->Has("Profile_bus_enable")) {
+    return;
+  }
+  // Insert a signal between every bus port and the bus infrastructure, and attach the profilers onto those.
+  std::vector<cerata::Signal *> profile_nodes;
+  for (const auto &bp : bus_ports) {
+    if (bp->edges().size() != 1) {
+      FLETCHER_LOG(ERROR, "RecordBatch bus port has other than exactly one edge.");
+    }
+    profile_nodes.push_back(AttachSignalToNode(this, bp, inst_to_comp_map()));
+  }
+  auto profiler_map = EnableStreamProfiling(this, profile_nodes);
+
+  auto enable = nucleus_inst_->prt("Profile_bus_enable");
+  auto clear = nucleus_inst_->prt("Profile_bus_clear");
+  auto snapshot = nucleus_inst_->prt("Profile_bus_snapshot");
+  auto counters = ProfileCounterNames();
+
+  // Connect the counters to the Nucleus ports of the registers, which are named after the bus ports.
+  for (size_t i = 0; i < bus_ports.size(); i++) {
+    const auto &entry = profiler_map[profile_nodes[i]];
+    auto prefixes = ProfileRegPrefixes(*bus_ports[i]);
+    if (entry.second.size() != prefixes.size() * counters.size()) {
+      FLETCHER_LOG(ERROR, "Number of bus profiler counters does not match the number of registers of bus port "
+          + bus_ports[i]->name());
+    }
+    for (size_t s = 0; s < prefixes.size(); s++) {
+      auto prof_inst = entry.first[s];
+      auto first = nucleus_inst_->Get<MmioPort>(prefixes[s] + "_" + counters.front());
+      Connect(prof_inst->prt("enable"), enable);
+      Connect(prof_inst->prt("clear"), clear);
+      Connect(prof_inst->prt("snapshot"), snapshot);
+      prof_inst->par("OUT_COUNT_WIDTH")->SetValue(intl(static_cast<int>(first->reg.width)));
+      for (size_t c = 0; c < counters.size(); c++) {
+        Connect(nucleus_inst_->prt(prefixes[s] + "_" + counters[c]), entry.second[s * counters.size() + c]);
+      }
+    }
+  }
+}
+
+void Mantle::TraceBusPorts(const std::vector<BusPort *> &bus_ports, const BusDimParams &bus_params) {
+  if (!nucleus_inst_->Has("Trace_index") || bus_ports.empty()) {
+    return;
+  }
+  // Insert a signal between every bus port and the bus infrastructure, and attach the probes of the tracer onto those.
+  // The order of the probes matches the order of the Trace_port_ registers, see GetBusTraceRegs().
+  std::vector<cerata::Signal *> trace_nodes;
+  for (const auto &bp : bus_ports) {
+    if (bp->edges().size() != 1) {
+      FLETCHER_LOG(ERROR, "RecordBatch bus port has other than exactly one edge.");
+    }
+    trace_nodes.push_back(AttachSignalToNode(this, bp, inst_to_comp_map()));
+  }
+  auto tracer = EnableBusTracing(this, trace_nodes);
+  ConnectBusParam(tracer, "", bus_params, inst_to_comp_map());
+  auto index = nucleus_inst_->Get<MmioPort>("Trace_index");
+  auto depth_log2 = std::strtol(index->reg.meta.at(MMIO_TRACE_DEPTH_LOG2).c_str(), nullptr, 10);
+  tracer->par("DEPTH_LOG2")->SetValue(intl(static_cast<int>(depth_log2)));
+
+  // Connect the controls from and the outputs to the Nucleus ports of the registers.
+  Connect(tracer->prt("enable"), nucleus_inst_->prt("Trace_enable"));
+  Connect(tracer->prt("clear"), nucleus_inst_->prt("Trace_clear"));
+  Connect(tracer->prt("index"), index);
+  Connect(nucleus_inst_->prt("Trace_count"), tracer->prt("count"));
+  Connect(nucleus_inst_->prt("Trace_dropped"), tracer->prt("dropped"));
+  Connect(nucleus_inst_->prt("Trace_cycle"), tracer->prt("entry_cycle"));
+  Connect(nucleus_inst_->prt("Trace_port"), tracer->prt("entry_port"));
+  Connect(nucleus_inst_->prt("Trace_addr"), tracer->prt("entry_addr"));
+  Connect(nucleus_inst_->prt("Trace_len"), tracer->prt("entry_len"));
+}
+
+std::string MasterPortName(BusFunction function, uint32_t channel) {
+  std::string result = function == BusFunction::READ ? "rd_mst" : "wr_mst";
+  if (channel > 0) {
+    result += "_ch" + std::to_string(channel);
+  }
+  return result;
+}
+
+std::vector<uint32_t> Mantle::channels(BusFunction function) const {
+  auto result = channels_.find(function);
+  if (result == channels_.end()) {
+    return {};
+  }
+  return result->second;
+}
+
 /// @brief Construct a Mantle and return a shared pointer to it.
 std::shared_ptr<Mantle> mantle(const std::string &name,
                                const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                                const std::shared_ptr<Nucleus> &nucleus,
                                BusDim bus_spec,
-                               Axi4LiteSpec axi_spec) {
-  return std::make_shared<Mantle>(name, recordbatches, nucleus, bus_spec, axi_spec);
+                               Axi4LiteSpec axi_spec,
+                               ArbiterTopology topology) {
+  return std::make_shared<Mantle>(name, recordbatches, nucleus, bus_spec, axi_spec, topology);
 }
 
 }  // namespace fletchgen
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <map>
 #include <memory>
 #include <vector>
 #include <utility>
@@ -30,6 +31,30 @@ namespace fletchgen {
 
 using cerata::Instance;
 
+/// @brief Options for the bus infrastructure that connects RecordBatch bus ports to the top-level bus masters.
+struct ArbiterTopology {
+  /// Maximum number of slave ports per arbiter. Zero results in a single flat arbiter per bus master.
+  uint32_t fan_in = 0;
+  /// Whether to place a bus buffer between every RecordBatch bus port and its arbiter.
+  bool leaf_buffers = false;
+  /// Whether to weigh the arbitration of every bus port by its demand. Explicit weights are always used.
+  bool weights = false;
+  /// Maximum number of outstanding requests of every arbiter.
+  uint32_t max_outstanding = 4;
+  /// Number of synchronization registers of the clock domain crossings between the RecordBatches and the bus
+  /// infrastructure. Zero assumes the kernel and bus clock domains are driven by the same clock.
+  uint32_t xclk_stages = 0;
+  /// Number of register slices between every RecordBatch bus port and the arbiter tree.
+  uint32_t leaf_slices = 0;
+  /// Number of register slices between the levels of an arbiter tree.
+  uint32_t tree_slices = 0;
+  /// Number of register slices between every root arbiter and its top-level bus master port.
+  uint32_t master_slices = 0;
+  /// Minimum number of bus ports of an arbiter tree for which every leaf gets at least one register slice. Zero only
+  /// inserts the leaf slices set explicitly.
+  uint32_t slice_fan_in = 0;
+};
+
 /**
  * @brief A component that wraps a Kernel and all ArrayReaders/Writers resulting from a Schema set.
  */
@@ -40,17 +65,47 @@ class Mantle : public Component {
                   const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                   const std::shared_ptr<Nucleus> &nucleus,
                   BusDim bus_dim,
-                  Axi4LiteSpec axi_spec);
+                  Axi4LiteSpec axi_spec,
+                  ArbiterTopology topology = {});
   /// @brief Return the kernel component of this Mantle.
   std::shared_ptr<Nucleus> nucleus() const { return nucleus_; }
   /// @brief Return all RecordBatch(Reader/Writer) instances of this Mantle.
   std::vector<Instance *> recordbatch_instances() const { return recordbatch_instances_; }
   /// @brief Return all RecordBatch(Reader/Writer) components of this Mantle.
   std::vector<std::shared_ptr<RecordBatch>> recordbatch_components() const { return recordbatch_components_; }
+  /// @brief Return the memory interface channels that have a top-level bus master port for some bus function.
+  std::vector<uint32_t> channels(BusFunction function) const;
 
  protected:
+  /// @brief Connect bus slave ports to a tree of arbiters of some bus spec and return the root arbiter.
+  Instance *ArbiterTree(const BusSpec &spec,
+                        std::vector<Port *> slaves,
+                        const std::string &prefix,
+                        const std::shared_ptr<Port> &kcd,
+                        const std::shared_ptr<Port> &bcd,
+                        const BusDimParams &bus_params);
+  /// @brief Insert a chain of register slices after a bus master port and return the master port of the last slice.
+  Port *SliceBus(BusFunction function,
+                 Port *master,
+                 uint32_t slices,
+                 const std::string &prefix,
+                 const std::shared_ptr<Port> &bcd,
+                 const BusDimParams &bus_params);
+  /// @brief Instantiate a bus arbiter and connect its clock, reset and generics, including its slave port weights.
+  Instance *Arbiter(BusFunction function,
+                    const std::string &name,
+                    const std::shared_ptr<Port> &bcd,
+                    const BusDimParams &bus_params,
+                    const std::vector<uint32_t> &weights = {});
+  /// @brief Insert stream profilers on RecordBatch bus ports, if the Nucleus exposes bus profiling registers.
+  void ProfileBusPorts(const std::vector<BusPort *> &bus_ports);
+  /// @brief Record the requests of RecordBatch bus ports with a BusTracer, if the Nucleus exposes bus trace registers.
+  void TraceBusPorts(const std::vector<BusPort *> &bus_ports, const BusDimParams &bus_params);
+
   /// Top-level bus dimensions.
   BusDim bus_dim_;
+  /// Topology of the bus infrastructure.
+  ArbiterTopology topology_;
   /// The Nucleus to be instantiated by this Mantle.
   std::shared_ptr<Nucleus> nucleus_;
   /// Shortcut to the instantiated Nucleus.
@@ -61,8 +116,17 @@ class Mantle : public Component {
   std::vector<std::shared_ptr<RecordBatch>> recordbatch_components_;
   /// A mapping of bus port (containing the bus parameters and function) to arbiter instances.
   std::unordered_map<BusPort *, Instance *> arbiters_;
+  /// The memory interface channels with a top-level bus master port, per bus function.
+  std::map<BusFunction, std::vector<uint32_t>> channels_;
 };
 
+/**
+ * @brief Return the name of the top-level bus master port of a Mantle.
+ *
+ * Channel 0 results in "rd_mst" or "wr_mst", other channels are suffixed with "_ch<channel>".
+ */
+std::string MasterPortName(BusFunction function, uint32_t channel = 0);
+
 /**
  * @brief Construct the mantle component and return a shared pointer to it.
  * @param name          The name of the mantle.
@@ -70,12 +134,14 @@ class Mantle : public Component {
  * @param nucleus       The Nucleus to instantiate.
  * @param bus_spec      The specification of the top-level bus.
  * @param axi_spec      The specification of the AXI4-lite MMIO interface.
+ * @param topology      The topology of the bus infrastructure.
  * @return              A shared pointer to the mantle component.
  */
 std::shared_ptr<Mantle> mantle(const std::string &name,
                                const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                                const std::shared_ptr<Nucleus> &nucleus,
                                BusDim bus_spec,
-                               Axi4LiteSpec axi_spec);
+                               Axi4LiteSpec axi_spec,
+                               ArbiterTopology topology = {});
 
 }  // namespace fletchgen
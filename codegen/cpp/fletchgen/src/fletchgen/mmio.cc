@@ -22,6 +22,10 @@
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <map>
+#include <sstream>
 
 #include "fletchgen/axi4_lite.h"
 #include "fletchgen/basic_types.h"
@@ -35,6 +39,7 @@ static std::string ToString(MmioBehavior behavior) {
   switch (behavior) {
     case MmioBehavior::STATUS: return "status";
     case MmioBehavior::STROBE: return "strobe";
+    case MmioBehavior::CONSTANT: return "constant";
     default: return "control";
   }
 }
@@ -69,6 +74,10 @@ std::shared_ptr<Component> mmio(const std::vector<fletcher::RecordBatchDescripti
   auto comp = component("mmio", {kcd});
   // Generate all ports and add to the component.
   for (const auto &reg : regs) {
+    // Constant registers are not connected to anything.
+    if (reg.behavior == MmioBehavior::CONSTANT) {
+      continue;
+    }
     auto dir = ToDir(reg.behavior);
     auto port = mmio_port(dir, reg, kernel_cd());
     // Change the name to vhdmmio convention.
@@ -96,12 +105,209 @@ static size_t Offset(uint32_t address, uint32_t alignment) {
   return 8 * (address % (alignment / 8));
 }
 
+std::vector<size_t> AssignMmioAddresses(const std::vector<std::vector<MmioReg> *> &regs,
+                                        Axi4LiteSpec axi_spec,
+                                        std::optional<size_t *> next_addr) {
+  std::vector<size_t> result;
+  // The next free byte address.
+  size_t next_free_addr = axi_spec.offset;
+  for (const auto &sub : regs) {
+    for (auto &r : *sub) {
+      if (r.addr) {
+        // There is a fixed address.
+        result.push_back(axi_spec.offset + *r.addr);
+        // Just take this address plus its space as the next address. This limits how the vector of MmioRegs can be
+        // supplied (fixed addr. must be at the start of the vector and ordered), but we don't currently use this in
+        // any other way.
+        next_free_addr = axi_spec.offset + *r.addr + AddrSpaceUsed(r.width, 32);
+      } else {
+        // There is not a fixed address. Remember it relative to the offset, like fixed addresses, such that assigning
+        // the addresses again results in the same addresses.
+        result.push_back(next_free_addr);
+        r.addr = next_free_addr - axi_spec.offset;
+        next_free_addr += AddrSpaceUsed(r.width, 32);
+      }
+    }
+  }
+  if (next_addr) {
+    **next_addr = next_free_addr;
+  }
+  return result;
+}
+
+static std::string ToString(MmioFunction function) {
+  switch (function) {
+    case MmioFunction::BATCH: return "batch";
+    case MmioFunction::BUFFER: return "buffer";
+    case MmioFunction::KERNEL: return "kernel";
+    case MmioFunction::PROFILE: return "profile";
+    case MmioFunction::PROJECTION: return "projection";
+    case MmioFunction::WRITTEN: return "written";
+    case MmioFunction::RING: return "ring";
+    case MmioFunction::CHUNKS: return "chunks";
+    case MmioFunction::VALIDITY: return "validity";
+    case MmioFunction::TIMER: return "timer";
+    case MmioFunction::PROGRESS: return "progress";
+    case MmioFunction::COMPLETION: return "completion";
+    case MmioFunction::TRACE: return "trace";
+    default: return "default";
+  }
+}
+
+std::string GenerateMmioManifest(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec) {
+  std::stringstream ss;
+  ss << "# Fletchgen generated MMIO register manifest.\n"
+        "# Registers are 32 bits wide. Fields wider than the remainder of a register continue in the next registers.\n"
+        "# name function behavior register bit_index bit_width\n";
+  auto addresses = AssignMmioAddresses(regs, axi_spec);
+  size_t i = 0;
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      ss << r.name << " " << ToString(r.function) << " " << ToString(r.behavior) << " " << addresses[i++] / 4 << " "
+         << r.index << " " << r.width << "\n";
+    }
+  }
+  return ss.str();
+}
+
+/// @brief Return a name in CamelCase, e.g. R_A_enable becomes RAEnable.
+static std::string CamelCase(const std::string &name) {
+  std::string result;
+  bool upper = true;
+  for (char c : name) {
+    if (c == '_') {
+      upper = true;
+    } else {
+      result += upper ? static_cast<char>(std::toupper(c)) : c;
+      upper = false;
+    }
+  }
+  return result;
+}
+
+std::string GenerateMmioHeader(const std::vector<std::vector<MmioReg> *> &regs,
+                               Axi4LiteSpec axi_spec,
+                               const std::string &kernel_name) {
+  auto addresses = AssignMmioAddresses(regs, axi_spec);
+  std::stringstream fields;
+  std::stringstream accessors;
+  size_t num_regs = 0;
+  size_t i = 0;
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      auto offset = addresses[i++] / 4;
+      num_regs = std::max(num_regs, offset + AddrSpaceUsed(r.index + r.width, 32) / 4);
+      auto desc = r.desc.empty() ? r.name : r.desc;
+      fields << "/// " << desc << " (" << ToString(r.function) << ", " << ToString(r.behavior) << ")\n"
+             << "constexpr Field " << r.name << "{" << offset << ", " << r.index << ", " << r.width << "};\n";
+      if (r.init && (r.behavior == MmioBehavior::CONSTANT)) {
+        fields << "/// Value of " << r.name << ".\n"
+               << "constexpr uint64_t " << r.name << "_value = 0x" << std::hex << std::uppercase << *r.init
+               << std::dec << std::nouppercase << ";\n";
+      }
+      // Fields beyond 64 bits have no accessors.
+      if (r.index + r.width > 64) {
+        continue;
+      }
+      auto type = r.width > 32 ? "uint64_t" : "uint32_t";
+      auto name = CamelCase(r.name);
+      if (r.behavior != MmioBehavior::STATUS && r.behavior != MmioBehavior::CONSTANT) {
+        accessors << "  /// @brief Write " << r.name << ": " << desc << "\n"
+                  << "  fletcher::Status Set" << name << "(" << type << " value) { return Write(" << r.name
+                  << ", value); }\n";
+      }
+      if (r.behavior != MmioBehavior::STROBE) {
+        accessors << "  /// @brief Read " << r.name << ": " << desc << "\n"
+                  << "  fletcher::Status Get" << name << "(" << type << " *value) {\n"
+                  << "    uint64_t raw = 0;\n"
+                  << "    auto status = Read(" << r.name << ", &raw);\n"
+                  << "    *value = static_cast<" << type << ">(raw);\n"
+                  << "    return status;\n"
+                  << "  }\n";
+      }
+    }
+  }
+
+  std::stringstream ss;
+  ss << "// Fletchgen generated register layout of kernel " << kernel_name << ".\n"
+        "// Registers are 32 bits wide. Fields wider than the remainder of a register continue in the next registers.\n"
+        "#pragma once\n"
+        "\n"
+        "#include <fletcher/api.h>\n"
+        "#include <cstdint>\n"
+        "\n"
+        "namespace " << kernel_name << "_mmio {\n"
+        "\n"
+        "/// A field of one or more 32-bit registers.\n"
+        "struct Field {\n"
+        "  /// The index of the first 32-bit register holding the field.\n"
+        "  uint64_t offset;\n"
+        "  /// The LSB index of the field within the first register.\n"
+        "  uint32_t index;\n"
+        "  /// The width of the field in bits.\n"
+        "  uint32_t width;\n"
+        "};\n"
+        "\n"
+     << fields.str()
+     << "\n"
+        "/// The number of 32-bit registers of the register window.\n"
+        "constexpr uint64_t num_registers = " << num_regs << ";\n"
+        "\n"
+        "/// Typed access to the registers of the register window of a Kernel.\n"
+        "class Registers {\n"
+        " public:\n"
+        "  /// @brief Construct typed access to the registers of a Kernel.\n"
+        "  explicit Registers(fletcher::Kernel *kernel)\n"
+        "      : platform_(kernel->context()->platform().get()), mmio_base_(kernel->mmio_base()) {}\n"
+        "\n"
+     << accessors.str()
+     << "\n"
+        "  /// @brief Write a field, preserving the other bits of partially covered registers.\n"
+        "  fletcher::Status Write(Field field, uint64_t value) {\n"
+        "    for (uint32_t word = 0; 32 * word < field.index + field.width; word++) {\n"
+        "      uint32_t lo = word == 0 ? field.index : 0;\n"
+        "      uint32_t hi = field.index + field.width - 32 * word < 32 ? field.index + field.width - 32 * word : 32;\n"
+        "      uint32_t mask = hi - lo == 32 ? 0xFFFFFFFFu : ((1u << (hi - lo)) - 1) << lo;\n"
+        "      auto part = static_cast<uint32_t>((value << field.index) >> (32 * word));\n"
+        "      if (mask != 0xFFFFFFFFu) {\n"
+        "        uint32_t old = 0;\n"
+        "        auto status = platform_->ReadMMIO(mmio_base_ + field.offset + word, &old);\n"
+        "        if (!status.ok()) return status;\n"
+        "        part = (old & ~mask) | (part & mask);\n"
+        "      }\n"
+        "      auto status = platform_->WriteMMIO(mmio_base_ + field.offset + word, part);\n"
+        "      if (!status.ok()) return status;\n"
+        "    }\n"
+        "    return fletcher::Status::OK();\n"
+        "  }\n"
+        "\n"
+        "  /// @brief Read a field.\n"
+        "  fletcher::Status Read(Field field, uint64_t *value) {\n"
+        "    uint64_t raw = 0;\n"
+        "    for (uint32_t word = 0; 32 * word < field.index + field.width; word++) {\n"
+        "      uint32_t part = 0;\n"
+        "      auto status = platform_->ReadMMIO(mmio_base_ + field.offset + word, &part);\n"
+        "      if (!status.ok()) return status;\n"
+        "      raw |= static_cast<uint64_t>(part) << (32 * word);\n"
+        "    }\n"
+        "    raw >>= field.index;\n"
+        "    *value = field.width < 64 ? raw & ((1ull << field.width) - 1) : raw;\n"
+        "    return fletcher::Status::OK();\n"
+        "  }\n"
+        "\n"
+        " private:\n"
+        "  fletcher::Platform *platform_;\n"
+        "  uint64_t mmio_base_;\n"
+        "};\n"
+        "\n"
+        "}  // namespace " << kernel_name << "_mmio\n";
+  return ss.str();
+}
+
 std::string GenerateVhdmmioYaml(const std::vector<std::vector<MmioReg> *> &regs,
                                 Axi4LiteSpec axi_spec,
                                 std::optional<size_t *> next_addr) {
   std::stringstream ss;
-  // The next free byte address.
-  size_t next_free_addr = axi_spec.offset;
   // Header:
   ss << "metadata:\n"
         "  name: mmio\n"
@@ -122,23 +328,13 @@ std::string GenerateVhdmmioYaml(const std::vector<std::vector<MmioReg> *> &regs,
         "\n"
         "fields: \n";
 
+  auto addresses = AssignMmioAddresses(regs, axi_spec, next_addr);
+
   // Iterate over the registers and generate the appropriate YAML lines.
+  size_t i = 0;
   for (const auto &sub : regs) {
     for (auto &r : *sub) {
-      // Determine the address.
-      if (r.addr) {
-        // There is a fixed address.
-        ss << "  - address: " << axi_spec.offset + *r.addr << "\n";
-        // Just take this address plus its space as the next address. This limits how the vector of MmioRegs can be
-        // supplied (fixed addr. must be at the start of the vector and ordered), but we don't currently use this in
-        // any other way.
-        next_free_addr = axi_spec.offset + *r.addr + AddrSpaceUsed(r.width, 32);
-      } else {
-        // There is not a fixed address.
-        ss << "  - address: " << next_free_addr << "\n";
-        r.addr = next_free_addr;
-        next_free_addr += AddrSpaceUsed(r.width, 32);
-      }
+      ss << "  - address: " << addresses[i++] << "\n";
       // Set doc, name and other stuff.
       ss << "    name: " << r.name << "\n";
       if (!r.desc.empty()) {
@@ -151,14 +347,366 @@ std::string GenerateVhdmmioYaml(const std::vector<std::vector<MmioReg> *> &regs,
         ss << "    bitrange: " << offset + r.index << "\n";
       }
       ss << "    behavior: " << ToString(r.behavior) << "\n";
+      if (r.behavior == MmioBehavior::CONSTANT) {
+        ss << "    value: " << r.init.value_or(0) << "\n";
+      }
       ss << "\n";
     }
   }
 
-  if (next_addr) {
-    **next_addr = next_free_addr;
+  return ss.str();
+}
+
+namespace {
+
+/// A part of a register that is mapped onto a single bus word.
+struct MmioSlice {
+  /// The register.
+  const MmioReg *reg;
+  /// The lowest bit of the part in the register.
+  uint32_t reg_lo;
+  /// The lowest bit of the part in the bus word.
+  uint32_t word_lo;
+  /// The number of bits.
+  uint32_t width;
+};
+
+/// @brief Return a VHDL bit string literal of some width.
+std::string BitString(uint64_t value, uint32_t width) {
+  std::string bits;
+  for (uint32_t i = width; i > 0; i--) {
+    bits.push_back(((i - 1 < 64) && ((value >> (i - 1)) & 1u)) ? '1' : '0');
+  }
+  return width == 1 ? "'" + bits + "'" : "\"" + bits + "\"";
+}
+
+/// @brief Return a VHDL range of some width starting at some bit.
+std::string Range(uint32_t lo, uint32_t width) {
+  return "(" + std::to_string(lo + width - 1) + " downto " + std::to_string(lo) + ")";
+}
+
+/// @brief Return the internal register signal name of a register.
+std::string RegSignal(const MmioReg &r) {
+  return "r_" + r.name;
+}
+
+/// @brief Return the VHDL port declarations of the mmio component.
+std::string MmioPorts(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec) {
+  std::stringstream ss;
+  auto decl = [&](const std::string &name, const std::string &dir, const std::string &type) {
+    ss << "    " << std::left << std::setw(40) << name << " : " << std::setw(4) << dir << type << ";\n";
+  };
+  auto vec = [](size_t width) { return "std_logic_vector(" + std::to_string(width - 1) + " downto 0)"; };
+  decl("kcd_clk", "in", "std_logic");
+  decl("kcd_reset", "in", "std_logic");
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      if (r.behavior == MmioBehavior::CONSTANT) {
+        continue;
+      }
+      auto type = r.width == 1 ? std::string("std_logic") : vec(r.width);
+      if (ToDir(r.behavior) == Port::Dir::IN) {
+        decl("f_" + r.name + "_write_data", "in", type);
+      } else {
+        decl("f_" + r.name + "_data", "out", type);
+      }
+    }
+  }
+  auto dw = axi_spec.data_width;
+  auto aw = axi_spec.addr_width;
+  decl("mmio_awvalid", "in", "std_logic");
+  decl("mmio_awready", "out", "std_logic");
+  decl("mmio_awaddr", "in", vec(aw));
+  decl("mmio_wvalid", "in", "std_logic");
+  decl("mmio_wready", "out", "std_logic");
+  decl("mmio_wdata", "in", vec(dw));
+  decl("mmio_wstrb", "in", vec(dw / 8));
+  decl("mmio_bvalid", "out", "std_logic");
+  decl("mmio_bready", "in", "std_logic");
+  decl("mmio_bresp", "out", vec(2));
+  decl("mmio_arvalid", "in", "std_logic");
+  decl("mmio_arready", "out", "std_logic");
+  decl("mmio_araddr", "in", vec(aw));
+  decl("mmio_rvalid", "out", "std_logic");
+  decl("mmio_rready", "in", "std_logic");
+  decl("mmio_rdata", "out", vec(dw));
+  decl("mmio_rresp", "out", vec(2));
+  // Remove the last semicolon.
+  auto str = ss.str();
+  str.erase(str.rfind(';'), 1);
+  return str;
+}
+
+}  // namespace
+
+std::string GenerateMmioPackage(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec) {
+  std::stringstream ss;
+  ss << "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "\n"
+        "package mmio_pkg is\n"
+        "\n"
+        "  component mmio is\n"
+        "    port (\n";
+  // Indent the port declarations by another level.
+  std::stringstream ports(MmioPorts(regs, axi_spec));
+  for (std::string line; std::getline(ports, line);) {
+    ss << "  " << line << "\n";
   }
+  ss << "    );\n"
+        "  end component;\n"
+        "\n"
+        "end package mmio_pkg;\n";
+  return ss.str();
+}
 
+std::string GenerateMmioVhdl(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec) {
+  auto addresses = AssignMmioAddresses(regs, axi_spec);
+  auto dw = static_cast<uint32_t>(axi_spec.data_width);
+  auto aw = static_cast<uint32_t>(axi_spec.addr_width);
+  auto word_bytes = dw / 8;
+  uint32_t lsb = 0;
+  while ((1u << lsb) < word_bytes) lsb++;
+
+  // Map every register onto the bus words it occupies.
+  std::map<uint64_t, std::vector<MmioSlice>> words;
+  size_t i = 0;
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      uint64_t bit = 8 * static_cast<uint64_t>(addresses[i++]) + r.index;
+      uint32_t done = 0;
+      while (done < r.width) {
+        auto word_lo = static_cast<uint32_t>(bit % dw);
+        auto n = std::min(r.width - done, dw - word_lo);
+        words[bit / dw].push_back({&r, done, word_lo, n});
+        bit += n;
+        done += n;
+      }
+    }
+  }
+
+  auto word_name = [](uint64_t w) { return "w_" + std::to_string(w); };
+  // Bits of a register part, as an expression.
+  auto reg_bits = [](const std::string &sig, const MmioSlice &s) {
+    return s.reg->width == 1 ? sig : sig + Range(s.reg_lo, s.width);
+  };
+  // Bits of a bus word part, as an expression.
+  auto word_bits = [](const std::string &word, const MmioSlice &s) {
+    return s.reg->width == 1 ? word + "(" + std::to_string(s.word_lo) + ")" : word + Range(s.word_lo, s.width);
+  };
+
+  std::stringstream ss;
+  ss << "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n"
+        "-- AXI4-lite register file generated by Fletchgen.\n"
+        "entity mmio is\n"
+        "  port (\n"
+     << MmioPorts(regs, axi_spec)
+     << "  );\n"
+        "end entity mmio;\n"
+        "\n"
+        "architecture Behavioral of mmio is\n"
+        "\n"
+        "  constant ZERO       : std_logic_vector(" << dw - 1 << " downto 0) := (others => '0');\n"
+        "\n";
+
+  // Register signals for everything the host writes.
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      if ((r.behavior != MmioBehavior::STATUS) && (r.behavior != MmioBehavior::CONSTANT)) {
+        auto init = r.behavior == MmioBehavior::CONTROL ? r.init.value_or(0) : 0;
+        auto type = r.width == 1 ? std::string("std_logic")
+                                 : "std_logic_vector(" + std::to_string(r.width - 1) + " downto 0)";
+        ss << "  signal " << std::left << std::setw(11) << RegSignal(r) << " : " << type
+           << " := " << BitString(init, r.width) << ";\n";
+      }
+    }
+  }
+  // Read values of every bus word.
+  for (const auto &w : words) {
+    ss << "  signal " << std::left << std::setw(11) << word_name(w.first)
+       << " : std_logic_vector(" << dw - 1 << " downto 0);\n";
+  }
+  ss << "\n"
+        "  signal awready_r   : std_logic := '0';\n"
+        "  signal bvalid_r    : std_logic := '0';\n"
+        "  signal arready_r   : std_logic := '0';\n"
+        "  signal rvalid_r    : std_logic := '0';\n"
+        "  signal rdata_r     : std_logic_vector(" << dw - 1 << " downto 0) := (others => '0');\n"
+        "\n"
+        "  -- Return a bus word, with the bytes selected by a write strobe replaced.\n"
+        "  function merge(old: std_logic_vector; data: std_logic_vector; strb: std_logic_vector)\n"
+        "    return std_logic_vector is\n"
+        "    variable result : std_logic_vector(" << dw - 1 << " downto 0) := old;\n"
+        "  begin\n"
+        "    for i in 0 to " << word_bytes - 1 << " loop\n"
+        "      if strb(i) = '1' then\n"
+        "        result(8*i+7 downto 8*i) := data(8*i+7 downto 8*i);\n"
+        "      end if;\n"
+        "    end loop;\n"
+        "    return result;\n"
+        "  end function;\n"
+        "\n"
+        "begin\n"
+        "\n";
+
+  // Compose the read value of every bus word. Strobe registers read as zero, constant registers as their value.
+  for (const auto &w : words) {
+    auto slices = w.second;
+    std::sort(slices.begin(), slices.end(), [](const MmioSlice &a, const MmioSlice &b) {
+      return a.word_lo > b.word_lo;
+    });
+    std::vector<std::string> parts;
+    uint32_t top = dw;
+    for (const auto &s : slices) {
+      if (s.word_lo + s.width > top) {
+        FLETCHER_LOG(ERROR, "MMIO register " + s.reg->name + " overlaps with another register.");
+      }
+      if (s.word_lo + s.width < top) {
+        parts.push_back("ZERO" + Range(0, top - s.word_lo - s.width));
+      }
+      switch (s.reg->behavior) {
+        case MmioBehavior::STATUS: parts.push_back(reg_bits("f_" + s.reg->name + "_write_data", s));
+          break;
+        case MmioBehavior::CONTROL: parts.push_back(reg_bits(RegSignal(*s.reg), s));
+          break;
+        case MmioBehavior::STROBE: parts.push_back("ZERO" + Range(0, s.width));
+          break;
+        case MmioBehavior::CONSTANT: parts.push_back(BitString(s.reg->init.value_or(0) >> s.reg_lo, s.width));
+          break;
+      }
+      top = s.word_lo;
+    }
+    if (top > 0) {
+      parts.push_back("ZERO" + Range(0, top));
+    }
+    ss << "  " << word_name(w.first) << " <= ";
+    for (size_t p = 0; p < parts.size(); p++) {
+      ss << (p > 0 ? "\n    & " : "") << parts[p];
+    }
+    ss << ";\n";
+  }
+  ss << "\n";
+
+  // Drive the register outputs.
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      if ((r.behavior != MmioBehavior::STATUS) && (r.behavior != MmioBehavior::CONSTANT)) {
+        ss << "  f_" << r.name << "_data <= " << RegSignal(r) << ";\n";
+      }
+    }
+  }
+
+  auto word_addr = [&](uint64_t w) { return BitString(w, aw - lsb); };
+  auto reset_strobes = [&](const std::string &indent) {
+    for (const auto &sub : regs) {
+      for (const auto &r : *sub) {
+        if (r.behavior == MmioBehavior::STROBE) {
+          ss << indent << RegSignal(r) << " <= " << (r.width == 1 ? "'0'" : "(others => '0')") << ";\n";
+        }
+      }
+    }
+  };
+
+  ss << "\n"
+        "  mmio_awready <= awready_r;\n"
+        "  mmio_wready  <= awready_r;\n"
+        "  mmio_bvalid  <= bvalid_r;\n"
+        "  mmio_bresp   <= \"00\";\n"
+        "  mmio_arready <= arready_r;\n"
+        "  mmio_rvalid  <= rvalid_r;\n"
+        "  mmio_rdata   <= rdata_r;\n"
+        "  mmio_rresp   <= \"00\";\n"
+        "\n"
+        "  reg_proc: process (kcd_clk) is\n"
+        "    variable waddr : std_logic_vector(" << aw - lsb - 1 << " downto 0);\n"
+        "    variable raddr : std_logic_vector(" << aw - lsb - 1 << " downto 0);\n"
+        "    variable wword : std_logic_vector(" << dw - 1 << " downto 0);\n"
+        "  begin\n"
+        "    if rising_edge(kcd_clk) then\n"
+        "      -- Strobes are asserted for a single cycle.\n";
+  reset_strobes("      ");
+  ss << "      awready_r <= '0';\n"
+        "      arready_r <= '0';\n"
+        "      if mmio_bready = '1' then\n"
+        "        bvalid_r <= '0';\n"
+        "      end if;\n"
+        "      if mmio_rready = '1' then\n"
+        "        rvalid_r <= '0';\n"
+        "      end if;\n"
+        "\n"
+        "      -- Accept a write when both address and data are valid and the response can be given.\n"
+        "      if mmio_awvalid = '1' and mmio_wvalid = '1' and awready_r = '0'\n"
+        "         and (bvalid_r = '0' or mmio_bready = '1') then\n"
+        "        awready_r <= '1';\n"
+        "        bvalid_r <= '1';\n"
+        "        waddr := mmio_awaddr(" << aw - 1 << " downto " << lsb << ");\n"
+        "        case waddr is\n";
+  for (const auto &w : words) {
+    auto has = [&](MmioBehavior behavior) {
+      return std::any_of(w.second.begin(), w.second.end(), [&](const MmioSlice &s) {
+        return s.reg->behavior == behavior;
+      });
+    };
+    // Words holding status and constant registers only can not be written.
+    if (!has(MmioBehavior::CONTROL) && !has(MmioBehavior::STROBE)) {
+      continue;
+    }
+    ss << "          when " << word_addr(w.first) << " =>\n";
+    // Control registers keep the bytes that are not written, strobes only fire for the bytes that are.
+    for (auto behavior : {MmioBehavior::CONTROL, MmioBehavior::STROBE}) {
+      if (!has(behavior)) {
+        continue;
+      }
+      auto old = behavior == MmioBehavior::CONTROL ? word_name(w.first) : std::string("ZERO");
+      ss << "            wword := merge(" << old << ", mmio_wdata, mmio_wstrb);\n";
+      for (const auto &s : w.second) {
+        if (s.reg->behavior == behavior) {
+          ss << "            " << reg_bits(RegSignal(*s.reg), s) << " <= " << word_bits("wword", s) << ";\n";
+        }
+      }
+    }
+  }
+  ss << "          when others =>\n"
+        "            null;\n"
+        "        end case;\n"
+        "      end if;\n"
+        "\n"
+        "      -- Accept a read when the response can be given.\n"
+        "      if mmio_arvalid = '1' and arready_r = '0' and (rvalid_r = '0' or mmio_rready = '1') then\n"
+        "        arready_r <= '1';\n"
+        "        rvalid_r <= '1';\n"
+        "        raddr := mmio_araddr(" << aw - 1 << " downto " << lsb << ");\n"
+        "        case raddr is\n";
+  for (const auto &w : words) {
+    ss << "          when " << word_addr(w.first) << " =>\n"
+       << "            rdata_r <= " << word_name(w.first) << ";\n";
+  }
+  ss << "          when others =>\n"
+        "            rdata_r <= (others => '0');\n"
+        "        end case;\n"
+        "      end if;\n"
+        "\n"
+        "      if kcd_reset = '1' then\n";
+  for (const auto &sub : regs) {
+    for (const auto &r : *sub) {
+      if (r.behavior == MmioBehavior::CONTROL) {
+        ss << "        " << RegSignal(r) << " <= " << BitString(r.init.value_or(0), r.width) << ";\n";
+      }
+    }
+  }
+  reset_strobes("        ");
+  ss << "        awready_r <= '0';\n"
+        "        bvalid_r <= '0';\n"
+        "        arready_r <= '0';\n"
+        "        rvalid_r <= '0';\n"
+        "      end if;\n"
+        "    end if;\n"
+        "  end process;\n"
+        "\n"
+        "end architecture Behavioral;\n";
   return ss.str();
 }
 
@@ -166,7 +714,8 @@ bool ExposeToKernel(MmioFunction fun) {
   switch (fun) {
     case MmioFunction::DEFAULT:
     case MmioFunction::KERNEL:
-    case MmioFunction::BATCH: return true;
+    case MmioFunction::BATCH:
+    case MmioFunction::PROJECTION: return true;
     default:return false;
   }
 }
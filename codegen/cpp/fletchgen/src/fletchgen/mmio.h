@@ -47,14 +47,33 @@ constexpr char MMIO_BUFFER[] = "fletchgen_mmio_buffer";
 constexpr char MMIO_KERNEL[] = "fletchgen_mmio_kernel";
 /// Fletchgen metadata for mmio-controlled profiling ports.
 constexpr char MMIO_PROFILE[] = "fletchgen_mmio_profile";
+/// Fletchgen metadata for profiling registers of streams on memory interface bus ports.
+constexpr char MMIO_PROFILE_BUS[] = "fletchgen_mmio_profile_bus";
+/// Fletchgen metadata for the number of 32-bit words of a descriptor of the descriptor ring.
+constexpr char MMIO_RING_REGS[] = "fletchgen_mmio_ring_regs";
+/// Fletchgen metadata for the number of bus beats of a descriptor of the descriptor ring.
+constexpr char MMIO_RING_BEATS[] = "fletchgen_mmio_ring_beats";
+/// Fletchgen metadata for the two-log of the number of entries of the bus trace ring.
+constexpr char MMIO_TRACE_DEPTH_LOG2[] = "fletchgen_mmio_trace_depth_log2";
+/// Fletchgen metadata for the number of bus beats of a descriptor of a chunk list.
+constexpr char MMIO_CHUNK_BEATS[] = "fletchgen_mmio_chunk_beats";
 
 /// Register intended use enumeration.
 enum class MmioFunction {
-  DEFAULT,   ///< Default registers.
-  BATCH,     ///< Registers for RecordBatch metadata.
-  BUFFER,    ///< Registers for buffer addresses.
-  KERNEL,    ///< Registers for the kernel.
-  PROFILE    ///< Register for the profiler.
+  DEFAULT,     ///< Default registers.
+  BATCH,       ///< Registers for RecordBatch metadata.
+  BUFFER,      ///< Registers for buffer addresses.
+  KERNEL,      ///< Registers for the kernel.
+  PROFILE,     ///< Register for the profiler.
+  PROJECTION,  ///< Registers to enable the fields of RecordBatches.
+  WRITTEN,     ///< Registers reporting the number of elements written to RecordBatches.
+  RING,        ///< Registers of the descriptor ring.
+  CHUNKS,      ///< Registers of the chunk lists of RecordBatches.
+  VALIDITY,    ///< Registers to skip reading the validity bitmaps of fields without nulls.
+  TIMER,       ///< Registers timing the execution of the kernel.
+  PROGRESS,    ///< Registers reporting the number of rows consumed from RecordBatches.
+  COMPLETION,  ///< Registers of the completion record written to host memory.
+  TRACE        ///< Registers of the bus request trace.
 };
 
 /// Register access behavior enumeration.
@@ -62,6 +81,7 @@ enum class MmioBehavior {
   CONTROL,   ///< Register contents is controlled by host software.
   STATUS,    ///< Register contents is controlled by hardware kernel.
   STROBE,    ///< Register contents is asserted for one cycle by host software.
+  CONSTANT,  ///< Register contents is the initial value, read-only. Does not result in a port.
 };
 
 /// @brief Structure to represent an MMIO register
@@ -118,6 +138,20 @@ struct MmioPort : public Port {
 std::shared_ptr<MmioPort> mmio_port(Port::Dir dir, const MmioReg &reg,
                                     const std::shared_ptr<ClockDomain> &domain = cerata::default_domain());
 
+/**
+ * @brief Assign addresses to registers that do not have one.
+ *
+ * Any fixed addresses in the MmioReg.address field can only occur at the start of the vector set and must be ordered.
+ *
+ * @param regs       A vector of pointers to vectors of registers. Will be modified in case address was not set.
+ * @param axi_spec   Specification of the AXI4 lite mmio bus.
+ * @param next_addr  Optionally outputs the byte address offset of the next free register address.
+ * @return           The bus byte address of every register, in order.
+ */
+std::vector<size_t> AssignMmioAddresses(const std::vector<std::vector<MmioReg> *> &regs,
+                                        Axi4LiteSpec axi_spec,
+                                        std::optional<size_t *> next_addr = std::nullopt);
+
 /**
  * @brief Returns a YAML string for the vhdmmio tool based on a set of registers.
  *
@@ -131,6 +165,50 @@ std::string GenerateVhdmmioYaml(const std::vector<std::vector<MmioReg> *> &regs,
                                 Axi4LiteSpec axi_spec,
                                 std::optional<size_t *> next_addr = std::nullopt);
 
+/**
+ * @brief Returns a register manifest for the run-time based on a set of registers.
+ *
+ * Every register results in a line with its name, function, behavior, the index of the 32-bit register it starts in,
+ * and its bit index and bit width. Lines starting with # are comments.
+ *
+ * @param regs       A vector of pointers to vectors of registers. Will be modified in case address was not set.
+ * @param axi_spec   Specification of the AXI4 lite mmio bus.
+ */
+std::string GenerateMmioManifest(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec);
+
+/**
+ * @brief Returns a C++ header for the run-time with the register layout of a design.
+ *
+ * For every register, the header holds a constexpr Field with the index of the 32-bit register it starts in, and its
+ * bit index and bit width, in a namespace named after the kernel. It also holds a Registers class with a typed setter
+ * and/or getter for every register, e.g. SetThreshold(uint32_t), operating on the register window of a
+ * fletcher::Kernel. Host code including the header performs no run-time register offset arithmetic, and fails to
+ * compile when it refers to registers that the design no longer has.
+ *
+ * @param regs         A vector of pointers to vectors of registers. Will be modified in case address was not set.
+ * @param axi_spec     Specification of the AXI4 lite mmio bus.
+ * @param kernel_name  The name of the kernel.
+ */
+std::string GenerateMmioHeader(const std::vector<std::vector<MmioReg> *> &regs,
+                               Axi4LiteSpec axi_spec,
+                               const std::string &kernel_name);
+
+/**
+ * @brief Returns the VHDL source of an AXI4-lite register file for a set of registers.
+ *
+ * The resulting "mmio" entity has the same interface as the one that vhdmmio generates from GenerateVhdmmioYaml, such
+ * that it can be used without running vhdmmio. Control registers are read/write, status registers are read-only,
+ * strobe registers are asserted for one cycle for every bit written as one, and constant registers read as their
+ * initial value.
+ *
+ * @param regs       A vector of pointers to vectors of registers. Will be modified in case address was not set.
+ * @param axi_spec   Specification of the AXI4 lite mmio bus.
+ */
+std::string GenerateMmioVhdl(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec);
+
+/// @brief Returns the VHDL source of the mmio_pkg package, declaring the component of GenerateMmioVhdl.
+std::string GenerateMmioPackage(const std::vector<std::vector<MmioReg> *> &regs, Axi4LiteSpec axi_spec);
+
 /**
  * @brief Generate the MMIO component for the nucleus.
  *
@@ -14,8 +14,11 @@
 
 #include <cerata/api.h>
 #include <cerata/vhdl/vhdl.h>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include <cerata/parameter.h>
 
 #include "fletchgen/nucleus.h"
@@ -34,10 +37,31 @@ using cerata::vector;
 using cerata::component;
 using cerata::parameter;
 
-Component *accm() {
+/// @brief Add an optional single-bit input port to a command merging component, if it does not have it yet.
+static void AddBitPort(Component *accm, const std::string &name) {
+  for (const auto &p : accm->GetAll<Port>()) {
+    if (p->name() == name) {
+      return;
+    }
+  }
+  accm->Add(port(name, cerata::bit(), Port::Dir::IN, kernel_cd()));
+}
+
+/// @brief Add the field enable and kernel stopped ports to a command merging component, if required.
+static void AddOptionalPorts(Component *accm, bool enable, bool stop) {
+  if (enable) {
+    AddBitPort(accm, "enable");
+  }
+  if (stop) {
+    AddBitPort(accm, "stopped");
+  }
+}
+
+Component *accm(bool enable, bool stop) {
   // Check if the Array component was already created.
   auto opt_comp = cerata::default_component_pool()->Get("ArrayCmdCtrlMerger");
   if (opt_comp) {
+    AddOptionalPorts(*opt_comp, enable, stop);
     return *opt_comp;
   }
 
@@ -45,16 +69,183 @@ Component *accm() {
   auto iw = index_width();
   auto tw = tag_width();
   auto num_addr = parameter("num_addr", 0);
+  auto num_flags = parameter("NUM_FLAGS", 0);
+  auto validity = parameter("VALIDITY", std::string(""));
   auto kernel_side_cmd = port("kernel_cmd", cmd_type(iw, tw), Port::Dir::IN, kernel_cd());
-  auto nucleus_side_cmd = port("nucleus_cmd", cmd_type(iw, tw, num_addr * ba), Port::Dir::OUT, kernel_cd());
+  auto nucleus_side_cmd = port("nucleus_cmd", cmd_type(iw, tw, num_addr * ba + num_flags), Port::Dir::OUT, kernel_cd());
   auto ctrl = port_array("ctrl", vector(ba), num_addr, Port::Dir::IN, kernel_cd());
-  auto result = component("ArrayCmdCtrlMerger", {num_addr, ba, iw, tw, kernel_side_cmd, nucleus_side_cmd, ctrl});
+  auto all_valid = port_array("all_valid", cerata::bit(), num_flags, Port::Dir::IN, kernel_cd());
+  auto result = component("ArrayCmdCtrlMerger", {num_addr, ba, iw, tw, num_flags, validity,
+                                                 kernel_side_cmd, nucleus_side_cmd, ctrl, all_valid});
 
   // This is a primitive component from the hardware lib
   result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
   result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
   result->SetMeta(cerata::vhdl::meta::PACKAGE, "Array_pkg");
 
+  AddOptionalPorts(result.get(), enable, stop);
+  return result.get();
+}
+
+Component *descriptor_ring(Axi4LiteSpec axi_spec) {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto opt_comp = cerata::default_component_pool()->Get("DescriptorRing");
+  if (opt_comp) {
+    return *opt_comp;
+  }
+
+  auto result = component("DescriptorRing");
+
+  // Parameters.
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::READ};
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+  result->Add({parameter("MMIO_ADDR_WIDTH", static_cast<int>(axi_spec.addr_width)),
+               parameter("MMIO_DATA_WIDTH", static_cast<int>(axi_spec.data_width)),
+               parameter("MMIO_OFFSET", static_cast<int>(axi_spec.offset)),
+               parameter("DESC_REGS", 1),
+               parameter("DESC_BEATS", 1)});
+
+  // The host side and the register file side of the AXI4-lite port, and the descriptor fetch bus port.
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  auto mmio = std::make_shared<Axi4LitePort>(Port::Dir::IN, axi_spec, "mmio", bus_cd());
+  auto regs = std::make_shared<Axi4LitePort>(Port::Dir::OUT, axi_spec, "regs", bus_cd());
+  auto bus = bus_port("bus", Port::Dir::OUT, spec);
+  result->Add({kcd, mmio, regs, bus});
+
+  // The ring registers.
+  result->Add({port("enable", cerata::bit(), Port::Dir::IN, kernel_cd()),
+               port("base", vector(64), Port::Dir::IN, kernel_cd()),
+               port("size", vector(32), Port::Dir::IN, kernel_cd()),
+               port("tail", vector(32), Port::Dir::IN, kernel_cd()),
+               port("head", vector(32), Port::Dir::OUT, kernel_cd())});
+
+  // This is a primitive component from the hardware lib
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Wrapper_pkg");
+  return result.get();
+}
+
+Component *kernel_timer() {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto opt_comp = cerata::default_component_pool()->Get("KernelTimer");
+  if (opt_comp) {
+    return *opt_comp;
+  }
+
+  auto result = component("KernelTimer", {port("kcd", cr(), Port::Dir::IN, kernel_cd()),
+                                          port("start", cerata::bit(), Port::Dir::IN, kernel_cd()),
+                                          port("reset", cerata::bit(), Port::Dir::IN, kernel_cd()),
+                                          port("done", cerata::bit(), Port::Dir::IN, kernel_cd()),
+                                          port("cycles", vector(64), Port::Dir::OUT, kernel_cd())});
+
+  // This is a primitive component from the hardware lib
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Wrapper_pkg");
+  return result.get();
+}
+
+Component *chunk_walker(bool enable, bool stop) {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto opt_comp = cerata::default_component_pool()->Get("ChunkWalker");
+  if (opt_comp) {
+    AddOptionalPorts(*opt_comp, enable, stop);
+    return *opt_comp;
+  }
+
+  auto result = component("ChunkWalker");
+
+  // Parameters.
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::READ};
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+  auto iw = index_width();
+  auto tw = tag_width();
+  auto num_addr = parameter("NUM_ADDR", 1);
+  auto num_flags = parameter("NUM_FLAGS", 0);
+  result->Add({iw, tw, num_addr,
+               parameter("INDEX_WORDS", 1),
+               parameter("ADDR_WORD", 2),
+               parameter("DESC_BEATS", 1),
+               num_flags,
+               parameter("VALIDITY", std::string(""))});
+
+  // The command and unlock streams on either side, and the descriptor fetch bus port.
+  auto kcd = port("kcd", cr(), Port::Dir::IN, kernel_cd());
+  auto kernel_cmd = port("kernel_cmd", cmd_type(iw, tw), Port::Dir::IN, kernel_cd());
+  auto nucleus_cmd = port("nucleus_cmd", cmd_type(iw, tw, num_addr * params.aw + num_flags), Port::Dir::OUT,
+                          kernel_cd());
+  auto nucleus_unl = port("nucleus_unl", unlock_type(tw), Port::Dir::IN, kernel_cd());
+  auto kernel_unl = port("kernel_unl", unlock_type(tw), Port::Dir::OUT, kernel_cd());
+  auto bus = bus_port("bus", Port::Dir::OUT, spec);
+  result->Add({kcd, kernel_cmd, nucleus_cmd, nucleus_unl, kernel_unl, bus});
+
+  // The chunk list registers.
+  result->Add({port("chunks", vector(64), Port::Dir::IN, kernel_cd()),
+               port("num_chunks", vector(32), Port::Dir::IN, kernel_cd())});
+
+  // This is a primitive component from the hardware lib
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Wrapper_pkg");
+
+  AddOptionalPorts(result.get(), enable, stop);
+  return result.get();
+}
+
+Component *completion_writer() {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto opt_comp = cerata::default_component_pool()->Get("CompletionWriter");
+  if (opt_comp) {
+    return *opt_comp;
+  }
+
+  auto result = component("CompletionWriter");
+
+  // Parameters.
+  BusDimParams params(result);
+  BusSpecParams spec{params, BusFunction::WRITE};
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+
+  // The status and result of the kernel, the record address and the record write bus port.
+  result->Add({port("kcd", cr(), Port::Dir::IN, kernel_cd()),
+               port("idle", cerata::bit(), Port::Dir::IN, kernel_cd()),
+               port("busy", cerata::bit(), Port::Dir::IN, kernel_cd()),
+               port("done", cerata::bit(), Port::Dir::IN, kernel_cd()),
+               port("result", vector(64), Port::Dir::IN, kernel_cd()),
+               port("cycles", vector(64), Port::Dir::IN, kernel_cd()),
+               port("address", vector(64), Port::Dir::IN, kernel_cd()),
+               bus_port("bus", Port::Dir::OUT, spec)});
+
+  // This is a primitive component from the hardware lib
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Wrapper_pkg");
+  return result.get();
+}
+
+Component *kernel_stop() {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto opt_comp = cerata::default_component_pool()->Get("KernelStop");
+  if (opt_comp) {
+    return *opt_comp;
+  }
+
+  auto result = component("KernelStop", {port("kcd", cr(), Port::Dir::IN, kernel_cd()),
+                                         port("start", cerata::bit(), Port::Dir::IN, kernel_cd()),
+                                         port("stop", cerata::bit(), Port::Dir::IN, kernel_cd()),
+                                         port("reset", cerata::bit(), Port::Dir::IN, kernel_cd()),
+                                         port("stopped", cerata::bit(), Port::Dir::OUT, kernel_cd())});
+
+  // This is a primitive component from the hardware lib
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Wrapper_pkg");
   return result.get();
 }
 
@@ -73,11 +264,12 @@ Nucleus::Nucleus(const std::string &name,
                  const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                  const std::shared_ptr<Kernel> &kernel,
                  const std::shared_ptr<Component> &mmio,
-                 Axi4LiteSpec axi_spec)
+                 Axi4LiteSpec axi_spec,
+                 BusDim bus_dim)
     : Component(name) {
   cerata::NodeMap rebinding;
 
-  auto iw = index_width();
+  auto iw = index_width(GetIndexWidth(recordbatches));
   auto tw = tag_width();
   Add(iw);
   Add(tw);
@@ -91,11 +283,26 @@ Nucleus::Nucleus(const std::string &name,
   // Instantiate the kernel and connect the clock/reset.
   kernel_inst = Instantiate(kernel.get());
   Connect(kernel_inst->prt("kcd"), kcd.get());
+  // Expose the result scratchpad bus port of the kernel, if any, for the Mantle to connect to the bus infrastructure.
+  if (kernel_inst->Has("result_bus")) {
+    auto bus_params = BusDimParams(this, bus_dim, "RESULT");
+    auto bus = bus_port("result_bus", Port::Dir::OUT, BusSpecParams{bus_params, BusFunction::WRITE});
+    Add(bus);
+    Connect(bus.get(), kernel_inst->prt("result_bus"));
+    ConnectBusParam(kernel_inst, "RESULT_", bus_params, inst_to_comp_map());
+  }
 
   // Instantiate the MMIO component and connect the AXI4-lite port and clock/reset.
   auto mmio_inst = Instantiate(mmio.get());
-  mmio_inst->prt("mmio") <<= axi;
   mmio_inst->prt("kcd") <<= kcd;
+  // A descriptor ring, if any, sits in between the AXI4-lite port and the MMIO component.
+  auto ring_inst = InstantiateDescriptorRing(mmio_inst, kcd.get(), axi_spec, bus_dim);
+  if (ring_inst != nullptr) {
+    ring_inst->prt("mmio") <<= axi;
+    Connect(mmio_inst->prt("mmio"), ring_inst->prt("regs"));
+  } else {
+    mmio_inst->prt("mmio") <<= axi;
+  }
   // For the kernel user, we need to abstract the "ctrl" field of the command streams away.
   // We need to instantiate a little ArrayCommandCtrlMerger (accm) component that just adds the buffer addresses to
   // the cmd stream ctrl field. We will remember the instances of that component and we'll get the buffer address ports
@@ -103,11 +310,37 @@ Nucleus::Nucleus(const std::string &name,
   std::vector<Instance *> accms;
   // Get all the buffer ports from the mmio instance.
   std::vector<MmioPort *> mmio_buffer_ports;
+  // Get the field enable ports from the mmio instance, if fields can be projected out.
+  std::vector<MmioPort *> mmio_enable_ports;
+  // Get the chunk list registers from the mmio instance, if RecordBatches have chunk lists.
+  std::unordered_map<std::string, MmioPort *> mmio_chunk_ports;
+  // Get the all valid registers of the validity bitmaps from the mmio instance, if they were generated.
+  std::vector<MmioPort *> mmio_validity_ports;
   for (const auto &p : mmio_inst->GetAll<MmioPort>()) {
     if (p->reg.function == MmioFunction::BUFFER) {
       mmio_buffer_ports.push_back(p);
+    } else if (p->reg.function == MmioFunction::VALIDITY) {
+      mmio_validity_ports.push_back(p);
+    } else if (p->reg.function == MmioFunction::PROJECTION) {
+      mmio_enable_ports.push_back(p);
+    } else if (p->reg.function == MmioFunction::CHUNKS) {
+      mmio_chunk_ports[p->reg.name] = p;
     }
   }
+  auto chunked = [&mmio_chunk_ports](const RecordBatch &rb) {
+    return mmio_chunk_ports.count(rb.schema()->name() + "_chunks") > 0;
+  };
+  // Fields read in gather mode get their commands from an ArrayGather.
+  auto gathered = [](const FieldPort &fp) {
+    return fletcher::GetBoolMeta(*fp.field_, fletcher::meta::GATHER, false);
+  };
+  // Fields cached on-chip are looked up through an ArrayCache.
+  auto cached = [](const FieldPort &fp) {
+    return fletcher::GetUIntMeta(*fp.field_, fletcher::meta::ONCHIP, 0) > 0;
+  };
+  // Once the kernel is stopped, its commands are passed on with an empty range.
+  auto stop_inst = InstantiateKernelStop(mmio_inst, kcd.get());
+  auto stop = stop_inst != nullptr;
 
   // Copy over the field-derived ports from the RecordBatches.
   for (const auto &rb : recordbatches) {
@@ -123,16 +356,27 @@ Nucleus::Nucleus(const std::string &name,
       auto ba = bus_addr_width(64, prefix);
       Add(ba);
 
-      auto nucleus_cmd = command_port(cmd->fletcher_schema_, cmd->field_, iw, tw, ba, kernel_cd());
+      auto ftw = field_tag_width(*cmd->field_, tw);
+      auto nucleus_cmd = command_port(cmd->fletcher_schema_, cmd->field_, iw, ftw, ba, kernel_cd());
       nucleus_cmd->Reverse();
       Add(nucleus_cmd);
 
       // Now, instantiate an ACCM that will merge the buffer addresses onto the command stream at the nucleus level.
-      auto accm_inst = Instantiate(accm(), cmd->name() + "_accm_inst");
+      // With a chunk list, a ChunkWalker takes its place, which merges the buffer addresses of every chunk instead.
+      Instance *accm_inst;
+      if (chunked(*rb)) {
+        accm_inst = Instantiate(chunk_walker(!mmio_enable_ports.empty(), stop), cmd->name() + "_walker_inst");
+        Connect(accm_inst->prt("kcd"), kcd.get());
+      } else {
+        accm_inst = Instantiate(accm(!mmio_enable_ports.empty(), stop), cmd->name() + "_accm_inst");
+        accm_inst->par("BUS_ADDR_WIDTH")->SetValue(ba);
+      }
+      if (stop) {
+        Connect(accm_inst->prt("stopped"), stop_inst->prt("stopped"));
+      }
       // Connect the parameters.
-      accm_inst->par("BUS_ADDR_WIDTH")->SetValue(ba);
       accm_inst->par("INDEX_WIDTH")->SetValue(iw);
-      accm_inst->par("TAG_WIDTH")->SetValue(tw);
+      accm_inst->par("TAG_WIDTH")->SetValue(ftw);
       // Remember the instance.
       accms.push_back(accm_inst);
     }
@@ -142,21 +386,37 @@ Nucleus::Nucleus(const std::string &name,
   size_t batch_idx = 0;
   size_t accm_idx = 0;
   size_t buf_idx = 0;
+  size_t valid_idx = 0;
   for (const auto &r : recordbatches) {
-    // Connect Arrow data stream
+    // Connect Arrow data stream, through a filter if the schema has a filter expression.
+    auto filter_inst = InstantiateFilter(*r, mmio_inst, kcd.get());
     for (const auto &ap : r->GetFieldPorts(FieldPort::Function::ARROW)) {
       auto kernel_data = kernel_inst->prt(ap->name());
       auto nucleus_data = prt(ap->name());
       std::shared_ptr<cerata::Edge> edge;
-      if (ap->dir() == Port::OUT) {
+      if (cached(*ap)) {
+        if (filter_inst != nullptr) {
+          FLETCHER_LOG(FATAL, "Field " << ap->field_->name() << " of RecordBatch " << r->name()
+                                       << " can not be cached on-chip with a filter expression.");
+        }
+        InstantiateCache(*ap, kcd.get());
+      } else if (filter_inst != nullptr) {
+        Connect(filter_inst->prt("in_" + ap->name()), nucleus_data);
+        Connect(kernel_data, filter_inst->prt("out_" + ap->name()));
+      } else if (ap->dir() == Port::OUT) {
         edge = Connect(kernel_data, nucleus_data);
       } else {
         edge = Connect(nucleus_data, kernel_data);
       }
     }
 
-    // Connect unlock stream
+    // Connect unlock stream. With a chunk list, the ChunkWalker passes on one unlock per kernel command.
+    // Likewise, the ArrayGather of a field read in gather mode passes on one unlock per gather, and the ArrayCache of a
+    // field cached on-chip passes on the unlock of a preload once it is stored.
     for (const auto &up : r->GetFieldPorts(FieldPort::Function::UNLOCK)) {
+      if (chunked(*r) || gathered(*up) || cached(*up)) {
+        continue;
+      }
       auto kernel_unl = kernel_inst->prt(up->name());
       auto nucleus_unl = prt(up->name());
       Connect(kernel_unl, nucleus_unl);
@@ -164,29 +424,80 @@ Nucleus::Nucleus(const std::string &name,
 
     // Connect the command stream through the ACCM.
     size_t field_idx = 0;
+    size_t rb_buf_idx = 0;
     for (const auto &cmd : r->GetFieldPorts(FieldPort::Function::COMMAND)) {
       // Get the ports on either side of the ACCM.
       auto accm_nucleus_cmd = accms[accm_idx]->prt("nucleus_cmd");
       auto accm_kernel_cmd = accms[accm_idx]->prt("kernel_cmd");
-      auto accm_ctrl = accms[accm_idx]->prt_arr("ctrl");
 
-      // Get the corresponding cmd ports on this nucleus and the kernel.
+      // Get the corresponding cmd port on this nucleus.
       auto nucleus_cmd = this->prt(cmd->name());
-      auto kernel_cmd = kernel_inst->prt(cmd->name());
 
       // Connect the nucleus cmd to the ACCM cmd and the ACCM command to the kernel cmd.
       Connect(nucleus_cmd, accm_nucleus_cmd);
-      Connect(accm_kernel_cmd, kernel_cmd);
+      if (gathered(*cmd)) {
+        // In gather mode, the kernel supplies row indices to an ArrayGather, which drives the ACCM command instead.
+        if (chunked(*r)) {
+          FLETCHER_LOG(FATAL, "Field " << cmd->field_->name() << " of RecordBatch " << r->name()
+                                       << " can not be read in gather mode with a chunk list.");
+        }
+        auto name = r->schema()->name() + "_" + cmd->field_->name();
+        auto gather_inst = Instantiate(array_gather(), name + "_gather_inst");
+        Connect(gather_inst->prt("kcd"), kcd.get());
+        gather_inst->par("INDEX_WIDTH")->SetValue(iw);
+        gather_inst->par("TAG_WIDTH")->SetValue(field_tag_width(*cmd->field_, tw));
+        Connect(accm_kernel_cmd, gather_inst->prt("nucleus_cmd"));
+        Connect(gather_inst->prt("kernel_idx"), kernel_inst->prt(name + "_idx"));
+        Connect(gather_inst->prt("nucleus_unl"), prt(name + "_unl"));
+        Connect(kernel_inst->prt(name + "_unl"), gather_inst->prt("kernel_unl"));
+      } else {
+        Connect(accm_kernel_cmd, kernel_inst->prt(cmd->name()));
+      }
 
       // To connect the buffer addresses from the mmio to the ACCM, we need to figure out which buffers there are.
       // We can look this up in the RecordBatchDescription.
       auto field_bufs = r->batch_desc().fields[field_idx].buffers;
-      for (size_t b = 0; b < field_bufs.size(); b++) {
+      if (chunked(*r)) {
+        // The buffer addresses of the field follow the indices and the addresses of the preceding fields of the
+        // RecordBatch in every descriptor of the chunk list.
+        auto walker = accms[accm_idx];
+        auto name = r->schema()->name() + "_" + cmd->field_->name();
+        auto chunks = mmio_chunk_ports.at(r->schema()->name() + "_chunks");
+        auto index_words = static_cast<int>(GetIndexWidth(recordbatches) / 32);
+        walker->par("NUM_ADDR")->SetValue(cerata::intl(static_cast<int>(field_bufs.size())));
+        walker->par("INDEX_WORDS")->SetValue(cerata::intl(index_words));
+        walker->par("ADDR_WORD")->SetValue(cerata::intl(2 * index_words + 2 * static_cast<int>(rb_buf_idx)));
+        walker->par("DESC_BEATS")->SetValue(cerata::intl(std::stoi(chunks->reg.meta.at(MMIO_CHUNK_BEATS))));
+        Connect(walker->prt("nucleus_unl"), prt(name + "_unl"));
+        Connect(kernel_inst->prt(name + "_unl"), walker->prt("kernel_unl"));
+        ConnectChunkWalker(walker, name, chunks, mmio_chunk_ports.at(r->schema()->name() + "_num_chunks"), bus_dim);
+        buf_idx += field_bufs.size();
+        rb_buf_idx += field_bufs.size();
+      }
+      for (size_t b = 0; !chunked(*r) && (b < field_bufs.size()); b++) {
         // TODO(johanpel): it is here somewhat blatantly assumed mmio_buffer_ports follows ordering, etc.. properly.
         //  Perhaps it would be nicer if this was somewhat better synchronized.
-        Connect(accm_ctrl->Append(), mmio_buffer_ports[buf_idx]);
+        Connect(accms[accm_idx]->prt_arr("ctrl")->Append(), mmio_buffer_ports[buf_idx]);
         buf_idx++;
       }
+      // The ArrayReader expects an all valid flag right after the address of every validity bitmap. These are driven
+      // by the all valid registers, which have the same order as the validity bitmaps of the RecordBatches in read
+      // mode. Without them, the flags are low, except for chunks of which the validity bitmap has a null address.
+      auto validity = GetCtrlValidity(*cmd->field_);
+      auto num_flags = GetCtrlFlagCount(*cmd->field_);
+      accms[accm_idx]->par("VALIDITY")->SetValue(cerata::strl(validity));
+      if (!chunked(*r) && !mmio_validity_ports.empty() && (r->mode() == fletcher::Mode::READ)) {
+        for (size_t f = 0; f < num_flags; f++) {
+          Connect(accms[accm_idx]->prt_arr("all_valid")->Append(), mmio_validity_ports[valid_idx]);
+          valid_idx++;
+        }
+      } else {
+        accms[accm_idx]->par("NUM_FLAGS")->SetValue(cerata::intl(static_cast<int>(num_flags)));
+      }
+      // Connect the field enable register, which has the same order as the commands.
+      if (!mmio_enable_ports.empty()) {
+        Connect(accms[accm_idx]->prt("enable"), mmio_enable_ports[accm_idx]);
+      }
       field_idx++;
       accm_idx++;
     }
@@ -207,8 +518,15 @@ Nucleus::Nucleus(const std::string &name,
     }
   }
 
+  auto timer_inst = InstantiateKernelTimer(mmio_inst, kcd.get());
+  InstantiateCompletionWriter(mmio_inst, kcd.get(), timer_inst, bus_dim);
+
   // Gather all Field-derived ports that require profiling on this Nucleus.
   ProfileDataStreams(mmio_inst);
+  ExposeBusProfiling(mmio_inst);
+  ExposeBusTrace(mmio_inst);
+  CountOutputStreams(mmio_inst);
+  CountConsumedRows(mmio_inst);
 
   // Add and connect platform IO
   auto ext = external();
@@ -223,8 +541,181 @@ std::shared_ptr<Nucleus> nucleus(const std::string &name,
                                  const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                                  const std::shared_ptr<Kernel> &kernel,
                                  const std::shared_ptr<Component> &mmio,
-                                 Axi4LiteSpec axi_spec) {
-  return std::make_shared<Nucleus>(name, recordbatches, kernel, mmio, axi_spec);
+                                 Axi4LiteSpec axi_spec,
+                                 BusDim bus_dim) {
+  return std::make_shared<Nucleus>(name, recordbatches, kernel, mmio, axi_spec, bus_dim);
+}
+
+Instance *Nucleus::InstantiateFilter(const RecordBatch &recordbatch, Instance *mmio_inst, Port *kcd) {
+  auto expr = GetFilterExpr(*recordbatch.schema()->arrow_schema());
+  if (!expr) {
+    return nullptr;
+  }
+  if (recordbatch.schema()->mode() != fletcher::Mode::READ) {
+    FLETCHER_LOG(FATAL, "Filter expression of RecordBatch " << recordbatch.name() << " is only supported for reads.");
+  }
+  // Find the custom kernel register holding the threshold.
+  MmioPort *threshold = nullptr;
+  for (const auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if ((p->reg.function == MmioFunction::KERNEL) && (p->reg.name == expr->reg)) {
+      threshold = p;
+    }
+  }
+  if ((threshold == nullptr) || (threshold->dir() != Port::Dir::OUT)) {
+    FLETCHER_LOG(FATAL, "Filter expression of RecordBatch " << recordbatch.name() << " refers to register "
+                                                              << expr->reg << ", which is not a custom kernel control "
+                                                                              "register. Add it with --regs.");
+  }
+  auto flt = filter(recordbatch.schema()->name() + "_Filter", recordbatch, *expr, threshold->reg.width);
+  filters.push_back(flt);
+  auto inst = Instantiate(flt.get());
+  Connect(inst->prt("kcd"), kcd);
+  Connect(inst->prt("threshold"), threshold);
+  return inst;
+}
+
+Instance *Nucleus::InstantiateDescriptorRing(Instance *mmio_inst, Port *kcd, Axi4LiteSpec axi_spec, BusDim bus_dim) {
+  std::unordered_map<std::string, MmioPort *> regs;
+  for (const auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if (p->reg.function == MmioFunction::RING) {
+      regs[p->reg.name] = p;
+    }
+  }
+  if (regs.empty()) {
+    return nullptr;
+  }
+
+  auto inst = Instantiate(descriptor_ring(axi_spec));
+  Connect(inst->prt("kcd"), kcd);
+  // The descriptor size was derived from the RecordBatch registers when the ring registers were generated.
+  const auto &meta = regs.at("ring_tail")->reg.meta;
+  inst->par("DESC_REGS")->SetValue(cerata::intl(std::stoi(meta.at(MMIO_RING_REGS))));
+  inst->par("DESC_BEATS")->SetValue(cerata::intl(std::stoi(meta.at(MMIO_RING_BEATS))));
+  Connect(inst->prt("enable"), regs.at("ring_enable"));
+  Connect(inst->prt("base"), regs.at("ring_base"));
+  Connect(inst->prt("size"), regs.at("ring_size"));
+  Connect(inst->prt("tail"), regs.at("ring_tail"));
+  Connect(regs.at("ring_head"), inst->prt("head"));
+
+  // Expose the descriptor fetch bus port, for the Mantle to connect to the bus infrastructure.
+  auto bus_params = BusDimParams(this, bus_dim, "RING");
+  auto bus = bus_port("ring_bus", Port::Dir::OUT, BusSpecParams{bus_params, BusFunction::READ});
+  Add(bus);
+  Connect(bus.get(), inst->prt("bus"));
+  ConnectBusParam(inst, "", bus_params, inst_to_comp_map());
+  return inst;
+}
+
+Instance *Nucleus::InstantiateKernelTimer(Instance *mmio_inst, Port *kcd) {
+  std::unordered_map<std::string, MmioPort *> regs;
+  for (const auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if ((p->reg.function == MmioFunction::DEFAULT) || (p->reg.function == MmioFunction::TIMER)) {
+      regs[p->reg.name] = p;
+    }
+  }
+  if (regs.count("cycles") == 0) {
+    return nullptr;
+  }
+
+  auto inst = Instantiate(kernel_timer());
+  Connect(inst->prt("kcd"), kcd);
+  // The strobes and the done status are also connected to the kernel, through the default registers.
+  Connect(inst->prt("start"), regs.at("start"));
+  Connect(inst->prt("reset"), regs.at("reset"));
+  Connect(inst->prt("done"), kernel_inst->prt("done"));
+  Connect(regs.at("cycles"), inst->prt("cycles"));
+  return inst;
+}
+
+Instance *Nucleus::InstantiateCompletionWriter(Instance *mmio_inst, Port *kcd, Instance *timer, BusDim bus_dim) {
+  MmioPort *address = nullptr;
+  for (const auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if ((p->reg.function == MmioFunction::COMPLETION) && (p->reg.name == "completion_address")) {
+      address = p;
+    }
+  }
+  if (address == nullptr) {
+    return nullptr;
+  }
+  if (timer == nullptr) {
+    FLETCHER_LOG(FATAL, "A completion record requires the cycles register of the default registers.");
+  }
+
+  auto inst = Instantiate(completion_writer());
+  Connect(inst->prt("kcd"), kcd);
+  // The status and result ports of the kernel also drive the default registers.
+  Connect(inst->prt("idle"), kernel_inst->prt("idle"));
+  Connect(inst->prt("busy"), kernel_inst->prt("busy"));
+  Connect(inst->prt("done"), kernel_inst->prt("done"));
+  Connect(inst->prt("result"), kernel_inst->prt("result"));
+  Connect(inst->prt("cycles"), timer->prt("cycles"));
+  Connect(inst->prt("address"), address);
+
+  // Expose the record write bus port, for the Mantle to connect to the bus infrastructure.
+  auto bus_params = BusDimParams(this, bus_dim, "COMPLETION");
+  auto bus = bus_port("completion_bus", Port::Dir::OUT, BusSpecParams{bus_params, BusFunction::WRITE});
+  Add(bus);
+  Connect(bus.get(), inst->prt("bus"));
+  ConnectBusParam(inst, "", bus_params, inst_to_comp_map());
+  return inst;
+}
+
+Instance *Nucleus::InstantiateKernelStop(Instance *mmio_inst, Port *kcd) {
+  std::unordered_map<std::string, MmioPort *> regs;
+  for (const auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if (p->reg.function == MmioFunction::DEFAULT) {
+      regs[p->reg.name] = p;
+    }
+  }
+  if ((regs.count("start") == 0) || (regs.count("stop") == 0) || (regs.count("reset") == 0)) {
+    return nullptr;
+  }
+
+  auto inst = Instantiate(kernel_stop());
+  Connect(inst->prt("kcd"), kcd);
+  // The strobes are also connected to the kernel, through the default registers.
+  Connect(inst->prt("start"), regs.at("start"));
+  Connect(inst->prt("stop"), regs.at("stop"));
+  Connect(inst->prt("reset"), regs.at("reset"));
+  return inst;
+}
+
+Instance *Nucleus::InstantiateCache(const FieldPort &arrow_port, Port *kcd) {
+  auto name = arrow_port.name();
+  auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(arrow_port.field_->type());
+  auto depth = fletcher::GetUIntMeta(*arrow_port.field_, fletcher::meta::ONCHIP, 0);
+  auto depth_log2 = std::max(1, static_cast<int>(ceil(log2(depth))));
+
+  auto inst = Instantiate(array_cache(), name + "_cache_inst");
+  Connect(inst->prt("kcd"), kcd);
+  inst->par("INDEX_WIDTH")->SetValue(par("INDEX_WIDTH")->shared_from_this());
+  inst->par("TAG_WIDTH")->SetValue(field_tag_width(*arrow_port.field_, par("TAG_WIDTH")->shared_from_this()));
+  inst->par("VALUE_WIDTH")->SetValue(cerata::intl(fwt->bit_width()));
+  inst->par("DEPTH_LOG2")->SetValue(cerata::intl(depth_log2));
+
+  // The data ports carry the Arrow data stream of the field, of which the kernel receives the looked up values.
+  auto data_type = arrow_port.type()->shared_from_this();
+  inst->prt("nucleus_data")->SetType(data_type);
+  inst->prt("kernel_data")->SetType(data_type);
+  Connect(inst->prt("nucleus_data"), prt(name));
+  Connect(kernel_inst->prt(name), inst->prt("kernel_data"));
+  Connect(inst->prt("kernel_lookup"), kernel_inst->prt(name + "_lookup"));
+  Connect(inst->prt("nucleus_unl"), prt(name + "_unl"));
+  Connect(kernel_inst->prt(name + "_unl"), inst->prt("kernel_unl"));
+  return inst;
+}
+
+void Nucleus::ConnectChunkWalker(Instance *walker, const std::string &name, MmioPort *chunks, MmioPort *count,
+                                 BusDim bus_dim) {
+  Connect(walker->prt("chunks"), chunks);
+  Connect(walker->prt("num_chunks"), count);
+
+  // Expose the descriptor fetch bus port, for the Mantle to connect to the bus infrastructure.
+  auto bus_params = BusDimParams(this, bus_dim, name + "_CHUNK");
+  auto bus = bus_port(name + "_chunk_bus", Port::Dir::OUT, BusSpecParams{bus_params, BusFunction::READ});
+  Add(bus);
+  Connect(bus.get(), walker->prt("bus"));
+  ConnectBusParam(walker, "", bus_params, inst_to_comp_map());
 }
 
 std::vector<FieldPort *> Nucleus::GetFieldPorts(FieldPort::Function fun) const {
@@ -264,21 +755,30 @@ void Nucleus::ProfileDataStreams(Instance *mmio_inst) {
     //  unchanged as well. This assumption might be a bit wild if things get added in the future, so it would be nice
     //  to figure out a better way to keep this synchronized.
 
-    // Get the enable and clear ports.
+    // Get the enable, clear and snapshot ports.
     auto enable = signal("Profile_enable", cerata::bit(), kernel_cd());
     auto clear = signal("Profile_clear", cerata::bit(), kernel_cd());
-    Add({enable, clear});
+    auto snapshot = signal("Profile_snapshot", cerata::bit(), kernel_cd());
+    Add({enable, clear, snapshot});
 
     enable <<= mmio_inst->prt("f_Profile_enable_data");
     clear <<= mmio_inst->prt("f_Profile_clear_data");
+    snapshot <<= mmio_inst->prt("f_Profile_snapshot_data");
 
     // Gather all mmio profile result ports
     std::vector<MmioPort *> mmio_profile_ports;
     for (auto &p : mmio_inst->GetAll<MmioPort>()) {
-      if ((p->reg.function == MmioFunction::PROFILE) && (p->reg.behavior == MmioBehavior::STATUS)) {
+      if ((p->reg.function == MmioFunction::PROFILE) && (p->reg.behavior == MmioBehavior::STATUS)
+          && (p->reg.meta.count(MMIO_PROFILE_BUS) == 0)) {
         mmio_profile_ports.push_back(p);
       }
     }
+    // The counters are as wide as the registers they are connected to.
+    if (mmio_profile_ports.empty()) {
+      FLETCHER_LOG(ERROR, "No mmio profile registers present for profiled streams.");
+    }
+    auto count_width = cerata::intl(static_cast<int>(mmio_profile_ports.front()->reg.width));
+
     // Loop over all profiled nodes and connect them.
     size_t port_idx = 0;
     for (const auto &pair : profiler_map) {
@@ -288,6 +788,8 @@ void Nucleus::ProfileDataStreams(Instance *mmio_inst) {
       for (const auto &prof_inst : instances) {
         Connect(prof_inst->prt("enable"), enable.get());
         Connect(prof_inst->prt("clear"), clear.get());
+        Connect(prof_inst->prt("snapshot"), snapshot.get());
+        prof_inst->par("OUT_COUNT_WIDTH")->SetValue(count_width);
       }
 
       for (const auto &prof_port : ports) {
@@ -298,4 +800,134 @@ void Nucleus::ProfileDataStreams(Instance *mmio_inst) {
   }
 }
 
+void Nucleus::CountOutputStreams(Instance *mmio_inst) {
+  std::vector<MmioPort *> mmio_count_ports;
+  for (auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if (p->reg.function == MmioFunction::WRITTEN) {
+      mmio_count_ports.push_back(p);
+    }
+  }
+  if (mmio_count_ports.empty()) {
+    return;
+  }
+
+  // Insert a signal between the kernel and every port of a write-mode field, and count the streams of that signal.
+  cerata::NodeMap rebinding;
+  std::vector<cerata::Signal *> count_nodes;
+  for (const auto &p : GetFieldPorts(FieldPort::Function::ARROW)) {
+    if (p->fletcher_schema_->mode() == fletcher::Mode::WRITE) {
+      count_nodes.push_back(AttachSignalToNode(this, p, &rebinding, "Written_" + p->name()));
+    }
+  }
+  auto counter_map = EnableElementCounting(this, count_nodes);
+
+  // The counters are cleared when the kernel is started, such that they hold the counts of the last run.
+  auto clear = signal("Written_clear", cerata::bit(), kernel_cd());
+  Add(clear);
+  clear <<= mmio_inst->prt("f_start_data");
+  auto count_width = cerata::intl(static_cast<int>(mmio_count_ports.front()->reg.width));
+
+  // The registers were generated in the same order as the streams of the write-mode field ports.
+  size_t port_idx = 0;
+  for (const auto &node : count_nodes) {
+    const auto &counters = counter_map.at(node);
+    for (const auto &inst : counters.first) {
+      Connect(inst->prt("clear"), clear.get());
+      inst->par("OUT_COUNT_WIDTH")->SetValue(count_width);
+    }
+    for (const auto &count_port : counters.second) {
+      if (port_idx >= mmio_count_ports.size()) {
+        FLETCHER_LOG(FATAL, "Number of output count registers does not match number of written streams.");
+      }
+      Connect(mmio_count_ports[port_idx], count_port);
+      port_idx++;
+    }
+  }
+}
+
+void Nucleus::CountConsumedRows(Instance *mmio_inst) {
+  std::unordered_map<std::string, MmioPort *> mmio_progress_ports;
+  for (auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if (p->reg.function == MmioFunction::PROGRESS) {
+      mmio_progress_ports[p->reg.name] = p;
+    }
+  }
+  if (mmio_progress_ports.empty()) {
+    return;
+  }
+
+  // Count the elements of the first stream of the first field of every read-mode RecordBatch, which are its rows.
+  cerata::NodeMap rebinding;
+  std::vector<cerata::Signal *> count_nodes;
+  std::vector<MmioPort *> count_regs;
+  std::unordered_map<const FletcherSchema *, bool> counted;
+  for (const auto &p : GetFieldPorts(FieldPort::Function::ARROW)) {
+    const auto *schema = p->fletcher_schema_.get();
+    if ((schema->mode() != fletcher::Mode::READ) || counted[schema]) {
+      continue;
+    }
+    counted[schema] = true;
+    count_nodes.push_back(AttachSignalToNode(this, p, &rebinding, "Consumed_" + p->name()));
+    count_regs.push_back(mmio_progress_ports.at(schema->name() + "_consumed"));
+  }
+  auto counter_map = EnableElementCounting(this, count_nodes);
+
+  // The counters are cleared when the kernel is started, such that they hold the counts of the last run.
+  auto clear = signal("Consumed_clear", cerata::bit(), kernel_cd());
+  Add(clear);
+  clear <<= mmio_inst->prt("f_start_data");
+  auto count_width = cerata::intl(static_cast<int>(count_regs.front()->reg.width));
+  for (size_t i = 0; i < count_nodes.size(); i++) {
+    const auto &counters = counter_map.at(count_nodes[i]);
+    for (const auto &inst : counters.first) {
+      Connect(inst->prt("clear"), clear.get());
+      inst->par("OUT_COUNT_WIDTH")->SetValue(count_width);
+    }
+    Connect(count_regs[i], counters.second.front());
+  }
+}
+
+void Nucleus::ExposeBusProfiling(Instance *mmio_inst) {
+  // The bus ports are only available in the Mantle, so the counter registers of their profilers are exposed as ports.
+  std::vector<MmioPort *> bus_profile_ports;
+  for (auto &p : mmio_inst->GetAll<MmioPort>()) {
+    if ((p->reg.function == MmioFunction::PROFILE) && (p->reg.meta.count(MMIO_PROFILE_BUS) > 0)) {
+      bus_profile_ports.push_back(p);
+    }
+  }
+  if (bus_profile_ports.empty()) {
+    return;
+  }
+
+  for (const auto &control : {"enable", "clear", "snapshot"}) {
+    auto p = port(std::string("Profile_bus_") + control, cerata::bit(), Port::Dir::OUT, kernel_cd());
+    Add(p);
+    Connect(p, mmio_inst->prt(std::string("f_Profile_") + control + "_data"));
+  }
+
+  for (const auto &mp : bus_profile_ports) {
+    auto p = mmio_port(Port::Dir::IN, mp->reg, kernel_cd());
+    Add(p);
+    Connect(mp, p);
+  }
+}
+
+void Nucleus::ExposeBusTrace(Instance *mmio_inst) {
+  // Like the bus profilers, the BusTracer is only instantiated in the Mantle, so all its registers are exposed as ports.
+  for (auto &mp : mmio_inst->GetAll<MmioPort>()) {
+    if (mp->reg.function != MmioFunction::TRACE) {
+      continue;
+    }
+    if (mp->reg.behavior == MmioBehavior::STATUS) {
+      auto p = mmio_port(Port::Dir::IN, mp->reg, kernel_cd());
+      Add(p);
+      Connect(mp, p);
+    } else {
+      auto p = mmio_port(Port::Dir::OUT, mp->reg, kernel_cd());
+      Add(p);
+      Connect(p, mp);
+    }
+  }
+}
+
 }  // namespace fletchgen
@@ -17,7 +17,6 @@
 #include <cerata/api.h>
 #include <fletcher/common.h>
 
-#include <vector>
 #include <vector>
 #include <string>
 #include <memory>
@@ -28,14 +27,70 @@
 #include "fletchgen/array.h"
 #include "fletchgen/mmio.h"
 #include "fletchgen/axi4_lite.h"
+#include "fletchgen/filter.h"
+#include "fletchgen/bus.h"
 
 namespace fletchgen {
 
 using cerata::Port;
 using cerata::Component;
 
-/// @brief Return the ArrayCmdCtrlMerger component.
-Component *accm();
+/**
+ * @brief Return the ArrayCmdCtrlMerger component.
+ * @param enable Whether the component must have the field enable port. Its VHDL port defaults to enabled.
+ * @param stop   Whether the component must have the kernel stopped port. Its VHDL port defaults to not stopped.
+ */
+Component *accm(bool enable = false, bool stop = false);
+
+/**
+ * @brief Return a Cerata model of a DescriptorRing.
+ * @param axi_spec The specification of the AXI4-lite ports, between the host and the register file.
+ * @return         The DescriptorRing component.
+ *
+ * This model corresponds to [`hardware/wrapper/DescriptorRing.vhd`]. Changes to the implementation of this component
+ * in the HDL source must be reflected in the implementation of this function.
+ */
+Component *descriptor_ring(Axi4LiteSpec axi_spec);
+
+/**
+ * @brief Return a Cerata model of a ChunkWalker, which takes the place of the ArrayCmdCtrlMerger of a field of a
+ *        RecordBatch with a chunk list.
+ * @param enable Whether the component must have the field enable port. Its VHDL port defaults to enabled.
+ * @param stop   Whether the component must have the kernel stopped port. Its VHDL port defaults to not stopped.
+ * @return       The ChunkWalker component.
+ *
+ * This model corresponds to [`hardware/wrapper/ChunkWalker.vhd`]. Changes to the implementation of this component in
+ * the HDL source must be reflected in the implementation of this function.
+ */
+Component *chunk_walker(bool enable = false, bool stop = false);
+
+/**
+ * @brief Return a Cerata model of a KernelTimer, which counts the cycles of the execution of the kernel.
+ * @return The KernelTimer component.
+ *
+ * This model corresponds to [`hardware/wrapper/KernelTimer.vhd`]. Changes to the implementation of this component in
+ * the HDL source must be reflected in the implementation of this function.
+ */
+Component *kernel_timer();
+
+/**
+ * @brief Return a Cerata model of a CompletionWriter, which writes a completion record to host memory when the kernel
+ *        is done.
+ * @return The CompletionWriter component.
+ *
+ * This model corresponds to [`hardware/wrapper/CompletionWriter.vhd`]. Changes to the implementation of this component
+ * in the HDL source must be reflected in the implementation of this function.
+ */
+Component *completion_writer();
+
+/**
+ * @brief Return a Cerata model of a KernelStop, which remembers that the kernel was stopped until it is started again.
+ * @return The KernelStop component.
+ *
+ * This model corresponds to [`hardware/wrapper/KernelStop.vhd`]. Changes to the implementation of this component in
+ * the HDL source must be reflected in the implementation of this function.
+ */
+Component *kernel_stop();
 
 /// @brief It's like a kernel, but there is a kernel inside.
 struct Nucleus : Component {
@@ -44,18 +99,92 @@ struct Nucleus : Component {
                    const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                    const std::shared_ptr<Kernel> &kernel,
                    const std::shared_ptr<Component> &mmio,
-                   Axi4LiteSpec axi_spec);
+                   Axi4LiteSpec axi_spec,
+                   BusDim bus_dim = BusDim());
 
   /// @brief Return all field-derived ports with a specific function.
   std::vector<FieldPort *> GetFieldPorts(FieldPort::Function fun) const;
 
   /// @brief Profile any Arrow data streams that require profiling.
   void ProfileDataStreams(Instance *mmio_inst);
+  /// @brief Count the elements of the Arrow data streams that the kernel writes, if there are registers for them.
+  void CountOutputStreams(Instance *mmio_inst);
+  /// @brief Count the rows the kernel consumes from read-mode RecordBatches, if there are registers for them.
+  void CountConsumedRows(Instance *mmio_inst);
+  /// @brief Expose the bus profiler control and counter registers to the Mantle, where the bus ports are profiled.
+  void ExposeBusProfiling(Instance *mmio_inst);
+  /// @brief Expose the bus trace registers to the Mantle, where the bus ports are traced.
+  void ExposeBusTrace(Instance *mmio_inst);
+  /**
+   * @brief Instantiate a filter for the Arrow data streams of a RecordBatch, if its schema has a filter expression.
+   * @param recordbatch The RecordBatch to filter.
+   * @param mmio_inst   The MMIO instance providing the threshold register.
+   * @param kcd         The kernel clock domain port of this Nucleus.
+   * @return The filter instance, or nullptr if the RecordBatch is not filtered.
+   */
+  Instance *InstantiateFilter(const RecordBatch &recordbatch, Instance *mmio_inst, Port *kcd);
+  /**
+   * @brief Instantiate a KernelTimer driving the cycles register, if there is one, from the start and reset strobes of
+   *        the MMIO instance and the done status of the kernel.
+   * @param mmio_inst The MMIO instance providing the default registers.
+   * @param kcd       The kernel clock domain port of this Nucleus.
+   * @return The timer instance, or nullptr if there is no cycles register.
+   */
+  Instance *InstantiateKernelTimer(Instance *mmio_inst, Port *kcd);
+  /**
+   * @brief Instantiate a KernelStop driven by the start, stop and reset strobes of the MMIO instance, of which the
+   *        stopped port makes the command mergers pass on the commands of the kernel with an empty range.
+   * @param mmio_inst The MMIO instance providing the default registers.
+   * @param kcd       The kernel clock domain port of this Nucleus.
+   * @return The stop instance, or nullptr if there are no start, stop and reset registers.
+   */
+  Instance *InstantiateKernelStop(Instance *mmio_inst, Port *kcd);
+  /**
+   * @brief Instantiate a CompletionWriter, if there are registers for it, writing the status and result of the kernel
+   *        and the count of a KernelTimer to host memory. Its bus port is exposed to the Mantle as "completion_bus".
+   * @param mmio_inst The MMIO instance providing the completion record registers.
+   * @param kcd       The kernel clock domain port of this Nucleus.
+   * @param timer     The KernelTimer instance providing the cycles of the kernel.
+   * @param bus_dim   The dimensions of the bus through which the record is written.
+   * @return The completion writer instance, or nullptr if there are no completion record registers.
+   */
+  Instance *InstantiateCompletionWriter(Instance *mmio_inst, Port *kcd, Instance *timer, BusDim bus_dim);
+  /**
+   * @brief Instantiate an ArrayCache for a field cached on-chip, in between its Arrow data and unlock streams and the
+   *        kernel, and connect it to the lookup port of the kernel.
+   * @param arrow_port  The Arrow data port of the field on this Nucleus.
+   * @param kcd         The kernel clock domain port of this Nucleus.
+   * @return The cache instance.
+   */
+  Instance *InstantiateCache(const FieldPort &arrow_port, Port *kcd);
+  /**
+   * @brief Instantiate a descriptor ring between the AXI4-lite port and the MMIO instance, if there are registers for
+   *        it. Its bus port is exposed to the Mantle as the "ring_bus" port.
+   * @param mmio_inst The MMIO instance providing the ring registers.
+   * @param kcd       The kernel clock domain port of this Nucleus.
+   * @param axi_spec  The specification of the AXI4-lite port.
+   * @param bus_dim   The dimensions of the bus through which descriptors are fetched.
+   * @return The descriptor ring instance, or nullptr if there are no ring registers.
+   */
+  Instance *InstantiateDescriptorRing(Instance *mmio_inst, Port *kcd, Axi4LiteSpec axi_spec, BusDim bus_dim);
+  /**
+   * @brief Connect the ChunkWalker of a field to the chunk list registers of its RecordBatch, and expose its bus port
+   *        to the Mantle as the "<schema>_<field>_chunk_bus" port.
+   * @param walker    The ChunkWalker instance.
+   * @param name      The name of the field, prefixed with the name of its schema.
+   * @param chunks    The register holding the device address of the chunk list.
+   * @param count     The register holding the number of chunks.
+   * @param bus_dim   The dimensions of the bus through which descriptors are fetched.
+   */
+  void ConnectChunkWalker(Instance *walker, const std::string &name, MmioPort *chunks, MmioPort *count,
+                          BusDim bus_dim);
 
   /// The kernel component.
   std::shared_ptr<Kernel> kernel;
   /// The kernel instance.
   Instance *kernel_inst;
+  /// The filters in front of the kernel, one for every RecordBatch with a filter expression.
+  std::vector<std::shared_ptr<Filter>> filters;
 };
 
 /// @brief Make an Nucleus component based on RecordBatch components. Returns a shared pointer to the new Nucleus.
@@ -63,6 +192,7 @@ std::shared_ptr<Nucleus> nucleus(const std::string &name,
                                  const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
                                  const std::shared_ptr<Kernel> &kernel,
                                  const std::shared_ptr<Component> &mmio,
-                                 Axi4LiteSpec axi_spec);
+                                 Axi4LiteSpec axi_spec,
+                                 BusDim bus_dim = BusDim());
 
 }  // namespace fletchgen
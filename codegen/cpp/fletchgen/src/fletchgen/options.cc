@@ -40,6 +40,10 @@ bool Options::Parse(Options *options, int argc, char **argv) {
                  "Schemas contained in these RecordBatches may be skipped for the --input option.");
   app.add_option("-s,--recordbatch_output", options->srec_out_path,
                  "Memory model contents output file (formatted as SREC).");
+  app.add_option("--image_output", options->image_out_path,
+                 "Memory model contents output file (raw binary image). A manifest of buffer offsets is written "
+                 "to <file>.manifest. When used with --sim, the simulation memory model loads this image instead of "
+                 "the SREC file.");
   app.add_option("-t,--srec_dump", options->srec_sim_dump,
                  "Path to dump memory model contents to after simulation (formatted as SREC).");
 
@@ -59,6 +63,13 @@ bool Options::Parse(Options *options, int argc, char **argv) {
                "file exists already in the specified path, the output filename will be <filename>.bak. This "
                "file is always overwritten.");
 
+  app.add_flag("--force", options->force,
+               "Regenerate all output, even if the command line, the input files and the Fletchgen version did not "
+               "change since the last run in the output directory.");
+
+  app.add_option("-j,--jobs", options->jobs,
+                 "Maximum number of threads used to generate output files. (Default: number of hardware threads)");
+
   app.add_option("--regs", options->regs,
                  "Names of custom registers in the following format: \"<behavior>:<width>:<name>:<init>\", "
                  "where <behavior> is one character from the following options:\n"
@@ -68,6 +79,10 @@ bool Options::Parse(Options *options, int argc, char **argv) {
                  "step of the simulation. Init must be a hexadecimal value in the form of 0x01234ABCD.\n"
                  "Example: \"-reg32 c:32:myh2kreg:0xDEADBEEF s:64:mk2hreg\"");
 
+  app.add_option("--kernel_clock_hz", options->kernel_clock_hz,
+                 "Frequency of the kernel clock in Hz, reported to the run-time in the clock_hz register, such that "
+                 "the cycles register can be converted to an execution time. Default: 0 (unknown)");
+
   app.add_option("-e,--external", options->externals_yaml, "Path to YAML file describing external signals to drag "
                                                            "between kernel and top-level.");
 
@@ -82,14 +97,169 @@ bool Options::Parse(Options *options, int argc, char **argv) {
                  "  bm : Bus maximum burst size.\n"
                  "Currently supports only one top-level bus specification. Default: \"64,512,64,8,1,16\"");
 
+  app.add_option("--auto_epc", options->auto_epc,
+                 "Derive the elements-per-cycle of every field from a target throughput in bytes per cycle, the bus "
+                 "data width and the element width. Fields with \"fletcher_epc\" metadata are left unchanged. "
+                 "The expected bus utilization of every data stream is reported.");
+  app.add_flag("--perf_report", options->perf_report,
+               "Estimate the throughput of every buffer reader/writer from the bus dimensions and elements-per-cycle, "
+               "the oversubscription of every bus arbiter and the bottleneck stream of every RecordBatch, and write "
+               "the estimation to <output_path>/fletchgen.perf.");
+  app.add_option("--profile_count_width", options->profile_count_width,
+                 "Width of the counters of stream profilers. Counters wider than 32 bits span multiple MMIO registers, "
+                 "and are read out consistently through the snapshot register. Default: 32")
+      ->check(CLI::Range(1, 64));
+  app.add_flag("--profile_bus", options->profile_bus,
+               "Also profile the request and data streams of every RecordBatch memory interface bus port, to measure "
+               "bus utilization, arbiter contention and average burst lengths.");
+  app.add_option("--bus_trace", options->bus_trace,
+                 "Record the cycle, address and length of the requests of every RecordBatch memory interface bus port "
+                 "in an on-chip ring of this many entries, rounded up to a power of two, which the run-time reads out "
+                 "through MMIO registers. One request is recorded per cycle; concurrent requests of other ports are "
+                 "counted as dropped. Default: 0 (disabled)");
+  app.add_flag("--write_coalesce", options->write_coalesce,
+               "Coalesce the short bursts that BufferWriters issue before the first and after the last maximum "
+               "length burst of a command into a single burst each, for every field of schemas in write mode. The "
+               "data up to the first maximum burst boundary is then buffered before it is written. Fields can also "
+               "enable this individually with \"fletcher_write_coalesce\" metadata.");
+  app.add_flag("--output_counts", options->output_counts,
+               "Generate a status register for every stream of every field of schemas in write mode, reporting the "
+               "number of elements the kernel wrote to it since it was last started. The run-time uses these to "
+               "derive the number of bytes written to every output buffer, and to detect output buffers that were "
+               "too small.");
+  app.add_flag("--progress", options->progress,
+               "Generate a status register for every schema in read mode, reporting the number of rows of its first "
+               "field that the kernel consumed since it was last started. When a kernel is stopped, the run-time "
+               "uses these to hand the rows that were not consumed to a fallback.");
+  app.add_flag("--descriptor_ring", options->descriptor_ring,
+               "Generate a descriptor ring. The host writes batch descriptors, holding the first and last indices "
+               "and buffer addresses of all RecordBatches, to a ring in device memory and bumps its tail register. "
+               "The hardware fetches and processes the descriptors back-to-back, without a start/done handshake with "
+               "the host per batch, and bumps the head register as batches complete.");
+  app.add_flag("--chunk_list", options->chunk_list,
+               "Generate a chunk list for every schema in read mode. The host writes a descriptor for every chunk of "
+               "e.g. an Arrow Table, holding its first and last indices and buffer addresses, to device memory. The "
+               "hardware walks the chunks back-to-back for every command of the kernel, which issues its commands "
+               "over the rows of all chunks as if they were a single RecordBatch.");
+  app.add_flag("--completion_record", options->completion_record,
+               "Generate a completion record. When the kernel is done, the hardware writes the status, result and "
+               "cycles registers and a sequence number to host memory at the completion_address register, through "
+               "the first write bus master. The host waits on this record in its own memory instead of polling the "
+               "status register over MMIO.");
+  app.add_option("--result_bytes", options->result_bytes,
+                 "Size in bytes of a result scratchpad in device memory. The run-time allocates the scratchpad and "
+                 "writes its address to the result_address register, which is passed to the kernel together with a "
+                 "write bus port (result_bus) to write larger results than fit in the return registers, e.g. "
+                 "histograms or group-by aggregates. The size is reported in the result_bytes register. "
+                 "Default: 0 (no scratchpad).");
+  app.add_option("--kernel_expr", options->kernel_expr,
+                 "Generate the implementation of the kernel, instead of a template, from an expression of the form "
+                 "\"<func>(<value>) [WHERE <field> <op> <register or literal> [AND ...]]\", e.g. "
+                 "\"SUM(price * quantity) WHERE quantity > min_quantity\". <func> is SUM, COUNT, MIN or MAX. The "
+                 "kernel aggregates the rows of a single schema in read mode into the result register, at one row per "
+                 "cycle. Registers must be custom kernel control registers, see --regs.");
+  app.add_flag("--pipelined_kernel", options->pipelined_kernel,
+               "Generate a pipelined kernel template, instead of a template with an empty architecture. Every Arrow "
+               "data, command and unlock stream of the kernel passes through a register slice, and every field in "
+               "read mode passes through an example pipeline stage to the field in write mode with the same name "
+               "and type, if any. Supports fields with primitive, fixed-size list, dictionary, string, binary and "
+               "list of primitive types.");
+  app.add_flag("--projection", options->projection,
+               "Generate an enable register for every field of every RecordBatch. The ArrayReaders/Writers of "
+               "disabled fields issue no bus requests. The enable bits are also passed to the kernel, which should "
+               "not issue commands to disabled fields. All fields are enabled by default.");
+  app.add_flag("--all_valid", options->all_valid,
+               "Generate an all valid register for every validity bitmap of every schema in read mode. The "
+               "ArrayReaders skip reading the validity bitmaps of which the register is set, as if all elements are "
+               "valid. The run-time sets them for RecordBatches of which the field has no nulls, and does not "
+               "transfer those bitmaps to the device. With --chunk_list, no registers are generated, and the "
+               "validity bitmaps of chunks are skipped when their address is null instead.");
+  app.add_option("--arbiter_fan_in", options->arbiter_fan_in,
+                 "Maximum number of slave ports per bus arbiter. When more RecordBatch bus ports share a bus master, "
+                 "a tree of arbiters is generated. Default: 0 (a single arbiter per bus master).");
+  app.add_flag("--arbiter_buffers", options->arbiter_buffers,
+               "Place a bus buffer between every RecordBatch bus port and its arbiter, such that a slow stream does "
+               "not stall the other streams.");
+  app.add_flag("--arbiter_weights", options->arbiter_weights,
+               "Weigh the arbitration of every RecordBatch bus port by the bytes per cycle its field demands, i.e. "
+               "its element width times its elements-per-cycle, such that the bus share of a field follows its "
+               "demand. Fields can also set their weight with \"fletcher_bus_weight\" metadata.");
+  app.add_option("--arbiter_max_outstanding", options->arbiter_max_outstanding,
+                 "Maximum number of outstanding requests of every bus arbiter. More outstanding requests hide more "
+                 "memory latency. Default: 4")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--xclk_stages", options->xclk_stages,
+                 "Number of synchronization registers of the clock domain crossings between the kernel clock domain "
+                 "and the bus clock domain. When non-zero, the kernel and the RecordBatches run on the kernel clock, "
+                 "and every RecordBatch bus port crosses to the bus clock through a dual-clock FIFO. Default: 0 (the "
+                 "kernel and bus clock domains are driven by the same clock)");
+  app.add_option("--bus_slices", options->bus_slices,
+                 "Number of register slices on every bus connection of the arbiter trees, per class of connection, in "
+                 "the order: RecordBatch bus port to arbiter tree (leaf), between arbiter levels (tree), root arbiter "
+                 "to top-level bus master port (master). Every slice registers all streams of the bus, which breaks "
+                 "long routes at the cost of a cycle of latency. Default: 0,0,0")
+      ->expected(3)
+      ->delimiter(',');
+  app.add_option("--bus_slice_fan_in", options->bus_slice_fan_in,
+                 "Minimum number of bus ports sharing an arbiter tree for which every leaf connection gets at least "
+                 "one register slice, as the leaves of wide trees are spread over the device. Default: 0 (only the "
+                 "slices of --bus_slices are inserted)");
+
   app.add_flag("--mmio64", options->mmio64, "Use a 64-bits AXI4-lite MMIO data bus instead of 32-bits.");
   app.add_option("--mmio-offset", options->mmio_offset, "AXI4 offset address for Fletcher registers.");
+  app.add_option("--mmio_backend", options->mmio_backend,
+                 "Select the back-end that generates the MMIO register file.\n"
+                 "Available back-ends:\n"
+                 "  native  : Generate the register file VHDL directly (default).\n"
+                 "  vhdmmio : Generate a vhdmmio configuration and run vhdmmio (requires python3 and vhdmmio).")
+      ->check(CLI::IsMember({"native", "vhdmmio"}));
+  app.add_option("--platform", options->platform,
+                 "Take the defaults of --bus_specs, --mmio64, --mmio-offset and --kernel_clock_hz from a platform "
+                 "profile, and write the profile, including its run-time hints, to "
+                 "<output_path>/fletchgen.platform.profile. Options that are given explicitly override the profile.\n"
+                 "Value is the name of a built-in profile or the path of a profile file.\n"
+                 "Built-in profiles:\n"
+                 "  aws     : AWS EC2 F1.\n"
+                 "  snap    : CAPI SNAP.\n"
+                 "  ocaccel : OpenCAPI OC-Accel.\n"
+                 "  alveo   : Xilinx Alveo with XRT.");
   //app.add_option("--axi4l-addr-width", options->axi4_lite_aw, "TODO: Width of the AXI4-lite address bus (Default:32).");
 
   app.add_flag("--axi", options->axi_top, "Generate AXI top-level template (VHDL only).");
+  app.add_option("--instances", options->num_instances,
+                 "Number of mantle instances in the AXI top-level. Every instance gets its own MMIO window of 64 KiB. "
+                 "Default: 1");
+  app.add_flag("--axi_fifo", options->axi_fifo,
+               "Buffer whole bursts in the AXI converters of the AXI top-level.");
+  app.add_option("--axi_slice_depths", options->axi_slice_depths,
+                 "Depths of the slices of the AXI converters of the AXI top-level, in the order: Fletcher bus request, "
+                 "Fletcher bus data, AXI4 request, AXI4 data. A depth of 0 disables a slice. Default: 0,0,0,0")
+      ->expected(4)
+      ->delimiter(',');
 
   app.add_flag("--sim", options->sim_top,
                "Generate simulation top-level template (VHDL only).");
+  app.add_option("--sim_clock_period", options->sim_clock_period,
+                 "Bus clock period of the simulation top-level in nanoseconds. Default: 10")
+      ->check(CLI::PositiveNumber);
+  app.add_option("--sim_kernel_clock_period", options->sim_kernel_clock_period,
+                 "Kernel clock period of the simulation top-level in nanoseconds. Requires --xclk_stages when it "
+                 "differs from the bus clock period. Default: the bus clock period")
+      ->check(CLI::NonNegativeNumber);
+  app.add_option("--sim_latency", options->sim_latency,
+                 "Number of cycles the simulation memory models take to return the first word of a read request, or "
+                 "the response of a write request. Default: 0");
+  app.add_option("--sim_bandwidth", options->sim_bandwidth,
+                 "Maximum number of bytes per cycle transferred by every simulation memory model. The memory models "
+                 "print the bandwidth they achieved at the end of the simulation. Default: 0 (a bus word per cycle)");
+  app.add_option("--sim_max_outstanding", options->sim_max_outstanding,
+                 "Maximum number of read requests the simulation memory models accept before the first one is "
+                 "answered. Default: 1")
+      ->check(CLI::PositiveNumber);
+  app.add_flag("--sim_cosim", options->sim_cosim,
+               "Let a host application drive the simulation top-level through the \"sim\" platform, instead of "
+               "the RecordBatches. The top-level must be elaborated with the co-simulation bridge of "
+               "platforms/sim/hardware.");
   app.add_flag("--vivado_hls", options->vivado_hls,
                "Generate a Vivado HLS kernel template.");
 
@@ -107,6 +277,9 @@ bool Options::Parse(Options *options, int argc, char **argv) {
                "More detailed information on stdout.");
   */
 
+  // Remember the arguments, such that runs can be compared.
+  options->arguments.assign(argv + 1, argv + argc);
+
   // Try to parse and quit if parsing failed.
   try {
     app.parse(argc, argv);
@@ -115,10 +288,34 @@ bool Options::Parse(Options *options, int argc, char **argv) {
     options->quit = true;
     return true;
   } catch (CLI::Error &e) {
-    FLETCHER_LOG(ERROR, e.get_name() + ":\n" + e.what());
+    FLETCHER_LOG(WARNING, e.get_name() + ":\n" + e.what());
     return false;
   }
 
+  // Apply the platform profile to the options that were not given explicitly, and resolve the profile with the ones
+  // that were.
+  if (!options->platform.empty()) {
+    if (!LoadPlatformProfile(options->platform, &options->profile)) {
+      return false;
+    }
+    if (app.count("--bus_specs") == 0) {
+      options->bus_dims = {options->profile.bus_specs};
+    }
+    if (app.count("--mmio64") == 0) {
+      options->mmio64 = options->profile.mmio64;
+    }
+    if (app.count("--mmio-offset") == 0) {
+      options->mmio_offset = options->profile.mmio_offset;
+    }
+    if (app.count("--kernel_clock_hz") == 0) {
+      options->kernel_clock_hz = options->profile.kernel_clock_hz;
+    }
+    options->profile.bus_specs = options->bus_dims.front();
+    options->profile.mmio64 = options->mmio64;
+    options->profile.mmio_offset = options->mmio_offset;
+    options->profile.kernel_clock_hz = options->kernel_clock_hz;
+  }
+
   // Also quit when version is called.
   if (options->version) {
     options->quit = true;
@@ -138,6 +335,17 @@ bool Options::MustGenerateSREC() const {
   return false;
 }
 
+bool Options::MustGenerateImage() const {
+  if (!image_out_path.empty()) {
+    if (recordbatches.empty()) {
+      FLETCHER_LOG(WARNING, "Memory image output flag set, but no RecordBatches were supplied.");
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+
 static bool HasLanguage(const std::vector<std::string> &languages, const std::string &lang) {
   for (const auto &l : languages) {
     if (l == lang) {
@@ -20,6 +20,8 @@
 #include <memory>
 #include <string>
 
+#include "fletchgen/platform.h"
+
 namespace fletchgen {
 
 /// Fletcher program options.
@@ -38,31 +40,109 @@ struct Options {
   std::vector<std::string> languages = {"vhdl", "dot"};
   /// SREC output path. This is the path where an SREC file based on input RecordBatches will be placed.
   std::string srec_out_path;
+  /// Memory image output path. This is the path where a raw binary image based on input RecordBatches will be placed.
+  std::string image_out_path;
   /// SREC simulation output path, where the simulation should dump the memory contents of written RecordBatches.
   std::string srec_sim_dump;
   /// Name of the Kernel.
   std::string kernel_name = "Kernel";
   /// Custom 32-bit registers.
   std::vector<std::string> regs;
+  /// Kernel clock frequency in Hz, reported in the clock_hz register. 0 means unknown.
+  uint32_t kernel_clock_hz = 0;
   /// File to parse for external signals to/from top level to kernel.
   std::string externals_yaml;
   /// Bus dimensions strings.
   std::vector<std::string> bus_dims = {"64,512,8,1,16"};
+  /// Target bytes per cycle of every data stream to derive elements-per-cycle from. 0 disables this.
+  uint32_t auto_epc = 0;
+  /// Whether to write a report of the estimated throughput of every stream and arbiter.
+  bool perf_report = false;
+  /// Width of the stream profiler counters.
+  uint32_t profile_count_width = 32;
+  /// Whether to profile the streams of the RecordBatch memory interface bus ports.
+  bool profile_bus = false;
+  /// Number of entries of the trace of the requests of the RecordBatch memory interface bus ports. 0 disables this.
+  uint32_t bus_trace = 0;
+  /// Whether to coalesce the short write bursts of every field of schemas in write mode.
+  bool write_coalesce = false;
+  /// Whether to generate registers reporting the number of elements written to every stream of write-mode schemas.
+  bool output_counts = false;
+  /// Whether to generate registers reporting the number of rows the kernel consumed from every read-mode RecordBatch.
+  bool progress = false;
+  /// Whether to generate a descriptor ring, through which the kernel processes batches without a handshake per batch.
+  bool descriptor_ring = false;
+  /// Whether to generate a chunk list for every RecordBatch in read mode, such that a kernel run spans many chunks.
+  bool chunk_list = false;
+  /// Whether to write a completion record to host memory when the kernel is done, for the host to wait on.
+  bool completion_record = false;
+  /// Size of a result scratchpad in device memory that the kernel can write results to. 0 disables this.
+  uint32_t result_bytes = 0;
+  /// Expression of which Fletchgen generates the kernel implementation, instead of a template. Empty if none.
+  std::string kernel_expr;
+  /// Whether to generate a pipelined kernel template, with a register slice on every stream at the kernel interface.
+  bool pipelined_kernel = false;
+  /// Whether to generate an enable register for every field, such that unused fields can be projected out at run-time.
+  bool projection = false;
+  /// Whether to generate an all valid register for every validity bitmap, such that bitmaps without nulls are not read.
+  bool all_valid = false;
+  /// Maximum number of slave ports per bus arbiter. 0 results in a single flat arbiter per bus master.
+  uint32_t arbiter_fan_in = 0;
+  /// Whether to place a bus buffer between every RecordBatch bus port and its arbiter.
+  bool arbiter_buffers = false;
+  /// Whether the bus arbiters weigh the RecordBatch bus ports by the demand of their fields.
+  bool arbiter_weights = false;
+  /// Maximum number of outstanding requests of every bus arbiter.
+  uint32_t arbiter_max_outstanding = 4;
+  /// Synchronization registers of the kernel to bus clock domain crossings. 0 assumes a single clock.
+  uint32_t xclk_stages = 0;
+  /// Number of register slices on the leaf, tree and master bus connections of the arbiter trees.
+  std::vector<uint32_t> bus_slices = {0, 0, 0};
+  /// Minimum number of bus ports of an arbiter tree for which every leaf connection gets a register slice. 0 disables.
+  uint32_t bus_slice_fan_in = 0;
   /// Use 64-bits data width for AXI4-lite MMIO bus when true.
   bool mmio64 = false;
   /// AXI4-lite address bus width
   size_t mmio_addr_width = 32;
   /// AXI4-lite offset address for Fletcher registers.
   size_t mmio_offset = 0;
+  /// Back-end that generates the MMIO register file, either "native" or "vhdmmio".
+  std::string mmio_backend = "native";
+  /// Name of a built-in platform profile or path of a platform profile file. Empty if none.
+  std::string platform;
+  /// The platform profile, resolved with the options that were given explicitly.
+  PlatformProfile profile;
 
   /// Whether to generate an AXI top level.
   bool axi_top = false;
+  /// Number of mantle instances in the AXI top level.
+  size_t num_instances = 1;
+  /// Whether to buffer whole bursts in the AXI converters of the AXI top level.
+  bool axi_fifo = false;
+  /// Depths of the request and data slices on the Fletcher bus and AXI4 side of the AXI converters, in that order.
+  std::vector<uint32_t> axi_slice_depths = {0, 0, 0, 0};
   /// Whether to simulate an AXI top level.
   bool sim_top = false;
+  /// Clock period of the simulation top level in nanoseconds.
+  double sim_clock_period = 10.0;
+  /// Kernel clock period of the simulation top level in nanoseconds. 0 means the same as the bus clock period.
+  double sim_kernel_clock_period = 0.0;
+  /// Latency of the simulation memory models in cycles.
+  uint32_t sim_latency = 0;
+  /// Maximum number of bytes per cycle transferred by every simulation memory model. 0 means a bus word per cycle.
+  uint32_t sim_bandwidth = 0;
+  /// Maximum number of outstanding read requests of every simulation memory model.
+  uint32_t sim_max_outstanding = 1;
+  /// Whether the simulation top level is driven by a host application through the co-simulation bridge.
+  bool sim_cosim = false;
   /// Whether to generate static VHDL files (copied from hardware directory, embedded as resources).
   bool static_vhdl = false;
   /// Whether to backup any existing generated files.
   bool backup = false;
+  /// Regenerate all output, even if the inputs did not change since the last run.
+  bool force = false;
+  /// Maximum number of threads to generate output with. 0 uses the number of hardware threads.
+  size_t jobs = 0;
 
   /// Vivado HLS template. TODO(johanpel): not yet implemented.
   bool vivado_hls = false;
@@ -78,6 +158,9 @@ struct Options {
   /// Show version information.
   bool version = false;
 
+  /// The command line arguments, excluding the program name.
+  std::vector<std::string> arguments;
+
   /**
    * @brief Parse command line options and store the result
    * @param options A pointer to the Options object to parse into
@@ -93,6 +176,8 @@ struct Options {
   [[nodiscard]] bool MustGenerateDesign() const;
   /// @brief Return true if an SREC file must be generated.
   [[nodiscard]] bool MustGenerateSREC() const;
+  /// @brief Return true if a binary memory image must be generated.
+  [[nodiscard]] bool MustGenerateImage() const;
   /// @brief Return true if generation must take place for some target.
   [[nodiscard]] bool MustGenerate(const std::string &target) const;
 
@@ -0,0 +1,293 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/perf.h"
+
+#include <fletcher/common.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletchgen/basic_types.h"
+
+namespace fletchgen {
+
+namespace {
+
+/// Appends the streams of the buffers of a field.
+class StreamCollector {
+ public:
+  StreamCollector(std::string recordbatch, uint32_t channel, BusFunction function, std::vector<StreamEstimate> *out)
+      : recordbatch_(std::move(recordbatch)), channel_(channel), function_(function), out_(out) {}
+
+  /**
+   * @brief Append the streams of a field and its children.
+   * @param field   The field.
+   * @param name    The name of the field, including the names of its parents.
+   * @param rate    The number of elements of this field per cycle.
+   * @param epc     The value elements-per-cycle of the top-level field.
+   */
+  void Add(const arrow::Field &field, const std::string &name, double rate, uint32_t epc) {
+    const auto &type = *field.type();
+    if (field.nullable()) {
+      Append(name + ".validity", rate / 8.0);
+    }
+    switch (type.id()) {
+      case arrow::Type::STRING:
+      case arrow::Type::BINARY:
+      case arrow::Type::LARGE_STRING:
+      case arrow::Type::LARGE_BINARY:
+        Append(name + ".offsets", rate * IndexWidth(type) / 8.0);
+        Append(name + ".values", static_cast<double>(epc));
+        break;
+      case arrow::Type::LIST:
+      case arrow::Type::LARGE_LIST:
+        Append(name + ".offsets", rate * IndexWidth(type) / 8.0);
+        Add(*type.field(0), name + "." + type.field(0)->name(), epc, epc);
+        break;
+      case arrow::Type::STRUCT:
+        for (const auto &child : type.fields()) {
+          Add(*child, name + "." + child->name(), rate, epc);
+        }
+        break;
+      case arrow::Type::DICTIONARY: {
+        // The DictionaryReader takes at least two cycles per element, and only streams the indices from memory.
+        const auto &index_type = *static_cast<const arrow::DictionaryType &>(type).index_type();
+        Append(name + ".indices", 0.5 * GetFixedWidthTypeBitWidth(index_type) / 8.0);
+        break;
+      }
+      case arrow::Type::FIXED_SIZE_LIST:
+        // The values of a whole list are read as a single element.
+        Append(name + ".values", rate * GetFixedWidthTypeBitWidth(type) / 8.0);
+        break;
+      default:
+        if (dynamic_cast<const arrow::FixedWidthType *>(&type) != nullptr) {
+          Append(name + ".values", rate * GetFixedWidthTypeBitWidth(type) / 8.0);
+        }
+        break;
+    }
+  }
+
+  /// @brief Append the stream of the compressed values of a field, which the Lz4Reader reads a byte per cycle from.
+  void AddCompressed(const std::string &name) { Append(name + ".values", 1.0); }
+
+  /// @brief Append the stream of the data page of a field, which the ParquetPageReader reads a byte per cycle from.
+  void AddPage(const std::string &name) { Append(name + ".values", 1.0); }
+
+  /// @brief Append the streams of the runs of a field, of which the RunEndReader reads at most one per cycle.
+  void AddRunEnds(const arrow::Field &field) {
+    Append(field.name() + ".run_ends", 4.0);
+    Append(field.name() + ".values", GetFixedWidthTypeBitWidth(*field.type()) / 8.0);
+  }
+
+ private:
+  static uint32_t IndexWidth(const arrow::DataType &type) {
+    switch (type.id()) {
+      case arrow::Type::LARGE_STRING:
+      case arrow::Type::LARGE_BINARY:
+      case arrow::Type::LARGE_LIST: return 64;
+      default: return 32;
+    }
+  }
+
+  void Append(const std::string &name, double demand) {
+    StreamEstimate s;
+    s.recordbatch = recordbatch_;
+    s.name = name;
+    s.channel = channel_;
+    s.function = function_;
+    s.demand = demand;
+    out_->push_back(s);
+  }
+
+  std::string recordbatch_;
+  uint32_t channel_;
+  BusFunction function_;
+  std::vector<StreamEstimate> *out_;
+};
+
+/// @brief Append the streams of all buffers of a field, depending on the reader/writer it is accessed with.
+void AddField(const arrow::Field &field, StreamCollector *collector) {
+  if (!fletcher::GetMeta(field, fletcher::meta::COMPRESSION).empty()) {
+    collector->AddCompressed(field.name());
+    return;
+  }
+  if (fletcher::IsRunEndEncoded(field)) {
+    collector->AddRunEnds(field);
+    return;
+  }
+  if (fletcher::IsParquetEncoded(field)) {
+    collector->AddPage(field.name());
+    return;
+  }
+  auto epc = static_cast<uint32_t>(fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1));
+  auto lepc = static_cast<uint32_t>(fletcher::GetUIntMeta(field, fletcher::meta::LIST_EPC, 1));
+  switch (field.type()->id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: collector->Add(field, field.name(), lepc, epc);
+      break;
+    default: collector->Add(field, field.name(), epc, epc);
+      break;
+  }
+}
+
+/// @brief Return the memory interface channel of a field, which may be set on the field or on its schema.
+uint32_t GetBusChannel(const arrow::Schema &schema, const arrow::Field &field) {
+  auto channel = fletcher::GetMeta(field, fletcher::meta::BUS_CHANNEL);
+  if (channel.empty()) {
+    channel = fletcher::GetMeta(schema, fletcher::meta::BUS_CHANNEL);
+  }
+  if (channel.empty()) {
+    return 0;
+  }
+  return static_cast<uint32_t>(std::stoul(channel, nullptr, 10));
+}
+
+/// @brief Share the capacity of an arbiter fairly among its streams.
+void ShareFairly(double capacity, std::vector<StreamEstimate *> *streams) {
+  // Serve the streams with the lowest peak first. Every stream gets at most an equal share of what is left.
+  std::sort(streams->begin(), streams->end(), [](const StreamEstimate *a, const StreamEstimate *b) {
+    return a->peak < b->peak;
+  });
+  double left = capacity;
+  for (size_t i = 0; i < streams->size(); i++) {
+    auto *s = (*streams)[i];
+    s->achieved = std::min(s->peak, left / static_cast<double>(streams->size() - i));
+    left -= s->achieved;
+  }
+}
+
+}  // namespace
+
+std::optional<size_t> PerfReport::Bottleneck(const std::string &recordbatch) const {
+  std::optional<size_t> result;
+  for (size_t i = 0; i < streams.size(); i++) {
+    const auto &s = streams[i];
+    if (s.recordbatch != recordbatch) {
+      continue;
+    }
+    if (!result) {
+      result = i;
+      continue;
+    }
+    const auto &b = streams[*result];
+    if ((s.efficiency() < b.efficiency()) || ((s.efficiency() == b.efficiency()) && (s.peak > b.peak))) {
+      result = i;
+    }
+  }
+  return result;
+}
+
+std::string PerfReport::ToString() const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2);
+  ss << "# Fletchgen throughput estimation.\n";
+  ss << "# Bus: " << bus.ToString() << "\n";
+  ss << "# Steady-state estimate in bytes per cycle, with all streams active and no memory stalls.\n";
+  ss << "\n[streams]\n";
+  for (const auto &s : streams) {
+    ss << s.recordbatch << "." << s.name
+       << ": channel=" << s.channel
+       << ", " << (s.function == BusFunction::READ ? "read" : "write")
+       << ", peak=" << s.peak
+       << ", achieved=" << s.achieved
+       << " (" << 100.0 * s.efficiency() << "%)\n";
+  }
+  ss << "\n[arbiters]\n";
+  for (const auto &a : arbiters) {
+    ss << "channel " << a.channel << " " << (a.function == BusFunction::READ ? "read" : "write")
+       << ": streams=" << a.num_streams
+       << ", demand=" << a.demand
+       << ", capacity=" << a.capacity
+       << ", oversubscription=" << a.oversubscription() << "\n";
+  }
+  ss << "\n[bottlenecks]\n";
+  std::vector<std::string> recordbatches;
+  for (const auto &s : streams) {
+    if (std::find(recordbatches.begin(), recordbatches.end(), s.recordbatch) == recordbatches.end()) {
+      recordbatches.push_back(s.recordbatch);
+    }
+  }
+  for (const auto &rb : recordbatches) {
+    const auto &s = streams[*Bottleneck(rb)];
+    ss << rb << ": " << s.name << " (" << s.achieved << " of " << s.peak << ")\n";
+  }
+  return ss.str();
+}
+
+double GetFieldDemand(const arrow::Field &field) {
+  std::vector<StreamEstimate> streams;
+  StreamCollector collector("", 0, BusFunction::READ, &streams);
+  AddField(field, &collector);
+  double result = 0.0;
+  for (const auto &s : streams) {
+    result += s.demand;
+  }
+  return result;
+}
+
+PerfReport EstimatePerformance(const std::vector<std::shared_ptr<FletcherSchema>> &schemas, const BusDim &bus) {
+  PerfReport result;
+  result.bus = bus;
+  double bus_bytes = bus.dw / 8.0;
+
+  for (const auto &fs : schemas) {
+    auto function = fs->mode() == Mode::READ ? BusFunction::READ : BusFunction::WRITE;
+    const auto &schema = *fs->arrow_schema();
+    for (const auto &field : schema.fields()) {
+      if (fletcher::GetBoolMeta(*field, fletcher::meta::IGNORE, false)) {
+        continue;
+      }
+      StreamCollector collector(fs->name(), GetBusChannel(schema, *field), function, &result.streams);
+      AddField(*field, &collector);
+    }
+  }
+
+  // A buffer reader/writer never transfers more than a bus word per cycle.
+  for (auto &s : result.streams) {
+    s.peak = std::min(s.demand, bus_bytes);
+  }
+
+  // All streams of a channel and function share an arbiter tree.
+  std::map<std::pair<uint32_t, BusFunction>, std::vector<StreamEstimate *>> groups;
+  for (auto &s : result.streams) {
+    groups[{s.channel, s.function}].push_back(&s);
+  }
+  for (auto &g : groups) {
+    ArbiterEstimate a;
+    a.channel = g.first.first;
+    a.function = g.first.second;
+    a.num_streams = g.second.size();
+    a.capacity = bus_bytes;
+    for (const auto *s : g.second) {
+      a.demand += s->peak;
+    }
+    ShareFairly(a.capacity, &g.second);
+    result.arbiters.push_back(a);
+  }
+
+  return result;
+}
+
+}  // namespace fletchgen
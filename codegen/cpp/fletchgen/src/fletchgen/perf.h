@@ -0,0 +1,111 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fletchgen/bus.h"
+#include "fletchgen/schema.h"
+
+namespace fletchgen {
+
+/// @brief The estimated throughput of a single buffer reader/writer, i.e. a single bus master on an arbiter.
+struct StreamEstimate {
+  /// Name of the RecordBatch.
+  std::string recordbatch;
+  /// Name of the stream, e.g. "field.values".
+  std::string name;
+  /// Memory interface channel of the stream.
+  uint32_t channel = 0;
+  /// Whether the stream reads from or writes to memory.
+  BusFunction function = BusFunction::READ;
+  /// Bytes per cycle the ArrayReader/Writer can deliver or accept at most, given its elements-per-cycle.
+  double demand = 0.0;
+  /// Bytes per cycle the stream could transfer if it had the bus to itself.
+  double peak = 0.0;
+  /// Bytes per cycle the stream is expected to transfer when all streams on its arbiter are active.
+  double achieved = 0.0;
+  /// @brief Return the fraction of the peak throughput that is expected to be achieved.
+  [[nodiscard]] double efficiency() const { return peak > 0.0 ? achieved / peak : 1.0; }
+};
+
+/// @brief The estimated load of a bus arbiter tree, shared by all streams of a memory interface channel and function.
+struct ArbiterEstimate {
+  /// Memory interface channel of the arbiter.
+  uint32_t channel = 0;
+  /// Whether the arbiter reads from or writes to memory.
+  BusFunction function = BusFunction::READ;
+  /// Number of streams on the arbiter.
+  size_t num_streams = 0;
+  /// Sum of the peak throughput of all streams on the arbiter in bytes per cycle.
+  double demand = 0.0;
+  /// Bytes per cycle the master port of the arbiter can transfer.
+  double capacity = 0.0;
+  /// @brief Return the ratio of demand over capacity. Values above one mean the streams are throttled.
+  [[nodiscard]] double oversubscription() const { return capacity > 0.0 ? demand / capacity : 0.0; }
+};
+
+/// @brief A throughput estimation of every stream and arbiter in a design.
+struct PerfReport {
+  /// The dimensions of the bus.
+  BusDim bus;
+  /// All streams, in the order of the RecordBatches and their fields.
+  std::vector<StreamEstimate> streams;
+  /// All arbiters, ordered by channel and function.
+  std::vector<ArbiterEstimate> arbiters;
+  /**
+   * @brief Return the bottleneck stream of a RecordBatch.
+   *
+   * This is the stream that is throttled most by its arbiter, or the stream that uses the largest fraction of the bus
+   * data width if no stream is throttled.
+   *
+   * @param recordbatch The name of the RecordBatch.
+   * @return            The index of the stream in streams, or std::nullopt if the RecordBatch has no streams.
+   */
+  [[nodiscard]] std::optional<size_t> Bottleneck(const std::string &recordbatch) const;
+  /// @brief Return a human-readable report.
+  [[nodiscard]] std::string ToString() const;
+};
+
+/**
+ * @brief Return the bytes per cycle that the buffer readers/writers of a field demand together, given its EPC.
+ * @param field The field.
+ * @return      The sum of the demand of the streams of all buffers of the field.
+ */
+double GetFieldDemand(const arrow::Field &field);
+
+/**
+ * @brief Estimate the throughput of all streams of a set of RecordBatches.
+ *
+ * Every buffer of a field (validity bitmap, offsets, values) is read or written by its own buffer reader/writer, which
+ * transfers at most the number of bytes of its elements-per-cycle per cycle, and at most a bus word per cycle. The
+ * arbiters stream bursts back-to-back, so the master port of an arbiter delivers a bus word per cycle. When the
+ * streams of an arbiter demand more than that, round-robin arbitration of equally long bursts shares the bandwidth
+ * fairly: streams that demand less than an equal share get their demand, and the other streams share the rest.
+ *
+ * This is a steady-state estimate that assumes all streams are active and memory responds without stalls. It does not
+ * account for memory latency, the length of commands or the lengths of lists.
+ *
+ * @param schemas The Fletcher schemas of the RecordBatches.
+ * @param bus     The dimensions of the bus.
+ * @return        The estimation.
+ */
+PerfReport EstimatePerformance(const std::vector<std::shared_ptr<FletcherSchema>> &schemas, const BusDim &bus);
+
+}  // namespace fletchgen
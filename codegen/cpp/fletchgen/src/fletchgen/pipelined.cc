@@ -0,0 +1,505 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/pipelined.h"
+
+#include <cerata/api.h>
+#include <cerata/vhdl/vhdl.h>
+#include <fletcher/common.h>
+
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletchgen/array.h"
+#include "fletchgen/mmio.h"
+#include "fletchgen/recordbatch.h"
+#include "fletchgen/utils.h"
+
+namespace fletchgen {
+
+namespace {
+
+/// A stream at the kernel interface.
+struct PipeStream {
+  /// The name of the stream, i.e. the prefix of its flattened signals.
+  std::string name;
+  /// The flattened payload signals, in order of concatenation, and whether each is a vector.
+  std::vector<std::pair<std::string, bool>> payload;
+};
+
+/// The streams of a field at the kernel interface.
+struct PipeField {
+  /// The name of the schema of the field.
+  std::string schema;
+  /// The field.
+  std::shared_ptr<arrow::Field> field;
+  /// The mode of the schema of the field.
+  fletcher::Mode mode = fletcher::Mode::READ;
+  /// The Arrow data streams, of which the first one holds the last element of the command.
+  std::vector<PipeStream> data;
+  /// The command stream.
+  PipeStream cmd;
+  /// The unlock stream.
+  PipeStream unl;
+  /// For fields in read mode, the field in write mode the output of its pipeline stage goes to, or -1.
+  int sink = -1;
+  /// For fields in write mode, the field in read mode its streams come from, or -1.
+  int source = -1;
+  /// The index of the command and unlock of this field in the pending bits, or -1 if no command is issued.
+  int pending = -1;
+};
+
+/// The ports of a kernel involved in its pipelined template.
+struct PipePorts {
+  /// The fields, in order of their ports.
+  std::vector<PipeField> fields;
+  /// The indices of the fields in read mode.
+  std::vector<size_t> reads;
+  /// The number of fields to which a command is issued.
+  size_t num_pending = 0;
+  /// The other status registers, which are not driven by the template.
+  std::vector<const MmioPort *> status;
+};
+
+/// @brief Return the stream of an Arrow field of which the values are a single vector.
+PipeStream ValueStream(const std::string &name, const arrow::Field &field) {
+  PipeStream result{name, {{name + "_dvalid", false}, {name + "_last", false}}};
+  if (field.nullable()) {
+    result.payload.emplace_back(name + "_validity", false);
+  }
+  result.payload.emplace_back(name, true);
+  if (fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1) > 1) {
+    result.payload.emplace_back(name + "_count", true);
+  }
+  return result;
+}
+
+/// @brief Return the length and values streams of a list of primitives, see ListPrimType().
+std::vector<PipeStream> ListPrimStreams(const std::string &name, const std::string &values) {
+  auto v = name + "_" + values;
+  return {{name, {{name + "_dvalid", false}, {name + "_last", false}, {name + "_length", true},
+                  {name + "_count", true}}},
+          {v, {{v + "_dvalid", false}, {v + "_last", false}, {v, true}, {v + "_count", true}}}};
+}
+
+/// @brief Return the data streams of a field at the kernel interface. Exits if the field is not supported.
+std::vector<PipeStream> DataStreams(const std::string &name, const FieldPort &fp) {
+  const auto &field = *fp.field_;
+  if (fletcher::GetBoolMeta(field, fletcher::meta::GATHER, false)
+      || (fletcher::GetUIntMeta(field, fletcher::meta::ONCHIP, 0) > 0)) {
+    FLETCHER_LOG(FATAL, "The pipelined kernel template does not support gathered or on-chip fields, such as field "
+        << field.name() << " of schema " << fp.fletcher_schema_->name() << ".");
+  }
+  switch (field.type()->id()) {
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_BINARY: return ListPrimStreams(name, "bytes");
+    case arrow::Type::STRING:
+    case arrow::Type::LARGE_STRING: return ListPrimStreams(name, "chars");
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
+      auto child = field.type()->field(0);
+      if (GetConfigType(*child->type()) == ConfigType::PRIM) {
+        return ListPrimStreams(name, child->name());
+      }
+      break;
+    }
+    case arrow::Type::STRUCT: break;
+    default: return {ValueStream(name, field)};
+  }
+  FLETCHER_LOG(FATAL, "The pipelined kernel template does not support nested field " << field.name() << " of type "
+      << field.type()->ToString() << " of schema " << fp.fletcher_schema_->name() << ". Use the default template.");
+  return {};
+}
+
+/// @brief Return whether the streams of a field in read mode can be passed to a field in write mode as they are.
+bool Matches(const arrow::Field &read, const arrow::Field &write) {
+  return (read.name() == write.name()) && read.type()->Equals(write.type()) && (read.nullable() == write.nullable())
+      && (fletcher::GetUIntMeta(read, fletcher::meta::VALUE_EPC, 1)
+          == fletcher::GetUIntMeta(write, fletcher::meta::VALUE_EPC, 1))
+      && (fletcher::GetUIntMeta(read, fletcher::meta::LIST_EPC, 1)
+          == fletcher::GetUIntMeta(write, fletcher::meta::LIST_EPC, 1));
+}
+
+/// @brief Resolve the ports of a kernel involved in its pipelined template. Exits if a port is not supported.
+PipePorts Resolve(const Kernel &kernel) {
+  PipePorts result;
+  std::map<std::pair<std::string, std::string>, std::string> cmds, unls;
+  for (const auto &node : kernel.GetNodes()) {
+    if ((node->name() == "result_bus") || (node->name() == "ext")) {
+      FLETCHER_LOG(FATAL, "The pipelined kernel template does not support the result scratchpad or external I/O.");
+    }
+    auto mp = dynamic_cast<const MmioPort *>(node);
+    if (mp != nullptr) {
+      if ((mp->dir() == Port::Dir::OUT) && (mp->reg.function != MmioFunction::DEFAULT)) {
+        result.status.push_back(mp);
+      }
+      continue;
+    }
+    auto fp = dynamic_cast<const FieldPort *>(node);
+    if (fp == nullptr) {
+      continue;
+    }
+    auto key = std::make_pair(fp->fletcher_schema_->name(), fp->field_->name());
+    switch (fp->function_) {
+      case FieldPort::Function::ARROW: {
+        PipeField f;
+        f.schema = fp->fletcher_schema_->name();
+        f.field = fp->field_;
+        f.mode = fp->fletcher_schema_->mode();
+        f.data = DataStreams(fp->name(), *fp);
+        result.fields.push_back(f);
+        break;
+      }
+      case FieldPort::Function::COMMAND: cmds[key] = fp->name();
+        break;
+      case FieldPort::Function::UNLOCK: unls[key] = fp->name();
+        break;
+      default: break;
+    }
+  }
+
+  for (size_t i = 0; i < result.fields.size(); i++) {
+    auto &f = result.fields[i];
+    auto key = std::make_pair(f.schema, f.field->name());
+    auto c = cmds.at(key);
+    auto u = unls.at(key);
+    f.cmd = {c, {{c + "_firstIdx", true}, {c + "_lastIdx", true}, {c + "_tag", true}}};
+    f.unl = {u, {{u + "_tag", true}}};
+    if (f.mode == fletcher::Mode::READ) {
+      result.reads.push_back(i);
+    }
+  }
+
+  // Pass every field in read mode to the first unused field in write mode with the same name and type.
+  for (auto r : result.reads) {
+    for (auto &w : result.fields) {
+      if ((w.mode == fletcher::Mode::WRITE) && (w.source < 0) && Matches(*result.fields[r].field, *w.field)) {
+        w.source = static_cast<int>(r);
+        result.fields[r].sink = static_cast<int>(&w - &result.fields[0]);
+        break;
+      }
+    }
+  }
+  for (auto &f : result.fields) {
+    if ((f.mode == fletcher::Mode::READ) || (f.source >= 0)) {
+      f.pending = static_cast<int>(result.num_pending++);
+    }
+  }
+  return result;
+}
+
+/// @brief Return the VHDL expression of the width of the payload of a stream.
+std::string Width(const PipeStream &s) {
+  std::vector<std::string> terms;
+  int bits = 0;
+  for (const auto &p : s.payload) {
+    if (p.second) {
+      terms.push_back(p.first + "'length");
+    } else {
+      bits++;
+    }
+  }
+  if (bits > 0) {
+    terms.insert(terms.begin(), std::to_string(bits));
+  }
+  std::stringstream ss;
+  for (size_t i = 0; i < terms.size(); i++) {
+    ss << (i > 0 ? " + " : "") << terms[i];
+  }
+  return ss.str();
+}
+
+/// @brief Return the VHDL statements assigning the payload signals of a stream from a concatenated vector.
+std::string Split(const PipeStream &s, const std::string &vec) {
+  std::stringstream ss;
+  int bits = 0;
+  std::vector<std::string> terms;
+  // The first signal of the payload is in the most significant bits.
+  for (auto p = s.payload.rbegin(); p != s.payload.rend(); ++p) {
+    std::stringstream o;
+    o << bits;
+    for (const auto &t : terms) {
+      o << " + " << t;
+    }
+    auto offset = o.str();
+    if (p->second) {
+      ss << "  " << p->first << " <= " << vec << "(" << offset << " + " << p->first << "'length - 1 downto " << offset
+         << ");\n";
+      terms.push_back(p->first + "'length");
+    } else {
+      ss << "  " << p->first << " <= " << vec << "(" << offset << ");\n";
+      bits++;
+    }
+  }
+  return ss.str();
+}
+
+/// @brief Return the VHDL expression concatenating the payload signals of a stream.
+std::string Concat(const PipeStream &s) {
+  std::stringstream ss;
+  for (size_t i = 0; i < s.payload.size(); i++) {
+    ss << (i > 0 ? " & " : "") << s.payload[i].first;
+  }
+  return ss.str();
+}
+
+/// @brief Return the VHDL declarations of the kernel-side signals of a stream and its register slice.
+std::string Declare(const PipeStream &s) {
+  std::stringstream ss;
+  ss << "  constant " << s.name << "_W : natural := " << Width(s) << ";\n"
+     << "  signal " << s.name << "_k_valid : std_logic;\n"
+     << "  signal " << s.name << "_k_ready : std_logic;\n"
+     << "  signal " << s.name << "_k_data  : std_logic_vector(" << s.name << "_W-1 downto 0);\n"
+     << "  signal " << s.name << "_p_data  : std_logic_vector(" << s.name << "_W-1 downto 0);\n";
+  return ss.str();
+}
+
+/// @brief Return the VHDL instance of the register slice of a stream, between its ports and its kernel-side signals.
+std::string Slice(const PipeStream &s, bool in) {
+  auto port = [&](const std::string &sig) { return s.name + "_" + sig; };
+  auto kern = [&](const std::string &sig) { return s.name + "_k_" + sig; };
+  std::stringstream ss;
+  if (in) {
+    ss << "  " << s.name << "_p_data <= " << Concat(s) << ";\n\n";
+  }
+  ss << "  " << s.name << "_slice: StreamSlice\n"
+        "    generic map (\n"
+        "      DATA_WIDTH => " << s.name << "_W\n"
+        "    )\n"
+        "    port map (\n"
+        "      clk       => kcd_clk,\n"
+        "      reset     => kcd_reset,\n"
+        "      in_valid  => " << (in ? port("valid") : kern("valid")) << ",\n"
+        "      in_ready  => " << (in ? port("ready") : kern("ready")) << ",\n"
+        "      in_data   => " << (in ? port("p_data") : kern("data")) << ",\n"
+        "      out_valid => " << (in ? kern("valid") : port("valid")) << ",\n"
+        "      out_ready => " << (in ? kern("ready") : port("ready")) << ",\n"
+        "      out_data  => " << (in ? kern("data") : port("p_data")) << "\n"
+        "    );\n\n";
+  if (!in) {
+    ss << Split(s, s.name + "_p_data") << "\n";
+  }
+  return ss.str();
+}
+
+}  // namespace
+
+void PipelineKernel(Kernel *kernel) {
+  // Exit early if the design has ports the template does not support.
+  Resolve(*kernel);
+  // The template is generated by GeneratePipelinedKernelVHDL.
+  kernel->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  kernel->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  kernel->SetMeta(cerata::vhdl::meta::PACKAGE, kernel->name() + "_pkg");
+}
+
+std::string GeneratePipelinedKernelVHDL(const Kernel &kernel) {
+  auto ports = Resolve(kernel);
+  const auto &fields = ports.fields;
+  auto np = ports.num_pending;
+  auto nr = ports.reads.size();
+
+  std::stringstream ss;
+  ss << DEFAULT_NOTICE;
+  ss << "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n"
+        "package " << kernel.name() << "_pkg is\n";
+  ss << cerata::vhdl::Decl::Generate(kernel, false, 1).ToString();
+  ss << "end package;\n"
+        "\n"
+        "library ieee;\n"
+        "use ieee.std_logic_1164.all;\n"
+        "use ieee.numeric_std.all;\n"
+        "\n"
+        "library work;\n"
+        "use work.Stream_pkg.all;\n"
+        "\n";
+  ss << cerata::vhdl::Decl::Generate(kernel, true).ToString();
+  ss << "\n"
+        "-- Pipelined kernel template. Every stream at the kernel interface passes through a register slice, such that\n"
+        "-- the datapath has no combinational paths to the ports of the kernel. Insert the datapath in the pipeline\n"
+        "-- stages of the fields in read mode, and keep their handshakes registered to close timing.\n"
+        "architecture Implementation of " << kernel.name() << " is\n"
+        "  type state_t is (STATE_IDLE, STATE_STREAM, STATE_DONE);\n"
+        "  signal state        : state_t;\n";
+  if (np > 0) {
+    ss << "  -- Fields of which the command was not yet accepted.\n"
+          "  signal cmd_pending  : std_logic_vector(" << np - 1 << " downto 0);\n"
+          "  -- Fields of which the unlock was not yet received.\n"
+          "  signal unl_pending  : std_logic_vector(" << np - 1 << " downto 0);\n";
+  }
+  if (nr > 0) {
+    ss << "  -- Fields in read mode of which the last element did not yet leave the pipeline stage.\n"
+          "  signal last_pending : std_logic_vector(" << nr - 1 << " downto 0);\n";
+  }
+  ss << "\n";
+  for (const auto &f : fields) {
+    ss << "  -- " << f.schema << "." << f.field->name() << "\n";
+    for (const auto &s : f.data) {
+      ss << Declare(s);
+      if (f.mode == fletcher::Mode::READ) {
+        ss << "  signal " << s.name << "_stg_valid : std_logic;\n"
+           << "  signal " << s.name << "_stg_ready : std_logic;\n"
+           << "  signal " << s.name << "_stg_data  : std_logic_vector(" << s.name << "_W-1 downto 0);\n";
+      }
+    }
+    ss << Declare(f.cmd) << Declare(f.unl);
+  }
+  ss << "begin\n"
+        "\n";
+
+  // Register slices of all streams.
+  for (const auto &f : fields) {
+    for (const auto &s : f.data) {
+      ss << Slice(s, f.mode == fletcher::Mode::READ);
+    }
+    ss << Slice(f.cmd, false) << Slice(f.unl, true);
+  }
+
+  // Commands and unlocks.
+  for (const auto &f : fields) {
+    const auto &c = f.cmd.name;
+    if (f.pending >= 0) {
+      ss << "  " << c << "_k_valid <= cmd_pending(" << f.pending << ");\n"
+         << "  " << c << "_k_data  <= " << f.schema << "_firstidx & " << f.schema << "_lastidx & std_logic_vector'("
+         << c << "_tag'range => '0');\n";
+    } else {
+      ss << "  " << c << "_k_valid <= '0';\n"
+         << "  " << c << "_k_data  <= (others => '0');\n";
+    }
+    ss << "  " << f.unl.name << "_k_ready <= '1';\n";
+  }
+  ss << "\n";
+
+  // Pipeline stages of the fields in read mode, which pass their output on or consume it.
+  for (const auto &f : fields) {
+    if (f.mode == fletcher::Mode::READ) {
+      for (size_t i = 0; i < f.data.size(); i++) {
+        const auto &s = f.data[i].name;
+        if (f.sink >= 0) {
+          const auto &w = fields[f.sink].data[i].name;
+          ss << "  " << w << "_k_valid <= " << s << "_stg_valid;\n"
+             << "  " << w << "_k_data  <= " << s << "_stg_data;\n"
+             << "  " << s << "_stg_ready <= " << w << "_k_ready;\n";
+        } else {
+          ss << "  " << s << "_stg_ready <= '1';\n";
+        }
+        ss << "  " << s << "_k_ready <= not " << s << "_stg_valid or " << s << "_stg_ready;\n";
+      }
+    } else if (f.source < 0) {
+      for (const auto &s : f.data) {
+        ss << "  " << s.name << "_k_valid <= '0';\n"
+           << "  " << s.name << "_k_data  <= (others => '0');\n";
+      }
+    }
+  }
+  ss << "\n";
+
+  for (const auto &mp : ports.status) {
+    ss << "  " << mp->name() << " <= " << (mp->reg.width == 1 ? "'0'" : "(others => '0')") << ";\n";
+  }
+  if (!ports.status.empty()) {
+    ss << "\n";
+  }
+  ss << "  result <= (others => '0');\n"
+        "  idle   <= '1' when (state = STATE_IDLE) or (state = STATE_DONE) else '0';\n"
+        "  busy   <= '1' when state = STATE_STREAM else '0';\n"
+        "  done   <= '1' when state = STATE_DONE else '0';\n"
+        "\n";
+
+  ss << "  seq_proc: process (kcd_clk) is\n"
+        "  begin\n"
+        "    if rising_edge(kcd_clk) then\n";
+  for (size_t r = 0; r < nr; r++) {
+    const auto &f = fields[ports.reads[r]];
+    ss << "      -- Pipeline stage of " << f.schema << "." << f.field->name()
+       << ". Replace the pass-through by the datapath.\n";
+    for (const auto &s : f.data) {
+      ss << "      if " << s.name << "_k_ready = '1' then\n"
+            "        " << s.name << "_stg_valid <= " << s.name << "_k_valid;\n"
+            "        " << s.name << "_stg_data  <= " << s.name << "_k_data;\n"
+            "      end if;\n";
+    }
+    const auto &first = f.data[0].name;
+    ss << "      if (" << first << "_stg_valid = '1') and (" << first << "_stg_ready = '1') and (" << first
+       << "_stg_data(" << first << "_W-2) = '1') then\n"
+          "        last_pending(" << r << ") <= '0';\n"
+          "      end if;\n"
+          "\n";
+  }
+  for (const auto &f : fields) {
+    if (f.pending >= 0) {
+      ss << "      if " << f.cmd.name << "_k_ready = '1' then\n"
+            "        cmd_pending(" << f.pending << ") <= '0';\n"
+            "      end if;\n"
+            "      if " << f.unl.name << "_k_valid = '1' then\n"
+            "        unl_pending(" << f.pending << ") <= '0';\n"
+            "      end if;\n";
+    }
+  }
+  if (np > 0) {
+    ss << "\n";
+  }
+
+  std::string finished = "true";
+  if (nr > 0) {
+    finished = "(unsigned(last_pending) = 0) and (unsigned(unl_pending) = 0)";
+  }
+  ss << "      case state is\n"
+        "        when STATE_IDLE =>\n"
+        "          if start = '1' then\n";
+  if (np > 0) {
+    ss << "            cmd_pending  <= (others => '1');\n"
+          "            unl_pending  <= (others => '1');\n"
+          "            last_pending <= (others => '1');\n";
+  }
+  ss << "            state        <= STATE_STREAM;\n"
+        "          end if;\n"
+        "\n"
+        "        when STATE_STREAM =>\n"
+        "          if " << finished << " then\n"
+        "            state <= STATE_DONE;\n"
+        "          end if;\n"
+        "\n"
+        "        when STATE_DONE =>\n"
+        "          null;\n"
+        "      end case;\n"
+        "\n"
+        "      if (kcd_reset = '1') or (reset = '1') then\n"
+        "        state        <= STATE_IDLE;\n";
+  if (np > 0) {
+    ss << "        cmd_pending  <= (others => '0');\n"
+          "        unl_pending  <= (others => '0');\n"
+          "        last_pending <= (others => '0');\n";
+  }
+  for (auto r : ports.reads) {
+    for (const auto &s : fields[r].data) {
+      ss << "        " << s.name << "_stg_valid <= '0';\n";
+    }
+  }
+  ss << "      end if;\n"
+        "    end if;\n"
+        "  end process;\n"
+        "\n"
+        "end architecture;\n";
+  return ss.str();
+}
+
+}  // namespace fletchgen
@@ -0,0 +1,49 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+
+#include "fletchgen/kernel.h"
+
+namespace fletchgen {
+
+/**
+ * @brief Let Fletchgen generate a pipelined template of a kernel, instead of a template with an empty architecture.
+ *
+ * The kernel becomes a primitive component with its own VHDL source, see GeneratePipelinedKernelVHDL(). Exits if the
+ * design has ports the pipelined template does not support.
+ *
+ * @param kernel The kernel.
+ */
+void PipelineKernel(Kernel *kernel);
+
+/**
+ * @brief Return the VHDL source of the package and the pipelined template of a kernel.
+ *
+ * Every Arrow data, command and unlock stream of the kernel passes through a register slice, such that no
+ * combinational path runs from the ports of the kernel to its datapath, and the ready signals of the datapath are
+ * registered at the ports. Upon start, the template issues a command for the range of its RecordBatch to every field
+ * in read mode. Every stream of these fields passes through a pipeline stage, which is where the datapath of the user
+ * goes. The stage passes its output to the stream of a field in write mode with the same name and type, to which a
+ * command is then also issued, or otherwise consumes it. The kernel is done when the last element of every field in
+ * read mode passed its stage, and all commands were unlocked.
+ *
+ * @param kernel The kernel, of which the ports are derived from the design.
+ * @return The VHDL source.
+ */
+std::string GeneratePipelinedKernelVHDL(const Kernel &kernel);
+
+}  // namespace fletchgen
@@ -0,0 +1,157 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletchgen/platform.h"
+
+#include <fletcher/common.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+namespace fletchgen {
+
+/// The built-in platform profiles. Maximum bursts are 4 KiB, the largest burst that AXI4 allows.
+static const std::unordered_map<std::string, std::string> kBuiltinProfiles = {
+    {"aws",
+     "# AWS EC2 F1. Buffers are copied to the on-board DDR4 memory, which the kernel accesses through the 512-bit\n"
+     "# AXI4 interface of the shell.\n"
+     "name aws\n"
+     "bus_specs 64,512,8,1,64\n"
+     "mmio64 0\n"
+     "mmio_offset 0\n"
+     "kernel_clock_hz 250000000\n"
+     "buffer_alignment 64\n"
+     "mem_type cache\n"
+     "spin_usec 50\n"
+     "poll_interval_usec 100\n"},
+    {"snap",
+     "# CAPI SNAP. The kernel accesses host memory coherently through the 512-bit AXI4 interface of the action.\n"
+     "name snap\n"
+     "bus_specs 64,512,8,1,64\n"
+     "mmio64 0\n"
+     "mmio_offset 0\n"
+     "kernel_clock_hz 250000000\n"
+     "buffer_alignment 64\n"
+     "mem_type any\n"
+     "spin_usec 50\n"
+     "poll_interval_usec 100\n"},
+    {"ocaccel",
+     "# OpenCAPI OC-Accel. The kernel accesses host memory coherently through the 1024-bit AXI4 interface of the\n"
+     "# action.\n"
+     "name ocaccel\n"
+     "bus_specs 64,1024,8,1,32\n"
+     "mmio64 0\n"
+     "mmio_offset 0\n"
+     "kernel_clock_hz 200000000\n"
+     "buffer_alignment 128\n"
+     "mem_type any\n"
+     "spin_usec 50\n"
+     "poll_interval_usec 100\n"},
+    {"alveo",
+     "# Xilinx Alveo with XRT. Buffers are copied to on-board memory, which the kernel accesses through a 512-bit\n"
+     "# AXI4 interface. XRT transfers host buffers aligned to 4 KiB without copying them.\n"
+     "name alveo\n"
+     "bus_specs 64,512,8,1,64\n"
+     "mmio64 0\n"
+     "mmio_offset 0\n"
+     "kernel_clock_hz 300000000\n"
+     "buffer_alignment 4096\n"
+     "mem_type cache\n"
+     "spin_usec 50\n"
+     "poll_interval_usec 100\n"},
+};
+
+std::string PlatformProfile::ToString() const {
+  std::stringstream ss;
+  ss << "# Fletchgen platform profile.\n"
+        "# key value\n";
+  ss << "name " << name << "\n";
+  ss << "bus_specs " << bus_specs << "\n";
+  ss << "mmio64 " << (mmio64 ? 1 : 0) << "\n";
+  ss << "mmio_offset " << mmio_offset << "\n";
+  ss << "kernel_clock_hz " << kernel_clock_hz << "\n";
+  ss << "buffer_alignment " << buffer_alignment << "\n";
+  ss << "mem_type " << mem_type << "\n";
+  ss << "spin_usec " << spin_usec << "\n";
+  ss << "poll_interval_usec " << poll_interval_usec << "\n";
+  return ss.str();
+}
+
+bool ParsePlatformProfile(std::istream *in, PlatformProfile *out) {
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(*in, line)) {
+    line_number++;
+    std::istringstream fields(line);
+    std::string key;
+    std::string value;
+    if (!(fields >> key) || (key[0] == '#')) {
+      continue;
+    }
+    if (!(fields >> value)) {
+      FLETCHER_LOG(WARNING, "Platform profile line " << line_number << ": key " << key << " has no value.");
+      return false;
+    }
+    try {
+      if (key == "name") {
+        out->name = value;
+      } else if (key == "bus_specs") {
+        out->bus_specs = value;
+      } else if (key == "mmio64") {
+        out->mmio64 = std::stoul(value) != 0;
+      } else if (key == "mmio_offset") {
+        out->mmio_offset = std::stoul(value, nullptr, 0);
+      } else if (key == "kernel_clock_hz") {
+        out->kernel_clock_hz = static_cast<uint32_t>(std::stoul(value));
+      } else if (key == "buffer_alignment") {
+        out->buffer_alignment = std::stoll(value);
+      } else if (key == "mem_type") {
+        if ((value != "any") && (value != "cache")) {
+          FLETCHER_LOG(WARNING, "Platform profile line " << line_number << ": mem_type must be any or cache.");
+          return false;
+        }
+        out->mem_type = value;
+      } else if (key == "spin_usec") {
+        out->spin_usec = static_cast<uint32_t>(std::stoul(value));
+      } else if (key == "poll_interval_usec") {
+        out->poll_interval_usec = static_cast<uint32_t>(std::stoul(value));
+      } else {
+        FLETCHER_LOG(WARNING, "Platform profile line " << line_number << ": unknown key " << key << ".");
+        return false;
+      }
+    } catch (const std::exception &e) {
+      FLETCHER_LOG(WARNING, "Platform profile line " << line_number << ": invalid value " << value << " of key " << key
+                                                     << ".");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadPlatformProfile(const std::string &name_or_path, PlatformProfile *out) {
+  auto builtin = kBuiltinProfiles.find(name_or_path);
+  if (builtin != kBuiltinProfiles.end()) {
+    std::istringstream in(builtin->second);
+    return ParsePlatformProfile(&in, out);
+  }
+  std::ifstream in(name_or_path);
+  if (!in.good()) {
+    FLETCHER_LOG(WARNING, "Platform " << name_or_path << " is neither a built-in platform profile nor a profile file.");
+    return false;
+  }
+  return ParsePlatformProfile(&in, out);
+}
+
+}  // namespace fletchgen
@@ -0,0 +1,76 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+namespace fletchgen {
+
+/**
+ * @brief The defaults of a target platform, e.g. AWS EC2 F1.
+ *
+ * A profile is a text file of "<key> <value>" lines, of which lines starting with # are comments. It holds the bus
+ * and MMIO dimensions and the kernel clock of the target, which Fletchgen uses as defaults of its options, and hints
+ * for the run-time, which Fletchgen passes on through fletchgen.platform.profile in its output directory.
+ */
+struct PlatformProfile {
+  /// The name of the platform.
+  std::string name;
+  /// Bus dimensions, in the format of --bus_specs.
+  std::string bus_specs = "64,512,8,1,16";
+  /// Whether the AXI4-lite MMIO data bus is 64 bits wide instead of 32 bits.
+  bool mmio64 = false;
+  /// AXI4-lite offset address of the Fletcher registers.
+  size_t mmio_offset = 0;
+  /// Kernel clock frequency in Hz. 0 means unknown.
+  uint32_t kernel_clock_hz = 0;
+
+  /// Run-time hint: alignment of the device addresses of buffers in bytes, see Context::SetBufferAlignment(). 0 means
+  /// no alignment.
+  int64_t buffer_alignment = 0;
+  /// Run-time hint: the memory type that MemType::ANY resolves to, either "any" or "cache".
+  std::string mem_type = "any";
+  /// Run-time hint: the window in which to poll a kernel at maximum speed, in microseconds.
+  uint32_t spin_usec = 50;
+  /// Run-time hint: the poll interval after the spin window, in microseconds.
+  uint32_t poll_interval_usec = 100;
+
+  /// @brief Return the profile in the file format.
+  [[nodiscard]] std::string ToString() const;
+};
+
+/**
+ * @brief Parse a platform profile.
+ * @param[in]  in   The stream to parse.
+ * @param[out] out  The profile, of which keys that are not in the stream keep their value.
+ * @return True if successful, false otherwise.
+ */
+bool ParsePlatformProfile(std::istream *in, PlatformProfile *out);
+
+/**
+ * @brief Load a built-in platform profile by name, or a platform profile file.
+ *
+ * Built-in profiles are "aws" (AWS EC2 F1), "snap" (CAPI SNAP), "ocaccel" (OpenCAPI OC-Accel) and "alveo" (Xilinx
+ * Alveo with XRT).
+ *
+ * @param[in]  name_or_path The name of a built-in profile, or the path of a profile file.
+ * @param[out] out          The profile.
+ * @return True if successful, false otherwise.
+ */
+bool LoadPlatformProfile(const std::string &name_or_path, PlatformProfile *out);
+
+}  // namespace fletchgen
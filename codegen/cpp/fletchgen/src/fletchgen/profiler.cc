@@ -18,10 +18,12 @@
 #include <cerata/vhdl/vhdl.h>
 #include <cmath>
 #include <memory>
+#include <string>
 #include <vector>
 #include <tuple>
 
 #include "fletchgen/basic_types.h"
+#include "fletchgen/bus.h"
 #include "fletchgen/nucleus.h"
 
 namespace fletchgen {
@@ -36,8 +38,6 @@ using cerata::field;
 using cerata::integer;
 using cerata::bit;
 
-static constexpr uint32_t COUNT_WIDTH = 32;
-
 // Vhdmmio documentation strings for profiling:
 namespace doc {
 static constexpr char e[] = "Element count. Accumulates the number of elements transferred on the stream. "
@@ -63,7 +63,45 @@ static constexpr char p[] = "packets";
 static constexpr char c[] = "cycles";
 }  // namespace name
 
-std::vector<MmioReg> GetProfilingRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches) {
+/// @brief Return <prefix>_<flat name>_<stream index> for every stream in the type of a node.
+static std::vector<std::string> StreamRegPrefixes(const cerata::Node &node, const std::string &prefix) {
+  std::vector<std::string> result;
+  auto flattened = cerata::Flatten(node.type());
+  for (auto &fti : flattened) {
+    if (dynamic_cast<cerata::Stream *>(fti.type_) != nullptr) {
+      result.push_back(prefix + "_" + fti.name(cerata::NamePart(node.name())) + "_" + std::to_string(result.size()));
+    }
+  }
+  return result;
+}
+
+std::vector<std::string> ProfileRegPrefixes(const cerata::Node &node) {
+  // Counter registers of the si-th stream are named Profile_<flat name>_<si>_<counter>.
+  return StreamRegPrefixes(node, "Profile");
+}
+
+std::vector<std::string> ProfileCounterNames() {
+  return {name::e, name::v, name::r, name::t, name::p, name::c};
+}
+
+/// @brief Append the counter registers of every stream of a profiled node to a vector of registers.
+static void AppendCounterRegs(const cerata::Node &node, uint32_t count_width, std::vector<MmioReg> *regs) {
+  using MF = MmioFunction;
+  using MB = MmioBehavior;
+  for (const auto &pre : ProfileRegPrefixes(node)) {
+    MmioReg e(MF::PROFILE, MB::STATUS, pre + "_" + name::e, doc::e, count_width);
+    MmioReg v(MF::PROFILE, MB::STATUS, pre + "_" + name::v, doc::v, count_width);
+    MmioReg r(MF::PROFILE, MB::STATUS, pre + "_" + name::r, doc::r, count_width);
+    MmioReg t(MF::PROFILE, MB::STATUS, pre + "_" + name::t, doc::t, count_width);
+    MmioReg p(MF::PROFILE, MB::STATUS, pre + "_" + name::p, doc::p, count_width);
+    MmioReg c(MF::PROFILE, MB::STATUS, pre + "_" + name::c, doc::c, count_width);
+    regs->insert(regs->end(), {e, v, r, t, p, c});
+  }
+}
+
+std::vector<MmioReg> GetProfilingRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
+                                      uint32_t count_width,
+                                      bool profile_bus) {
   std::vector<MmioReg> profile_regs;
   using MF = MmioFunction;
   using MB = MmioBehavior;
@@ -80,26 +118,30 @@ std::vector<MmioReg> GetProfilingRegs(const std::vector<std::shared_ptr<RecordBa
                             "Resets profiler counters when this bit is asserted.",
                             1);
 
+  profile_regs.emplace_back(MF::PROFILE,
+                            MB::STROBE,
+                            "Profile_snapshot",
+                            "Copies all profiler counters to the count registers at once when this bit is asserted.",
+                            1);
+
   for (const auto &rb : recordbatches) {
     auto fps = rb->GetFieldPorts();
     for (const auto &fp : fps) {
       // Check if we should profile the field-derived port node.
       if (fp->profile_) {
-        auto flattened = cerata::Flatten(fp->type());
-        int si = 0;  // stream index
-        for (auto &fti : flattened) {
-          if (dynamic_cast<cerata::Stream *>(fti.type_) != nullptr) {
-            const auto pre = "Profile_" + fti.name(cerata::NamePart(fp->name()));  // prefix
-            const auto sis = "_" + std::to_string(si) + "_";  // stream index string
-            MmioReg e(MF::PROFILE, MB::STATUS, pre + sis + name::e, doc::e, COUNT_WIDTH);
-            MmioReg v(MF::PROFILE, MB::STATUS, pre + sis + name::v, doc::v, COUNT_WIDTH);
-            MmioReg r(MF::PROFILE, MB::STATUS, pre + sis + name::r, doc::r, COUNT_WIDTH);
-            MmioReg t(MF::PROFILE, MB::STATUS, pre + sis + name::t, doc::t, COUNT_WIDTH);
-            MmioReg p(MF::PROFILE, MB::STATUS, pre + sis + name::p, doc::p, COUNT_WIDTH);
-            MmioReg c(MF::PROFILE, MB::STATUS, pre + sis + name::c, doc::c, COUNT_WIDTH);
-            profile_regs.insert(profile_regs.end(), {e, v, r, t, p, c});
-            si++;
-          }
+        AppendCounterRegs(*fp, count_width, &profile_regs);
+      }
+    }
+  }
+
+  if (profile_bus) {
+    // Profile every stream of the bus ports through which the RecordBatches access memory.
+    for (const auto &rb : recordbatches) {
+      for (const auto &bp : rb->GetAll<BusPort>()) {
+        auto first_bus_reg = profile_regs.size();
+        AppendCounterRegs(*bp, count_width, &profile_regs);
+        for (size_t i = first_bus_reg; i < profile_regs.size(); i++) {
+          profile_regs[i].meta[MMIO_PROFILE_BUS] = "true";
         }
       }
     }
@@ -107,6 +149,77 @@ std::vector<MmioReg> GetProfilingRegs(const std::vector<std::shared_ptr<RecordBa
   return profile_regs;
 }
 
+std::vector<MmioReg> GetBusTraceRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches, uint32_t depth) {
+  using MF = MmioFunction;
+  using MB = MmioBehavior;
+  uint32_t depth_log2 = 0;
+  while ((1u << depth_log2) < depth) {
+    depth_log2++;
+  }
+  uint32_t ring_depth = 1u << depth_log2;
+
+  std::vector<MmioReg> result;
+  result.emplace_back(MF::TRACE, MB::CONSTANT, "Trace_depth", "Number of entries of the trace ring.", 32, 0,
+                      std::nullopt, ring_depth);
+  result.emplace_back(MF::TRACE, MB::CONTROL, "Trace_enable", "Records bus requests when this bit is high.", 1);
+  result.emplace_back(MF::TRACE, MB::STROBE, "Trace_clear", "Clears the trace when this bit is asserted.", 1);
+  result.emplace_back(MF::TRACE, MB::CONTROL, "Trace_index",
+                      "Index of the entry of the trace ring shown by the entry registers.", 32);
+  result.back().meta[MMIO_TRACE_DEPTH_LOG2] = std::to_string(depth_log2);
+  result.emplace_back(MF::TRACE, MB::STATUS, "Trace_count",
+                      "Number of requests recorded since the trace was cleared. The n-th request is held at index n "
+                      "modulo the depth, until it is overwritten.", 32);
+  result.emplace_back(MF::TRACE, MB::STATUS, "Trace_dropped",
+                      "Number of requests not recorded, because a port with a lower index was recorded in the same "
+                      "cycle.", 32);
+  result.emplace_back(MF::TRACE, MB::STATUS, "Trace_cycle", "Cycle of the entry, relative to the last clear.", 32);
+  result.emplace_back(MF::TRACE, MB::STATUS, "Trace_port", "Index of the bus port of the entry.", 32);
+  result.emplace_back(MF::TRACE, MB::STATUS, "Trace_addr", "Address of the request of the entry.", 64);
+  result.emplace_back(MF::TRACE, MB::STATUS, "Trace_len", "Burst length of the request of the entry.", 32);
+
+  // Name the traced bus ports, in the order in which the Mantle connects them to the BusTracer.
+  for (const auto &rb : recordbatches) {
+    for (const auto &bp : rb->GetAll<BusPort>()) {
+      result.emplace_back(MF::TRACE, MB::CONSTANT, "Trace_port_" + bp->name(),
+                          "Whether this traced bus port is a write port.", 1, 0, std::nullopt,
+                          bp->spec_.func == BusFunction::WRITE ? 1 : 0);
+    }
+  }
+  return result;
+}
+
+std::vector<MmioReg> GetOutputCountRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
+                                        uint32_t count_width) {
+  std::vector<MmioReg> result;
+  for (const auto &rb : recordbatches) {
+    if (rb->mode() != fletcher::Mode::WRITE) {
+      continue;
+    }
+    for (const auto &fp : rb->GetFieldPorts(FieldPort::Function::ARROW)) {
+      for (const auto &name : StreamRegPrefixes(*fp, "Written")) {
+        result.emplace_back(MmioFunction::WRITTEN, MmioBehavior::STATUS, name,
+                            "Number of elements written by the kernel to this stream since it was last started.",
+                            count_width);
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<MmioReg> GetProgressRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
+                                     uint32_t count_width) {
+  std::vector<MmioReg> result;
+  for (const auto &rb : recordbatches) {
+    if ((rb->mode() != fletcher::Mode::READ) || rb->GetFieldPorts(FieldPort::Function::ARROW).empty()) {
+      continue;
+    }
+    result.emplace_back(MmioFunction::PROGRESS, MmioBehavior::STATUS, rb->schema()->name() + "_consumed",
+                        "Number of rows the kernel consumed from this RecordBatch since it was last started.",
+                        count_width);
+  }
+  return result;
+}
+
 std::shared_ptr<cerata::Type> stream_probe(const std::shared_ptr<Node> &count_width) {
   // We require a probe stream where the valid and ready are control fields that travel in the same direction.
   // flat type indices:
@@ -134,6 +247,7 @@ static Component *profiler() {
   auto probe = port("probe", stream_probe(icw), Port::Dir::IN);
   auto enable = port("enable", bit(), Port::Dir::IN);
   auto clear = port("clear", bit(), Port::Dir::IN);
+  auto snapshot = port("snapshot", bit(), Port::Dir::IN);
   auto e = port(std::string("count_") + name::e, oct, Port::Dir::OUT);
   auto v = port(std::string("count_") + name::v, oct, Port::Dir::OUT);
   auto r = port(std::string("count_") + name::r, oct, Port::Dir::OUT);
@@ -142,7 +256,7 @@ static Component *profiler() {
   auto c = port(std::string("count_") + name::c, oct, Port::Dir::OUT);
 
   // Component & ports
-  auto ret = component("Profiler", {icw, ocw, pcr, probe, enable, clear, e, v, r, t, p, c});
+  auto ret = component("Profiler", {icw, ocw, pcr, probe, enable, clear, snapshot, e, v, r, t, p, c});
 
   // VHDL metadata
   ret->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
@@ -152,20 +266,89 @@ static Component *profiler() {
   return ret.get();
 }
 
-NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
-                                        const std::vector<cerata::Signal *> &profile_nodes) {
-  cerata::NodeMap rebinding;
+static Component *element_counter() {
+  auto opt_comp = cerata::default_component_pool()->Get("ElementCounter");
+  if (opt_comp) {
+    return *opt_comp;
+  }
+
+  auto icw = parameter("PROBE_COUNT_WIDTH", integer(), cerata::intl(1));
+  auto ocw = parameter("OUT_COUNT_WIDTH", integer(), cerata::intl(32));
+
+  auto pcr = port("pcd", cr(), Port::Dir::IN);
+  auto probe = port("probe", stream_probe(icw), Port::Dir::IN);
+  auto clear = port("clear", bit(), Port::Dir::IN);
+  auto e = port(std::string("count_") + name::e, vector("out_count_type", ocw), Port::Dir::OUT);
+
+  auto ret = component("ElementCounter", {icw, ocw, pcr, probe, clear, e});
+
+  ret->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  ret->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  ret->SetMeta(cerata::vhdl::meta::PACKAGE, "Profile_pkg");
+
+  return ret.get();
+}
+
+static Component *bus_tracer() {
+  // This component model corresponds to a VHDL primitive. Any modifications should be reflected accordingly.
+  auto opt_comp = cerata::default_component_pool()->Get("BusTracer");
+  if (opt_comp) {
+    return *opt_comp;
+  }
+
+  auto result = component("BusTracer");
+  BusDimParams params(result);
+  result->Remove(params.bs.get());
+  result->Remove(params.bm.get());
+  auto num_ports = parameter("NUM_PORTS", 1);
+  result->Add({num_ports, parameter("DEPTH_LOG2", 10)});
+
+  // The valid, ready, address and length of the request stream of every traced bus port.
+  auto probe = record("bus_trace_probe", {field("valid", bit()),
+                                          field("ready", bit()),
+                                          field("addr", vector(params.aw)),
+                                          field("len", vector(params.lw))});
+  result->Add({port("pcd", cr(), Port::Dir::IN),
+               cerata::port_array("probe", probe, num_ports, Port::Dir::IN),
+               port("enable", bit(), Port::Dir::IN),
+               port("clear", bit(), Port::Dir::IN),
+               port("index", vector(32), Port::Dir::IN),
+               port("count", vector(32), Port::Dir::OUT),
+               port("dropped", vector(32), Port::Dir::OUT),
+               port("entry_cycle", vector(32), Port::Dir::OUT),
+               port("entry_port", vector(32), Port::Dir::OUT),
+               port("entry_addr", vector(64), Port::Dir::OUT),
+               port("entry_len", vector(32), Port::Dir::OUT)});
+
+  result->SetMeta(cerata::vhdl::meta::PRIMITIVE, "true");
+  result->SetMeta(cerata::vhdl::meta::LIBRARY, "work");
+  result->SetMeta(cerata::vhdl::meta::PACKAGE, "Profile_pkg");
+  return result.get();
+}
+
+/**
+ * @brief Attach an instance of a probing component to every stream of some nodes.
+ * @param comp    The component to instantiate the probing components in.
+ * @param nodes   The nodes of which the streams are probed.
+ * @param unit    The probing component, with a pcd clock/reset port and a probe port of the stream_probe type.
+ * @param outputs The names of the result ports of the probing component.
+ * @return        A mapping from each node to the instances and their result ports.
+ */
+static NodeProfilerPorts AttachStreamProbes(cerata::Component *comp,
+                                            const std::vector<cerata::Signal *> &nodes,
+                                            Component *unit,
+                                            const std::vector<std::string> &outputs) {
   NodeProfilerPorts result;
-  // Get all nodes and check if their type contains a stream, then check if they should be profiled.
-  for (auto node : profile_nodes) {
+  // Get all nodes and check if their type contains a stream, then check if they should be probed.
+  for (auto node : nodes) {
     // Flatten the type
     auto flat_types = Flatten(node->type());
     int s = 0;
     // Iterate over all flattened types. If we encounter a stream, we must profile it.
     size_t fti = 0;
     while (fti < flat_types.size()) {
-      if (flat_types[fti].type_->Is(Type::RECORD)) {
-        FLETCHER_LOG(DEBUG, "Inserting profiler for stream node " + node->name()
+      if (dynamic_cast<cerata::Stream *>(flat_types[fti].type_) != nullptr) {
+        FLETCHER_LOG(DEBUG, "Inserting " + unit->name() + " for stream node " + node->name()
             + ", sub-stream " + std::to_string(s)
             + " of flattened type " + node->type()->name()
             + " index " + std::to_string(fti) + ".");
@@ -178,9 +361,9 @@ NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
                                        + "] of stream node [" + node->name() + "].");
         }
 
-        // Instantiate a profiler.
+        // Instantiate the probing component.
         std::string name = flat_types[fti].name(cerata::NamePart(node->name(), true));
-        auto profiler_inst = comp->Instantiate(profiler(), profiler()->name() + "_" + name + "_inst");
+        auto profiler_inst = comp->Instantiate(unit, unit->name() + "_" + name + "_inst");
         // Set the domain of all ports.
         for (auto &p : profiler_inst->GetAll<Port>()) {
           p->SetDomain(domain);
@@ -207,6 +390,10 @@ NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
         fti++;
         while (fti < flat_types.size()) {
           auto ft = flat_types[fti];
+          if (dynamic_cast<cerata::Stream *>(ft.type_) != nullptr) {
+            // This is the next stream, which gets its own probe.
+            break;
+          }
           if (ft.type_->meta.count(meta::COUNT) > 0) {
             auto width = std::strtol(flat_types[fti].type_->meta.at(meta::COUNT).c_str(), nullptr, 10);
             p_in_count_width <<= intl(static_cast<int>(width));
@@ -227,12 +414,10 @@ NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
         Connect(p_probe, node);
 
         // Create an entry in the map.
-        auto new_ports = std::vector<Port *>({profiler_inst->prt(std::string("count_") + name::e),
-                                              profiler_inst->prt(std::string("count_") + name::v),
-                                              profiler_inst->prt(std::string("count_") + name::r),
-                                              profiler_inst->prt(std::string("count_") + name::t),
-                                              profiler_inst->prt(std::string("count_") + name::p),
-                                              profiler_inst->prt(std::string("count_") + name::c)});
+        std::vector<Port *> new_ports;
+        for (const auto &output : outputs) {
+          new_ports.push_back(profiler_inst->prt(output));
+        }
 
         if (result.count(node) == 0) {
           // We need to create a new entry.
@@ -240,7 +425,7 @@ NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
         } else {
           // Insert the ports into the old entry.
           result[node].first.push_back(profiler_inst);
-          auto vec = result[node].second;
+          auto &vec = result[node].second;
           vec.insert(vec.end(), new_ports.begin(), new_ports.end());
         }
         // Increase the s-th stream index in the flattened type.
@@ -254,4 +439,69 @@ NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
   return result;
 }
 
+NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp,
+                                        const std::vector<cerata::Signal *> &profile_nodes) {
+  std::vector<std::string> outputs;
+  for (const auto &counter : ProfileCounterNames()) {
+    outputs.push_back("count_" + counter);
+  }
+  return AttachStreamProbes(comp, profile_nodes, profiler(), outputs);
+}
+
+NodeProfilerPorts EnableElementCounting(cerata::Component *comp, const std::vector<cerata::Signal *> &count_nodes) {
+  return AttachStreamProbes(comp, count_nodes, element_counter(), {std::string("count_") + name::e});
+}
+
+Instance *EnableBusTracing(cerata::Component *comp, const std::vector<cerata::Signal *> &bus_nodes) {
+  if (bus_nodes.empty()) {
+    return nullptr;
+  }
+  auto domain = *GetDomain(*bus_nodes.front());
+  auto cr_node = GetClockResetPort(comp, *domain);
+  if (!cr_node) {
+    throw std::runtime_error("No clock/reset port present on component [" + comp->name() + "] for clock domain ["
+                                 + domain->name() + "] of bus node [" + bus_nodes.front()->name() + "].");
+  }
+
+  auto inst = comp->Instantiate(bus_tracer(), "BusTracer_inst");
+  for (auto node : bus_nodes) {
+    auto probe = inst->prt_arr("probe")->Append();
+    probe->SetDomain(domain);
+
+    // The request stream is the first stream of the bus types, see bus_read() and bus_write(). Its valid and ready
+    // follow the stream in the flattened type, and its address and length are the first vectors of its element.
+    auto flat_types = Flatten(node->type());
+    size_t req = 0;
+    while ((req < flat_types.size()) && (dynamic_cast<cerata::Stream *>(flat_types[req].type_) == nullptr)) {
+      req++;
+    }
+    std::vector<size_t> fields;
+    for (size_t fti = req + 3; (fti < flat_types.size()) && (fields.size() < 2); fti++) {
+      if (dynamic_cast<cerata::Vector *>(flat_types[fti].type_) != nullptr) {
+        fields.push_back(fti);
+      }
+    }
+    if (fields.size() != 2) {
+      FLETCHER_LOG(FATAL, "Traced node " << node->name() << " is not of a bus type.");
+    }
+
+    auto mapper = TypeMapper::Make(node->type(), probe->type());
+    auto matrix = mapper->map_matrix().Empty();
+    matrix(req, 0) = 1;        // Connect the stream to the probe record.
+    matrix(req + 1, 1) = 1;    // Connect the stream valid.
+    matrix(req + 2, 2) = 1;    // Connect the stream ready.
+    matrix(fields[0], 3) = 1;  // Connect the address.
+    matrix(fields[1], 4) = 1;  // Connect the length.
+    mapper->SetMappingMatrix(matrix);
+    node->type()->AddMapper(mapper);
+    Connect(probe, node);
+  }
+
+  for (auto &p : inst->GetAll<Port>()) {
+    p->SetDomain(domain);
+  }
+  Connect(inst->prt("pcd"), *cr_node);
+  return inst;
+}
+
 }  // namespace fletchgen
@@ -29,8 +29,55 @@ namespace fletchgen {
 /// A mapping from nodes to profiler instances and ports.
 using NodeProfilerPorts = std::map<Node *, std::pair<std::vector<Instance *>, std::vector<Port *>>>;
 
-/// @brief Obtain the registers that should be reserved in the mmio component for profiling.
-std::vector<MmioReg> GetProfilingRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches);
+/**
+ * @brief Obtain the registers that should be reserved in the mmio component for profiling.
+ * @param recordbatches The RecordBatches of which the profiled fields result in counter registers.
+ * @param count_width   The width of every counter register. Counters wider than 32 bits span multiple registers.
+ * @param profile_bus   Whether to also profile the streams of the RecordBatch memory interface bus ports. The counter
+ *                      registers of these streams carry the MMIO_PROFILE_BUS metadata.
+ * @return              The enable, clear and snapshot registers, followed by the counter registers of every stream.
+ */
+std::vector<MmioReg> GetProfilingRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
+                                      uint32_t count_width = 32,
+                                      bool profile_bus = false);
+
+/**
+ * @brief Return the counter register name prefixes of a profiled node.
+ * @param node  The node to profile.
+ * @return      For every stream in the type of the node, the prefix Profile_<flat name>_<stream index>.
+ */
+std::vector<std::string> ProfileRegPrefixes(const cerata::Node &node);
+
+/**
+ * @brief Obtain the registers reporting the number of elements the kernel wrote to write-mode RecordBatches.
+ * @param recordbatches The RecordBatches of which the write-mode fields result in element count registers.
+ * @param count_width   The width of every count register. Counts wider than 32 bits span multiple registers.
+ * @return              For every stream of every write-mode field, a status register Written_<flat name>_<index>.
+ */
+std::vector<MmioReg> GetOutputCountRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
+                                        uint32_t count_width = 32);
+
+/**
+ * @brief Obtain the registers reporting the number of rows the kernel consumed from read-mode RecordBatches.
+ * @param recordbatches The RecordBatches of which the read-mode ones result in a progress register.
+ * @param count_width   The width of every count register. Counts wider than 32 bits span multiple registers.
+ * @return              For every read-mode RecordBatch, a status register <schema name>_consumed.
+ */
+std::vector<MmioReg> GetProgressRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches,
+                                     uint32_t count_width = 32);
+
+/**
+ * @brief Obtain the registers of a BusTracer recording the requests of the RecordBatch memory interface bus ports.
+ * @param recordbatches The RecordBatches of which the bus ports are traced.
+ * @param depth         The number of entries of the trace ring, rounded up to a power of two.
+ * @return              The registers of the BusTracer, followed by a constant register Trace_port_<bus port name> for
+ *                      every traced bus port in the order of the port indices, holding 1 for write ports. The
+ *                      Trace_index register carries the MMIO_TRACE_DEPTH_LOG2 metadata.
+ */
+std::vector<MmioReg> GetBusTraceRegs(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches, uint32_t depth);
+
+/// @brief Return the counter register name suffixes, in the order of the ports returned by EnableStreamProfiling.
+std::vector<std::string> ProfileCounterNames();
 
 /// @brief Returns a stream probe type based on a count width for multi-epc streams.
 std::shared_ptr<cerata::Type> stream_probe(const std::shared_ptr<Node> &count_width);
@@ -54,4 +101,27 @@ std::unique_ptr<cerata::Instance> profiler(const std::string &name,
  */
 NodeProfilerPorts EnableStreamProfiling(cerata::Component *comp, const std::vector<cerata::Signal *> &profile_nodes);
 
+/**
+ * @brief Transforms a Cerata component graph to count the elements transferred on every stream of selected nodes.
+ *
+ * Like EnableStreamProfiling, but attaches an ElementCounter rather than a Profiler to every stream.
+ *
+ * @param comp        The component to apply the transformation to.
+ * @param count_nodes The signal nodes of which the streams should be counted.
+ * @return            A mapping from each input node to the instantiated counters and their count ports.
+ */
+NodeProfilerPorts EnableElementCounting(cerata::Component *comp, const std::vector<cerata::Signal *> &count_nodes);
+
+/**
+ * @brief Transforms a Cerata component graph to record the requests of selected bus nodes with a BusTracer.
+ *
+ * The request stream of every node is connected to the next index of the probe port array of a single BusTracer, in
+ * the order of the nodes. The BusTracer is clocked by the clock domain of the first node.
+ *
+ * @param comp      The component to apply the transformation to.
+ * @param bus_nodes The signal nodes of bus read or write type of which the requests should be recorded.
+ * @return          The BusTracer instance.
+ */
+Instance *EnableBusTracing(cerata::Component *comp, const std::vector<cerata::Signal *> &bus_nodes);
+
 }  // namespace fletchgen
@@ -18,9 +18,12 @@
 #include <memory>
 #include <vector>
 #include <utility>
+#include <string>
+#include <sstream>
 
 #include "fletchgen/array.h"
 #include "fletchgen/bus.h"
+#include "fletchgen/perf.h"
 #include "fletchgen/schema.h"
 
 namespace fletchgen {
@@ -30,8 +33,55 @@ using cerata::Component;
 using cerata::Port;
 using cerata::Literal;
 using cerata::intl;
+using cerata::booll;
 using cerata::Term;
 
+/// @brief Return the memory interface channel of a field, which may be set on the field or on its schema.
+static uint32_t GetBusChannel(const arrow::Schema &schema, const arrow::Field &field) {
+  auto channel = fletcher::GetMeta(field, fletcher::meta::BUS_CHANNEL);
+  if (channel.empty()) {
+    channel = fletcher::GetMeta(schema, fletcher::meta::BUS_CHANNEL);
+  }
+  if (channel.empty()) {
+    return 0;
+  }
+  return static_cast<uint32_t>(std::stoul(channel, nullptr, 10));
+}
+
+/// @brief Return true if a field or any of its children is nullable.
+static bool HasNullable(const arrow::Field &field) {
+  if (field.nullable()) {
+    return true;
+  }
+  for (const auto &child : field.type()->fields()) {
+    if (HasNullable(*child)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @brief Append the properties of a field that determine its stream type to a key. See GetStreamType().
+static void AppendStreamTypeKey(const arrow::Field &field, std::stringstream *key) {
+  *key << fletcher::GetUIntMeta(field, fletcher::meta::VALUE_EPC, 1) << ","
+       << fletcher::GetUIntMeta(field, fletcher::meta::LIST_EPC, 1) << ","
+       << field.nullable() << ",";
+  if (field.type()->num_fields() == 0) {
+    *key << field.type()->ToString();
+    return;
+  }
+  // The record of a struct is named after its field. The children of nested types name the fields of the record.
+  *key << field.type()->name() << "<";
+  if (field.type()->id() == arrow::Type::STRUCT) {
+    *key << field.name();
+  }
+  for (const auto &child : field.type()->fields()) {
+    *key << ";" << child->name() << ":";
+    AppendStreamTypeKey(*child, key);
+  }
+  *key << ">";
+}
+
 RecordBatch::RecordBatch(const std::string &name,
                          const std::shared_ptr<FletcherSchema> &fletcher_schema,
                          fletcher::RecordBatchDescription batch_desc)
@@ -55,10 +105,14 @@ void RecordBatch::AddArrays(const std::shared_ptr<FletcherSchema> &fletcher_sche
   cerata::NodeMap rebinding;
 
   // Add Array type generics.
-  auto iw = index_width();
+  auto iw = index_width(fletcher::HasLargeOffsets(*fletcher_schema->arrow_schema()) ? 64 : 32);
   auto tw = tag_width();
   Add({iw, tw});
 
+  // The clock/reset ports of the RecordBatch drive those of all ArrayReaders/Writers.
+  auto kcd = prt("kcd");
+  auto bcd = prt("bcd");
+
   // Iterate over all fields and add ArrayReader/Writer data and control ports.
   for (const auto &field : fletcher_schema->arrow_schema()->fields()) {
     // Name prefix for all sorts of stuff.
@@ -77,69 +131,156 @@ void RecordBatch::AddArrays(const std::shared_ptr<FletcherSchema> &fletcher_sche
                               "not implemented include:\n"
                               "  - dvalid bit is ignored (so you cannot supply handshakes on the values stream for "
                               "empty lists or use empty handshakes to close streams)\n"
-                              "  - lists of primitives (e.g. strings) values stream last signal must signal the last "
-                              "value for all lists, not single lists in the Arrow Array).\n"
+                              "  - lists (e.g. strings) values stream last signal must signal the last value for all "
+                              "lists, not single lists in the Arrow Array).\n"
                               "  - clock domain crossings.");
       }
 
       // Generate the schema-defined Arrow data port for the kernel.
       // This is the un-concatenated version w.r.t. the streams visible on the Array primitive component.
-      auto kernel_arrow_port = arrow_port(fletcher_schema, field, true, kernel_cd());
-      auto kernel_arrow_type = kernel_arrow_port->type();
+      auto arrow_types = GetArrowTypes(*field);
+      auto kernel_arrow_port = arrow_port(fletcher_schema, field, true, kernel_cd(), arrow_types.first);
       Add(kernel_arrow_port);
 
-      // Instantiate an ArrayReader/Writer.
-      auto a = Instantiate(array(mode_), field->name() + "_inst");
-      array_instances_.push_back(a);
+      if (fletcher::GetBoolMeta(*field, fletcher::meta::GATHER, false) && (mode_ == Mode::WRITE)) {
+        FLETCHER_LOG(FATAL, "Writing field " << field->name() << " in gather mode is not supported.");
+      }
+      // ArrayWriters write structs and (nested) lists, but no validity bitmaps.
+      if ((mode_ == Mode::WRITE) && HasNullable(*field)) {
+        FLETCHER_LOG(FATAL, "Writing field " << field->name() << " with nullable (child) fields is not supported.");
+      }
+      if (fletcher::GetUIntMeta(*field, fletcher::meta::ONCHIP, 0) > 0) {
+        auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(field->type());
+        if (mode_ == Mode::WRITE) {
+          FLETCHER_LOG(FATAL, "Caching written field " << field->name() << " on-chip is not supported.");
+        }
+        if (field->nullable() || (GetConfigType(*field->type()) != ConfigType::PRIM) || (fwt == nullptr)) {
+          FLETCHER_LOG(FATAL, "Field " << field->name() << " cached on-chip must be a non-nullable fixed-width field.");
+        }
+        if ((fletcher::GetUIntMeta(*field, fletcher::meta::VALUE_EPC, 1) > 1)
+            || !fletcher::GetMeta(*field, fletcher::meta::COMPRESSION).empty()
+            || !fletcher::GetMeta(*field, fletcher::meta::ENCODING).empty()
+            || fletcher::GetBoolMeta(*field, fletcher::meta::GATHER, false)) {
+          FLETCHER_LOG(FATAL, "Field " << field->name() << " cached on-chip can not have elements-per-cycle > 1, "
+                                          "compression, an encoding or gather mode.");
+        }
+      }
 
-      // Generate and set a configuration string for the ArrayReader.
-      Connect(a->Get<Parameter>("CFG"), GenerateConfigString(*field));
+      // Instantiate an ArrayReader/Writer, a DictionaryReader for dictionary-encoded fields, an Lz4Reader for
+      // compressed fields, a RunEndReader for run-end encoded fields, or a ParquetPageReader for Parquet-encoded
+      // fields.
+      Instance *a = nullptr;
+      auto compression = fletcher::GetMeta(*field, fletcher::meta::COMPRESSION);
+      auto encoding = fletcher::GetMeta(*field, fletcher::meta::ENCODING);
+      if (!encoding.empty() && !fletcher::IsRunEndEncoded(*field) && !fletcher::IsParquetEncoded(*field)) {
+        FLETCHER_LOG(FATAL, "Encoding " << encoding << " of field " << field->name() << " is not supported.");
+      }
+      if (fletcher::IsParquetEncoded(*field)) {
+        auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(field->type());
+        if (mode_ == Mode::WRITE) {
+          FLETCHER_LOG(FATAL, "Writing Parquet-encoded field " << field->name() << " is not supported.");
+        }
+        if ((GetConfigType(*field->type()) != ConfigType::PRIM) || (fwt == nullptr)
+            || ((fwt->bit_width() != 32) && (fwt->bit_width() != 64))) {
+          FLETCHER_LOG(FATAL, "Parquet-encoded field " << field->name() << " must be of a 32- or 64-bit fixed-width "
+                                                                           "type.");
+        }
+        if (!compression.empty() || fletcher::GetBoolMeta(*field, fletcher::meta::GATHER, false)
+            || (fletcher::GetUIntMeta(*field, fletcher::meta::VALUE_EPC, 1) > 1)) {
+          FLETCHER_LOG(FATAL, "Parquet-encoded field " << field->name() << " can not be compressed, read in gather "
+                                                                           "mode or have elements-per-cycle > 1.");
+        }
+        a = Instantiate(parquet_page_reader(), field->name() + "_inst");
+        a->par("VALUE_WIDTH")->SetValue(intl(fwt->bit_width()));
+        a->par("NULLABLE")->SetValue(booll(field->nullable()));
+      } else if (fletcher::IsRunEndEncoded(*field)) {
+        if (mode_ == Mode::WRITE) {
+          FLETCHER_LOG(FATAL, "Writing run-end encoded field " << field->name() << " is not supported.");
+        }
+        if (field->nullable()) {
+          FLETCHER_LOG(FATAL, "Nullable run-end encoded field " << field->name() << " is not supported.");
+        }
+        if ((GetConfigType(*field->type()) != ConfigType::PRIM)
+            || (std::dynamic_pointer_cast<arrow::FixedWidthType>(field->type()) == nullptr)) {
+          FLETCHER_LOG(FATAL, "Run-end encoded field " << field->name() << " must be of a fixed-width type.");
+        }
+        if (!compression.empty() || fletcher::GetBoolMeta(*field, fletcher::meta::GATHER, false)) {
+          FLETCHER_LOG(FATAL, "Run-end encoded field " << field->name() << " can not be compressed or read in "
+                                                                          "gather mode.");
+        }
+        a = Instantiate(run_end_reader(), field->name() + "_inst");
+        // The values are delivered like those of an ArrayReader of the same field.
+        Connect(a->Get<Parameter>("CFG"), GenerateConfigString(*field));
+      } else if (!compression.empty()) {
+        auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(field->type());
+        if (compression != fletcher::meta::LZ4) {
+          FLETCHER_LOG(FATAL, "Compression " << compression << " of field " << field->name() << " is not supported.");
+        }
+        if (mode_ == Mode::WRITE) {
+          FLETCHER_LOG(FATAL, "Writing compressed field " << field->name() << " is not supported.");
+        }
+        if (field->nullable()) {
+          FLETCHER_LOG(FATAL, "Nullable compressed field " << field->name() << " is not supported.");
+        }
+        if ((GetConfigType(*field->type()) != ConfigType::PRIM) || (fwt == nullptr) || (fwt->bit_width() % 8 != 0)) {
+          FLETCHER_LOG(FATAL, "Compressed field " << field->name() << " must be of a byte-aligned fixed-width type.");
+        }
+        if (fletcher::GetUIntMeta(*field, fletcher::meta::VALUE_EPC, 1) > 1) {
+          FLETCHER_LOG(FATAL, "Elements-per-cycle > 1 on compressed field " << field->name() << " is not supported.");
+        }
+        a = Instantiate(lz4_reader(), field->name() + "_inst");
+        a->par("VALUE_WIDTH")->SetValue(intl(fwt->bit_width()));
+      } else if (GetConfigType(*field->type()) == ConfigType::DICTIONARY) {
+        auto dict_type = std::static_pointer_cast<arrow::DictionaryType>(field->type());
+        if (mode_ == Mode::WRITE) {
+          FLETCHER_LOG(FATAL, "Writing dictionary-encoded field " << field->name() << " is not supported.");
+        }
+        if (field->nullable()) {
+          FLETCHER_LOG(FATAL, "Nullable dictionary-encoded field " << field->name() << " is not supported.");
+        }
+        a = Instantiate(dictionary_reader(), field->name() + "_inst");
+        a->par("KEY_WIDTH")->SetValue(intl(GetFixedWidthTypeBitWidth(*dict_type->index_type())));
+        a->par("VALUE_WIDTH")->SetValue(intl(GetFixedWidthTypeBitWidth(*dict_type->value_type())));
+      } else {
+        a = Instantiate(array(mode_), field->name() + "_inst");
+        // Generate and set a configuration string for the ArrayReader.
+        Connect(a->Get<Parameter>("CFG"), GenerateConfigString(*field));
+      }
+      array_instances_.push_back(a);
 
       // Drive the clocks and resets.
-      Connect(a->prt("kcd"), prt("kcd"));
-      Connect(a->prt("bcd"), prt("bcd"));
+      Connect(a->prt("kcd"), kcd);
+      Connect(a->prt("bcd"), bcd);
 
-      // Connect some global parameters.
-      a->par("CMD_TAG_WIDTH") <<= tw;
+      // Connect some global parameters. A field may have a tag width of its own.
+      auto ftw = field_tag_width(*field, tw);
+      a->par("CMD_TAG_WIDTH")->SetValue(ftw);
       a->par(index_width()) <<= iw;
 
       // Connect the bus ports.
-      ConnectBusPorts(a, prefix, &rebinding);
+      ConnectBusPorts(a, prefix, *field, GetBusChannel(*fletcher_schema->arrow_schema(), *field), &rebinding);
 
       // Drive the RecordBatch Arrow data port with the ArrayReader/Writer data port, or vice versa.
+      // Rebind the type of the Array data port because now we know the field (also see array()).
       if (mode_ == Mode::READ) {
         auto a_data_port = a->prt("out");
-        // Rebind the type because now we know the field (also see array()).
-        auto a_data_spec = GetArrayDataSpec(*field);
-        auto a_data_type = array_reader_out(a_data_spec.first, a_data_spec.second);
-        a_data_port->SetType(a_data_type);
-        // Create a mapper between the Arrow port and the Array data port.
-        auto mapper = GetStreamTypeMapper(kernel_arrow_type, a_data_type.get());
-        kernel_arrow_type->AddMapper(mapper);
-        // Connect the ports.
+        a_data_port->SetType(arrow_types.second);
         kernel_arrow_port <<= a_data_port;
       } else {
         auto a_data_port = a->prt("in");
-        // Rebind the type because now we know the field (also see array()).
-        auto a_data_spec = GetArrayDataSpec(*field);
-        auto a_data_type = array_writer_in(a_data_spec.first, a_data_spec.second);
-        a_data_port->SetType(a_data_type);
-        // Create a mapper between the Arrow port and the Array data port.
-        auto mapper = GetStreamTypeMapper(kernel_arrow_type, a_data_type.get());
-        kernel_arrow_type->AddMapper(mapper);
-        // Connect the ports.
+        a_data_port->SetType(arrow_types.second);
         a_data_port <<= kernel_arrow_port;
       }
 
       // Get the command stream and unlock stream ports and set their real type and connect.
       auto a_cmd = a->Get<Port>("cmd");
-      auto ct = cmd_type(iw,
-                         tw,
-                         a->par(bus_addr_width())->shared_from_this() * GetCtrlBufferCount(*field));
+      // The control field holds the buffer addresses, and the all valid flag of every validity bitmap.
+      auto ct = cmd_type(iw, ftw, a->par(bus_addr_width())->shared_from_this() * GetCtrlBufferCount(*field)
+          + GetCtrlFlagCount(*field));
       a_cmd->SetType(ct);
 
       auto aw = Get<Parameter>(prefix + "_" + bus_addr_width()->name())->shared_from_this();
-      auto cmd = command_port(fletcher_schema, field, iw, tw, aw, kernel_cd());
+      auto cmd = command_port(fletcher_schema, field, iw, ftw, aw, kernel_cd());
       Connect(a_cmd, cmd);
       Add(cmd);
 
@@ -147,13 +288,31 @@ void RecordBatch::AddArrays(const std::shared_ptr<FletcherSchema> &fletcher_sche
       auto ut = unlock_type(a->par("CMD_TAG_WIDTH")->shared_from_this());
       a_unl->SetType(ut);
 
-      auto unl = unlock_port(fletcher_schema, field, tw, kernel_cd());
+      auto unl = unlock_port(fletcher_schema, field, ftw, kernel_cd());
       Connect(unl, a_unl);
       Add(unl);
     }
   }
 }
 
+std::pair<std::shared_ptr<cerata::Type>, std::shared_ptr<cerata::Type>>
+RecordBatch::GetArrowTypes(const arrow::Field &field) {
+  std::stringstream key;
+  AppendStreamTypeKey(field, &key);
+  auto existing = types_.find(key.str());
+  if (existing != types_.end()) {
+    return existing->second;
+  }
+  auto kernel_type = GetStreamType(field, mode_);
+  auto a_data_spec = GetArrayDataSpec(field);
+  auto a_data_type = mode_ == Mode::READ ? array_reader_out(a_data_spec) : array_writer_in(a_data_spec);
+  // Create a mapper between the Arrow port and the Array data port.
+  kernel_type->AddMapper(GetStreamTypeMapper(kernel_type.get(), a_data_type.get()));
+  auto result = std::make_pair(kernel_type, a_data_type);
+  types_[key.str()] = result;
+  return result;
+}
+
 std::vector<std::shared_ptr<FieldPort>>
 RecordBatch::GetFieldPorts(const std::optional<FieldPort::Function> &function) const {
   std::vector<std::shared_ptr<FieldPort>> result;
@@ -168,7 +327,15 @@ RecordBatch::GetFieldPorts(const std::optional<FieldPort::Function> &function) c
   return result;
 }
 
-void RecordBatch::ConnectBusPorts(Instance *array, const std::string &prefix, cerata::NodeMap *rebinding) {
+void RecordBatch::ConnectBusPorts(Instance *array,
+                                  const std::string &prefix,
+                                  const arrow::Field &field,
+                                  uint32_t channel,
+                                  cerata::NodeMap *rebinding) {
+  auto weight = fletcher::GetUIntMeta(field, fletcher::meta::BUS_WEIGHT, 0);
+  if (weight > 255) {
+    FLETCHER_LOG(FATAL, "Bus weight of field " << field.name() << " must be at most 255.");
+  }
   auto a_bus_ports = array->GetAll<BusPort>();
   for (const auto &a_bus_port : a_bus_ports) {
     auto rb_port_prefix = prefix + "_bus";
@@ -178,6 +345,9 @@ void RecordBatch::ConnectBusPorts(Instance *array, const std::string &prefix, ce
     auto rb_bus_spec = BusSpecParams{rb_bus_params, a_bus_spec.func};
     // Copy over the ArrayReader/Writer's bus port
     auto rb_bus_port = bus_port(rb_port_prefix, a_bus_port->dir(), rb_bus_spec);
+    rb_bus_port->channel_ = channel;
+    rb_bus_port->demand_ = GetFieldDemand(field);
+    rb_bus_port->weight_ = static_cast<uint32_t>(weight);
     // Add them to the RecordBatch
     Add(rb_bus_port);
     // Connect them to the ArrayReader/Writer
@@ -187,6 +357,15 @@ void RecordBatch::ConnectBusPorts(Instance *array, const std::string &prefix, ce
   }
 }
 
+uint32_t GetIndexWidth(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches) {
+  for (const auto &rb : recordbatches) {
+    if (fletcher::HasLargeOffsets(*rb->schema()->arrow_schema())) {
+      return 64;
+    }
+  }
+  return 32;
+}
+
 std::shared_ptr<RecordBatch> record_batch(const std::string &name,
                                           const std::shared_ptr<FletcherSchema> &fletcher_schema,
                                           const fletcher::RecordBatchDescription &batch_desc) {
@@ -199,9 +378,12 @@ std::shared_ptr<RecordBatch> record_batch(const std::string &name,
 std::shared_ptr<FieldPort> arrow_port(const std::shared_ptr<FletcherSchema> &fletcher_schema,
                                       const std::shared_ptr<arrow::Field> &field,
                                       bool reverse,
-                                      const std::shared_ptr<ClockDomain> &domain) {
+                                      const std::shared_ptr<ClockDomain> &domain,
+                                      std::shared_ptr<cerata::Type> type) {
   auto name = fletcher_schema->name() + "_" + field->name();
-  auto type = GetStreamType(*field, fletcher_schema->mode());
+  if (type == nullptr) {
+    type = GetStreamType(*field, fletcher_schema->mode());
+  }
   Port::Dir dir;
   if (reverse) {
     dir = Term::Reverse(mode2dir(fletcher_schema->mode()));
@@ -223,7 +405,7 @@ std::shared_ptr<FieldPort> command_port(const std::shared_ptr<FletcherSchema> &s
                                         const std::shared_ptr<ClockDomain> &domain) {
   std::shared_ptr<cerata::Type> type;
   if (addr_width) {
-    type = cmd_type(index_width, tag_width, *addr_width * GetCtrlBufferCount(*field));
+    type = cmd_type(index_width, tag_width, *addr_width * GetCtrlBufferCount(*field) + GetCtrlFlagCount(*field));
   } else {
     type = cmd_type(index_width, tag_width);
   }
@@ -232,6 +414,27 @@ std::shared_ptr<FieldPort> command_port(const std::shared_ptr<FletcherSchema> &s
   return std::make_shared<FieldPort>(name, FieldPort::COMMAND, field, schema, type, Port::Dir::IN, domain, false);
 }
 
+std::shared_ptr<FieldPort> gather_port(const std::shared_ptr<FletcherSchema> &schema,
+                                       const std::shared_ptr<arrow::Field> &field,
+                                       const std::shared_ptr<Node> &index_width,
+                                       const std::shared_ptr<Node> &tag_width,
+                                       const std::shared_ptr<ClockDomain> &domain) {
+  auto type = gather_type(index_width, tag_width);
+  auto name = schema->name() + "_" + field->name() + "_idx";
+
+  return std::make_shared<FieldPort>(name, FieldPort::COMMAND, field, schema, type, Port::Dir::IN, domain, false);
+}
+
+std::shared_ptr<FieldPort> lookup_port(const std::shared_ptr<FletcherSchema> &schema,
+                                       const std::shared_ptr<arrow::Field> &field,
+                                       const std::shared_ptr<Node> &index_width,
+                                       const std::shared_ptr<ClockDomain> &domain) {
+  auto type = lookup_type(index_width);
+  auto name = schema->name() + "_" + field->name() + "_lookup";
+
+  return std::make_shared<FieldPort>(name, FieldPort::LOOKUP, field, schema, type, Port::Dir::IN, domain, false);
+}
+
 std::shared_ptr<FieldPort> unlock_port(const std::shared_ptr<FletcherSchema> &schema,
                                        const std::shared_ptr<arrow::Field> &field,
                                        const std::shared_ptr<Node> &tag_width,
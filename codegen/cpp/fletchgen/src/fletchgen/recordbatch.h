@@ -22,6 +22,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 #include "fletchgen/utils.h"
 #include "fletchgen/basic_types.h"
@@ -54,7 +55,8 @@ struct FieldPort : public Port {
   enum Function {
     ARROW,      ///< Port with Arrow data
     COMMAND,    ///< Port to issue commands to the generated interface.
-    UNLOCK      ///< Port that signals the kernel a command was completed.
+    UNLOCK,     ///< Port that signals the kernel a command was completed.
+    LOOKUP      ///< Port to look up values in the on-chip cache of a field.
   } function_;  ///< The function of this FieldPort.
 
   /// The Fletcher schema this port was derived from.
@@ -99,12 +101,14 @@ struct FieldPort : public Port {
  * @param field            The Arrow field to derive the port from.
  * @param reverse          Reverse the direction of the port.
  * @param domain           The clock domain of this port.
+ * @param type             Optionally, the stream type of the port. If not supplied, it is derived from the field.
  * @return                 A shared pointer to a new FieldPort.
  */
 std::shared_ptr<FieldPort> arrow_port(const std::shared_ptr<FletcherSchema> &fletcher_schema,
                                       const std::shared_ptr<arrow::Field> &field,
                                       bool reverse,
-                                      const std::shared_ptr<ClockDomain> &domain = default_domain());
+                                      const std::shared_ptr<ClockDomain> &domain = default_domain(),
+                                      std::shared_ptr<cerata::Type> type = nullptr);
 /**
  * @brief Construct a field-derived command port.
  * @param schema  The Fletcher-derived schema.
@@ -122,6 +126,36 @@ std::shared_ptr<FieldPort> command_port(const std::shared_ptr<FletcherSchema> &s
                                         std::optional<std::shared_ptr<Node>> addr_width = std::nullopt,
                                         const std::shared_ptr<ClockDomain> &domain = default_domain());
 
+/**
+ * @brief Construct a field-derived gather port, through which the kernel supplies the row indices of a field that is
+ *        read in gather mode, see fletcher::meta::GATHER.
+ * @param schema      The Fletcher-derived schema.
+ * @param field       The Arrow field to derive the port from.
+ * @param index_width Type generic node for index field width.
+ * @param tag_width   Type generic node for tag field width.
+ * @param domain      The clock domain.
+ * @return            A shared pointer to a new FieldPort.
+ */
+std::shared_ptr<FieldPort> gather_port(const std::shared_ptr<FletcherSchema> &schema,
+                                       const std::shared_ptr<arrow::Field> &field,
+                                       const std::shared_ptr<Node> &index_width,
+                                       const std::shared_ptr<Node> &tag_width,
+                                       const std::shared_ptr<ClockDomain> &domain = default_domain());
+
+/**
+ * @brief Construct a field-derived lookup port, through which the kernel supplies the addresses of the values to look
+ *        up in the on-chip cache of a field, see fletcher::meta::ONCHIP.
+ * @param schema      The Fletcher-derived schema.
+ * @param field       The Arrow field to derive the port from.
+ * @param index_width Type generic node for index field width.
+ * @param domain      The clock domain.
+ * @return            A shared pointer to a new FieldPort.
+ */
+std::shared_ptr<FieldPort> lookup_port(const std::shared_ptr<FletcherSchema> &schema,
+                                       const std::shared_ptr<arrow::Field> &field,
+                                       const std::shared_ptr<Node> &index_width,
+                                       const std::shared_ptr<ClockDomain> &domain = default_domain());
+
 /**
  * @brief Construct a field-derived unlock port.
  * @param schema    The Fletcher-derived schema.
@@ -182,9 +216,27 @@ struct RecordBatch : public Component {
   fletcher::RecordBatchDescription batch_desc_;
 
  private:
-  void ConnectBusPorts(Instance *array, const std::string &prefix, cerata::NodeMap *rebinding);
+  void ConnectBusPorts(Instance *array,
+                       const std::string &prefix,
+                       const arrow::Field &field,
+                       uint32_t channel,
+                       cerata::NodeMap *rebinding);
+
+  /**
+   * @brief Return the kernel and ArrayReader/Writer data stream types of a field.
+   *
+   * Fields that only differ in their name share these types and the mapper between them, such that the types of
+   * schemas with many fields of the same type are only constructed once.
+   */
+  std::pair<std::shared_ptr<cerata::Type>, std::shared_ptr<cerata::Type>> GetArrowTypes(const arrow::Field &field);
+
+  /// The kernel and ArrayReader/Writer data stream types of the fields, keyed by the field properties they depend on.
+  std::unordered_map<std::string, std::pair<std::shared_ptr<cerata::Type>, std::shared_ptr<cerata::Type>>> types_;
 };
 
+/// @brief Return the width of the indices of a set of RecordBatches, 64 if any has 64-bit offsets, 32 otherwise.
+uint32_t GetIndexWidth(const std::vector<std::shared_ptr<RecordBatch>> &recordbatches);
+
 /// @brief Make a new RecordBatch(Reader/Writer) component, based on a Fletcher schema.
 std::shared_ptr<RecordBatch> record_batch(const std::string &name,
                                           const std::shared_ptr<FletcherSchema> &fletcher_schema,
@@ -51,6 +51,15 @@ bool SchemaSet::RequiresWriting() const {
   return false;
 }
 
+uint32_t SchemaSet::index_width() const {
+  for (const auto &fs : schemas_) {
+    if (fletcher::HasLargeOffsets(*fs->arrow_schema())) {
+      return 64;
+    }
+  }
+  return 32;
+}
+
 bool SchemaSet::HasSchemaWithName(const std::string &name) const {
   for (const auto &fs : schemas_) {
     if (fs->name() == name) {
@@ -92,6 +92,8 @@ class SchemaSet : public cerata::Named {
   [[nodiscard]] std::vector<std::shared_ptr<FletcherSchema>> write_schemas() const;
   /// @brief Sort the schemas by name, then by read/write mode.
   void Sort();
+  /// @brief Return the width of the RecordBatch indices, 64 if any schema has 64-bit offsets, 32 otherwise.
+  [[nodiscard]] uint32_t index_width() const;
 
  private:
   /// @brief Schemas of RecordBatches.
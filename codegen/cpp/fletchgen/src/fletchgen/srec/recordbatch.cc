@@ -21,6 +21,11 @@
 #include <memory>
 #include <ostream>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <iomanip>
 
 #include "fletchgen/srec/srec.h"
 
@@ -30,31 +35,39 @@ static inline size_t PaddedLength(size_t size, size_t alignment) {
   return ((size + alignment - 1) / alignment) * alignment;
 }
 
-void GenerateReadSREC(const std::vector<fletcher::RecordBatchDescription> &meta_in,
-                      std::vector<fletcher::RecordBatchDescription> *meta_out,
-                      std::ofstream *out,
-                      int64_t buffer_align) {
-  // We need to align each buffer into the SREC stream.
+/// @brief Determine the location of every buffer of non-virtual RecordBatches in a memory image starting at 0.
+static void LayoutBuffers(const std::vector<fletcher::RecordBatchDescription> &meta_in,
+                          std::vector<fletcher::RecordBatchDescription> *meta_out,
+                          int64_t buffer_align) {
+  // Building hex dumps of every buffer is expensive, only do so when they end up in the log.
+  bool debug = fletcher::IsLoggingEnabled(FLETCHER_LOG_DEBUG);
+
+  // We need to align each buffer into the image.
   // We start at offset 0.
   uint64_t offset = 0;
   for (const auto &desc_in : meta_in) {
     fletcher::RecordBatchDescription desc_out = desc_in;
-    // We can only copy data from physically existing recordbatches into the SREC
+    // We can only copy data from physically existing recordbatches into the image
     if (!desc_in.is_virtual) {
+      if (debug) {
+        FLETCHER_LOG(DEBUG, "RecordBatch " + desc_in.name + " buffers: \n" + desc_in.ToString());
+      }
       desc_out.fields.clear();
       for (const auto &f : desc_in.fields) {
         desc_out.fields.emplace_back(f.type_, f.length, f.null_count);
-        FLETCHER_LOG(DEBUG, "RecordBatch " + desc_in.name + " buffers: \n" + desc_in.ToString());
         for (const auto &buf : f.buffers) {
           // May the force be with us
-          auto srec_buf_address = reinterpret_cast<uint8_t *>(offset);
-          // Determine the place of the buffer in the SREC output
-          desc_out.fields.back().buffers.emplace_back(srec_buf_address, buf.size_, buf.desc_, buf.level_);
+          auto image_buf_address = reinterpret_cast<uint8_t *>(offset);
+          // Determine the place of the buffer in the image
+          desc_out.fields.back().buffers.emplace_back(image_buf_address, buf.size_, buf.desc_, buf.level_);
+          desc_out.fields.back().buffers.back().device_offset_ = buf.device_offset_;
 
           // Print some debug info
-          auto hv = fletcher::HexView(offset);
-          hv.AddData(buf.raw_buffer_, buf.size_);
-          FLETCHER_LOG(DEBUG, fletcher::ToString(buf.desc_) + "\n" + hv.ToString());
+          if (debug) {
+            auto hv = fletcher::HexView(offset);
+            hv.AddData(buf.raw_buffer_, buf.size_);
+            FLETCHER_LOG(DEBUG, fletcher::ToString(buf.desc_) + "\n" + hv.ToString());
+          }
 
           // Calculate the padded length and calculate the next offset.
           auto padded_size = PaddedLength(buf.size_, buffer_align);
@@ -64,47 +77,334 @@ void GenerateReadSREC(const std::vector<fletcher::RecordBatchDescription> &meta_
     }
     meta_out->push_back(desc_out);
   }
-  // We have now determined the location of every buffer in the SREC file and we know the total size of the resulting
-  // file in bytes. We must now create the actual SREC file. Calloc some space to serialize the Arrow buffers into.
-  auto srec_buffer = static_cast<uint8_t *>(calloc(1, offset));
-
-  // Copy over every buffer.
-  for (size_t r = 0; r < meta_in.size(); r++) {
-    if (!meta_in[r].is_virtual) {
-      for (size_t f = 0; f < meta_in[r].fields.size(); f++) {
-        for (size_t b = 0; b < meta_in[r].fields[f].buffers.size(); b++) {
-          auto srec_off = reinterpret_cast<size_t>(meta_out->at(r).fields[f].buffers[b].raw_buffer_);
-          auto dest = srec_buffer + srec_off;
-          auto src = meta_in[r].fields[f].buffers[b].raw_buffer_;
-          auto size = meta_in[r].fields[f].buffers[b].size_;
-          // skip empty buffers (typically implicit validity buffers)
-          if (src != nullptr) {
-            memcpy(dest, src, size);
+}
+
+/**
+ * @brief Stream the buffers of non-virtual RecordBatches in the order of LayoutBuffers.
+ * @param write Called with a pointer and a size to append source data.
+ * @param pad   Called with a size to append zero bytes.
+ */
+template<typename WriteFunc, typename PadFunc>
+static void StreamBuffers(const std::vector<fletcher::RecordBatchDescription> &meta_in,
+                          int64_t buffer_align,
+                          WriteFunc write,
+                          PadFunc pad) {
+  for (const auto &desc_in : meta_in) {
+    if (!desc_in.is_virtual) {
+      for (const auto &f : desc_in.fields) {
+        for (const auto &buf : f.buffers) {
+          // Empty buffers (typically implicit validity buffers) are zero-filled.
+          if (buf.raw_buffer_ != nullptr) {
+            write(buf.raw_buffer_, buf.size_);
+          } else {
+            pad(buf.size_);
           }
+          pad(PaddedLength(buf.size_, buffer_align) - buf.size_);
         }
       }
     }
   }
+}
 
-  // Create the SREC file, start at 0
-  srec::File sr(0, srec_buffer, offset);
-  if (out->good()) {
-    sr.write(out);
-  } else {
+void GenerateReadSREC(const std::vector<fletcher::RecordBatchDescription> &meta_in,
+                      std::vector<fletcher::RecordBatchDescription> *meta_out,
+                      std::ofstream *out,
+                      int64_t buffer_align) {
+  LayoutBuffers(meta_in, meta_out, buffer_align);
+
+  // We have now determined the location of every buffer in the SREC file. Buffers are laid out in the order in which
+  // they were visited, so we can stream them straight from their source into the SREC file, padding in between.
+  if (!out->good()) {
     FLETCHER_LOG(ERROR, "Output stream unavailable. SREC was not written.");
+    return;
+  }
+
+  // Create the SREC file, start at 0
+  srec::Writer sr(out, 0);
+  StreamBuffers(meta_in, buffer_align,
+                [&](const uint8_t *data, size_t size) { sr.Write(data, size); },
+                [&](size_t size) { sr.Pad(size); });
+  sr.Flush();
+}
+
+void GenerateReadImage(const std::vector<fletcher::RecordBatchDescription> &meta_in,
+                       std::vector<fletcher::RecordBatchDescription> *meta_out,
+                       std::ofstream *out,
+                       std::ostream *manifest,
+                       int64_t buffer_align) {
+  size_t first = meta_out->size();
+  LayoutBuffers(meta_in, meta_out, buffer_align);
+
+  if (!out->good() || !manifest->good()) {
+    FLETCHER_LOG(ERROR, "Output stream unavailable. Memory image was not written.");
+    return;
+  }
+
+  // Write the manifest, one line per buffer.
+  for (size_t r = first; r < meta_out->size(); r++) {
+    const auto &desc = meta_out->at(r);
+    if (!desc.is_virtual) {
+      for (const auto &f : desc.fields) {
+        for (const auto &buf : f.buffers) {
+          (*manifest) << "0x" << std::hex << std::setw(16) << std::setfill('0')
+                      << reinterpret_cast<uint64_t>(buf.raw_buffer_) << std::dec << " " << buf.size_ << " "
+                      << desc.name << ":" << fletcher::ToString(buf.desc_) << "\n";
+        }
+      }
+    }
+  }
+
+  // Stream the raw bytes.
+  static const uint8_t zeros[4096] = {0};
+  StreamBuffers(meta_in, buffer_align,
+                [&](const uint8_t *data, size_t size) {
+                  out->write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+                },
+                [&](size_t size) {
+                  while (size > 0) {
+                    auto n = std::min(size, sizeof(zeros));
+                    out->write(reinterpret_cast<const char *>(zeros), static_cast<std::streamsize>(n));
+                    size -= n;
+                  }
+                });
+}
+
+namespace {
+
+/// Buffers that SREC data is decoded into, each starting at an offset in the SREC address space.
+struct BufferImage {
+  /// The SREC offsets of the buffers, in ascending order.
+  std::vector<uint64_t> offsets;
+  /// The buffers.
+  std::vector<std::shared_ptr<arrow::ResizableBuffer>> buffers;
+
+  /// @brief Make sure a buffer is at least some size, zero-filling any growth.
+  void Reserve(size_t b, int64_t size) {
+    auto &buf = buffers[b];
+    auto old_size = buf->size();
+    if (size > old_size) {
+      auto status = buf->Resize(std::max(size, 2 * old_size), false);
+      if (!status.ok()) {
+        throw std::runtime_error("Could not allocate SREC buffer: " + status.ToString());
+      }
+      std::memset(buf->mutable_data() + old_size, 0, buf->size() - old_size);
+    }
+  }
+
+  /// @brief Copy data at some SREC address into the buffers that cover it.
+  void Write(uint64_t address, const uint8_t *data, size_t size) {
+    if (offsets.empty()) {
+      return;
+    }
+    // Skip any data before the first buffer.
+    if (address < offsets[0]) {
+      auto skip = std::min<uint64_t>(size, offsets[0] - address);
+      address += skip;
+      data += skip;
+      size -= skip;
+    }
+    while (size > 0) {
+      auto b = static_cast<size_t>(std::upper_bound(offsets.begin(), offsets.end(), address) - offsets.begin() - 1);
+      size_t n = size;
+      if (b + 1 < offsets.size()) {
+        n = std::min<uint64_t>(n, offsets[b + 1] - address);
+      }
+      auto pos = static_cast<int64_t>(address - offsets[b]);
+      Reserve(b, pos + static_cast<int64_t>(n));
+      std::memcpy(buffers[b]->mutable_data() + pos, data, n);
+      address += n;
+      data += n;
+      size -= n;
+    }
+  }
+};
+
+/// @brief Decode an SREC stream into the buffers of an image, without materializing any Record.
+void DecodeSREC(std::istream *input, BufferImage *image) {
+  // A record holds at most 255 bytes after the byte count.
+  uint8_t data[256];
+  size_t line_no = 0;
+  for (std::string line; std::getline(*input, line);) {
+    line_no++;
+    if (line.empty() || (line == "\r")) {
+      continue;
+    }
+    RecordView record;
+    if (!RecordView::Parse(line.data(), line.size(), data, sizeof(data), &record)) {
+      throw std::runtime_error("Could not parse SREC line " + std::to_string(line_no) + ".");
+    }
+    // Only data records end up in the buffers.
+    switch (record.type()) {
+      case Record::DATA16:
+      case Record::DATA24:
+      case Record::DATA32:image->Write(record.address(), record.data(), record.size());
+        break;
+      default:break;
+    }
+  }
+}
+
+/// Takes decoded buffers in the order in which a RecordBatchLayout flattens them.
+struct BufferCursor {
+  BufferImage *image;
+  size_t next;
+
+  /// @brief Take the next buffer, sliced or grown to exactly some size.
+  std::shared_ptr<arrow::Buffer> Take(int64_t size) {
+    if (size < 0) {
+      throw std::runtime_error("SREC contains invalid offsets.");
+    }
+    auto b = next++;
+    image->Reserve(b, size);
+    return arrow::SliceBuffer(image->buffers[b], 0, size);
   }
 
-  free(srec_buffer);
+  /// @brief Take the next buffer as a validity bitmap, or nullptr if the SREC layout did not contain any bytes.
+  std::shared_ptr<arrow::Buffer> TakeValidity(int64_t length) {
+    auto b = next;
+    bool empty = (b + 1 < image->offsets.size()) ? image->offsets[b + 1] == image->offsets[b]
+                                                 : image->buffers[b]->size() == 0;
+    if (empty) {
+      next++;
+      return nullptr;
+    }
+    return Take((length + 7) / 8);
+  }
+
+  /// @brief Return the last offset of an offsets buffer of some length.
+  static int64_t LastOffset(const arrow::Buffer &offsets, int64_t length, bool large) {
+    if (large) {
+      return reinterpret_cast<const int64_t *>(offsets.data())[length];
+    }
+    return reinterpret_cast<const int32_t *>(offsets.data())[length];
+  }
+};
+
+/// @brief Reconstruct the ArrayData of a field from decoded buffers.
+std::shared_ptr<arrow::ArrayData> MakeArrayData(const arrow::Field &field, int64_t length, BufferCursor *cursor) {
+  std::shared_ptr<arrow::Buffer> validity;
+  int64_t null_count = 0;
+  if (field.nullable()) {
+    validity = cursor->TakeValidity(length);
+    if (validity != nullptr) {
+      null_count = arrow::kUnknownNullCount;
+    }
+  }
+  const auto &type = field.type();
+  bool large = (type->id() == arrow::Type::LARGE_STRING) || (type->id() == arrow::Type::LARGE_BINARY)
+      || (type->id() == arrow::Type::LARGE_LIST);
+  auto offset_size = large ? sizeof(int64_t) : sizeof(int32_t);
+  switch (type->id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY: {
+      auto offsets = cursor->Take((length + 1) * offset_size);
+      auto values = cursor->Take(BufferCursor::LastOffset(*offsets, length, large));
+      return arrow::ArrayData::Make(type, length, {validity, offsets, values}, null_count);
+    }
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
+      auto offsets = cursor->Take((length + 1) * offset_size);
+      auto child = MakeArrayData(*type->field(0), BufferCursor::LastOffset(*offsets, length, large), cursor);
+      if (child == nullptr) {
+        return nullptr;
+      }
+      return arrow::ArrayData::Make(type, length, {validity, offsets}, {child}, null_count);
+    }
+    case arrow::Type::STRUCT: {
+      std::vector<std::shared_ptr<arrow::ArrayData>> children;
+      for (int i = 0; i < type->num_fields(); i++) {
+        auto child = MakeArrayData(*type->field(i), length, cursor);
+        if (child == nullptr) {
+          return nullptr;
+        }
+        children.push_back(child);
+      }
+      return arrow::ArrayData::Make(type, length, {validity}, children, null_count);
+    }
+    default: {
+      auto fixed = std::dynamic_pointer_cast<arrow::FixedWidthType>(type);
+      if (fixed == nullptr) {
+        FLETCHER_LOG(ERROR, "Cannot read " + type->ToString() + " from SREC.");
+        return nullptr;
+      }
+      auto values = cursor->Take((length * fixed->bit_width() + 7) / 8);
+      return arrow::ArrayData::Make(type, length, {validity, values}, null_count);
+    }
+  }
 }
 
+}  // namespace
+
 std::vector<std::shared_ptr<arrow::RecordBatch>>
 ReadRecordBatchesFromSREC(std::istream *input,
                           const std::vector<std::shared_ptr<arrow::Schema>> &schemas,
                           const std::vector<uint64_t> &num_rows,
                           const std::vector<uint64_t> &buf_offsets) {
   std::vector<std::shared_ptr<arrow::RecordBatch>> ret;
-  // TODO(johanpel): implement this
-  FLETCHER_LOG(ERROR, "SREC to RecordBatch not yet implemented.");
+  if (schemas.size() != num_rows.size()) {
+    FLETCHER_LOG(ERROR, "Number of Schemas and number of RecordBatch row counts do not match.");
+    return ret;
+  }
+
+  // Count the flattened buffers of every Schema, in the same way GenerateReadSREC lays them out.
+  size_t num_buffers = 0;
+  for (const auto &schema : schemas) {
+    std::shared_ptr<fletcher::RecordBatchLayout> layout;
+    if (!fletcher::RecordBatchLayout::Make(schema, &layout)) {
+      FLETCHER_LOG(ERROR, "Schema " + fletcher::GetMeta(*schema, fletcher::meta::NAME) + " cannot be read from SREC.");
+      return ret;
+    }
+    for (const auto &f : layout->description().fields) {
+      num_buffers += f.buffers.size();
+    }
+  }
+  if (buf_offsets.size() != num_buffers) {
+    FLETCHER_LOG(ERROR, "Expected " + std::to_string(num_buffers) + " SREC buffer offsets, got "
+        + std::to_string(buf_offsets.size()) + ".");
+    return ret;
+  }
+  if (!std::is_sorted(buf_offsets.begin(), buf_offsets.end())) {
+    FLETCHER_LOG(ERROR, "SREC buffer offsets must be in ascending order.");
+    return ret;
+  }
+
+  // Preallocate the buffers. Each buffer spans up to the next one, the last one grows as data arrives.
+  BufferImage image;
+  image.offsets = buf_offsets;
+  for (size_t b = 0; b < num_buffers; b++) {
+    int64_t size = (b + 1 < num_buffers) ? static_cast<int64_t>(buf_offsets[b + 1] - buf_offsets[b]) : 0;
+    auto result = arrow::AllocateResizableBuffer(size);
+    if (!result.ok()) {
+      FLETCHER_LOG(ERROR, "Could not allocate SREC buffer: " + result.status().ToString());
+      return ret;
+    }
+    std::shared_ptr<arrow::ResizableBuffer> buffer = std::move(result).ValueOrDie();
+    if (size > 0) {
+      std::memset(buffer->mutable_data(), 0, size);
+    }
+    image.buffers.push_back(buffer);
+  }
+
+  // Decode all data records in a single pass.
+  DecodeSREC(input, &image);
+
+  // Wrap the buffers in RecordBatches.
+  BufferCursor cursor{&image, 0};
+  for (size_t r = 0; r < schemas.size(); r++) {
+    const auto &schema = schemas[r];
+    auto rows = static_cast<int64_t>(num_rows[r]);
+    std::vector<std::shared_ptr<arrow::ArrayData>> columns;
+    for (int f = 0; f < schema->num_fields(); f++) {
+      auto column = MakeArrayData(*schema->field(f), rows, &cursor);
+      if (column == nullptr) {
+        return {};
+      }
+      columns.push_back(column);
+    }
+    ret.push_back(arrow::RecordBatch::Make(schema, rows, columns));
+  }
   return ret;
 }
 
@@ -39,6 +39,25 @@ void GenerateReadSREC(const std::vector<fletcher::RecordBatchDescription> &meta_
                       std::ofstream *out,
                       int64_t buffer_align);
 
+/**
+ * @brief Generate and save a raw binary memory image from a bunch of RecordBatches.
+ *
+ * The image uses the same layout as GenerateReadSREC, but contains the raw bytes, starting at address 0. It is roughly
+ * half the size of the equivalent SREC file and requires no parsing to load.
+ *
+ * @param meta_in       The RecordBatch descriptions.
+ * @param meta_out      Metadata output about saved RecordBatches.
+ * @param out           Output stream to write the image to.
+ * @param manifest      Output stream to write a manifest to, with one "<offset> <size> <recordbatch>:<buffer>" line
+ *                      per buffer.
+ * @param buffer_align  Alignment in bytes for every RecordBatch buffer.
+ */
+void GenerateReadImage(const std::vector<fletcher::RecordBatchDescription> &meta_in,
+                       std::vector<fletcher::RecordBatchDescription> *meta_out,
+                       std::ofstream *out,
+                       std::ostream *manifest,
+                       int64_t buffer_align);
+
 /**
  * Write SREC formatted RecordBatches to an output stream.
  * @param output        The output stream to write to.
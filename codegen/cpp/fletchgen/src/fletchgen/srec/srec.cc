@@ -28,46 +28,56 @@ Record::Record(Type type, uint32_t address, const uint8_t *data, size_t size)
     throw std::domain_error("SREC Record size cannot exceed " + std::to_string(MAX_DATA_BYTES) + " bytes.");
   }
   if (size_ > 0) {
-    // Allocate buffer for data
-    data_ = static_cast<uint8_t *>(calloc(1, size_));
     // Copy data over
     memcpy(data_, data, size);
   }
 }
 
-Record::~Record() {
-  if (size_ > 0) {
-    free(data_);
-  }
-}
-
 Record Record::Header(const std::string &header_str, uint16_t address) {
-  auto str = header_str.substr(0, std::max(MAX_DATA_BYTES, header_str.size()));
+  auto str = header_str.substr(0, std::min(MAX_DATA_BYTES, header_str.size()));
   return Record(Record::HEADER, address, (const uint8_t *) (str.c_str()), str.size());
 }
 
-uint8_t Record::byte_count() {
-  return address_width() + size_ + 1;
+RecordView Record::view() const {
+  return RecordView(type_, address_, data_, size_);
+}
+
+std::string Record::ToString(bool line_feed) const {
+  char line[MAX_LINE_LENGTH];
+  return std::string(line, view().Format(line, line_feed));
 }
 
-int Record::address_width() {
-  switch (type_) {
-    case DATA24: return 3;
-    case COUNT24: return 3;
-    case TERM24: return 3;
-    case DATA32: return 4;
-    case TERM32: return 4;
+std::optional<Record> Record::FromString(const std::string &line) {
+  uint8_t data[MAX_DATA_BYTES];
+  RecordView view;
+  if (!RecordView::Parse(line.data(), line.size(), data, MAX_DATA_BYTES, &view)) {
+    return std::nullopt;
+  }
+  return Record(view.type(), view.address(), view.data(), view.size());
+}
+
+int RecordView::address_width(Record::Type type) {
+  switch (type) {
+    case Record::DATA24: return 3;
+    case Record::COUNT24: return 3;
+    case Record::TERM24: return 3;
+    case Record::DATA32: return 4;
+    case Record::TERM32: return 4;
     default:return 2;
   }
 }
 
-uint8_t Record::checksum() {
+uint8_t RecordView::byte_count() const {
+  return address_width(type_) + size_ + 1;
+}
+
+uint8_t RecordView::checksum() const {
   uint32_t sum = 0;
   // Byte count
   sum += byte_count();
   // Address
-  if (address_width() > 3) sum += (address_ & 0xFF000000u) >> 24u;
-  if (address_width() > 2) sum += (address_ & 0x00FF0000u) >> 16u;
+  if (address_width(type_) > 3) sum += (address_ & 0xFF000000u) >> 24u;
+  if (address_width(type_) > 2) sum += (address_ & 0x00FF0000u) >> 16u;
   sum += (address_ & 0x0000FF00u) >> 8u;
   sum += (address_ & 0x000000FFu);
   // Data
@@ -81,80 +91,85 @@ uint8_t Record::checksum() {
   return ret;
 }
 
-std::string Record::ToString(bool line_feed) {
-  // String stream to build output
-  std::stringstream output;
+size_t RecordView::Format(char *line, bool line_feed) const {
+  char *pos = line;
   // Record type
-  output << 'S' << std::to_string(type_);
+  *pos++ = 'S';
+  *pos++ = hex::kDigits[type_];
   // Byte count
-  PutHex(output, byte_count());
+  pos = hex::PutByte(pos, byte_count());
   // Address
-  PutHex(output, address_, 2 * address_width());
+  for (int i = address_width(type_) - 1; i >= 0; i--) {
+    pos = hex::PutByte(pos, static_cast<uint8_t>(address_ >> (8u * i)));
+  }
   // Data
   for (size_t i = 0; i < size_; i++) {
-    PutHex(output, data_[i]);
+    pos = hex::PutByte(pos, data_[i]);
   }
   // Checksum
-  PutHex(output, checksum());
+  pos = hex::PutByte(pos, checksum());
   // Line feed
   if (line_feed) {
-    output << std::endl;
+    *pos++ = '\n';
   }
-  return output.str();
+  return pos - line;
 }
 
-std::optional<Record> Record::FromString(const std::string &line) {
-  // TODO(johanpel): make this function not break on big endian systems
-  size_t offset = 0;
-  Record ret(RESERVED, 0, nullptr, 0);
-
-  // Check if line starts with S (1 character)
-  if (line.substr(offset, 1) != "S") {
-    return std::nullopt;
+bool RecordView::Parse(const char *line, size_t length, uint8_t *data, size_t capacity, RecordView *out) {
+  // Ignore any line endings.
+  while ((length > 0) && ((line[length - 1] == '\r') || (line[length - 1] == '\n'))) {
+    length--;
   }
-  offset++;
-
-  // Get type (1 character)
-  uint64_t t = std::stoul(line.substr(offset, 1), nullptr, 16);
-  if (t > 9) {
-    return std::nullopt;
+  // Check if line starts with S, a type, and a whole number of bytes.
+  if ((length < 4) || (line[0] != 'S') || (length % 2 != 0)) {
+    return false;
   }
-  ret.type_ = static_cast<Type>(t);
-  offset++;
-
-  // Get size (2 characters, 1 byte), subtract address width and checksum
-  ret.size_ = std::stoul(line.substr(offset, 2), nullptr, 16) - ret.address_width() - 1;
-  if (ret.size_ > MAX_DATA_BYTES) {
-    return std::nullopt;
+  int type = hex::GetDigit(line[1]);
+  if ((type < 0) || (type > 9)) {
+    return false;
   }
-  offset += 2;
+  const char *pos = line + 2;
 
-  // Obtain the address (addr. width * (2 chars or 1 byte))
-  uint32_t addr = 0;
-  for (int i = ret.address_width() - 1; i >= 0; i--) {
-    uint8_t byte = static_cast<uint8_t>(std::stoul(line.substr(offset, 2), nullptr, 16));
-    addr |= static_cast<uint32_t>(byte) << (8u * i);
-    offset += 2;
+  // Get the byte count, which must match the line length, and subtract address width and checksum.
+  int count = hex::GetByte(pos);
+  pos += 2;
+  if ((count < 0) || (static_cast<size_t>(count) != (length - 2) / 2 - 1)) {
+    return false;
+  }
+  auto t = static_cast<Record::Type>(type);
+  int width = address_width(t);
+  if (count < width + 1) {
+    return false;
+  }
+  size_t size = count - width - 1;
+  if (size > capacity) {
+    return false;
   }
-  ret.address_ = addr;
-
-  // Reserve a data buffer
-  ret.data_ = static_cast<uint8_t *>(calloc(ret.size_, sizeof(uint8_t)));
 
-  // Obtain the data (2 chars or 1 byte)
-  for (size_t i = 0; i < ret.size_; i++) {
-    auto byte = static_cast<uint8_t>(std::stoul(line.substr(offset, 2), nullptr, 16));
-    ret.data_[i] = byte;
-    offset += 2;
+  // Obtain the address.
+  uint32_t address = 0;
+  for (int i = 0; i < width; i++) {
+    int byte = hex::GetByte(pos);
+    if (byte < 0) {
+      return false;
+    }
+    address = (address << 8u) | static_cast<uint32_t>(byte);
+    pos += 2;
   }
 
-  // Validate checksum
-  uint8_t sum = static_cast<uint8_t>(std::stoul(line.substr(offset, 2), nullptr, 16));
-  if (ret.checksum() != sum) {
-    return std::nullopt;
+  // Obtain the data.
+  for (size_t i = 0; i < size; i++) {
+    int byte = hex::GetByte(pos);
+    if (byte < 0) {
+      return false;
+    }
+    data[i] = static_cast<uint8_t>(byte);
+    pos += 2;
   }
 
-  return ret;
+  // Validate checksum
+  *out = RecordView(t, address, data, size);
+  return hex::GetByte(pos) == out->checksum();
 }
 
 File::File(uint32_t start_address, const uint8_t *data, size_t size, const std::string &header_str) {
@@ -179,10 +194,53 @@ File::File(uint32_t start_address, const uint8_t *data, size_t size, const std::
   }
 }
 
+Writer::Writer(std::ostream *output, uint32_t start_address, const std::string &header_str)
+    : output_(output), address_(start_address) {
+  output_->write(text_, Record::Header(header_str).view().Format(text_, true));
+}
+
+void Writer::Emit() {
+  output_->write(text_, RecordView(Record::DATA32, address_, line_, fill_).Format(text_, true));
+  address_ += static_cast<uint32_t>(fill_);
+  fill_ = 0;
+}
+
+void Writer::Write(const uint8_t *data, size_t size) {
+  while (size > 0) {
+    auto n = std::min(size, Record::MAX_DATA_BYTES - fill_);
+    std::memcpy(line_ + fill_, data, n);
+    fill_ += n;
+    data += n;
+    size -= n;
+    if (fill_ == Record::MAX_DATA_BYTES) {
+      Emit();
+    }
+  }
+}
+
+void Writer::Pad(size_t size) {
+  while (size > 0) {
+    auto n = std::min(size, Record::MAX_DATA_BYTES - fill_);
+    std::memset(line_ + fill_, 0, n);
+    fill_ += n;
+    size -= n;
+    if (fill_ == Record::MAX_DATA_BYTES) {
+      Emit();
+    }
+  }
+}
+
+void Writer::Flush() {
+  if (fill_ > 0) {
+    Emit();
+  }
+}
+
 void File::write(std::ostream *output) {
   if (output->good()) {
-    for (auto &r : records) {
-      (*output) << r.ToString(true);
+    char line[Record::MAX_LINE_LENGTH];
+    for (const auto &r : records) {
+      output->write(line, r.view().Format(line, true));
     }
   } else {
     FLETCHER_LOG(ERROR, "Could not write SREC file to output stream.");
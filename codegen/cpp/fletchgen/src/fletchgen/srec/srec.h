@@ -28,6 +28,54 @@
 
 namespace fletchgen::srec {
 
+/// Table-driven hexadecimal encoding and decoding.
+namespace hex {
+
+/// Upper case hexadecimal digits.
+inline constexpr char kDigits[] = "0123456789ABCDEF";
+
+/// Table mapping characters to their hexadecimal value, or -1.
+struct DecodeTable {
+  int8_t values[256];
+  constexpr DecodeTable() : values() {
+    for (auto &v : values) v = -1;
+    for (int i = 0; i < 10; i++) values['0' + i] = static_cast<int8_t>(i);
+    for (int i = 0; i < 6; i++) {
+      values['A' + i] = static_cast<int8_t>(10 + i);
+      values['a' + i] = static_cast<int8_t>(10 + i);
+    }
+  }
+};
+
+/// The hexadecimal decoding table.
+inline constexpr DecodeTable kDecodeTable;
+
+/// @brief Write a byte as two hexadecimal characters. Returns the position after the written characters.
+inline char *PutByte(char *out, uint8_t byte) {
+  out[0] = kDigits[byte >> 4u];
+  out[1] = kDigits[byte & 0xFu];
+  return out + 2;
+}
+
+/// @brief Return the value of a hexadecimal character, or -1 if it is not one.
+inline int GetDigit(char c) {
+  return kDecodeTable.values[static_cast<uint8_t>(c)];
+}
+
+/// @brief Decode two hexadecimal characters into a byte. Returns -1 if either character is not hexadecimal.
+inline int GetByte(const char *in) {
+  int hi = GetDigit(in[0]);
+  int lo = GetDigit(in[1]);
+  if ((hi | lo) < 0) {
+    return -1;
+  }
+  return (hi << 4) | lo;
+}
+
+}  // namespace hex
+
+class RecordView;
+
 /**
  * @brief Structure to build up a single Record of an SREC file.
  */
@@ -35,6 +83,8 @@ class Record {
  public:
   /// Maximum number of data bytes per Record.
   static constexpr size_t MAX_DATA_BYTES = 32;
+  /// Maximum number of characters of a Record line, including a line feed.
+  static constexpr size_t MAX_LINE_LENGTH = 2 + 2 * (1 + 4 + MAX_DATA_BYTES + 1) + 1;
 
   /**
    * @brief The SREC Record type.
@@ -52,9 +102,6 @@ class Record {
     TERM16 = 9
   };
 
-  /// @brief SREC Record copy constructor
-  Record(const Record &rec) : Record(rec.type_, rec.address_, rec.data_, rec.size_) {}
-
   /**
    * @brief SREC Record constructor. Data is copied into the Record.
    * @param type    The type of the SREC record.
@@ -64,9 +111,6 @@ class Record {
    */
   Record(Type type, uint32_t address, const uint8_t *data, size_t size);
 
-  /// @brief Record destructor.
-  ~Record();
-
   /// @brief Attempt to construct a Record from a string.
   static std::optional<Record> FromString(const std::string &line);
 
@@ -100,14 +144,16 @@ class Record {
   }
 
   /// @brief Return the SREC Record string
-  std::string ToString(bool line_feed = false);
+  [[nodiscard]] std::string ToString(bool line_feed = false) const;
 
   /// @brief Return the address of this record.
   [[nodiscard]] inline uint32_t address() const { return address_; }
   /// @brief Return the size in bytes of this record.
   [[nodiscard]] inline size_t size() const { return size_; }
   /// @brief Return the data source pointer of this record.
-  [[nodiscard]] inline uint8_t *data() const { return data_; }
+  [[nodiscard]] inline const uint8_t *data() const { return data_; }
+  /// @brief Return a view on this record.
+  [[nodiscard]] RecordView view() const;
 
  private:
   /// Record type.
@@ -117,20 +163,124 @@ class Record {
   /// Record address.
   uint32_t address_ = 0;
   /// Record data.
-  uint8_t *data_ = nullptr;
+  uint8_t data_[MAX_DATA_BYTES] = {0};
+};
+
+/**
+ * @brief A Record that points to its data rather than owning it.
+ *
+ * Formatting and parsing work on caller-provided buffers, such that streaming large SREC files does not allocate.
+ */
+class RecordView {
+ public:
+  /// @brief Construct an empty header record view.
+  RecordView() = default;
+
+  /**
+   * @brief Construct a new RecordView.
+   * @param type    The type of the SREC record.
+   * @param address The address of the data in the SREC file.
+   * @param data    The data, which must outlive the view.
+   * @param size    The size of the data in bytes.
+   */
+  RecordView(Record::Type type, uint32_t address, const uint8_t *data, size_t size)
+      : type_(type), size_(size), address_(address), data_(data) {}
+
+  /**
+   * @brief Format the record line.
+   * @param line      The output, with room for at least Record::MAX_LINE_LENGTH characters. Not null-terminated.
+   * @param line_feed Whether to append a line feed.
+   * @return          The number of characters written.
+   */
+  size_t Format(char *line, bool line_feed = false) const;
 
-  /// @brief Return the number of bytes of the address field.
-  int address_width();
+  /**
+   * @brief Parse a record line.
+   *
+   * Trailing carriage returns and line feeds are ignored.
+   *
+   * @param line      The line.
+   * @param length    The number of characters of the line.
+   * @param data      The buffer to decode data bytes into. The view will point to this buffer.
+   * @param capacity  The size of the data buffer in bytes.
+   * @param out       The resulting view.
+   * @return          True if the line is a valid record with at most capacity data bytes, false otherwise.
+   */
+  static bool Parse(const char *line, size_t length, uint8_t *data, size_t capacity, RecordView *out);
+
+  /// @brief Return the type of this record.
+  [[nodiscard]] inline Record::Type type() const { return type_; }
+  /// @brief Return the address of this record.
+  [[nodiscard]] inline uint32_t address() const { return address_; }
+  /// @brief Return the size in bytes of this record.
+  [[nodiscard]] inline size_t size() const { return size_; }
+  /// @brief Return the data of this record.
+  [[nodiscard]] inline const uint8_t *data() const { return data_; }
+
+  /// @brief Return the number of bytes of the address field of a record type.
+  static int address_width(Record::Type type);
   /// @brief Return the byte count of this Record.
-  uint8_t byte_count();
+  [[nodiscard]] uint8_t byte_count() const;
   /// @brief Return the checksum of this Record.
-  uint8_t checksum();
+  [[nodiscard]] uint8_t checksum() const;
+
+ private:
+  /// Record type.
+  Record::Type type_ = Record::HEADER;
+  /// Record size in number of data bytes.
+  size_t size_ = 0;
+  /// Record address.
+  uint32_t address_ = 0;
+  /// Record data.
+  const uint8_t *data_ = nullptr;
 };
 
 inline void PutHex(std::stringstream &stream, uint32_t val, int characters = 2) {
   stream << std::uppercase << std::hex << std::setfill('0') << std::setw(characters) << val;
 }
 
+/**
+ * @brief Streams data into an SREC output stream, one Record at a time.
+ *
+ * Data is cut into MAX_DATA_BYTES data records at consecutive addresses, regardless of how it is spread over calls
+ * to Write and Pad, so the output is identical to that of a File constructed from the concatenated data.
+ */
+class Writer {
+ public:
+  /**
+   * @brief Construct a new Writer and write the header record.
+   * @param output        The output stream to write to.
+   * @param start_address The address of the first data byte.
+   * @param header_str    The header string. Default is commonly used "HDR".
+   */
+  explicit Writer(std::ostream *output, uint32_t start_address = 0, const std::string &header_str = "HDR");
+
+  /// @brief Append data to the output.
+  void Write(const uint8_t *data, size_t size);
+  /// @brief Append zero bytes to the output.
+  void Pad(size_t size);
+  /// @brief Write any pending bytes as a final, possibly shorter, record.
+  void Flush();
+
+  /// @brief Return the address of the next byte to be written.
+  [[nodiscard]] inline uint32_t address() const { return static_cast<uint32_t>(address_ + fill_); }
+
+ private:
+  /// @brief Write the pending line as a data record.
+  void Emit();
+
+  /// The output stream.
+  std::ostream *output_;
+  /// Address of the first pending byte.
+  uint32_t address_;
+  /// Pending bytes of the next record.
+  uint8_t line_[Record::MAX_DATA_BYTES] = {0};
+  /// Number of pending bytes.
+  size_t fill_ = 0;
+  /// Reusable buffer for formatted records.
+  char text_[Record::MAX_LINE_LENGTH] = {0};
+};
+
 /**
  * @brief Structure to build up an SREC file with multiple Record lines.
  */
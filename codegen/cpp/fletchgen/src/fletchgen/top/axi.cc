@@ -16,7 +16,13 @@
 
 #include <cerata/api.h>
 #include <cerata/vhdl/vhdl.h>
+#include <fletcher/common.h>
+#include <fletcher/fletcher.h>
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <cerata/api.h>
 #include <cerata/vhdl/vhdl.h>
@@ -28,11 +34,411 @@ namespace fletchgen::top {
 
 using cerata::vhdl::Template;
 
+/// A port of the mantle that is connected to a signal of the top level.
+struct PortSignal {
+  /// The name of the mantle port.
+  std::string port;
+  /// The signal in the top level it connects to when there is a single instance.
+  std::string single;
+  /// The concatenated signal in the top level it connects to when there are multiple instances.
+  std::string multi;
+  /// The width of the port, or empty if the port is a std_logic.
+  std::string width;
+};
+
+static const std::vector<PortSignal> read_ports = {
+    {"rd_mst_rreq_valid", "rd_mst_rreq_valid", "bsv_rreq_valid", ""},
+    {"rd_mst_rreq_ready", "rd_mst_rreq_ready", "bsv_rreq_ready", ""},
+    {"rd_mst_rreq_addr", "rd_mst_rreq_addr", "bsv_rreq_addr", "BUS_ADDR_WIDTH"},
+    {"rd_mst_rreq_len", "rd_mst_rreq_len", "bsv_rreq_len", "BUS_LEN_WIDTH"},
+    {"rd_mst_rdat_valid", "rd_mst_rdat_valid", "bsv_rdat_valid", ""},
+    {"rd_mst_rdat_ready", "rd_mst_rdat_ready", "bsv_rdat_ready", ""},
+    {"rd_mst_rdat_data", "rd_mst_rdat_data", "bsv_rdat_data", "BUS_DATA_WIDTH"},
+    {"rd_mst_rdat_last", "rd_mst_rdat_last", "bsv_rdat_last", ""}};
+
+static const std::vector<PortSignal> write_ports = {
+    {"wr_mst_wreq_valid", "wr_mst_wreq_valid", "bsv_wreq_valid", ""},
+    {"wr_mst_wreq_ready", "wr_mst_wreq_ready", "bsv_wreq_ready", ""},
+    {"wr_mst_wreq_addr", "wr_mst_wreq_addr", "bsv_wreq_addr", "BUS_ADDR_WIDTH"},
+    {"wr_mst_wreq_len", "wr_mst_wreq_len", "bsv_wreq_len", "BUS_LEN_WIDTH"},
+    {"wr_mst_wreq_last", "wr_mst_wreq_last", "bsv_wreq_last", ""},
+    {"wr_mst_wdat_valid", "wr_mst_wdat_valid", "bsv_wdat_valid", ""},
+    {"wr_mst_wdat_ready", "wr_mst_wdat_ready", "bsv_wdat_ready", ""},
+    {"wr_mst_wdat_data", "wr_mst_wdat_data", "bsv_wdat_data", "BUS_DATA_WIDTH"},
+    {"wr_mst_wdat_strobe", "wr_mst_wdat_strobe", "bsv_wdat_strobe", "BUS_DATA_WIDTH/8"},
+    {"wr_mst_wdat_last", "wr_mst_wdat_last", "bsv_wdat_last", ""},
+    {"wr_mst_wrep_valid", "wr_mst_wrep_valid", "bsv_wrep_valid", ""},
+    {"wr_mst_wrep_ready", "wr_mst_wrep_ready", "bsv_wrep_ready", ""},
+    {"wr_mst_wrep_ok", "wr_mst_wrep_ok", "bsv_wrep_ok", ""}};
+
+/// AXI read converter of memory interface channel 0.
+static const char axi_read_converter[] =
+    "  -----------------------------------------------------------------------------\n"
+    "  -- AXI read converter\n"
+    "  -----------------------------------------------------------------------------\n"
+    "  -- Buffering bursts is disabled by default (ENABLE_FIFO=false) because\n"
+    "  -- BufferReaders are already able to absorb full bursts.\n"
+    "  axi_read_conv_inst: AxiReadConverter\n"
+    "    generic map (\n"
+    "      ADDR_WIDTH                => BUS_ADDR_WIDTH,\n"
+    "      MASTER_DATA_WIDTH         => BUS_DATA_WIDTH,\n"
+    "      MASTER_LEN_WIDTH          => BUS_LEN_WIDTH,\n"
+    "      SLAVE_DATA_WIDTH          => BUS_DATA_WIDTH,\n"
+    "      SLAVE_LEN_WIDTH           => BUS_LEN_WIDTH,\n"
+    "      SLAVE_MAX_BURST           => BUS_BURST_MAX_LEN,\n"
+    "      ENABLE_FIFO               => ${ENABLE_FIFO},\n"
+    "      SLV_REQ_SLICE_DEPTH       => ${SLV_REQ_SLICE_DEPTH},\n"
+    "      SLV_DAT_SLICE_DEPTH       => ${SLV_DAT_SLICE_DEPTH},\n"
+    "      MST_REQ_SLICE_DEPTH       => ${MST_REQ_SLICE_DEPTH},\n"
+    "      MST_DAT_SLICE_DEPTH       => ${MST_DAT_SLICE_DEPTH}\n"
+    "    )\n"
+    "    port map (\n"
+    "      clk                       => bcd_clk,\n"
+    "      reset_n                   => bcd_reset_n,\n"
+    "      slv_bus_rreq_addr         => rd_mst_rreq_addr,\n"
+    "      slv_bus_rreq_len          => rd_mst_rreq_len,\n"
+    "      slv_bus_rreq_valid        => rd_mst_rreq_valid,\n"
+    "      slv_bus_rreq_ready        => rd_mst_rreq_ready,\n"
+    "      slv_bus_rdat_data         => rd_mst_rdat_data,\n"
+    "      slv_bus_rdat_last         => rd_mst_rdat_last,\n"
+    "      slv_bus_rdat_valid        => rd_mst_rdat_valid,\n"
+    "      slv_bus_rdat_ready        => rd_mst_rdat_ready,\n"
+    "      m_axi_araddr              => m_axi_araddr,\n"
+    "      m_axi_arlen               => m_axi_arlen,\n"
+    "      m_axi_arvalid             => m_axi_arvalid,\n"
+    "      m_axi_arready             => m_axi_arready,\n"
+    "      m_axi_arsize              => m_axi_arsize,\n"
+    "      m_axi_rdata               => m_axi_rdata,\n"
+    "      m_axi_rlast               => m_axi_rlast,\n"
+    "      m_axi_rvalid              => m_axi_rvalid,\n"
+    "      m_axi_rready              => m_axi_rready\n"
+    "    );";
+
+/// AXI write converter of memory interface channel 0.
+static const char axi_write_converter[] =
+    "  -----------------------------------------------------------------------------\n"
+    "  -- AXI write converter\n"
+    "  -----------------------------------------------------------------------------\n"
+    "  -- Buffering bursts is disabled by default (ENABLE_FIFO=false) because\n"
+    "  -- BufferWriters are already able to absorb full bursts.\n"
+    "  axi_write_conv_inst: AxiWriteConverter\n"
+    "    generic map (\n"
+    "      ADDR_WIDTH                => BUS_ADDR_WIDTH,\n"
+    "      MASTER_DATA_WIDTH         => BUS_DATA_WIDTH,\n"
+    "      MASTER_LEN_WIDTH          => BUS_LEN_WIDTH,\n"
+    "      SLAVE_DATA_WIDTH          => BUS_DATA_WIDTH,\n"
+    "      SLAVE_LEN_WIDTH           => BUS_LEN_WIDTH,\n"
+    "      SLAVE_MAX_BURST           => BUS_BURST_MAX_LEN,\n"
+    "      ENABLE_FIFO               => ${ENABLE_FIFO},\n"
+    "      SLV_REQ_SLICE_DEPTH       => ${SLV_REQ_SLICE_DEPTH},\n"
+    "      SLV_DAT_SLICE_DEPTH       => ${SLV_DAT_SLICE_DEPTH},\n"
+    "      MST_REQ_SLICE_DEPTH       => ${MST_REQ_SLICE_DEPTH},\n"
+    "      MST_DAT_SLICE_DEPTH       => ${MST_DAT_SLICE_DEPTH}\n"
+    "    )\n"
+    "    port map (\n"
+    "      clk                       => bcd_clk,\n"
+    "      reset_n                   => bcd_reset_n,\n"
+    "      slv_bus_wreq_addr         => wr_mst_wreq_addr,\n"
+    "      slv_bus_wreq_len          => wr_mst_wreq_len,\n"
+    "      slv_bus_wreq_valid        => wr_mst_wreq_valid,\n"
+    "      slv_bus_wreq_ready        => wr_mst_wreq_ready,\n"
+    "      slv_bus_wreq_last         => wr_mst_wreq_last,\n"
+    "      slv_bus_wdat_data         => wr_mst_wdat_data,\n"
+    "      slv_bus_wdat_strobe       => wr_mst_wdat_strobe,\n"
+    "      slv_bus_wdat_last         => wr_mst_wdat_last,\n"
+    "      slv_bus_wdat_valid        => wr_mst_wdat_valid,\n"
+    "      slv_bus_wdat_ready        => wr_mst_wdat_ready,\n"
+    "      slv_bus_wrep_valid        => wr_mst_wrep_valid,\n"
+    "      slv_bus_wrep_ready        => wr_mst_wrep_ready,\n"
+    "      slv_bus_wrep_ok           => wr_mst_wrep_ok,\n"
+    "      m_axi_awaddr              => m_axi_awaddr,\n"
+    "      m_axi_awlen               => m_axi_awlen,\n"
+    "      m_axi_awvalid             => m_axi_awvalid,\n"
+    "      m_axi_awready             => m_axi_awready,\n"
+    "      m_axi_awsize              => m_axi_awsize,\n"
+    "      m_axi_awuser              => m_axi_awuser,\n"
+    "      m_axi_wdata               => m_axi_wdata,\n"
+    "      m_axi_wstrb               => m_axi_wstrb,\n"
+    "      m_axi_wlast               => m_axi_wlast,\n"
+    "      m_axi_wvalid              => m_axi_wvalid,\n"
+    "      m_axi_wready              => m_axi_wready,\n"
+    "      m_axi_bvalid              => m_axi_bvalid,\n"
+    "      m_axi_bready              => m_axi_bready,\n"
+    "      m_axi_bresp               => m_axi_bresp\n"
+    "    );";
+
+/// The AXI4 master ports of the top level, except for the "m_axi_" prefix.
+static const std::vector<std::pair<std::string, std::string>> axi_master_ports = {
+    {"araddr", "out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0)"},
+    {"arlen", "out std_logic_vector(BUS_LEN_WIDTH-1 downto 0)"},
+    {"arvalid", "out std_logic := '0'"},
+    {"arready", "in  std_logic"},
+    {"arsize", "out std_logic_vector(2 downto 0)"},
+    {"rdata", "in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0)"},
+    {"rresp", "in  std_logic_vector(1 downto 0)"},
+    {"rlast", "in  std_logic"},
+    {"rvalid", "in  std_logic"},
+    {"rready", "out std_logic := '0'"},
+    {"awvalid", "out std_logic := '0'"},
+    {"awready", "in  std_logic"},
+    {"awaddr", "out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0)"},
+    {"awlen", "out std_logic_vector(BUS_LEN_WIDTH-1 downto 0)"},
+    {"awsize", "out std_logic_vector(2 downto 0)"},
+    {"awuser", "out std_logic_vector(0 downto 0)"},
+    {"wvalid", "out std_logic := '0'"},
+    {"wready", "in  std_logic"},
+    {"wdata", "out std_logic_vector(BUS_DATA_WIDTH-1 downto 0)"},
+    {"wlast", "out std_logic"},
+    {"wstrb", "out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0)"},
+    {"bvalid", "in  std_logic"},
+    {"bready", "out std_logic"},
+    {"bresp", "in  std_logic_vector(1 downto 0)"}};
+
+/// @brief Return some text with all occurrences of a string replaced by another string.
+static std::string ReplaceAll(std::string text, const std::string &from, const std::string &to) {
+  for (auto pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size())) {
+    text.replace(pos, from.size(), to);
+  }
+  return text;
+}
+
+/// @brief Rename the signals and instances of memory interface channel 0 in some VHDL text to those of a channel.
+static std::string ForChannel(const std::string &text, uint32_t channel) {
+  if (channel == 0) {
+    return text;
+  }
+  auto ch = "_ch" + std::to_string(channel);
+  auto result = ReplaceAll(text, "rd_mst_", MasterPortName(BusFunction::READ, channel) + "_");
+  result = ReplaceAll(result, "wr_mst_", MasterPortName(BusFunction::WRITE, channel) + "_");
+  // Only rename the top-level AXI signals, not the ports of the converters.
+  result = ReplaceAll(result, "=> m_axi_", "=> m_axi" + ch + "_");
+  result = ReplaceAll(result, "_conv_inst", "_conv" + ch + "_inst");
+  return result;
+}
+
+/// @brief Set the buffering generics of an AXI converter to those of a converter configuration.
+static std::string Configure(const std::string &text, const AxiConverterConfig &config) {
+  auto result = ReplaceAll(text, "${ENABLE_FIFO}", config.enable_fifo ? "true" : "false");
+  result = ReplaceAll(result, "${SLV_REQ_SLICE_DEPTH}", std::to_string(config.slv_req_slice_depth));
+  result = ReplaceAll(result, "${SLV_DAT_SLICE_DEPTH}", std::to_string(config.slv_dat_slice_depth));
+  result = ReplaceAll(result, "${MST_REQ_SLICE_DEPTH}", std::to_string(config.mst_req_slice_depth));
+  result = ReplaceAll(result, "${MST_DAT_SLICE_DEPTH}", std::to_string(config.mst_dat_slice_depth));
+  return result;
+}
+
+/// @brief Return the MMIO ports of the mantle.
+static std::vector<PortSignal> MMIOPorts(const Axi4LiteSpec &axi_spec) {
+  auto aw = std::to_string(axi_spec.addr_width);
+  auto dw = std::to_string(axi_spec.data_width);
+  auto sw = std::to_string(axi_spec.data_width / 8);
+  std::vector<PortSignal> result;
+  for (const auto &p : std::vector<std::pair<std::string, std::string>>{
+      {"awvalid", ""}, {"awready", ""}, {"awaddr", aw},
+      {"wvalid", ""}, {"wready", ""}, {"wdata", dw}, {"wstrb", sw},
+      {"bvalid", ""}, {"bready", ""}, {"bresp", "2"},
+      {"arvalid", ""}, {"arready", ""}, {"araddr", aw},
+      {"rvalid", ""}, {"rready", ""}, {"rdata", dw}, {"rresp", "2"}}) {
+    result.push_back({"mmio_" + p.first, "s_axi_" + p.first, "mmio_" + p.first, p.second});
+  }
+  return result;
+}
+
+/// @brief Return a port map association of a port to a signal, i.e. "port => signal".
+static std::string Association(const std::string &port, const std::string &signal, bool last = false) {
+  std::string padded = port;
+  if (padded.size() < 26) {
+    padded.resize(26, ' ');
+  }
+  return "      " + padded + "=> " + signal + (last ? "\n" : ",\n");
+}
+
+/// @brief Return the signal a port of mantle instance i connects to.
+static std::string InstanceSignal(const PortSignal &p, size_t i, size_t num_instances) {
+  if (num_instances == 1) {
+    return p.single;
+  }
+  if (p.width.empty()) {
+    return p.multi + "(" + std::to_string(i) + ")";
+  }
+  return p.multi + "(" + std::to_string(i + 1) + "*" + p.width + "-1 downto " + std::to_string(i) + "*" + p.width + ")";
+}
+
+/// @brief Return the signal declaration of the concatenated signal of a port for all instances.
+static std::string InstanceSignalDecl(const PortSignal &p, size_t num_instances) {
+  std::string padded = p.multi;
+  if (padded.size() < 23) {
+    padded.resize(23, ' ');
+  }
+  auto n = std::to_string(num_instances);
+  if (p.width.empty()) {
+    return "  signal " + padded + ": std_logic_vector(" + n + "-1 downto 0);\n";
+  }
+  return "  signal " + padded + ": std_logic_vector(" + n + "*" + p.width + "-1 downto 0);\n";
+}
+
+/// @brief Generate the instantiation of mantle instance i.
+static std::string GenerateMantleInstance(const Mantle &mantle,
+                                          const Axi4LiteSpec &axi_spec,
+                                          const std::string &external_inst_map,
+                                          size_t i,
+                                          size_t num_instances) {
+  std::string inst_name = mantle.name() + "_inst";
+  if (num_instances > 1) {
+    inst_name += std::to_string(i);
+  }
+  std::string result;
+  result += "  " + inst_name + " : " + mantle.name() + "\n";
+  result += "    generic map (\n";
+  result += Association("BUS_ADDR_WIDTH", "BUS_ADDR_WIDTH");
+  result += Association("BUS_DATA_WIDTH", "BUS_DATA_WIDTH");
+  result += Association("BUS_BURST_STEP_LEN", "BUS_BURST_STEP_LEN");
+  result += Association("BUS_BURST_MAX_LEN", "BUS_BURST_MAX_LEN");
+  result += Association("BUS_LEN_WIDTH", "BUS_LEN_WIDTH");
+  result += Association("INDEX_WIDTH", "INDEX_WIDTH");
+  result += Association("TAG_WIDTH", "TAG_WIDTH", true);
+  result += "    )\n";
+  result += "    port map (\n";
+  result += Association("kcd_clk", "kcd_clk");
+  result += Association("kcd_reset", "kcd_reset");
+  result += Association("bcd_clk", "bcd_clk");
+  result += Association("bcd_reset", "bcd_reset");
+  result += external_inst_map + "\n";
+  for (auto ch : mantle.channels(BusFunction::READ)) {
+    for (const auto &p : read_ports) {
+      result += Association(ForChannel(p.port, ch), ForChannel(InstanceSignal(p, i, num_instances), ch));
+    }
+  }
+  for (auto ch : mantle.channels(BusFunction::WRITE)) {
+    for (const auto &p : write_ports) {
+      result += Association(ForChannel(p.port, ch), ForChannel(InstanceSignal(p, i, num_instances), ch));
+    }
+  }
+  auto mmio_ports = MMIOPorts(axi_spec);
+  for (size_t p = 0; p < mmio_ports.size(); p++) {
+    result += Association(mmio_ports[p].port, InstanceSignal(mmio_ports[p], i, num_instances),
+                          p == mmio_ports.size() - 1);
+  }
+  result += "    );\n";
+  return result;
+}
+
+/// @brief Generate the declarations of the concatenated signals of all instances.
+static std::string GenerateInstanceSignals(const SchemaSet &schema_set,
+                                           const Axi4LiteSpec &axi_spec,
+                                           size_t num_instances) {
+  std::string result = "\n  -- Active low reset for kernel clock domain\n";
+  result += "  signal kcd_reset_n            : std_logic;\n";
+  result += "\n  -- Concatenated signals of all instances.\n";
+  if (schema_set.RequiresReading()) {
+    for (const auto &p : read_ports) {
+      result += InstanceSignalDecl(p, num_instances);
+    }
+  }
+  if (schema_set.RequiresWriting()) {
+    for (const auto &p : write_ports) {
+      result += InstanceSignalDecl(p, num_instances);
+    }
+  }
+  for (const auto &p : MMIOPorts(axi_spec)) {
+    result += InstanceSignalDecl(p, num_instances);
+  }
+  return result;
+}
+
+/// @brief Generate the bus arbiters and MMIO demultiplexer that share the top-level interfaces among all instances.
+static std::string GenerateInstanceInterconnect(const SchemaSet &schema_set,
+                                                const Axi4LiteSpec &axi_spec,
+                                                size_t num_instances) {
+  auto n = std::to_string(num_instances);
+  std::string result;
+  result += "  -- Active low reset\n";
+  result += "  kcd_reset_n <= not kcd_reset;\n\n";
+  result += "  -----------------------------------------------------------------------------\n";
+  result += "  -- MMIO demultiplexer\n";
+  result += "  -----------------------------------------------------------------------------\n";
+  result += "  -- Every instance has its own window of " + std::to_string(1u << FLETCHER_INSTANCE_WINDOW_BITS)
+      + " bytes in the MMIO address space.\n";
+  result += "  mmio_demux_inst: AxiLiteDemux\n";
+  result += "    generic map (\n";
+  result += Association("BUS_ADDR_WIDTH", std::to_string(axi_spec.addr_width));
+  result += Association("BUS_DATA_WIDTH", std::to_string(axi_spec.data_width));
+  result += Association("WINDOW_ADDR_WIDTH", std::to_string(FLETCHER_INSTANCE_WINDOW_BITS));
+  result += Association("NUM_MASTER_PORTS", n, true);
+  result += "    )\n";
+  result += "    port map (\n";
+  result += Association("clk", "kcd_clk");
+  result += Association("reset_n", "kcd_reset_n");
+  auto mmio_ports = MMIOPorts(axi_spec);
+  for (const auto &p : mmio_ports) {
+    result += Association(p.single, p.single);
+  }
+  for (size_t p = 0; p < mmio_ports.size(); p++) {
+    result += Association("m_axi_" + mmio_ports[p].port.substr(5), mmio_ports[p].multi, p == mmio_ports.size() - 1);
+  }
+  result += "    );\n\n";
+
+  if (schema_set.RequiresReading()) {
+    result += "  -----------------------------------------------------------------------------\n";
+    result += "  -- Read arbiter\n";
+    result += "  -----------------------------------------------------------------------------\n";
+    result += "  rd_arb_inst: entity work.BusReadArbiterVec\n";
+    result += "    generic map (\n";
+    result += Association("BUS_ADDR_WIDTH", "BUS_ADDR_WIDTH");
+    result += Association("BUS_LEN_WIDTH", "BUS_LEN_WIDTH");
+    result += Association("BUS_DATA_WIDTH", "BUS_DATA_WIDTH");
+    result += Association("NUM_SLAVE_PORTS", n);
+    result += Association("ARB_METHOD", "\"ROUND-ROBIN\"", true);
+    result += "    )\n";
+    result += "    port map (\n";
+    result += Association("bcd_clk", "bcd_clk");
+    result += Association("bcd_reset", "bcd_reset");
+    for (const auto &p : read_ports) {
+      result += Association(p.single.substr(3), p.single);
+    }
+    for (size_t p = 0; p < read_ports.size(); p++) {
+      result += Association(read_ports[p].multi, read_ports[p].multi, p == read_ports.size() - 1);
+    }
+    result += "    );\n\n";
+  }
+
+  if (schema_set.RequiresWriting()) {
+    result += "  -----------------------------------------------------------------------------\n";
+    result += "  -- Write arbiter\n";
+    result += "  -----------------------------------------------------------------------------\n";
+    result += "  wr_arb_inst: entity work.BusWriteArbiterVec\n";
+    result += "    generic map (\n";
+    result += Association("BUS_ADDR_WIDTH", "BUS_ADDR_WIDTH");
+    result += Association("BUS_LEN_WIDTH", "BUS_LEN_WIDTH");
+    result += Association("BUS_DATA_WIDTH", "BUS_DATA_WIDTH");
+    result += Association("NUM_SLAVE_PORTS", n);
+    result += Association("ARB_METHOD", "\"ROUND-ROBIN\"", true);
+    result += "    )\n";
+    result += "    port map (\n";
+    result += Association("bcd_clk", "bcd_clk");
+    result += Association("bcd_reset", "bcd_reset");
+    for (const auto &p : write_ports) {
+      result += Association(p.single.substr(3), p.single);
+    }
+    for (size_t p = 0; p < write_ports.size(); p++) {
+      result += Association(write_ports[p].multi, write_ports[p].multi, p == write_ports.size() - 1);
+    }
+    result += "    );\n";
+  }
+  return result;
+}
+
 std::string GenerateAXITop(const Mantle &mantle,
                            const SchemaSet &schema_set,
                            Axi4LiteSpec axi_spec,
                            std::optional<std::shared_ptr<Type>> external,
-                           const std::vector<std::ostream *> &outputs) {
+                           const std::vector<std::ostream *> &outputs,
+                           size_t num_instances,
+                           const AxiConverterConfig &converters) {
+  if (num_instances == 0) {
+    FLETCHER_LOG(ERROR, "AXI top level requires at least one instance.");
+  }
+
+
   // Template for AXI top level
   auto t = Template::FromString(axi_source);
 
@@ -43,13 +449,64 @@ std::string GenerateAXITop(const Mantle &mantle,
   t.Replace("BUS_BURST_STEP_LEN", 1);
   t.Replace("BUS_BURST_MAX_LEN", 64);
 
+  // Array indices
+  t.Replace("INDEX_WIDTH", schema_set.index_width());
+
   // MMIO properties
   t.Replace("MMIO_ADDR_WIDTH", axi_spec.addr_width);
   t.Replace("MMIO_DATA_WIDTH", axi_spec.data_width);
 
-  // Do not change this order, TODO: fix this in replacement code
-  t.Replace("FLETCHER_WRAPPER_NAME", mantle.name());
-  t.Replace("FLETCHER_WRAPPER_INST_NAME", mantle.name() + "_inst");
+  // Every memory interface channel of the mantle gets its own AXI4 master. Channel 0 uses the m_axi ports of the
+  // template, other channels are prefixed with m_axi_ch<channel>.
+  auto read_channels = mantle.channels(BusFunction::READ);
+  auto write_channels = mantle.channels(BusFunction::WRITE);
+  std::vector<uint32_t> channels = read_channels;
+  channels.insert(channels.end(), write_channels.begin(), write_channels.end());
+  std::sort(channels.begin(), channels.end());
+  channels.erase(std::unique(channels.begin(), channels.end()), channels.end());
+  if ((num_instances > 1) && (channels.size() > 1)) {
+    FLETCHER_LOG(ERROR, "Multiple memory interface channels are not supported for AXI top levels with multiple "
+                        "instances.");
+  }
+
+  std::string channel_ports;
+  std::string channel_signals;
+  for (auto ch : channels) {
+    if (ch == 0) {
+      continue;
+    }
+    auto prefix = "m_axi_ch" + std::to_string(ch) + "_";
+    channel_ports += "\n    -- AXI4 master of memory interface channel " + std::to_string(ch) + "\n";
+    for (const auto &p : axi_master_ports) {
+      auto name = prefix + p.first;
+      name.resize(std::max<size_t>(name.size(), 28), ' ');
+      channel_ports += "    " + name + ": " + p.second + ";\n";
+    }
+    std::vector<PortSignal> ports;
+    if (std::find(read_channels.begin(), read_channels.end(), ch) != read_channels.end()) {
+      ports.insert(ports.end(), read_ports.begin(), read_ports.end());
+    }
+    if (std::find(write_channels.begin(), write_channels.end(), ch) != write_channels.end()) {
+      ports.insert(ports.end(), write_ports.begin(), write_ports.end());
+    }
+    for (const auto &p : ports) {
+      auto name = ForChannel(p.single, ch);
+      name.resize(std::max<size_t>(name.size(), 23), ' ');
+      auto type = p.width.empty() ? "std_logic" : "std_logic_vector(" + p.width + "-1 downto 0)";
+      channel_signals += "  signal " + name + ": " + type + ";\n";
+    }
+  }
+  t.Replace("AXI_CHANNEL_PORTS_DECL", channel_ports);
+  t.Replace("AXI_CHANNEL_SIGNALS", channel_signals);
+
+  std::string read_converters;
+  for (auto ch : read_channels) {
+    read_converters += (read_converters.empty() ? "" : "\n\n") + ForChannel(Configure(axi_read_converter, converters), ch);
+  }
+  std::string write_converters;
+  for (auto ch : write_channels) {
+    write_converters += (write_converters.empty() ? "" : "\n\n") + ForChannel(Configure(axi_write_converter, converters), ch);
+  }
 
   if (schema_set.RequiresReading()) {
     t.Replace("MST_RREQ_DECLARE",
@@ -62,60 +519,9 @@ std::string GenerateAXITop(const Mantle &mantle,
               "      rd_mst_rdat_data          : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);\n"
               "      rd_mst_rdat_last          : in  std_logic;\n");
 
-    t.Replace("MST_RREQ_INSTANTIATE",
-              "      rd_mst_rreq_valid         => rd_mst_rreq_valid,\n"
-              "      rd_mst_rreq_ready         => rd_mst_rreq_ready,\n"
-              "      rd_mst_rreq_addr          => rd_mst_rreq_addr,\n"
-              "      rd_mst_rreq_len           => rd_mst_rreq_len,\n"
-              "      rd_mst_rdat_valid         => rd_mst_rdat_valid,\n"
-              "      rd_mst_rdat_ready         => rd_mst_rdat_ready,\n"
-              "      rd_mst_rdat_data          => rd_mst_rdat_data,\n"
-              "      rd_mst_rdat_last          => rd_mst_rdat_last,");
-
-    t.Replace("AXI_READ_CONVERTER",
-              "  -----------------------------------------------------------------------------\n"
-              "  -- AXI read converter\n"
-              "  -----------------------------------------------------------------------------\n"
-              "  -- Buffering bursts is disabled (ENABLE_FIFO=false) because BufferReaders\n"
-              "  -- are already able to absorb full bursts.\n"
-              "  axi_read_conv_inst: AxiReadConverter\n"
-              "    generic map (\n"
-              "      ADDR_WIDTH                => BUS_ADDR_WIDTH,\n"
-              "      MASTER_DATA_WIDTH         => BUS_DATA_WIDTH,\n"
-              "      MASTER_LEN_WIDTH          => BUS_LEN_WIDTH,\n"
-              "      SLAVE_DATA_WIDTH          => BUS_DATA_WIDTH,\n"
-              "      SLAVE_LEN_WIDTH           => BUS_LEN_WIDTH,\n"
-              "      SLAVE_MAX_BURST           => BUS_BURST_MAX_LEN,\n"
-              "      ENABLE_FIFO               => false,\n"
-              "      SLV_REQ_SLICE_DEPTH       => 0,\n"
-              "      SLV_DAT_SLICE_DEPTH       => 0,\n"
-              "      MST_REQ_SLICE_DEPTH       => 0,\n"
-              "      MST_DAT_SLICE_DEPTH       => 0\n"
-              "    )\n"
-              "    port map (\n"
-              "      clk                       => bcd_clk,\n"
-              "      reset_n                   => bcd_reset_n,\n"
-              "      slv_bus_rreq_addr         => rd_mst_rreq_addr,\n"
-              "      slv_bus_rreq_len          => rd_mst_rreq_len,\n"
-              "      slv_bus_rreq_valid        => rd_mst_rreq_valid,\n"
-              "      slv_bus_rreq_ready        => rd_mst_rreq_ready,\n"
-              "      slv_bus_rdat_data         => rd_mst_rdat_data,\n"
-              "      slv_bus_rdat_last         => rd_mst_rdat_last,\n"
-              "      slv_bus_rdat_valid        => rd_mst_rdat_valid,\n"
-              "      slv_bus_rdat_ready        => rd_mst_rdat_ready,\n"
-              "      m_axi_araddr              => m_axi_araddr,\n"
-              "      m_axi_arlen               => m_axi_arlen,\n"
-              "      m_axi_arvalid             => m_axi_arvalid,\n"
-              "      m_axi_arready             => m_axi_arready,\n"
-              "      m_axi_arsize              => m_axi_arsize,\n"
-              "      m_axi_rdata               => m_axi_rdata,\n"
-              "      m_axi_rlast               => m_axi_rlast,\n"
-              "      m_axi_rvalid              => m_axi_rvalid,\n"
-              "      m_axi_rready              => m_axi_rready\n"
-              "    );");
+    t.Replace("AXI_READ_CONVERTER", read_converters);
   } else {
     t.Replace("MST_RREQ_DECLARE", "");
-    t.Replace("MST_RREQ_INSTANTIATE", "");
     t.Replace("AXI_READ_CONVERTER", "");
   }
 
@@ -136,81 +542,19 @@ std::string GenerateAXITop(const Mantle &mantle,
               "      wr_mst_wrep_ok           : in  std_logic;"
     );
 
-    t.Replace("MST_WREQ_INSTANTIATE",
-              "      wr_mst_wreq_valid         => wr_mst_wreq_valid,\n"
-              "      wr_mst_wreq_ready         => wr_mst_wreq_ready,\n"
-              "      wr_mst_wreq_addr          => wr_mst_wreq_addr,\n"
-              "      wr_mst_wreq_len           => wr_mst_wreq_len,\n"
-              "      wr_mst_wreq_last          => wr_mst_wreq_last,\n"
-              "      wr_mst_wdat_valid         => wr_mst_wdat_valid,\n"
-              "      wr_mst_wdat_ready         => wr_mst_wdat_ready,\n"
-              "      wr_mst_wdat_data          => wr_mst_wdat_data,\n"
-              "      wr_mst_wdat_strobe        => wr_mst_wdat_strobe,\n"
-              "      wr_mst_wdat_last          => wr_mst_wdat_last,\n"
-              "      wr_mst_wrep_valid         => wr_mst_wrep_valid,\n"
-              "      wr_mst_wrep_ready         => wr_mst_wrep_ready,\n"
-              "      wr_mst_wrep_ok            => wr_mst_wrep_ok,");
-
-    t.Replace("AXI_WRITE_CONVERTER",
-              "  -----------------------------------------------------------------------------\n"
-              "  -- AXI write converter\n"
-              "  -----------------------------------------------------------------------------\n"
-              "  -- Buffering bursts is disabled (ENABLE_FIFO=false) because BufferWriters\n"
-              "  -- are already able to absorb full bursts.\n"
-              "  axi_write_conv_inst: AxiWriteConverter\n"
-              "    generic map (\n"
-              "      ADDR_WIDTH                => BUS_ADDR_WIDTH,\n"
-              "      MASTER_DATA_WIDTH         => BUS_DATA_WIDTH,\n"
-              "      MASTER_LEN_WIDTH          => BUS_LEN_WIDTH,\n"
-              "      SLAVE_DATA_WIDTH          => BUS_DATA_WIDTH,\n"
-              "      SLAVE_LEN_WIDTH           => BUS_LEN_WIDTH,\n"
-              "      SLAVE_MAX_BURST           => BUS_BURST_MAX_LEN,\n"
-              "      ENABLE_FIFO               => false,\n"
-              "      SLV_REQ_SLICE_DEPTH       => 0,\n"
-              "      SLV_DAT_SLICE_DEPTH       => 0,\n"
-              "      MST_REQ_SLICE_DEPTH       => 0,\n"
-              "      MST_DAT_SLICE_DEPTH       => 0\n"
-              "    )\n"
-              "    port map (\n"
-              "      clk                       => bcd_clk,\n"
-              "      reset_n                   => bcd_reset_n,\n"
-              "      slv_bus_wreq_addr         => wr_mst_wreq_addr,\n"
-              "      slv_bus_wreq_len          => wr_mst_wreq_len,\n"
-              "      slv_bus_wreq_valid        => wr_mst_wreq_valid,\n"
-              "      slv_bus_wreq_ready        => wr_mst_wreq_ready,\n"
-              "      slv_bus_wreq_last         => wr_mst_wreq_last,\n"
-              "      slv_bus_wdat_data         => wr_mst_wdat_data,\n"
-              "      slv_bus_wdat_strobe       => wr_mst_wdat_strobe,\n"
-              "      slv_bus_wdat_last         => wr_mst_wdat_last,\n"
-              "      slv_bus_wdat_valid        => wr_mst_wdat_valid,\n"
-              "      slv_bus_wdat_ready        => wr_mst_wdat_ready,\n"
-              "      slv_bus_wrep_valid        => wr_mst_wrep_valid,\n"
-              "      slv_bus_wrep_ready        => wr_mst_wrep_ready,\n"
-              "      slv_bus_wrep_ok           => wr_mst_wrep_ok,\n"
-              "      m_axi_awaddr              => m_axi_awaddr,\n"
-              "      m_axi_awlen               => m_axi_awlen,\n"
-              "      m_axi_awvalid             => m_axi_awvalid,\n"
-              "      m_axi_awready             => m_axi_awready,\n"
-              "      m_axi_awsize              => m_axi_awsize,\n"
-              "      m_axi_awuser              => m_axi_awuser,\n"
-              "      m_axi_wdata               => m_axi_wdata,\n"
-              "      m_axi_wstrb               => m_axi_wstrb,\n"
-              "      m_axi_wlast               => m_axi_wlast,\n"
-              "      m_axi_wvalid              => m_axi_wvalid,\n"
-              "      m_axi_wready              => m_axi_wready,\n"
-              "      m_axi_bvalid              => m_axi_bvalid,\n"
-              "      m_axi_bready              => m_axi_bready,\n"
-              "      m_axi_bresp               => m_axi_bresp\n"
-              "    );");
+    t.Replace("AXI_WRITE_CONVERTER", write_converters);
   } else {
     t.Replace("MST_WREQ_DECLARE", "");
-    t.Replace("MST_WREQ_INSTANTIATE", "");
     t.Replace("AXI_WRITE_CONVERTER", "");
   }
 
   t.Replace("MANTLE_DECL", cerata::vhdl::Decl::Generate(mantle, false, 1).ToString());
 
+  std::string external_inst_map;
   if (external) {
+    if (num_instances > 1) {
+      FLETCHER_LOG(ERROR, "External signals are not supported for AXI top levels with multiple instances.");
+    }
     auto p_mantle = cerata::port("ext", external.value(), cerata::Port::Dir::OUT);
     auto p_top = cerata::port("ext", external.value(), cerata::Port::Dir::OUT);
     cerata::Connect(p_top, p_mantle);
@@ -222,10 +566,26 @@ std::string GenerateAXITop(const Mantle &mantle,
     inst_block << ",";
 
     t.Replace("EXTERNAL_PORT_DECL", decl_block.ToString());
-    t.Replace("EXTERNAL_INST_MAP", inst_block.ToString());
+    external_inst_map = inst_block.ToString();
   } else {
     t.Replace("EXTERNAL_PORT_DECL", "");
-    t.Replace("EXTERNAL_INST_MAP", "");
+  }
+
+  std::string instances;
+  for (size_t i = 0; i < num_instances; i++) {
+    if (i > 0) {
+      instances += "\n";
+    }
+    instances += GenerateMantleInstance(mantle, axi_spec, external_inst_map, i, num_instances);
+  }
+  t.Replace("MANTLE_INSTANCES", instances);
+
+  if (num_instances > 1) {
+    t.Replace("INSTANCE_SIGNALS", GenerateInstanceSignals(schema_set, axi_spec, num_instances));
+    t.Replace("INSTANCE_INTERCONNECT", GenerateInstanceInterconnect(schema_set, axi_spec, num_instances));
+  } else {
+    t.Replace("INSTANCE_SIGNALS", "");
+    t.Replace("INSTANCE_INTERCONNECT", "");
   }
 
   for (auto &o : outputs) {
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -23,11 +24,42 @@
 
 namespace fletchgen::top {
 
-/// @brief Generate an AXI top level on supplied output streams from a ColumnWrapper
+/// Buffering of the AXI read and write converters between the mantle bus masters and the AXI4 master ports.
+struct AxiConverterConfig {
+  /// Whether to buffer whole bursts in the converters.
+  bool enable_fifo = false;
+  /// Depth of the slice on the request channel of the Fletcher bus side. 0 disables the slice.
+  uint32_t slv_req_slice_depth = 0;
+  /// Depth of the slice on the data channel of the Fletcher bus side. 0 disables the slice.
+  uint32_t slv_dat_slice_depth = 0;
+  /// Depth of the slice on the request channel of the AXI4 side. 0 disables the slice.
+  uint32_t mst_req_slice_depth = 0;
+  /// Depth of the slice on the data channel of the AXI4 side. 0 disables the slice.
+  uint32_t mst_dat_slice_depth = 0;
+};
+
+/**
+ * @brief Generate an AXI top level on supplied output streams from a ColumnWrapper
+ *
+ * When num_instances is larger than one, the top level contains that many instances of the mantle. Their bus masters
+ * are arbitrated onto the AXI4 master port and every instance gets its own window of FLETCHER_INSTANCE_WINDOW_BITS
+ * address bits on the AXI4-lite MMIO port.
+ *
+ * @param mantle        The mantle to instantiate.
+ * @param schema_set    The schema set of the mantle.
+ * @param axi_spec      The AXI4-lite MMIO bus specification.
+ * @param external      The type of the external signals of the mantle, if any.
+ * @param outputs       The output streams to write the top level to.
+ * @param num_instances The number of mantle instances.
+ * @param converters    The buffering of the AXI converters.
+ * @return The generated top level source.
+ */
 std::string GenerateAXITop(const Mantle &mantle,
                            const SchemaSet &schema_set,
                            Axi4LiteSpec axi_spec,
                            std::optional<std::shared_ptr<Type>> external,
-                           const std::vector<std::ostream *> &outputs);
+                           const std::vector<std::ostream *> &outputs,
+                           size_t num_instances = 1,
+                           const AxiConverterConfig &converters = {});
 
 }  // namespace fletchgen::top
@@ -47,13 +47,15 @@ static char axi_source[] =
     "-------------------------------------------------------------------------------\n"
     "-- AXI4 compatible top level for Fletcher generated accelerators.\n"
     "-------------------------------------------------------------------------------\n"
-    "-- Requires an AXI4 port to host memory.\n"
-    "-- Requires an AXI4-lite port from host for MMIO.\n"
+    "-- Requires an AXI4 port to host memory, in the bus clock domain.\n"
+    "-- Requires an AXI4-lite port from host for MMIO, in the kernel clock domain.\n"
+    "-- The clock domains may only be driven by different clocks when the design\n"
+    "-- was generated with clock domain crossings (fletchgen --xclk_stages).\n"
     "-------------------------------------------------------------------------------\n"
     "entity AxiTop is\n"
     "  generic (\n"
     "    -- Accelerator properties\n"
-    "    INDEX_WIDTH                 : natural := 32;\n"
+    "    INDEX_WIDTH                 : natural := ${INDEX_WIDTH};\n"
     "    REG_WIDTH                   : natural := 32;\n"
     "    TAG_WIDTH                   : natural := 1;\n"
     "    -- AXI4 (full) bus properties for memory access.\n"
@@ -113,6 +115,7 @@ static char axi_source[] =
     "    m_axi_bvalid                : in  std_logic;\n"
     "    m_axi_bready                : out std_logic;\n"
     "    m_axi_bresp                 : in  std_logic_vector(1 downto 0);\n"
+    "${AXI_CHANNEL_PORTS_DECL}"
     "    ---------------------------------------------------------------------------\n"
     "    -- AXI4-lite Slave as MMIO interface\n"
     "    ---------------------------------------------------------------------------\n"
@@ -179,6 +182,8 @@ static char axi_source[] =
     "  signal wr_mst_wrep_valid      : std_logic;\n"
     "  signal wr_mst_wrep_ready      : std_logic;\n"
     "  signal wr_mst_wrep_ok         : std_logic;\n"
+    "${AXI_CHANNEL_SIGNALS}"
+    "${INSTANCE_SIGNALS}"
     "\n"
     "begin\n"
     "\n"
@@ -188,43 +193,9 @@ static char axi_source[] =
     "  -----------------------------------------------------------------------------\n"
     "  -- Fletcher generated wrapper\n"
     "  -----------------------------------------------------------------------------\n"
-    "  ${FLETCHER_WRAPPER_INST_NAME} : ${FLETCHER_WRAPPER_NAME}\n"
-    "    generic map (\n"
-    "      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,\n"
-    "      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,\n"
-    "      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,\n"
-    "      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,\n"
-    "      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,\n"
-    "      INDEX_WIDTH               => INDEX_WIDTH,\n"
-    "      TAG_WIDTH                 => TAG_WIDTH\n"
-    "    )\n"
-    "    port map (\n"
-    "      kcd_clk                   => kcd_clk,\n"
-    "      kcd_reset                 => kcd_reset,\n"
-    "      bcd_clk                   => bcd_clk,\n"
-    "      bcd_reset                 => bcd_reset,\n"
-    "${EXTERNAL_INST_MAP}\n"
-    "${MST_RREQ_INSTANTIATE}\n"
-    "${MST_WREQ_INSTANTIATE}\n"
-    "      mmio_awvalid              => s_axi_awvalid,\n"
-    "      mmio_awready              => s_axi_awready,\n"
-    "      mmio_awaddr               => s_axi_awaddr,\n"
-    "      mmio_wvalid               => s_axi_wvalid,\n"
-    "      mmio_wready               => s_axi_wready,\n"
-    "      mmio_wdata                => s_axi_wdata,\n"
-    "      mmio_wstrb                => s_axi_wstrb,\n"
-    "      mmio_bvalid               => s_axi_bvalid,\n"
-    "      mmio_bready               => s_axi_bready,\n"
-    "      mmio_bresp                => s_axi_bresp,\n"
-    "      mmio_arvalid              => s_axi_arvalid,\n"
-    "      mmio_arready              => s_axi_arready,\n"
-    "      mmio_araddr               => s_axi_araddr,\n"
-    "      mmio_rvalid               => s_axi_rvalid,\n"
-    "      mmio_rready               => s_axi_rready,\n"
-    "      mmio_rdata                => s_axi_rdata,\n"
-    "      mmio_rresp                => s_axi_rresp\n"
-    "    );\n"
+    "${MANTLE_INSTANCES}"
     "\n"
+    "${INSTANCE_INTERCONNECT}\n"
     "${AXI_READ_CONVERTER}\n"
     "${AXI_WRITE_CONVERTER}\n"
     "\n"
@@ -20,6 +20,9 @@
 #include <string>
 #include <iomanip>
 #include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "fletchgen/top/sim_template.h"
 #include "fletchgen/mantle.h"
@@ -34,7 +37,7 @@ static std::string GenMMIOWrite(uint32_t idx, uint32_t value, const std::string
   str << "    mmio_write32("
       << std::dec << idx << ", "
       << "X\"" << std::setfill('0') << std::setw(8) << std::hex << value << "\","
-      << " mmio_source, mmio_sink, bcd_clk, bcd_reset);";
+      << " mmio_source, mmio_sink, kcd_clk, kcd_reset);";
   if (!comment.empty()) {
     str << " -- " << comment;
   }
@@ -50,7 +53,7 @@ static std::string GenMMIORead(uint32_t idx,
   str << "    mmio_read32("
       << std::dec << idx << ", "
       << " read_data, "
-      << " mmio_source, mmio_sink, bcd_clk, bcd_reset);";
+      << " mmio_source, mmio_sink, kcd_clk, kcd_reset);";
   if (!comment.empty()) {
     str << " -- " << comment;
   }
@@ -77,13 +80,65 @@ static std::string CanonicalizePath(const std::string &path) {
   return result;
 }
 
+/// Memory interface signals of a read channel, except for the "bus_" prefix.
+static const std::vector<std::pair<std::string, std::string>> read_signals = {
+    {"rreq_addr", "std_logic_vector(BUS_ADDR_WIDTH-1 downto 0)"},
+    {"rreq_len", "std_logic_vector(BUS_LEN_WIDTH-1 downto 0)"},
+    {"rreq_valid", "std_logic"},
+    {"rreq_ready", "std_logic"},
+    {"rdat_data", "std_logic_vector(BUS_DATA_WIDTH-1 downto 0)"},
+    {"rdat_last", "std_logic"},
+    {"rdat_valid", "std_logic"},
+    {"rdat_ready", "std_logic"}};
+
+/// Memory interface signals of a write channel, except for the "bus_" prefix.
+static const std::vector<std::pair<std::string, std::string>> write_signals = {
+    {"wreq_addr", "std_logic_vector(BUS_ADDR_WIDTH-1 downto 0)"},
+    {"wreq_last", "std_logic"},
+    {"wreq_len", "std_logic_vector(BUS_LEN_WIDTH-1 downto 0)"},
+    {"wreq_valid", "std_logic"},
+    {"wreq_ready", "std_logic"},
+    {"wdat_data", "std_logic_vector(BUS_DATA_WIDTH-1 downto 0)"},
+    {"wdat_strobe", "std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0)"},
+    {"wdat_last", "std_logic"},
+    {"wdat_valid", "std_logic"},
+    {"wdat_ready", "std_logic"},
+    {"wrep_ok", "std_logic"},
+    {"wrep_valid", "std_logic"},
+    {"wrep_ready", "std_logic"}};
+
+/// @brief Rename the signals and memory model instance of memory interface channel 0 in some VHDL text to a channel.
+static std::string ForChannel(const std::string &text, const std::string &mem_inst, uint32_t channel) {
+  if (channel == 0) {
+    return text;
+  }
+  auto ch = "_ch" + std::to_string(channel);
+  std::string result = text;
+  for (const auto &rename : std::vector<std::pair<std::string, std::string>>{
+      {"rd_mst_", MasterPortName(BusFunction::READ, channel) + "_"},
+      {"wr_mst_", MasterPortName(BusFunction::WRITE, channel) + "_"},
+      {"=> bus_", "=> bus" + ch + "_"},
+      {mem_inst + "_inst", mem_inst + ch + "_inst"}}) {
+    for (auto pos = result.find(rename.first); pos != std::string::npos;
+         pos = result.find(rename.first, pos + rename.second.size())) {
+      result.replace(pos, rename.first.size(), rename.second);
+    }
+  }
+  return result;
+}
+
 std::string GenerateSimTop(const Design &design,
                            const std::vector<std::ostream *> &outputs,
                            const std::string &read_srec_path,
                            const std::string &write_srec_path,
-                           const std::vector<RecordBatchDescription> &recordbatches) {
+                           const std::vector<RecordBatchDescription> &recordbatches,
+                           const std::string &read_image_path,
+                           const SimTiming &timing,
+                           bool cosim) {
   // Template file for simulation top-level
   auto t = Template::FromString(sim_source);
+  // Template file for the stimuli that drive the simulation from the RecordBatches.
+  auto stimuli = Template::FromString(sim_stimuli_source);
 
   // Offset of schema specific registers
   constexpr int ndefault = FLETCHER_REG_SCHEMA;
@@ -101,6 +156,14 @@ std::string GenerateSimTop(const Design &design,
   t.Replace("BUS_LEN_WIDTH", 8);
   t.Replace("BUS_BURST_STEP_LEN", 1);
   t.Replace("BUS_BURST_MAX_LEN", 64);
+  t.Replace("INDEX_WIDTH", design.schema_set->index_width());
+
+  std::stringstream bcd_half_period;
+  bcd_half_period << timing.clock_period / 2;
+  t.Replace("BCD_HALF_PERIOD", bcd_half_period.str());
+  std::stringstream kcd_half_period;
+  kcd_half_period << (timing.kernel_clock_period > 0.0 ? timing.kernel_clock_period : timing.clock_period) / 2;
+  t.Replace("KCD_HALF_PERIOD", kcd_half_period.str());
 
   t.Replace("MMIO_DATA_WIDTH", design.mmio_spec.data_width);
   t.Replace("MMIO_ADDR_WIDTH", design.mmio_spec.addr_width);
@@ -125,6 +188,9 @@ std::string GenerateSimTop(const Design &design,
 
   FLETCHER_LOG(DEBUG, "SIM: Generating MMIO writes for " << num_rbs << " RecordBatches.");
 
+  // Every first and last index occupies one register per 32 bits.
+  uint32_t iregs = design.schema_set->index_width() / 32;
+
   // Loop over all RecordBatches
   size_t buffer_offset = 0;
   size_t rb_offset = 0;
@@ -132,10 +198,10 @@ std::string GenerateSimTop(const Design &design,
     for (const auto &f : rb.fields) {
       for (const auto &b : f.buffers) {
         // Get the low and high part of the address
-        auto addr = reinterpret_cast<uint64_t>(b.raw_buffer_);
+        auto addr = reinterpret_cast<uint64_t>(b.raw_buffer_) - b.device_offset_;
         auto addr_lo = (uint32_t) (addr & 0xFFFFFFFF);
         auto addr_hi = (uint32_t) (addr >> 32u);
-        uint32_t buffer_idx = 2 * (buffer_offset) + (ndefault + 2 * num_rbs);
+        uint32_t buffer_idx = 2 * (buffer_offset) + (ndefault + 2 * iregs * num_rbs);
         buffer_meta << GenMMIOWrite(buffer_idx,
                                     addr_lo,
                                     rb.name + " " + fletcher::ToString(b.desc_) + " buffer address.");
@@ -144,13 +210,19 @@ std::string GenerateSimTop(const Design &design,
         buffer_offset++;
       }
     }
-    uint32_t rb_idx = 2 * (rb_offset) + ndefault;
+    uint32_t rb_idx = 2 * iregs * (rb_offset) + ndefault;
     rb_meta << GenMMIOWrite(rb_idx, 0, rb.name + " first index.");
-    rb_meta << GenMMIOWrite(rb_idx + 1, rb.rows, rb.name + " last index.");
+    if (iregs == 2) {
+      rb_meta << GenMMIOWrite(rb_idx + 1, 0);
+    }
+    rb_meta << GenMMIOWrite(rb_idx + iregs, static_cast<uint32_t>(rb.rows), rb.name + " last index.");
+    if (iregs == 2) {
+      rb_meta << GenMMIOWrite(rb_idx + 3, static_cast<uint32_t>(static_cast<uint64_t>(rb.rows) >> 32u));
+    }
     rb_offset++;
   }
-  t.Replace("SREC_BUFFER_ADDRESSES", buffer_meta.str());
-  t.Replace("SREC_FIRSTLAST_INDICES", rb_meta.str());
+  stimuli.Replace("SREC_BUFFER_ADDRESSES", buffer_meta.str());
+  stimuli.Replace("SREC_FIRSTLAST_INDICES", rb_meta.str());
 
   std::stringstream kri;
   if (!design.kernel_regs.empty()) {
@@ -162,64 +234,103 @@ std::string GenerateSimTop(const Design &design,
       }
     }
   }
-  t.Replace("KERNEL_REGS_INIT", kri.str());
+  stimuli.Replace("KERNEL_REGS_INIT", kri.str());
 
   // Profiling registers.
   if (!design.profiling_regs.empty()) {
     std::stringstream profile_reads;
     uint32_t addr = 0;
-    int i = 0;
+    uint32_t snapshot_addr = 0;
     for (const auto &pr : design.profiling_regs) {
       if (pr.name == "Profile_enable") {
         // Profiling register should have an address now.
         addr = pr.addr.value();
+      } else if (pr.name == "Profile_snapshot") {
+        snapshot_addr = pr.addr.value();
       } else if (pr.name == "Profile_clear") {
         // do nothing
       } else if (pr.function == MmioFunction::PROFILE) {
-        i++;
-        std::stringstream profile_prefix;
-        profile_prefix << std::setw(42) << ("Profile " + pr.name);
-        profile_reads << GenMMIORead(pr.addr.value() / 4, profile_prefix.str(), false);
+        // Counters wider than 32 bits span multiple registers, starting with the lower bits.
+        for (uint32_t word = 0; 32 * word < pr.width; word++) {
+          auto name = "Profile " + pr.name + (word > 0 ? " [" + std::to_string(word) + "]" : "");
+          std::stringstream profile_prefix;
+          profile_prefix << std::setw(42) << name;
+          profile_reads << GenMMIORead(pr.addr.value() / 4 + word, profile_prefix.str(), false);
+        }
       }
     }
-    t.Replace("PROFILE_START", GenMMIOWrite(addr / 4, 1, "Start profiling."));
-    t.Replace("PROFILE_STOP", GenMMIOWrite(addr / 4, 0, "Stop profiling."));
-    t.Replace("PROFILE_READ", profile_reads.str());
+    stimuli.Replace("PROFILE_START", GenMMIOWrite(addr / 4, 1, "Start profiling."));
+    stimuli.Replace("PROFILE_STOP", GenMMIOWrite(addr / 4, 0, "Stop profiling.")
+        + GenMMIOWrite(snapshot_addr / 4, 1, "Snapshot profiler counters."));
+    stimuli.Replace("PROFILE_READ", profile_reads.str());
   } else {
-    t.Replace("PROFILE_START", "");
-    t.Replace("PROFILE_STOP", "");
-    t.Replace("PROFILE_READ", "");
+    stimuli.Replace("PROFILE_START", "");
+    stimuli.Replace("PROFILE_STOP", "");
+    stimuli.Replace("PROFILE_READ", "");
   }
 
+  // A co-simulation is driven by a host application through the bridge instead.
+  t.Replace("STIMULI", cosim ? std::string(sim_cosim_stimuli_source) : stimuli.ToString());
+  t.Replace("COSIM_USE", cosim ? "use work.SimBridge_pkg.all;\n" : "");
+
+  // Memory interface signals of channels other than channel 0.
+  std::string channel_signals;
+  for (auto func : {BusFunction::READ, BusFunction::WRITE}) {
+    for (auto ch : design.mantle_comp->channels(func)) {
+      if (ch == 0) {
+        continue;
+      }
+      for (const auto &sig : func == BusFunction::READ ? read_signals : write_signals) {
+        auto name = "bus_ch" + std::to_string(ch) + "_" + sig.first;
+        name.resize(std::max<size_t>(name.size(), 23), ' ');
+        channel_signals += "  signal " + name + ": " + sig.second + ";\n";
+      }
+    }
+  }
+  t.Replace("BUS_CHANNEL_SIGNALS", channel_signals);
+
   // Read/write specific memory models
   if (design.schema_set->RequiresReading()) {
-    auto abs_path = CanonicalizePath(read_srec_path);
-    t.Replace("BUS_READ_SLAVE_MOCK",
-              "  rmem_inst: BusReadSlaveMock\n"
-              "  generic map (\n"
-              "    BUS_ADDR_WIDTH              => BUS_ADDR_WIDTH,\n"
-              "    BUS_LEN_WIDTH               => BUS_LEN_WIDTH,\n"
-              "    BUS_DATA_WIDTH              => BUS_DATA_WIDTH,\n"
-              "    SEED                        => 1337,\n"
-              "    RANDOM_REQUEST_TIMING       => false,\n"
-              "    RANDOM_RESPONSE_TIMING      => false,\n"
-              "    SREC_FILE                   => \"" +
-                  abs_path
-                  + "\"\n"
-                    "  )\n"
-                    "  port map (\n"
-                    "    clk                         => bcd_clk,\n"
-                    "    reset                       => bcd_reset,\n"
-                    "    rreq_valid                  => bus_rreq_valid,\n"
-                    "    rreq_ready                  => bus_rreq_ready,\n"
-                    "    rreq_addr                   => bus_rreq_addr,\n"
-                    "    rreq_len                    => bus_rreq_len,\n"
-                    "    rdat_valid                  => bus_rdat_valid,\n"
-                    "    rdat_ready                  => bus_rdat_ready,\n"
-                    "    rdat_data                   => bus_rdat_data,\n"
-                    "    rdat_last                   => bus_rdat_last\n"
-                    "  );\n"
-                    "\n");
+    // The co-simulation memory model reads the device memory of the host application through the bridge. Otherwise,
+    // load either the binary memory image or the SREC file.
+    std::string read_generics =
+        "    BUS_ADDR_WIDTH              => BUS_ADDR_WIDTH,\n"
+        "    BUS_LEN_WIDTH               => BUS_LEN_WIDTH,\n"
+        "    BUS_DATA_WIDTH              => BUS_DATA_WIDTH,\n"
+        "    LATENCY                     => " + std::to_string(timing.latency);
+    if (cosim) {
+      read_generics += "\n";
+    } else {
+      read_generics +=
+          ",\n"
+          "    SEED                        => 1337,\n"
+          "    RANDOM_REQUEST_TIMING       => false,\n"
+          "    RANDOM_RESPONSE_TIMING      => false,\n"
+          "    BANDWIDTH                   => " + std::to_string(timing.bandwidth) + ",\n"
+          "    MAX_OUTSTANDING             => " + std::to_string(timing.max_outstanding) + ",\n"
+              + (read_image_path.empty()
+                 ? "    SREC_FILE                   => \"" + CanonicalizePath(read_srec_path) + "\"\n"
+                 : "    BIN_FILE                    => \"" + CanonicalizePath(read_image_path) + "\"\n");
+    }
+    std::string read_mock =
+        std::string(cosim ? "  rmem_inst: BusReadSlaveCosim\n" : "  rmem_inst: BusReadSlaveMock\n")
+            + "  generic map (\n"
+            + read_generics
+            + "  )\n"
+              "  port map (\n"
+              "    clk                         => bcd_clk,\n"
+              "    reset                       => bcd_reset,\n"
+              "    rreq_valid                  => bus_rreq_valid,\n"
+              "    rreq_ready                  => bus_rreq_ready,\n"
+              "    rreq_addr                   => bus_rreq_addr,\n"
+              "    rreq_len                    => bus_rreq_len,\n"
+              "    rdat_valid                  => bus_rdat_valid,\n"
+              "    rdat_ready                  => bus_rdat_ready,\n"
+              "    rdat_data                   => bus_rdat_data,\n"
+              "    rdat_last                   => bus_rdat_last,\n"
+              "    print_stats                 => mem_print_stats\n"
+              "  );\n"
+              "\n";
 
     t.Replace("MST_RREQ_DECLARE",
               "      rd_mst_rreq_valid         : out std_logic;\n"
@@ -231,51 +342,71 @@ std::string GenerateSimTop(const Design &design,
               "      rd_mst_rdat_data          : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);\n"
               "      rd_mst_rdat_last          : in  std_logic;\n");
 
-    t.Replace("MST_RREQ_INSTANTIATE",
-              "      rd_mst_rreq_valid         => bus_rreq_valid,\n"
-              "      rd_mst_rreq_ready         => bus_rreq_ready,\n"
-              "      rd_mst_rreq_addr          => bus_rreq_addr,\n"
-              "      rd_mst_rreq_len           => bus_rreq_len,\n"
-              "      rd_mst_rdat_valid         => bus_rdat_valid,\n"
-              "      rd_mst_rdat_ready         => bus_rdat_ready,\n"
-              "      rd_mst_rdat_data          => bus_rdat_data,\n"
-              "      rd_mst_rdat_last          => bus_rdat_last,\n");
+    std::string read_inst =
+        "      rd_mst_rreq_valid         => bus_rreq_valid,\n"
+        "      rd_mst_rreq_ready         => bus_rreq_ready,\n"
+        "      rd_mst_rreq_addr          => bus_rreq_addr,\n"
+        "      rd_mst_rreq_len           => bus_rreq_len,\n"
+        "      rd_mst_rdat_valid         => bus_rdat_valid,\n"
+        "      rd_mst_rdat_ready         => bus_rdat_ready,\n"
+        "      rd_mst_rdat_data          => bus_rdat_data,\n"
+        "      rd_mst_rdat_last          => bus_rdat_last,\n";
+
+    // Every memory interface channel gets its own memory model, all loaded with the same contents.
+    std::string read_mocks;
+    std::string read_insts;
+    for (auto ch : design.mantle_comp->channels(BusFunction::READ)) {
+      read_mocks += ForChannel(read_mock, "rmem", ch);
+      read_insts += ForChannel(read_inst, "rmem", ch);
+    }
+    t.Replace("BUS_READ_SLAVE_MOCK", read_mocks);
+    t.Replace("MST_RREQ_INSTANTIATE", read_insts);
   } else {
     t.Replace("BUS_READ_SLAVE_MOCK", "");
     t.Replace("MST_RREQ_DECLARE", "");
     t.Replace("MST_RREQ_INSTANTIATE", "");
   }
   if (design.schema_set->RequiresWriting()) {
-    t.Replace("BUS_WRITE_SLAVE_MOCK",
-              "  wmem_inst: BusWriteSlaveMock\n"
-              "  generic map (\n"
-              "    BUS_ADDR_WIDTH              => BUS_ADDR_WIDTH,\n"
-              "    BUS_LEN_WIDTH               => BUS_LEN_WIDTH,\n"
-              "    BUS_DATA_WIDTH              => BUS_DATA_WIDTH,\n"
-              "    SEED                        => 1337,\n"
-              "    RANDOM_REQUEST_TIMING       => false,\n"
-              "    RANDOM_RESPONSE_TIMING      => false,\n"
-              "    SREC_FILE                   => \""
-                  + CanonicalizePath(write_srec_path)
-                  + "\"\n"
-                    "  )\n"
-                    "  port map (\n"
-                    "    clk                         => bcd_clk,\n"
-                    "    reset                       => bcd_reset,\n"
-                    "    wreq_valid                  => bus_wreq_valid,\n"
-                    "    wreq_ready                  => bus_wreq_ready,\n"
-                    "    wreq_addr                   => bus_wreq_addr,\n"
-                    "    wreq_len                    => bus_wreq_len,\n"
-                    "    wreq_last                   => bus_wreq_last,\n"
-                    "    wdat_valid                  => bus_wdat_valid,\n"
-                    "    wdat_ready                  => bus_wdat_ready,\n"
-                    "    wdat_data                   => bus_wdat_data,\n"
-                    "    wdat_strobe                 => bus_wdat_strobe,\n"
-                    "    wdat_last                   => bus_wdat_last,\n"
-                    "    wrep_valid                  => bus_wrep_valid,\n"
-                    "    wrep_ready                  => bus_wrep_ready,\n"
-                    "    wrep_ok                     => bus_wrep_ok\n"
-                    "  );");
+    // The co-simulation memory model writes the device memory of the host application through the bridge.
+    std::string write_generics =
+        "    BUS_ADDR_WIDTH              => BUS_ADDR_WIDTH,\n"
+        "    BUS_LEN_WIDTH               => BUS_LEN_WIDTH,\n"
+        "    BUS_DATA_WIDTH              => BUS_DATA_WIDTH,\n"
+        "    LATENCY                     => " + std::to_string(timing.latency);
+    if (cosim) {
+      write_generics += "\n";
+    } else {
+      write_generics +=
+          ",\n"
+          "    SEED                        => 1337,\n"
+          "    RANDOM_REQUEST_TIMING       => false,\n"
+          "    RANDOM_RESPONSE_TIMING      => false,\n"
+          "    BANDWIDTH                   => " + std::to_string(timing.bandwidth) + ",\n"
+          "    SREC_FILE                   => \"" + CanonicalizePath(write_srec_path) + "\"\n";
+    }
+    std::string write_mock =
+        std::string(cosim ? "  wmem_inst: BusWriteSlaveCosim\n" : "  wmem_inst: BusWriteSlaveMock\n")
+            + "  generic map (\n"
+            + write_generics
+            + "  )\n"
+              "  port map (\n"
+              "    clk                         => bcd_clk,\n"
+              "    reset                       => bcd_reset,\n"
+              "    wreq_valid                  => bus_wreq_valid,\n"
+              "    wreq_ready                  => bus_wreq_ready,\n"
+              "    wreq_addr                   => bus_wreq_addr,\n"
+              "    wreq_len                    => bus_wreq_len,\n"
+              "    wreq_last                   => bus_wreq_last,\n"
+              "    wdat_valid                  => bus_wdat_valid,\n"
+              "    wdat_ready                  => bus_wdat_ready,\n"
+              "    wdat_data                   => bus_wdat_data,\n"
+              "    wdat_strobe                 => bus_wdat_strobe,\n"
+              "    wdat_last                   => bus_wdat_last,\n"
+              "    wrep_valid                  => bus_wrep_valid,\n"
+              "    wrep_ready                  => bus_wrep_ready,\n"
+              "    wrep_ok                     => bus_wrep_ok,\n"
+              "    print_stats                 => mem_print_stats\n"
+              "  );";
 
     t.Replace("MST_WREQ_DECLARE",
               "      wr_mst_wreq_valid         : out std_logic;\n"
@@ -292,20 +423,34 @@ std::string GenerateSimTop(const Design &design,
               "      wr_mst_wrep_ready         : out std_logic;\n"
               "      wr_mst_wrep_ok            : in  std_logic;\n");
 
-    t.Replace("MST_WREQ_INSTANTIATE",
-              "      wr_mst_wreq_valid         => bus_wreq_valid,\n"
-              "      wr_mst_wreq_ready         => bus_wreq_ready,\n"
-              "      wr_mst_wreq_addr          => bus_wreq_addr,\n"
-              "      wr_mst_wreq_len           => bus_wreq_len,\n"
-              "      wr_mst_wreq_last          => bus_wreq_last,\n"
-              "      wr_mst_wdat_valid         => bus_wdat_valid,\n"
-              "      wr_mst_wdat_ready         => bus_wdat_ready,\n"
-              "      wr_mst_wdat_data          => bus_wdat_data,\n"
-              "      wr_mst_wdat_strobe        => bus_wdat_strobe,\n"
-              "      wr_mst_wdat_last          => bus_wdat_last,\n"
-              "      wr_mst_wrep_valid         => bus_wrep_valid,\n"
-              "      wr_mst_wrep_ready         => bus_wrep_ready,\n"
-              "      wr_mst_wrep_ok            => bus_wrep_ok,");
+    std::string write_inst =
+        "      wr_mst_wreq_valid         => bus_wreq_valid,\n"
+        "      wr_mst_wreq_ready         => bus_wreq_ready,\n"
+        "      wr_mst_wreq_addr          => bus_wreq_addr,\n"
+        "      wr_mst_wreq_len           => bus_wreq_len,\n"
+        "      wr_mst_wreq_last          => bus_wreq_last,\n"
+        "      wr_mst_wdat_valid         => bus_wdat_valid,\n"
+        "      wr_mst_wdat_ready         => bus_wdat_ready,\n"
+        "      wr_mst_wdat_data          => bus_wdat_data,\n"
+        "      wr_mst_wdat_strobe        => bus_wdat_strobe,\n"
+        "      wr_mst_wdat_last          => bus_wdat_last,\n"
+        "      wr_mst_wrep_valid         => bus_wrep_valid,\n"
+        "      wr_mst_wrep_ready         => bus_wrep_ready,\n"
+        "      wr_mst_wrep_ok            => bus_wrep_ok,";
+
+    // The write memory model dumps its contents to a single file, so only one channel can be simulated.
+    auto write_channels = design.mantle_comp->channels(BusFunction::WRITE);
+    if (write_channels.size() > 1) {
+      FLETCHER_LOG(ERROR, "Simulation top level supports only one memory interface channel for writing.");
+    }
+    std::string write_mocks;
+    std::string write_insts;
+    for (auto ch : write_channels) {
+      write_mocks += ForChannel(write_mock, "wmem", ch);
+      write_insts += ForChannel(write_inst, "wmem", ch);
+    }
+    t.Replace("BUS_WRITE_SLAVE_MOCK", write_mocks);
+    t.Replace("MST_WREQ_INSTANTIATE", write_insts);
   } else {
     t.Replace("BUS_WRITE_SLAVE_MOCK", "");
     t.Replace("MST_WREQ_DECLARE", "");
@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -21,11 +22,38 @@
 
 namespace fletchgen::top {
 
-/// @brief Generate a simulation top level on supplied output streams from a ColumnWrapper
+/// Timing of the simulation top level clock and memory models.
+struct SimTiming {
+  /// Bus clock period in nanoseconds.
+  double clock_period = 10.0;
+  /// Kernel clock period in nanoseconds. 0 drives the kernel clock domain with the bus clock.
+  double kernel_clock_period = 0.0;
+  /// Number of cycles between accepting a read request and returning its first word, or between accepting the last
+  /// word of a write request and returning its response.
+  uint32_t latency = 0;
+  /// Maximum number of bytes transferred per cycle by every memory model. 0 transfers up to a bus word every cycle.
+  uint32_t bandwidth = 0;
+  /// Maximum number of outstanding read requests of every read memory model.
+  uint32_t max_outstanding = 1;
+};
+
+/**
+ * @brief Generate a simulation top level on supplied output streams from a ColumnWrapper
+ *
+ * When read_image_path is not empty, the read memory model loads the binary memory image at that path rather than the
+ * SREC file at read_srec_path. The memory models print the bandwidth they achieved at the end of the simulation.
+ *
+ * When cosim is true, the simulation is driven by a host application through the "sim" platform instead. The stimuli
+ * forward its MMIO commands to the kernel, and the memory models access its device memory through the co-simulation
+ * bridge (see platforms/sim).
+ */
 std::string GenerateSimTop(const Design &design,
                            const std::vector<std::ostream *> &outputs,
                            const std::string &read_srec_path,
                            const std::string &write_srec_path,
-                           const std::vector<fletcher::RecordBatchDescription> &recordbatches);
+                           const std::vector<fletcher::RecordBatchDescription> &recordbatches,
+                           const std::string &read_image_path = "",
+                           const SimTiming &timing = {},
+                           bool cosim = false);
 
 }
@@ -42,11 +42,12 @@ static char sim_source[] =
     "use work.Interconnect_pkg.all;\n"
     "use work.UtilStr_pkg.all;\n"
     "use work.UtilConv_pkg.all;\n"
+    "${COSIM_USE}"
     "\n"
     "entity SimTop_tc is\n"
     "  generic (\n"
     "    -- Accelerator properties\n"
-    "    INDEX_WIDTH                 : natural := 32;\n"
+    "    INDEX_WIDTH                 : natural := ${INDEX_WIDTH};\n"
     "    TAG_WIDTH                   : natural := 1;\n"
     "\n"
     "    -- Host bus properties\n"
@@ -71,6 +72,7 @@ static char sim_source[] =
     "  constant REG_STATUS           : natural := 1;\n"
     "  constant REG_RETURN0          : natural := 2;\n"
     "  constant REG_RETURN1          : natural := 3;\n"
+    "  constant REG_CYCLES           : natural := 5;\n"
     "\n"
     "  constant CONTROL_CLEAR        : std_logic_vector(31 downto 0) := X\"00000000\";\n"
     "  constant CONTROL_START        : std_logic_vector(31 downto 0) := X\"00000001\";\n"
@@ -83,6 +85,7 @@ static char sim_source[] =
     "\n"
     "  -- Sim signals\n"
     "  signal clock_stop             : boolean := false;\n"
+    "  signal mem_print_stats        : std_logic := '0';\n"
     "\n"
     "  -- Accelerator signals\n"
     "  signal kcd_clk                : std_logic;\n"
@@ -169,6 +172,7 @@ static char sim_source[] =
     "  signal bus_wrep_ok            : std_logic;\n"
     "  signal bus_wrep_valid         : std_logic;\n"
     "  signal bus_wrep_ready         : std_logic;\n"
+    "${BUS_CHANNEL_SIGNALS}"
     "\n"
     "  procedure mmio_write32 (constant idx    : in  natural;\n"
     "                          constant data   : in  std_logic_vector(31 downto 0);\n"
@@ -274,6 +278,7 @@ static char sim_source[] =
     "  stimuli_proc : process is\n"
     "    variable read_data        : std_logic_vector(31 downto 0) := X\"DEADBEEF\";\n"
     "    variable read_data_masked : std_logic_vector(31 downto 0);\n"
+    "    variable command          : integer;\n"
     "  begin\n"
     "    mmio_source.awvalid <= '0';\n"
     "    mmio_source.wvalid  <= '0';\n"
@@ -284,71 +289,56 @@ static char sim_source[] =
     "\n"
     "    wait until kcd_reset = '1' and bcd_reset = '1';\n"
     "\n"
-    "    -- 1. Reset the user core\n"
-    "    mmio_write32(REG_CONTROL, CONTROL_RESET, mmio_source, mmio_sink, bcd_clk, bcd_reset);\n"
-    "\n"
-    "    -- 2. Write addresses of the arrow buffers in the SREC file.\n"
-    "${SREC_BUFFER_ADDRESSES}\n"
-    "    -- 3. Write recordbatch bounds.\n"
-    "${SREC_FIRSTLAST_INDICES}\n"
-    "    -- 4. Write any kernel-specific registers.\n"
-    "${KERNEL_REGS_INIT}\n"
-    "    -- 5. Start the kernel.\n"
-    "${PROFILE_START}"
-    "    mmio_write32(REG_CONTROL, CONTROL_START, mmio_source, mmio_sink, bcd_clk, bcd_reset);\n"
+    "${STIMULI}"
+    "    -- Print the memory model statistics.\n"
+    "    mem_print_stats <= '1';\n"
+    "    wait until rising_edge(bcd_clk);\n"
     "\n"
-    "    -- 6. Poll for completion\n"
-    "    loop\n"
-    "      -- Wait a bunch of cycles.\n"
-    "      for I in 0 to 8 loop\n"
-    "        wait until rising_edge(bcd_clk);\n"
-    "      end loop;\n"
-    "\n"
-    "      -- Read the status register.\n"
-    "      mmio_read32(REG_STATUS, read_data, mmio_source, mmio_sink, bcd_clk, bcd_reset);\n"
-    "\n"
-    "      -- Check if we're done.\n"
-    "      read_data_masked := read_data and STATUS_DONE;\n"
-    "      exit when read_data_masked = STATUS_DONE;\n"
-    "    end loop;\n"
-    "\n"
-    "${PROFILE_STOP}\n"
-    "    -- 7. Read return register.\n"
-    "    mmio_read32(REG_RETURN0, read_data, mmio_source, mmio_sink, bcd_clk, bcd_reset);\n"
-    "    println(\"Return register 0: \" & slvToHex(read_data));\n"
-    "    mmio_read32(REG_RETURN1, read_data, mmio_source, mmio_sink, bcd_clk, bcd_reset);\n"
-    "    println(\"Return register 1: \" & slvToHex(read_data));\n"
-    "\n"
-    "    -- 8. Read profile registers.\n"
-    "${PROFILE_READ}\n"
-    "    -- 9. Finish and stop simulation.\n"
+    "    -- Finish and stop simulation.\n"
     "    report \"Stimuli done.\";\n"
     "    clock_stop <= true;\n"
     "\n"
     "    wait;\n"
     "  end process;\n"
     "\n"
-    "  clk_proc: process is\n"
+    "  kcd_clk_proc: process is\n"
     "  begin\n"
     "    if not clock_stop then\n"
     "      kcd_clk <= '1';\n"
-    "      bcd_clk <= '1';\n"
-    "      wait for 5 ns;\n"
+    "      wait for ${KCD_HALF_PERIOD} ns;\n"
     "      kcd_clk <= '0';\n"
+    "      wait for ${KCD_HALF_PERIOD} ns;\n"
+    "    else\n"
+    "      wait;\n"
+    "    end if;\n"
+    "  end process;\n"
+    "\n"
+    "  bcd_clk_proc: process is\n"
+    "  begin\n"
+    "    if not clock_stop then\n"
+    "      bcd_clk <= '1';\n"
+    "      wait for ${BCD_HALF_PERIOD} ns;\n"
     "      bcd_clk <= '0';\n"
-    "      wait for 5 ns;\n"
+    "      wait for ${BCD_HALF_PERIOD} ns;\n"
     "    else\n"
     "      wait;\n"
     "    end if;\n"
     "  end process;\n"
     "\n"
-    "  reset_proc: process is\n"
+    "  kcd_reset_proc: process is\n"
     "  begin\n"
     "    kcd_reset <= '1';\n"
-    "    bcd_reset <= '1';\n"
     "    wait for 50 ns;\n"
     "    wait until rising_edge(kcd_clk);\n"
     "    kcd_reset <= '0';\n"
+    "    wait;\n"
+    "  end process;\n"
+    "\n"
+    "  bcd_reset_proc: process is\n"
+    "  begin\n"
+    "    bcd_reset <= '1';\n"
+    "    wait for 50 ns;\n"
+    "    wait until rising_edge(bcd_clk);\n"
     "    bcd_reset <= '0';\n"
     "    wait;\n"
     "  end process;\n"
@@ -399,4 +389,75 @@ static char sim_source[] =
     "\n"
     "end architecture;\n";
 
+/// Stimuli that drive a simulation from the RecordBatches that the SREC file or memory image was generated from.
+static char sim_stimuli_source[] =
+    "    -- 1. Reset the user core\n"
+    "    mmio_write32(REG_CONTROL, CONTROL_RESET, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "\n"
+    "    -- 2. Write addresses of the arrow buffers in the SREC file.\n"
+    "${SREC_BUFFER_ADDRESSES}\n"
+    "    -- 3. Write recordbatch bounds.\n"
+    "${SREC_FIRSTLAST_INDICES}\n"
+    "    -- 4. Write any kernel-specific registers.\n"
+    "${KERNEL_REGS_INIT}\n"
+    "    -- 5. Start the kernel.\n"
+    "${PROFILE_START}"
+    "    mmio_write32(REG_CONTROL, CONTROL_START, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "\n"
+    "    -- 6. Poll for completion\n"
+    "    loop\n"
+    "      -- Wait a bunch of cycles.\n"
+    "      for I in 0 to 8 loop\n"
+    "        wait until rising_edge(kcd_clk);\n"
+    "      end loop;\n"
+    "\n"
+    "      -- Read the status register.\n"
+    "      mmio_read32(REG_STATUS, read_data, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "\n"
+    "      -- Check if we're done.\n"
+    "      read_data_masked := read_data and STATUS_DONE;\n"
+    "      exit when read_data_masked = STATUS_DONE;\n"
+    "    end loop;\n"
+    "\n"
+    "${PROFILE_STOP}\n"
+    "    -- 7. Read return register.\n"
+    "    mmio_read32(REG_RETURN0, read_data, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "    println(\"Return register 0: \" & slvToHex(read_data));\n"
+    "    mmio_read32(REG_RETURN1, read_data, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "    println(\"Return register 1: \" & slvToHex(read_data));\n"
+    "\n"
+    "    -- 8. Read the kernel clock cycles from start until done, least significant word first.\n"
+    "    mmio_read32(REG_CYCLES, read_data, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "    println(\"Kernel cycles: \" & slvToDec(read_data));\n"
+    "    mmio_read32(REG_CYCLES + 1, read_data, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "    println(\"Kernel cycles [1]: \" & slvToDec(read_data));\n"
+    "\n"
+    "    -- 9. Read profile registers.\n"
+    "${PROFILE_READ}\n";
+
+/// Stimuli that serve the commands of a host application through the co-simulation bridge.
+static char sim_cosim_stimuli_source[] =
+    "    -- Serve the MMIO commands of the host application until it terminates the platform.\n"
+    "    loop\n"
+    "      command := cosim_poll;\n"
+    "      case command is\n"
+    "        when COSIM_WRITE_MMIO =>\n"
+    "          mmio_write32(cosim_offset, std_logic_vector(to_signed(cosim_value, 32)),\n"
+    "                       mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "          cosim_complete(0);\n"
+    "        when COSIM_READ_MMIO =>\n"
+    "          mmio_read32(cosim_offset, read_data, mmio_source, mmio_sink, kcd_clk, kcd_reset);\n"
+    "          cosim_complete(to_integer(signed(read_data)));\n"
+    "        when COSIM_TERMINATE =>\n"
+    "          cosim_complete(0);\n"
+    "          exit;\n"
+    "        when others =>\n"
+    "          -- Let the simulation run while there is nothing to do.\n"
+    "          for I in 0 to 15 loop\n"
+    "            wait until rising_edge(kcd_clk);\n"
+    "          end loop;\n"
+    "      end case;\n"
+    "    end loop;\n"
+    "\n";
+
 }  // namespace fletchgen::top
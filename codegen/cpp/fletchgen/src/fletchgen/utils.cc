@@ -17,6 +17,10 @@
 #include <fletcher/common.h>
 #include <cerata/api.h>
 #include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
 
 #include "fletchgen_config/config.h"
 
@@ -69,6 +73,31 @@ void LogCerata(cerata::LogLevel level,
   }
 }
 
+void ParallelFor(size_t n, size_t threads, const std::function<void(size_t)> &func) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min(threads, n);
+  if (threads <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      func(i);
+    }
+    return;
+  }
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back([&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        func(i);
+      }
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+}
+
 std::string version() {
   return "fletchgen " + std::to_string(FLETCHGEN_VERSION_MAJOR)
       + "." + std::to_string(FLETCHGEN_VERSION_MINOR)
@@ -18,6 +18,7 @@
 #include <cerata/api.h>
 
 #include <string>
+#include <functional>
 
 /// Contains all classes and functions related to Fletchgen.
 namespace fletchgen {
@@ -42,6 +43,17 @@ void LogCerata(cerata::LogLevel level,
                char const *source_file,
                int line_number);
 
+/**
+ * @brief Call a function for every index in [0, n) on a pool of worker threads.
+ *
+ * Indices are handed out in ascending order, but may complete in any order. Returns when all calls have completed.
+ *
+ * @param n       The number of indices.
+ * @param threads The maximum number of worker threads. 0 uses the number of hardware threads.
+ * @param func    The function to call with each index.
+ */
+void ParallelFor(size_t n, size_t threads, const std::function<void(size_t)> &func);
+
 /// Default copyright notice.
 constexpr char DEFAULT_NOTICE[] = "-- Copyright 2018-2019 Delft University of Technology\n"
                                   "--\n"
@@ -21,6 +21,8 @@
 #include <vector>
 #include <memory>
 #include <fstream>
+#include <sstream>
+#include <iterator>
 
 #include "fletchgen/srec/srec.h"
 #include "fletchgen/srec/recordbatch.h"
@@ -68,6 +70,28 @@ TEST(SREC, FromString) {
   TEST_SREC_STR("S107003000144ED492");
 }
 
+TEST(SREC, RecordView) {
+  // Parse into a caller-provided buffer and format into a reusable line buffer.
+  const std::string line = "S11300100002000800082629001853812341001813";
+  uint8_t data[Record::MAX_DATA_BYTES];
+  RecordView view;
+  ASSERT_TRUE(RecordView::Parse(line.data(), line.size(), data, sizeof(data), &view));
+  ASSERT_EQ(view.type(), Record::DATA16);
+  ASSERT_EQ(view.address(), 0x10u);
+  ASSERT_EQ(view.size(), 16u);
+  ASSERT_EQ(view.data(), data);
+  char text[Record::MAX_LINE_LENGTH];
+  ASSERT_EQ(std::string(text, view.Format(text, true)), line + "\n");
+
+  // Bad checksums, characters and byte counts are rejected.
+  RecordView bad;
+  ASSERT_FALSE(RecordView::Parse("S107003000144ED493", 18, data, sizeof(data), &bad));
+  ASSERT_FALSE(RecordView::Parse("S107003000144EDX92", 18, data, sizeof(data), &bad));
+  ASSERT_FALSE(RecordView::Parse("S108003000144ED492", 18, data, sizeof(data), &bad));
+  // Records larger than the data buffer are rejected.
+  ASSERT_FALSE(RecordView::Parse(line.data(), line.size(), data, 8, &bad));
+}
+
 TEST(SREC, File) {
   // Test a round trip via a file.
   uint8_t data[52] = {0x28, 0x5F, 0x24, 0x5F, 0x22, 0x12, 0x22, 0x6A,
@@ -91,6 +115,26 @@ TEST(SREC, File) {
   free(result);
 }
 
+TEST(SREC, Writer) {
+  // Streaming data in uneven pieces must yield the same records as a File of the whole image.
+  uint8_t data[100];
+  for (size_t i = 0; i < 100; i++) {
+    data[i] = static_cast<uint8_t>(i < 90 ? i : 0);
+  }
+  std::stringstream expected;
+  File(0, data, 100).write(&expected);
+
+  std::stringstream streamed;
+  Writer sr(&streamed);
+  sr.Write(data, 7);
+  sr.Write(data + 7, 50);
+  sr.Write(data + 57, 33);
+  sr.Pad(10);
+  ASSERT_EQ(sr.address(), 100);
+  sr.Flush();
+  ASSERT_EQ(streamed.str(), expected.str());
+}
+
 TEST(SREC, RecordBatchRoundTrip) {
   // Get a recordbatch with some integers
   auto rb = fletcher::GetStringRB();
@@ -109,4 +153,82 @@ TEST(SREC, RecordBatchRoundTrip) {
   EXPECT_TRUE(afw.ValueOrDie()->WriteRecordBatch(*rb).ok());
 }
 
+TEST(SREC, ReadRecordBatchesFromSREC) {
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches = {fletcher::GetFilterRB(), fletcher::GetListUint8RB()};
+  std::vector<fletcher::RecordBatchDescription> meta_in;
+  for (const auto &rb : batches) {
+    fletcher::RecordBatchDescription desc;
+    fletcher::RecordBatchAnalyzer rba(&desc);
+    ASSERT_TRUE(rba.Analyze(*rb));
+    meta_in.push_back(desc);
+  }
+
+  // Write the SREC and gather the buffer offsets it used.
+  std::vector<fletcher::RecordBatchDescription> meta_out;
+  auto ofs = std::ofstream("srec_read_test.srec");
+  GenerateReadSREC(meta_in, &meta_out, &ofs, 64);
+  ofs.close();
+  std::vector<std::shared_ptr<arrow::Schema>> schemas;
+  std::vector<uint64_t> num_rows;
+  std::vector<uint64_t> offsets;
+  for (size_t i = 0; i < batches.size(); i++) {
+    schemas.push_back(batches[i]->schema());
+    num_rows.push_back(batches[i]->num_rows());
+    for (const auto &f : meta_out[i].fields) {
+      for (const auto &b : f.buffers) {
+        offsets.push_back(reinterpret_cast<uint64_t>(b.raw_buffer_));
+      }
+    }
+  }
+
+  auto ifs = std::ifstream("srec_read_test.srec");
+  auto result = ReadRecordBatchesFromSREC(&ifs, schemas, num_rows, offsets);
+  ASSERT_EQ(result.size(), batches.size());
+  for (size_t i = 0; i < batches.size(); i++) {
+    ASSERT_TRUE(result[i]->Equals(*batches[i]));
+  }
+}
+
+TEST(SREC, GenerateReadImage) {
+  auto rb = fletcher::GetFilterRB();
+  fletcher::RecordBatchDescription desc;
+  fletcher::RecordBatchAnalyzer rba(&desc);
+  ASSERT_TRUE(rba.Analyze(*rb));
+
+  // The image must hold the same bytes at the same offsets as the SREC file.
+  std::vector<fletcher::RecordBatchDescription> srec_meta;
+  auto srec_ofs = std::ofstream("image_test.srec");
+  GenerateReadSREC({desc}, &srec_meta, &srec_ofs, 64);
+  srec_ofs.close();
+  std::vector<fletcher::RecordBatchDescription> image_meta;
+  std::stringstream manifest;
+  auto image_ofs = std::ofstream("image_test.bin", std::ios::binary);
+  GenerateReadImage({desc}, &image_meta, &image_ofs, &manifest, 64);
+  image_ofs.close();
+
+  auto ifs = std::ifstream("image_test.srec");
+  uint8_t *srec_data;
+  size_t srec_size;
+  File(&ifs).ToBuffer(&srec_data, &srec_size);
+  auto bin = std::ifstream("image_test.bin", std::ios::binary);
+  std::vector<char> image((std::istreambuf_iterator<char>(bin)), std::istreambuf_iterator<char>());
+  ASSERT_EQ(image.size(), srec_size);
+  ASSERT_EQ(memcmp(image.data(), srec_data, srec_size), 0);
+  free(srec_data);
+
+  // The manifest has one line per buffer, at the offsets of the SREC layout.
+  size_t lines = 0;
+  for (const auto &f : srec_meta[0].fields) {
+    for (const auto &b : f.buffers) {
+      std::string offset;
+      manifest >> offset;
+      ASSERT_EQ(std::stoull(offset, nullptr, 16), reinterpret_cast<uint64_t>(b.raw_buffer_));
+      std::string rest;
+      std::getline(manifest, rest);
+      lines++;
+    }
+  }
+  ASSERT_GT(lines, 0u);
+}
+
 }  // namespace fletchgen::srec
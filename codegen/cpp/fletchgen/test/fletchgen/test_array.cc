@@ -19,6 +19,7 @@
 
 #include "fletcher/common.h"
 #include "fletchgen/array.h"
+#include "fletchgen/epc.h"
 #include "fletchgen/test_utils.h"
 
 namespace fletchgen {
@@ -87,4 +88,95 @@ TEST(Array, Writer) {
   GenerateTestDecl(top);
 }
 
+TEST(Array, DictionaryReader) {
+  auto top = dictionary_reader();
+  GenerateTestDecl(top);
+
+  // The kernel sees the decoded values, while both the indices and dictionary buffer addresses are passed on.
+  auto dict = arrow::field("test", arrow::dictionary(arrow::uint8(), arrow::float64()), false);
+  ASSERT_EQ(GetConfigType(*dict->type()), ConfigType::DICTIONARY);
+  ASSERT_EQ(GetArrayDataSpec(*dict), std::pair<uint32_t, uint32_t>(1, 64));
+  ASSERT_EQ(GetCtrlBufferCount(*dict), 2);
+}
+
+TEST(Array, Lz4Reader) {
+  auto top = lz4_reader();
+  GenerateTestDecl(top);
+
+  // The kernel sees the decompressed values of a single compressed values buffer.
+  auto field = fletcher::WithMetaCompression(*arrow::field("test", arrow::uint32(), false));
+  ASSERT_EQ(GetArrayDataSpec(*field), std::pair<uint32_t, uint32_t>(1, 32));
+  ASSERT_EQ(GetCtrlBufferCount(*field), 1);
+  ASSERT_FALSE(DeriveEPC(*field, BusDim(), 64));
+}
+
+TEST(Array, RunEndReader) {
+  auto top = run_end_reader();
+  GenerateTestDecl(top);
+
+  // The kernel sees the expanded values, while the runs are read from a run ends and a values buffer.
+  auto epc = fletcher::WithMetaEPC(*arrow::field("test", arrow::uint32(), false), 4);
+  auto field = fletcher::WithMetaRunEndEncoding(*epc);
+  ASSERT_EQ(GetArrayDataSpec(*field), std::pair<uint32_t, uint32_t>(1, 3 + 4 * 32));
+  ASSERT_EQ(GetCtrlBufferCount(*field), 2);
+  ASSERT_EQ(GetCtrlFlagCount(*field), 0);
+  ASSERT_EQ(GenerateConfigString(*field), "prim(32;epc=4)");
+  ASSERT_FALSE(DeriveEPC(*field, BusDim(), 64));
+}
+
+TEST(Array, ParquetPageReader) {
+  auto top = parquet_page_reader();
+  GenerateTestDecl(top);
+
+  // The kernel sees the values and validity of a nullable field, while the page is read from a single buffer.
+  auto field = fletcher::WithMetaParquetEncoding(*arrow::field("test", arrow::uint32(), true));
+  ASSERT_EQ(GetArrayDataSpec(*field), std::pair<uint32_t, uint32_t>(1, 33));
+  ASSERT_EQ(GetCtrlBufferCount(*field), 1);
+  ASSERT_EQ(GetCtrlFlagCount(*field), 0);
+  ASSERT_FALSE(DeriveEPC(*field, BusDim(), 64));
+}
+
+TEST(Array, LargeOffsets) {
+  // Types with 64-bit offsets use the same configurations, but with a 64-bit length stream.
+  auto str = arrow::field("test", arrow::large_utf8(), false);
+  ASSERT_EQ(GetConfigType(*str->type()), ConfigType::LIST_PRIM);
+  ASSERT_EQ(GenerateConfigString(*str), "listprim(8)");
+  ASSERT_EQ(GetArrayDataSpec(*str), std::pair<uint32_t, uint32_t>(2, 64 + 8 + 1 + 1));
+  auto list = arrow::field("test", arrow::large_list(arrow::field("inner", arrow::uint16(), false)), false);
+  ASSERT_EQ(GetConfigType(*list->type()), ConfigType::LIST_PRIM);
+  ASSERT_EQ(GetArrayDataSpec(*list), std::pair<uint32_t, uint32_t>(2, 64 + 16 + 1 + 1));
+  GetStreamType(*str, fletcher::Mode::READ);
+}
+
+TEST(Array, FixedSizeList) {
+  // A fixed-size list is read as a single primitive element of the width of a whole list, without offsets.
+  auto vec = arrow::field("test", arrow::fixed_size_list(arrow::field("item", arrow::float32(), false), 128), false);
+  ASSERT_EQ(GetConfigType(*vec->type()), ConfigType::PRIM);
+  ASSERT_EQ(GenerateConfigString(*vec), "prim(4096)");
+  ASSERT_EQ(GetArrayDataSpec(*vec), std::pair<uint32_t, uint32_t>(1, 4096));
+  ASSERT_EQ(GetCtrlBufferCount(*vec), 1);
+  GetStreamType(*vec, fletcher::Mode::READ);
+
+  auto epc = fletcher::WithMetaEPC(*vec, 2);
+  ASSERT_EQ(GenerateConfigString(*epc), "prim(4096;epc=2)");
+  ASSERT_EQ(GetArrayDataSpec(*epc), std::pair<uint32_t, uint32_t>(1, 2 + 2 * 4096));
+}
+
+TEST(Array, ConfigStringBufferDepth) {
+  auto prim = fletcher::WithMetaEPC(*arrow::field("test", arrow::uint32(), false), 4);
+  prim = fletcher::WithMetaBufferDepth(*prim, 64, 256);
+  ASSERT_EQ(GenerateConfigString(*prim), "prim(32;epc=4,bus_fifo_depth=64,fifo_size=256)");
+
+  auto str = fletcher::WithMetaBufferDepth(*arrow::field("test", arrow::utf8(), false), 32);
+  ASSERT_EQ(GenerateConfigString(*str), "listprim(8;bus_fifo_depth=32,idx_bus_fifo_depth=32)");
+}
+
+TEST(Array, ConfigStringWriteCoalesce) {
+  auto prim = fletcher::WithMetaWriteCoalesce(*arrow::field("test", arrow::uint32(), false));
+  ASSERT_EQ(GenerateConfigString(*prim), "prim(32;coalesce=1)");
+
+  auto str = fletcher::WithMetaWriteCoalesce(*arrow::field("test", arrow::utf8(), false));
+  ASSERT_EQ(GenerateConfigString(*str), "listprim(8;coalesce=1,idx_coalesce=1)");
+}
+
 }  // namespace fletchgen
@@ -0,0 +1,68 @@
+// Copyright 2018-2019 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <cerata/api.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fletcher/test_schemas.h"
+
+#include "fletchgen/filter.h"
+#include "fletchgen/nucleus.h"
+#include "fletchgen/design.h"
+
+#include "fletchgen/test_utils.h"
+
+namespace fletchgen {
+
+TEST(Filter, ParseExpr) {
+  auto expr = ParseFilterExpr(" price>=min_price ");
+  ASSERT_TRUE(expr);
+  ASSERT_EQ(expr->field, "price");
+  ASSERT_EQ(expr->op, FilterOp::GE);
+  ASSERT_EQ(expr->reg, "min_price");
+  ASSERT_EQ(ParseFilterExpr("a != b")->op, FilterOp::NE);
+  ASSERT_EQ(ToVHDL(FilterOp::NE), "/=");
+  ASSERT_FALSE(ParseFilterExpr("price >= "));
+  ASSERT_FALSE(ParseFilterExpr("price => min_price"));
+}
+
+TEST(Filter, Nucleus) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::GetRowFilterSchema();
+  auto fs = std::make_shared<FletcherSchema>(schema, "RowFilterRead");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto regs = Design::GetRecordBatchRegs({rbd});
+  regs.emplace_back(MmioFunction::KERNEL, MmioBehavior::CONTROL, "min_price", "", 32);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+  ASSERT_EQ(n->filters.size(), 1u);
+  GenerateTestAll(n);
+
+  // The comparison is signed, and the nullable key must be valid for a row to pass.
+  auto vhdl = n->filters[0]->GenerateVHDL();
+  std::cout << vhdl << std::endl;
+  ASSERT_NE(vhdl.find("entity RowFilterRead_Filter is"), std::string::npos);
+  ASSERT_NE(vhdl.find("signed(in_RowFilterRead_price) >= resize(signed(threshold), 64)"), std::string::npos);
+  ASSERT_NE(vhdl.find("(in_RowFilterRead_price_validity = '1')"), std::string::npos);
+  ASSERT_NE(vhdl.find("out_RowFilterRead_id_dvalid <= in_RowFilterRead_id_dvalid and pass;"), std::string::npos);
+}
+
+}  // namespace fletchgen
@@ -16,6 +16,7 @@
 #include <cerata/api.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "fletcher/test_schemas.h"
 
@@ -23,6 +24,10 @@
 #include "fletchgen/mantle.h"
 #include "fletchgen/bus.h"
 #include "fletchgen/schema.h"
+#include "fletchgen/design.h"
+#include "fletchgen/expression.h"
+#include "fletchgen/pipelined.h"
+#include "fletchgen/hls/vivado.h"
 
 #include "fletchgen/test_utils.h"
 
@@ -60,4 +65,103 @@ TEST(Kernel, BigSchema) {
   TestReadKernel("Big", fletcher::GetBigSchema());
 }
 
+TEST(Kernel, VivadoHLSTemplate) {
+  cerata::default_component_pool()->Clear();
+  auto schema = arrow::schema({fletcher::WithMetaEPC(*arrow::field("number", arrow::int32(), false), 4),
+                               fletcher::WithMetaEPC(*arrow::field("name", arrow::utf8(), false), 8)});
+  schema = fletcher::WithMetaRequired(*schema, "Numbers", fletcher::Mode::READ);
+  auto fs = FletcherSchema::Make(schema);
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto rbr = record_batch("Test_" + fs->name(), fs, rbd);
+  auto top = kernel("TestHLS", {rbr}, mmio({rbd}, {}, Axi4LiteSpec()));
+  auto src = hls::GenerateVivadoHLSTemplate(*top);
+  ASSERT_NE(src.find("hls::stream<f_mint32<4>> number;"), std::string::npos);
+  ASSERT_NE(src.find("hls::stream<f_size> name_lengths;"), std::string::npos);
+  ASSERT_NE(src.find("hls::stream<f_muint8<8>> name_chars;"), std::string::npos);
+  ASSERT_NE(src.find("bool TestHLS("), std::string::npos);
+}
+
+TEST(Kernel, ParseExpr) {
+  auto expr = ParseKernelExpr("sum(price * quantity) WHERE quantity > min_quantity and price <= 1000");
+  ASSERT_TRUE(expr);
+  ASSERT_EQ(expr->func, AggregateFunc::SUM);
+  ASSERT_EQ(expr->fields, std::vector<std::string>({"price", "quantity"}));
+  ASSERT_EQ(expr->op, '*');
+  ASSERT_EQ(expr->conditions.size(), 2u);
+  ASSERT_EQ(expr->conditions[1].op, FilterOp::LE);
+  ASSERT_EQ(expr->conditions[1].reg, "1000");
+  ASSERT_TRUE(ParseKernelExpr("COUNT(*) WHERE id != 0"));
+  ASSERT_TRUE(ParseKernelExpr("MAX(price)"));
+  ASSERT_FALSE(ParseKernelExpr("COUNT(a + b)"));
+  ASSERT_FALSE(ParseKernelExpr("SUM(*)"));
+  ASSERT_FALSE(ParseKernelExpr("SUM(a) WHERE"));
+  ASSERT_FALSE(ParseKernelExpr("AVG(a)"));
+}
+
+TEST(Kernel, Expression) {
+  cerata::default_component_pool()->Clear();
+  auto schema = arrow::schema({arrow::field("id", arrow::uint32(), false),
+                               arrow::field("price", arrow::int64(), true),
+                               arrow::field("quantity", arrow::uint16(), false)});
+  schema = fletcher::WithMetaRequired(*schema, "Orders", fletcher::Mode::READ);
+  auto fs = FletcherSchema::Make(schema);
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto regs = Design::GetRecordBatchRegs({rbd});
+  regs.emplace_back(MmioFunction::KERNEL, MmioBehavior::CONTROL, "min_quantity", "", 16);
+  auto rbr = record_batch("Test_" + fs->name(), fs, rbd);
+  auto top = kernel("TestExpr", {rbr}, mmio({rbd}, regs, Axi4LiteSpec()));
+  auto expr = ParseKernelExpr("SUM(price * quantity) WHERE quantity > min_quantity AND price < 1000");
+  ASSERT_TRUE(expr);
+  ImplementKernel(top.get(), *expr);
+
+  // Commands are only issued to fields of the expression, and rows with a null price are skipped.
+  auto vhdl = GenerateKernelVHDL(*top, *expr);
+  ASSERT_NE(vhdl.find("entity TestExpr is"), std::string::npos);
+  ASSERT_NE(vhdl.find("Orders_price_cmd_firstIdx <= Orders_firstidx;"), std::string::npos);
+  ASSERT_NE(vhdl.find("Orders_id_cmd_valid <= '0';"), std::string::npos);
+  ASSERT_NE(vhdl.find("(Orders_price_validity = '1')"), std::string::npos);
+  ASSERT_NE(vhdl.find("(signed(resize(unsigned(Orders_quantity), 66)) > signed(resize(unsigned(min_quantity), 66)))"),
+            std::string::npos);
+  ASSERT_NE(vhdl.find("product <= resize(signed(Orders_price), 66) * signed(resize(unsigned(Orders_quantity), 66));"),
+            std::string::npos);
+  ASSERT_NE(vhdl.find("acc <= acc + agg_value;"), std::string::npos);
+}
+
+TEST(Kernel, Pipelined) {
+  cerata::default_component_pool()->Clear();
+  auto in_schema = arrow::schema({arrow::field("number", arrow::int64(), true),
+                                  arrow::field("name", arrow::utf8(), false)});
+  in_schema = fletcher::WithMetaRequired(*in_schema, "In", fletcher::Mode::READ);
+  auto out_schema = arrow::schema({arrow::field("number", arrow::int64(), true)});
+  out_schema = fletcher::WithMetaRequired(*out_schema, "Out", fletcher::Mode::WRITE);
+  std::vector<fletcher::RecordBatchDescription> rbds;
+  std::vector<std::shared_ptr<RecordBatch>> rbs;
+  for (const auto &schema : {in_schema, out_schema}) {
+    auto fs = FletcherSchema::Make(schema);
+    fletcher::RecordBatchDescription rbd;
+    fletcher::SchemaAnalyzer sa(&rbd);
+    sa.Analyze(*schema);
+    rbds.push_back(rbd);
+    rbs.push_back(record_batch("Test_" + fs->name(), fs, rbd));
+  }
+  auto top = kernel("TestPipelined", rbs, mmio(rbds, Design::GetRecordBatchRegs(rbds), Axi4LiteSpec()));
+  PipelineKernel(top.get());
+
+  // Every stream passes through a slice, and In.number passes through its stage to Out.number.
+  auto vhdl = GeneratePipelinedKernelVHDL(*top);
+  ASSERT_NE(vhdl.find("entity TestPipelined is"), std::string::npos);
+  ASSERT_NE(vhdl.find("In_number_slice: StreamSlice"), std::string::npos);
+  ASSERT_NE(vhdl.find("In_name_chars_slice: StreamSlice"), std::string::npos);
+  ASSERT_NE(vhdl.find("Out_number_cmd_slice: StreamSlice"), std::string::npos);
+  ASSERT_NE(vhdl.find("In_number_p_data <= In_number_dvalid & In_number_last & In_number_validity & In_number;"),
+            std::string::npos);
+  ASSERT_NE(vhdl.find("Out_number_k_data  <= In_number_stg_data;"), std::string::npos);
+  ASSERT_NE(vhdl.find("In_name_stg_ready <= '1';"), std::string::npos);
+  ASSERT_NE(vhdl.find("Out_number_cmd_k_data  <= Out_firstidx & Out_lastidx"), std::string::npos);
+}
+
 }  // namespace fletchgen
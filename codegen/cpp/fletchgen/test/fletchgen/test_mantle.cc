@@ -13,10 +13,12 @@
 // limitations under the License.
 
 #include <arrow/api.h>
+#include <fletcher/fletcher.h>
 #include <cerata/api.h>
 #include <gtest/gtest.h>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "fletchgen/design.h"
 #include "fletchgen/mantle.h"
@@ -26,7 +28,10 @@
 
 namespace fletchgen {
 
-static void TestReadMantle(const std::shared_ptr<arrow::Schema> &schema) {
+static std::shared_ptr<Mantle> TestReadMantle(const std::shared_ptr<arrow::Schema> &schema,
+                                              ArbiterTopology topology = {},
+                                              std::string *vhdl = nullptr,
+                                              bool profile_bus = false) {
   cerata::default_component_pool()->Clear();
   auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
   fletcher::RecordBatchDescription rbd;
@@ -35,15 +40,19 @@ static void TestReadMantle(const std::shared_ptr<arrow::Schema> &schema) {
   std::vector<fletcher::RecordBatchDescription> rbds = {rbd};
   auto rb_regs = Design::GetRecordBatchRegs(rbds);
   auto r = record_batch("Test_" + rbd.name, fs, rbd);
-  auto pr_regs = GetProfilingRegs({r});
+  auto pr_regs = GetProfilingRegs({r}, 32, profile_bus);
   std::vector<MmioReg> regs;
   regs.insert(regs.end(), rb_regs.begin(), rb_regs.end());
   regs.insert(regs.end(), pr_regs.begin(), pr_regs.end());
   auto m = mmio({rbd}, regs, Axi4LiteSpec());
   auto k = kernel("Test_Kernel", {r}, m);
   auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
-  auto man = mantle("Test_Mantle", {r}, n, BusDim(), Axi4LiteSpec());
-  GenerateTestAll(man);
+  auto man = mantle("Test_Mantle", {r}, n, BusDim(), Axi4LiteSpec(), topology);
+  auto src = GenerateTestAll(man);
+  if (vhdl != nullptr) {
+    *vhdl = src;
+  }
+  return man;
 }
 
 TEST(Mantle, TwoPrim) {
@@ -58,4 +67,196 @@ TEST(Mantle, NullablePrim) {
   TestReadMantle(fletcher::GetNullablePrimReadSchema());
 }
 
+TEST(Mantle, BusChannels) {
+  auto schema = fletcher::GetTwoPrimReadSchema();
+  schema = schema->SetField(1, fletcher::WithMetaBusChannel(*schema->field(1), 1)).ValueOrDie();
+  auto man = TestReadMantle(schema);
+  ASSERT_EQ(man->channels(BusFunction::READ), std::vector<uint32_t>({0, 1}));
+  ASSERT_TRUE(man->channels(BusFunction::WRITE).empty());
+}
+
+TEST(Mantle, ArbiterTree) {
+  std::string src;
+  TestReadMantle(fletcher::GetBigSchema(), ArbiterTopology{2, true}, &src);
+  // Five bus ports with a fan-in of two result in two levels of arbiters below the root arbiter.
+  ASSERT_NE(src.find("_l0_0_inst"), std::string::npos);
+  ASSERT_NE(src.find("_l0_1_inst"), std::string::npos);
+  ASSERT_EQ(src.find("_l0_2_inst"), std::string::npos);
+  ASSERT_NE(src.find("_l1_0_inst"), std::string::npos);
+  ASSERT_EQ(src.find("_l2_0_inst"), std::string::npos);
+  ASSERT_NE(src.find("_buf4_inst"), std::string::npos);
+  ASSERT_NE(src.find("BusReadLeafBuffer"), std::string::npos);
+}
+
+TEST(Mantle, ArbiterWeights) {
+  std::string src;
+  auto schema = fletcher::GetTwoPrimReadSchema();
+  schema = schema->SetField(1, arrow::field("B", arrow::int64(), false)).ValueOrDie();
+  // Without weights, all bus ports are arbitrated equally.
+  TestReadMantle(schema, {}, &src);
+  ASSERT_EQ(src.find("\"1,8\""), std::string::npos);
+  // The 64-bit field demands eight times the bytes per cycle of the 8-bit field.
+  ArbiterTopology topology;
+  topology.weights = true;
+  TestReadMantle(schema, topology, &src);
+  ASSERT_NE(src.find("\"1,8\""), std::string::npos);
+  // An explicit weight is used even if the ports are not weighed by their demand.
+  schema = schema->SetField(0, fletcher::WithMetaBusWeight(*schema->field(0), 3)).ValueOrDie();
+  TestReadMantle(schema, {}, &src);
+  ASSERT_NE(src.find("\"3,1\""), std::string::npos);
+}
+
+TEST(Mantle, BusSlices) {
+  std::string src;
+  ArbiterTopology topology;
+  topology.fan_in = 2;
+  topology.tree_slices = 1;
+  topology.master_slices = 2;
+  TestReadMantle(fletcher::GetBigSchema(), topology, &src);
+  ASSERT_NE(src.find("BusReadSlice"), std::string::npos);
+  ASSERT_EQ(src.find("_leaf0_slice0_inst"), std::string::npos);
+  ASSERT_NE(src.find("_l0_0_slice0_inst"), std::string::npos);
+  ASSERT_NE(src.find("_mst_slice1_inst"), std::string::npos);
+  // The five bus ports reach the fan-in from which every leaf gets a slice.
+  topology.slice_fan_in = 5;
+  TestReadMantle(fletcher::GetBigSchema(), topology, &src);
+  ASSERT_NE(src.find("_leaf4_slice0_inst"), std::string::npos);
+  ASSERT_EQ(src.find("_leaf0_slice1_inst"), std::string::npos);
+}
+
+TEST(Mantle, BusProfiling) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::GetTwoPrimReadSchema();
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  // Two read bus ports with a request and a data stream each.
+  size_t bus_regs = 0;
+  for (const auto &reg : GetProfilingRegs({r}, 32, true)) {
+    bus_regs += reg.meta.count(MMIO_PROFILE_BUS);
+  }
+  ASSERT_EQ(bus_regs, 2 * 2 * ProfileCounterNames().size());
+
+  std::string src;
+  auto man = TestReadMantle(schema, {}, &src, true);
+  ASSERT_TRUE(man->nucleus()->Has("Profile_bus_enable"));
+  ASSERT_NE(src.find("Profiler_"), std::string::npos);
+}
+
+TEST(Mantle, DescriptorRing) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetPrimReadSchema()};
+  options->descriptor_ring = true;
+  Design design(options);
+  // A descriptor holds the first and last index and the 64-bit values buffer address, which fits in a single beat.
+  ASSERT_EQ(design.ring_regs.size(), 6u);
+  ASSERT_EQ(design.ring_regs[0].name, "ring_enable");
+  ASSERT_EQ(design.ring_regs[5].meta.at(MMIO_RING_REGS), "4");
+  ASSERT_EQ(design.ring_regs[5].init, 64u);
+  // The ring is hidden from the kernel, and fetches its descriptors through the read bus of the Mantle.
+  ASSERT_FALSE(design.kernel_comp->Has("ring_tail"));
+  ASSERT_TRUE(design.nucleus_comp->Has("ring_bus"));
+  auto src = GenerateTestAll(design.mantle_comp);
+  ASSERT_NE(src.find("DescriptorRing"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+}
+
+TEST(Mantle, KernelTimer) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetPrimReadSchema()};
+  options->kernel_clock_hz = 250000000;
+  Design design(options);
+  // The cycles and clock frequency registers precede the schema-derived registers, see fletcher.h.
+  ASSERT_EQ(design.default_regs.size(), 10u);
+  ASSERT_EQ(design.default_regs[8].name, "cycles");
+  ASSERT_EQ(*design.default_regs[8].addr, 4u * FLETCHER_REG_CYCLES);
+  ASSERT_EQ(*design.default_regs[9].addr, 4u * FLETCHER_REG_CLOCK_HZ);
+  ASSERT_EQ(design.default_regs[9].init, 250000000u);
+  auto addresses = AssignMmioAddresses(design.all_regs, design.mmio_spec);
+  ASSERT_EQ(addresses[design.default_regs.size()], 4u * FLETCHER_REG_SCHEMA);
+  // The counter is driven by the Nucleus rather than by the kernel.
+  ASSERT_FALSE(design.kernel_comp->Has("cycles"));
+  auto src = GenerateTestAll(design.mantle_comp);
+  ASSERT_NE(src.find("KernelTimer"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+}
+
+TEST(Mantle, CompletionRecord) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetPrimReadSchema()};
+  options->completion_record = true;
+  Design design(options);
+  ASSERT_EQ(design.completion_regs.size(), 1u);
+  ASSERT_EQ(design.completion_regs[0].name, "completion_address");
+  // The record is written by the Nucleus, which gets a write bus master even though the schemas are only read.
+  ASSERT_FALSE(design.kernel_comp->Has("completion_address"));
+  ASSERT_TRUE(design.nucleus_comp->Has("completion_bus"));
+  ASSERT_TRUE(design.mantle_comp->Has("wr_mst"));
+  auto src = GenerateTestAll(design.mantle_comp);
+  ASSERT_NE(src.find("CompletionWriter"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+}
+
+TEST(Mantle, BusTrace) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetTwoPrimReadSchema()};
+  options->bus_trace = 100;
+  Design design(options);
+  // The ring depth is rounded up to a power of two, and both read bus ports are named by a constant register.
+  ASSERT_EQ(design.trace_regs.size(), 12u);
+  ASSERT_EQ(design.trace_regs[0].name, "Trace_depth");
+  ASSERT_EQ(design.trace_regs[0].init, 128u);
+  ASSERT_EQ(design.trace_regs[3].meta.at(MMIO_TRACE_DEPTH_LOG2), "7");
+  ASSERT_EQ(design.trace_regs[10].name.rfind("Trace_port_", 0), 0u);
+  ASSERT_EQ(design.trace_regs[10].init, 0u);
+  ASSERT_EQ(design.trace_regs[11].init, 0u);
+  // The bus ports are only available in the Mantle, so the Nucleus exposes the registers.
+  ASSERT_FALSE(design.kernel_comp->Has("Trace_index"));
+  ASSERT_TRUE(design.nucleus_comp->Has("Trace_index"));
+  auto src = GenerateTestAll(design.mantle_comp);
+  ASSERT_NE(src.find("BusTracer"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+}
+
+TEST(Mantle, Progress) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetPrimReadSchema()};
+  options->progress = true;
+  Design design(options);
+  ASSERT_EQ(design.progress_regs.size(), 1u);
+  ASSERT_EQ(design.progress_regs[0].name, "PrimRead_consumed");
+  ASSERT_EQ(design.progress_regs[0].function, MmioFunction::PROGRESS);
+  // The kernel is stopped through the command mergers, and the rows are counted by the Nucleus.
+  ASSERT_FALSE(design.kernel_comp->Has("PrimRead_consumed"));
+  auto src = GenerateTestAll(design.mantle_comp);
+  ASSERT_NE(src.find("KernelStop"), std::string::npos);
+  ASSERT_NE(src.find("Consumed_clear"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+}
+
+TEST(Mantle, ChunkList) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetPrimReadSchema()};
+  options->chunk_list = true;
+  Design design(options);
+  // A descriptor holds the first and last index and the 64-bit values buffer address, which fits in a single beat.
+  ASSERT_EQ(design.chunk_regs.size(), 3u);
+  ASSERT_EQ(design.chunk_regs[0].name, "PrimRead_chunks");
+  ASSERT_EQ(design.chunk_regs[2].init, 64u);
+  // The chunk list is hidden from the kernel, and every field fetches its descriptors through the read bus.
+  ASSERT_FALSE(design.kernel_comp->Has("PrimRead_chunks"));
+  ASSERT_TRUE(design.nucleus_comp->Has("PrimRead_number_chunk_bus"));
+  auto src = GenerateTestAll(design.mantle_comp);
+  ASSERT_NE(src.find("ChunkWalker"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+}
+
 }  // namespace fletchgen
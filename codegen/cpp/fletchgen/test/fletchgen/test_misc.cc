@@ -17,8 +17,22 @@
 #include <gtest/gtest.h>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
+#include "fletcher/test_schemas.h"
+
+#include "fletchgen/fletchgen.h"
+#include "fletchgen/array.h"
 #include "fletchgen/design.h"
+#include "fletchgen/epc.h"
+#include "fletchgen/mmio.h"
+#include "fletchgen/utils.h"
+#include "fletchgen/incremental.h"
+#include "fletchgen/perf.h"
+#include "fletchgen/platform.h"
 
 namespace fletchgen {
 
@@ -27,4 +41,235 @@ TEST(Misc, ParseCustomRegs) {
                                          "s:32:my_kernel_to_host_signaling_reg"});
 }
 
+TEST(Misc, MmioVhdl) {
+  std::vector<MmioReg> regs = {
+      {MmioFunction::DEFAULT, MmioBehavior::STROBE, "start", "", 1, 0, 0},
+      {MmioFunction::DEFAULT, MmioBehavior::STATUS, "result", "", 64, 0, 8},
+      {MmioFunction::KERNEL, MmioBehavior::CONTROL, "first", "", 32, 0, std::nullopt, 0xF}};
+  auto vhdl = GenerateMmioVhdl({&regs}, Axi4LiteSpec());
+  // Addresses are assigned like they are for vhdmmio.
+  ASSERT_EQ(regs[2].addr, 16u);
+  // The interface must match the mmio component.
+  ASSERT_NE(vhdl.find("entity mmio is"), std::string::npos);
+  ASSERT_NE(vhdl.find("f_start_data"), std::string::npos);
+  ASSERT_NE(vhdl.find("f_result_write_data"), std::string::npos);
+  ASSERT_NE(vhdl.find("f_first_data"), std::string::npos);
+  ASSERT_NE(vhdl.find("mmio_awaddr"), std::string::npos);
+  ASSERT_NE(vhdl.find("r_first <= \"00000000000000000000000000001111\";"), std::string::npos);
+  ASSERT_NE(GenerateMmioPackage({&regs}, Axi4LiteSpec()).find("component mmio is"), std::string::npos);
+}
+
+TEST(Misc, MmioConstant) {
+  std::vector<MmioReg> regs = {
+      {MmioFunction::DEFAULT, MmioBehavior::STROBE, "start", "", 1, 0, 0},
+      {MmioFunction::DEFAULT, MmioBehavior::CONSTANT, "schema_hash", "", 32, 0, 16, 0xA5}};
+  // Constant registers read as their value, and do not result in a port.
+  auto vhdl = GenerateMmioVhdl({&regs}, Axi4LiteSpec());
+  ASSERT_NE(vhdl.find("\"00000000000000000000000010100101\""), std::string::npos);
+  ASSERT_EQ(vhdl.find("schema_hash"), std::string::npos);
+  cerata::default_component_pool()->Clear();
+  auto comp = mmio({}, regs, Axi4LiteSpec());
+  ASSERT_TRUE(comp->Has("f_start_data"));
+  ASSERT_FALSE(comp->Has("f_schema_hash_data"));
+  auto yaml = GenerateVhdmmioYaml({&regs}, Axi4LiteSpec());
+  ASSERT_NE(yaml.find("behavior: constant\n    value: 165\n"), std::string::npos);
+}
+
+TEST(Misc, MmioManifest) {
+  std::vector<MmioReg> regs = {
+      {MmioFunction::DEFAULT, MmioBehavior::STROBE, "start", "", 1, 0, 0},
+      {MmioFunction::PROFILE, MmioBehavior::STATUS, "Profile_x_0_cycles", "", 32}};
+  Axi4LiteSpec spec(32, 32, 8);
+  auto manifest = GenerateMmioManifest({&regs}, spec);
+  ASSERT_NE(manifest.find("start default strobe 2 0 1\n"), std::string::npos);
+  ASSERT_NE(manifest.find("Profile_x_0_cycles profile status 3 0 32\n"), std::string::npos);
+  // Assigning the addresses again must not move the registers.
+  ASSERT_EQ(GenerateMmioManifest({&regs}, spec), manifest);
+}
+
+TEST(Misc, MmioHeader) {
+  std::vector<MmioReg> regs = {
+      {MmioFunction::DEFAULT, MmioBehavior::STROBE, "start", "", 1, 0, 0},
+      {MmioFunction::DEFAULT, MmioBehavior::STATUS, "done", "", 1, 2, 4},
+      {MmioFunction::KERNEL, MmioBehavior::CONTROL, "my_threshold", "", 32},
+      {MmioFunction::BUFFER, MmioBehavior::CONTROL, "R_a_values", "", 64},
+      {MmioFunction::DEFAULT, MmioBehavior::CONSTANT, "schema_hash", "", 32, 0, {}, 0xABCD}};
+  Axi4LiteSpec spec(32, 32, 8);
+  auto header = GenerateMmioHeader({&regs}, spec, "MyKernel");
+  ASSERT_NE(header.find("namespace MyKernel_mmio {"), std::string::npos);
+  ASSERT_NE(header.find("constexpr Field start{2, 0, 1};"), std::string::npos);
+  ASSERT_NE(header.find("constexpr Field done{3, 2, 1};"), std::string::npos);
+  ASSERT_NE(header.find("constexpr Field my_threshold{4, 0, 32};"), std::string::npos);
+  ASSERT_NE(header.find("constexpr Field R_a_values{5, 0, 64};"), std::string::npos);
+  ASSERT_NE(header.find("constexpr uint64_t schema_hash_value = 0xABCD;"), std::string::npos);
+  ASSERT_NE(header.find("constexpr uint64_t num_registers = 8;"), std::string::npos);
+  // Accessors follow the behavior of the register.
+  ASSERT_NE(header.find("Status SetStart(uint32_t value)"), std::string::npos);
+  ASSERT_EQ(header.find("GetStart("), std::string::npos);
+  ASSERT_EQ(header.find("SetDone("), std::string::npos);
+  ASSERT_NE(header.find("Status SetMyThreshold(uint32_t value)"), std::string::npos);
+  ASSERT_NE(header.find("Status SetRAValues(uint64_t value)"), std::string::npos);
+  ASSERT_NE(header.find("Status GetSchemaHash(uint32_t *value)"), std::string::npos);
+}
+
+TEST(Misc, AutoEPC) {
+  BusDim bus;  // 512 bits wide.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint32()),
+                               arrow::field("b", arrow::utf8()),
+                               fletcher::WithMetaEPC(*arrow::field("c", arrow::uint64()), 2),
+                               arrow::field("d", arrow::uint64())});
+  std::vector<EPCChoice> choices;
+  auto result = WithAutoEPC(schema, bus, 16, &choices);
+  ASSERT_EQ(choices.size(), 4u);
+  ASSERT_EQ(fletcher::GetUIntMeta(*result->field(0), fletcher::meta::VALUE_EPC, 0), 4);
+  ASSERT_EQ(fletcher::GetUIntMeta(*result->field(1), fletcher::meta::VALUE_EPC, 0), 16);
+  // Existing EPC metadata is kept.
+  ASSERT_EQ(fletcher::GetUIntMeta(*result->field(2), fletcher::meta::VALUE_EPC, 0), 2);
+  ASSERT_TRUE(choices[2].fixed);
+  ASSERT_DOUBLE_EQ(choices[3].utilization(bus), 0.25);
+  // The EPC never exceeds the bus width.
+  ASSERT_EQ(DeriveEPC(*arrow::field("e", arrow::uint64()), bus, 1024)->epc, 8);
+}
+
+TEST(Misc, BitPackedEPC) {
+  BusDim bus;  // 512 bits wide.
+  auto schema = arrow::schema({arrow::field("a", arrow::boolean(), false),
+                               arrow::field("b", arrow::boolean(), true),
+                               arrow::field("c", arrow::uint8(), false)});
+  auto result = WithBitPackedEPC(schema, bus);
+  // Non-nullable booleans get a full bus word per cycle, other fields are left alone.
+  ASSERT_EQ(fletcher::GetUIntMeta(*result->field(0), fletcher::meta::VALUE_EPC, 0), 512);
+  ASSERT_EQ(fletcher::GetUIntMeta(*result->field(1), fletcher::meta::VALUE_EPC, 0), 0);
+  ASSERT_EQ(fletcher::GetUIntMeta(*result->field(2), fletcher::meta::VALUE_EPC, 0), 0);
+  ASSERT_EQ(GenerateConfigString(*result->field(0)), "prim(1;epc=512)");
+}
+
+TEST(Misc, PerfReport) {
+  BusDim bus;  // 64 bytes per cycle.
+  auto a = fletcher::WithMetaRequired(
+      *arrow::schema({fletcher::WithMetaEPC(*arrow::field("a", arrow::uint32(), false), 16),
+                      fletcher::WithMetaEPC(*arrow::field("b", arrow::utf8(), false), 64)}),
+      "A", fletcher::Mode::READ);
+  auto b = fletcher::WithMetaRequired(
+      *arrow::schema({fletcher::WithMetaBusChannel(*arrow::field("c", arrow::uint8(), true), 1)}),
+      "B", fletcher::Mode::READ);
+  auto report = EstimatePerformance({FletcherSchema::Make(a), FletcherSchema::Make(b)}, bus);
+
+  ASSERT_EQ(report.streams.size(), 5u);
+  ASSERT_EQ(report.streams[1].name, "b.offsets");
+  ASSERT_DOUBLE_EQ(report.streams[1].peak, 4.0);
+  ASSERT_EQ(report.streams[3].name, "c.validity");
+  ASSERT_DOUBLE_EQ(report.streams[3].peak, 1.0 / 8.0);
+
+  // Channel 0 is oversubscribed. The offsets stream gets its demand, the value streams share the rest.
+  ASSERT_EQ(report.arbiters.size(), 2u);
+  ASSERT_DOUBLE_EQ(report.arbiters[0].oversubscription(), 132.0 / 64.0);
+  ASSERT_DOUBLE_EQ(report.streams[1].achieved, 4.0);
+  ASSERT_DOUBLE_EQ(report.streams[0].achieved, 30.0);
+  ASSERT_DOUBLE_EQ(report.streams[2].achieved, 30.0);
+  ASSERT_EQ(*report.Bottleneck("A"), 0u);
+
+  // Channel 1 is not oversubscribed, so its widest stream is the bottleneck.
+  ASSERT_LT(report.arbiters[1].oversubscription(), 1.0);
+  ASSERT_DOUBLE_EQ(report.streams[4].efficiency(), 1.0);
+  ASSERT_EQ(*report.Bottleneck("B"), 4u);
+  ASSERT_FALSE(report.Bottleneck("C"));
+  ASSERT_NE(report.ToString().find("B: c.values"), std::string::npos);
+}
+
+TEST(Misc, Partitions) {
+  cerata::default_component_pool()->Clear();
+  auto options = std::make_shared<Options>();
+  options->schemas = {fletcher::GetPartitionedWriteSchema()};
+  Design design(options);
+  // Every partition gets its own RecordBatchWriter, and a register through which the kernel reports its rows.
+  ASSERT_EQ(design.recordbatch_comps.size(), 4u);
+  ASSERT_EQ(design.partition_regs.size(), 4u);
+  ASSERT_EQ(design.partition_regs[2].name, "Shuffle_p2_rows");
+  ASSERT_EQ(design.partition_regs[2].behavior, MmioBehavior::STATUS);
+  ASSERT_NE(design.kernel_comp->Get<cerata::Port>("Shuffle_p2_rows"), nullptr);
+  cerata::default_component_pool()->Clear();
+}
+
+TEST(Misc, ParallelFor) {
+  // Every index must be visited exactly once, for any number of threads.
+  for (size_t threads : {0, 1, 3, 64}) {
+    std::vector<std::atomic<int>> visits(17);
+    ParallelFor(visits.size(), threads, [&](size_t i) { visits[i]++; });
+    for (const auto &v : visits) {
+      ASSERT_EQ(v, 1);
+    }
+  }
+}
+
+TEST(Misc, Incremental) {
+  Options options;
+  options.arguments = {"-n", "MyKernel"};
+  auto hash = HashInputs(options);
+  ASSERT_EQ(HashInputs(options), hash);
+
+  // Forcing does not change the hash, other arguments do.
+  options.arguments.emplace_back("--force");
+  ASSERT_EQ(HashInputs(options), hash);
+  options.arguments = {"-n", "MyOtherKernel"};
+  ASSERT_NE(HashInputs(options), hash);
+
+  std::filesystem::remove_all("incremental");
+  std::filesystem::create_directories("incremental/vhdl");
+  std::ofstream("incremental/vhdl/MyKernel.gen.vhd") << "-- output" << std::endl;
+  WriteManifest("incremental", hash);
+  ASSERT_TRUE(IsUpToDate("incremental", hash));
+  ASSERT_FALSE(IsUpToDate("incremental", hash + 1));
+
+  // Removing an output file of the last run requires generating it again.
+  std::filesystem::remove("incremental/vhdl/MyKernel.gen.vhd");
+  ASSERT_FALSE(IsUpToDate("incremental", hash));
+}
+
+TEST(Misc, InMemory) {
+  std::map<std::string, std::string> files;
+  ASSERT_EQ(Generate({fletcher::GetPrimReadSchema()}, {}, {"-n", "Sum", "--axi"}, &files), 0);
+  ASSERT_EQ(files.count("fletchgen.mmio.manifest"), 1u);
+  ASSERT_EQ(files.count("vhdl/mmio.gen.vhd"), 1u);
+  ASSERT_EQ(files.count("vhdl/Sum.gen.vhd"), 1u);
+  ASSERT_EQ(files.count("vhdl/AxiTop.gen.vhd"), 1u);
+
+  // Every call generates the design from scratch, so repeated calls give the same output.
+  std::map<std::string, std::string> again;
+  ASSERT_EQ(Generate({fletcher::GetPrimReadSchema()}, {}, {"-n", "Sum", "--axi"}, &again), 0);
+  ASSERT_EQ(files, again);
+
+  // Inputs are only accepted in memory.
+  std::map<std::string, std::string> none;
+  ASSERT_NE(Generate({}, {}, {"-n", "Sum"}, &none), 0);
+  ASSERT_NE(Generate({fletcher::GetPrimReadSchema()}, {}, {"-i", "prim.as"}, &none), 0);
+}
+
+TEST(Misc, PlatformProfile) {
+  PlatformProfile aws;
+  ASSERT_TRUE(LoadPlatformProfile("aws", &aws));
+  ASSERT_EQ(aws.name, "aws");
+  ASSERT_EQ(aws.bus_specs, "64,512,8,1,64");
+  ASSERT_EQ(aws.mem_type, "cache");
+
+  // A profile survives a round trip through the file format.
+  PlatformProfile parsed;
+  std::istringstream in(aws.ToString());
+  ASSERT_TRUE(ParsePlatformProfile(&in, &parsed));
+  ASSERT_EQ(parsed.ToString(), aws.ToString());
+
+  std::istringstream unknown("name foo\nbus_width 512\n");
+  ASSERT_FALSE(ParsePlatformProfile(&unknown, &parsed));
+  ASSERT_FALSE(LoadPlatformProfile("no_such_platform", &parsed));
+
+  // The profile is written to the output, and options that are given explicitly override it.
+  std::map<std::string, std::string> files;
+  ASSERT_EQ(Generate({fletcher::GetPrimReadSchema()}, {}, {"-n", "Sum", "--platform", "aws"}, &files), 0);
+  ASSERT_EQ(files.at("fletchgen.platform.profile"), aws.ToString());
+  files.clear();
+  ASSERT_EQ(Generate({fletcher::GetPrimReadSchema()}, {},
+                     {"-n", "Sum", "--platform", "aws", "--bus_specs", "64,512,8,1,16"}, &files), 0);
+  ASSERT_NE(files.at("fletchgen.platform.profile").find("bus_specs 64,512,8,1,16"), std::string::npos);
+}
+
 }  // namespace fletchgen
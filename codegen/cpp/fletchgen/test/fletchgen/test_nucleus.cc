@@ -16,6 +16,7 @@
 #include <cerata/api.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "fletcher/test_schemas.h"
 
@@ -55,4 +56,154 @@ TEST(Nucleus, TwoPrimRead) {
   TestNucleus("TestNucleus", fletcher::GetTwoPrimReadSchema());
 }
 
+TEST(Nucleus, Projection) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::GetTwoPrimReadSchema();
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  auto regs = Design::GetRecordBatchRegs({rbd});
+  auto en_regs = Design::GetProjectionRegs({r});
+  ASSERT_EQ(en_regs.size(), 2u);
+  ASSERT_EQ(en_regs[0].name, "R_A_enable");
+  ASSERT_EQ(en_regs[0].init, 1u);
+  regs.insert(regs.end(), en_regs.begin(), en_regs.end());
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  // The kernel sees the enable bits, such that it can skip disabled fields.
+  ASSERT_NE(k->Get<Port>("R_B_enable"), nullptr);
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+  GenerateTestAll(n);
+}
+
+TEST(Nucleus, OutputCounts) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::GetStringWriteSchema();
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  std::vector<MmioReg> regs = {{MmioFunction::DEFAULT, MmioBehavior::STROBE, "start", "Start the kernel.", 1, 0, 0}};
+  auto rb_regs = Design::GetRecordBatchRegs({rbd});
+  regs.insert(regs.end(), rb_regs.begin(), rb_regs.end());
+  // A string field has a length and a values stream.
+  auto count_regs = GetOutputCountRegs({r}, 64);
+  ASSERT_EQ(count_regs.size(), 2u);
+  ASSERT_EQ(count_regs[0].name.rfind("Written_", 0), 0u);
+  ASSERT_EQ(count_regs[1].name.back(), '1');
+  ASSERT_EQ(count_regs[1].width, 64u);
+  regs.insert(regs.end(), count_regs.begin(), count_regs.end());
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+  ASSERT_TRUE(n->Has("Written_clear"));
+  auto src = GenerateTestAll(n);
+  ASSERT_NE(src.find("ElementCounter_"), std::string::npos);
+}
+
+TEST(Nucleus, Gather) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::WithMetaRequired(
+      *arrow::schema({fletcher::WithMetaGather(*arrow::field("number", arrow::int64(), false))}),
+      "Gather",
+      fletcher::Mode::READ);
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  auto regs = Design::GetRecordBatchRegs({rbd});
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  // The kernel supplies row indices instead of commands.
+  ASSERT_TRUE(k->Has("Gather_number_idx"));
+  ASSERT_FALSE(k->Has("Gather_number_cmd"));
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+  auto src = GenerateTestAll(n);
+  ASSERT_NE(src.find("ArrayGather"), std::string::npos);
+}
+
+TEST(Nucleus, TagWidth) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::WithMetaRequired(
+      *arrow::schema({fletcher::WithMetaTagWidth(*arrow::field("a", arrow::int64(), false), 4),
+                      arrow::field("b", arrow::int64(), false)}),
+      "TagWidth",
+      fletcher::Mode::READ);
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  auto regs = Design::GetRecordBatchRegs({rbd});
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+
+  // A field with tag width metadata has its own tag width at the kernel, the other one shares the generic.
+  auto decl = GenerateTestDecl(k.get());
+  auto line = [&decl](const std::string &port) {
+    auto begin = decl.find(port + " ");
+    return decl.substr(begin, decl.find('\n', begin) - begin);
+  };
+  ASSERT_NE(line("TagWidth_a_cmd_tag").find("3 downto 0"), std::string::npos);
+  ASSERT_NE(line("TagWidth_a_unl_tag").find("3 downto 0"), std::string::npos);
+  ASSERT_NE(line("TagWidth_b_cmd_tag").find("TAG_WIDTH-1 downto 0"), std::string::npos);
+  ASSERT_NE(line("TagWidth_b_unl_tag").find("TAG_WIDTH-1 downto 0"), std::string::npos);
+  auto src = GenerateTestAll(n);
+  ASSERT_NE(src.find("TagWidth_a_cmd_accm_inst"), std::string::npos);
+}
+
+TEST(Nucleus, OnChip) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::WithMetaRequired(
+      *arrow::schema({fletcher::WithMetaOnChip(*arrow::field("lut", arrow::uint32(), false), 1000)}),
+      "OnChip",
+      fletcher::Mode::READ);
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  auto regs = Design::GetRecordBatchRegs({rbd});
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  // The kernel preloads the cache with a command, and looks up the values.
+  ASSERT_TRUE(k->Has("OnChip_lut_cmd"));
+  ASSERT_TRUE(k->Has("OnChip_lut_lookup"));
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+  auto src = GenerateTestAll(n);
+  ASSERT_NE(src.find("ArrayCache"), std::string::npos);
+}
+
+TEST(Nucleus, AllValid) {
+  cerata::default_component_pool()->Clear();
+  auto schema = fletcher::WithMetaRequired(
+      *arrow::schema({arrow::field("number", arrow::int64(), true), arrow::field("other", arrow::int64(), false)}),
+      "AllValid",
+      fletcher::Mode::READ);
+  auto fs = std::make_shared<FletcherSchema>(schema, "TestSchema");
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  auto r = record_batch("Test_" + rbd.name, fs, rbd);
+  // Only the nullable field has a validity bitmap, of which the all valid register follows the buffer addresses.
+  ASSERT_EQ(Design::GetRecordBatchRegs({rbd}).size(), 5u);
+  auto regs = Design::GetRecordBatchRegs({rbd}, 32, true);
+  ASSERT_EQ(regs.size(), 6u);
+  ASSERT_EQ(regs.back().function, MmioFunction::VALIDITY);
+  ASSERT_EQ(regs.back().name, "AllValid_number_all_valid");
+  ASSERT_EQ(regs.back().width, 1u);
+  auto m = mmio({rbd}, regs, Axi4LiteSpec());
+  auto k = kernel("Test_Kernel", {r}, m);
+  // The flags are not exposed to the kernel.
+  ASSERT_FALSE(k->Has("AllValid_number_all_valid"));
+  auto n = nucleus("Test_Nucleus", {r}, k, m, Axi4LiteSpec());
+  auto src = GenerateTestAll(n);
+  ASSERT_NE(src.find("VALIDITY"), std::string::npos);
+}
+
 }  // namespace fletchgen
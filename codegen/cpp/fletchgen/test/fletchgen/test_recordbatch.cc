@@ -17,6 +17,7 @@
 #include <cerata/api.h>
 
 #include "fletcher/test_schemas.h"
+#include "fletchgen/array.h"
 #include "fletchgen/schema.h"
 #include "fletchgen/recordbatch.h"
 #include "fletchgen/test_utils.h"
@@ -49,4 +50,45 @@ TEST(RecordBatch, NullablePrimRead) {
   TestRecordBatchReader(fletcher::GetNullablePrimReadSchema());
 }
 
+TEST(RecordBatch, DictionaryRead) {
+  TestRecordBatchReader(fletcher::GetDictionarySchema());
+}
+
+TEST(RecordBatch, CompressedRead) {
+  TestRecordBatchReader(fletcher::GetCompressedSchema());
+}
+
+TEST(RecordBatch, RunEndRead) {
+  TestRecordBatchReader(fletcher::GetRunEndSchema());
+}
+
+TEST(RecordBatch, ParquetPageRead) {
+  TestRecordBatchReader(fletcher::GetParquetPageSchema());
+}
+
+TEST(RecordBatch, NestedWrite) {
+  auto schema = fletcher::GetNestedWriteSchema();
+  ASSERT_EQ(GenerateConfigString(*schema->field(0)), "struct(prim(32),list(listprim(8)))");
+  ASSERT_EQ(GenerateConfigString(*schema->field(1)), "list(struct(prim(32),list(listprim(8))))");
+  TestRecordBatchReader(schema);
+}
+
+TEST(RecordBatch, ParallelListStructRead) {
+  cerata::default_component_pool()->Clear();
+  std::shared_ptr<arrow::Schema> schema;
+  ASSERT_TRUE(fletcher::SplitParallelFields(fletcher::GetParallelListStructSchema(), &schema));
+  auto fs = FletcherSchema::Make(schema);
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  // Both children read the offsets buffer of the list, so it has an address register for each of them.
+  ASSERT_EQ(rbd.fields.size(), 2u);
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 2u);
+  ASSERT_EQ(rbd.fields[1].buffers.size(), 3u);
+  // Every child of the struct is read by its own ArrayReader, with its own length stream.
+  auto rbr = record_batch("Test_" + fs->name(), fs, rbd);
+  ASSERT_EQ(rbr->GetFieldPorts(FieldPort::Function::ARROW).size(), 2u);
+  GenerateTestAll(rbr);
+}
+
 }  // namespace fletchgen
@@ -14,6 +14,8 @@
 
 name = "pyfletchgen"
 
+from pyfletchgen.lib import Output, Register, generate, parse_manifest
+
 def _run():
     from pyfletchgen.lib import fletchgen
     import sys
@@ -17,5 +17,16 @@
 
 cimport cython
 
+from libcpp.map cimport map as cpp_map
+from libcpp.memory cimport shared_ptr
+from libcpp.string cimport string as cpp_string
+from libcpp.vector cimport vector
+
+from pyarrow.lib cimport CRecordBatch, CSchema
+
 cdef extern from "fletchgen/fletchgen.h" namespace "fletchgen":
   cdef int fletchgen(int argc, char **argv)
+  cdef int Generate(const vector[shared_ptr[CSchema]] &schemas,
+                    const vector[shared_ptr[CRecordBatch]] &recordbatches,
+                    const vector[cpp_string] &arguments,
+                    cpp_map[cpp_string, cpp_string] *files) nogil
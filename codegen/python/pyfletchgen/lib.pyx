@@ -15,8 +15,23 @@
 # distutils: language = c++
 # cython: language_level=3
 
-from pyfletchgen.fletchgen cimport fletchgen as cfletchgen
+from collections import namedtuple
+
+from pyfletchgen.fletchgen cimport fletchgen as cfletchgen, Generate as cgenerate
 from libc.stdlib cimport malloc, free
+from libcpp.map cimport map as cpp_map
+from libcpp.memory cimport shared_ptr
+from libcpp.string cimport string as cpp_string
+from libcpp.vector cimport vector
+
+import pyarrow
+from pyarrow.lib cimport CRecordBatch, CSchema, pyarrow_unwrap_batch, pyarrow_unwrap_schema
+
+# A register of the register manifest, see fletchgen.mmio.manifest.
+Register = namedtuple('Register', ['name', 'function', 'behavior', 'register', 'bit_index', 'bit_width'])
+
+# The output of generate(). The files are keyed by their path relative to the output directory.
+Output = namedtuple('Output', ['files', 'registers'])
 
 def fletchgen(*args):
   cdef int argc = len(args) + 1
@@ -33,3 +48,46 @@ def fletchgen(*args):
 
   return cfletchgen(argc, argv)
 
+
+
+def parse_manifest(manifest):
+  """Parse the contents of a register manifest into a list of Registers."""
+  registers = []
+  for line in manifest.splitlines():
+    if not line or line.startswith('#'):
+      continue
+    name, function, behavior, register, bit_index, bit_width = line.split()
+    registers.append(Register(name, function, behavior, int(register), int(bit_index), int(bit_width)))
+  return registers
+
+def generate(*args, schemas=(), recordbatches=()):
+  """Generate a design from pyarrow Schemas and RecordBatches in memory, without touching the file system.
+
+  The arguments are the command line options of fletchgen, without input and output paths, e.g. '-n', 'Sum'.
+  Returns an Output holding the generated sources and the registers of the design. Every call generates a design from
+  scratch, so this may be called repeatedly, e.g. from the workers of a process pool.
+  """
+  cdef vector[shared_ptr[CSchema]] c_schemas
+  cdef vector[shared_ptr[CRecordBatch]] c_recordbatches
+  cdef vector[cpp_string] c_args
+  cdef cpp_map[cpp_string, cpp_string] c_files
+  cdef int status
+
+  for schema in schemas:
+    if not isinstance(schema, pyarrow.Schema):
+      raise TypeError("Expected a pyarrow.Schema, got {}".format(type(schema)))
+    c_schemas.push_back(pyarrow_unwrap_schema(schema))
+  for batch in recordbatches:
+    if not isinstance(batch, pyarrow.RecordBatch):
+      raise TypeError("Expected a pyarrow.RecordBatch, got {}".format(type(batch)))
+    c_recordbatches.push_back(pyarrow_unwrap_batch(batch))
+  for arg in args:
+    c_args.push_back(str(arg).encode())
+
+  with nogil:
+    status = cgenerate(c_schemas, c_recordbatches, c_args, &c_files)
+  if status != 0:
+    raise RuntimeError("Fletchgen could not generate the design. See the log for details.")
+
+  files = {path.decode(): source.decode() for path, source in dict(c_files).items()}
+  return Output(files, parse_manifest(files['fletchgen.mmio.manifest']))
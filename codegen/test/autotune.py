@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+# Copyright 2018 Delft University of Technology
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Design-space autotuner of the Fletchgen parameters.
+
+Sweeps the elements-per-cycle (through the --auto_epc target), the maximum bus burst length, the depth of the bus FIFOs
+of the buffer readers and writers, and the bus arbiter topology, for the schemas of some Fletchgen input files and a
+target bandwidth in bytes per cycle.
+
+Every elements-per-cycle target is evaluated with the throughput estimation of Fletchgen (--perf_report), of which the
+throughput is capped at the target bandwidth. The estimation does not depend on the other parameters. With --simulate,
+the Pareto-optimal targets are combined with every value of the other parameters, and every combination is generated
+and simulated with the simulation top-level of a design, as in perf.py, to measure its kernel cycles.
+
+The Pareto-optimal configurations are those for which no other configuration is at least as fast while using at most
+as many datapath bytes per cycle and bytes of bus buffers.
+"""
+
+import argparse
+import csv
+import itertools
+import multiprocessing
+import os
+import re
+import subprocess
+import sys
+
+import pyarrow as pa
+
+from perf import parse
+
+FIFO_DEPTH = b'fletcher_bus_fifo_depth'
+STREAM = re.compile(r'^([^.\s]+)\.(\S+): channel=\d+, (?:read|write), peak=([\d.]+), achieved=([\d.]+)')
+
+
+def read_schema(path):
+    """Return the schema of a Fletchgen input file, i.e. a serialized schema (.as) or a RecordBatch file (.rb)."""
+    if path.endswith('.rb'):
+        return pa.ipc.open_file(path).schema
+    with open(path, 'rb') as f:
+        return pa.ipc.read_schema(pa.py_buffer(f.read()))
+
+
+def write_input(path, schema):
+    """Write a Fletchgen input file with another schema, of which the fields only differ in their metadata."""
+    if not path.endswith('.rb'):
+        pa.output_stream(path).write(schema.serialize())
+        return
+    reader = pa.ipc.open_file(path)
+    batches = [reader.get_batch(i) for i in range(reader.num_record_batches)]
+    writer = pa.RecordBatchFileWriter(path, schema)
+    for batch in batches:
+        writer.write(pa.RecordBatch.from_arrays(batch.columns, schema=schema))
+    writer.close()
+
+
+def with_fifo_depth(schema, depth):
+    """Return a schema of which every field has a bus FIFO depth, or the schema itself if the depth is the default."""
+    if depth == 0:
+        return schema
+    fields = [f.with_metadata(dict(f.metadata or {}, **{FIFO_DEPTH: str(depth).encode()})) for f in schema]
+    return pa.schema(fields, metadata=schema.metadata)
+
+
+def parse_report(report):
+    """Return the streams of a Fletchgen throughput estimation, as (recordbatch, stream, peak, achieved) tuples."""
+    streams = []
+    section = None
+    for line in report.splitlines():
+        if line.startswith('['):
+            section = line.strip()
+            continue
+        match = STREAM.match(line)
+        if section == '[streams]' and match:
+            streams.append((match.group(1), match.group(2), float(match.group(3)), float(match.group(4))))
+    return streams
+
+
+def throughput(streams):
+    """Return the estimated bytes per cycle of a design.
+
+    The streams of a RecordBatch advance together, so a RecordBatch transfers the peak bytes per cycle of all its
+    streams at the efficiency of its bottleneck stream.
+    """
+    total = 0.0
+    for rb in sorted({s[0] for s in streams}):
+        peaks = [s[2] for s in streams if s[0] == rb]
+        efficiency = min(s[3] / s[2] for s in streams if s[0] == rb and s[2] > 0) if sum(peaks) > 0 else 0.0
+        total += efficiency * sum(peaks)
+    return total
+
+
+def estimate(job):
+    """Estimate the throughput of the design of some schemas for an elements-per-cycle target."""
+    from pyfletchgen import generate
+    schemas, bus, target = job
+    output = generate('--perf_report', '--bus_specs', bus, '--auto_epc', target, schemas=schemas)
+    streams = parse_report(output.files['fletchgen.perf'])
+    return {'streams': len(streams), 'datapath': sum(s[2] for s in streams), 'throughput': throughput(streams)}
+
+
+def dominates(a, b, objectives):
+    """Return true if configuration a is at least as good as b for every objective, and better for one."""
+    at_least = all(a[o] >= b[o] if up else a[o] <= b[o] for o, up in objectives)
+    better = any(a[o] > b[o] if up else a[o] < b[o] for o, up in objectives)
+    return at_least and better
+
+
+def pareto(configs, objectives):
+    """Return the Pareto-optimal configurations. Of equivalent configurations, only the first one is kept."""
+    front = []
+    for c in configs:
+        if any(dominates(o, c, objectives) for o in configs):
+            continue
+        if any(all(f[o] == c[o] for o, _ in objectives) for f in front):
+            continue
+        front.append(c)
+    return front
+
+
+def bus_specs(bus, bm):
+    """Return the bus specification with another maximum burst length."""
+    values = bus.split(',')
+    return ','.join(values[:4] + [str(bm)])
+
+
+def flags(config, bus):
+    """Return the Fletchgen flags of a configuration."""
+    result = ['--bus_specs', bus_specs(bus, config['bm']), '--auto_epc', str(config['target'])]
+    result += ['--arbiter_fan_in', str(config['fan_in']), '--arbiter_max_outstanding', str(config['outstanding'])]
+    if config['arbiter_buffers']:
+        result.append('--arbiter_buffers')
+    return result
+
+
+def buffering(config, bus, streams):
+    """Return the bytes of the bus FIFOs of the buffer readers/writers and of the arbiter buffers of a configuration."""
+    word = int(bus.split(',')[1]) // 8
+    depth = config['fifo_depth'] or 16
+    return streams * word * (depth + (config['bm'] if config['arbiter_buffers'] else 0))
+
+
+def simulate(design, inputs, schemas, config, bus, extra):
+    """Generate and simulate a design with a configuration, and return its kernel cycles."""
+    for path, schema in zip(inputs, schemas):
+        write_input(path, with_fifo_depth(schema, config['fifo_depth']))
+    design_flags = ' '.join(flags(config, bus) + extra)
+    subprocess.run(['make', '-C', design, 'design', 'FLETCHGEN_FLAGS=' + design_flags], check=True)
+    sim = subprocess.run(['make', '-C', design, 'sim'], check=True, stdout=subprocess.PIPE, universal_newlines=True)
+    cycles = parse(sim.stdout)['cycles']
+    if cycles == 0:
+        raise RuntimeError('Simulation of {} did not report the kernel cycles.'.format(design))
+    return cycles
+
+
+def int_list(value):
+    return [int(v) for v in value.split(',')]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('inputs', nargs='+',
+                        help='Fletchgen input files, i.e. serialized schemas (.as) or RecordBatch files (.rb). With '
+                             '--simulate, these are the files the design reads, and they are restored afterwards.')
+    parser.add_argument('--bandwidth', type=float, required=True, help='Target bandwidth in bytes per cycle.')
+    parser.add_argument('--bus', default='64,512,8,1,16',
+                        help='Bus specification "aw,dw,lw,bs,bm". Default: 64,512,8,1,16.')
+    parser.add_argument('--epc_targets', type=int_list,
+                        help='Comma-separated --auto_epc targets. Default: half, once and twice the bandwidth.')
+    parser.add_argument('--bursts', type=int_list, default=[8, 16, 32, 64],
+                        help='Comma-separated maximum bus burst lengths. Default: 8,16,32,64.')
+    parser.add_argument('--fifo_depths', type=int_list, default=[16, 32, 64],
+                        help='Comma-separated bus FIFO depths. Default: 16,32,64.')
+    parser.add_argument('--fan_ins', type=int_list, default=[0, 2, 4],
+                        help='Comma-separated --arbiter_fan_in values. Default: 0,2,4.')
+    parser.add_argument('--outstanding', type=int_list, default=[4, 8, 16],
+                        help='Comma-separated --arbiter_max_outstanding values. Default: 4,8,16.')
+    parser.add_argument('--no_arbiter_buffers', action='store_true', help='Do not sweep --arbiter_buffers.')
+    parser.add_argument('--simulate', metavar='DESIGN',
+                        help='Simulate the configurations with a design, of which the Makefile has the input, design '
+                             'and sim targets, like the designs of perf.py.')
+    parser.add_argument('--flags', default='', help='Additional flags passed to Fletchgen when simulating.')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count(), help='Parallel estimations. Default: all CPUs.')
+    parser.add_argument('--csv', help='Write all evaluated configurations to a CSV file.')
+    args = parser.parse_args()
+
+    if args.simulate:
+        subprocess.run(['make', '-C', args.simulate, 'input'], check=True)
+    schemas = [read_schema(path) for path in args.inputs]
+    targets = args.epc_targets or sorted({max(1, round(args.bandwidth * f)) for f in (0.5, 1, 2)})
+
+    with multiprocessing.Pool(args.jobs) as pool:
+        estimates = pool.map(estimate, [(schemas, args.bus, t) for t in targets])
+    configs = []
+    for target, est in zip(targets, estimates):
+        configs.append({'target': target, 'bm': int(args.bus.split(',')[4]), 'fifo_depth': 0, 'fan_in': 0,
+                        'outstanding': 4, 'arbiter_buffers': False, 'streams': est['streams'],
+                        'datapath': est['datapath'], 'throughput': min(est['throughput'], args.bandwidth)})
+    for c in configs:
+        c['buffering'] = buffering(c, args.bus, c['streams'])
+    objectives = [('throughput', True), ('datapath', False), ('buffering', False)]
+    front = pareto(configs, objectives)
+
+    if args.simulate:
+        sweep = itertools.product(front, args.bursts, args.fifo_depths, args.fan_ins, args.outstanding,
+                                  [False] if args.no_arbiter_buffers else [False, True])
+        configs = []
+        originals = []
+        for path in args.inputs:
+            with open(path, 'rb') as f:
+                originals.append(f.read())
+        try:
+            for base, bm, depth, fan_in, outstanding, buffers in sweep:
+                c = dict(base, bm=bm, fifo_depth=depth, fan_in=fan_in, outstanding=outstanding, arbiter_buffers=buffers)
+                c['buffering'] = buffering(c, args.bus, c['streams'])
+                c['cycles'] = simulate(args.simulate, args.inputs, schemas, c, args.bus, args.flags.split())
+                configs.append(c)
+        finally:
+            for path, original in zip(args.inputs, originals):
+                with open(path, 'wb') as f:
+                    f.write(original)
+        objectives = [('cycles', False), ('datapath', False), ('buffering', False)]
+        front = pareto(configs, objectives)
+
+    for c in configs:
+        c['pareto'] = c in front
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=list(configs[0].keys()))
+            writer.writeheader()
+            writer.writerows(configs)
+
+    key = 'cycles' if args.simulate else 'throughput'
+    print('Pareto-optimal configurations ({} of {}):'.format(len(front), len(configs)))
+    for c in sorted(front, key=lambda c: (-c['throughput'], c.get('cycles', 0), c['datapath'], c['buffering'])):
+        print('  {}={:.2f}, datapath={:.2f} B/cycle, buffering={} B: {}'.format(
+            key, c[key], c['datapath'], c['buffering'], ' '.join(flags(c, args.bus)) +
+            (' (fletcher_bus_fifo_depth={})'.format(c['fifo_depth']) if c['fifo_depth'] else '')))
+    if not any(c['throughput'] >= args.bandwidth for c in front):
+        print('No configuration reaches the target bandwidth of {} bytes per cycle.'.format(args.bandwidth))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# Copyright 2018 Delft University of Technology
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Performance regression suite of the code generation tests.
+
+Every design is generated with stream profilers on its memory interface buses, and simulated with the generated
+simulation top-level. From the simulation output, the kernel clock cycles from start until done and the counters of
+every profiled stream are extracted, and compared against the baseline stored next to the design.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+# Designs that are simulated with their generated simulation top-level and a kernel in VHDL.
+DESIGNS = ['primmap', 'listprim', 'stringread']
+BASELINE = 'perf.baseline.json'
+
+CYCLES = re.compile(r'Kernel cycles(?: \[(\d+)\])?: (\d+)')
+PROFILE = re.compile(r'Profile ([^\s:]+)(?: \[(\d+)\])?: (\d+)')
+
+
+def parse(output):
+    """Extract the kernel cycles and the stream profiler counters from the output of a simulation."""
+    cycles = 0
+    streams = {}
+    for line in output.splitlines():
+        match = CYCLES.search(line)
+        if match:
+            cycles += int(match.group(2)) << (32 * int(match.group(1) or 0))
+            continue
+        match = PROFILE.search(line)
+        if match:
+            # Counters are named <stream>_<counter>, and counters wider than 32 bits are printed per word.
+            stream, counter = match.group(1).rsplit('_', 1)
+            value = int(match.group(3)) << (32 * int(match.group(2) or 0))
+            counters = streams.setdefault(stream, {})
+            counters[counter] = counters.get(counter, 0) + value
+    return {'cycles': cycles, 'streams': streams}
+
+
+def run(design, flags):
+    """Generate and simulate a design, and return its results."""
+    subprocess.run(['make', '-C', design, 'all', 'FLETCHGEN_FLAGS=' + flags], check=True)
+    sim = subprocess.run(['make', '-C', design, 'sim'], check=True, stdout=subprocess.PIPE, universal_newlines=True)
+    result = parse(sim.stdout)
+    if result['cycles'] == 0:
+        raise RuntimeError('Simulation of {} did not report the kernel cycles.'.format(design))
+    return result
+
+
+def changed(result, baseline, tolerance):
+    """Return true if a result differs from its baseline by more than the relative tolerance."""
+    return abs(result - baseline) > tolerance * max(baseline, 1)
+
+
+def compare(design, result, baseline, tolerance):
+    """Compare the results of a design against its baseline. Return the regressions and the other changes."""
+    regressions = []
+    changes = []
+    if result['cycles'] > baseline['cycles'] * (1 + tolerance):
+        regressions.append('{}: kernel cycles increased from {} to {}.'.format(design, baseline['cycles'],
+                                                                              result['cycles']))
+    elif changed(result['cycles'], baseline['cycles'], tolerance):
+        changes.append('{}: kernel cycles decreased from {} to {}.'.format(design, baseline['cycles'],
+                                                                          result['cycles']))
+    for stream, counters in sorted(baseline['streams'].items()):
+        if stream not in result['streams']:
+            changes.append('{}: stream {} is no longer profiled.'.format(design, stream))
+            continue
+        for counter, value in sorted(counters.items()):
+            new = result['streams'][stream].get(counter, 0)
+            if changed(new, value, tolerance):
+                changes.append('{}: {} {} changed from {} to {}.'.format(design, stream, counter, value, new))
+    return regressions, changes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('designs', nargs='*', default=DESIGNS, help='The designs to run. Default: all designs.')
+    parser.add_argument('--update', action='store_true', help='Store the results as the new baselines.')
+    parser.add_argument('--tolerance', type=float, default=0.02,
+                        help='Relative change of a result that is not reported. Default: 0.02.')
+    parser.add_argument('--strict', action='store_true',
+                        help='Also fail on changes of stream profiler counters beyond the tolerance.')
+    parser.add_argument('--flags', default='--profile_bus', help='Additional flags passed to Fletchgen.')
+    args = parser.parse_args()
+
+    os.chdir(os.path.dirname(os.path.abspath(__file__)))
+    regressions = []
+    changes = []
+    for design in args.designs:
+        result = run(design, args.flags)
+        path = os.path.join(design, BASELINE)
+        print('{}: {} kernel cycles, {} profiled streams.'.format(design, result['cycles'], len(result['streams'])))
+        if args.update:
+            with open(path, 'w') as f:
+                json.dump(result, f, indent=2, sort_keys=True)
+                f.write('\n')
+            continue
+        if not os.path.exists(path):
+            print('{}: no baseline. Store one with --update.'.format(design))
+            continue
+        with open(path) as f:
+            r, c = compare(design, result, json.load(f), args.tolerance)
+        regressions += r
+        changes += c
+
+    for line in changes:
+        print('CHANGED: ' + line)
+    for line in regressions:
+        print('REGRESSION: ' + line)
+    failed = regressions or (args.strict and changes)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -31,6 +31,69 @@
 #define FLETCHER_STATUS_ERROR 1
 #define FLETCHER_STATUS_NO_PLATFORM 2
 #define FLETCHER_STATUS_DEVICE_OUT_OF_MEMORY 3
+#define FLETCHER_STATUS_TIMEOUT 4
+
+/**
+ * \brief Optional platform functions.
+ *
+ * Besides the mandatory functions that every platform library must export, a platform may export the following
+ * functions. The run-time libraries fall back to an implementation based on the mandatory functions when they are not
+ * available.
+ *
+ * fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count);
+ *   Write \p count consecutive MMIO registers starting at \p offset.
+ *
+ * fstatus_t platformWriteMMIO64(uint64_t offset, uint64_t value);
+ *   Write \p value to the two consecutive MMIO registers starting at the even register \p offset with a single 64-bit
+ *   access, the lower register holding the lower bits. Only useful for devices with a 64-bit MMIO bus, e.g. generated
+ *   with fletchgen --mmio64.
+ *
+ * fstatus_t platformReadMMIO64(uint64_t offset, uint64_t *value);
+ *   Read the two consecutive MMIO registers starting at the even register \p offset into \p value with a single 64-bit
+ *   access, such that 64-bit registers are read atomically. Required if platformWriteMMIO64 is exported.
+ *
+ * fstatus_t platformWaitForInterrupt(uint64_t timeout_usec);
+ *   Block until the device raises an interrupt or until \p timeout_usec microseconds have passed. Spurious wake-ups
+ *   are allowed; the run-time libraries always check the status register afterwards.
+ *
+ * fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size);
+ *   Allocate \p size bytes of host memory that the device can access directly, e.g. pinned, huge-page-backed memory
+ *   that is mapped into the address space of the device. \p device_address receives the address through which the
+ *   device accesses the memory. Buffers in such memory do not have to be prepared for the device.
+ *
+ * fstatus_t platformHostFree(uint8_t *host_address);
+ *   Free host memory that was allocated with platformHostMalloc. Required if platformHostMalloc is exported.
+ *
+ * fstatus_t platformDeviceMap(da_t device_address, int64_t size, uint8_t **host_address);
+ *   Map \p size bytes of device memory allocated with platformDeviceMalloc at \p device_address into the address space
+ *   of the host, e.g. through a write-combining mapping of a PCIe BAR. \p host_address receives the address through
+ *   which the host accesses the memory. Buffers in such memory reside on the device already.
+ *
+ * fstatus_t platformDeviceUnmap(uint8_t *host_address, int64_t size);
+ *   Unmap device memory that was mapped with platformDeviceMap. Required if platformDeviceMap is exported.
+ *
+ * fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count);
+ *   Copy \p count regions from host memory to device memory, described by \p iov. Drivers with scatter-gather DMA
+ *   may submit all regions as a single transfer.
+ *
+ * fstatus_t platformLoadImage(const char *path, uint64_t region);
+ *   Program the device with the image (bitstream) stored at \p path. Platforms with partial reconfiguration program
+ *   reconfigurable region \p region, of which the kernel instance has register window \p region. Platforms without
+ *   it only support region 0, which is the whole device.
+ *
+ * fstatus_t platformGetDeviceCount(uint64_t *count);
+ *   Store the number of devices of the platform in the host in \p count. Called before platformInit.
+ *
+ * fstatus_t platformSetDevice(uint64_t device);
+ *   Select the device that this copy of the library operates on. Called once, before platformInit. The run-time
+ *   libraries load a separate copy of the library for every device, such that the global state of a platform
+ *   library belongs to a single device. Required if platformGetDeviceCount is exported.
+ *
+ * fstatus_t platformGetNumaNode(int64_t *node);
+ *   Store the NUMA node of the host that the device is attached to in \p node, or -1 if it is unknown. The run-time
+ *   libraries stage copies from host memory on other nodes through node-local memory, and pin their worker threads
+ *   to the node.
+ */
 
 /// Status for function return values
 typedef uint64_t fstatus_t;
@@ -50,6 +113,16 @@ typedef union {
   da_t full;
 } dau_t;
 
+/// Descriptor of a region to transfer between host and device memory.
+typedef struct {
+  /// Address of the region in host memory.
+  const uint8_t *host_address;
+  /// Address of the region in device memory.
+  da_t device_address;
+  /// Size of the region in bytes.
+  uint64_t size;
+} fiov_t;
+
 /// Device nullptr
 #define D_NULLPTR (da_t) 0x0
 
@@ -58,9 +131,15 @@ typedef union {
 #define FLETCHER_REG_STATUS         1
 #define FLETCHER_REG_RETURN0        2
 #define FLETCHER_REG_RETURN1        3
+/// Read-only hash of the schemas the kernel was generated for, see fletcher::SchemaSetHash
+#define FLETCHER_REG_SCHEMA_HASH    4
+/// Read-only number of kernel clock cycles from the last start until done (64-bit, low word first)
+#define FLETCHER_REG_CYCLES         5
+/// Read-only kernel clock frequency in Hz, or 0 if it was not known when the kernel was generated
+#define FLETCHER_REG_CLOCK_HZ       7
 
 /// Offset for schema derived registers
-#define FLETCHER_REG_SCHEMA         4
+#define FLETCHER_REG_SCHEMA         8
 
 #define FLETCHER_REG_CONTROL_START  0x0u
 #define FLETCHER_REG_CONTROL_STOP   0x1u
@@ -69,3 +148,10 @@ typedef union {
 #define FLETCHER_REG_STATUS_IDLE    0x0u
 #define FLETCHER_REG_STATUS_BUSY    0x1u
 #define FLETCHER_REG_STATUS_DONE    0x2u
+
+/// Number of MMIO address bits of the register window of every kernel instance in multi-instance designs.
+/// Instance i occupies byte addresses [i << FLETCHER_INSTANCE_WINDOW_BITS, (i + 1) << FLETCHER_INSTANCE_WINDOW_BITS).
+#define FLETCHER_INSTANCE_WINDOW_BITS 16
+
+/// Number of 32-bit registers in the register window of every kernel instance.
+#define FLETCHER_INSTANCE_WINDOW_REGS (1u << (FLETCHER_INSTANCE_WINDOW_BITS - 2))
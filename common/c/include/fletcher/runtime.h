@@ -0,0 +1,149 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fletcher/fletcher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \file
+ * \brief C API of the Fletcher run-time library.
+ *
+ * Allows applications that do not use Arrow C++, e.g. in Rust or Java, to hand RecordBatches to Fletcher through the
+ * Arrow C Data Interface without copying them. All functions are implemented by the C++ run-time library.
+ */
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+/// Schema of the Arrow C Data Interface, as specified by Apache Arrow.
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+
+/// Array of the Arrow C Data Interface, as specified by Apache Arrow.
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+/// Handle of a platform instance.
+typedef struct FletcherPlatform *fplatform_t;
+
+/// Handle of a context.
+typedef struct FletcherContext *fcontext_t;
+
+/// Handle of a kernel.
+typedef struct FletcherKernel *fkernel_t;
+
+/// Memory types of RecordBatches, see fletcher::MemType.
+#define FLETCHER_MEM_ANY 0
+#define FLETCHER_MEM_CACHE 1
+
+/// \brief Return the message of the last error of a function of this API in the calling thread, or an empty string.
+const char *fletcherLastError(void);
+
+/// \brief Create a platform instance by \p name, or autodetect the platform if \p name is NULL.
+fstatus_t fletcherPlatformCreate(const char *name, fplatform_t *platform);
+
+/// \brief Initialize a platform. \p init_data may point to platform-specific initialization options or be NULL.
+fstatus_t fletcherPlatformInit(fplatform_t platform, void *init_data);
+
+/// \brief Terminate and destroy a platform instance. Contexts and kernels on it keep it alive until they are destroyed.
+void fletcherPlatformDestroy(fplatform_t platform);
+
+/// \brief Create a context on a platform.
+fstatus_t fletcherContextCreate(fplatform_t platform, fcontext_t *context);
+
+/**
+ * \brief Queue a RecordBatch exported through the Arrow C Data Interface.
+ *
+ * The context takes ownership of \p array and \p schema, also when queueing fails. \p array must be a struct array of
+ * which the children are the columns. \p mem_type is FLETCHER_MEM_ANY or FLETCHER_MEM_CACHE.
+ */
+fstatus_t fletcherContextQueueArrowArray(fcontext_t context,
+                                         struct ArrowArray *array,
+                                         struct ArrowSchema *schema,
+                                         int mem_type);
+
+/// \brief Make the queued RecordBatches available to the device.
+fstatus_t fletcherContextEnable(fcontext_t context);
+
+/**
+ * \brief Export queued RecordBatch \p index through the Arrow C Data Interface.
+ *
+ * RecordBatches with a write-mode schema are read back from the device first, of which the kernel wrote \p num_rows
+ * rows, or all rows if \p num_rows is -1. The consumer must release \p array and \p schema.
+ */
+fstatus_t fletcherContextExportArrowArray(fcontext_t context,
+                                          uint64_t index,
+                                          struct ArrowArray *array,
+                                          struct ArrowSchema *schema,
+                                          int64_t num_rows);
+
+/// \brief Destroy a context, freeing its device buffers.
+void fletcherContextDestroy(fcontext_t context);
+
+/// \brief Create a kernel operating on a context, of which the register window starts at register \p mmio_base.
+fstatus_t fletcherKernelCreate(fcontext_t context, uint64_t mmio_base, fkernel_t *kernel);
+
+/// \brief Reset the kernel.
+fstatus_t fletcherKernelReset(fkernel_t kernel);
+
+/// \brief Write the metadata of the RecordBatches of the context of the kernel to its registers.
+fstatus_t fletcherKernelWriteMetaData(fkernel_t kernel);
+
+/// \brief Write \p count custom arguments to the kernel.
+fstatus_t fletcherKernelSetArguments(fkernel_t kernel, const uint32_t *arguments, uint64_t count);
+
+/// \brief Start the kernel.
+fstatus_t fletcherKernelStart(fkernel_t kernel);
+
+/// \brief Wait until the kernel is done, polling its status every \p poll_interval_usec microseconds.
+fstatus_t fletcherKernelWaitUntilDone(fkernel_t kernel, uint64_t poll_interval_usec);
+
+/// \brief Destroy a kernel.
+void fletcherKernelDestroy(fkernel_t kernel);
+
+#ifdef __cplusplus
+}
+#endif
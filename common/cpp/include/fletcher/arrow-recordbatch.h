@@ -24,6 +24,38 @@
 
 namespace fletcher {
 
+/**
+ * @brief The range of physical elements of an ArrayData that a (sliced) RecordBatch covers.
+ *
+ * Indices are physical, i.e. they include the offset of the ArrayData. The kernel addresses element origin as element
+ * zero, while only the elements [begin, end) have to be transferred.
+ */
+struct ArraySlice {
+  /// The physical index of the element that the kernel addresses as element zero.
+  int64_t origin;
+  /// The physical index of the first element that is covered.
+  int64_t begin;
+  /// The physical index of the element after the last element that is covered.
+  int64_t end;
+
+  /// @brief Return the slice of an ArrayData of a column, i.e. all its elements.
+  static ArraySlice Of(const arrow::ArrayData &data) { return {data.offset, data.offset, data.offset + data.length}; }
+
+  /// @brief Return the slice of a child (or dictionary) of an ArrayData that this slice covers.
+  ArraySlice Child(const arrow::ArrayData &parent, const arrow::ArrayData &child) const;
+};
+
+/**
+ * @brief Describe the part of a buffer of an ArrayData that a slice covers.
+ * @param data   The ArrayData holding the buffer.
+ * @param buffer The index of the buffer in the ArrayData.
+ * @param slice  The slice of the ArrayData.
+ * @param whole  Whether to describe the whole buffer rather than the part that the slice covers.
+ * @param out    The buffer description of which to set the raw buffer, size and device offset.
+ * @return       False if the slice of a bit-packed buffer does not start at a byte boundary, true otherwise.
+ */
+bool DescribeBuffer(const arrow::ArrayData &data, int buffer, const ArraySlice &slice, bool whole, BufferMetadata *out);
+
 /**
  * @brief Class to analyze a RecordBatch.
  *
@@ -39,23 +71,36 @@ class RecordBatchAnalyzer : public arrow::ArrayVisitor {
  protected:
   arrow::Status VisitArray(const arrow::Array &arr);
 
+  /// @brief Add the part of a buffer of an ArrayData that the current slice covers.
+  arrow::Status AddBuffer(const arrow::ArrayData &data, int buffer, const std::string &name);
+
   template<typename ArrayType>
   arrow::Status VisitFixedWidth(const ArrayType &array) {
-    std::shared_ptr<arrow::Buffer> buf = array.values();
-    auto desc = buf_name;
-    desc.emplace_back("values");
-    out_->fields.back().buffers.emplace_back(buf->data(), buf->size(), desc, level);
-    return arrow::Status::OK();
+    // Run-end encoded columns hold their run ends in an additional buffer, that precedes the values buffer.
+    if ((level == 0) && IsRunEndEncoded(*field)) {
+      auto status = AddBuffer(*array.data(), 2, "run_ends");
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    return AddBuffer(*array.data(), 1, "values");
   }
 
-  arrow::Status VisitBinary(const arrow::BinaryArray &array);
+  arrow::Status VisitBinary(const arrow::Array &array);
   arrow::Status Visit(const arrow::StringArray &array) override { return VisitBinary(array); }
   arrow::Status Visit(const arrow::BinaryArray &array) override { return VisitBinary(array); }
-  arrow::Status Visit(const arrow::ListArray &array) override;
+  arrow::Status Visit(const arrow::LargeStringArray &array) override { return VisitBinary(array); }
+  arrow::Status Visit(const arrow::LargeBinaryArray &array) override { return VisitBinary(array); }
+  arrow::Status VisitList(const arrow::Array &array, const arrow::Array &values);
+  arrow::Status Visit(const arrow::ListArray &array) override { return VisitList(array, *array.values()); }
+  arrow::Status Visit(const arrow::LargeListArray &array) override { return VisitList(array, *array.values()); }
+  arrow::Status Visit(const arrow::FixedSizeListArray &array) override;
   arrow::Status Visit(const arrow::StructArray &array) override;
+  arrow::Status Visit(const arrow::DictionaryArray &array) override;
 
 #define VISIT_FIXED_WIDTH(TYPE) \
   arrow::Status Visit(const TYPE& array) override { return VisitFixedWidth<TYPE>(array); }
+  VISIT_FIXED_WIDTH(arrow::BooleanArray)
   VISIT_FIXED_WIDTH(arrow::Int8Array)
   VISIT_FIXED_WIDTH(arrow::Int16Array)
   VISIT_FIXED_WIDTH(arrow::Int32Array)
@@ -77,16 +122,83 @@ class RecordBatchAnalyzer : public arrow::ArrayVisitor {
 #undef VISIT_FIXED_WIDTH
 
   // TODO(johanpel): Not implemented yet:
-  //arrow::Status Visit(const arrow::BooleanArray &array) override {}
   //arrow::Status Visit(const arrow::NullArray &array) override {}
   //arrow::Status Visit(const UnionArray& array) override {}
-  //arrow::Status Visit(const DictionaryArray& array) override {}
   //arrow::Status Visit(const ExtensionArray& array) override {}
 
   std::vector<std::string> buf_name;
   int level = 0;
   RecordBatchDescription *out_{};
   std::shared_ptr<arrow::Field> field;
+  /// The slice of the array that is currently visited.
+  ArraySlice slice{0, 0, 0};
+  /// Whether to describe whole buffers, e.g. for write-mode RecordBatches, rather than the parts that slices cover.
+  bool whole = false;
+};
+
+/**
+ * @brief A precompiled plan to locate the buffers of RecordBatches with a specific Schema.
+ *
+ * Compiling the layout walks the Schema once, producing the same description as the RecordBatchAnalyzer would for any
+ * RecordBatch of that Schema. Afterwards, Fill() only extracts the raw buffer pointers and sizes of a RecordBatch. When
+ * filling a description that was copied from description() before, Fill() does not allocate any heap memory.
+ *
+ * Like the RecordBatchAnalyzer, only the parts of the buffers of read-mode RecordBatches that are covered by slices are
+ * described.
+ */
+class RecordBatchLayout {
+ public:
+  /**
+   * @brief Compile a layout for a Schema.
+   * @param schema  The Schema to compile the layout for.
+   * @param out     A pointer to a shared pointer that will own the new layout.
+   * @return        True if successful, false if the Schema contains types that are not supported.
+   */
+  static bool Make(const std::shared_ptr<arrow::Schema> &schema, std::shared_ptr<RecordBatchLayout> *out);
+
+  /// @brief Return the Schema of this layout.
+  const std::shared_ptr<arrow::Schema> &schema() const { return schema_; }
+
+  /// @brief Return the description template, with empty buffers.
+  const RecordBatchDescription &description() const { return desc_; }
+
+  /**
+   * @brief Fill a description with the buffers of a RecordBatch.
+   * @param batch The RecordBatch, which must have the Schema of this layout.
+   * @param desc  The description to fill, which must be a copy of description() or a description filled before.
+   * @return      True if successful, false otherwise, e.g. when a slice of a bit-packed buffer does not start at a
+   *              byte boundary.
+   */
+  bool Fill(const arrow::RecordBatch &batch, RecordBatchDescription *desc) const;
+
+ protected:
+  /// Locates a single buffer in the ArrayData tree of a column.
+  struct Locator {
+    /// The index of the column.
+    int column;
+    /// The child indices to follow from the column ArrayData, where kDictionary selects the dictionary.
+    std::vector<int> path;
+    /// The index of the buffer in the ArrayData.
+    int buffer;
+    /// Whether this is a validity buffer.
+    bool validity;
+    /// Whether to describe the whole buffer, rather than the part that a slice covers.
+    bool whole;
+  };
+
+  /// Path element that selects the dictionary of a dictionary-encoded ArrayData rather than a child.
+  static constexpr int kDictionary = -1;
+
+  /// @brief Add the locators and buffer descriptions of a field.
+  bool AddField(const arrow::Field &field, int column, const std::vector<int> &path,
+                std::vector<std::string> name, int level);
+
+  /// The Schema of this layout.
+  std::shared_ptr<arrow::Schema> schema_;
+  /// The description template.
+  RecordBatchDescription desc_;
+  /// The buffer locators, in the order of the buffers in the description.
+  std::vector<Locator> locators_;
 };
 
 }
\ No newline at end of file
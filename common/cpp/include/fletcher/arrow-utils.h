@@ -17,10 +17,13 @@
 #include <arrow/api.h>
 
 #include <vector>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 
+#include "fletcher/meta/meta.h"
+
 namespace fletcher {
 
 /// @brief Access mode for reads / writes to recordbatches, arrays, buffers, etc. as seen from accelerator kernel.
@@ -39,6 +42,10 @@ struct BufferMetadata {
   /// non-nullable fields).
   bool implicit_ = false;
 
+  /// The number of bytes between the start of the buffer as addressed by the kernel and raw_buffer_. Non-zero when only
+  /// the part of a buffer covered by a slice is described, e.g. the values of the strings of a sliced string array.
+  int64_t device_offset_ = 0;
+
   BufferMetadata(const uint8_t *raw_buffer,
                  int64_t size,
                  std::vector<std::string> desc,
@@ -102,6 +109,43 @@ int64_t GetIntMeta(const arrow::Field &field, const std::string &key, int defaul
  */
 bool GetBoolMeta(const arrow::Field &field, const std::string &key, bool default_to = false);
 
+/**
+ * @brief Return whether an Arrow type is or contains a type with 64-bit offsets (LargeString, LargeBinary, LargeList).
+ * @param type    The Arrow type to inspect.
+ * @return        True if any (nested) offsets buffer of this type holds 64-bit offsets.
+ */
+bool HasLargeOffsets(const arrow::DataType &type);
+
+/**
+ * @brief Return whether any field of an Arrow schema has 64-bit offsets.
+ * @param schema  The Arrow Schema to inspect.
+ * @return        True if any (nested) offsets buffer of this schema holds 64-bit offsets.
+ */
+bool HasLargeOffsets(const arrow::Schema &schema);
+
+/**
+ * @brief Return a hash of the parts of an Arrow schema that determine the hardware generated for it.
+ *
+ * The hash covers the access mode and the type, nullability, compression and encoding of every field that is not
+ * ignored, including nested fields. Field names and all other metadata are not taken into account, such that schemas
+ * that only differ in names result in the same hash.
+ *
+ * @param schema  The Arrow Schema to hash.
+ * @return        The 32-bit FNV-1a hash of the canonical form of the schema.
+ */
+uint32_t SchemaHash(const arrow::Schema &schema);
+
+/**
+ * @brief Return a hash of an ordered set of Arrow schemas, see SchemaHash.
+ *
+ * Fletchgen stores this hash of the schemas of a design in the schema hash register. The schemas must be in the order
+ * of the RecordBatches of the design.
+ *
+ * @param schema_set  The Arrow Schemas to hash.
+ * @return            The 32-bit FNV-1a hash of the canonical forms of all schemas.
+ */
+uint32_t SchemaSetHash(const std::vector<std::shared_ptr<arrow::Schema>> &schema_set);
+
 /**
  * @brief Append the minimum required metadata for Fletcher to a schema. Returns a copy of the schema.
  * @param schema        The Schema to append to.
@@ -131,6 +175,27 @@ std::shared_ptr<arrow::Schema> WithMetaBusSpec(const arrow::Schema &schema,
                                                int lw = 8,
                                                int bs = 1,
                                                int bm = 16);
+
+/**
+ * @brief Append a row filter expression to the metadata of a schema. Returns a copy of the schema.
+ * @param schema      The Schema to append to.
+ * @param expression  The filter expression, e.g. "price > min_price". See meta::FILTER.
+ * @return            A copy of the schema with the filter metadata appended.
+ */
+std::shared_ptr<arrow::Schema> WithMetaFilter(const arrow::Schema &schema, const std::string &expression);
+
+/**
+ * @brief Append partitioning metadata to a write schema. Returns a copy of the schema.
+ *
+ * @param schema      The write schema to append to.
+ * @param partitions  The number of partitions. See meta::PARTITIONS.
+ * @param key         The name of the integer field of which the hash selects the partition of a row.
+ * @return            A copy of the schema with the partitioning metadata appended.
+ */
+std::shared_ptr<arrow::Schema> WithMetaPartitions(const arrow::Schema &schema,
+                                                  uint32_t partitions,
+                                                  const std::string &key);
+
 /**
  * @brief Append Elements-Per-Cycle metadata to a field. Returns a copy of the field.
  *
@@ -156,6 +221,268 @@ std::shared_ptr<arrow::Field> WithMetaIgnore(const arrow::Field &field);
 */
 std::shared_ptr<arrow::Field> WithMetaProfile(const arrow::Field &field);
 
+/**
+ * @brief Append metadata to a field to select the memory interface channel it accesses memory through. Returns a copy.
+ * @param field   The field to append to.
+ * @param channel The memory interface channel.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaBusChannel(const arrow::Field &field, uint32_t channel);
+
+/**
+ * @brief Append metadata to a field to set the arbitration weight of its bus port. Returns a copy of the field.
+ *
+ * This keeps any metadata the field already has.
+ *
+ * @param field   The field to append to.
+ * @param weight  The arbitration weight, from 1 to 255.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaBusWeight(const arrow::Field &field, uint32_t weight);
+
+/**
+ * @brief Append buffer FIFO sizing metadata to a field. Returns a copy of the field.
+ *
+ * This works only for primitive and list<primitive> fields, and keeps any metadata the field already has. Deeper
+ * FIFOs allow more outstanding bursts, which helps to hide the latency of e.g. host memory accessed over PCIe.
+ *
+ * @param field           The field to append to.
+ * @param bus_fifo_depth  The depth of the bus response FIFO in bus words. Zero keeps the hardware default (16).
+ * @param fifo_size       The size of the element FIFO in elements. Zero keeps the hardware default (64).
+ * @return                A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaBufferDepth(const arrow::Field &field, uint32_t bus_fifo_depth,
+                                                  uint32_t fifo_size = 0);
+
+/**
+ * @brief Append metadata to a field to coalesce the short bursts of its buffer writers. Returns a copy of the field.
+ *
+ * This only affects fields of schemas in write mode, and keeps any metadata the field already has.
+ *
+ * @param field   The field to append to.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaWriteCoalesce(const arrow::Field &field);
+
+/**
+ * @brief Append metadata to a field to read it by row index rather than by range. Returns a copy of the field.
+ *
+ * This only affects fields of schemas in read mode, and keeps any metadata the field already has.
+ *
+ * @param field   The field to append to.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaGather(const arrow::Field &field);
+
+/**
+ * @brief Append metadata to a field to set the tag width of its command and unlock streams. Returns a copy of the field.
+ *
+ * Keeps any metadata the field already has. See meta::TAG_WIDTH.
+ *
+ * @param field   The field to append to.
+ * @param width   The tag width in bits.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaTagWidth(const arrow::Field &field, uint32_t width);
+
+/**
+ * @brief Append metadata to a field to cache it in on-chip memory. Returns a copy of the field.
+ *
+ * This works only for non-nullable fixed-width fields of schemas in read mode, and keeps any metadata the field
+ * already has. See meta::ONCHIP.
+ *
+ * @param field   The field to append to.
+ * @param depth   The number of elements the cache must hold.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaOnChip(const arrow::Field &field, uint32_t depth);
+
+/**
+ * @brief Append metadata to a field to signify its values buffer is compressed. Returns a copy of the field.
+ *
+ * This works only for non-nullable fixed-width fields with a bit width that is a multiple of 8. The values buffer
+ * must be laid out as described for meta::COMPRESSION, see MakeCompressedArray().
+ *
+ * @param field   The field to append to.
+ * @param codec   The compression codec. Only meta::LZ4 is supported.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaCompression(const arrow::Field &field, const std::string &codec = meta::LZ4);
+
+/**
+ * @brief Return the uncompressed length in bytes that precedes the data of a compressed buffer.
+ * @param buffer  The compressed buffer.
+ * @return        The uncompressed length, or -1 if the buffer does not hold one.
+ */
+int64_t GetUncompressedLength(const arrow::Buffer &buffer);
+
+/**
+ * @brief Wrap a compressed values buffer in an array, without decompressing it.
+ *
+ * The buffer must hold the uncompressed length of the values in bytes as a little-endian 64-bit integer, followed by
+ * the compressed values, like compressed buffers of the Arrow IPC format. The resulting array can be queued on a
+ * device for a field with compression metadata (see WithMetaCompression()), such that the device reads and
+ * decompresses the buffer. Its values must not be accessed on the host.
+ *
+ * @param type        The fixed-width type of the values.
+ * @param length      The number of values.
+ * @param compressed  The compressed buffer.
+ * @param out         The resulting array.
+ * @return            True if successful, false if the uncompressed length does not match the number of values.
+ */
+bool MakeCompressedArray(const std::shared_ptr<arrow::DataType> &type,
+                         int64_t length,
+                         const std::shared_ptr<arrow::Buffer> &compressed,
+                         std::shared_ptr<arrow::Array> *out);
+
+/**
+ * @brief Append metadata to a field to signify it is run-end encoded. Returns a copy of the field.
+ *
+ * This works only for non-nullable fixed-width fields, see meta::ENCODING and MakeRunEndEncodedArray().
+ *
+ * @param field   The field to append to.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaRunEndEncoding(const arrow::Field &field);
+
+/// @brief Return true if a field is run-end encoded, see meta::ENCODING.
+bool IsRunEndEncoded(const arrow::Field &field);
+
+/**
+ * @brief Wrap the values and run ends of a run-end encoded column in an array.
+ *
+ * Arrow 7 has no run-end encoded type, so the array has the type of the values and one element per row, while its
+ * values buffer only holds one value per run. The run ends are kept as an additional buffer, at index 2. The resulting
+ * array can be queued on a device for a field with run-end encoding metadata (see WithMetaRunEndEncoding()), such
+ * that only the runs are transferred and the device expands them. Its values must not be accessed on the host.
+ *
+ * @param values    The non-nullable fixed-width value of every run.
+ * @param run_ends  The strictly increasing, positive run end of every run. The last run end is the number of rows.
+ * @param out       The resulting array.
+ * @return          True if successful, false if the runs are malformed.
+ */
+bool MakeRunEndEncodedArray(const std::shared_ptr<arrow::Array> &values,
+                            const std::shared_ptr<arrow::Int32Array> &run_ends,
+                            std::shared_ptr<arrow::Array> *out);
+
+/**
+ * @brief Run-end encode a non-nullable fixed-width array.
+ *
+ * Consecutive equal values are merged into a single run. See MakeRunEndEncodedArray().
+ *
+ * @param array   The array to encode.
+ * @param out     The resulting array.
+ * @return        True if successful, false if the array is of an unsupported type or holds nulls.
+ */
+bool RunEndEncode(const std::shared_ptr<arrow::Array> &array, std::shared_ptr<arrow::Array> *out);
+
+/**
+ * @brief Append metadata to a field to signify it is read from Parquet data pages. Returns a copy of the field.
+ *
+ * This works only for flat fields of 32- or 64-bit fixed-width types, see meta::PARQUET and MakeParquetPageArray().
+ *
+ * @param field   The field to append to.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaParquetEncoding(const arrow::Field &field);
+
+/// @brief Return true if a field is read from Parquet data pages, see meta::PARQUET.
+bool IsParquetEncoded(const arrow::Field &field);
+
+/**
+ * @brief Return the number of PLAIN-encoded values in the body of a Parquet data page.
+ * @param page      The body of an uncompressed version 1 data page of a flat column.
+ * @param bit_width The bit width of the values.
+ * @param nullable  Whether the page starts with definition levels.
+ * @return          The number of values, or -1 if the page is malformed.
+ */
+int64_t GetParquetPageValueCount(const arrow::Buffer &page, int bit_width, bool nullable);
+
+/**
+ * @brief Wrap the body of a Parquet data page in an array, without decoding it.
+ *
+ * The page must be an uncompressed version 1 data page of a flat column with PLAIN-encoded values, without its page
+ * header. For nullable fields, the body starts with the RLE/bit-packed hybrid encoded definition levels, preceded by
+ * their length as a little-endian 32-bit integer. The resulting array has no validity bitmap, but its null count is
+ * derived from the number of values in the page. It can be queued on a device for a field with Parquet encoding
+ * metadata (see WithMetaParquetEncoding()), such that the device decodes the page. Its values must not be accessed on
+ * the host.
+ *
+ * @param type      The 32- or 64-bit fixed-width type of the values.
+ * @param length    The number of values of the page, including nulls.
+ * @param nullable  Whether the page holds definition levels.
+ * @param page      The body of the page.
+ * @param out       The resulting array.
+ * @return          True if successful, false if the page does not hold the values of length elements.
+ */
+bool MakeParquetPageArray(const std::shared_ptr<arrow::DataType> &type,
+                          int64_t length,
+                          bool nullable,
+                          const std::shared_ptr<arrow::Buffer> &page,
+                          std::shared_ptr<arrow::Array> *out);
+
+/**
+ * @brief Append metadata to a field to read the children of its struct values in parallel. Returns a copy of the field.
+ *
+ * This works only for lists and large lists of a non-nullable struct, see meta::PARALLEL and SplitParallelFields().
+ *
+ * @param field   The field to append to.
+ * @return        A copy of the field with metadata appended.
+ */
+std::shared_ptr<arrow::Field> WithMetaParallel(const arrow::Field &field);
+
+/**
+ * @brief Split every field of a schema with parallel metadata into one list field per child of its struct.
+ *
+ * A field "points" of type List<Struct<x, y>> becomes the fields "points_x" of type List<x> and "points_y" of type
+ * List<y>. They keep the nullability and other metadata of the original field. Fletchgen generates hardware for the
+ * split schema, and the run-time splits RecordBatches accordingly before they are queued.
+ *
+ * @param schema  The schema to split.
+ * @param out     The split schema, or the schema itself if it has no fields with parallel metadata.
+ * @return        True if successful, false if a field with parallel metadata is not a list of a non-nullable struct.
+ */
+bool SplitParallelFields(const std::shared_ptr<arrow::Schema> &schema, std::shared_ptr<arrow::Schema> *out);
+
+/**
+ * @brief Split every column of a RecordBatch with parallel metadata, like SplitParallelFields() splits its schema.
+ *
+ * The resulting list arrays share the validity and offsets buffers of the original list array and the child arrays of
+ * its struct array, so no data is copied.
+ *
+ * @param batch   The RecordBatch to split.
+ * @param out     The split RecordBatch, or the RecordBatch itself if it has no fields with parallel metadata.
+ * @return        True if successful, false if a field with parallel metadata is not a list of a non-nullable struct.
+ */
+bool SplitParallelFields(const std::shared_ptr<arrow::RecordBatch> &batch, std::shared_ptr<arrow::RecordBatch> *out);
+
+/**
+ * @brief Expand a write schema with partitioning metadata into one schema per partition.
+ *
+ * A schema "Out" with P partitions becomes the schemas "Out_p0" up to "Out_p<P-1>", that have the same fields and
+ * metadata, except that meta::PARTITIONS is replaced by meta::PARTITION holding the index of the partition. Fletchgen
+ * generates a RecordBatchWriter for every partition, to which the kernel writes the rows for which PartitionOf()
+ * returns its index.
+ *
+ * @param schema  The schema to expand.
+ * @param out     The partition schemas, or only the schema itself if it has no partitioning metadata.
+ * @return        True if successful, false if the schema is not a write schema, the number of partitions is invalid, or
+ *                the key is not a non-nullable integer field of the schema.
+ */
+bool PartitionSchemas(const std::shared_ptr<arrow::Schema> &schema, std::vector<std::shared_ptr<arrow::Schema>> *out);
+
+/**
+ * @brief Return the partition of a row with some key, as computed in hardware by partition_of() of Partition_pkg.
+ *
+ * The key is hashed by folding it to 32 bits and multiplying by the golden ratio, after which the upper bits of the
+ * product of the hash and the number of partitions select the partition. This keeps the hardware to two multipliers.
+ *
+ * @param key         The key, i.e. the bits of the key field, zero-extended to 64 bits.
+ * @param partitions  The number of partitions.
+ * @return            The index of the partition, smaller than partitions.
+ */
+uint32_t PartitionOf(uint64_t key, uint32_t partitions);
+
 /**
  * Write a schema to a Flatbuffer file
  * @param file_name   File to write to.
@@ -180,6 +507,27 @@ void WriteRecordBatchesToFile(const std::string &filename,
  */
 bool ReadRecordBatchesFromFile(const std::string &file_name, std::vector<std::shared_ptr<arrow::RecordBatch>> *out);
 
+/**
+ * @brief Memory-map an Arrow IPC file and visit its RecordBatches one by one as they are decoded.
+ *
+ * The buffers of the RecordBatches point into the memory-mapped file, so no copies of the data are made. The mapping
+ * remains valid for as long as any of the RecordBatches is alive.
+ *
+ * @param file_name The path to the input file.
+ * @param visit     Called for every RecordBatch, in file order. Stops reading when it returns false.
+ * @return          True if successful, false otherwise.
+ */
+bool MapRecordBatchesFromFile(const std::string &file_name,
+                              const std::function<bool(const std::shared_ptr<arrow::RecordBatch> &)> &visit);
+
+/**
+ * @brief Memory-map an Arrow IPC file and obtain all its RecordBatches without copying their data.
+ * @param file_name The path to the input file.
+ * @param out       Vector to store the RecordBatches.
+ * @return          True if successful, false otherwise.
+ */
+bool MapRecordBatchesFromFile(const std::string &file_name, std::vector<std::shared_ptr<arrow::RecordBatch>> *out);
+
 /**
  * @brief Reads a schema from a file.
  * @param file_path Path to the file to read from.
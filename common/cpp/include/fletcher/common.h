@@ -20,4 +20,6 @@
 #include "fletcher/arrow-utils.h"
 #include "fletcher/arrow-recordbatch.h"
 #include "fletcher/arrow-schema.h"
+#include "fletcher/datagen.h"
+#include "fletcher/staging.h"
 #include "fletcher/meta/meta.h"
@@ -0,0 +1,84 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace fletcher {
+
+/// Distributions of the lengths of generated strings, binaries and lists.
+enum class LengthDistribution {
+  FIXED,    ///< Every length is the maximum length.
+  UNIFORM,  ///< Lengths are uniformly distributed between the minimum and maximum length.
+  ZIPF      ///< Lengths are Zipf-distributed, such that short lengths are much more likely than long lengths.
+};
+
+/// @brief Return a human-readable name of a length distribution.
+std::string ToString(LengthDistribution distribution);
+
+/**
+ * @brief Parse the name of a length distribution, see ToString(LengthDistribution).
+ * @param name  The name of the distribution.
+ * @param out   The distribution.
+ * @return      True if successful, false otherwise.
+ */
+bool ParseLengthDistribution(const std::string &name, LengthDistribution *out);
+
+/// Options for generating RecordBatches with random data.
+struct GeneratorOptions {
+  /// The number of rows.
+  int64_t rows = 1024;
+  /// The probability of a value of a nullable field (at any nesting level) being null.
+  double null_ratio = 0.0;
+  /// The minimum length of strings, binaries and lists.
+  uint32_t min_length = 0;
+  /// The maximum length of strings, binaries and lists.
+  uint32_t max_length = 16;
+  /// The distribution of the lengths of strings, binaries and lists.
+  LengthDistribution length_distribution = LengthDistribution::UNIFORM;
+  /// The seed of the random number generator. Equal options result in equal RecordBatches.
+  uint64_t seed = 0;
+};
+
+/**
+ * @brief Generate a RecordBatch with random data for a schema.
+ *
+ * Supports booleans, integers, floating point numbers, (large) strings and binaries, (large) lists and structs of
+ * these, to any nesting depth. The RecordBatch keeps the metadata of the schema.
+ *
+ * @param schema  The schema of the RecordBatch.
+ * @param options The options of the data.
+ * @param out     The resulting RecordBatch.
+ * @return        True if successful, false if the schema holds a type that is not supported.
+ */
+bool GenerateRecordBatch(const std::shared_ptr<arrow::Schema> &schema,
+                         const GeneratorOptions &options,
+                         std::shared_ptr<arrow::RecordBatch> *out);
+
+/**
+ * @brief Return a type of nested lists.
+ * @param value_type  The type of the innermost values.
+ * @param depth       The number of nested lists. Zero returns the value type.
+ * @param nullable    Whether the lists and values are nullable.
+ * @return            The nested list type.
+ */
+std::shared_ptr<arrow::DataType> NestedListType(const std::shared_ptr<arrow::DataType> &value_type,
+                                                int depth,
+                                                bool nullable = false);
+
+}  // namespace fletcher
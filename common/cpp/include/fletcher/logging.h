@@ -15,8 +15,32 @@
 #pragma once
 
 #include <string>
+#include <sstream>
+#include <atomic>
 #include <cstdlib>
 
+/*
+ * Messages are filtered before their arguments are evaluated, both at compile time and at run time:
+ *
+ * - Messages with a level below FLETCHER_LOG_MIN_LEVEL are compiled out. It defaults to DEBUG (-1) for debug builds,
+ *   and to INFO (0) when NDEBUG is defined.
+ * - Messages with a level below the run-time level, see SetLogLevel(), are skipped.
+ *
+ * ERROR and FATAL messages are never filtered, since they terminate the application.
+ */
+#ifndef FLETCHER_LOG_MIN_LEVEL
+#ifndef NDEBUG
+#define FLETCHER_LOG_MIN_LEVEL -1
+#else
+#define FLETCHER_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+#define FLETCHER_LOG_SKIP(level)                                                                  \
+  ((static_cast<int>(FLETCHER_LOG_##level) <= static_cast<int>(FLETCHER_LOG_WARNING))             \
+      && ((static_cast<int>(FLETCHER_LOG_##level) < FLETCHER_LOG_MIN_LEVEL)                       \
+          || !fletcher::IsLoggingEnabled(FLETCHER_LOG_##level)))
+
 #ifdef FLETCHER_USE_ARROW_LOGGING
 /*
  * Use Arrow's logging facilities
@@ -25,7 +49,10 @@
 
 // Logging Macros
 #define FLETCHER_LOG_INTERNAL(level) ::arrow::util::ArrowLog(__FILE__, __LINE__, level)
-#define FLETCHER_LOG(level, msg) FLETCHER_LOG_INTERNAL(fletcher::FLETCHER_LOG_##level) << msg
+#define FLETCHER_LOG(level, msg)                                                                  \
+  if (FLETCHER_LOG_SKIP(level)) {                                                                 \
+  } else                                                                                          \
+    FLETCHER_LOG_INTERNAL(FLETCHER_LOG_##level) << msg
 
 // Logging levels
 constexpr arrow::util::ArrowLogLevel FLETCHER_LOG_DEBUG = arrow::util::ArrowLogLevel::ARROW_DEBUG;
@@ -38,7 +65,13 @@ namespace fletcher {
 
 using LogLevel = arrow::util::ArrowLogLevel;
 
+namespace detail {
+/// The run-time log level.
+extern std::atomic<int> log_level;
+}  // namespace detail
+
 inline void StartLogging(const std::string &app_name, LogLevel level, const std::string &file_name) {
+  detail::log_level.store(static_cast<int>(level), std::memory_order_relaxed);
   arrow::util::ArrowLog::StartArrowLog(app_name, level, file_name);
 }
 
@@ -46,6 +79,18 @@ inline void StopLogging() {
   arrow::util::ArrowLog::ShutDownArrowLog();
 }
 
+/// @brief The asynchronous sink is not available when Arrow's logging facilities are used. Returns false.
+inline bool StartAsyncLogging(const std::string &file_name = "") {
+  (void) file_name;
+  return false;
+}
+
+/// @brief Return true if messages of the given level are logged. Use this to skip building expensive messages.
+inline bool IsLoggingEnabled(LogLevel level) {
+  return (static_cast<int>(level) >= detail::log_level.load(std::memory_order_relaxed))
+      && arrow::util::ArrowLog::IsLevelEnabled(level);
+}
+
 }  // namespace fletcher
 
 #else
@@ -61,35 +106,15 @@ constexpr int FLETCHER_LOG_WARNING = 1;
 constexpr int FLETCHER_LOG_ERROR = 2;
 constexpr int FLETCHER_LOG_FATAL = 3;
 
-#ifndef NDEBUG
-#define FLETCHER_LOG(level, msg) \
-  if (FLETCHER_LOG_##level > FLETCHER_LOG_WARNING) {                      \
-    std::cerr << "[" + fletcher::level2str(FLETCHER_LOG_##level) + "]: "  \
-              << msg                                                      \
-              << std::endl;                                               \
-    std::exit(-1);                                                        \
-  } else {                                                                \
-    std::cout << "[" << fletcher::level2str(FLETCHER_LOG_##level) + "]: " \
-              << msg                                                      \
-              << std::endl;                                               \
-  }                                                                       \
-(void)0
-// ^ prevent empty statement linting errors
-#else
-#define FLETCHER_LOG(level, msg)                                          \
-if (FLETCHER_LOG_##level > FLETCHER_LOG_WARNING) {                        \
-    std::cerr << "[" + fletcher::level2str(FLETCHER_LOG_##level) + "]: "  \
-              << msg                                                      \
-              << std::endl;                                               \
-    std::exit(-1);                                                        \
-  } else if (FLETCHER_LOG_##level > FLETCHER_LOG_DEBUG) {                 \
-    std::cout << "[" << fletcher::level2str(FLETCHER_LOG_##level) + "]: " \
-              << msg                                                      \
-              << std::endl;                                               \
-  }                                                                       \
+#define FLETCHER_LOG(level, msg)                                                                  \
+  if (FLETCHER_LOG_SKIP(level)) {                                                                 \
+  } else {                                                                                        \
+    std::ostringstream fletcher_log_stream_;                                                      \
+    fletcher_log_stream_ << msg;                                                                  \
+    fletcher::detail::Log(FLETCHER_LOG_##level, fletcher_log_stream_.str());                      \
+  }                                                                                               \
 (void)0
 // ^ prevent empty statement linting errors
-#endif
 
 namespace fletcher {
 
@@ -105,16 +130,62 @@ inline std::string level2str(int level) {
   }
 }
 
+namespace detail {
+/// The run-time log level.
+extern std::atomic<int> log_level;
+
+/**
+ * @brief Write a formatted message to the log sink.
+ *
+ * Messages up to WARNING are written to stdout, or handed to the asynchronous sink if it was started. ERROR and FATAL
+ * messages are written to stderr after the asynchronous sink was flushed, after which the application exits.
+ */
+void Log(LogLevel level, const std::string &msg);
+}  // namespace detail
+
+/**
+ * @brief Set the run-time log level.
+ * @param[in] app_name  The name of the application. Unused.
+ * @param[in] level     The lowest level of messages to log.
+ * @param[in] file_name Unused, messages are written to stdout. See StartAsyncLogging() to log to a file.
+ */
 inline void StartLogging(const std::string &app_name, LogLevel level, const std::string &file_name) {
-  // No init required, but prevent compiler warnings by pretending to use the arguments.
   (void) app_name;
-  (void) level;
   (void) file_name;
+  detail::log_level.store(level, std::memory_order_relaxed);
 }
 
-inline void StopLogging() {
-  // No shutdown required.
+/**
+ * @brief Write messages from a background thread, such that threads that log do not wait for I/O.
+ *
+ * Messages are still formatted by the thread that logs them. Stop the sink with StopLogging().
+ *
+ * @param[in] file_name The file to write messages to, or an empty string for stdout.
+ * @return True if the sink was started, false if the file could not be opened.
+ */
+bool StartAsyncLogging(const std::string &file_name = "");
+
+/// @brief Write all pending messages and stop the asynchronous sink, if it was started.
+void StopLogging();
+
+/// @brief Return true if messages of the given level are logged. Use this to skip building expensive messages.
+inline bool IsLoggingEnabled(LogLevel level) {
+  return (level >= FLETCHER_LOG_MIN_LEVEL) && (level >= detail::log_level.load(std::memory_order_relaxed));
 }
 
 }  // namespace fletcher
 #endif
+
+namespace fletcher {
+
+/// @brief Set the lowest level of messages to log at run time. Messages below FLETCHER_LOG_MIN_LEVEL stay filtered.
+inline void SetLogLevel(LogLevel level) {
+  detail::log_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+/// @brief Return the lowest level of messages that is logged at run time.
+inline LogLevel GetLogLevel() {
+  return static_cast<LogLevel>(detail::log_level.load(std::memory_order_relaxed));
+}
+
+}  // namespace fletcher
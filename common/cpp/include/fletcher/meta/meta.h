@@ -46,6 +46,27 @@ constexpr char WRITE[] = "write";
 /// All values should be supplied as a decimal ASCII string.
 constexpr char BUS_SPEC[] = "fletcher_bus_spec";
 
+/// Key to assign the memory interface (e.g. an HBM or DDR channel) that a schema or field accesses memory through.
+/// Can be set on a schema and overridden per field. Values can be any natural number, e.g. "0", "1", ...
+/// Fields without this key use channel 0.
+constexpr char BUS_CHANNEL[] = "fletcher_bus_channel";
+
+/// Key to drop rows of a read schema before they reach the kernel.
+/// Value must be a comparison of the form "<field> <op> <register>", where <op> is one of >, >=, <, <=, == or !=, and
+/// <register> is the name of a custom kernel register holding the value to compare against, e.g. "price > min_price".
+constexpr char FILTER[] = "fletcher_filter";
+
+/// Key to split a write schema into a number of partitions, to which the kernel assigns every row by the hash of a key
+/// field. Values can be any positive integer, e.g. "2", "4", ... Requires PARTITION_KEY. See PartitionSchemas().
+constexpr char PARTITIONS[] = "fletcher_partitions";
+
+/// Key to name the non-nullable integer field of a partitioned write schema of which the hash selects the partition of
+/// a row, see PartitionOf().
+constexpr char PARTITION_KEY[] = "fletcher_partition_key";
+
+/// Key set by PartitionSchemas() to the index of the partition that a schema holds.
+constexpr char PARTITION[] = "fletcher_partition";
+
 // Field metadata:
 
 /// Key to enable profiling of data streams.
@@ -64,6 +85,60 @@ constexpr char VALUE_EPC[] = "fletcher_epc";
 /// Values can be any natural power of two, e.g. "1", "2", "4", ...
 constexpr char LIST_EPC[] = "fletcher_lepc";
 
+/// Key to set the depth of the bus response FIFO of the buffer readers/writers of a field, in bus words.
+/// This determines how many bursts can be outstanding. Values can be any positive integer, e.g. "16", "64", ...
+constexpr char BUS_FIFO_DEPTH[] = "fletcher_bus_fifo_depth";
+
+/// Key to set the arbitration weight of the bus port of a field on the bus arbiters.
+/// A field with weight W may issue W commands for every command of a field with weight 1 on the same arbiter. Values
+/// can be any integer from 1 to 255, e.g. "1", "8", ...
+constexpr char BUS_WEIGHT[] = "fletcher_bus_weight";
+
+/// Key to set the size of the element FIFO of the buffer readers of a field, in elements.
+/// Values can be any positive integer, e.g. "64", "256", ...
+constexpr char FIFO_SIZE[] = "fletcher_fifo_size";
+
+/// Key to coalesce the short bursts of the buffer writers of a field.
+/// Setting value to "true" writes the data before the first and after the last maximum length burst of a command in a
+/// single burst each, rather than in bursts of the minimum burst length. Any other value disables coalescing.
+constexpr char WRITE_COALESCE[] = "fletcher_write_coalesce";
+
+/// Key to read a compressed field. The values buffer of the field must hold the uncompressed length of the values as a
+/// little-endian 64-bit integer, followed by the compressed values, like compressed buffers of the Arrow IPC format.
+/// The only supported value is "lz4", for an LZ4 frame. Only non-nullable fixed-width fields can be compressed.
+constexpr char COMPRESSION[] = "fletcher_compression";
+constexpr char LZ4[] = "lz4";
+
+/// Key to read a run-end encoded field. The only supported value is "run_end". The field then has a buffer of 32-bit
+/// run ends next to its values buffer, which holds one value per run rather than per row. The run end of a run is the
+/// row index one past its last row, like the run ends of Arrow run-end encoded arrays. Only non-nullable fixed-width
+/// fields can be run-end encoded.
+constexpr char ENCODING[] = "fletcher_encoding";
+constexpr char RUN_END[] = "run_end";
+/// The value "parquet" reads a field from a Parquet data page. The values buffer of the field then holds the body of an
+/// uncompressed version 1 data page with PLAIN-encoded values, and the field has no validity bitmap. For nullable
+/// fields, the definition levels of the page hold the validity of the values. Only flat fields of 32- or 64-bit
+/// fixed-width types can be read from pages.
+constexpr char PARQUET[] = "parquet";
+
+/// Key to read the children of a list of structs in parallel.
+/// Setting value to "true" splits a list of a non-nullable struct into one list per child of the struct, that share the
+/// offsets buffer of the list. Every child is then read by its own ArrayReader, such that its values stream is not
+/// throttled by the other children. Any other value disables this. Only supported for read schemas.
+constexpr char PARALLEL[] = "fletcher_parallel";
+
+/// Key to read a field by row index rather than by range.
+/// Setting value to "true" replaces the command stream of the field at the kernel interface by a stream of row indices,
+/// of which runs of consecutive indices are coalesced into commands. Any other value disables this. Only supported
+/// for read schemas.
+constexpr char GATHER[] = "fletcher_gather";
+
+/// Key to cache a small field in on-chip memory, for random-access lookups by the kernel.
+/// Value is the number of elements the cache must hold, e.g. "1024", which is rounded up to a power of two. The kernel
+/// preloads the cache with a command on the field, after which it looks up values through a stream of row indices
+/// instead of receiving the Arrow data stream. Only supported for non-nullable fixed-width fields of read schemas.
+constexpr char ONCHIP[] = "fletcher_onchip";
+
 /// Key to set the tag width for the command and unlock streams.
 /// Values can by any positive, e.g. "1", "2", "3", ...
 constexpr char TAG_WIDTH[] = "fletcher_tag_width";
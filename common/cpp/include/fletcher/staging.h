@@ -0,0 +1,122 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "fletcher/arrow-utils.h"
+
+namespace fletcher {
+
+/// Instruction set extensions used by the staging functions, in order of preference.
+enum class SimdLevel {
+  /// Portable scalar code.
+  SCALAR = 0,
+  /// ARM NEON.
+  NEON,
+  /// x86 AVX2.
+  AVX2,
+  /// x86 AVX-512 (F).
+  AVX512
+};
+
+/// @brief Return the best instruction set extension supported by the CPU, detected once.
+SimdLevel GetSimdLevel();
+
+/// @brief Return a human-readable name of an instruction set extension.
+std::string ToString(SimdLevel level);
+
+/// The alignment of the buffers staged by StageRecordBatch(), in bytes.
+constexpr int64_t kStagingAlignment = 64;
+
+/**
+ * @brief Write an all-valid validity bitmap.
+ * @param[in]  length  The number of elements. Padding bits of the last byte are set as well.
+ * @param[out] dst     The bitmap, of (length + 7) / 8 bytes.
+ */
+void StageValidity(int64_t length, uint8_t *dst);
+
+/**
+ * @brief Copy 32-bit offsets, optionally rebased such that the first offset is zero.
+ *
+ * @param[in]  src     The offsets.
+ * @param[in]  count   The number of offsets, i.e. the number of elements plus one.
+ * @param[in]  rebase  Whether to subtract the first offset from all offsets.
+ * @param[out] dst     The staged offsets.
+ * @param[in]  level   The instruction set extension to use. Clamped to GetSimdLevel().
+ */
+void StageOffsets(const int32_t *src, int64_t count, bool rebase, int32_t *dst, SimdLevel level = GetSimdLevel());
+
+/**
+ * @brief Copy 64-bit offsets, optionally rebased such that the first offset is zero.
+ * @see StageOffsets(const int32_t *, int64_t, bool, int32_t *, SimdLevel)
+ */
+void StageOffsets(const int64_t *src, int64_t count, bool rebase, int64_t *dst, SimdLevel level = GetSimdLevel());
+
+/**
+ * @brief Copy 64-bit offsets narrowed to 32 bits, optionally rebased such that the first offset is zero.
+ *
+ * Offsets are non-decreasing, so their range is checked before copying.
+ *
+ * @return False if the (rebased) offsets do not fit in 32 bits, in which case nothing is written. True otherwise.
+ * @see StageOffsets(const int32_t *, int64_t, bool, int32_t *, SimdLevel)
+ */
+bool StageOffsets(const int64_t *src, int64_t count, bool rebase, int32_t *dst, SimdLevel level = GetSimdLevel());
+
+/// Transformations applied while staging a RecordBatch.
+struct StagingOptions {
+  /// Write all-valid bitmaps for the implicit validity buffers of fields without nulls.
+  bool materialize_validity = false;
+  /// Rebase the offsets of sliced string, binary and list arrays to start at zero.
+  bool rebase_offsets = false;
+  /// Narrow 64-bit offsets to 32 bits.
+  bool narrow_offsets = false;
+};
+
+/**
+ * @brief Return the number of bytes StageRecordBatch() requires to stage a RecordBatch.
+ * @param[in] desc     The description of the RecordBatch, see RecordBatchAnalyzer.
+ * @param[in] options  The transformations to apply.
+ * @return The number of bytes, or -1 if the RecordBatch can not be staged with these options.
+ */
+int64_t StagedSize(const RecordBatchDescription &desc, const StagingOptions &options);
+
+/**
+ * @brief Copy all buffers of a RecordBatch to a staging buffer, transforming them in the same pass.
+ *
+ * The buffers are copied back-to-back, every one aligned to kStagingAlignment, e.g. into a pinned buffer or a bounce
+ * buffer from which they are transferred to the device. Offsets are rebased and narrowed with the best instruction set
+ * extension of the CPU, see GetSimdLevel(). The resulting description points to the staged buffers, of which the
+ * device offsets account for rebased offsets: the buffers of the elements that the rebased offsets index are addressed
+ * from the first element that is covered.
+ *
+ * Rebasing fails for bit-packed buffers (validity bitmaps and booleans) of list elements of which the first covered
+ * element does not start at a byte boundary, and narrowing fails for offsets that do not fit in 32 bits.
+ *
+ * @param[in]  desc      The description of the RecordBatch, see RecordBatchAnalyzer.
+ * @param[in]  options   The transformations to apply.
+ * @param[out] dst       The staging buffer, which should be aligned to kStagingAlignment.
+ * @param[in]  capacity  The size of the staging buffer, see StagedSize().
+ * @param[out] out       The description of the staged RecordBatch.
+ * @return True if successful, false if the RecordBatch can not be staged with these options or does not fit.
+ */
+bool StageRecordBatch(const RecordBatchDescription &desc,
+                      const StagingOptions &options,
+                      uint8_t *dst,
+                      int64_t capacity,
+                      RecordBatchDescription *out);
+
+}  // namespace fletcher
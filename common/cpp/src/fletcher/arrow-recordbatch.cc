@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -30,15 +31,131 @@ std::string RecordBatchDescription::ToString() const {
   return str.str();
 }
 
+/// @brief Return whether a type has 64-bit offsets.
+static bool IsLarge(arrow::Type::type id) {
+  return (id == arrow::Type::LARGE_STRING) || (id == arrow::Type::LARGE_BINARY) || (id == arrow::Type::LARGE_LIST);
+}
+
+/// @brief Return the offset at some physical index of the offsets buffer of an ArrayData, or 0 if it does not exist.
+static int64_t OffsetAt(const arrow::ArrayData &data, int64_t i) {
+  if ((data.buffers.size() < 2) || (data.buffers[1] == nullptr)) {
+    return 0;
+  }
+  const auto &buf = data.buffers[1];
+  if (IsLarge(data.type->id())) {
+    return (i + 1) * 8 <= buf->size() ? reinterpret_cast<const int64_t *>(buf->data())[i] : 0;
+  }
+  return (i + 1) * 4 <= buf->size() ? reinterpret_cast<const int32_t *>(buf->data())[i] : 0;
+}
+
+/// @brief Return whether the buffers of a column should be described as a whole, rather than the parts a slice covers.
+static bool DescribeWhole(const arrow::Schema &schema, int column) {
+  // Write-mode buffers are filled by the kernel, compressed buffers are decompressed from their start, runs are
+  // expanded from the first run, and pages are decoded from their start.
+  const auto &field = *schema.field(column);
+  return (GetMode(schema) == Mode::WRITE) || !GetMeta(field, meta::COMPRESSION).empty() || IsRunEndEncoded(field)
+      || IsParquetEncoded(field);
+}
+
+ArraySlice ArraySlice::Child(const arrow::ArrayData &parent, const arrow::ArrayData &child) const {
+  switch (parent.type->id()) {
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST:
+      // The offsets are indices of the child elements, relative to the offset of the child.
+      return {child.offset, child.offset + OffsetAt(parent, begin), child.offset + OffsetAt(parent, end)};
+    case arrow::Type::FIXED_SIZE_LIST: {
+      // Every list holds the same number of child elements.
+      auto n = static_cast<const arrow::FixedSizeListType &>(*parent.type).list_size();
+      return {child.offset + origin * n, child.offset + begin * n, child.offset + end * n};
+    }
+    case arrow::Type::DICTIONARY:
+      // The indices may refer to any dictionary element.
+      return Of(child);
+    default:
+      // Struct elements map one-to-one to child elements.
+      return {child.offset + origin, child.offset + begin, child.offset + end};
+  }
+}
+
+bool DescribeBuffer(const arrow::ArrayData &data, int buffer, const ArraySlice &slice, bool whole, BufferMetadata *out) {
+  std::shared_ptr<arrow::Buffer> buf;
+  if (static_cast<size_t>(buffer) < data.buffers.size()) {
+    buf = data.buffers[buffer];
+  }
+  out->device_offset_ = 0;
+  if (buf == nullptr) {
+    out->raw_buffer_ = nullptr;
+    out->size_ = 0;
+    return true;
+  }
+  out->raw_buffer_ = buf->data();
+  out->size_ = buf->size();
+  if (whole) {
+    return true;
+  }
+
+  // Determine the width of the elements of the buffer, and the elements of the buffer that the slice covers.
+  auto id = data.type->id();
+  auto range = slice;
+  int64_t bits = 0;
+  if (buffer == 0) {
+    bits = 1;
+  } else if ((id == arrow::Type::STRING) || (id == arrow::Type::BINARY) || (id == arrow::Type::LARGE_STRING)
+      || (id == arrow::Type::LARGE_BINARY)) {
+    if (buffer == 1) {
+      bits = IsLarge(id) ? 64 : 32;
+      range.end++;
+    } else {
+      // The values are addressed by the offsets, from the start of the buffer.
+      bits = 8;
+      range = {0, OffsetAt(data, slice.begin), OffsetAt(data, slice.end)};
+    }
+  } else if ((id == arrow::Type::LIST) || (id == arrow::Type::LARGE_LIST)) {
+    bits = IsLarge(id) ? 64 : 32;
+    range.end++;
+  } else {
+    auto fixed = std::dynamic_pointer_cast<arrow::FixedWidthType>(data.type);
+    if (fixed == nullptr) {
+      return true;
+    }
+    bits = fixed->bit_width();
+  }
+
+  // The kernel addresses whole bytes, so the element at the origin must start at a byte boundary.
+  if ((range.origin * bits) % 8 != 0) {
+    return false;
+  }
+  auto first = std::min(range.begin * bits / 8, buf->size());
+  auto last = std::max(first, std::min((range.end * bits + 7) / 8, buf->size()));
+  out->raw_buffer_ = buf->data() + first;
+  out->size_ = last - first;
+  out->device_offset_ = first - range.origin * bits / 8;
+  return true;
+}
+
+arrow::Status RecordBatchAnalyzer::AddBuffer(const arrow::ArrayData &data, int buffer, const std::string &name) {
+  auto desc = buf_name;
+  desc.push_back(name);
+  out_->fields.back().buffers.emplace_back(nullptr, 0, desc, level);
+  if (!DescribeBuffer(data, buffer, slice, whole, &out_->fields.back().buffers.back())) {
+    return arrow::Status::Invalid("Slice of bit-packed buffer " + ToString(desc) + " does not start at a byte boundary.");
+  }
+  return arrow::Status::OK();
+}
+
 arrow::Status RecordBatchAnalyzer::VisitArray(const arrow::Array &arr) {
   // buf_name += ":" + arr.type()->ToString();
   // buf_name.push_back(arr.type()->ToString());
-  // Check if the field is nullable. If so, add the (implicit) validity bitmap buffer
-  if (field->nullable()) {
+  // Check if the field is nullable. If so, add the (implicit) validity bitmap buffer. The validity of Parquet-encoded
+  // columns is held by the definition levels in their page.
+  if (field->nullable() && !((level == 0) && IsParquetEncoded(*field))) {
     auto desc = buf_name;
     desc.emplace_back("validity");
     if (arr.null_count() > 0) {
-      out_->fields.back().buffers.emplace_back(arr.null_bitmap()->data(), arr.null_bitmap()->size(), desc, level);
+      auto status = AddBuffer(*arr.data(), 0, "validity");
+      if (!status.ok()) {
+        return status;
+      }
     } else {
       auto dummy = std::make_shared<arrow::Buffer>(nullptr, 0);
       out_->fields.back().buffers.emplace_back(dummy->data(), dummy->size(), desc, level, true);
@@ -50,12 +167,15 @@ arrow::Status RecordBatchAnalyzer::VisitArray(const arrow::Array &arr) {
 bool RecordBatchAnalyzer::Analyze(const arrow::RecordBatch &batch) {
   out_->name = fletcher::GetMeta(*batch.schema(), fletcher::meta::NAME);
   out_->rows = batch.num_rows();
+  out_->mode = GetMode(*batch.schema());
   // Depth-first search every column (arrow::Array) for buffers.
   for (int i = 0; i < batch.num_columns(); ++i) {
     auto arr = batch.column(i);
     // Remember what field we are at
     field = batch.schema()->field(i);
     buf_name = {field->name()};
+    slice = ArraySlice::Of(*arr->data());
+    whole = DescribeWhole(*batch.schema(), i);
     out_->fields.emplace_back(arr->type(), arr->length(), arr->null_count());
     if (!VisitArray(*arr).ok()) {
       return false;
@@ -64,20 +184,19 @@ bool RecordBatchAnalyzer::Analyze(const arrow::RecordBatch &batch) {
   return true;
 }
 
-arrow::Status RecordBatchAnalyzer::VisitBinary(const arrow::BinaryArray &array) {
-  auto odesc = buf_name;
-  odesc.emplace_back("offsets");
-  auto vdesc = buf_name;
-  vdesc.emplace_back("values");
-  out_->fields.back().buffers.emplace_back(array.value_offsets()->data(), array.value_offsets()->size(), odesc, level);
-  out_->fields.back().buffers.emplace_back(array.value_data()->data(), array.value_data()->size(), vdesc, level);
-  return arrow::Status::OK();
+arrow::Status RecordBatchAnalyzer::VisitBinary(const arrow::Array &array) {
+  auto status = AddBuffer(*array.data(), 1, "offsets");
+  if (!status.ok()) {
+    return status;
+  }
+  return AddBuffer(*array.data(), 2, "values");
 }
 
-arrow::Status RecordBatchAnalyzer::Visit(const arrow::ListArray &array) {
-  auto desc = buf_name;
-  desc.emplace_back("offsets");
-  out_->fields.back().buffers.emplace_back(array.value_offsets()->data(), array.value_offsets()->size(), desc, level);
+arrow::Status RecordBatchAnalyzer::VisitList(const arrow::Array &array, const arrow::Array &values) {
+  auto status = AddBuffer(*array.data(), 1, "offsets");
+  if (!status.ok()) {
+    return status;
+  }
   // Advance to the next nesting level.
   level++;
   // A list should only have one child.
@@ -85,6 +204,16 @@ arrow::Status RecordBatchAnalyzer::Visit(const arrow::ListArray &array) {
     return arrow::Status::TypeError("List type does not have exactly one child.");
   }
   field = field->type()->field(0);
+  slice = slice.Child(*array.data(), *values.data());
+  // Visit the nested values array
+  return VisitArray(values);
+}
+
+arrow::Status RecordBatchAnalyzer::Visit(const arrow::FixedSizeListArray &array) {
+  // Every list holds the same number of values, so there is no offsets buffer. Advance to the next nesting level.
+  level++;
+  field = field->type()->field(0);
+  slice = slice.Child(*array.data(), *array.values()->data());
   // Visit the nested values array
   return VisitArray(*array.values());
 }
@@ -99,8 +228,11 @@ arrow::Status RecordBatchAnalyzer::Visit(const arrow::StructArray &array) {
     return arrow::Status::TypeError(
         "Number of child arrays for struct does not match number of child fields for field type.");
   }
+  auto struct_slice = slice;
   for (int i = 0; i < array.num_fields(); ++i) {
-    std::shared_ptr<arrow::Array> child_array = array.field(i);
+    // Take the child without the offset of the struct applied, which the slice already includes.
+    auto child_array = arrow::MakeArray(array.data()->child_data[i]);
+    slice = struct_slice.Child(*array.data(), *child_array->data());
     // Go down one nesting level
     level++;
     // Select the struct field
@@ -116,4 +248,174 @@ arrow::Status RecordBatchAnalyzer::Visit(const arrow::StructArray &array) {
   return arrow::Status::OK();
 }
 
+arrow::Status RecordBatchAnalyzer::Visit(const arrow::DictionaryArray &array) {
+  // The indices are the values of the field itself.
+  auto status = AddBuffer(*array.data(), 1, "indices");
+  if (!status.ok()) {
+    return status;
+  }
+  // The dictionary is a non-nullable array of the value type, one nesting level down.
+  auto dict_field = field;
+  auto dict_name = buf_name;
+  auto dict_slice = slice;
+  slice = slice.Child(*array.data(), *array.dictionary()->data());
+  field = arrow::field("dictionary", array.dict_type()->value_type(), false);
+  buf_name.emplace_back("dictionary");
+  level++;
+  status = VisitArray(*array.dictionary());
+  level--;
+  field = dict_field;
+  buf_name = dict_name;
+  slice = dict_slice;
+  return status;
+}
+
+constexpr int RecordBatchLayout::kDictionary;
+
+bool RecordBatchLayout::Make(const std::shared_ptr<arrow::Schema> &schema, std::shared_ptr<RecordBatchLayout> *out) {
+  auto layout = std::make_shared<RecordBatchLayout>();
+  layout->schema_ = schema;
+  layout->desc_.name = fletcher::GetMeta(*schema, fletcher::meta::NAME);
+  layout->desc_.rows = 0;
+  layout->desc_.mode = GetMode(*schema);
+  for (int i = 0; i < schema->num_fields(); ++i) {
+    auto field = schema->field(i);
+    layout->desc_.fields.emplace_back(field->type(), 0, 0);
+    if (!layout->AddField(*field, i, {}, {field->name()}, 0)) {
+      return false;
+    }
+  }
+  *out = layout;
+  return true;
+}
+
+bool RecordBatchLayout::AddField(const arrow::Field &field,
+                                 int column,
+                                 const std::vector<int> &path,
+                                 std::vector<std::string> name,
+                                 int level) {
+  auto &buffers = desc_.fields.back().buffers;
+  auto whole = DescribeWhole(*schema_, column);
+  auto add = [&](const std::string &buf_name, int buffer, bool validity) {
+    auto desc = name;
+    desc.push_back(buf_name);
+    buffers.emplace_back(nullptr, 0, desc, level, validity);
+    locators_.push_back({column, path, buffer, validity, whole});
+  };
+
+  // The (implicit) validity bitmap buffer comes first, like in the RecordBatchAnalyzer.
+  if (field.nullable() && !((level == 0) && IsParquetEncoded(field))) {
+    add("validity", 0, true);
+  }
+
+  switch (field.type()->id()) {
+    case arrow::Type::BOOL:
+    case arrow::Type::INT8:
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::INT64:
+    case arrow::Type::UINT8:
+    case arrow::Type::UINT16:
+    case arrow::Type::UINT32:
+    case arrow::Type::UINT64:
+    case arrow::Type::HALF_FLOAT:
+    case arrow::Type::FLOAT:
+    case arrow::Type::DOUBLE:
+    case arrow::Type::DATE32:
+    case arrow::Type::DATE64:
+    case arrow::Type::TIMESTAMP:
+    case arrow::Type::TIME32:
+    case arrow::Type::TIME64:
+    case arrow::Type::FIXED_SIZE_BINARY:
+    case arrow::Type::DECIMAL128:
+      // Run-end encoded columns hold their run ends in an additional buffer, like in the RecordBatchAnalyzer.
+      if ((level == 0) && IsRunEndEncoded(field)) {
+        add("run_ends", 2, false);
+      }
+      add("values", 1, false);
+      return true;
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:add("offsets", 1, false);
+      add("values", 2, false);
+      return true;
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST: {
+      add("offsets", 1, false);
+      auto child_path = path;
+      child_path.push_back(0);
+      return AddField(*field.type()->field(0), column, child_path, name, level + 1);
+    }
+    case arrow::Type::FIXED_SIZE_LIST: {
+      auto child_path = path;
+      child_path.push_back(0);
+      return AddField(*field.type()->field(0), column, child_path, name, level + 1);
+    }
+    case arrow::Type::STRUCT: {
+      for (int i = 0; i < field.type()->num_fields(); ++i) {
+        auto child = field.type()->field(i);
+        auto child_path = path;
+        child_path.push_back(i);
+        auto child_name = name;
+        child_name.push_back(child->name());
+        if (!AddField(*child, column, child_path, child_name, level + 1)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case arrow::Type::DICTIONARY: {
+      add("indices", 1, false);
+      auto dict_type = static_cast<const arrow::DictionaryType *>(field.type().get());
+      auto dict_path = path;
+      dict_path.push_back(kDictionary);
+      name.push_back("dictionary");
+      return AddField(*arrow::field("dictionary", dict_type->value_type(), false), column, dict_path, name, level + 1);
+    }
+    default:FLETCHER_LOG(DEBUG, "RecordBatchLayout does not support type " << field.type()->ToString());
+      return false;
+  }
+}
+
+bool RecordBatchLayout::Fill(const arrow::RecordBatch &batch, RecordBatchDescription *desc) const {
+  if (batch.num_columns() != schema_->num_fields()) {
+    return false;
+  }
+  desc->rows = batch.num_rows();
+  size_t loc = 0;
+  for (int c = 0; c < batch.num_columns(); ++c) {
+    auto column = batch.column_data(c);
+    auto &field = desc->fields[c];
+    field.type_ = column->type;
+    field.length = column->length;
+    field.null_count = column->GetNullCount();
+    for (auto &buf : field.buffers) {
+      const auto &l = locators_[loc++];
+      // Follow the path to the ArrayData that holds this buffer, and the slice of it that the RecordBatch covers.
+      const arrow::ArrayData *data = column.get();
+      auto slice = ArraySlice::Of(*data);
+      for (auto child : l.path) {
+        auto next = child == kDictionary ? data->dictionary.get() : data->child_data[child].get();
+        slice = slice.Child(*data, *next);
+        data = next;
+      }
+      if (l.validity) {
+        buf.implicit_ = data->GetNullCount() == 0;
+        if (buf.implicit_) {
+          buf.raw_buffer_ = nullptr;
+          buf.size_ = 0;
+          buf.device_offset_ = 0;
+          continue;
+        }
+      }
+      if (!DescribeBuffer(*data, l.buffer, slice, l.whole, &buf)) {
+        FLETCHER_LOG(DEBUG, "Slice of bit-packed buffer " << ToString(buf.desc_) << " does not start at a byte boundary.");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 }  // namespace fletcher
@@ -48,12 +48,18 @@ bool FieldAnalyzer::Analyze(const arrow::Field &field) {
   field_out_->type_ = field.type();
   // Check if the field is nullable. If so, add the validity bitmap buffer as expected buffer.
   // As there is no physical RecordBatch, we don't know whether it is implicit or not, and it is assumed to not be
-  // implicit.
-  if (field.nullable()) {
+  // implicit. The validity of Parquet-encoded fields is held by the definition levels of their page.
+  if (field.nullable() && !IsParquetEncoded(field)) {
     auto desc = buf_name_;
     desc.emplace_back("validity");
     field_out_->buffers.emplace_back(nullptr, 0, desc, level, false);
   }
+  // Run-end encoded fields have a run ends buffer, that precedes the values buffer.
+  if (IsRunEndEncoded(field)) {
+    auto desc = buf_name_;
+    desc.emplace_back("run_ends");
+    field_out_->buffers.emplace_back(nullptr, 0, desc, level);
+  }
   auto status = VisitType(*field.type());
   if (!status.ok()) {
     FLETCHER_LOG(ERROR, "Could not analyze field. ARROW[" + status.ToString() + "]");
@@ -79,7 +85,7 @@ arrow::Status FieldAnalyzer::VisitType(const arrow::DataType &type) {
   return type.Accept(this);
 }
 
-arrow::Status FieldAnalyzer::VisitBinary(const arrow::BinaryType &type) {
+arrow::Status FieldAnalyzer::VisitBinary(const arrow::BaseBinaryType &type) {
   // Suppress unused warning
   (void) type;
   // Expect an offsets buffer
@@ -93,7 +99,7 @@ arrow::Status FieldAnalyzer::VisitBinary(const arrow::BinaryType &type) {
   return arrow::Status::OK();
 }
 
-arrow::Status FieldAnalyzer::Visit(const arrow::ListType &type) {
+arrow::Status FieldAnalyzer::VisitList(const arrow::BaseListType &type) {
   // Expect an offsets buffer
   auto desc = buf_name_;
   desc.emplace_back("offsets");
@@ -108,6 +114,12 @@ arrow::Status FieldAnalyzer::Visit(const arrow::ListType &type) {
   return VisitType(*type.field(0)->type());
 }
 
+arrow::Status FieldAnalyzer::Visit(const arrow::FixedSizeListType &type) {
+  // Every list holds the same number of values, so there is no offsets buffer. Advance to the next nesting level.
+  level++;
+  return VisitType(*type.value_type());
+}
+
 arrow::Status FieldAnalyzer::Visit(const arrow::StructType &type) {
   arrow::Status status;
   // Remember this nesting level name
@@ -128,4 +140,19 @@ arrow::Status FieldAnalyzer::Visit(const arrow::StructType &type) {
   return arrow::Status::OK();
 }
 
+arrow::Status FieldAnalyzer::Visit(const arrow::DictionaryType &type) {
+  // Expect an indices buffer
+  auto desc = buf_name_;
+  desc.emplace_back("indices");
+  field_out_->buffers.emplace_back(nullptr, 0, desc, level);
+  // The dictionary values are expected one nesting level down, without a validity bitmap.
+  auto field_name = buf_name_;
+  buf_name_.emplace_back("dictionary");
+  level++;
+  auto status = VisitType(*type.value_type());
+  level--;
+  buf_name_ = field_name;
+  return status;
+}
+
 }  // namespace fletcher
@@ -19,9 +19,13 @@
 #include <utility>
 #include <memory>
 #include <vector>
+#include <functional>
 #include <iostream>
 #include <unordered_map>
 #include <sstream>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
 
 #include "fletcher/arrow-utils.h"
 #include "fletcher/logging.h"
@@ -95,6 +99,98 @@ bool GetBoolMeta(const arrow::Field &field, const std::string &key, bool default
   return default_to;
 }
 
+bool HasLargeOffsets(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+    case arrow::Type::LARGE_LIST:return true;
+    case arrow::Type::DICTIONARY:
+      return HasLargeOffsets(*static_cast<const arrow::DictionaryType &>(type).value_type());
+    default:break;
+  }
+  for (const auto &child : type.fields()) {
+    if (HasLargeOffsets(*child->type())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HasLargeOffsets(const arrow::Schema &schema) {
+  for (const auto &field : schema.fields()) {
+    if (HasLargeOffsets(*field->type())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Canonical forms of types and schemas, without names and metadata.
+static std::string CanonicalForm(const arrow::DataType &type);
+
+static std::string CanonicalForm(const arrow::Field &field) {
+  // Compressed fields are read by a decompressor, run-end encoded fields by a run expander, and Parquet-encoded fields
+  // by a page decoder.
+  auto compression = GetMeta(field, meta::COMPRESSION);
+  return (field.nullable() ? "?" : "") + CanonicalForm(*field.type()) + (compression.empty() ? "" : "@" + compression)
+      + (IsRunEndEncoded(field) ? "~" : "") + (IsParquetEncoded(field) ? "#" : "");
+}
+
+static std::string CanonicalForm(const arrow::DataType &type) {
+  auto result = std::to_string(static_cast<int>(type.id()));
+  auto fixed = dynamic_cast<const arrow::FixedWidthType *>(&type);
+  if (fixed != nullptr) {
+    result += ":" + std::to_string(fixed->bit_width());
+  }
+  if (type.id() == arrow::Type::DICTIONARY) {
+    const auto &dict = static_cast<const arrow::DictionaryType &>(type);
+    result += "<" + CanonicalForm(*dict.index_type()) + "," + CanonicalForm(*dict.value_type()) + ">";
+  }
+  if (type.num_fields() > 0) {
+    result += "<";
+    for (int i = 0; i < type.num_fields(); i++) {
+      result += (i > 0 ? "," : "") + CanonicalForm(*type.field(i));
+    }
+    result += ">";
+  }
+  return result;
+}
+
+static std::string CanonicalForm(const arrow::Schema &schema) {
+  std::string result = GetMode(schema) == Mode::READ ? "r(" : "w(";
+  bool first = true;
+  for (const auto &field : schema.fields()) {
+    // Ignored fields do not result in hardware.
+    if (GetBoolMeta(*field, meta::IGNORE, false)) {
+      continue;
+    }
+    result += (first ? "" : ",") + CanonicalForm(*field);
+    first = false;
+  }
+  return result + ")";
+}
+
+static uint32_t Fnv1a(const std::string &str) {
+  uint32_t hash = 2166136261u;
+  for (auto c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+uint32_t SchemaHash(const arrow::Schema &schema) {
+  return Fnv1a(CanonicalForm(schema));
+}
+
+uint32_t SchemaSetHash(const std::vector<std::shared_ptr<arrow::Schema>> &schema_set) {
+  std::string str;
+  for (const auto &schema : schema_set) {
+    str += CanonicalForm(*schema) + "|";
+  }
+  return Fnv1a(str);
+}
+
 std::shared_ptr<arrow::Schema> WithMetaRequired(const arrow::Schema &schema,
                                                 std::string schema_name,
                                                 Mode mode) {
@@ -123,6 +219,31 @@ std::shared_ptr<arrow::Schema> WithMetaBusSpec(const arrow::Schema &schema,
   return schema.WithMetadata(meta);
 }
 
+std::shared_ptr<arrow::Schema> WithMetaFilter(const arrow::Schema &schema, const std::string &expression) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (schema.metadata() != nullptr) {
+    meta = schema.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::FILTER, expression);
+  return schema.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Schema> WithMetaPartitions(const arrow::Schema &schema,
+                                                  uint32_t partitions,
+                                                  const std::string &key) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (schema.metadata() != nullptr) {
+    meta = schema.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::PARTITIONS, std::to_string(partitions));
+  meta->Append(meta::PARTITION_KEY, key);
+  return schema.WithMetadata(meta);
+}
+
 std::shared_ptr<arrow::Field> WithMetaEPC(const arrow::Field &field, int epc) {
   auto meta = std::make_shared<arrow::KeyValueMetadata>(
       std::vector<std::string>({meta::VALUE_EPC}),
@@ -144,6 +265,365 @@ std::shared_ptr<arrow::Field> WithMetaProfile(const arrow::Field &field) {
   return field.WithMetadata(meta);
 }
 
+std::shared_ptr<arrow::Field> WithMetaBusChannel(const arrow::Field &field, uint32_t channel) {
+  auto meta = std::make_shared<arrow::KeyValueMetadata>(
+      std::vector<std::string>({meta::BUS_CHANNEL}),
+      std::vector<std::string>({std::to_string(channel)}));
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaBusWeight(const arrow::Field &field, uint32_t weight) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::BUS_WEIGHT, std::to_string(weight));
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaBufferDepth(const arrow::Field &field, uint32_t bus_fifo_depth,
+                                                  uint32_t fifo_size) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  if (bus_fifo_depth > 0) {
+    meta->Append(meta::BUS_FIFO_DEPTH, std::to_string(bus_fifo_depth));
+  }
+  if (fifo_size > 0) {
+    meta->Append(meta::FIFO_SIZE, std::to_string(fifo_size));
+  }
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaWriteCoalesce(const arrow::Field &field) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::WRITE_COALESCE, "true");
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaGather(const arrow::Field &field) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::GATHER, "true");
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaTagWidth(const arrow::Field &field, uint32_t width) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::TAG_WIDTH, std::to_string(width));
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaOnChip(const arrow::Field &field, uint32_t depth) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::ONCHIP, std::to_string(depth));
+  return field.WithMetadata(meta);
+}
+
+std::shared_ptr<arrow::Field> WithMetaCompression(const arrow::Field &field, const std::string &codec) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::COMPRESSION, codec);
+  return field.WithMetadata(meta);
+}
+
+int64_t GetUncompressedLength(const arrow::Buffer &buffer) {
+  if (buffer.size() < static_cast<int64_t>(sizeof(int64_t))) {
+    return -1;
+  }
+  // The length is stored in little-endian byte order.
+  int64_t result = 0;
+  for (int i = sizeof(int64_t) - 1; i >= 0; i--) {
+    result = (result << 8) | buffer.data()[i];
+  }
+  return result;
+}
+
+bool MakeCompressedArray(const std::shared_ptr<arrow::DataType> &type,
+                         int64_t length,
+                         const std::shared_ptr<arrow::Buffer> &compressed,
+                         std::shared_ptr<arrow::Array> *out) {
+  auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(type);
+  if ((fwt == nullptr) || (fwt->bit_width() % 8 != 0) || (compressed == nullptr)) {
+    FLETCHER_LOG(WARNING, "Only byte-aligned fixed-width values can be compressed.");
+    return false;
+  }
+  auto uncompressed = GetUncompressedLength(*compressed);
+  if (uncompressed != length * (fwt->bit_width() / 8)) {
+    FLETCHER_LOG(WARNING, "Compressed buffer holds " << uncompressed << " bytes, but " << length << " values of type "
+                                                     << type->ToString() << " were expected.");
+    return false;
+  }
+  *out = arrow::MakeArray(arrow::ArrayData::Make(type, length, {nullptr, compressed}, 0));
+  return true;
+}
+
+std::shared_ptr<arrow::Field> WithMetaRunEndEncoding(const arrow::Field &field) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::ENCODING, meta::RUN_END);
+  return field.WithMetadata(meta);
+}
+
+bool IsRunEndEncoded(const arrow::Field &field) {
+  return GetMeta(field, meta::ENCODING) == meta::RUN_END;
+}
+
+bool MakeRunEndEncodedArray(const std::shared_ptr<arrow::Array> &values,
+                            const std::shared_ptr<arrow::Int32Array> &run_ends,
+                            std::shared_ptr<arrow::Array> *out) {
+  if ((values == nullptr) || (run_ends == nullptr)
+      || (std::dynamic_pointer_cast<arrow::FixedWidthType>(values->type()) == nullptr)) {
+    FLETCHER_LOG(WARNING, "Only fixed-width values can be run-end encoded.");
+    return false;
+  }
+  if ((values->null_count() != 0) || (run_ends->null_count() != 0) || (values->length() != run_ends->length())) {
+    FLETCHER_LOG(WARNING, "Run-end encoded arrays must have one non-null value and run end per run.");
+    return false;
+  }
+  // The device reads both buffers from their start.
+  if ((values->offset() != 0) || (run_ends->offset() != 0)) {
+    FLETCHER_LOG(WARNING, "Values and run ends of run-end encoded arrays can not be sliced.");
+    return false;
+  }
+  int32_t previous = 0;
+  for (int64_t i = 0; i < run_ends->length(); i++) {
+    if (run_ends->Value(i) <= previous) {
+      FLETCHER_LOG(WARNING, "Run end " << run_ends->Value(i) << " of run " << i << " does not exceed the run end "
+                                       << previous << " of the run before it.");
+      return false;
+    }
+    previous = run_ends->Value(i);
+  }
+  const auto &data = values->data();
+  *out = arrow::MakeArray(arrow::ArrayData::Make(values->type(),
+                                                 previous,
+                                                 {nullptr, data->buffers[1], run_ends->data()->buffers[1]},
+                                                 0));
+  return true;
+}
+
+bool RunEndEncode(const std::shared_ptr<arrow::Array> &array, std::shared_ptr<arrow::Array> *out) {
+  if ((array == nullptr) || (std::dynamic_pointer_cast<arrow::FixedWidthType>(array->type()) == nullptr)
+      || (array->null_count() != 0)) {
+    FLETCHER_LOG(WARNING, "Only non-nullable fixed-width arrays can be run-end encoded.");
+    return false;
+  }
+  if (array->length() > std::numeric_limits<int32_t>::max()) {
+    FLETCHER_LOG(WARNING, "Arrays of more than 2^31 - 1 rows can not be run-end encoded with 32-bit run ends.");
+    return false;
+  }
+  arrow::ArrayVector runs;
+  arrow::Int32Builder run_ends;
+  for (int64_t i = 0; i < array->length(); i++) {
+    if ((i + 1 == array->length()) || !array->RangeEquals(i, i + 1, i + 1, array)) {
+      runs.push_back(array->Slice(i, 1));
+      if (!run_ends.Append(static_cast<int32_t>(i + 1)).ok()) {
+        return false;
+      }
+    }
+  }
+  std::shared_ptr<arrow::Array> values;
+  if (runs.empty()) {
+    values = array;
+  } else {
+    auto concatenated = arrow::Concatenate(runs);
+    if (!concatenated.ok()) {
+      FLETCHER_LOG(WARNING,
+                   "Could not gather the values of the runs. ARROW[" << concatenated.status().ToString() << "]");
+      return false;
+    }
+    values = concatenated.ValueOrDie();
+  }
+  std::shared_ptr<arrow::Array> ends;
+  if (!run_ends.Finish(&ends).ok()) {
+    return false;
+  }
+  return MakeRunEndEncodedArray(values, std::static_pointer_cast<arrow::Int32Array>(ends), out);
+}
+
+std::shared_ptr<arrow::Field> WithMetaParquetEncoding(const arrow::Field &field) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::ENCODING, meta::PARQUET);
+  return field.WithMetadata(meta);
+}
+
+bool IsParquetEncoded(const arrow::Field &field) {
+  return GetMeta(field, meta::ENCODING) == meta::PARQUET;
+}
+
+int64_t GetParquetPageValueCount(const arrow::Buffer &page, int bit_width, bool nullable) {
+  if ((bit_width != 32) && (bit_width != 64)) {
+    return -1;
+  }
+  int64_t offset = 0;
+  if (nullable) {
+    if (page.size() < static_cast<int64_t>(sizeof(uint32_t))) {
+      return -1;
+    }
+    // The byte length of the definition levels is stored in little-endian byte order.
+    uint32_t levels = 0;
+    for (int i = sizeof(uint32_t) - 1; i >= 0; i--) {
+      levels = (levels << 8) | page.data()[i];
+    }
+    offset = sizeof(uint32_t) + static_cast<int64_t>(levels);
+  }
+  if ((offset > page.size()) || ((page.size() - offset) % (bit_width / 8) != 0)) {
+    return -1;
+  }
+  return (page.size() - offset) / (bit_width / 8);
+}
+
+bool MakeParquetPageArray(const std::shared_ptr<arrow::DataType> &type,
+                          int64_t length,
+                          bool nullable,
+                          const std::shared_ptr<arrow::Buffer> &page,
+                          std::shared_ptr<arrow::Array> *out) {
+  auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(type);
+  if ((fwt == nullptr) || ((fwt->bit_width() != 32) && (fwt->bit_width() != 64)) || (page == nullptr)) {
+    FLETCHER_LOG(WARNING, "Only 32- and 64-bit fixed-width values can be read from Parquet pages.");
+    return false;
+  }
+  // Nulls have no value in the page.
+  auto values = GetParquetPageValueCount(*page, fwt->bit_width(), nullable);
+  if ((values < 0) || (values > length) || (!nullable && (values != length))) {
+    FLETCHER_LOG(WARNING, "Parquet page holds " << values << " values, but " << length << " elements of type "
+                                                << type->ToString() << " were expected.");
+    return false;
+  }
+  *out = arrow::MakeArray(arrow::ArrayData::Make(type, length, {nullptr, page}, length - values));
+  return true;
+}
+
+std::shared_ptr<arrow::Field> WithMetaParallel(const arrow::Field &field) {
+  std::shared_ptr<arrow::KeyValueMetadata> meta;
+  if (field.metadata() != nullptr) {
+    meta = field.metadata()->Copy();
+  } else {
+    meta = std::make_shared<arrow::KeyValueMetadata>();
+  }
+  meta->Append(meta::PARALLEL, "true");
+  return field.WithMetadata(meta);
+}
+
+/// @brief Return whether a field with parallel metadata is a list of a non-nullable struct, and can thus be split.
+static bool CanSplit(const arrow::Field &field) {
+  auto id = field.type()->id();
+  if ((id != arrow::Type::LIST) && (id != arrow::Type::LARGE_LIST)) {
+    FLETCHER_LOG(WARNING, "Field " << field.name() << " with parallel metadata is not a list.");
+    return false;
+  }
+  auto values = field.type()->field(0);
+  if ((values->type()->id() != arrow::Type::STRUCT) || (values->type()->num_fields() == 0) || values->nullable()) {
+    FLETCHER_LOG(WARNING,
+                 "Field " << field.name() << " with parallel metadata is not a list of a non-nullable struct.");
+    return false;
+  }
+  return true;
+}
+
+/// @brief Return the fields that a field with parallel metadata is split into.
+static std::vector<std::shared_ptr<arrow::Field>> SplitParallelField(const arrow::Field &field) {
+  // The split fields are not split again.
+  auto meta = field.metadata()->Copy();
+  meta->Delete(meta::PARALLEL).ok();
+  std::vector<std::shared_ptr<arrow::Field>> result;
+  for (const auto &child : field.type()->field(0)->type()->fields()) {
+    auto type = field.type()->id() == arrow::Type::LARGE_LIST ? arrow::large_list(child) : arrow::list(child);
+    result.push_back(arrow::field(field.name() + "_" + child->name(), type, field.nullable(), meta));
+  }
+  return result;
+}
+
+bool SplitParallelFields(const std::shared_ptr<arrow::Schema> &schema, std::shared_ptr<arrow::Schema> *out) {
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  bool split = false;
+  for (const auto &field : schema->fields()) {
+    if (!GetBoolMeta(*field, meta::PARALLEL, false)) {
+      fields.push_back(field);
+      continue;
+    }
+    if (!CanSplit(*field)) {
+      return false;
+    }
+    auto split_fields = SplitParallelField(*field);
+    fields.insert(fields.end(), split_fields.begin(), split_fields.end());
+    split = true;
+  }
+  *out = split ? arrow::schema(fields, schema->metadata()) : schema;
+  return true;
+}
+
+bool SplitParallelFields(const std::shared_ptr<arrow::RecordBatch> &batch, std::shared_ptr<arrow::RecordBatch> *out) {
+  std::shared_ptr<arrow::Schema> schema;
+  if (!SplitParallelFields(batch->schema(), &schema)) {
+    return false;
+  }
+  if (schema == batch->schema()) {
+    *out = batch;
+    return true;
+  }
+  std::vector<std::shared_ptr<arrow::ArrayData>> columns;
+  for (int c = 0; c < batch->num_columns(); c++) {
+    auto data = batch->column_data(c);
+    if (!GetBoolMeta(*batch->schema()->field(c), meta::PARALLEL, false)) {
+      columns.push_back(data);
+      continue;
+    }
+    auto values = std::static_pointer_cast<arrow::StructArray>(arrow::MakeArray(data->child_data[0]));
+    if (values->null_count() > 0) {
+      FLETCHER_LOG(WARNING,
+                   "Column " << batch->schema()->field(c)->name() << " with parallel metadata has null structs.");
+      return false;
+    }
+    // The offsets of the list index the struct array, of which the child arrays are sliced accordingly.
+    for (int i = 0; i < values->num_fields(); i++) {
+      const auto &field = schema->field(static_cast<int>(columns.size()));
+      columns.push_back(arrow::ArrayData::Make(field->type(), data->length, data->buffers, {values->field(i)->data()},
+                                               data->null_count, data->offset));
+    }
+  }
+  *out = arrow::RecordBatch::Make(schema, batch->num_rows(), columns);
+  return true;
+}
+
 bool ReadSchemaFromFile(const std::string &file_name,
                         std::shared_ptr<arrow::Schema> *out) {
   std::shared_ptr<arrow::Schema> schema;
@@ -173,6 +653,51 @@ bool ReadSchemaFromFile(const std::string &file_name,
   return true;
 }
 
+bool PartitionSchemas(const std::shared_ptr<arrow::Schema> &schema, std::vector<std::shared_ptr<arrow::Schema>> *out) {
+  auto partitions_str = GetMeta(*schema, meta::PARTITIONS);
+  if (partitions_str.empty()) {
+    *out = {schema};
+    return true;
+  }
+  auto name = GetMeta(*schema, meta::NAME);
+  if (GetMode(*schema) != Mode::WRITE) {
+    FLETCHER_LOG(WARNING, "Schema " << name << " with partitioning metadata is not a write schema.");
+    return false;
+  }
+  char *end = nullptr;
+  auto partitions = std::strtoul(partitions_str.c_str(), &end, 10);
+  if ((*end != '\0') || (partitions == 0) || (partitions > UINT32_MAX)) {
+    FLETCHER_LOG(WARNING, "Schema " << name << " has an invalid number of partitions: " << partitions_str);
+    return false;
+  }
+  auto key = schema->GetFieldByName(GetMeta(*schema, meta::PARTITION_KEY));
+  if ((key == nullptr) || !arrow::is_integer(key->type()->id()) || key->nullable()) {
+    FLETCHER_LOG(WARNING, "Partition key of schema " << name << " is not a non-nullable integer field.");
+    return false;
+  }
+  out->clear();
+  for (unsigned long p = 0; p < partitions; p++) {
+    // Keep all metadata except the schema name and the number of partitions.
+    auto meta = std::make_shared<arrow::KeyValueMetadata>();
+    for (int64_t i = 0; i < schema->metadata()->size(); i++) {
+      const auto &k = schema->metadata()->key(i);
+      if ((k != meta::NAME) && (k != meta::PARTITIONS)) {
+        meta->Append(k, schema->metadata()->value(i));
+      }
+    }
+    meta->Append(meta::NAME, name + "_p" + std::to_string(p));
+    meta->Append(meta::PARTITION, std::to_string(p));
+    out->push_back(schema->WithMetadata(meta));
+  }
+  return true;
+}
+
+uint32_t PartitionOf(uint64_t key, uint32_t partitions) {
+  auto folded = static_cast<uint32_t>(key ^ (key >> 32));
+  auto hash = static_cast<uint32_t>(folded * UINT32_C(0x9E3779B1));
+  return static_cast<uint32_t>((static_cast<uint64_t>(hash) * partitions) >> 32);
+}
+
 void WriteSchemaToFile(const std::string &file_name, const arrow::Schema &schema) {
   std::shared_ptr<arrow::ResizableBuffer> resizable_buffer;
   arrow::Result<std::shared_ptr<arrow::ResizableBuffer>> resbuffer_result;
@@ -263,6 +788,53 @@ bool ReadRecordBatchesFromFile(const std::string &file_name,
   return true;
 }
 
+bool MapRecordBatchesFromFile(const std::string &file_name,
+                              const std::function<bool(const std::shared_ptr<arrow::RecordBatch> &)> &visit) {
+  arrow::Result<std::shared_ptr<arrow::io::MemoryMappedFile>>
+      result = arrow::io::MemoryMappedFile::Open(file_name, arrow::io::FileMode::READ);
+  if (!result.ok()) {
+    FLETCHER_LOG(WARNING,
+                 "Could not memory-map file for reading: " + file_name + " ARROW:["
+                     + result.status().ToString() + "]");
+    return false;
+  }
+  std::shared_ptr<arrow::io::MemoryMappedFile> file = result.ValueOrDie();
+
+  arrow::Result<std::shared_ptr<arrow::ipc::RecordBatchFileReader>> file_result;
+  file_result = arrow::ipc::RecordBatchFileReader::Open(file);
+  if (!file_result.ok()) {
+    FLETCHER_LOG(WARNING,
+                 "Could not open RecordBatchFileReader. ARROW:["
+                     + file_result.status().ToString() + "]");
+    return false;
+  }
+  auto reader = file_result.ValueOrDie();
+
+  // Batches are decoded lazily, so the visitor can process the first batch before the others are read.
+  for (int i = 0; i < reader->num_record_batches(); i++) {
+    arrow::Result<std::shared_ptr<arrow::RecordBatch>> rb_result;
+    rb_result = reader->ReadRecordBatch(i);
+    if (!rb_result.ok()) {
+      FLETCHER_LOG(WARNING,
+                   "Could not read RecordBatch " << i << " from file. ARROW:["
+                       + rb_result.status().ToString() + "]");
+      return false;
+    }
+    if (!visit(rb_result.ValueOrDie())) {
+      break;
+    }
+  }
+
+  return true;
+}
+
+bool MapRecordBatchesFromFile(const std::string &file_name, std::vector<std::shared_ptr<arrow::RecordBatch>> *out) {
+  return MapRecordBatchesFromFile(file_name, [out](const std::shared_ptr<arrow::RecordBatch> &rb) {
+    out->push_back(rb);
+    return true;
+  });
+}
+
 std::string ToString(const std::vector<std::string> &strvec, const std::string &sep) {
   std::string result;
   for (const auto &s : strvec) {
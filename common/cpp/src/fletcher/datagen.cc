@@ -0,0 +1,196 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/datagen.h"
+
+#include <arrow/builder.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fletcher/logging.h"
+
+namespace fletcher {
+
+std::string ToString(LengthDistribution distribution) {
+  switch (distribution) {
+    case LengthDistribution::FIXED: return "fixed";
+    case LengthDistribution::UNIFORM: return "uniform";
+    case LengthDistribution::ZIPF: return "zipf";
+  }
+  return "unknown";
+}
+
+bool ParseLengthDistribution(const std::string &name, LengthDistribution *out) {
+  for (auto d : {LengthDistribution::FIXED, LengthDistribution::UNIFORM, LengthDistribution::ZIPF}) {
+    if (name == ToString(d)) {
+      *out = d;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+
+/// Appends random values to Arrow builders.
+class Generator {
+ public:
+  explicit Generator(const GeneratorOptions &options) : options_(options), rng_(options.seed) {
+    if ((options_.length_distribution == LengthDistribution::ZIPF) && (options_.max_length > options_.min_length)) {
+      // The probability of a length of min_length + k is proportional to 1 / (k + 1).
+      std::vector<double> weights;
+      for (uint32_t k = 0; k <= options_.max_length - options_.min_length; k++) {
+        weights.push_back(1.0 / (k + 1.0));
+      }
+      zipf_ = std::discrete_distribution<uint32_t>(weights.begin(), weights.end());
+    }
+  }
+
+  /// @brief Append a random value of some type to a builder of that type.
+  arrow::Status Append(arrow::ArrayBuilder *builder, const arrow::DataType &type, bool nullable) {
+    // Struct validity is appended by the struct builder, because its children need values as well.
+    if ((type.id() != arrow::Type::STRUCT) && IsNull(nullable)) {
+      return builder->AppendNull();
+    }
+    switch (type.id()) {
+      case arrow::Type::BOOL: return static_cast<arrow::BooleanBuilder *>(builder)->Append((rng_() & 1) == 1);
+      case arrow::Type::INT8: return AppendInt<arrow::Int8Builder>(builder);
+      case arrow::Type::INT16: return AppendInt<arrow::Int16Builder>(builder);
+      case arrow::Type::INT32: return AppendInt<arrow::Int32Builder>(builder);
+      case arrow::Type::INT64: return AppendInt<arrow::Int64Builder>(builder);
+      case arrow::Type::UINT8: return AppendInt<arrow::UInt8Builder>(builder);
+      case arrow::Type::UINT16: return AppendInt<arrow::UInt16Builder>(builder);
+      case arrow::Type::UINT32: return AppendInt<arrow::UInt32Builder>(builder);
+      case arrow::Type::UINT64: return AppendInt<arrow::UInt64Builder>(builder);
+        // Positive, finite half-precision numbers.
+      case arrow::Type::HALF_FLOAT:
+        return static_cast<arrow::HalfFloatBuilder *>(builder)->Append(static_cast<uint16_t>(rng_() & 0x3FFF));
+      case arrow::Type::FLOAT: return static_cast<arrow::FloatBuilder *>(builder)->Append(static_cast<float>(Real()));
+      case arrow::Type::DOUBLE: return static_cast<arrow::DoubleBuilder *>(builder)->Append(Real());
+      case arrow::Type::STRING: return AppendBinary<arrow::StringBuilder>(builder);
+      case arrow::Type::BINARY: return AppendBinary<arrow::BinaryBuilder>(builder);
+      case arrow::Type::LARGE_STRING: return AppendBinary<arrow::LargeStringBuilder>(builder);
+      case arrow::Type::LARGE_BINARY: return AppendBinary<arrow::LargeBinaryBuilder>(builder);
+      case arrow::Type::LIST: return AppendList<arrow::ListBuilder>(builder, type);
+      case arrow::Type::LARGE_LIST: return AppendList<arrow::LargeListBuilder>(builder, type);
+      case arrow::Type::STRUCT: {
+        auto struct_builder = static_cast<arrow::StructBuilder *>(builder);
+        ARROW_RETURN_NOT_OK(struct_builder->Append(!IsNull(nullable)));
+        for (int i = 0; i < type.num_fields(); i++) {
+          ARROW_RETURN_NOT_OK(Append(struct_builder->field_builder(i), *type.field(i)->type(),
+                                     type.field(i)->nullable()));
+        }
+        return arrow::Status::OK();
+      }
+      default: return arrow::Status::NotImplemented("Generating values of type " + type.ToString());
+    }
+  }
+
+ private:
+  /// @brief Return true if the next value of a field must be null.
+  bool IsNull(bool nullable) {
+    return nullable && (options_.null_ratio > 0.0) && (unit_(rng_) < options_.null_ratio);
+  }
+
+  /// @brief Return the next length of a string, binary or list.
+  uint32_t Length() {
+    if (options_.max_length <= options_.min_length) {
+      return options_.max_length;
+    }
+    switch (options_.length_distribution) {
+      case LengthDistribution::FIXED: return options_.max_length;
+      case LengthDistribution::UNIFORM:
+        return std::uniform_int_distribution<uint32_t>(options_.min_length, options_.max_length)(rng_);
+      case LengthDistribution::ZIPF: return options_.min_length + zipf_(rng_);
+    }
+    return options_.max_length;
+  }
+
+  /// @brief Return a random floating point number.
+  double Real() { return std::uniform_real_distribution<double>(-1000.0, 1000.0)(rng_); }
+
+  template<typename BuilderType>
+  arrow::Status AppendInt(arrow::ArrayBuilder *builder) {
+    using T = typename BuilderType::value_type;
+    return static_cast<BuilderType *>(builder)->Append(static_cast<T>(rng_()));
+  }
+
+  template<typename BuilderType>
+  arrow::Status AppendBinary(arrow::ArrayBuilder *builder) {
+    std::string value(Length(), ' ');
+    for (auto &c : value) {
+      c = static_cast<char>('a' + rng_() % 26);
+    }
+    using offset_type = typename BuilderType::offset_type;
+    return static_cast<BuilderType *>(builder)->Append(value.data(), static_cast<offset_type>(value.size()));
+  }
+
+  template<typename BuilderType>
+  arrow::Status AppendList(arrow::ArrayBuilder *builder, const arrow::DataType &type) {
+    auto list_builder = static_cast<BuilderType *>(builder);
+    ARROW_RETURN_NOT_OK(list_builder->Append());
+    const auto &values = *type.field(0);
+    auto length = Length();
+    for (uint32_t i = 0; i < length; i++) {
+      ARROW_RETURN_NOT_OK(Append(list_builder->value_builder(), *values.type(), values.nullable()));
+    }
+    return arrow::Status::OK();
+  }
+
+  GeneratorOptions options_;
+  std::mt19937_64 rng_;
+  std::uniform_real_distribution<double> unit_{0.0, 1.0};
+  std::discrete_distribution<uint32_t> zipf_;
+};
+
+}  // namespace
+
+bool GenerateRecordBatch(const std::shared_ptr<arrow::Schema> &schema,
+                         const GeneratorOptions &options,
+                         std::shared_ptr<arrow::RecordBatch> *out) {
+  Generator generator(options);
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (const auto &field : schema->fields()) {
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+    auto status = arrow::MakeBuilder(arrow::default_memory_pool(), field->type(), &builder);
+    for (int64_t r = 0; status.ok() && (r < options.rows); r++) {
+      status = generator.Append(builder.get(), *field->type(), field->nullable());
+    }
+    std::shared_ptr<arrow::Array> column;
+    if (status.ok()) {
+      status = builder->Finish(&column);
+    }
+    if (!status.ok()) {
+      FLETCHER_LOG(WARNING, "Could not generate field " << field->name() << ": " << status.ToString());
+      return false;
+    }
+    columns.push_back(column);
+  }
+  *out = arrow::RecordBatch::Make(schema, options.rows, columns);
+  return true;
+}
+
+std::shared_ptr<arrow::DataType> NestedListType(const std::shared_ptr<arrow::DataType> &value_type,
+                                                int depth,
+                                                bool nullable) {
+  auto result = value_type;
+  for (int i = 0; i < depth; i++) {
+    result = arrow::list(arrow::field(i == 0 ? "item" : "list", result, nullable));
+  }
+  return result;
+}
+
+}  // namespace fletcher
@@ -0,0 +1,164 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/logging.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <utility>
+
+namespace fletcher {
+namespace detail {
+
+// Log everything by default, such that only FLETCHER_LOG_MIN_LEVEL applies until SetLogLevel() is called.
+std::atomic<int> log_level{static_cast<int>(FLETCHER_LOG_DEBUG)};
+
+}  // namespace detail
+
+#ifndef FLETCHER_USE_ARROW_LOGGING
+
+namespace {
+
+/// A sink that writes log messages from a background thread.
+class AsyncSink {
+ public:
+  ~AsyncSink() { Stop(); }
+
+  /// @brief Start the writer thread. Returns false if the file could not be opened.
+  bool Start(const std::string &file_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) {
+      return true;
+    }
+    if (!file_name.empty()) {
+      file_.open(file_name, std::ios::out | std::ios::app);
+      if (!file_.is_open()) {
+        return false;
+      }
+    }
+    stop_ = false;
+    running_ = true;
+    thread_ = std::thread(&AsyncSink::Write, this);
+    return true;
+  }
+
+  /// @brief Write all pending messages and stop the writer thread.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_ || stop_) {
+        return;
+      }
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    if (file_.is_open()) {
+      file_.close();
+    }
+  }
+
+  /// @brief Hand a message to the writer thread. Returns false if the sink is not running.
+  bool Push(std::string &&line) {
+    bool notify;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_ || stop_) {
+        return false;
+      }
+      notify = pending_.empty();
+      pending_.push_back(std::move(line));
+    }
+    if (notify) {
+      cv_.notify_one();
+    }
+    return true;
+  }
+
+ private:
+  /// @brief Write pending messages until the sink is stopped. Runs on the writer thread.
+  void Write() {
+    std::vector<std::string> lines;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      lines.swap(pending_);
+      bool stop = stop_;
+      // Write without holding the lock, such that logging threads do not wait for I/O.
+      lock.unlock();
+      std::ostream &out = file_.is_open() ? static_cast<std::ostream &>(file_) : std::cout;
+      for (const auto &l : lines) {
+        out << l << '\n';
+      }
+      out.flush();
+      lines.clear();
+      lock.lock();
+      if (stop && pending_.empty()) {
+        break;
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::string> pending_;
+  std::ofstream file_;
+  std::thread thread_;
+  bool running_ = false;
+  bool stop_ = false;
+};
+
+AsyncSink &sink() {
+  static AsyncSink result;
+  return result;
+}
+
+}  // namespace
+
+namespace detail {
+
+void Log(LogLevel level, const std::string &msg) {
+  auto line = "[" + level2str(level) + "]: " + msg;
+  if (level > FLETCHER_LOG_WARNING) {
+    // Make sure preceding messages are written before the application exits.
+    sink().Stop();
+    std::cerr << line << std::endl;
+    std::exit(-1);
+  }
+  if (!sink().Push(std::move(line))) {
+    std::cout << "[" + level2str(level) + "]: " << msg << std::endl;
+  }
+}
+
+}  // namespace detail
+
+bool StartAsyncLogging(const std::string &file_name) {
+  return sink().Start(file_name);
+}
+
+void StopLogging() {
+  sink().Stop();
+}
+
+#endif
+
+}  // namespace fletcher
@@ -0,0 +1,519 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/staging.h"
+
+#include <arrow/api.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The vectorized functions are compiled for their instruction set extension through function attributes, such that
+// the library runs on any CPU of its architecture and selects them at run-time.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FLETCHER_STAGING_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#define FLETCHER_STAGING_NEON
+#include <arm_neon.h>
+#endif
+
+namespace fletcher {
+
+static SimdLevel DetectSimdLevel() {
+#if defined(FLETCHER_STAGING_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SimdLevel::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  return SimdLevel::SCALAR;
+#elif defined(FLETCHER_STAGING_NEON)
+  return SimdLevel::NEON;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+SimdLevel GetSimdLevel() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+std::string ToString(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::NEON: return "NEON";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    default: return "scalar";
+  }
+}
+
+/// @brief Return a level, or the best supported level if it is not supported.
+static SimdLevel Clamp(SimdLevel level) {
+  auto best = GetSimdLevel();
+  return static_cast<int>(level) <= static_cast<int>(best) ? level : best;
+}
+
+// Every vectorized function processes as many whole vectors as possible and returns the number of elements it
+// processed. The remaining elements are processed by the scalar code of the caller.
+
+#if defined(FLETCHER_STAGING_X86)
+
+__attribute__((target("avx2")))
+static int64_t RebaseAvx2(const int32_t *src, int64_t count, int32_t base, int32_t *dst) {
+  auto b = _mm256_set1_epi32(base);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_sub_epi32(v, b));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static int64_t RebaseAvx2(const int64_t *src, int64_t count, int64_t base, int64_t *dst) {
+  auto b = _mm256_set1_epi64x(base);
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_sub_epi64(v, b));
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static int64_t NarrowAvx2(const int64_t *src, int64_t count, int64_t base, int32_t *dst) {
+  auto b = _mm256_set1_epi64x(base);
+  // Gather the lower halves of the four 64-bit lanes in the lower 128 bits.
+  auto lower = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto v = _mm256_sub_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)), b);
+    auto packed = _mm256_permutevar8x32_epi32(v, lower);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_castsi256_si128(packed));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+static int64_t RebaseAvx512(const int32_t *src, int64_t count, int32_t base, int32_t *dst) {
+  auto b = _mm512_set1_epi32(base);
+  int64_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    _mm512_storeu_si512(dst + i, _mm512_sub_epi32(_mm512_loadu_si512(src + i), b));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+static int64_t RebaseAvx512(const int64_t *src, int64_t count, int64_t base, int64_t *dst) {
+  auto b = _mm512_set1_epi64(base);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm512_storeu_si512(dst + i, _mm512_sub_epi64(_mm512_loadu_si512(src + i), b));
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+static int64_t NarrowAvx512(const int64_t *src, int64_t count, int64_t base, int32_t *dst) {
+  auto b = _mm512_set1_epi64(base);
+  int64_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    auto v = _mm512_sub_epi64(_mm512_loadu_si512(src + i), b);
+    auto narrowed = _mm512_mask_cvtepi64_epi32(_mm256_setzero_si256(), 0xFF, v);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), narrowed);
+  }
+  return i;
+}
+
+#endif  // FLETCHER_STAGING_X86
+
+#if defined(FLETCHER_STAGING_NEON)
+
+static int64_t RebaseNeon(const int32_t *src, int64_t count, int32_t base, int32_t *dst) {
+  auto b = vdupq_n_s32(base);
+  int64_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    vst1q_s32(dst + i, vsubq_s32(vld1q_s32(src + i), b));
+  }
+  return i;
+}
+
+static int64_t RebaseNeon(const int64_t *src, int64_t count, int64_t base, int64_t *dst) {
+  auto b = vdupq_n_s64(base);
+  int64_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    vst1q_s64(dst + i, vsubq_s64(vld1q_s64(src + i), b));
+  }
+  return i;
+}
+
+static int64_t NarrowNeon(const int64_t *src, int64_t count, int64_t base, int32_t *dst) {
+  auto b = vdupq_n_s64(base);
+  int64_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    vst1_s32(dst + i, vmovn_s64(vsubq_s64(vld1q_s64(src + i), b)));
+  }
+  return i;
+}
+
+#endif  // FLETCHER_STAGING_NEON
+
+void StageValidity(int64_t length, uint8_t *dst) {
+  if (length > 0) {
+    std::memset(dst, 0xFF, static_cast<size_t>((length + 7) / 8));
+  }
+}
+
+void StageOffsets(const int32_t *src, int64_t count, bool rebase, int32_t *dst, SimdLevel level) {
+  if (count <= 0) {
+    return;
+  }
+  int32_t base = rebase ? src[0] : 0;
+  int64_t i = 0;
+  switch (Clamp(level)) {
+#if defined(FLETCHER_STAGING_X86)
+    case SimdLevel::AVX512: i = RebaseAvx512(src, count, base, dst);
+      break;
+    case SimdLevel::AVX2: i = RebaseAvx2(src, count, base, dst);
+      break;
+#elif defined(FLETCHER_STAGING_NEON)
+    case SimdLevel::NEON: i = RebaseNeon(src, count, base, dst);
+      break;
+#endif
+    default: break;
+  }
+  for (; i < count; i++) {
+    dst[i] = src[i] - base;
+  }
+}
+
+void StageOffsets(const int64_t *src, int64_t count, bool rebase, int64_t *dst, SimdLevel level) {
+  if (count <= 0) {
+    return;
+  }
+  int64_t base = rebase ? src[0] : 0;
+  int64_t i = 0;
+  switch (Clamp(level)) {
+#if defined(FLETCHER_STAGING_X86)
+    case SimdLevel::AVX512: i = RebaseAvx512(src, count, base, dst);
+      break;
+    case SimdLevel::AVX2: i = RebaseAvx2(src, count, base, dst);
+      break;
+#elif defined(FLETCHER_STAGING_NEON)
+    case SimdLevel::NEON: i = RebaseNeon(src, count, base, dst);
+      break;
+#endif
+    default: break;
+  }
+  for (; i < count; i++) {
+    dst[i] = src[i] - base;
+  }
+}
+
+bool StageOffsets(const int64_t *src, int64_t count, bool rebase, int32_t *dst, SimdLevel level) {
+  if (count <= 0) {
+    return true;
+  }
+  int64_t base = rebase ? src[0] : 0;
+  if ((src[0] - base < std::numeric_limits<int32_t>::min())
+      || (src[count - 1] - base > std::numeric_limits<int32_t>::max())) {
+    return false;
+  }
+  int64_t i = 0;
+  switch (Clamp(level)) {
+#if defined(FLETCHER_STAGING_X86)
+    case SimdLevel::AVX512: i = NarrowAvx512(src, count, base, dst);
+      break;
+    case SimdLevel::AVX2: i = NarrowAvx2(src, count, base, dst);
+      break;
+#elif defined(FLETCHER_STAGING_NEON)
+    case SimdLevel::NEON: i = NarrowNeon(src, count, base, dst);
+      break;
+#endif
+    default: break;
+  }
+  for (; i < count; i++) {
+    dst[i] = static_cast<int32_t>(src[i] - base);
+  }
+  return true;
+}
+
+namespace {
+
+/**
+ * @brief Stages the buffers of the fields of a RecordBatch.
+ *
+ * Walks the type of a field in the order in which the RecordBatchAnalyzer describes its buffers. Every array is
+ * visited with the range of its elements that is covered, relative to the element the kernel addresses as element
+ * zero, and the number of elements by which the elements are shifted because offsets indexing them were rebased.
+ */
+class Stager {
+ public:
+  /// @brief Construct a Stager that stages to dst, or that only determines the size if dst is nullptr.
+  Stager(const StagingOptions &options, uint8_t *dst, int64_t capacity)
+      : options_(options), dst_(dst), capacity_(capacity) {}
+
+  /// @brief Stage the buffers of a field.
+  bool Field(const FieldMetadata &field, std::vector<BufferMetadata> *out) {
+    in_ = &field.buffers;
+    next_ = 0;
+    out_ = out;
+    return Array(*field.type_, 1, 0, field.length, 0) && (next_ == in_->size());
+  }
+
+  /// @brief Return the number of bytes of the staging buffer that were used.
+  int64_t used() const { return used_; }
+
+ private:
+  /// @brief Return the next buffer to stage, or nullptr if all buffers were staged.
+  const BufferMetadata *Peek() const { return next_ < in_->size() ? &(*in_)[next_] : nullptr; }
+
+  /// @brief Reserve an aligned region of the staging buffer.
+  bool Reserve(int64_t size, uint8_t **ptr) {
+    auto pos = (used_ + kStagingAlignment - 1) / kStagingAlignment * kStagingAlignment;
+    if ((dst_ != nullptr) && (pos + size > capacity_)) {
+      return false;
+    }
+    *ptr = dst_ != nullptr ? dst_ + pos : nullptr;
+    used_ = pos + size;
+    return true;
+  }
+
+  /// @brief Return the device offset of a buffer after shifting its elements, or false if it is no whole byte.
+  static bool Shift(int64_t device_offset, int64_t bits, int64_t shift, int64_t *out) {
+    auto offset_bits = device_offset * 8 - shift * bits;
+    if (offset_bits % 8 != 0) {
+      return false;
+    }
+    *out = offset_bits / 8;
+    return true;
+  }
+
+  /// @brief Copy a buffer of elements of some bit width.
+  bool Copy(int64_t bits, int64_t shift) {
+    if (Peek() == nullptr) {
+      return false;
+    }
+    auto staged = (*in_)[next_++];
+    if (!Shift(staged.device_offset_, bits, shift, &staged.device_offset_)) {
+      return false;
+    }
+    uint8_t *ptr = nullptr;
+    if (staged.size_ > 0) {
+      if (!Reserve(staged.size_, &ptr)) {
+        return false;
+      }
+      if (ptr != nullptr) {
+        std::memcpy(ptr, staged.raw_buffer_, static_cast<size_t>(staged.size_));
+      }
+    }
+    staged.raw_buffer_ = ptr;
+    out_->push_back(staged);
+    return true;
+  }
+
+  /// @brief Stage a validity bitmap, materializing it if it is implicit.
+  bool Validity(int64_t lo, int64_t hi, int64_t shift) {
+    const auto &b = (*in_)[next_];
+    if (!b.implicit_) {
+      return Copy(1, shift);
+    }
+    next_++;
+    auto staged = b;
+    if (options_.materialize_validity) {
+      // All bits are set, so the bitmap may start at the byte holding the first covered element.
+      auto first = (lo - shift) / 8;
+      auto last = std::max(first, (hi - shift + 7) / 8);
+      uint8_t *ptr = nullptr;
+      if (!Reserve(last - first, &ptr)) {
+        return false;
+      }
+      if (ptr != nullptr) {
+        StageValidity(8 * (last - first), ptr);
+      }
+      staged.raw_buffer_ = ptr;
+      staged.size_ = last - first;
+      staged.device_offset_ = first;
+      staged.implicit_ = false;
+    }
+    out_->push_back(staged);
+    return true;
+  }
+
+  /// @brief Stage an offsets buffer, and return the first and last offset it holds and the base subtracted from them.
+  bool Offsets(bool large, int64_t shift, int64_t *first, int64_t *last, int64_t *base) {
+    if (Peek() == nullptr) {
+      return false;
+    }
+    auto staged = (*in_)[next_++];
+    int64_t in_width = large ? 8 : 4;
+    bool narrow = large && options_.narrow_offsets;
+    int64_t out_width = narrow ? 4 : in_width;
+    auto count = staged.size_ / in_width;
+    *first = 0;
+    *last = 0;
+    if (count > 0) {
+      if (large) {
+        *first = reinterpret_cast<const int64_t *>(staged.raw_buffer_)[0];
+        *last = reinterpret_cast<const int64_t *>(staged.raw_buffer_)[count - 1];
+      } else {
+        *first = reinterpret_cast<const int32_t *>(staged.raw_buffer_)[0];
+        *last = reinterpret_cast<const int32_t *>(staged.raw_buffer_)[count - 1];
+      }
+    }
+    *base = options_.rebase_offsets ? *first : 0;
+    if (narrow && ((*first - *base < std::numeric_limits<int32_t>::min())
+        || (*last - *base > std::numeric_limits<int32_t>::max()))) {
+      return false;
+    }
+    if (staged.device_offset_ % in_width != 0) {
+      return false;
+    }
+    staged.device_offset_ = (staged.device_offset_ / in_width - shift) * out_width;
+    staged.size_ = count * out_width;
+    uint8_t *ptr = nullptr;
+    if (count > 0) {
+      if (!Reserve(staged.size_, &ptr)) {
+        return false;
+      }
+      if ((ptr != nullptr) && !large) {
+        StageOffsets(reinterpret_cast<const int32_t *>(staged.raw_buffer_), count, options_.rebase_offsets,
+                     reinterpret_cast<int32_t *>(ptr));
+      } else if ((ptr != nullptr) && narrow) {
+        StageOffsets(reinterpret_cast<const int64_t *>(staged.raw_buffer_), count, options_.rebase_offsets,
+                     reinterpret_cast<int32_t *>(ptr));
+      } else if (ptr != nullptr) {
+        StageOffsets(reinterpret_cast<const int64_t *>(staged.raw_buffer_), count, options_.rebase_offsets,
+                     reinterpret_cast<int64_t *>(ptr));
+      }
+    }
+    staged.raw_buffer_ = ptr;
+    out_->push_back(staged);
+    return true;
+  }
+
+  /**
+   * @brief Stage the buffers of an array.
+   * @param type   The type of the array.
+   * @param depth  The number of names in the descriptions of the buffers of the array, excluding the buffer name.
+   * @param lo     The first covered element.
+   * @param hi     The element after the last covered element.
+   * @param shift  The number of elements by which the elements are shifted.
+   */
+  bool Array(const arrow::DataType &type, size_t depth, int64_t lo, int64_t hi, int64_t shift) {
+    // The validity bitmap of a nullable array comes first. Bitmaps of children are named after the children.
+    auto b = Peek();
+    if ((b != nullptr) && (b->desc_.size() == depth + 1) && (b->desc_.back() == "validity")) {
+      if (!Validity(lo, hi, shift)) {
+        return false;
+      }
+    }
+    int64_t first = 0;
+    int64_t last = 0;
+    int64_t base = 0;
+    switch (type.id()) {
+      case arrow::Type::DICTIONARY: {
+        // The indices address the whole dictionary, which is not shifted.
+        const auto &dict = static_cast<const arrow::DictionaryType &>(type);
+        const auto &index = static_cast<const arrow::FixedWidthType &>(*dict.index_type());
+        return Copy(index.bit_width(), shift) && Array(*dict.value_type(), depth + 1, 0, 0, 0);
+      }
+      case arrow::Type::STRING:
+      case arrow::Type::BINARY:
+        return Offsets(false, shift, &first, &last, &base) && Copy(8, base);
+      case arrow::Type::LARGE_STRING:
+      case arrow::Type::LARGE_BINARY:
+        return Offsets(true, shift, &first, &last, &base) && Copy(8, base);
+      case arrow::Type::LIST:
+        return Offsets(false, shift, &first, &last, &base)
+            && Array(*type.field(0)->type(), depth, first, last, base);
+      case arrow::Type::LARGE_LIST:
+        return Offsets(true, shift, &first, &last, &base)
+            && Array(*type.field(0)->type(), depth, first, last, base);
+      case arrow::Type::STRUCT:
+        for (const auto &child : type.fields()) {
+          if (!Array(*child->type(), depth + 1, lo, hi, shift)) {
+            return false;
+          }
+        }
+        return true;
+      default: {
+        // The run ends of a run-end encoded array come before its values, which hold one element per run.
+        auto fixed = dynamic_cast<const arrow::FixedWidthType *>(&type);
+        b = Peek();
+        if ((b != nullptr) && (b->desc_.size() == depth + 1) && (b->desc_.back() == "run_ends")) {
+          return (fixed != nullptr) && (shift == 0) && Copy(32, 0) && Copy(fixed->bit_width(), 0);
+        }
+        return (fixed != nullptr) && Copy(fixed->bit_width(), shift);
+      }
+    }
+  }
+
+  const StagingOptions &options_;
+  uint8_t *dst_;
+  int64_t capacity_;
+  int64_t used_ = 0;
+  const std::vector<BufferMetadata> *in_ = nullptr;
+  size_t next_ = 0;
+  std::vector<BufferMetadata> *out_ = nullptr;
+};
+
+/// @brief Stage a RecordBatch, or determine the size of the staging buffer if dst is nullptr.
+bool Stage(const RecordBatchDescription &desc,
+           const StagingOptions &options,
+           uint8_t *dst,
+           int64_t capacity,
+           RecordBatchDescription *out,
+           int64_t *used) {
+  Stager stager(options, dst, capacity);
+  auto result = desc;
+  result.fields.clear();
+  for (const auto &f : desc.fields) {
+    result.fields.emplace_back(f.type_, f.length, f.null_count);
+    if (!stager.Field(f, &result.fields.back().buffers)) {
+      return false;
+    }
+  }
+  if (out != nullptr) {
+    *out = result;
+  }
+  *used = stager.used();
+  return true;
+}
+
+}  // namespace
+
+int64_t StagedSize(const RecordBatchDescription &desc, const StagingOptions &options) {
+  int64_t used = 0;
+  return Stage(desc, options, nullptr, 0, nullptr, &used) ? used : -1;
+}
+
+bool StageRecordBatch(const RecordBatchDescription &desc,
+                      const StagingOptions &options,
+                      uint8_t *dst,
+                      int64_t capacity,
+                      RecordBatchDescription *out) {
+  int64_t used = 0;
+  return Stage(desc, options, dst, capacity, out, &used);
+}
+
+}  // namespace fletcher
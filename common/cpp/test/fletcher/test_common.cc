@@ -18,6 +18,8 @@
 
 #include <vector>
 #include <string>
+#include <cstdio>
+#include <fstream>
 
 #include "fletcher/test_schemas.h"
 #include "fletcher/test_recordbatches.h"
@@ -33,6 +35,350 @@ TEST(Common, AppendMetaRequired) {
   ASSERT_EQ(map.at("fletcher_mode"), "read");
 }
 
+TEST(Common, SchemaHash) {
+  auto a = arrow::schema({arrow::field("number", arrow::int64(), false),
+                          arrow::field("name", arrow::list(arrow::field("char", arrow::uint8(), false)))});
+  auto b = arrow::schema({arrow::field("x", arrow::int64(), false),
+                          arrow::field("y", arrow::list(arrow::field("z", arrow::uint8(), false)))});
+  auto a_read = fletcher::WithMetaRequired(*a, "A", fletcher::Mode::READ);
+  auto b_read = fletcher::WithMetaRequired(*b, "B", fletcher::Mode::READ);
+  auto a_write = fletcher::WithMetaRequired(*a, "A", fletcher::Mode::WRITE);
+  // Names and metadata other than the mode are not taken into account.
+  ASSERT_EQ(fletcher::SchemaHash(*a_read), fletcher::SchemaHash(*b_read));
+  ASSERT_EQ(fletcher::SchemaHash(*a_read), fletcher::SchemaHash(*a));
+  ASSERT_NE(fletcher::SchemaHash(*a_read), fletcher::SchemaHash(*a_write));
+  // Types and nullability are.
+  auto c = arrow::schema({arrow::field("number", arrow::int32(), false),
+                          arrow::field("name", arrow::list(arrow::field("char", arrow::uint8(), false)))});
+  auto d = arrow::schema({arrow::field("number", arrow::int64(), true),
+                          arrow::field("name", arrow::list(arrow::field("char", arrow::uint8(), false)))});
+  ASSERT_NE(fletcher::SchemaHash(*a), fletcher::SchemaHash(*c));
+  ASSERT_NE(fletcher::SchemaHash(*a), fletcher::SchemaHash(*d));
+  auto f = arrow::schema({fletcher::WithMetaCompression(*a->field(0)), a->field(1)});
+  ASSERT_NE(fletcher::SchemaHash(*a), fletcher::SchemaHash(*f));
+  // Ignored fields do not result in hardware.
+  auto e = a->AddField(2, fletcher::WithMetaIgnore(*arrow::field("extra", arrow::utf8()))).ValueOrDie();
+  ASSERT_EQ(fletcher::SchemaHash(*a), fletcher::SchemaHash(*e));
+  // The order of schemas in a set matters.
+  ASSERT_NE(fletcher::SchemaSetHash({a_read, a_write}), fletcher::SchemaSetHash({a_write, a_read}));
+  ASSERT_EQ(fletcher::SchemaSetHash({a_read, a_write}), fletcher::SchemaSetHash({b_read, a_write}));
+}
+
+TEST(Common, CompressedArray) {
+  // The uncompressed length of four uint32 values, followed by an LZ4 frame. Its contents are not checked.
+  std::vector<uint8_t> bytes = {16, 0, 0, 0, 0, 0, 0, 0, 0x04, 0x22, 0x4D, 0x18, 0x60, 0x40, 0x82, 0, 0, 0, 0};
+  auto buffer = std::make_shared<arrow::Buffer>(bytes.data(), bytes.size());
+  ASSERT_EQ(fletcher::GetUncompressedLength(*buffer), 16);
+  std::shared_ptr<arrow::Array> array;
+  ASSERT_TRUE(fletcher::MakeCompressedArray(arrow::uint32(), 4, buffer, &array));
+  ASSERT_EQ(array->length(), 4);
+  ASSERT_EQ(array->data()->buffers[1]->size(), static_cast<int64_t>(bytes.size()));
+  // The uncompressed length must match the number of values.
+  ASSERT_FALSE(fletcher::MakeCompressedArray(arrow::uint32(), 5, buffer, &array));
+  ASSERT_FALSE(fletcher::MakeCompressedArray(arrow::boolean(), 128, buffer, &array));
+  auto field = fletcher::WithMetaCompression(*arrow::field("a", arrow::uint32(), false));
+  ASSERT_EQ(fletcher::GetMeta(*field, fletcher::meta::COMPRESSION), fletcher::meta::LZ4);
+}
+
+TEST(Common, RunEndEncodedArray) {
+  arrow::Int32Builder ib;
+  ASSERT_TRUE(ib.AppendValues({5, 5, 5, 7, 7, 1}).ok());
+  std::shared_ptr<arrow::Array> plain;
+  ASSERT_TRUE(ib.Finish(&plain).ok());
+  std::shared_ptr<arrow::Array> array;
+  ASSERT_TRUE(fletcher::RunEndEncode(plain, &array));
+  ASSERT_EQ(array->length(), 6);
+  auto values = reinterpret_cast<const int32_t *>(array->data()->buffers[1]->data());
+  auto run_ends = reinterpret_cast<const int32_t *>(array->data()->buffers[2]->data());
+  ASSERT_EQ(values[0], 5);
+  ASSERT_EQ(values[1], 7);
+  ASSERT_EQ(values[2], 1);
+  ASSERT_EQ(run_ends[0], 3);
+  ASSERT_EQ(run_ends[1], 5);
+  ASSERT_EQ(run_ends[2], 6);
+
+  // Run ends must be strictly increasing, and there must be one for every value.
+  std::shared_ptr<arrow::Array> ends;
+  ASSERT_TRUE(ib.AppendValues({3, 3, 6}).ok());
+  ASSERT_TRUE(ib.Finish(&ends).ok());
+  auto run_values = plain->Slice(0, 3);
+  ASSERT_FALSE(fletcher::MakeRunEndEncodedArray(run_values, std::static_pointer_cast<arrow::Int32Array>(ends), &array));
+  ASSERT_TRUE(ib.AppendValues({3, 5}).ok());
+  ASSERT_TRUE(ib.Finish(&ends).ok());
+  ASSERT_FALSE(fletcher::MakeRunEndEncodedArray(run_values, std::static_pointer_cast<arrow::Int32Array>(ends), &array));
+
+  // The run ends precede the values, and both are described as a whole.
+  auto field = fletcher::WithMetaRunEndEncoding(*arrow::field("a", arrow::int32(), false));
+  ASSERT_EQ(fletcher::GetMeta(*field, fletcher::meta::ENCODING), fletcher::meta::RUN_END);
+  ASSERT_NE(fletcher::SchemaHash(*arrow::schema({field})),
+            fletcher::SchemaHash(*arrow::schema({arrow::field("a", arrow::int32(), false)})));
+  ASSERT_TRUE(fletcher::RunEndEncode(plain, &array));
+  auto batch = arrow::RecordBatch::Make(arrow::schema({field}), 6, {array});
+  fletcher::RecordBatchDescription desc;
+  fletcher::RecordBatchAnalyzer rba(&desc);
+  ASSERT_TRUE(rba.Analyze(*batch));
+  const auto &buffers = desc.fields[0].buffers;
+  ASSERT_EQ(buffers.size(), 2);
+  ASSERT_EQ(buffers[0].desc_.back(), "run_ends");
+  ASSERT_EQ(buffers[0].size_, 3 * static_cast<int64_t>(sizeof(int32_t)));
+  ASSERT_EQ(buffers[1].desc_.back(), "values");
+  ASSERT_EQ(buffers[1].size_, 3 * static_cast<int64_t>(sizeof(int32_t)));
+}
+
+TEST(Common, ParquetPageArray) {
+  // A data page of five nullable int32 values, of which the second and fifth are null. The definition levels are a
+  // single bit-packed group, followed by the three non-null values.
+  std::vector<uint8_t> bytes = {2, 0, 0, 0, 3, 0x0D, 10, 0, 0, 0, 30, 0, 0, 0, 40, 0, 0, 0};
+  auto page = std::make_shared<arrow::Buffer>(bytes.data(), bytes.size());
+  ASSERT_EQ(fletcher::GetParquetPageValueCount(*page, 32, true), 3);
+  ASSERT_EQ(fletcher::GetParquetPageValueCount(*page, 64, true), -1);
+  std::shared_ptr<arrow::Array> array;
+  ASSERT_TRUE(fletcher::MakeParquetPageArray(arrow::int32(), 5, true, page, &array));
+  ASSERT_EQ(array->length(), 5);
+  ASSERT_EQ(array->null_count(), 2);
+  // The page must hold the values of all non-null elements, and non-nullable pages hold no levels.
+  ASSERT_FALSE(fletcher::MakeParquetPageArray(arrow::int32(), 2, true, page, &array));
+  ASSERT_FALSE(fletcher::MakeParquetPageArray(arrow::int32(), 5, false, page, &array));
+  ASSERT_FALSE(fletcher::MakeParquetPageArray(arrow::int16(), 5, true, page, &array));
+
+  // The page is described as a whole, without a validity bitmap.
+  auto field = fletcher::WithMetaParquetEncoding(*arrow::field("a", arrow::int32(), true));
+  ASSERT_EQ(fletcher::GetMeta(*field, fletcher::meta::ENCODING), fletcher::meta::PARQUET);
+  ASSERT_NE(fletcher::SchemaHash(*arrow::schema({field})),
+            fletcher::SchemaHash(*arrow::schema({arrow::field("a", arrow::int32(), true)})));
+  ASSERT_TRUE(fletcher::MakeParquetPageArray(arrow::int32(), 5, true, page, &array));
+  auto batch = arrow::RecordBatch::Make(arrow::schema({field}), 5, {array});
+  fletcher::RecordBatchDescription desc;
+  fletcher::RecordBatchAnalyzer rba(&desc);
+  ASSERT_TRUE(rba.Analyze(*batch));
+  const auto &buffers = desc.fields[0].buffers;
+  ASSERT_EQ(buffers.size(), 1);
+  ASSERT_EQ(buffers[0].desc_.back(), "values");
+  ASSERT_EQ(buffers[0].size_, static_cast<int64_t>(bytes.size()));
+}
+
+TEST(Common, SplitParallelFields) {
+  auto schema = fletcher::GetParallelListStructSchema();
+  std::shared_ptr<arrow::Schema> split;
+  ASSERT_TRUE(fletcher::SplitParallelFields(schema, &split));
+  ASSERT_EQ(split->num_fields(), 2);
+  ASSERT_EQ(split->field(0)->name(), "points_x");
+  ASSERT_TRUE(split->field(0)->type()->Equals(arrow::list(arrow::field("x", arrow::int32(), false))));
+  ASSERT_EQ(split->field(1)->name(), "points_label");
+  ASSERT_FALSE(fletcher::GetBoolMeta(*split->field(1), fletcher::meta::PARALLEL, false));
+  // Schemas without parallel fields are not copied.
+  std::shared_ptr<arrow::Schema> same;
+  ASSERT_TRUE(fletcher::SplitParallelFields(split, &same));
+  ASSERT_EQ(same, split);
+  // Only lists of non-nullable structs can be split.
+  auto invalid = arrow::schema({fletcher::WithMetaParallel(*arrow::field("a", arrow::list(arrow::int32()), false))});
+  ASSERT_FALSE(fletcher::SplitParallelFields(invalid, &same));
+
+  // The split arrays share the buffers of the list array and its struct array.
+  arrow::Int32Builder xb;
+  arrow::StringBuilder lb;
+  ASSERT_TRUE(xb.AppendValues({1, 2, 3}).ok());
+  ASSERT_TRUE(lb.AppendValues({"a", "bc", "def"}).ok());
+  std::shared_ptr<arrow::Array> x, label, offsets;
+  ASSERT_TRUE(xb.Finish(&x).ok());
+  ASSERT_TRUE(lb.Finish(&label).ok());
+  auto values = std::make_shared<arrow::StructArray>(schema->field(0)->type()->field(0)->type(), 3,
+                                                     arrow::ArrayVector{x, label});
+  arrow::Int32Builder ob;
+  ASSERT_TRUE(ob.AppendValues({0, 1, 3}).ok());
+  ASSERT_TRUE(ob.Finish(&offsets).ok());
+  auto list = arrow::ListArray::FromArrays(*offsets, *values).ValueOrDie();
+  auto batch = arrow::RecordBatch::Make(schema, 2, {list});
+  std::shared_ptr<arrow::RecordBatch> split_batch;
+  ASSERT_TRUE(fletcher::SplitParallelFields(batch, &split_batch));
+  ASSERT_TRUE(split_batch->schema()->Equals(*split));
+  auto points_label = std::static_pointer_cast<arrow::ListArray>(split_batch->column(1));
+  ASSERT_EQ(points_label->value_offsets(), list->value_offsets());
+  ASSERT_EQ(points_label->value_length(1), 2);
+  ASSERT_TRUE(points_label->values()->Equals(label));
+  ASSERT_TRUE(split_batch->ValidateFull().ok());
+}
+
+TEST(Common, PartitionSchemas) {
+  std::vector<std::shared_ptr<arrow::Schema>> partitions;
+  ASSERT_TRUE(fletcher::PartitionSchemas(fletcher::GetPartitionedWriteSchema(), &partitions));
+  ASSERT_EQ(partitions.size(), 4);
+  for (size_t p = 0; p < partitions.size(); p++) {
+    ASSERT_EQ(fletcher::GetMeta(*partitions[p], fletcher::meta::NAME), "Shuffle_p" + std::to_string(p));
+    ASSERT_EQ(fletcher::GetMeta(*partitions[p], fletcher::meta::PARTITION), std::to_string(p));
+    ASSERT_TRUE(fletcher::GetMeta(*partitions[p], fletcher::meta::PARTITIONS).empty());
+    ASSERT_EQ(fletcher::GetMode(*partitions[p]), fletcher::Mode::WRITE);
+    ASSERT_EQ(partitions[p]->num_fields(), 2);
+  }
+  // Schemas without partitioning metadata are not expanded.
+  ASSERT_TRUE(fletcher::PartitionSchemas(partitions[0], &partitions));
+  ASSERT_EQ(partitions.size(), 1);
+  // The key must be a non-nullable integer field.
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("s", arrow::utf8(), false)}),
+                                           "Invalid",
+                                           fletcher::Mode::WRITE);
+  ASSERT_FALSE(fletcher::PartitionSchemas(fletcher::WithMetaPartitions(*schema, 2, "s"), &partitions));
+  ASSERT_FALSE(fletcher::PartitionSchemas(fletcher::WithMetaPartitions(*schema, 2, "t"), &partitions));
+  ASSERT_FALSE(fletcher::PartitionSchemas(fletcher::WithMetaPartitions(*schema, 0, "s"), &partitions));
+}
+
+TEST(Common, PartitionOf) {
+  // Every partition receives a fair share of consecutive keys.
+  std::vector<size_t> rows(5, 0);
+  for (uint64_t key = 0; key < 5000; key++) {
+    auto p = fletcher::PartitionOf(key, 5);
+    ASSERT_LT(p, 5);
+    rows[p]++;
+  }
+  for (auto r : rows) {
+    ASSERT_GT(r, 800);
+    ASSERT_LT(r, 1200);
+  }
+  ASSERT_EQ(fletcher::PartitionOf(0x123456789, 1), 0);
+  // The key is folded, so the upper and lower halves contribute equally.
+  ASSERT_EQ(fletcher::PartitionOf(0x0000000100000000, 16), fletcher::PartitionOf(1, 16));
+}
+
+TEST(Common, StageOffsets) {
+  std::vector<int64_t> offsets(37);
+  for (size_t i = 0; i < offsets.size(); i++) {
+    offsets[i] = (int64_t(1) << 33) + 3 * static_cast<int64_t>(i);
+  }
+  // Every instruction set extension gives the same result, unsupported ones fall back to the best supported one.
+  for (auto level : {fletcher::SimdLevel::SCALAR, fletcher::SimdLevel::NEON, fletcher::SimdLevel::AVX2,
+                     fletcher::SimdLevel::AVX512}) {
+    std::vector<int64_t> wide(offsets.size());
+    fletcher::StageOffsets(offsets.data(), 37, true, wide.data(), level);
+    std::vector<int32_t> narrow(offsets.size() + 1, -1);
+    ASSERT_TRUE(fletcher::StageOffsets(offsets.data(), 37, true, narrow.data(), level));
+    for (size_t i = 0; i < offsets.size(); i++) {
+      ASSERT_EQ(wide[i], 3 * static_cast<int64_t>(i));
+      ASSERT_EQ(narrow[i], 3 * static_cast<int32_t>(i));
+    }
+    ASSERT_EQ(narrow.back(), -1);
+    // Without rebasing, the offsets do not fit in 32 bits.
+    ASSERT_FALSE(fletcher::StageOffsets(offsets.data(), 37, false, narrow.data(), level));
+  }
+}
+
+TEST(Common, StageRecordBatch) {
+  auto schema = arrow::schema({arrow::field("s", arrow::utf8(), true),
+                               arrow::field("l", arrow::list(arrow::field("item", arrow::int32(), false)), false),
+                               arrow::field("ls", arrow::large_utf8(), false)});
+  arrow::StringBuilder sb;
+  ASSERT_TRUE(sb.AppendValues({"a", "bb", "ccc", "dddd", "eeeee"}).ok());
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(sb.Finish(&s).ok());
+  auto ib = std::make_shared<arrow::Int32Builder>();
+  arrow::ListBuilder lb(arrow::default_memory_pool(), ib, schema->field(1)->type());
+  for (const auto &list : std::vector<std::vector<int32_t>>{{1}, {2, 3}, {4, 5, 6}, {7}, {8, 9}}) {
+    ASSERT_TRUE(lb.Append().ok());
+    ASSERT_TRUE(ib->AppendValues(list).ok());
+  }
+  std::shared_ptr<arrow::Array> l;
+  ASSERT_TRUE(lb.Finish(&l).ok());
+  arrow::LargeStringBuilder lsb;
+  ASSERT_TRUE(lsb.AppendValues({"v", "w", "x", "yy", "z"}).ok());
+  std::shared_ptr<arrow::Array> ls;
+  ASSERT_TRUE(lsb.Finish(&ls).ok());
+  auto batch = arrow::RecordBatch::Make(schema, 5, {s, l, ls})->Slice(2, 2);
+
+  fletcher::RecordBatchDescription desc;
+  fletcher::RecordBatchAnalyzer rba(&desc);
+  ASSERT_TRUE(rba.Analyze(*batch));
+  fletcher::StagingOptions options;
+  options.materialize_validity = true;
+  options.rebase_offsets = true;
+  options.narrow_offsets = true;
+  auto size = fletcher::StagedSize(desc, options);
+  ASSERT_GT(size, 0);
+  std::vector<uint8_t> staging(static_cast<size_t>(size));
+  fletcher::RecordBatchDescription staged;
+  ASSERT_FALSE(fletcher::StageRecordBatch(desc, options, staging.data(), size - 1, &staged));
+  ASSERT_TRUE(fletcher::StageRecordBatch(desc, options, staging.data(), size, &staged));
+  ASSERT_EQ(staged.fields.size(), 3);
+  for (const auto &f : staged.fields) {
+    for (const auto &b : f.buffers) {
+      ASSERT_EQ((b.raw_buffer_ - staging.data()) % fletcher::kStagingAlignment, 0);
+    }
+  }
+
+  // The validity bitmap of the strings is materialized, and the values are addressed from the first string.
+  const auto &sbufs = staged.fields[0].buffers;
+  ASSERT_EQ(sbufs.size(), 3);
+  ASSERT_FALSE(sbufs[0].implicit_);
+  ASSERT_EQ(sbufs[0].size_, 1);
+  ASSERT_EQ(sbufs[0].raw_buffer_[0], 0xFF);
+  auto soffsets = reinterpret_cast<const int32_t *>(sbufs[1].raw_buffer_);
+  ASSERT_EQ(soffsets[0], 0);
+  ASSERT_EQ(soffsets[1], 3);
+  ASSERT_EQ(soffsets[2], 7);
+  ASSERT_EQ(sbufs[2].device_offset_, 0);
+  ASSERT_EQ(std::string(reinterpret_cast<const char *>(sbufs[2].raw_buffer_), 7), "cccdddd");
+
+  // The list elements are addressed from the first element of the first list.
+  const auto &lbufs = staged.fields[1].buffers;
+  ASSERT_EQ(lbufs.size(), 2);
+  auto loffsets = reinterpret_cast<const int32_t *>(lbufs[0].raw_buffer_);
+  ASSERT_EQ(loffsets[0], 0);
+  ASSERT_EQ(loffsets[2], 4);
+  ASSERT_EQ(lbufs[1].device_offset_, 0);
+  ASSERT_EQ(reinterpret_cast<const int32_t *>(lbufs[1].raw_buffer_)[0], 4);
+
+  // The 64-bit offsets are narrowed.
+  const auto &lsbufs = staged.fields[2].buffers;
+  ASSERT_EQ(lsbufs[0].size_, 3 * static_cast<int64_t>(sizeof(int32_t)));
+  ASSERT_EQ(reinterpret_cast<const int32_t *>(lsbufs[0].raw_buffer_)[2], 3);
+
+  // Without rebasing, the buffers are copied as they are.
+  options.rebase_offsets = false;
+  size = fletcher::StagedSize(desc, options);
+  staging.resize(static_cast<size_t>(size));
+  ASSERT_TRUE(fletcher::StageRecordBatch(desc, options, staging.data(), size, &staged));
+  ASSERT_EQ(reinterpret_cast<const int32_t *>(staged.fields[0].buffers[1].raw_buffer_)[0], 3);
+  ASSERT_EQ(staged.fields[0].buffers[2].device_offset_, 3);
+}
+
+TEST(Common, GenerateRecordBatch) {
+  auto schema = arrow::schema({arrow::field("number", arrow::int32(), true),
+                               arrow::field("name", arrow::utf8(), false),
+                               arrow::field("nested", fletcher::NestedListType(arrow::uint8(), 3), false),
+                               arrow::field("point", arrow::struct_({arrow::field("x", arrow::float64(), false),
+                                                                     arrow::field("y", arrow::float64(), true)}))});
+  fletcher::GeneratorOptions options;
+  options.rows = 1000;
+  options.null_ratio = 0.5;
+  options.min_length = 2;
+  options.max_length = 8;
+  std::shared_ptr<arrow::RecordBatch> rb;
+  ASSERT_TRUE(fletcher::GenerateRecordBatch(schema, options, &rb));
+  ASSERT_TRUE(rb->ValidateFull().ok());
+  ASSERT_EQ(rb->num_rows(), 1000);
+  // Only nullable fields have nulls.
+  ASSERT_GT(rb->column(0)->null_count(), 300);
+  ASSERT_LT(rb->column(0)->null_count(), 700);
+  ASSERT_EQ(rb->column(1)->null_count(), 0);
+  auto names = std::static_pointer_cast<arrow::StringArray>(rb->column(1));
+  for (int64_t i = 0; i < names->length(); i++) {
+    ASSERT_GE(names->value_length(i), 2);
+    ASSERT_LE(names->value_length(i), 8);
+  }
+  // Equal options result in equal data.
+  std::shared_ptr<arrow::RecordBatch> again;
+  ASSERT_TRUE(fletcher::GenerateRecordBatch(schema, options, &again));
+  ASSERT_TRUE(rb->Equals(*again));
+  // Fixed lengths.
+  options.length_distribution = fletcher::LengthDistribution::FIXED;
+  ASSERT_TRUE(fletcher::GenerateRecordBatch(schema, options, &rb));
+  ASSERT_EQ(std::static_pointer_cast<arrow::StringArray>(rb->column(1))->value_length(0), 8);
+  fletcher::LengthDistribution d;
+  ASSERT_TRUE(fletcher::ParseLengthDistribution("zipf", &d));
+  ASSERT_EQ(d, fletcher::LengthDistribution::ZIPF);
+  ASSERT_FALSE(fletcher::ParseLengthDistribution("normal", &d));
+  // Unsupported types are rejected.
+  ASSERT_FALSE(fletcher::GenerateRecordBatch(arrow::schema({arrow::field("d", arrow::date32())}), options, &rb));
+}
+
 TEST(Common, RecordBatchFileRoundTrip) {
   auto rb_out = fletcher::GetStringRB();
   std::vector<std::shared_ptr<arrow::RecordBatch>> rbs_in;
@@ -42,6 +388,16 @@ TEST(Common, RecordBatchFileRoundTrip) {
   ASSERT_TRUE(rb_out->Equals(*rbs_in[0]));
 }
 
+TEST(Common, MapRecordBatchesFromFile) {
+  auto rb_out = fletcher::GetStringRB();
+  fletcher::WriteRecordBatchesToFile("test-common-map.rb", {rb_out});
+  std::vector<std::shared_ptr<arrow::RecordBatch>> rbs_in;
+  ASSERT_TRUE(fletcher::MapRecordBatchesFromFile("test-common-map.rb", &rbs_in));
+  ASSERT_EQ(rbs_in.size(), 1);
+  ASSERT_TRUE(rb_out->Equals(*rbs_in[0]));
+  ASSERT_FALSE(fletcher::MapRecordBatchesFromFile("does-not-exist.rb", &rbs_in));
+}
+
 TEST(Common, HexView) {
   fletcher::HexView hv0(0, 8);
   fletcher::HexView hv1(3, 16);
@@ -54,3 +410,37 @@ TEST(Common, HexView) {
   // Test without header and offset
   ASSERT_EQ(hv1.ToString(false), "0000000000000000          01 02 03 04                               ....         ");
 }
+
+TEST(Common, LogLevelFilter) {
+  int evaluated = 0;
+  auto message = [&]() {
+    evaluated++;
+    return std::string("message");
+  };
+  // Arguments of filtered messages are not evaluated.
+  fletcher::SetLogLevel(FLETCHER_LOG_WARNING);
+  FLETCHER_LOG(INFO, message());
+  ASSERT_EQ(evaluated, 0);
+  ASSERT_FALSE(fletcher::IsLoggingEnabled(FLETCHER_LOG_INFO));
+  FLETCHER_LOG(WARNING, message());
+  ASSERT_EQ(evaluated, 1);
+
+  fletcher::SetLogLevel(FLETCHER_LOG_DEBUG);
+  ASSERT_EQ(fletcher::GetLogLevel(), FLETCHER_LOG_DEBUG);
+  FLETCHER_LOG(DEBUG, message());
+  ASSERT_EQ(evaluated, FLETCHER_LOG_MIN_LEVEL <= FLETCHER_LOG_DEBUG ? 2 : 1);
+}
+
+#ifndef FLETCHER_USE_ARROW_LOGGING
+TEST(Common, AsyncLogging) {
+  std::remove("test-common.log");
+  ASSERT_TRUE(fletcher::StartAsyncLogging("test-common.log"));
+  FLETCHER_LOG(WARNING, "async " << 42);
+  fletcher::StopLogging();
+
+  std::ifstream file("test-common.log");
+  std::string line;
+  ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+  ASSERT_EQ(line, "[WARN ]: async 42");
+}
+#endif
@@ -102,6 +102,51 @@ inline std::shared_ptr<arrow::RecordBatch> GetListUint8RB() {
   return record_batch;
 }
 
+inline std::shared_ptr<arrow::RecordBatch> GetBoolRB() {
+  std::vector<bool> flags = {true, false, false, true, true, false, true, true, false, true};
+  arrow::BooleanBuilder builder;
+  THROW_NOT_OK(builder.AppendValues(flags));
+  std::shared_ptr<arrow::Array> array;
+  THROW_NOT_OK(builder.Finish(&array));
+  return arrow::RecordBatch::Make(GetBoolSchema(), flags.size(), {array});
+}
+
+inline std::shared_ptr<arrow::RecordBatch> GetFixedSizeListRB() {
+  std::vector<float> values = {0.0f, 0.1f, 0.2f, 0.3f, 1.0f, 1.1f, 1.2f, 1.3f, 2.0f, 2.1f, 2.2f, 2.3f};
+  auto vb = std::make_shared<arrow::FloatBuilder>();
+  arrow::FixedSizeListBuilder lb(arrow::default_memory_pool(), vb, 4);
+  THROW_NOT_OK(lb.AppendValues(3));
+  THROW_NOT_OK(vb->AppendValues(values));
+  std::shared_ptr<arrow::Array> array;
+  THROW_NOT_OK(lb.Finish(&array));
+  return arrow::RecordBatch::Make(GetFixedSizeListSchema(), 3, {array});
+}
+
+inline std::shared_ptr<arrow::RecordBatch> GetDictionaryRB() {
+  std::vector<uint8_t> indices = {2, 0, 0, 1, 2, 2};
+  std::vector<uint32_t> dictionary = {1337, 42, 31415};
+  arrow::UInt8Builder index_builder;
+  arrow::UInt32Builder dict_builder;
+  THROW_NOT_OK(index_builder.AppendValues(indices));
+  THROW_NOT_OK(dict_builder.AppendValues(dictionary));
+  std::shared_ptr<arrow::Array> index_array;
+  std::shared_ptr<arrow::Array> dict_array;
+  THROW_NOT_OK(index_builder.Finish(&index_array));
+  THROW_NOT_OK(dict_builder.Finish(&dict_array));
+  auto schema = GetDictionarySchema();
+  auto array = std::make_shared<arrow::DictionaryArray>(schema->field(0)->type(), index_array, dict_array);
+  return arrow::RecordBatch::Make(schema, indices.size(), {array});
+}
+
+inline std::shared_ptr<arrow::RecordBatch> GetLargeStringRB() {
+  std::vector<std::string> names = {"Alice", "Bob", "Carol"};
+  arrow::LargeStringBuilder builder;
+  THROW_NOT_OK(builder.AppendValues(names));
+  std::shared_ptr<arrow::Array> array;
+  THROW_NOT_OK(builder.Finish(&array));
+  return arrow::RecordBatch::Make(GetLargeStringSchema(), names.size(), {array});
+}
+
 inline std::shared_ptr<arrow::RecordBatch> GetFloat64RB() {
   std::vector<double> numbers = {1.2, 0.6, 1.4, 0.3, 4.5, -1.2, 5.1, -1.3};
   // Make a float builder
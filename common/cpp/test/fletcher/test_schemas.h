@@ -104,6 +104,39 @@ inline std::shared_ptr<arrow::Schema> GetStructSchema() {
   return WithMetaRequired(*std::make_shared<arrow::Schema>(schema_fields), "StructBatch", Mode::READ);
 }
 
+inline std::shared_ptr<arrow::Schema> GetNestedWriteSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> struct_fields = {
+      arrow::field("id", arrow::uint32(), false),
+      arrow::field("tags", arrow::list(arrow::field("tag", arrow::utf8(), false)), false),
+  };
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("S", arrow::struct_(struct_fields), false),
+      arrow::field("groups", arrow::list(arrow::field("group", arrow::struct_(struct_fields), false)), false)
+  };
+  return WithMetaRequired(*std::make_shared<arrow::Schema>(schema_fields), "NestedWrite", Mode::WRITE);
+}
+
+inline std::shared_ptr<arrow::Schema> GetParallelListStructSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> struct_fields = {
+      arrow::field("x", arrow::int32(), false),
+      arrow::field("label", arrow::utf8(), false),
+  };
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      WithMetaParallel(*arrow::field("points", arrow::list(arrow::field("point", arrow::struct_(struct_fields), false)),
+                                     false))
+  };
+  return WithMetaRequired(*std::make_shared<arrow::Schema>(schema_fields), "ParallelRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetPartitionedWriteSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("key", arrow::uint32(), false),
+      arrow::field("value", arrow::utf8(), false),
+  };
+  auto schema = WithMetaRequired(*std::make_shared<arrow::Schema>(schema_fields), "Shuffle", Mode::WRITE);
+  return WithMetaPartitions(*schema, 4, "key");
+}
+
 inline std::shared_ptr<arrow::Schema> GetBigSchema() {
   std::vector<std::shared_ptr<arrow::Field>> struct_fields = {
       arrow::field("Xuint16", arrow::uint16(), false),
@@ -144,6 +177,64 @@ inline std::shared_ptr<arrow::Schema> GetListIntSchema() {
   return WithMetaRequired(*schema, "ListInt", Mode::READ);
 }
 
+inline std::shared_ptr<arrow::Schema> GetBoolSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("flag", arrow::boolean(), false),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "BoolRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetFixedSizeListSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("V", arrow::fixed_size_list(arrow::field("item", arrow::float32(), false), 4), false),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "FixedSizeListRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetDictionarySchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("Category", arrow::dictionary(arrow::uint8(), arrow::uint32()), false),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "DictRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetLargeStringSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("Name", arrow::large_utf8(), false),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "LargeStringRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetCompressedSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      WithMetaCompression(*arrow::field("number", arrow::int64(), false)),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "CompressedRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetRunEndSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      WithMetaRunEndEncoding(*arrow::field("timestamp", arrow::int64(), false)),
+      WithMetaRunEndEncoding(*WithMetaEPC(*arrow::field("sensor", arrow::uint16(), false), 4)),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "RunEndRead", Mode::READ);
+}
+
+inline std::shared_ptr<arrow::Schema> GetParquetPageSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      WithMetaParquetEncoding(*arrow::field("price", arrow::float64(), true)),
+      WithMetaParquetEncoding(*arrow::field("quantity", arrow::int32(), false)),
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaRequired(*schema, "ParquetPageRead", Mode::READ);
+}
+
 inline std::shared_ptr<arrow::Schema> GetFilterReadSchema() {
   std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
       arrow::field("read_first_name", arrow::utf8(), false),
@@ -154,6 +245,15 @@ inline std::shared_ptr<arrow::Schema> GetFilterReadSchema() {
   return WithMetaRequired(*schema, "FilterRead", Mode::READ);
 }
 
+inline std::shared_ptr<arrow::Schema> GetRowFilterSchema() {
+  std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
+      arrow::field("id", arrow::uint32(), false),
+      arrow::field("price", arrow::int64(), true)
+  };
+  auto schema = std::make_shared<arrow::Schema>(schema_fields);
+  return WithMetaFilter(*WithMetaRequired(*schema, "RowFilterRead", Mode::READ), "price >= min_price");
+}
+
 inline std::shared_ptr<arrow::Schema> GetFilterWriteSchema() {
   std::vector<std::shared_ptr<arrow::Field>> schema_fields = {
       arrow::field("write_first_name", arrow::utf8(), false),
@@ -98,6 +98,154 @@ TEST(RecordBatchAnalyzer, VisitStruct) {
   ASSERT_EQ(rbd.fields[0].buffers[1].size_, 4 * sizeof(uint32_t));
 }
 
+TEST(RecordBatchAnalyzer, VisitBool) {
+  auto rb = fletcher::GetBoolRB();
+  fletcher::RecordBatchDescription rbd;
+  fletcher::RecordBatchAnalyzer rba(&rbd);
+  ASSERT_TRUE(rba.Analyze(*rb));
+  ASSERT_EQ(rbd.fields[0].length, 10);
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 1);
+  ASSERT_EQ(rbd.fields[0].buffers[0].desc_, vs({"flag", "values"}));
+  // The values are bit-packed.
+  ASSERT_EQ(rbd.fields[0].buffers[0].size_, 2);
+}
+
+TEST(RecordBatchAnalyzer, VisitLargeString) {
+  auto rb = fletcher::GetLargeStringRB();
+  fletcher::RecordBatchDescription rbd;
+  fletcher::RecordBatchAnalyzer rba(&rbd);
+  ASSERT_TRUE(rba.Analyze(*rb));
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 2);
+  ASSERT_EQ(rbd.fields[0].buffers[0].desc_, vs({"Name", "offsets"}));
+  // Offsets are 64 bits wide.
+  ASSERT_EQ(rbd.fields[0].buffers[0].size_, 4 * sizeof(int64_t));
+  ASSERT_EQ(rbd.fields[0].buffers[1].desc_, vs({"Name", "values"}));
+  ASSERT_EQ(rbd.fields[0].buffers[1].size_, 13);
+  ASSERT_TRUE(fletcher::HasLargeOffsets(*rb->schema()));
+  ASSERT_FALSE(fletcher::HasLargeOffsets(*fletcher::GetStringRB()->schema()));
+}
+
+TEST(RecordBatchAnalyzer, VisitDictionary) {
+  auto rb = fletcher::GetDictionaryRB();
+  fletcher::RecordBatchDescription rbd;
+  fletcher::RecordBatchAnalyzer rba(&rbd);
+  ASSERT_TRUE(rba.Analyze(*rb));
+  ASSERT_EQ(rbd.name, "DictRead");
+  ASSERT_EQ(rbd.fields[0].length, 6);
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 2);
+  ASSERT_EQ(rbd.fields[0].buffers[0].level_, 0);
+  ASSERT_EQ(rbd.fields[0].buffers[0].desc_, vs({"Category", "indices"}));
+  ASSERT_EQ(rbd.fields[0].buffers[0].size_, 6 * sizeof(uint8_t));
+  ASSERT_EQ(rbd.fields[0].buffers[1].level_, 1);
+  ASSERT_EQ(rbd.fields[0].buffers[1].desc_, vs({"Category", "dictionary", "values"}));
+  ASSERT_EQ(rbd.fields[0].buffers[1].size_, 3 * sizeof(uint32_t));
+}
+
+TEST(RecordBatchAnalyzer, VisitSlice) {
+  auto rb = fletcher::GetStringRB();
+  auto strings = std::static_pointer_cast<arrow::StringArray>(rb->column(0));
+  auto slice = rb->Slice(2, 3);
+  fletcher::RecordBatchDescription rbd;
+  fletcher::RecordBatchAnalyzer rba(&rbd);
+  ASSERT_TRUE(rba.Analyze(*slice));
+  ASSERT_EQ(rbd.fields[0].length, 3);
+  // Only the offsets of the slice are described, and the kernel addresses the first of them as element zero.
+  ASSERT_EQ(rbd.fields[0].buffers[0].raw_buffer_, strings->value_offsets()->data() + 2 * sizeof(int32_t));
+  ASSERT_EQ(rbd.fields[0].buffers[0].size_, 4 * sizeof(int32_t));
+  ASSERT_EQ(rbd.fields[0].buffers[0].device_offset_, 0);
+  // Only the values of the slice are described, but the kernel addresses them through the original offsets.
+  ASSERT_EQ(rbd.fields[0].buffers[1].raw_buffer_, strings->value_data()->data() + strings->value_offset(2));
+  ASSERT_EQ(rbd.fields[0].buffers[1].size_, strings->value_offset(5) - strings->value_offset(2));
+  ASSERT_EQ(rbd.fields[0].buffers[1].device_offset_, strings->value_offset(2));
+
+  // Slices of bit-packed buffers must start at a byte boundary.
+  fletcher::RecordBatchDescription bools;
+  fletcher::RecordBatchAnalyzer bool_rba(&bools);
+  ASSERT_TRUE(bool_rba.Analyze(*fletcher::GetBoolRB()->Slice(8)));
+  ASSERT_EQ(bools.fields[0].buffers[0].size_, 1);
+  fletcher::RecordBatchDescription unaligned;
+  fletcher::RecordBatchAnalyzer unaligned_rba(&unaligned);
+  ASSERT_FALSE(unaligned_rba.Analyze(*fletcher::GetBoolRB()->Slice(3)));
+}
+
+TEST(RecordBatchAnalyzer, VisitFixedSizeList) {
+  auto rb = fletcher::GetFixedSizeListRB();
+  fletcher::RecordBatchDescription rbd;
+  fletcher::RecordBatchAnalyzer rba(&rbd);
+  ASSERT_TRUE(rba.Analyze(*rb));
+  // There is no offsets buffer.
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 1);
+  ASSERT_EQ(rbd.fields[0].buffers[0].level_, 1);
+  ASSERT_EQ(rbd.fields[0].buffers[0].desc_, vs({"V", "values"}));
+  ASSERT_EQ(rbd.fields[0].buffers[0].size_, 12 * sizeof(float));
+
+  // A slice covers the values of its lists.
+  auto values = std::static_pointer_cast<arrow::FixedSizeListArray>(rb->column(0))->values();
+  fletcher::RecordBatchDescription sliced;
+  fletcher::RecordBatchAnalyzer sliced_rba(&sliced);
+  ASSERT_TRUE(sliced_rba.Analyze(*rb->Slice(1, 2)));
+  ASSERT_EQ(sliced.fields[0].buffers[0].raw_buffer_, values->data()->buffers[1]->data() + 4 * sizeof(float));
+  ASSERT_EQ(sliced.fields[0].buffers[0].size_, 8 * sizeof(float));
+  ASSERT_EQ(sliced.fields[0].buffers[0].device_offset_, 0);
+}
+
+static void ExpectSameDescription(const fletcher::RecordBatchDescription &a,
+                                  const fletcher::RecordBatchDescription &b) {
+  ASSERT_EQ(a.name, b.name);
+  ASSERT_EQ(a.rows, b.rows);
+  ASSERT_EQ(a.fields.size(), b.fields.size());
+  for (size_t f = 0; f < a.fields.size(); f++) {
+    ASSERT_TRUE(a.fields[f].type_->Equals(b.fields[f].type_));
+    ASSERT_EQ(a.fields[f].length, b.fields[f].length);
+    ASSERT_EQ(a.fields[f].null_count, b.fields[f].null_count);
+    ASSERT_EQ(a.fields[f].buffers.size(), b.fields[f].buffers.size());
+    for (size_t i = 0; i < a.fields[f].buffers.size(); i++) {
+      ASSERT_EQ(a.fields[f].buffers[i].raw_buffer_, b.fields[f].buffers[i].raw_buffer_);
+      ASSERT_EQ(a.fields[f].buffers[i].size_, b.fields[f].buffers[i].size_);
+      ASSERT_EQ(a.fields[f].buffers[i].desc_, b.fields[f].buffers[i].desc_);
+      ASSERT_EQ(a.fields[f].buffers[i].level_, b.fields[f].buffers[i].level_);
+      ASSERT_EQ(a.fields[f].buffers[i].implicit_, b.fields[f].buffers[i].implicit_);
+      ASSERT_EQ(a.fields[f].buffers[i].device_offset_, b.fields[f].buffers[i].device_offset_);
+    }
+  }
+}
+
+TEST(RecordBatchLayout, SameAsAnalyzer) {
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches = {fletcher::GetIntRB(),
+                                                              fletcher::GetStringRB(),
+                                                              fletcher::GetListUint8RB(),
+                                                              fletcher::GetStructRB(),
+                                                              fletcher::GetFilterRB(),
+                                                              fletcher::GetDictionaryRB(),
+                                                              fletcher::GetBoolRB(),
+                                                              fletcher::GetLargeStringRB(),
+                                                              fletcher::GetFixedSizeListRB()};
+  // Slices must be described in the same way.
+  for (size_t i = 0, n = batches.size(); i < n; i++) {
+    if (batches[i]->num_rows() > 2) {
+      batches.push_back(batches[i]->Slice(1, batches[i]->num_rows() - 2));
+    }
+  }
+  for (const auto &rb : batches) {
+    fletcher::RecordBatchDescription expected;
+    fletcher::RecordBatchAnalyzer rba(&expected);
+    auto analyzed = rba.Analyze(*rb);
+
+    std::shared_ptr<fletcher::RecordBatchLayout> layout;
+    ASSERT_TRUE(fletcher::RecordBatchLayout::Make(rb->schema(), &layout));
+    auto desc = layout->description();
+    // Bit-packed slices that do not start at a byte boundary can be described by neither.
+    ASSERT_EQ(layout->Fill(*rb, &desc), analyzed);
+    if (!analyzed) {
+      continue;
+    }
+    ExpectSameDescription(expected, desc);
+    // Filling again must give the same result.
+    ASSERT_TRUE(layout->Fill(*rb, &desc));
+    ExpectSameDescription(expected, desc);
+  }
+}
+
 // TypeVisitor tests
 TEST(SchemaAnalyzer, VisitPrimitive) {
   auto schema = fletcher::GetPrimReadSchema();
@@ -133,6 +281,30 @@ TEST(SchemaAnalyzer, VisitString) {
   ASSERT_EQ(rbd.fields[0].buffers[1].size_, 0);
 }
 
+TEST(SchemaAnalyzer, VisitDictionary) {
+  auto schema = fletcher::GetDictionarySchema();
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  ASSERT_TRUE(rbd.is_virtual);
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 2);
+  ASSERT_EQ(rbd.fields[0].buffers[0].level_, 0);
+  ASSERT_EQ(rbd.fields[0].buffers[0].desc_, vs({"Category", "indices"}));
+  ASSERT_EQ(rbd.fields[0].buffers[1].level_, 1);
+  ASSERT_EQ(rbd.fields[0].buffers[1].desc_, vs({"Category", "dictionary", "values"}));
+}
+
+TEST(SchemaAnalyzer, VisitFixedSizeList) {
+  auto schema = fletcher::GetFixedSizeListSchema();
+  fletcher::RecordBatchDescription rbd;
+  fletcher::SchemaAnalyzer sa(&rbd);
+  sa.Analyze(*schema);
+  ASSERT_TRUE(rbd.is_virtual);
+  ASSERT_EQ(rbd.fields[0].buffers.size(), 1);
+  ASSERT_EQ(rbd.fields[0].buffers[0].level_, 1);
+  ASSERT_EQ(rbd.fields[0].buffers[0].desc_, vs({"V", "values"}));
+}
+
 TEST(SchemaAnalyzer, VisitStruct) {
   auto schema = fletcher::GetStructSchema();
   fletcher::RecordBatchDescription rbd;
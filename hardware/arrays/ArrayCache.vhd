@@ -0,0 +1,184 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.UtilRam_pkg.all;
+
+-- Caches the values of a small field in on-chip memory, for random-access
+-- lookups by the kernel.
+--
+-- The kernel preloads the cache with a regular command on the field, of which
+-- the ArrayReader streams the values into the RAM. The element at row
+-- firstIdx + i of the command is stored at address i, and elements beyond
+-- 2**DEPTH_LOG2 are dropped. The unlock of the command is passed on to the
+-- kernel once the last element is stored, after which the kernel may look up
+-- values by their address. Lookups stall until the cache is loaded. A next
+-- preload starts with its first element, so lookups must have ended by then.
+--
+-- Every lookup is answered with one value, which has the last flag of the
+-- lookup. The RAM is read in the cycle the lookup is accepted, such that a
+-- lookup can be accepted every cycle. RAM_CONFIG selects the RAM primitive,
+-- e.g. block or ultra RAM, see UtilRam1R1W.
+entity ArrayCache is
+  generic (
+    -- Width of the lookup indices.
+    INDEX_WIDTH                 : positive := 32;
+    -- Width of the values.
+    VALUE_WIDTH                 : positive := 32;
+    -- Log2 of the number of values the cache can hold.
+    DEPTH_LOG2                  : positive := 10;
+    -- RAM configuration string for the cache.
+    RAM_CONFIG                  : string   := "";
+    -- Width of the unlock stream tag field.
+    TAG_WIDTH                   : positive := 1
+  );
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Nucleus side data input stream of the preload.
+    nucleus_data_valid          : in  std_logic;
+    nucleus_data_ready          : out std_logic;
+    nucleus_data_dvalid         : in  std_logic;
+    nucleus_data_last           : in  std_logic;
+    nucleus_data                : in  std_logic_vector(VALUE_WIDTH-1 downto 0);
+
+    -- Kernel side lookup input stream.
+    kernel_lookup_valid         : in  std_logic;
+    kernel_lookup_ready         : out std_logic;
+    kernel_lookup_index         : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    kernel_lookup_last          : in  std_logic;
+
+    -- Kernel side data output stream of the looked up values.
+    kernel_data_valid           : out std_logic;
+    kernel_data_ready           : in  std_logic;
+    kernel_data_dvalid          : out std_logic;
+    kernel_data_last            : out std_logic;
+    kernel_data                 : out std_logic_vector(VALUE_WIDTH-1 downto 0);
+
+    -- Nucleus side unlock input stream.
+    nucleus_unl_valid           : in  std_logic;
+    nucleus_unl_ready           : out std_logic;
+    nucleus_unl_tag             : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Kernel side unlock output stream.
+    kernel_unl_valid            : out std_logic;
+    kernel_unl_ready            : in  std_logic;
+    kernel_unl_tag              : out std_logic_vector(TAG_WIDTH-1 downto 0)
+  );
+end ArrayCache;
+
+architecture Behavioral of ArrayCache is
+
+  -- Address at which the next preloaded element is stored.
+  signal wr_addr                : unsigned(DEPTH_LOG2 downto 0);
+  -- Whether the cache holds a complete preload.
+  signal loaded                 : std_logic;
+  -- Whether a preload was stored, of which the unlock was not yet passed on.
+  signal done                   : std_logic;
+
+  -- Output holding register state.
+  signal out_valid              : std_logic;
+  signal out_last               : std_logic;
+
+  signal fill                   : std_logic;
+  signal lookup                 : std_logic;
+
+  signal ram_wena               : std_logic;
+  signal ram_waddr              : std_logic_vector(DEPTH_LOG2-1 downto 0);
+
+begin
+
+  -- The next preload is only accepted when the unlock of the previous one was passed on.
+  fill                <= nucleus_data_valid and not done;
+  lookup              <= kernel_lookup_valid and loaded and (not out_valid or kernel_data_ready);
+
+  -- The first element of a preload is stored at the start of the cache.
+  ram_waddr           <= (others => '0') when loaded = '1' else std_logic_vector(wr_addr(DEPTH_LOG2-1 downto 0));
+  ram_wena            <= fill and nucleus_data_dvalid and (loaded or not wr_addr(DEPTH_LOG2));
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      if fill = '1' then
+        if loaded = '1' then
+          loaded <= '0';
+          wr_addr <= (others => '0');
+          if nucleus_data_dvalid = '1' then
+            wr_addr <= to_unsigned(1, DEPTH_LOG2+1);
+          end if;
+        elsif nucleus_data_dvalid = '1' and wr_addr(DEPTH_LOG2) = '0' then
+          wr_addr <= wr_addr + 1;
+        end if;
+        if nucleus_data_last = '1' then
+          loaded <= '1';
+          done <= '1';
+        end if;
+      end if;
+
+      if nucleus_unl_valid = '1' and kernel_unl_ready = '1' and done = '1' then
+        done <= '0';
+      end if;
+
+      if lookup = '1' then
+        out_valid <= '1';
+        out_last <= kernel_lookup_last;
+      elsif kernel_data_ready = '1' then
+        out_valid <= '0';
+      end if;
+
+      if kcd_reset = '1' then
+        wr_addr <= (others => '0');
+        loaded <= '0';
+        done <= '0';
+        out_valid <= '0';
+        out_last <= '0';
+      end if;
+    end if;
+  end process;
+
+  -- The read port holds its data while the output is stalled, as no lookup is accepted then.
+  ram_inst: UtilRam1R1W
+    generic map (
+      WIDTH                     => VALUE_WIDTH,
+      DEPTH_LOG2                => DEPTH_LOG2,
+      RAM_CONFIG                => RAM_CONFIG
+    )
+    port map (
+      w_clk                     => kcd_clk,
+      w_ena                     => ram_wena,
+      w_addr                    => ram_waddr,
+      w_data                    => nucleus_data,
+      r_clk                     => kcd_clk,
+      r_ena                     => lookup,
+      r_addr                    => kernel_lookup_index(DEPTH_LOG2-1 downto 0),
+      r_data                    => kernel_data
+    );
+
+  nucleus_data_ready  <= not done;
+  kernel_lookup_ready <= lookup;
+
+  kernel_data_valid   <= out_valid;
+  kernel_data_dvalid  <= '1';
+  kernel_data_last    <= out_last;
+
+  nucleus_unl_ready   <= kernel_unl_ready and done;
+  kernel_unl_valid    <= nucleus_unl_valid and done;
+  kernel_unl_tag      <= nucleus_unl_tag;
+
+end Behavioral;
@@ -22,6 +22,11 @@ use ieee.numeric_std.all;
 -- hardware developer. Once some functionality to drive a single node with
 -- non-overlapping flattened type mappers from multiple nodes is implemented,
 -- this component can be removed.
+--
+-- The ctrl field of ArrayReaders holds a flag right above the address of
+-- every validity bitmap, which makes the ArrayReader skip reading the bitmap
+-- when high, as if all elements are valid. VALIDITY marks which addresses are
+-- those of validity bitmaps, and the flags are taken from all_valid in order.
 
 entity ArrayCmdCtrlMerger is
   generic (
@@ -32,7 +37,12 @@ entity ArrayCmdCtrlMerger is
     -- Width of the command stream tag field.
     TAG_WIDTH                   : positive := 1;
     -- Width of the indices
-    INDEX_WIDTH                 : positive := 32
+    INDEX_WIDTH                 : positive := 32;
+    -- Number of validity bitmap addresses.
+    NUM_FLAGS                   : natural := 0;
+    -- For every address, '1' if it is the address of a validity bitmap, and
+    -- '0' otherwise.
+    VALIDITY                    : string := ""
   );
   port (
     -- Nucleus side output stream
@@ -40,7 +50,7 @@ entity ArrayCmdCtrlMerger is
     nucleus_cmd_ready           : in  std_logic;
     nucleus_cmd_firstIdx        : out std_logic_vector(INDEX_WIDTH-1 downto 0);
     nucleus_cmd_lastidx         : out std_logic_vector(INDEX_WIDTH-1 downto 0);
-    nucleus_cmd_ctrl            : out std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH-1 downto 0);
+    nucleus_cmd_ctrl            : out std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH + NUM_FLAGS-1 downto 0);
     nucleus_cmd_tag             : out std_logic_vector(TAG_WIDTH-1 downto 0);
     
     -- Kernel side input stream
@@ -51,7 +61,20 @@ entity ArrayCmdCtrlMerger is
     kernel_cmd_tag              : in  std_logic_vector(TAG_WIDTH-1 downto 0);
     
     -- MMIO side buffer address inputs
-    ctrl                        : in  std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH-1 downto 0)
+    ctrl                        : in  std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH-1 downto 0);
+
+    -- MMIO side field enable input. When low, commands are passed on with an
+    -- empty range, such that the ArrayReader/Writer issues no bus requests.
+    enable                      : in  std_logic := '1';
+
+    -- High once the kernel was stopped, until it is started or reset again.
+    -- Like a disabled field, commands are then passed on with an empty range,
+    -- such that outstanding bus requests drain and no new ones are issued.
+    stopped                     : in  std_logic := '0';
+
+    -- MMIO side all valid inputs, one for every validity bitmap. When high,
+    -- the validity bitmap is not read.
+    all_valid                   : in  std_logic_vector(NUM_FLAGS-1 downto 0) := (others => '0')
   );
 end ArrayCmdCtrlMerger;
 
@@ -61,8 +84,26 @@ begin
   nucleus_cmd_valid    <= kernel_cmd_valid;
   kernel_cmd_ready     <= nucleus_cmd_ready;
   nucleus_cmd_firstIdx <= kernel_cmd_firstIdx;
-  nucleus_cmd_lastidx  <= kernel_cmd_lastidx;
-  nucleus_cmd_ctrl     <= ctrl;
+  nucleus_cmd_lastidx  <= kernel_cmd_lastidx when enable = '1' and stopped = '0' else kernel_cmd_firstIdx;
   nucleus_cmd_tag      <= kernel_cmd_tag;
 
+  ctrl_proc: process(ctrl, all_valid) is
+    variable pos  : natural;
+    variable flag : natural;
+  begin
+    pos  := 0;
+    flag := 0;
+    for a in 0 to NUM_ADDR-1 loop
+      nucleus_cmd_ctrl(pos+BUS_ADDR_WIDTH-1 downto pos) <= ctrl((a+1)*BUS_ADDR_WIDTH-1 downto a*BUS_ADDR_WIDTH);
+      pos := pos + BUS_ADDR_WIDTH;
+      if a < VALIDITY'length and flag < NUM_FLAGS then
+        if VALIDITY(VALIDITY'low + a) = '1' then
+          nucleus_cmd_ctrl(pos) <= all_valid(flag);
+          pos  := pos + 1;
+          flag := flag + 1;
+        end if;
+      end if;
+    end loop;
+  end process;
+
 end Behavioral;
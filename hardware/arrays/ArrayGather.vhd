@@ -0,0 +1,214 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Turns a stream of row indices into ArrayReader commands, for random-access
+-- reads of a field.
+--
+-- The kernel supplies the rows to gather as a stream of indices, of which the
+-- last one of a gather is marked. Runs of consecutive indices with the same
+-- tag are coalesced into a single command of at most MAX_RUN rows, such that
+-- the ArrayReader reads them in bursts. A run is issued as soon as the next
+-- index does not extend it, or no next index is available. The ArrayReader
+-- pipelines the commands, of which up to MAX_PENDING may await their unlock,
+-- and returns the elements in order of the indices. The last signal of the
+-- data stream marks the end of every run.
+--
+-- The unlocks of all commands but the last one of a gather are absorbed, such
+-- that the kernel receives one unlock per gather.
+entity ArrayGather is
+  generic (
+    -- Width of the indices.
+    INDEX_WIDTH                 : positive := 32;
+    -- Width of the command stream tag field.
+    TAG_WIDTH                   : positive := 1;
+    -- Maximum number of rows of a coalesced command.
+    MAX_RUN                     : positive := 256;
+    -- Maximum number of commands awaiting their unlock.
+    MAX_PENDING                 : positive := 64
+  );
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Kernel side index input stream.
+    kernel_idx_valid            : in  std_logic;
+    kernel_idx_ready            : out std_logic;
+    kernel_idx_index            : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    kernel_idx_last             : in  std_logic;
+    kernel_idx_tag              : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Nucleus side command output stream.
+    nucleus_cmd_valid           : out std_logic;
+    nucleus_cmd_ready           : in  std_logic;
+    nucleus_cmd_firstIdx        : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+    nucleus_cmd_lastIdx         : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+    nucleus_cmd_tag             : out std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Nucleus side unlock input stream.
+    nucleus_unl_valid           : in  std_logic;
+    nucleus_unl_ready           : out std_logic;
+    nucleus_unl_tag             : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Kernel side unlock output stream.
+    kernel_unl_valid            : out std_logic;
+    kernel_unl_ready            : in  std_logic;
+    kernel_unl_tag              : out std_logic_vector(TAG_WIDTH-1 downto 0)
+  );
+end ArrayGather;
+
+architecture Behavioral of ArrayGather is
+
+  type reg_type is record
+    -- The run of indices being coalesced.
+    run_valid   : std_logic;
+    run_first   : unsigned(INDEX_WIDTH-1 downto 0);
+    run_last    : unsigned(INDEX_WIDTH-1 downto 0);
+    run_len     : natural range 0 to MAX_RUN;
+    run_end     : std_logic;
+    run_tag     : std_logic_vector(TAG_WIDTH-1 downto 0);
+    -- The command being issued.
+    cmd_valid   : std_logic;
+    cmd_first   : unsigned(INDEX_WIDTH-1 downto 0);
+    cmd_last    : unsigned(INDEX_WIDTH-1 downto 0);
+    cmd_end     : std_logic;
+    cmd_tag     : std_logic_vector(TAG_WIDTH-1 downto 0);
+    -- Whether every issued command awaiting its unlock ends a gather, in order.
+    ends        : std_logic_vector(MAX_PENDING-1 downto 0);
+    wr_ptr      : natural range 0 to MAX_PENDING-1;
+    rd_ptr      : natural range 0 to MAX_PENDING-1;
+    pending     : natural range 0 to MAX_PENDING;
+  end record;
+
+  constant reg_init : reg_type := (
+    run_valid   => '0',
+    run_first   => (others => '0'),
+    run_last    => (others => '0'),
+    run_len     => 0,
+    run_end     => '0',
+    run_tag     => (others => '0'),
+    cmd_valid   => '0',
+    cmd_first   => (others => '0'),
+    cmd_last    => (others => '0'),
+    cmd_end     => '0',
+    cmd_tag     => (others => '0'),
+    ends        => (others => '0'),
+    wr_ptr      => 0,
+    rd_ptr      => 0,
+    pending     => 0
+  );
+
+  signal r : reg_type;
+  signal d : reg_type;
+
+  signal head_end   : std_logic;
+  signal idx_ready  : std_logic;
+
+begin
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      r <= d;
+      if kcd_reset = '1' then
+        r <= reg_init;
+      end if;
+    end if;
+  end process;
+
+  head_end <= r.ends(r.rd_ptr);
+
+  comb_proc: process(r, head_end, kernel_idx_valid, kernel_idx_index, kernel_idx_last, kernel_idx_tag,
+                     nucleus_cmd_ready, nucleus_unl_valid, kernel_unl_ready) is
+    variable v        : reg_type;
+    variable cmd_free : boolean;
+    variable extend   : boolean;
+    variable accept   : boolean;
+  begin
+    v := r;
+    accept := false;
+
+    -- Retire the command being issued.
+    if r.cmd_valid = '1' and nucleus_cmd_ready = '1' then
+      v.cmd_valid := '0';
+      v.ends(r.wr_ptr) := r.cmd_end;
+      v.wr_ptr := (r.wr_ptr + 1) mod MAX_PENDING;
+      v.pending := v.pending + 1;
+    end if;
+
+    -- Pass on the unlock of the last command of a gather, and absorb all others.
+    if nucleus_unl_valid = '1' and r.pending /= 0 and (head_end = '0' or kernel_unl_ready = '1') then
+      v.rd_ptr := (r.rd_ptr + 1) mod MAX_PENDING;
+      v.pending := v.pending - 1;
+    end if;
+    cmd_free := v.cmd_valid = '0' and v.pending < MAX_PENDING;
+
+    extend := r.run_valid = '1' and r.run_end = '0' and r.run_len < MAX_RUN
+              and kernel_idx_valid = '1' and unsigned(kernel_idx_index) = r.run_last
+              and kernel_idx_tag = r.run_tag;
+
+    if extend then
+      -- The index continues the run.
+      v.run_last := r.run_last + 1;
+      v.run_len  := r.run_len + 1;
+      v.run_end  := kernel_idx_last;
+      accept     := true;
+    elsif r.run_valid = '1' then
+      -- The run is complete, or no next index is available yet. Issue it, and start the next run.
+      if cmd_free then
+        v.cmd_valid := '1';
+        v.cmd_first := r.run_first;
+        v.cmd_last  := r.run_last;
+        v.cmd_end   := r.run_end;
+        v.cmd_tag   := r.run_tag;
+        v.run_valid := '0';
+        accept      := kernel_idx_valid = '1';
+      end if;
+    else
+      accept := kernel_idx_valid = '1';
+    end if;
+
+    if accept and not extend then
+      v.run_valid := '1';
+      v.run_first := unsigned(kernel_idx_index);
+      v.run_last  := unsigned(kernel_idx_index) + 1;
+      v.run_len   := 1;
+      v.run_end   := kernel_idx_last;
+      v.run_tag   := kernel_idx_tag;
+    end if;
+
+    if accept then
+      idx_ready <= '1';
+    else
+      idx_ready <= '0';
+    end if;
+
+    d <= v;
+  end process;
+
+  kernel_idx_ready      <= idx_ready;
+
+  nucleus_cmd_valid     <= r.cmd_valid;
+  nucleus_cmd_firstIdx  <= std_logic_vector(r.cmd_first);
+  nucleus_cmd_lastIdx   <= std_logic_vector(r.cmd_last);
+  nucleus_cmd_tag       <= r.cmd_tag;
+
+  nucleus_unl_ready     <= '0' when r.pending = 0 else kernel_unl_ready when head_end = '1' else '1';
+  kernel_unl_valid      <= nucleus_unl_valid when r.pending /= 0 and head_end = '1' else '0';
+  kernel_unl_tag        <= nucleus_unl_tag;
+
+end Behavioral;
@@ -180,7 +180,8 @@ begin
         ELEMENT_COUNT_WIDTH     => COUNT_WIDTH,
         CMD_CTRL_WIDTH          => 1,
         CMD_TAG_WIDTH           => CMD_TAG_WIDTH,
-        BUS_FIFO_DEPTH          => parse_param(CFG, "bus_fifo_depth", 16)
+        BUS_FIFO_DEPTH          => parse_param(CFG, "bus_fifo_depth", 16),
+        BUS_COALESCE            => parse_param(CFG, "coalesce", false)
       )
       port map (
         bcd_clk                 => bcd_clk,
@@ -361,81 +362,58 @@ begin
   -----------------------------------------------------------------------------
   -- List Writer
   -----------------------------------------------------------------------------
-  --list_gen: if CMD = "list" generate
-  --begin
-  --  list_inst: ArrayWriterList
-  --    generic map (
-  --      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
-  --      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
-  --      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
-  --      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
-  --      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
-  --      INDEX_WIDTH               => INDEX_WIDTH,
-  --      CFG                       => CFG,
-  --      CMD_TAG_ENABLE            => CMD_TAG_ENABLE,
-  --      CMD_TAG_WIDTH             => CMD_TAG_WIDTH
-  --    )
-  --    port map (
-  --      bcd_clk                   => bcd_clk,
-  --      bcd_reset                 => bcd_reset,
-  --      kcd_clk                   => kcd_clk,
-  --      kcd_reset                 => kcd_reset,
-  --
-  --      cmd_valid                 => cmd_valid,
-  --      cmd_ready                 => cmd_ready,
-  --      cmd_firstIdx              => cmd_firstIdx,
-  --      cmd_lastIdx               => cmd_lastIdx,
-  --      cmd_ctrl                  => cmd_ctrl,
-  --      cmd_tag                   => cmd_tag,
-  --
-  --      unlock_valid              => unlock_valid,
-  --      unlock_ready              => unlock_ready,
-  --      unlock_tag                => unlock_tag,
-  --
-  --    port map (
-  --      bcd_clk                   => bcd_clk,
-  --      bcd_reset                 => bcd_reset,
-  --      kcd_clk                   => kcd_clk,
-  --      kcd_reset                 => kcd_reset,
-  --
-  --      cmd_valid                 => cmd_valid,
-  --      cmd_ready                 => cmd_ready,
-  --      cmd_firstIdx              => cmd_firstIdx,
-  --      cmd_lastIdx               => cmd_lastIdx,
-  --      cmd_ctrl                  => cmd_ctrl,
-  --      cmd_tag                   => cmd_tag,
-  --
-  --      unlock_valid              => unlock_valid,
-  --      unlock_ready              => unlock_ready,
-  --      unlock_tag                => unlock_tag,
-  --
-  --      bus_wreq_valid            => bus_wreq_valid,
-  --      bus_wreq_ready            => bus_wreq_ready,
-  --      bus_wreq_addr             => bus_wreq_addr,
-  --      bus_wreq_len              => bus_wreq_len,
-  --      bus_wreq_last             => bus_wreq_last,
-  --      bus_wdat_valid            => bus_wdat_valid,
-  --      bus_wdat_ready            => bus_wdat_ready,
-  --      bus_wdat_data             => bus_wdat_data,
-  --      bus_wdat_strobe           => bus_wdat_strobe,
-  --      bus_wdat_last             => bus_wdat_last,
-  --      bus_wrep_valid            => bus_wrep_valid,
-  --      bus_wrep_ready            => bus_wrep_ready,
-  --      bus_wrep_ok               => bus_wrep_ok,
-  --
-  --      in_valid                  => in_valid,
-  --      in_ready                  => in_ready,
-  --      in_last                   => in_last,
-  --      in_dvalid                 => in_dvalid,
-  --      in_data                   => in_data
-  --
-  --      out_valid                 => out_valid,
-  --      out_ready                 => out_ready,
-  --      out_last                  => out_last,
-  --      out_dvalid                => out_dvalid,
-  --      out_data                  => out_data
-  --    );
-  --end generate;
+  list_gen: if CMD = "list" generate
+  begin
+    list_inst: ArrayWriterList
+      generic map (
+        BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+        BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+        BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+        BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+        BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+        INDEX_WIDTH               => INDEX_WIDTH,
+        CFG                       => CFG,
+        CMD_TAG_ENABLE            => CMD_TAG_ENABLE,
+        CMD_TAG_WIDTH             => CMD_TAG_WIDTH
+      )
+      port map (
+        bcd_clk                   => bcd_clk,
+        bcd_reset                 => bcd_reset,
+        kcd_clk                   => kcd_clk,
+        kcd_reset                 => kcd_reset,
+
+        cmd_valid                 => cmd_valid,
+        cmd_ready                 => cmd_ready,
+        cmd_firstIdx              => cmd_firstIdx,
+        cmd_lastIdx               => cmd_lastIdx,
+        cmd_ctrl                  => cmd_ctrl,
+        cmd_tag                   => cmd_tag,
+
+        unlock_valid              => unlock_valid,
+        unlock_ready              => unlock_ready,
+        unlock_tag                => unlock_tag,
+
+        bus_wreq_valid            => bus_wreq_valid,
+        bus_wreq_ready            => bus_wreq_ready,
+        bus_wreq_addr             => bus_wreq_addr,
+        bus_wreq_len              => bus_wreq_len,
+        bus_wreq_last             => bus_wreq_last,
+        bus_wdat_valid            => bus_wdat_valid,
+        bus_wdat_ready            => bus_wdat_ready,
+        bus_wdat_data             => bus_wdat_data,
+        bus_wdat_strobe           => bus_wdat_strobe,
+        bus_wdat_last             => bus_wdat_last,
+        bus_wrep_valid            => bus_wrep_valid,
+        bus_wrep_ready            => bus_wrep_ready,
+        bus_wrep_ok               => bus_wrep_ok,
+
+        in_valid                  => in_valid,
+        in_ready                  => in_ready,
+        in_last                   => in_last,
+        in_dvalid                 => in_dvalid,
+        in_data                   => in_data
+      );
+  end generate;
 
   -----------------------------------------------------------------------------
   -- List of primitives writer
@@ -496,64 +474,57 @@ begin
   -----------------------------------------------------------------------------
   -- Struct writer
   -----------------------------------------------------------------------------
-  --struct_gen: if CMD = "struct" generate
-  --begin
-  --  struct_inst: ArrayWriterStruct
-  --    generic map (
-  --      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
-  --      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
-  --      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
-  --      BUS_STROBE_WIDTH          => BUS_STROBE_WIDTH,
-  --      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
-  --      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
-  --      INDEX_WIDTH               => INDEX_WIDTH,
-  --      CFG                       => CFG,
-  --      CMD_TAG_ENABLE            => CMD_TAG_ENABLE,
-  --      CMD_TAG_WIDTH             => CMD_TAG_WIDTH
-  --    )
-  --    port map (
-  --      bcd_clk                   => bcd_clk,
-  --      bcd_reset                 => bcd_reset,
-  --      kcd_clk                   => kcd_clk,
-  --      kcd_reset                 => kcd_reset,
-  --
-  --      cmd_valid                 => cmd_valid,
-  --      cmd_ready                 => cmd_ready,
-  --      cmd_firstIdx              => cmd_firstIdx,
-  --      cmd_lastIdx               => cmd_lastIdx,
-  --      cmd_ctrl                  => cmd_ctrl,
-  --      cmd_tag                   => cmd_tag,
-  --
-  --      unlock_valid              => unlock_valid,
-  --      unlock_ready              => unlock_ready,
-  --      unlock_tag                => unlock_tag,
-  --
-  --      bus_wreq_valid            => bus_wreq_valid,
-  --      bus_wreq_ready            => bus_wreq_ready,
-  --      bus_wreq_addr             => bus_wreq_addr,
-  --      bus_wreq_len              => bus_wreq_len,
-  --      bus_wreq_last             => bus_wreq_last,
-  --      bus_wdat_valid            => bus_wdat_valid,
-  --      bus_wdat_ready            => bus_wdat_ready,
-  --      bus_wdat_data             => bus_wdat_data,
-  --      bus_wdat_strobe           => bus_wdat_strobe,
-  --      bus_wdat_last             => bus_wdat_last,
-  --      bus_wrep_valid            => bus_wrep_valid,
-  --      bus_wrep_ready            => bus_wrep_ready,
-  --      bus_wrep_ok               => bus_wrep_ok,
-  --
-  --      in_valid                  => in_valid,
-  --      in_ready                  => in_ready,
-  --      in_last                   => in_last,
-  --      in_dvalid                 => in_dvalid,
-  --      in_data                   => in_data
-  --
-  --      out_valid                 => out_valid,
-  --      out_ready                 => out_ready,
-  --      out_last                  => out_last,
-  --      out_dvalid                => out_dvalid,
-  --      out_data                  => out_data
-  --    );
-  --end generate;
+  struct_gen: if CMD = "struct" generate
+  begin
+    struct_inst: ArrayWriterStruct
+      generic map (
+        BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+        BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+        BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+        BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+        BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+        INDEX_WIDTH               => INDEX_WIDTH,
+        CFG                       => CFG,
+        CMD_TAG_ENABLE            => CMD_TAG_ENABLE,
+        CMD_TAG_WIDTH             => CMD_TAG_WIDTH
+      )
+      port map (
+        bcd_clk                   => bcd_clk,
+        bcd_reset                 => bcd_reset,
+        kcd_clk                   => kcd_clk,
+        kcd_reset                 => kcd_reset,
+
+        cmd_valid                 => cmd_valid,
+        cmd_ready                 => cmd_ready,
+        cmd_firstIdx              => cmd_firstIdx,
+        cmd_lastIdx               => cmd_lastIdx,
+        cmd_ctrl                  => cmd_ctrl,
+        cmd_tag                   => cmd_tag,
+
+        unlock_valid              => unlock_valid,
+        unlock_ready              => unlock_ready,
+        unlock_tag                => unlock_tag,
+
+        bus_wreq_valid            => bus_wreq_valid,
+        bus_wreq_ready            => bus_wreq_ready,
+        bus_wreq_addr             => bus_wreq_addr,
+        bus_wreq_len              => bus_wreq_len,
+        bus_wreq_last             => bus_wreq_last,
+        bus_wdat_valid            => bus_wdat_valid,
+        bus_wdat_ready            => bus_wdat_ready,
+        bus_wdat_data             => bus_wdat_data,
+        bus_wdat_strobe           => bus_wdat_strobe,
+        bus_wdat_last             => bus_wdat_last,
+        bus_wrep_valid            => bus_wrep_valid,
+        bus_wrep_ready            => bus_wrep_ready,
+        bus_wrep_ok               => bus_wrep_ok,
+
+        in_valid                  => in_valid,
+        in_ready                  => in_ready,
+        in_last                   => in_last,
+        in_dvalid                 => in_dvalid,
+        in_data                   => in_data
+      );
+  end generate;
 
 end Behavioral;
@@ -301,6 +301,7 @@ begin
       BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
       BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
       BUS_FIFO_DEPTH            => parse_param(CFG, "idx_bus_fifo_depth", 16),
+      BUS_COALESCE              => parse_param(CFG, "idx_coalesce", false),
       INDEX_WIDTH               => INDEX_WIDTH,
       ELEMENT_WIDTH             => INDEX_WIDTH,
       IS_OFFSETS_BUFFER         => true,
@@ -368,6 +369,7 @@ begin
       BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
       BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
       BUS_FIFO_DEPTH            => parse_param(CFG, "bus_fifo_depth", 16),
+      BUS_COALESCE              => parse_param(CFG, "coalesce", false),
       INDEX_WIDTH               => INDEX_WIDTH,
       ELEMENT_WIDTH             => ELEMENT_WIDTH,
       IS_OFFSETS_BUFFER         => false,
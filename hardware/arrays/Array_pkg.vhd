@@ -165,6 +165,53 @@ package Array_pkg is
     );
   end component;
 
+  component ArrayWriterList is
+    generic (
+      BUS_ADDR_WIDTH            : natural;
+      BUS_LEN_WIDTH             : natural;
+      BUS_DATA_WIDTH            : natural;
+      BUS_BURST_STEP_LEN        : natural;
+      BUS_BURST_MAX_LEN         : natural;
+      INDEX_WIDTH               : natural;
+      CFG                       : string;
+      CMD_TAG_ENABLE            : boolean;
+      CMD_TAG_WIDTH             : natural
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      cmd_valid                 : in  std_logic;
+      cmd_ready                 : out std_logic;
+      cmd_firstIdx              : in  std_logic_vector;
+      cmd_lastIdx               : in  std_logic_vector;
+      cmd_ctrl                  : in  std_logic_vector;
+      cmd_tag                   : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      unlock_valid              : out std_logic;
+      unlock_ready              : in  std_logic := '1';
+      unlock_tag                : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      bus_wreq_valid            : out std_logic_vector;
+      bus_wreq_ready            : in  std_logic_vector;
+      bus_wreq_addr             : out std_logic_vector;
+      bus_wreq_len              : out std_logic_vector;
+      bus_wreq_last             : out std_logic_vector;
+      bus_wdat_valid            : out std_logic_vector;
+      bus_wdat_ready            : in  std_logic_vector;
+      bus_wdat_data             : out std_logic_vector;
+      bus_wdat_strobe           : out std_logic_vector;
+      bus_wdat_last             : out std_logic_vector;
+      bus_wrep_valid            : in  std_logic_vector;
+      bus_wrep_ready            : out std_logic_vector;
+      bus_wrep_ok               : in  std_logic_vector;
+      in_valid                  : in  std_logic_vector;
+      in_ready                  : out std_logic_vector;
+      in_last                   : in  std_logic_vector;
+      in_dvalid                 : in  std_logic_vector;
+      in_data                   : in  std_logic_vector
+    );
+  end component;
+
   component ArrayWriterListPrim is
     generic (
       BUS_ADDR_WIDTH            : natural;
@@ -212,6 +259,53 @@ package Array_pkg is
     );
   end component;
 
+  component ArrayWriterStruct is
+    generic (
+      BUS_ADDR_WIDTH            : natural;
+      BUS_LEN_WIDTH             : natural;
+      BUS_DATA_WIDTH            : natural;
+      BUS_BURST_STEP_LEN        : natural;
+      BUS_BURST_MAX_LEN         : natural;
+      INDEX_WIDTH               : natural;
+      CFG                       : string;
+      CMD_TAG_ENABLE            : boolean;
+      CMD_TAG_WIDTH             : natural
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      cmd_valid                 : in  std_logic;
+      cmd_ready                 : out std_logic;
+      cmd_firstIdx              : in  std_logic_vector;
+      cmd_lastIdx               : in  std_logic_vector;
+      cmd_ctrl                  : in  std_logic_vector;
+      cmd_tag                   : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      unlock_valid              : out std_logic;
+      unlock_ready              : in  std_logic := '1';
+      unlock_tag                : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      bus_wreq_valid            : out std_logic_vector;
+      bus_wreq_ready            : in  std_logic_vector;
+      bus_wreq_addr             : out std_logic_vector;
+      bus_wreq_len              : out std_logic_vector;
+      bus_wreq_last             : out std_logic_vector;
+      bus_wdat_valid            : out std_logic_vector;
+      bus_wdat_ready            : in  std_logic_vector;
+      bus_wdat_data             : out std_logic_vector;
+      bus_wdat_strobe           : out std_logic_vector;
+      bus_wdat_last             : out std_logic_vector;
+      bus_wrep_valid            : in  std_logic_vector;
+      bus_wrep_ready            : out std_logic_vector;
+      bus_wrep_ok               : in  std_logic_vector;
+      in_valid                  : in  std_logic_vector;
+      in_ready                  : out std_logic_vector;
+      in_last                   : in  std_logic_vector;
+      in_dvalid                 : in  std_logic_vector;
+      in_data                   : in  std_logic_vector
+    );
+  end component;
+
   component ArrayWriterListSync is
     generic (
       LENGTH_WIDTH              : positive;
@@ -281,6 +375,195 @@ package Array_pkg is
     );
   end component;
 
+  -----------------------------------------------------------------------------
+  -- DictionaryReader
+  -----------------------------------------------------------------------------
+  component DictionaryReader is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      BUS_BURST_STEP_LEN        : natural := 4;
+      BUS_BURST_MAX_LEN         : natural := 16;
+      INDEX_WIDTH               : natural := 32;
+      KEY_WIDTH                 : natural := 8;
+      VALUE_WIDTH               : natural := 32;
+      CACHE_DEPTH_LOG2          : natural := 10;
+      CACHE_RAM_CONFIG          : string  := "";
+      XCLK_STAGES               : natural := 0;
+      CMD_TAG_ENABLE            : boolean := false;
+      CMD_TAG_WIDTH             : natural := 1
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      cmd_valid                 : in  std_logic;
+      cmd_ready                 : out std_logic;
+      cmd_firstIdx              : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_lastIdx               : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_ctrl                  : in  std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+      cmd_tag                   : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      unl_valid                 : out std_logic;
+      unl_ready                 : in  std_logic := '1';
+      unl_tag                   : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+      bus_rreq_valid            : out std_logic;
+      bus_rreq_ready            : in  std_logic;
+      bus_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_rdat_valid            : in  std_logic;
+      bus_rdat_ready            : out std_logic;
+      bus_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_rdat_last             : in  std_logic;
+      out_valid                 : out std_logic_vector(0 downto 0);
+      out_ready                 : in  std_logic_vector(0 downto 0);
+      out_last                  : out std_logic_vector(0 downto 0);
+      out_dvalid                : out std_logic_vector(0 downto 0);
+      out_data                  : out std_logic_vector(VALUE_WIDTH-1 downto 0)
+    );
+  end component;
+
+  component Lz4Reader is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      BUS_BURST_STEP_LEN        : natural := 4;
+      BUS_BURST_MAX_LEN         : natural := 16;
+      INDEX_WIDTH               : natural := 32;
+      VALUE_WIDTH               : natural := 32;
+      HISTORY_DEPTH_LOG2        : natural := 16;
+      HISTORY_RAM_CONFIG        : string  := "";
+      CHUNK_LEN_LOG2            : natural := 6;
+      MAX_CHUNKS                : natural := 4;
+      XCLK_STAGES               : natural := 0;
+      CMD_TAG_ENABLE            : boolean := false;
+      CMD_TAG_WIDTH             : natural := 1
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      cmd_valid                 : in  std_logic;
+      cmd_ready                 : out std_logic;
+      cmd_firstIdx              : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_lastIdx               : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_ctrl                  : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      cmd_tag                   : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      unl_valid                 : out std_logic;
+      unl_ready                 : in  std_logic := '1';
+      unl_tag                   : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+      bus_rreq_valid            : out std_logic;
+      bus_rreq_ready            : in  std_logic;
+      bus_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_rdat_valid            : in  std_logic;
+      bus_rdat_ready            : out std_logic;
+      bus_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_rdat_last             : in  std_logic;
+      out_valid                 : out std_logic_vector(0 downto 0);
+      out_ready                 : in  std_logic_vector(0 downto 0);
+      out_last                  : out std_logic_vector(0 downto 0);
+      out_dvalid                : out std_logic_vector(0 downto 0);
+      out_data                  : out std_logic_vector(VALUE_WIDTH-1 downto 0)
+    );
+  end component;
+
+  component RunEndReader is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      BUS_BURST_STEP_LEN        : natural := 4;
+      BUS_BURST_MAX_LEN         : natural := 16;
+      INDEX_WIDTH               : natural := 32;
+      CFG                       : string  := "prim(32)";
+      CHUNK_LEN_LOG2            : natural := 4;
+      MAX_CHUNKS                : natural := 4;
+      XCLK_STAGES               : natural := 0;
+      CMD_TAG_ENABLE            : boolean := false;
+      CMD_TAG_WIDTH             : natural := 1
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      cmd_valid                 : in  std_logic;
+      cmd_ready                 : out std_logic;
+      cmd_firstIdx              : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_lastIdx               : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_ctrl                  : in  std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+      cmd_tag                   : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      unl_valid                 : out std_logic;
+      unl_ready                 : in  std_logic := '1';
+      unl_tag                   : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+      bus_rreq_valid            : out std_logic;
+      bus_rreq_ready            : in  std_logic;
+      bus_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_rdat_valid            : in  std_logic;
+      bus_rdat_ready            : out std_logic;
+      bus_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_rdat_last             : in  std_logic;
+      out_valid                 : out std_logic_vector(0 downto 0);
+      out_ready                 : in  std_logic_vector(0 downto 0);
+      out_last                  : out std_logic_vector(0 downto 0);
+      out_dvalid                : out std_logic_vector(0 downto 0);
+      out_data                  : out std_logic_vector(arcfg_userWidth(CFG, INDEX_WIDTH)-1 downto 0)
+    );
+  end component;
+
+  component ParquetPageReader is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      BUS_BURST_STEP_LEN        : natural := 4;
+      BUS_BURST_MAX_LEN         : natural := 16;
+      INDEX_WIDTH               : natural := 32;
+      VALUE_WIDTH               : natural := 32;
+      NULLABLE                  : boolean := false;
+      LEVEL_DEPTH_LOG2          : natural := 16;
+      LEVEL_RAM_CONFIG          : string  := "";
+      CHUNK_LEN_LOG2            : natural := 6;
+      MAX_CHUNKS                : natural := 4;
+      XCLK_STAGES               : natural := 0;
+      CMD_TAG_ENABLE            : boolean := false;
+      CMD_TAG_WIDTH             : natural := 1
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      cmd_valid                 : in  std_logic;
+      cmd_ready                 : out std_logic;
+      cmd_firstIdx              : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_lastIdx               : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      cmd_ctrl                  : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      cmd_tag                   : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+      unl_valid                 : out std_logic;
+      unl_ready                 : in  std_logic := '1';
+      unl_tag                   : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+      bus_rreq_valid            : out std_logic;
+      bus_rreq_ready            : in  std_logic;
+      bus_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_rdat_valid            : in  std_logic;
+      bus_rdat_ready            : out std_logic;
+      bus_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_rdat_last             : in  std_logic;
+      out_valid                 : out std_logic_vector(0 downto 0);
+      out_ready                 : in  std_logic_vector(0 downto 0);
+      out_last                  : out std_logic_vector(0 downto 0);
+      out_dvalid                : out std_logic_vector(0 downto 0);
+      out_data                  : out std_logic_vector(VALUE_WIDTH+boolean'pos(NULLABLE)-1 downto 0)
+    );
+  end component;
+
   component ArrayReaderLevel is
     generic (
       BUS_ADDR_WIDTH            : natural;
@@ -609,21 +892,89 @@ package Array_pkg is
       BUS_ADDR_WIDTH            : positive := 64;
       NUM_ADDR                  : positive := 1;
       TAG_WIDTH                 : positive := 1;
-      INDEX_WIDTH               : positive := 32
+      INDEX_WIDTH               : positive := 32;
+      NUM_FLAGS                 : natural := 0;
+      VALIDITY                  : string := ""
     );
     port (
       nucleus_cmd_valid         : out std_logic;
       nucleus_cmd_ready         : in  std_logic;
       nucleus_cmd_firstIdx      : out std_logic_vector(INDEX_WIDTH-1 downto 0);
       nucleus_cmd_lastidx       : out std_logic_vector(INDEX_WIDTH-1 downto 0);
-      nucleus_cmd_ctrl          : out std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH-1 downto 0);
+      nucleus_cmd_ctrl          : out std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH + NUM_FLAGS-1 downto 0);
       nucleus_cmd_tag           : out std_logic_vector(TAG_WIDTH-1 downto 0);
       kernel_cmd_valid          : in  std_logic;
       kernel_cmd_ready          : out std_logic;
       kernel_cmd_firstIdx       : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
       kernel_cmd_lastidx        : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
       kernel_cmd_tag            : in  std_logic_vector(TAG_WIDTH-1 downto 0);
-      ctrl                      : in  std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH-1 downto 0)
+      ctrl                      : in  std_logic_vector(NUM_ADDR * BUS_ADDR_WIDTH-1 downto 0);
+      enable                    : in  std_logic := '1';
+      stopped                   : in  std_logic := '0';
+      all_valid                 : in  std_logic_vector(NUM_FLAGS-1 downto 0) := (others => '0')
+    );
+  end component;
+
+  component ArrayGather is
+    generic (
+      INDEX_WIDTH               : positive := 32;
+      TAG_WIDTH                 : positive := 1;
+      MAX_RUN                   : positive := 256;
+      MAX_PENDING               : positive := 64
+    );
+    port (
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      kernel_idx_valid          : in  std_logic;
+      kernel_idx_ready          : out std_logic;
+      kernel_idx_index          : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      kernel_idx_last           : in  std_logic;
+      kernel_idx_tag            : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+      nucleus_cmd_valid         : out std_logic;
+      nucleus_cmd_ready         : in  std_logic;
+      nucleus_cmd_firstIdx      : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+      nucleus_cmd_lastIdx       : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+      nucleus_cmd_tag           : out std_logic_vector(TAG_WIDTH-1 downto 0);
+      nucleus_unl_valid         : in  std_logic;
+      nucleus_unl_ready         : out std_logic;
+      nucleus_unl_tag           : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+      kernel_unl_valid          : out std_logic;
+      kernel_unl_ready          : in  std_logic;
+      kernel_unl_tag            : out std_logic_vector(TAG_WIDTH-1 downto 0)
+    );
+  end component;
+
+  component ArrayCache is
+    generic (
+      INDEX_WIDTH               : positive := 32;
+      VALUE_WIDTH               : positive := 32;
+      DEPTH_LOG2                : positive := 10;
+      RAM_CONFIG                : string   := "";
+      TAG_WIDTH                 : positive := 1
+    );
+    port (
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      nucleus_data_valid        : in  std_logic;
+      nucleus_data_ready        : out std_logic;
+      nucleus_data_dvalid       : in  std_logic;
+      nucleus_data_last         : in  std_logic;
+      nucleus_data              : in  std_logic_vector(VALUE_WIDTH-1 downto 0);
+      kernel_lookup_valid       : in  std_logic;
+      kernel_lookup_ready       : out std_logic;
+      kernel_lookup_index       : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      kernel_lookup_last        : in  std_logic;
+      kernel_data_valid         : out std_logic;
+      kernel_data_ready         : in  std_logic;
+      kernel_data_dvalid        : out std_logic;
+      kernel_data_last          : out std_logic;
+      kernel_data               : out std_logic_vector(VALUE_WIDTH-1 downto 0);
+      nucleus_unl_valid         : in  std_logic;
+      nucleus_unl_ready         : out std_logic;
+      nucleus_unl_tag           : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+      kernel_unl_valid          : out std_logic;
+      kernel_unl_ready          : in  std_logic;
+      kernel_unl_tag            : out std_logic_vector(TAG_WIDTH-1 downto 0)
     );
   end component;
 
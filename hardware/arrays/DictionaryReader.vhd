@@ -0,0 +1,574 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+use work.UtilInt_pkg.all;
+use work.UtilRam_pkg.all;
+use work.Interconnect_pkg.all;
+use work.ArrayConfig_pkg.all;
+use work.ArrayConfigParse_pkg.all;
+use work.Array_pkg.all;
+
+-- Reads a dictionary-encoded Arrow array of fixed-width values and delivers
+-- the decoded values.
+--
+-- Only the (narrow) indices are streamed from memory. Dictionary values are
+-- fetched on demand and kept in a direct-mapped cache of 2**CACHE_DEPTH_LOG2
+-- entries, such that every distinct value is normally fetched from memory
+-- only once per command. The cache is invalidated for every command, as the
+-- next command may refer to a different dictionary.
+--
+-- Commands are processed one at a time. A cache hit takes two kernel clock
+-- cycles per element, a miss additionally takes the latency of a single-
+-- element read of the dictionary buffer.
+entity DictionaryReader is
+  generic (
+
+    ---------------------------------------------------------------------------
+    -- Bus metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Number of beats in a burst step.
+    BUS_BURST_STEP_LEN          : natural := 4;
+
+    -- Maximum number of beats in a burst.
+    BUS_BURST_MAX_LEN           : natural := 16;
+
+    ---------------------------------------------------------------------------
+    -- Arrow metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Index field width.
+    INDEX_WIDTH                 : natural := 32;
+
+    -- Bit width of the dictionary indices (keys) in memory.
+    KEY_WIDTH                   : natural := 8;
+
+    -- Bit width of the dictionary values.
+    VALUE_WIDTH                 : natural := 32;
+
+    ---------------------------------------------------------------------------
+    -- Dictionary cache configuration
+    ---------------------------------------------------------------------------
+    -- Log2 of the number of cache entries. The cache is never made larger
+    -- than required to hold all keys.
+    CACHE_DEPTH_LOG2            : natural := 10;
+
+    -- RAM configuration string for the cache.
+    CACHE_RAM_CONFIG            : string  := "";
+
+    -- Number of synchronization stages for the internal command FIFOs. If
+    -- this is zero, the bus and kernel clocks must be the same.
+    XCLK_STAGES                 : natural := 0;
+
+    ---------------------------------------------------------------------------
+    -- Array metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Enables or disables command stream tag system. When enabled, an
+    -- additional output stream is created that returns tags supplied along
+    -- with the command stream when all index bus requests for the command
+    -- have been made.
+    CMD_TAG_ENABLE              : boolean := false;
+
+    -- Command stream tag width. Must be at least 1 to avoid null vectors.
+    CMD_TAG_WIDTH               : natural := 1
+
+  );
+  port (
+
+    ---------------------------------------------------------------------------
+    -- Clock domains
+    ---------------------------------------------------------------------------
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- bus and control logic side.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- accelerator side, which also holds the dictionary cache.
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- Command streams
+    ---------------------------------------------------------------------------
+    -- Command stream input (bus clock domain). firstIdx (inclusive) and
+    -- lastIdx (exclusive) select a range of indices. The ctrl vector holds
+    -- the indices buffer address in the lower half and the dictionary values
+    -- buffer address in the upper half.
+    cmd_valid                   : in  std_logic;
+    cmd_ready                   : out std_logic;
+    cmd_firstIdx                : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_lastIdx                 : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_ctrl                    : in  std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+    cmd_tag                     : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+
+    -- Unlock stream (bus clock domain). Produces the chunk tags supplied by
+    -- the command stream when all index bus requests have been made.
+    unl_valid                   : out std_logic;
+    unl_ready                   : in  std_logic := '1';
+    unl_tag                     : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    ---------------------------------------------------------------------------
+    -- Bus access ports
+    ---------------------------------------------------------------------------
+    -- Bus access port (bus clock domain).
+    bus_rreq_valid              : out std_logic;
+    bus_rreq_ready              : in  std_logic;
+    bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_rdat_valid              : in  std_logic;
+    bus_rdat_ready              : out std_logic;
+    bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_rdat_last               : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- User streams
+    ---------------------------------------------------------------------------
+    -- Decoded values output stream (kernel clock domain).
+    out_valid                   : out std_logic_vector(0 downto 0);
+    out_ready                   : in  std_logic_vector(0 downto 0);
+    out_last                    : out std_logic_vector(0 downto 0);
+    out_dvalid                  : out std_logic_vector(0 downto 0);
+    out_data                    : out std_logic_vector(VALUE_WIDTH-1 downto 0)
+
+  );
+end DictionaryReader;
+
+architecture Behavioral of DictionaryReader is
+
+  -- Configuration strings of the index and dictionary value ArrayReaders.
+  constant IDX_CFG              : string := "prim(" & integer'image(KEY_WIDTH) & ")";
+  constant VAL_CFG              : string := "prim(" & integer'image(VALUE_WIDTH) & ")";
+
+  -- Cache dimensions. The part of the key that does not address the cache
+  -- is stored alongside the value as the tag.
+  constant CDL                  : natural := imin(CACHE_DEPTH_LOG2, KEY_WIDTH);
+  constant TAG_WIDTH            : natural := KEY_WIDTH - CDL;
+  constant TW                   : natural := imax(1, TAG_WIDTH);
+  constant RAM_WIDTH            : natural := TW + VALUE_WIDTH;
+
+  -- Return the tag of a key.
+  function key_tag(key : std_logic_vector(KEY_WIDTH-1 downto 0)) return std_logic_vector is
+    variable result             : std_logic_vector(TW-1 downto 0) := (others => '0');
+  begin
+    if TAG_WIDTH > 0 then
+      result(TAG_WIDTH-1 downto 0) := key(KEY_WIDTH-1 downto CDL);
+    end if;
+    return result;
+  end function;
+
+  -- Command stream to the index ArrayReader.
+  signal icmd_valid             : std_logic;
+  signal icmd_ready             : std_logic;
+
+  -- Dictionary address stream.
+  signal bdcmd_valid            : std_logic;
+  signal bdcmd_ready            : std_logic;
+  signal dcmd_valid             : std_logic;
+  signal dcmd_ready             : std_logic;
+  signal dcmd_addr              : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+
+  -- Index stream.
+  signal idx_valid              : std_logic_vector(0 downto 0);
+  signal idx_ready              : std_logic_vector(0 downto 0);
+  signal idx_last               : std_logic_vector(0 downto 0);
+  signal idx_dvalid             : std_logic_vector(0 downto 0);
+  signal idx_data               : std_logic_vector(KEY_WIDTH-1 downto 0);
+
+  -- Cache miss command stream, in the kernel and bus clock domains.
+  signal miss_valid             : std_logic;
+  signal miss_ready             : std_logic;
+  signal miss_data              : std_logic_vector(INDEX_WIDTH+BUS_ADDR_WIDTH-1 downto 0);
+  signal vcmd_valid             : std_logic;
+  signal vcmd_ready             : std_logic;
+  signal vcmd_data              : std_logic_vector(INDEX_WIDTH+BUS_ADDR_WIDTH-1 downto 0);
+  signal vcmd_firstIdx          : std_logic_vector(INDEX_WIDTH-1 downto 0);
+  signal vcmd_lastIdx           : std_logic_vector(INDEX_WIDTH-1 downto 0);
+
+  -- Dictionary value stream.
+  signal val_valid              : std_logic_vector(0 downto 0);
+  signal val_ready              : std_logic_vector(0 downto 0);
+  signal val_data               : std_logic_vector(VALUE_WIDTH-1 downto 0);
+
+  -- Cache RAM ports.
+  signal ram_wena               : std_logic;
+  signal ram_waddr              : std_logic_vector(CDL-1 downto 0);
+  signal ram_wdata              : std_logic_vector(RAM_WIDTH-1 downto 0);
+  signal ram_rena               : std_logic;
+  signal ram_raddr              : std_logic_vector(CDL-1 downto 0);
+  signal ram_rdata              : std_logic_vector(RAM_WIDTH-1 downto 0);
+
+  -- Bus ports of the index (0) and dictionary (1) ArrayReaders.
+  signal bsv_rreq_valid         : std_logic_vector(1 downto 0);
+  signal bsv_rreq_ready         : std_logic_vector(1 downto 0);
+  signal bsv_rreq_addr          : std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+  signal bsv_rreq_len           : std_logic_vector(2*BUS_LEN_WIDTH-1 downto 0);
+  signal bsv_rdat_valid         : std_logic_vector(1 downto 0);
+  signal bsv_rdat_ready         : std_logic_vector(1 downto 0);
+  signal bsv_rdat_data          : std_logic_vector(2*BUS_DATA_WIDTH-1 downto 0);
+  signal bsv_rdat_last          : std_logic_vector(1 downto 0);
+
+  type state_type is (IDLE, FETCH, LOOKUP, MISS, REFILL, OUTPUT);
+
+  type reg_type is record
+    state                       : state_type;
+    addr                        : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    key                         : std_logic_vector(KEY_WIDTH-1 downto 0);
+    last                        : std_logic;
+    dvalid                      : std_logic;
+    value                       : std_logic_vector(VALUE_WIDTH-1 downto 0);
+    valid                       : std_logic_vector(2**CDL-1 downto 0);
+  end record;
+
+  signal r                      : reg_type;
+  signal d                      : reg_type;
+
+begin
+
+  -- Split the command stream into a command for the index reader and the
+  -- dictionary address for the lookup logic.
+  cmd_split_inst: StreamSync
+    generic map (
+      NUM_INPUTS                => 1,
+      NUM_OUTPUTS               => 2
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+
+      in_valid(0)               => cmd_valid,
+      in_ready(0)               => cmd_ready,
+
+      out_valid(1)              => bdcmd_valid,
+      out_valid(0)              => icmd_valid,
+      out_ready(1)              => bdcmd_ready,
+      out_ready(0)              => icmd_ready
+    );
+
+  dcmd_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => BUS_ADDR_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => bcd_clk,
+      in_reset                  => bcd_reset,
+      in_valid                  => bdcmd_valid,
+      in_ready                  => bdcmd_ready,
+      in_data                   => cmd_ctrl(2*BUS_ADDR_WIDTH-1 downto BUS_ADDR_WIDTH),
+      out_clk                   => kcd_clk,
+      out_reset                 => kcd_reset,
+      out_valid                 => dcmd_valid,
+      out_ready                 => dcmd_ready,
+      out_data                  => dcmd_addr
+    );
+
+  -- Stream the indices.
+  idx_reader_inst: ArrayReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      CFG                       => IDX_CFG,
+      CMD_TAG_ENABLE            => CMD_TAG_ENABLE,
+      CMD_TAG_WIDTH             => CMD_TAG_WIDTH
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmd_valid                 => icmd_valid,
+      cmd_ready                 => icmd_ready,
+      cmd_firstIdx              => cmd_firstIdx,
+      cmd_lastIdx               => cmd_lastIdx,
+      cmd_ctrl                  => cmd_ctrl(BUS_ADDR_WIDTH-1 downto 0),
+      cmd_tag                   => cmd_tag,
+
+      unl_valid                 => unl_valid,
+      unl_ready                 => unl_ready,
+      unl_tag                   => unl_tag,
+
+      bus_rreq_valid            => bsv_rreq_valid(0),
+      bus_rreq_ready            => bsv_rreq_ready(0),
+      bus_rreq_addr             => bsv_rreq_addr(BUS_ADDR_WIDTH-1 downto 0),
+      bus_rreq_len              => bsv_rreq_len(BUS_LEN_WIDTH-1 downto 0),
+      bus_rdat_valid            => bsv_rdat_valid(0),
+      bus_rdat_ready            => bsv_rdat_ready(0),
+      bus_rdat_data             => bsv_rdat_data(BUS_DATA_WIDTH-1 downto 0),
+      bus_rdat_last             => bsv_rdat_last(0),
+
+      out_valid                 => idx_valid,
+      out_ready                 => idx_ready,
+      out_last                  => idx_last,
+      out_dvalid                => idx_dvalid,
+      out_data                  => idx_data
+    );
+
+  -- Move the cache miss commands to the bus clock domain.
+  miss_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => INDEX_WIDTH+BUS_ADDR_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => miss_valid,
+      in_ready                  => miss_ready,
+      in_data                   => miss_data,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => vcmd_valid,
+      out_ready                 => vcmd_ready,
+      out_data                  => vcmd_data
+    );
+
+  miss_data     <= r.addr & std_logic_vector(resize(unsigned(r.key), INDEX_WIDTH));
+  vcmd_firstIdx <= vcmd_data(INDEX_WIDTH-1 downto 0);
+  vcmd_lastIdx  <= std_logic_vector(unsigned(vcmd_firstIdx) + 1);
+
+  -- Fetch single dictionary values on cache misses.
+  val_reader_inst: ArrayReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      CFG                       => VAL_CFG,
+      CMD_TAG_ENABLE            => false,
+      CMD_TAG_WIDTH             => 1
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmd_valid                 => vcmd_valid,
+      cmd_ready                 => vcmd_ready,
+      cmd_firstIdx              => vcmd_firstIdx,
+      cmd_lastIdx               => vcmd_lastIdx,
+      cmd_ctrl                  => vcmd_data(INDEX_WIDTH+BUS_ADDR_WIDTH-1 downto INDEX_WIDTH),
+
+      unl_valid                 => open,
+      unl_tag                   => open,
+
+      bus_rreq_valid            => bsv_rreq_valid(1),
+      bus_rreq_ready            => bsv_rreq_ready(1),
+      bus_rreq_addr             => bsv_rreq_addr(2*BUS_ADDR_WIDTH-1 downto BUS_ADDR_WIDTH),
+      bus_rreq_len              => bsv_rreq_len(2*BUS_LEN_WIDTH-1 downto BUS_LEN_WIDTH),
+      bus_rdat_valid            => bsv_rdat_valid(1),
+      bus_rdat_ready            => bsv_rdat_ready(1),
+      bus_rdat_data             => bsv_rdat_data(2*BUS_DATA_WIDTH-1 downto BUS_DATA_WIDTH),
+      bus_rdat_last             => bsv_rdat_last(1),
+
+      out_valid                 => val_valid,
+      out_ready                 => val_ready,
+      out_last                  => open,
+      out_dvalid                => open,
+      out_data                  => val_data
+    );
+
+  -- Share the bus between the index and dictionary readers.
+  arb_inst: BusReadArbiterVec
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      NUM_SLAVE_PORTS           => 2
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+
+      mst_rreq_valid            => bus_rreq_valid,
+      mst_rreq_ready            => bus_rreq_ready,
+      mst_rreq_addr             => bus_rreq_addr,
+      mst_rreq_len              => bus_rreq_len,
+      mst_rdat_valid            => bus_rdat_valid,
+      mst_rdat_ready            => bus_rdat_ready,
+      mst_rdat_data             => bus_rdat_data,
+      mst_rdat_last             => bus_rdat_last,
+
+      bsv_rreq_valid            => bsv_rreq_valid,
+      bsv_rreq_ready            => bsv_rreq_ready,
+      bsv_rreq_addr             => bsv_rreq_addr,
+      bsv_rreq_len              => bsv_rreq_len,
+      bsv_rdat_valid            => bsv_rdat_valid,
+      bsv_rdat_ready            => bsv_rdat_ready,
+      bsv_rdat_data             => bsv_rdat_data,
+      bsv_rdat_last             => bsv_rdat_last
+    );
+
+  -- The dictionary cache. Every entry holds the tag of its key and the value.
+  cache_inst: UtilRam1R1W
+    generic map (
+      WIDTH                     => RAM_WIDTH,
+      DEPTH_LOG2                => CDL,
+      RAM_CONFIG                => CACHE_RAM_CONFIG
+    )
+    port map (
+      w_clk                     => kcd_clk,
+      w_ena                     => ram_wena,
+      w_addr                    => ram_waddr,
+      w_data                    => ram_wdata,
+      r_clk                     => kcd_clk,
+      r_ena                     => ram_rena,
+      r_addr                    => ram_raddr,
+      r_data                    => ram_rdata
+    );
+
+  ram_raddr <= idx_data(CDL-1 downto 0);
+  ram_waddr <= r.key(CDL-1 downto 0);
+  ram_wdata <= key_tag(r.key) & val_data;
+
+  seq: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      -- Registers
+      r                         <= d;
+
+      -- Reset
+      if kcd_reset = '1' then
+        r.state                 <= IDLE;
+        r.valid                 <= (others => '0');
+      end if;
+    end if;
+  end process;
+
+  comb: process(r,
+    dcmd_valid, dcmd_addr,
+    idx_valid, idx_last, idx_dvalid, idx_data,
+    ram_rdata,
+    miss_ready,
+    val_valid, val_data,
+    out_ready
+  ) is
+    variable v                  : reg_type;
+    variable fetch              : boolean;
+  begin
+    v := r;
+    fetch := false;
+
+    -- Default outputs
+    dcmd_ready                  <= '0';
+    idx_ready(0)                <= '0';
+    miss_valid                  <= '0';
+    val_ready(0)                <= '0';
+    ram_wena                    <= '0';
+    ram_rena                    <= '0';
+    out_valid(0)                <= '0';
+
+    case r.state is
+      when IDLE =>
+        -- Wait for the dictionary of the next command and invalidate the cache.
+        dcmd_ready              <= '1';
+        if dcmd_valid = '1' then
+          v.addr                := dcmd_addr;
+          v.valid               := (others => '0');
+          v.state               := FETCH;
+        end if;
+
+      when FETCH =>
+        fetch                   := true;
+
+      when LOOKUP =>
+        -- The cache entry has been read.
+        if r.valid(to_integer(unsigned(r.key(CDL-1 downto 0)))) = '1'
+          and ram_rdata(RAM_WIDTH-1 downto VALUE_WIDTH) = key_tag(r.key)
+        then
+          v.value               := ram_rdata(VALUE_WIDTH-1 downto 0);
+          v.state               := OUTPUT;
+        else
+          v.state               := MISS;
+        end if;
+
+      when MISS =>
+        -- Request the value from the dictionary buffer.
+        miss_valid              <= '1';
+        if miss_ready = '1' then
+          v.state               := REFILL;
+        end if;
+
+      when REFILL =>
+        -- Store the value in the cache and pass it on.
+        val_ready(0)            <= '1';
+        if val_valid(0) = '1' then
+          ram_wena              <= '1';
+          v.valid(to_integer(unsigned(r.key(CDL-1 downto 0)))) := '1';
+          v.value               := val_data;
+          v.state               := OUTPUT;
+        end if;
+
+      when OUTPUT =>
+        out_valid(0)            <= '1';
+        if out_ready(0) = '1' then
+          if r.last = '1' then
+            v.state             := IDLE;
+          else
+            -- Accept the next index in the same cycle.
+            v.state             := FETCH;
+            fetch               := true;
+          end if;
+        end if;
+
+    end case;
+
+    -- Accept an index and look it up in the cache. Transfers without data
+    -- are passed through.
+    if fetch then
+      idx_ready(0)              <= '1';
+      ram_rena                  <= '1';
+      if idx_valid(0) = '1' then
+        v.key                   := idx_data;
+        v.last                  := idx_last(0);
+        v.dvalid                := idx_dvalid(0);
+        if idx_dvalid(0) = '1' then
+          v.state               := LOOKUP;
+        else
+          v.state               := OUTPUT;
+        end if;
+      end if;
+    end if;
+
+    d <= v;
+  end process;
+
+  out_last(0)   <= r.last;
+  out_dvalid(0) <= r.dvalid;
+  out_data      <= r.value;
+
+end Behavioral;
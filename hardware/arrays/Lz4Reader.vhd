@@ -0,0 +1,723 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+use work.UtilInt_pkg.all;
+use work.UtilRam_pkg.all;
+use work.Interconnect_pkg.all;
+use work.ArrayConfig_pkg.all;
+use work.ArrayConfigParse_pkg.all;
+use work.Array_pkg.all;
+
+-- Reads an LZ4-compressed Arrow buffer of fixed-width values and delivers the
+-- decompressed values.
+--
+-- The buffer must be laid out like a compressed buffer of the Arrow IPC
+-- format: the uncompressed length as a 64-bit integer, followed by an LZ4
+-- frame. Only the compressed bytes are streamed from memory, in chunks of
+-- 2**CHUNK_LEN_LOG2 bytes, until the end mark of the frame is found or all
+-- elements of the command have been delivered. Like the BufferReaders, the
+-- last chunk may be read beyond the end of the buffer.
+--
+-- The buffer is decompressed from the start for every command. Elements
+-- before firstIdx are decompressed and dropped. Matches may refer to at most
+-- 2**HISTORY_DEPTH_LOG2 bytes back, which must be 16 to support any frame.
+-- Content and block checksums are skipped but not checked.
+--
+-- Commands are processed one at a time. Literals are decompressed at one
+-- byte per kernel clock cycle, matches at one byte every two cycles.
+entity Lz4Reader is
+  generic (
+
+    ---------------------------------------------------------------------------
+    -- Bus metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Number of beats in a burst step.
+    BUS_BURST_STEP_LEN          : natural := 4;
+
+    -- Maximum number of beats in a burst.
+    BUS_BURST_MAX_LEN           : natural := 16;
+
+    ---------------------------------------------------------------------------
+    -- Arrow metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Index field width.
+    INDEX_WIDTH                 : natural := 32;
+
+    -- Bit width of the values. Must be a multiple of 8.
+    VALUE_WIDTH                 : natural := 32;
+
+    ---------------------------------------------------------------------------
+    -- Decompressor configuration
+    ---------------------------------------------------------------------------
+    -- Log2 of the size of the history of decompressed bytes that matches can
+    -- refer to.
+    HISTORY_DEPTH_LOG2          : natural := 16;
+
+    -- RAM configuration string for the history.
+    HISTORY_RAM_CONFIG          : string  := "";
+
+    -- Log2 of the number of compressed bytes requested per chunk.
+    CHUNK_LEN_LOG2              : natural := 6;
+
+    -- Maximum number of chunks that are requested but not yet decompressed.
+    MAX_CHUNKS                  : natural := 4;
+
+    -- Number of synchronization stages for the internal command FIFOs. If
+    -- this is zero, the bus and kernel clocks must be the same.
+    XCLK_STAGES                 : natural := 0;
+
+    ---------------------------------------------------------------------------
+    -- Array metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Enables or disables command stream tag system. When enabled, an
+    -- additional output stream is created that returns tags supplied along
+    -- with the command stream when the command has been processed.
+    CMD_TAG_ENABLE              : boolean := false;
+
+    -- Command stream tag width. Must be at least 1 to avoid null vectors.
+    CMD_TAG_WIDTH               : natural := 1
+
+  );
+  port (
+
+    ---------------------------------------------------------------------------
+    -- Clock domains
+    ---------------------------------------------------------------------------
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- bus and control logic side.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- accelerator side, which also holds the decompressor.
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- Command streams
+    ---------------------------------------------------------------------------
+    -- Command stream input (bus clock domain). firstIdx (inclusive) and
+    -- lastIdx (exclusive) select a range of decompressed values. The ctrl
+    -- vector holds the address of the compressed buffer.
+    cmd_valid                   : in  std_logic;
+    cmd_ready                   : out std_logic;
+    cmd_firstIdx                : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_lastIdx                 : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_ctrl                    : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    cmd_tag                     : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+
+    -- Unlock stream (bus clock domain). Produces the chunk tags supplied by
+    -- the command stream when the command has been processed.
+    unl_valid                   : out std_logic;
+    unl_ready                   : in  std_logic := '1';
+    unl_tag                     : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    ---------------------------------------------------------------------------
+    -- Bus access ports
+    ---------------------------------------------------------------------------
+    -- Bus access port (bus clock domain).
+    bus_rreq_valid              : out std_logic;
+    bus_rreq_ready              : in  std_logic;
+    bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_rdat_valid              : in  std_logic;
+    bus_rdat_ready              : out std_logic;
+    bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_rdat_last               : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- User streams
+    ---------------------------------------------------------------------------
+    -- Decompressed values output stream (kernel clock domain).
+    out_valid                   : out std_logic_vector(0 downto 0);
+    out_ready                   : in  std_logic_vector(0 downto 0);
+    out_last                    : out std_logic_vector(0 downto 0);
+    out_dvalid                  : out std_logic_vector(0 downto 0);
+    out_data                    : out std_logic_vector(VALUE_WIDTH-1 downto 0)
+
+  );
+end Lz4Reader;
+
+architecture Behavioral of Lz4Reader is
+
+  -- The compressed bytes are read by an ArrayReader of bytes.
+  constant BYTE_CFG             : string  := "prim(8)";
+
+  constant ELEM_BYTES           : natural := VALUE_WIDTH / 8;
+  constant HDL                  : natural := HISTORY_DEPTH_LOG2;
+  constant CHUNK_LEN            : natural := 2**CHUNK_LEN_LOG2;
+
+  -- Command FIFO data: tag, buffer address, lastIdx and firstIdx.
+  constant CMD_WIDTH            : natural := CMD_TAG_WIDTH + BUS_ADDR_WIDTH + 2*INDEX_WIDTH;
+
+  -- Chunk command FIFO data: buffer address, lastIdx and firstIdx in bytes.
+  constant CHUNK_WIDTH          : natural := BUS_ADDR_WIDTH + 2*INDEX_WIDTH;
+
+  -- Command stream, in the bus and kernel clock domains.
+  signal cmd_data               : std_logic_vector(CMD_WIDTH-1 downto 0);
+  signal kcmd_valid             : std_logic;
+  signal kcmd_ready             : std_logic;
+  signal kcmd_data              : std_logic_vector(CMD_WIDTH-1 downto 0);
+
+  -- Chunk command stream, in the kernel and bus clock domains.
+  signal chunk_valid            : std_logic;
+  signal chunk_ready            : std_logic;
+  signal chunk_data             : std_logic_vector(CHUNK_WIDTH-1 downto 0);
+  signal bchunk_valid           : std_logic;
+  signal bchunk_ready           : std_logic;
+  signal bchunk_data            : std_logic_vector(CHUNK_WIDTH-1 downto 0);
+
+  -- Unlock stream in the kernel clock domain.
+  signal kunl_valid             : std_logic;
+  signal kunl_ready             : std_logic;
+
+  -- Compressed byte stream.
+  signal in_valid               : std_logic_vector(0 downto 0);
+  signal in_ready               : std_logic_vector(0 downto 0);
+  signal in_last                : std_logic_vector(0 downto 0);
+  signal in_data                : std_logic_vector(7 downto 0);
+
+  -- History RAM ports.
+  signal ram_wena               : std_logic;
+  signal ram_waddr              : std_logic_vector(HDL-1 downto 0);
+  signal ram_wdata              : std_logic_vector(7 downto 0);
+  signal ram_rena               : std_logic;
+  signal ram_raddr              : std_logic_vector(HDL-1 downto 0);
+  signal ram_rdata              : std_logic_vector(7 downto 0);
+
+  type state_type is (IDLE, PREFIX, MAGIC, FLG, BD, CSIZE, DICTID, HC, BSIZE,
+                      RAW, TOKEN, LITEXT, LITERAL, OFF0, OFF1, MATEXT,
+                      MATCH_RD, MATCH_WR, BCSUM, DRAIN, UNLOCK);
+
+  type reg_type is record
+    state                       : state_type;
+
+    -- Command.
+    first                       : unsigned(INDEX_WIDTH-1 downto 0);
+    last                        : unsigned(INDEX_WIDTH-1 downto 0);
+    addr                        : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    tag                         : std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    -- Chunk requests.
+    issue                       : std_logic;
+    chunk                       : unsigned(INDEX_WIDTH-1 downto 0);
+    pending                     : unsigned(log2ceil(MAX_CHUNKS+1)-1 downto 0);
+
+    -- Frame parsing.
+    cnt                         : unsigned(3 downto 0);
+    flg                         : std_logic_vector(7 downto 0);
+    bsize                       : std_logic_vector(31 downto 0);
+    remaining                   : unsigned(31 downto 0);
+    lit                         : unsigned(31 downto 0);
+    mat                         : unsigned(31 downto 0);
+    offset                      : unsigned(15 downto 0);
+
+    -- Decompressed bytes.
+    wpos                        : unsigned(HDL-1 downto 0);
+    bcnt                        : unsigned(log2ceil(ELEM_BYTES+1)-1 downto 0);
+    idx                         : unsigned(INDEX_WIDTH-1 downto 0);
+
+    -- Output element.
+    ovalid                      : std_logic;
+    olast                       : std_logic;
+    odvalid                     : std_logic;
+    elem                        : std_logic_vector(VALUE_WIDTH-1 downto 0);
+  end record;
+
+  signal r                      : reg_type;
+  signal d                      : reg_type;
+
+begin
+
+  assert VALUE_WIDTH mod 8 = 0 and VALUE_WIDTH > 0
+    report "Lz4Reader VALUE_WIDTH must be a positive multiple of 8."
+    severity failure;
+
+  assert HISTORY_DEPTH_LOG2 <= 16
+    report "Lz4Reader HISTORY_DEPTH_LOG2 must be at most 16."
+    severity failure;
+
+  cmd_data <= cmd_tag & cmd_ctrl & cmd_lastIdx & cmd_firstIdx;
+
+  -- Move the commands to the kernel clock domain.
+  cmd_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CMD_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => bcd_clk,
+      in_reset                  => bcd_reset,
+      in_valid                  => cmd_valid,
+      in_ready                  => cmd_ready,
+      in_data                   => cmd_data,
+      out_clk                   => kcd_clk,
+      out_reset                 => kcd_reset,
+      out_valid                 => kcmd_valid,
+      out_ready                 => kcmd_ready,
+      out_data                  => kcmd_data
+    );
+
+  -- Move the chunk commands to the bus clock domain.
+  chunk_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CHUNK_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => chunk_valid,
+      in_ready                  => chunk_ready,
+      in_data                   => chunk_data,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => bchunk_valid,
+      out_ready                 => bchunk_ready,
+      out_data                  => bchunk_data
+    );
+
+  chunk_data <= r.addr
+              & std_logic_vector(r.chunk + CHUNK_LEN)
+              & std_logic_vector(r.chunk);
+
+  -- Stream the compressed bytes.
+  byte_reader_inst: ArrayReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      CFG                       => BYTE_CFG,
+      CMD_TAG_ENABLE            => false,
+      CMD_TAG_WIDTH             => 1
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmd_valid                 => bchunk_valid,
+      cmd_ready                 => bchunk_ready,
+      cmd_firstIdx              => bchunk_data(INDEX_WIDTH-1 downto 0),
+      cmd_lastIdx               => bchunk_data(2*INDEX_WIDTH-1 downto INDEX_WIDTH),
+      cmd_ctrl                  => bchunk_data(CHUNK_WIDTH-1 downto 2*INDEX_WIDTH),
+
+      unl_valid                 => open,
+      unl_tag                   => open,
+
+      bus_rreq_valid            => bus_rreq_valid,
+      bus_rreq_ready            => bus_rreq_ready,
+      bus_rreq_addr             => bus_rreq_addr,
+      bus_rreq_len              => bus_rreq_len,
+      bus_rdat_valid            => bus_rdat_valid,
+      bus_rdat_ready            => bus_rdat_ready,
+      bus_rdat_data             => bus_rdat_data,
+      bus_rdat_last             => bus_rdat_last,
+
+      out_valid                 => in_valid,
+      out_ready                 => in_ready,
+      out_last                  => in_last,
+      out_dvalid                => open,
+      out_data                  => in_data
+    );
+
+  -- Move the unlock tags back to the bus clock domain.
+  unl_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CMD_TAG_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => kunl_valid,
+      in_ready                  => kunl_ready,
+      in_data                   => r.tag,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => unl_valid,
+      out_ready                 => unl_ready,
+      out_data                  => unl_tag
+    );
+
+  -- The history of decompressed bytes that matches are copied from.
+  history_inst: UtilRam1R1W
+    generic map (
+      WIDTH                     => 8,
+      DEPTH_LOG2                => HDL,
+      RAM_CONFIG                => HISTORY_RAM_CONFIG
+    )
+    port map (
+      w_clk                     => kcd_clk,
+      w_ena                     => ram_wena,
+      w_addr                    => ram_waddr,
+      w_data                    => ram_wdata,
+      r_clk                     => kcd_clk,
+      r_ena                     => ram_rena,
+      r_addr                    => ram_raddr,
+      r_data                    => ram_rdata
+    );
+
+  ram_waddr <= std_logic_vector(r.wpos);
+  ram_raddr <= std_logic_vector(r.wpos - resize(r.offset, HDL));
+
+  seq: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      -- Registers
+      r                         <= d;
+
+      -- Reset
+      if kcd_reset = '1' then
+        r.state                 <= IDLE;
+        r.issue                 <= '0';
+        r.pending               <= (others => '0');
+        r.ovalid                <= '0';
+      end if;
+    end if;
+  end process;
+
+  comb: process(r,
+    kcmd_valid, kcmd_data,
+    chunk_ready,
+    in_valid, in_last, in_data,
+    ram_rdata,
+    kunl_ready,
+    out_ready
+  ) is
+    variable v                  : reg_type;
+    variable b                  : unsigned(7 downto 0);
+    variable sink               : boolean;
+    variable take               : boolean;
+    variable push               : boolean;
+    variable push_data          : std_logic_vector(7 downto 0);
+  begin
+    v := r;
+    b := unsigned(in_data);
+    take := false;
+    push := false;
+    push_data := in_data;
+
+    -- Default outputs
+    kcmd_ready                  <= '0';
+    chunk_valid                 <= '0';
+    in_ready(0)                 <= '0';
+    kunl_valid                  <= '0';
+    ram_wena                    <= '0';
+    ram_rena                    <= '0';
+
+    -- Hand over the output element.
+    if r.ovalid = '1' and out_ready(0) = '1' then
+      v.ovalid                  := '0';
+    end if;
+
+    -- Decompressed bytes can be accepted when no element is waiting.
+    sink := v.ovalid = '0';
+
+    -- Request the next chunk of compressed bytes.
+    if r.issue = '1' and r.pending < MAX_CHUNKS then
+      chunk_valid               <= '1';
+      if chunk_ready = '1' then
+        v.chunk                 := r.chunk + CHUNK_LEN;
+        v.pending               := v.pending + 1;
+      end if;
+    end if;
+
+    case r.state is
+      when IDLE =>
+        -- Wait for the last element of the previous command to be handed over.
+        if sink then
+          kcmd_ready            <= '1';
+        end if;
+        if sink and kcmd_valid = '1' then
+          v.first               := unsigned(kcmd_data(INDEX_WIDTH-1 downto 0));
+          v.last                := unsigned(kcmd_data(2*INDEX_WIDTH-1 downto INDEX_WIDTH));
+          v.addr                := kcmd_data(2*INDEX_WIDTH+BUS_ADDR_WIDTH-1 downto 2*INDEX_WIDTH);
+          v.tag                 := kcmd_data(CMD_WIDTH-1 downto 2*INDEX_WIDTH+BUS_ADDR_WIDTH);
+          v.chunk               := (others => '0');
+          v.cnt                 := (others => '0');
+          v.bcnt                := (others => '0');
+          v.idx                 := (others => '0');
+          v.wpos                := (others => '0');
+          if v.first = v.last then
+            -- Empty commands result in a single transfer without data.
+            v.ovalid            := '1';
+            v.olast             := '1';
+            v.odvalid           := '0';
+            v.state             := UNLOCK;
+          else
+            v.issue             := '1';
+            v.state             := PREFIX;
+          end if;
+        end if;
+
+      when PREFIX | MAGIC | CSIZE | DICTID | BCSUM =>
+        -- Skip the uncompressed length, the magic number, the content size,
+        -- the dictionary ID and block checksums.
+        take                    := true;
+
+      when FLG | BD | HC | BSIZE | TOKEN | LITEXT | OFF0 | OFF1 | MATEXT =>
+        take                    := true;
+
+      when RAW | LITERAL =>
+        -- Copy the byte to the output.
+        take                    := sink;
+
+      when MATCH_RD =>
+        -- Read the byte to copy from the history.
+        ram_rena                <= '1';
+        v.state                 := MATCH_WR;
+
+      when MATCH_WR =>
+        if sink then
+          push                  := true;
+          push_data             := ram_rdata;
+          v.mat                 := r.mat - 1;
+          if r.mat = 1 then
+            v.state             := TOKEN;
+          else
+            v.state             := MATCH_RD;
+          end if;
+        else
+          -- Read the byte again once the output element is handed over.
+          v.state               := MATCH_RD;
+        end if;
+
+      when DRAIN =>
+        -- Discard the remaining bytes of the requested chunks.
+        v.issue                 := '0';
+        take                    := true;
+        if r.pending = 0 and r.issue = '0' then
+          v.state               := UNLOCK;
+        end if;
+
+      when UNLOCK =>
+        kunl_valid              <= '1';
+        if kunl_ready = '1' then
+          v.state               := IDLE;
+        end if;
+
+    end case;
+
+    -- Accept a compressed byte.
+    if take then
+      in_ready(0)               <= '1';
+    end if;
+    if take and in_valid(0) = '1' then
+      if in_last(0) = '1' then
+        v.pending               := v.pending - 1;
+      end if;
+
+      -- Bytes of blocks count towards the block size.
+      case r.state is
+        when RAW | TOKEN | LITEXT | LITERAL | OFF0 | OFF1 | MATEXT =>
+          v.remaining           := r.remaining - 1;
+        when others =>
+          null;
+      end case;
+
+      case r.state is
+        when PREFIX =>
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 7 then
+            v.cnt               := (others => '0');
+            v.state             := MAGIC;
+          end if;
+
+        when MAGIC =>
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 3 then
+            v.cnt               := (others => '0');
+            v.state             := FLG;
+          end if;
+
+        when FLG =>
+          v.flg                 := in_data;
+          v.state               := BD;
+
+        when BD =>
+          if r.flg(3) = '1' then
+            v.state             := CSIZE;
+          elsif r.flg(0) = '1' then
+            v.state             := DICTID;
+          else
+            v.state             := HC;
+          end if;
+
+        when CSIZE =>
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 7 then
+            v.cnt               := (others => '0');
+            if r.flg(0) = '1' then
+              v.state           := DICTID;
+            else
+              v.state           := HC;
+            end if;
+          end if;
+
+        when DICTID =>
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 3 then
+            v.cnt               := (others => '0');
+            v.state             := HC;
+          end if;
+
+        when HC =>
+          v.state               := BSIZE;
+
+        when BSIZE =>
+          v.bsize               := in_data & r.bsize(31 downto 8);
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 3 then
+            v.cnt               := (others => '0');
+            v.remaining         := resize(unsigned(v.bsize(30 downto 0)), 32);
+            if unsigned(v.bsize) = 0 then
+              -- End mark.
+              v.state           := DRAIN;
+            elsif v.bsize(31) = '1' then
+              v.state           := RAW;
+            else
+              v.state           := TOKEN;
+            end if;
+          end if;
+
+        when RAW =>
+          push                  := true;
+
+        when TOKEN =>
+          v.lit                 := resize(b(7 downto 4), 32);
+          v.mat                 := resize(b(3 downto 0), 32) + 4;
+          if b(7 downto 4) = 15 then
+            v.state             := LITEXT;
+          elsif b(7 downto 4) /= 0 then
+            v.state             := LITERAL;
+          elsif v.remaining = 0 then
+            v.state             := BCSUM;
+          else
+            v.state             := OFF0;
+          end if;
+
+        when LITEXT =>
+          v.lit                 := r.lit + b;
+          if b /= 255 then
+            v.state             := LITERAL;
+          end if;
+
+        when LITERAL =>
+          push                  := true;
+          v.lit                 := r.lit - 1;
+          if r.lit = 1 then
+            -- The last sequence of a block only holds literals.
+            if v.remaining = 0 then
+              v.state           := BCSUM;
+            else
+              v.state           := OFF0;
+            end if;
+          end if;
+
+        when OFF0 =>
+          v.offset(7 downto 0)  := b;
+          v.state               := OFF1;
+
+        when OFF1 =>
+          v.offset(15 downto 8) := b;
+          if r.mat = 19 then
+            v.state             := MATEXT;
+          else
+            v.state             := MATCH_RD;
+          end if;
+
+        when MATEXT =>
+          v.mat                 := r.mat + b;
+          if b /= 255 then
+            v.state             := MATCH_RD;
+          end if;
+
+        when BCSUM =>
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 3 then
+            v.cnt               := (others => '0');
+            v.state             := BSIZE;
+          end if;
+
+        when others =>
+          null;
+      end case;
+    end if;
+
+    -- Raw blocks end when all their bytes are copied.
+    if r.state = RAW and v.remaining = 0 then
+      v.state                   := BCSUM;
+    end if;
+
+    -- Skip block checksums if the frame has none.
+    if v.state = BCSUM and r.flg(4) = '0' then
+      v.state                   := BSIZE;
+    end if;
+
+    -- Store a decompressed byte in the history and its element.
+    ram_wdata                   <= push_data;
+    if push then
+      ram_wena                  <= '1';
+      v.wpos                    := r.wpos + 1;
+      v.elem                    := push_data & r.elem(VALUE_WIDTH-1 downto 8);
+      v.bcnt                    := r.bcnt + 1;
+      if r.bcnt = ELEM_BYTES-1 then
+        v.bcnt                  := (others => '0');
+        v.idx                   := r.idx + 1;
+        -- Elements before firstIdx are dropped.
+        if r.idx >= r.first then
+          v.ovalid              := '1';
+          v.odvalid             := '1';
+          v.olast               := '0';
+        end if;
+        if v.idx = r.last then
+          -- All elements were decompressed, so stop decompressing.
+          v.olast               := '1';
+          v.state               := DRAIN;
+        end if;
+      end if;
+    end if;
+
+    d <= v;
+  end process;
+
+  out_valid(0)  <= r.ovalid;
+  out_last(0)   <= r.olast;
+  out_dvalid(0) <= r.odvalid;
+  out_data      <= r.elem;
+
+end Behavioral;
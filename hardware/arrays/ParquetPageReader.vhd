@@ -0,0 +1,730 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+use work.UtilInt_pkg.all;
+use work.UtilRam_pkg.all;
+use work.Interconnect_pkg.all;
+use work.ArrayConfig_pkg.all;
+use work.ArrayConfigParse_pkg.all;
+use work.Array_pkg.all;
+
+-- Reads a Parquet data page of fixed-width values and delivers the decoded
+-- values.
+--
+-- The buffer must hold the body of an uncompressed version 1 data page of a
+-- flat column, i.e. the page without its header. For nullable fields, the
+-- body starts with the byte length of the definition levels as a 32-bit
+-- integer, followed by the definition levels, encoded with the RLE/bit-packed
+-- hybrid encoding with a bit width of 1. The PLAIN-encoded values of the
+-- non-null elements follow. For non-nullable fields, the body only holds the
+-- values. The page bytes are streamed from memory, in chunks of
+-- 2**CHUNK_LEN_LOG2 bytes, until all elements of the command have been
+-- delivered. Like the BufferReaders, the last chunk may be read beyond the
+-- end of the buffer.
+--
+-- The page is decoded from the start for every command. Elements before
+-- firstIdx are decoded and dropped. The definition levels come before all
+-- values, so they are expanded into a validity RAM of 2**LEVEL_DEPTH_LOG2
+-- bits first, which bounds the number of elements of a command.
+--
+-- The output stream is that of an ArrayReader with configuration
+-- prim(<VALUE_WIDTH>), or null(prim(<VALUE_WIDTH>)) for nullable fields.
+-- Commands are processed one at a time. Definition levels are expanded at one
+-- element per kernel clock cycle, and values are decoded at one byte per
+-- cycle.
+entity ParquetPageReader is
+  generic (
+
+    ---------------------------------------------------------------------------
+    -- Bus metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Number of beats in a burst step.
+    BUS_BURST_STEP_LEN          : natural := 4;
+
+    -- Maximum number of beats in a burst.
+    BUS_BURST_MAX_LEN           : natural := 16;
+
+    ---------------------------------------------------------------------------
+    -- Arrow metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Index field width.
+    INDEX_WIDTH                 : natural := 32;
+
+    -- Bit width of the values. Must be a multiple of 8.
+    VALUE_WIDTH                 : natural := 32;
+
+    -- Whether the page holds definition levels, and the output stream holds
+    -- a validity bit.
+    NULLABLE                    : boolean := false;
+
+    ---------------------------------------------------------------------------
+    -- Decoder configuration
+    ---------------------------------------------------------------------------
+    -- Log2 of the maximum number of elements of a command of a nullable
+    -- field.
+    LEVEL_DEPTH_LOG2            : natural := 16;
+
+    -- RAM configuration string for the expanded definition levels.
+    LEVEL_RAM_CONFIG            : string  := "";
+
+    -- Log2 of the number of page bytes requested per chunk.
+    CHUNK_LEN_LOG2              : natural := 6;
+
+    -- Maximum number of chunks that are requested but not yet decoded.
+    MAX_CHUNKS                  : natural := 4;
+
+    -- Number of synchronization stages for the internal command FIFOs. If
+    -- this is zero, the bus and kernel clocks must be the same.
+    XCLK_STAGES                 : natural := 0;
+
+    ---------------------------------------------------------------------------
+    -- Array metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Enables or disables command stream tag system. When enabled, an
+    -- additional output stream is created that returns tags supplied along
+    -- with the command stream when the command has been processed.
+    CMD_TAG_ENABLE              : boolean := false;
+
+    -- Command stream tag width. Must be at least 1 to avoid null vectors.
+    CMD_TAG_WIDTH               : natural := 1
+
+  );
+  port (
+
+    ---------------------------------------------------------------------------
+    -- Clock domains
+    ---------------------------------------------------------------------------
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- bus and control logic side.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- accelerator side, which also holds the decoder.
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- Command streams
+    ---------------------------------------------------------------------------
+    -- Command stream input (bus clock domain). firstIdx (inclusive) and
+    -- lastIdx (exclusive) select a range of decoded values. The ctrl vector
+    -- holds the address of the page buffer.
+    cmd_valid                   : in  std_logic;
+    cmd_ready                   : out std_logic;
+    cmd_firstIdx                : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_lastIdx                 : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_ctrl                    : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    cmd_tag                     : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+
+    -- Unlock stream (bus clock domain). Produces the chunk tags supplied by
+    -- the command stream when the command has been processed.
+    unl_valid                   : out std_logic;
+    unl_ready                   : in  std_logic := '1';
+    unl_tag                     : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    ---------------------------------------------------------------------------
+    -- Bus access ports
+    ---------------------------------------------------------------------------
+    -- Bus access port (bus clock domain).
+    bus_rreq_valid              : out std_logic;
+    bus_rreq_ready              : in  std_logic;
+    bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_rdat_valid              : in  std_logic;
+    bus_rdat_ready              : out std_logic;
+    bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_rdat_last               : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- User streams
+    ---------------------------------------------------------------------------
+    -- Decoded values output stream (kernel clock domain). For nullable
+    -- fields, the most significant bit of the data is the validity bit.
+    out_valid                   : out std_logic_vector(0 downto 0);
+    out_ready                   : in  std_logic_vector(0 downto 0);
+    out_last                    : out std_logic_vector(0 downto 0);
+    out_dvalid                  : out std_logic_vector(0 downto 0);
+    out_data                    : out std_logic_vector(VALUE_WIDTH+boolean'pos(NULLABLE)-1 downto 0)
+
+  );
+end ParquetPageReader;
+
+architecture Behavioral of ParquetPageReader is
+
+  -- The page bytes are read by an ArrayReader of bytes.
+  constant BYTE_CFG             : string  := "prim(8)";
+
+  constant ELEM_BYTES           : natural := VALUE_WIDTH / 8;
+  constant LDL                  : natural := LEVEL_DEPTH_LOG2;
+  constant CHUNK_LEN            : natural := 2**CHUNK_LEN_LOG2;
+
+  -- Command FIFO data: tag, buffer address, lastIdx and firstIdx.
+  constant CMD_WIDTH            : natural := CMD_TAG_WIDTH + BUS_ADDR_WIDTH + 2*INDEX_WIDTH;
+
+  -- Chunk command FIFO data: buffer address, lastIdx and firstIdx in bytes.
+  constant CHUNK_WIDTH          : natural := BUS_ADDR_WIDTH + 2*INDEX_WIDTH;
+
+  -- Command stream, in the bus and kernel clock domains.
+  signal cmd_data               : std_logic_vector(CMD_WIDTH-1 downto 0);
+  signal kcmd_valid             : std_logic;
+  signal kcmd_ready             : std_logic;
+  signal kcmd_data              : std_logic_vector(CMD_WIDTH-1 downto 0);
+
+  -- Chunk command stream, in the kernel and bus clock domains.
+  signal chunk_valid            : std_logic;
+  signal chunk_ready            : std_logic;
+  signal chunk_data             : std_logic_vector(CHUNK_WIDTH-1 downto 0);
+  signal bchunk_valid           : std_logic;
+  signal bchunk_ready           : std_logic;
+  signal bchunk_data            : std_logic_vector(CHUNK_WIDTH-1 downto 0);
+
+  -- Unlock stream in the kernel clock domain.
+  signal kunl_valid             : std_logic;
+  signal kunl_ready             : std_logic;
+
+  -- Page byte stream.
+  signal in_valid               : std_logic_vector(0 downto 0);
+  signal in_ready               : std_logic_vector(0 downto 0);
+  signal in_last                : std_logic_vector(0 downto 0);
+  signal in_data                : std_logic_vector(7 downto 0);
+
+  -- Validity RAM ports.
+  signal ram_wena               : std_logic;
+  signal ram_waddr              : std_logic_vector(LDL-1 downto 0);
+  signal ram_wdata              : std_logic_vector(0 downto 0);
+  signal ram_rena               : std_logic;
+  signal ram_raddr              : std_logic_vector(LDL-1 downto 0);
+  signal ram_rdata              : std_logic_vector(0 downto 0);
+
+  type state_type is (IDLE, LEN, HDR, RLE_VAL, RLE_RUN, PACKED, PACKED_BITS,
+                      SKIP, VALID_RD, VALID_WR, VALUE, DRAIN, UNLOCK);
+
+  type reg_type is record
+    state                       : state_type;
+
+    -- Command.
+    first                       : unsigned(INDEX_WIDTH-1 downto 0);
+    last                        : unsigned(INDEX_WIDTH-1 downto 0);
+    addr                        : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    tag                         : std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    -- Chunk requests.
+    issue                       : std_logic;
+    chunk                       : unsigned(INDEX_WIDTH-1 downto 0);
+    pending                     : unsigned(log2ceil(MAX_CHUNKS+1)-1 downto 0);
+
+    -- Definition levels.
+    cnt                         : unsigned(3 downto 0);
+    lrem                        : unsigned(31 downto 0);
+    hdr                         : unsigned(31 downto 0);
+    run                         : unsigned(31 downto 0);
+    lbit                        : std_logic;
+    pbyte                       : std_logic_vector(7 downto 0);
+    lidx                        : unsigned(INDEX_WIDTH-1 downto 0);
+
+    -- Decoded values.
+    bcnt                        : unsigned(log2ceil(ELEM_BYTES+1)-1 downto 0);
+    idx                         : unsigned(INDEX_WIDTH-1 downto 0);
+
+    -- Output element.
+    ovalid                      : std_logic;
+    olast                       : std_logic;
+    odvalid                     : std_logic;
+    ovalidity                   : std_logic;
+    elem                        : std_logic_vector(VALUE_WIDTH-1 downto 0);
+  end record;
+
+  signal r                      : reg_type;
+  signal d                      : reg_type;
+
+begin
+
+  assert VALUE_WIDTH mod 8 = 0 and VALUE_WIDTH > 0
+    report "ParquetPageReader VALUE_WIDTH must be a positive multiple of 8."
+    severity failure;
+
+  assert LEVEL_DEPTH_LOG2 > 0 and LEVEL_DEPTH_LOG2 <= INDEX_WIDTH
+    report "ParquetPageReader LEVEL_DEPTH_LOG2 must be positive and at most INDEX_WIDTH."
+    severity failure;
+
+  cmd_data <= cmd_tag & cmd_ctrl & cmd_lastIdx & cmd_firstIdx;
+
+  -- Move the commands to the kernel clock domain.
+  cmd_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CMD_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => bcd_clk,
+      in_reset                  => bcd_reset,
+      in_valid                  => cmd_valid,
+      in_ready                  => cmd_ready,
+      in_data                   => cmd_data,
+      out_clk                   => kcd_clk,
+      out_reset                 => kcd_reset,
+      out_valid                 => kcmd_valid,
+      out_ready                 => kcmd_ready,
+      out_data                  => kcmd_data
+    );
+
+  -- Move the chunk commands to the bus clock domain.
+  chunk_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CHUNK_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => chunk_valid,
+      in_ready                  => chunk_ready,
+      in_data                   => chunk_data,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => bchunk_valid,
+      out_ready                 => bchunk_ready,
+      out_data                  => bchunk_data
+    );
+
+  chunk_data <= r.addr
+              & std_logic_vector(r.chunk + CHUNK_LEN)
+              & std_logic_vector(r.chunk);
+
+  -- Stream the page bytes.
+  byte_reader_inst: ArrayReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      CFG                       => BYTE_CFG,
+      CMD_TAG_ENABLE            => false,
+      CMD_TAG_WIDTH             => 1
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmd_valid                 => bchunk_valid,
+      cmd_ready                 => bchunk_ready,
+      cmd_firstIdx              => bchunk_data(INDEX_WIDTH-1 downto 0),
+      cmd_lastIdx               => bchunk_data(2*INDEX_WIDTH-1 downto INDEX_WIDTH),
+      cmd_ctrl                  => bchunk_data(CHUNK_WIDTH-1 downto 2*INDEX_WIDTH),
+
+      unl_valid                 => open,
+      unl_tag                   => open,
+
+      bus_rreq_valid            => bus_rreq_valid,
+      bus_rreq_ready            => bus_rreq_ready,
+      bus_rreq_addr             => bus_rreq_addr,
+      bus_rreq_len              => bus_rreq_len,
+      bus_rdat_valid            => bus_rdat_valid,
+      bus_rdat_ready            => bus_rdat_ready,
+      bus_rdat_data             => bus_rdat_data,
+      bus_rdat_last             => bus_rdat_last,
+
+      out_valid                 => in_valid,
+      out_ready                 => in_ready,
+      out_last                  => in_last,
+      out_dvalid                => open,
+      out_data                  => in_data
+    );
+
+  -- Move the unlock tags back to the bus clock domain.
+  unl_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CMD_TAG_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => kunl_valid,
+      in_ready                  => kunl_ready,
+      in_data                   => r.tag,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => unl_valid,
+      out_ready                 => unl_ready,
+      out_data                  => unl_tag
+    );
+
+  -- The validity of every element, expanded from the definition levels.
+  level_gen: if NULLABLE generate
+    level_inst: UtilRam1R1W
+      generic map (
+        WIDTH                   => 1,
+        DEPTH_LOG2              => LDL,
+        RAM_CONFIG              => LEVEL_RAM_CONFIG
+      )
+      port map (
+        w_clk                   => kcd_clk,
+        w_ena                   => ram_wena,
+        w_addr                  => ram_waddr,
+        w_data                  => ram_wdata,
+        r_clk                   => kcd_clk,
+        r_ena                   => ram_rena,
+        r_addr                  => ram_raddr,
+        r_data                  => ram_rdata
+      );
+  end generate;
+
+  no_level_gen: if not NULLABLE generate
+    ram_rdata <= "1";
+  end generate;
+
+  ram_waddr <= std_logic_vector(resize(r.lidx, LDL));
+  ram_raddr <= std_logic_vector(resize(r.idx, LDL));
+
+  seq: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      -- Registers
+      r                         <= d;
+
+      -- Reset
+      if kcd_reset = '1' then
+        r.state                 <= IDLE;
+        r.issue                 <= '0';
+        r.pending               <= (others => '0');
+        r.ovalid                <= '0';
+      end if;
+    end if;
+  end process;
+
+  comb: process(r,
+    kcmd_valid, kcmd_data,
+    chunk_ready,
+    in_valid, in_last, in_data,
+    ram_rdata,
+    kunl_ready,
+    out_ready
+  ) is
+    variable v                  : reg_type;
+    variable b                  : unsigned(7 downto 0);
+    variable sink               : boolean;
+    variable take               : boolean;
+    variable level              : boolean;
+    variable level_bit          : std_logic;
+    variable run_done           : boolean;
+    variable levels_done        : boolean;
+    variable elem_done          : boolean;
+    variable elem_validity      : std_logic;
+  begin
+    v := r;
+    b := unsigned(in_data);
+    take := false;
+    level := false;
+    level_bit := '0';
+    run_done := false;
+    levels_done := false;
+    elem_done := false;
+    elem_validity := '1';
+
+    -- Default outputs
+    kcmd_ready                  <= '0';
+    chunk_valid                 <= '0';
+    in_ready(0)                 <= '0';
+    kunl_valid                  <= '0';
+    ram_wena                    <= '0';
+    ram_rena                    <= '0';
+
+    -- Hand over the output element.
+    if r.ovalid = '1' and out_ready(0) = '1' then
+      v.ovalid                  := '0';
+    end if;
+
+    -- Elements can be decoded when no element is waiting.
+    sink := v.ovalid = '0';
+
+    -- Request the next chunk of page bytes.
+    if r.issue = '1' and r.pending < MAX_CHUNKS then
+      chunk_valid               <= '1';
+      if chunk_ready = '1' then
+        v.chunk                 := r.chunk + CHUNK_LEN;
+        v.pending               := v.pending + 1;
+      end if;
+    end if;
+
+    case r.state is
+      when IDLE =>
+        -- Wait for the last element of the previous command to be handed over.
+        if sink then
+          kcmd_ready            <= '1';
+        end if;
+        if sink and kcmd_valid = '1' then
+          v.first               := unsigned(kcmd_data(INDEX_WIDTH-1 downto 0));
+          v.last                := unsigned(kcmd_data(2*INDEX_WIDTH-1 downto INDEX_WIDTH));
+          v.addr                := kcmd_data(2*INDEX_WIDTH+BUS_ADDR_WIDTH-1 downto 2*INDEX_WIDTH);
+          v.tag                 := kcmd_data(CMD_WIDTH-1 downto 2*INDEX_WIDTH+BUS_ADDR_WIDTH);
+          v.chunk               := (others => '0');
+          v.cnt                 := (others => '0');
+          v.bcnt                := (others => '0');
+          v.lidx                := (others => '0');
+          v.idx                 := (others => '0');
+          if v.first = v.last then
+            -- Empty commands result in a single transfer without data.
+            v.ovalid            := '1';
+            v.olast             := '1';
+            v.odvalid           := '0';
+            v.state             := UNLOCK;
+          else
+            v.issue             := '1';
+            if NULLABLE then
+              v.state           := LEN;
+            else
+              v.state           := VALUE;
+            end if;
+          end if;
+        end if;
+
+      when LEN | HDR | RLE_VAL | PACKED | SKIP =>
+        take                    := true;
+
+      when RLE_RUN =>
+        -- Expand the repeated level.
+        level                   := true;
+        level_bit               := r.lbit;
+        v.run                   := r.run - 1;
+        if r.run = 1 then
+          run_done              := true;
+        end if;
+
+      when PACKED_BITS =>
+        -- Expand the bit-packed levels, least significant bit first.
+        level                   := true;
+        level_bit               := r.pbyte(to_integer(r.cnt(2 downto 0)));
+        v.cnt                   := r.cnt + 1;
+        if r.cnt = 7 then
+          v.run                 := r.run - 1;
+          if r.run = 1 then
+            run_done            := true;
+          else
+            v.state             := PACKED;
+          end if;
+        end if;
+
+      when VALID_RD =>
+        -- Read the validity of the next element.
+        ram_rena                <= '1';
+        v.state                 := VALID_WR;
+
+      when VALID_WR =>
+        if ram_rdata(0) = '1' then
+          v.state               := VALUE;
+        elsif sink then
+          -- Null elements have no value in the page.
+          elem_done             := true;
+          elem_validity         := '0';
+          v.elem                := (others => '0');
+        else
+          -- Read the validity again once the output element is handed over.
+          v.state               := VALID_RD;
+        end if;
+
+      when VALUE =>
+        -- Copy the byte to the output.
+        take                    := sink;
+
+      when DRAIN =>
+        -- Discard the remaining bytes of the requested chunks.
+        v.issue                 := '0';
+        take                    := true;
+        if r.pending = 0 and r.issue = '0' then
+          v.state               := UNLOCK;
+        end if;
+
+      when UNLOCK =>
+        kunl_valid              <= '1';
+        if kunl_ready = '1' then
+          v.state               := IDLE;
+        end if;
+
+    end case;
+
+    -- Accept a page byte.
+    if take then
+      in_ready(0)               <= '1';
+    end if;
+    if take and in_valid(0) = '1' then
+      if in_last(0) = '1' then
+        v.pending               := v.pending - 1;
+      end if;
+
+      -- Bytes of the definition levels count towards their length.
+      case r.state is
+        when HDR | RLE_VAL | PACKED | SKIP =>
+          v.lrem                := r.lrem - 1;
+        when others =>
+          null;
+      end case;
+
+      case r.state is
+        when LEN =>
+          -- The byte length of the definition levels, in little-endian order.
+          v.lrem                := b & r.lrem(31 downto 8);
+          v.cnt                 := r.cnt + 1;
+          if r.cnt = 3 then
+            v.cnt               := (others => '0');
+            v.hdr               := (others => '0');
+            if v.lrem = 0 then
+              levels_done       := true;
+            else
+              v.state           := HDR;
+            end if;
+          end if;
+
+        when HDR =>
+          -- The run header is an unsigned LEB128 integer. Its least
+          -- significant bit selects a bit-packed or an RLE run.
+          v.hdr                 := r.hdr or shift_left(resize(b(6 downto 0), 32), 7*to_integer(r.cnt(2 downto 0)));
+          v.cnt                 := r.cnt + 1;
+          if b(7) = '0' then
+            v.cnt               := (others => '0');
+            v.run               := shift_right(v.hdr, 1);
+            if v.hdr(0) = '1' then
+              -- The number of groups of 8 levels, which take a byte each.
+              v.state           := PACKED;
+              if v.run = 0 then
+                run_done        := true;
+              end if;
+            else
+              v.state           := RLE_VAL;
+            end if;
+          end if;
+
+        when RLE_VAL =>
+          -- The repeated level is padded to a byte.
+          v.lbit                := in_data(0);
+          v.state               := RLE_RUN;
+          if r.run = 0 then
+            run_done            := true;
+          end if;
+
+        when PACKED =>
+          v.pbyte               := in_data;
+          v.cnt                 := (others => '0');
+          v.state               := PACKED_BITS;
+
+        when SKIP =>
+          -- Discard the levels of elements beyond the command.
+          if v.lrem = 0 then
+            v.state             := VALID_RD;
+          end if;
+
+        when VALUE =>
+          v.elem                := in_data & r.elem(VALUE_WIDTH-1 downto 8);
+          v.bcnt                := r.bcnt + 1;
+          if r.bcnt = ELEM_BYTES-1 then
+            elem_done           := true;
+          end if;
+
+        when others =>
+          null;
+      end case;
+    end if;
+
+    -- Store an expanded level in the validity RAM.
+    ram_wdata(0)                <= level_bit;
+    if level then
+      ram_wena                  <= '1';
+      v.lidx                    := r.lidx + 1;
+      if v.lidx = r.last then
+        levels_done             := true;
+      end if;
+    end if;
+
+    -- Decode the next run header once a run is exhausted.
+    if run_done then
+      v.hdr                     := (others => '0');
+      v.cnt                     := (others => '0');
+      if v.lrem = 0 then
+        levels_done             := true;
+      else
+        v.state                 := HDR;
+      end if;
+    end if;
+
+    -- Decode the values once the levels of all elements of the command are
+    -- known, skipping the remaining levels.
+    if levels_done then
+      if v.lrem = 0 then
+        v.state                 := VALID_RD;
+      else
+        v.state                 := SKIP;
+      end if;
+    end if;
+
+    -- Deliver a decoded element.
+    if elem_done then
+      v.bcnt                    := (others => '0');
+      v.idx                     := r.idx + 1;
+      -- Elements before firstIdx are dropped.
+      if r.idx >= r.first then
+        v.ovalid                := '1';
+        v.odvalid               := '1';
+        v.olast                 := '0';
+        v.ovalidity             := elem_validity;
+      end if;
+      if v.idx = r.last then
+        -- All elements were decoded, so stop decoding.
+        v.olast                 := '1';
+        v.state                 := DRAIN;
+      elsif NULLABLE then
+        v.state                 := VALID_RD;
+      else
+        v.state                 := VALUE;
+      end if;
+    end if;
+
+    d <= v;
+  end process;
+
+  out_valid(0)  <= r.ovalid;
+  out_last(0)   <= r.olast;
+  out_dvalid(0) <= r.odvalid;
+
+  null_gen: if NULLABLE generate
+    out_data    <= r.ovalidity & r.elem;
+  end generate;
+
+  no_null_gen: if not NULLABLE generate
+    out_data    <= r.elem;
+  end generate;
+
+end Behavioral;
@@ -0,0 +1,663 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+use work.UtilInt_pkg.all;
+use work.Interconnect_pkg.all;
+use work.ArrayConfig_pkg.all;
+use work.ArrayConfigParse_pkg.all;
+use work.Array_pkg.all;
+
+-- Reads a run-end encoded Arrow array of fixed-width values and delivers the
+-- expanded values.
+--
+-- The array consists of a buffer of 32-bit run ends and a buffer with the
+-- value of every run. The run end of a run is the index one past its last
+-- element. Only the runs are streamed from memory, in chunks of
+-- 2**CHUNK_LEN_LOG2 runs, until all elements of the command have been
+-- delivered, such that the bus traffic scales with the number of runs rather
+-- than the number of elements. Like the BufferReaders, the last chunk may be
+-- read beyond the end of the buffers.
+--
+-- CFG is the configuration string of an ArrayReader of the expanded values,
+-- i.e. prim(<width>;epc=<n>), which also determines the output stream. The
+-- runs are expanded from the first run for every command. Runs that end
+-- before firstIdx are dropped at one run per cycle.
+--
+-- Commands are processed one at a time. Every kernel clock cycle, up to epc
+-- elements of the current run are added to the output transfer, and the next
+-- run is accepted once the current run is exhausted. Transfers are complete,
+-- i.e. hold epc elements, except for the last transfer of a command.
+entity RunEndReader is
+  generic (
+
+    ---------------------------------------------------------------------------
+    -- Bus metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Number of beats in a burst step.
+    BUS_BURST_STEP_LEN          : natural := 4;
+
+    -- Maximum number of beats in a burst.
+    BUS_BURST_MAX_LEN           : natural := 16;
+
+    ---------------------------------------------------------------------------
+    -- Arrow metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Index field width.
+    INDEX_WIDTH                 : natural := 32;
+
+    -- Configuration string of the expanded values.
+    CFG                         : string  := "prim(32)";
+
+    ---------------------------------------------------------------------------
+    -- Expander configuration
+    ---------------------------------------------------------------------------
+    -- Log2 of the number of runs requested per chunk.
+    CHUNK_LEN_LOG2              : natural := 4;
+
+    -- Maximum number of chunks that are requested but not yet expanded.
+    MAX_CHUNKS                  : natural := 4;
+
+    -- Number of synchronization stages for the internal command FIFOs. If
+    -- this is zero, the bus and kernel clocks must be the same.
+    XCLK_STAGES                 : natural := 0;
+
+    ---------------------------------------------------------------------------
+    -- Array metrics and configuration
+    ---------------------------------------------------------------------------
+    -- Enables or disables command stream tag system. When enabled, an
+    -- additional output stream is created that returns tags supplied along
+    -- with the command stream when the command has been processed.
+    CMD_TAG_ENABLE              : boolean := false;
+
+    -- Command stream tag width. Must be at least 1 to avoid null vectors.
+    CMD_TAG_WIDTH               : natural := 1
+
+  );
+  port (
+
+    ---------------------------------------------------------------------------
+    -- Clock domains
+    ---------------------------------------------------------------------------
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- bus and control logic side.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Rising-edge sensitive clock and active-high synchronous reset for the
+    -- accelerator side, which also holds the expander.
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- Command streams
+    ---------------------------------------------------------------------------
+    -- Command stream input (bus clock domain). firstIdx (inclusive) and
+    -- lastIdx (exclusive) select a range of expanded values. The ctrl vector
+    -- holds the run ends buffer address in the lower half and the values
+    -- buffer address in the upper half.
+    cmd_valid                   : in  std_logic;
+    cmd_ready                   : out std_logic;
+    cmd_firstIdx                : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_lastIdx                 : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    cmd_ctrl                    : in  std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+    cmd_tag                     : in  std_logic_vector(CMD_TAG_WIDTH-1 downto 0) := (others => '0');
+
+    -- Unlock stream (bus clock domain). Produces the chunk tags supplied by
+    -- the command stream when the command has been processed.
+    unl_valid                   : out std_logic;
+    unl_ready                   : in  std_logic := '1';
+    unl_tag                     : out std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    ---------------------------------------------------------------------------
+    -- Bus access ports
+    ---------------------------------------------------------------------------
+    -- Bus access port (bus clock domain).
+    bus_rreq_valid              : out std_logic;
+    bus_rreq_ready              : in  std_logic;
+    bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_rdat_valid              : in  std_logic;
+    bus_rdat_ready              : out std_logic;
+    bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_rdat_last               : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- User streams
+    ---------------------------------------------------------------------------
+    -- Expanded values output stream (kernel clock domain), like the output
+    -- stream of an ArrayReader with configuration CFG.
+    out_valid                   : out std_logic_vector(0 downto 0);
+    out_ready                   : in  std_logic_vector(0 downto 0);
+    out_last                    : out std_logic_vector(0 downto 0);
+    out_dvalid                  : out std_logic_vector(0 downto 0);
+    out_data                    : out std_logic_vector(arcfg_userWidth(CFG, INDEX_WIDTH)-1 downto 0)
+
+  );
+end RunEndReader;
+
+architecture Behavioral of RunEndReader is
+
+  -- Dimensions of the expanded values.
+  constant VALUE_WIDTH          : natural := strtoi(parse_arg(CFG, 0));
+  constant EPC                  : natural := parse_param(CFG, "epc", 1);
+  constant COUNT_WIDTH          : natural := log2ceil(EPC+1);
+
+  -- Configuration strings of the run ends and values ArrayReaders.
+  constant RUN_END_WIDTH        : natural := 32;
+  constant RE_CFG               : string  := "prim(" & integer'image(RUN_END_WIDTH) & ")";
+  constant VAL_CFG              : string  := "prim(" & integer'image(VALUE_WIDTH) & ")";
+
+  constant CHUNK_LEN            : natural := 2**CHUNK_LEN_LOG2;
+
+  -- Command FIFO data: tag, buffer addresses, lastIdx and firstIdx.
+  constant CMD_WIDTH            : natural := CMD_TAG_WIDTH + 2*BUS_ADDR_WIDTH + 2*INDEX_WIDTH;
+
+  -- Chunk command FIFO data: buffer addresses, lastIdx and firstIdx in runs.
+  constant CHUNK_WIDTH          : natural := 2*BUS_ADDR_WIDTH + 2*INDEX_WIDTH;
+
+  -- Command stream, in the bus and kernel clock domains.
+  signal cmd_data               : std_logic_vector(CMD_WIDTH-1 downto 0);
+  signal kcmd_valid             : std_logic;
+  signal kcmd_ready             : std_logic;
+  signal kcmd_data              : std_logic_vector(CMD_WIDTH-1 downto 0);
+
+  -- Chunk command stream, in the kernel and bus clock domains.
+  signal chunk_valid            : std_logic;
+  signal chunk_ready            : std_logic;
+  signal chunk_data             : std_logic_vector(CHUNK_WIDTH-1 downto 0);
+  signal bchunk_valid           : std_logic;
+  signal bchunk_ready           : std_logic;
+  signal bchunk_data            : std_logic_vector(CHUNK_WIDTH-1 downto 0);
+  signal bchunk_first           : std_logic_vector(INDEX_WIDTH-1 downto 0);
+  signal bchunk_last            : std_logic_vector(INDEX_WIDTH-1 downto 0);
+
+  -- Chunk command streams to the run ends and values ArrayReaders.
+  signal recmd_valid            : std_logic;
+  signal recmd_ready            : std_logic;
+  signal vcmd_valid             : std_logic;
+  signal vcmd_ready             : std_logic;
+
+  -- Unlock stream in the kernel clock domain.
+  signal kunl_valid             : std_logic;
+  signal kunl_ready             : std_logic;
+
+  -- Run end stream.
+  signal re_valid               : std_logic_vector(0 downto 0);
+  signal re_ready               : std_logic_vector(0 downto 0);
+  signal re_last                : std_logic_vector(0 downto 0);
+  signal re_data                : std_logic_vector(RUN_END_WIDTH-1 downto 0);
+
+  -- Run value stream.
+  signal val_valid              : std_logic_vector(0 downto 0);
+  signal val_ready              : std_logic_vector(0 downto 0);
+  signal val_data               : std_logic_vector(VALUE_WIDTH-1 downto 0);
+
+  -- Bus ports of the run ends (0) and values (1) ArrayReaders.
+  signal bsv_rreq_valid         : std_logic_vector(1 downto 0);
+  signal bsv_rreq_ready         : std_logic_vector(1 downto 0);
+  signal bsv_rreq_addr          : std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+  signal bsv_rreq_len           : std_logic_vector(2*BUS_LEN_WIDTH-1 downto 0);
+  signal bsv_rdat_valid         : std_logic_vector(1 downto 0);
+  signal bsv_rdat_ready         : std_logic_vector(1 downto 0);
+  signal bsv_rdat_data          : std_logic_vector(2*BUS_DATA_WIDTH-1 downto 0);
+  signal bsv_rdat_last          : std_logic_vector(1 downto 0);
+
+  type state_type is (IDLE, RUN, DRAIN, UNLOCK);
+
+  type reg_type is record
+    state                       : state_type;
+
+    -- Command.
+    last                        : unsigned(INDEX_WIDTH-1 downto 0);
+    addr                        : std_logic_vector(2*BUS_ADDR_WIDTH-1 downto 0);
+    tag                         : std_logic_vector(CMD_TAG_WIDTH-1 downto 0);
+
+    -- Chunk requests.
+    issue                       : std_logic;
+    chunk                       : unsigned(INDEX_WIDTH-1 downto 0);
+    pending                     : unsigned(log2ceil(MAX_CHUNKS+1)-1 downto 0);
+
+    -- Index of the next element to deliver.
+    idx                         : unsigned(INDEX_WIDTH-1 downto 0);
+
+    -- Current run.
+    have                        : std_logic;
+    rend                        : unsigned(INDEX_WIDTH-1 downto 0);
+    value                       : std_logic_vector(VALUE_WIDTH-1 downto 0);
+
+    -- Output transfer, which is filled while it is not valid.
+    ovalid                      : std_logic;
+    olast                       : std_logic;
+    odvalid                     : std_logic;
+    ocount                      : unsigned(COUNT_WIDTH-1 downto 0);
+    odata                       : std_logic_vector(EPC*VALUE_WIDTH-1 downto 0);
+  end record;
+
+  signal r                      : reg_type;
+  signal d                      : reg_type;
+
+begin
+
+  assert parse_command(CFG) = "prim"
+    report "RunEndReader CFG must be a prim configuration."
+    severity failure;
+
+  cmd_data <= cmd_tag & cmd_ctrl & cmd_lastIdx & cmd_firstIdx;
+
+  -- Move the commands to the kernel clock domain.
+  cmd_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CMD_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => bcd_clk,
+      in_reset                  => bcd_reset,
+      in_valid                  => cmd_valid,
+      in_ready                  => cmd_ready,
+      in_data                   => cmd_data,
+      out_clk                   => kcd_clk,
+      out_reset                 => kcd_reset,
+      out_valid                 => kcmd_valid,
+      out_ready                 => kcmd_ready,
+      out_data                  => kcmd_data
+    );
+
+  -- Move the chunk commands to the bus clock domain.
+  chunk_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CHUNK_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => chunk_valid,
+      in_ready                  => chunk_ready,
+      in_data                   => chunk_data,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => bchunk_valid,
+      out_ready                 => bchunk_ready,
+      out_data                  => bchunk_data
+    );
+
+  chunk_data <= r.addr
+              & std_logic_vector(r.chunk + CHUNK_LEN)
+              & std_logic_vector(r.chunk);
+
+  bchunk_first <= bchunk_data(INDEX_WIDTH-1 downto 0);
+  bchunk_last  <= bchunk_data(2*INDEX_WIDTH-1 downto INDEX_WIDTH);
+
+  -- Both ArrayReaders read the same chunk of runs.
+  chunk_split_inst: StreamSync
+    generic map (
+      NUM_INPUTS                => 1,
+      NUM_OUTPUTS               => 2
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+
+      in_valid(0)               => bchunk_valid,
+      in_ready(0)               => bchunk_ready,
+
+      out_valid(1)              => vcmd_valid,
+      out_valid(0)              => recmd_valid,
+      out_ready(1)              => vcmd_ready,
+      out_ready(0)              => recmd_ready
+    );
+
+  -- Stream the run ends.
+  re_reader_inst: ArrayReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      CFG                       => RE_CFG,
+      CMD_TAG_ENABLE            => false,
+      CMD_TAG_WIDTH             => 1
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmd_valid                 => recmd_valid,
+      cmd_ready                 => recmd_ready,
+      cmd_firstIdx              => bchunk_first,
+      cmd_lastIdx               => bchunk_last,
+      cmd_ctrl                  => bchunk_data(2*INDEX_WIDTH+BUS_ADDR_WIDTH-1 downto 2*INDEX_WIDTH),
+
+      unl_valid                 => open,
+      unl_tag                   => open,
+
+      bus_rreq_valid            => bsv_rreq_valid(0),
+      bus_rreq_ready            => bsv_rreq_ready(0),
+      bus_rreq_addr             => bsv_rreq_addr(BUS_ADDR_WIDTH-1 downto 0),
+      bus_rreq_len              => bsv_rreq_len(BUS_LEN_WIDTH-1 downto 0),
+      bus_rdat_valid            => bsv_rdat_valid(0),
+      bus_rdat_ready            => bsv_rdat_ready(0),
+      bus_rdat_data             => bsv_rdat_data(BUS_DATA_WIDTH-1 downto 0),
+      bus_rdat_last             => bsv_rdat_last(0),
+
+      out_valid                 => re_valid,
+      out_ready                 => re_ready,
+      out_last                  => re_last,
+      out_dvalid                => open,
+      out_data                  => re_data
+    );
+
+  -- Stream the value of every run.
+  val_reader_inst: ArrayReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      CFG                       => VAL_CFG,
+      CMD_TAG_ENABLE            => false,
+      CMD_TAG_WIDTH             => 1
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmd_valid                 => vcmd_valid,
+      cmd_ready                 => vcmd_ready,
+      cmd_firstIdx              => bchunk_first,
+      cmd_lastIdx               => bchunk_last,
+      cmd_ctrl                  => bchunk_data(CHUNK_WIDTH-1 downto 2*INDEX_WIDTH+BUS_ADDR_WIDTH),
+
+      unl_valid                 => open,
+      unl_tag                   => open,
+
+      bus_rreq_valid            => bsv_rreq_valid(1),
+      bus_rreq_ready            => bsv_rreq_ready(1),
+      bus_rreq_addr             => bsv_rreq_addr(2*BUS_ADDR_WIDTH-1 downto BUS_ADDR_WIDTH),
+      bus_rreq_len              => bsv_rreq_len(2*BUS_LEN_WIDTH-1 downto BUS_LEN_WIDTH),
+      bus_rdat_valid            => bsv_rdat_valid(1),
+      bus_rdat_ready            => bsv_rdat_ready(1),
+      bus_rdat_data             => bsv_rdat_data(2*BUS_DATA_WIDTH-1 downto BUS_DATA_WIDTH),
+      bus_rdat_last             => bsv_rdat_last(1),
+
+      out_valid                 => val_valid,
+      out_ready                 => val_ready,
+      out_last                  => open,
+      out_dvalid                => open,
+      out_data                  => val_data
+    );
+
+  -- Share the bus between the run ends and values readers.
+  arb_inst: BusReadArbiterVec
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      NUM_SLAVE_PORTS           => 2
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+
+      mst_rreq_valid            => bus_rreq_valid,
+      mst_rreq_ready            => bus_rreq_ready,
+      mst_rreq_addr             => bus_rreq_addr,
+      mst_rreq_len              => bus_rreq_len,
+      mst_rdat_valid            => bus_rdat_valid,
+      mst_rdat_ready            => bus_rdat_ready,
+      mst_rdat_data             => bus_rdat_data,
+      mst_rdat_last             => bus_rdat_last,
+
+      bsv_rreq_valid            => bsv_rreq_valid,
+      bsv_rreq_ready            => bsv_rreq_ready,
+      bsv_rreq_addr             => bsv_rreq_addr,
+      bsv_rreq_len              => bsv_rreq_len,
+      bsv_rdat_valid            => bsv_rdat_valid,
+      bsv_rdat_ready            => bsv_rdat_ready,
+      bsv_rdat_data             => bsv_rdat_data,
+      bsv_rdat_last             => bsv_rdat_last
+    );
+
+  -- Move the unlock tags back to the bus clock domain.
+  unl_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                => 2,
+      DATA_WIDTH                => CMD_TAG_WIDTH,
+      XCLK_STAGES               => XCLK_STAGES
+    )
+    port map (
+      in_clk                    => kcd_clk,
+      in_reset                  => kcd_reset,
+      in_valid                  => kunl_valid,
+      in_ready                  => kunl_ready,
+      in_data                   => r.tag,
+      out_clk                   => bcd_clk,
+      out_reset                 => bcd_reset,
+      out_valid                 => unl_valid,
+      out_ready                 => unl_ready,
+      out_data                  => unl_tag
+    );
+
+  seq: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      -- Registers
+      r                         <= d;
+
+      -- Reset
+      if kcd_reset = '1' then
+        r.state                 <= IDLE;
+        r.issue                 <= '0';
+        r.pending               <= (others => '0');
+        r.have                  <= '0';
+        r.ovalid                <= '0';
+        r.ocount                <= (others => '0');
+      end if;
+    end if;
+  end process;
+
+  comb: process(r,
+    kcmd_valid, kcmd_data,
+    chunk_ready,
+    re_valid, re_last, re_data,
+    val_valid, val_data,
+    kunl_ready,
+    out_ready
+  ) is
+    variable v                  : reg_type;
+    variable sink               : boolean;
+    variable take               : boolean;
+    variable hi                 : unsigned(INDEX_WIDTH-1 downto 0);
+    variable n                  : unsigned(INDEX_WIDTH-1 downto 0);
+    variable k                  : natural range 0 to EPC;
+    variable base               : natural range 0 to EPC;
+  begin
+    v := r;
+    take := false;
+
+    -- Default outputs
+    kcmd_ready                  <= '0';
+    chunk_valid                 <= '0';
+    re_ready(0)                 <= '0';
+    val_ready(0)                <= '0';
+    kunl_valid                  <= '0';
+
+    -- Hand over the output transfer, and start filling the next one.
+    if r.ovalid = '1' and out_ready(0) = '1' then
+      v.ovalid                  := '0';
+      v.ocount                  := (others => '0');
+    end if;
+
+    -- Elements can be added when no transfer is waiting.
+    sink := v.ovalid = '0';
+
+    -- Request the next chunk of runs.
+    if r.issue = '1' and r.pending < MAX_CHUNKS then
+      chunk_valid               <= '1';
+      if chunk_ready = '1' then
+        v.chunk                 := r.chunk + CHUNK_LEN;
+        v.pending               := v.pending + 1;
+      end if;
+    end if;
+
+    case r.state is
+      when IDLE =>
+        -- Wait for the last transfer of the previous command to be handed over.
+        if sink then
+          kcmd_ready            <= '1';
+        end if;
+        if sink and kcmd_valid = '1' then
+          -- Elements before firstIdx are never delivered.
+          v.idx                 := unsigned(kcmd_data(INDEX_WIDTH-1 downto 0));
+          v.last                := unsigned(kcmd_data(2*INDEX_WIDTH-1 downto INDEX_WIDTH));
+          v.addr                := kcmd_data(2*INDEX_WIDTH+2*BUS_ADDR_WIDTH-1 downto 2*INDEX_WIDTH);
+          v.tag                 := kcmd_data(CMD_WIDTH-1 downto 2*INDEX_WIDTH+2*BUS_ADDR_WIDTH);
+          v.chunk               := (others => '0');
+          v.have                := '0';
+          if v.idx = v.last then
+            -- Empty commands result in a single transfer without data.
+            v.ovalid            := '1';
+            v.olast             := '1';
+            v.odvalid           := '0';
+            v.state             := UNLOCK;
+          else
+            v.issue             := '1';
+            v.state             := RUN;
+          end if;
+        end if;
+
+      when RUN =>
+        if r.have = '1' then
+          if r.rend < r.last then
+            hi                  := r.rend;
+          else
+            hi                  := r.last;
+          end if;
+
+          if r.idx >= hi then
+            -- The run ends before the next element, so drop it.
+            v.have              := '0';
+
+          elsif sink then
+            -- Add as many elements of the run as fit in the output transfer.
+            base                := to_integer(v.ocount);
+            n                   := hi - r.idx;
+            if n < EPC - base then
+              k                 := to_integer(n(COUNT_WIDTH-1 downto 0));
+            else
+              k                 := EPC - base;
+            end if;
+            for i in 0 to EPC-1 loop
+              if i >= base and i < base + k then
+                v.odata((i+1)*VALUE_WIDTH-1 downto i*VALUE_WIDTH) := r.value;
+              end if;
+            end loop;
+            v.ocount            := to_unsigned(base + k, COUNT_WIDTH);
+            v.idx               := r.idx + k;
+            if v.idx = hi then
+              v.have            := '0';
+            end if;
+
+            if v.idx = r.last then
+              -- All elements were delivered, so stop reading runs.
+              v.ovalid          := '1';
+              v.olast           := '1';
+              v.odvalid         := '1';
+              v.state           := DRAIN;
+            elsif base + k = EPC then
+              v.ovalid          := '1';
+              v.olast           := '0';
+              v.odvalid         := '1';
+            end if;
+          end if;
+        end if;
+
+        -- Accept the next run once the current one is exhausted.
+        take                    := v.state = RUN and v.have = '0';
+
+      when DRAIN =>
+        -- Discard the remaining runs of the requested chunks.
+        v.issue                 := '0';
+        take                    := true;
+        if r.pending = 0 and r.issue = '0' then
+          v.state               := UNLOCK;
+        end if;
+
+      when UNLOCK =>
+        kunl_valid              <= '1';
+        if kunl_ready = '1' then
+          v.state               := IDLE;
+        end if;
+
+    end case;
+
+    -- Accept the run end and value of a run at the same time.
+    if take then
+      re_ready(0)               <= val_valid(0);
+      val_ready(0)              <= re_valid(0);
+    end if;
+    if take and re_valid(0) = '1' and val_valid(0) = '1' then
+      if re_last(0) = '1' then
+        v.pending               := v.pending - 1;
+      end if;
+      if r.state = RUN then
+        v.have                  := '1';
+        v.rend                  := resize(unsigned(re_data), INDEX_WIDTH);
+        v.value                 := val_data;
+      end if;
+    end if;
+
+    d <= v;
+  end process;
+
+  out_valid(0)  <= r.ovalid;
+  out_last(0)   <= r.olast;
+  out_dvalid(0) <= r.odvalid;
+
+  -- The count precedes the elements when more than one element is delivered
+  -- per transfer, like for ArrayReaders.
+  epc_gen: if EPC > 1 generate
+    out_data <= std_logic_vector(r.ocount) & r.odata;
+  end generate;
+  no_epc_gen: if EPC = 1 generate
+    out_data <= r.odata;
+  end generate;
+
+end Behavioral;
@@ -28,6 +28,16 @@ package Arrow_pkg is
   -----------------------------------------------------------------------------
   constant FLETCHER_REG_WIDTH   : natural := 32;
 
+  -----------------------------------------------------------------------------
+  -- Partitioned output
+  -----------------------------------------------------------------------------
+  -- Returns the partition of a row of a partitioned write schema with the
+  -- given key, out of the given number of partitions. The key is the
+  -- zero-extended value of the key field, of at most 64 bits. This matches
+  -- fletcher::PartitionOf() of the run-time, so the host can tell in which
+  -- partition to find a row.
+  function partition_of(key : std_logic_vector; partitions : positive) return natural;
+
   component UserCoreMock is
     generic (
       NUM_REQUESTS              : natural;
@@ -75,3 +85,22 @@ package Arrow_pkg is
   end component;
   
 end Arrow_pkg;
+
+package body Arrow_pkg is
+
+  function partition_of(key : std_logic_vector; partitions : positive) return natural is
+    constant GOLDEN : unsigned(31 downto 0) := X"9E3779B1";
+    variable k      : unsigned(63 downto 0);
+    variable h      : unsigned(63 downto 0);
+    variable p      : unsigned(63 downto 0);
+  begin
+    -- Fold the key to 32 bits, and hash it by multiplying by the golden ratio.
+    k := resize(unsigned(key), 64);
+    h := (k(63 downto 32) xor k(31 downto 0)) * GOLDEN;
+    -- The upper half of the product of the hash and the number of partitions
+    -- is the partition.
+    p := h(31 downto 0) * to_unsigned(partitions, 32);
+    return to_integer(p(63 downto 32));
+  end function;
+
+end Arrow_pkg;
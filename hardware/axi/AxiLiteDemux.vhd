@@ -0,0 +1,258 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.std_logic_misc.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.UtilInt_pkg.all;
+
+-- Routes an AXI4-lite slave port to one of several AXI4-lite master ports,
+-- such that every master port is mapped to its own window of the address
+-- space. Window i starts at byte address i * 2**WINDOW_ADDR_WIDTH. Only the
+-- address bits within the window are passed to the master ports; all higher
+-- bits are zero. Accesses beyond the last window are routed to the last
+-- master port.
+--
+-- One read and one write transaction can be outstanding at a time, which is
+-- sufficient for MMIO traffic from a host.
+--
+-- The master ports are concatenated, with master port i occupying index i
+-- (or the i-th slice of vectors).
+entity AxiLiteDemux is
+  generic (
+    ---------------------------------------------------------------------------
+    -- Bus metrics and configuration
+    ---------------------------------------------------------------------------
+    BUS_ADDR_WIDTH              : natural := 32;
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Number of address bits of every window.
+    WINDOW_ADDR_WIDTH           : natural := 16;
+
+    -- Number of master ports.
+    NUM_MASTER_PORTS            : natural := 2
+  );
+  port (
+    clk                         : in  std_logic;
+    reset_n                     : in  std_logic;
+
+    ---------------------------------------------------------------------------
+    -- AXI4-lite slave port
+    ---------------------------------------------------------------------------
+    -- Write address channel
+    s_axi_awvalid               : in  std_logic;
+    s_axi_awready               : out std_logic;
+    s_axi_awaddr                : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+
+    -- Write data channel
+    s_axi_wvalid                : in  std_logic;
+    s_axi_wready                : out std_logic;
+    s_axi_wdata                 : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    s_axi_wstrb                 : in  std_logic_vector((BUS_DATA_WIDTH/8)-1 downto 0);
+
+    -- Write response channel
+    s_axi_bvalid                : out std_logic;
+    s_axi_bready                : in  std_logic;
+    s_axi_bresp                 : out std_logic_vector(1 downto 0);
+
+    -- Read address channel
+    s_axi_arvalid               : in  std_logic;
+    s_axi_arready               : out std_logic;
+    s_axi_araddr                : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+
+    -- Read data channel
+    s_axi_rvalid                : out std_logic;
+    s_axi_rready                : in  std_logic;
+    s_axi_rdata                 : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    s_axi_rresp                 : out std_logic_vector(1 downto 0);
+
+    ---------------------------------------------------------------------------
+    -- Concatenated AXI4-lite master ports
+    ---------------------------------------------------------------------------
+    -- Write address channels
+    m_axi_awvalid               : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_awready               : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_awaddr                : out std_logic_vector(NUM_MASTER_PORTS*BUS_ADDR_WIDTH-1 downto 0);
+
+    -- Write data channels
+    m_axi_wvalid                : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_wready                : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_wdata                 : out std_logic_vector(NUM_MASTER_PORTS*BUS_DATA_WIDTH-1 downto 0);
+    m_axi_wstrb                 : out std_logic_vector(NUM_MASTER_PORTS*(BUS_DATA_WIDTH/8)-1 downto 0);
+
+    -- Write response channels
+    m_axi_bvalid                : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_bready                : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_bresp                 : in  std_logic_vector(NUM_MASTER_PORTS*2-1 downto 0);
+
+    -- Read address channels
+    m_axi_arvalid               : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_arready               : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_araddr                : out std_logic_vector(NUM_MASTER_PORTS*BUS_ADDR_WIDTH-1 downto 0);
+
+    -- Read data channels
+    m_axi_rvalid                : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_rready                : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+    m_axi_rdata                 : in  std_logic_vector(NUM_MASTER_PORTS*BUS_DATA_WIDTH-1 downto 0);
+    m_axi_rresp                 : in  std_logic_vector(NUM_MASTER_PORTS*2-1 downto 0)
+  );
+end AxiLiteDemux;
+
+architecture Behavioral of AxiLiteDemux is
+
+  -- Number of address bits used to select the master port.
+  constant SEL_WIDTH : natural := imax(1, log2ceil(NUM_MASTER_PORTS));
+
+  -- Return the master port index that an address maps to.
+  function port_index(addr : std_logic_vector) return natural is
+    variable idx : natural;
+  begin
+    idx := to_integer(unsigned(addr(WINDOW_ADDR_WIDTH+SEL_WIDTH-1 downto WINDOW_ADDR_WIDTH)));
+    if idx > NUM_MASTER_PORTS-1 then
+      idx := NUM_MASTER_PORTS-1;
+    end if;
+    return idx;
+  end function;
+
+  -- Return an address with all bits beyond the window cleared.
+  function window_addr(addr : std_logic_vector) return std_logic_vector is
+    variable result : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0) := (others => '0');
+  begin
+    result(WINDOW_ADDR_WIDTH-1 downto 0) := addr(WINDOW_ADDR_WIDTH-1 downto 0);
+    return result;
+  end function;
+
+  -- Write transaction state.
+  signal w_busy                 : std_logic;
+  signal w_sel                  : natural range 0 to NUM_MASTER_PORTS-1;
+  signal aw_done                : std_logic;
+  signal wd_done                : std_logic;
+
+  -- Read transaction state.
+  signal r_busy                 : std_logic;
+  signal r_sel                  : natural range 0 to NUM_MASTER_PORTS-1;
+  signal ar_done                : std_logic;
+
+  signal m_awready_sel          : std_logic;
+  signal m_wready_sel           : std_logic;
+  signal m_bvalid_sel           : std_logic;
+  signal m_arready_sel          : std_logic;
+  signal m_rvalid_sel           : std_logic;
+
+  signal s_awready_int          : std_logic;
+  signal s_wready_int           : std_logic;
+  signal s_bvalid_int           : std_logic;
+  signal s_arready_int          : std_logic;
+  signal s_rvalid_int           : std_logic;
+
+begin
+
+  m_awready_sel <= m_axi_awready(w_sel);
+  m_wready_sel  <= m_axi_wready(w_sel);
+  m_bvalid_sel  <= m_axi_bvalid(w_sel);
+  m_arready_sel <= m_axi_arready(r_sel);
+  m_rvalid_sel  <= m_axi_rvalid(r_sel);
+
+  -- Handshakes on the slave port are only accepted once a transaction is
+  -- routed to a master port.
+  s_awready_int <= w_busy and not aw_done and m_awready_sel;
+  s_wready_int  <= w_busy and not wd_done and m_wready_sel;
+  s_bvalid_int  <= w_busy and aw_done and wd_done and m_bvalid_sel;
+  s_arready_int <= r_busy and not ar_done and m_arready_sel;
+  s_rvalid_int  <= r_busy and ar_done and m_rvalid_sel;
+
+  s_axi_awready <= s_awready_int;
+  s_axi_wready  <= s_wready_int;
+  s_axi_bvalid  <= s_bvalid_int;
+  s_axi_bresp   <= m_axi_bresp(2*w_sel+1 downto 2*w_sel);
+  s_axi_arready <= s_arready_int;
+  s_axi_rvalid  <= s_rvalid_int;
+  s_axi_rdata   <= m_axi_rdata((r_sel+1)*BUS_DATA_WIDTH-1 downto r_sel*BUS_DATA_WIDTH);
+  s_axi_rresp   <= m_axi_rresp(2*r_sel+1 downto 2*r_sel);
+
+  master_gen: for i in 0 to NUM_MASTER_PORTS-1 generate
+    m_axi_awvalid(i) <= s_axi_awvalid and w_busy and not aw_done when w_sel = i else '0';
+    m_axi_awaddr((i+1)*BUS_ADDR_WIDTH-1 downto i*BUS_ADDR_WIDTH) <= window_addr(s_axi_awaddr);
+    m_axi_wvalid(i)  <= s_axi_wvalid and w_busy and not wd_done when w_sel = i else '0';
+    m_axi_wdata((i+1)*BUS_DATA_WIDTH-1 downto i*BUS_DATA_WIDTH) <= s_axi_wdata;
+    m_axi_wstrb((i+1)*(BUS_DATA_WIDTH/8)-1 downto i*(BUS_DATA_WIDTH/8)) <= s_axi_wstrb;
+    m_axi_bready(i)  <= s_axi_bready and w_busy and aw_done and wd_done when w_sel = i else '0';
+    m_axi_arvalid(i) <= s_axi_arvalid and r_busy and not ar_done when r_sel = i else '0';
+    m_axi_araddr((i+1)*BUS_ADDR_WIDTH-1 downto i*BUS_ADDR_WIDTH) <= window_addr(s_axi_araddr);
+    m_axi_rready(i)  <= s_axi_rready and r_busy and ar_done when r_sel = i else '0';
+  end generate;
+
+  write_proc: process(clk)
+  begin
+    if rising_edge(clk) then
+      if w_busy = '0' then
+        -- Route a new write transaction.
+        if s_axi_awvalid = '1' then
+          w_sel  <= port_index(s_axi_awaddr);
+          w_busy <= '1';
+        end if;
+      else
+        if s_axi_awvalid = '1' and s_awready_int = '1' then
+          aw_done <= '1';
+        end if;
+        if s_axi_wvalid = '1' and s_wready_int = '1' then
+          wd_done <= '1';
+        end if;
+        if s_bvalid_int = '1' and s_axi_bready = '1' then
+          w_busy  <= '0';
+          aw_done <= '0';
+          wd_done <= '0';
+        end if;
+      end if;
+
+      if reset_n = '0' then
+        w_busy  <= '0';
+        w_sel   <= 0;
+        aw_done <= '0';
+        wd_done <= '0';
+      end if;
+    end if;
+  end process;
+
+  read_proc: process(clk)
+  begin
+    if rising_edge(clk) then
+      if r_busy = '0' then
+        -- Route a new read transaction.
+        if s_axi_arvalid = '1' then
+          r_sel  <= port_index(s_axi_araddr);
+          r_busy <= '1';
+        end if;
+      else
+        if s_axi_arvalid = '1' and s_arready_int = '1' then
+          ar_done <= '1';
+        end if;
+        if s_rvalid_int = '1' and s_axi_rready = '1' then
+          r_busy  <= '0';
+          ar_done <= '0';
+        end if;
+      end if;
+
+      if reset_n = '0' then
+        r_busy  <= '0';
+        r_sel   <= 0;
+        ar_done <= '0';
+      end if;
+    end if;
+  end process;
+
+end Behavioral;
@@ -142,4 +142,51 @@ package Axi_pkg is
     );
   end component;
 
+  component AxiLiteDemux is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_DATA_WIDTH            : natural := 32;
+      WINDOW_ADDR_WIDTH         : natural := 16;
+      NUM_MASTER_PORTS          : natural := 2
+    );
+    port (
+      clk                       : in  std_logic;
+      reset_n                   : in  std_logic;
+      s_axi_awvalid             : in  std_logic;
+      s_axi_awready             : out std_logic;
+      s_axi_awaddr              : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      s_axi_wvalid              : in  std_logic;
+      s_axi_wready              : out std_logic;
+      s_axi_wdata               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      s_axi_wstrb               : in  std_logic_vector((BUS_DATA_WIDTH/8)-1 downto 0);
+      s_axi_bvalid              : out std_logic;
+      s_axi_bready              : in  std_logic;
+      s_axi_bresp               : out std_logic_vector(1 downto 0);
+      s_axi_arvalid             : in  std_logic;
+      s_axi_arready             : out std_logic;
+      s_axi_araddr              : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      s_axi_rvalid              : out std_logic;
+      s_axi_rready              : in  std_logic;
+      s_axi_rdata               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      s_axi_rresp               : out std_logic_vector(1 downto 0);
+      m_axi_awvalid             : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_awready             : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_awaddr              : out std_logic_vector(NUM_MASTER_PORTS*BUS_ADDR_WIDTH-1 downto 0);
+      m_axi_wvalid              : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_wready              : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_wdata               : out std_logic_vector(NUM_MASTER_PORTS*BUS_DATA_WIDTH-1 downto 0);
+      m_axi_wstrb               : out std_logic_vector(NUM_MASTER_PORTS*(BUS_DATA_WIDTH/8)-1 downto 0);
+      m_axi_bvalid              : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_bready              : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_bresp               : in  std_logic_vector(NUM_MASTER_PORTS*2-1 downto 0);
+      m_axi_arvalid             : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_arready             : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_araddr              : out std_logic_vector(NUM_MASTER_PORTS*BUS_ADDR_WIDTH-1 downto 0);
+      m_axi_rvalid              : in  std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_rready              : out std_logic_vector(NUM_MASTER_PORTS-1 downto 0);
+      m_axi_rdata               : in  std_logic_vector(NUM_MASTER_PORTS*BUS_DATA_WIDTH-1 downto 0);
+      m_axi_rresp               : in  std_logic_vector(NUM_MASTER_PORTS*2-1 downto 0)
+    );
+  end component;
+
 end Axi_pkg;
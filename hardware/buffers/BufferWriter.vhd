@@ -65,6 +65,13 @@ entity BufferWriter is
     -- Be safe, don't touch this.
     BUS_FIFO_THRES_SHIFT        : natural := 0;
 
+    -- Whether to coalesce the burst steps before the first and after the last
+    -- maximum length burst of a command into a single burst each, rather than
+    -- writing every burst step separately. This reduces the number of short
+    -- bursts, at the cost of buffering the data up to the first maximum burst
+    -- boundary before it is written.
+    BUS_COALESCE                : boolean := false;
+
     ---------------------------------------------------------------------------
     -- Buffer metrics and configuration
     ---------------------------------------------------------------------------
@@ -464,7 +471,8 @@ begin
       INDEX_WIDTH               => INDEX_WIDTH,
       ELEMENT_WIDTH             => ELEMENT_WIDTH,
       IS_OFFSETS_BUFFER         => IS_OFFSETS_BUFFER,
-      CHECK_INDEX               => false
+      CHECK_INDEX               => false,
+      COALESCE                  => BUS_COALESCE
     )
     port map (
       clk                       => kcd_clk,
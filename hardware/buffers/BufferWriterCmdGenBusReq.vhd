@@ -69,7 +69,13 @@ entity BufferWriterCmdGenBusReq is
 
     -- Wether or not this component should check if the first and last index
     -- are not equal
-    CHECK_INDEX                 : boolean
+    CHECK_INDEX                 : boolean;
+
+    -- Whether to coalesce the burst steps before the first and after the last
+    -- maximum length burst into a single burst each. The steps before the
+    -- first maximum burst boundary are then only requested once they are all
+    -- loaded, or once the last step is loaded.
+    COALESCE                    : boolean := false
 
   );
   port (
@@ -136,6 +142,9 @@ architecture rtl of BufferWriterCmdGenBusReq is
     reset                       : std_logic;
     step_sub                    : std_logic;
     max_sub                     : std_logic;
+    -- Subtract a number of steps at once, for coalesced bursts.
+    steps_sub                   : std_logic;
+    steps                       : unsigned(log2ceil(BUS_BURST_MAX_LEN/BUS_BURST_STEP_LEN+1) downto 0);
   end record;
 
   signal cnt_ctrl        : counter_control_record;
@@ -212,8 +221,15 @@ architecture rtl of BufferWriterCmdGenBusReq is
 
   constant INDEX_ZERO           : unsigned(INDEX_WIDTH-1 downto 0) := (others => '0');
 
+  -- Number of burst steps between two alignment boundaries.
+  constant ALIGN_STEPS          : natural := BYTE_ALIGN / BYTES_PER_STEP;
+
   signal byte_address           : unsigned(BUS_ADDR_WIDTH-1 downto 0);
 
+  -- Number of burst steps from the current address to the next alignment
+  -- boundary.
+  signal align_steps            : unsigned(log2ceil(BUS_BURST_MAX_LEN/BUS_BURST_STEP_LEN+1) downto 0);
+
 begin
 
   -----------------------------------------------------------------------------
@@ -251,6 +267,8 @@ begin
       v.step                    := v.step - 1;
     elsif cnt_ctrl.max_sub = '1' then
       v.step                    := v.step - MAX_STEPS;
+    elsif cnt_ctrl.steps_sub = '1' then
+      v.step                    := v.step - cnt_ctrl.steps;
     end if;
 
     -- pragma translate off
@@ -268,6 +286,16 @@ begin
   -- Get the byte address of this index
   byte_address                  <= resize(r.base_address + shift(r.index.current, ITOBA_LSHIFT), BUS_ADDR_WIDTH);
 
+  -- Get the number of steps to the next alignment boundary
+  align_multi_gen: if ALIGN_STEPS > 1 generate
+    align_steps                 <= to_unsigned(ALIGN_STEPS, align_steps'length)
+                                 - resize(byte_address(log2floor(BYTE_ALIGN)-1 downto log2floor(BYTES_PER_STEP)),
+                                          align_steps'length);
+  end generate;
+  align_single_gen: if ALIGN_STEPS <= 1 generate
+    align_steps                 <= to_unsigned(1, align_steps'length);
+  end generate;
+
   -----------------------------------------------------------------------------
   -- State machine sequential part
   -----------------------------------------------------------------------------
@@ -288,12 +316,13 @@ begin
     r,
     cmdIn_valid, cmdIn_firstIdx, cmdIn_lastIdx, cmdIn_baseAddr, cmdIn_implicit,
     busReq_ready,
-    byte_address,
+    byte_address, align_steps,
     steps_last, steps_valid,
     counter
   ) is
     variable vr                 : regs_record;
     variable vo                 : output_record;
+    variable steps              : unsigned(log2ceil(BUS_BURST_MAX_LEN/BUS_BURST_STEP_LEN+1) downto 0);
   begin
     -- Default registered values:
     vr                          := r;
@@ -306,6 +335,8 @@ begin
     vo.master.last              := '0';
     vo.cnt_ctrl.step_sub        := '0';
     vo.cnt_ctrl.max_sub         := '0';
+    vo.cnt_ctrl.steps_sub       := '0';
+    vo.cnt_ctrl.steps           := (others => '0');
     vo.cnt_ctrl.reset           := '0';
     vo.steps_ready              := '0';
 
@@ -386,10 +417,38 @@ begin
           vr.state              := POST_STEP;
         end if;
 
+        -- When coalescing, write all steps up to the alignment boundary in a
+        -- single burst once they are loaded, or all loaded steps once the last
+        -- step is loaded.
+        if COALESCE then
+          steps                 := align_steps;
+          if counter.step < steps then
+            steps               := counter.step;
+          end if;
+          vo.master.len         := resize(steps * STEP_LEN, BUS_LEN_WIDTH);
+          vo.master.last        := '0';
+          if r.last = '1' and counter.step = steps then
+            vo.master.last      := '1';
+          end if;
+          if r.last = '0' and counter.step < align_steps then
+            vo.master.valid     := '0';
+          end if;
+          if vo.master.valid = '0' and vr.last = '1' then
+            vr.state            := POST_STEP;
+          end if;
+        end if;
+
         -- Back-pressure from bus
         if busReq_ready = '1' and vo.master.valid = '1' then
-          vo.cnt_ctrl.step_sub  := '1';
-          vr.index.current      := vr.index.current + ELEMS_PER_STEP;
+          if COALESCE then
+            vo.cnt_ctrl.steps_sub := '1';
+            vo.cnt_ctrl.steps   := steps;
+            vr.index.current    := resize(vr.index.current + steps * to_unsigned(ELEMS_PER_STEP, INDEX_WIDTH),
+                                          INDEX_WIDTH);
+          else
+            vo.cnt_ctrl.step_sub := '1';
+            vr.index.current    := vr.index.current + ELEMS_PER_STEP;
+          end if;
 
           if vr.last = '1' then
             vr.state            := POST_STEP;
@@ -476,6 +535,20 @@ begin
           end if;
         end if;
 
+        -- When coalescing, write the remaining steps in a single burst, up to
+        -- the alignment boundary.
+        if COALESCE then
+          steps                 := align_steps;
+          if counter.step < steps then
+            steps               := counter.step;
+          end if;
+          vo.master.len         := resize(steps * STEP_LEN, BUS_LEN_WIDTH);
+          vo.master.last        := '0';
+          if vr.last = '1' and counter.step = steps then
+            vo.master.last      := '1';
+          end if;
+        end if;
+
         -- Stop when all steps have been requested.
         if counter.step = 0 then
           vo.master.valid       := '0';
@@ -484,7 +557,12 @@ begin
 
         -- Back-pressure
         if busReq_ready = '1' and vo.master.valid = '1' then
-          if counter.step < MAX_STEPS then
+          if COALESCE then
+            vo.cnt_ctrl.steps_sub := '1';
+            vo.cnt_ctrl.steps   := steps;
+            vr.index.current    := resize(vr.index.current + steps * to_unsigned(ELEMS_PER_STEP, INDEX_WIDTH),
+                                          INDEX_WIDTH);
+          elsif counter.step < MAX_STEPS then
             vo.cnt_ctrl.step_sub  := '1';
             vr.index.current      := vr.index.current + ELEMS_PER_STEP;
           else
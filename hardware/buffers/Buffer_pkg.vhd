@@ -299,6 +299,7 @@ package Buffer_pkg is
       BUS_BURST_MAX_LEN         : natural;
       BUS_FIFO_DEPTH            : natural;
       BUS_FIFO_THRES_SHIFT      : natural := 0;
+      BUS_COALESCE              : boolean := false;
       INDEX_WIDTH               : natural;
       ELEMENT_WIDTH             : natural;
       IS_OFFSETS_BUFFER         : boolean;
@@ -448,7 +449,8 @@ package Buffer_pkg is
       INDEX_WIDTH               : natural;
       ELEMENT_WIDTH             : natural;
       IS_OFFSETS_BUFFER         : boolean;
-      CHECK_INDEX               : boolean := false
+      CHECK_INDEX               : boolean := false;
+      COALESCE                  : boolean := false
     );
     port (
       clk                       : in  std_logic;
@@ -0,0 +1,267 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Buffer_pkg.all;
+use work.Interconnect_pkg.all;
+use work.UtilInt_pkg.all;
+use work.UtilStr_pkg.all;
+
+-------------------------------------------------------------------------------
+-- This testbench measures the throughput of the BufferReader.
+--
+-- A single command reading ROWS elements is issued to the BufferReader, which
+-- reads from a bus slave mock without random timing. The output stream is
+-- always ready, such that the BufferReader and the bus are the only limiting
+-- factors. The number of elements, output transfers and bus words, and the
+-- number of cycles from the command handshake up to the last output transfer
+-- are printed on a single line starting with BENCH, which is parsed by
+-- hardware/test/bench/sweep.py.
+-------------------------------------------------------------------------------
+entity BufferReaderBench_tb is
+  generic (
+    TEST_NAME                   : string   := "BufferReader";
+    BUS_ADDR_WIDTH              : natural  := 64;
+    BUS_LEN_WIDTH               : natural  := 9;
+    BUS_DATA_WIDTH              : natural  := 512;
+    BUS_BURST_STEP_LEN          : natural  := 1;
+    BUS_BURST_MAX_LEN           : natural  := 64;
+    BUS_FIFO_DEPTH              : natural  := 16;
+
+    INDEX_WIDTH                 : natural  := 32;
+    ELEMENT_WIDTH               : natural  := 32;
+    ELEMENT_COUNT_MAX           : natural  := 1;
+    ELEMENT_COUNT_WIDTH         : natural  := imax(1, log2ceil(ELEMENT_COUNT_MAX+1));
+    ELEMENT_FIFO_SIZE           : natural  := 64;
+
+    ROWS                        : natural  := 4096;
+
+    -- Bus slave mock.
+    SLAVE_LATENCY               : natural  := 0;
+    SLAVE_MAX_OUTSTANDING       : positive := 4
+  );
+end BufferReaderBench_tb;
+
+architecture tb of BufferReaderBench_tb is
+  signal sim_done               : boolean := false;
+
+  signal bcd_clk                : std_logic := '1';
+  signal bcd_reset              : std_logic := '1';
+  signal kcd_clk                : std_logic := '1';
+  signal kcd_reset              : std_logic := '1';
+
+  signal cmdIn_valid            : std_logic := '0';
+  signal cmdIn_ready            : std_logic;
+  signal cmdIn_firstIdx         : std_logic_vector(INDEX_WIDTH-1 downto 0);
+  signal cmdIn_lastIdx          : std_logic_vector(INDEX_WIDTH-1 downto 0);
+  signal cmdIn_baseAddr         : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+
+  signal bus_rreq_valid         : std_logic;
+  signal bus_rreq_ready         : std_logic;
+  signal bus_rreq_addr          : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+  signal bus_rreq_len           : std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+  signal bus_rdat_valid         : std_logic;
+  signal bus_rdat_ready         : std_logic;
+  signal bus_rdat_data          : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+  signal bus_rdat_last          : std_logic;
+
+  signal out_valid              : std_logic;
+  signal out_ready              : std_logic := '1';
+  signal out_data               : std_logic_vector(ELEMENT_COUNT_MAX*ELEMENT_WIDTH-1 downto 0);
+  signal out_count              : std_logic_vector(ELEMENT_COUNT_WIDTH-1 downto 0);
+  signal out_last               : std_logic;
+
+begin
+
+  -- Clock
+  clk_proc: process is
+  begin
+    if not sim_done then
+      bcd_clk                   <= '1';
+      kcd_clk                   <= '1';
+      wait for 2 ns;
+      bcd_clk                   <= '0';
+      kcd_clk                   <= '0';
+      wait for 2 ns;
+    else
+      wait;
+    end if;
+  end process;
+
+  -- Reset
+  reset_proc: process is
+  begin
+    bcd_reset                   <= '1';
+    kcd_reset                   <= '1';
+    wait for 8 ns;
+    wait until rising_edge(kcd_clk);
+    bcd_reset                   <= '0';
+    kcd_reset                   <= '0';
+    wait;
+  end process;
+
+  -- Issue a single command for all rows.
+  command_proc: process is
+  begin
+    cmdIn_firstIdx              <= (others => '0');
+    cmdIn_lastIdx               <= std_logic_vector(to_unsigned(ROWS, INDEX_WIDTH));
+    cmdIn_baseAddr              <= (others => '0');
+    wait until rising_edge(kcd_clk) and kcd_reset = '0';
+    cmdIn_valid                 <= '1';
+    wait until rising_edge(kcd_clk) and cmdIn_ready = '1';
+    cmdIn_valid                 <= '0';
+    wait;
+  end process;
+
+  -- Count cycles and transfers from the command handshake to the last output
+  -- transfer.
+  measure_proc: process is
+    variable cycles             : natural := 0;
+    variable elements           : natural := 0;
+    variable transfers          : natural := 0;
+    variable words              : natural := 0;
+    variable count              : natural;
+  begin
+    wait until rising_edge(kcd_clk) and cmdIn_valid = '1' and cmdIn_ready = '1';
+
+    loop
+      wait until rising_edge(kcd_clk);
+      cycles                    := cycles + 1;
+
+      if bus_rdat_valid = '1' and bus_rdat_ready = '1' then
+        words                   := words + 1;
+      end if;
+
+      if out_valid = '1' and out_ready = '1' then
+        transfers               := transfers + 1;
+        -- A count of zero encodes ELEMENT_COUNT_MAX when the count is too
+        -- narrow to hold it.
+        count                   := to_integer(unsigned(out_count));
+        if count = 0 then
+          count                 := ELEMENT_COUNT_MAX;
+        end if;
+        elements                := elements + count;
+        exit when out_last = '1';
+      end if;
+    end loop;
+
+    println("BENCH " & TEST_NAME
+      & " elements " & intToDec(elements)
+      & " transfers " & intToDec(transfers)
+      & " words " & intToDec(words)
+      & " cycles " & intToDec(cycles));
+
+    if elements /= ROWS then
+      report "TEST FAILURE. Expected " & intToDec(ROWS) & " elements, received " & intToDec(elements) & "."
+        severity failure;
+    end if;
+
+    sim_done                    <= true;
+
+    -- Dirty trick to allow stdout to empty write buffer since textio doesn't have a flush function
+    wait for 100 ns;
+
+    report "TEST SUCCESSFUL.";
+
+    wait;
+  end process;
+
+  slave_inst: BusReadSlaveMock
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      SEED                      => 1,
+      RANDOM_REQUEST_TIMING     => false,
+      RANDOM_RESPONSE_TIMING    => false,
+      LATENCY                   => SLAVE_LATENCY,
+      MAX_OUTSTANDING           => SLAVE_MAX_OUTSTANDING
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      rreq_valid                => bus_rreq_valid,
+      rreq_ready                => bus_rreq_ready,
+      rreq_addr                 => bus_rreq_addr,
+      rreq_len                  => bus_rreq_len,
+      rdat_valid                => bus_rdat_valid,
+      rdat_ready                => bus_rdat_ready,
+      rdat_data                 => bus_rdat_data,
+      rdat_last                 => bus_rdat_last
+    );
+
+  uut: BufferReader
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      ELEMENT_WIDTH             => ELEMENT_WIDTH,
+      IS_OFFSETS_BUFFER         => false,
+      ELEMENT_COUNT_MAX         => ELEMENT_COUNT_MAX,
+      ELEMENT_COUNT_WIDTH       => ELEMENT_COUNT_WIDTH,
+      CMD_CTRL_WIDTH            => 1,
+      CMD_TAG_WIDTH             => 1,
+      BUS_FIFO_DEPTH            => BUS_FIFO_DEPTH,
+      ELEMENT_FIFO_SIZE         => ELEMENT_FIFO_SIZE
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmdIn_valid               => cmdIn_valid,
+      cmdIn_ready               => cmdIn_ready,
+      cmdIn_firstIdx            => cmdIn_firstIdx,
+      cmdIn_lastIdx             => cmdIn_lastIdx,
+      cmdIn_baseAddr            => cmdIn_baseAddr,
+      cmdIn_implicit            => '0',
+      cmdIn_ctrl                => "0",
+      cmdIn_tag                 => "0",
+
+      unlock_valid              => open,
+      unlock_ready              => '1',
+      unlock_tag                => open,
+
+      cmdOut_valid              => open,
+      cmdOut_ready              => '1',
+      cmdOut_firstIdx           => open,
+      cmdOut_lastIdx            => open,
+      cmdOut_ctrl               => open,
+      cmdOut_tag                => open,
+
+      bus_rreq_valid            => bus_rreq_valid,
+      bus_rreq_ready            => bus_rreq_ready,
+      bus_rreq_addr             => bus_rreq_addr,
+      bus_rreq_len              => bus_rreq_len,
+      bus_rdat_valid            => bus_rdat_valid,
+      bus_rdat_ready            => bus_rdat_ready,
+      bus_rdat_data             => bus_rdat_data,
+      bus_rdat_last             => bus_rdat_last,
+
+      out_valid                 => out_valid,
+      out_ready                 => out_ready,
+      out_data                  => out_data,
+      out_count                 => out_count,
+      out_last                  => out_last
+    );
+
+end architecture;
@@ -0,0 +1,293 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Buffer_pkg.all;
+use work.Interconnect_pkg.all;
+use work.UtilInt_pkg.all;
+use work.UtilStr_pkg.all;
+
+-------------------------------------------------------------------------------
+-- This testbench measures the throughput of the BufferWriter.
+--
+-- A single command writing ROWS elements is issued to the BufferWriter, which
+-- writes to a bus slave mock without random timing. The input stream is always
+-- valid and delivers ELEMENT_COUNT_MAX elements per transfer, such that the
+-- BufferWriter and the bus are the only limiting factors. The number of
+-- elements, input transfers and bus words, and the number of cycles from the
+-- command handshake up to the unlock handshake are printed on a single line
+-- starting with BENCH, which is parsed by hardware/test/bench/sweep.py.
+-------------------------------------------------------------------------------
+entity BufferWriterBench_tb is
+  generic (
+    TEST_NAME                   : string   := "BufferWriter";
+    BUS_ADDR_WIDTH              : natural  := 64;
+    BUS_LEN_WIDTH               : natural  := 9;
+    BUS_DATA_WIDTH              : natural  := 512;
+    BUS_BURST_STEP_LEN          : natural  := 1;
+    BUS_BURST_MAX_LEN           : natural  := 64;
+    BUS_FIFO_DEPTH              : natural  := 16;
+    BUS_FIFO_THRES_SHIFT        : natural  := 0;
+
+    INDEX_WIDTH                 : natural  := 32;
+    ELEMENT_WIDTH               : natural  := 32;
+    ELEMENT_COUNT_MAX           : natural  := 1;
+    ELEMENT_COUNT_WIDTH         : natural  := imax(1, log2ceil(ELEMENT_COUNT_MAX));
+
+    -- Must be a multiple of ELEMENT_COUNT_MAX.
+    ROWS                        : natural  := 4096;
+
+    -- Bus slave mock.
+    SLAVE_LATENCY               : natural  := 0
+  );
+end BufferWriterBench_tb;
+
+architecture tb of BufferWriterBench_tb is
+  constant TRANSFERS            : natural := ROWS / ELEMENT_COUNT_MAX;
+
+  signal sim_done               : boolean := false;
+
+  signal bcd_clk                : std_logic := '1';
+  signal bcd_reset              : std_logic := '1';
+  signal kcd_clk                : std_logic := '1';
+  signal kcd_reset              : std_logic := '1';
+
+  signal cmdIn_valid            : std_logic := '0';
+  signal cmdIn_ready            : std_logic;
+  signal cmdIn_firstIdx         : std_logic_vector(INDEX_WIDTH-1 downto 0);
+  signal cmdIn_lastIdx          : std_logic_vector(INDEX_WIDTH-1 downto 0);
+  signal cmdIn_baseAddr         : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+
+  signal unlock_valid           : std_logic;
+  signal unlock_ready           : std_logic := '1';
+
+  signal in_valid               : std_logic := '0';
+  signal in_ready               : std_logic;
+  signal in_data                : std_logic_vector(ELEMENT_COUNT_MAX*ELEMENT_WIDTH-1 downto 0);
+  signal in_count               : std_logic_vector(ELEMENT_COUNT_WIDTH-1 downto 0);
+  signal in_last                : std_logic := '0';
+
+  signal bus_wreq_valid         : std_logic;
+  signal bus_wreq_ready         : std_logic;
+  signal bus_wreq_addr          : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+  signal bus_wreq_len           : std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+  signal bus_wreq_last          : std_logic;
+  signal bus_wdat_valid         : std_logic;
+  signal bus_wdat_ready         : std_logic;
+  signal bus_wdat_data          : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+  signal bus_wdat_strobe        : std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+  signal bus_wdat_last          : std_logic;
+  signal bus_wrep_valid         : std_logic;
+  signal bus_wrep_ready         : std_logic;
+  signal bus_wrep_ok            : std_logic;
+
+begin
+
+  assert ROWS mod ELEMENT_COUNT_MAX = 0
+    report "ROWS must be a multiple of ELEMENT_COUNT_MAX." severity failure;
+
+  -- Clock
+  clk_proc: process is
+  begin
+    if not sim_done then
+      bcd_clk                   <= '1';
+      kcd_clk                   <= '1';
+      wait for 2 ns;
+      bcd_clk                   <= '0';
+      kcd_clk                   <= '0';
+      wait for 2 ns;
+    else
+      wait;
+    end if;
+  end process;
+
+  -- Reset
+  reset_proc: process is
+  begin
+    bcd_reset                   <= '1';
+    kcd_reset                   <= '1';
+    wait for 8 ns;
+    wait until rising_edge(kcd_clk);
+    bcd_reset                   <= '0';
+    kcd_reset                   <= '0';
+    wait;
+  end process;
+
+  -- Issue a single command for all rows, with a known last index.
+  command_proc: process is
+  begin
+    cmdIn_firstIdx              <= (others => '0');
+    cmdIn_lastIdx               <= std_logic_vector(to_unsigned(ROWS, INDEX_WIDTH));
+    cmdIn_baseAddr              <= (others => '0');
+    wait until rising_edge(kcd_clk) and kcd_reset = '0';
+    cmdIn_valid                 <= '1';
+    wait until rising_edge(kcd_clk) and cmdIn_ready = '1';
+    cmdIn_valid                 <= '0';
+    wait;
+  end process;
+
+  -- Keep the input stream valid with full transfers until all rows are
+  -- delivered. A count of zero encodes ELEMENT_COUNT_MAX when the count is too
+  -- narrow to hold it.
+  input_proc: process is
+    variable sent               : natural := 0;
+  begin
+    in_data                     <= (others => '1');
+    in_count                    <= std_logic_vector(to_unsigned(ELEMENT_COUNT_MAX mod 2**ELEMENT_COUNT_WIDTH,
+                                                                ELEMENT_COUNT_WIDTH));
+    wait until rising_edge(kcd_clk) and kcd_reset = '0';
+    while sent < TRANSFERS loop
+      in_valid                  <= '1';
+      if sent = TRANSFERS - 1 then
+        in_last                 <= '1';
+      end if;
+      wait until rising_edge(kcd_clk) and in_ready = '1';
+      sent                      := sent + 1;
+    end loop;
+    in_valid                    <= '0';
+    in_last                     <= '0';
+    wait;
+  end process;
+
+  -- Count cycles and bus words from the command handshake to the unlock
+  -- handshake.
+  measure_proc: process is
+    variable cycles             : natural := 0;
+    variable words              : natural := 0;
+  begin
+    wait until rising_edge(kcd_clk) and cmdIn_valid = '1' and cmdIn_ready = '1';
+
+    loop
+      if bus_wdat_valid = '1' and bus_wdat_ready = '1' then
+        words                   := words + 1;
+      end if;
+      exit when unlock_valid = '1' and unlock_ready = '1';
+      wait until rising_edge(kcd_clk);
+      cycles                    := cycles + 1;
+    end loop;
+
+    println("BENCH " & TEST_NAME
+      & " elements " & intToDec(ROWS)
+      & " transfers " & intToDec(TRANSFERS)
+      & " words " & intToDec(words)
+      & " cycles " & intToDec(cycles));
+
+    sim_done                    <= true;
+
+    -- Dirty trick to allow stdout to empty write buffer since textio doesn't have a flush function
+    wait for 100 ns;
+
+    report "TEST SUCCESSFUL.";
+
+    wait;
+  end process;
+
+  slave_inst: BusWriteSlaveMock
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      SEED                      => 1,
+      RANDOM_REQUEST_TIMING     => false,
+      RANDOM_RESPONSE_TIMING    => false,
+      LATENCY                   => SLAVE_LATENCY
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      wreq_valid                => bus_wreq_valid,
+      wreq_ready                => bus_wreq_ready,
+      wreq_addr                 => bus_wreq_addr,
+      wreq_len                  => bus_wreq_len,
+      wreq_last                 => bus_wreq_last,
+      wdat_valid                => bus_wdat_valid,
+      wdat_ready                => bus_wdat_ready,
+      wdat_data                 => bus_wdat_data,
+      wdat_strobe               => bus_wdat_strobe,
+      wdat_last                 => bus_wdat_last,
+      wrep_valid                => bus_wrep_valid,
+      wrep_ready                => bus_wrep_ready,
+      wrep_ok                   => bus_wrep_ok
+    );
+
+  uut: BufferWriter
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      BUS_STROBE_WIDTH          => BUS_DATA_WIDTH/8,
+      BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
+      BUS_BURST_MAX_LEN         => BUS_BURST_MAX_LEN,
+      BUS_FIFO_DEPTH            => BUS_FIFO_DEPTH,
+      BUS_FIFO_THRES_SHIFT      => BUS_FIFO_THRES_SHIFT,
+      INDEX_WIDTH               => INDEX_WIDTH,
+      ELEMENT_WIDTH             => ELEMENT_WIDTH,
+      IS_OFFSETS_BUFFER         => false,
+      ELEMENT_COUNT_MAX         => ELEMENT_COUNT_MAX,
+      ELEMENT_COUNT_WIDTH       => ELEMENT_COUNT_WIDTH,
+      CMD_CTRL_WIDTH            => 1,
+      CMD_TAG_WIDTH             => 1
+    )
+    port map (
+      bcd_clk                   => bcd_clk,
+      bcd_reset                 => bcd_reset,
+      kcd_clk                   => kcd_clk,
+      kcd_reset                 => kcd_reset,
+
+      cmdIn_valid               => cmdIn_valid,
+      cmdIn_ready               => cmdIn_ready,
+      cmdIn_firstIdx            => cmdIn_firstIdx,
+      cmdIn_lastIdx             => cmdIn_lastIdx,
+      cmdIn_baseAddr            => cmdIn_baseAddr,
+      cmdIn_implicit            => '0',
+      cmdIn_tag                 => "0",
+      cmdIn_ctrl                => "0",
+
+      unlock_valid              => unlock_valid,
+      unlock_ready              => unlock_ready,
+      unlock_tag                => open,
+
+      cmdOut_valid              => open,
+      cmdOut_ready              => '1',
+      cmdOut_firstIdx           => open,
+      cmdOut_lastIdx            => open,
+      cmdOut_ctrl               => open,
+      cmdOut_tag                => open,
+
+      in_valid                  => in_valid,
+      in_ready                  => in_ready,
+      in_data                   => in_data,
+      in_count                  => in_count,
+      in_last                   => in_last,
+
+      bus_wreq_valid            => bus_wreq_valid,
+      bus_wreq_ready            => bus_wreq_ready,
+      bus_wreq_addr             => bus_wreq_addr,
+      bus_wreq_len              => bus_wreq_len,
+      bus_wreq_last             => bus_wreq_last,
+      bus_wdat_valid            => bus_wdat_valid,
+      bus_wdat_ready            => bus_wdat_ready,
+      bus_wdat_data             => bus_wdat_data,
+      bus_wdat_strobe           => bus_wdat_strobe,
+      bus_wdat_last             => bus_wdat_last,
+      bus_wrep_valid            => bus_wrep_valid,
+      bus_wrep_ready            => bus_wrep_ready,
+      bus_wrep_ok               => bus_wrep_ok
+    );
+
+end architecture;
@@ -41,6 +41,7 @@ entity BufferWriter_tb is
 
     BUS_FIFO_DEPTH              : natural  := 1;
     BUS_FIFO_THRES_SHIFT        : natural  := 0;
+    BUS_COALESCE                : boolean  := false;
 
     INDEX_WIDTH                 : natural  := 32;
     IS_OFFSETS_BUFFER           : boolean  := true;
@@ -605,6 +606,7 @@ begin
       BUS_BURST_STEP_LEN        => BUS_BURST_STEP_LEN,
       BUS_FIFO_DEPTH            => BUS_FIFO_DEPTH,
       BUS_FIFO_THRES_SHIFT      => BUS_FIFO_THRES_SHIFT,
+      BUS_COALESCE              => BUS_COALESCE,
       INDEX_WIDTH               => INDEX_WIDTH,
       ELEMENT_WIDTH             => ELEMENT_WIDTH,
       IS_OFFSETS_BUFFER         => IS_OFFSETS_BUFFER,
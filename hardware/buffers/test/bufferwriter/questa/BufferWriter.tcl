@@ -8,6 +8,7 @@ proc print_cases {} {
   echo " - 8x64in512out"
   echo " - 32in32out"
   echo " - 32in64out"
+  echo " - 32in64outCoalesce"
   echo " - Default"
   echo " - IndexBS4"
   echo " - IndexBuf"
@@ -49,6 +50,7 @@ add_source ../BufferWriter_8x1in64out_tc.vhd -2008
 add_source ../BufferWriter_8x64in512out_tc.vhd -2008
 add_source ../BufferWriter_32in32out_tc.vhd -2008
 add_source ../BufferWriter_32in64out_tc.vhd -2008
+add_source ../BufferWriter_32in64outCoalesce_tc.vhd -2008
 add_source ../BufferWriter_Default_tc.vhd -2008
 add_source ../BufferWriter_IndexBS4_tc.vhd -2008
 add_source ../BufferWriter_IndexBuf_tc.vhd -2008
@@ -0,0 +1,157 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- This unit gates the request streams of the slave ports of a bus arbiter,
+-- such that the share of the requests of every port follows its weight.
+--
+-- Every port holds a number of credits, which is decremented by every request
+-- that completes a command, i.e. of which the last flag is set. A port without
+-- credits is withheld from the arbiter while another requesting port has
+-- credits left. When none of the requesting ports has credits left, the
+-- credits of all ports are restored to their weights. Ports therefore never
+-- starve, and a port only loses its request stream in between commands.
+
+entity BusArbiterWeights is
+  generic (
+
+    -- Number of slave ports.
+    NUM_SLAVE_PORTS             : natural := 2;
+
+    -- Comma-separated weights of the slave ports, e.g. "8,1,1", of at most
+    -- 255 each. If empty, the request streams are passed through as is.
+    WEIGHTS                     : string := ""
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Request stream handshakes of the slave ports.
+    in_valid                    : in  std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+    in_ready                    : out std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+    in_last                     : in  std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+
+    -- Request stream handshakes towards the arbiter.
+    out_valid                   : out std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+    out_ready                   : in  std_logic_vector(NUM_SLAVE_PORTS-1 downto 0)
+
+  );
+end BusArbiterWeights;
+
+architecture Behavioral of BusArbiterWeights is
+
+  type credit_array is array (natural range <>) of unsigned(7 downto 0);
+
+  -- Return the weights of the ports, which default to 1.
+  function parse_weights return credit_array is
+    variable result : credit_array(0 to NUM_SLAVE_PORTS-1) := (others => to_unsigned(1, 8));
+    variable port_i : natural := 0;
+    variable value  : natural := 0;
+  begin
+    for i in WEIGHTS'range loop
+      if WEIGHTS(i) = ',' then
+        if port_i < NUM_SLAVE_PORTS then
+          result(port_i) := to_unsigned(value, 8);
+        end if;
+        port_i := port_i + 1;
+        value := 0;
+      elsif WEIGHTS(i) >= '0' and WEIGHTS(i) <= '9' then
+        value := value * 10 + character'pos(WEIGHTS(i)) - character'pos('0');
+      end if;
+    end loop;
+    if port_i < NUM_SLAVE_PORTS then
+      result(port_i) := to_unsigned(value, 8);
+    end if;
+    -- A port without weight would be withheld until all other ports are idle.
+    for i in result'range loop
+      if result(i) = 0 then
+        result(i) := to_unsigned(1, 8);
+      end if;
+    end loop;
+    return result;
+  end function;
+
+  constant PORT_WEIGHTS         : credit_array(0 to NUM_SLAVE_PORTS-1) := parse_weights;
+
+begin
+
+  no_weights_gen: if WEIGHTS = "" generate
+  begin
+    out_valid <= in_valid;
+    in_ready  <= out_ready;
+  end generate;
+
+  weights_gen: if WEIGHTS /= "" generate
+    signal credits              : credit_array(0 to NUM_SLAVE_PORTS-1);
+    signal enable               : std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+    signal restore              : std_logic;
+  begin
+
+    -- Determine which ports may present their requests to the arbiter.
+    enable_proc: process (in_valid, credits) is
+      variable any_credits      : boolean;
+    begin
+      any_credits := false;
+      for i in 0 to NUM_SLAVE_PORTS-1 loop
+        if in_valid(i) = '1' and credits(i) /= 0 then
+          any_credits := true;
+        end if;
+      end loop;
+      for i in 0 to NUM_SLAVE_PORTS-1 loop
+        if credits(i) /= 0 or not any_credits then
+          enable(i) <= '1';
+        else
+          enable(i) <= '0';
+        end if;
+      end loop;
+      if any_credits then
+        restore <= '0';
+      else
+        restore <= '1';
+      end if;
+    end process;
+
+    out_valid <= in_valid and enable;
+    in_ready  <= out_ready and enable;
+
+    credit_proc: process (bcd_clk) is
+    begin
+      if rising_edge(bcd_clk) then
+        for i in 0 to NUM_SLAVE_PORTS-1 loop
+          if restore = '1' then
+            credits(i) <= PORT_WEIGHTS(i);
+          end if;
+          if in_valid(i) = '1' and out_ready(i) = '1' and enable(i) = '1' and in_last(i) = '1' then
+            if restore = '1' then
+              credits(i) <= PORT_WEIGHTS(i) - 1;
+            else
+              credits(i) <= credits(i) - 1;
+            end if;
+          end if;
+        end loop;
+        if bcd_reset = '1' then
+          credits <= PORT_WEIGHTS;
+        end if;
+      end if;
+    end process;
+
+  end generate;
+
+end Behavioral;
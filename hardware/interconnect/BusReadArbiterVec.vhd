@@ -44,6 +44,12 @@ entity BusReadArbiterVec is
     -- lower-indexed masters take precedence.
     ARB_METHOD                  : string := "ROUND-ROBIN";
 
+    -- Comma-separated arbitration weights of the slave ports, e.g. "8,1,1".
+    -- A port with weight W may issue W commands for every command of a port
+    -- with weight 1, while both are requesting. If empty, all ports are
+    -- arbitrated equally. See BusArbiterWeights.
+    ARB_WEIGHTS                 : string := "";
+
     -- Maximum number of outstanding requests. This is rounded upward to
     -- whatever is convenient internally.
     MAX_OUTSTANDING             : natural := 2;
@@ -162,6 +168,11 @@ architecture Behavioral of BusReadArbiterVec is
   -- Serialized arbiter input signals.
   signal arb_in_valid           : std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
   signal arb_in_ready           : std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+
+  -- Weighted slave request stream handshakes.
+  signal wgt_valid              : std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+  signal wgt_ready              : std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+  signal wgt_last               : std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
   signal arb_in_data            : std_logic_vector(BQI(BQI'high)*NUM_SLAVE_PORTS-1 downto 0);
 
   -- Arbiter output stream handshake.
@@ -314,18 +325,39 @@ begin
   bms2arb_proc: process (bss_rreq_valid, bss_rreq_addr, bss_rreq_len) is
   begin
     for i in 0 to NUM_SLAVE_PORTS-1 loop
-      arb_in_valid(i) <= bss_rreq_valid(i);
+      wgt_valid(i) <= bss_rreq_valid(i);
       arb_in_data(i*BQI(BQI'high)+BQI(2)-1 downto i*BQI(BQI'high)+BQI(1)) <= bss_rreq_addr(i);
       arb_in_data(i*BQI(BQI'high)+BQI(1)-1 downto i*BQI(BQI'high)+BQI(0)) <= bss_rreq_len(i);
     end loop;
   end process;
-  arb2bms_proc: process (arb_in_ready) is
+  arb2bms_proc: process (wgt_ready) is
   begin
     for i in 0 to NUM_SLAVE_PORTS-1 loop
-      bss_rreq_ready(i) <= arb_in_ready(i);
+      bss_rreq_ready(i) <= wgt_ready(i);
     end loop;
   end process;
 
+  -- Gate the slave request streams according to their weights.
+  -- Every read request is a command of its own.
+  wgt_last <= (others => '1');
+
+  weights_inst: BusArbiterWeights
+    generic map (
+      NUM_SLAVE_PORTS                   => NUM_SLAVE_PORTS,
+      WEIGHTS                           => ARB_WEIGHTS
+    )
+    port map (
+      bcd_clk                           => bcd_clk,
+      bcd_reset                         => bcd_reset,
+
+      in_valid                          => wgt_valid,
+      in_ready                          => wgt_ready,
+      in_last                           => wgt_last,
+
+      out_valid                         => arb_in_valid,
+      out_ready                         => arb_in_ready
+    );
+
   -- Instantiate the stream arbiter.
   arb_inst: StreamArb
     generic map (
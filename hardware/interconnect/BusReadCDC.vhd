@@ -0,0 +1,162 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+use work.UtilInt_pkg.all;
+
+-- This unit moves a read bus from the kernel clock domain to the bus clock
+-- domain through a clock domain crossing FIFO for the request and the data
+-- stream. It is placed by fletchgen between a RecordBatch bus port and the
+-- bus infrastructure when the kernel and the bus run on different clocks.
+entity BusReadCDC is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Minimum number of entries of the FIFOs. Rounded up to a power of two.
+    FIFO_DEPTH                  : natural := 16;
+
+    -- Number of synchronization registers of the FIFOs.
+    XCLK_STAGES                 : natural := 2;
+
+    -- RAM configuration string for the data FIFO.
+    RAM_CONFIG                  : string  := ""
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset of the
+    -- slave port.
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Rising-edge sensitive clock and active-high synchronous reset of the
+    -- master port.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Slave port.
+    slv_rreq_valid              : in  std_logic;
+    slv_rreq_ready              : out std_logic;
+    slv_rreq_addr               : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    slv_rreq_len                : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    slv_rdat_valid              : out std_logic;
+    slv_rdat_ready              : in  std_logic;
+    slv_rdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    slv_rdat_last               : out std_logic;
+
+    -- Master port.
+    mst_rreq_valid              : out std_logic;
+    mst_rreq_ready              : in  std_logic;
+    mst_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    mst_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    mst_rdat_valid              : in  std_logic;
+    mst_rdat_ready              : out std_logic;
+    mst_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    mst_rdat_last               : in  std_logic
+
+  );
+end BusReadCDC;
+
+architecture Behavioral of BusReadCDC is
+
+  -- Log2 of the FIFO depth.
+  constant DEPTH_LOG2           : natural := log2ceil(FIFO_DEPTH);
+
+  -- Bus request serialization indices.
+  constant BQI : nat_array := cumulative((
+    1 => BUS_ADDR_WIDTH,
+    0 => BUS_LEN_WIDTH
+  ));
+
+  signal reqi_sData             : std_logic_vector(BQI(BQI'high)-1 downto 0);
+  signal reqo_sData             : std_logic_vector(BQI(BQI'high)-1 downto 0);
+
+  -- Bus response serialization indices.
+  constant BPI : nat_array := cumulative((
+    1 => BUS_DATA_WIDTH,
+    0 => 1
+  ));
+
+  signal dati_sData             : std_logic_vector(BPI(BPI'high)-1 downto 0);
+  signal dato_sData             : std_logic_vector(BPI(BPI'high)-1 downto 0);
+
+begin
+
+  -- Request FIFO from the kernel to the bus clock domain.
+  req_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                        => DEPTH_LOG2,
+      DATA_WIDTH                        => BQI(BQI'high),
+      XCLK_STAGES                       => XCLK_STAGES
+    )
+    port map (
+      in_clk                            => kcd_clk,
+      in_reset                          => kcd_reset,
+      in_valid                          => slv_rreq_valid,
+      in_ready                          => slv_rreq_ready,
+      in_data                           => reqi_sData,
+      out_clk                           => bcd_clk,
+      out_reset                         => bcd_reset,
+      out_valid                         => mst_rreq_valid,
+      out_ready                         => mst_rreq_ready,
+      out_data                          => reqo_sData
+    );
+
+  reqi_sData(BQI(2)-1 downto BQI(1))    <= slv_rreq_addr;
+  reqi_sData(BQI(1)-1 downto BQI(0))    <= slv_rreq_len;
+
+  mst_rreq_addr                         <= reqo_sData(BQI(2)-1 downto BQI(1));
+  mst_rreq_len                          <= reqo_sData(BQI(1)-1 downto BQI(0));
+
+  -- Data FIFO from the bus to the kernel clock domain.
+  dat_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                        => DEPTH_LOG2,
+      DATA_WIDTH                        => BPI(BPI'high),
+      XCLK_STAGES                       => XCLK_STAGES,
+      RAM_CONFIG                        => RAM_CONFIG
+    )
+    port map (
+      in_clk                            => bcd_clk,
+      in_reset                          => bcd_reset,
+      in_valid                          => mst_rdat_valid,
+      in_ready                          => mst_rdat_ready,
+      in_data                           => dati_sData,
+      out_clk                           => kcd_clk,
+      out_reset                         => kcd_reset,
+      out_valid                         => slv_rdat_valid,
+      out_ready                         => slv_rdat_ready,
+      out_data                          => dato_sData
+    );
+
+  dati_sData(BPI(2)-1 downto BPI(1))    <= mst_rdat_data;
+  dati_sData(BPI(0))                    <= mst_rdat_last;
+
+  slv_rdat_data                         <= dato_sData(BPI(2)-1 downto BPI(1));
+  slv_rdat_last                         <= dato_sData(BPI(0));
+
+end Behavioral;
@@ -0,0 +1,109 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Interconnect_pkg.all;
+
+-- Wrapper for BusReadBuffer with the clock domain port naming that the
+-- arbiters use. This unit is placed by fletchgen between a RecordBatch bus
+-- port and the leaf arbiter it is connected to, such that a master that
+-- does not accept its read data quickly cannot stall the arbiter.
+entity BusReadLeafBuffer is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Minimum number of burst beats that can be stored in the FIFO. Rounded up
+    -- to a power of two. This is also the maximum burst length supported.
+    FIFO_DEPTH                  : natural := 16;
+
+    -- RAM configuration string for the response FIFO.
+    RAM_CONFIG                  : string  := ""
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Slave port.
+    slv_rreq_valid              : in  std_logic;
+    slv_rreq_ready              : out std_logic;
+    slv_rreq_addr               : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    slv_rreq_len                : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    slv_rdat_valid              : out std_logic;
+    slv_rdat_ready              : in  std_logic;
+    slv_rdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    slv_rdat_last               : out std_logic;
+
+    -- Master port.
+    mst_rreq_valid              : out std_logic;
+    mst_rreq_ready              : in  std_logic;
+    mst_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    mst_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    mst_rdat_valid              : in  std_logic;
+    mst_rdat_ready              : out std_logic;
+    mst_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    mst_rdat_last               : in  std_logic
+
+  );
+end BusReadLeafBuffer;
+
+architecture Behavioral of BusReadLeafBuffer is
+begin
+
+  buffer_inst: BusReadBuffer
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      FIFO_DEPTH                => FIFO_DEPTH,
+      RAM_CONFIG                => RAM_CONFIG
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+
+      slv_rreq_valid            => slv_rreq_valid,
+      slv_rreq_ready            => slv_rreq_ready,
+      slv_rreq_addr             => slv_rreq_addr,
+      slv_rreq_len              => slv_rreq_len,
+      slv_rdat_valid            => slv_rdat_valid,
+      slv_rdat_ready            => slv_rdat_ready,
+      slv_rdat_data             => slv_rdat_data,
+      slv_rdat_last             => slv_rdat_last,
+
+      mst_rreq_valid            => mst_rreq_valid,
+      mst_rreq_ready            => mst_rreq_ready,
+      mst_rreq_addr             => mst_rreq_addr,
+      mst_rreq_len              => mst_rreq_len,
+      mst_rdat_valid            => mst_rdat_valid,
+      mst_rdat_ready            => mst_rdat_ready,
+      mst_rdat_data             => mst_rdat_data,
+      mst_rdat_last             => mst_rdat_last
+    );
+
+end Behavioral;
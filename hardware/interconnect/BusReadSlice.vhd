@@ -0,0 +1,118 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+
+-- Register slice for a read bus. Both the request and the data stream pass
+-- through a StreamSlice, which breaks all combinatorial paths between the
+-- slave and the master port, including the ready signals. This unit is placed
+-- by fletchgen on long bus connections, at the cost of one cycle of latency
+-- in every direction.
+entity BusReadSlice is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Slave port.
+    slv_rreq_valid              : in  std_logic;
+    slv_rreq_ready              : out std_logic;
+    slv_rreq_addr               : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    slv_rreq_len                : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    slv_rdat_valid              : out std_logic;
+    slv_rdat_ready              : in  std_logic;
+    slv_rdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    slv_rdat_last               : out std_logic;
+
+    -- Master port.
+    mst_rreq_valid              : out std_logic;
+    mst_rreq_ready              : in  std_logic;
+    mst_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    mst_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    mst_rdat_valid              : in  std_logic;
+    mst_rdat_ready              : out std_logic;
+    mst_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    mst_rdat_last               : in  std_logic
+
+  );
+end BusReadSlice;
+
+architecture Behavioral of BusReadSlice is
+
+  signal slv_req_data           : std_logic_vector(BUS_ADDR_WIDTH+BUS_LEN_WIDTH-1 downto 0);
+  signal mst_req_data           : std_logic_vector(BUS_ADDR_WIDTH+BUS_LEN_WIDTH-1 downto 0);
+  signal mst_dat_data           : std_logic_vector(BUS_DATA_WIDTH downto 0);
+  signal slv_dat_data           : std_logic_vector(BUS_DATA_WIDTH downto 0);
+
+begin
+
+  slv_req_data <= slv_rreq_addr & slv_rreq_len;
+
+  req_slice_inst: StreamSlice
+    generic map (
+      DATA_WIDTH                => BUS_ADDR_WIDTH+BUS_LEN_WIDTH
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      in_valid                  => slv_rreq_valid,
+      in_ready                  => slv_rreq_ready,
+      in_data                   => slv_req_data,
+      out_valid                 => mst_rreq_valid,
+      out_ready                 => mst_rreq_ready,
+      out_data                  => mst_req_data
+    );
+
+  mst_rreq_addr <= mst_req_data(BUS_ADDR_WIDTH+BUS_LEN_WIDTH-1 downto BUS_LEN_WIDTH);
+  mst_rreq_len  <= mst_req_data(BUS_LEN_WIDTH-1 downto 0);
+
+  mst_dat_data <= mst_rdat_last & mst_rdat_data;
+
+  dat_slice_inst: StreamSlice
+    generic map (
+      DATA_WIDTH                => BUS_DATA_WIDTH+1
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      in_valid                  => mst_rdat_valid,
+      in_ready                  => mst_rdat_ready,
+      in_data                   => mst_dat_data,
+      out_valid                 => slv_rdat_valid,
+      out_ready                 => slv_rdat_ready,
+      out_data                  => slv_dat_data
+    );
+
+  slv_rdat_last <= slv_dat_data(BUS_DATA_WIDTH);
+  slv_rdat_data <= slv_dat_data(BUS_DATA_WIDTH-1 downto 0);
+
+end Behavioral;
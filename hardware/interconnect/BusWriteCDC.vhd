@@ -0,0 +1,199 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+use work.UtilInt_pkg.all;
+
+-- This unit moves a write bus from the kernel clock domain to the bus clock
+-- domain through a clock domain crossing FIFO for the request, data and
+-- response streams. It is placed by fletchgen between a RecordBatch bus port
+-- and the bus infrastructure when the kernel and the bus run on different
+-- clocks.
+entity BusWriteCDC is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Minimum number of entries of the FIFOs. Rounded up to a power of two.
+    FIFO_DEPTH                  : natural := 16;
+
+    -- Number of synchronization registers of the FIFOs.
+    XCLK_STAGES                 : natural := 2;
+
+    -- RAM configuration string for the data FIFO.
+    RAM_CONFIG                  : string  := ""
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset of the
+    -- slave port.
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Rising-edge sensitive clock and active-high synchronous reset of the
+    -- master port.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Slave port.
+    slv_wreq_valid              : in  std_logic;
+    slv_wreq_ready              : out std_logic;
+    slv_wreq_addr               : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    slv_wreq_len                : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    slv_wreq_last               : in  std_logic;
+    slv_wdat_valid              : in  std_logic;
+    slv_wdat_ready              : out std_logic;
+    slv_wdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    slv_wdat_strobe             : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    slv_wdat_last               : in  std_logic;
+    slv_wrep_valid              : out std_logic;
+    slv_wrep_ready              : in  std_logic;
+    slv_wrep_ok                 : out std_logic;
+
+    -- Master port.
+    mst_wreq_valid              : out std_logic;
+    mst_wreq_ready              : in  std_logic;
+    mst_wreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    mst_wreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    mst_wreq_last               : out std_logic;
+    mst_wdat_valid              : out std_logic;
+    mst_wdat_ready              : in  std_logic;
+    mst_wdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    mst_wdat_strobe             : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    mst_wdat_last               : out std_logic;
+    mst_wrep_valid              : in  std_logic;
+    mst_wrep_ready              : out std_logic;
+    mst_wrep_ok                 : in  std_logic
+
+  );
+end BusWriteCDC;
+
+architecture Behavioral of BusWriteCDC is
+
+  -- Log2 of the FIFO depth.
+  constant DEPTH_LOG2           : natural := log2ceil(FIFO_DEPTH);
+
+  -- Bus request serialization indices.
+  constant BQI : nat_array := cumulative((
+    2 => BUS_ADDR_WIDTH,
+    1 => BUS_LEN_WIDTH,
+    0 => 1
+  ));
+
+  signal reqi_sData             : std_logic_vector(BQI(BQI'high)-1 downto 0);
+  signal reqo_sData             : std_logic_vector(BQI(BQI'high)-1 downto 0);
+
+  -- Bus data serialization indices.
+  constant BDI : nat_array := cumulative((
+    2 => BUS_DATA_WIDTH,
+    1 => BUS_DATA_WIDTH/8,
+    0 => 1
+  ));
+
+  signal dati_sData             : std_logic_vector(BDI(BDI'high)-1 downto 0);
+  signal dato_sData             : std_logic_vector(BDI(BDI'high)-1 downto 0);
+
+begin
+
+  -- Request FIFO from the kernel to the bus clock domain.
+  req_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                        => DEPTH_LOG2,
+      DATA_WIDTH                        => BQI(BQI'high),
+      XCLK_STAGES                       => XCLK_STAGES
+    )
+    port map (
+      in_clk                            => kcd_clk,
+      in_reset                          => kcd_reset,
+      in_valid                          => slv_wreq_valid,
+      in_ready                          => slv_wreq_ready,
+      in_data                           => reqi_sData,
+      out_clk                           => bcd_clk,
+      out_reset                         => bcd_reset,
+      out_valid                         => mst_wreq_valid,
+      out_ready                         => mst_wreq_ready,
+      out_data                          => reqo_sData
+    );
+
+  reqi_sData(BQI(3)-1 downto BQI(2))    <= slv_wreq_addr;
+  reqi_sData(BQI(2)-1 downto BQI(1))    <= slv_wreq_len;
+  reqi_sData(BQI(0))                    <= slv_wreq_last;
+
+  mst_wreq_addr                         <= reqo_sData(BQI(3)-1 downto BQI(2));
+  mst_wreq_len                          <= reqo_sData(BQI(2)-1 downto BQI(1));
+  mst_wreq_last                         <= reqo_sData(BQI(0));
+
+  -- Data FIFO from the kernel to the bus clock domain.
+  dat_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                        => DEPTH_LOG2,
+      DATA_WIDTH                        => BDI(BDI'high),
+      XCLK_STAGES                       => XCLK_STAGES,
+      RAM_CONFIG                        => RAM_CONFIG
+    )
+    port map (
+      in_clk                            => kcd_clk,
+      in_reset                          => kcd_reset,
+      in_valid                          => slv_wdat_valid,
+      in_ready                          => slv_wdat_ready,
+      in_data                           => dati_sData,
+      out_clk                           => bcd_clk,
+      out_reset                         => bcd_reset,
+      out_valid                         => mst_wdat_valid,
+      out_ready                         => mst_wdat_ready,
+      out_data                          => dato_sData
+    );
+
+  dati_sData(BDI(3)-1 downto BDI(2))    <= slv_wdat_data;
+  dati_sData(BDI(2)-1 downto BDI(1))    <= slv_wdat_strobe;
+  dati_sData(BDI(0))                    <= slv_wdat_last;
+
+  mst_wdat_data                         <= dato_sData(BDI(3)-1 downto BDI(2));
+  mst_wdat_strobe                       <= dato_sData(BDI(2)-1 downto BDI(1));
+  mst_wdat_last                         <= dato_sData(BDI(0));
+
+  -- Response FIFO from the bus to the kernel clock domain.
+  rep_fifo_inst: StreamFIFO
+    generic map (
+      DEPTH_LOG2                        => DEPTH_LOG2,
+      DATA_WIDTH                        => 1,
+      XCLK_STAGES                       => XCLK_STAGES
+    )
+    port map (
+      in_clk                            => bcd_clk,
+      in_reset                          => bcd_reset,
+      in_valid                          => mst_wrep_valid,
+      in_ready                          => mst_wrep_ready,
+      in_data(0)                        => mst_wrep_ok,
+      out_clk                           => kcd_clk,
+      out_reset                         => kcd_reset,
+      out_valid                         => slv_wrep_valid,
+      out_ready                         => slv_wrep_ready,
+      out_data(0)                       => slv_wrep_ok
+    );
+
+end Behavioral;
@@ -0,0 +1,134 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Interconnect_pkg.all;
+
+-- Wrapper for BusWriteBuffer with the clock domain port naming that the
+-- arbiters use. This unit is placed by fletchgen between a RecordBatch bus
+-- port and the leaf arbiter it is connected to, such that write bursts are
+-- only forwarded to the arbiter once their data is available.
+entity BusWriteLeafBuffer is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32;
+
+    -- Minimum number of burst beats that can be stored in the FIFO. Rounded up
+    -- to a power of two. This is also the maximum burst length supported.
+    FIFO_DEPTH                  : natural := 16;
+
+    -- RAM configuration string for the data FIFO.
+    RAM_CONFIG                  : string  := ""
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Slave port.
+    slv_wreq_valid              : in  std_logic;
+    slv_wreq_ready              : out std_logic;
+    slv_wreq_addr               : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    slv_wreq_len                : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    slv_wreq_last               : in  std_logic;
+    slv_wdat_valid              : in  std_logic;
+    slv_wdat_ready              : out std_logic;
+    slv_wdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    slv_wdat_strobe             : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    slv_wdat_last               : in  std_logic;
+    slv_wrep_valid              : out std_logic;
+    slv_wrep_ready              : in  std_logic;
+    slv_wrep_ok                 : out std_logic;
+
+    -- Master port.
+    mst_wreq_valid              : out std_logic;
+    mst_wreq_ready              : in  std_logic;
+    mst_wreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    mst_wreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    mst_wreq_last               : out std_logic;
+    mst_wdat_valid              : out std_logic;
+    mst_wdat_ready              : in  std_logic;
+    mst_wdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    mst_wdat_strobe             : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    mst_wdat_last               : out std_logic;
+    mst_wrep_valid              : in  std_logic;
+    mst_wrep_ready              : out std_logic;
+    mst_wrep_ok                 : in  std_logic
+
+  );
+end BusWriteLeafBuffer;
+
+architecture Behavioral of BusWriteLeafBuffer is
+begin
+
+  buffer_inst: BusWriteBuffer
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      FIFO_DEPTH                => FIFO_DEPTH,
+      RAM_CONFIG                => RAM_CONFIG
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      full                      => open,
+      empty                     => open,
+      error                     => open,
+      count                     => open,
+
+      slv_wreq_valid            => slv_wreq_valid,
+      slv_wreq_ready            => slv_wreq_ready,
+      slv_wreq_addr             => slv_wreq_addr,
+      slv_wreq_len              => slv_wreq_len,
+      slv_wreq_last             => slv_wreq_last,
+      slv_wdat_valid            => slv_wdat_valid,
+      slv_wdat_ready            => slv_wdat_ready,
+      slv_wdat_data             => slv_wdat_data,
+      slv_wdat_strobe           => slv_wdat_strobe,
+      slv_wdat_last             => slv_wdat_last,
+      slv_wrep_valid            => slv_wrep_valid,
+      slv_wrep_ready            => slv_wrep_ready,
+      slv_wrep_ok               => slv_wrep_ok,
+
+      mst_wreq_valid            => mst_wreq_valid,
+      mst_wreq_ready            => mst_wreq_ready,
+      mst_wreq_addr             => mst_wreq_addr,
+      mst_wreq_len              => mst_wreq_len,
+      mst_wreq_last             => mst_wreq_last,
+      mst_wdat_valid            => mst_wdat_valid,
+      mst_wdat_ready            => mst_wdat_ready,
+      mst_wdat_data             => mst_wdat_data,
+      mst_wdat_strobe           => mst_wdat_strobe,
+      mst_wdat_last             => mst_wdat_last,
+      mst_wdat_ctrl             => open,
+      mst_wrep_valid            => mst_wrep_valid,
+      mst_wrep_ready            => mst_wrep_ready,
+      mst_wrep_ok               => mst_wrep_ok
+    );
+
+end Behavioral;
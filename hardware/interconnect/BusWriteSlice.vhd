@@ -0,0 +1,154 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Stream_pkg.all;
+
+-- Register slice for a write bus. The request, data and response streams pass
+-- through a StreamSlice, which breaks all combinatorial paths between the
+-- slave and the master port, including the ready signals. This unit is placed
+-- by fletchgen on long bus connections, at the cost of one cycle of latency
+-- in every direction.
+entity BusWriteSlice is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 32;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width.
+    BUS_DATA_WIDTH              : natural := 32
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    bcd_clk                     : in  std_logic;
+    bcd_reset                   : in  std_logic;
+
+    -- Slave port.
+    slv_wreq_valid              : in  std_logic;
+    slv_wreq_ready              : out std_logic;
+    slv_wreq_addr               : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    slv_wreq_len                : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    slv_wreq_last               : in  std_logic;
+    slv_wdat_valid              : in  std_logic;
+    slv_wdat_ready              : out std_logic;
+    slv_wdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    slv_wdat_strobe             : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    slv_wdat_last               : in  std_logic;
+    slv_wrep_valid              : out std_logic;
+    slv_wrep_ready              : in  std_logic;
+    slv_wrep_ok                 : out std_logic;
+
+    -- Master port.
+    mst_wreq_valid              : out std_logic;
+    mst_wreq_ready              : in  std_logic;
+    mst_wreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    mst_wreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    mst_wreq_last               : out std_logic;
+    mst_wdat_valid              : out std_logic;
+    mst_wdat_ready              : in  std_logic;
+    mst_wdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    mst_wdat_strobe             : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    mst_wdat_last               : out std_logic;
+    mst_wrep_valid              : in  std_logic;
+    mst_wrep_ready              : out std_logic;
+    mst_wrep_ok                 : in  std_logic
+
+  );
+end BusWriteSlice;
+
+architecture Behavioral of BusWriteSlice is
+
+  constant REQ_WIDTH            : natural := BUS_ADDR_WIDTH+BUS_LEN_WIDTH+1;
+  constant DAT_WIDTH            : natural := BUS_DATA_WIDTH+BUS_DATA_WIDTH/8+1;
+
+  signal slv_req_data           : std_logic_vector(REQ_WIDTH-1 downto 0);
+  signal mst_req_data           : std_logic_vector(REQ_WIDTH-1 downto 0);
+  signal slv_dat_data           : std_logic_vector(DAT_WIDTH-1 downto 0);
+  signal mst_dat_data           : std_logic_vector(DAT_WIDTH-1 downto 0);
+  signal mst_rep_data           : std_logic_vector(0 downto 0);
+  signal slv_rep_data           : std_logic_vector(0 downto 0);
+
+begin
+
+  slv_req_data <= slv_wreq_last & slv_wreq_addr & slv_wreq_len;
+
+  req_slice_inst: StreamSlice
+    generic map (
+      DATA_WIDTH                => REQ_WIDTH
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      in_valid                  => slv_wreq_valid,
+      in_ready                  => slv_wreq_ready,
+      in_data                   => slv_req_data,
+      out_valid                 => mst_wreq_valid,
+      out_ready                 => mst_wreq_ready,
+      out_data                  => mst_req_data
+    );
+
+  mst_wreq_last <= mst_req_data(REQ_WIDTH-1);
+  mst_wreq_addr <= mst_req_data(BUS_ADDR_WIDTH+BUS_LEN_WIDTH-1 downto BUS_LEN_WIDTH);
+  mst_wreq_len  <= mst_req_data(BUS_LEN_WIDTH-1 downto 0);
+
+  slv_dat_data <= slv_wdat_last & slv_wdat_strobe & slv_wdat_data;
+
+  dat_slice_inst: StreamSlice
+    generic map (
+      DATA_WIDTH                => DAT_WIDTH
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      in_valid                  => slv_wdat_valid,
+      in_ready                  => slv_wdat_ready,
+      in_data                   => slv_dat_data,
+      out_valid                 => mst_wdat_valid,
+      out_ready                 => mst_wdat_ready,
+      out_data                  => mst_dat_data
+    );
+
+  mst_wdat_last   <= mst_dat_data(DAT_WIDTH-1);
+  mst_wdat_strobe <= mst_dat_data(DAT_WIDTH-2 downto BUS_DATA_WIDTH);
+  mst_wdat_data   <= mst_dat_data(BUS_DATA_WIDTH-1 downto 0);
+
+  mst_rep_data(0) <= mst_wrep_ok;
+
+  rep_slice_inst: StreamSlice
+    generic map (
+      DATA_WIDTH                => 1
+    )
+    port map (
+      clk                       => bcd_clk,
+      reset                     => bcd_reset,
+      in_valid                  => mst_wrep_valid,
+      in_ready                  => mst_wrep_ready,
+      in_data                   => mst_rep_data,
+      out_valid                 => slv_wrep_valid,
+      out_ready                 => slv_wrep_ready,
+      out_data                  => slv_rep_data
+    );
+
+  slv_wrep_ok <= slv_rep_data(0);
+
+end Behavioral;
@@ -36,6 +36,22 @@ package Interconnect_pkg is
   -----------------------------------------------------------------------------
   -- Bus devices
   -----------------------------------------------------------------------------
+  component BusArbiterWeights is
+    generic (
+      NUM_SLAVE_PORTS           : natural := 2;
+      WEIGHTS                   : string := ""
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      in_valid                  : in  std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+      in_ready                  : out std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+      in_last                   : in  std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+      out_valid                 : out std_logic_vector(NUM_SLAVE_PORTS-1 downto 0);
+      out_ready                 : in  std_logic_vector(NUM_SLAVE_PORTS-1 downto 0)
+    );
+  end component;
+
   component BusReadArbiterVec is
     generic (
       BUS_ADDR_WIDTH            : natural := 32;
@@ -43,6 +59,7 @@ package Interconnect_pkg is
       BUS_DATA_WIDTH            : natural := 32;
       NUM_SLAVE_PORTS           : natural := 2;
       ARB_METHOD                : string  := "ROUND-ROBIN";
+      ARB_WEIGHTS               : string  := "";
       MAX_OUTSTANDING           : natural := 2;
       RAM_CONFIG                : string  := "";
       SLV_REQ_SLICES            : boolean := true;
@@ -81,6 +98,7 @@ package Interconnect_pkg is
       BUS_DATA_WIDTH            : natural := 32;
       NUM_SLAVE_PORTS           : natural := 2;
       ARB_METHOD                : string := "ROUND-ROBIN";
+      ARB_WEIGHTS               : string := "";
       MAX_OUTSTANDING           : natural := 2;
       RAM_CONFIG                : string := "";
       SLV_REQ_SLICES            : boolean := false;
@@ -216,6 +234,218 @@ package Interconnect_pkg is
     );
   end component;
 
+  component BusReadLeafBuffer is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      FIFO_DEPTH                : natural := 16;
+      RAM_CONFIG                : string  := ""
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      slv_rreq_valid            : in  std_logic;
+      slv_rreq_ready            : out std_logic;
+      slv_rreq_addr             : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      slv_rreq_len              : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      slv_rdat_valid            : out std_logic;
+      slv_rdat_ready            : in  std_logic;
+      slv_rdat_data             : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      slv_rdat_last             : out std_logic;
+      mst_rreq_valid            : out std_logic;
+      mst_rreq_ready            : in  std_logic;
+      mst_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      mst_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      mst_rdat_valid            : in  std_logic;
+      mst_rdat_ready            : out std_logic;
+      mst_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      mst_rdat_last             : in  std_logic
+    );
+  end component;
+
+  component BusWriteLeafBuffer is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      FIFO_DEPTH                : natural := 16;
+      RAM_CONFIG                : string  := ""
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      slv_wreq_valid            : in  std_logic;
+      slv_wreq_ready            : out std_logic;
+      slv_wreq_addr             : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      slv_wreq_len              : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      slv_wreq_last             : in  std_logic;
+      slv_wdat_valid            : in  std_logic;
+      slv_wdat_ready            : out std_logic;
+      slv_wdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      slv_wdat_strobe           : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      slv_wdat_last             : in  std_logic;
+      slv_wrep_valid            : out std_logic;
+      slv_wrep_ready            : in  std_logic;
+      slv_wrep_ok               : out std_logic;
+      mst_wreq_valid            : out std_logic;
+      mst_wreq_ready            : in  std_logic;
+      mst_wreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      mst_wreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      mst_wreq_last             : out std_logic;
+      mst_wdat_valid            : out std_logic;
+      mst_wdat_ready            : in  std_logic;
+      mst_wdat_data             : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      mst_wdat_strobe           : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      mst_wdat_last             : out std_logic;
+      mst_wrep_valid            : in  std_logic;
+      mst_wrep_ready            : out std_logic;
+      mst_wrep_ok               : in  std_logic
+    );
+  end component;
+
+  component BusReadSlice is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      slv_rreq_valid            : in  std_logic;
+      slv_rreq_ready            : out std_logic;
+      slv_rreq_addr             : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      slv_rreq_len              : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      slv_rdat_valid            : out std_logic;
+      slv_rdat_ready            : in  std_logic;
+      slv_rdat_data             : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      slv_rdat_last             : out std_logic;
+      mst_rreq_valid            : out std_logic;
+      mst_rreq_ready            : in  std_logic;
+      mst_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      mst_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      mst_rdat_valid            : in  std_logic;
+      mst_rdat_ready            : out std_logic;
+      mst_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      mst_rdat_last             : in  std_logic
+    );
+  end component;
+
+  component BusWriteSlice is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32
+    );
+    port (
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      slv_wreq_valid            : in  std_logic;
+      slv_wreq_ready            : out std_logic;
+      slv_wreq_addr             : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      slv_wreq_len              : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      slv_wreq_last             : in  std_logic;
+      slv_wdat_valid            : in  std_logic;
+      slv_wdat_ready            : out std_logic;
+      slv_wdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      slv_wdat_strobe           : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      slv_wdat_last             : in  std_logic;
+      slv_wrep_valid            : out std_logic;
+      slv_wrep_ready            : in  std_logic;
+      slv_wrep_ok               : out std_logic;
+      mst_wreq_valid            : out std_logic;
+      mst_wreq_ready            : in  std_logic;
+      mst_wreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      mst_wreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      mst_wreq_last             : out std_logic;
+      mst_wdat_valid            : out std_logic;
+      mst_wdat_ready            : in  std_logic;
+      mst_wdat_data             : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      mst_wdat_strobe           : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      mst_wdat_last             : out std_logic;
+      mst_wrep_valid            : in  std_logic;
+      mst_wrep_ready            : out std_logic;
+      mst_wrep_ok               : in  std_logic
+    );
+  end component;
+
+  component BusReadCDC is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      FIFO_DEPTH                : natural := 16;
+      XCLK_STAGES               : natural := 2;
+      RAM_CONFIG                : string  := ""
+    );
+    port (
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      slv_rreq_valid            : in  std_logic;
+      slv_rreq_ready            : out std_logic;
+      slv_rreq_addr             : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      slv_rreq_len              : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      slv_rdat_valid            : out std_logic;
+      slv_rdat_ready            : in  std_logic;
+      slv_rdat_data             : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      slv_rdat_last             : out std_logic;
+      mst_rreq_valid            : out std_logic;
+      mst_rreq_ready            : in  std_logic;
+      mst_rreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      mst_rreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      mst_rdat_valid            : in  std_logic;
+      mst_rdat_ready            : out std_logic;
+      mst_rdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      mst_rdat_last             : in  std_logic
+    );
+  end component;
+
+  component BusWriteCDC is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 32;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 32;
+      FIFO_DEPTH                : natural := 16;
+      XCLK_STAGES               : natural := 2;
+      RAM_CONFIG                : string  := ""
+    );
+    port (
+      kcd_clk                   : in  std_logic;
+      kcd_reset                 : in  std_logic;
+      bcd_clk                   : in  std_logic;
+      bcd_reset                 : in  std_logic;
+      slv_wreq_valid            : in  std_logic;
+      slv_wreq_ready            : out std_logic;
+      slv_wreq_addr             : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      slv_wreq_len              : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      slv_wreq_last             : in  std_logic;
+      slv_wdat_valid            : in  std_logic;
+      slv_wdat_ready            : out std_logic;
+      slv_wdat_data             : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      slv_wdat_strobe           : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      slv_wdat_last             : in  std_logic;
+      slv_wrep_valid            : out std_logic;
+      slv_wrep_ready            : in  std_logic;
+      slv_wrep_ok               : out std_logic;
+      mst_wreq_valid            : out std_logic;
+      mst_wreq_ready            : in  std_logic;
+      mst_wreq_addr             : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      mst_wreq_len              : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      mst_wreq_last             : out std_logic;
+      mst_wdat_valid            : out std_logic;
+      mst_wdat_ready            : in  std_logic;
+      mst_wdat_data             : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      mst_wdat_strobe           : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      mst_wdat_last             : out std_logic;
+      mst_wrep_valid            : in  std_logic;
+      mst_wrep_ready            : out std_logic;
+      mst_wrep_ok               : in  std_logic
+    );
+  end component;
+
   component BusReadArbiter is
     generic (
       BUS_ADDR_WIDTH            : natural := 32;
@@ -688,7 +918,11 @@ package Interconnect_pkg is
       SEED                      : positive := 1;
       RANDOM_REQUEST_TIMING     : boolean := true;
       RANDOM_RESPONSE_TIMING    : boolean := true;
-      SREC_FILE                 : string := ""
+      SREC_FILE                 : string := "";
+      BIN_FILE                  : string := "";
+      LATENCY                   : natural := 0;
+      BANDWIDTH                 : natural := 0;
+      MAX_OUTSTANDING           : positive := 1
     );
     port (
       clk                       : in  std_logic;
@@ -700,7 +934,8 @@ package Interconnect_pkg is
       rdat_valid                : out std_logic;
       rdat_ready                : in  std_logic;
       rdat_data                 : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
-      rdat_last                 : out std_logic
+      rdat_last                 : out std_logic;
+      print_stats               : in  std_logic := '0'
     );
   end component;
 
@@ -738,7 +973,9 @@ package Interconnect_pkg is
       SEED                      : positive;
       RANDOM_REQUEST_TIMING     : boolean := false;
       RANDOM_RESPONSE_TIMING    : boolean := false;
-      SREC_FILE                 : string  := ""
+      SREC_FILE                 : string  := "";
+      LATENCY                   : natural := 0;
+      BANDWIDTH                 : natural := 0
     );
     port (
       clk                       : in  std_logic;
@@ -755,7 +992,8 @@ package Interconnect_pkg is
       wdat_last                 : in  std_logic;
       wrep_valid                : out std_logic;
       wrep_ready                : in  std_logic;
-      wrep_ok                   : out std_logic
+      wrep_ok                   : out std_logic;
+      print_stats               : in  std_logic := '0'
     );
   end component;
   
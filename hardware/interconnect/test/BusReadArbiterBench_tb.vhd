@@ -0,0 +1,219 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.Interconnect_pkg.all;
+use work.UtilStr_pkg.all;
+
+-------------------------------------------------------------------------------
+-- This testbench measures the throughput of the BusReadArbiterVec.
+--
+-- Every slave port of the arbiter is driven by a master that requests BURSTS
+-- bursts of BURST_LEN words back-to-back and is always ready to receive data.
+-- The master port of the arbiter is connected to a bus slave mock without
+-- random timing. The number of words received by all masters and the number of
+-- cycles from reset up to the last word are printed on a single line starting
+-- with BENCH, which is parsed by hardware/test/bench/sweep.py.
+-------------------------------------------------------------------------------
+entity BusReadArbiterBench_tb is
+  generic (
+    TEST_NAME                   : string   := "BusReadArbiter";
+    BUS_ADDR_WIDTH              : natural  := 64;
+    BUS_LEN_WIDTH               : natural  := 9;
+    BUS_DATA_WIDTH              : natural  := 512;
+    NUM_MASTERS                 : natural  := 2;
+    ARB_METHOD                  : string   := "ROUND-ROBIN";
+    MAX_OUTSTANDING             : natural  := 4;
+    BURST_LEN                   : positive := 16;
+    BURSTS                      : positive := 64;
+
+    -- Bus slave mock.
+    SLAVE_LATENCY               : natural  := 0;
+    SLAVE_MAX_OUTSTANDING       : positive := 4
+  );
+end BusReadArbiterBench_tb;
+
+architecture tb of BusReadArbiterBench_tb is
+  constant BURST_BYTES          : natural := BURST_LEN * BUS_DATA_WIDTH / 8;
+
+  signal sim_done               : boolean := false;
+
+  signal clk                    : std_logic := '1';
+  signal reset                  : std_logic := '1';
+
+  signal mst_rreq_valid         : std_logic;
+  signal mst_rreq_ready         : std_logic;
+  signal mst_rreq_addr          : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+  signal mst_rreq_len           : std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+  signal mst_rdat_valid         : std_logic;
+  signal mst_rdat_ready         : std_logic;
+  signal mst_rdat_data          : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+  signal mst_rdat_last          : std_logic;
+
+  signal bsv_rreq_valid         : std_logic_vector(NUM_MASTERS-1 downto 0) := (others => '0');
+  signal bsv_rreq_ready         : std_logic_vector(NUM_MASTERS-1 downto 0);
+  signal bsv_rreq_addr          : std_logic_vector(NUM_MASTERS*BUS_ADDR_WIDTH-1 downto 0);
+  signal bsv_rreq_len           : std_logic_vector(NUM_MASTERS*BUS_LEN_WIDTH-1 downto 0);
+  signal bsv_rdat_valid         : std_logic_vector(NUM_MASTERS-1 downto 0);
+  signal bsv_rdat_ready         : std_logic_vector(NUM_MASTERS-1 downto 0) := (others => '1');
+  signal bsv_rdat_data          : std_logic_vector(NUM_MASTERS*BUS_DATA_WIDTH-1 downto 0);
+  signal bsv_rdat_last          : std_logic_vector(NUM_MASTERS-1 downto 0);
+
+begin
+
+  -- Clock
+  clk_proc: process is
+  begin
+    if not sim_done then
+      clk                       <= '1';
+      wait for 2 ns;
+      clk                       <= '0';
+      wait for 2 ns;
+    else
+      wait;
+    end if;
+  end process;
+
+  -- Reset
+  reset_proc: process is
+  begin
+    reset                       <= '1';
+    wait for 8 ns;
+    wait until rising_edge(clk);
+    reset                       <= '0';
+    wait;
+  end process;
+
+  -- Request generators, every master reading its own region.
+  master_gen: for i in 0 to NUM_MASTERS-1 generate
+    request_proc: process is
+    begin
+      bsv_rreq_len((i+1)*BUS_LEN_WIDTH-1 downto i*BUS_LEN_WIDTH)
+                                <= std_logic_vector(to_unsigned(BURST_LEN, BUS_LEN_WIDTH));
+      wait until rising_edge(clk) and reset = '0';
+      for b in 0 to BURSTS-1 loop
+        bsv_rreq_valid(i)       <= '1';
+        bsv_rreq_addr((i+1)*BUS_ADDR_WIDTH-1 downto i*BUS_ADDR_WIDTH)
+                                <= std_logic_vector(to_unsigned((i*BURSTS+b)*BURST_BYTES, BUS_ADDR_WIDTH));
+        wait until rising_edge(clk) and bsv_rreq_ready(i) = '1';
+      end loop;
+      bsv_rreq_valid(i)         <= '0';
+      wait;
+    end process;
+  end generate;
+
+  -- Count cycles and words from reset up to the last burst of all masters.
+  measure_proc: process is
+    variable cycles             : natural := 0;
+    variable words              : natural := 0;
+    variable bursts             : natural := 0;
+  begin
+    wait until rising_edge(clk) and reset = '0';
+
+    loop
+      wait until rising_edge(clk);
+      cycles                    := cycles + 1;
+      for i in 0 to NUM_MASTERS-1 loop
+        if bsv_rdat_valid(i) = '1' and bsv_rdat_ready(i) = '1' then
+          words                 := words + 1;
+          if bsv_rdat_last(i) = '1' then
+            bursts              := bursts + 1;
+          end if;
+        end if;
+      end loop;
+      exit when bursts = NUM_MASTERS * BURSTS;
+    end loop;
+
+    println("BENCH " & TEST_NAME
+      & " elements " & intToDec(words)
+      & " transfers " & intToDec(words)
+      & " words " & intToDec(words)
+      & " cycles " & intToDec(cycles));
+
+    if words /= NUM_MASTERS * BURSTS * BURST_LEN then
+      report "TEST FAILURE. Expected " & intToDec(NUM_MASTERS * BURSTS * BURST_LEN) & " words, received "
+        & intToDec(words) & "." severity failure;
+    end if;
+
+    sim_done                    <= true;
+
+    -- Dirty trick to allow stdout to empty write buffer since textio doesn't have a flush function
+    wait for 100 ns;
+
+    report "TEST SUCCESSFUL.";
+
+    wait;
+  end process;
+
+  slave_inst: BusReadSlaveMock
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      SEED                      => 1,
+      RANDOM_REQUEST_TIMING     => false,
+      RANDOM_RESPONSE_TIMING    => false,
+      LATENCY                   => SLAVE_LATENCY,
+      MAX_OUTSTANDING           => SLAVE_MAX_OUTSTANDING
+    )
+    port map (
+      clk                       => clk,
+      reset                     => reset,
+      rreq_valid                => mst_rreq_valid,
+      rreq_ready                => mst_rreq_ready,
+      rreq_addr                 => mst_rreq_addr,
+      rreq_len                  => mst_rreq_len,
+      rdat_valid                => mst_rdat_valid,
+      rdat_ready                => mst_rdat_ready,
+      rdat_data                 => mst_rdat_data,
+      rdat_last                 => mst_rdat_last
+    );
+
+  uut: BusReadArbiterVec
+    generic map (
+      BUS_ADDR_WIDTH            => BUS_ADDR_WIDTH,
+      BUS_LEN_WIDTH             => BUS_LEN_WIDTH,
+      BUS_DATA_WIDTH            => BUS_DATA_WIDTH,
+      NUM_SLAVE_PORTS           => NUM_MASTERS,
+      ARB_METHOD                => ARB_METHOD,
+      MAX_OUTSTANDING           => MAX_OUTSTANDING
+    )
+    port map (
+      bcd_clk                   => clk,
+      bcd_reset                 => reset,
+
+      mst_rreq_valid            => mst_rreq_valid,
+      mst_rreq_ready            => mst_rreq_ready,
+      mst_rreq_addr             => mst_rreq_addr,
+      mst_rreq_len              => mst_rreq_len,
+      mst_rdat_valid            => mst_rdat_valid,
+      mst_rdat_ready            => mst_rdat_ready,
+      mst_rdat_data             => mst_rdat_data,
+      mst_rdat_last             => mst_rdat_last,
+
+      bsv_rreq_valid            => bsv_rreq_valid,
+      bsv_rreq_ready            => bsv_rreq_ready,
+      bsv_rreq_addr             => bsv_rreq_addr,
+      bsv_rreq_len              => bsv_rreq_len,
+      bsv_rdat_valid            => bsv_rdat_valid,
+      bsv_rdat_ready            => bsv_rdat_ready,
+      bsv_rdat_data             => bsv_rdat_data,
+      bsv_rdat_last             => bsv_rdat_last
+    );
+
+end architecture;
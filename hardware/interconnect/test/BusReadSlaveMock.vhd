@@ -21,10 +21,18 @@ library work;
 use work.Stream_pkg.all;
 use work.Interconnect_pkg.all;
 use work.UtilMem64_pkg.all;
+use work.UtilStr_pkg.all;
 
 -- This simulation-only unit is a mockup of a bus slave that can either
--- respond based on an S-record file of the memory contents, or simply returns
--- the requested address as data. The handshake signals can be randomized.
+-- respond based on an S-record file or a raw binary image of the memory
+-- contents, or simply returns the requested address as data. The handshake
+-- signals can be randomized.
+--
+-- To approximate the timing of a real memory, the mock can delay the first
+-- word of every response, cap the number of bytes it returns per cycle, and
+-- accept multiple requests before the first one is answered. When
+-- print_stats is asserted, the mock prints the number of words it returned
+-- and the achieved bandwidth since the first request.
 
 entity BusReadSlaveMock is
   generic (
@@ -48,9 +56,25 @@ entity BusReadSlaveMock is
     -- Whether to randomize the request stream handshake timing.
     RANDOM_RESPONSE_TIMING      : boolean := true;
 
-    -- S-record file to load into memory. If not specified, the unit reponds
-    -- with the requested address for each word.
-    SREC_FILE                   : string := ""
+    -- S-record file to load into memory. If neither this nor BIN_FILE is
+    -- specified, the unit reponds with the requested address for each word.
+    SREC_FILE                   : string := "";
+
+    -- Raw binary memory image to load into memory, starting at address 0.
+    -- Loads much faster than an S-record file of the same contents.
+    BIN_FILE                    : string := "";
+
+    -- Number of cycles between accepting a request and returning its first
+    -- word.
+    LATENCY                     : natural := 0;
+
+    -- Maximum number of bytes returned per cycle, averaged over time. 0
+    -- returns up to a bus word every cycle.
+    BANDWIDTH                   : natural := 0;
+
+    -- Maximum number of requests that are accepted but not completely
+    -- answered yet.
+    MAX_OUTSTANDING             : positive := 1
 
   );
   port (
@@ -68,28 +92,106 @@ entity BusReadSlaveMock is
     rdat_valid                  : out std_logic := '0';
     rdat_ready                  : in  std_logic;
     rdat_data                   : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
-    rdat_last                   : out std_logic
+    rdat_last                   : out std_logic;
+
+    -- Print the statistics of the mock on a rising edge.
+    print_stats                 : in  std_logic := '0'
 
   );
 end BusReadSlaveMock;
 
+
 architecture Behavioral of BusReadSlaveMock is
+
+  -- Number of bytes in a bus word.
+  constant WORD_BYTES           : natural := BUS_DATA_WIDTH / 8;
+
+  -- A request that was accepted, but not completely answered yet.
+  type request_type is record
+    addr                        : unsigned(63 downto 0);
+    len                         : natural;
+    -- Cycle from which the first word of the response may be returned.
+    due                         : natural;
+  end record;
+
+  type request_array is array (natural range <>) of request_type;
+
+  -- Return a non-negative real number as a string with two decimals.
+  function realToStr(x : real) return string is
+    variable hundredths         : natural;
+  begin
+    hundredths := natural(x * 100.0);
+    if hundredths mod 100 < 10 then
+      return integer'image(hundredths / 100) & ".0" & integer'image(hundredths mod 100);
+    end if;
+    return integer'image(hundredths / 100) & "." & integer'image(hundredths mod 100);
+  end function;
+
 begin
 
-  -- Request handler. First accepts and ready's a command, then outputs the a
-  -- response burst as fast as possible.
+  -- Request handler. Accepts requests while fewer than MAX_OUTSTANDING
+  -- requests are being answered, and returns the words of every request in
+  -- order, as soon as the latency has passed and the bandwidth allows it.
   process is
-    variable len    : natural;
-    variable addr   : unsigned(63 downto 0);
     variable data   : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
     variable mem    : mem_state_type;
     variable seed1  : positive := SEED;
     variable seed2  : positive := 1;
     variable rand   : real;
+
+    -- Accepted requests, oldest first.
+    variable queue      : request_array(0 to MAX_OUTSTANDING-1);
+    variable count      : natural;
+    -- Index of the next word of the oldest request.
+    variable beat       : natural;
+    variable cycle      : natural;
+    -- Bytes that may be returned, refilled by BANDWIDTH bytes every cycle.
+    variable credit     : natural;
+    -- Whether to wait for a request before asserting ready.
+    variable wait_valid : boolean;
+    -- The handshake signals as driven in the previous cycle.
+    variable req_ready  : boolean;
+    variable dat_valid  : boolean;
+    variable dat_accept : boolean;
+
+    -- Loads a raw binary memory image, starting at address 0.
+    procedure mem_loadBin(mem: inout mem_state_type; fname: in string) is
+      type char_file_type is file of character;
+      file     f      : char_file_type;
+      variable status : file_open_status;
+      variable c      : character;
+      variable word   : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      variable waddr  : unsigned(63 downto 0) := (others => '0');
+      variable idx    : natural := 0;
+    begin
+      file_open(status, f, fname, read_mode);
+      assert status = open_ok
+        report "Could not open memory image " & fname severity failure;
+      word := (others => '0');
+      while not endfile(f) loop
+        read(f, c);
+        word(8*idx+7 downto 8*idx) := std_logic_vector(to_unsigned(character'pos(c), 8));
+        idx := idx + 1;
+        if idx = BUS_DATA_WIDTH / 8 then
+          mem_write(mem, std_logic_vector(waddr), word);
+          waddr := waddr + (BUS_DATA_WIDTH / 8);
+          word := (others => '0');
+          idx := 0;
+        end if;
+      end loop;
+      if idx > 0 then
+        mem_write(mem, std_logic_vector(waddr), word);
+      end if;
+      file_close(f);
+    end procedure;
+
   begin
     if SREC_FILE /= "" then
       mem_clear(mem);
       mem_loadSRec(mem, SREC_FILE);
+    elsif BIN_FILE /= "" then
+      mem_clear(mem);
+      mem_loadBin(mem, BIN_FILE);
     end if;
 
     state: loop
@@ -99,99 +201,168 @@ begin
       rdat_valid <= '0';
       rdat_data <= (others => '0');
       rdat_last <= '0';
-
-      -- Delay randomly before accepting the next request, if enabled.
-      if RANDOM_REQUEST_TIMING then
-
-        -- Consumers are allowed to wait for valid before asserting ready, but
-        -- they can also assert ready earlier. In the latter case, ready can
-        -- toggle whenever the consumer wants. Model both kinds of interface
-        -- styles with a 50/50 chance to test both,
-        uniform(seed1, seed2, rand);
-        if rand < 0.5 then
-          while rreq_valid /= '1' loop
-            wait until rising_edge(clk);
-            exit state when reset = '1';
-          end loop;
-        end if;
-
-        -- Delay randomly before accepting the transfer.
-        loop
-          uniform(seed1, seed2, rand);
-          if rand < 0.3 then
-            rreq_ready <= '1';
-            wait until rising_edge(clk);
-            exit state when reset = '1';
-            exit when rreq_valid = '1';
-          else
-            rreq_ready <= '0';
-            wait until rising_edge(clk);
-            exit state when reset = '1';
-          end if;
-        end loop;
-        rreq_ready <= '0';
-
-      else
-
-        -- Wait for request valid.
-        loop
-          wait until rising_edge(clk);
-          exit state when reset = '1';
-          exit when rreq_valid = '1';
-        end loop;
-
-        -- Accept the request.
-        rreq_ready <= '1';
+      count := 0;
+      beat := 0;
+      cycle := 0;
+      credit := WORD_BYTES;
+      wait_valid := false;
+      req_ready := false;
+      dat_valid := false;
+
+      loop
         wait until rising_edge(clk);
         exit state when reset = '1';
-        rreq_ready <= '0';
-
-      end if;
+        cycle := cycle + 1;
+
+        -- Handle the response handshake of the previous cycle.
+        dat_accept := dat_valid and rdat_ready = '1';
+        if dat_accept then
+          credit := credit - WORD_BYTES;
+          beat := beat + 1;
+          if beat = queue(0).len then
+            for i in 1 to count-1 loop
+              queue(i-1) := queue(i);
+            end loop;
+            count := count - 1;
+            beat := 0;
+          end if;
+        end if;
 
-      addr := resize(unsigned(rreq_addr), 64);
-      len := to_integer(unsigned(rreq_len));
+        -- Handle the request handshake of the previous cycle. Requests for
+        -- zero words are accepted, but not answered.
+        if req_ready and rreq_valid = '1' then
+          if unsigned(rreq_len) /= 0 then
+            queue(count).addr := resize(unsigned(rreq_addr), 64);
+            queue(count).len := to_integer(unsigned(rreq_len));
+            queue(count).due := cycle + LATENCY;
+            count := count + 1;
+          end if;
 
-      for i in 0 to len-1 loop
+          -- Consumers are allowed to wait for valid before asserting ready, but
+          -- they can also assert ready earlier. In the latter case, ready can
+          -- toggle whenever the consumer wants. Model both kinds of interface
+          -- styles with a 50/50 chance to test both.
+          if RANDOM_REQUEST_TIMING then
+            uniform(seed1, seed2, rand);
+            wait_valid := rand < 0.5;
+          end if;
+        end if;
 
-        -- Figure out what data to respond with.
-        if SREC_FILE /= "" then
-          mem_read(mem, std_logic_vector(addr), data);
+        -- Refill the bandwidth credit, but never beyond a single word, such
+        -- that idle cycles cannot be made up for later.
+        if BANDWIDTH = 0 then
+          credit := WORD_BYTES;
         else
-          data := std_logic_vector(resize(addr, BUS_DATA_WIDTH));
+          credit := credit + BANDWIDTH;
+          if credit > WORD_BYTES then
+            credit := WORD_BYTES;
+          end if;
         end if;
 
-        -- Delay randomly before generating the next response, if enabled.
-        if RANDOM_RESPONSE_TIMING then
-          loop
+        -- Accept a request when there is room for it, delaying randomly if
+        -- enabled.
+        req_ready := count < MAX_OUTSTANDING;
+        if req_ready and RANDOM_REQUEST_TIMING then
+          uniform(seed1, seed2, rand);
+          req_ready := rand < 0.3 and not (wait_valid and rreq_valid /= '1');
+        end if;
+
+        -- A response word stays valid until it is accepted. Otherwise, return
+        -- the next word when its request is due and the bandwidth allows it,
+        -- delaying randomly if enabled.
+        if dat_accept or not dat_valid then
+          dat_valid := count > 0 and credit >= WORD_BYTES;
+          if dat_valid then
+            dat_valid := cycle >= queue(0).due;
+          end if;
+          if dat_valid and RANDOM_RESPONSE_TIMING then
             uniform(seed1, seed2, rand);
-            exit when rand < 0.3;
-            wait until rising_edge(clk);
-            exit state when reset = '1';
-          end loop;
+            dat_valid := rand < 0.3;
+          end if;
+          if dat_valid then
+            -- Figure out what data to respond with.
+            if SREC_FILE /= "" or BIN_FILE /= "" then
+              mem_read(mem, std_logic_vector(queue(0).addr + beat * WORD_BYTES), data);
+            else
+              data := std_logic_vector(resize(queue(0).addr + beat * WORD_BYTES, BUS_DATA_WIDTH));
+            end if;
+            rdat_data <= data;
+            if beat = queue(0).len - 1 then
+              rdat_last <= '1';
+            else
+              rdat_last <= '0';
+            end if;
+          end if;
         end if;
 
-        -- Assert response.
-        rdat_valid <= '1';
-        rdat_data <= data;
-        if i = len-1 then
-          rdat_last <= '1';
+        if req_ready then
+          rreq_ready <= '1';
         else
-          rdat_last <= '0';
+          rreq_ready <= '0';
+        end if;
+        if dat_valid then
+          rdat_valid <= '1';
+        else
+          rdat_valid <= '0';
         end if;
-
-        -- Wait for response ready.
-        loop
-          wait until rising_edge(clk);
-          exit state when reset = '1';
-          exit when rdat_ready = '1';
-        end loop;
-        rdat_valid <= '0';
-
-        addr := addr + (BUS_DATA_WIDTH / 8);
 
       end loop;
 
-    end loop;
+    end loop state;
+  end process;
+
+  -- Statistics of the responses since the first request after reset.
+  stats_proc: process is
+    variable cycle      : natural := 0;
+    variable first      : natural := 0;
+    variable last       : natural := 0;
+    variable started    : boolean := false;
+    variable words      : natural := 0;
+    variable start_time : time := 0 ns;
+    variable end_time   : time := 0 ns;
+    variable cycles     : natural;
+    variable bytes      : real;
+    variable ns         : real;
+  begin
+    wait on clk, print_stats;
+    if rising_edge(clk) then
+      cycle := cycle + 1;
+      if reset = '1' then
+        started := false;
+        words := 0;
+      else
+        if not started and rreq_valid = '1' then
+          started := true;
+          first := cycle;
+          last := cycle;
+          start_time := now;
+          end_time := now;
+        end if;
+        if rdat_valid = '1' and rdat_ready = '1' then
+          words := words + 1;
+          last := cycle;
+          end_time := now;
+        end if;
+      end if;
+    end if;
+    if rising_edge(print_stats) then
+      cycles := last - first + 1;
+      bytes := real(words) * real(WORD_BYTES);
+      ns := real((end_time - start_time) / 1 ns);
+      if not started then
+        println(BusReadSlaveMock'path_name & ": no requests.");
+      else
+        println(BusReadSlaveMock'path_name & ": "
+          & integer'image(words) & " words in "
+          & integer'image(cycles) & " cycles from the first request to the last word, "
+          & realToStr(bytes / real(cycles)) & " B/cycle ("
+          & realToStr(100.0 * real(words) / real(cycles)) & "% of the bus)");
+        if ns > 0.0 then
+          println(BusReadSlaveMock'path_name & ": "
+            & realToStr(bytes / ns) & " GB/s");
+        end if;
+      end if;
+    end if;
   end process;
 
 end Behavioral;
@@ -26,6 +26,12 @@ use work.UtilStr_pkg.all;
 -- This simulation-only unit is a mockup of a bus slave that can either write 
 -- to an S-record file, or simply accept and print the written data on stdout.
 -- The handshake signals can be randomized.
+--
+-- To approximate the timing of a real memory, the mock can cap the number of
+-- bytes it accepts per cycle, and delay the write response after the last
+-- word of every request. When print_stats is asserted, the mock prints the
+-- number of words it accepted and the achieved bandwidth since the first
+-- request.
 
 entity BusWriteSlaveMock is
   generic (
@@ -51,7 +57,15 @@ entity BusWriteSlaveMock is
 
     -- S-record file to dump writes. If not specified, the unit dumps the 
     -- writes on stdout
-    SREC_FILE                   : string := ""
+    SREC_FILE                   : string := "";
+
+    -- Number of cycles between accepting the last word of a request and
+    -- returning its write response.
+    LATENCY                     : natural := 0;
+
+    -- Maximum number of bytes accepted per cycle, averaged over time. 0
+    -- accepts up to a bus word every cycle.
+    BANDWIDTH                   : natural := 0
 
   );
   port (
@@ -74,13 +88,30 @@ entity BusWriteSlaveMock is
     wdat_last                   : in  std_logic;
     wrep_valid                  : out std_logic;
     wrep_ready                  : in  std_logic;
-    wrep_ok                     : out std_logic
+    wrep_ok                     : out std_logic;
+
+    -- Print the statistics of the mock on a rising edge.
+    print_stats                 : in  std_logic := '0'
 
   );
 end BusWriteSlaveMock;
 
 architecture Behavioral of BusWriteSlaveMock is
 
+  -- Number of bytes in a bus word.
+  constant WORD_BYTES           : natural := BUS_DATA_WIDTH / 8;
+
+  -- Return a non-negative real number as a string with two decimals.
+  function realToStr(x : real) return string is
+    variable hundredths         : natural;
+  begin
+    hundredths := natural(x * 100.0);
+    if hundredths mod 100 < 10 then
+      return integer'image(hundredths / 100) & ".0" & integer'image(hundredths mod 100);
+    end if;
+    return integer'image(hundredths / 100) & "." & integer'image(hundredths mod 100);
+  end function;
+
   signal wreq_cons_valid        : std_logic;
   signal wreq_cons_ready        : std_logic;
 
@@ -93,8 +124,13 @@ architecture Behavioral of BusWriteSlaveMock is
   signal wdat_int_valid         : std_logic;
   signal wdat_int_ready         : std_logic;
 
+  -- Internal copy of wdat_ready, such that the statistics can use it.
+  signal wdat_ready_int         : std_logic := '0';
+
 begin
 
+  wdat_ready <= wdat_ready_int;
+
   -- Request handler. First accepts and ready's a command, then outputs the a
   -- response burst as fast as possible.
   process is
@@ -102,6 +138,21 @@ begin
     variable addr   : unsigned(63 downto 0);
     variable data   : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
     variable mem    : mem_state_type;
+
+    -- Bytes that may be accepted, refilled by BANDWIDTH bytes every cycle.
+    variable credit : natural;
+
+    -- Refills the bandwidth credit, but never beyond a single word, such that
+    -- idle cycles cannot be made up for later.
+    procedure refill is
+    begin
+      if BANDWIDTH = 0 or credit + BANDWIDTH > WORD_BYTES then
+        credit := WORD_BYTES;
+      else
+        credit := credit + BANDWIDTH;
+      end if;
+    end procedure;
+
   begin
     if SREC_FILE /= "" then
       mem_clear(mem);
@@ -111,11 +162,15 @@ begin
 
       -- Reset state.
       wreq_ready <= '0';
+      wdat_ready_int <= '0';
+      wrep_valid <= '0';
+      credit := WORD_BYTES;
 
       -- Wait for request valid.
       loop
         wait until rising_edge(clk);
         exit state when reset = '1';
+        refill;
         exit when wreq_valid = '1';
       end loop;
 
@@ -126,18 +181,34 @@ begin
       wreq_ready <= '1';
       wait until rising_edge(clk);
       exit state when reset = '1';
+      refill;
       wreq_ready <= '0';
 
       for i in 0 to len-1 loop
 
+        -- Wait until the bandwidth allows accepting another word.
+        while credit < WORD_BYTES loop
+          wdat_ready_int <= '0';
+          wait until rising_edge(clk);
+          exit state when reset = '1';
+          refill;
+        end loop;
+
         -- Accept the incoming data
-        wdat_ready <= '1';
+        wdat_ready_int <= '1';
         
-        -- Wait for response ready.
+        -- Wait for response ready. The credit of an accepted word is spent
+        -- before refilling, such that a bandwidth of a bus word per cycle
+        -- accepts a word every cycle.
         loop
           wait until rising_edge(clk);
           exit state when reset = '1';
-          exit when wdat_valid = '1';
+          if wdat_valid = '1' then
+            credit := credit - WORD_BYTES;
+            refill;
+            exit;
+          end if;
+          refill;
         end loop;
         
         -- Print or dump the data to an SREC file
@@ -160,7 +231,14 @@ begin
       end loop;
       
       -- Stop accepting data
-      wdat_ready <= '0';
+      wdat_ready_int <= '0';
+
+      -- Delay the response.
+      for i in 1 to LATENCY loop
+        wait until rising_edge(clk);
+        exit state when reset = '1';
+        refill;
+      end loop;
       
       -- Send response
       wrep_valid <= '1';
@@ -170,6 +248,7 @@ begin
       loop
         wait until rising_edge(clk);
         exit state when reset = '1';
+        refill;
         exit when wrep_ready = '1';
       end loop;
       
@@ -179,5 +258,59 @@ begin
     end loop;
   end process;
 
+  -- Statistics of the accepted data since the first request after reset.
+  stats_proc: process is
+    variable cycle      : natural := 0;
+    variable first      : natural := 0;
+    variable last       : natural := 0;
+    variable started    : boolean := false;
+    variable words      : natural := 0;
+    variable start_time : time := 0 ns;
+    variable end_time   : time := 0 ns;
+    variable cycles     : natural;
+    variable bytes      : real;
+    variable ns         : real;
+  begin
+    wait on clk, print_stats;
+    if rising_edge(clk) then
+      cycle := cycle + 1;
+      if reset = '1' then
+        started := false;
+        words := 0;
+      else
+        if not started and wreq_valid = '1' then
+          started := true;
+          first := cycle;
+          last := cycle;
+          start_time := now;
+          end_time := now;
+        end if;
+        if wdat_valid = '1' and wdat_ready_int = '1' then
+          words := words + 1;
+          last := cycle;
+          end_time := now;
+        end if;
+      end if;
+    end if;
+    if rising_edge(print_stats) then
+      cycles := last - first + 1;
+      bytes := real(words) * real(WORD_BYTES);
+      ns := real((end_time - start_time) / 1 ns);
+      if not started then
+        println(BusWriteSlaveMock'path_name & ": no requests.");
+      else
+        println(BusWriteSlaveMock'path_name & ": "
+          & integer'image(words) & " words in "
+          & integer'image(cycles) & " cycles from the first request to the last word, "
+          & realToStr(bytes / real(cycles)) & " B/cycle ("
+          & realToStr(100.0 * real(words) / real(cycles)) & "% of the bus)");
+        if ns > 0.0 then
+          println(BusWriteSlaveMock'path_name & ": "
+            & realToStr(bytes / ns) & " GB/s");
+        end if;
+      end if;
+    end if;
+  end process;
+
 end Behavioral;
 
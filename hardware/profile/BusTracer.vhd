@@ -0,0 +1,136 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Records the requests of a number of bus ports into an on-chip ring of
+-- 2**DEPTH_LOG2 entries, while enabled. Every entry holds the cycle at which
+-- the request was handshaked, relative to the last clear, the index of the
+-- port, and the address and length of the request. When the ring is full, the
+-- oldest entries are overwritten.
+--
+-- A single request is recorded per cycle. When multiple ports handshake a
+-- request in the same cycle, the one with the lowest index is recorded, and
+-- the others are counted as dropped.
+--
+-- The count output holds the number of requests recorded since the last clear.
+-- The n-th recorded request, counting from zero, is held at index n modulo
+-- 2**DEPTH_LOG2 until it is overwritten. The entry outputs show the entry at
+-- the index input, one cycle after it was set.
+entity BusTracer is
+  generic (
+    BUS_ADDR_WIDTH  : natural := 64;
+    BUS_DATA_WIDTH  : natural := 512;
+    BUS_LEN_WIDTH   : natural := 8;
+    NUM_PORTS       : positive := 1;
+    DEPTH_LOG2      : positive := 10
+  );
+  port (
+    pcd_clk         : in  std_logic;
+    pcd_reset       : in  std_logic;
+    probe_valid     : in  std_logic_vector(NUM_PORTS-1 downto 0);
+    probe_ready     : in  std_logic_vector(NUM_PORTS-1 downto 0);
+    probe_addr      : in  std_logic_vector(NUM_PORTS*BUS_ADDR_WIDTH-1 downto 0);
+    probe_len       : in  std_logic_vector(NUM_PORTS*BUS_LEN_WIDTH-1 downto 0);
+    enable          : in  std_logic;
+    clear           : in  std_logic;
+    index           : in  std_logic_vector(31 downto 0);
+    count           : out std_logic_vector(31 downto 0);
+    dropped         : out std_logic_vector(31 downto 0);
+    entry_cycle     : out std_logic_vector(31 downto 0);
+    entry_port      : out std_logic_vector(31 downto 0);
+    entry_addr      : out std_logic_vector(63 downto 0);
+    entry_len       : out std_logic_vector(31 downto 0)
+  );
+end BusTracer;
+
+architecture Behavioral of BusTracer is
+  constant PORT_WIDTH   : natural := 16;
+  constant ENTRY_WIDTH  : natural := 32 + PORT_WIDTH + BUS_ADDR_WIDTH + BUS_LEN_WIDTH;
+
+  -- Entry layout, from LSB to MSB: length, address, port, cycle.
+  constant LEN_LSB      : natural := 0;
+  constant ADDR_LSB     : natural := LEN_LSB + BUS_LEN_WIDTH;
+  constant PORT_LSB     : natural := ADDR_LSB + BUS_ADDR_WIDTH;
+  constant CYCLE_LSB    : natural := PORT_LSB + PORT_WIDTH;
+
+  type ring_type is array (0 to 2**DEPTH_LOG2-1) of std_logic_vector(ENTRY_WIDTH-1 downto 0);
+  signal ring           : ring_type;
+
+  signal cycles         : unsigned(31 downto 0);
+  signal recorded       : unsigned(31 downto 0);
+  signal drops          : unsigned(31 downto 0);
+  signal entry          : std_logic_vector(ENTRY_WIDTH-1 downto 0);
+begin
+
+  process(pcd_clk) is
+    variable found      : boolean;
+    variable handshakes : natural range 0 to NUM_PORTS;
+    variable sel_port   : natural range 0 to NUM_PORTS-1;
+    variable sel_addr   : std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    variable sel_len    : std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+  begin
+    if rising_edge(pcd_clk) then
+      -- Read port of the ring, for the host to read out entries.
+      entry <= ring(to_integer(unsigned(index(DEPTH_LOG2-1 downto 0))));
+
+      if enable = '1' then
+        found := false;
+        handshakes := 0;
+        sel_port := 0;
+        sel_addr := (others => '0');
+        sel_len := (others => '0');
+        for i in 0 to NUM_PORTS-1 loop
+          if (probe_valid(i) = '1') and (probe_ready(i) = '1') then
+            if not found then
+              found := true;
+              sel_port := i;
+              sel_addr := probe_addr((i+1)*BUS_ADDR_WIDTH-1 downto i*BUS_ADDR_WIDTH);
+              sel_len := probe_len((i+1)*BUS_LEN_WIDTH-1 downto i*BUS_LEN_WIDTH);
+            end if;
+            handshakes := handshakes + 1;
+          end if;
+        end loop;
+
+        if found then
+          ring(to_integer(recorded(DEPTH_LOG2-1 downto 0))) <=
+            std_logic_vector(cycles)
+            & std_logic_vector(to_unsigned(sel_port, PORT_WIDTH))
+            & sel_addr
+            & sel_len;
+          recorded <= recorded + 1;
+          drops <= drops + handshakes - 1;
+        end if;
+
+        cycles <= cycles + 1;
+      end if;
+
+      if (pcd_reset = '1') or (clear = '1') then
+        cycles   <= (others => '0');
+        recorded <= (others => '0');
+        drops    <= (others => '0');
+      end if;
+    end if;
+  end process;
+
+  count       <= std_logic_vector(recorded);
+  dropped     <= std_logic_vector(drops);
+  entry_cycle <= entry(CYCLE_LSB+31 downto CYCLE_LSB);
+  entry_port  <= std_logic_vector(resize(unsigned(entry(PORT_LSB+PORT_WIDTH-1 downto PORT_LSB)), 32));
+  entry_addr  <= std_logic_vector(resize(unsigned(entry(ADDR_LSB+BUS_ADDR_WIDTH-1 downto ADDR_LSB)), 64));
+  entry_len   <= std_logic_vector(resize(unsigned(entry(LEN_LSB+BUS_LEN_WIDTH-1 downto LEN_LSB)), 32));
+
+end architecture;
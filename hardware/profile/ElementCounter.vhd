@@ -0,0 +1,60 @@
+-- Copyright 2018-2019 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Accumulates the number of elements transferred on a stream, i.e. the sum of
+-- the count field of every handshaked transfer. Fletchgen attaches these to
+-- the streams that the kernel writes to RecordBatches, and clears them when
+-- the kernel is started, such that the host can read how many elements were
+-- written to every buffer after the kernel is done.
+entity ElementCounter is
+  generic (
+    PROBE_COUNT_WIDTH : positive;
+    OUT_COUNT_WIDTH   : positive
+  );
+  port (
+    pcd_clk         : in  std_logic;
+    pcd_reset       : in  std_logic;
+    probe_valid     : in  std_logic;
+    probe_ready     : in  std_logic;
+    probe_last      : in  std_logic;
+    probe_count     : in  std_logic_vector(PROBE_COUNT_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(1, PROBE_COUNT_WIDTH));
+    clear           : in  std_logic;
+    count_elements  : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0)
+  );
+end ElementCounter;
+
+architecture Behavioral of ElementCounter is
+  signal elements : unsigned(OUT_COUNT_WIDTH-1 downto 0);
+begin
+
+  process(pcd_clk) is
+  begin
+    if rising_edge(pcd_clk) then
+      if (probe_valid = '1') and (probe_ready = '1') then
+        elements <= elements + resize(unsigned(probe_count), OUT_COUNT_WIDTH);
+      end if;
+
+      if (pcd_reset = '1') or (clear = '1') then
+        elements <= (others => '0');
+      end if;
+    end if;
+  end process;
+
+  count_elements <= std_logic_vector(elements);
+
+end architecture;
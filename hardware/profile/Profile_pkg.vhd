@@ -32,6 +32,7 @@ package Profile_pkg is
       probe_count     : in  std_logic_vector(PROBE_COUNT_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(1, PROBE_COUNT_WIDTH));
       enable          : in  std_logic;
       clear           : in  std_logic;
+      snapshot        : in  std_logic := '1';
       count_elements  : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0);
       count_valids    : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0);
       count_readies   : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0);
@@ -41,4 +42,48 @@ package Profile_pkg is
     );
   end component;
 
+  component ElementCounter is
+    generic (
+      PROBE_COUNT_WIDTH : positive := 1;
+      OUT_COUNT_WIDTH   : positive := 32
+    );
+    port (
+      pcd_clk         : in  std_logic;
+      pcd_reset       : in  std_logic;
+      probe_valid     : in  std_logic;
+      probe_ready     : in  std_logic;
+      probe_last      : in  std_logic;
+      probe_count     : in  std_logic_vector(PROBE_COUNT_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(1, PROBE_COUNT_WIDTH));
+      clear           : in  std_logic;
+      count_elements  : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0)
+    );
+  end component;
+
+  component BusTracer is
+    generic (
+      BUS_ADDR_WIDTH  : natural := 64;
+      BUS_DATA_WIDTH  : natural := 512;
+      BUS_LEN_WIDTH   : natural := 8;
+      NUM_PORTS       : positive := 1;
+      DEPTH_LOG2      : positive := 10
+    );
+    port (
+      pcd_clk         : in  std_logic;
+      pcd_reset       : in  std_logic;
+      probe_valid     : in  std_logic_vector(NUM_PORTS-1 downto 0);
+      probe_ready     : in  std_logic_vector(NUM_PORTS-1 downto 0);
+      probe_addr      : in  std_logic_vector(NUM_PORTS*BUS_ADDR_WIDTH-1 downto 0);
+      probe_len       : in  std_logic_vector(NUM_PORTS*BUS_LEN_WIDTH-1 downto 0);
+      enable          : in  std_logic;
+      clear           : in  std_logic;
+      index           : in  std_logic_vector(31 downto 0);
+      count           : out std_logic_vector(31 downto 0);
+      dropped         : out std_logic_vector(31 downto 0);
+      entry_cycle     : out std_logic_vector(31 downto 0);
+      entry_port      : out std_logic_vector(31 downto 0);
+      entry_addr      : out std_logic_vector(63 downto 0);
+      entry_len       : out std_logic_vector(31 downto 0)
+    );
+  end component;
+
 end Profile_pkg;
@@ -21,6 +21,12 @@ library work;
 use work.UtilStr_pkg.all;
 use work.UtilConv_pkg.all;
 
+-- Counts the number of valid, ready, handshaked and last cycles of a stream,
+-- and the number of cycles while the profiler is enabled. The count outputs
+-- are shadow registers that are loaded with all counter values at once when
+-- snapshot is asserted, such that a consistent set of counts can be read out
+-- while the profiler is counting. When snapshot is left unconnected, the count
+-- outputs follow the counters.
 entity Profiler is
   generic (
     PROBE_COUNT_WIDTH : positive;
@@ -35,6 +41,7 @@ entity Profiler is
     probe_count     : in  std_logic_vector(PROBE_COUNT_WIDTH-1 downto 0) := std_logic_vector(to_unsigned(1, PROBE_COUNT_WIDTH));
     enable          : in  std_logic;
     clear           : in  std_logic;
+    snapshot        : in  std_logic := '1';
     count_elements  : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0);
     count_valids    : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0);
     count_readies   : out std_logic_vector(OUT_COUNT_WIDTH-1 downto 0);
@@ -83,12 +90,14 @@ begin
       cycles    := ZERO_COUNT;
     end if;
 
-    count_elements  <= std_logic_vector(elements);
-    count_valids    <= std_logic_vector(valids);
-    count_readies   <= std_logic_vector(readies);
-    count_transfers <= std_logic_vector(transfers);
-    count_packets   <= std_logic_vector(packets);
-    count_cycles    <= std_logic_vector(cycles);
+    if (snapshot = '1') then
+      count_elements  <= std_logic_vector(elements);
+      count_valids    <= std_logic_vector(valids);
+      count_readies   <= std_logic_vector(readies);
+      count_transfers <= std_logic_vector(transfers);
+      count_packets   <= std_logic_vector(packets);
+      count_cycles    <= std_logic_vector(cycles);
+    end if;
   end if;
 
 end process;
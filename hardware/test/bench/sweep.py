@@ -0,0 +1,245 @@
+#!/usr/bin/env python3
+# Copyright 2018 Delft University of Technology
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Throughput characterization of the BufferReader, BufferWriter and BusReadArbiterVec.
+
+For every combination of the swept generics, a test case is generated that instantiates the benchmark testbench of a
+component, and all test cases are simulated with vhdeps and GHDL. Every testbench prints the number of elements, stream
+transfers and bus words it transferred and the number of cycles it took, from which a table of the achieved throughput
+is printed.
+"""
+
+import argparse
+import csv
+import itertools
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+HARDWARE = os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..'))
+
+# The benchmark testbench of every component, with the generics that are swept by default.
+BENCHES = {
+    'reader': {
+        'entity': 'BufferReaderBench_tb',
+        'sweep': {
+            'BUS_DATA_WIDTH': [64, 512],
+            'ELEMENT_WIDTH': [8, 32, 64],
+            'BUS_BURST_MAX_LEN': [16, 64],
+            'BUS_FIFO_DEPTH': [16, 64],
+        },
+    },
+    'writer': {
+        'entity': 'BufferWriterBench_tb',
+        'sweep': {
+            'BUS_DATA_WIDTH': [64, 512],
+            'ELEMENT_WIDTH': [8, 32, 64],
+            'BUS_BURST_MAX_LEN': [16, 64],
+            'BUS_FIFO_DEPTH': [16, 64],
+        },
+    },
+    'arbiter': {
+        'entity': 'BusReadArbiterBench_tb',
+        'sweep': {
+            'BUS_DATA_WIDTH': [64, 512],
+            'NUM_MASTERS': [1, 2, 4, 8],
+            'BURST_LEN': [1, 4, 16, 64],
+        },
+    },
+}
+
+BENCH = re.compile(r'BENCH (\S+) elements (\d+) transfers (\d+) words (\d+) cycles (\d+)')
+
+TEST_CASE = '''library ieee;
+use ieee.std_logic_1164.all;
+
+--pragma simulation timeout {timeout}
+
+entity {name}_tc is
+end {name}_tc;
+
+architecture TestCase of {name}_tc is
+begin
+  tb: entity work.{entity} generic map (
+{generics}
+  );
+end TestCase;
+'''
+
+
+def literal(value):
+    """Return a Python value as a VHDL literal."""
+    if isinstance(value, bool):
+        return 'true' if value else 'false'
+    if isinstance(value, str):
+        return '"{}"'.format(value)
+    return str(value)
+
+
+def parse_value(value):
+    """Parse a generic value given on the command line."""
+    if value.lower() in ('true', 'false'):
+        return value.lower() == 'true'
+    try:
+        return int(value)
+    except ValueError:
+        return value
+
+
+def configurations(bench, overrides, only):
+    """Return every combination of the swept generics of a bench, as a list of dicts.
+
+    Overridden generics apply to a bench if it sweeps them by default, or if it is the only bench.
+    """
+    sweep = dict(BENCHES[bench]['sweep'])
+    sweep.update({k: v for k, v in overrides.items() if only or k in sweep})
+    names = sorted(sweep)
+    return [dict(zip(names, values)) for values in itertools.product(*(sweep[n] for n in names))]
+
+
+def valid(bench, config):
+    """Return whether a configuration can be instantiated."""
+    data = config.get('BUS_DATA_WIDTH', 512)
+    if bench in ('reader', 'writer'):
+        count = config.get('ELEMENT_COUNT_MAX', 1)
+        return config.get('ELEMENT_WIDTH', 32) * count <= data and config.get('BUS_BURST_MAX_LEN', 64) <= 256
+    return config.get('BURST_LEN', 16) <= 256
+
+
+def generate(directory, tests, timeout):
+    """Write the test cases of all configurations to a directory."""
+    for name, (bench, config) in tests.items():
+        generics = dict(config)
+        generics['TEST_NAME'] = name
+        lines = ['    {:<27} => {}'.format(k, literal(v)) for k, v in sorted(generics.items())]
+        with open(os.path.join(directory, name + '_tc.vhd'), 'w') as f:
+            f.write(TEST_CASE.format(name=name, entity=BENCHES[bench]['entity'], generics=',\n'.join(lines),
+                                     timeout=timeout))
+
+
+def simulate(directory, jobs):
+    """Simulate all test cases in a directory and return the output."""
+    sim = subprocess.run(['vhdeps', '-i', HARDWARE, '-i', directory, 'ghdl', '-j', str(jobs), '--',
+                          '--pattern', 'Bench*_tc'],
+                         stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    return sim.stdout
+
+
+def results(tests, output):
+    """Combine the configurations of all tests with their measurements."""
+    measured = {}
+    for match in BENCH.finditer(output):
+        measured[match.group(1)] = [int(match.group(i)) for i in range(2, 6)]
+    rows = []
+    for name, (bench, config) in tests.items():
+        if name not in measured:
+            print('{}: no measurement, the simulation failed.'.format(name), file=sys.stderr)
+            continue
+        elements, transfers, words, cycles = measured[name]
+        data = config.get('BUS_DATA_WIDTH', 512)
+        if bench == 'arbiter':
+            element_bytes = data / 8
+        else:
+            element_bytes = config.get('ELEMENT_WIDTH', 32) / 8
+        row = {'bench': bench}
+        row.update(config)
+        row.update({
+            'elements/cycle': elements / cycles,
+            'bytes/cycle': elements * element_bytes / cycles,
+            'transfers/cycle': transfers / cycles,
+            'bus words/cycle': words / cycles,
+            'efficiency': elements * element_bytes / cycles / (data / 8),
+        })
+        rows.append(row)
+    return rows
+
+
+def columns_of(rows):
+    """Return the columns of rows of results, in order of appearance."""
+    columns = []
+    for row in rows:
+        columns += [c for c in row if c not in columns]
+    return columns
+
+
+def table(rows):
+    """Return rows of results as a Markdown table."""
+    columns = columns_of(rows)
+
+    def cell(row, column):
+        value = row.get(column, '')
+        return '{:.3f}'.format(value) if isinstance(value, float) else str(value)
+
+    lines = ['| ' + ' | '.join(columns) + ' |', '|' + '|'.join('---' for _ in columns) + '|']
+    lines += ['| ' + ' | '.join(cell(row, c) for c in columns) + ' |' for row in rows]
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('benches', nargs='*', default=sorted(BENCHES),
+                        help='The components to characterize, out of {}. Default: all components.'.format(
+                            ', '.join(sorted(BENCHES))))
+    parser.add_argument('--set', action='append', default=[], metavar='GENERIC=V1,V2,...',
+                        help='Sweep a generic over the given values instead of its default values, or fix it to a '
+                             'single value. May be given multiple times.')
+    parser.add_argument('--csv', help='Also write the results to a CSV file.')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count() or 1, help='Number of parallel simulations.')
+    parser.add_argument('--timeout', default='10 ms', help='Simulation timeout of every test case.')
+    parser.add_argument('--keep', help='Generate the test cases in this directory and keep them.')
+    args = parser.parse_args()
+
+    for bench in args.benches:
+        if bench not in BENCHES:
+            parser.error('Unknown component {}.'.format(bench))
+
+    overrides = {}
+    for s in args.set:
+        generic, _, values = s.partition('=')
+        if not values:
+            parser.error('--set expects GENERIC=V1,V2,..., got {}.'.format(s))
+        overrides[generic.upper()] = [parse_value(v) for v in values.split(',')]
+
+    tests = {}
+    for bench in args.benches:
+        for config in configurations(bench, overrides, len(args.benches) == 1):
+            if valid(bench, config):
+                tests['Bench{}{}'.format(bench.capitalize(), len(tests))] = (bench, config)
+
+    if args.keep:
+        os.makedirs(args.keep, exist_ok=True)
+        generate(args.keep, tests, args.timeout)
+        output = simulate(args.keep, args.jobs)
+    else:
+        with tempfile.TemporaryDirectory() as directory:
+            generate(directory, tests, args.timeout)
+            output = simulate(directory, args.jobs)
+
+    rows = results(tests, output)
+    for bench in args.benches:
+        print(table([r for r in rows if r['bench'] == bench]))
+        print()
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=columns_of(rows))
+            writer.writeheader()
+            writer.writerows(rows)
+    return 0 if len(rows) == len(tests) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -101,12 +101,19 @@ proc add_interconnect {{source_dir ""}} {
   echo "- Bus infrastructure."
   set source_dir [source_dir_or_default $source_dir]
   add_source $source_dir/interconnect/Interconnect_pkg.vhd
+  add_source $source_dir/interconnect/BusArbiterWeights.vhd
   add_source $source_dir/interconnect/BusReadArbiter.vhd
   add_source $source_dir/interconnect/BusReadArbiterVec.vhd
   add_source $source_dir/interconnect/BusReadBuffer.vhd
+  add_source $source_dir/interconnect/BusReadLeafBuffer.vhd
+  add_source $source_dir/interconnect/BusReadSlice.vhd
+  add_source $source_dir/interconnect/BusReadCDC.vhd
   add_source $source_dir/interconnect/BusWriteArbiter.vhd
   add_source $source_dir/interconnect/BusWriteArbiterVec.vhd
   add_source $source_dir/interconnect/BusWriteBuffer.vhd
+  add_source $source_dir/interconnect/BusWriteLeafBuffer.vhd
+  add_source $source_dir/interconnect/BusWriteSlice.vhd
+  add_source $source_dir/interconnect/BusWriteCDC.vhd
 }
 
 proc add_interconnect_tb {{source_dir ""}} {
@@ -154,9 +161,17 @@ proc add_arrays {{source_dir ""}} {
   add_source $source_dir/arrays/ArrayReaderStruct.vhd
   add_source $source_dir/arrays/ArrayReaderUnlockCombine.vhd
   add_source $source_dir/arrays/ArrayReader.vhd
+  add_source $source_dir/arrays/DictionaryReader.vhd
+  add_source $source_dir/arrays/Lz4Reader.vhd
+  add_source $source_dir/arrays/ParquetPageReader.vhd
+  add_source $source_dir/arrays/RunEndReader.vhd
+  add_source $source_dir/arrays/ArrayGather.vhd
+  add_source $source_dir/arrays/ArrayCache.vhd
   add_source $source_dir/arrays/ArrayWriterArb.vhd
   add_source $source_dir/arrays/ArrayWriterListSync.vhd
   add_source $source_dir/arrays/ArrayWriterListPrim.vhd
+  add_source $source_dir/arrays/ArrayWriterList.vhd
+  add_source $source_dir/arrays/ArrayWriterStruct.vhd
   add_source $source_dir/arrays/ArrayWriterLevel.vhd
   add_source $source_dir/arrays/ArrayWriter.vhd
 }
@@ -166,6 +181,7 @@ proc add_axi {{source_dir ""}} {
   set source_dir [source_dir_or_default $source_dir]
   add_source $source_dir/axi/Axi_pkg.vhd
   add_source $source_dir/axi/AxiMmio.vhd
+  add_source $source_dir/axi/AxiLiteDemux.vhd
   add_source $source_dir/axi/AxiWriteConverter.vhd
   add_source $source_dir/axi/AxiReadConverter.vhd
 }
@@ -181,6 +197,11 @@ proc add_wrapper {{source_dir ""}} {
   echo "- Wrapper components."
   set source_dir [source_dir_or_default $source_dir]
   add_source $source_dir/wrapper/UserCoreController.vhd
+  add_source $source_dir/wrapper/DescriptorRing.vhd
+  add_source $source_dir/wrapper/ChunkWalker.vhd
+  add_source $source_dir/wrapper/KernelTimer.vhd
+  add_source $source_dir/wrapper/KernelStop.vhd
+  add_source $source_dir/wrapper/CompletionWriter.vhd
   add_source $source_dir/wrapper/Wrapper_pkg.vhd
 }
 
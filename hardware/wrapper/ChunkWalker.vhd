@@ -0,0 +1,336 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Walks the chunks of a chunked RecordBatch for the command stream of one
+-- field, such that the kernel processes all chunks in a single run.
+--
+-- This unit takes the place of the ArrayCmdCtrlMerger of a field. The kernel
+-- issues commands over the rows of all chunks, as if they were a single
+-- RecordBatch. The chunk list in memory holds a descriptor for every chunk,
+-- of DESC_BEATS bus beats each, in the layout of the RecordBatch registers:
+-- the first and last index of the chunk (INDEX_WORDS 32-bit words each),
+-- followed by the 64-bit addresses of all buffers of the RecordBatch. The
+-- addresses of this field start at 32-bit word ADDR_WORD.
+--
+-- Descriptors hold no all valid flags for the validity bitmaps of the field,
+-- which are marked by VALIDITY like for the ArrayCmdCtrlMerger. Instead, the
+-- flag of a validity bitmap is set when its address is zero, as the run-time
+-- leaves the validity bitmaps of chunks without nulls at the null address.
+--
+-- For every kernel command, the descriptors are fetched in order and the
+-- command is split into one command per chunk that it covers, with the buffer
+-- addresses of that chunk. The unlocks of all but the last of these commands
+-- are absorbed, such that the kernel receives one unlock per command. When the
+-- field is disabled, or the list holds no chunks, a single command with an
+-- empty range is issued instead.
+entity ChunkWalker is
+  generic (
+    BUS_ADDR_WIDTH              : natural := 64;
+    BUS_DATA_WIDTH              : natural := 512;
+    BUS_LEN_WIDTH               : natural := 8;
+    INDEX_WIDTH                 : positive := 32;
+    TAG_WIDTH                   : positive := 1;
+    -- Number of buffer addresses of the field.
+    NUM_ADDR                    : positive := 1;
+    -- Number of 32-bit words of the first and last index in a descriptor.
+    INDEX_WORDS                 : positive := 1;
+    -- Index of the 32-bit word of the first buffer address of the field in a descriptor.
+    ADDR_WORD                   : natural := 2;
+    -- Number of bus beats of a descriptor. Must be a power of two.
+    DESC_BEATS                  : positive := 1;
+    -- Number of validity bitmap addresses of the field.
+    NUM_FLAGS                   : natural := 0;
+    -- For every address, '1' if it is the address of a validity bitmap, and
+    -- '0' otherwise.
+    VALIDITY                    : string := ""
+  );
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Kernel side command stream.
+    kernel_cmd_valid            : in  std_logic;
+    kernel_cmd_ready            : out std_logic;
+    kernel_cmd_firstIdx         : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    kernel_cmd_lastIdx          : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+    kernel_cmd_tag              : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Nucleus side command stream, towards the ArrayReader.
+    nucleus_cmd_valid           : out std_logic;
+    nucleus_cmd_ready           : in  std_logic;
+    nucleus_cmd_firstIdx        : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+    nucleus_cmd_lastIdx         : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+    nucleus_cmd_ctrl            : out std_logic_vector(NUM_ADDR*BUS_ADDR_WIDTH+NUM_FLAGS-1 downto 0);
+    nucleus_cmd_tag             : out std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Nucleus side unlock stream, from the ArrayReader.
+    nucleus_unl_valid           : in  std_logic;
+    nucleus_unl_ready           : out std_logic;
+    nucleus_unl_tag             : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Kernel side unlock stream.
+    kernel_unl_valid            : out std_logic;
+    kernel_unl_ready            : in  std_logic;
+    kernel_unl_tag              : out std_logic_vector(TAG_WIDTH-1 downto 0);
+
+    -- Descriptor fetch bus.
+    bus_rreq_valid              : out std_logic;
+    bus_rreq_ready              : in  std_logic;
+    bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_rdat_valid              : in  std_logic;
+    bus_rdat_ready              : out std_logic;
+    bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_rdat_last               : in  std_logic;
+
+    -- Chunk list registers.
+    chunks                      : in  std_logic_vector(63 downto 0);
+    num_chunks                  : in  std_logic_vector(31 downto 0);
+
+    -- Field enable. When low, commands are passed on with an empty range.
+    enable                      : in  std_logic := '1';
+
+    -- High once the kernel was stopped. New commands are then passed on with
+    -- an empty range, like for a disabled field.
+    stopped                     : in  std_logic := '0'
+  );
+end ChunkWalker;
+
+architecture Behavioral of ChunkWalker is
+
+  constant STRIDE : natural := DESC_BEATS * BUS_DATA_WIDTH / 8;
+
+  type state_type is (S_IDLE, S_FETCH, S_CLIP, S_ISSUE, S_NEXT, S_EMPTY, S_UNLOCK);
+
+  type reg_type is record
+    state       : state_type;
+    -- The kernel command being walked.
+    first       : unsigned(INDEX_WIDTH-1 downto 0);
+    last        : unsigned(INDEX_WIDTH-1 downto 0);
+    tag         : std_logic_vector(TAG_WIDTH-1 downto 0);
+    -- The current chunk, and the row of the kernel command at which it starts.
+    chunk       : unsigned(31 downto 0);
+    row         : unsigned(INDEX_WIDTH-1 downto 0);
+    len         : unsigned(INDEX_WIDTH-1 downto 0);
+    -- Descriptor fetch.
+    rreq_valid  : std_logic;
+    rreq_addr   : unsigned(63 downto 0);
+    beat        : natural range 0 to DESC_BEATS-1;
+    desc        : std_logic_vector(DESC_BEATS*BUS_DATA_WIDTH-1 downto 0);
+    -- The command to issue.
+    cmd_first   : unsigned(INDEX_WIDTH-1 downto 0);
+    cmd_last    : unsigned(INDEX_WIDTH-1 downto 0);
+    ctrl        : std_logic_vector(NUM_ADDR*BUS_ADDR_WIDTH+NUM_FLAGS-1 downto 0);
+    -- The number of commands issued and unlocks received for the kernel command.
+    issued      : unsigned(31 downto 0);
+    unlocked    : unsigned(31 downto 0);
+  end record;
+
+  constant reg_init : reg_type := (
+    state       => S_IDLE,
+    first       => (others => '0'),
+    last        => (others => '0'),
+    tag         => (others => '0'),
+    chunk       => (others => '0'),
+    row         => (others => '0'),
+    len         => (others => '0'),
+    rreq_valid  => '0',
+    rreq_addr   => (others => '0'),
+    beat        => 0,
+    desc        => (others => '0'),
+    cmd_first   => (others => '0'),
+    cmd_last    => (others => '0'),
+    ctrl        => (others => '0'),
+    issued      => (others => '0'),
+    unlocked    => (others => '0')
+  );
+
+  signal r : reg_type;
+  signal d : reg_type;
+
+  -- Whether an unlock belongs to a command that is followed by another command of the same kernel command.
+  signal absorb     : std_logic;
+  -- Whether an unlock belongs to the last command of the kernel command.
+  signal final      : std_logic;
+
+begin
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      r <= d;
+      if kcd_reset = '1' then
+        r <= reg_init;
+      end if;
+    end if;
+  end process;
+
+  absorb <= '1' when r.unlocked + 1 < r.issued else '0';
+  final  <= '1' when r.state = S_UNLOCK and r.unlocked + 1 = r.issued else '0';
+
+  comb_proc: process(r, absorb, final, kernel_cmd_valid, kernel_cmd_firstIdx, kernel_cmd_lastIdx, kernel_cmd_tag,
+                     nucleus_cmd_ready, nucleus_unl_valid, kernel_unl_ready, bus_rreq_ready, bus_rdat_valid,
+                     bus_rdat_data, chunks, num_chunks, enable, stopped) is
+    variable v     : reg_type;
+    variable fi    : unsigned(INDEX_WIDTH-1 downto 0);
+    variable li    : unsigned(INDEX_WIDTH-1 downto 0);
+    variable lo    : unsigned(INDEX_WIDTH-1 downto 0);
+    variable hi    : unsigned(INDEX_WIDTH-1 downto 0);
+    variable word  : natural;
+    variable pos   : natural;
+    variable flag  : natural;
+  begin
+    v := r;
+
+    -- Count the unlocks that are absorbed or passed on.
+    if nucleus_unl_valid = '1' and (absorb = '1' or (final = '1' and kernel_unl_ready = '1')) then
+      v.unlocked := r.unlocked + 1;
+    end if;
+
+    case r.state is
+      when S_IDLE =>
+        if kernel_cmd_valid = '1' then
+          v.first    := unsigned(kernel_cmd_firstIdx);
+          v.last     := unsigned(kernel_cmd_lastIdx);
+          v.tag      := kernel_cmd_tag;
+          v.chunk    := (others => '0');
+          v.row      := (others => '0');
+          v.ctrl     := (others => '0');
+          v.issued   := (others => '0');
+          v.unlocked := (others => '0');
+          if enable = '0' or stopped = '1' or unsigned(num_chunks) = 0 then
+            v.state := S_EMPTY;
+          else
+            v.rreq_valid := '1';
+            v.rreq_addr  := unsigned(chunks);
+            v.beat       := 0;
+            v.state      := S_FETCH;
+          end if;
+        end if;
+
+      when S_FETCH =>
+        if bus_rreq_ready = '1' then
+          v.rreq_valid := '0';
+        end if;
+        if bus_rdat_valid = '1' then
+          v.desc(BUS_DATA_WIDTH*(r.beat+1)-1 downto BUS_DATA_WIDTH*r.beat) := bus_rdat_data;
+          if r.beat = DESC_BEATS-1 then
+            v.state := S_CLIP;
+          else
+            v.beat := r.beat + 1;
+          end if;
+        end if;
+
+      when S_CLIP =>
+        -- Clip the range of the kernel command to the rows of this chunk.
+        fi := unsigned(r.desc(INDEX_WIDTH-1 downto 0));
+        li := unsigned(r.desc(32*INDEX_WORDS+INDEX_WIDTH-1 downto 32*INDEX_WORDS));
+        v.len := li - fi;
+        if r.first > r.row then
+          lo := r.first;
+        else
+          lo := r.row;
+        end if;
+        if r.last < r.row + v.len then
+          hi := r.last;
+        else
+          hi := r.row + v.len;
+        end if;
+        pos  := 0;
+        flag := 0;
+        for a in 0 to NUM_ADDR-1 loop
+          word := ADDR_WORD + 2 * a;
+          v.ctrl(pos+BUS_ADDR_WIDTH-1 downto pos) := r.desc(32*word+BUS_ADDR_WIDTH-1 downto 32*word);
+          pos := pos + BUS_ADDR_WIDTH;
+          if a < VALIDITY'length and flag < NUM_FLAGS then
+            if VALIDITY(VALIDITY'low + a) = '1' then
+              if unsigned(r.desc(32*word+BUS_ADDR_WIDTH-1 downto 32*word)) = 0 then
+                v.ctrl(pos) := '1';
+              else
+                v.ctrl(pos) := '0';
+              end if;
+              pos  := pos + 1;
+              flag := flag + 1;
+            end if;
+          end if;
+        end loop;
+        if lo < hi then
+          v.cmd_first := fi + (lo - r.row);
+          v.cmd_last  := fi + (hi - r.row);
+          v.state     := S_ISSUE;
+        else
+          v.state     := S_NEXT;
+        end if;
+
+      when S_ISSUE =>
+        if nucleus_cmd_ready = '1' then
+          v.issued := r.issued + 1;
+          v.state  := S_NEXT;
+        end if;
+
+      when S_NEXT =>
+        v.row   := r.row + r.len;
+        v.chunk := r.chunk + 1;
+        if v.chunk = unsigned(num_chunks) or v.row >= r.last then
+          if r.issued = 0 then
+            v.state := S_EMPTY;
+          else
+            v.state := S_UNLOCK;
+          end if;
+        else
+          v.rreq_valid := '1';
+          v.rreq_addr  := r.rreq_addr + STRIDE;
+          v.beat       := 0;
+          v.state      := S_FETCH;
+        end if;
+
+      when S_EMPTY =>
+        v.cmd_first := (others => '0');
+        v.cmd_last  := (others => '0');
+        if nucleus_cmd_ready = '1' then
+          v.issued := r.issued + 1;
+          v.state  := S_UNLOCK;
+        end if;
+
+      when S_UNLOCK =>
+        if final = '1' and nucleus_unl_valid = '1' and kernel_unl_ready = '1' then
+          v.state := S_IDLE;
+        end if;
+    end case;
+
+    d <= v;
+  end process;
+
+  kernel_cmd_ready      <= '1' when r.state = S_IDLE else '0';
+
+  nucleus_cmd_valid     <= '1' when r.state = S_ISSUE or r.state = S_EMPTY else '0';
+  nucleus_cmd_firstIdx  <= std_logic_vector(r.cmd_first);
+  nucleus_cmd_lastIdx   <= std_logic_vector(r.cmd_last);
+  nucleus_cmd_ctrl      <= r.ctrl;
+  nucleus_cmd_tag       <= r.tag;
+
+  nucleus_unl_ready     <= '1' when absorb = '1' else kernel_unl_ready when final = '1' else '0';
+  kernel_unl_valid      <= nucleus_unl_valid when final = '1' else '0';
+  kernel_unl_tag        <= nucleus_unl_tag;
+
+  bus_rreq_valid        <= r.rreq_valid;
+  bus_rreq_addr         <= std_logic_vector(resize(r.rreq_addr, BUS_ADDR_WIDTH));
+  bus_rreq_len          <= std_logic_vector(to_unsigned(DESC_BEATS, BUS_LEN_WIDTH));
+  bus_rdat_ready        <= '1' when r.state = S_FETCH else '0';
+
+end Behavioral;
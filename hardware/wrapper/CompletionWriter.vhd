@@ -0,0 +1,212 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Writes a completion record to host memory when the kernel is done, such
+-- that the host can wait for the kernel without polling the status register.
+--
+-- On the rising edge of the done status of the kernel, and if the address is
+-- not zero, a 32-byte record is written to the address in a single burst:
+--
+--   bytes  0..7  : result register.
+--   bytes  8..15 : cycles register of the KernelTimer.
+--   bytes 16..19 : status register, i.e. the idle, busy and done bits.
+--   bytes 24..27 : sequence number.
+--
+-- The sequence number is incremented for every record and skips zero, such
+-- that a record initialized to zero by the host always changes. It is the last
+-- word of the record, such that the other fields are in place when it changes
+-- on buses that write the beats of a burst in order. The address must be
+-- aligned to 32 bytes.
+entity CompletionWriter is
+  generic (
+    BUS_ADDR_WIDTH              : natural := 64;
+    BUS_DATA_WIDTH              : natural := 512;
+    BUS_LEN_WIDTH               : natural := 8
+  );
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Default registers of the kernel.
+    idle                        : in  std_logic;
+    busy                        : in  std_logic;
+    done                        : in  std_logic;
+    result                      : in  std_logic_vector(63 downto 0);
+    cycles                      : in  std_logic_vector(63 downto 0);
+
+    -- Host address of the completion record. Zero disables the write-back.
+    address                     : in  std_logic_vector(63 downto 0);
+
+    -- Completion record write bus.
+    bus_wreq_valid              : out std_logic;
+    bus_wreq_ready              : in  std_logic;
+    bus_wreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_wreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_wreq_last               : out std_logic;
+    bus_wdat_valid              : out std_logic;
+    bus_wdat_ready              : in  std_logic;
+    bus_wdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_wdat_strobe             : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    bus_wdat_last               : out std_logic;
+    bus_wrep_valid              : in  std_logic;
+    bus_wrep_ready              : out std_logic;
+    bus_wrep_ok                 : in  std_logic
+  );
+end CompletionWriter;
+
+architecture Behavioral of CompletionWriter is
+
+  constant REC_WIDTH      : positive := 256;
+
+  -- Number of bus beats of a record.
+  function rec_beats return positive is
+  begin
+    if BUS_DATA_WIDTH >= REC_WIDTH then
+      return 1;
+    end if;
+    return REC_WIDTH / BUS_DATA_WIDTH;
+  end function;
+
+  constant REC_BEATS      : positive := rec_beats;
+
+  type state_type is (S_IDLE, S_CAPTURE, S_WRITE, S_REPLY);
+
+  type reg_type is record
+    state         : state_type;
+    done_prev     : std_logic;
+    pending       : std_logic;
+    seq           : unsigned(31 downto 0);
+    wreq_valid    : std_logic;
+    wdat_valid    : std_logic;
+    addr          : std_logic_vector(63 downto 0);
+    rec           : std_logic_vector(REC_BEATS*BUS_DATA_WIDTH-1 downto 0);
+    beat          : natural range 0 to REC_BEATS-1;
+  end record;
+
+  constant reg_init : reg_type := (
+    state       => S_IDLE,
+    done_prev   => '0',
+    pending     => '0',
+    seq         => (others => '0'),
+    wreq_valid  => '0',
+    wdat_valid  => '0',
+    addr        => (others => '0'),
+    rec         => (others => '0'),
+    beat        => 0
+  );
+
+  signal r : reg_type;
+  signal d : reg_type;
+
+begin
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      r <= d;
+      if kcd_reset = '1' then
+        r <= reg_init;
+      end if;
+    end if;
+  end process;
+
+  comb_proc: process(r, idle, busy, done, result, cycles, address,
+                     bus_wreq_ready, bus_wdat_ready, bus_wrep_valid) is
+    variable v : reg_type;
+  begin
+    v := r;
+    v.done_prev := done;
+
+    -- Remember completions while a record is being written.
+    if done = '1' and r.done_prev = '0' and unsigned(address) /= 0 then
+      v.pending := '1';
+    end if;
+
+    case r.state is
+      when S_IDLE =>
+        if r.pending = '1' then
+          v.pending := '0';
+          v.state   := S_CAPTURE;
+        end if;
+
+      when S_CAPTURE =>
+        -- The KernelTimer stops counting in the cycle of the done edge, so its count is stable from here on.
+        if r.seq = X"FFFFFFFF" then
+          v.seq := to_unsigned(1, 32);
+        else
+          v.seq := r.seq + 1;
+        end if;
+        v.rec                       := (others => '0');
+        v.rec(63 downto 0)          := result;
+        v.rec(127 downto 64)        := cycles;
+        v.rec(128)                  := idle;
+        v.rec(129)                  := busy;
+        v.rec(130)                  := done;
+        v.rec(223 downto 192)       := std_logic_vector(v.seq);
+        v.addr                      := address;
+        v.beat                      := 0;
+        v.wreq_valid                := '1';
+        v.wdat_valid                := '1';
+        v.state                     := S_WRITE;
+
+      when S_WRITE =>
+        if bus_wreq_ready = '1' then
+          v.wreq_valid := '0';
+        end if;
+        if r.wdat_valid = '1' and bus_wdat_ready = '1' then
+          if r.beat = REC_BEATS-1 then
+            v.wdat_valid := '0';
+          else
+            v.beat := r.beat + 1;
+          end if;
+        end if;
+        if v.wreq_valid = '0' and v.wdat_valid = '0' then
+          v.state := S_REPLY;
+        end if;
+
+      when S_REPLY =>
+        if bus_wrep_valid = '1' then
+          v.state := S_IDLE;
+        end if;
+    end case;
+
+    d <= v;
+  end process;
+
+  bus_wreq_valid  <= r.wreq_valid;
+  bus_wreq_addr   <= r.addr(BUS_ADDR_WIDTH-1 downto 0);
+  bus_wreq_len    <= std_logic_vector(to_unsigned(REC_BEATS, BUS_LEN_WIDTH));
+  bus_wreq_last   <= '1';
+
+  bus_wdat_valid  <= r.wdat_valid;
+  bus_wdat_data   <= r.rec(BUS_DATA_WIDTH*(r.beat+1)-1 downto BUS_DATA_WIDTH*r.beat);
+  bus_wdat_last   <= '1' when r.beat = REC_BEATS-1 else '0';
+
+  -- Only the bytes of the record are written on buses wider than the record.
+  full_strobe_gen: if BUS_DATA_WIDTH <= REC_WIDTH generate
+    bus_wdat_strobe <= (others => '1');
+  end generate;
+
+  partial_strobe_gen: if BUS_DATA_WIDTH > REC_WIDTH generate
+    bus_wdat_strobe(REC_WIDTH/8-1 downto 0) <= (others => '1');
+    bus_wdat_strobe(BUS_DATA_WIDTH/8-1 downto REC_WIDTH/8) <= (others => '0');
+  end generate;
+
+  bus_wrep_ready  <= '1' when r.state = S_REPLY else '0';
+
+end Behavioral;
@@ -0,0 +1,431 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Processes batch descriptors from a ring in memory back-to-back, without a
+-- start/done handshake with the host for every batch.
+--
+-- This unit sits between the host AXI4-lite port and the register file of a
+-- Nucleus. Host transactions pass through unmodified. When the ring is enabled
+-- and its head differs from its tail, it fetches the descriptor at
+-- base + head * DESC_BEATS * BUS_DATA_WIDTH / 8 from memory, and replays the
+-- register writes the host would otherwise perform: it resets the kernel,
+-- writes the DESC_REGS 32-bit words of the descriptor to the registers
+-- following the schema hash register (the first and last indices and buffer
+-- addresses of the RecordBatches), starts the kernel and polls its done status.
+-- Then the head is incremented, modulo the ring size.
+--
+-- The kernel is therefore unaware of the ring. The host and this unit share
+-- the register file one transaction at a time, in round-robin order.
+entity DescriptorRing is
+  generic (
+    BUS_ADDR_WIDTH              : natural := 64;
+    BUS_DATA_WIDTH              : natural := 512;
+    BUS_LEN_WIDTH               : natural := 8;
+    MMIO_ADDR_WIDTH             : natural := 32;
+    MMIO_DATA_WIDTH             : natural := 32;
+    -- Byte address offset of the register file.
+    MMIO_OFFSET                 : natural := 0;
+    -- Number of 32-bit words of a descriptor.
+    DESC_REGS                   : positive := 1;
+    -- Number of bus beats of a descriptor. Must be a power of two.
+    DESC_BEATS                  : positive := 1
+  );
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Host side.
+    mmio_awvalid                : in  std_logic;
+    mmio_awready                : out std_logic;
+    mmio_awaddr                 : in  std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+    mmio_wvalid                 : in  std_logic;
+    mmio_wready                 : out std_logic;
+    mmio_wdata                  : in  std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+    mmio_wstrb                  : in  std_logic_vector(MMIO_DATA_WIDTH/8-1 downto 0);
+    mmio_bvalid                 : out std_logic;
+    mmio_bready                 : in  std_logic;
+    mmio_bresp                  : out std_logic_vector(1 downto 0);
+    mmio_arvalid                : in  std_logic;
+    mmio_arready                : out std_logic;
+    mmio_araddr                 : in  std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+    mmio_rvalid                 : out std_logic;
+    mmio_rready                 : in  std_logic;
+    mmio_rdata                  : out std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+    mmio_rresp                  : out std_logic_vector(1 downto 0);
+
+    -- Register file side.
+    regs_awvalid                : out std_logic;
+    regs_awready                : in  std_logic;
+    regs_awaddr                 : out std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+    regs_wvalid                 : out std_logic;
+    regs_wready                 : in  std_logic;
+    regs_wdata                  : out std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+    regs_wstrb                  : out std_logic_vector(MMIO_DATA_WIDTH/8-1 downto 0);
+    regs_bvalid                 : in  std_logic;
+    regs_bready                 : out std_logic;
+    regs_bresp                  : in  std_logic_vector(1 downto 0);
+    regs_arvalid                : out std_logic;
+    regs_arready                : in  std_logic;
+    regs_araddr                 : out std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+    regs_rvalid                 : in  std_logic;
+    regs_rready                 : out std_logic;
+    regs_rdata                  : in  std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+    regs_rresp                  : in  std_logic_vector(1 downto 0);
+
+    -- Descriptor fetch bus.
+    bus_rreq_valid              : out std_logic;
+    bus_rreq_ready              : in  std_logic;
+    bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    bus_rdat_valid              : in  std_logic;
+    bus_rdat_ready              : out std_logic;
+    bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    bus_rdat_last               : in  std_logic;
+
+    -- Ring registers.
+    enable                      : in  std_logic;
+    base                        : in  std_logic_vector(63 downto 0);
+    size                        : in  std_logic_vector(31 downto 0);
+    tail                        : in  std_logic_vector(31 downto 0);
+    head                        : out std_logic_vector(31 downto 0)
+  );
+end DescriptorRing;
+
+architecture Behavioral of DescriptorRing is
+
+  -- Register indices, see runtime/cpp/include/fletcher/fletcher.h.
+  constant REG_CONTROL    : natural := 0;
+  constant REG_STATUS     : natural := 1;
+  constant REG_SCHEMA     : natural := 8;
+
+  constant CONTROL_START  : std_logic_vector(31 downto 0) := X"00000001";
+  constant CONTROL_RESET  : std_logic_vector(31 downto 0) := X"00000004";
+  constant STATUS_DONE    : natural := 2;
+
+  constant LANES          : positive := MMIO_DATA_WIDTH / 32;
+  constant STRIDE         : natural := DESC_BEATS * BUS_DATA_WIDTH / 8;
+
+  type port_state_type is (P_IDLE, P_WRITE, P_BRESP, P_READ, P_RRESP, P_HOST_B, P_HOST_R);
+
+  type ring_state_type is (R_IDLE, R_FETCH, R_RESET, R_RESET_CLR, R_REGS, R_START, R_START_CLR, R_POLL);
+
+  type state_type is record
+    -- Register file port.
+    port_state    : port_state_type;
+    host          : std_logic;
+    last_host     : std_logic;
+    awvalid       : std_logic;
+    wvalid        : std_logic;
+    arvalid       : std_logic;
+    addr          : std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+    data          : std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+    strb          : std_logic_vector(MMIO_DATA_WIDTH/8-1 downto 0);
+    resp          : std_logic_vector(1 downto 0);
+    -- Ring.
+    ring_state    : ring_state_type;
+    head          : unsigned(31 downto 0);
+    rreq_valid    : std_logic;
+    rreq_addr     : unsigned(63 downto 0);
+    beat          : natural range 0 to DESC_BEATS-1;
+    desc          : std_logic_vector(DESC_BEATS*BUS_DATA_WIDTH-1 downto 0);
+    word          : natural range 0 to DESC_REGS-1;
+    -- Register accesses of the ring.
+    req           : std_logic;
+    req_write     : std_logic;
+    req_reg       : natural;
+    req_data      : std_logic_vector(31 downto 0);
+    busy          : std_logic;
+    done          : std_logic;
+    rdata         : std_logic_vector(31 downto 0);
+  end record;
+
+  constant state_init : state_type := (
+    port_state  => P_IDLE,
+    host        => '0',
+    last_host   => '0',
+    awvalid     => '0',
+    wvalid      => '0',
+    arvalid     => '0',
+    addr        => (others => '0'),
+    data        => (others => '0'),
+    strb        => (others => '0'),
+    resp        => (others => '0'),
+    ring_state  => R_IDLE,
+    head        => (others => '0'),
+    rreq_valid  => '0',
+    rreq_addr   => (others => '0'),
+    beat        => 0,
+    desc        => (others => '0'),
+    word        => 0,
+    req         => '0',
+    req_write   => '0',
+    req_reg     => 0,
+    req_data    => (others => '0'),
+    busy        => '0',
+    done        => '0',
+    rdata       => (others => '0')
+  );
+
+  signal r : state_type;
+  signal d : state_type;
+
+  signal host_write : std_logic;
+  signal host_read  : std_logic;
+
+begin
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      r <= d;
+      if kcd_reset = '1' then
+        r <= state_init;
+      end if;
+    end if;
+  end process;
+
+  -- The host gets the register file when it is free, unless the ring waits and the host had it last.
+  host_write <= '1' when r.port_state = P_IDLE and mmio_awvalid = '1' and mmio_wvalid = '1'
+                         and (r.req = '0' or r.last_host = '0') else '0';
+  host_read  <= '1' when r.port_state = P_IDLE and host_write = '0' and mmio_arvalid = '1'
+                         and (r.req = '0' or r.last_host = '0') else '0';
+
+  comb_proc: process(r, host_write, host_read,
+                     mmio_awaddr, mmio_wdata, mmio_wstrb, mmio_bready, mmio_araddr, mmio_rready,
+                     regs_awready, regs_wready, regs_bvalid, regs_bresp, regs_arready, regs_rvalid, regs_rdata,
+                     regs_rresp, bus_rreq_ready, bus_rdat_valid, bus_rdat_data, enable, base, size, tail) is
+    variable v    : state_type;
+    variable lane : natural;
+
+    -- Issue a register access of the ring, if the previous one is complete.
+    procedure access_reg(write : std_logic; reg : natural; data : std_logic_vector(31 downto 0)) is
+    begin
+      if r.req = '0' and r.busy = '0' and r.done = '0' then
+        v.req       := '1';
+        v.busy      := '1';
+        v.req_write := write;
+        v.req_reg   := reg;
+        v.req_data  := data;
+      end if;
+    end procedure;
+
+  begin
+    v := r;
+    v.done := '0';
+
+    ----------------------------------------------------------
+    -- Register file port:
+    ----------------------------------------------------------
+    case r.port_state is
+      when P_IDLE =>
+        if host_write = '1' then
+          v.host       := '1';
+          v.last_host  := '1';
+          v.addr       := mmio_awaddr;
+          v.data       := mmio_wdata;
+          v.strb       := mmio_wstrb;
+          v.awvalid    := '1';
+          v.wvalid     := '1';
+          v.port_state := P_WRITE;
+        elsif host_read = '1' then
+          v.host       := '1';
+          v.last_host  := '1';
+          v.addr       := mmio_araddr;
+          v.arvalid    := '1';
+          v.port_state := P_READ;
+        elsif r.req = '1' then
+          -- Place the 32-bit word in the lane of its register.
+          lane := r.req_reg mod LANES;
+          v.host      := '0';
+          v.last_host := '0';
+          v.req       := '0';
+          v.addr      := std_logic_vector(to_unsigned(MMIO_OFFSET + 4 * r.req_reg, MMIO_ADDR_WIDTH));
+          v.strb      := (others => '0');
+          v.strb(4*lane+3 downto 4*lane) := "1111";
+          for i in 0 to LANES-1 loop
+            v.data(32*i+31 downto 32*i) := r.req_data;
+          end loop;
+          if r.req_write = '1' then
+            v.awvalid    := '1';
+            v.wvalid     := '1';
+            v.port_state := P_WRITE;
+          else
+            v.arvalid    := '1';
+            v.port_state := P_READ;
+          end if;
+        end if;
+
+      when P_WRITE =>
+        if regs_awready = '1' then
+          v.awvalid := '0';
+        end if;
+        if regs_wready = '1' then
+          v.wvalid := '0';
+        end if;
+        if v.awvalid = '0' and v.wvalid = '0' then
+          v.port_state := P_BRESP;
+        end if;
+
+      when P_BRESP =>
+        if regs_bvalid = '1' then
+          v.resp := regs_bresp;
+          if r.host = '1' then
+            v.port_state := P_HOST_B;
+          else
+            v.busy       := '0';
+            v.done       := '1';
+            v.port_state := P_IDLE;
+          end if;
+        end if;
+
+      when P_READ =>
+        if regs_arready = '1' then
+          v.arvalid    := '0';
+          v.port_state := P_RRESP;
+        end if;
+
+      when P_RRESP =>
+        if regs_rvalid = '1' then
+          v.resp := regs_rresp;
+          v.data := regs_rdata;
+          if r.host = '1' then
+            v.port_state := P_HOST_R;
+          else
+            lane := r.req_reg mod LANES;
+            v.rdata      := regs_rdata(32*lane+31 downto 32*lane);
+            v.busy       := '0';
+            v.done       := '1';
+            v.port_state := P_IDLE;
+          end if;
+        end if;
+
+      when P_HOST_B =>
+        if mmio_bready = '1' then
+          v.port_state := P_IDLE;
+        end if;
+
+      when P_HOST_R =>
+        if mmio_rready = '1' then
+          v.port_state := P_IDLE;
+        end if;
+    end case;
+
+    ----------------------------------------------------------
+    -- Ring:
+    ----------------------------------------------------------
+    case r.ring_state is
+      when R_IDLE =>
+        if enable = '0' then
+          v.head := (others => '0');
+        elsif r.head /= unsigned(tail) then
+          v.rreq_valid := '1';
+          v.rreq_addr  := unsigned(base) + r.head * to_unsigned(STRIDE, 32);
+          v.beat       := 0;
+          v.ring_state := R_FETCH;
+        end if;
+
+      when R_FETCH =>
+        if bus_rreq_ready = '1' then
+          v.rreq_valid := '0';
+        end if;
+        if bus_rdat_valid = '1' then
+          v.desc(BUS_DATA_WIDTH*(r.beat+1)-1 downto BUS_DATA_WIDTH*r.beat) := bus_rdat_data;
+          if r.beat = DESC_BEATS-1 then
+            v.ring_state := R_RESET;
+          else
+            v.beat := r.beat + 1;
+          end if;
+        end if;
+
+      when R_RESET =>
+        access_reg('1', REG_CONTROL, CONTROL_RESET);
+        if r.done = '1' then
+          v.ring_state := R_RESET_CLR;
+        end if;
+
+      when R_RESET_CLR =>
+        access_reg('1', REG_CONTROL, (others => '0'));
+        if r.done = '1' then
+          v.word       := 0;
+          v.ring_state := R_REGS;
+        end if;
+
+      when R_REGS =>
+        access_reg('1', REG_SCHEMA + r.word, r.desc(32*r.word+31 downto 32*r.word));
+        if r.done = '1' then
+          if r.word = DESC_REGS-1 then
+            v.ring_state := R_START;
+          else
+            v.word := r.word + 1;
+          end if;
+        end if;
+
+      when R_START =>
+        access_reg('1', REG_CONTROL, CONTROL_START);
+        if r.done = '1' then
+          v.ring_state := R_START_CLR;
+        end if;
+
+      when R_START_CLR =>
+        access_reg('1', REG_CONTROL, (others => '0'));
+        if r.done = '1' then
+          v.ring_state := R_POLL;
+        end if;
+
+      when R_POLL =>
+        access_reg('0', REG_STATUS, (others => '0'));
+        if r.done = '1' and r.rdata(STATUS_DONE) = '1' then
+          if r.head + 1 = unsigned(size) then
+            v.head := (others => '0');
+          else
+            v.head := r.head + 1;
+          end if;
+          v.ring_state := R_IDLE;
+        end if;
+    end case;
+
+    d <= v;
+  end process;
+
+  mmio_awready    <= host_write;
+  mmio_wready     <= host_write;
+  mmio_bvalid     <= '1' when r.port_state = P_HOST_B else '0';
+  mmio_bresp      <= r.resp;
+  mmio_arready    <= host_read;
+  mmio_rvalid     <= '1' when r.port_state = P_HOST_R else '0';
+  mmio_rdata      <= r.data;
+  mmio_rresp      <= r.resp;
+
+  regs_awvalid    <= r.awvalid;
+  regs_awaddr     <= r.addr;
+  regs_wvalid     <= r.wvalid;
+  regs_wdata      <= r.data;
+  regs_wstrb      <= r.strb;
+  regs_bready     <= '1' when r.port_state = P_BRESP else '0';
+  regs_arvalid    <= r.arvalid;
+  regs_araddr     <= r.addr;
+  regs_rready     <= '1' when r.port_state = P_RRESP else '0';
+
+  bus_rreq_valid  <= r.rreq_valid;
+  bus_rreq_addr   <= std_logic_vector(resize(r.rreq_addr, BUS_ADDR_WIDTH));
+  bus_rreq_len    <= std_logic_vector(to_unsigned(DESC_BEATS, BUS_LEN_WIDTH));
+  bus_rdat_ready  <= '1' when r.ring_state = R_FETCH else '0';
+
+  head            <= std_logic_vector(r.head);
+
+end Behavioral;
@@ -0,0 +1,65 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Remembers that the kernel was stopped through the stop strobe of the default
+-- registers, until it is started or reset again.
+--
+-- While stopped is high, the ArrayCmdCtrlMergers and ChunkWalkers pass on the
+-- commands of the kernel with an empty range. The bus requests of commands
+-- that were already issued drain, and no new bus requests are issued, such
+-- that the kernel can unwind and signal done without waiting for the rest of
+-- its data.
+entity KernelStop is
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Default registers of the kernel.
+    start                       : in  std_logic;
+    stop                        : in  std_logic;
+    reset                       : in  std_logic;
+
+    -- Whether the kernel was stopped since it was last started.
+    stopped                     : out std_logic
+  );
+end KernelStop;
+
+architecture Behavioral of KernelStop is
+  signal r : std_logic;
+begin
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      if stop = '1' then
+        r <= '1';
+      end if;
+
+      if start = '1' or reset = '1' then
+        r <= '0';
+      end if;
+
+      if kcd_reset = '1' then
+        r <= '0';
+      end if;
+    end if;
+  end process;
+
+  stopped <= r;
+
+end Behavioral;
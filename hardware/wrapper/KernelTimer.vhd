@@ -0,0 +1,81 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Counts the kernel clock cycles of the execution of a kernel, for the cycles
+-- register of the default registers.
+--
+-- The counter is cleared and starts counting on the start strobe of the
+-- kernel, and stops on the rising edge of the done status of the kernel, such
+-- that a done status left high by a previous run does not stop the counter.
+-- A reset strobe stops the counter. The count holds the number of cycles
+-- counted so far while the kernel runs, and the number of cycles of the last
+-- run afterwards.
+entity KernelTimer is
+  port (
+    kcd_clk                     : in  std_logic;
+    kcd_reset                   : in  std_logic;
+
+    -- Default registers of the kernel.
+    start                       : in  std_logic;
+    reset                       : in  std_logic;
+    done                        : in  std_logic;
+
+    -- Number of cycles of the current or last run.
+    cycles                      : out std_logic_vector(63 downto 0)
+  );
+end KernelTimer;
+
+architecture Behavioral of KernelTimer is
+  signal count      : unsigned(63 downto 0);
+  signal running    : std_logic;
+  signal done_prev  : std_logic;
+begin
+
+  seq_proc: process(kcd_clk) is
+  begin
+    if rising_edge(kcd_clk) then
+      done_prev <= done;
+
+      if running = '1' then
+        count <= count + 1;
+      end if;
+
+      if done = '1' and done_prev = '0' then
+        running <= '0';
+      end if;
+
+      if reset = '1' then
+        running <= '0';
+      end if;
+
+      if start = '1' then
+        count   <= (others => '0');
+        running <= '1';
+      end if;
+
+      if kcd_reset = '1' then
+        count     <= (others => '0');
+        running   <= '0';
+        done_prev <= '0';
+      end if;
+    end if;
+  end process;
+
+  cycles <= std_logic_vector(count);
+
+end Behavioral;
@@ -40,6 +40,196 @@ package Wrapper_pkg is
     );
   end component;
 
+  component DescriptorRing is
+    generic (
+      BUS_ADDR_WIDTH              : natural := 64;
+      BUS_DATA_WIDTH              : natural := 512;
+      BUS_LEN_WIDTH               : natural := 8;
+      MMIO_ADDR_WIDTH             : natural := 32;
+      MMIO_DATA_WIDTH             : natural := 32;
+      MMIO_OFFSET                 : natural := 0;
+      DESC_REGS                   : positive := 1;
+      DESC_BEATS                  : positive := 1
+    );
+    port (
+      kcd_clk                     : in  std_logic;
+      kcd_reset                   : in  std_logic;
+
+      -- Host side.
+      mmio_awvalid                : in  std_logic;
+      mmio_awready                : out std_logic;
+      mmio_awaddr                 : in  std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+      mmio_wvalid                 : in  std_logic;
+      mmio_wready                 : out std_logic;
+      mmio_wdata                  : in  std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+      mmio_wstrb                  : in  std_logic_vector(MMIO_DATA_WIDTH/8-1 downto 0);
+      mmio_bvalid                 : out std_logic;
+      mmio_bready                 : in  std_logic;
+      mmio_bresp                  : out std_logic_vector(1 downto 0);
+      mmio_arvalid                : in  std_logic;
+      mmio_arready                : out std_logic;
+      mmio_araddr                 : in  std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+      mmio_rvalid                 : out std_logic;
+      mmio_rready                 : in  std_logic;
+      mmio_rdata                  : out std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+      mmio_rresp                  : out std_logic_vector(1 downto 0);
+
+      -- Register file side.
+      regs_awvalid                : out std_logic;
+      regs_awready                : in  std_logic;
+      regs_awaddr                 : out std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+      regs_wvalid                 : out std_logic;
+      regs_wready                 : in  std_logic;
+      regs_wdata                  : out std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+      regs_wstrb                  : out std_logic_vector(MMIO_DATA_WIDTH/8-1 downto 0);
+      regs_bvalid                 : in  std_logic;
+      regs_bready                 : out std_logic;
+      regs_bresp                  : in  std_logic_vector(1 downto 0);
+      regs_arvalid                : out std_logic;
+      regs_arready                : in  std_logic;
+      regs_araddr                 : out std_logic_vector(MMIO_ADDR_WIDTH-1 downto 0);
+      regs_rvalid                 : in  std_logic;
+      regs_rready                 : out std_logic;
+      regs_rdata                  : in  std_logic_vector(MMIO_DATA_WIDTH-1 downto 0);
+      regs_rresp                  : in  std_logic_vector(1 downto 0);
+
+      -- Descriptor fetch bus.
+      bus_rreq_valid              : out std_logic;
+      bus_rreq_ready              : in  std_logic;
+      bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_rdat_valid              : in  std_logic;
+      bus_rdat_ready              : out std_logic;
+      bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_rdat_last               : in  std_logic;
+
+      -- Ring registers.
+      enable                      : in  std_logic;
+      base                        : in  std_logic_vector(63 downto 0);
+      size                        : in  std_logic_vector(31 downto 0);
+      tail                        : in  std_logic_vector(31 downto 0);
+      head                        : out std_logic_vector(31 downto 0)
+    );
+  end component;
+
+  component ChunkWalker is
+    generic (
+      BUS_ADDR_WIDTH              : natural := 64;
+      BUS_DATA_WIDTH              : natural := 512;
+      BUS_LEN_WIDTH               : natural := 8;
+      INDEX_WIDTH                 : positive := 32;
+      TAG_WIDTH                   : positive := 1;
+      NUM_ADDR                    : positive := 1;
+      INDEX_WORDS                 : positive := 1;
+      ADDR_WORD                   : natural := 2;
+      DESC_BEATS                  : positive := 1;
+      NUM_FLAGS                   : natural := 0;
+      VALIDITY                    : string := ""
+    );
+    port (
+      kcd_clk                     : in  std_logic;
+      kcd_reset                   : in  std_logic;
+
+      -- Kernel side command stream.
+      kernel_cmd_valid            : in  std_logic;
+      kernel_cmd_ready            : out std_logic;
+      kernel_cmd_firstIdx         : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      kernel_cmd_lastIdx          : in  std_logic_vector(INDEX_WIDTH-1 downto 0);
+      kernel_cmd_tag              : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+      -- Nucleus side command stream, towards the ArrayReader.
+      nucleus_cmd_valid           : out std_logic;
+      nucleus_cmd_ready           : in  std_logic;
+      nucleus_cmd_firstIdx        : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+      nucleus_cmd_lastIdx         : out std_logic_vector(INDEX_WIDTH-1 downto 0);
+      nucleus_cmd_ctrl            : out std_logic_vector(NUM_ADDR*BUS_ADDR_WIDTH+NUM_FLAGS-1 downto 0);
+      nucleus_cmd_tag             : out std_logic_vector(TAG_WIDTH-1 downto 0);
+
+      -- Nucleus side unlock stream, from the ArrayReader.
+      nucleus_unl_valid           : in  std_logic;
+      nucleus_unl_ready           : out std_logic;
+      nucleus_unl_tag             : in  std_logic_vector(TAG_WIDTH-1 downto 0);
+
+      -- Kernel side unlock stream.
+      kernel_unl_valid            : out std_logic;
+      kernel_unl_ready            : in  std_logic;
+      kernel_unl_tag              : out std_logic_vector(TAG_WIDTH-1 downto 0);
+
+      -- Descriptor fetch bus.
+      bus_rreq_valid              : out std_logic;
+      bus_rreq_ready              : in  std_logic;
+      bus_rreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_rreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_rdat_valid              : in  std_logic;
+      bus_rdat_ready              : out std_logic;
+      bus_rdat_data               : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_rdat_last               : in  std_logic;
+
+      -- Chunk list registers.
+      chunks                      : in  std_logic_vector(63 downto 0);
+      num_chunks                  : in  std_logic_vector(31 downto 0);
+
+      -- Field enable.
+      enable                      : in  std_logic := '1';
+
+      -- Kernel stopped.
+      stopped                     : in  std_logic := '0'
+    );
+  end component;
+
+  component KernelTimer is
+    port (
+      kcd_clk                     : in  std_logic;
+      kcd_reset                   : in  std_logic;
+      start                       : in  std_logic;
+      reset                       : in  std_logic;
+      done                        : in  std_logic;
+      cycles                      : out std_logic_vector(63 downto 0)
+    );
+  end component;
+
+  component KernelStop is
+    port (
+      kcd_clk                     : in  std_logic;
+      kcd_reset                   : in  std_logic;
+      start                       : in  std_logic;
+      stop                        : in  std_logic;
+      reset                       : in  std_logic;
+      stopped                     : out std_logic
+    );
+  end component;
+
+  component CompletionWriter is
+    generic (
+      BUS_ADDR_WIDTH              : natural := 64;
+      BUS_DATA_WIDTH              : natural := 512;
+      BUS_LEN_WIDTH               : natural := 8
+    );
+    port (
+      kcd_clk                     : in  std_logic;
+      kcd_reset                   : in  std_logic;
+      idle                        : in  std_logic;
+      busy                        : in  std_logic;
+      done                        : in  std_logic;
+      result                      : in  std_logic_vector(63 downto 0);
+      cycles                      : in  std_logic_vector(63 downto 0);
+      address                     : in  std_logic_vector(63 downto 0);
+      bus_wreq_valid              : out std_logic;
+      bus_wreq_ready              : in  std_logic;
+      bus_wreq_addr               : out std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      bus_wreq_len                : out std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      bus_wreq_last               : out std_logic;
+      bus_wdat_valid              : out std_logic;
+      bus_wdat_ready              : in  std_logic;
+      bus_wdat_data               : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      bus_wdat_strobe             : out std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      bus_wdat_last               : out std_logic;
+      bus_wrep_valid              : in  std_logic;
+      bus_wrep_ready              : out std_logic;
+      bus_wrep_ok                 : in  std_logic
+    );
+  end component;
+
   -----------------------------------------------------------------------------
   -- Wrapper simulation components
   -----------------------------------------------------------------------------
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "helpers.h"
 #include "packet.h"
 
 /// @brief Packet template (multi).
@@ -9,5 +10,25 @@ struct f_mpacket : public f_packet_base
     ap_uint<f_log2<N>::value> count = N; // For true minimum use N-1
     T data[N];
     f_mpacket() = default;
-    f_mpacket(T _data[N]) : data(_data), f_packet_base() {}
-};
\ No newline at end of file
+    f_mpacket(const T _data[N]) : f_packet_base()
+    {
+        for (unsigned int i = 0; i < N; i++)
+        {
+#pragma HLS UNROLL
+            data[i] = _data[i];
+        }
+    }
+    f_mpacket(const T _data[N], ap_uint<f_log2<N>::value> _count, bool dvalid, bool last)
+        : f_mpacket(_data)
+    {
+        count = _count;
+        this->dvalid = dvalid;
+        this->last = last;
+    }
+
+    /// @brief Return true if element i is one of the count valid elements of the packet.
+    bool valid(unsigned int i) const { return dvalid && (i < count); }
+
+    using inner_type = T;
+    static constexpr unsigned int elements = N;
+};
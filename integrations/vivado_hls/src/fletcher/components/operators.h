@@ -3,6 +3,9 @@
 #include "fletcher/components/operators/arith.h"
 #include "fletcher/components/operators/indecrement.h"
 #include "fletcher/components/operators/logical.h"
+#include "fletcher/components/operators/mpacket.h"
+#include "fletcher/components/operators/reduce.h"
+#include "fletcher/components/operators/sort.h"
 
 //template <typename T>
 //f_packet<T> operator+(f_packet<T> &rhs) {
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "../mpacket.h"
+
+// Element-wise arithmetic, applied to all N elements in parallel.
+#define OP +
+
+#include "base_mpacket_arith.inc"
+#include "base_mpacket_unary.inc"
+#undef OP
+#define OP -
+
+#include "base_mpacket_arith.inc"
+#include "base_mpacket_unary.inc"
+#undef OP
+#define OP *
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP /
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP %
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP &
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP |
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP ^
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP ~
+
+#include "base_mpacket_unary.inc"
+#undef OP
+#define OP <<
+
+#include "base_mpacket_arith.inc"
+#undef OP
+#define OP >>
+
+#include "base_mpacket_arith.inc"
+#undef OP
+
+// Element-wise comparisons, resulting in a mask packet.
+#define OP ==
+
+#include "base_mpacket_logical.inc"
+#undef OP
+#define OP !=
+
+#include "base_mpacket_logical.inc"
+#undef OP
+#define OP <
+
+#include "base_mpacket_logical.inc"
+#undef OP
+#define OP >
+
+#include "base_mpacket_logical.inc"
+#undef OP
+#define OP <=
+
+#include "base_mpacket_logical.inc"
+#undef OP
+#define OP >=
+
+#include "base_mpacket_logical.inc"
+#undef OP
+
+// Reductions over the valid elements of a packet.
+
+/// @brief Return the sum of the valid elements of a multi-element packet.
+template <typename T, unsigned int N>
+T f_sum(const f_mpacket<T, N> &val) {
+    T result = 0;
+    for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+        if (val.valid(i)) {
+            result += val.data[i];
+        }
+    }
+    return result;
+}
+
+/// @brief Return the number of valid elements of a mask packet that are set.
+template <unsigned int N>
+ap_uint<f_log2<N>::value> f_count(const f_mpacket<bool, N> &mask) {
+    ap_uint<f_log2<N>::value> result = 0;
+    for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+        if (mask.valid(i) && mask.data[i]) {
+            result++;
+        }
+    }
+    return result;
+}
+
+/// @brief Return true if any valid element of a mask packet is set.
+template <unsigned int N>
+bool f_any(const f_mpacket<bool, N> &mask) {
+    return f_count(mask) > 0;
+}
+
+/// @brief Return true if all valid elements of a mask packet are set.
+template <unsigned int N>
+bool f_all(const f_mpacket<bool, N> &mask) {
+    return f_count(mask) == (mask.dvalid ? mask.count : ap_uint<f_log2<N>::value>(0));
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "../mpacket.h"
+#include "../nullable.h"
+
+// Reductions that reach an initiation interval of one.
+//
+// Packets are reduced through a balanced tree of depth log2(N) rather than a chain of N operations, and the null or
+// invalid elements of a packet are skipped rather than replaced by an identity value, such that the same tree serves
+// sums, minima and maxima of any type.
+
+/// @brief Sum operator for reductions.
+struct f_op_sum {
+    template <typename T>
+    T operator()(const T &a, const T &b) const { return a + b; }
+};
+
+/// @brief Minimum operator for reductions.
+struct f_op_min {
+    template <typename T>
+    T operator()(const T &a, const T &b) const { return b < a ? b : a; }
+};
+
+/// @brief Maximum operator for reductions.
+struct f_op_max {
+    template <typename T>
+    T operator()(const T &a, const T &b) const { return a < b ? b : a; }
+};
+
+/// @brief An intermediate value of a reduction tree, which is absent if all elements it covers are invalid.
+template <typename T>
+struct f_partial {
+    T data;
+    bool valid;
+};
+
+/// @brief Reduction tree over elements [LO, LO + LEN) of an array.
+template <typename T, typename Op, unsigned int LO, unsigned int LEN>
+struct f_tree {
+    static f_partial<T> reduce(const T data[], const bool valid[], const Op &op) {
+#pragma HLS INLINE
+        f_partial<T> a = f_tree<T, Op, LO, LEN / 2>::reduce(data, valid, op);
+        f_partial<T> b = f_tree<T, Op, LO + LEN / 2, LEN - LEN / 2>::reduce(data, valid, op);
+        f_partial<T> result;
+        result.valid = a.valid || b.valid;
+        result.data = (a.valid && b.valid) ? op(a.data, b.data) : (a.valid ? a.data : b.data);
+        return result;
+    }
+};
+
+template <typename T, typename Op, unsigned int LO>
+struct f_tree<T, Op, LO, 1> {
+    static f_partial<T> reduce(const T data[], const bool valid[], const Op &op) {
+#pragma HLS INLINE
+        f_partial<T> result;
+        result.data = data[LO];
+        result.valid = valid[LO];
+        return result;
+    }
+};
+
+/**
+ * @brief Reduce the valid, non-null elements of a multi-element packet through a balanced tree.
+ *
+ * Elements of which the corresponding element of \p mask is false are null, and skipped. The result is null if the
+ * packet holds no valid, non-null elements, and has the dvalid and last signals of the packet.
+ */
+template <typename Op, typename T, unsigned int N>
+nullable<f_packet<T>> f_reduce(const f_mpacket<T, N> &val, const f_mpacket<bool, N> &mask, const Op &op = Op()) {
+#pragma HLS INLINE
+    bool valid[N];
+#pragma HLS ARRAY_PARTITION variable=valid complete
+    for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+        valid[i] = val.valid(i) && mask.data[i];
+    }
+    f_partial<T> result = f_tree<T, Op, 0, N>::reduce(val.data, valid, op);
+    return nullable<f_packet<T>>(result.valid, result.data, val.dvalid, val.last);
+}
+
+/// @brief Reduce the valid elements of a multi-element packet through a balanced tree.
+template <typename Op, typename T, unsigned int N>
+nullable<f_packet<T>> f_reduce(const f_mpacket<T, N> &val, const Op &op = Op()) {
+#pragma HLS INLINE
+    f_mpacket<bool, N> mask;
+    for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+        mask.data[i] = true;
+    }
+    return f_reduce<Op>(val, mask, op);
+}
+
+/// @brief Return the sum of the valid elements of a multi-element packet, through an adder tree.
+template <typename T, unsigned int N>
+nullable<f_packet<T>> f_tree_sum(const f_mpacket<T, N> &val) { return f_reduce<f_op_sum>(val); }
+
+/// @brief Return the minimum of the valid elements of a multi-element packet, or null if it has none.
+template <typename T, unsigned int N>
+nullable<f_packet<T>> f_min(const f_mpacket<T, N> &val) { return f_reduce<f_op_min>(val); }
+
+/// @brief Return the maximum of the valid elements of a multi-element packet, or null if it has none.
+template <typename T, unsigned int N>
+nullable<f_packet<T>> f_max(const f_mpacket<T, N> &val) { return f_reduce<f_op_max>(val); }
+
+/**
+ * @brief Reduces the packets of a stream to a single value per sequence, of which the last packet has the last signal.
+ *
+ * Null packets and packets without dvalid are skipped, such that the result of a sequence is null if it holds no
+ * valid elements. The accumulator is the only loop-carried state, so an initiation interval of one is reached if Op
+ * completes within a cycle for T, e.g. integer or fixed-point sums, minima and maxima.
+ *
+ * Example, summing a stream of multi-element packets with one packet per cycle:
+ *
+ *     f_reducer<int, f_op_sum> sum;
+ *     nullable<f_packet<int>> result;
+ *     bool done = false;
+ *     while (!done) {
+ *     #pragma HLS PIPELINE II=1
+ *         done = sum.update(in.read(), &result);
+ *     }
+ */
+template <typename T, typename Op>
+struct f_reducer {
+    T acc = 0;
+    bool any = false;
+
+    /**
+     * @brief Feed a nullable packet to the reducer.
+     * @return True on the last packet of a sequence, in which case \p out holds the result of the sequence. The
+     *         reducer is then reset for the next sequence.
+     */
+    bool update(const nullable<f_packet<T>> &in, nullable<f_packet<T>> *out) {
+#pragma HLS INLINE
+        Op op;
+        bool take = in.dvalid && in.valid;
+        T next = any ? op(acc, in.data) : in.data;
+        bool next_any = any || take;
+        if (take) {
+            acc = next;
+        }
+        any = next_any;
+        if (in.last) {
+            *out = nullable<f_packet<T>>(any, acc, true, true);
+            acc = 0;
+            any = false;
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Feed a packet to the reducer. See update(const nullable<f_packet<T>> &, nullable<f_packet<T>> *).
+    bool update(const f_packet<T> &in, nullable<f_packet<T>> *out) {
+#pragma HLS INLINE
+        return update(nullable<f_packet<T>>(true, in.data, in.dvalid, in.last), out);
+    }
+
+    /// @brief Feed a multi-element packet to the reducer, which is first reduced through a balanced tree.
+    template <unsigned int N>
+    bool update(const f_mpacket<T, N> &in, nullable<f_packet<T>> *out) {
+#pragma HLS INLINE
+        return update(f_reduce<Op>(in), out);
+    }
+};
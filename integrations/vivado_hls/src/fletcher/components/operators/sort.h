@@ -0,0 +1,205 @@
+#pragma once
+
+#include "../mpacket.h"
+#include "../nullable.h"
+
+// Sorting networks and top-k selection that reach an initiation interval of one.
+//
+// Both are built from bitonic compare-exchange networks of depth log2(N) * (log2(N) + 1) / 2, which are fully
+// unrolled. Invalid elements order after all valid elements, such that the valid elements of a sorted packet remain
+// its first count elements.
+
+/// @brief Ascending order.
+struct f_less {
+    template <typename T>
+    bool operator()(const T &a, const T &b) const { return a < b; }
+};
+
+/// @brief Descending order.
+struct f_greater {
+    template <typename T>
+    bool operator()(const T &a, const T &b) const { return b < a; }
+};
+
+/// @brief Return true if N is a power of two.
+template <unsigned int N>
+struct f_is_pow2 {
+    enum { value = (N != 0) && ((N & (N - 1)) == 0) };
+};
+
+/// @brief Compare-exchange two elements, such that element i orders before element j.
+template <typename T, typename Compare>
+void f_compare_exchange(T data[], bool valid[], unsigned int i, unsigned int j, const Compare &comp) {
+#pragma HLS INLINE
+    bool swap = (!valid[i] && valid[j]) || (valid[i] && valid[j] && comp(data[j], data[i]));
+    if (swap) {
+        T t = data[i];
+        data[i] = data[j];
+        data[j] = t;
+        bool v = valid[i];
+        valid[i] = valid[j];
+        valid[j] = v;
+    }
+}
+
+/**
+ * @brief Sort a bitonic sequence of N elements, of which N is a power of two.
+ *
+ * Applies the last merge phase of a bitonic sorting network, i.e. log2(N) stages of N/2 compare-exchanges.
+ */
+template <typename T, unsigned int N, typename Compare>
+void f_bitonic_merge(T data[N], bool valid[N], const Compare &comp) {
+#pragma HLS INLINE
+    for (unsigned int j = N / 2; j > 0; j /= 2) {
+#pragma HLS UNROLL
+        for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+            unsigned int l = i ^ j;
+            if (l > i) {
+                f_compare_exchange(data, valid, i, l, comp);
+            }
+        }
+    }
+}
+
+/// @brief Sort N elements, of which N is a power of two, through a bitonic sorting network.
+template <typename T, unsigned int N, typename Compare>
+void f_bitonic_sort(T data[N], bool valid[N], const Compare &comp) {
+#pragma HLS INLINE
+    for (unsigned int k = 2; k <= N; k *= 2) {
+#pragma HLS UNROLL
+        for (unsigned int j = k / 2; j > 0; j /= 2) {
+#pragma HLS UNROLL
+            for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+                unsigned int l = i ^ j;
+                if (l > i) {
+                    // Alternate the direction of every sequence of k elements, to form bitonic sequences.
+                    if ((i & k) == 0) {
+                        f_compare_exchange(data, valid, i, l, comp);
+                    } else {
+                        f_compare_exchange(data, valid, l, i, comp);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sort the valid elements of a multi-element packet, of which N must be a power of two.
+ *
+ * The sorted valid elements are the first count elements of the result, which has the count, dvalid and last signals
+ * of the packet.
+ */
+template <typename T, unsigned int N, typename Compare = f_less>
+f_mpacket<T, N> f_sort(const f_mpacket<T, N> &val, const Compare &comp = Compare()) {
+#pragma HLS INLINE
+    static_assert(f_is_pow2<N>::value, "f_sort requires a power of two number of elements.");
+    f_mpacket<T, N> result = val;
+    bool valid[N];
+#pragma HLS ARRAY_PARTITION variable=valid complete
+    for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+        valid[i] = val.valid(i);
+    }
+    f_bitonic_sort<T, N>(result.data, valid, comp);
+    return result;
+}
+
+/**
+ * @brief Keeps the first K elements of a stream in the order of Compare, e.g. the K greatest with f_greater.
+ *
+ * K must be a power of two. The elements are held in order in data, of which the first count are valid. The data
+ * array must be completely partitioned by the kernel, e.g.:
+ *
+ *     f_topk<int, 8> top;
+ *     #pragma HLS ARRAY_PARTITION variable=top.data complete
+ *
+ * Every insertion takes a single bitonic merge of depth log2(K), such that a multi-element packet of up to K elements
+ * is inserted every cycle at an initiation interval of one.
+ */
+template <typename T, unsigned int K, typename Compare = f_greater>
+struct f_topk {
+    static_assert(f_is_pow2<K>::value, "f_topk requires a power of two number of elements.");
+
+    T data[K];
+    ap_uint<f_log2<K + 1>::value> count = 0;
+
+    /// @brief Remove all elements, e.g. at the start of a sequence.
+    void clear() { count = 0; }
+
+    /**
+     * @brief Insert the valid, non-null elements of a multi-element packet of N <= K elements, of which N must be a
+     *        power of two.
+     *
+     * Elements of which the corresponding element of \p mask is false are null, and skipped.
+     */
+    template <unsigned int N>
+    void insert(const f_mpacket<T, N> &val, const f_mpacket<bool, N> &mask) {
+#pragma HLS INLINE
+        static_assert(N <= K, "f_topk can insert at most K elements at once.");
+        static_assert(f_is_pow2<N>::value, "f_topk requires a power of two number of elements per packet.");
+        Compare comp;
+        // Sort the packet, and merge it in reverse with the held elements. Of every pair, the first in order belongs
+        // to the first K elements of both. The result is a bitonic sequence, which is then sorted.
+        f_mpacket<T, N> in = val;
+        bool in_valid[N];
+#pragma HLS ARRAY_PARTITION variable=in_valid complete
+        for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+            in_valid[i] = val.valid(i) && mask.data[i];
+        }
+        f_bitonic_sort<T, N>(in.data, in_valid, comp);
+        T merged[K];
+        bool merged_valid[K];
+#pragma HLS ARRAY_PARTITION variable=merged complete
+#pragma HLS ARRAY_PARTITION variable=merged_valid complete
+        for (unsigned int i = 0; i < K; i++) {
+#pragma HLS UNROLL
+            bool held = i < count;
+            unsigned int r = K - 1 - i;
+            bool other = (r < N) && in_valid[r < N ? r : 0];
+            T other_data = in.data[r < N ? r : 0];
+            bool take_other = other && (!held || comp(other_data, data[i]));
+            merged[i] = take_other ? other_data : data[i];
+            merged_valid[i] = held || other;
+        }
+        f_bitonic_merge<T, K>(merged, merged_valid, comp);
+        ap_uint<f_log2<K + 1>::value> n = 0;
+        for (unsigned int i = 0; i < K; i++) {
+#pragma HLS UNROLL
+            data[i] = merged[i];
+            if (merged_valid[i]) {
+                n++;
+            }
+        }
+        count = n;
+    }
+
+    /// @brief Insert the valid elements of a multi-element packet of N <= K elements, N being a power of two.
+    template <unsigned int N>
+    void insert(const f_mpacket<T, N> &val) {
+#pragma HLS INLINE
+        f_mpacket<bool, N> mask;
+        for (unsigned int i = 0; i < N; i++) {
+#pragma HLS UNROLL
+            mask.data[i] = true;
+        }
+        insert(val, mask);
+    }
+
+    /// @brief Insert a nullable packet, unless it is null or has no valid data.
+    void insert(const nullable<f_packet<T>> &val) {
+#pragma HLS INLINE
+        T d[1] = {val.data};
+        f_mpacket<T, 1> in(d, 1, val.dvalid && val.valid, val.last);
+        insert(in);
+    }
+
+    /// @brief Insert a packet, unless it has no valid data.
+    void insert(const f_packet<T> &val) {
+#pragma HLS INLINE
+        insert(nullable<f_packet<T>>(true, val.data, val.dvalid, val.last));
+    }
+};
@@ -43,6 +43,7 @@ using f_mdpacket = f_mpacket<double, N>;
 
 using f_base_length_type = ap_int<32>;
 using f_size = f_spacket<32>;
+using f_lsize = f_spacket<64>;
 
 // Arrow primitive types:
 using f_bool = f_upacket<1>;
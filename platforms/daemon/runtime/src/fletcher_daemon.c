@@ -0,0 +1,569 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <memory.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "fletcher/fletcher.h"
+
+#include "./fletcher_daemon.h"
+#include "./fletcher_daemon_shm.h"
+
+#define CHECK_STATUS(identifier) if (identifier != FLETCHER_STATUS_OK) { \
+                                   return status;                        \
+                                 }                                       \
+                                 (void)0
+
+#define daemon_print(...) do { if (!options.quiet) fprintf(stdout, __VA_ARGS__); } while (0)
+
+/// Host memory shared with the daemon.
+typedef struct {
+  /// The host address of the buffer.
+  uint8_t *host;
+  /// The size of the buffer in bytes.
+  uint64_t size;
+  /// The identifier of the buffer in commands.
+  uint64_t id;
+} SharedBuffer;
+
+InitOptions options = {0};
+
+/// The socket connected to the daemon, or -1 if the platform is not initialized.
+static int sock = -1;
+/// The segment shared with the daemon.
+static FletcherDaemonShm *shm = NULL;
+/// The staging area in the segment.
+static uint8_t *staging = NULL;
+/// Host memory allocated with platformHostMalloc.
+static SharedBuffer *buffers = NULL;
+/// Number of buffers in host memory allocated with platformHostMalloc.
+static size_t num_buffers = 0;
+/// Serializes commands and messages of multiple threads.
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// @brief Sleep briefly while waiting for the daemon.
+static void backoff(void) {
+  struct timespec ts = {0, 10000};
+  nanosleep(&ts, NULL);
+}
+
+/// @brief Return zero if the daemon has closed the connection.
+static int daemon_alive(void) {
+  char byte;
+  ssize_t received = recv(sock, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    fprintf(stderr, "[DAEMON] Lost the connection to the daemon.\n");
+    return 0;
+  }
+  return 1;
+}
+
+/// @brief Send \p message with file descriptor \p fd, if not negative, and store the answer in \p message.
+static fstatus_t request(FletcherDaemonMessage *message, int fd) {
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE(sizeof(int))];
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base = message;
+  iov.iov_len = sizeof(*message);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (fd >= 0) {
+    memset(control, 0, sizeof(control));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) != (ssize_t) sizeof(*message)) return FLETCHER_STATUS_ERROR;
+  if (recv(sock, message, sizeof(*message), MSG_WAITALL) != (ssize_t) sizeof(*message)) return FLETCHER_STATUS_ERROR;
+  return message->status;
+}
+
+/// @brief Enqueue \p command and store its index in \p index. Must be called with the lock held.
+static fstatus_t enqueue(const FletcherDaemonCommand *command, uint64_t *index) {
+  uint64_t head = shm->head;
+  // Wait for a free slot in the ring.
+  while (head - __atomic_load_n(&shm->tail, __ATOMIC_ACQUIRE) >= FLETCHER_DAEMON_RING_SIZE) {
+    if (!daemon_alive()) return FLETCHER_STATUS_ERROR;
+    backoff();
+  }
+  shm->ring[head % FLETCHER_DAEMON_RING_SIZE] = *command;
+  __atomic_store_n(&shm->head, head + 1, __ATOMIC_RELEASE);
+  if (index != NULL) *index = head;
+  return FLETCHER_STATUS_OK;
+}
+
+/// @brief Wait for the completion of the command at \p index. Must be called with the lock held.
+static fstatus_t wait_for(uint64_t index) {
+  while (__atomic_load_n(&shm->tail, __ATOMIC_ACQUIRE) <= index) {
+    if (!daemon_alive()) return FLETCHER_STATUS_ERROR;
+    backoff();
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+/// @brief Wait for the completion of all enqueued commands. Must be called with the lock held.
+static fstatus_t drain(void) {
+  if (shm->head == 0) return FLETCHER_STATUS_OK;
+  return wait_for(shm->head - 1);
+}
+
+/**
+ * @brief Execute \p command and wait for its completion. Must be called with the lock held.
+ *
+ * On success, \p command holds the completed command.
+ */
+static fstatus_t execute(FletcherDaemonCommand *command) {
+  fstatus_t status;
+  uint64_t index;
+  status = enqueue(command, &index);
+  CHECK_STATUS(status);
+  status = wait_for(index);
+  CHECK_STATUS(status);
+  *command = shm->ring[index % FLETCHER_DAEMON_RING_SIZE];
+  return command->status;
+}
+
+/**
+ * @brief Find the shared buffer that holds \p size bytes at \p host_address. Must be called with the lock held.
+ *
+ * Stores the identifier of the buffer and the offset of the bytes in it in \p id and \p position. Returns zero if no
+ * shared buffer holds all bytes.
+ */
+static int find_buffer(const uint8_t *host_address, int64_t size, uint64_t *id, uint64_t *position) {
+  size_t i;
+  for (i = 0; i < num_buffers; i++) {
+    if (host_address >= buffers[i].host && host_address + size <= buffers[i].host + buffers[i].size) {
+      *id = buffers[i].id;
+      *position = (uint64_t) (host_address - buffers[i].host);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+fstatus_t platformGetName(char *name, size_t size) {
+  size_t len = strlen(FLETCHER_PLATFORM_NAME);
+  if (len > size) {
+    memcpy(name, FLETCHER_PLATFORM_NAME, size - 1);
+    name[size - 1] = '\0';
+  } else {
+    memcpy(name, FLETCHER_PLATFORM_NAME, len + 1);
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformInit(void *arg) {
+  InitOptions defaults = {0};
+  FletcherDaemonMessage message = {0};
+  struct sockaddr_un address;
+  const char *env;
+  uint64_t size = FLETCHER_DAEMON_STAGING_OFFSET + FLETCHER_DAEMON_STAGING_BYTES;
+  fstatus_t status;
+  int fd;
+  if (sock >= 0) {
+    return FLETCHER_STATUS_OK;
+  }
+  options = (arg != NULL) ? *(InitOptions *) arg : defaults;
+
+  env = getenv("FLETCHER_DAEMON_SOCKET");
+  if (env != NULL) options.socket_path = env;
+  if (options.socket_path == NULL) options.socket_path = FLETCHER_DAEMON_DEFAULT_SOCKET;
+
+  daemon_print("[DAEMON] Initializing platform.       Arguments @ [host] %016lX.\n", (unsigned long) arg);
+
+  sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) return FLETCHER_STATUS_ERROR;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", options.socket_path);
+  if (connect(sock, (struct sockaddr *) &address, sizeof(address)) != 0) {
+    fprintf(stderr, "[DAEMON] Could not connect to the daemon at %s.\n", options.socket_path);
+    close(sock);
+    sock = -1;
+    return FLETCHER_STATUS_ERROR;
+  }
+
+  // Create the segment, which the daemon maps through the file descriptor that is passed along.
+  fd = memfd_create("fletcher_daemon", MFD_CLOEXEC);
+  if (fd < 0 || ftruncate(fd, (off_t) size) != 0) {
+    if (fd >= 0) close(fd);
+    close(sock);
+    sock = -1;
+    return FLETCHER_STATUS_ERROR;
+  }
+  shm = (FletcherDaemonShm *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (shm == MAP_FAILED) {
+    shm = NULL;
+    close(fd);
+    close(sock);
+    sock = -1;
+    return FLETCHER_STATUS_ERROR;
+  }
+  staging = (uint8_t *) shm + FLETCHER_DAEMON_STAGING_OFFSET;
+  shm->size = size;
+  __atomic_store_n(&shm->magic, FLETCHER_DAEMON_MAGIC, __ATOMIC_RELEASE);
+
+  message.type = FLETCHER_DAEMON_MSG_CONNECT;
+  message.size = size;
+  status = request(&message, fd);
+  close(fd);
+  if (status != FLETCHER_STATUS_OK) {
+    fprintf(stderr, "[DAEMON] The daemon refused the connection.\n");
+    munmap(shm, size);
+    shm = NULL;
+    staging = NULL;
+    close(sock);
+    sock = -1;
+    return FLETCHER_STATUS_ERROR;
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_WRITE_MMIO;
+  command.offset = offset;
+  command.value = value;
+  pthread_mutex_lock(&lock);
+  status = enqueue(&command, NULL);
+  pthread_mutex_unlock(&lock);
+  daemon_print("[DAEMON] Wrote MMIO register.       %04lu <= 0x%08X\n", offset, value);
+  return status;
+}
+
+fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status = FLETCHER_STATUS_OK;
+  uint64_t i;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_WRITE_MMIO;
+  pthread_mutex_lock(&lock);
+  for (i = 0; i < count && status == FLETCHER_STATUS_OK; i++) {
+    command.offset = offset + i;
+    command.value = values[i];
+    status = enqueue(&command, NULL);
+    daemon_print("[DAEMON] Wrote MMIO register.       %04lu <= 0x%08X (batch)\n", offset + i, values[i]);
+  }
+  pthread_mutex_unlock(&lock);
+  return status;
+}
+
+fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_READ_MMIO;
+  command.offset = offset;
+  pthread_mutex_lock(&lock);
+  status = execute(&command);
+  pthread_mutex_unlock(&lock);
+  CHECK_STATUS(status);
+  *value = (uint32_t) command.value;
+  daemon_print("[DAEMON] Read MMIO register.        %04lu => 0x%08X\n", offset, *value);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status = FLETCHER_STATUS_OK;
+  uint64_t id;
+  uint64_t position;
+  int64_t done;
+  int64_t chunk;
+  if (shm == NULL || size < 0) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_COPY_H2D;
+  pthread_mutex_lock(&lock);
+  if (find_buffer(host_source, size, &id, &position)) {
+    // The daemon reads the shared buffer directly.
+    command.buffer = id;
+    command.position = position;
+    command.value = device_destination;
+    command.size = (uint64_t) size;
+    status = execute(&command);
+  } else {
+    for (done = 0; done < size && status == FLETCHER_STATUS_OK; done += chunk) {
+      chunk = size - done;
+      if ((uint64_t) chunk > FLETCHER_DAEMON_STAGING_BYTES) chunk = FLETCHER_DAEMON_STAGING_BYTES;
+      memcpy(staging, host_source + done, chunk);
+      command.buffer = FLETCHER_DAEMON_STAGING;
+      command.position = 0;
+      command.value = device_destination + done;
+      command.size = (uint64_t) chunk;
+      status = execute(&command);
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  daemon_print("[DAEMON] Copied from host to device.  [host] 0x%016lX --> [dev] 0x%016lX (%ld bytes)\n",
+               (uint64_t) host_source,
+               device_destination,
+               size);
+  return status;
+}
+
+fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count) {
+  fstatus_t status;
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    status = platformCopyHostToDevice(iov[i].host_address, iov[i].device_address, (int64_t) iov[i].size);
+    CHECK_STATUS(status);
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination, int64_t size) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status = FLETCHER_STATUS_OK;
+  uint64_t id;
+  uint64_t position;
+  int64_t done;
+  int64_t chunk;
+  if (shm == NULL || size < 0) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_COPY_D2H;
+  pthread_mutex_lock(&lock);
+  if (find_buffer(host_destination, size, &id, &position)) {
+    // The daemon writes the shared buffer directly.
+    command.buffer = id;
+    command.position = position;
+    command.value = device_source;
+    command.size = (uint64_t) size;
+    status = execute(&command);
+  } else {
+    for (done = 0; done < size && status == FLETCHER_STATUS_OK; done += chunk) {
+      chunk = size - done;
+      if ((uint64_t) chunk > FLETCHER_DAEMON_STAGING_BYTES) chunk = FLETCHER_DAEMON_STAGING_BYTES;
+      command.buffer = FLETCHER_DAEMON_STAGING;
+      command.position = 0;
+      command.value = device_source + done;
+      command.size = (uint64_t) chunk;
+      status = execute(&command);
+      if (status == FLETCHER_STATUS_OK) {
+        memcpy(host_destination + done, staging, chunk);
+      }
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  daemon_print("[DAEMON] Copied from device to host.  [dev] 0x%016lX --> [host] 0x%016lX (%ld bytes)\n",
+               device_source,
+               (uint64_t) host_destination,
+               size);
+  return status;
+}
+
+fstatus_t platformTerminate(void *arg) {
+  size_t i;
+  if (sock < 0) {
+    return FLETCHER_STATUS_OK;
+  }
+  daemon_print("[DAEMON] Terminating platform.        Arguments @ [host] 0x%016lX.\n", (uint64_t) arg);
+  pthread_mutex_lock(&lock);
+  // Let the daemon complete the posted commands before disconnecting. It then releases everything of this process.
+  drain();
+  close(sock);
+  sock = -1;
+  for (i = 0; i < num_buffers; i++) {
+    munmap(buffers[i].host, buffers[i].size);
+  }
+  free(buffers);
+  buffers = NULL;
+  num_buffers = 0;
+  munmap(shm, shm->size);
+  shm = NULL;
+  staging = NULL;
+  pthread_mutex_unlock(&lock);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status;
+  if (shm == NULL || size < 0) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_DEVICE_MALLOC;
+  command.size = (uint64_t) size;
+  pthread_mutex_lock(&lock);
+  status = execute(&command);
+  pthread_mutex_unlock(&lock);
+  CHECK_STATUS(status);
+  *device_address = command.value;
+  daemon_print("[DAEMON] Allocating device memory.    [device] 0x%016lX (%10lu bytes).\n",
+               (uint64_t) *device_address,
+               size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformDeviceFree(da_t device_address) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  command.type = FLETCHER_DAEMON_CMD_DEVICE_FREE;
+  command.value = device_address;
+  pthread_mutex_lock(&lock);
+  status = execute(&command);
+  pthread_mutex_unlock(&lock);
+  daemon_print("[DAEMON] Freeing device memory.       [device] 0x%016lX.\n", device_address);
+  return status;
+}
+
+fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size) {
+  FletcherDaemonMessage message = {0};
+  SharedBuffer *grown;
+  uint8_t *host;
+  fstatus_t status;
+  int fd;
+  if (shm == NULL || size <= 0) return FLETCHER_STATUS_ERROR;
+  fd = memfd_create("fletcher_daemon_buffer", MFD_CLOEXEC);
+  if (fd < 0) return FLETCHER_STATUS_ERROR;
+  if (ftruncate(fd, (off_t) size) != 0) {
+    close(fd);
+    return FLETCHER_STATUS_ERROR;
+  }
+  host = (uint8_t *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (host == MAP_FAILED) {
+    close(fd);
+    return FLETCHER_STATUS_ERROR;
+  }
+
+  pthread_mutex_lock(&lock);
+  grown = (SharedBuffer *) realloc(buffers, (num_buffers + 1) * sizeof(SharedBuffer));
+  if (grown == NULL) {
+    status = FLETCHER_STATUS_ERROR;
+  } else {
+    buffers = grown;
+    // The daemon maps the buffer and prepares it on the device.
+    message.type = FLETCHER_DAEMON_MSG_MAP;
+    message.size = (uint64_t) size;
+    status = request(&message, fd);
+  }
+  if (status == FLETCHER_STATUS_OK) {
+    buffers[num_buffers].host = host;
+    buffers[num_buffers].size = (uint64_t) size;
+    buffers[num_buffers].id = message.id;
+    num_buffers++;
+  }
+  pthread_mutex_unlock(&lock);
+  close(fd);
+
+  if (status != FLETCHER_STATUS_OK) {
+    munmap(host, size);
+    return status;
+  }
+  *host_address = host;
+  *device_address = message.address;
+  daemon_print("[DAEMON] Allocating shared memory.    [host] 0x%016lX --> [device] 0x%016lX (%10lu bytes).\n",
+               (uint64_t) host,
+               (uint64_t) *device_address,
+               size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformHostFree(uint8_t *host_address) {
+  FletcherDaemonMessage message = {0};
+  fstatus_t status;
+  uint64_t size;
+  size_t i;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  for (i = 0; i < num_buffers && buffers[i].host != host_address; i++) {}
+  if (i == num_buffers) {
+    pthread_mutex_unlock(&lock);
+    return FLETCHER_STATUS_ERROR;
+  }
+  // Enqueued commands may still refer to the buffer.
+  status = drain();
+  if (status == FLETCHER_STATUS_OK) {
+    message.type = FLETCHER_DAEMON_MSG_UNMAP;
+    message.id = buffers[i].id;
+    status = request(&message, -1);
+  }
+  size = buffers[i].size;
+  buffers[i] = buffers[num_buffers - 1];
+  num_buffers--;
+  pthread_mutex_unlock(&lock);
+  munmap(host_address, size);
+  daemon_print("[DAEMON] Freeing shared memory.       [host] 0x%016lX.\n", (uint64_t) host_address);
+  return status;
+}
+
+fstatus_t platformPrepareHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size, int *alloced) {
+  FletcherDaemonCommand command = {0};
+  fstatus_t status;
+  int shared;
+
+  if (shm == NULL || size < 0) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  shared = find_buffer(host_source, size, &command.buffer, &command.position);
+  if (shared) {
+    // Let the platform of the daemon decide whether the device can access the shared buffer directly.
+    command.type = FLETCHER_DAEMON_CMD_PREPARE;
+    command.size = (uint64_t) size;
+    status = execute(&command);
+  }
+  pthread_mutex_unlock(&lock);
+
+  if (shared) {
+    CHECK_STATUS(status);
+    *device_destination = command.value;
+    *alloced = command.size != 0;
+  } else {
+    // Allocate new memory.
+    status = platformDeviceMalloc(device_destination, size);
+    // We have newly allocated the buffer, signal this back to the caller.
+    *alloced = 1;
+    CHECK_STATUS(status);
+
+    // Copy data
+    status = platformCopyHostToDevice(host_source, *device_destination, size);
+  }
+
+  daemon_print("[DAEMON] Prepared buffer on device.   [host] 0x%016lX --> 0x%016lX (%10lu bytes).\n",
+               (unsigned long) host_source,
+               (unsigned long) *device_destination,
+               size);
+
+  return status;
+}
+
+fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size) {
+  fstatus_t status;
+
+  // Allocate new memory.
+  status = platformDeviceMalloc(device_destination, size);
+  CHECK_STATUS(status);
+
+  // Copy data
+  status = platformCopyHostToDevice(host_source, *device_destination, size);
+
+  daemon_print("[DAEMON] Cached buffer on device.     [host] 0x%016lX --> 0x%016lX (%10lu bytes).\n",
+               (unsigned long) host_source,
+               (unsigned long) *device_destination,
+               size);
+
+  return status;
+}
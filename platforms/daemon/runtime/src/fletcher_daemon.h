@@ -0,0 +1,106 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include "fletcher/fletcher.h"
+
+/// Platform name.
+#define FLETCHER_PLATFORM_NAME "daemon"
+
+/**
+ * @brief Platform options.
+ *
+ * The options can also be set through the environment, which is useful when the platform is created by name:
+ * FLETCHER_DAEMON_SOCKET.
+ */
+typedef struct {
+  /// Non-zero to suppress all output.
+  int quiet;
+  /// Path of the socket of the daemon. NULL selects FLETCHER_DAEMON_DEFAULT_SOCKET.
+  const char *socket_path;
+} InitOptions;
+
+/// @brief Store the platform name in a buffer of size /p size pointed to by /p name.
+fstatus_t platformGetName(char *name, size_t size);
+
+/**
+ * @brief Initialize the platform.
+ *
+ * Connect to the daemon and pass it the command ring. \p arg may point to a null pointer or an InitOptions structure.
+ */
+fstatus_t platformInit(void *arg);
+
+/**
+ * @brief Write \p value to MMIO register \p offset. The write is posted; it is executed in order by the daemon.
+ *
+ * The first write to the register window of a kernel instance leases the instance to this process. Commands that write
+ * to an instance that is leased to another process wait until the lease is released.
+ */
+fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value);
+
+/// @brief Write \p count consecutive MMIO registers starting at \p offset from \p values.
+fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count);
+
+/// @brief Read MMIO register \p offset into \p value. Blocks until the daemon has executed the read.
+fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value);
+
+/**
+ * @brief Copy \p size bytes from host address \p host_source to device address \p device_destination.
+ *
+ * The daemon reads host memory allocated with platformHostMalloc directly. Other host memory is copied through the
+ * staging area.
+ */
+fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size);
+
+/// @brief Copy \p count regions described by \p iov from host to device.
+fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count);
+
+/// @brief Copy \p size bytes from device address \p device_source to host address \p host_destination.
+fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination, int64_t size);
+
+/// @brief Allocate \p size bytes on the device. The daemon frees the allocation if this process exits.
+fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size);
+
+/// @brief Free the memory allocated at \p device_address.
+fstatus_t platformDeviceFree(da_t device_address);
+
+/**
+ * @brief Allocate \p size bytes of host memory that the device can access directly.
+ *
+ * The memory is shared with the daemon, which prepares it on the device. This only succeeds if the platform of the
+ * daemon can access the host memory without copying it.
+ */
+fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size);
+
+/// @brief Free device-visible host memory allocated at \p host_address.
+fstatus_t platformHostFree(uint8_t *host_address);
+
+/**
+ * @brief Ensure the device can read \p size bytes from a host buffer at \p host_source.
+ *
+ * Buffers in host memory allocated with platformHostMalloc are prepared by the platform of the daemon. Other buffers
+ * are always copied to newly allocated device memory.
+ */
+fstatus_t platformPrepareHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size, int *alloced);
+
+/// @brief Explicitly cache \p size bytes from \p host_source on the device.
+fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size);
+
+/**
+ * @brief Terminate the platform.
+ *
+ * Disconnect from the daemon, which releases the device memory, host buffers and kernel instances of this process.
+ */
+fstatus_t platformTerminate(void *arg);
@@ -0,0 +1,116 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/**
+ * This file describes the protocol between the daemon platform, which is loaded by every host application, and the
+ * device daemon fletcherd, which owns the device. It is included by both.
+ *
+ * A client connects to the Unix socket of the daemon, and passes it a memfd with its segment in a CONNECT message. The
+ * segment starts with a FletcherDaemonShm header, followed by the staging area. The client enqueues commands in the
+ * ring of the header. The daemon executes them in order, and completes every command by storing its status and result
+ * in the command and advancing the tail.
+ *
+ * Host memory that the client allocates with platformHostMalloc is a memfd as well, that the client passes to the
+ * daemon in a MAP message. Commands refer to such a buffer by the identifier that the daemon returns, such that the
+ * daemon reads and writes it directly. Commands that refer to buffer zero use the staging area instead.
+ */
+
+#include <stdint.h>
+
+/// Value of the magic field of an initialized segment.
+#define FLETCHER_DAEMON_MAGIC 0x4E4F4D4541444C46ull
+
+/// Default path of the socket of the daemon, if FLETCHER_DAEMON_SOCKET is not set.
+#define FLETCHER_DAEMON_DEFAULT_SOCKET "/tmp/fletcherd.sock"
+
+/// Number of commands in the ring.
+#define FLETCHER_DAEMON_RING_SIZE 256
+
+/// Offset of the staging area in the segment, the first page boundary after the header.
+#define FLETCHER_DAEMON_STAGING_OFFSET 16384ull
+
+/// Size of the staging area in bytes. Larger copies of memory that is not shared with the daemon are split.
+#define FLETCHER_DAEMON_STAGING_BYTES (4ull * 1024 * 1024)
+
+/// Buffer identifier of the staging area.
+#define FLETCHER_DAEMON_STAGING 0
+
+/// Socket message types.
+#define FLETCHER_DAEMON_MSG_CONNECT 1
+#define FLETCHER_DAEMON_MSG_MAP 2
+#define FLETCHER_DAEMON_MSG_UNMAP 3
+
+/// Command types.
+#define FLETCHER_DAEMON_CMD_NONE 0
+#define FLETCHER_DAEMON_CMD_WRITE_MMIO 1
+#define FLETCHER_DAEMON_CMD_READ_MMIO 2
+#define FLETCHER_DAEMON_CMD_DEVICE_MALLOC 3
+#define FLETCHER_DAEMON_CMD_DEVICE_FREE 4
+#define FLETCHER_DAEMON_CMD_COPY_H2D 5
+#define FLETCHER_DAEMON_CMD_COPY_D2H 6
+#define FLETCHER_DAEMON_CMD_PREPARE 7
+
+/**
+ * A message on the socket. Every message is answered by a message of the same type.
+ *
+ * CONNECT and MAP messages carry a file descriptor of \p size bytes. The answer to a MAP message holds the identifier
+ * of the buffer, and the device address through which the device accesses it. An UNMAP message releases the buffer
+ * with identifier \p id.
+ */
+typedef struct {
+  /// The message type.
+  uint32_t type;
+  /// The status of the answer.
+  uint32_t status;
+  /// The buffer identifier.
+  uint64_t id;
+  /// The size of the segment or the buffer in bytes.
+  uint64_t size;
+  /// The device address of the buffer.
+  uint64_t address;
+} FletcherDaemonMessage;
+
+/// A command from a client to the daemon.
+typedef struct {
+  /// The command type.
+  uint32_t type;
+  /// The status of the command after completion.
+  uint32_t status;
+  /// The MMIO register offset.
+  uint64_t offset;
+  /// The value to write or that was read, or the device address.
+  uint64_t value;
+  /// The host buffer identifier, or FLETCHER_DAEMON_STAGING.
+  uint64_t buffer;
+  /// The offset in the host buffer in bytes.
+  uint64_t position;
+  /// The size in bytes. After completion of a PREPARE command, non-zero if device memory was allocated.
+  uint64_t size;
+} FletcherDaemonCommand;
+
+/// Header of the segment of a client.
+typedef struct {
+  /// FLETCHER_DAEMON_MAGIC when the client has initialized the segment.
+  uint64_t magic;
+  /// Size of the whole segment in bytes.
+  uint64_t size;
+  /// Number of commands enqueued by the client.
+  uint64_t head;
+  /// Number of commands completed by the daemon.
+  uint64_t tail;
+  /// The command ring, indexed by head and tail modulo FLETCHER_DAEMON_RING_SIZE.
+  FletcherDaemonCommand ring[FLETCHER_DAEMON_RING_SIZE];
+} FletcherDaemonShm;
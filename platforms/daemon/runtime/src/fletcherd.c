@@ -0,0 +1,642 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * The device daemon. It loads the platform library of the device, and executes the commands of all connected host
+ * applications on it. See fletcher_daemon_shm.h for the protocol.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <memory.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "fletcher/fletcher.h"
+
+#include "./fletcher_daemon_shm.h"
+
+/// Maximum number of connected clients.
+#define FLETCHERD_MAX_CLIENTS 64
+
+/// Maximum number of leased kernel instances.
+#define FLETCHERD_MAX_LEASES 64
+
+/// Maximum number of commands executed for a client before serving the next one.
+#define FLETCHERD_BATCH 32
+
+/// Default time in microseconds a client keeps a kernel instance after it completed, if FLETCHER_DAEMON_LEASE_USEC is
+/// not set.
+#define FLETCHERD_DEFAULT_LEASE_USEC 10000
+
+#define daemon_print(...) do { if (!options.quiet) fprintf(stdout, __VA_ARGS__); } while (0)
+
+/// Daemon options.
+typedef struct {
+  /// Non-zero to suppress all output.
+  int quiet;
+  /// Name of the platform of the device.
+  const char *platform;
+  /// Path of the socket.
+  const char *socket_path;
+  /// Device to select, or -1 to use the default device of the platform.
+  long device;
+  /// Time in microseconds a client keeps a kernel instance after it completed.
+  uint64_t lease_usec;
+} Options;
+
+/// The functions of the platform library of the device.
+typedef struct {
+  void *handle;
+  fstatus_t (*platformInit)(void *);
+  fstatus_t (*platformWriteMMIO)(uint64_t, uint32_t);
+  fstatus_t (*platformReadMMIO)(uint64_t, uint32_t *);
+  fstatus_t (*platformDeviceMalloc)(da_t *, int64_t);
+  fstatus_t (*platformDeviceFree)(da_t);
+  fstatus_t (*platformCopyHostToDevice)(const uint8_t *, da_t, int64_t);
+  fstatus_t (*platformCopyDeviceToHost)(da_t, uint8_t *, int64_t);
+  fstatus_t (*platformPrepareHostBuffer)(const uint8_t *, da_t *, int64_t, int *);
+  fstatus_t (*platformTerminate)(void *);
+  fstatus_t (*platformSetDevice)(uint64_t);
+} Device;
+
+/// Host memory of a client that is mapped by the daemon.
+typedef struct {
+  /// The identifier of the buffer in commands.
+  uint64_t id;
+  /// The address of the mapping.
+  uint8_t *data;
+  /// The size of the buffer in bytes.
+  uint64_t size;
+} Buffer;
+
+/// A connected host application.
+typedef struct {
+  /// The socket, or -1 if this slot is free.
+  int socket;
+  /// The segment of the client, or NULL before it has connected.
+  FletcherDaemonShm *shm;
+  /// The host memory of the client.
+  Buffer *buffers;
+  size_t num_buffers;
+  /// The identifier of the next buffer.
+  uint64_t next_id;
+  /// The device memory allocated by the client, freed when it disconnects.
+  da_t *allocations;
+  size_t num_allocations;
+} Client;
+
+/**
+ * The lease of the register window of a kernel instance to a client.
+ *
+ * Only the client holding the lease writes the registers of the instance, such that the launches of different clients
+ * do not interfere.
+ */
+typedef struct {
+  /// The client holding the lease, or NULL if this slot is free.
+  Client *client;
+  /// The register window, i.e. the MMIO offset divided by FLETCHER_INSTANCE_WINDOW_REGS.
+  uint64_t window;
+  /// Non-zero if the client started the instance.
+  int started;
+  /// Non-zero if the client read a status register with the done bit set after it started the instance.
+  int done;
+  /// Non-zero if another client waits for the lease.
+  int contended;
+  /// The time of the last access by the client in microseconds.
+  uint64_t last_usec;
+} Lease;
+
+static Options options = {0};
+static Device device = {0};
+static Client clients[FLETCHERD_MAX_CLIENTS];
+static Lease leases[FLETCHERD_MAX_LEASES];
+static volatile sig_atomic_t running = 1;
+
+static void stop(int signal) {
+  (void) signal;
+  running = 0;
+}
+
+/// @brief Return a monotonic time in microseconds.
+static uint64_t now_usec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+/// @brief Sleep briefly when no client has work, such that an idle daemon hardly uses the CPU.
+static void backoff(void) {
+  struct timespec ts = {0, 50000};
+  nanosleep(&ts, NULL);
+}
+
+#define LOAD_SYMBOL(symbol) *(void **) (&device.symbol) = dlsym(device.handle, #symbol)
+
+/// @brief Load the platform library of the device. Returns zero on failure.
+static int load_platform(const char *name) {
+  char library[256];
+  snprintf(library, sizeof(library), "libfletcher_%s.so", name);
+  device.handle = dlopen(library, RTLD_NOW);
+  if (device.handle == NULL) {
+    fprintf(stderr, "[FLETCHERD] Could not load %s: %s\n", library, dlerror());
+    return 0;
+  }
+  LOAD_SYMBOL(platformInit);
+  LOAD_SYMBOL(platformWriteMMIO);
+  LOAD_SYMBOL(platformReadMMIO);
+  LOAD_SYMBOL(platformDeviceMalloc);
+  LOAD_SYMBOL(platformDeviceFree);
+  LOAD_SYMBOL(platformCopyHostToDevice);
+  LOAD_SYMBOL(platformCopyDeviceToHost);
+  LOAD_SYMBOL(platformPrepareHostBuffer);
+  LOAD_SYMBOL(platformTerminate);
+  LOAD_SYMBOL(platformSetDevice);
+  if (device.platformInit == NULL || device.platformWriteMMIO == NULL || device.platformReadMMIO == NULL
+      || device.platformDeviceMalloc == NULL || device.platformDeviceFree == NULL
+      || device.platformCopyHostToDevice == NULL || device.platformCopyDeviceToHost == NULL
+      || device.platformPrepareHostBuffer == NULL || device.platformTerminate == NULL) {
+    fprintf(stderr, "[FLETCHERD] %s does not implement the platform interface.\n", library);
+    return 0;
+  }
+  return 1;
+}
+
+/// @brief Return the lease of register window \p window, or NULL if it is not leased.
+static Lease *find_lease(uint64_t window) {
+  size_t i;
+  for (i = 0; i < FLETCHERD_MAX_LEASES; i++) {
+    if (leases[i].client != NULL && leases[i].window == window) return &leases[i];
+  }
+  return NULL;
+}
+
+/// @brief Return the lease of \p client on the register window of \p offset, or NULL if another client holds it.
+static Lease *acquire(Client *client, uint64_t offset) {
+  uint64_t window = offset / FLETCHER_INSTANCE_WINDOW_REGS;
+  Lease *lease = find_lease(window);
+  size_t i;
+  if (lease != NULL) {
+    if (lease->client == client) return lease;
+    lease->contended = 1;
+    return NULL;
+  }
+  for (i = 0; i < FLETCHERD_MAX_LEASES && leases[i].client != NULL; i++) {}
+  if (i == FLETCHERD_MAX_LEASES) return NULL;
+  lease = &leases[i];
+  memset(lease, 0, sizeof(*lease));
+  lease->client = client;
+  lease->window = window;
+  lease->last_usec = now_usec();
+  daemon_print("[FLETCHERD] Leased instance %lu to client %ld.\n", window, (long) (client - clients));
+  return lease;
+}
+
+/// @brief Release the leases that completed, once they are idle or contended.
+static void expire_leases(void) {
+  uint64_t now = now_usec();
+  size_t i;
+  for (i = 0; i < FLETCHERD_MAX_LEASES; i++) {
+    Lease *lease = &leases[i];
+    if (lease->client != NULL && lease->done
+        && (lease->contended || now - lease->last_usec >= options.lease_usec)) {
+      daemon_print("[FLETCHERD] Released instance %lu of client %ld.\n",
+                   lease->window,
+                   (long) (lease->client - clients));
+      lease->client = NULL;
+    }
+  }
+}
+
+/// @brief Return a pointer to \p size bytes at \p position of host buffer \p id of \p client, or NULL if out of range.
+static uint8_t *host_pointer(Client *client, uint64_t id, uint64_t position, uint64_t size) {
+  uint64_t staging_size = client->shm->size - FLETCHER_DAEMON_STAGING_OFFSET;
+  size_t i;
+  if (id == FLETCHER_DAEMON_STAGING) {
+    if (position > staging_size || size > staging_size - position) return NULL;
+    return (uint8_t *) client->shm + FLETCHER_DAEMON_STAGING_OFFSET + position;
+  }
+  for (i = 0; i < client->num_buffers; i++) {
+    if (client->buffers[i].id == id) {
+      if (position > client->buffers[i].size || size > client->buffers[i].size - position) return NULL;
+      return client->buffers[i].data + position;
+    }
+  }
+  return NULL;
+}
+
+/// @brief Remember that \p client allocated device memory at \p address. Returns zero on failure.
+static int track(Client *client, da_t address) {
+  da_t *grown = (da_t *) realloc(client->allocations, (client->num_allocations + 1) * sizeof(da_t));
+  if (grown == NULL) return 0;
+  client->allocations = grown;
+  client->allocations[client->num_allocations++] = address;
+  return 1;
+}
+
+/// @brief Forget the device memory of \p client at \p address. Returns zero if the client did not allocate it.
+static int untrack(Client *client, da_t address) {
+  size_t i;
+  for (i = 0; i < client->num_allocations; i++) {
+    if (client->allocations[i] == address) {
+      client->allocations[i] = client->allocations[--client->num_allocations];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/// @brief Execute \p command of \p client, and store its status and result in it.
+static void execute(Client *client, FletcherDaemonCommand *command) {
+  fstatus_t status = FLETCHER_STATUS_ERROR;
+  uint64_t reg = command->offset % FLETCHER_INSTANCE_WINDOW_REGS;
+  uint32_t value;
+  uint8_t *host;
+  da_t address;
+  Lease *lease;
+  int alloced;
+  switch (command->type) {
+    case FLETCHER_DAEMON_CMD_WRITE_MMIO:
+      // The caller acquired the lease.
+      lease = find_lease(command->offset / FLETCHER_INSTANCE_WINDOW_REGS);
+      status = device.platformWriteMMIO(command->offset, (uint32_t) command->value);
+      if (reg == FLETCHER_REG_CONTROL && (command->value & (1u << FLETCHER_REG_CONTROL_START))) {
+        lease->started = 1;
+        lease->done = 0;
+      }
+      lease->last_usec = now_usec();
+      break;
+    case FLETCHER_DAEMON_CMD_READ_MMIO:
+      status = device.platformReadMMIO(command->offset, &value);
+      command->value = value;
+      lease = find_lease(command->offset / FLETCHER_INSTANCE_WINDOW_REGS);
+      if (lease != NULL && lease->client == client) {
+        if (reg == FLETCHER_REG_STATUS && lease->started && (value & (1u << FLETCHER_REG_STATUS_DONE))) {
+          lease->done = 1;
+        }
+        lease->last_usec = now_usec();
+      }
+      break;
+    case FLETCHER_DAEMON_CMD_DEVICE_MALLOC:
+      status = device.platformDeviceMalloc(&address, (int64_t) command->size);
+      if (status == FLETCHER_STATUS_OK && !track(client, address)) {
+        device.platformDeviceFree(address);
+        status = FLETCHER_STATUS_ERROR;
+      }
+      command->value = address;
+      break;
+    case FLETCHER_DAEMON_CMD_DEVICE_FREE:
+      // Clients can only free their own device memory.
+      if (untrack(client, command->value)) {
+        status = device.platformDeviceFree(command->value);
+      }
+      break;
+    case FLETCHER_DAEMON_CMD_COPY_H2D:
+      host = host_pointer(client, command->buffer, command->position, command->size);
+      if (host != NULL) {
+        status = device.platformCopyHostToDevice(host, command->value, (int64_t) command->size);
+      }
+      break;
+    case FLETCHER_DAEMON_CMD_COPY_D2H:
+      host = host_pointer(client, command->buffer, command->position, command->size);
+      if (host != NULL) {
+        status = device.platformCopyDeviceToHost(command->value, host, (int64_t) command->size);
+      }
+      break;
+    case FLETCHER_DAEMON_CMD_PREPARE:
+      host = host_pointer(client, command->buffer, command->position, command->size);
+      if (host == NULL) break;
+      alloced = 0;
+      status = device.platformPrepareHostBuffer(host, &address, (int64_t) command->size, &alloced);
+      if (status == FLETCHER_STATUS_OK && alloced && !track(client, address)) {
+        device.platformDeviceFree(address);
+        status = FLETCHER_STATUS_ERROR;
+      }
+      command->value = address;
+      command->size = (uint64_t) alloced;
+      break;
+    default:
+      break;
+  }
+  command->status = (uint32_t) status;
+}
+
+/**
+ * @brief Execute the enqueued commands of \p client, up to FLETCHERD_BATCH.
+ *
+ * Stops at a write to a kernel instance that is leased to another client, which is retried in the next turn. Returns
+ * the number of executed commands.
+ */
+static int serve(Client *client) {
+  FletcherDaemonShm *shm = client->shm;
+  FletcherDaemonCommand command;
+  uint64_t head = __atomic_load_n(&shm->head, __ATOMIC_ACQUIRE);
+  uint64_t tail = shm->tail;
+  int executed = 0;
+  while (tail < head && executed < FLETCHERD_BATCH) {
+    // Work on a copy, such that the client cannot change the command while it is executed.
+    command = shm->ring[tail % FLETCHER_DAEMON_RING_SIZE];
+    if (command.type == FLETCHER_DAEMON_CMD_WRITE_MMIO && acquire(client, command.offset) == NULL) break;
+    execute(client, &command);
+    shm->ring[tail % FLETCHER_DAEMON_RING_SIZE] = command;
+    tail++;
+    executed++;
+    __atomic_store_n(&shm->tail, tail, __ATOMIC_RELEASE);
+  }
+  return executed;
+}
+
+/// @brief Release everything of \p client and close its connection.
+static void disconnect(Client *client) {
+  size_t i;
+  for (i = 0; i < FLETCHERD_MAX_LEASES; i++) {
+    if (leases[i].client == client) leases[i].client = NULL;
+  }
+  for (i = 0; i < client->num_allocations; i++) {
+    device.platformDeviceFree(client->allocations[i]);
+  }
+  for (i = 0; i < client->num_buffers; i++) {
+    munmap(client->buffers[i].data, client->buffers[i].size);
+  }
+  if (client->shm != NULL) {
+    munmap(client->shm, client->shm->size);
+  }
+  close(client->socket);
+  free(client->allocations);
+  free(client->buffers);
+  memset(client, 0, sizeof(*client));
+  client->socket = -1;
+  daemon_print("[FLETCHERD] Disconnected client %ld.\n", (long) (client - clients));
+}
+
+/// @brief Map the segment of \p client from \p fd.
+static fstatus_t connect_client(Client *client, int fd, uint64_t size) {
+  FletcherDaemonShm *shm;
+  if (client->shm != NULL || fd < 0 || size < FLETCHER_DAEMON_STAGING_OFFSET) return FLETCHER_STATUS_ERROR;
+  shm = (FletcherDaemonShm *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (shm == MAP_FAILED) return FLETCHER_STATUS_ERROR;
+  if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != FLETCHER_DAEMON_MAGIC || shm->size != size) {
+    munmap(shm, size);
+    return FLETCHER_STATUS_ERROR;
+  }
+  client->shm = shm;
+  daemon_print("[FLETCHERD] Connected client %ld.\n", (long) (client - clients));
+  return FLETCHER_STATUS_OK;
+}
+
+/// @brief Map host buffer \p fd of \p client, and prepare it on the device. Stores the result in \p message.
+static fstatus_t map_buffer(Client *client, int fd, FletcherDaemonMessage *message) {
+  Buffer *grown;
+  uint8_t *data;
+  da_t address;
+  int alloced = 0;
+  fstatus_t status;
+  if (client->shm == NULL || fd < 0 || message->size == 0) return FLETCHER_STATUS_ERROR;
+  grown = (Buffer *) realloc(client->buffers, (client->num_buffers + 1) * sizeof(Buffer));
+  if (grown == NULL) return FLETCHER_STATUS_ERROR;
+  client->buffers = grown;
+  data = (uint8_t *) mmap(NULL, message->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) return FLETCHER_STATUS_ERROR;
+  status = device.platformPrepareHostBuffer(data, &address, (int64_t) message->size, &alloced);
+  if (status == FLETCHER_STATUS_OK && alloced) {
+    // The device cannot access the buffer without a copy, so it would not be device-visible host memory.
+    device.platformDeviceFree(address);
+    status = FLETCHER_STATUS_ERROR;
+  }
+  if (status != FLETCHER_STATUS_OK) {
+    munmap(data, message->size);
+    return status;
+  }
+  client->buffers[client->num_buffers].id = ++client->next_id;
+  client->buffers[client->num_buffers].data = data;
+  client->buffers[client->num_buffers].size = message->size;
+  client->num_buffers++;
+  message->id = client->next_id;
+  message->address = address;
+  return FLETCHER_STATUS_OK;
+}
+
+/// @brief Unmap host buffer \p id of \p client.
+static fstatus_t unmap_buffer(Client *client, uint64_t id) {
+  size_t i;
+  for (i = 0; i < client->num_buffers; i++) {
+    if (client->buffers[i].id == id) {
+      munmap(client->buffers[i].data, client->buffers[i].size);
+      client->buffers[i] = client->buffers[--client->num_buffers];
+      return FLETCHER_STATUS_OK;
+    }
+  }
+  return FLETCHER_STATUS_ERROR;
+}
+
+/// @brief Receive and answer a message of \p client, or disconnect it if it closed the connection.
+static void handle_message(Client *client) {
+  FletcherDaemonMessage message;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  char control[CMSG_SPACE(sizeof(int))];
+  ssize_t received;
+  int fd = -1;
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base = &message;
+  iov.iov_len = sizeof(message);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  received = recvmsg(client->socket, &msg, MSG_CMSG_CLOEXEC);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  if (received != (ssize_t) sizeof(message)) {
+    if (fd >= 0) close(fd);
+    disconnect(client);
+    return;
+  }
+
+  switch (message.type) {
+    case FLETCHER_DAEMON_MSG_CONNECT: message.status = connect_client(client, fd, message.size);
+      break;
+    case FLETCHER_DAEMON_MSG_MAP: message.status = map_buffer(client, fd, &message);
+      break;
+    case FLETCHER_DAEMON_MSG_UNMAP: message.status = unmap_buffer(client, message.id);
+      break;
+    default: message.status = FLETCHER_STATUS_ERROR;
+  }
+  if (fd >= 0) close(fd);
+  if (send(client->socket, &message, sizeof(message), MSG_NOSIGNAL) != (ssize_t) sizeof(message)) {
+    disconnect(client);
+  }
+}
+
+/// @brief Accept new connections and handle the messages of all clients. Returns non-zero if there was any.
+static int poll_sockets(int listener) {
+  struct pollfd fds[FLETCHERD_MAX_CLIENTS + 1];
+  Client *owners[FLETCHERD_MAX_CLIENTS + 1];
+  nfds_t count = 1;
+  nfds_t i;
+  int fd;
+  fds[0].fd = listener;
+  fds[0].events = POLLIN;
+  for (i = 0; i < FLETCHERD_MAX_CLIENTS; i++) {
+    if (clients[i].socket >= 0) {
+      fds[count].fd = clients[i].socket;
+      fds[count].events = POLLIN;
+      owners[count] = &clients[i];
+      count++;
+    }
+  }
+  if (poll(fds, count, 0) <= 0) return 0;
+
+  if (fds[0].revents & POLLIN) {
+    fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+    if (fd >= 0) {
+      for (i = 0; i < FLETCHERD_MAX_CLIENTS && clients[i].socket >= 0; i++) {}
+      if (i == FLETCHERD_MAX_CLIENTS) {
+        fprintf(stderr, "[FLETCHERD] Refused a client: too many clients.\n");
+        close(fd);
+      } else {
+        clients[i].socket = fd;
+      }
+    }
+  }
+  for (i = 1; i < count; i++) {
+    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+      handle_message(owners[i]);
+    }
+  }
+  return 1;
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s -p <platform> [-s <socket>] [-d <device>] [-l <lease usec>] [-q]\n"
+          "  -p  Name of the platform of the device, e.g. aws, loaded from libfletcher_<platform>.so.\n"
+          "  -s  Path of the socket. Default: $FLETCHER_DAEMON_SOCKET or " FLETCHER_DAEMON_DEFAULT_SOCKET ".\n"
+          "  -d  Device to select, if the platform supports multiple devices.\n"
+          "  -l  Time in microseconds a client keeps a kernel instance after it completed.\n"
+          "  -q  Suppress all output.\n",
+          program);
+}
+
+int main(int argc, char **argv) {
+  struct sockaddr_un address;
+  struct sigaction action;
+  const char *env;
+  size_t next = 0;
+  size_t i;
+  int listener;
+  int active;
+  int opt;
+
+  options.socket_path = FLETCHER_DAEMON_DEFAULT_SOCKET;
+  options.device = -1;
+  options.lease_usec = FLETCHERD_DEFAULT_LEASE_USEC;
+  env = getenv("FLETCHER_DAEMON_SOCKET");
+  if (env != NULL) options.socket_path = env;
+  env = getenv("FLETCHER_DAEMON_LEASE_USEC");
+  if (env != NULL) options.lease_usec = strtoull(env, NULL, 0);
+  while ((opt = getopt(argc, argv, "p:s:d:l:q")) != -1) {
+    switch (opt) {
+      case 'p': options.platform = optarg;
+        break;
+      case 's': options.socket_path = optarg;
+        break;
+      case 'd': options.device = strtol(optarg, NULL, 0);
+        break;
+      case 'l': options.lease_usec = strtoull(optarg, NULL, 0);
+        break;
+      case 'q': options.quiet = 1;
+        break;
+      default: usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+  }
+  if (options.platform == NULL) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!load_platform(options.platform)) return EXIT_FAILURE;
+  if (device.platformInit(NULL) != FLETCHER_STATUS_OK) {
+    fprintf(stderr, "[FLETCHERD] Could not initialize platform %s.\n", options.platform);
+    return EXIT_FAILURE;
+  }
+  if (options.device >= 0) {
+    if (device.platformSetDevice == NULL
+        || device.platformSetDevice((uint64_t) options.device) != FLETCHER_STATUS_OK) {
+      fprintf(stderr, "[FLETCHERD] Could not select device %ld.\n", options.device);
+      device.platformTerminate(NULL);
+      return EXIT_FAILURE;
+    }
+  }
+
+  listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", options.socket_path);
+  unlink(options.socket_path);
+  if (listener < 0 || bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0
+      || listen(listener, FLETCHERD_MAX_CLIENTS) != 0) {
+    fprintf(stderr, "[FLETCHERD] Could not listen on %s: %s\n", options.socket_path, strerror(errno));
+    device.platformTerminate(NULL);
+    return EXIT_FAILURE;
+  }
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stop;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  for (i = 0; i < FLETCHERD_MAX_CLIENTS; i++) {
+    clients[i].socket = -1;
+  }
+  daemon_print("[FLETCHERD] Serving platform %s on %s.\n", options.platform, options.socket_path);
+
+  while (running) {
+    active = poll_sockets(listener);
+    expire_leases();
+    // Serve the clients round-robin, starting at a different client every turn.
+    for (i = 0; i < FLETCHERD_MAX_CLIENTS; i++) {
+      Client *client = &clients[(next + i) % FLETCHERD_MAX_CLIENTS];
+      if (client->shm != NULL) {
+        active |= serve(client);
+      }
+    }
+    next = (next + 1) % FLETCHERD_MAX_CLIENTS;
+    if (!active) backoff();
+  }
+
+  daemon_print("[FLETCHERD] Stopping.\n");
+  for (i = 0; i < FLETCHERD_MAX_CLIENTS; i++) {
+    if (clients[i].socket >= 0) disconnect(&clients[i]);
+  }
+  close(listener);
+  unlink(options.socket_path);
+  device.platformTerminate(NULL);
+  dlclose(device.handle);
+  return EXIT_SUCCESS;
+}
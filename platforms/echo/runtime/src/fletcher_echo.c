@@ -12,9 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <memory.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "fletcher/fletcher.h"
 
@@ -29,6 +32,116 @@
 
 InitOptions options = {0};
 
+/// State of the device model.
+typedef struct {
+  /// The values of the MMIO registers.
+  uint32_t regs[FLETCHER_ECHO_MODEL_REGS];
+  /// The time at which every instance was last started, in nanoseconds.
+  double start_ns[FLETCHER_ECHO_MODEL_INSTANCES];
+  /// The time at which every instance is done, in nanoseconds.
+  double done_ns[FLETCHER_ECHO_MODEL_INSTANCES];
+  /// Bytes copied to the device since the last kernel start.
+  double pending_bytes;
+} ModelState;
+
+static ModelState *model = NULL;
+
+/// The emulated device that this copy of the library operates on.
+static uint64_t device_index = 0;
+
+/// @brief Return a monotonic timestamp in nanoseconds.
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+/// @brief Override a model option from the environment, if set.
+static void env_option(const char *name, double *value) {
+  const char *str = getenv(name);
+  if (str != NULL) {
+    *value = strtod(str, NULL);
+  }
+}
+
+/// @brief Model a DMA transfer of \p size bytes by waiting for the modeled duration.
+static void model_dma(double size) {
+  double duration;
+  double end;
+  if (model == NULL) return;
+  model->pending_bytes += size;
+  duration = options.dma_latency_usec * 1e3;
+  if (options.dma_bytes_per_sec > 0) {
+    duration += size / options.dma_bytes_per_sec * 1e9;
+  }
+  // Spin rather than sleep, such that short transfers are modeled accurately.
+  end = now_ns() + duration;
+  while (now_ns() < end) {}
+}
+
+/// @brief Model a write to an MMIO register.
+static void model_write(uint64_t offset, uint32_t value) {
+  uint64_t instance;
+  double duration;
+  if (offset >= FLETCHER_ECHO_MODEL_REGS) return;
+  model->regs[offset] = value;
+  if (offset % FLETCHER_INSTANCE_WINDOW_REGS != FLETCHER_REG_CONTROL) return;
+  instance = offset / FLETCHER_INSTANCE_WINDOW_REGS;
+  if (value & (1u << FLETCHER_REG_CONTROL_RESET)) {
+    model->done_ns[instance] = 0;
+  } else if (value & (1u << FLETCHER_REG_CONTROL_START)) {
+    duration = options.kernel_latency_usec * 1e3;
+    if (options.kernel_bytes_per_sec > 0) {
+      duration += model->pending_bytes / options.kernel_bytes_per_sec * 1e9;
+    }
+    model->start_ns[instance] = now_ns();
+    model->done_ns[instance] = model->start_ns[instance] + duration;
+    model->pending_bytes = 0;
+    if (options.kernel != NULL) {
+      options.kernel(&model->regs[instance * FLETCHER_INSTANCE_WINDOW_REGS], instance, options.kernel_data);
+      // The modeled duration counts from the start, so a slow functional model does not add to it.
+      if (now_ns() > model->done_ns[instance]) {
+        model->done_ns[instance] = now_ns();
+      }
+    }
+  } else if (value & (1u << FLETCHER_REG_CONTROL_STOP)) {
+    // A stopped kernel unwinds right away.
+    if (now_ns() < model->done_ns[instance]) {
+      model->done_ns[instance] = now_ns();
+    }
+  }
+}
+
+/// @brief Return the modeled kernel clock cycles of the last run of an instance, until now or until it was done.
+static uint64_t model_cycles(uint64_t instance) {
+  double now = now_ns();
+  double end = now < model->done_ns[instance] ? now : model->done_ns[instance];
+  return (uint64_t) ((end - model->start_ns[instance]) * 1e-9 * FLETCHER_ECHO_MODEL_CLOCK_HZ);
+}
+
+/// @brief Model a read of an MMIO register.
+static uint32_t model_read(uint64_t offset) {
+  uint64_t instance;
+  uint64_t reg;
+  if (offset >= FLETCHER_ECHO_MODEL_REGS) return 0;
+  instance = offset / FLETCHER_INSTANCE_WINDOW_REGS;
+  reg = offset % FLETCHER_INSTANCE_WINDOW_REGS;
+  switch (reg) {
+    case FLETCHER_REG_STATUS:
+      if (model->done_ns[instance] == 0) return 1u << FLETCHER_REG_STATUS_IDLE;
+      return (now_ns() >= model->done_ns[instance]) ? (1u << FLETCHER_REG_STATUS_DONE)
+                                                     : (1u << FLETCHER_REG_STATUS_BUSY);
+    case FLETCHER_REG_CYCLES:
+      return model->done_ns[instance] == 0 ? 0 : (uint32_t) model_cycles(instance);
+    case FLETCHER_REG_CYCLES + 1:
+      return model->done_ns[instance] == 0 ? 0 : (uint32_t) (model_cycles(instance) >> 32);
+    case FLETCHER_REG_CLOCK_HZ:
+      return FLETCHER_ECHO_MODEL_CLOCK_HZ;
+    default:
+      return model->regs[offset];
+  }
+}
+
 fstatus_t platformGetName(char *name, size_t size) {
   size_t len = strlen(FLETCHER_PLATFORM_NAME);
   if (len > size) {
@@ -41,21 +154,85 @@ fstatus_t platformGetName(char *name, size_t size) {
 }
 
 fstatus_t platformInit(void *arg) {
-  if (arg != NULL) {
-    options = *(InitOptions *) arg;
+  double enable = 0;
+  InitOptions defaults = {0};
+  // Start from the defaults, such that the options of an earlier initialization do not persist.
+  options = (arg != NULL) ? *(InitOptions *) arg : defaults;
+  enable = options.model;
+  env_option("FLETCHER_ECHO_MODEL", &enable);
+  env_option("FLETCHER_ECHO_KERNEL_BYTES_PER_SEC", &options.kernel_bytes_per_sec);
+  env_option("FLETCHER_ECHO_KERNEL_LATENCY_USEC", &options.kernel_latency_usec);
+  env_option("FLETCHER_ECHO_DMA_BYTES_PER_SEC", &options.dma_bytes_per_sec);
+  env_option("FLETCHER_ECHO_DMA_LATENCY_USEC", &options.dma_latency_usec);
+  options.model = (enable != 0) || (options.kernel != NULL);
+  echo_print("[ECHO] Initializing platform.       Arguments @ [host] %016lX, device %lu.\n",
+             (unsigned long) arg,
+             (unsigned long) device_index);
+  if (options.model) {
+    options.quiet = 1;
+    if (model == NULL) {
+      model = (ModelState *) calloc(1, sizeof(ModelState));
+      if (model == NULL) {
+        return FLETCHER_STATUS_ERROR;
+      }
+    }
   }
-  echo_print("[ECHO] Initializing platform.       Arguments @ [host] %016lX.\n", (unsigned long) arg);
   return FLETCHER_STATUS_OK;
 }
 
 fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value) {
+  if (model != NULL) {
+    model_write(offset, value);
+    return FLETCHER_STATUS_OK;
+  }
   echo_print("[ECHO] Wrote MMIO register.       %04lu <= 0x%08X\n", offset, value);
   return FLETCHER_STATUS_OK;
 }
 
+fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count) {
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    if (model != NULL) {
+      model_write(offset + i, values[i]);
+    }
+    echo_print("[ECHO] Wrote MMIO register.       %04lu <= 0x%08X (batch)\n", offset + i, values[i]);
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformWriteMMIO64(uint64_t offset, uint64_t value) {
+  if (model != NULL) {
+    model_write(offset, (uint32_t) value);
+    model_write(offset + 1, (uint32_t) (value >> 32));
+    return FLETCHER_STATUS_OK;
+  }
+  echo_print("[ECHO] Wrote MMIO register pair.  %04lu <= 0x%016lX\n", offset, (unsigned long) value);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformReadMMIO64(uint64_t offset, uint64_t *value) {
+  uint32_t lo, hi;
+  fstatus_t status;
+  if (model != NULL) {
+    *value = model_read(offset) | ((uint64_t) model_read(offset + 1) << 32);
+    return FLETCHER_STATUS_OK;
+  }
+  status = platformReadMMIO(offset, &lo);
+  if (status != FLETCHER_STATUS_OK) {
+    return status;
+  }
+  status = platformReadMMIO(offset + 1, &hi);
+  *value = lo | ((uint64_t) hi << 32);
+  return status;
+}
+
 fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value) {
   char buffer[256];
   unsigned long val = 0;
+  if (model != NULL) {
+    *value = model_read(offset);
+    return FLETCHER_STATUS_OK;
+  }
   printf("[ECHO] Enter the value for MMIO register at offset %lu: 0x", offset);
   fgets(buffer, 256, stdin);
   val = strtoul(buffer, NULL, 16);
@@ -66,6 +243,7 @@ fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value) {
 
 fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size) {
   memcpy((void *) device_destination, host_source, size);
+  model_dma((double) size);
   echo_print("[ECHO] Copied from host to device.  [host] 0x%016lX --> [dev] 0x%016lX (%ld bytes)\n",
              (uint64_t) host_source,
              device_destination,
@@ -73,8 +251,31 @@ fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_desti
   return FLETCHER_STATUS_OK;
 }
 
+fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count) {
+  uint64_t i;
+  double total = 0;
+  for (i = 0; i < count; i++) {
+    memcpy((void *) iov[i].device_address, iov[i].host_address, iov[i].size);
+    total += (double) iov[i].size;
+    echo_print("[ECHO] Copied from host to device.  [host] 0x%016lX --> [dev] 0x%016lX (%ld bytes) (vectored)\n",
+               (uint64_t) iov[i].host_address,
+               iov[i].device_address,
+               (int64_t) iov[i].size);
+  }
+  // A vectored copy is modeled as a single transfer.
+  model_dma(total);
+  return FLETCHER_STATUS_OK;
+}
+
 fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination, int64_t size) {
+  double pending;
   memcpy(host_destination, (void *) device_source, size);
+  if (model != NULL) {
+    // Copies back to the host are not processed by the kernel.
+    pending = model->pending_bytes;
+    model_dma((double) size);
+    model->pending_bytes = pending;
+  }
   echo_print("[ECHO] Copied from device to host.  [dev] 0x%016lX --> [host] 0x%016lX (%ld bytes)\n",
              device_source,
              (uint64_t) host_destination,
@@ -84,6 +285,8 @@ fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination
 
 fstatus_t platformTerminate(void *arg) {
   echo_print("[ECHO] Terminating platform.        Arguments @ [host] 0x%016lX.\n", (uint64_t) arg);
+  free(model);
+  model = NULL;
   return FLETCHER_STATUS_OK;
 }
 
@@ -96,6 +299,39 @@ fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size) {
   return FLETCHER_STATUS_OK;
 }
 
+fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size) {
+  // On the echo platform, the device accesses host memory directly. Align to huge pages.
+  if (posix_memalign((void **) host_address, FLETCHER_ECHO_HOST_ALIGNMENT, (size_t) size) != 0) {
+    return FLETCHER_STATUS_DEVICE_OUT_OF_MEMORY;
+  }
+  *device_address = (da_t) *host_address;
+  echo_print("[ECHO] Allocating device-visible host memory. [host] 0x%016lX (%10lu bytes).\n",
+             (uint64_t) *host_address,
+             size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformHostFree(uint8_t *host_address) {
+  echo_print("[ECHO] Freeing device-visible host memory.    [host] 0x%016lX.\n", (uint64_t) host_address);
+  free(host_address);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformDeviceMap(da_t device_address, int64_t size, uint8_t **host_address) {
+  // On the echo platform, "device" memory is host memory.
+  *host_address = (uint8_t *) device_address;
+  echo_print("[ECHO] Mapping device memory.       [device] 0x%016lX --> 0x%016lX (%10lu bytes).\n",
+             device_address,
+             (uint64_t) *host_address,
+             size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformDeviceUnmap(uint8_t *host_address, int64_t size) {
+  echo_print("[ECHO] Unmapping device memory.       [host] 0x%016lX (%10lu bytes).\n", (uint64_t) host_address, size);
+  return FLETCHER_STATUS_OK;
+}
+
 fstatus_t platformDeviceFree(da_t device_address) {
   free((void *) device_address);
   echo_print("[ECHO] Freeing device memory.       [device] 0x%016lX.\n", device_address);
@@ -139,3 +375,37 @@ fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_desti
 
   return status;
 }
+
+fstatus_t platformLoadImage(const char *path, uint64_t region) {
+  if (region >= FLETCHER_ECHO_MODEL_INSTANCES) {
+    return FLETCHER_STATUS_ERROR;
+  }
+  if (model != NULL) {
+    memset(&model->regs[region * FLETCHER_INSTANCE_WINDOW_REGS], 0, FLETCHER_INSTANCE_WINDOW_REGS * sizeof(uint32_t));
+    model->done_ns[region] = 0;
+  }
+  echo_print("[ECHO] Loaded image.                [region] %lu <-- %s\n", (unsigned long) region, path);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformGetDeviceCount(uint64_t *count) {
+  double devices = 1;
+  env_option("FLETCHER_ECHO_DEVICES", &devices);
+  if (devices < 1) {
+    return FLETCHER_STATUS_ERROR;
+  }
+  *count = (uint64_t) devices;
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformSetDevice(uint64_t device) {
+  device_index = device;
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformGetNumaNode(int64_t *node) {
+  double value = -1;
+  env_option("FLETCHER_ECHO_NUMA_NODE", &value);
+  *node = (int64_t) value;
+  return FLETCHER_STATUS_OK;
+}
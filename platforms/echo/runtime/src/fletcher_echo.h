@@ -22,9 +22,67 @@
 /// Alignment for allocations.
 #define FLETCHER_ECHO_ALIGNMENT 4096
 
-/// Platform options.
+/// Alignment for device-visible host memory allocations, i.e. the size of a huge page.
+#define FLETCHER_ECHO_HOST_ALIGNMENT (2 * 1024 * 1024)
+
+/// Number of MMIO registers that are modeled.
+#define FLETCHER_ECHO_MODEL_REGS (1u << 16)
+
+/// Number of kernel instances that are modeled, each with a register window of FLETCHER_INSTANCE_WINDOW_REGS.
+#define FLETCHER_ECHO_MODEL_INSTANCES (FLETCHER_ECHO_MODEL_REGS / FLETCHER_INSTANCE_WINDOW_REGS)
+
+/// Kernel clock frequency of the modeled device in Hz, reported in the clock frequency register.
+#define FLETCHER_ECHO_MODEL_CLOCK_HZ 250000000u
+
+/**
+ * @brief A functional model of a kernel, that runs on the host when a kernel instance is started.
+ *
+ * The register window of the instance holds the values written by the run-time, i.e. the RecordBatch ranges and the
+ * device addresses of the Arrow buffers written by Kernel::WriteMetaData(). On the echo platform, device addresses are
+ * host addresses, so the model accesses the buffers directly. The model writes its results to the return registers.
+ *
+ * @param regs      The register window of the instance, of FLETCHER_INSTANCE_WINDOW_REGS registers.
+ * @param instance  The index of the instance.
+ * @param user_data The kernel_data of the InitOptions.
+ */
+typedef void (*EchoKernel)(uint32_t *regs, uint64_t instance, void *user_data);
+
+/**
+ * @brief Platform options.
+ *
+ * The model options can also be set through the environment, which is useful when the platform is autodetected:
+ * FLETCHER_ECHO_MODEL, FLETCHER_ECHO_KERNEL_BYTES_PER_SEC, FLETCHER_ECHO_KERNEL_LATENCY_USEC,
+ * FLETCHER_ECHO_DMA_BYTES_PER_SEC and FLETCHER_ECHO_DMA_LATENCY_USEC.
+ */
 typedef struct {
+  /// Non-zero to suppress all output.
   int quiet;
+  /**
+   * Non-zero to model the timing of a device instead of reading MMIO values from stdin. Implies quiet.
+   *
+   * MMIO registers are stored. Starting a kernel marks it busy until it has processed all bytes copied to the device
+   * since it was last started, at the kernel rate. Copies between host and device take the DMA latency plus the time
+   * to transfer the bytes at the DMA bandwidth. The execution cycles register counts the cycles of the modeled kernel
+   * clock since the last start, until the kernel is done.
+   */
+  int model;
+  /// Modeled kernel processing rate, in bytes per second. Zero means infinitely fast.
+  double kernel_bytes_per_sec;
+  /// Modeled time between starting a kernel and its first possible completion, in microseconds.
+  double kernel_latency_usec;
+  /// Modeled DMA bandwidth, in bytes per second. Zero means infinitely fast.
+  double dma_bytes_per_sec;
+  /// Modeled DMA latency of every transfer, in microseconds.
+  double dma_latency_usec;
+  /**
+   * Functional model of the kernel, or a null pointer. Implies model.
+   *
+   * Starting a kernel instance calls the function before the start returns. The instance is done when the function
+   * has returned and the modeled kernel duration has passed.
+   */
+  EchoKernel kernel;
+  /// User data passed to the functional model of the kernel.
+  void *kernel_data;
 } InitOptions;
 
 /// @brief Store the platform name in a buffer of size /p size pointed to by /p name.
@@ -37,12 +95,24 @@ fstatus_t platformInit(void *arg);
 /// @brief Write \p value to MMIO register \p offset.
 fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value);
 
+/// @brief Write \p count consecutive MMIO registers starting at \p offset from \p values.
+fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count);
+
 /// @brief Read MMIO register \p offset into \p value. For the Echo platform, the value is taken from stdin.
 fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value);
 
+/// @brief Write \p value to the MMIO registers \p offset (lower bits) and \p offset + 1 (upper bits).
+fstatus_t platformWriteMMIO64(uint64_t offset, uint64_t value);
+
+/// @brief Read the MMIO registers \p offset (lower bits) and \p offset + 1 (upper bits) into \p value.
+fstatus_t platformReadMMIO64(uint64_t offset, uint64_t *value);
+
 /// @brief Copy \p size bytes from host address \p host_source to device address \p device_destination.
 fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size);
 
+/// @brief Copy \p count regions described by \p iov from host to device.
+fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count);
+
 /// @brief Copy \p size bytes from device address \p device_source to host address \p host_destination.
 fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination, int64_t size);
 
@@ -57,6 +127,26 @@ fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size);
 /// @brief Free the memory allocated at \p device_address.
 fstatus_t platformDeviceFree(da_t device_address);
 
+/**
+ * @brief Allocate \p size bytes of host memory that the device can access directly.
+ *
+ * For the Echo platform, the device address is the host address.
+ */
+fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size);
+
+/// @brief Free device-visible host memory allocated at \p host_address.
+fstatus_t platformHostFree(uint8_t *host_address);
+
+/**
+ * @brief Map \p size bytes of device memory at \p device_address into the address space of the host.
+ *
+ * For the Echo platform, the host address is the device address.
+ */
+fstatus_t platformDeviceMap(da_t device_address, int64_t size, uint8_t **host_address);
+
+/// @brief Unmap device memory mapped at \p host_address.
+fstatus_t platformDeviceUnmap(uint8_t *host_address, int64_t size);
+
 /**
  * @brief Ensure the device can read \p size bytes from a host buffer at \p host_source.
  *
@@ -93,6 +183,23 @@ fstatus_t platformPrepareHostBuffer(const uint8_t *host_source, da_t *device_des
  */
 fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size);
 
+/**
+ * @brief Program reconfigurable region \p region with the image at \p path.
+ *
+ * For the Echo platform, no file is read. When the device is modeled, the registers of the kernel instance of the
+ * region are cleared, like they would be by a newly programmed image.
+ */
+fstatus_t platformLoadImage(const char *path, uint64_t region);
+
+/// @brief Store the number of emulated devices in \p count. Set through FLETCHER_ECHO_DEVICES, one by default.
+fstatus_t platformGetDeviceCount(uint64_t *count);
+
+/// @brief Select the emulated device \p device.
+fstatus_t platformSetDevice(uint64_t device);
+
+/// @brief Store the NUMA node of the emulated device in \p node. Set through FLETCHER_ECHO_NUMA_NODE, -1 by default.
+fstatus_t platformGetNumaNode(int64_t *node);
+
 /**
  * @brief Terminate the platform.
  *
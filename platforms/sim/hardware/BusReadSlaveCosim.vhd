@@ -0,0 +1,151 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.UtilStr_pkg.all;
+use work.SimBridge_pkg.all;
+
+-- This simulation-only unit is a bus slave that responds with the contents of
+-- the device memory of a host application that uses the sim platform, read
+-- through the co-simulation bridge. It answers one request at a time.
+
+entity BusReadSlaveCosim is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 64;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width. Must be a multiple of 32.
+    BUS_DATA_WIDTH              : natural := 512;
+
+    -- Number of cycles between accepting a request and returning its first
+    -- word.
+    LATENCY                     : natural := 0
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    clk                         : in  std_logic;
+    reset                       : in  std_logic;
+
+    -- Bus interface.
+    rreq_valid                  : in  std_logic;
+    rreq_ready                  : out std_logic;
+    rreq_addr                   : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    rreq_len                    : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    rdat_valid                  : out std_logic;
+    rdat_ready                  : in  std_logic;
+    rdat_data                   : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    rdat_last                   : out std_logic;
+
+    -- Print the number of returned words on a rising edge.
+    print_stats                 : in  std_logic := '0'
+
+  );
+end BusReadSlaveCosim;
+
+architecture Behavioral of BusReadSlaveCosim is
+
+  -- Number of words returned since reset.
+  signal words                  : natural := 0;
+
+begin
+
+  process is
+    variable len    : natural;
+    variable addr   : unsigned(63 downto 0);
+    variable word   : unsigned(63 downto 0);
+    variable data   : std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+  begin
+    words <= 0;
+
+    state: loop
+
+      -- Reset state.
+      rreq_ready <= '0';
+      rdat_valid <= '0';
+      rdat_last <= '0';
+
+      -- Wait for request valid.
+      loop
+        wait until rising_edge(clk);
+        exit state when reset = '1';
+        exit when rreq_valid = '1';
+      end loop;
+
+      addr := resize(unsigned(rreq_addr), 64);
+      len := to_integer(unsigned(rreq_len));
+
+      -- Accept the request.
+      rreq_ready <= '1';
+      wait until rising_edge(clk);
+      exit state when reset = '1';
+      rreq_ready <= '0';
+
+      -- Delay the response.
+      for i in 1 to LATENCY loop
+        wait until rising_edge(clk);
+        exit state when reset = '1';
+      end loop;
+
+      for i in 0 to len-1 loop
+
+        -- Read the word from the device memory.
+        for j in 0 to BUS_DATA_WIDTH/32-1 loop
+          word := addr + 4 * j;
+          data(32*j+31 downto 32*j) := std_logic_vector(to_signed(cosim_read32(
+            to_integer(signed(word(63 downto 32))),
+            to_integer(signed(word(31 downto 0)))), 32));
+        end loop;
+
+        -- Assert response.
+        rdat_valid <= '1';
+        rdat_data <= data;
+        if i = len-1 then
+          rdat_last <= '1';
+        else
+          rdat_last <= '0';
+        end if;
+
+        -- Wait for response ready.
+        loop
+          wait until rising_edge(clk);
+          exit state when reset = '1';
+          exit when rdat_ready = '1';
+        end loop;
+        words <= words + 1;
+
+        addr := addr + (BUS_DATA_WIDTH / 8);
+
+      end loop;
+      rdat_valid <= '0';
+
+    end loop;
+  end process;
+
+  stats_proc: process is
+  begin
+    wait until rising_edge(print_stats);
+    println(BusReadSlaveCosim'path_name & ": " & integer'image(words) & " words.");
+  end process;
+
+end Behavioral;
@@ -0,0 +1,168 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+library work;
+use work.UtilStr_pkg.all;
+use work.SimBridge_pkg.all;
+
+-- This simulation-only unit is a bus slave that writes to the device memory of
+-- a host application that uses the sim platform, through the co-simulation
+-- bridge. It handles one request at a time.
+
+entity BusWriteSlaveCosim is
+  generic (
+
+    -- Bus address width.
+    BUS_ADDR_WIDTH              : natural := 64;
+
+    -- Bus burst length width.
+    BUS_LEN_WIDTH               : natural := 8;
+
+    -- Bus data width. Must be a multiple of 32.
+    BUS_DATA_WIDTH              : natural := 512;
+
+    -- Number of cycles between accepting the last word of a request and
+    -- returning its write response.
+    LATENCY                     : natural := 0
+
+  );
+  port (
+
+    -- Rising-edge sensitive clock and active-high synchronous reset.
+    clk                         : in  std_logic;
+    reset                       : in  std_logic;
+
+    -- Bus interface.
+    wreq_valid                  : in  std_logic;
+    wreq_ready                  : out std_logic;
+    wreq_addr                   : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+    wreq_len                    : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+    wreq_last                   : in  std_logic;
+    wdat_valid                  : in  std_logic;
+    wdat_ready                  : out std_logic;
+    wdat_data                   : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+    wdat_strobe                 : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+    wdat_last                   : in  std_logic;
+    wrep_valid                  : out std_logic;
+    wrep_ready                  : in  std_logic;
+    wrep_ok                     : out std_logic;
+
+    -- Print the number of accepted words on a rising edge.
+    print_stats                 : in  std_logic := '0'
+
+  );
+end BusWriteSlaveCosim;
+
+architecture Behavioral of BusWriteSlaveCosim is
+
+  -- Number of words accepted since reset.
+  signal words                  : natural := 0;
+
+begin
+
+  process is
+    variable len    : natural;
+    variable addr   : unsigned(63 downto 0);
+    variable word   : unsigned(63 downto 0);
+  begin
+    words <= 0;
+
+    state: loop
+
+      -- Reset state.
+      wreq_ready <= '0';
+      wdat_ready <= '0';
+      wrep_valid <= '0';
+
+      -- Wait for request valid.
+      loop
+        wait until rising_edge(clk);
+        exit state when reset = '1';
+        exit when wreq_valid = '1';
+      end loop;
+
+      addr := resize(unsigned(wreq_addr), 64);
+      len := to_integer(unsigned(wreq_len));
+
+      -- Accept the request.
+      wreq_ready <= '1';
+      wait until rising_edge(clk);
+      exit state when reset = '1';
+      wreq_ready <= '0';
+
+      for i in 0 to len-1 loop
+
+        -- Accept the incoming data.
+        wdat_ready <= '1';
+        loop
+          wait until rising_edge(clk);
+          exit state when reset = '1';
+          exit when wdat_valid = '1';
+        end loop;
+        words <= words + 1;
+
+        -- Write the enabled bytes to the device memory.
+        for j in 0 to BUS_DATA_WIDTH/32-1 loop
+          word := addr + 4 * j;
+          cosim_write32(
+            to_integer(signed(word(63 downto 32))),
+            to_integer(signed(word(31 downto 0))),
+            to_integer(signed(wdat_data(32*j+31 downto 32*j))),
+            to_integer(unsigned(wdat_strobe(4*j+3 downto 4*j))));
+        end loop;
+
+        -- Check the last signal.
+        if i = len-1 then
+          assert wdat_last = '1'
+            report "Last was not asserted."
+            severity failure;
+        end if;
+
+        addr := addr + (BUS_DATA_WIDTH / 8);
+
+      end loop;
+
+      -- Stop accepting data.
+      wdat_ready <= '0';
+
+      -- Delay the response.
+      for i in 1 to LATENCY loop
+        wait until rising_edge(clk);
+        exit state when reset = '1';
+      end loop;
+
+      -- Send response.
+      wrep_valid <= '1';
+      wrep_ok <= '1';
+      loop
+        wait until rising_edge(clk);
+        exit state when reset = '1';
+        exit when wrep_ready = '1';
+      end loop;
+      wrep_valid <= '0';
+
+    end loop;
+  end process;
+
+  stats_proc: process is
+  begin
+    wait until rising_edge(print_stats);
+    println(BusWriteSlaveCosim'path_name & ": " & integer'image(words) & " words.");
+  end process;
+
+end Behavioral;
@@ -0,0 +1,150 @@
+-- Copyright 2018 Delft University of Technology
+--
+-- Licensed under the Apache License, Version 2.0 (the "License");
+-- you may not use this file except in compliance with the License.
+-- You may obtain a copy of the License at
+--
+--     http://www.apache.org/licenses/LICENSE-2.0
+--
+-- Unless required by applicable law or agreed to in writing, software
+-- distributed under the License is distributed on an "AS IS" BASIS,
+-- WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+-- See the License for the specific language governing permissions and
+-- limitations under the License.
+
+library ieee;
+use ieee.std_logic_1164.all;
+
+-- This simulation-only package declares the foreign subprograms of the
+-- co-simulation bridge (fletcher_sim_bridge.c), through which a host
+-- application that uses the sim platform drives the simulation, and the
+-- memory models that access the device memory of the host application.
+
+package SimBridge_pkg is
+
+  -- Command types returned by cosim_poll. These must match the
+  -- FLETCHER_SIM_CMD_* values of fletcher_sim_shm.h.
+  constant COSIM_NONE           : integer := 0;
+  constant COSIM_WRITE_MMIO     : integer := 1;
+  constant COSIM_READ_MMIO      : integer := 2;
+  constant COSIM_TERMINATE      : integer := 3;
+
+  -- Returns the type of the next command of the host application, or
+  -- COSIM_NONE if there is none. Waits for the host application on the first
+  -- call.
+  impure function cosim_poll return integer;
+  attribute foreign of cosim_poll : function is "VHPIDIRECT cosim_poll";
+
+  -- Returns the MMIO register offset of the current command.
+  impure function cosim_offset return integer;
+  attribute foreign of cosim_offset : function is "VHPIDIRECT cosim_offset";
+
+  -- Returns the value to write of the current command.
+  impure function cosim_value return integer;
+  attribute foreign of cosim_value : function is "VHPIDIRECT cosim_value";
+
+  -- Completes the current command, returning value to the host application.
+  procedure cosim_complete(value : integer);
+  attribute foreign of cosim_complete : procedure is "VHPIDIRECT cosim_complete";
+
+  -- Returns the 32-bit little-endian word of device memory at the address of
+  -- which hi and lo are the upper and lower 32 bits.
+  impure function cosim_read32(hi : integer; lo : integer) return integer;
+  attribute foreign of cosim_read32 : function is "VHPIDIRECT cosim_read32";
+
+  -- Writes the bytes of the 32-bit little-endian word value of which the bit
+  -- in strobe is set to device memory.
+  procedure cosim_write32(hi : integer; lo : integer; value : integer; strobe : integer);
+  attribute foreign of cosim_write32 : procedure is "VHPIDIRECT cosim_write32";
+
+  component BusReadSlaveCosim is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 64;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 512;
+      LATENCY                   : natural := 0
+    );
+    port (
+      clk                       : in  std_logic;
+      reset                     : in  std_logic;
+      rreq_valid                : in  std_logic;
+      rreq_ready                : out std_logic;
+      rreq_addr                 : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      rreq_len                  : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      rdat_valid                : out std_logic;
+      rdat_ready                : in  std_logic;
+      rdat_data                 : out std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      rdat_last                 : out std_logic;
+      print_stats               : in  std_logic := '0'
+    );
+  end component;
+
+  component BusWriteSlaveCosim is
+    generic (
+      BUS_ADDR_WIDTH            : natural := 64;
+      BUS_LEN_WIDTH             : natural := 8;
+      BUS_DATA_WIDTH            : natural := 512;
+      LATENCY                   : natural := 0
+    );
+    port (
+      clk                       : in  std_logic;
+      reset                     : in  std_logic;
+      wreq_valid                : in  std_logic;
+      wreq_ready                : out std_logic;
+      wreq_addr                 : in  std_logic_vector(BUS_ADDR_WIDTH-1 downto 0);
+      wreq_len                  : in  std_logic_vector(BUS_LEN_WIDTH-1 downto 0);
+      wreq_last                 : in  std_logic;
+      wdat_valid                : in  std_logic;
+      wdat_ready                : out std_logic;
+      wdat_data                 : in  std_logic_vector(BUS_DATA_WIDTH-1 downto 0);
+      wdat_strobe               : in  std_logic_vector(BUS_DATA_WIDTH/8-1 downto 0);
+      wdat_last                 : in  std_logic;
+      wrep_valid                : out std_logic;
+      wrep_ready                : in  std_logic;
+      wrep_ok                   : out std_logic;
+      print_stats               : in  std_logic := '0'
+    );
+  end component;
+
+end SimBridge_pkg;
+
+package body SimBridge_pkg is
+
+  -- The bodies below are only executed when the simulation is elaborated
+  -- without the bridge.
+
+  impure function cosim_poll return integer is
+  begin
+    report "The co-simulation bridge is not linked into the simulation." severity failure;
+    return COSIM_NONE;
+  end function;
+
+  impure function cosim_offset return integer is
+  begin
+    report "The co-simulation bridge is not linked into the simulation." severity failure;
+    return 0;
+  end function;
+
+  impure function cosim_value return integer is
+  begin
+    report "The co-simulation bridge is not linked into the simulation." severity failure;
+    return 0;
+  end function;
+
+  procedure cosim_complete(value : integer) is
+  begin
+    report "The co-simulation bridge is not linked into the simulation." severity failure;
+  end procedure;
+
+  impure function cosim_read32(hi : integer; lo : integer) return integer is
+  begin
+    report "The co-simulation bridge is not linked into the simulation." severity failure;
+    return 0;
+  end function;
+
+  procedure cosim_write32(hi : integer; lo : integer; value : integer; strobe : integer) is
+  begin
+    report "The co-simulation bridge is not linked into the simulation." severity failure;
+  end procedure;
+
+end SimBridge_pkg;
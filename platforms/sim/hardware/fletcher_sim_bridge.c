@@ -0,0 +1,122 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Co-simulation bridge between the sim platform and the simulation top level. The functions below implement the
+// foreign subprograms of SimBridge_pkg through GHDL's VHPIDIRECT interface, and must be linked into the simulation,
+// e.g.: ghdl -e -Wl,fletcher_sim_bridge.c -Wl,-lrt SimTop_tc
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../runtime/src/fletcher_sim_shm.h"
+
+/// The shared memory segment of the host application, or NULL if not attached yet.
+static FletcherSimShm *shm = NULL;
+/// The device memory in the shared memory segment.
+static uint8_t *memory = NULL;
+/// Size of the device memory in bytes.
+static uint64_t memory_bytes = 0;
+/// The command that is being executed.
+static FletcherSimCommand *current = NULL;
+
+/// @brief Attach to the shared memory segment of the host application, waiting until it is created.
+static void attach(void) {
+  const char *name = getenv("FLETCHER_SIM_SHM");
+  struct timespec ts = {0, 10000000};
+  struct stat st;
+  int fd = -1;
+  if (shm != NULL) return;
+  if (name == NULL) name = FLETCHER_SIM_DEFAULT_SHM;
+  fprintf(stdout, "[SIM] Waiting for host application on shared memory segment %s.\n", name);
+  fflush(stdout);
+  for (;;) {
+    if (fd < 0) fd = shm_open(name, O_RDWR, 0);
+    if (fd >= 0 && fstat(fd, &st) == 0 && (uint64_t) st.st_size > FLETCHER_SIM_MEMORY_OFFSET) break;
+    nanosleep(&ts, NULL);
+  }
+  shm = (FletcherSimShm *) mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shm == MAP_FAILED) {
+    fprintf(stderr, "[SIM] Could not map shared memory segment %s.\n", name);
+    exit(EXIT_FAILURE);
+  }
+  while (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != FLETCHER_SIM_MAGIC) {
+    nanosleep(&ts, NULL);
+  }
+  memory = (uint8_t *) shm + FLETCHER_SIM_MEMORY_OFFSET;
+  memory_bytes = shm->size - FLETCHER_SIM_MEMORY_OFFSET;
+  __atomic_store_n(&shm->attached, 1, __ATOMIC_RELEASE);
+}
+
+/// @brief Return a pointer to the 4 bytes of device memory at the address made of \p hi and \p lo, or NULL.
+static uint8_t *device_pointer(int hi, int lo) {
+  uint64_t address = ((uint64_t) (uint32_t) hi << 32u) | (uint32_t) lo;
+  attach();
+  if (address < FLETCHER_SIM_DEVICE_BASE || address - FLETCHER_SIM_DEVICE_BASE + 4 > memory_bytes) {
+    fprintf(stderr, "[SIM] Access to device address 0x%016lX outside of device memory.\n", (unsigned long) address);
+    return NULL;
+  }
+  return memory + (address - FLETCHER_SIM_DEVICE_BASE);
+}
+
+int cosim_poll(void) {
+  uint64_t tail;
+  attach();
+  tail = shm->tail;
+  if (__atomic_load_n(&shm->head, __ATOMIC_ACQUIRE) == tail) {
+    return FLETCHER_SIM_CMD_NONE;
+  }
+  current = &shm->ring[tail % FLETCHER_SIM_RING_SIZE];
+  return (int) current->type;
+}
+
+int cosim_offset(void) {
+  return (int) current->offset;
+}
+
+int cosim_value(void) {
+  return (int) current->value;
+}
+
+void cosim_complete(int value) {
+  current->value = (uint32_t) value;
+  current = NULL;
+  __atomic_store_n(&shm->tail, shm->tail + 1, __ATOMIC_RELEASE);
+}
+
+int cosim_read32(int hi, int lo) {
+  uint8_t *p = device_pointer(hi, lo);
+  uint32_t value = 0;
+  if (p != NULL) memcpy(&value, p, 4);
+  return (int) value;
+}
+
+void cosim_write32(int hi, int lo, int value, int strobe) {
+  uint8_t *p = device_pointer(hi, lo);
+  int i;
+  if (p == NULL) return;
+  for (i = 0; i < 4; i++) {
+    if (strobe & (1 << i)) {
+      p[i] = (uint8_t) ((uint32_t) value >> (8u * i));
+    }
+  }
+}
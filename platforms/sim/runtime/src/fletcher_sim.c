@@ -0,0 +1,374 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <memory.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "fletcher/fletcher.h"
+
+#include "./fletcher_sim.h"
+#include "./fletcher_sim_shm.h"
+
+#define CHECK_STATUS(identifier) if (identifier != FLETCHER_STATUS_OK) { \
+                                   return status;                        \
+                                 }                                       \
+                                 (void)0
+
+#define sim_print(...) do { if (!options.quiet) fprintf(stdout, __VA_ARGS__); } while (0)
+
+InitOptions options = {0};
+
+/// The shared memory segment, or NULL if the platform is not initialized.
+static FletcherSimShm *shm = NULL;
+/// The device memory in the shared memory segment.
+static uint8_t *memory = NULL;
+/// Name of the shared memory segment.
+static char shm_name[256];
+/// Process ID of the simulator, if started by the platform. -1 once it has exited.
+static pid_t simulator = 0;
+/// Offset of the next device memory allocation.
+static uint64_t alloc_next = 0;
+/// Number of device memory allocations that have not been freed.
+static uint64_t alloc_live = 0;
+/// Serializes commands and allocations of multiple threads.
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/// @brief Sleep briefly while waiting for the simulation, such that the simulator gets the CPU.
+static void backoff(void) {
+  struct timespec ts = {0, 10000};
+  nanosleep(&ts, NULL);
+}
+
+/// @brief Return zero if the simulator was started by the platform and has exited.
+static int simulator_alive(void) {
+  int status;
+  if (simulator > 0 && waitpid(simulator, &status, WNOHANG) == simulator) {
+    fprintf(stderr, "[SIM] Simulator exited before completing all commands.\n");
+    simulator = -1;
+  }
+  return simulator >= 0;
+}
+
+/// @brief Enqueue a command and store its index in \p index. Must be called with the lock held.
+static fstatus_t enqueue(uint32_t type, uint64_t offset, uint32_t value, uint64_t *index) {
+  uint64_t head = shm->head;
+  FletcherSimCommand *command;
+  // Wait for a free slot in the ring.
+  while (head - __atomic_load_n(&shm->tail, __ATOMIC_ACQUIRE) >= FLETCHER_SIM_RING_SIZE) {
+    if (!simulator_alive()) return FLETCHER_STATUS_ERROR;
+    backoff();
+  }
+  command = &shm->ring[head % FLETCHER_SIM_RING_SIZE];
+  command->type = type;
+  command->offset = (uint32_t) offset;
+  command->value = value;
+  __atomic_store_n(&shm->head, head + 1, __ATOMIC_RELEASE);
+  if (index != NULL) *index = head;
+  return FLETCHER_STATUS_OK;
+}
+
+/// @brief Wait for the completion of the command at \p index. Must be called with the lock held.
+static fstatus_t wait_for(uint64_t index) {
+  while (__atomic_load_n(&shm->tail, __ATOMIC_ACQUIRE) <= index) {
+    if (!simulator_alive()) return FLETCHER_STATUS_ERROR;
+    backoff();
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+/// @brief Return a host pointer to \p size bytes of device memory at \p address, or NULL if out of range.
+static uint8_t *device_pointer(da_t address, int64_t size) {
+  uint64_t device_size = shm->size - FLETCHER_SIM_MEMORY_OFFSET;
+  if (address < FLETCHER_SIM_DEVICE_BASE || size < 0) return NULL;
+  if (address - FLETCHER_SIM_DEVICE_BASE + (uint64_t) size > device_size) return NULL;
+  return memory + (address - FLETCHER_SIM_DEVICE_BASE);
+}
+
+fstatus_t platformGetName(char *name, size_t size) {
+  size_t len = strlen(FLETCHER_PLATFORM_NAME);
+  if (len > size) {
+    memcpy(name, FLETCHER_PLATFORM_NAME, size - 1);
+    name[size - 1] = '\0';
+  } else {
+    memcpy(name, FLETCHER_PLATFORM_NAME, len + 1);
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformInit(void *arg) {
+  InitOptions defaults = {0};
+  const char *env;
+  uint64_t memory_bytes;
+  uint64_t size;
+  int fd;
+  if (shm != NULL) {
+    return FLETCHER_STATUS_OK;
+  }
+  options = (arg != NULL) ? *(InitOptions *) arg : defaults;
+
+  env = getenv("FLETCHER_SIM_SHM");
+  if (env != NULL) options.shm_name = env;
+  if (options.shm_name == NULL) options.shm_name = FLETCHER_SIM_DEFAULT_SHM;
+  env = getenv("FLETCHER_SIM_MEMORY_BYTES");
+  if (env != NULL) options.memory_bytes = strtoull(env, NULL, 0);
+  memory_bytes = options.memory_bytes ? options.memory_bytes : FLETCHER_SIM_DEFAULT_MEMORY_BYTES;
+  env = getenv("FLETCHER_SIM_COMMAND");
+  if (env != NULL) options.command = env;
+
+  sim_print("[SIM] Initializing platform.       Arguments @ [host] %016lX.\n", (unsigned long) arg);
+
+  // Create a fresh segment. Pages of the device memory are only allocated when they are used.
+  snprintf(shm_name, sizeof(shm_name), "%s", options.shm_name);
+  shm_unlink(shm_name);
+  fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    fprintf(stderr, "[SIM] Could not create shared memory segment %s.\n", shm_name);
+    return FLETCHER_STATUS_ERROR;
+  }
+  size = FLETCHER_SIM_MEMORY_OFFSET + memory_bytes;
+  if (ftruncate(fd, (off_t) size) != 0) {
+    close(fd);
+    shm_unlink(shm_name);
+    return FLETCHER_STATUS_ERROR;
+  }
+  shm = (FletcherSimShm *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shm == MAP_FAILED) {
+    shm = NULL;
+    shm_unlink(shm_name);
+    return FLETCHER_STATUS_ERROR;
+  }
+  memory = (uint8_t *) shm + FLETCHER_SIM_MEMORY_OFFSET;
+  shm->size = size;
+  __atomic_store_n(&shm->magic, FLETCHER_SIM_MAGIC, __ATOMIC_RELEASE);
+  alloc_next = 0;
+  alloc_live = 0;
+
+  // Start the simulator, which finds the segment through the environment.
+  simulator = 0;
+  if (options.command != NULL) {
+    setenv("FLETCHER_SIM_SHM", shm_name, 1);
+    sim_print("[SIM] Starting simulator.          %s\n", options.command);
+    fflush(stdout);
+    simulator = fork();
+    if (simulator == 0) {
+      execl("/bin/sh", "sh", "-c", options.command, (char *) NULL);
+      _exit(127);
+    }
+    if (simulator < 0) {
+      simulator = 0;
+      return FLETCHER_STATUS_ERROR;
+    }
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value) {
+  fstatus_t status;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  status = enqueue(FLETCHER_SIM_CMD_WRITE_MMIO, offset, value, NULL);
+  pthread_mutex_unlock(&lock);
+  sim_print("[SIM] Wrote MMIO register.       %04lu <= 0x%08X\n", offset, value);
+  return status;
+}
+
+fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count) {
+  fstatus_t status = FLETCHER_STATUS_OK;
+  uint64_t i;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  for (i = 0; i < count && status == FLETCHER_STATUS_OK; i++) {
+    status = enqueue(FLETCHER_SIM_CMD_WRITE_MMIO, offset + i, values[i], NULL);
+    sim_print("[SIM] Wrote MMIO register.       %04lu <= 0x%08X (batch)\n", offset + i, values[i]);
+  }
+  pthread_mutex_unlock(&lock);
+  return status;
+}
+
+fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value) {
+  fstatus_t status;
+  uint64_t index;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  status = enqueue(FLETCHER_SIM_CMD_READ_MMIO, offset, 0, &index);
+  if (status == FLETCHER_STATUS_OK) {
+    status = wait_for(index);
+  }
+  if (status == FLETCHER_STATUS_OK) {
+    *value = shm->ring[index % FLETCHER_SIM_RING_SIZE].value;
+  }
+  pthread_mutex_unlock(&lock);
+  CHECK_STATUS(status);
+  sim_print("[SIM] Read MMIO register.        %04lu => 0x%08X\n", offset, *value);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size) {
+  uint8_t *destination;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  destination = device_pointer(device_destination, size);
+  if (destination == NULL) return FLETCHER_STATUS_ERROR;
+  memcpy(destination, host_source, size);
+  sim_print("[SIM] Copied from host to device.  [host] 0x%016lX --> [dev] 0x%016lX (%ld bytes)\n",
+            (uint64_t) host_source,
+            device_destination,
+            size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count) {
+  fstatus_t status;
+  uint64_t i;
+  for (i = 0; i < count; i++) {
+    status = platformCopyHostToDevice(iov[i].host_address, iov[i].device_address, (int64_t) iov[i].size);
+    CHECK_STATUS(status);
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination, int64_t size) {
+  uint8_t *source;
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  source = device_pointer(device_source, size);
+  if (source == NULL) return FLETCHER_STATUS_ERROR;
+  memcpy(host_destination, source, size);
+  sim_print("[SIM] Copied from device to host.  [dev] 0x%016lX --> [host] 0x%016lX (%ld bytes)\n",
+            device_source,
+            (uint64_t) host_destination,
+            size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformTerminate(void *arg) {
+  fstatus_t status = FLETCHER_STATUS_OK;
+  uint64_t index;
+  int exit_status;
+  if (shm == NULL) {
+    return FLETCHER_STATUS_OK;
+  }
+  sim_print("[SIM] Terminating platform.        Arguments @ [host] 0x%016lX.\n", (uint64_t) arg);
+  pthread_mutex_lock(&lock);
+  // Stop the simulation, unless there is no simulator to stop.
+  if (simulator > 0 || __atomic_load_n(&shm->attached, __ATOMIC_ACQUIRE)) {
+    status = enqueue(FLETCHER_SIM_CMD_TERMINATE, 0, 0, &index);
+    if (status == FLETCHER_STATUS_OK) {
+      status = wait_for(index);
+    }
+  }
+  if (simulator > 0) {
+    waitpid(simulator, &exit_status, 0);
+  }
+  simulator = 0;
+  munmap(shm, shm->size);
+  shm = NULL;
+  memory = NULL;
+  shm_unlink(shm_name);
+  pthread_mutex_unlock(&lock);
+  return status;
+}
+
+fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size) {
+  uint64_t aligned = ((uint64_t) size + FLETCHER_SIM_ALIGNMENT - 1) / FLETCHER_SIM_ALIGNMENT * FLETCHER_SIM_ALIGNMENT;
+  if (shm == NULL || size < 0) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  if (alloc_next + aligned > shm->size - FLETCHER_SIM_MEMORY_OFFSET) {
+    pthread_mutex_unlock(&lock);
+    return FLETCHER_STATUS_DEVICE_OUT_OF_MEMORY;
+  }
+  *device_address = FLETCHER_SIM_DEVICE_BASE + alloc_next;
+  alloc_next += aligned;
+  alloc_live++;
+  pthread_mutex_unlock(&lock);
+  sim_print("[SIM] Allocating device memory.    [device] 0x%016lX (%10lu bytes).\n",
+            (uint64_t) *device_address,
+            size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformDeviceFree(da_t device_address) {
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  if (device_pointer(device_address, 0) == NULL) return FLETCHER_STATUS_ERROR;
+  pthread_mutex_lock(&lock);
+  if (alloc_live > 0) {
+    alloc_live--;
+  }
+  // Memory is reused once all allocations are freed.
+  if (alloc_live == 0) {
+    alloc_next = 0;
+  }
+  pthread_mutex_unlock(&lock);
+  sim_print("[SIM] Freeing device memory.       [device] 0x%016lX.\n", device_address);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size) {
+  fstatus_t status;
+  status = platformDeviceMalloc(device_address, size);
+  CHECK_STATUS(status);
+  *host_address = device_pointer(*device_address, size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformHostFree(uint8_t *host_address) {
+  if (shm == NULL) return FLETCHER_STATUS_ERROR;
+  return platformDeviceFree(FLETCHER_SIM_DEVICE_BASE + (da_t) (host_address - memory));
+}
+
+fstatus_t platformPrepareHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size, int *alloced) {
+  fstatus_t status;
+
+  // Allocate new memory.
+  status = platformDeviceMalloc(device_destination, size);
+  // We have newly allocated the buffer, signal this back to the caller.
+  *alloced = 1;
+  CHECK_STATUS(status);
+
+  // Copy data
+  status = platformCopyHostToDevice(host_source, *device_destination, size);
+
+  sim_print("[SIM] Prepared buffer on device.   [host] 0x%016lX --> 0x%016lX (%10lu bytes).\n",
+            (unsigned long) host_source,
+            (unsigned long) *device_destination,
+            size);
+
+  return status;
+}
+
+fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size) {
+  fstatus_t status;
+
+  // Allocate new memory.
+  status = platformDeviceMalloc(device_destination, size);
+  CHECK_STATUS(status);
+
+  // Copy data
+  status = platformCopyHostToDevice(host_source, *device_destination, size);
+
+  sim_print("[SIM] Cached buffer on device.    [host] 0x%016lX --> 0x%016lX (%10lu bytes).\n",
+            (unsigned long) host_source,
+            (unsigned long) *device_destination,
+            size);
+
+  return status;
+}
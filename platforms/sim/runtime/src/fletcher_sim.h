@@ -0,0 +1,115 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+
+#include "fletcher/fletcher.h"
+
+/// Platform name.
+#define FLETCHER_PLATFORM_NAME "sim"
+
+/// Alignment for device memory allocations.
+#define FLETCHER_SIM_ALIGNMENT 4096
+
+/// Default size of the device memory in bytes, if FLETCHER_SIM_MEMORY_BYTES is not set.
+#define FLETCHER_SIM_DEFAULT_MEMORY_BYTES (256ull * 1024 * 1024)
+
+/**
+ * @brief Platform options.
+ *
+ * The options can also be set through the environment, which is useful when the platform is created by name:
+ * FLETCHER_SIM_SHM, FLETCHER_SIM_MEMORY_BYTES and FLETCHER_SIM_COMMAND.
+ */
+typedef struct {
+  /// Non-zero to suppress all output.
+  int quiet;
+  /// Name of the shared memory segment. NULL selects FLETCHER_SIM_DEFAULT_SHM.
+  const char *shm_name;
+  /// Size of the device memory in bytes. Zero selects FLETCHER_SIM_DEFAULT_MEMORY_BYTES.
+  uint64_t memory_bytes;
+  /**
+   * Shell command that starts the simulator, or NULL to attach to a simulator that is started separately.
+   *
+   * The command inherits FLETCHER_SIM_SHM, such that the bridge attaches to the right segment.
+   */
+  const char *command;
+} InitOptions;
+
+/// @brief Store the platform name in a buffer of size /p size pointed to by /p name.
+fstatus_t platformGetName(char *name, size_t size);
+
+/**
+ * @brief Initialize the platform.
+ *
+ * Create the shared memory segment and start the simulator, if a command is set. \p arg may point to a null pointer or
+ * an InitOptions structure.
+ */
+fstatus_t platformInit(void *arg);
+
+/// @brief Write \p value to MMIO register \p offset. The write is posted; it is executed in order by the simulation.
+fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value);
+
+/// @brief Write \p count consecutive MMIO registers starting at \p offset from \p values.
+fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count);
+
+/// @brief Read MMIO register \p offset into \p value. Blocks until the simulation has executed the read.
+fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value);
+
+/// @brief Copy \p size bytes from host address \p host_source to device address \p device_destination.
+fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size);
+
+/// @brief Copy \p count regions described by \p iov from host to device.
+fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count);
+
+/// @brief Copy \p size bytes from device address \p device_source to host address \p host_destination.
+fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t *host_destination, int64_t size);
+
+/**
+ * @brief Allocate \p size bytes on the device.
+ *
+ * The device memory is part of the shared memory segment, such that the memory models of the simulation can access
+ * it. Memory is allocated linearly, and is only reused after all allocations have been freed.
+ */
+fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size);
+
+/// @brief Free the memory allocated at \p device_address.
+fstatus_t platformDeviceFree(da_t device_address);
+
+/**
+ * @brief Allocate \p size bytes of host memory that the device can access directly.
+ *
+ * For the sim platform, this is device memory that is mapped into the address space of the host application.
+ */
+fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size);
+
+/// @brief Free device-visible host memory allocated at \p host_address.
+fstatus_t platformHostFree(uint8_t *host_address);
+
+/**
+ * @brief Ensure the device can read \p size bytes from a host buffer at \p host_source.
+ *
+ * The simulation cannot access the memory of the host application, so this always allocates device memory and copies
+ * the buffer to it.
+ */
+fstatus_t platformPrepareHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size, int *alloced);
+
+/// @brief Explicitly cache \p size bytes from \p host_source on the device.
+fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size);
+
+/**
+ * @brief Terminate the platform.
+ *
+ * Stop the simulation, wait for the simulator if it was started by the platform, and remove the shared memory segment.
+ */
+fstatus_t platformTerminate(void *arg);
@@ -0,0 +1,76 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/**
+ * This file describes the shared memory segment through which the sim platform and the co-simulation bridge in the
+ * simulator communicate. It is included by both.
+ *
+ * The segment starts with a FletcherSimShm header, followed by the device memory. The platform enqueues commands in
+ * the ring of the header. The bridge executes them in order in the simulation, and completes every command by storing
+ * its result in the command and advancing the tail. Device address FLETCHER_SIM_DEVICE_BASE maps to the first byte of
+ * the device memory.
+ */
+
+#include <stdint.h>
+
+/// Value of the magic field of an initialized segment.
+#define FLETCHER_SIM_MAGIC 0x4D49534843544C46ull
+
+/// Default name of the shared memory segment, if FLETCHER_SIM_SHM is not set.
+#define FLETCHER_SIM_DEFAULT_SHM "/fletcher_sim"
+
+/// Number of commands in the ring.
+#define FLETCHER_SIM_RING_SIZE 256
+
+/// Device address of the first byte of the device memory.
+#define FLETCHER_SIM_DEVICE_BASE 0x10000000ull
+
+/// Offset of the device memory in the segment, the first page boundary after the header.
+#define FLETCHER_SIM_MEMORY_OFFSET 8192ull
+
+/// Command types. These values must match the constants in SimBridge_pkg.
+#define FLETCHER_SIM_CMD_NONE 0
+#define FLETCHER_SIM_CMD_WRITE_MMIO 1
+#define FLETCHER_SIM_CMD_READ_MMIO 2
+#define FLETCHER_SIM_CMD_TERMINATE 3
+
+/// A command from the platform to the simulation.
+typedef struct {
+  /// The command type.
+  uint32_t type;
+  /// The MMIO register offset.
+  uint32_t offset;
+  /// The value to write, or the value that was read after completion.
+  uint32_t value;
+  uint32_t reserved;
+} FletcherSimCommand;
+
+/// Header of the shared memory segment.
+typedef struct {
+  /// FLETCHER_SIM_MAGIC when the platform has initialized the segment.
+  uint64_t magic;
+  /// Size of the whole segment in bytes.
+  uint64_t size;
+  /// Non-zero once the bridge has attached to the segment.
+  uint32_t attached;
+  uint32_t reserved;
+  /// Number of commands enqueued by the platform.
+  uint64_t head;
+  /// Number of commands completed by the bridge.
+  uint64_t tail;
+  /// The command ring, indexed by head and tail modulo FLETCHER_SIM_RING_SIZE.
+  FletcherSimCommand ring[FLETCHER_SIM_RING_SIZE];
+} FletcherSimShm;
@@ -0,0 +1,403 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Benchmarks of the run-time library.
+ *
+ * Usage: fletcher-bench [options] [platform]
+ *
+ * Runs against the named platform, or the autodetected platform if no name is given. The echo platform is run in its
+ * non-interactive model mode, see platforms/echo/runtime/README.md.
+ *
+ * The micro suite measures single run-time operations. The end-to-end (e2e) suite generates RecordBatches and measures
+ * complete launches, from queueing the RecordBatch until the kernel is done, reporting throughput and the latency of
+ * every phase. Options:
+ *
+ *   --json                Print one JSON object per benchmark, instead of a table.
+ *   --suite <name>        Only run the micro or e2e suite.
+ *   --schema <file>       Run the e2e suite with data generated for a schema file, instead of the built-in workloads.
+ *   --rows <n>            The number of rows of generated RecordBatches.
+ *   --null-ratio <r>      The ratio of nulls of nullable fields of the schema file.
+ *   --min-length <n>      The minimum length of strings and lists of the schema file.
+ *   --max-length <n>      The maximum length of strings and lists of the schema file.
+ *   --lengths <name>      The distribution of lengths of the schema file: fixed, uniform or zipf.
+ *   --seed <n>            The seed of the data generator.
+ */
+
+#include <arrow/api.h>
+#include <fletcher/api.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// The minimum duration of the measurement of a benchmark, in seconds.
+constexpr double kMinSeconds = 0.2;
+
+/// The minimum number of launches of an end-to-end benchmark.
+constexpr size_t kMinLaunches = 3;
+
+/// Command-line options.
+struct Options {
+  std::string platform;
+  bool json = false;
+  bool micro = true;
+  bool e2e = true;
+  std::string schema_file;
+  int64_t rows = 0;
+  fletcher::GeneratorOptions generator;
+};
+
+/// Prints the results of benchmarks as a table or as JSON objects.
+struct Reporter {
+  bool json = false;
+  std::string platform;
+  int64_t timestamp = 0;
+
+  /// @brief Return the fields shared by all JSON objects.
+  std::string Header(const std::string &suite, const std::string &name) const {
+    return "{\"suite\":\"" + suite + "\",\"name\":\"" + name + "\",\"platform\":\"" + platform + "\",\"timestamp\":"
+        + std::to_string(timestamp);
+  }
+};
+
+/// @brief Run a benchmark often enough to measure it for kMinSeconds, and print the results.
+void Run(const Reporter &reporter, const std::string &name, const std::function<void()> &iteration,
+         double bytes_per_iteration = 0.0, const std::string &counter_name = "", double counter = 0.0) {
+  // Warm up, which also makes sure the benchmark runs at least once.
+  iteration();
+  size_t iterations = 1;
+  double seconds = 0.0;
+  while (true) {
+    fletcher::Timer t;
+    t.start();
+    for (size_t i = 0; i < iterations; i++) {
+      iteration();
+    }
+    t.stop();
+    seconds = t.seconds();
+    if ((seconds >= kMinSeconds) || (iterations >= (1ul << 30))) break;
+    iterations *= seconds > 0.0 ? std::max<size_t>(2, static_cast<size_t>(kMinSeconds / seconds * 1.2)) : 10;
+  }
+  auto ns = seconds / static_cast<double>(iterations) * 1e9;
+  auto gbps = bytes_per_iteration * iterations / seconds / 1e9;
+  if (reporter.json) {
+    std::cout << reporter.Header("micro", name) << std::fixed << std::setprecision(1) << ",\"ns\":" << ns
+              << ",\"iterations\":" << iterations;
+    if (bytes_per_iteration > 0.0) {
+      std::cout << std::setprecision(3) << ",\"gbps\":" << gbps;
+    }
+    if (!counter_name.empty()) {
+      std::cout << std::setprecision(0) << ",\"" << counter_name << "\":" << counter;
+    }
+    std::cout << "}" << std::endl;
+    return;
+  }
+  std::cout << std::left << std::setw(40) << name << std::right << std::setw(14) << std::fixed << std::setprecision(0)
+            << ns << " ns" << std::setw(12) << iterations;
+  if (bytes_per_iteration > 0.0) {
+    std::cout << std::setw(12) << std::setprecision(2) << gbps << " GB/s";
+  }
+  if (!counter_name.empty()) {
+    std::cout << "  " << counter_name << "=" << std::setprecision(0) << counter;
+  }
+  std::cout << std::endl;
+}
+
+/// @brief Create a RecordBatch with a number of uint64 fields.
+std::shared_ptr<arrow::RecordBatch> MakeBatch(int num_fields, int64_t num_rows) {
+  std::vector<std::shared_ptr<arrow::Field>> fields;
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (int f = 0; f < num_fields; f++) {
+    fields.push_back(arrow::field("f" + std::to_string(f), arrow::uint64(), false));
+    arrow::UInt64Builder b;
+    for (int64_t i = 0; i < num_rows; i++) {
+      b.Append(static_cast<uint64_t>(i)).ok();
+    }
+    std::shared_ptr<arrow::Array> arr;
+    b.Finish(&arr).ok();
+    columns.push_back(arr);
+  }
+  return arrow::RecordBatch::Make(arrow::schema(fields), num_rows, columns);
+}
+
+/// @brief Check a status, and exit if it is not OK.
+void Check(fletcher::Status status, const std::string &what) {
+  if (!status.ok()) {
+    std::cerr << "Benchmark failed: " << what << ": " << status.message << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+/// A schema and the options to generate its data with, for the end-to-end suite.
+struct Workload {
+  std::string name;
+  std::shared_ptr<arrow::Schema> schema;
+  fletcher::GeneratorOptions options;
+};
+
+/// @brief Return a workload of a single-field read schema.
+Workload MakeWorkload(const std::string &name, const std::shared_ptr<arrow::Field> &field, double null_ratio = 0.0,
+                      uint32_t min_length = 0, uint32_t max_length = 0,
+                      fletcher::LengthDistribution lengths = fletcher::LengthDistribution::UNIFORM) {
+  Workload result;
+  result.name = name;
+  result.schema = fletcher::WithMetaRequired(*arrow::schema({field}), name, fletcher::Mode::READ);
+  result.options.rows = 65536;
+  result.options.null_ratio = null_ratio;
+  result.options.min_length = min_length;
+  result.options.max_length = max_length;
+  result.options.length_distribution = lengths;
+  return result;
+}
+
+/// @brief Return the built-in workloads of the end-to-end suite.
+std::vector<Workload> BuiltinWorkloads() {
+  using fletcher::LengthDistribution;
+  std::vector<Workload> result = {
+      MakeWorkload("prim", arrow::field("a", arrow::uint64(), false)),
+      MakeWorkload("nullable/null_ratio:0.1", arrow::field("a", arrow::int64(), true), 0.1),
+      MakeWorkload("nullable/null_ratio:0.5", arrow::field("a", arrow::int64(), true), 0.5),
+      MakeWorkload("string/fixed:16", arrow::field("s", arrow::utf8(), false), 0.0, 16, 16, LengthDistribution::FIXED),
+      MakeWorkload("string/uniform:0-64", arrow::field("s", arrow::utf8(), false), 0.0, 0, 64),
+      MakeWorkload("string/zipf:0-1024", arrow::field("s", arrow::utf8(), false), 0.0, 0, 1024,
+                   LengthDistribution::ZIPF),
+      MakeWorkload("struct", arrow::field("p", arrow::struct_({arrow::field("x", arrow::uint32(), false),
+                                                               arrow::field("y", arrow::float64(), false)}), false))};
+  for (int depth = 1; depth <= 3; depth++) {
+    result.push_back(MakeWorkload("nested/depth:" + std::to_string(depth),
+                                  arrow::field("l", fletcher::NestedListType(arrow::uint8(), depth), false),
+                                  0.0, 0, 8));
+  }
+  return result;
+}
+
+/// @brief Launch a kernel on a RecordBatch once, from queueing the RecordBatch until the kernel is done.
+std::shared_ptr<fletcher::Context> Launch(const std::shared_ptr<fletcher::Platform> &platform,
+                                          const std::shared_ptr<arrow::RecordBatch> &batch) {
+  std::shared_ptr<fletcher::Context> context;
+  Check(fletcher::Context::Make(&context, platform), "create context");
+  Check(context->QueueRecordBatch(batch), "queue RecordBatch");
+  Check(context->Enable(), "enable context");
+  fletcher::Kernel kernel(context);
+  Check(kernel.WriteMetaData(), "write metadata");
+  Check(kernel.Reset(), "reset kernel");
+  Check(kernel.Start(), "start kernel");
+  Check(kernel.PollUntilDone(), "poll kernel");
+  return context;
+}
+
+/// @brief Launch a kernel on a RecordBatch repeatedly for kMinSeconds, and print the throughput and phase latencies.
+void RunEndToEnd(const Reporter &reporter, const std::shared_ptr<fletcher::Platform> &platform,
+                 const std::string &name, const std::shared_ptr<arrow::RecordBatch> &batch) {
+  // Warm up.
+  auto bytes = static_cast<double>(Launch(platform, batch)->GetQueueSize());
+  fletcher::Instrumentation phases;
+  fletcher::Histogram launches;
+  size_t iterations = 0;
+  double seconds = 0.0;
+  while (((seconds < kMinSeconds) || (iterations < kMinLaunches)) && (iterations < (1ul << 20))) {
+    fletcher::Timer t;
+    t.start();
+    auto context = Launch(platform, batch);
+    t.stop();
+    seconds += t.seconds();
+    iterations++;
+    launches.Record(static_cast<uint64_t>(t.seconds() * 1e9));
+    phases.Merge(context->instrumentation());
+  }
+  auto gbps = bytes * iterations / seconds / 1e9;
+  auto rows_per_s = static_cast<double>(batch->num_rows()) * iterations / seconds;
+  auto mean_ns = seconds / static_cast<double>(iterations) * 1e9;
+  if (reporter.json) {
+    std::cout << reporter.Header("e2e", name) << ",\"rows\":" << batch->num_rows() << std::fixed << std::setprecision(0)
+              << ",\"bytes\":" << bytes << ",\"iterations\":" << iterations << std::setprecision(6)
+              << ",\"seconds\":" << seconds << std::setprecision(3) << ",\"gbps\":" << gbps << std::setprecision(0)
+              << ",\"rows_per_s\":" << rows_per_s << ",\"launch_ns\":{\"mean\":" << mean_ns
+              << ",\"p50\":" << launches.Percentile(0.5) << ",\"p99\":" << launches.Percentile(0.99)
+              << ",\"max\":" << launches.max() << "},\"phases\":" << phases.GetStats().ToJSON() << "}" << std::endl;
+    return;
+  }
+  std::cout << std::left << std::setw(40) << "E2E/" + name << std::right << std::setw(14) << std::fixed
+            << std::setprecision(0) << mean_ns << " ns" << std::setw(12) << iterations << std::setw(12)
+            << std::setprecision(2) << gbps << " GB/s" << std::setw(14) << std::setprecision(0) << rows_per_s
+            << " rows/s" << std::endl;
+}
+
+/// @brief Print the usage of the benchmarks and exit.
+void Usage(const char *program) {
+  std::cerr << "Usage: " << program << " [--json] [--suite micro|e2e] [--schema <file>] [--rows <n>] "
+            << "[--null-ratio <r>] [--min-length <n>] [--max-length <n>] [--lengths fixed|uniform|zipf] "
+            << "[--seed <n>] [platform]" << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+/// @brief Parse the command-line options.
+Options ParseOptions(int argc, char **argv) {
+  Options result;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    // Return the value of an option that takes one.
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) Usage(argv[0]);
+      return argv[++i];
+    };
+    if (arg == "--json") {
+      result.json = true;
+    } else if (arg == "--suite") {
+      auto suite = value();
+      if ((suite != "micro") && (suite != "e2e")) Usage(argv[0]);
+      result.micro = suite == "micro";
+      result.e2e = suite == "e2e";
+    } else if (arg == "--schema") {
+      result.schema_file = value();
+    } else if (arg == "--rows") {
+      result.rows = std::stoll(value());
+    } else if (arg == "--null-ratio") {
+      result.generator.null_ratio = std::stod(value());
+    } else if (arg == "--min-length") {
+      result.generator.min_length = static_cast<uint32_t>(std::stoul(value()));
+    } else if (arg == "--max-length") {
+      result.generator.max_length = static_cast<uint32_t>(std::stoul(value()));
+    } else if (arg == "--lengths") {
+      if (!fletcher::ParseLengthDistribution(value(), &result.generator.length_distribution)) Usage(argv[0]);
+    } else if (arg == "--seed") {
+      result.generator.seed = std::stoull(value());
+    } else if ((arg.size() > 1) && (arg[0] == '-')) {
+      Usage(argv[0]);
+    } else {
+      result.platform = arg;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  auto options = ParseOptions(argc, argv);
+
+  // Make the echo platform non-interactive, unless configured otherwise.
+  setenv("FLETCHER_ECHO_MODEL", "1", 0);
+
+  std::shared_ptr<fletcher::Platform> platform;
+  if (!options.platform.empty()) {
+    Check(fletcher::Platform::Make(options.platform, &platform, false), "create platform");
+  } else {
+    Check(fletcher::Platform::Make(&platform, false), "create platform");
+  }
+  Check(platform->Init(), "initialize platform");
+
+  Reporter reporter;
+  reporter.json = options.json;
+  reporter.platform = platform->name();
+  reporter.timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  if (!reporter.json) {
+    std::cout << "Platform: " << platform->name() << std::endl;
+    std::cout << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(17) << "Time"
+              << std::setw(12) << "Iterations" << std::endl;
+  }
+
+  if (options.micro) {
+    // Queueing and enabling a RecordBatch, for an increasing number of fields and buffers.
+    for (int num_fields : {1, 4, 16, 64}) {
+      auto batch = MakeBatch(num_fields, 1024);
+      Run(reporter, "QueueEnable/fields:" + std::to_string(num_fields), [&]() {
+        std::shared_ptr<fletcher::Context> context;
+        Check(fletcher::Context::Make(&context, platform), "create context");
+        Check(context->QueueRecordBatch(batch), "queue RecordBatch");
+        Check(context->Enable(), "enable context");
+      });
+    }
+
+    // Writing the metadata of a RecordBatch, for an increasing number of MMIO registers.
+    for (int num_fields : {1, 4, 16, 64}) {
+      std::shared_ptr<fletcher::Context> context;
+      Check(fletcher::Context::Make(&context, platform), "create context");
+      Check(context->QueueRecordBatch(MakeBatch(num_fields, 16)), "queue RecordBatch");
+      Check(context->Enable(), "enable context");
+      fletcher::Kernel kernel(context);
+      auto regs = 2 * context->num_recordbatches() + 2 * context->num_buffers();
+      Run(reporter, "WriteMetaData/fields:" + std::to_string(num_fields), [&]() {
+        Check(kernel.WriteMetaData(), "write metadata");
+      }, 0.0, "mmio_writes", static_cast<double>(regs));
+    }
+
+    // Starting a kernel and polling until it is done.
+    {
+      std::shared_ptr<fletcher::Context> context;
+      Check(fletcher::Context::Make(&context, platform), "create context");
+      Check(context->QueueRecordBatch(MakeBatch(1, 16)), "queue RecordBatch");
+      Check(context->Enable(), "enable context");
+      fletcher::Kernel kernel(context);
+      Check(kernel.WriteMetaData(), "write metadata");
+      Run(reporter, "StartPollUntilDone", [&]() {
+        Check(kernel.Reset(), "reset kernel");
+        Check(kernel.Start(), "start kernel");
+        Check(kernel.PollUntilDone(), "poll kernel");
+      });
+    }
+
+    // Host-to-device throughput, for an increasing buffer size.
+    for (int64_t size : {4096l, 65536l, 1048576l, 16777216l}) {
+      std::vector<uint8_t> host(static_cast<size_t>(size), 1);
+      da_t device = D_NULLPTR;
+      Check(platform->DeviceMalloc(&device, static_cast<size_t>(size)), "allocate device memory");
+      Run(reporter, "CopyHostToDevice/bytes:" + std::to_string(size), [&]() {
+        Check(platform->CopyHostToDevice(host.data(), device, static_cast<uint64_t>(size)), "copy to device");
+      }, static_cast<double>(size));
+      Check(platform->DeviceFree(device), "free device memory");
+    }
+  }
+
+  if (options.e2e) {
+    // Launches on generated RecordBatches, for the schema file or for the built-in workloads.
+    std::vector<Workload> workloads;
+    if (!options.schema_file.empty()) {
+      Workload w;
+      if (!fletcher::ReadSchemaFromFile(options.schema_file, &w.schema)) {
+        std::cerr << "Benchmark failed: could not read schema " << options.schema_file << std::endl;
+        return EXIT_FAILURE;
+      }
+      w.name = options.schema_file;
+      w.options = options.generator;
+      workloads.push_back(w);
+    } else {
+      workloads = BuiltinWorkloads();
+    }
+    for (auto &w : workloads) {
+      if (options.rows > 0) {
+        w.options.rows = options.rows;
+      }
+      w.options.seed = options.generator.seed;
+      std::shared_ptr<arrow::RecordBatch> batch;
+      if (!fletcher::GenerateRecordBatch(w.schema, w.options, &batch)) {
+        std::cerr << "Benchmark failed: could not generate data for " << w.name << std::endl;
+        return EXIT_FAILURE;
+      }
+      RunEndToEnd(reporter, platform, w.name, batch);
+    }
+  }
+
+  Check(platform->Terminate(), "terminate platform");
+  return EXIT_SUCCESS;
+}
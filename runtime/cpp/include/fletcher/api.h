@@ -24,11 +24,38 @@
 #include "fletcher/hex-view.h"
 #include "fletcher/arrow-recordbatch.h"
 #include "fletcher/arrow-schema.h"
+#include "fletcher/datagen.h"
 
 // CPP runtime lib
 #include "fletcher/context.h"
 #include "fletcher/platform.h"
 #include "fletcher/kernel.h"
+#include "fletcher/pool.h"
+#include "fletcher/residency.h"
+#include "fletcher/devices.h"
+#include "fletcher/numa.h"
+#include "fletcher/streaming.h"
+#include "fletcher/scheduler.h"
+#include "fletcher/pinned.h"
+#include "fletcher/mapped.h"
+#include "fletcher/stats.h"
+#include "fletcher/trace.h"
+#include "fletcher/tiled.h"
+#include "fletcher/profiler.h"
+#include "fletcher/output.h"
+#include "fletcher/partition.h"
+#include "fletcher/submission.h"
+#include "fletcher/ring.h"
+#include "fletcher/completion.h"
+#include "fletcher/result.h"
+#include "fletcher/offload.h"
+#include "fletcher/image.h"
+#include "fletcher/chunks.h"
+#include "fletcher/ingest.h"
+#include "fletcher/flight.h"
+#include "fletcher/sink.h"
+#include "fletcher/coalesce.h"
+#include "fletcher/prune.h"
 
 /// Contains all Fletcher classes and functions for use in run-time applications.
 namespace fletcher {
@@ -0,0 +1,126 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+#include "fletcher/profiler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Lets a kernel process many RecordBatches of one schema in a single run, through the chunk lists that
+ *        fletchgen generates with --chunk_list.
+ *
+ * Consecutive RecordBatches of a Context with the same schema name form the chunks of a single table. For every such
+ * table, the chunk list is an array of descriptors in device memory, each holding the first and last index and the
+ * buffer addresses of one chunk (see Kernel::GatherMetaData()). The hardware walks the chunks back-to-back, such that
+ * the kernel processes the rows of all chunks as if they were a single RecordBatch, without being restarted.
+ *
+ * The registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest).
+ */
+class ChunkList {
+ public:
+  /**
+   * @brief Create a ChunkList for every RecordBatch of a kernel that has a chunk list.
+   * @param[out] out        A pointer to a shared pointer that will own the new ChunkList.
+   * @param[in]  platform   The platform of the kernel.
+   * @param[in]  registers  The registers of the register manifest generated by fletchgen.
+   * @param[in]  mmio_base  The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ChunkList> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::vector<MmioRegister> &registers,
+                     uint64_t mmio_base = 0);
+
+  /**
+   * @brief Create a ChunkList for every RecordBatch of a kernel that has a chunk list, using a register manifest file.
+   * @param[out] out            A pointer to a shared pointer that will own the new ChunkList.
+   * @param[in]  platform       The platform of the kernel.
+   * @param[in]  manifest_path  The path of the register manifest generated by fletchgen.
+   * @param[in]  mmio_base      The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ChunkList> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::string &manifest_path,
+                     uint64_t mmio_base = 0);
+
+  /// @brief Free the device memory of the chunk lists. The kernel must not be running.
+  ~ChunkList();
+
+  /**
+   * @brief Write the chunk lists and the RecordBatch metadata of the Context of a Kernel.
+   *
+   * The Context must have been enabled, and must not be modified until the kernel is done. Instead of the metadata
+   * that Kernel::WriteMetaData() writes, the RecordBatch registers of every table hold the range of its concatenated
+   * chunks and the buffer addresses of its first chunk. Call this again instead of Kernel::UpdateMetaData() after the
+   * Context was modified.
+   *
+   * @param[in] kernel A Kernel operating on the Context holding the chunks.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status WriteMetaData(Kernel *kernel);
+
+  /// @brief Return the number of RecordBatches that have a chunk list.
+  size_t num_lists() const { return lists_.size(); }
+  /// @brief Return the number of bytes of every descriptor in the chunk list of a RecordBatch.
+  uint32_t stride(size_t i) const { return lists_[i].stride; }
+  /// @brief Return the device address of the chunk list of a RecordBatch.
+  da_t address(size_t i) const { return lists_[i].address; }
+
+ private:
+  explicit ChunkList(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+
+  /// The chunk list of a RecordBatch.
+  struct List {
+    /// The name of the RecordBatch.
+    std::string name;
+    /// The register holding the device address of the chunk list.
+    MmioRegister chunks;
+    /// The register holding the number of chunks.
+    MmioRegister num_chunks;
+    /// The number of bytes of every descriptor.
+    uint32_t stride = 0;
+    /// The device address of the chunk list.
+    da_t address = D_NULLPTR;
+    /// The number of descriptors the device memory of the chunk list can hold.
+    size_t capacity = 0;
+  };
+
+  /// @brief Write a register of a chunk list.
+  Status Write(const MmioRegister &reg, uint64_t value);
+  /// @brief Write the descriptors of a chunk list to device memory, growing it if required.
+  Status WriteList(List *list, std::vector<uint8_t> *descriptors, size_t count);
+
+  /// The platform of the kernel.
+  std::shared_ptr<Platform> platform_;
+  /// The offset of the register window of the kernel.
+  uint64_t mmio_base_ = 0;
+  /// The chunk lists, in order of the registers.
+  std::vector<List> lists_;
+};
+
+}  // namespace fletcher
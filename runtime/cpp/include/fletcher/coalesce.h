@@ -0,0 +1,128 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Concatenates small RecordBatches of a reader into larger ones, such that a kernel is launched once for many.
+ *
+ * Every RecordBatch that a kernel processes pays for queueing, enabling, writing metadata, starting and polling,
+ * regardless of its size. A Coalescer reads RecordBatches of the same Schema from another reader and concatenates
+ * consecutive ones into a single RecordBatch, until adding the next one would exceed a number of rows or bytes, or
+ * until the first one has waited for some time. The offsets of list, string and binary fields are rebased.
+ *
+ * A Coalescer is an arrow::RecordBatchReader, so it can feed StreamingContext::Run(). The return registers of the kernel
+ * then hold the result of a coalesced RecordBatch. Results with a row for every row of a coalesced RecordBatch, e.g. a
+ * RecordBatch that a kernel wrote, are sliced back into a RecordBatch for every original one with Split().
+ */
+class Coalescer : public arrow::RecordBatchReader {
+ public:
+  /**
+   * @brief Construct a new Coalescer.
+   * @param[in] reader            The reader to obtain the RecordBatches from.
+   * @param[in] max_rows          The maximum number of rows of a coalesced RecordBatch, or 0 for no limit.
+   * @param[in] max_bytes         The maximum number of buffer bytes of a coalesced RecordBatch, or 0 for no limit.
+   * @param[in] max_latency_usec  The time after obtaining the first RecordBatch of a coalesced RecordBatch after which
+   *                              no more RecordBatches are added to it, in microseconds, or 0 for no limit.
+   * @param[in] pool              The pool to allocate the coalesced RecordBatches from.
+   */
+  Coalescer(std::shared_ptr<arrow::RecordBatchReader> reader,
+            int64_t max_rows,
+            int64_t max_bytes,
+            int64_t max_latency_usec,
+            arrow::MemoryPool *pool);
+
+  /**
+   * @brief Create a new Coalescer.
+   *
+   * A single RecordBatch that exceeds the limits by itself is passed on as is. A RecordBatch that is not coalesced
+   * with any other is passed on without copying it.
+   *
+   * @param[out] out               A pointer to a shared pointer that will own the new Coalescer.
+   * @param[in]  reader            The reader to obtain the RecordBatches from.
+   * @param[in]  max_rows          The maximum number of rows of a coalesced RecordBatch, or 0 for no limit.
+   * @param[in]  max_bytes         The maximum number of buffer bytes of a coalesced RecordBatch, or 0 for no limit.
+   * @param[in]  max_latency_usec  The time after obtaining the first RecordBatch of a coalesced RecordBatch after
+   *                               which no more RecordBatches are added to it, in microseconds, or 0 for no limit.
+   * @param[in]  pool              The pool to allocate the coalesced RecordBatches from, e.g. a PinnedMemoryPool.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Coalescer> *out,
+                     const std::shared_ptr<arrow::RecordBatchReader> &reader,
+                     int64_t max_rows = 1 << 20,
+                     int64_t max_bytes = 64 * 1024 * 1024,
+                     int64_t max_latency_usec = 0,
+                     arrow::MemoryPool *pool = arrow::default_memory_pool());
+
+  /**
+   * @brief Return the next coalesced RecordBatch.
+   * @param[out] out The next coalesced RecordBatch, or nullptr if the reader is exhausted.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Next(std::shared_ptr<arrow::RecordBatch> *out);
+
+  /// @brief Return the Schema of the RecordBatches.
+  std::shared_ptr<arrow::Schema> schema() const override { return reader_->schema(); }
+
+  /// @brief Return the next coalesced RecordBatch as an arrow::RecordBatchReader, see Next().
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override;
+
+  /**
+   * @brief Slice a RecordBatch with a row for every row of a coalesced RecordBatch into one for every original one.
+   * @param[in]  index  The index of the coalesced RecordBatch, in the order in which they were returned.
+   * @param[in]  batch  The RecordBatch to slice, e.g. the results of a kernel. Must have at least as many rows as the
+   *                    coalesced RecordBatch.
+   * @param[out] out    A slice of \p batch for every original RecordBatch.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Split(size_t index,
+               const std::shared_ptr<arrow::RecordBatch> &batch,
+               std::vector<std::shared_ptr<arrow::RecordBatch>> *out) const;
+
+  /// @brief Return the number of rows of every original RecordBatch of a coalesced RecordBatch.
+  const std::vector<int64_t> &parts(size_t index) const { return parts_[index]; }
+
+  /// @brief Return the number of coalesced RecordBatches that were returned.
+  size_t num_coalesced() const { return parts_.size(); }
+
+ private:
+  /// The reader to obtain the RecordBatches from.
+  std::shared_ptr<arrow::RecordBatchReader> reader_;
+  /// The maximum number of rows of a coalesced RecordBatch.
+  int64_t max_rows_;
+  /// The maximum number of buffer bytes of a coalesced RecordBatch.
+  int64_t max_bytes_;
+  /// The time after which no more RecordBatches are added to a coalesced RecordBatch.
+  std::chrono::microseconds max_latency_;
+  /// The pool to allocate the coalesced RecordBatches from.
+  arrow::MemoryPool *pool_;
+  /// A RecordBatch that was read, but did not fit the previous coalesced RecordBatch.
+  std::shared_ptr<arrow::RecordBatch> held_;
+  /// Whether the reader is exhausted.
+  bool exhausted_ = false;
+  /// The number of rows of every original RecordBatch of every coalesced RecordBatch.
+  std::vector<std::vector<int64_t>> parts_;
+};
+
+}  // namespace fletcher
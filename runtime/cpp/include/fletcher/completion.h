@@ -0,0 +1,145 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletcher/platform.h"
+#include "fletcher/profiler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief A completion record in host memory, that the kernel writes when it is done (fletchgen --completion_record).
+ *
+ * Polling the status register is an uncached MMIO read across the device interface for every poll, which is slow and
+ * loads the control path of the device when many threads or processes poll. Instead, the hardware writes the status,
+ * result and cycles registers to a record in host memory when the kernel is done, and bumps its sequence number. The
+ * host waits for the sequence number to change in its own cache.
+ *
+ * Attach the record to a Kernel with Kernel::SetCompletionRecord(), after which the Kernel waits on the record and
+ * reads its return values and cycles from it, instead of from the registers.
+ *
+ * The registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest).
+ */
+class CompletionRecord {
+ public:
+  /// The layout of the record, as written by hardware/wrapper/CompletionWriter.vhd.
+  struct Record {
+    /// The result register.
+    uint64_t result;
+    /// The cycles register.
+    uint64_t cycles;
+    /// The status register.
+    uint32_t status;
+    /// Reserved.
+    uint32_t reserved0;
+    /// Incremented for every record written by the hardware. Never zero once written.
+    uint32_t sequence;
+    /// Reserved.
+    uint32_t reserved1;
+  };
+
+  /**
+   * @brief Allocate a completion record in device-visible host memory and pass its address to the kernel.
+   * @param[out] out        A pointer to a shared pointer that will own the new CompletionRecord.
+   * @param[in]  platform   The platform of the kernel, which must support Platform::HostMalloc().
+   * @param[in]  registers  The registers of the register manifest generated by fletchgen.
+   * @param[in]  mmio_base  The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<CompletionRecord> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::vector<MmioRegister> &registers,
+                     uint64_t mmio_base = 0);
+
+  /**
+   * @brief Allocate a completion record in device-visible host memory and pass its address to the kernel, using a
+   *        register manifest file.
+   * @param[out] out            A pointer to a shared pointer that will own the new CompletionRecord.
+   * @param[in]  platform       The platform of the kernel, which must support Platform::HostMalloc().
+   * @param[in]  manifest_path  The path of the register manifest generated by fletchgen.
+   * @param[in]  mmio_base      The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<CompletionRecord> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::string &manifest_path,
+                     uint64_t mmio_base = 0);
+
+  /// @brief Disable the write-back and free the record.
+  ~CompletionRecord();
+
+  /// @brief Remember the current sequence number, right before the kernel is started.
+  void Arm();
+
+  /// @brief Return true if the hardware wrote a record since the last call to Arm().
+  bool Done() const;
+
+  /**
+   * @brief Wait until the hardware wrote a record since the last call to Arm().
+   *
+   * Spins on the record for a short window, which gives the lowest latency for short kernels. With the WAITPKG
+   * instructions (-mwaitpkg), the core sleeps until the cache line of the record is written instead. After the window,
+   * the record is checked at an interval.
+   *
+   * @param[in] spin_usec           The window in which to spin on the record, in microseconds.
+   * @param[in] poll_interval_usec  The interval at which to check the record after the spin window.
+   * @param[in] timeout_usec        The time to wait, in microseconds. When 0, waits indefinitely.
+   * @return Status::OK() when the record was written, Status::TIMEOUT() when the timeout expired.
+   */
+  Status Wait(unsigned int spin_usec = 50, unsigned int poll_interval_usec = 100, unsigned int timeout_usec = 0);
+
+  /**
+   * @brief Return a copy of the last record written by the hardware.
+   *
+   * Only the fields of a record of which the sequence number was observed by Done() or Wait() are guaranteed to be
+   * complete.
+   */
+  Record Read() const;
+
+  /// @brief Return the host address of the record.
+  uint8_t *host() const { return host_; }
+  /// @brief Return the device address of the record.
+  da_t address() const { return address_; }
+
+ private:
+  explicit CompletionRecord(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+
+  /// @brief Return the sequence number of the last record written by the hardware.
+  uint32_t Sequence() const;
+
+  /// The platform of the kernel.
+  std::shared_ptr<Platform> platform_;
+  /// The offset of the register window of the kernel.
+  uint64_t mmio_base_ = 0;
+  /// The register holding the device address of the record.
+  MmioRegister address_reg_;
+  /// The host address of the record.
+  uint8_t *host_ = nullptr;
+  /// The device address of the record.
+  da_t address_ = D_NULLPTR;
+  /// The sequence number when the record was last armed.
+  uint32_t armed_ = 0;
+};
+
+}  // namespace fletcher
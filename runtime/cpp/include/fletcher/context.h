@@ -15,19 +15,30 @@
 #pragma once
 
 #include <arrow/api.h>
+#include <arrow/c/abi.h>
 #include <fletcher/common.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <memory>
+#include <string>
 #include <iostream>
 
 #include "fletcher/platform.h"
+#include "fletcher/pool.h"
+#include "fletcher/residency.h"
+#include "fletcher/stats.h"
 #include "fletcher/status.h"
+#include "fletcher/trace.h"
 
 namespace fletcher {
 
 using fletcher::Mode;
 
+struct MmioRegister;
+
 /// Enumeration for different types of memory management.
 enum class MemType {
   /**
@@ -36,6 +47,9 @@ enum class MemType {
    * For platforms where the device may access host memory directly, ANY will not copy data to device on-board
    * memory to make it available to the device. If the platform requires a copy to on-board memory, then this will
    * behave the same as the CACHE option.
+   *
+   * Buffers in device-visible host memory, e.g. allocated by a PinnedMemoryPool, are always used in place.
+   * Implicit buffers and buffers of ignored fields are never made available to the device.
    */
       ANY,
 
@@ -48,6 +62,9 @@ enum class MemType {
    *
    * Selecting CACHE may result in higher performance if there is data reuse by the kernel, but may result in lower
    * performance if the data is not reused by the kernel (for example fully streamable kernels).
+   *
+   * Buffers in device memory that is mapped into the host, e.g. allocated by a MappedMemoryPool, are on-board already
+   * and are used in place, for both CACHE and ANY.
    */
       CACHE
 };
@@ -60,6 +77,8 @@ struct DeviceBuffer {
   da_t device_address = D_NULLPTR;
   /// The size of this buffer in bytes.
   int64_t size = 0;
+  /// The number of bytes by which the kernel addresses the buffer before device_address, see BufferMetadata.
+  int64_t device_offset = 0;
 
   /// The memory type of this buffer.
   MemType memory = MemType::CACHE;
@@ -70,6 +89,16 @@ struct DeviceBuffer {
   bool available_to_device = false;
   /// Whether this buffer was allocated on the device using Platform malloc.
   bool was_alloced = false;
+  /// Whether this buffer was allocated from a DeviceMemoryPool.
+  bool pooled = false;
+  /// Whether this buffer was acquired from a ResidencyCache, which owns its device memory.
+  bool resident = false;
+  /// The number of bytes allocated on the device for this buffer, if it was allocated.
+  int64_t capacity = 0;
+  /// Whether this buffer was staged to meet the buffer alignment of the Context, see Context::SetBufferAlignment().
+  bool staged = false;
+  /// Whether this buffer is owned by another Context, see Context::QueueDeviceRecordBatch().
+  bool borrowed = false;
 
   /// @brief Construct a default DeviceBuffer.
   DeviceBuffer() = default;
@@ -77,6 +106,46 @@ struct DeviceBuffer {
   /// @brief Construct a new DeviceBuffer.
   DeviceBuffer(const uint8_t *host_address, int64_t size, MemType type, Mode access_mode)
       : host_address(host_address), size(size), memory(type), mode(access_mode) {}
+
+  /**
+   * @brief Return true if the device accesses the host memory of this buffer directly.
+   *
+   * The contents of such buffers, including data written by the kernel, can be viewed at host_address without copying.
+   * Other buffers must be copied from the device with Platform::CopyDeviceToHost().
+   */
+  bool host_visible() const {
+    return (host_address != nullptr) && !was_alloced && !pooled && !resident && !borrowed;
+  }
+
+  /// @brief Return the address of this buffer as written to the buffer address registers of the kernel.
+  da_t kernel_address() const {
+    return device_address == D_NULLPTR ? D_NULLPTR : device_address - static_cast<da_t>(device_offset);
+  }
+};
+
+/// Byte counts of the buffers of queued RecordBatches, for capacity planning. See Context::GetQueueSizes().
+struct QueueSizes {
+  /// The number of bytes copied from the host to the device, including the padding of staged buffers.
+  int64_t transfer = 0;
+  /// The number of bytes of device memory allocated, after padding to the alignment of the Context and its pool.
+  int64_t allocate = 0;
+  /// The number of bytes acquired from the ResidencyCache that need not be transferred.
+  int64_t resident = 0;
+  /// The number of bytes accessed by the kernel, i.e. the parts of the buffers it addresses.
+  int64_t kernel = 0;
+
+  /// @brief Add the byte counts of other sizes to these.
+  QueueSizes &operator+=(const QueueSizes &other);
+};
+
+/// Byte counts of the buffers of a single field of a queued RecordBatch.
+struct FieldQueueSizes {
+  /// The index of the RecordBatch.
+  size_t recordbatch = 0;
+  /// The name of the field.
+  std::string field;
+  /// The byte counts of the buffers of the field.
+  QueueSizes sizes;
 };
 
 /// A Context for a platform where a RecordBatches can be prepared for processing by the Kernel.
@@ -84,12 +153,19 @@ class Context {
  public:
   /**
    * @brief Context constructor.
+   *
+   * The buffer alignment is taken from the profile of the platform, see Platform::profile().
+   *
    * @param[in] platform  A platform to construct the context on.
    */
-  explicit Context(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+  explicit Context(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {
+    if (platform_ != nullptr) {
+      buffer_alignment_ = platform_->profile().buffer_alignment;
+    }
+  }
 
   /// @brief Deconstruct the context object, freeing all allocated device buffers.
-  ~Context();
+  virtual ~Context();
 
   /**
    * @brief Create a new context on a specific platform.
@@ -99,12 +175,57 @@ class Context {
    */
   static Status Make(std::shared_ptr<Context> *context, const std::shared_ptr<Platform> &platform);
 
+  /**
+   * @brief Create a new context on a specific platform that allocates cached buffers from a DeviceMemoryPool.
+   *
+   * The pool may be shared between Contexts, such that device memory is recycled rather than allocated and freed by
+   * the platform for every buffer. Buffers with MemType::ANY are still prepared by the platform.
+   *
+   * @param[out] context  A pointer to a shared pointer that will own the new Context.
+   * @param[in]  platform The platform to create the Context on.
+   * @param[in]  pool     The pool to allocate cached buffers from.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Context> *context,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::shared_ptr<DeviceMemoryPool> &pool);
+
+  /**
+   * @brief Acquire cached buffers from a ResidencyCache, rather than copying them to the device for this Context only.
+   *
+   * The buffers of read-mode RecordBatches with MemType::CACHE are then copied to the device only if they are not
+   * resident yet, e.g. because another Context, field or RecordBatch uses the same buffer. Buffers that do not fit in
+   * the budget of the cache are cached for this Context only. Must be set before Enable().
+   *
+   * @param[in] cache The cache to acquire buffers from. Must be of the same platform as the Context.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status SetResidencyCache(const std::shared_ptr<ResidencyCache> &cache);
+
   /**
    * @brief Enqueue an arrow::RecordBatch for usage on the device.
    *
    * This function utilizes Arrow metadata in the schema of the RecordBatch to determine whether or not some field
    * (i.e. some Array in the internal structure) will be used on the device.
    *
+   * Fields with compression metadata (see WithMetaCompression()) must hold a compressed values buffer, such as one
+   * created by MakeCompressedArray(). It is queued without decompressing it, and decompressed by the device.
+   *
+   * Fields with run-end encoding metadata (see WithMetaRunEndEncoding()) must hold their run ends and run values, such
+   * as an array created by MakeRunEndEncodedArray(). Only the runs are queued, and the device expands them.
+   *
+   * Fields with Parquet encoding metadata (see WithMetaParquetEncoding()) must hold the body of a data page, such as an
+   * array created by MakeParquetPageArray(). The page is queued without decoding it, and decoded by the device.
+   *
+   * Fields with parallel metadata (see WithMetaParallel()) are split into one list field per child of their struct, like
+   * fletchgen splits them, without copying any data. The queued RecordBatch, as returned by recordbatch(), is the split
+   * RecordBatch.
+   *
+   * MemType::ANY resolves to MemType::CACHE when the profile of the platform prefers caching, see Platform::profile().
+   *
+   * If a buffer layout is set for the Schema of the RecordBatch (see SetLayout()), its columns are arranged by name in
+   * the order of the buffer address registers, and columns that the kernel does not access are dropped.
+   *
    * @param[in] record_batch  The arrow::RecordBatch to queue
    * @param[in] mem_type      Force caching; i.e. the RecordBatch is guaranteed to be copied to on-board memory.
    * @return Status::OK() if successful, otherwise a descriptive error status.
@@ -112,12 +233,182 @@ class Context {
   Status QueueRecordBatch(const std::shared_ptr<arrow::RecordBatch> &record_batch,
                           MemType mem_type = MemType::ANY);
 
-  /// @brief Obtain the size (in bytes) of all buffers currently enqueued.
+  /**
+   * @brief Set the buffer layout of the kernel, such that queued RecordBatches are mapped to it by field name.
+   *
+   * Without a layout, the columns of a queued RecordBatch must be in the order of the Schema that fletchgen generated
+   * the kernel for. With a layout, the columns of RecordBatches of a Schema with the same name may be in any order, and
+   * may include extra columns. Every field of the kernel is looked up by name, and the buffers of its type must match
+   * the buffer address registers of the field. Columns without registers are dropped. The columns are arranged without
+   * copying any data, and recordbatch() and recordbatch_description() return the arranged RecordBatch.
+   *
+   * Must be called before RecordBatches are queued.
+   *
+   * @param[in] registers The registers of the register manifest generated by fletchgen.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status SetLayout(const std::vector<MmioRegister> &registers);
+
+  /**
+   * @brief Set the buffer layout of the kernel from a register manifest file, see SetLayout().
+   * @param[in] manifest_path The path of the register manifest generated by fletchgen (fletchgen.mmio.manifest).
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status LoadLayout(const std::string &manifest_path);
+
+  /**
+   * @brief Enqueue a RecordBatch exported through the Arrow C Data Interface, without copying it.
+   *
+   * This allows any Arrow implementation, e.g. in another language or another build of Arrow C++, to hand its buffers
+   * to the device. The array must be a struct array of which the children are the columns, as exported for a
+   * RecordBatch. The Context takes ownership of the array: it is released when the RecordBatch is no longer used. The
+   * schema is released once it is imported.
+   *
+   * @param[in] array     The exported struct array. Moved from, also when the import fails.
+   * @param[in] schema    The exported schema, including any Fletcher metadata. Moved from, also when the import fails.
+   * @param[in] mem_type  Force caching; i.e. the RecordBatch is guaranteed to be copied to on-board memory.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status QueueRecordBatch(struct ArrowArray *array, struct ArrowSchema *schema, MemType mem_type = MemType::ANY);
+
+  /**
+   * @brief Memory-map an Arrow IPC file and enqueue all its RecordBatches, without copying them on the host.
+   * @param[in] file_name The path to the Arrow IPC file.
+   * @param[in] mem_type  The memory type to use for the buffers of the RecordBatches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status QueueRecordBatchesFromFile(const std::string &file_name, MemType mem_type = MemType::ANY);
+
+  /**
+   * @brief Enqueue the output of the kernel of another Context as a RecordBatch to read, without a host round-trip.
+   *
+   * This chains kernels on the device: the RecordBatch that one kernel wrote is read by the next kernel, without
+   * reading it back to the host and copying it to the device again. The buffers of the queued RecordBatch are not made
+   * available to the device by Enable(); the kernel addresses the device buffers of the source Context directly.
+   *
+   * The source RecordBatch must have a write-mode Schema and must be enabled. Its buffers must not be replaced while
+   * this Context uses them, and the source kernel must be done before the kernel of this Context is started. The
+   * source Context is kept alive by this Context, such that its device buffers are not freed before this Context is.
+   *
+   * The host buffers of the queued RecordBatch are those of the source RecordBatch, which do not hold the output of the
+   * source kernel unless it was read back. The RecordBatch must therefore not be exported or read on the host.
+   *
+   * If a buffer layout is set for the Schema (see SetLayout()), its columns and their device buffers are arranged by
+   * name in the order of the buffer address registers of the kernel of this Context.
+   *
+   * @param[in] source    The Context of the kernel that wrote the RecordBatch. Must be of the same platform.
+   * @param[in] index     The index of the RecordBatch in the source Context.
+   * @param[in] num_rows  The number of rows written by the source kernel, or -1 if it wrote all rows.
+   * @param[in] schema    The Schema to read the RecordBatch with, which must have the same fields as the source Schema.
+   *                      Defaults to the source Schema with its mode set to read.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status QueueDeviceRecordBatch(const std::shared_ptr<Context> &source,
+                                size_t index,
+                                int64_t num_rows = -1,
+                                const std::shared_ptr<arrow::Schema> &schema = nullptr);
+
+  /**
+   * @brief Obtain the size (in bytes) of all buffers currently enqueued.
+   *
+   * This includes implicit buffers and buffers of ignored fields, which are not made available to the device. See
+   * GetQueueSizes() for the bytes transferred to, allocated on and accessed by the device.
+   */
   size_t GetQueueSize() const;
 
+  /**
+   * @brief Obtain the bytes transferred to, allocated on, resident on and accessed by the device for queued buffers.
+   *
+   * For buffers that were enabled, the sizes follow from how they were made available to the device. For buffers that
+   * were not, they are predicted from their memory type, the buffer alignment, the DeviceMemoryPool and the contents of
+   * the ResidencyCache. Whether the platform copies MemType::ANY buffers that are not in device-visible host memory is
+   * only known once they are enabled, so they are then counted as transferred and allocated. Allocations made by the
+   * platform rather than a pool are counted without any padding the platform may add.
+   *
+   * This allows a scheduler to decide whether further RecordBatches fit in device memory before enabling them.
+   *
+   * @param[out] fields Optional vector to which the sizes of every field of every RecordBatch are appended.
+   * @return The sizes of all buffers.
+   */
+  QueueSizes GetQueueSizes(std::vector<FieldQueueSizes> *fields = nullptr) const;
+
   /// @brief Enable the usage of the enqueued buffers by the device.
   Status Enable();
 
+  /**
+   * @brief Set the number of threads that Enable() uses to make buffers available to the device.
+   *
+   * With more than one thread, the buffers are prepared or cached concurrently, which speeds up Enable() on platforms
+   * with multiple DMA engines. The platform must then support concurrent transfers. The order of the device buffers
+   * is the same regardless of the number of threads.
+   *
+   * @param[in] num_threads The maximum number of threads. Zero is treated as one. The default is one.
+   */
+  void SetTransferThreads(size_t num_threads) { transfer_threads_ = num_threads == 0 ? 1 : num_threads; }
+
+  /**
+   * @brief Set the alignment that the buffers of read-mode RecordBatches must meet on the device, e.g. the bus word.
+   *
+   * Buffers of which the host address or the size is not a multiple of the alignment are staged: they are copied to a
+   * device allocation padded to a multiple of the alignment, and the padding is zeroed by the same transfer. Aligned
+   * buffers are made available to the device as usual. Buffers acquired from a ResidencyCache are not staged. Must be
+   * set before Enable().
+   *
+   * @param[in] alignment The alignment in bytes. Zero (the default) disables staging. Otherwise, a power of two.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status SetBufferAlignment(int64_t alignment);
+
+  /// @brief Return the alignment that the buffers of read-mode RecordBatches must meet on the device.
+  int64_t buffer_alignment() const { return buffer_alignment_; }
+
+  /**
+   * @brief Replace an enabled RecordBatch by another RecordBatch with the same layout.
+   *
+   * This allows a Context to be reused for a stream of RecordBatches of the same Schema, without re-enabling the
+   * Context. Device allocations are reused when the new buffers fit, and grown otherwise. The memory type of the
+   * buffers is unchanged. Afterwards, Kernel::UpdateMetaData() rewrites only the registers that changed.
+   *
+   * If a buffer layout is set for the Schema (see SetLayout()), the columns are arranged like in QueueRecordBatch().
+   *
+   * @param[in] index         The index of the RecordBatch to replace.
+   * @param[in] record_batch  The new RecordBatch. Must have the same buffers as the RecordBatch it replaces.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status ReplaceRecordBatch(size_t index, const std::shared_ptr<arrow::RecordBatch> &record_batch);
+
+  /**
+   * @brief Copy the buffers of a RecordBatch with a write-mode Schema back from the device, after the kernel is done.
+   *
+   * The results are copied into the host buffers of the RecordBatch that was queued. For string and binary fields, the
+   * offsets buffer is copied first, such that only the bytes of the values buffer that were written are copied.
+   * Buffers that the device accessed in host memory directly, i.e. that were not allocated on the device, are not
+   * copied at all; the returned RecordBatch then wraps the memory written by the device without copies.
+   *
+   * If the kernel reports how many rows it wrote, e.g. to a partition of a partitioned write schema, only the values of
+   * those rows are copied, and the returned RecordBatch is sliced to those rows.
+   *
+   * @param[in]  index    The index of the RecordBatch to read back.
+   * @param[out] out      The RecordBatch holding the results.
+   * @param[in]  num_rows The number of rows written by the kernel, or -1 if it wrote all rows of the RecordBatch.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status ReadbackRecordBatch(size_t index, std::shared_ptr<arrow::RecordBatch> *out, int64_t num_rows = -1);
+
+  /**
+   * @brief Export a queued RecordBatch through the Arrow C Data Interface, without copying it.
+   *
+   * RecordBatches with a write-mode Schema are read back first, see ReadbackRecordBatch(). The exported structs keep
+   * the host buffers alive until the consumer releases them, also after the Context is destroyed.
+   *
+   * @param[in]  index     The index of the RecordBatch to export.
+   * @param[out] array     The struct to export the RecordBatch to as a struct array.
+   * @param[out] schema    The struct to export the Schema of the RecordBatch to.
+   * @param[in]  num_rows  The number of rows written by the kernel, or -1. Only used for write-mode Schemas.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status ExportRecordBatch(size_t index, struct ArrowArray *array, struct ArrowSchema *schema, int64_t num_rows = -1);
+
   /// @brief Return the platform this context is active on.
   std::shared_ptr<Platform> platform() const { return platform_; }
 
@@ -141,9 +432,48 @@ class Context {
    */
   std::shared_ptr<arrow::RecordBatch> recordbatch(size_t i) const { return host_batches_[i]; }
 
+  /**
+   * @brief Return the description of the buffers of the i-th arrow::RecordBatch of this context.
+   *
+   * The device buffers of all RecordBatches are ordered like the buffers of their descriptions.
+   *
+   * @param[in] i The index of the arrow::RecordBatch.
+   * @return The description of its buffers.
+   */
+  const RecordBatchDescription &recordbatch_description(size_t i) const { return host_batch_desc_[i]; }
+
+  /**
+   * @brief Return a snapshot of the latency statistics of this Context and the Kernels operating in it.
+   *
+   * Every phase of preparing and launching a kernel, from queueing RecordBatches to kernel completion, is timed and
+   * aggregated into a histogram. The snapshot holds the count, mean, p50, p99 and maximum of every phase.
+   */
+  Stats GetStats() const { return instrumentation_.GetStats(); }
+
+  /// @brief Clear the latency statistics of this Context.
+  void ResetStats() { instrumentation_.Reset(); }
+
+  /**
+   * @brief Trace the phases of this Context and the Kernels operating in it to a Tracer, or stop tracing with nullptr.
+   *
+   * Every phase that is timed for the latency statistics is then also recorded as a span of the timeline of the
+   * Tracer. A Tracer may be shared between Contexts. Must not be called while RecordBatches are queued or enabled, or
+   * while Kernels operating in this Context are launched.
+   *
+   * @param[in] tracer The tracer to record spans to.
+   */
+  void SetTracer(const std::shared_ptr<Tracer> &tracer) { instrumentation_.SetTracer(tracer); }
+
+  /// @brief Return the latency histograms of this Context, to which Kernels operating in it record their phases.
+  Instrumentation &instrumentation() { return instrumentation_; }
+
  protected:
   /// The platform this context is running on.
   std::shared_ptr<Platform> platform_;
+  /// Optional pool to allocate cached buffers from.
+  std::shared_ptr<DeviceMemoryPool> pool_;
+  /// Optional cache to acquire cached buffers from.
+  std::shared_ptr<ResidencyCache> cache_;
   /// The RecordBatches on the host side.
   std::vector<std::shared_ptr<arrow::RecordBatch>> host_batches_;
   /// The descriptions of the RecordBatches on the host side.
@@ -152,6 +482,188 @@ class Context {
   std::vector<MemType> host_batch_memtype_;
   /// Prepared/cached buffers on the device.
   std::vector<DeviceBuffer> device_buffers_;
+  /// A compiled buffer layout, with descriptions of RecordBatches that are no longer used and can be refilled.
+  struct CachedLayout {
+    std::shared_ptr<RecordBatchLayout> layout;
+    std::vector<RecordBatchDescription> spare;
+  };
+  /// Compiled buffer layouts of the Schemas of queued RecordBatches, by the Schema they were compiled for. The layouts
+  /// own their Schemas, so a Schema address is never reused while it is a key.
+  std::unordered_map<const arrow::Schema *, CachedLayout> layouts_;
+  /// Protects the layouts, which are also used by threads that push to a StreamingContext.
+  std::mutex layouts_mutex_;
+  /// Latency histograms of all phases.
+  Instrumentation instrumentation_;
+  /// The maximum number of threads to enable buffers with.
+  size_t transfer_threads_ = 1;
+  /// The alignment that read buffers must meet on the device, or zero.
+  int64_t buffer_alignment_ = 0;
+  /// The device buffers borrowed from other Contexts, by the index of the RecordBatch they were queued as.
+  std::map<size_t, std::vector<DeviceBuffer>> device_batches_;
+  /// The Contexts that device buffers were borrowed from.
+  std::vector<std::shared_ptr<Context>> sources_;
+  /// The names of the buffer address registers of the kernel, in register order, by the name of their Schema.
+  std::map<std::string, std::vector<std::string>> buffer_layout_;
+
+  /**
+   * @brief Describe the buffers of a RecordBatch.
+   *
+   * Uses a compiled RecordBatchLayout for the Schema of the RecordBatch, which is created the first time a Schema is
+   * seen. Falls back to the RecordBatchAnalyzer for Schemas that can not be compiled. Descriptions passed to Recycle()
+   * are refilled, such that describing a RecordBatch of a known Schema does not allocate.
+   *
+   * The buffers of fields that the hardware ignores (see WithMetaIgnore()) are marked implicit. Implicit buffers are
+   * not accessed by the kernel, so they are not made available to the device and keep a null device address.
+   *
+   * @param[in]  record_batch The RecordBatch to describe.
+   * @param[out] desc         The resulting description.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Describe(const arrow::RecordBatch &record_batch, RecordBatchDescription *desc);
+
+  /**
+   * @brief Return a description that is no longer used, such that Describe() refills it for a RecordBatch of the same
+   *        Schema.
+   * @param[in] schema  The Schema of the described RecordBatch.
+   * @param[in] desc    The description.
+   */
+  void Recycle(const arrow::Schema &schema, RecordBatchDescription &&desc);
+
+  /// @brief Return the cached layout of a Schema, or nullptr if there is none. Must be called with the lock held.
+  CachedLayout *FindLayout(const arrow::Schema &schema);
+
+  /**
+   * @brief Arrange the columns of a described RecordBatch in the order of the buffer layout of its Schema.
+   *
+   * Columns are only reordered or dropped, so no data is copied.
+   *
+   * @param[in,out] record_batch  The RecordBatch to arrange.
+   * @param[in,out] desc          The description of the RecordBatch, of which the fields are arranged alike.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status ArrangeFields(std::shared_ptr<arrow::RecordBatch> *record_batch, RecordBatchDescription *desc) const;
+
+  /**
+   * @brief Make the buffers of a described RecordBatch available to the device.
+   *
+   * On platforms that support vectored copies, the buffers of a cached RecordBatch are allocated first and then
+   * copied with a single call to Platform::CopyHostToDeviceV().
+   *
+   * @param[in]  desc      The description of the RecordBatch.
+   * @param[in]  mem_type  The memory type to use for the buffers.
+   * @param[out] out       The vector to append the resulting DeviceBuffers to.
+   * @param[in]  owner     The owner of the host buffers. Buffers are only acquired from the ResidencyCache if known.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status EnableBuffers(const RecordBatchDescription &desc,
+                       MemType mem_type,
+                       std::vector<DeviceBuffer> *out,
+                       const std::shared_ptr<const void> &owner = nullptr);
+
+  /**
+   * @brief Make a single buffer available to the device, according to its host address, size and memory type.
+   * @param[in,out] device_buf The buffer to enable. Receives the device address and allocation flags.
+   * @param[in]     owner      The owner of the host buffer. The buffer is only acquired from the ResidencyCache if known.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status EnableBuffer(DeviceBuffer *device_buf, const std::shared_ptr<const void> &owner = nullptr);
+
+  /**
+   * @brief Return the byte counts of a single buffer of a queued RecordBatch.
+   * @param[in] buffer     The description of the buffer.
+   * @param[in] mode       The mode of its RecordBatch.
+   * @param[in] mem_type   The memory type of its RecordBatch.
+   * @param[in] device_buf The device buffer it was enabled as, or nullptr if it was not enabled.
+   * @return The byte counts of the buffer.
+   */
+  QueueSizes BufferSizes(const BufferMetadata &buffer,
+                         Mode mode,
+                         MemType mem_type,
+                         const DeviceBuffer *device_buf) const;
+
+  /**
+   * @brief Allocate device memory for a buffer, from the pool if the Context has one, without copying it.
+   * @param[in,out] device_buf The buffer to allocate. Receives the device address and allocation flags.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status AllocateBuffer(DeviceBuffer *device_buf);
+
+  /// @brief Return true if a buffer must be staged to meet the buffer alignment.
+  bool NeedsStaging(const DeviceBuffer &device_buf) const;
+
+  /**
+   * @brief Allocate a padded device buffer for a misaligned buffer and copy it, see SetBufferAlignment().
+   * @param[in,out] device_buf The buffer to stage. Receives the device address and allocation flags.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status StageBuffer(DeviceBuffer *device_buf);
+
+  /**
+   * @brief Copy a buffer to its padded device allocation, zeroing the padding in the same transfer.
+   * @param[in] device_buf The staged buffer.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status CopyStaged(const DeviceBuffer &device_buf);
+
+  /// @brief Enable the buffers of all queued RecordBatches using multiple threads.
+  Status EnableParallel();
+
+  /**
+   * @brief Check that the values buffers of compressed fields hold the uncompressed length of their values.
+   *
+   * Compressed buffers are made available to the device as is, such that only the compressed bytes are transferred.
+   * The device decompresses them from the start, so compressed columns can not be sliced.
+   *
+   * @param[in] record_batch  The RecordBatch to check.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status CheckCompressedFields(const arrow::RecordBatch &record_batch);
+
+  /**
+   * @brief Check that run-end encoded fields hold runs that cover all their rows.
+   *
+   * The run ends and values buffers are made available to the device as is, such that only the runs are transferred.
+   * The device expands the runs from the first run, so run-end encoded columns can not be sliced.
+   *
+   * @param[in] record_batch  The RecordBatch to check.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status CheckRunEndEncodedFields(const arrow::RecordBatch &record_batch);
+
+  /**
+   * @brief Check that Parquet-encoded fields hold a data page with the values of their rows.
+   *
+   * Pages are made available to the device as is, such that only the encoded bytes are transferred. The device decodes
+   * them from the start, so Parquet-encoded columns can not be sliced.
+   *
+   * @param[in] record_batch  The RecordBatch to check.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status CheckParquetEncodedFields(const arrow::RecordBatch &record_batch);
+
+  /**
+   * @brief Check that fields cached on-chip fit in their cache.
+   *
+   * The kernel preloads such fields into on-chip memory of the depth set by meta::ONCHIP before it looks up values, so
+   * the preload takes part in the run time of the kernel, rather than in the transfers of the Context.
+   *
+   * @param[in] record_batch  The RecordBatch to check.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status CheckOnChipFields(const arrow::RecordBatch &record_batch);
+
+  /// @brief Mark all buffers of fields with the ignore metadata key implicit.
+  static void MarkIgnoredFields(const arrow::Schema &schema, RecordBatchDescription *desc);
+
+  /// @brief Return the number of buffers of a described RecordBatch.
+  static size_t NumBuffers(const RecordBatchDescription &desc);
+
+  /**
+   * @brief Free the DeviceBuffers that were allocated on the device.
+   * @param[in] buffers The buffers to free.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status FreeBuffers(const std::vector<DeviceBuffer> &buffers);
 };
 
 }  // namespace fletcher
@@ -0,0 +1,152 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+#include "fletcher/residency.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Distributes work over the devices of a host.
+ *
+ * The pool holds an initialized Platform for every device, see Platform::MakeAll(). Before operating on some
+ * RecordBatches, a device is acquired from the pool according to its policy. Contexts for the device are created by the
+ * pool, and the device is released when the work is done. Applications that run work from multiple threads through
+ * Run() therefore use all devices without sharding the work themselves.
+ *
+ * Pools with a cache budget keep a ResidencyCache per device, which the Contexts of the pool use, such that buffers
+ * shared between batches stay resident on the device that processed them.
+ *
+ * All functions are thread-safe.
+ */
+class DevicePool {
+ public:
+  /// Policies to select a device.
+  enum class Policy {
+    /// Select the device with the fewest acquisitions in flight.
+    LEAST_LOADED,
+    /// Select the device on which most bytes of the RecordBatches are resident. Falls back to LEAST_LOADED on ties.
+    LOCALITY
+  };
+
+  /// Statistics of a device of the pool.
+  struct DeviceStats {
+    /// Number of times the device was acquired.
+    uint64_t acquisitions = 0;
+    /// Number of acquisitions that were not yet released.
+    size_t in_flight = 0;
+  };
+
+  /// Statistics of the pool.
+  struct Stats {
+    /// Statistics per device.
+    std::vector<DeviceStats> devices;
+    /// @brief Return a human-readable summary.
+    std::string ToString() const;
+  };
+
+  /**
+   * @brief Create a new DevicePool.
+   * @param[out] out           A pointer to a shared pointer that will own the new pool.
+   * @param[in]  platforms     Initialized platforms, one per device.
+   * @param[in]  policy        The policy to select a device.
+   * @param[in]  cache_budget  The budget of the ResidencyCache of every device, in bytes. Zero for no caches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<DevicePool> *out,
+                     const std::vector<std::shared_ptr<Platform>> &platforms,
+                     Policy policy = Policy::LEAST_LOADED,
+                     int64_t cache_budget = 0);
+
+  /**
+   * @brief Acquire a device to operate on some RecordBatches.
+   * @param[in]  batches  The RecordBatches to operate on. Used by the LOCALITY policy.
+   * @param[out] device   The index of the selected device.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Acquire(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, size_t *device);
+
+  /**
+   * @brief Release a device that was acquired before.
+   * @param[in] device The index of the device.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Release(size_t device);
+
+  /**
+   * @brief Create a new Context on a device, using the ResidencyCache of the device if the pool has one.
+   * @param[in]  device   The index of the device.
+   * @param[out] context  A pointer to a shared pointer that will own the new Context.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status MakeContext(size_t device, std::shared_ptr<Context> *context);
+
+  /**
+   * @brief Acquire a device, enable RecordBatches on it and launch a kernel on them.
+   *
+   * The launch function sets any arguments, starts the kernel and waits until it is done. The device is released
+   * afterwards, also when the launch fails.
+   *
+   * @param[in] batches   The RecordBatches to operate on.
+   * @param[in] launch    The function launching the kernel.
+   * @param[in] mem_type  The memory type of the RecordBatches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Run(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches,
+             const std::function<Status(Kernel *kernel)> &launch,
+             MemType mem_type = MemType::CACHE);
+
+  /// @brief Return the number of devices.
+  size_t num_devices() const { return platforms_.size(); }
+  /// @brief Return the platform of a device.
+  std::shared_ptr<Platform> platform(size_t device) const { return platforms_[device]; }
+  /// @brief Return the ResidencyCache of a device, or nullptr if the pool has no caches.
+  std::shared_ptr<ResidencyCache> cache(size_t device) const { return caches_.empty() ? nullptr : caches_[device]; }
+  /// @brief Return the policy to select a device.
+  Policy policy() const { return policy_; }
+  /// @brief Return the statistics of the pool.
+  Stats stats();
+
+ private:
+  DevicePool(std::vector<std::shared_ptr<Platform>> platforms, Policy policy);
+
+  /// @brief Return the number of bytes of some RecordBatches resident on every device.
+  std::vector<int64_t> ResidentBytes(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches);
+
+  /// The platform of every device.
+  std::vector<std::shared_ptr<Platform>> platforms_;
+  /// The ResidencyCache of every device, if any.
+  std::vector<std::shared_ptr<ResidencyCache>> caches_;
+  /// The policy to select a device.
+  Policy policy_;
+  /// Statistics per device.
+  std::vector<DeviceStats> devices_;
+  /// Mutex protecting the statistics.
+  std::mutex mutex_;
+};
+
+}  // namespace fletcher
@@ -0,0 +1,133 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "fletcher/kernel.h"
+#include "fletcher/status.h"
+#include "fletcher/streaming.h"
+
+namespace arrow {
+namespace flight {
+class FlightServerBase;
+}  // namespace flight
+}  // namespace arrow
+
+namespace fletcher {
+
+/**
+ * @brief Runs a kernel on the RecordBatches of Arrow Flight streams, and streams the results back.
+ *
+ * The kernel must be constructed on a StreamingContext. Every RecordBatch of a DoPut or DoExchange stream is pushed to
+ * the StreamingContext as it is received, without copying it on the host, such that it is transferred to the device
+ * while the kernel processes the previous RecordBatch. A single kernel serves all streams, so streams are processed one
+ * at a time.
+ *
+ * For DoPut streams, the return registers of the kernel are written back as eight bytes of application metadata per
+ * RecordBatch, where register 1 holds the upper 32 bits. For DoExchange streams, a RecordBatch obtained from a result
+ * function is written back per RecordBatch, e.g. one that was read back from the output of the kernel.
+ *
+ * The RecordBatches of a stream must hold the fields of the Schema of the service, which holds the Fletcher metadata.
+ * Serving requires that the run-time library was built with FLETCHER_FLIGHT, while Process() is always available.
+ */
+class FlightService {
+ public:
+  /**
+   * @brief Function that obtains the result of the kernel after it finished the RecordBatch with some index.
+   * @param[in]  index   The index of the RecordBatch in its stream.
+   * @param[in]  kernel  The kernel that processed the RecordBatch.
+   * @param[out] out     The RecordBatch to write back.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  using ResultFunction = std::function<Status(size_t index, Kernel *kernel, std::shared_ptr<arrow::RecordBatch> *out)>;
+
+  /// @brief Function that writes back the result for the RecordBatch with some index.
+  using ResultWriter = std::function<Status(size_t index, const std::shared_ptr<arrow::RecordBatch> &result)>;
+
+  /**
+   * @brief Construct a new FlightService.
+   * @param[in] kernel  The kernel to run, constructed on a StreamingContext.
+   * @param[in] schema  The Schema of the RecordBatches, including Fletcher metadata.
+   * @param[in] result  The function obtaining the result of every RecordBatch.
+   */
+  FlightService(std::shared_ptr<Kernel> kernel, std::shared_ptr<arrow::Schema> schema, ResultFunction result);
+
+  /// @brief Shut the server down, if it is serving.
+  ~FlightService();
+
+  /**
+   * @brief Create a new FlightService.
+   * @param[out] out     A pointer to a shared pointer that will own the new FlightService.
+   * @param[in]  kernel  The kernel to run, which must be constructed on a StreamingContext with at least two slots.
+   * @param[in]  schema  The Schema of the RecordBatches, including Fletcher metadata.
+   * @param[in]  result  The function obtaining the result of every RecordBatch. Defaults to a RecordBatch with a single
+   *                     uint64 "result" field holding the return registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<FlightService> *out,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::shared_ptr<arrow::Schema> &schema,
+                     const ResultFunction &result = nullptr);
+
+  /**
+   * @brief Run the kernel on every RecordBatch of a reader, and write back the result of every RecordBatch.
+   *
+   * This is what the server does for every stream, and may be called without a server, e.g. for other transports.
+   *
+   * @param[in] reader  The reader to obtain the RecordBatches from.
+   * @param[in] writer  The function writing back the results.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Process(arrow::RecordBatchReader *reader, const ResultWriter &writer);
+
+  /**
+   * @brief Serve DoPut and DoExchange streams at a location, until Shutdown() is called.
+   * @param[in] uri The location to serve at, e.g. "grpc+tcp://0.0.0.0:8815". Port 0 selects a free port.
+   * @return Status::OK() if the server was shut down, otherwise a descriptive error status.
+   */
+  Status Serve(const std::string &uri);
+
+  /// @brief Shut the server down. Streams that are being processed are finished first.
+  Status Shutdown();
+
+  /// @brief Return the port the server listens on, or 0 if it is not serving.
+  int port() const;
+
+  /// @brief Return the Schema of the RecordBatches.
+  std::shared_ptr<arrow::Schema> schema() const { return schema_; }
+
+ private:
+  /// The kernel to run.
+  std::shared_ptr<Kernel> kernel_;
+  /// The StreamingContext of the kernel.
+  std::shared_ptr<StreamingContext> context_;
+  /// The Schema of the RecordBatches.
+  std::shared_ptr<arrow::Schema> schema_;
+  /// The function obtaining the result of every RecordBatch.
+  ResultFunction result_;
+  /// Mutex serializing streams, since they share the kernel.
+  std::mutex kernel_mutex_;
+  /// The server, if serving.
+  std::shared_ptr<arrow::flight::FlightServerBase> server_;
+  /// Mutex protecting the server.
+  mutable std::mutex server_mutex_;
+};
+
+}  // namespace fletcher
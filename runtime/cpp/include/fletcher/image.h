@@ -0,0 +1,134 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// Statistics of an ImageCache.
+struct ImageCacheStats {
+  /// The number of acquisitions for which a region already held a matching image.
+  uint64_t hits = 0;
+  /// The number of acquisitions for which no region held a matching image.
+  uint64_t misses = 0;
+  /// The number of images that were loaded.
+  uint64_t loads = 0;
+  /// The number of loads that replaced an image in a region.
+  uint64_t evictions = 0;
+  /// The total time spent loading images, in seconds.
+  double load_seconds = 0.0;
+};
+
+/**
+ * @brief Keeps track of the images (bitstreams) loaded into the reconfigurable regions of a device.
+ *
+ * Applications register the image that implements every SchemaSet they use. When a kernel for some SchemaSet is
+ * required, the cache selects a region that already holds a matching image, and only programs an image on a miss. The
+ * least recently used region is reprogrammed, such that workloads that alternate between a few SchemaSets avoid most
+ * reloads. Images are identified by the schema hash register, see SchemaSetHash(), such that images that were loaded
+ * before the cache was created are found as well.
+ *
+ * Every region is the kernel instance with the register window of the same index. Platforms without partial
+ * reconfiguration have a single region.
+ *
+ * Acquiring is thread-safe, but reprogramming a region invalidates Kernels that operate on it. Applications must not
+ * acquire images while kernels that may be evicted are running.
+ */
+class ImageCache {
+ public:
+  /**
+   * @brief Construct a new ImageCache.
+   * @param[in] platform    The platform of the device.
+   * @param[in] num_regions The number of reconfigurable regions of the device.
+   * @param[in] window_regs The size of the register window of every region, in registers.
+   */
+  ImageCache(std::shared_ptr<Platform> platform, size_t num_regions, uint64_t window_regs);
+
+  /**
+   * @brief Create a new ImageCache.
+   * @param[out] out          A pointer to a shared pointer that will own the new ImageCache.
+   * @param[in]  platform     The platform of the device.
+   * @param[in]  num_regions  The number of reconfigurable regions of the device.
+   * @param[in]  window_regs  The size of the register window of every region, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ImageCache> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     size_t num_regions = 1,
+                     uint64_t window_regs = FLETCHER_INSTANCE_WINDOW_REGS);
+
+  /**
+   * @brief Register the image that implements a SchemaSet.
+   * @param[in] path        The path of the image file, passed to Platform::LoadImage().
+   * @param[in] schema_set  The schemas of the image, in the order of its RecordBatches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Register(const std::string &path, const std::vector<std::shared_ptr<arrow::Schema>> &schema_set);
+
+  /**
+   * @brief Select a region holding an image that implements a SchemaSet, loading the image on a miss.
+   * @param[in]  schema_set The schemas to implement, in the order of the RecordBatches of the Context.
+   * @param[out] mmio_base  The offset of the register window of the region, in registers. See Kernel::Kernel().
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Acquire(const std::vector<std::shared_ptr<arrow::Schema>> &schema_set, uint64_t *mmio_base);
+
+  /// @brief Return the statistics of the cache.
+  ImageCacheStats stats() const;
+
+  /// @brief Return the number of reconfigurable regions.
+  size_t num_regions() const { return regions_.size(); }
+
+ private:
+  /// The state of a reconfigurable region.
+  struct Region {
+    /// Whether the schema hash register of the region was read.
+    bool probed = false;
+    /// Whether the region holds an image.
+    bool loaded = false;
+    /// The schema hash of the image in the region.
+    uint32_t hash = 0;
+    /// The tick of the last acquisition of the region.
+    uint64_t last_use = 0;
+  };
+
+  /// The platform of the device.
+  std::shared_ptr<Platform> platform_;
+  /// The size of the register window of every region.
+  uint64_t window_regs_;
+  /// The regions of the device.
+  std::vector<Region> regions_;
+  /// The paths of the registered images, by schema hash.
+  std::map<uint32_t, std::string> images_;
+  /// Incremented on every acquisition, to order regions by their last use.
+  uint64_t tick_ = 0;
+  /// The statistics of the cache.
+  ImageCacheStats stats_;
+  /// Mutex protecting the state of the cache.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace fletcher
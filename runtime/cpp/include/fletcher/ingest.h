@@ -0,0 +1,177 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Decodes input, e.g. the row groups of a Parquet file, into RecordBatches on multiple threads ahead of use.
+ *
+ * The input is divided into units that are decoded independently, such as row groups. Worker threads decode the units
+ * in order, into buffers allocated from a memory pool. With a PinnedMemoryPool, the RecordBatches are decoded directly
+ * into memory the device can access, such that the Context uses them in place rather than copying them.
+ *
+ * The RecordBatches are returned in the order of their units. At most a number of units is decoded ahead of the
+ * RecordBatch that was returned last, which bounds the memory used by decoded RecordBatches that await processing.
+ *
+ * An Ingest is an arrow::RecordBatchReader, so it can feed StreamingContext::Run(), which transfers the next
+ * RecordBatch while the kernel processes the current one. The device is then kept busy while the threads decode ahead.
+ */
+class Ingest : public arrow::RecordBatchReader {
+ public:
+  /**
+   * @brief Function that decodes a single unit of input into a RecordBatch.
+   *
+   * Called on the worker threads, concurrently for different units.
+   *
+   * @param[in]  unit  The index of the unit to decode.
+   * @param[in]  pool  The pool to allocate the buffers of the RecordBatch from.
+   * @param[out] out   The decoded RecordBatch.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  using DecodeFunction = std::function<Status(size_t unit,
+                                              arrow::MemoryPool *pool,
+                                              std::shared_ptr<arrow::RecordBatch> *out)>;
+
+  /**
+   * @brief Construct a new Ingest and start its worker threads.
+   * @param[in] schema      The Schema of the decoded RecordBatches.
+   * @param[in] num_units   The number of units to decode.
+   * @param[in] decode      The function decoding a single unit.
+   * @param[in] num_threads The number of worker threads.
+   * @param[in] capacity    The maximum number of units decoded ahead of the RecordBatch returned last.
+   * @param[in] pool        The pool to allocate the decoded RecordBatches from.
+   */
+  Ingest(std::shared_ptr<arrow::Schema> schema,
+         size_t num_units,
+         DecodeFunction decode,
+         size_t num_threads,
+         size_t capacity,
+         arrow::MemoryPool *pool);
+
+  /// @brief Stop decoding and join the worker threads. Units that are being decoded are finished first.
+  ~Ingest() override;
+
+  /**
+   * @brief Create a new Ingest that decodes units with a function.
+   * @param[out] out          A pointer to a shared pointer that will own the new Ingest.
+   * @param[in]  schema       The Schema of the decoded RecordBatches.
+   * @param[in]  num_units    The number of units to decode.
+   * @param[in]  decode       The function decoding a single unit.
+   * @param[in]  num_threads  The number of worker threads.
+   * @param[in]  capacity     The maximum number of units decoded ahead of the RecordBatch returned last.
+   * @param[in]  pool         The pool to allocate the decoded RecordBatches from, e.g. a PinnedMemoryPool.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Ingest> *out,
+                     const std::shared_ptr<arrow::Schema> &schema,
+                     size_t num_units,
+                     const DecodeFunction &decode,
+                     size_t num_threads = 4,
+                     size_t capacity = 8,
+                     arrow::MemoryPool *pool = arrow::default_memory_pool());
+
+  /**
+   * @brief Create a new Ingest that decodes the row groups of a Parquet file, one RecordBatch per row group.
+   *
+   * The file is opened once and its metadata is parsed once. Every row group is decoded by a reader of its own, such
+   * that row groups are decoded in parallel. Only available if the run-time library was built with FLETCHER_PARQUET.
+   *
+   * @param[out] out          A pointer to a shared pointer that will own the new Ingest.
+   * @param[in]  file_name    The path to the Parquet file.
+   * @param[in]  schema       The Schema of the RecordBatches, including Fletcher metadata, of which the fields must
+   *                          match the columns of the file. Defaults to the Schema of the file.
+   * @param[in]  num_threads  The number of worker threads.
+   * @param[in]  capacity     The maximum number of row groups decoded ahead of the RecordBatch returned last.
+   * @param[in]  pool         The pool to allocate the decoded RecordBatches from, e.g. a PinnedMemoryPool.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status MakeParquet(std::shared_ptr<Ingest> *out,
+                            const std::string &file_name,
+                            const std::shared_ptr<arrow::Schema> &schema = nullptr,
+                            size_t num_threads = 4,
+                            size_t capacity = 8,
+                            arrow::MemoryPool *pool = arrow::default_memory_pool());
+
+  /**
+   * @brief Return the next decoded RecordBatch, in the order of the units. Blocks until it is decoded.
+   * @param[out] out The next RecordBatch, or nullptr if all units were returned.
+   * @return Status::OK() if successful, otherwise the status of the failed decode. Decoding stops after a failure.
+   */
+  Status Next(std::shared_ptr<arrow::RecordBatch> *out);
+
+  /// @brief Return the Schema of the decoded RecordBatches.
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  /// @brief Return the next decoded RecordBatch as an arrow::RecordBatchReader, see Next().
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override;
+
+  /// @brief Return the number of units to decode.
+  size_t num_units() const { return num_units_; }
+
+ private:
+  /// A decoded unit.
+  struct Decoded {
+    /// The status of decoding the unit.
+    Status status;
+    /// The decoded RecordBatch.
+    std::shared_ptr<arrow::RecordBatch> batch;
+  };
+
+  /// @brief Decode units until all units are decoded or the Ingest is destructed. Runs on the worker threads.
+  void DecodeUnits();
+
+  /// The Schema of the decoded RecordBatches.
+  std::shared_ptr<arrow::Schema> schema_;
+  /// The number of units to decode.
+  size_t num_units_;
+  /// The function decoding a single unit.
+  DecodeFunction decode_;
+  /// The maximum number of units decoded ahead of the RecordBatch returned last.
+  size_t capacity_;
+  /// The pool to allocate the decoded RecordBatches from.
+  arrow::MemoryPool *pool_;
+  /// The index of the next unit to decode.
+  size_t next_unit_ = 0;
+  /// The index of the unit of the next RecordBatch to return.
+  size_t next_batch_ = 0;
+  /// Units that were decoded but not returned yet.
+  std::map<size_t, Decoded> decoded_;
+  /// Whether the worker threads should stop.
+  bool stop_ = false;
+  /// The worker threads.
+  std::vector<std::thread> threads_;
+  /// Mutex protecting the units.
+  std::mutex mutex_;
+  /// Signals the worker threads that a RecordBatch was returned or that they should stop.
+  std::condition_variable decode_cv_;
+  /// Signals readers that a unit was decoded.
+  std::condition_variable ready_cv_;
+};
+
+}  // namespace fletcher
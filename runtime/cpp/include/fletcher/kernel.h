@@ -17,26 +17,66 @@
 #include <arrow/api.h>
 #include <fletcher/fletcher.h>
 #include <cstdint>
+#include <string>
 #include <vector>
 #include <memory>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
 
 #include "fletcher/context.h"
 #include "fletcher/platform.h"
+#include "fletcher/stats.h"
 
 namespace fletcher {
 
-/// The Kernel class is used to manage the computational kernel of the accelerator.
+class ImageCache;
+class CompletionRecord;
+
+/**
+ * @brief The Kernel class is used to manage the computational kernel of the accelerator.
+ *
+ * Kernels are not thread-safe, and all Kernels with the same register window share the registers of the device. Use a
+ * SubmissionQueue to launch a kernel instance from multiple threads.
+ */
 class Kernel {
  public:
   /**
    * @brief Construct a new kernel that can operate within a specific context.
-   * @param[in] context The context to operate in.
+   * @param[in] context   The context to operate in.
+   * @param[in] mmio_base The offset of the register window of the kernel, in registers. This is non-zero for all but
+   *                      the first instance of a kernel in designs with multiple instances.
+   */
+  explicit Kernel(std::shared_ptr<Context> context, uint64_t mmio_base = 0);
+
+  /// @brief Kernel destructor. Stops the completion monitor, failing any completions that are still pending.
+  ~Kernel();
+
+  /**
+   * @brief Create a new kernel for the RecordBatches of a context, on a region holding an image that implements them.
+   *
+   * The image is selected by an ImageCache from the schemas of the RecordBatches in the context, and is only loaded
+   * when no region holds it yet.
+   *
+   * @param[out] out      A pointer to a shared pointer that will own the new Kernel.
+   * @param[in]  context  The context to operate in. Its RecordBatches must have been queued.
+   * @param[in]  cache    The ImageCache of the device.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
    */
-  explicit Kernel(std::shared_ptr<Context> context);
+  static Status Make(std::shared_ptr<Kernel> *out, const std::shared_ptr<Context> &context, ImageCache *cache);
 
   /**
-   * @brief Returns true if the kernel implements an operation over a set of arrow::Schemas. Not implemented.
-   * @param[in] schema_set A vector of shared pointers to arrow::Schemas to check.
+   * @brief Returns true if the kernel implements an operation over a set of arrow::Schemas.
+   *
+   * Reads the schema hash register that Fletchgen generates for the kernel, and compares it to the SchemaSetHash of
+   * the schemas. Field names and metadata other than the access mode are not taken into account.
+   *
+   * @param[in] schema_set A vector of shared pointers to arrow::Schemas to check, in the order of the RecordBatches of
+   *                       the kernel.
    * @return Returns true if the kernel implements an operation over a set of arrow::Schemas.
    */
   bool ImplementsSchemaSet(const std::vector<std::shared_ptr<arrow::Schema>> &schema_set);
@@ -53,8 +93,20 @@ class Kernel {
    * @param[in] first             The first index of the range (inclusive).
    * @param[in] last              The last index of the range (exclusive).
    * @return Status::OK() if successful, otherwise a descriptive error status.
+   *
+   * Ranges beyond 32 bits require a kernel generated with 64-bit indices, see index_width.
    */
-  Status SetRange(size_t recordbatch_index, int32_t first, int32_t last);
+  Status SetRange(size_t recordbatch_index, int64_t first, int64_t last);
+
+  /**
+   * @brief Enable only a subset of the fields of all RecordBatches, such that the others are not fetched from memory.
+   * @param[in] fields  The names of the fields to enable. Every other field is disabled. When empty, all fields are
+   *                    enabled.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   *
+   * Requires a kernel generated with fletchgen --projection, see projection.
+   */
+  Status SetProjection(const std::vector<std::string> &fields);
 
   /**
    * @brief Set custom arguments to the kernel. Writes consecutive MMIO registers starting from custom register offset.
@@ -69,6 +121,41 @@ class Kernel {
    */
   Status Start();
 
+  /**
+   * @brief Start the kernel and monitor its completion asynchronously.
+   *
+   * Completion is monitored by a single background thread owned by this Kernel, such that the calling thread is free
+   * to prepare the next RecordBatch while the kernel is running. Pending completions are resolved in order.
+   *
+   * When the kernel is not done within the timeout, the monitor thread cancels it (see Cancel()) and resolves the
+   * completion with Status::TIMEOUT().
+   *
+   * @param[out] completion         A future that will hold the polling status once the done flag is asserted.
+   * @param[in]  poll_interval_usec The interval at which the monitor thread polls the Kernel.
+   * @param[in]  timeout_usec       The time after the start of the kernel after which it is cancelled, in microseconds.
+   *                                When 0, the kernel is awaited indefinitely.
+   * @return Status::OK() if the kernel was started, otherwise a descriptive error status.
+   */
+  Status StartAsync(std::shared_future<Status> *completion,
+                    unsigned int poll_interval_usec = 0,
+                    unsigned int timeout_usec = 0);
+
+  /**
+   * @brief Cancel a running kernel by asserting the stop bit of the control register.
+   *
+   * Kernels generated by Fletchgen stop issuing new commands to their ArrayReaders and ArrayWriters once stopped, such
+   * that outstanding bus transactions drain. The kernel itself is expected to unwind and assert done. When it does not
+   * within the timeout, the kernel is reset.
+   *
+   * A cancelled kernel is not recorded as a completion. The rows that the kernel consumed before it was stopped can be
+   * read with a ProgressCounter, if the kernel was generated with fletchgen --progress.
+   *
+   * @param[in] timeout_usec The time to wait for the kernel to assert done after stopping it, in microseconds.
+   * @return Status::OK() if the kernel stopped, Status::TIMEOUT() if it had to be reset, otherwise a descriptive error
+   *         status.
+   */
+  Status Cancel(unsigned int timeout_usec = 1000);
+
   /**
    * @brief Read the status register of the Kernel.
    * @param[out] status_out A pointer to a value to store the status.
@@ -84,12 +171,40 @@ class Kernel {
    */
   Status GetReturn(uint32_t *ret0, uint32_t *ret1 = nullptr);
 
+  /**
+   * @brief Read the number of kernel clock cycles of the last run of the Kernel, from start until done.
+   *
+   * The cycles are counted in hardware, so unlike the time measured by the host, they exclude the latency of starting
+   * the Kernel and of polling for completion. While the Kernel runs, the cycles counted so far are returned, of which
+   * the two halves may be read in different cycles.
+   *
+   * @param[out] cycles A pointer to a value to store the number of cycles.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status GetExecutionCycles(uint64_t *cycles);
+
+  /**
+   * @brief Read the kernel clock frequency that the Kernel was generated for.
+   * @param[out] hz A pointer to a value to store the frequency in Hz, which is 0 if it is not known.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status GetClockFrequency(uint32_t *hz);
+
+  /**
+   * @brief Read the execution time of the last run of the Kernel, from its cycles and clock frequency.
+   * @param[out] seconds A pointer to a value to store the execution time in seconds.
+   * @return Status::OK() if successful, otherwise a descriptive error status, e.g. if the frequency is not known.
+   */
+  Status GetExecutionTime(double *seconds);
+
   /**
    * @brief Poll (blocking) the done flag of the status register for assertion with an interval.
    * @param[in] poll_interval_usec The interval at which to poll the Kernel.
-   * @return Status::OK() when the kernel is finished, otherwise a descriptive error status.
+   * @param[in] timeout_usec       The time to wait for the kernel, in microseconds. When 0, waits indefinitely.
+   * @return Status::OK() when the kernel is finished, Status::TIMEOUT() when the timeout expired, otherwise a
+   *         descriptive error status.
    */
-  Status PollUntilDoneInterval(unsigned int poll_interval_usec);
+  Status PollUntilDoneInterval(unsigned int poll_interval_usec, unsigned int timeout_usec = 0);
 
   /**
    * @brief Poll the done flag of the status register for assertion (blocking). Polls at maximum speed.
@@ -99,30 +214,189 @@ class Kernel {
    */
   Status PollUntilDone();
 
+  /**
+   * @brief Wait (blocking) until the done flag of the status register is asserted, with low latency and CPU usage.
+   *
+   * If the platform supports interrupts, waits for interrupts and checks the status register after every interrupt or
+   * poll interval. Otherwise, polls at maximum speed for a short window, and then falls back to polling at an interval.
+   *
+   * The kernel keeps running when the timeout expires; it can then be cancelled with Cancel().
+   *
+   * @param[in] spin_usec           The window in which to poll at maximum speed, in microseconds.
+   * @param[in] poll_interval_usec  The poll interval after the spin window, or the interrupt timeout.
+   * @param[in] timeout_usec        The time to wait for the kernel, in microseconds. When 0, waits indefinitely.
+   * @return Status::OK() when the kernel is finished, Status::TIMEOUT() when the timeout expired, otherwise a
+   *         descriptive error status.
+   */
+  Status WaitUntilDone(unsigned int spin_usec = 50,
+                       unsigned int poll_interval_usec = 100,
+                       unsigned int timeout_usec = 0);
+
+  /**
+   * @brief Wait for the kernel through a completion record in host memory, instead of the status register.
+   *
+   * Every wait then checks the record in the cache of the host rather than reading the status register over MMIO, and
+   * GetReturn() and GetExecutionCycles() read the record of a completed run. Requires a kernel generated with fletchgen
+   * --completion_record. The record must be attached before the kernel is started.
+   *
+   * @param[in] record The completion record of the register window of this Kernel, or nullptr to detach it.
+   */
+  void SetCompletionRecord(std::shared_ptr<CompletionRecord> record);
+
   /// @brief Return the context of this Kernel.
   std::shared_ptr<Context> context();
 
+  /// @brief Return the offset of the register window of this Kernel, in registers.
+  uint64_t mmio_base() const { return mmio_base_; }
+
   /**
    * @brief Write RecordBatch metadata from the Context to the Kernel MMIO registers.
    * @return Status::OK() if successful, otherwise a descriptive error status.
    */
   Status WriteMetaData();
 
+  /**
+   * @brief Write the given values to the schema-derived registers, instead of the RecordBatch metadata of the Context.
+   *
+   * Used by e.g. ChunkList, of which the hardware holds a different number of RecordBatches than the Context.
+   *
+   * @param[in] regs The register values, in the layout of GatherMetaData().
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status WriteMetaData(const std::vector<uint32_t> &regs);
+
+  /**
+   * @brief Write only the RecordBatch metadata registers that changed since the metadata was last written.
+   *
+   * Use this after Context::ReplaceRecordBatch() to avoid rewriting all registers. Writes all metadata if it was not
+   * written before, or if the number of metadata registers changed.
+   *
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status UpdateMetaData();
+
+  /**
+   * @brief Gather the values of all schema-derived registers from the Context.
+   *
+   * These are the registers that WriteMetaData() writes, starting at FLETCHER_REG_SCHEMA: the first and last index of
+   * every RecordBatch, followed by the address of every buffer. With all_valid, these are followed by the all valid
+   * flag of every validity bitmap of the RecordBatches in read mode, which is set when the bitmap is implicit.
+   *
+   * @param[out] regs The register values.
+   */
+  void GatherMetaData(std::vector<uint32_t> *regs);
+
   // Default control and status values:
   /// Control register start command value.
   uint32_t ctrl_start = 1ul << FLETCHER_REG_CONTROL_START;
   /// Control register reset command value.
   uint32_t ctrl_reset = 1ul << FLETCHER_REG_CONTROL_RESET;
+  /// Control register stop command value.
+  uint32_t ctrl_stop = 1ul << FLETCHER_REG_CONTROL_STOP;
   /// Status register done value.
   uint32_t done_status = 1ul << FLETCHER_REG_STATUS_DONE;
   /// Status register done mask bits.
   uint32_t done_status_mask = 1ul << FLETCHER_REG_STATUS_DONE;
+  /**
+   * Width of the first and last index registers of every RecordBatch, either 32 or 64 bits. When 0, this is derived
+   * from the Context: Fletchgen generates 64-bit indices for designs with 64-bit offsets (LargeString, LargeBinary,
+   * LargeList).
+   */
+  uint32_t index_width = 0;
+  /**
+   * Whether the kernel was generated with an enable register for every field (fletchgen --projection). These
+   * registers are located between the buffer addresses and the custom registers.
+   */
+  bool projection = false;
+  /**
+   * Whether the kernel was generated with an all valid register for every validity bitmap (fletchgen --all_valid).
+   * These registers follow the buffer addresses, and are set for the validity bitmaps of fields without nulls, which
+   * are not transferred to the device.
+   */
+  bool all_valid = false;
+  /**
+   * Whether the kernel was generated with a 64-bit MMIO bus (fletchgen --mmio64). Consecutive registers are then
+   * written in aligned pairs with a single access each, if the platform supports 64-bit MMIO accesses.
+   */
+  bool mmio64 = false;
 
  protected:
   /// Whether RecordBatch metadata was written.
   bool metadata_written = false;
   /// The context that this kernel should operate on.
   std::shared_ptr<Context> context_;
+
+ private:
+  /// @brief Write a register in the register window of this Kernel.
+  Status WriteMMIO(uint64_t offset, uint32_t value);
+  /// @brief Write consecutive registers in the register window of this Kernel.
+  Status WriteMMIOBatch(uint64_t offset, const uint32_t *values, size_t count);
+  /// @brief Read a register in the register window of this Kernel.
+  Status ReadMMIO(uint64_t offset, uint32_t *value);
+  /// @brief Return the number of 32-bit registers that hold a first or last index.
+  size_t IndexRegisters() const;
+  /// @brief Return the number of field enable registers.
+  size_t ProjectionRegisters() const;
+  /// @brief Return the number of all valid registers.
+  size_t AllValidRegisters() const;
+  /// @brief Return the number of schema-derived registers, i.e. the offset of the field enable registers.
+  size_t MetaDataRegisters() const;
+
+  /// The schema-derived register values that were last written.
+  std::vector<uint32_t> metadata_;
+
+  /// The offset of the register window of this Kernel.
+  uint64_t mmio_base_;
+
+  /// A completion that is awaited by the monitor thread.
+  struct Completion {
+    /// The promise to fulfill once the kernel is done.
+    std::promise<Status> promise;
+    /// The interval at which to poll the Kernel.
+    unsigned int poll_interval_usec;
+    /// Started when the kernel was started.
+    Timer timer;
+    /// The time after which the kernel is cancelled, or the default time point if it is awaited indefinitely.
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  /// @brief Return the deadline of a timeout in microseconds from now, or the default time point if it is 0.
+  static std::chrono::steady_clock::time_point Deadline(unsigned int timeout_usec);
+  /// @brief Return true if a deadline returned by Deadline() has passed.
+  static bool Expired(const std::chrono::steady_clock::time_point &deadline);
+
+  /// @brief Record the completion latency of a launch timed by a timer started at kernel start, and clear the timer.
+  void RecordCompletion(Timer *timer);
+
+  /// Started whenever the kernel is started.
+  Timer launch_timer_;
+
+  /// The completion record that the kernel writes when it is done, if any.
+  std::shared_ptr<CompletionRecord> completion_record_;
+
+  /// @brief Resolve pending completions until the Kernel is destructed. Runs on the monitor thread.
+  void MonitorCompletions();
+
+  /// @brief Assert the stop bit, and wait for done until a timeout in microseconds, after which the kernel is reset.
+  Status Stop(unsigned int timeout_usec = 1000);
+
+  /// @brief Check whether the completion record was written, or else whether the done flag of the status register is
+  ///        asserted.
+  Status IsDone(bool *done);
+
+  /// @brief Wait for an interrupt if the platform supports it, otherwise sleep for the interval.
+  void Idle(unsigned int interval_usec);
+
+  /// The completion monitor thread. Started on the first call to StartAsync().
+  std::thread monitor_;
+  /// Mutex protecting the pending completions.
+  std::mutex monitor_mutex_;
+  /// Signals the monitor thread that there are pending completions or that it should stop.
+  std::condition_variable monitor_cv_;
+  /// Completions that are not yet resolved.
+  std::deque<Completion> pending_;
+  /// Whether the monitor thread should stop.
+  std::atomic<bool> monitor_stop_{false};
 };
 
 }  // namespace fletcher
@@ -0,0 +1,74 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/api.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief An arrow::MemoryPool that allocates device memory that is mapped into the address space of the host.
+ *
+ * Memory is allocated with Platform::DeviceMalloc and mapped with Platform::DeviceMap, e.g. through a write-combining
+ * mapping of a PCIe BAR. Arrow builders using this pool write straight into on-board memory of the device. Buffers
+ * built with it are recognized by Context::Enable() as resident, and are used in place for any MemType, without
+ * copying them.
+ *
+ * Reading from such memory is slow on most platforms, so the pool suits buffers that the host mostly writes.
+ */
+class MappedMemoryPool : public arrow::MemoryPool {
+ public:
+  /**
+   * @brief Construct a new MappedMemoryPool.
+   * @param[in] platform The platform to allocate memory with.
+   */
+  explicit MappedMemoryPool(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+
+  /**
+   * @brief Create a new MappedMemoryPool.
+   * @param[out] out       A pointer to a shared pointer that will own the new pool.
+   * @param[in]  platform  The platform to allocate memory with.
+   * @return Status::OK() if successful, an error status if the platform can not map device memory.
+   */
+  static Status Make(std::shared_ptr<MappedMemoryPool> *out, const std::shared_ptr<Platform> &platform);
+
+  arrow::Status Allocate(int64_t size, uint8_t **out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) override;
+  void Free(uint8_t *buffer, int64_t size) override;
+  int64_t bytes_allocated() const override { return bytes_allocated_; }
+  int64_t max_memory() const override { return max_memory_; }
+  std::string backend_name() const override { return "fletcher-mapped"; }
+
+  /// @brief Return the platform this pool allocates with.
+  std::shared_ptr<Platform> platform() const { return platform_; }
+
+ private:
+  /// The platform to allocate memory with.
+  std::shared_ptr<Platform> platform_;
+  /// Number of bytes currently allocated.
+  std::atomic<int64_t> bytes_allocated_{0};
+  /// Highest number of bytes allocated at any time.
+  std::atomic<int64_t> max_memory_{0};
+};
+
+}  // namespace fletcher
@@ -0,0 +1,69 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// Size of the node-local bounce buffer through which a thread stages copies from remote host memory.
+constexpr size_t kNumaBounceBytes = 4 * 1024 * 1024;
+
+/**
+ * @brief Return the NUMA node of the memory at some host address.
+ * @param[in] address The host address. The memory must have been touched, otherwise it is not placed on a node.
+ * @return The index of the node, or -1 if it is unknown.
+ */
+int NumaNodeOf(const void *address);
+
+/**
+ * @brief Restrict the calling thread to the CPUs of a NUMA node.
+ * @param[in] node The index of the node. Negative indices leave the thread unrestricted.
+ * @return Status::OK() if successful, otherwise a descriptive error status.
+ */
+Status PinThreadToNode(int node);
+
+/**
+ * @brief Check whether a host buffer lies on another NUMA node than the device of a platform.
+ *
+ * Returns false when the node of the device or of the buffer is unknown.
+ *
+ * @param[in] platform      The platform of the device.
+ * @param[in] host_address  The host address of the buffer.
+ * @return True if copies of the buffer should be staged through memory local to the device.
+ */
+bool IsNumaRemote(Platform *platform, const uint8_t *host_address);
+
+/**
+ * @brief Copy data from host memory to device memory, staging it through node-local memory if the source is remote.
+ *
+ * Host buffers on another NUMA node than the device are copied into a bounce buffer on the node of the device by the
+ * calling thread, chunk by chunk, such that the device only reads from local memory. Every thread has its own bounce
+ * buffer of kNumaBounceBytes. Other buffers are copied directly.
+ *
+ * @param[in] platform            The platform of the device.
+ * @param[in] host_source         Source pointer in host memory.
+ * @param[in] device_destination  Destination pointer in device memory.
+ * @param[in] size                The amount of bytes to copy.
+ * @return Status::OK() if successful, otherwise a descriptive error status.
+ */
+Status NumaCopyHostToDevice(Platform *platform, const uint8_t *host_source, da_t device_destination, int64_t size);
+
+}  // namespace fletcher
@@ -0,0 +1,185 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+#include "fletcher/stats.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Runs a kernel either on the device or through a host implementation, whichever is expected to be faster.
+ *
+ * For small batches, the fixed overhead of a launch exceeds the time a host implementation of the kernel takes. The
+ * Offloader holds a host implementation next to the function launching the kernel, and decides per batch where to run
+ * it using a cost model:
+ *
+ *   device: launch_ns + bytes * (transfer_ns_per_byte + device_ns_per_byte)
+ *   host:   bytes * host_ns_per_byte
+ *
+ * The launch overhead (metadata and start), the transfer time (allocations and copies) and the kernel time (start to
+ * done) are taken from the Instrumentation of the Context of every device run. The host time is measured around the
+ * host implementation. All parameters are exponential moving averages, such that the model follows changes in e.g.
+ * device load. Until both targets were measured, batches run on the target that was not measured yet, starting with
+ * the device.
+ *
+ * All functions are thread-safe.
+ */
+class Offloader {
+ public:
+  /// Targets to run a batch on.
+  enum class Target {
+    /// Launch the kernel on the device.
+    DEVICE,
+    /// Run the host implementation.
+    HOST
+  };
+
+  /// The function launching the kernel. It sets any arguments, starts the kernel and waits until it is done.
+  using LaunchFunction = std::function<Status(Kernel *kernel)>;
+  /// The host implementation of the kernel, operating on the same RecordBatches.
+  using HostFunction = std::function<Status(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches)>;
+
+  /// The cost model. Durations are in nanoseconds.
+  struct Model {
+    /// Fixed overhead of a device launch, i.e. writing the metadata and starting the kernel.
+    double launch_ns = 0.0;
+    /// Inverse bandwidth of transfers to the device.
+    double transfer_ns_per_byte = 0.0;
+    /// Time the kernel takes per byte, from start to done.
+    double device_ns_per_byte = 0.0;
+    /// Time the host implementation takes per byte.
+    double host_ns_per_byte = 0.0;
+    /// Number of device runs the model is based on.
+    uint64_t device_samples = 0;
+    /// Number of host runs the model is based on.
+    uint64_t host_samples = 0;
+
+    /// @brief Return the expected duration of running some bytes on the device.
+    double DeviceCost(int64_t bytes) const;
+    /// @brief Return the expected duration of running some bytes on the host.
+    double HostCost(int64_t bytes) const;
+    /// @brief Return the number of bytes from which the device is faster, or -1 if the host is always faster.
+    int64_t BreakEven() const;
+  };
+
+  /// Statistics of the Offloader.
+  struct Stats {
+    /// Number of runs on the device.
+    uint64_t device_runs = 0;
+    /// Number of runs on the host.
+    uint64_t host_runs = 0;
+    /// Number of bytes processed on the device.
+    int64_t device_bytes = 0;
+    /// Number of bytes processed on the host.
+    int64_t host_bytes = 0;
+    /// The current cost model.
+    Model model;
+    /// @brief Return a human-readable summary.
+    std::string ToString() const;
+  };
+
+  /**
+   * @brief Create a new Offloader.
+   * @param[out] out        A pointer to a shared pointer that will own the new Offloader.
+   * @param[in]  platform   The initialized platform of the device.
+   * @param[in]  launch     The function launching the kernel.
+   * @param[in]  host       The host implementation of the kernel.
+   * @param[in]  mem_type   The memory type of the RecordBatches on the device.
+   * @param[in]  smoothing  The weight of a new measurement in the moving averages of the model, in (0, 1].
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Offloader> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     LaunchFunction launch,
+                     HostFunction host,
+                     MemType mem_type = MemType::ANY,
+                     double smoothing = 0.25);
+
+  /**
+   * @brief Decide where to run some RecordBatches, without running them.
+   * @param[in]  batches  The RecordBatches.
+   * @param[out] target   The target that is expected to be faster.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Decide(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, Target *target);
+
+  /**
+   * @brief Run the kernel on some RecordBatches, on the target that is expected to be faster.
+   * @param[in]  batches  The RecordBatches.
+   * @param[out] target   Optionally, the target the RecordBatches ran on.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Run(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, Target *target = nullptr);
+
+  /**
+   * @brief Run the kernel on some RecordBatches on a specific target. The run updates the model.
+   * @param[in] target   The target to run on.
+   * @param[in] batches  The RecordBatches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status RunOn(Target target, const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches);
+
+  /// @brief Replace the model, e.g. with one measured by an earlier run of the application.
+  void SetModel(const Model &model);
+  /// @brief Return the statistics of the Offloader.
+  Stats stats();
+  /// @brief Return the platform of the device.
+  std::shared_ptr<Platform> platform() const { return platform_; }
+
+  /// @brief Return the number of bytes of the buffers of some RecordBatches.
+  static int64_t BatchBytes(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches);
+
+ private:
+  Offloader(std::shared_ptr<Platform> platform, LaunchFunction launch, HostFunction host, MemType mem_type,
+            double smoothing);
+
+  /// @brief Run on the device and measure the run.
+  Status RunDevice(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, int64_t bytes);
+  /// @brief Run on the host and measure the run.
+  Status RunHost(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, int64_t bytes);
+  /// @brief Return the target that is expected to be faster for some bytes. Requires mutex_.
+  Target DecideBytes(int64_t bytes) const;
+  /// @brief Update a moving average of the model with a new measurement. Requires mutex_.
+  void Update(double *average, double value, uint64_t samples) const;
+
+  /// The platform of the device.
+  std::shared_ptr<Platform> platform_;
+  /// The function launching the kernel.
+  LaunchFunction launch_;
+  /// The host implementation.
+  HostFunction host_;
+  /// The memory type of the RecordBatches on the device.
+  MemType mem_type_;
+  /// The weight of a new measurement.
+  double smoothing_;
+  /// The statistics, including the model.
+  Stats stats_;
+  /// Mutex protecting the statistics.
+  std::mutex mutex_;
+};
+
+}  // namespace fletcher
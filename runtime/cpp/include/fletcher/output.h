@@ -0,0 +1,187 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletcher/kernel.h"
+#include "fletcher/profiler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// The number of bytes that a kernel wrote to a buffer of a RecordBatch with a write-mode Schema.
+struct OutputBuffer {
+  /// The index of the RecordBatch in the Context.
+  size_t recordbatch = 0;
+  /// The index of the buffer in the device buffers of the Context.
+  size_t device_buffer = 0;
+  /// The description of the buffer, e.g. "String_values".
+  std::string name;
+  /// The number of bytes that the kernel wrote.
+  int64_t written = 0;
+  /// The number of bytes available to the kernel, i.e. the size of the buffer or of its device allocation.
+  int64_t capacity = 0;
+
+  /// @brief Return true if the kernel wrote more bytes than were available.
+  bool overflow() const { return written > capacity; }
+};
+
+/**
+ * @brief Reads out the output count registers that fletchgen generates with --output_counts.
+ *
+ * For every stream of every field of a write-mode Schema, the hardware counts the number of elements that the kernel
+ * wrote since it was last started. From these counts, the OutputCounter derives the number of bytes written to every
+ * buffer of the write-mode RecordBatches of the Context of a Kernel. This allows the host to allocate the values
+ * buffers of list and string fields from an estimate, and to launch the kernel again with larger buffers if the
+ * estimate was too small.
+ *
+ * The registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest). They must match the write-mode RecordBatches of the Context, in order.
+ */
+class OutputCounter {
+ public:
+  /**
+   * @brief Create a new OutputCounter for a Kernel from a register manifest file.
+   * @param[out] counter       A pointer to a shared pointer that will own the new OutputCounter.
+   * @param[in]  kernel        The kernel of which the output counts are read out.
+   * @param[in]  manifest_path The path of the register manifest generated by fletchgen.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<OutputCounter> *counter,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::string &manifest_path);
+
+  /**
+   * @brief Create a new OutputCounter for a Kernel from parsed manifest registers.
+   * @param[out] counter    A pointer to a shared pointer that will own the new OutputCounter.
+   * @param[in]  kernel     The kernel of which the output counts are read out.
+   * @param[in]  registers  The registers of the manifest.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<OutputCounter> *counter,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::vector<MmioRegister> &registers);
+
+  /**
+   * @brief Read the output counts and derive the number of bytes written to every output buffer.
+   *
+   * Must be called after the kernel is done. Implicit buffers, which are not made available to the device, are
+   * skipped.
+   *
+   * @param[out] buffers  The buffers of all write-mode RecordBatches of the Context, in device buffer order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read(std::vector<OutputBuffer> *buffers);
+
+  /**
+   * @brief Launch a kernel, and launch it again with larger output buffers if its output did not fit.
+   *
+   * After every launch, the output buffers are read. If the kernel wrote more bytes to any buffer than were available,
+   * the grow function is called with all output buffers. It should replace the write-mode RecordBatches by larger ones
+   * with Context::ReplaceRecordBatch(), and rewrite their metadata with Kernel::UpdateMetaData(), after which the kernel
+   * is launched again.
+   *
+   * A kernel still writes the bytes that did not fit past the end of a buffer that was too small, so the device memory
+   * behind output buffers must not hold data that is needed afterwards.
+   *
+   * @param[in]  launch       A function that launches the kernel and waits until it is done.
+   * @param[in]  grow         A function that grows the output buffers to at least the number of bytes written.
+   * @param[out] buffers      The output buffers of the last launch.
+   * @param[in]  max_attempts The maximum number of launches.
+   * @return Status::OK() if the output of the last launch fit, otherwise a descriptive error status.
+   */
+  Status Run(const std::function<Status()> &launch,
+             const std::function<Status(const std::vector<OutputBuffer> &)> &grow,
+             std::vector<OutputBuffer> *buffers,
+             size_t max_attempts = 2);
+
+  /// @brief Return the names of all counted streams, in manifest order.
+  std::vector<std::string> streams() const;
+
+ private:
+  explicit OutputCounter(std::shared_ptr<Kernel> kernel) : kernel_(std::move(kernel)) {}
+
+  /// The kernel of which the output counts are read out.
+  std::shared_ptr<Kernel> kernel_;
+  /// The count register of every stream.
+  std::vector<MmioRegister> counts_;
+};
+
+/// The number of rows that a kernel consumed from a RecordBatch with a read-mode Schema.
+struct RecordBatchProgress {
+  /// The index of the RecordBatch in the Context.
+  size_t recordbatch = 0;
+  /// The number of rows, counted from the first index of the range of the RecordBatch.
+  int64_t consumed = 0;
+};
+
+/**
+ * @brief Reads out the progress registers that fletchgen generates with --progress.
+ *
+ * For every read-mode RecordBatch, the hardware counts the rows of its first field that the kernel consumed since it
+ * was last started. After a kernel is cancelled with Kernel::Cancel(), the host can process the rows that remain, i.e.
+ * [first + consumed, last) of the range of every RecordBatch, on the CPU instead.
+ *
+ * The registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest). They must match the read-mode RecordBatches of the Context that have any fields that are
+ * not ignored by the hardware, in order.
+ */
+class ProgressCounter {
+ public:
+  /**
+   * @brief Create a new ProgressCounter for a Kernel from a register manifest file.
+   * @param[out] counter       A pointer to a shared pointer that will own the new ProgressCounter.
+   * @param[in]  kernel        The kernel of which the progress is read out.
+   * @param[in]  manifest_path The path of the register manifest generated by fletchgen.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ProgressCounter> *counter,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::string &manifest_path);
+
+  /**
+   * @brief Create a new ProgressCounter for a Kernel from parsed manifest registers.
+   * @param[out] counter    A pointer to a shared pointer that will own the new ProgressCounter.
+   * @param[in]  kernel     The kernel of which the progress is read out.
+   * @param[in]  registers  The registers of the manifest.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ProgressCounter> *counter,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::vector<MmioRegister> &registers);
+
+  /**
+   * @brief Read the number of rows consumed from every read-mode RecordBatch.
+   * @param[out] progress The progress of every counted read-mode RecordBatch of the Context, in order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read(std::vector<RecordBatchProgress> *progress);
+
+ private:
+  explicit ProgressCounter(std::shared_ptr<Kernel> kernel) : kernel_(std::move(kernel)) {}
+
+  /// The kernel of which the progress is read out.
+  std::shared_ptr<Kernel> kernel_;
+  /// The progress register of every counted RecordBatch.
+  std::vector<MmioRegister> consumed_;
+};
+
+}  // namespace fletcher
@@ -0,0 +1,105 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/profiler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief The output RecordBatches of the partitions of a partitioned write-mode Schema.
+ *
+ * A write-mode Schema with partitioning metadata (see WithMetaPartitions()) is expanded by fletchgen into one Schema
+ * per partition, each with its own RecordBatchWriter. The kernel writes every row to the partition selected by the hash
+ * of its key field, and reports the number of rows it wrote to every partition in the <name>_rows register of the
+ * partition. This allows the output of a kernel to be shuffled, e.g. over a network, without scanning it on the host.
+ *
+ * A PartitionedOutput allocates an output RecordBatch for every partition, queues them on a Context, and reads them
+ * back as separate RecordBatches holding only the rows that the kernel wrote.
+ */
+class PartitionedOutput {
+ public:
+  /**
+   * @brief Allocate the output RecordBatches of the partitions of a partitioned write-mode Schema.
+   *
+   * Only fixed-width, string and binary fields are supported. Every partition can hold all rows, because the kernel
+   * may write all rows to the same partition.
+   *
+   * @param[out] output  A pointer to a shared pointer that will own the new PartitionedOutput.
+   * @param[in]  schema  The partitioned write-mode Schema.
+   * @param[in]  rows    The number of rows every partition can hold.
+   * @param[in]  values  The number of bytes of the values buffers of string and binary fields of every partition.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<PartitionedOutput> *output,
+                     const std::shared_ptr<arrow::Schema> &schema,
+                     int64_t rows,
+                     int64_t values = 0);
+
+  /**
+   * @brief Queue the output RecordBatches of all partitions on a Context, in partition order.
+   * @param[in] context   The Context to queue the RecordBatches on.
+   * @param[in] mem_type  The type of memory to allocate for the RecordBatches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Queue(Context *context, MemType mem_type = MemType::ANY);
+
+  /**
+   * @brief Read back the rows that a kernel wrote to every partition, after it is done.
+   * @param[in]  kernel     The kernel that wrote the partitions. Its Context must be the one they were queued on.
+   * @param[in]  registers  The registers of the register manifest generated by fletchgen.
+   * @param[out] out        One RecordBatch per partition, holding the rows that the kernel wrote to it.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read(Kernel *kernel,
+              const std::vector<MmioRegister> &registers,
+              std::vector<std::shared_ptr<arrow::RecordBatch>> *out);
+
+  /**
+   * @brief Read back the rows that a kernel wrote to every partition, using a register manifest file.
+   * @param[in]  kernel         The kernel that wrote the partitions.
+   * @param[in]  manifest_path  The path of the register manifest generated by fletchgen.
+   * @param[out] out            One RecordBatch per partition, holding the rows that the kernel wrote to it.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read(Kernel *kernel, const std::string &manifest_path, std::vector<std::shared_ptr<arrow::RecordBatch>> *out);
+
+  /// @brief Return the number of partitions.
+  size_t num_partitions() const { return recordbatches_.size(); }
+
+  /// @brief Return the allocated output RecordBatch of every partition.
+  const std::vector<std::shared_ptr<arrow::RecordBatch>> &recordbatches() const { return recordbatches_; }
+
+ private:
+  PartitionedOutput() = default;
+
+  /// The output RecordBatch of every partition.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> recordbatches_;
+  /// Whether the RecordBatches were queued on a Context.
+  bool queued_ = false;
+  /// The index of the RecordBatch of the first partition in the Context.
+  size_t first_ = 0;
+};
+
+}  // namespace fletcher
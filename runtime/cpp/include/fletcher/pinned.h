@@ -0,0 +1,70 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief An arrow::MemoryPool that allocates host memory that the device can access directly.
+ *
+ * Memory is allocated with Platform::HostMalloc, e.g. pinned, huge-page-backed memory that is mapped into the address
+ * space of the device. Arrow buffers built with this pool are recognized by Context::Enable(), which then uses them
+ * in place for MemType::ANY, without preparing or copying them.
+ */
+class PinnedMemoryPool : public arrow::MemoryPool {
+ public:
+  /**
+   * @brief Construct a new PinnedMemoryPool.
+   * @param[in] platform The platform to allocate memory with.
+   */
+  explicit PinnedMemoryPool(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+
+  /**
+   * @brief Create a new PinnedMemoryPool.
+   * @param[out] out       A pointer to a shared pointer that will own the new pool.
+   * @param[in]  platform  The platform to allocate memory with.
+   * @return Status::OK() if successful, an error status if the platform does not support device-visible host memory.
+   */
+  static Status Make(std::shared_ptr<PinnedMemoryPool> *out, const std::shared_ptr<Platform> &platform);
+
+  arrow::Status Allocate(int64_t size, uint8_t **out) override;
+  arrow::Status Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) override;
+  void Free(uint8_t *buffer, int64_t size) override;
+  int64_t bytes_allocated() const override { return bytes_allocated_; }
+  int64_t max_memory() const override { return max_memory_; }
+  std::string backend_name() const override { return "fletcher-pinned"; }
+
+  /// @brief Return the platform this pool allocates with.
+  std::shared_ptr<Platform> platform() const { return platform_; }
+
+ private:
+  /// The platform to allocate memory with.
+  std::shared_ptr<Platform> platform_;
+  /// Number of bytes currently allocated.
+  std::atomic<int64_t> bytes_allocated_{0};
+  /// Highest number of bytes allocated at any time.
+  std::atomic<int64_t> max_memory_{0};
+};
+
+}  // namespace fletcher
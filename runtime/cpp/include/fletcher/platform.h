@@ -15,9 +15,13 @@
 #pragma once
 
 #include <dlfcn.h>
+#include <fletcher/fletcher.h>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <cassert>
 
 #include "fletcher/status.h"
@@ -28,9 +32,72 @@
 #define DYLIB_EXT ".so"
 #endif
 
+#ifdef FLETCHER_STATIC_PLATFORM
+// With the FLETCHER_STATIC_PLATFORM CMake option, the library of a single platform is linked into the run-time, instead
+// of being opened at run-time. Its functions are declared here, the optional ones weakly, such that they are null when
+// the platform does not export them.
+extern "C" {
+fstatus_t platformGetName(char *name, size_t size);
+fstatus_t platformInit(void *arg);
+fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value);
+fstatus_t platformReadMMIO(uint64_t offset, uint32_t *value);
+fstatus_t platformDeviceMalloc(da_t *device_address, int64_t size);
+fstatus_t platformDeviceFree(da_t device_address);
+fstatus_t platformCopyHostToDevice(const uint8_t *host_source, da_t device_destination, int64_t size);
+fstatus_t platformCopyDeviceToHost(const da_t device_source, uint8_t *host_destination, int64_t size);
+fstatus_t platformPrepareHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size, int *alloced);
+fstatus_t platformCacheHostBuffer(const uint8_t *host_source, da_t *device_destination, int64_t size);
+fstatus_t platformTerminate(void *arg);
+__attribute__((weak)) fstatus_t platformWriteMMIOBatch(uint64_t offset, const uint32_t *values, uint64_t count);
+__attribute__((weak)) fstatus_t platformWriteMMIO64(uint64_t offset, uint64_t value);
+__attribute__((weak)) fstatus_t platformReadMMIO64(uint64_t offset, uint64_t *value);
+__attribute__((weak)) fstatus_t platformWaitForInterrupt(uint64_t timeout_usec);
+__attribute__((weak)) fstatus_t platformHostMalloc(uint8_t **host_address, da_t *device_address, int64_t size);
+__attribute__((weak)) fstatus_t platformHostFree(uint8_t *host_address);
+__attribute__((weak)) fstatus_t platformDeviceMap(da_t device_address, int64_t size, uint8_t **host_address);
+__attribute__((weak)) fstatus_t platformDeviceUnmap(uint8_t *host_address, int64_t size);
+__attribute__((weak)) fstatus_t platformCopyHostToDeviceV(const fiov_t *iov, uint64_t count);
+__attribute__((weak)) fstatus_t platformLoadImage(const char *path, uint64_t region);
+__attribute__((weak)) fstatus_t platformGetDeviceCount(uint64_t *count);
+__attribute__((weak)) fstatus_t platformSetDevice(uint64_t device);
+__attribute__((weak)) fstatus_t platformGetNumaNode(int64_t *node);
+}
+/// Call a function of the statically linked platform directly, such that it resolves at compile time and can be
+/// inlined with link-time optimization.
+#define FLETCHER_PLATFORM_CALL(function) ::function
+#else
+/// Call a function of the platform through the pointer that was resolved when the platform library was opened.
+#define FLETCHER_PLATFORM_CALL(function) function
+#endif
+
 namespace fletcher {
 
-/// A Fletcher Platform. Links during run-time and abstracts access to lower-level platform-specific libraries / API's.
+/**
+ * @brief Run-time hints of a platform profile, as written by fletchgen --platform to fletchgen.platform.profile.
+ *
+ * Platform::Make() loads the profile file that the FLETCHER_PLATFORM_PROFILE environment variable points to, if set.
+ */
+struct PlatformProfile {
+  /// The name of the platform, or empty if no profile was loaded.
+  std::string name;
+  /// Alignment of the device addresses of buffers in bytes, applied by every Context, see Context::SetBufferAlignment().
+  int64_t buffer_alignment = 0;
+  /// Whether buffers queued with MemType::ANY are cached, i.e. copied to on-board memory.
+  bool cache = false;
+  /// The window in which to poll a kernel at maximum speed, in microseconds, see Kernel::WaitUntilDone().
+  unsigned int spin_usec = 50;
+  /// The poll interval after the spin window, in microseconds, see Kernel::WaitUntilDone().
+  unsigned int poll_interval_usec = 100;
+};
+
+/**
+ * @brief A Fletcher Platform. Links during run-time and abstracts access to lower-level platform-specific libraries /
+ *        API's.
+ *
+ * When the run-time is built with the FLETCHER_STATIC_PLATFORM CMake option, the library of that platform is linked
+ * into the run-time instead, and it is the only platform that can be made. The MMIO and copy operations then call
+ * the platform functions directly rather than through function pointers.
+ */
 class Platform {
  public:
   /// @brief Platform destructor.
@@ -42,6 +109,10 @@ class Platform {
 
   /**
    * @brief Create a new platform instance.
+   *
+   * Platform libraries are opened and linked once per process; later calls for the same name hand out a new instance
+   * that shares the cached function table. Failures to open a library are cached as well.
+   *
    * @param[in]  name          The name of the platform.
    * @param[out] platform_out  A pointer to a shared pointer that will point to the new platform instance.
    * @param[in]  quiet         Whether to suppress any logging messages
@@ -51,12 +122,81 @@ class Platform {
 
   /**
    * @brief Create a new platform by attempting to autodetect the platform driver.
+   *
+   * Autodetection runs once per process. Later calls create an instance of the platform that was detected first.
+   *
    * @param[out] platform_out  A pointer to a shared pointer that will point to the new platform instance.
    * @param[in]  quiet         Suppresses logging messages when true.
    * @return Status::OK() if successful, otherwise a descriptive error status with platform_out = nullptr.
    */
   static Status Make(std::shared_ptr<Platform> *platform_out, bool quiet = true);
 
+  /**
+   * @brief Create a new platform instance for one of the devices of a host.
+   *
+   * Platform libraries keep the state of a device in global variables. Every device other than device 0 therefore uses
+   * its own copy of the library, loaded into a separate link-map namespace. Requires the platform to export the
+   * optional functions platformGetDeviceCount and platformSetDevice for devices other than device 0.
+   *
+   * @param[in]  name          The name of the platform.
+   * @param[in]  device        The index of the device.
+   * @param[out] platform_out  A pointer to a shared pointer that will point to the new platform instance.
+   * @param[in]  quiet         Whether to suppress any logging messages
+   * @return Status::OK() if successful, otherwise a descriptive error status with platform_out = nullptr.
+   */
+  static Status Make(const std::string &name,
+                     uint64_t device,
+                     std::shared_ptr<Platform> *platform_out,
+                     bool quiet = true);
+
+  /**
+   * @brief Create a new platform instance for every device of a host.
+   * @param[in]  name           The name of the platform.
+   * @param[out] platforms_out  The new platform instances, by device index.
+   * @param[in]  quiet          Whether to suppress any logging messages
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status MakeAll(const std::string &name, std::vector<std::shared_ptr<Platform>> *platforms_out,
+                        bool quiet = true);
+
+  /**
+   * @brief Enumerate the devices of a platform.
+   *
+   * Platforms that do not export platformGetDeviceCount have a single device.
+   *
+   * @param[in]  name   The name of the platform.
+   * @param[out] count  The number of devices.
+   * @param[in]  quiet  Whether to suppress any logging messages
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status DeviceCount(const std::string &name, uint64_t *count, bool quiet = true);
+
+  /// @brief Return the index of the device of this platform instance.
+  uint64_t device() const { return device_; }
+
+  /**
+   * @brief Load the run-time hints of a platform profile file.
+   *
+   * The file holds a "<key> <value>" pair on every line. Lines starting with # are comments. The keys that describe the
+   * hardware, e.g. bus_specs, are ignored, such that the file generated by fletchgen --platform can be loaded as is.
+   *
+   * @param[in] path  The path of the profile file.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status LoadProfile(const std::string &path);
+
+  /// @brief Return the run-time hints of the platform profile.
+  const PlatformProfile &profile() const { return profile_; }
+
+  /**
+   * @brief Return the NUMA node the device is attached to.
+   *
+   * Uses the optional platformGetNumaNode function if the platform exports it.
+   *
+   * @return The index of the node, or -1 if it is unknown.
+   */
+  int numa_node();
+
   /// @brief Return the name of the platform.
   std::string name();
 
@@ -72,7 +212,9 @@ class Platform {
    * @param[in] value   Value to write.
    * @return Status::OK() if successful, otherwise a descriptive error status.
    */
-  inline Status WriteMMIO(uint64_t offset, uint32_t value) { return Status(platformWriteMMIO(offset, value)); }
+  inline Status WriteMMIO(uint64_t offset, uint32_t value) {
+    return Status(FLETCHER_PLATFORM_CALL(platformWriteMMIO)(offset, value));
+  }
 
   /**
   * @brief Read from an MMIO register.
@@ -80,10 +222,125 @@ class Platform {
   * @param[out] value   Pointer to a value to store the result.
   * @return Status::OK() if successful, otherwise a descriptive error status.
   */
-  inline Status ReadMMIO(uint64_t offset, uint32_t *value) { return Status(platformReadMMIO(offset, value)); }
+  inline Status ReadMMIO(uint64_t offset, uint32_t *value) {
+    return Status(FLETCHER_PLATFORM_CALL(platformReadMMIO)(offset, value));
+  }
+
+  /**
+   * @brief Write to a range of consecutive MMIO registers.
+   *
+   * Uses the optional platformWriteMMIOBatch function if the platform exports it, otherwise writes every register
+   * separately.
+   *
+   * @param[in] offset  Register offset of the first register to write to.
+   * @param[in] values  Values to write.
+   * @param[in] count   Number of registers to write.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status WriteMMIOBatch(uint64_t offset, const uint32_t *values, size_t count);
+
+  /// @brief Return true if the platform supports batched MMIO writes natively.
+  inline bool HasWriteMMIOBatch() const { return platformWriteMMIOBatch != nullptr; }
+
+  /**
+   * @brief Write a 64 bit value to two successive 32 bit MMIO registers. The lower register gets the lower bits.
+   *
+   * Uses the optional platformWriteMMIO64 function for even offsets if the platform exports it, such that the
+   * registers are written with a single access on a 64-bit MMIO bus. Otherwise writes both registers separately.
+   *
+   * @param[in] offset  Register offset of the lower register.
+   * @param[in] value   Value to write.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status WriteMMIO64(uint64_t offset, uint64_t value);
+
+  /// @brief Return true if the platform supports 64-bit MMIO accesses natively.
+  inline bool HasMMIO64() const { return (platformWriteMMIO64 != nullptr) && (platformReadMMIO64 != nullptr); }
+
+  /**
+   * @brief Block until the device raises an interrupt, or until a timeout.
+   * @param[in] timeout_usec  The maximum time to wait in microseconds.
+   * @return Status::OK() if an interrupt or timeout occurred, an error status if the platform does not support it.
+   */
+  inline Status WaitForInterrupt(uint64_t timeout_usec) {
+    if (platformWaitForInterrupt == nullptr) {
+      return Status::ERROR("Platform does not support interrupts.");
+    }
+    return Status(platformWaitForInterrupt(timeout_usec));
+  }
+
+  /// @brief Return true if the platform supports waiting for interrupts.
+  inline bool HasWaitForInterrupt() const { return platformWaitForInterrupt != nullptr; }
+
+  /**
+   * @brief Allocate host memory that the device can access directly.
+   *
+   * The platform remembers the allocation, such that buffers inside it can be used by the device without preparation.
+   * See IsDeviceVisible().
+   *
+   * @param[out] host_address  The host address of the allocated memory.
+   * @param[in]  size          The number of bytes to allocate.
+   * @return Status::OK() if successful, an error status if the platform does not support it or is out of memory.
+   */
+  Status HostMalloc(uint8_t **host_address, int64_t size);
+
+  /**
+   * @brief Free host memory that was allocated with HostMalloc().
+   * @param[in] host_address  The host address of the memory.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status HostFree(uint8_t *host_address);
+
+  /// @brief Return true if the platform supports allocating host memory that the device can access directly.
+  inline bool HasHostMalloc() const { return (platformHostMalloc != nullptr) && (platformHostFree != nullptr); }
+
+  /**
+   * @brief Check whether a host buffer lies entirely within memory allocated with HostMalloc().
+   * @param[in]  host_address    The host address of the buffer.
+   * @param[in]  size            The size of the buffer in bytes.
+   * @param[out] device_address  The address through which the device can access the buffer, if it is device-visible.
+   * @return True if the device can access the buffer directly, false otherwise.
+   */
+  bool IsDeviceVisible(const uint8_t *host_address, int64_t size, da_t *device_address);
+
+  /**
+   * @brief Map device memory into the address space of the host, e.g. through a write-combining BAR mapping.
+   *
+   * The platform remembers the mapping, such that buffers inside it are recognized as resident on the device. See
+   * IsDeviceMapped().
+   *
+   * @param[in]  device_address  The address of device memory allocated with DeviceMalloc().
+   * @param[in]  size            The number of bytes to map.
+   * @param[out] host_address    The host address of the mapped memory.
+   * @return Status::OK() if successful, an error status if the platform does not support it.
+   */
+  Status DeviceMap(da_t device_address, int64_t size, uint8_t **host_address);
+
+  /**
+   * @brief Unmap device memory that was mapped with DeviceMap().
+   * @param[in] host_address  The host address of the mapped memory.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status DeviceUnmap(uint8_t *host_address);
+
+  /// @brief Return true if the platform supports mapping device memory into the address space of the host.
+  inline bool HasDeviceMap() const { return (platformDeviceMap != nullptr) && (platformDeviceUnmap != nullptr); }
+
+  /**
+   * @brief Check whether a host buffer lies entirely within device memory mapped with DeviceMap().
+   * @param[in]  host_address    The host address of the buffer.
+   * @param[in]  size            The size of the buffer in bytes.
+   * @param[out] device_address  The device address of the buffer, if it is mapped.
+   * @return True if the buffer resides in device memory, false otherwise.
+   */
+  bool IsDeviceMapped(const uint8_t *host_address, int64_t size, da_t *device_address);
 
   /**
   * @brief Read 64 bit value from two successive 32 bit MMIO registers. The lower register will go to the lower bits.
+  *
+  * Uses the optional platformReadMMIO64 function for even offsets if the platform exports it, such that the value is
+  * read atomically on a 64-bit MMIO bus. Otherwise reads both registers separately, the higher one first.
+  *
   * @param[in]  offset  Register offset to read from.
   * @param[out] value   Pointer to a value to store the result.
   * @return Status::OK() if successful, otherwise a descriptive error status.
@@ -115,9 +372,40 @@ class Platform {
    * @return Status::OK() if successful, otherwise a descriptive error status.
    */
   inline Status CopyHostToDevice(uint8_t *host_source, da_t device_destination, uint64_t size) {
-    return Status(platformCopyHostToDevice(host_source, device_destination, size));
+    return Status(FLETCHER_PLATFORM_CALL(platformCopyHostToDevice)(host_source, device_destination, size));
+  }
+
+  /**
+   * @brief Copy multiple regions from host memory to device memory.
+   *
+   * Uses the optional platformCopyHostToDeviceV function if the platform exports it, such that drivers with
+   * scatter-gather DMA can submit all regions as a single transfer. Otherwise copies every region separately.
+   *
+   * @param[in] iov   Descriptors of the regions to copy.
+   * @param[in] count The number of regions.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status CopyHostToDeviceV(const fiov_t *iov, size_t count);
+
+  /// @brief Return true if the platform supports vectored copies from host to device natively.
+  inline bool HasCopyHostToDeviceV() const { return platformCopyHostToDeviceV != nullptr; }
+
+  /**
+   * @brief Program the device, or one of its reconfigurable regions, with an image.
+   * @param[in] path    The path of the image (bitstream) file.
+   * @param[in] region  The reconfigurable region to program. Zero for the whole device.
+   * @return Status::OK() if successful, an error status if the platform does not support it or loading failed.
+   */
+  inline Status LoadImage(const std::string &path, uint64_t region = 0) {
+    if (platformLoadImage == nullptr) {
+      return Status::ERROR("Platform does not support loading images.");
+    }
+    return Status(platformLoadImage(path.c_str(), region));
   }
 
+  /// @brief Return true if the platform supports programming the device with an image.
+  inline bool HasLoadImage() const { return platformLoadImage != nullptr; }
+
   /**
    * @brief Copy data from device memory to host memory.
    * @param[in] device_source       Source pointer in device memory.
@@ -126,7 +414,7 @@ class Platform {
    * @return Status::OK() if successful, otherwise a descriptive error status.
    */
   inline Status CopyDeviceToHost(da_t device_source, uint8_t *host_destination, uint64_t size) {
-    return Status(platformCopyDeviceToHost(device_source, host_destination, size));
+    return Status(FLETCHER_PLATFORM_CALL(platformCopyDeviceToHost)(device_source, host_destination, size));
   }
 
   /**
@@ -189,9 +477,61 @@ class Platform {
   fstatus_t (*platformCacheHostBuffer)(const uint8_t *host_source, da_t *device_destination, int64_t size) = nullptr;
   fstatus_t (*platformTerminate)(void *arg) = nullptr;
 
+  // Optional functions:
+  fstatus_t (*platformWriteMMIOBatch)(uint64_t offset, const uint32_t *values, uint64_t count) = nullptr;
+  fstatus_t (*platformWriteMMIO64)(uint64_t offset, uint64_t value) = nullptr;
+  fstatus_t (*platformReadMMIO64)(uint64_t offset, uint64_t *value) = nullptr;
+  fstatus_t (*platformWaitForInterrupt)(uint64_t timeout_usec) = nullptr;
+  fstatus_t (*platformHostMalloc)(uint8_t **host_address, da_t *device_address, int64_t size) = nullptr;
+  fstatus_t (*platformHostFree)(uint8_t *host_address) = nullptr;
+  fstatus_t (*platformDeviceMap)(da_t device_address, int64_t size, uint8_t **host_address) = nullptr;
+  fstatus_t (*platformDeviceUnmap)(uint8_t *host_address, int64_t size) = nullptr;
+  fstatus_t (*platformCopyHostToDeviceV)(const fiov_t *iov, uint64_t count) = nullptr;
+  fstatus_t (*platformLoadImage)(const char *path, uint64_t region) = nullptr;
+  fstatus_t (*platformGetDeviceCount)(uint64_t *count) = nullptr;
+  fstatus_t (*platformSetDevice)(uint64_t device) = nullptr;
+  fstatus_t (*platformGetNumaNode)(int64_t *node) = nullptr;
+
+  /// A region of host address space that the device can access directly, or that maps device memory.
+  struct HostRegion {
+    /// The size of the region in bytes.
+    int64_t size;
+    /// The address through which the device accesses the region.
+    da_t device_address;
+  };
+
+  /// Regions allocated with HostMalloc, by host address.
+  std::map<const uint8_t *, HostRegion> host_regions_;
+  /// Regions of device memory mapped with DeviceMap, by host address.
+  std::map<const uint8_t *, HostRegion> mapped_regions_;
+  /// Mutex protecting the host and mapped regions.
+  std::mutex host_regions_mutex_;
+
+  /// @brief Find the region of a map of regions that holds a host buffer entirely. Requires host_regions_mutex_.
+  static bool FindRegion(const std::map<const uint8_t *, HostRegion> &regions,
+                         const uint8_t *host_address,
+                         int64_t size,
+                         da_t *device_address);
+
   /// @brief Attempt to link all functions using a handle obtained by dlopen.
   Status Link(void *handle, bool quiet = true);
 
+  /// @brief Copy all linked functions from another platform instance.
+  void Link(const Platform &other);
+
+#ifdef FLETCHER_STATIC_PLATFORM
+  /// @brief Link all functions of the platform that is linked into the run-time.
+  void LinkStatic();
+#endif
+
+  /// @brief Open and link the library of a platform for a device, or return nullptr if that fails.
+  static std::shared_ptr<Platform> Open(const std::string &name, uint64_t device, bool quiet);
+
+  /// The index of the device of this platform instance.
+  uint64_t device_ = 0;
+  /// The run-time hints of the platform profile.
+  PlatformProfile profile_;
+
   /// Whether this platform was terminated.
   bool terminated = false;
 };
@@ -0,0 +1,161 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief A device memory arena that sub-allocates aligned regions from large slabs.
+ *
+ * Slabs are allocated with Platform::DeviceMalloc once and are only returned to the platform when the pool is
+ * destructed or Trim() is called. Regions freed back to the pool are coalesced with neighbouring free regions and are
+ * recycled by subsequent allocations, also across Contexts that share the pool.
+ *
+ * All functions are thread-safe.
+ */
+class DeviceMemoryPool {
+ public:
+  /// Statistics of the pool.
+  struct Stats {
+    /// Total number of bytes allocated on the device in slabs.
+    int64_t slab_bytes = 0;
+    /// Number of slabs.
+    size_t num_slabs = 0;
+    /// Number of bytes currently handed out, including alignment padding.
+    int64_t allocated_bytes = 0;
+    /// Highest number of bytes that was handed out at any time.
+    int64_t high_water_mark = 0;
+    /// Number of regions currently handed out.
+    size_t num_allocations = 0;
+    /// Number of free regions across all slabs.
+    size_t num_free_regions = 0;
+    /// Size of the largest free region.
+    int64_t largest_free_region = 0;
+
+    /// @brief Return the external fragmentation, i.e. 1 - (largest free region / total free bytes).
+    double fragmentation() const;
+    /// @brief Return a human-readable summary.
+    std::string ToString() const;
+  };
+
+  /**
+   * @brief Construct a new DeviceMemoryPool.
+   * @param[in] platform    The platform to allocate slabs on.
+   * @param[in] slab_size   The minimum size of a slab in bytes.
+   * @param[in] alignment   The alignment of every region in bytes. Must be a power of two.
+   */
+  DeviceMemoryPool(std::shared_ptr<Platform> platform, int64_t slab_size, int64_t alignment);
+
+  /// @brief Destruct the pool, freeing all slabs on the device.
+  ~DeviceMemoryPool();
+
+  /**
+   * @brief Create a new DeviceMemoryPool.
+   * @param[out] out        A pointer to a shared pointer that will own the new pool.
+   * @param[in]  platform   The platform to allocate slabs on.
+   * @param[in]  slab_size  The minimum size of a slab in bytes.
+   * @param[in]  alignment  The alignment of every region in bytes. Must be a power of two.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<DeviceMemoryPool> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     int64_t slab_size = 64 * 1024 * 1024,
+                     int64_t alignment = 4096);
+
+  /**
+   * @brief Allocate an aligned region of device memory.
+   * @param[out] device_address The device address of the region.
+   * @param[in]  size           The number of bytes to allocate.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Allocate(da_t *device_address, int64_t size);
+
+  /**
+   * @brief Return a region that was allocated from this pool.
+   * @param[in] device_address The device address of the region.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Free(da_t device_address);
+
+  /**
+   * @brief Return all slabs without allocated regions to the platform.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Trim();
+
+  /// @brief Return the statistics of this pool.
+  Stats stats();
+
+  /// @brief Return the platform this pool allocates on.
+  std::shared_ptr<Platform> platform() const { return platform_; }
+
+  /// @brief Return the alignment of every region in bytes.
+  int64_t alignment() const { return alignment_; }
+
+ private:
+  /// A slab of device memory.
+  struct Slab {
+    /// The device address of the slab.
+    da_t address;
+    /// The size of the slab in bytes.
+    int64_t size;
+    /// Free regions in this slab, mapping offset to size.
+    std::map<int64_t, int64_t> free;
+  };
+
+  /// An allocated region.
+  struct Region {
+    /// The slab the region lives in.
+    Slab *slab;
+    /// The offset of the region within the slab.
+    int64_t offset;
+    /// The size of the region in bytes.
+    int64_t size;
+  };
+
+  /// @brief Attempt to allocate a region from the existing slabs. Must be called while holding the mutex.
+  bool AllocateFromSlabs(da_t *device_address, int64_t aligned_size);
+
+  /// The platform to allocate slabs on.
+  std::shared_ptr<Platform> platform_;
+  /// The minimum size of a slab.
+  int64_t slab_size_;
+  /// The alignment of every region.
+  int64_t alignment_;
+  /// The slabs of this pool.
+  std::vector<std::unique_ptr<Slab>> slabs_;
+  /// Regions currently handed out, by device address.
+  std::unordered_map<da_t, Region> regions_;
+  /// Number of bytes currently handed out.
+  int64_t allocated_bytes_ = 0;
+  /// Highest number of bytes handed out.
+  int64_t high_water_mark_ = 0;
+  /// Mutex protecting the pool.
+  std::mutex mutex_;
+};
+
+}  // namespace fletcher
@@ -0,0 +1,293 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletcher/kernel.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// A register of the register manifest that fletchgen generates.
+struct MmioRegister {
+  /// The name of the register.
+  std::string name;
+  /// The intended use of the register, e.g. "default", "kernel" or "profile".
+  std::string function;
+  /// The access behavior of the register, either "control", "status", "strobe" or "constant".
+  std::string behavior;
+  /// The offset of the first 32-bit register holding the field, in registers.
+  uint64_t offset = 0;
+  /// The LSB index of the field within the first register.
+  uint32_t index = 0;
+  /// The width of the field in bits.
+  uint32_t width = 0;
+};
+
+/**
+ * @brief Parse a register manifest generated by fletchgen.
+ * @param[in]  input      The stream to parse the manifest from.
+ * @param[out] registers  The registers of the manifest, in order.
+ * @return Status::OK() if successful, otherwise a descriptive error status.
+ */
+Status ParseRegisterManifest(std::istream *input, std::vector<MmioRegister> *registers);
+
+/**
+ * @brief Read the field of a manifest register of a Kernel.
+ * @param[in]  kernel The kernel in whose register window the register is located.
+ * @param[in]  reg    The register to read. Fields wider than 32 bits span consecutive registers.
+ * @param[out] value  The value of the field.
+ * @return Status::OK() if successful, otherwise a descriptive error status.
+ */
+Status ReadRegister(Kernel *kernel, const MmioRegister &reg, uint64_t *value);
+
+/// The counters of a single stream profiler.
+struct StreamProfile {
+  /// The name of the profiled stream.
+  std::string name;
+  /// The number of elements transferred.
+  uint64_t elements = 0;
+  /// The number of cycles in which the stream was valid.
+  uint64_t valids = 0;
+  /// The number of cycles in which the stream was ready.
+  uint64_t readies = 0;
+  /// The number of handshakes.
+  uint64_t transfers = 0;
+  /// The number of handshakes with the last signal asserted.
+  uint64_t packets = 0;
+  /// The number of cycles in which the profiler was enabled.
+  uint64_t cycles = 0;
+
+  /// @brief Return the average number of elements transferred per cycle.
+  double elements_per_cycle() const;
+  /// @brief Return the fraction of cycles in which a transfer took place.
+  double utilization() const;
+  /// @brief Return the fraction of valid cycles in which the sink was not ready, i.e. the sink was the bottleneck.
+  double backpressure() const;
+  /// @brief Return the fraction of ready cycles in which the source was not valid, i.e. the source was the bottleneck.
+  double starvation() const;
+  /// @brief Return the number of elements transferred per second, given the clock frequency of the stream.
+  double bandwidth(double clock_hz) const;
+};
+
+/**
+ * @brief Reads out the stream profilers that fletchgen inserts for fields with profiling enabled.
+ *
+ * The profiling registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest). All register offsets are relative to the register window of the Kernel.
+ */
+class Profiler {
+ public:
+  /**
+   * @brief Create a new Profiler for a Kernel from a register manifest file.
+   * @param[out] profiler      A pointer to a shared pointer that will own the new Profiler.
+   * @param[in]  kernel        The kernel of which the stream profilers are read out.
+   * @param[in]  manifest_path The path of the register manifest generated by fletchgen.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Profiler> *profiler,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::string &manifest_path);
+
+  /**
+   * @brief Create a new Profiler for a Kernel from parsed manifest registers.
+   * @param[out] profiler   A pointer to a shared pointer that will own the new Profiler.
+   * @param[in]  kernel     The kernel of which the stream profilers are read out.
+   * @param[in]  registers  The registers of the manifest.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Profiler> *profiler,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::vector<MmioRegister> &registers);
+
+  /// @brief Reset all profiler counters.
+  Status Clear();
+  /// @brief Enable counting on all profilers.
+  Status Start();
+  /// @brief Disable counting on all profilers, such that the counters can be read out consistently.
+  Status Stop();
+
+  /**
+   * @brief Copy the counters of all profilers to their count registers at once.
+   *
+   * This allows a consistent set of counters to be read while the profilers are counting, also for counters that span
+   * multiple registers. Designs generated without snapshot registers always show the current counter values.
+   */
+  Status Snapshot();
+
+  /**
+   * @brief Take a snapshot of the counters of all profiled streams and read them.
+   * @param[out] profiles The counters of every profiled stream, in manifest order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read(std::vector<StreamProfile> *profiles);
+
+  /**
+   * @brief Profile a kernel launch.
+   *
+   * Clears and starts the profilers, runs the launch function, which should return once the kernel is done, stops the
+   * profilers and reads them out.
+   *
+   * @param[in]  launch   A function that launches the kernel and waits until it is done.
+   * @param[out] profiles The counters of every profiled stream, in manifest order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Run(const std::function<Status()> &launch, std::vector<StreamProfile> *profiles);
+
+  /// @brief Return the names of all profiled streams, in manifest order.
+  std::vector<std::string> streams() const;
+
+  /**
+   * @brief Return a human-readable table of stream profiles.
+   * @param[in] profiles  The profiles to show.
+   * @param[in] clock_hz  The clock frequency of the profiled streams. If zero, no bandwidth is shown.
+   * @return The table.
+   */
+  static std::string ToString(const std::vector<StreamProfile> &profiles, double clock_hz = 0.0);
+
+ private:
+  /// The counter registers of a profiled stream.
+  struct Stream {
+    /// The name of the stream.
+    std::string name;
+    /// The counter registers, in the order of the StreamProfile counters.
+    std::vector<MmioRegister> counters;
+  };
+
+  explicit Profiler(std::shared_ptr<Kernel> kernel) : kernel_(std::move(kernel)) {}
+
+  /// @brief Write a value to the field of a register.
+  Status WriteField(const MmioRegister &reg, uint32_t value);
+  /// @brief Read the field of a register.
+  Status ReadField(const MmioRegister &reg, uint64_t *value);
+
+  /// The kernel of which the stream profilers are read out.
+  std::shared_ptr<Kernel> kernel_;
+  /// The enable control register.
+  MmioRegister enable_;
+  /// The clear strobe register.
+  MmioRegister clear_;
+  /// The snapshot strobe register, if the design has one.
+  MmioRegister snapshot_;
+  /// Whether the design has a snapshot register.
+  bool has_snapshot_ = false;
+  /// The profiled streams.
+  std::vector<Stream> streams_;
+};
+
+/**
+ * @brief Reads out the trace of the bus requests that fletchgen records with --bus_trace.
+ *
+ * The BusTracer records the cycle, port, address and length of the requests of all RecordBatch bus ports in an on-chip
+ * ring, of which the entries are read out one by one through the trace registers of the register manifest. Once the
+ * ring is full, it holds the most recent requests.
+ */
+class BusTrace {
+ public:
+  /**
+   * @brief Create a new BusTrace for a Kernel from a register manifest file.
+   * @param[out] trace         A pointer to a shared pointer that will own the new BusTrace.
+   * @param[in]  kernel        The kernel of which the bus requests are traced.
+   * @param[in]  manifest_path The path of the register manifest generated by fletchgen.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<BusTrace> *trace,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::string &manifest_path);
+
+  /**
+   * @brief Create a new BusTrace for a Kernel from parsed manifest registers.
+   * @param[out] trace      A pointer to a shared pointer that will own the new BusTrace.
+   * @param[in]  kernel     The kernel of which the bus requests are traced.
+   * @param[in]  registers  The registers of the manifest.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<BusTrace> *trace,
+                     const std::shared_ptr<Kernel> &kernel,
+                     const std::vector<MmioRegister> &registers);
+
+  /// @brief Discard all recorded requests and reset the cycle counter of the trace.
+  Status Clear();
+  /// @brief Start recording requests.
+  Status Start();
+  /// @brief Stop recording requests, such that the trace can be read out consistently.
+  Status Stop();
+
+  /**
+   * @brief Read the recorded requests that are still in the ring.
+   *
+   * The requests are returned in the order in which they were recorded, as a RecordBatch with the columns cycle
+   * (uint64, relative to the last clear), port (utf8, the name of the bus port), write (bool), address (uint64) and
+   * length (uint32, the burst length).
+   *
+   * @param[out] out      The recorded requests.
+   * @param[out] dropped  Optionally, the number of requests that were not recorded, because another port was recorded
+   *                      in the same cycle.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read(std::shared_ptr<arrow::RecordBatch> *out, uint64_t *dropped = nullptr);
+
+  /// @brief Return the names of all traced bus ports, in the order of their index.
+  std::vector<std::string> ports() const;
+
+ private:
+  /// A traced bus port.
+  struct Port {
+    /// The name of the bus port.
+    std::string name;
+    /// The constant register holding 1 if the bus port is a write port.
+    MmioRegister write;
+  };
+
+  explicit BusTrace(std::shared_ptr<Kernel> kernel) : kernel_(std::move(kernel)) {}
+
+  /// @brief Write a value to the field of a register.
+  Status WriteField(const MmioRegister &reg, uint32_t value);
+
+  /// The kernel of which the bus requests are traced.
+  std::shared_ptr<Kernel> kernel_;
+  /// The constant register holding the number of entries of the ring.
+  MmioRegister depth_;
+  /// The enable control register.
+  MmioRegister enable_;
+  /// The clear strobe register.
+  MmioRegister clear_;
+  /// The control register selecting the entry shown by the entry registers.
+  MmioRegister index_;
+  /// The status register holding the number of recorded requests.
+  MmioRegister count_;
+  /// The status register holding the number of dropped requests.
+  MmioRegister dropped_;
+  /// The status register holding the cycle of the selected entry.
+  MmioRegister cycle_;
+  /// The status register holding the port index of the selected entry.
+  MmioRegister port_;
+  /// The status register holding the address of the selected entry.
+  MmioRegister addr_;
+  /// The status register holding the burst length of the selected entry.
+  MmioRegister len_;
+  /// The traced bus ports.
+  std::vector<Port> ports_;
+};
+
+}  // namespace fletcher
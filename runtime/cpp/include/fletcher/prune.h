@@ -0,0 +1,175 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// The minimum and maximum of the valid values of an integer column.
+struct ZoneMap {
+  /// The minimum valid value.
+  int64_t min = 0;
+  /// The maximum valid value.
+  int64_t max = 0;
+  /// Whether the column holds any valid value. If not, min and max are meaningless.
+  bool has_values = false;
+
+  /**
+   * @brief Compute the zone map of an array.
+   *
+   * Supports arrays of the signed and unsigned integer types up to 64 bits, of which the values of uint64 arrays must
+   * fit in an int64, and of the date, time and timestamp types.
+   *
+   * @param[in]  array  The array.
+   * @param[out] out    The zone map of the array.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Compute(const arrow::Array &array, ZoneMap *out);
+};
+
+/// The zone maps of the columns of a RecordBatch, by column name.
+using ZoneMaps = std::map<std::string, ZoneMap>;
+
+/// A comparison of a column to a constant, e.g. a condition of the predicate of a kernel.
+struct Condition {
+  /// Comparison operators.
+  enum class Op { EQ, NE, LT, LE, GT, GE };
+
+  /// The name of the column.
+  std::string column;
+  /// The comparison operator, with the column on the left-hand side.
+  Op op = Op::EQ;
+  /// The constant on the right-hand side.
+  int64_t value = 0;
+
+  /**
+   * @brief Return whether the condition may hold for a row of a column with some zone map.
+   *
+   * Null values never satisfy a condition, so a column without valid values never matches.
+   */
+  bool MayMatch(const ZoneMap &zone_map) const;
+};
+
+/**
+ * @brief Read the zone maps of the row groups of a Parquet file from the statistics in its metadata.
+ *
+ * Row groups of which a column has no statistics have no zone map for that column. Only available if the run-time
+ * library was built with FLETCHER_PARQUET.
+ *
+ * @param[in]  file_name  The path to the Parquet file.
+ * @param[in]  columns    The names of the integer columns of which to read the zone maps.
+ * @param[out] out        The zone maps of every row group, in the order of the row groups.
+ * @return Status::OK() if successful, otherwise a descriptive error status.
+ */
+Status ReadParquetZoneMaps(const std::string &file_name,
+                           const std::vector<std::string> &columns,
+                           std::vector<ZoneMaps> *out);
+
+/**
+ * @brief Skips the RecordBatches of a reader of which no row satisfies a predicate, such that they are never
+ *        transferred to the device.
+ *
+ * The predicate is a conjunction of conditions. A RecordBatch is skipped if the zone map of a column proves that a
+ * condition on it holds for none of its rows. The zone maps are either passed along, e.g. from the statistics of the
+ * row groups of a Parquet file read by an Ingest, or computed from the RecordBatches.
+ *
+ * A Pruner is an arrow::RecordBatchReader, so it can feed StreamingContext::Run(). The results of the kernel then lack
+ * the skipped RecordBatches, for which Expand() inserts a synthesized result.
+ */
+class Pruner : public arrow::RecordBatchReader {
+ public:
+  /**
+   * @brief Construct a new Pruner.
+   * @param[in] reader      The reader to obtain the RecordBatches from.
+   * @param[in] conditions  The conditions of the predicate, which all have to hold for a row to match.
+   * @param[in] zone_maps   The zone maps of the RecordBatches of the reader, in order.
+   */
+  Pruner(std::shared_ptr<arrow::RecordBatchReader> reader,
+         std::vector<Condition> conditions,
+         std::vector<ZoneMaps> zone_maps);
+
+  /**
+   * @brief Create a new Pruner.
+   * @param[out] out         A pointer to a shared pointer that will own the new Pruner.
+   * @param[in]  reader      The reader to obtain the RecordBatches from.
+   * @param[in]  conditions  The conditions of the predicate, which all have to hold for a row to match. Every column
+   *                         must be an integer column of the Schema of the reader.
+   * @param[in]  zone_maps   The zone maps of the RecordBatches of the reader, in order. Zone maps of columns that are
+   *                         missing, also of RecordBatches beyond the end of this vector, are computed.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Pruner> *out,
+                     const std::shared_ptr<arrow::RecordBatchReader> &reader,
+                     const std::vector<Condition> &conditions,
+                     const std::vector<ZoneMaps> &zone_maps = {});
+
+  /**
+   * @brief Return the next RecordBatch of the reader that may hold a matching row.
+   * @param[out] out The next RecordBatch, or nullptr if the reader is exhausted.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Next(std::shared_ptr<arrow::RecordBatch> *out);
+
+  /// @brief Return the Schema of the RecordBatches.
+  std::shared_ptr<arrow::Schema> schema() const override { return reader_->schema(); }
+
+  /// @brief Return the next RecordBatch as an arrow::RecordBatchReader, see Next().
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override;
+
+  /**
+   * @brief Expand the results of the RecordBatches that were passed on into results of all RecordBatches of the reader.
+   * @param[in]  results  A result for every RecordBatch that was passed on, e.g. of StreamingContext::Run().
+   * @param[in]  skipped  The result of a skipped RecordBatch, e.g. zero for a count or a sum.
+   * @param[out] out      A result for every RecordBatch that was read, in order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Expand(const arrow::UInt64Array &results, uint64_t skipped, std::shared_ptr<arrow::Array> *out) const;
+
+  /// @brief Return whether every RecordBatch that was read was skipped, in order.
+  const std::vector<bool> &skipped() const { return skipped_; }
+
+  /// @brief Return the number of RecordBatches that were skipped.
+  size_t num_skipped() const { return num_skipped_; }
+
+  /// @brief Return the number of buffer bytes of the RecordBatches that were skipped.
+  int64_t bytes_skipped() const { return bytes_skipped_; }
+
+ private:
+  /// @brief Determine whether the RecordBatch with some index may hold a row matching the predicate.
+  Status MayMatch(const arrow::RecordBatch &batch, size_t index, bool *out) const;
+
+  /// The reader to obtain the RecordBatches from.
+  std::shared_ptr<arrow::RecordBatchReader> reader_;
+  /// The conditions of the predicate.
+  std::vector<Condition> conditions_;
+  /// The zone maps of the RecordBatches of the reader.
+  std::vector<ZoneMaps> zone_maps_;
+  /// Whether every RecordBatch that was read was skipped.
+  std::vector<bool> skipped_;
+  /// The number of RecordBatches that were skipped.
+  size_t num_skipped_ = 0;
+  /// The number of buffer bytes of the RecordBatches that were skipped.
+  int64_t bytes_skipped_ = 0;
+};
+
+}  // namespace fletcher
@@ -0,0 +1,201 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "fletcher/platform.h"
+#include "fletcher/pool.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Keeps copies of host buffers resident in device memory across Contexts.
+ *
+ * Buffers are identified by their host address and size. Every entry holds a reference to the owner of its host
+ * buffer, e.g. the RecordBatch it belongs to, such that the host memory can not be freed and reused for other data
+ * while the entry is resident. Arrow buffers are immutable; host buffers that are modified anyway must be invalidated
+ * with Invalidate().
+ *
+ * Contexts using a ResidencyCache (see Context::SetResidencyCache()) acquire their read-mode MemType::CACHE buffers from
+ * it. Buffers that are shared between fields, RecordBatches or Contexts are then copied to the device only once.
+ * Acquired entries are pinned until they are released. Unpinned entries are evicted in least-recently-used order when
+ * the resident bytes would exceed the budget of the cache.
+ *
+ * All functions are thread-safe.
+ */
+class ResidencyCache {
+ public:
+  /// Statistics of the cache.
+  struct Stats {
+    /// Number of acquisitions of buffers that were resident.
+    uint64_t hits = 0;
+    /// Number of acquisitions of buffers that were not resident.
+    uint64_t misses = 0;
+    /// Number of entries evicted to make room for other buffers.
+    uint64_t evictions = 0;
+    /// Number of acquisitions of buffers that did not fit in the budget next to the pinned entries.
+    uint64_t bypasses = 0;
+    /// Number of bytes currently resident.
+    int64_t resident_bytes = 0;
+    /// Number of entries currently resident.
+    size_t num_entries = 0;
+    /// Number of entries currently pinned.
+    size_t num_pinned = 0;
+
+    /// @brief Return the fraction of acquisitions that hit.
+    double hit_rate() const;
+    /// @brief Return a human-readable summary.
+    std::string ToString() const;
+  };
+
+  /**
+   * @brief Construct a new ResidencyCache.
+   * @param[in] platform  The platform to keep buffers resident on.
+   * @param[in] budget    The maximum number of resident bytes.
+   * @param[in] pool      Optional pool to allocate device memory from.
+   */
+  ResidencyCache(std::shared_ptr<Platform> platform, int64_t budget, std::shared_ptr<DeviceMemoryPool> pool);
+
+  /// @brief Destruct the cache, freeing the device memory of all entries.
+  ~ResidencyCache();
+
+  /**
+   * @brief Create a new ResidencyCache.
+   * @param[out] out       A pointer to a shared pointer that will own the new cache.
+   * @param[in]  platform  The platform to keep buffers resident on.
+   * @param[in]  budget    The maximum number of resident bytes.
+   * @param[in]  pool      Optional pool to allocate device memory from. Must be of the same platform.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ResidencyCache> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     int64_t budget,
+                     const std::shared_ptr<DeviceMemoryPool> &pool = nullptr);
+
+  /**
+   * @brief Acquire the device copy of a host buffer, copying it to the device if it is not resident.
+   *
+   * The entry is pinned until it is released with Release(). If the buffer does not fit in the budget next to the
+   * pinned entries, it is not cached, and the device address is set to D_NULLPTR. The caller must then make the buffer
+   * available to the device by other means.
+   *
+   * @param[in]  host_address    The host address of the buffer.
+   * @param[in]  size            The size of the buffer in bytes.
+   * @param[in]  owner           The owner of the host buffer, kept alive while the entry is resident.
+   * @param[out] device_address  The device address of the resident copy, or D_NULLPTR if the buffer was not cached.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Acquire(const uint8_t *host_address,
+                 int64_t size,
+                 const std::shared_ptr<const void> &owner,
+                 da_t *device_address);
+
+  /**
+   * @brief Unpin an entry that was acquired before.
+   * @param[in] device_address The device address returned by Acquire().
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Release(da_t device_address);
+
+  /**
+   * @brief Drop all entries of a host buffer that was modified, such that it is copied again when acquired next.
+   *
+   * Pinned entries are freed when they are released.
+   *
+   * @param[in] host_address The host address of the buffer.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Invalidate(const uint8_t *host_address);
+
+  /**
+   * @brief Check whether a host buffer is resident, without acquiring it.
+   * @param[in] host_address The host address of the buffer.
+   * @param[in] size         The size of the buffer in bytes.
+   * @return True if the buffer is resident and can be acquired, false otherwise.
+   */
+  bool IsResident(const uint8_t *host_address, int64_t size);
+
+  /**
+   * @brief Evict all unpinned entries.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Clear();
+
+  /// @brief Return the statistics of this cache.
+  Stats stats();
+
+  /// @brief Return the maximum number of resident bytes.
+  int64_t budget() const { return budget_; }
+
+  /// @brief Return the platform this cache keeps buffers resident on.
+  std::shared_ptr<Platform> platform() const { return platform_; }
+
+ private:
+  /// A buffer resident in device memory.
+  struct Entry {
+    /// The host address of the buffer.
+    const uint8_t *host_address;
+    /// The size of the buffer in bytes.
+    int64_t size;
+    /// The device address of the resident copy.
+    da_t device_address;
+    /// The owner of the host buffer.
+    std::shared_ptr<const void> owner;
+    /// The number of times the entry was acquired and not yet released.
+    size_t pins;
+    /// Whether the entry was invalidated while pinned. It can no longer be acquired, and is freed when unpinned.
+    bool stale;
+  };
+
+  /// Entries by recency of use, most recently used first.
+  using EntryList = std::list<Entry>;
+
+  /// @brief Evict unpinned entries until some number of bytes fits in the budget. Must be called while holding the mutex.
+  Status MakeRoom(int64_t size, bool *fits);
+
+  /// @brief Free the device memory of an entry and remove it. Must be called while holding the mutex.
+  Status Erase(EntryList::iterator entry);
+
+  /// The platform to keep buffers resident on.
+  std::shared_ptr<Platform> platform_;
+  /// The maximum number of resident bytes.
+  int64_t budget_;
+  /// Optional pool to allocate device memory from.
+  std::shared_ptr<DeviceMemoryPool> pool_;
+  /// All entries, including stale ones.
+  EntryList entries_;
+  /// Entries that can be acquired, by host address and size.
+  std::map<std::pair<const uint8_t *, int64_t>, EntryList::iterator> index_;
+  /// All entries, by device address.
+  std::unordered_map<da_t, EntryList::iterator> by_device_;
+  /// Statistics, of which the resident and entry counts are derived on request.
+  Stats stats_;
+  /// Number of bytes currently resident.
+  int64_t resident_bytes_ = 0;
+  /// Mutex protecting the cache.
+  std::mutex mutex_;
+};
+
+}  // namespace fletcher
@@ -0,0 +1,137 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletcher/platform.h"
+#include "fletcher/profiler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// A read-only view of the values of some type in a ResultBuffer.
+template<typename T>
+struct ResultSpan {
+  /// The first value.
+  const T *data = nullptr;
+  /// The number of values.
+  size_t size = 0;
+
+  /// @brief Return value i.
+  const T &operator[](size_t i) const { return data[i]; }
+  /// @brief Return a pointer to the first value.
+  const T *begin() const { return data; }
+  /// @brief Return a pointer past the last value.
+  const T *end() const { return data + size; }
+};
+
+/**
+ * @brief A result scratchpad in device memory, for kernels that produce more results than fit in the return registers.
+ *
+ * Designs generated with --result_bytes pass the address of the scratchpad to the kernel, which writes its results,
+ * e.g. a histogram or the aggregates of a group-by, there through its result bus. The ResultBuffer allocates the
+ * scratchpad and writes its address to the result_address register, which holds it for every following launch. After
+ * the kernel is done, Read() copies the whole scratchpad back in a single transfer.
+ *
+ * The registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest).
+ */
+class ResultBuffer {
+ public:
+  /**
+   * @brief Allocate the result scratchpad in device memory and pass its address to the kernel.
+   * @param[out] out        A pointer to a shared pointer that will own the new ResultBuffer.
+   * @param[in]  platform   The platform of the kernel.
+   * @param[in]  registers  The registers of the register manifest generated by fletchgen.
+   * @param[in]  mmio_base  The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ResultBuffer> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::vector<MmioRegister> &registers,
+                     uint64_t mmio_base = 0);
+
+  /**
+   * @brief Allocate the result scratchpad in device memory and pass its address to the kernel, using a manifest file.
+   * @param[out] out            A pointer to a shared pointer that will own the new ResultBuffer.
+   * @param[in]  platform       The platform of the kernel.
+   * @param[in]  manifest_path  The path of the register manifest generated by fletchgen.
+   * @param[in]  mmio_base      The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<ResultBuffer> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::string &manifest_path,
+                     uint64_t mmio_base = 0);
+
+  /// @brief Free the device memory of the scratchpad.
+  ~ResultBuffer();
+
+  /**
+   * @brief Fill the scratchpad with zeros, e.g. before a kernel that accumulates into it.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Clear();
+
+  /**
+   * @brief Copy the scratchpad back from the device, after the kernel is done.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Read();
+
+  /**
+   * @brief Copy the scratchpad back from the device, and view it as values of some type.
+   *
+   * The view is valid until the next call to Read() or the destruction of the ResultBuffer. Trailing bytes that do not
+   * make up a whole value are not part of the view.
+   *
+   * @param[out] out The values in the scratchpad.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  template<typename T>
+  Status Read(ResultSpan<T> *out) {
+    auto status = Read();
+    if (!status.ok()) {
+      return status;
+    }
+    *out = {reinterpret_cast<const T *>(host_.data()), host_.size() / sizeof(T)};
+    return Status::OK();
+  }
+
+  /// @brief Return the number of bytes of the scratchpad.
+  uint32_t size() const { return static_cast<uint32_t>(host_.size()); }
+  /// @brief Return the device address of the scratchpad.
+  da_t address() const { return address_; }
+  /// @brief Return the bytes that were last read back.
+  const std::vector<uint8_t> &bytes() const { return host_; }
+
+ private:
+  explicit ResultBuffer(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+
+  /// The platform of the kernel.
+  std::shared_ptr<Platform> platform_;
+  /// The device address of the scratchpad.
+  da_t address_ = D_NULLPTR;
+  /// The host copy of the scratchpad. Its storage is aligned for any fundamental type.
+  std::vector<uint8_t> host_;
+};
+
+}  // namespace fletcher
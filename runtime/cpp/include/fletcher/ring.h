@@ -0,0 +1,146 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+#include "fletcher/profiler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Submits batches to a kernel through the descriptor ring that fletchgen generates with --descriptor_ring.
+ *
+ * Every batch is described by a descriptor, holding the values of the schema-derived registers of a Context (see
+ * Kernel::GatherMetaData()). The host writes descriptors to a ring in device memory and bumps the tail register of the
+ * ring. The hardware fetches and processes the descriptors back-to-back: for every descriptor, it resets the kernel,
+ * writes the registers, starts the kernel and waits until it is done, after which it bumps the head register. The
+ * host therefore does not start every batch and await its completion itself, and can keep the kernel busy by
+ * submitting batches ahead.
+ *
+ * The kernel must not be started through a Kernel while the ring is enabled. A ring of some size holds at most size - 1
+ * pending descriptors.
+ *
+ * The registers are located through the register manifest that fletchgen generates in its output directory
+ * (fletchgen.mmio.manifest).
+ */
+class DescriptorRing {
+ public:
+  /**
+   * @brief Allocate a descriptor ring in device memory and enable it.
+   * @param[out] out        A pointer to a shared pointer that will own the new DescriptorRing.
+   * @param[in]  platform   The platform of the kernel.
+   * @param[in]  registers  The registers of the register manifest generated by fletchgen.
+   * @param[in]  size       The number of descriptors of the ring.
+   * @param[in]  mmio_base  The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<DescriptorRing> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::vector<MmioRegister> &registers,
+                     uint32_t size = 64,
+                     uint64_t mmio_base = 0);
+
+  /**
+   * @brief Allocate a descriptor ring in device memory and enable it, using a register manifest file.
+   * @param[out] out            A pointer to a shared pointer that will own the new DescriptorRing.
+   * @param[in]  platform       The platform of the kernel.
+   * @param[in]  manifest_path  The path of the register manifest generated by fletchgen.
+   * @param[in]  size           The number of descriptors of the ring.
+   * @param[in]  mmio_base      The offset of the register window of the kernel, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<DescriptorRing> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::string &manifest_path,
+                     uint32_t size = 64,
+                     uint64_t mmio_base = 0);
+
+  /// @brief Disable the ring and free its device memory. Pending descriptors should be drained first.
+  ~DescriptorRing();
+
+  /**
+   * @brief Submit the batch of the Context of a Kernel, waiting while the ring is full.
+   *
+   * The Context must have been enabled, and must not be modified until the batch is complete.
+   *
+   * @param[in] kernel              A Kernel operating on the Context holding the RecordBatches to process.
+   * @param[in] poll_interval_usec  The interval at which to poll the head register while the ring is full.
+   * @return Status::OK() if the batch was submitted, otherwise a descriptive error status.
+   */
+  Status Submit(Kernel *kernel, unsigned int poll_interval_usec = 100);
+
+  /**
+   * @brief Read the number of submitted batches that are not yet complete.
+   * @param[out] pending The number of pending batches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Pending(uint32_t *pending);
+
+  /**
+   * @brief Wait until all submitted batches are complete.
+   * @param[in] poll_interval_usec The interval at which to poll the head register.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Drain(unsigned int poll_interval_usec = 100);
+
+  /// @brief Return the number of descriptors of the ring.
+  uint32_t size() const { return size_; }
+  /// @brief Return the number of bytes of every descriptor in the ring.
+  uint32_t stride() const { return stride_; }
+  /// @brief Return the device address of the ring.
+  da_t address() const { return address_; }
+
+ private:
+  explicit DescriptorRing(std::shared_ptr<Platform> platform) : platform_(std::move(platform)) {}
+
+  /// @brief Write a register of the ring.
+  Status Write(const MmioRegister &reg, uint64_t value);
+  /// @brief Read the head register of the ring.
+  Status ReadHead(uint32_t *head);
+
+  /// The platform of the kernel.
+  std::shared_ptr<Platform> platform_;
+  /// The offset of the register window of the kernel.
+  uint64_t mmio_base_ = 0;
+  /// The register enabling the ring.
+  MmioRegister enable_;
+  /// The register holding the device address of the ring.
+  MmioRegister base_;
+  /// The register holding the number of descriptors of the ring.
+  MmioRegister size_reg_;
+  /// The register holding the index of the next descriptor written by the host.
+  MmioRegister tail_reg_;
+  /// The register holding the index of the next descriptor processed by the kernel.
+  MmioRegister head_reg_;
+  /// The number of descriptors of the ring.
+  uint32_t size_ = 0;
+  /// The number of bytes of every descriptor.
+  uint32_t stride_ = 0;
+  /// The index of the next descriptor to write.
+  uint32_t tail_ = 0;
+  /// The device address of the ring.
+  da_t address_ = D_NULLPTR;
+};
+
+}  // namespace fletcher
@@ -0,0 +1,185 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// A range of rows of a RecordBatch, with an inclusive first and exclusive last index.
+struct RowRange {
+  /// The first row of the range (inclusive).
+  int32_t first;
+  /// The last row of the range (exclusive).
+  int32_t last;
+  /// @brief Return the number of rows in the range.
+  inline int32_t size() const { return last - first; }
+};
+
+/**
+ * @brief Split the rows of a RecordBatch into contiguous ranges that span a (nearly) equal number of bytes.
+ *
+ * The byte volume of a row is estimated from the buffers found by the RecordBatchAnalyzer. Fixed-width columns
+ * contribute an equal number of bytes to every row. For string, binary and list columns, the top-level offsets buffer
+ * determines the number of child elements of every row, and every element carries an equal share of the bytes of the
+ * child buffers.
+ *
+ * Ranges may be empty when the RecordBatch has fewer rows than requested ranges, or when single rows are very large.
+ *
+ * @param[in]  batch      The RecordBatch to split.
+ * @param[in]  num_ranges The number of ranges to split the RecordBatch into.
+ * @param[out] out        The resulting ranges, in row order.
+ * @return Status::OK() if successful, otherwise a descriptive error status.
+ */
+Status SplitByBytes(const arrow::RecordBatch &batch, size_t num_ranges, std::vector<RowRange> *out);
+
+/**
+ * @brief Schedules the rows of a RecordBatch across multiple instances of a kernel that operate in parallel.
+ *
+ * Designs that are generated with multiple instances (fletchgen --instances) have one register window per instance.
+ * The Scheduler holds a Kernel for every instance, all operating in the same Context, and partitions the row range of
+ * a RecordBatch among them.
+ */
+class Scheduler {
+ public:
+  /**
+   * @brief Construct a new Scheduler.
+   * @param[in] context       The context to operate in.
+   * @param[in] num_instances The number of kernel instances.
+   * @param[in] window_regs   The size of the register window of every instance, in registers.
+   */
+  Scheduler(std::shared_ptr<Context> context, size_t num_instances, uint64_t window_regs);
+
+  /**
+   * @brief Create a new Scheduler.
+   * @param[out] out            A pointer to a shared pointer that will own the new Scheduler.
+   * @param[in]  context        The context to operate in.
+   * @param[in]  num_instances  The number of kernel instances.
+   * @param[in]  window_regs    The size of the register window of every instance, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Scheduler> *out,
+                     const std::shared_ptr<Context> &context,
+                     size_t num_instances,
+                     uint64_t window_regs = FLETCHER_INSTANCE_WINDOW_REGS);
+
+  /**
+   * @brief Reset all kernel instances.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Reset();
+
+  /**
+   * @brief Write RecordBatch metadata from the Context to all kernel instances.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status WriteMetaData();
+
+  /**
+   * @brief Set custom arguments of all kernel instances.
+   * @param[in] arguments A vector of arguments to write.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status SetArguments(const std::vector<uint32_t> &arguments);
+
+  /**
+   * @brief Partition the rows of a RecordBatch into contiguous ranges of (nearly) equal size, one per instance.
+   *
+   * Instances that receive no rows, because the RecordBatch has fewer rows than there are instances, are not started.
+   *
+   * @param[in] recordbatch_index The index of the RecordBatch in the Context to partition.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Partition(size_t recordbatch_index = 0);
+
+  /**
+   * @brief Partition the rows of a RecordBatch into ranges of (nearly) equal byte volume, one per instance.
+   *
+   * This balances the work better than Partition() for RecordBatches with string, binary or list columns of which the
+   * lengths vary. See SplitByBytes().
+   *
+   * @param[in] recordbatch_index The index of the RecordBatch in the Context to partition.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status PartitionByBytes(size_t recordbatch_index = 0);
+
+  /**
+   * @brief Process any number of row ranges of a RecordBatch, launching the instances as often as required.
+   *
+   * Ranges are dispatched in launches of up to num_instances() ranges. Every launch waits until all instances are done
+   * before the next launch is programmed.
+   *
+   * @param[in] recordbatch_index The index of the RecordBatch in the Context.
+   * @param[in] ranges            The ranges to process.
+   * @return Status::OK() when all ranges were processed, otherwise a descriptive error status.
+   */
+  Status Dispatch(size_t recordbatch_index, const std::vector<RowRange> &ranges);
+
+  /**
+   * @brief Program a row range of a RecordBatch for every instance.
+   * @param[in] recordbatch_index The index of the RecordBatch in the Context.
+   * @param[in] ranges            One range per instance. Instances with an empty range are not started.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status SetRanges(size_t recordbatch_index, const std::vector<RowRange> &ranges);
+
+  /**
+   * @brief Start all instances that have rows to process.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Start();
+
+  /**
+   * @brief Wait (blocking) until all started instances are done.
+   * @param[in] spin_usec           The window in which to poll at maximum speed, in microseconds.
+   * @param[in] poll_interval_usec  The poll interval after the spin window, or the interrupt timeout.
+   * @return Status::OK() when all instances are finished, otherwise a descriptive error status.
+   */
+  Status WaitUntilDone(unsigned int spin_usec = 50, unsigned int poll_interval_usec = 100);
+
+  /**
+   * @brief Partition a RecordBatch among all instances, start them and wait until they are done.
+   * @param[in] recordbatch_index The index of the RecordBatch in the Context to partition.
+   * @return Status::OK() when all instances are finished, otherwise a descriptive error status.
+   */
+  Status Run(size_t recordbatch_index = 0);
+
+  /// @brief Return the number of kernel instances.
+  size_t num_instances() const { return kernels_.size(); }
+
+  /// @brief Return the Kernel of instance i.
+  std::shared_ptr<Kernel> kernel(size_t i) const { return kernels_[i]; }
+
+  /// @brief Return the row ranges that were last programmed, one per instance.
+  const std::vector<RowRange> &ranges() const { return ranges_; }
+
+ private:
+  /// The context to operate in.
+  std::shared_ptr<Context> context_;
+  /// A Kernel for every instance.
+  std::vector<std::shared_ptr<Kernel>> kernels_;
+  /// The row range of every instance.
+  std::vector<RowRange> ranges_;
+};
+
+}  // namespace fletcher
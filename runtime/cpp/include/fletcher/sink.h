@@ -0,0 +1,149 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/ipc/writer.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "fletcher/context.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Streams the RecordBatches written by kernels to an Arrow IPC writer, e.g. a file or a socket.
+ *
+ * Writing a RecordBatch of a Context reads it back from the device on the calling thread, and hands it to a serializer
+ * thread. The serializer thread writes earlier RecordBatches to the IPC writer in the meantime, so that the readback of
+ * a chunk overlaps with the serialization of the chunk before it.
+ *
+ * A RecordBatch is read back into the host buffers that were queued on the Context. The IPC writer writes the body of
+ * the message straight from those buffers, so no RecordBatch is built or copied in between. The host buffers must
+ * therefore not be written again, e.g. by running a kernel on the RecordBatch, until Flush() returns.
+ */
+class IpcSink {
+ public:
+  /**
+   * @brief Construct a new IpcSink and start its serializer thread.
+   * @param[in] writer    The IPC writer to write the RecordBatches to.
+   * @param[in] capacity  The maximum number of RecordBatches that await serialization.
+   */
+  IpcSink(std::shared_ptr<arrow::ipc::RecordBatchWriter> writer, size_t capacity);
+
+  /// @brief Serialize the pending RecordBatches, close the IPC writer and join the serializer thread.
+  ~IpcSink();
+
+  /**
+   * @brief Create a new IpcSink that writes to an IPC writer.
+   * @param[out] out       A pointer to a shared pointer that will own the new IpcSink.
+   * @param[in]  writer    The IPC writer to write the RecordBatches to. Closed by Close().
+   * @param[in]  capacity  The maximum number of RecordBatches that await serialization.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<IpcSink> *out,
+                     const std::shared_ptr<arrow::ipc::RecordBatchWriter> &writer,
+                     size_t capacity = 1);
+
+  /**
+   * @brief Create a new IpcSink that writes the Arrow IPC streaming format to an output stream, e.g. a socket.
+   * @param[out] out       A pointer to a shared pointer that will own the new IpcSink.
+   * @param[in]  sink      The output stream.
+   * @param[in]  schema    The Schema of the RecordBatches.
+   * @param[in]  capacity  The maximum number of RecordBatches that await serialization.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status MakeStream(std::shared_ptr<IpcSink> *out,
+                           const std::shared_ptr<arrow::io::OutputStream> &sink,
+                           const std::shared_ptr<arrow::Schema> &schema,
+                           size_t capacity = 1);
+
+  /**
+   * @brief Create a new IpcSink that writes the Arrow IPC file format to an output stream.
+   * @param[out] out       A pointer to a shared pointer that will own the new IpcSink.
+   * @param[in]  sink      The output stream.
+   * @param[in]  schema    The Schema of the RecordBatches.
+   * @param[in]  capacity  The maximum number of RecordBatches that await serialization.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status MakeFile(std::shared_ptr<IpcSink> *out,
+                         const std::shared_ptr<arrow::io::OutputStream> &sink,
+                         const std::shared_ptr<arrow::Schema> &schema,
+                         size_t capacity = 1);
+
+  /**
+   * @brief Read back a RecordBatch with a write-mode Schema from the device and queue it for serialization.
+   *
+   * Blocks while the capacity of RecordBatches that await serialization is reached, before reading back.
+   *
+   * @param[in] context   The Context holding the RecordBatch.
+   * @param[in] index     The index of the RecordBatch in the Context.
+   * @param[in] num_rows  The number of rows written by the kernel, or -1, see Context::ReadbackRecordBatch().
+   * @return Status::OK() if successful, otherwise a descriptive error status, which may be that of serializing an
+   *         earlier RecordBatch.
+   */
+  Status Write(Context *context, size_t index, int64_t num_rows = -1);
+
+  /**
+   * @brief Queue a RecordBatch in host memory for serialization.
+   * @param[in] batch The RecordBatch.
+   * @return Status::OK() if successful, otherwise the status of serializing an earlier RecordBatch.
+   */
+  Status Write(const std::shared_ptr<arrow::RecordBatch> &batch);
+
+  /// @brief Wait until all queued RecordBatches are serialized. Returns the first error of serializing, if any.
+  Status Flush();
+
+  /// @brief Serialize the pending RecordBatches and close the IPC writer. Returns the first error, if any.
+  Status Close();
+
+  /// @brief Return the number of RecordBatches that were serialized.
+  size_t num_written();
+
+ private:
+  /// @brief Wait until there is room for another RecordBatch. Returns the first error of serializing, if any.
+  Status WaitForCapacity();
+
+  /// @brief Serialize RecordBatches until the IpcSink is closed. Runs on the serializer thread.
+  void Serialize();
+
+  /// The IPC writer.
+  std::shared_ptr<arrow::ipc::RecordBatchWriter> writer_;
+  /// The maximum number of RecordBatches that await serialization.
+  size_t capacity_;
+  /// RecordBatches that await serialization, including the one being serialized.
+  std::deque<std::shared_ptr<arrow::RecordBatch>> pending_;
+  /// The first error of serializing a RecordBatch or closing the IPC writer.
+  Status status_ = Status::OK();
+  /// The number of RecordBatches that were serialized.
+  size_t num_written_ = 0;
+  /// Whether the IPC writer is closed, or being closed.
+  bool closed_ = false;
+  /// The serializer thread.
+  std::thread thread_;
+  /// Mutex protecting the pending RecordBatches and the status.
+  std::mutex mutex_;
+  /// Signals the serializer thread that a RecordBatch was queued or that the IpcSink is closed.
+  std::condition_variable queued_cv_;
+  /// Signals writers that a RecordBatch was serialized.
+  std::condition_variable written_cv_;
+};
+
+}  // namespace fletcher
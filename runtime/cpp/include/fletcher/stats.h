@@ -0,0 +1,156 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/timer.h>
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace fletcher {
+
+class Tracer;
+
+/// Phases of preparing and launching a kernel that are instrumented by the run-time.
+enum class Phase : size_t {
+  /// Queueing a RecordBatch, including its analysis.
+  QUEUE = 0,
+  /// Analyzing the buffers of a RecordBatch.
+  ANALYZE,
+  /// Allocating a device buffer.
+  ALLOC,
+  /// Copying a buffer from host to device.
+  COPY,
+  /// Preparing or caching a buffer through the platform, which may allocate and copy.
+  PREPARE,
+  /// Writing RecordBatch metadata to the kernel.
+  METADATA,
+  /// Starting the kernel.
+  START,
+  /// Waiting until the kernel is done, from the first status poll to the done flag.
+  COMPLETION
+};
+
+/// The number of instrumented phases.
+constexpr size_t kNumPhases = static_cast<size_t>(Phase::COMPLETION) + 1;
+
+/// @brief Return a human-readable name of a phase.
+std::string ToString(Phase phase);
+
+/**
+ * @brief A lock-free histogram of durations.
+ *
+ * Durations are counted in buckets of which the upper bounds are powers of two nanoseconds. Percentiles are therefore
+ * accurate to within a factor of two, which is sufficient to locate launch overhead.
+ */
+class Histogram {
+ public:
+  /// The number of buckets.
+  static constexpr size_t kNumBuckets = 64;
+
+  Histogram();
+
+  /// @brief Record a duration in nanoseconds.
+  void Record(uint64_t nanoseconds);
+  /// @brief Return the number of recorded durations.
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  /// @brief Return the sum of all recorded durations in nanoseconds.
+  uint64_t total() const { return total_.load(std::memory_order_relaxed); }
+  /// @brief Return the longest recorded duration in nanoseconds.
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  /// @brief Return an upper bound of percentile p (in [0, 1]) of the recorded durations in nanoseconds.
+  uint64_t Percentile(double p) const;
+  /// @brief Clear all recorded durations.
+  void Reset();
+  /// @brief Add all durations recorded by another histogram.
+  void Merge(const Histogram &other);
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> total_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+/// A snapshot of the statistics of a single phase, with durations in nanoseconds.
+struct PhaseStats {
+  /// Number of recorded durations.
+  uint64_t count = 0;
+  /// Mean duration.
+  double mean = 0.0;
+  /// Median duration.
+  uint64_t p50 = 0;
+  /// 99th percentile duration.
+  uint64_t p99 = 0;
+  /// Longest duration.
+  uint64_t max = 0;
+};
+
+/// A snapshot of the statistics of all phases.
+struct Stats {
+  /// The statistics of every phase, indexed by Phase.
+  std::array<PhaseStats, kNumPhases> phases;
+  /// @brief Return the statistics of a phase.
+  const PhaseStats &operator[](Phase phase) const { return phases[static_cast<size_t>(phase)]; }
+  /// @brief Return a human-readable table of all phases.
+  std::string ToString() const;
+  /// @brief Return a JSON object with the statistics of every phase, by phase name, with durations in nanoseconds.
+  std::string ToJSON() const;
+};
+
+/// Histograms of the durations of all phases. All functions are thread-safe and lock-free.
+class Instrumentation {
+ public:
+  /// @brief Record a duration of a phase in nanoseconds.
+  inline void Record(Phase phase, uint64_t nanoseconds) { histograms_[static_cast<size_t>(phase)].Record(nanoseconds); }
+  /// @brief Record the interval of a stopped Timer for a phase, and trace it if a Tracer is attached.
+  inline void Record(Phase phase, const Timer &timer) {
+    Record(phase, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        timer.stop_ - timer.start_).count()));
+    if (tracer_.load(std::memory_order_relaxed) != nullptr) {
+      Trace(phase, timer);
+    }
+  }
+  /**
+   * @brief Attach a Tracer, to which the intervals of all phases are recorded as spans, or detach it with nullptr.
+   *
+   * Must not be called while phases are recorded.
+   */
+  void SetTracer(std::shared_ptr<Tracer> tracer);
+  /// @brief Return the attached Tracer, if any.
+  std::shared_ptr<Tracer> tracer() const { return tracer_owner_; }
+  /// @brief Return the histogram of a phase.
+  const Histogram &histogram(Phase phase) const { return histograms_[static_cast<size_t>(phase)]; }
+  /// @brief Return a snapshot of the statistics of all phases.
+  Stats GetStats() const;
+  /// @brief Clear all histograms.
+  void Reset();
+  /// @brief Add all durations recorded by another Instrumentation, e.g. to aggregate the phases of many Contexts.
+  void Merge(const Instrumentation &other);
+
+ private:
+  /// @brief Record the interval of a stopped Timer as a span of the attached Tracer.
+  void Trace(Phase phase, const Timer &timer);
+
+  std::array<Histogram, kNumPhases> histograms_;
+  /// The attached Tracer, if any, checked on every recorded phase.
+  std::atomic<Tracer *> tracer_{nullptr};
+  /// The owner of the attached Tracer.
+  std::shared_ptr<Tracer> tracer_owner_;
+};
+
+}  // namespace fletcher
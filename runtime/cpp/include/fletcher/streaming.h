@@ -0,0 +1,186 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <fletcher/common.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief A Context that pipelines host-to-device transfers of subsequent RecordBatches with kernel execution.
+ *
+ * The StreamingContext keeps up to a number of device-side slots. One slot is active, i.e. its RecordBatch and device
+ * buffers are exposed through the regular Context accessors and can be processed by a Kernel. The other slots hold
+ * RecordBatches that are pushed by the host and are transferred to the device by a background thread.
+ *
+ * A typical loop pushes RecordBatch N+1, processes the active RecordBatch N, and then rotates. After every Rotate(),
+ * Kernel::WriteMetaData() must be called to write the buffer addresses of the new active slot to the kernel. Run()
+ * implements this loop for all RecordBatches of an arrow::RecordBatchReader.
+ */
+class StreamingContext : public Context {
+ public:
+  /// @brief Function called by Run() after the kernel finished the RecordBatch with some index.
+  using BatchCallback = std::function<Status(size_t index, Kernel *kernel)>;
+
+  /**
+   * @brief StreamingContext constructor.
+   * @param[in] platform  A platform to construct the context on.
+   * @param[in] num_slots The maximum number of RecordBatches that can be resident on the device, including the active
+   *                      one.
+   */
+  StreamingContext(std::shared_ptr<Platform> platform, size_t num_slots);
+
+  /// @brief Deconstruct the context, stopping the transfer thread and freeing all device buffers.
+  ~StreamingContext() override;
+
+  /**
+   * @brief Create a new streaming context on a specific platform.
+   * @param[out] context    A pointer to a shared pointer that will own the new StreamingContext.
+   * @param[in]  platform   The platform to create the StreamingContext on.
+   * @param[in]  num_slots  The number of device-side slots. Must be at least 2 to overlap transfers with execution.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<StreamingContext> *context,
+                     const std::shared_ptr<Platform> &platform,
+                     size_t num_slots = 2);
+
+  /**
+   * @brief Create a new streaming context that allocates cached buffers from a DeviceMemoryPool.
+   *
+   * Since slots are released and refilled for every RecordBatch, a pool avoids a device allocation per buffer.
+   *
+   * @param[out] context    A pointer to a shared pointer that will own the new StreamingContext.
+   * @param[in]  platform   The platform to create the StreamingContext on.
+   * @param[in]  num_slots  The number of device-side slots. Must be at least 2 to overlap transfers with execution.
+   * @param[in]  pool       The pool to allocate cached buffers from.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<StreamingContext> *context,
+                     const std::shared_ptr<Platform> &platform,
+                     size_t num_slots,
+                     const std::shared_ptr<DeviceMemoryPool> &pool);
+
+  /**
+   * @brief Push an arrow::RecordBatch to be transferred to the device in the background.
+   *
+   * Blocks while all slots are occupied. Fields with parallel metadata are split, and if a buffer layout is set for the
+   * Schema of the RecordBatch (see Context::SetLayout()), its columns are arranged, like in Context::QueueRecordBatch().
+   *
+   * @param[in] record_batch  The arrow::RecordBatch to push.
+   * @param[in] mem_type      The memory type to use for the buffers of the RecordBatch.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Push(const std::shared_ptr<arrow::RecordBatch> &record_batch, MemType mem_type = MemType::ANY);
+
+  /**
+   * @brief Memory-map an Arrow IPC file and push its RecordBatches as they are decoded.
+   *
+   * The RecordBatches are not copied on the host. Because Push() blocks while all slots are occupied, the active
+   * RecordBatches must be processed and rotated by another thread while the file is being pushed. This allows the first
+   * kernel to start before the whole file is loaded.
+   *
+   * @param[in] file_name The path to the Arrow IPC file.
+   * @param[in] mem_type  The memory type to use for the buffers of the RecordBatches.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status PushFromFile(const std::string &file_name, MemType mem_type = MemType::ANY);
+
+  /**
+   * @brief Release the active slot and make the next pushed RecordBatch active.
+   *
+   * Blocks until the transfer of the next RecordBatch has finished.
+   *
+   * @return Status::OK() if successful, otherwise the status of the failed transfer or a descriptive error status.
+   */
+  Status Rotate();
+
+  /**
+   * @brief Run a kernel on every RecordBatch of a reader, transferring the next RecordBatch while the kernel runs.
+   *
+   * For every RecordBatch, the metadata registers that changed are written, the kernel is started and awaited, and
+   * its return registers are collected. The context must not hold any pushed RecordBatches, and must have at least two
+   * slots.
+   *
+   * @param[in]  reader    The reader to obtain the RecordBatches from.
+   * @param[in]  kernel    The kernel to run, which must be constructed on this context.
+   * @param[out] results   An arrow::UInt64Array with the return registers of the kernel for every RecordBatch, where
+   *                       return register 1 holds the upper 32 bits. May be nullptr.
+   * @param[in]  mem_type  The memory type to use for the buffers of the RecordBatches.
+   * @param[in]  callback  Optional function to call after every RecordBatch, e.g. to obtain other results.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Run(arrow::RecordBatchReader *reader,
+             Kernel *kernel,
+             std::shared_ptr<arrow::Array> *results = nullptr,
+             MemType mem_type = MemType::ANY,
+             const BatchCallback &callback = nullptr);
+
+  /// @brief Return the number of pushed RecordBatches that are not yet active.
+  size_t num_pending();
+
+ private:
+  /// A device-side slot holding a single RecordBatch.
+  struct Slot {
+    /// The RecordBatch on the host side.
+    std::shared_ptr<arrow::RecordBatch> batch;
+    /// The description of the RecordBatch.
+    RecordBatchDescription desc;
+    /// The memory type of the RecordBatch.
+    MemType mem_type = MemType::ANY;
+    /// The buffers of the RecordBatch on the device.
+    std::vector<DeviceBuffer> buffers;
+    /// Promise fulfilled by the transfer thread.
+    std::promise<Status> transferred;
+    /// Future of the transfer status.
+    std::future<Status> transfer_status;
+  };
+
+  /// @brief Transfer pushed slots to the device until the context is destructed. Runs on the transfer thread.
+  void TransferSlots();
+
+  /// The maximum number of resident RecordBatches.
+  size_t num_slots_;
+  /// Pushed slots, in order. Slots at index >= next_transfer_ still await their transfer.
+  std::deque<std::shared_ptr<Slot>> slots_;
+  /// The index in slots_ of the next slot to transfer.
+  size_t next_transfer_ = 0;
+  /// The background transfer thread.
+  std::thread transfer_thread_;
+  /// Mutex protecting the slots.
+  std::mutex mutex_;
+  /// Signals the transfer thread that there is work or that it should stop.
+  std::condition_variable transfer_cv_;
+  /// Signals pushers that a slot was released.
+  std::condition_variable release_cv_;
+  /// Whether the transfer thread should stop.
+  bool stop_ = false;
+};
+
+}  // namespace fletcher
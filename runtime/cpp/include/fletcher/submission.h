@@ -0,0 +1,198 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/fletcher.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/**
+ * @brief Serializes kernel launches of many host threads onto the register window of a single kernel instance.
+ *
+ * Contexts and Kernels are not thread-safe, and all Kernels of an instance share its registers. Threads that each
+ * prepare their own Context can submit launches to the queue of the instance instead of operating a Kernel. Submitting
+ * is lock-free; a single drain thread owned by the queue performs the launches in submission order, such that the
+ * registers are only ever accessed by one thread.
+ *
+ * Every launch is submitted with a priority class, each of which has its own queue. Launches of a class are only
+ * performed while the queues of all higher classes are empty, and launches of the same class are performed in
+ * submission order. Launches are not preempted, but long launches can be submitted in chunks of bounded row ranges,
+ * between which launches of higher classes are performed.
+ *
+ * The drain thread operates a Kernel on the Context of every launch. This Kernel is reused while subsequent launches
+ * operate in the same Context, such that only the metadata registers that changed are rewritten.
+ */
+class SubmissionQueue {
+ public:
+  /// Priority classes of launches, from highest to lowest.
+  enum class Priority : size_t {
+    /// Latency-critical launches, e.g. of interactive queries.
+    HIGH = 0,
+    /// Launches without specific latency requirements.
+    NORMAL,
+    /// Bulk launches that are only performed while no other launches are pending.
+    LOW
+  };
+
+  /**
+   * @brief A function that performs a launch on a Kernel, e.g. by setting arguments, starting it and waiting for it.
+   *
+   * The function is called on the drain thread with a Kernel of which the metadata registers were written.
+   */
+  using LaunchFunction = std::function<Status(Kernel *kernel)>;
+
+  /**
+   * @brief Construct a new SubmissionQueue and start its drain thread.
+   * @param[in] platform  The platform of the kernel instance.
+   * @param[in] mmio_base The offset of the register window of the kernel instance, in registers.
+   */
+  explicit SubmissionQueue(std::shared_ptr<Platform> platform, uint64_t mmio_base = 0);
+
+  /// @brief Stop the drain thread after the pending launches and fail launches that are submitted afterwards.
+  ~SubmissionQueue();
+
+  /**
+   * @brief Create a new SubmissionQueue.
+   * @param[out] out        A pointer to a shared pointer that will own the new SubmissionQueue.
+   * @param[in]  platform   The platform of the kernel instance.
+   * @param[in]  mmio_base  The offset of the register window of the kernel instance, in registers.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<SubmissionQueue> *out,
+                     const std::shared_ptr<Platform> &platform,
+                     uint64_t mmio_base = 0);
+
+  /**
+   * @brief Submit a launch operating in some Context. May be called by any number of threads concurrently.
+   *
+   * The Context must have been enabled, and must not be modified until the launch is complete.
+   *
+   * When chunk_rows is nonzero, the rows of the RecordBatches are launched in consecutive ranges of at most chunk_rows
+   * rows, which are set with Kernel::SetRange() for every RecordBatch before the launch function is called. All
+   * RecordBatches of the Context must then have the same number of rows. The completion holds the status of the first
+   * chunk that failed, after which no further chunks are launched.
+   *
+   * @param[in]  context     The Context holding the RecordBatches to process.
+   * @param[in]  launch      The function performing the launch. When nullptr, the kernel is started and awaited.
+   * @param[out] completion  A future that will hold the status of the launch. May be nullptr.
+   * @param[in]  priority    The priority class of the launch.
+   * @param[in]  chunk_rows  The maximum number of rows of a single launch, or 0 to launch all rows at once.
+   * @return Status::OK() if the launch was submitted, otherwise a descriptive error status.
+   */
+  Status Submit(const std::shared_ptr<Context> &context,
+                LaunchFunction launch = nullptr,
+                std::shared_future<Status> *completion = nullptr,
+                Priority priority = Priority::NORMAL,
+                int64_t chunk_rows = 0);
+
+  /// @brief Return the number of launches that were submitted but are not yet complete.
+  size_t num_pending() const { return num_pending_.load(); }
+
+  /**
+   * Width of the first and last index registers of the kernel instance, see Kernel::index_width.
+   * Must be set before the first launch.
+   */
+  uint32_t index_width = 0;
+  /// Whether the kernel was generated with field enable registers, see Kernel::projection. Must be set before the
+  /// first launch.
+  bool projection = false;
+  /// Whether the kernel was generated with all valid registers, see Kernel::all_valid. Must be set before the first
+  /// launch.
+  bool all_valid = false;
+  /// Whether the kernel was generated with a 64-bit MMIO bus, see Kernel::mmio64. Must be set before the first launch.
+  bool mmio64 = false;
+
+ private:
+  /// A submitted launch, linked into the queue.
+  struct Node {
+    /// The next node in the queue.
+    std::atomic<Node *> next{nullptr};
+    /// The Context of the launch.
+    std::shared_ptr<Context> context;
+    /// The function performing the launch.
+    LaunchFunction launch;
+    /// The promise to fulfill once the launch is complete.
+    std::promise<Status> promise;
+    /// The maximum number of rows of a chunk, or 0 if the launch is not chunked.
+    int64_t chunk_rows = 0;
+    /// The number of rows of the RecordBatches.
+    int64_t num_rows = 0;
+    /// The first row of the next chunk.
+    int64_t next_row = 0;
+  };
+
+  /// The queue of a priority class.
+  struct Lane {
+    /// Placeholder node, such that the queue is never empty.
+    Node stub;
+    /// The most recently pushed node. Exchanged by producers.
+    std::atomic<Node *> head{&stub};
+    /// The oldest node. Only accessed by the drain thread.
+    Node *tail = &stub;
+    /// A chunked launch of which some chunks were performed. Only accessed by the drain thread.
+    Node *partial = nullptr;
+
+    /// @brief Return true if the lane holds no launches. Only called by the drain thread.
+    bool empty() const { return (partial == nullptr) && (tail == &stub) && (head.load() == &stub); }
+  };
+
+  /// @brief Append a node to a lane. Wait-free for a bounded number of producers.
+  static void Push(Lane *lane, Node *node);
+  /// @brief Remove the oldest node from a lane, or return nullptr if none is ready. Only called by the drain thread.
+  static Node *Pop(Lane *lane);
+  /// @brief Perform the launch, or the next chunk of the launch, of a node. Runs on the drain thread.
+  Status Perform(Node *node, bool *complete);
+  /// @brief Perform submitted launches until the queue is destructed. Runs on the drain thread.
+  void Drain();
+
+  /// The platform of the kernel instance.
+  std::shared_ptr<Platform> platform_;
+  /// The offset of the register window of the kernel instance.
+  uint64_t mmio_base_;
+  /// The Kernel of the most recent launch.
+  std::shared_ptr<Kernel> kernel_;
+
+  /// The lanes of all priority classes, from highest to lowest.
+  std::array<Lane, 3> lanes_;
+  /// The number of launches that are not yet complete.
+  std::atomic<size_t> num_pending_{0};
+
+  /// Whether the drain thread is waiting for submissions.
+  std::atomic<bool> sleeping_{false};
+  /// Whether the drain thread should stop.
+  std::atomic<bool> stop_{false};
+  /// Mutex for waking up the drain thread. Only taken when it is sleeping.
+  std::mutex wake_mutex_;
+  /// Signals the drain thread that a launch was submitted or that it should stop.
+  std::condition_variable wake_cv_;
+  /// The drain thread.
+  std::thread drain_thread_;
+};
+
+}  // namespace fletcher
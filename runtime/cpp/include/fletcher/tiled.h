@@ -0,0 +1,129 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+#include <fletcher/fletcher.h>
+#include <cstdint>
+#include <vector>
+#include <memory>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/scheduler.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+/// The results of processing a single tile.
+struct TileResult {
+  /// The rows of the tile.
+  RowRange range;
+  /// The value of the first return register after the kernel finished the tile.
+  uint32_t return0;
+  /// The value of the second return register after the kernel finished the tile.
+  uint32_t return1;
+};
+
+/**
+ * @brief A Context that processes a RecordBatch that does not fit in device memory, one tile of rows at a time.
+ *
+ * The TiledContext allocates a single region of device memory of a fixed size. The rows of the queued RecordBatch are
+ * split into contiguous tiles of which the buffers fit in this region. For every tile, only the parts of the buffers
+ * that hold the rows of the tile are copied. The buffer addresses written to the kernel are offset such that the
+ * kernel can address the rows by their index in the whole RecordBatch, so offsets buffers are copied unchanged.
+ *
+ * Only a single RecordBatch with a read-mode Schema can be processed. Supported field types are fixed-width types,
+ * strings, binaries and lists of fixed-width types. Enable() must not be called on a TiledContext.
+ */
+class TiledContext : public Context {
+ public:
+  /// The alignment of the buffers of a tile in device memory, in bytes.
+  static constexpr int64_t kTileAlignment = 64;
+
+  /**
+   * @brief Construct a new TiledContext. Use Make() to allocate its device memory.
+   * @param[in] platform    The platform to construct the context on.
+   * @param[in] tile_bytes  The size of the device memory that holds a tile, in bytes.
+   */
+  TiledContext(std::shared_ptr<Platform> platform, int64_t tile_bytes);
+
+  /// @brief Destruct the TiledContext, freeing its device memory.
+  ~TiledContext() override;
+
+  /**
+   * @brief Create a new TiledContext.
+   * @param[out] context    A pointer to a shared pointer that will own the new TiledContext.
+   * @param[in]  platform   The platform to create the context on.
+   * @param[in]  tile_bytes The size of the device memory that holds a tile, in bytes.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<TiledContext> *context,
+                     const std::shared_ptr<Platform> &platform,
+                     int64_t tile_bytes);
+
+  /**
+   * @brief Split the rows of the queued RecordBatch into tiles that fit in the device memory of this context.
+   * @param[out] tiles  The tiles, in row order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Plan(std::vector<RowRange> *tiles);
+
+  /**
+   * @brief Copy the rows of a tile to the device memory of this context, and point the device buffers at them.
+   * @param[in] tile  The tile to load.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status LoadTile(const RowRange &tile);
+
+  /**
+   * @brief Process the queued RecordBatch tile by tile.
+   *
+   * For every tile, the tile is loaded, the changed metadata is written, and the kernel is started on the rows of the
+   * tile. Custom arguments must be set on the kernel beforehand.
+   *
+   * @param[in]  kernel   The kernel to process the tiles with. Must operate in this context.
+   * @param[out] results  The return registers of every tile, in row order.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status Run(Kernel *kernel, std::vector<TileResult> *results);
+
+  /// @brief Return the size of the device memory that holds a tile, in bytes.
+  int64_t tile_bytes() const { return tile_bytes_; }
+
+ private:
+  /// A region of a host buffer that holds the rows of a tile.
+  struct Region {
+    /// The offset of the region in the buffer, in bytes.
+    int64_t offset;
+    /// The size of the region, in bytes.
+    int64_t size;
+    /// Whether the buffer is accessed by the kernel. Buffers that are not keep a null device address.
+    bool used;
+  };
+
+  /// @brief Obtain the region of every buffer of the queued RecordBatch that holds the rows [first, last).
+  Status Regions(int64_t first, int64_t last, std::vector<Region> *out) const;
+
+  /// @brief Return the number of bytes of device memory that the regions occupy.
+  static int64_t Footprint(const std::vector<Region> &regions);
+
+  /// The size of the device memory that holds a tile.
+  int64_t tile_bytes_;
+  /// The device memory that holds a tile.
+  da_t tile_memory_ = D_NULLPTR;
+};
+
+}  // namespace fletcher
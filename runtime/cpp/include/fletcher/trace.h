@@ -0,0 +1,151 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <fletcher/timer.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fletcher/stats.h"
+#include "fletcher/status.h"
+
+namespace fletcher {
+
+struct StreamProfile;
+
+/// A recorded span of a phase, with times in nanoseconds since the creation of its Tracer.
+struct Span {
+  /// The phase of the span.
+  Phase phase = Phase::QUEUE;
+  /// The start of the span.
+  int64_t start = 0;
+  /// The duration of the span.
+  int64_t duration = 0;
+  /// The index of the thread that recorded the span, in order of the first span of every thread.
+  uint32_t thread = 0;
+};
+
+/**
+ * @brief Records a timeline of the phases of preparing and launching kernels, for export as a Chrome trace.
+ *
+ * A Tracer is attached to the Instrumentation of a Context (see Context::SetTracer()), after which every timed phase is
+ * recorded as a span, next to its histogram. This includes the phases recorded by Kernels operating in the Context,
+ * and every buffer that is allocated, copied or prepared by Enable(). Without a Tracer, recording a phase costs a
+ * single branch more.
+ *
+ * Every thread records its spans to a ring of its own, without locks. When a ring is full, its oldest spans are
+ * overwritten. Spans must therefore be exported once the traced work is done, rather than while spans are recorded.
+ *
+ * Counters of the stream profilers of a kernel (see Profiler) can be merged into the timeline with Sample().
+ *
+ * The exported JSON can be opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class Tracer {
+ public:
+  /**
+   * @brief Construct a new Tracer.
+   * @param[in] capacity The number of spans every thread can hold before its oldest spans are overwritten.
+   */
+  explicit Tracer(size_t capacity);
+
+  /**
+   * @brief Create a new Tracer.
+   * @param[out] tracer   A pointer to a shared pointer that will own the new Tracer.
+   * @param[in]  capacity The number of spans every thread can hold before its oldest spans are overwritten.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  static Status Make(std::shared_ptr<Tracer> *tracer, size_t capacity = 4096);
+
+  /// @brief Record the interval of a stopped Timer as a span of a phase, on the ring of the calling thread.
+  void Record(Phase phase, const Timer &timer);
+
+  /**
+   * @brief Record the counters of stream profilers at the current time, e.g. as read by Profiler::Read().
+   *
+   * Every stream becomes a counter track of the timeline. Unlike spans, samples are recorded under a lock.
+   *
+   * @param[in] profiles The counters of the profiled streams.
+   */
+  void Sample(const std::vector<StreamProfile> &profiles);
+
+  /// @brief Return all recorded spans, ordered by their start.
+  std::vector<Span> spans() const;
+
+  /// @brief Drop all recorded spans and samples. Must not be called while spans are recorded.
+  void Clear();
+
+  /// @brief Return the recorded spans and samples in the Chrome trace event JSON format.
+  std::string ToChromeJSON() const;
+
+  /**
+   * @brief Write the recorded spans and samples to a file in the Chrome trace event JSON format.
+   * @param[in] path The path of the file to write.
+   * @return Status::OK() if successful, otherwise a descriptive error status.
+   */
+  Status WriteChromeTrace(const std::string &path) const;
+
+ private:
+  /// The spans recorded by a single thread.
+  struct Ring {
+    Ring(size_t capacity, uint32_t thread) : spans(capacity), thread(thread) {}
+    /// The spans, of which span i is held at i modulo the capacity.
+    std::vector<Span> spans;
+    /// The number of spans recorded, including overwritten spans.
+    std::atomic<uint64_t> recorded{0};
+    /// The index of the recording thread.
+    uint32_t thread;
+  };
+
+  /// Counters of a profiled stream at some time.
+  struct CounterSample {
+    /// The time of the sample in nanoseconds since the creation of the Tracer.
+    int64_t time;
+    /// The name of the stream.
+    std::string name;
+    /// The number of elements transferred.
+    uint64_t elements;
+    /// The number of handshakes.
+    uint64_t transfers;
+    /// The number of cycles in which the stream was valid.
+    uint64_t valids;
+    /// The number of cycles in which the stream was ready.
+    uint64_t readies;
+  };
+
+  /// @brief Return the ring of the calling thread, creating it on its first span.
+  Ring *LocalRing();
+
+  /// @brief Return the number of nanoseconds between the creation of the Tracer and a point in time.
+  int64_t Since(const Timer::time_point &t) const;
+
+  /// The unique identifier of this Tracer, such that threads can cache their ring.
+  uint64_t id_;
+  /// The number of spans of every ring.
+  size_t capacity_;
+  /// The creation time of the Tracer.
+  Timer::time_point origin_;
+  /// The rings of all threads that recorded spans.
+  std::vector<std::unique_ptr<Ring>> rings_;
+  /// The recorded samples.
+  std::vector<CounterSample> samples_;
+  /// Mutex protecting the rings and samples vectors, but not the contents of the rings.
+  mutable std::mutex mutex_;
+};
+
+}  // namespace fletcher
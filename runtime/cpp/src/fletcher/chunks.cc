@@ -0,0 +1,232 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/chunks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fletcher {
+
+/// @brief Find a register of a chunk list.
+static Status FindRegister(const std::vector<MmioRegister> &registers, const std::string &name, MmioRegister *out) {
+  auto reg = std::find_if(registers.begin(), registers.end(), [&name](const MmioRegister &r) {
+    return r.name == name;
+  });
+  if (reg == registers.end()) {
+    return Status::ERROR("Register manifest has no register " + name + ". "
+                         "Was the design generated with --chunk_list?");
+  }
+  *out = *reg;
+  return Status::OK();
+}
+
+Status ChunkList::Make(std::shared_ptr<ChunkList> *out,
+                       const std::shared_ptr<Platform> &platform,
+                       const std::vector<MmioRegister> &registers,
+                       uint64_t mmio_base) {
+  std::shared_ptr<ChunkList> result(new ChunkList(platform));
+  result->mmio_base_ = mmio_base;
+
+  // Every RecordBatch with a chunk list has a constant stride register, named after the RecordBatch.
+  const std::string suffix = "_chunk_stride";
+  for (const auto &reg : registers) {
+    if ((reg.name.size() <= suffix.size())
+        || (reg.name.compare(reg.name.size() - suffix.size(), suffix.size(), suffix) != 0)) {
+      continue;
+    }
+    List list;
+    list.name = reg.name.substr(0, reg.name.size() - suffix.size());
+    auto status = FindRegister(registers, list.name + "_chunks", &list.chunks);
+    if (!status.ok()) {
+      return status;
+    }
+    status = FindRegister(registers, list.name + "_num_chunks", &list.num_chunks);
+    if (!status.ok()) {
+      return status;
+    }
+    // The hardware determines the size of a descriptor, from the number of RecordBatch registers and the bus width.
+    status = platform->ReadMMIO(mmio_base + reg.offset, &list.stride);
+    if (!status.ok()) {
+      return status;
+    }
+    if (list.stride == 0) {
+      return Status::ERROR("Chunk list of RecordBatch " + list.name + " has a stride of zero bytes.");
+    }
+    result->lists_.push_back(list);
+  }
+  if (result->lists_.empty()) {
+    return Status::ERROR("Register manifest has no chunk list registers. Was the design generated with --chunk_list?");
+  }
+
+  *out = result;
+  return Status::OK();
+}
+
+Status ChunkList::Make(std::shared_ptr<ChunkList> *out,
+                       const std::shared_ptr<Platform> &platform,
+                       const std::string &manifest_path,
+                       uint64_t mmio_base) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(out, platform, registers, mmio_base);
+}
+
+ChunkList::~ChunkList() {
+  for (const auto &list : lists_) {
+    if (list.address != D_NULLPTR) {
+      platform_->DeviceFree(list.address);
+    }
+  }
+}
+
+Status ChunkList::Write(const MmioRegister &reg, uint64_t value) {
+  for (uint32_t word = 0; 32 * word < reg.width; word++) {
+    auto status = platform_->WriteMMIO(mmio_base_ + reg.offset + word, static_cast<uint32_t>(value >> (32 * word)));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status ChunkList::WriteList(List *list, std::vector<uint8_t> *descriptors, size_t count) {
+  if (count > list->capacity) {
+    if (list->address != D_NULLPTR) {
+      auto status = platform_->DeviceFree(list->address);
+      list->address = D_NULLPTR;
+      list->capacity = 0;
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    auto status = platform_->DeviceMalloc(&list->address, count * list->stride);
+    if (!status.ok()) {
+      list->address = D_NULLPTR;
+      return status;
+    }
+    list->capacity = count;
+    // Descriptors are fetched in a single burst, so they must be aligned to their stride.
+    if (list->address % list->stride != 0) {
+      return Status::ERROR("Chunk list at device address " + std::to_string(list->address)
+                               + " is not aligned to its stride of " + std::to_string(list->stride) + " bytes.");
+    }
+  }
+  auto status = platform_->CopyHostToDevice(descriptors->data(), list->address, count * list->stride);
+  if (!status.ok()) {
+    return status;
+  }
+  status = Write(list->chunks, list->address);
+  if (!status.ok()) {
+    return status;
+  }
+  return Write(list->num_chunks, count);
+}
+
+Status ChunkList::WriteMetaData(Kernel *kernel) {
+  auto context = kernel->context();
+  auto num_rbs = context->num_recordbatches();
+  auto num_bufs = context->num_buffers();
+  if (num_rbs == 0) {
+    return Status::ERROR("Context holds no RecordBatches to write chunk lists for.");
+  }
+  if (kernel->all_valid) {
+    return Status::ERROR("Kernels with chunk lists have no all valid registers. Validity bitmaps of chunks without "
+                         "nulls are skipped through their null address instead.");
+  }
+
+  // Start from the metadata of every RecordBatch, i.e. every chunk, in which the ranges precede the buffer addresses.
+  std::vector<uint32_t> all;
+  kernel->GatherMetaData(&all);
+  auto iregs = (all.size() - 2 * num_bufs) / (2 * num_rbs);
+
+  std::vector<uint32_t> ranges;
+  std::vector<uint32_t> addresses;
+  size_t i = 0;
+  size_t buf = 0;
+  while (i < num_rbs) {
+    const auto &desc = context->recordbatch_description(i);
+    size_t rb_bufs = 0;
+    for (const auto &f : desc.fields) {
+      rb_bufs += f.buffers.size();
+    }
+    auto list = std::find_if(lists_.begin(), lists_.end(), [&desc](const List &l) { return l.name == desc.name; });
+
+    if (list == lists_.end()) {
+      // Without a chunk list, the RecordBatch is written as usual.
+      ranges.insert(ranges.end(), all.begin() + 2 * iregs * i, all.begin() + 2 * iregs * (i + 1));
+      addresses.insert(addresses.end(),
+                       all.begin() + 2 * iregs * num_rbs + 2 * buf,
+                       all.begin() + 2 * iregs * num_rbs + 2 * (buf + rb_bufs));
+      buf += rb_bufs;
+      i++;
+      continue;
+    }
+
+    auto desc_regs = 2 * iregs + 2 * rb_bufs;
+    if (desc_regs * sizeof(uint32_t) > list->stride) {
+      return Status::ERROR("Chunk descriptor of " + std::to_string(desc_regs) + " registers does not fit in the "
+                               + "stride of " + std::to_string(list->stride) + " bytes of the chunk list of "
+                               + list->name + ".");
+    }
+
+    // Every consecutive RecordBatch of the same schema is a chunk, of which the descriptor holds its own metadata.
+    std::vector<uint8_t> descriptors;
+    uint64_t rows = 0;
+    size_t count = 0;
+    auto first_buf = buf;
+    while ((i < num_rbs) && (context->recordbatch_description(i).name == list->name)) {
+      std::vector<uint32_t> regs(all.begin() + 2 * iregs * i, all.begin() + 2 * iregs * (i + 1));
+      regs.insert(regs.end(),
+                  all.begin() + 2 * iregs * num_rbs + 2 * buf,
+                  all.begin() + 2 * iregs * num_rbs + 2 * (buf + rb_bufs));
+      descriptors.resize(descriptors.size() + list->stride, 0);
+      std::memcpy(descriptors.data() + count * list->stride, regs.data(), regs.size() * sizeof(uint32_t));
+      rows += static_cast<uint64_t>(context->recordbatch(i)->num_rows());
+      buf += rb_bufs;
+      count++;
+      i++;
+    }
+    auto status = WriteList(&*list, &descriptors, count);
+    if (!status.ok()) {
+      return status;
+    }
+
+    // The RecordBatch registers hold the range of the concatenated chunks, and the addresses of the first chunk.
+    ranges.insert(ranges.end(), iregs, 0);
+    for (size_t w = 0; w < iregs; w++) {
+      ranges.push_back(static_cast<uint32_t>(rows >> (32 * w)));
+    }
+    addresses.insert(addresses.end(),
+                     all.begin() + 2 * iregs * num_rbs + 2 * first_buf,
+                     all.begin() + 2 * iregs * num_rbs + 2 * (first_buf + rb_bufs));
+  }
+
+  ranges.insert(ranges.end(), addresses.begin(), addresses.end());
+  return kernel->WriteMetaData(ranges);
+}
+
+}  // namespace fletcher
@@ -0,0 +1,163 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/coalesce.h"
+
+#include <arrow/api.h>
+#include <arrow/array/concatenate.h>
+#include <arrow/util/byte_size.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fletcher {
+
+Coalescer::Coalescer(std::shared_ptr<arrow::RecordBatchReader> reader,
+                     int64_t max_rows,
+                     int64_t max_bytes,
+                     int64_t max_latency_usec,
+                     arrow::MemoryPool *pool)
+    : reader_(std::move(reader)),
+      max_rows_(max_rows),
+      max_bytes_(max_bytes),
+      max_latency_(max_latency_usec),
+      pool_(pool) {}
+
+Status Coalescer::Make(std::shared_ptr<Coalescer> *out,
+                       const std::shared_ptr<arrow::RecordBatchReader> &reader,
+                       int64_t max_rows,
+                       int64_t max_bytes,
+                       int64_t max_latency_usec,
+                       arrow::MemoryPool *pool) {
+  if ((reader == nullptr) || (pool == nullptr)) {
+    return Status::ERROR("Coalescer requires a reader and a memory pool.");
+  }
+  if ((max_rows < 0) || (max_bytes < 0) || (max_latency_usec < 0)) {
+    return Status::ERROR("Coalescer limits must not be negative.");
+  }
+  *out = std::make_shared<Coalescer>(reader, max_rows, max_bytes, max_latency_usec, pool);
+  return Status::OK();
+}
+
+Status Coalescer::Next(std::shared_ptr<arrow::RecordBatch> *out) {
+  *out = nullptr;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  int64_t rows = 0;
+  int64_t bytes = 0;
+  auto first = std::chrono::steady_clock::now();
+  while (true) {
+    std::shared_ptr<arrow::RecordBatch> batch = std::move(held_);
+    held_ = nullptr;
+    if (batch == nullptr) {
+      if (exhausted_) {
+        break;
+      }
+      auto status = reader_->ReadNext(&batch);
+      if (!status.ok()) {
+        return Status::ERROR("Could not read RecordBatch to coalesce: " + status.ToString());
+      }
+      if (batch == nullptr) {
+        exhausted_ = true;
+        break;
+      }
+      if (!batch->schema()->Equals(*reader_->schema(), false)) {
+        return Status::ERROR("Coalescer requires RecordBatches of the same Schema.");
+      }
+    }
+
+    auto size = arrow::util::TotalBufferSize(*batch);
+    if (batches.empty()) {
+      first = std::chrono::steady_clock::now();
+    } else if (((max_rows_ > 0) && (rows + batch->num_rows() > max_rows_))
+        || ((max_bytes_ > 0) && (bytes + size > max_bytes_))) {
+      // Keep the RecordBatch for the next coalesced RecordBatch.
+      held_ = std::move(batch);
+      break;
+    }
+    rows += batch->num_rows();
+    bytes += size;
+    batches.push_back(std::move(batch));
+
+    if (((max_rows_ > 0) && (rows >= max_rows_)) || ((max_bytes_ > 0) && (bytes >= max_bytes_))
+        || ((max_latency_.count() > 0) && (std::chrono::steady_clock::now() - first >= max_latency_))) {
+      break;
+    }
+  }
+
+  if (batches.empty()) {
+    return Status::OK();
+  }
+
+  std::vector<int64_t> parts;
+  for (const auto &b : batches) {
+    parts.push_back(b->num_rows());
+  }
+  if (batches.size() == 1) {
+    *out = batches[0];
+    parts_.push_back(std::move(parts));
+    return Status::OK();
+  }
+
+  // Concatenating the columns rebases the offsets of list, string and binary fields.
+  auto schema = reader_->schema();
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (int c = 0; c < schema->num_fields(); c++) {
+    arrow::ArrayVector chunks;
+    for (const auto &b : batches) {
+      chunks.push_back(b->column(c));
+    }
+    auto column = arrow::Concatenate(chunks, pool_);
+    if (!column.ok()) {
+      return Status::ERROR("Could not coalesce field " + schema->field(c)->name() + ": " + column.status().ToString());
+    }
+    columns.push_back(column.ValueOrDie());
+  }
+  *out = arrow::RecordBatch::Make(schema, rows, columns);
+  parts_.push_back(std::move(parts));
+  return Status::OK();
+}
+
+arrow::Status Coalescer::ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) {
+  auto status = Next(batch);
+  if (!status.ok()) {
+    return arrow::Status::IOError(status.message);
+  }
+  return arrow::Status::OK();
+}
+
+Status Coalescer::Split(size_t index,
+                        const std::shared_ptr<arrow::RecordBatch> &batch,
+                        std::vector<std::shared_ptr<arrow::RecordBatch>> *out) const {
+  if (index >= parts_.size()) {
+    return Status::ERROR("Coalesced RecordBatch index " + std::to_string(index) + " out of bounds.");
+  }
+  int64_t rows = 0;
+  for (auto p : parts_[index]) {
+    rows += p;
+  }
+  if (batch->num_rows() < rows) {
+    return Status::ERROR("RecordBatch has " + std::to_string(batch->num_rows()) + " rows, but coalesced RecordBatch "
+                             + std::to_string(index) + " has " + std::to_string(rows) + " rows.");
+  }
+  out->clear();
+  int64_t offset = 0;
+  for (auto p : parts_[index]) {
+    out->push_back(batch->Slice(offset, p));
+    offset += p;
+  }
+  return Status::OK();
+}
+
+}  // namespace fletcher
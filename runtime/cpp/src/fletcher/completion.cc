@@ -0,0 +1,176 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/completion.h"
+
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fletcher {
+
+/// The number of bytes allocated for the record, such that it does not share its cache line with other data.
+constexpr int64_t kRecordAllocation = 64;
+
+/// @brief Find a register of the completion record.
+static Status FindRegister(const std::vector<MmioRegister> &registers, const std::string &name, MmioRegister *out) {
+  auto reg = std::find_if(registers.begin(), registers.end(), [&name](const MmioRegister &r) {
+    return r.name == name;
+  });
+  if (reg == registers.end()) {
+    return Status::ERROR("Register manifest has no register " + name + ". "
+                         "Was the design generated with --completion_record?");
+  }
+  *out = *reg;
+  return Status::OK();
+}
+
+/// @brief Pause a core that spins on a sequence number, until it may have changed.
+static void Relax(const volatile uint32_t *sequence, uint32_t armed) {
+#if defined(__WAITPKG__)
+  // Sleep in the light C0.1 state until the cache line of the sequence number is written, or for about a microsecond.
+  _umonitor(const_cast<uint32_t *>(sequence));
+  if (*sequence == armed) {
+    _umwait(1, __rdtsc() + 4096);
+  }
+#elif defined(__x86_64__) || defined(__i386__)
+  (void) sequence;
+  (void) armed;
+  _mm_pause();
+#else
+  (void) sequence;
+  (void) armed;
+  std::this_thread::yield();
+#endif
+}
+
+Status CompletionRecord::Make(std::shared_ptr<CompletionRecord> *out,
+                              const std::shared_ptr<Platform> &platform,
+                              const std::vector<MmioRegister> &registers,
+                              uint64_t mmio_base) {
+  if (!platform->HasHostMalloc()) {
+    return Status::ERROR("Platform " + platform->name() + " cannot allocate device-visible host memory for a "
+                         "completion record.");
+  }
+  std::shared_ptr<CompletionRecord> result(new CompletionRecord(platform));
+  result->mmio_base_ = mmio_base;
+  auto status = FindRegister(registers, "completion_address", &result->address_reg_);
+  if (!status.ok()) {
+    return status;
+  }
+
+  status = platform->HostMalloc(&result->host_, kRecordAllocation);
+  if (!status.ok()) {
+    return status;
+  }
+  if (!platform->IsDeviceVisible(result->host_, kRecordAllocation, &result->address_)) {
+    return Status::ERROR("Completion record is not visible to the device.");
+  }
+  // The record is written in a single burst of 32 bytes.
+  if (result->address_ % 32 != 0) {
+    return Status::ERROR("Completion record at device address " + std::to_string(result->address_)
+                             + " is not aligned to 32 bytes.");
+  }
+  // The hardware never writes a sequence number of zero, so the first record always changes it.
+  std::memset(result->host_, 0, kRecordAllocation);
+
+  for (uint32_t word = 0; 32 * word < result->address_reg_.width; word++) {
+    status = platform->WriteMMIO(mmio_base + result->address_reg_.offset + word,
+                                 static_cast<uint32_t>(result->address_ >> (32 * word)));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  *out = result;
+  return Status::OK();
+}
+
+Status CompletionRecord::Make(std::shared_ptr<CompletionRecord> *out,
+                              const std::shared_ptr<Platform> &platform,
+                              const std::string &manifest_path,
+                              uint64_t mmio_base) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(out, platform, registers, mmio_base);
+}
+
+CompletionRecord::~CompletionRecord() {
+  if (host_ != nullptr) {
+    // Stop the hardware from writing to the record before it is freed.
+    for (uint32_t word = 0; 32 * word < address_reg_.width; word++) {
+      platform_->WriteMMIO(mmio_base_ + address_reg_.offset + word, 0);
+    }
+    platform_->HostFree(host_);
+  }
+}
+
+uint32_t CompletionRecord::Sequence() const {
+  return *reinterpret_cast<const volatile uint32_t *>(host_ + offsetof(Record, sequence));
+}
+
+void CompletionRecord::Arm() {
+  armed_ = Sequence();
+}
+
+bool CompletionRecord::Done() const {
+  bool done = Sequence() != armed_;
+  // The other fields of the record are read after the sequence number.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return done;
+}
+
+Status CompletionRecord::Wait(unsigned int spin_usec, unsigned int poll_interval_usec, unsigned int timeout_usec) {
+  auto sequence = reinterpret_cast<const volatile uint32_t *>(host_ + offsetof(Record, sequence));
+  auto start = std::chrono::steady_clock::now();
+  auto spin_end = start + std::chrono::microseconds(spin_usec);
+  auto deadline = start + std::chrono::microseconds(timeout_usec);
+  while (!Done()) {
+    auto now = std::chrono::steady_clock::now();
+    if ((timeout_usec > 0) && (now >= deadline)) {
+      return Status::TIMEOUT();
+    }
+    if (now < spin_end) {
+      Relax(sequence, armed_);
+    } else {
+      usleep(poll_interval_usec);
+    }
+  }
+  return Status::OK();
+}
+
+CompletionRecord::Record CompletionRecord::Read() const {
+  Record result{};
+  std::memcpy(&result, host_, sizeof(Record));
+  return result;
+}
+
+}  // namespace fletcher
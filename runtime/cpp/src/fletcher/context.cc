@@ -13,31 +13,98 @@
 // limitations under the License.
 
 #include <arrow/api.h>
+#include <arrow/c/bridge.h>
 #include <fletcher/common.h>
+#include <cstring>
+#include <fstream>
 #include <vector>
 #include <memory>
+#include <utility>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 #include "fletcher/context.h"
+#include "fletcher/numa.h"
+#include "fletcher/profiler.h"
 
 namespace fletcher {
 
+/// @brief Round a size up to a multiple of a power-of-two alignment.
+static inline int64_t AlignUp(int64_t value, int64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
 Status Context::Make(std::shared_ptr<Context> *context, const std::shared_ptr<Platform> &platform) {
   *context = std::make_shared<Context>(platform);
   return Status::OK();
 }
 
+Status Context::Make(std::shared_ptr<Context> *context,
+                     const std::shared_ptr<Platform> &platform,
+                     const std::shared_ptr<DeviceMemoryPool> &pool) {
+  if ((pool != nullptr) && (pool->platform() != platform)) {
+    return Status::ERROR("DeviceMemoryPool was created for a different platform.");
+  }
+  *context = std::make_shared<Context>(platform);
+  (*context)->pool_ = pool;
+  return Status::OK();
+}
+
+Status Context::SetResidencyCache(const std::shared_ptr<ResidencyCache> &cache) {
+  if ((cache != nullptr) && (cache->platform() != platform_)) {
+    return Status::ERROR("ResidencyCache was created for a different platform.");
+  }
+  if (!device_buffers_.empty()) {
+    return Status::ERROR("ResidencyCache must be set before the Context is enabled.");
+  }
+  cache_ = cache;
+  return Status::OK();
+}
+
+Status Context::SetBufferAlignment(int64_t alignment) {
+  if ((alignment < 0) || ((alignment & (alignment - 1)) != 0)) {
+    return Status::ERROR("Buffer alignment must be zero or a power of two.");
+  }
+  if (!device_buffers_.empty()) {
+    return Status::ERROR("Buffer alignment must be set before the Context is enabled.");
+  }
+  buffer_alignment_ = alignment;
+  return Status::OK();
+}
+
 Context::~Context() {
-  Status status;
   FLETCHER_LOG(DEBUG, "Destructing Context...");
-  for (const auto &buf : device_buffers_) {
-    if (buf.was_alloced) {
-      status = platform_->DeviceFree(buf.device_address);
+  auto status = FreeBuffers(device_buffers_);
+  if (!status.ok()) {
+    FLETCHER_LOG(ERROR, "Could not properly free context. Device memory may be corrupted. "
+                        "Status: " + status.message);
+  }
+}
+
+Status Context::FreeBuffers(const std::vector<DeviceBuffer> &buffers) {
+  // Attempt to free all buffers, even if freeing one of them fails.
+  Status result = Status::OK();
+  for (const auto &buf : buffers) {
+    if (buf.resident) {
+      auto status = cache_->Release(buf.device_address);
+      if (!status.ok()) {
+        result = status;
+      }
+    } else if (buf.pooled) {
+      auto status = pool_->Free(buf.device_address);
+      if (!status.ok()) {
+        result = status;
+      }
+    } else if (buf.was_alloced) {
+      auto status = platform_->DeviceFree(buf.device_address);
       if (!status.ok()) {
-        FLETCHER_LOG(ERROR, "Could not properly free context. Device memory may be corrupted. "
-                            "Status: " + status.message);
+        result = status;
       }
     }
   }
+  return result;
 }
 
 Status Context::Enable() {
@@ -48,37 +115,475 @@ Status Context::Enable() {
 
   FLETCHER_LOG(DEBUG, "Enabling context for " << num_batches << " queued RecordBatch(es)");
 
-  // Loop over all batches queued on host
-  for (size_t i = 0; i < num_batches; i++) {
-    auto rbd = host_batch_desc_[i];
-    auto type = host_batch_memtype_[i];
-    for (const auto &f : rbd.fields) {
+  if (transfer_threads_ > 1) {
+    auto status = EnableParallel();
+    if (!status.ok()) {
+      return status;
+    }
+  } else {
+    // Loop over all batches queued on host
+    for (size_t i = 0; i < num_batches; i++) {
+      // Buffers borrowed from another Context are on the device already.
+      auto borrowed = device_batches_.find(i);
+      if (borrowed != device_batches_.end()) {
+        device_buffers_.insert(device_buffers_.end(), borrowed->second.begin(), borrowed->second.end());
+        continue;
+      }
+      auto status = EnableBuffers(host_batch_desc_[i], host_batch_memtype_[i], &device_buffers_, host_batches_[i]);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  FLETCHER_LOG(DEBUG, "Context contains " << device_buffers_.size() << " device buffer(s).");
+  return Status::OK();
+}
+
+Status Context::EnableBuffers(const RecordBatchDescription &desc,
+                              MemType mem_type,
+                              std::vector<DeviceBuffer> *out,
+                              const std::shared_ptr<const void> &owner) {
+  // Cached buffers can be copied with a single vectored copy if the platform supports it. Allocate them first, and
+  // gather the regions to copy. Buffers that may be resident already are acquired from the ResidencyCache instead.
+  bool resident = (cache_ != nullptr) && (owner != nullptr) && (desc.mode == Mode::READ);
+  bool vectored = (mem_type == MemType::CACHE) && !resident && platform_->HasCopyHostToDeviceV();
+  std::vector<fiov_t> iov;
+  for (const auto &f : desc.fields) {
+    for (const auto &b : f.buffers) {
+      DeviceBuffer device_buf(b.raw_buffer_, b.size_, mem_type, desc.mode);
+      device_buf.device_offset = b.device_offset_;
+      // Buffers that the kernel does not access keep a null device address.
+      if (!b.implicit_) {
+        // Misaligned buffers are staged by EnableBuffer, which copies them along with their padding. Buffers in mapped
+        // device memory are used in place by EnableBuffer.
+        da_t mapped = D_NULLPTR;
+        bool gather = vectored && !NeedsStaging(device_buf)
+            && !platform_->IsDeviceMapped(device_buf.host_address, device_buf.size, &mapped);
+        auto status = gather ? AllocateBuffer(&device_buf) : EnableBuffer(&device_buf, owner);
+        if (!status.ok()) {
+          return status;
+        }
+        if (gather && IsNumaRemote(platform_.get(), device_buf.host_address)) {
+          // Buffers on another NUMA node than the device are staged through node-local memory instead.
+          Timer timer;
+          timer.start();
+          status = NumaCopyHostToDevice(platform_.get(), device_buf.host_address, device_buf.device_address,
+                                        device_buf.size);
+          timer.stop();
+          instrumentation_.Record(Phase::COPY, timer);
+          if (!status.ok()) {
+            return status;
+          }
+        } else if (gather) {
+          iov.push_back({device_buf.host_address, device_buf.device_address, static_cast<uint64_t>(device_buf.size)});
+        }
+      }
+      out->push_back(device_buf);
+    }
+  }
+  if (!iov.empty()) {
+    Timer timer;
+    timer.start();
+    auto status = platform_->CopyHostToDeviceV(iov.data(), iov.size());
+    timer.stop();
+    instrumentation_.Record(Phase::COPY, timer);
+    return status;
+  }
+  return Status::OK();
+}
+
+Status Context::AllocateBuffer(DeviceBuffer *device_buf) {
+  Timer timer;
+  timer.start();
+  Status status;
+  if (pool_ != nullptr) {
+    status = pool_->Allocate(&device_buf->device_address, device_buf->size);
+    device_buf->pooled = status.ok();
+  } else {
+    status = platform_->DeviceMalloc(&device_buf->device_address, static_cast<size_t>(device_buf->size));
+    device_buf->was_alloced = status.ok();
+  }
+  timer.stop();
+  instrumentation_.Record(Phase::ALLOC, timer);
+  if (status.ok()) {
+    device_buf->capacity = device_buf->size;
+  }
+  return status;
+}
+
+bool Context::NeedsStaging(const DeviceBuffer &device_buf) const {
+  if ((buffer_alignment_ == 0) || (device_buf.mode != Mode::READ) || (device_buf.size <= 0)) {
+    return false;
+  }
+  auto mask = static_cast<uint64_t>(buffer_alignment_ - 1);
+  return ((reinterpret_cast<uintptr_t>(device_buf.host_address) & mask) != 0)
+      || ((static_cast<uint64_t>(device_buf.size) & mask) != 0);
+}
+
+Status Context::StageBuffer(DeviceBuffer *device_buf) {
+  // Allocate the padded size, but keep the size of the buffer itself.
+  auto size = device_buf->size;
+  device_buf->size = AlignUp(size, buffer_alignment_);
+  auto status = AllocateBuffer(device_buf);
+  device_buf->size = size;
+  if (!status.ok()) {
+    return status;
+  }
+  device_buf->staged = true;
+  status = CopyStaged(*device_buf);
+  if (!status.ok()) {
+    FreeBuffers({*device_buf});
+    device_buf->device_address = D_NULLPTR;
+    device_buf->was_alloced = false;
+    device_buf->pooled = false;
+    device_buf->staged = false;
+    device_buf->capacity = 0;
+  }
+  return status;
+}
+
+Status Context::CopyStaged(const DeviceBuffer &device_buf) {
+  // The whole words are copied from the host buffer. The last partial word is completed with zeros on the host, such
+  // that the padding is written by the same transfer rather than by a separate pass over the device allocation.
+  auto body = device_buf.size & ~(buffer_alignment_ - 1);
+  auto tail_size = device_buf.size - body;
+  std::vector<uint8_t> tail;
+  std::vector<fiov_t> iov;
+  if (body > 0) {
+    iov.push_back({device_buf.host_address, device_buf.device_address, static_cast<uint64_t>(body)});
+  }
+  if (tail_size > 0) {
+    tail.resize(static_cast<size_t>(buffer_alignment_), 0);
+    memcpy(tail.data(), device_buf.host_address + body, static_cast<size_t>(tail_size));
+    iov.push_back({tail.data(), device_buf.device_address + body, static_cast<uint64_t>(buffer_alignment_)});
+  }
+
+  Timer timer;
+  timer.start();
+  Status status;
+  if (platform_->HasCopyHostToDeviceV() && !IsNumaRemote(platform_.get(), device_buf.host_address)) {
+    status = platform_->CopyHostToDeviceV(iov.data(), iov.size());
+  } else {
+    for (size_t i = 0; status.ok() && (i < iov.size()); i++) {
+      status = NumaCopyHostToDevice(platform_.get(), iov[i].host_address, iov[i].device_address,
+                                    static_cast<int64_t>(iov[i].size));
+    }
+  }
+  timer.stop();
+  instrumentation_.Record(Phase::COPY, timer);
+  return status;
+}
+
+Status Context::EnableParallel() {
+  // Lay out all buffers in order first, such that the threads only fill in their device side.
+  std::vector<DeviceBuffer> buffers;
+  std::vector<bool> skip;
+  std::vector<std::shared_ptr<const void>> owners;
+  for (size_t i = 0; i < host_batch_desc_.size(); i++) {
+    // Buffers borrowed from another Context are on the device already.
+    auto borrowed = device_batches_.find(i);
+    if (borrowed != device_batches_.end()) {
+      for (const auto &b : borrowed->second) {
+        buffers.push_back(b);
+        skip.push_back(true);
+        owners.push_back(nullptr);
+      }
+      continue;
+    }
+    const auto &desc = host_batch_desc_[i];
+    for (const auto &f : desc.fields) {
       for (const auto &b : f.buffers) {
-        fletcher::Status status;
-        DeviceBuffer device_buf(b.raw_buffer_, b.size_, type, rbd.mode);
-        if (type == MemType::ANY) {
-          status = platform_->PrepareHostBuffer(device_buf.host_address,
-                                                &device_buf.device_address,
-                                                device_buf.size,
-                                                &device_buf.was_alloced);
-        } else if (type == MemType::CACHE) {
-          status = platform_->CacheHostBuffer(device_buf.host_address,
-                                              &device_buf.device_address,
-                                              device_buf.size);
-          // Cache always allocates on device.
-          device_buf.was_alloced = true;
+        buffers.emplace_back(b.raw_buffer_, b.size_, host_batch_memtype_[i], desc.mode);
+        buffers.back().device_offset = b.device_offset_;
+        skip.push_back(b.implicit_);
+        owners.push_back(host_batches_[i]);
+      }
+    }
+  }
+  std::vector<Status> statuses(buffers.size(), Status::OK());
+  std::atomic<size_t> next(0);
+  auto node = platform_->numa_node();
+  auto worker = [&]() {
+    PinThreadToNode(node);
+    for (auto i = next.fetch_add(1); i < buffers.size(); i = next.fetch_add(1)) {
+      if (!skip[i]) {
+        statuses[i] = EnableBuffer(&buffers[i], owners[i]);
+      }
+    }
+  };
+  auto num_threads = std::min(transfer_threads_, buffers.size());
+  FLETCHER_LOG(DEBUG, "Enabling " << buffers.size() << " buffer(s) using " << num_threads << " thread(s).");
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  // Keep the buffers up to the first failure, such that they are freed with the Context, and free the others.
+  size_t i = 0;
+  while ((i < buffers.size()) && statuses[i].ok()) {
+    device_buffers_.push_back(buffers[i++]);
+  }
+  if (i == buffers.size()) {
+    return Status::OK();
+  }
+  auto result = statuses[i];
+  std::vector<DeviceBuffer> rest;
+  for (size_t j = i + 1; j < buffers.size(); j++) {
+    if (statuses[j].ok()) rest.push_back(buffers[j]);
+  }
+  FreeBuffers(rest);
+  return result;
+}
+
+Status Context::EnableBuffer(DeviceBuffer *device_buf, const std::shared_ptr<const void> &owner) {
+  Timer timer;
+  fletcher::Status status;
+  auto mem_type = device_buf->memory;
+  if (!NeedsStaging(*device_buf)
+      && platform_->IsDeviceMapped(device_buf->host_address, device_buf->size, &device_buf->device_address)) {
+    // The buffer lives in device memory already, e.g. allocated by a MappedMemoryPool. Use it in place for any MemType.
+    return Status::OK();
+  }
+  if ((mem_type == MemType::CACHE) && (cache_ != nullptr) && (owner != nullptr) && (device_buf->mode == Mode::READ)
+      && (device_buf->size > 0)) {
+    // The buffer may be resident already. Otherwise, the cache copies it, unless it does not fit in its budget.
+    timer.start();
+    status = cache_->Acquire(device_buf->host_address, device_buf->size, owner, &device_buf->device_address);
+    timer.stop();
+    if (!status.ok()) {
+      return status;
+    }
+    if (device_buf->device_address != D_NULLPTR) {
+      instrumentation_.Record(Phase::PREPARE, timer);
+      device_buf->resident = true;
+      return Status::OK();
+    }
+  }
+  if (NeedsStaging(*device_buf)) {
+    // The device can not use the buffer in place, nor a copy of it without padding.
+    return StageBuffer(device_buf);
+  }
+  if ((mem_type == MemType::ANY)
+      && platform_->IsDeviceVisible(device_buf->host_address, device_buf->size, &device_buf->device_address)) {
+    // The buffer lives in device-visible host memory, e.g. allocated by a PinnedMemoryPool. Use it in place.
+    status = Status::OK();
+  } else if (mem_type == MemType::ANY) {
+    timer.start();
+    status = platform_->PrepareHostBuffer(device_buf->host_address,
+                                          &device_buf->device_address,
+                                          device_buf->size,
+                                          &device_buf->was_alloced);
+    timer.stop();
+    instrumentation_.Record(Phase::PREPARE, timer);
+  } else if ((mem_type == MemType::CACHE)
+      && ((pool_ != nullptr) || IsNumaRemote(platform_.get(), device_buf->host_address))) {
+    // Buffers on another NUMA node than the device are staged through node-local memory, so the platform can not
+    // allocate and copy them in one call.
+    status = AllocateBuffer(device_buf);
+    if (status.ok()) {
+      timer.start();
+      status = NumaCopyHostToDevice(platform_.get(), device_buf->host_address, device_buf->device_address,
+                                    device_buf->size);
+      timer.stop();
+      instrumentation_.Record(Phase::COPY, timer);
+    }
+  } else if (mem_type == MemType::CACHE) {
+    // The platform allocates and copies in one call, so these can not be timed separately.
+    timer.start();
+    status = platform_->CacheHostBuffer(device_buf->host_address,
+                                        &device_buf->device_address,
+                                        device_buf->size);
+    timer.stop();
+    instrumentation_.Record(Phase::PREPARE, timer);
+    // Cache always allocates on device.
+    device_buf->was_alloced = true;
+  } else {
+    status = Status::ERROR("Invalid / unsupported MemType.");
+  }
+  if (!status.ok()) {
+    if (device_buf->pooled) {
+      pool_->Free(device_buf->device_address);
+      device_buf->pooled = false;
+    }
+    return status;
+  }
+  if (device_buf->was_alloced || device_buf->pooled) {
+    device_buf->capacity = device_buf->size;
+  }
+  return Status::OK();
+}
+
+Status Context::ReplaceRecordBatch(size_t index, const std::shared_ptr<arrow::RecordBatch> &record_batch) {
+  if (record_batch == nullptr) {
+    return Status::ERROR("RecordBatch is nullptr.");
+  }
+  if (index >= host_batches_.size()) {
+    return Status::ERROR("RecordBatch index " + std::to_string(index) + " out of bounds.");
+  }
+  if (device_batches_.count(index) > 0) {
+    return Status::ERROR("RecordBatch " + std::to_string(index) + " was queued from the device and can not be "
+                         "replaced.");
+  }
+  std::shared_ptr<arrow::RecordBatch> split;
+  if (!SplitParallelFields(record_batch, &split)) {
+    return Status::ERROR("Could not split the fields with parallel metadata of the RecordBatch.");
+  }
+  // Find the device buffers of the RecordBatch. Buffers are enabled in the order of their RecordBatches.
+  size_t first = 0;
+  for (size_t i = 0; i < index; i++) {
+    first += NumBuffers(host_batch_desc_[i]);
+  }
+  auto num_buffers = NumBuffers(host_batch_desc_[index]);
+  if (first + num_buffers > device_buffers_.size()) {
+    return Status::ERROR("RecordBatch " + std::to_string(index) + " was not enabled.");
+  }
+
+  RecordBatchDescription rbd;
+  auto status = Describe(*split, &rbd);
+  if (!status.ok()) {
+    return status;
+  }
+  // Arrange the columns like the RecordBatch was arranged when it was queued, such that they map to the same buffers.
+  if (buffer_layout_.count(rbd.name) > 0) {
+    status = ArrangeFields(&split, &rbd);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  // The new RecordBatch must have exactly the same buffers, such that the register map of the kernel is unchanged.
+  const auto &old_desc = host_batch_desc_[index];
+  bool same_layout = (rbd.fields.size() == old_desc.fields.size()) && (rbd.mode == old_desc.mode);
+  for (size_t f = 0; same_layout && (f < rbd.fields.size()); f++) {
+    same_layout = rbd.fields[f].buffers.size() == old_desc.fields[f].buffers.size();
+  }
+  if (!same_layout) {
+    return Status::ERROR("RecordBatch to replace RecordBatch " + std::to_string(index) + " has a different layout.");
+  }
+
+  size_t i = first;
+  for (const auto &f : rbd.fields) {
+    for (const auto &b : f.buffers) {
+      auto &device_buf = device_buffers_[i++];
+      device_buf.host_address = b.raw_buffer_;
+      device_buf.size = b.size_;
+      device_buf.device_offset = b.device_offset_;
+      // Misaligned buffers reuse their allocation only if it fits their padding as well.
+      bool staged = NeedsStaging(device_buf);
+      auto required = staged ? AlignUp(device_buf.size, buffer_alignment_) : device_buf.size;
+      if (b.implicit_) {
+        // The kernel does not access this buffer, so it keeps a null device address.
+        status = FreeBuffers({device_buf});
+        device_buf.device_address = D_NULLPTR;
+        device_buf.was_alloced = false;
+        device_buf.pooled = false;
+        device_buf.resident = false;
+        device_buf.staged = false;
+        device_buf.capacity = 0;
+      } else if ((device_buf.was_alloced || device_buf.pooled) && (device_buf.capacity >= required)) {
+        // Reuse the device allocation.
+        device_buf.staged = staged;
+        if (staged) {
+          status = CopyStaged(device_buf);
         } else {
-          status = Status::ERROR("Invalid / unsupported MemType.");
+          Timer timer;
+          timer.start();
+          status = platform_->CopyHostToDevice(const_cast<uint8_t *>(device_buf.host_address),
+                                               device_buf.device_address,
+                                               device_buf.size);
+          timer.stop();
+          instrumentation_.Record(Phase::COPY, timer);
+        }
+      } else {
+        // The buffer does not fit, or was not allocated on the device at all. Free it and enable it anew.
+        status = FreeBuffers({device_buf});
+        device_buf.device_address = D_NULLPTR;
+        device_buf.was_alloced = false;
+        device_buf.pooled = false;
+        device_buf.resident = false;
+        device_buf.staged = false;
+        device_buf.capacity = 0;
+        if (status.ok()) {
+          status = EnableBuffer(&device_buf, split);
+        }
+      }
+      if (!status.ok()) {
+        return status;
+      }
+    }
+  }
+
+  Recycle(*host_batches_[index]->schema(), std::move(host_batch_desc_[index]));
+  host_batches_[index] = split;
+  host_batch_desc_[index] = std::move(rbd);
+  return Status::OK();
+}
+
+Status Context::ReadbackRecordBatch(size_t index, std::shared_ptr<arrow::RecordBatch> *out, int64_t num_rows) {
+  if (index >= host_batches_.size()) {
+    return Status::ERROR("RecordBatch index " + std::to_string(index) + " out of bounds.");
+  }
+  const auto &desc = host_batch_desc_[index];
+  if (desc.mode != Mode::WRITE) {
+    return Status::ERROR("RecordBatch " + std::to_string(index) + " does not have a write-mode Schema.");
+  }
+  size_t first = 0;
+  for (size_t i = 0; i < index; i++) {
+    first += NumBuffers(host_batch_desc_[i]);
+  }
+  if (first + NumBuffers(desc) > device_buffers_.size()) {
+    return Status::ERROR("RecordBatch " + std::to_string(index) + " was not enabled.");
+  }
+  if (num_rows > host_batches_[index]->num_rows()) {
+    return Status::ERROR("Kernel wrote " + std::to_string(num_rows) + " rows to RecordBatch " + std::to_string(index)
+                             + " of " + std::to_string(host_batches_[index]->num_rows()) + " rows.");
+  }
+
+  size_t i = first;
+  for (const auto &f : desc.fields) {
+    // The values that were written end at the offset of the first row that was not written.
+    auto rows = num_rows >= 0 ? num_rows : f.length;
+    auto id = f.type_->id();
+    bool large = (id == arrow::Type::LARGE_STRING) || (id == arrow::Type::LARGE_BINARY);
+    bool strings = (id == arrow::Type::STRING) || (id == arrow::Type::BINARY) || large;
+    size_t offset_size = large ? sizeof(int64_t) : sizeof(int32_t);
+    // The number of bytes of the values buffer that were written, known after reading back the offsets.
+    int64_t values_size = -1;
+    for (const auto &b : f.buffers) {
+      const auto &device_buf = device_buffers_[i++];
+      if (device_buf.host_visible()) {
+        // The device wrote to host memory directly.
+      } else {
+        auto size = device_buf.size;
+        if (strings && (values_size >= 0) && (b.desc_.back() == "values")) {
+          size = std::min(size, values_size);
         }
+        Timer timer;
+        timer.start();
+        auto status = platform_->CopyDeviceToHost(device_buf.device_address,
+                                                  const_cast<uint8_t *>(device_buf.host_address),
+                                                  static_cast<uint64_t>(size));
+        timer.stop();
+        instrumentation_.Record(Phase::COPY, timer);
         if (!status.ok()) {
           return status;
         }
-        device_buffers_.push_back(device_buf);
+      }
+      if (strings && (b.desc_.back() == "offsets")
+          && (b.size_ >= static_cast<int64_t>((rows + 1) * offset_size))) {
+        if (large) {
+          values_size = reinterpret_cast<const int64_t *>(device_buf.host_address)[rows];
+        } else {
+          values_size = reinterpret_cast<const int32_t *>(device_buf.host_address)[rows];
+        }
       }
     }
   }
 
-  FLETCHER_LOG(DEBUG, "Context contains " << device_buffers_.size() << " device buffer(s).");
+  *out = num_rows >= 0 ? host_batches_[index]->Slice(0, num_rows) : host_batches_[index];
   return Status::OK();
 }
 
@@ -87,31 +592,624 @@ Status Context::QueueRecordBatch(const std::shared_ptr<arrow::RecordBatch> &reco
   if (record_batch == nullptr) {
     return Status::ERROR("RecordBatch is nullptr.");
   }
+  if ((mem_type == MemType::ANY) && platform_->profile().cache) {
+    mem_type = MemType::CACHE;
+  }
 
-  host_batches_.push_back(record_batch);
+  Timer queue_timer;
+  queue_timer.start();
+
+  // Split the fields of which the children are read in parallel, like fletchgen does. This does not copy any data.
+  std::shared_ptr<arrow::RecordBatch> split;
+  if (!SplitParallelFields(record_batch, &split)) {
+    return Status::ERROR("Could not split the fields with parallel metadata of the RecordBatch.");
+  }
 
   // Create a description of the RecordBatch
+  Timer analyze_timer;
+  analyze_timer.start();
   RecordBatchDescription rbd;
-  RecordBatchAnalyzer rba(&rbd);
-  rba.Analyze(*record_batch);
-  host_batch_desc_.push_back(rbd);
+  auto status = Describe(*split, &rbd);
+  if (!status.ok()) {
+    return status;
+  }
+  // Arrange the columns by name in the order of the buffer address registers, if their layout is known.
+  if (buffer_layout_.count(rbd.name) > 0) {
+    status = ArrangeFields(&split, &rbd);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  host_batches_.push_back(split);
+  analyze_timer.stop();
+  instrumentation_.Record(Phase::ANALYZE, analyze_timer);
+  host_batch_desc_.push_back(std::move(rbd));
 
   // Put the desired memory type of the RecordBatch
   host_batch_memtype_.push_back(mem_type);
 
+  queue_timer.stop();
+  instrumentation_.Record(Phase::QUEUE, queue_timer);
+
   return Status::OK();
 }
 
+Status Context::SetLayout(const std::vector<MmioRegister> &registers) {
+  if (!host_batches_.empty()) {
+    return Status::ERROR("Cannot set the buffer layout while RecordBatches are queued.");
+  }
+  // Every RecordBatch of the kernel has a first index register, which is named after its Schema.
+  const std::string suffix = "_firstidx";
+  std::vector<std::string> schemas;
+  for (const auto &reg : registers) {
+    if ((reg.function == "batch") && (reg.name.size() > suffix.size())
+        && (reg.name.compare(reg.name.size() - suffix.size(), suffix.size(), suffix) == 0)) {
+      schemas.push_back(reg.name.substr(0, reg.name.size() - suffix.size()));
+    }
+  }
+  // Buffer address registers are prefixed with the name of their Schema. As Schema names may contain underscores
+  // themselves, the longest matching name is taken.
+  std::map<std::string, std::vector<std::string>> layout;
+  for (const auto &reg : registers) {
+    if (reg.function != "buffer") {
+      continue;
+    }
+    const std::string *schema = nullptr;
+    for (const auto &name : schemas) {
+      if ((reg.name.size() > name.size() + 1) && (reg.name.compare(0, name.size() + 1, name + "_") == 0)
+          && ((schema == nullptr) || (name.size() > schema->size()))) {
+        schema = &name;
+      }
+    }
+    if (schema == nullptr) {
+      return Status::ERROR("Buffer address register " + reg.name + " does not belong to any RecordBatch.");
+    }
+    layout[*schema].push_back(reg.name);
+  }
+  if (layout.empty()) {
+    return Status::ERROR("Register manifest has no buffer address registers.");
+  }
+  buffer_layout_ = std::move(layout);
+  return Status::OK();
+}
+
+Status Context::LoadLayout(const std::string &manifest_path) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return SetLayout(registers);
+}
+
+Status Context::ArrangeFields(std::shared_ptr<arrow::RecordBatch> *record_batch, RecordBatchDescription *desc) const {
+  const auto &layout = buffer_layout_.at(desc->name);
+  auto batch = *record_batch;
+  auto buffer_name = [&](const BufferMetadata &buffer) { return desc->name + "_" + ToString(buffer.desc_); };
+
+  // Find the register of the first buffer of every column. The buffers of a column are named after the column, and
+  // its type determines them, so all its buffers must follow in order. Columns without registers are not accessed.
+  std::vector<std::pair<size_t, int>> positions;
+  for (int c = 0; c < batch->num_columns(); c++) {
+    const auto &buffers = desc->fields[c].buffers;
+    if (buffers.empty()) {
+      continue;
+    }
+    auto first = std::find(layout.begin(), layout.end(), buffer_name(buffers.front()));
+    if (first == layout.end()) {
+      continue;
+    }
+    auto pos = static_cast<size_t>(first - layout.begin());
+    for (size_t b = 0; b < buffers.size(); b++) {
+      if ((pos + b >= layout.size()) || (layout[pos + b] != buffer_name(buffers[b]))) {
+        return Status::ERROR("Type of field " + batch->schema()->field(c)->name() + " of RecordBatch " + desc->name
+                                 + " does not match the buffers of the kernel.");
+      }
+    }
+    positions.emplace_back(pos, c);
+  }
+
+  // The columns must cover every buffer of the layout exactly once.
+  std::sort(positions.begin(), positions.end());
+  size_t next = 0;
+  for (const auto &p : positions) {
+    if (p.first < next) {
+      return Status::ERROR("RecordBatch " + desc->name + " has more than one field named "
+                               + batch->schema()->field(p.second)->name() + ".");
+    }
+    if (p.first > next) {
+      break;
+    }
+    next += desc->fields[p.second].buffers.size();
+  }
+  if (next != layout.size()) {
+    return Status::ERROR("RecordBatch " + desc->name + " lacks the field of buffer " + layout[next] + ".");
+  }
+
+  bool in_order = positions.size() == static_cast<size_t>(batch->num_columns());
+  for (size_t i = 0; in_order && (i < positions.size()); i++) {
+    in_order = positions[i].second == static_cast<int>(i);
+  }
+  if (in_order) {
+    return Status::OK();
+  }
+
+  // Reorder the columns and their descriptions. The arrays are shared, so no data is copied.
+  arrow::FieldVector fields;
+  arrow::ArrayVector columns;
+  std::vector<FieldMetadata> field_desc;
+  for (const auto &p : positions) {
+    fields.push_back(batch->schema()->field(p.second));
+    columns.push_back(batch->column(p.second));
+    field_desc.push_back(std::move(desc->fields[p.second]));
+  }
+  *record_batch = arrow::RecordBatch::Make(arrow::schema(fields, batch->schema()->metadata()),
+                                           batch->num_rows(),
+                                           columns);
+  desc->fields = std::move(field_desc);
+  return Status::OK();
+}
+
+Status Context::QueueRecordBatch(struct ArrowArray *array, struct ArrowSchema *schema, MemType mem_type) {
+  if ((array == nullptr) || (schema == nullptr)) {
+    return Status::ERROR("ArrowArray or ArrowSchema is nullptr.");
+  }
+  auto result = arrow::ImportRecordBatch(array, schema);
+  if (!result.ok()) {
+    return Status::ERROR("Could not import RecordBatch: " + result.status().ToString());
+  }
+  return QueueRecordBatch(std::move(result).ValueOrDie(), mem_type);
+}
+
+Status Context::ExportRecordBatch(size_t index, struct ArrowArray *array, struct ArrowSchema *schema, int64_t num_rows) {
+  if (index >= host_batches_.size()) {
+    return Status::ERROR("RecordBatch index " + std::to_string(index) + " out of bounds.");
+  }
+  auto batch = host_batches_[index];
+  if (host_batch_desc_[index].mode == Mode::WRITE) {
+    auto status = ReadbackRecordBatch(index, &batch, num_rows);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  auto result = arrow::ExportRecordBatch(*batch, array, schema);
+  if (!result.ok()) {
+    return Status::ERROR("Could not export RecordBatch: " + result.ToString());
+  }
+  return Status::OK();
+}
+
+Status Context::QueueRecordBatchesFromFile(const std::string &file_name, MemType mem_type) {
+  Status status = Status::OK();
+  bool read = MapRecordBatchesFromFile(file_name, [&](const std::shared_ptr<arrow::RecordBatch> &rb) {
+    status = QueueRecordBatch(rb, mem_type);
+    return status.ok();
+  });
+  if (!status.ok()) {
+    return status;
+  }
+  if (!read) {
+    return Status::ERROR("Could not read RecordBatches from " + file_name);
+  }
+  return Status::OK();
+}
+
+Status Context::QueueDeviceRecordBatch(const std::shared_ptr<Context> &source,
+                                       size_t index,
+                                       int64_t num_rows,
+                                       const std::shared_ptr<arrow::Schema> &schema) {
+  if (source == nullptr) {
+    return Status::ERROR("Source Context is nullptr.");
+  }
+  if (source.get() == this) {
+    return Status::ERROR("A Context can not queue its own RecordBatches from the device.");
+  }
+  if (source->platform_ != platform_) {
+    return Status::ERROR("Source Context was created for a different platform.");
+  }
+  if (index >= source->host_batches_.size()) {
+    return Status::ERROR("RecordBatch index " + std::to_string(index) + " out of bounds.");
+  }
+  const auto &source_desc = source->host_batch_desc_[index];
+  if (source_desc.mode != Mode::WRITE) {
+    return Status::ERROR("RecordBatch " + std::to_string(index) + " does not have a write-mode Schema.");
+  }
+  // Find the device buffers of the RecordBatch. Buffers are enabled in the order of their RecordBatches.
+  size_t first = 0;
+  for (size_t i = 0; i < index; i++) {
+    first += NumBuffers(source->host_batch_desc_[i]);
+  }
+  if (first + NumBuffers(source_desc) > source->device_buffers_.size()) {
+    return Status::ERROR("RecordBatch " + std::to_string(index) + " was not enabled.");
+  }
+  const auto &source_batch = source->host_batches_[index];
+  if (num_rows > source_batch->num_rows()) {
+    return Status::ERROR("Kernel wrote " + std::to_string(num_rows) + " rows to RecordBatch " + std::to_string(index)
+                             + " of " + std::to_string(source_batch->num_rows()) + " rows.");
+  }
+
+  Timer queue_timer;
+  queue_timer.start();
+
+  // Read the columns of the source RecordBatch with a read-mode Schema. This does not copy any data.
+  auto read_schema = schema;
+  if (read_schema == nullptr) {
+    std::shared_ptr<arrow::KeyValueMetadata> meta;
+    if (source_batch->schema()->metadata() != nullptr) {
+      meta = source_batch->schema()->metadata()->Copy();
+    } else {
+      meta = std::make_shared<arrow::KeyValueMetadata>();
+    }
+    auto set = meta->Set(meta::MODE, meta::READ);
+    if (!set.ok()) {
+      return Status::ERROR("Could not set the mode of the Schema: " + set.ToString());
+    }
+    read_schema = source_batch->schema()->WithMetadata(meta);
+  }
+  if (GetMode(*read_schema) != Mode::READ) {
+    return Status::ERROR("Schema to read RecordBatch " + std::to_string(index) + " with must have read mode.");
+  }
+  if (read_schema->num_fields() != source_batch->num_columns()) {
+    return Status::ERROR("Schema to read RecordBatch " + std::to_string(index) + " with has a different number of "
+                         "fields.");
+  }
+  for (int f = 0; f < read_schema->num_fields(); f++) {
+    if (!read_schema->field(f)->type()->Equals(*source_batch->column(f)->type())) {
+      return Status::ERROR("Field " + read_schema->field(f)->name() + " of the Schema to read RecordBatch "
+                               + std::to_string(index) + " with has a different type.");
+    }
+  }
+  auto batch = arrow::RecordBatch::Make(read_schema, source_batch->num_rows(), source_batch->columns());
+  if (num_rows >= 0) {
+    batch = batch->Slice(0, num_rows);
+  }
+
+  RecordBatchDescription rbd;
+  auto status = Describe(*batch, &rbd);
+  if (!status.ok()) {
+    return status;
+  }
+  bool same_layout = rbd.fields.size() == source_desc.fields.size();
+  for (size_t f = 0; same_layout && (f < rbd.fields.size()); f++) {
+    same_layout = rbd.fields[f].buffers.size() == source_desc.fields[f].buffers.size();
+  }
+  if (!same_layout) {
+    return Status::ERROR("Schema to read RecordBatch " + std::to_string(index) + " with has a different layout.");
+  }
+
+  // Find the first device buffer of every column of the source.
+  std::vector<size_t> column_buffers;
+  for (const auto &f : rbd.fields) {
+    column_buffers.push_back(first);
+    first += f.buffers.size();
+  }
+  // Arrange the columns by name in the order of the buffer address registers of this Context, if their layout is known.
+  auto source_fields = batch->schema()->fields();
+  if (buffer_layout_.count(rbd.name) > 0) {
+    status = ArrangeFields(&batch, &rbd);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  // Borrow the device buffers of the source, such that they are neither enabled nor freed by this Context.
+  std::vector<DeviceBuffer> borrowed;
+  for (size_t c = 0; c < rbd.fields.size(); c++) {
+    auto column = std::find(source_fields.begin(), source_fields.end(), batch->schema()->field(c));
+    size_t i = column_buffers[column - source_fields.begin()];
+    for (const auto &b : rbd.fields[c].buffers) {
+      auto device_buf = source->device_buffers_[i++];
+      device_buf.mode = Mode::READ;
+      device_buf.was_alloced = false;
+      device_buf.pooled = false;
+      device_buf.resident = false;
+      device_buf.staged = false;
+      device_buf.capacity = 0;
+      device_buf.borrowed = true;
+      if (b.implicit_) {
+        // The kernel does not access this buffer, so it keeps a null device address.
+        device_buf.device_address = D_NULLPTR;
+        device_buf.device_offset = 0;
+      }
+      borrowed.push_back(device_buf);
+    }
+  }
+
+  device_batches_[host_batches_.size()] = std::move(borrowed);
+  if (std::find(sources_.begin(), sources_.end(), source) == sources_.end()) {
+    sources_.push_back(source);
+  }
+  host_batches_.push_back(batch);
+  host_batch_desc_.push_back(std::move(rbd));
+  host_batch_memtype_.push_back(source->host_batch_memtype_[index]);
+
+  queue_timer.stop();
+  instrumentation_.Record(Phase::QUEUE, queue_timer);
+
+  return Status::OK();
+}
+
+/// Error message for RecordBatches that can not be described.
+static constexpr char kFillError[] = "Could not describe RecordBatch. Slices of validity bitmaps and boolean values "
+                                     "must start at a multiple of eight rows.";
+
+Status Context::Describe(const arrow::RecordBatch &record_batch, RecordBatchDescription *desc) {
+  const auto &schema = record_batch.schema();
+  auto status = CheckCompressedFields(record_batch);
+  if (!status.ok()) {
+    return status;
+  }
+  status = CheckRunEndEncodedFields(record_batch);
+  if (!status.ok()) {
+    return status;
+  }
+  status = CheckParquetEncodedFields(record_batch);
+  if (!status.ok()) {
+    return status;
+  }
+  status = CheckOnChipFields(record_batch);
+  if (!status.ok()) {
+    return status;
+  }
+  std::shared_ptr<RecordBatchLayout> layout;
+  {
+    std::lock_guard<std::mutex> lock(layouts_mutex_);
+    auto cached = FindLayout(*schema);
+    if ((cached == nullptr) && RecordBatchLayout::Make(schema, &layout)) {
+      cached = &layouts_[layout->schema().get()];
+      cached->layout = layout;
+    }
+    if (cached != nullptr) {
+      layout = cached->layout;
+      // Refill a spare description, which has all buffer names already, and only copy the template otherwise.
+      if (cached->spare.empty()) {
+        *desc = layout->description();
+      } else {
+        *desc = std::move(cached->spare.back());
+        cached->spare.pop_back();
+      }
+    }
+  }
+
+  if (layout != nullptr) {
+    if (!layout->Fill(record_batch, desc)) {
+      return Status::ERROR(kFillError);
+    }
+  } else {
+    RecordBatchAnalyzer rba(desc);
+    if (!rba.Analyze(record_batch)) {
+      return Status::ERROR(kFillError);
+    }
+  }
+  MarkIgnoredFields(*schema, desc);
+  return Status::OK();
+}
+
+Context::CachedLayout *Context::FindLayout(const arrow::Schema &schema) {
+  auto cached = layouts_.find(&schema);
+  if (cached != layouts_.end()) {
+    return &cached->second;
+  }
+  // RecordBatches that are imported or split have a new Schema object every time, which is not added as a key, such
+  // that the cache does not grow with every RecordBatch.
+  for (auto &entry : layouts_) {
+    if (entry.second.layout->schema()->Equals(schema, true)) {
+      return &entry.second;
+    }
+  }
+  return nullptr;
+}
+
+void Context::Recycle(const arrow::Schema &schema, RecordBatchDescription &&desc) {
+  std::lock_guard<std::mutex> lock(layouts_mutex_);
+  // Descriptions of the RecordBatchAnalyzer have no layout, and are simply dropped.
+  auto cached = FindLayout(schema);
+  if (cached != nullptr) {
+    cached->spare.push_back(std::move(desc));
+  }
+}
+
+Status Context::CheckCompressedFields(const arrow::RecordBatch &record_batch) {
+  const auto &schema = *record_batch.schema();
+  for (int c = 0; c < record_batch.num_columns(); c++) {
+    const auto &field = *schema.field(c);
+    if (GetMeta(field, meta::COMPRESSION).empty() || GetBoolMeta(field, meta::IGNORE, false)) {
+      continue;
+    }
+    // The device decompresses the values buffer from its start.
+    auto data = record_batch.column_data(c);
+    auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(data->type);
+    if ((fwt == nullptr) || (data->offset != 0) || (data->buffers.size() < 2) || (data->buffers[1] == nullptr)
+        || (GetUncompressedLength(*data->buffers[1]) != data->length * (fwt->bit_width() / 8))) {
+      return Status::ERROR("Compressed field " + field.name() + " does not hold a compressed buffer of "
+                               + std::to_string(data->length) + " values. See MakeCompressedArray().");
+    }
+  }
+  return Status::OK();
+}
+
+Status Context::CheckRunEndEncodedFields(const arrow::RecordBatch &record_batch) {
+  const auto &schema = *record_batch.schema();
+  for (int c = 0; c < record_batch.num_columns(); c++) {
+    const auto &field = *schema.field(c);
+    if (!IsRunEndEncoded(field) || GetBoolMeta(field, meta::IGNORE, false)) {
+      continue;
+    }
+    auto error = Status::ERROR("Run-end encoded field " + field.name() + " does not hold runs of "
+                                   + std::to_string(record_batch.num_rows()) + " rows. See MakeRunEndEncodedArray().");
+    auto data = record_batch.column_data(c);
+    auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(data->type);
+    if ((fwt == nullptr) || (data->offset != 0) || (data->buffers.size() < 3) || (data->buffers[1] == nullptr)
+        || (data->buffers[2] == nullptr)) {
+      return error;
+    }
+    // The device expands the runs from the first run, until the run that ends at the last row.
+    const auto *run_ends = reinterpret_cast<const int32_t *>(data->buffers[2]->data());
+    auto max_runs = data->buffers[2]->size() / static_cast<int64_t>(sizeof(int32_t));
+    int64_t runs = 0;
+    int32_t previous = 0;
+    while ((previous < data->length) && (runs < max_runs) && (run_ends[runs] > previous)) {
+      previous = run_ends[runs++];
+    }
+    if ((previous != data->length) || (data->buffers[1]->size() * 8 < runs * fwt->bit_width())) {
+      return error;
+    }
+  }
+  return Status::OK();
+}
+
+Status Context::CheckParquetEncodedFields(const arrow::RecordBatch &record_batch) {
+  const auto &schema = *record_batch.schema();
+  for (int c = 0; c < record_batch.num_columns(); c++) {
+    const auto &field = *schema.field(c);
+    if (!IsParquetEncoded(field) || GetBoolMeta(field, meta::IGNORE, false)) {
+      continue;
+    }
+    // The device decodes the page from its start. Nulls have no value in the page.
+    auto data = record_batch.column_data(c);
+    auto fwt = std::dynamic_pointer_cast<arrow::FixedWidthType>(data->type);
+    int64_t values = -1;
+    if ((fwt != nullptr) && (data->offset == 0) && (data->buffers.size() >= 2) && (data->buffers[1] != nullptr)) {
+      values = GetParquetPageValueCount(*data->buffers[1], fwt->bit_width(), field.nullable());
+    }
+    if ((values < 0) || (values > data->length) || (!field.nullable() && (values != data->length))) {
+      return Status::ERROR("Parquet-encoded field " + field.name() + " does not hold a data page of "
+                               + std::to_string(data->length) + " values. See MakeParquetPageArray().");
+    }
+  }
+  return Status::OK();
+}
+
+Status Context::CheckOnChipFields(const arrow::RecordBatch &record_batch) {
+  const auto &schema = *record_batch.schema();
+  for (int c = 0; c < record_batch.num_columns(); c++) {
+    const auto &field = *schema.field(c);
+    auto depth = GetUIntMeta(field, meta::ONCHIP, 0);
+    if ((depth == 0) || GetBoolMeta(field, meta::IGNORE, false)) {
+      continue;
+    }
+    if (static_cast<uint64_t>(record_batch.num_rows()) > depth) {
+      return Status::ERROR("Field " + field.name() + " cached on-chip holds " + std::to_string(record_batch.num_rows())
+                               + " rows, which do not fit in its cache of " + std::to_string(depth) + " elements.");
+    }
+  }
+  return Status::OK();
+}
+
+void Context::MarkIgnoredFields(const arrow::Schema &schema, RecordBatchDescription *desc) {
+  for (size_t f = 0; (f < desc->fields.size()) && (f < static_cast<size_t>(schema.num_fields())); f++) {
+    if (GetBoolMeta(*schema.field(static_cast<int>(f)), meta::IGNORE, false)) {
+      for (auto &b : desc->fields[f].buffers) {
+        b.implicit_ = true;
+      }
+    }
+  }
+}
+
+size_t Context::NumBuffers(const RecordBatchDescription &desc) {
+  size_t ret = 0;
+  for (const auto &f : desc.fields) {
+    ret += f.buffers.size();
+  }
+  return ret;
+}
+
 uint64_t Context::num_buffers() const {
   uint64_t ret = 0;
   for (const auto &rbd : host_batch_desc_) {
-    for (const auto &f : rbd.fields) {
-      ret += f.buffers.size();
-    }
+    ret += NumBuffers(rbd);
   }
   return ret;
 }
 
+QueueSizes &QueueSizes::operator+=(const QueueSizes &other) {
+  transfer += other.transfer;
+  allocate += other.allocate;
+  resident += other.resident;
+  kernel += other.kernel;
+  return *this;
+}
+
+QueueSizes Context::BufferSizes(const BufferMetadata &buffer,
+                                Mode mode,
+                                MemType mem_type,
+                                const DeviceBuffer *device_buf) const {
+  QueueSizes result;
+  // Buffers that the kernel does not access are never made available to the device.
+  if (buffer.implicit_) {
+    return result;
+  }
+  result.kernel = buffer.size_;
+  // Regions of a pool are padded to its alignment, like DeviceMemoryPool::Allocate() does.
+  auto pooled_size = [this](int64_t size) { return AlignUp(std::max<int64_t>(size, 1), pool_->alignment()); };
+  if (device_buf != nullptr) {
+    if (device_buf->resident) {
+      result.resident = device_buf->size;
+    } else if (device_buf->was_alloced || device_buf->pooled) {
+      result.transfer = device_buf->staged ? AlignUp(device_buf->size, buffer_alignment_) : device_buf->size;
+      result.allocate = device_buf->pooled ? pooled_size(device_buf->capacity) : device_buf->capacity;
+    }
+    return result;
+  }
+  // Predict what EnableBuffer() would do.
+  DeviceBuffer predicted(buffer.raw_buffer_, buffer.size_, mem_type, mode);
+  if (!NeedsStaging(predicted)
+      && platform_->IsDeviceMapped(buffer.raw_buffer_, buffer.size_, &predicted.device_address)) {
+    // The buffer is used in place.
+  } else if ((mem_type == MemType::CACHE) && (cache_ != nullptr) && (mode == Mode::READ) && (buffer.size_ > 0)
+      && cache_->IsResident(buffer.raw_buffer_, buffer.size_)) {
+    result.resident = buffer.size_;
+  } else if (NeedsStaging(predicted)) {
+    result.transfer = AlignUp(buffer.size_, buffer_alignment_);
+    result.allocate = pool_ != nullptr ? pooled_size(result.transfer) : result.transfer;
+  } else if ((mem_type == MemType::ANY)
+      && platform_->IsDeviceVisible(buffer.raw_buffer_, buffer.size_, &predicted.device_address)) {
+    // The buffer is used in place.
+  } else {
+    result.transfer = buffer.size_;
+    result.allocate = (pool_ != nullptr) && (mem_type == MemType::CACHE) ? pooled_size(buffer.size_) : buffer.size_;
+  }
+  return result;
+}
+
+QueueSizes Context::GetQueueSizes(std::vector<FieldQueueSizes> *fields) const {
+  QueueSizes total;
+  // Buffers are enabled in the order of their RecordBatches, like ReplaceRecordBatch() assumes.
+  size_t index = 0;
+  for (size_t i = 0; i < host_batch_desc_.size(); i++) {
+    const auto &desc = host_batch_desc_[i];
+    const auto &schema = *host_batches_[i]->schema();
+    // Buffers borrowed from another Context are known before this Context is enabled.
+    auto borrowed = device_batches_.find(i);
+    size_t j = 0;
+    for (size_t f = 0; f < desc.fields.size(); f++) {
+      FieldQueueSizes field;
+      field.recordbatch = i;
+      field.field = schema.field(static_cast<int>(f))->name();
+      for (const auto &b : desc.fields[f].buffers) {
+        const DeviceBuffer *device_buf = nullptr;
+        if (index < device_buffers_.size()) {
+          device_buf = &device_buffers_[index];
+        } else if (borrowed != device_batches_.end()) {
+          device_buf = &borrowed->second[j];
+        }
+        field.sizes += BufferSizes(b, desc.mode, host_batch_memtype_[i], device_buf);
+        index++;
+        j++;
+      }
+      total += field.sizes;
+      if (fields != nullptr) {
+        fields->push_back(field);
+      }
+    }
+  }
+  return total;
+}
+
 size_t Context::GetQueueSize() const {
   size_t size = 0;
   for (const auto &desc : host_batch_desc_) {
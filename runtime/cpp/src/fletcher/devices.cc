@@ -0,0 +1,168 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/devices.h"
+
+#include <fletcher/arrow-recordbatch.h>
+#include <sstream>
+#include <utility>
+
+namespace fletcher {
+
+std::string DevicePool::Stats::ToString() const {
+  std::stringstream ss;
+  ss << "DevicePool: " << devices.size() << " device(s)" << std::endl;
+  for (size_t d = 0; d < devices.size(); d++) {
+    ss << "  Device " << d << " : " << devices[d].acquisitions << " acquisitions, "
+       << devices[d].in_flight << " in flight" << std::endl;
+  }
+  return ss.str();
+}
+
+DevicePool::DevicePool(std::vector<std::shared_ptr<Platform>> platforms, Policy policy)
+    : platforms_(std::move(platforms)), policy_(policy), devices_(platforms_.size()) {}
+
+Status DevicePool::Make(std::shared_ptr<DevicePool> *out,
+                        const std::vector<std::shared_ptr<Platform>> &platforms,
+                        Policy policy,
+                        int64_t cache_budget) {
+  if (platforms.empty()) {
+    return Status::ERROR("A DevicePool requires at least one device.");
+  }
+  if (cache_budget < 0) {
+    return Status::ERROR("DevicePool cache budget must not be negative.");
+  }
+  std::shared_ptr<DevicePool> result(new DevicePool(platforms, policy));
+  if (cache_budget > 0) {
+    for (const auto &platform : platforms) {
+      std::shared_ptr<ResidencyCache> cache;
+      auto status = ResidencyCache::Make(&cache, platform, cache_budget);
+      if (!status.ok()) {
+        return status;
+      }
+      result->caches_.push_back(cache);
+    }
+  }
+  *out = result;
+  return Status::OK();
+}
+
+std::vector<int64_t> DevicePool::ResidentBytes(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches) {
+  std::vector<int64_t> result(platforms_.size(), 0);
+  if (caches_.empty()) {
+    return result;
+  }
+  for (const auto &batch : batches) {
+    RecordBatchDescription desc;
+    RecordBatchAnalyzer rba(&desc);
+    if (!rba.Analyze(*batch)) {
+      continue;
+    }
+    for (const auto &f : desc.fields) {
+      for (const auto &b : f.buffers) {
+        if (b.implicit_ || (b.size_ == 0)) {
+          continue;
+        }
+        for (size_t d = 0; d < caches_.size(); d++) {
+          if (caches_[d]->IsResident(b.raw_buffer_, b.size_)) {
+            result[d] += b.size_;
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+Status DevicePool::Acquire(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, size_t *device) {
+  // Determine the locality before taking the mutex, the caches have their own.
+  std::vector<int64_t> resident;
+  if (policy_ == Policy::LOCALITY) {
+    resident = ResidentBytes(batches);
+  } else {
+    resident.resize(platforms_.size(), 0);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t best = 0;
+  for (size_t d = 1; d < devices_.size(); d++) {
+    if ((resident[d] > resident[best])
+        || ((resident[d] == resident[best]) && (devices_[d].in_flight < devices_[best].in_flight))) {
+      best = d;
+    }
+  }
+  devices_[best].acquisitions++;
+  devices_[best].in_flight++;
+  *device = best;
+  return Status::OK();
+}
+
+Status DevicePool::Release(size_t device) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if ((device >= devices_.size()) || (devices_[device].in_flight == 0)) {
+    return Status::ERROR("Device " + std::to_string(device) + " was not acquired from this DevicePool.");
+  }
+  devices_[device].in_flight--;
+  return Status::OK();
+}
+
+Status DevicePool::MakeContext(size_t device, std::shared_ptr<Context> *context) {
+  if (device >= platforms_.size()) {
+    return Status::ERROR("DevicePool has no device " + std::to_string(device) + ".");
+  }
+  auto status = Context::Make(context, platforms_[device]);
+  if (!status.ok()) {
+    return status;
+  }
+  if (!caches_.empty()) {
+    return (*context)->SetResidencyCache(caches_[device]);
+  }
+  return Status::OK();
+}
+
+Status DevicePool::Run(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches,
+                       const std::function<Status(Kernel *kernel)> &launch,
+                       MemType mem_type) {
+  size_t device = 0;
+  auto status = Acquire(batches, &device);
+  if (!status.ok()) {
+    return status;
+  }
+  {
+    std::shared_ptr<Context> context;
+    status = MakeContext(device, &context);
+    for (size_t i = 0; status.ok() && (i < batches.size()); i++) {
+      status = context->QueueRecordBatch(batches[i], mem_type);
+    }
+    if (status.ok()) {
+      status = context->Enable();
+    }
+    if (status.ok()) {
+      Kernel kernel(context);
+      status = launch(&kernel);
+    }
+  }
+  // Release the device after the Context freed its buffers.
+  auto released = Release(device);
+  return status.ok() ? released : status;
+}
+
+DevicePool::Stats DevicePool::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats result;
+  result.devices = devices_;
+  return result;
+}
+
+}  // namespace fletcher
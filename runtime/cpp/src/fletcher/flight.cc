@@ -0,0 +1,268 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/flight.h"
+
+#include <arrow/api.h>
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifdef FLETCHER_FLIGHT
+#include <arrow/flight/api.h>
+#endif
+
+namespace fletcher {
+
+namespace {
+
+/// @brief Reader that labels the RecordBatches of another reader with the Schema of the service, without copying them.
+class SchemaReader : public arrow::RecordBatchReader {
+ public:
+  SchemaReader(arrow::RecordBatchReader *source, std::shared_ptr<arrow::Schema> schema)
+      : source_(source), schema_(std::move(schema)) {}
+
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override {
+    ARROW_RETURN_NOT_OK(source_->ReadNext(batch));
+    if (*batch == nullptr) {
+      return arrow::Status::OK();
+    }
+    if ((*batch)->num_columns() != schema_->num_fields()) {
+      return arrow::Status::Invalid("RecordBatch has " + std::to_string((*batch)->num_columns())
+                                        + " columns, but the Schema has " + std::to_string(schema_->num_fields())
+                                        + " fields.");
+    }
+    for (int f = 0; f < schema_->num_fields(); f++) {
+      if (!(*batch)->column(f)->type()->Equals(*schema_->field(f)->type())) {
+        return arrow::Status::Invalid("Column " + (*batch)->schema()->field(f)->name()
+                                          + " does not match field " + schema_->field(f)->name() + " of the Schema.");
+      }
+    }
+    *batch = arrow::RecordBatch::Make(schema_, (*batch)->num_rows(), (*batch)->columns());
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::RecordBatchReader *source_;
+  std::shared_ptr<arrow::Schema> schema_;
+};
+
+/// @brief Return a RecordBatch with a single row holding the return registers of a kernel.
+Status ReturnRegisters(size_t, Kernel *kernel, std::shared_ptr<arrow::RecordBatch> *out) {
+  uint32_t lo = 0;
+  uint32_t hi = 0;
+  auto status = kernel->GetReturn(&lo, &hi);
+  if (!status.ok()) return status;
+  arrow::UInt64Builder builder;
+  std::shared_ptr<arrow::Array> result;
+  auto append = builder.Append((static_cast<uint64_t>(hi) << 32) | lo);
+  if (append.ok()) {
+    append = builder.Finish(&result);
+  }
+  if (!append.ok()) {
+    return Status::ERROR("Could not build kernel result: " + append.ToString());
+  }
+  *out = arrow::RecordBatch::Make(arrow::schema({arrow::field("result", arrow::uint64(), false)}), 1, {result});
+  return Status::OK();
+}
+
+}  // namespace
+
+FlightService::FlightService(std::shared_ptr<Kernel> kernel,
+                             std::shared_ptr<arrow::Schema> schema,
+                             ResultFunction result)
+    : kernel_(std::move(kernel)), schema_(std::move(schema)), result_(std::move(result)) {
+  context_ = std::dynamic_pointer_cast<StreamingContext>(kernel_->context());
+}
+
+FlightService::~FlightService() {
+  Shutdown();
+}
+
+Status FlightService::Make(std::shared_ptr<FlightService> *out,
+                           const std::shared_ptr<Kernel> &kernel,
+                           const std::shared_ptr<arrow::Schema> &schema,
+                           const ResultFunction &result) {
+  if ((kernel == nullptr) || (schema == nullptr)) {
+    return Status::ERROR("FlightService requires a Kernel and a Schema.");
+  }
+  if (std::dynamic_pointer_cast<StreamingContext>(kernel->context()) == nullptr) {
+    return Status::ERROR("FlightService requires a Kernel constructed on a StreamingContext.");
+  }
+  *out = std::make_shared<FlightService>(kernel, schema, result ? result : ReturnRegisters);
+  return Status::OK();
+}
+
+Status FlightService::Process(arrow::RecordBatchReader *reader, const ResultWriter &writer) {
+  if ((reader == nullptr) || (writer == nullptr)) {
+    return Status::ERROR("Reader or writer is nullptr.");
+  }
+  SchemaReader labeled(reader, schema_);
+  std::lock_guard<std::mutex> lock(kernel_mutex_);
+  // Results are written back as soon as the kernel finished a RecordBatch, while the next one is being transferred.
+  return context_->Run(&labeled, kernel_.get(), nullptr, MemType::ANY, [&](size_t index, Kernel *kernel) -> Status {
+    std::shared_ptr<arrow::RecordBatch> result;
+    auto status = result_(index, kernel, &result);
+    if (!status.ok()) return status;
+    return writer(index, result);
+  });
+}
+
+#ifdef FLETCHER_FLIGHT
+
+namespace {
+
+/// @brief Reader that returns the RecordBatches of a Flight stream, skipping messages that only hold metadata.
+class FlightReader : public arrow::RecordBatchReader {
+ public:
+  FlightReader(arrow::flight::FlightMessageReader *reader, std::shared_ptr<arrow::Schema> schema)
+      : reader_(reader), schema_(std::move(schema)) {}
+
+  std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+  arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override {
+    arrow::flight::FlightStreamChunk chunk;
+    do {
+      ARROW_RETURN_NOT_OK(reader_->Next(&chunk));
+    } while ((chunk.data == nullptr) && (chunk.app_metadata != nullptr));
+    *batch = chunk.data;
+    return arrow::Status::OK();
+  }
+
+ private:
+  arrow::flight::FlightMessageReader *reader_;
+  std::shared_ptr<arrow::Schema> schema_;
+};
+
+/// @brief Flight server that passes the streams to a FlightService.
+class Server : public arrow::flight::FlightServerBase {
+ public:
+  explicit Server(FlightService *service) : service_(service) {}
+
+  arrow::Status DoPut(const arrow::flight::ServerCallContext &,
+                      std::unique_ptr<arrow::flight::FlightMessageReader> reader,
+                      std::unique_ptr<arrow::flight::FlightMetadataWriter> writer) override {
+    ARROW_ASSIGN_OR_RAISE(auto schema, reader->GetSchema());
+    FlightReader batches(reader.get(), schema);
+    auto status = service_->Process(&batches, [&](size_t, const std::shared_ptr<arrow::RecordBatch> &result) {
+      // Write back the first value of the first column, i.e. the return registers for the default result function.
+      uint64_t value = 0;
+      if ((result != nullptr) && (result->num_rows() > 0) && (result->column(0)->type_id() == arrow::Type::UINT64)) {
+        value = std::static_pointer_cast<arrow::UInt64Array>(result->column(0))->Value(0);
+      }
+      auto written = writer->WriteMetadata(*arrow::Buffer::Wrap(&value, 1));
+      return written.ok() ? Status::OK() : Status::ERROR("Could not write result: " + written.ToString());
+    });
+    return status.ok() ? arrow::Status::OK() : arrow::Status::ExecutionError(status.message);
+  }
+
+  arrow::Status DoExchange(const arrow::flight::ServerCallContext &,
+                           std::unique_ptr<arrow::flight::FlightMessageReader> reader,
+                           std::unique_ptr<arrow::flight::FlightMessageWriter> writer) override {
+    ARROW_ASSIGN_OR_RAISE(auto schema, reader->GetSchema());
+    FlightReader batches(reader.get(), schema);
+    bool begun = false;
+    auto status = service_->Process(&batches, [&](size_t, const std::shared_ptr<arrow::RecordBatch> &result) {
+      if (result == nullptr) {
+        return Status::OK();
+      }
+      arrow::Status written;
+      if (!begun) {
+        written = writer->Begin(result->schema());
+        begun = true;
+      }
+      if (written.ok()) {
+        written = writer->WriteRecordBatch(*result);
+      }
+      return written.ok() ? Status::OK() : Status::ERROR("Could not write result: " + written.ToString());
+    });
+    return status.ok() ? arrow::Status::OK() : arrow::Status::ExecutionError(status.message);
+  }
+
+ private:
+  FlightService *service_;
+};
+
+}  // namespace
+
+Status FlightService::Serve(const std::string &uri) {
+  std::shared_ptr<Server> server;
+  {
+    std::lock_guard<std::mutex> lock(server_mutex_);
+    if (server_ != nullptr) {
+      return Status::ERROR("FlightService is already serving.");
+    }
+    arrow::flight::Location location;
+    auto status = arrow::flight::Location::Parse(uri, &location);
+    if (status.ok()) {
+      server = std::make_shared<Server>(this);
+      status = server->Init(arrow::flight::FlightServerOptions(location));
+    }
+    if (!status.ok()) {
+      return Status::ERROR("Could not serve at " + uri + ": " + status.ToString());
+    }
+    server_ = server;
+  }
+  auto status = server->Serve();
+  {
+    std::lock_guard<std::mutex> lock(server_mutex_);
+    server_ = nullptr;
+  }
+  if (!status.ok()) {
+    return Status::ERROR("Could not serve at " + uri + ": " + status.ToString());
+  }
+  return Status::OK();
+}
+
+Status FlightService::Shutdown() {
+  std::shared_ptr<arrow::flight::FlightServerBase> server;
+  {
+    std::lock_guard<std::mutex> lock(server_mutex_);
+    server = server_;
+  }
+  if (server == nullptr) {
+    return Status::OK();
+  }
+  auto status = server->Shutdown();
+  if (!status.ok()) {
+    return Status::ERROR("Could not shut the server down: " + status.ToString());
+  }
+  return Status::OK();
+}
+
+int FlightService::port() const {
+  std::lock_guard<std::mutex> lock(server_mutex_);
+  return server_ != nullptr ? server_->port() : 0;
+}
+
+#else
+
+Status FlightService::Serve(const std::string &uri) {
+  return Status::ERROR("Could not serve at " + uri + ": the Fletcher run-time library was built without Arrow Flight "
+                       "support (FLETCHER_FLIGHT).");
+}
+
+Status FlightService::Shutdown() {
+  return Status::OK();
+}
+
+int FlightService::port() const {
+  return 0;
+}
+
+#endif
+
+}  // namespace fletcher
@@ -0,0 +1,122 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/image.h"
+
+#include <fletcher/common.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace fletcher {
+
+ImageCache::ImageCache(std::shared_ptr<Platform> platform, size_t num_regions, uint64_t window_regs)
+    : platform_(std::move(platform)), window_regs_(window_regs), regions_(num_regions) {}
+
+Status ImageCache::Make(std::shared_ptr<ImageCache> *out,
+                        const std::shared_ptr<Platform> &platform,
+                        size_t num_regions,
+                        uint64_t window_regs) {
+  if (platform == nullptr) {
+    return Status::ERROR("Platform is nullptr.");
+  }
+  if (num_regions == 0) {
+    return Status::ERROR("ImageCache requires at least one region.");
+  }
+  *out = std::make_shared<ImageCache>(platform, num_regions, window_regs);
+  return Status::OK();
+}
+
+Status ImageCache::Register(const std::string &path, const std::vector<std::shared_ptr<arrow::Schema>> &schema_set) {
+  auto hash = SchemaSetHash(schema_set);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto existing = images_.find(hash);
+  if ((existing != images_.end()) && (existing->second != path)) {
+    return Status::ERROR("Image " + existing->second + " was already registered for the schemas of image " + path
+                             + ".");
+  }
+  images_[hash] = path;
+  return Status::OK();
+}
+
+Status ImageCache::Acquire(const std::vector<std::shared_ptr<arrow::Schema>> &schema_set, uint64_t *mmio_base) {
+  auto hash = SchemaSetHash(schema_set);
+  std::lock_guard<std::mutex> lock(mutex_);
+  tick_++;
+
+  // Find out what regions that were not loaded by this cache hold, by reading their schema hash register once. A zero
+  // hash is taken to mean the region is empty, or holds an image without a schema hash register.
+  for (size_t i = 0; i < regions_.size(); i++) {
+    auto &r = regions_[i];
+    if (!r.probed) {
+      r.probed = true;
+      r.loaded = platform_->ReadMMIO(i * window_regs_ + FLETCHER_REG_SCHEMA_HASH, &r.hash).ok() && (r.hash != 0);
+    }
+  }
+
+  for (size_t i = 0; i < regions_.size(); i++) {
+    auto &r = regions_[i];
+    if (r.loaded && (r.hash == hash)) {
+      stats_.hits++;
+      r.last_use = tick_;
+      *mmio_base = i * window_regs_;
+      return Status::OK();
+    }
+  }
+
+  stats_.misses++;
+  auto image = images_.find(hash);
+  if (image == images_.end()) {
+    return Status::ERROR("No image was registered for the schemas.");
+  }
+  // Load the image into the least recently used region, preferring empty regions.
+  size_t victim = 0;
+  for (size_t i = 1; i < regions_.size(); i++) {
+    const auto &r = regions_[i];
+    const auto &v = regions_[victim];
+    if ((v.loaded && !r.loaded) || ((v.loaded == r.loaded) && (r.last_use < v.last_use))) {
+      victim = i;
+    }
+  }
+  auto &r = regions_[victim];
+  if (r.loaded) {
+    stats_.evictions++;
+  }
+  Timer t;
+  t.start();
+  auto status = platform_->LoadImage(image->second, victim);
+  t.stop();
+  stats_.load_seconds += t.seconds();
+  if (!status.ok()) {
+    // The region may hold a partially programmed image.
+    r.loaded = false;
+    return status;
+  }
+  FLETCHER_LOG(DEBUG, "Loaded image " << image->second << " into region " << victim << " in " << t.seconds()
+                                      << " s.");
+  stats_.loads++;
+  r.loaded = true;
+  r.hash = hash;
+  r.last_use = tick_;
+  *mmio_base = victim * window_regs_;
+  return Status::OK();
+}
+
+ImageCacheStats ImageCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace fletcher
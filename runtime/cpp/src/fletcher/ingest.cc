@@ -0,0 +1,235 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/ingest.h"
+
+#include <arrow/api.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef FLETCHER_PARQUET
+#include <arrow/io/file.h>
+#include <parquet/arrow/reader.h>
+#include <parquet/exception.h>
+#include <parquet/file_reader.h>
+#endif
+
+namespace fletcher {
+
+Ingest::Ingest(std::shared_ptr<arrow::Schema> schema,
+               size_t num_units,
+               DecodeFunction decode,
+               size_t num_threads,
+               size_t capacity,
+               arrow::MemoryPool *pool)
+    : schema_(std::move(schema)), num_units_(num_units), decode_(std::move(decode)), capacity_(capacity), pool_(pool) {
+  for (size_t t = 0; t < num_threads; t++) {
+    threads_.emplace_back(&Ingest::DecodeUnits, this);
+  }
+}
+
+Ingest::~Ingest() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  decode_cv_.notify_all();
+  for (auto &t : threads_) {
+    t.join();
+  }
+}
+
+Status Ingest::Make(std::shared_ptr<Ingest> *out,
+                    const std::shared_ptr<arrow::Schema> &schema,
+                    size_t num_units,
+                    const DecodeFunction &decode,
+                    size_t num_threads,
+                    size_t capacity,
+                    arrow::MemoryPool *pool) {
+  if ((schema == nullptr) || (decode == nullptr) || (pool == nullptr)) {
+    return Status::ERROR("Ingest requires a Schema, a decode function and a memory pool.");
+  }
+  if ((num_threads == 0) || (capacity == 0)) {
+    return Status::ERROR("Ingest requires at least one thread and a capacity of at least one unit.");
+  }
+  *out = std::make_shared<Ingest>(schema, num_units, decode, num_threads, capacity, pool);
+  return Status::OK();
+}
+
+void Ingest::DecodeUnits() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    // Decode the next unit once it is within the capacity ahead of the RecordBatch returned last.
+    decode_cv_.wait(lock, [this]() {
+      return stop_ || (next_unit_ >= num_units_) || (next_unit_ < next_batch_ + capacity_);
+    });
+    if (stop_ || (next_unit_ >= num_units_)) {
+      return;
+    }
+    auto unit = next_unit_++;
+    lock.unlock();
+
+    Decoded decoded;
+    decoded.status = decode_(unit, pool_, &decoded.batch);
+    if (decoded.status.ok() && (decoded.batch == nullptr)) {
+      decoded.status = Status::ERROR("Decoding unit " + std::to_string(unit) + " did not produce a RecordBatch.");
+    }
+
+    lock.lock();
+    decoded_[unit] = std::move(decoded);
+    ready_cv_.notify_all();
+  }
+}
+
+Status Ingest::Next(std::shared_ptr<arrow::RecordBatch> *out) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (next_batch_ >= num_units_) {
+    *out = nullptr;
+    return Status::OK();
+  }
+  ready_cv_.wait(lock, [this]() { return decoded_.count(next_batch_) > 0; });
+  auto it = decoded_.find(next_batch_);
+  auto decoded = std::move(it->second);
+  decoded_.erase(it);
+  next_batch_++;
+  if (!decoded.status.ok()) {
+    // Stop decoding. The units that are being decoded are dropped when the Ingest is destructed.
+    stop_ = true;
+    next_batch_ = num_units_;
+    decoded_.clear();
+    lock.unlock();
+    decode_cv_.notify_all();
+    *out = nullptr;
+    return decoded.status;
+  }
+  lock.unlock();
+  decode_cv_.notify_all();
+  *out = decoded.batch;
+  return Status::OK();
+}
+
+arrow::Status Ingest::ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) {
+  auto status = Next(batch);
+  if (!status.ok()) {
+    return arrow::Status::IOError(status.message);
+  }
+  return arrow::Status::OK();
+}
+
+#ifdef FLETCHER_PARQUET
+
+Status Ingest::MakeParquet(std::shared_ptr<Ingest> *out,
+                           const std::string &file_name,
+                           const std::shared_ptr<arrow::Schema> &schema,
+                           size_t num_threads,
+                           size_t capacity,
+                           arrow::MemoryPool *pool) {
+  auto opened = arrow::io::ReadableFile::Open(file_name);
+  if (!opened.ok()) {
+    return Status::ERROR("Could not open " + file_name + ": " + opened.status().ToString());
+  }
+  // Reads at an offset are thread-safe, so all readers share the file, as well as its metadata.
+  std::shared_ptr<arrow::io::RandomAccessFile> file = opened.ValueOrDie();
+  std::shared_ptr<parquet::FileMetaData> metadata;
+  std::shared_ptr<arrow::Schema> file_schema;
+  try {
+    metadata = parquet::ReadMetaData(file);
+    parquet::ReaderProperties properties(pool);
+    std::unique_ptr<parquet::arrow::FileReader> reader;
+    auto status = parquet::arrow::FileReader::Make(pool,
+                                                   parquet::ParquetFileReader::Open(file, properties, metadata),
+                                                   &reader);
+    if (status.ok()) {
+      status = reader->GetSchema(&file_schema);
+    }
+    if (!status.ok()) {
+      return Status::ERROR("Could not read the Schema of " + file_name + ": " + status.ToString());
+    }
+  } catch (const parquet::ParquetException &e) {
+    return Status::ERROR("Could not read the metadata of " + file_name + ": " + e.what());
+  }
+
+  auto batch_schema = schema != nullptr ? schema : file_schema;
+  if (batch_schema->num_fields() != file_schema->num_fields()) {
+    return Status::ERROR("Schema has " + std::to_string(batch_schema->num_fields()) + " fields, but " + file_name
+                             + " has " + std::to_string(file_schema->num_fields()) + " columns.");
+  }
+  for (int f = 0; f < batch_schema->num_fields(); f++) {
+    if (!batch_schema->field(f)->type()->Equals(*file_schema->field(f)->type())) {
+      return Status::ERROR("Field " + batch_schema->field(f)->name() + " of the Schema does not match column "
+                               + file_schema->field(f)->name() + " of " + file_name + ".");
+    }
+  }
+
+  auto decode = [file, metadata, batch_schema](size_t unit,
+                                               arrow::MemoryPool *pool,
+                                               std::shared_ptr<arrow::RecordBatch> *batch) -> Status {
+    std::shared_ptr<arrow::Table> table;
+    try {
+      // Decoding buffers are allocated from the pool as well, such that values are decoded into them in place.
+      parquet::ReaderProperties properties(pool);
+      std::unique_ptr<parquet::arrow::FileReader> reader;
+      auto status = parquet::arrow::FileReader::Make(pool,
+                                                     parquet::ParquetFileReader::Open(file, properties, metadata),
+                                                     &reader);
+      if (status.ok()) {
+        status = reader->ReadRowGroup(static_cast<int>(unit), &table);
+      }
+      if (!status.ok()) {
+        return Status::ERROR("Could not decode row group " + std::to_string(unit) + ": " + status.ToString());
+      }
+    } catch (const parquet::ParquetException &e) {
+      return Status::ERROR("Could not decode row group " + std::to_string(unit) + ": " + e.what());
+    }
+    // Columns of a row group may be decoded as multiple chunks, while the device expects a single buffer per column.
+    auto combined = table->CombineChunks(pool);
+    if (!combined.ok()) {
+      return Status::ERROR("Could not combine row group " + std::to_string(unit) + ": "
+                               + combined.status().ToString());
+    }
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    for (const auto &column : combined.ValueOrDie()->columns()) {
+      columns.push_back(column->num_chunks() > 0 ? column->chunk(0) : nullptr);
+      if (columns.back() == nullptr) {
+        auto empty = arrow::MakeArrayOfNull(column->type(), 0, pool);
+        if (!empty.ok()) {
+          return Status::ERROR("Could not create an empty column: " + empty.status().ToString());
+        }
+        columns.back() = empty.ValueOrDie();
+      }
+    }
+    *batch = arrow::RecordBatch::Make(batch_schema, table->num_rows(), columns);
+    return Status::OK();
+  };
+
+  return Make(out, batch_schema, static_cast<size_t>(metadata->num_row_groups()), decode, num_threads, capacity, pool);
+}
+
+#else
+
+Status Ingest::MakeParquet(std::shared_ptr<Ingest> *,
+                           const std::string &file_name,
+                           const std::shared_ptr<arrow::Schema> &,
+                           size_t,
+                           size_t,
+                           arrow::MemoryPool *) {
+  return Status::ERROR("Could not ingest " + file_name + ": the Fletcher run-time library was built without "
+                       "Parquet support (FLETCHER_PARQUET).");
+}
+
+#endif
+
+}  // namespace fletcher
@@ -15,56 +15,132 @@
 #include "fletcher/kernel.h"
 
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <utility>
 
+#include "fletcher/completion.h"
 #include "fletcher/context.h"
+#include "fletcher/image.h"
+#include "fletcher/numa.h"
 
 namespace fletcher {
 
-Kernel::Kernel(std::shared_ptr<Context> context) : context_(std::move(context)) {}
+Kernel::Kernel(std::shared_ptr<Context> context, uint64_t mmio_base)
+    : context_(std::move(context)), mmio_base_(mmio_base) {}
+
+Kernel::~Kernel() {
+  {
+    std::lock_guard<std::mutex> lock(monitor_mutex_);
+    monitor_stop_ = true;
+  }
+  monitor_cv_.notify_all();
+  if (monitor_.joinable()) {
+    monitor_.join();
+  }
+  // Fail any completions that were never picked up by the monitor thread.
+  for (auto &c : pending_) {
+    c.promise.set_value(Status::ERROR("Kernel destructed before completion."));
+  }
+}
+
+Status Kernel::Make(std::shared_ptr<Kernel> *out, const std::shared_ptr<Context> &context, ImageCache *cache) {
+  if ((context == nullptr) || (cache == nullptr)) {
+    return Status::ERROR("Context or ImageCache is nullptr.");
+  }
+  std::vector<std::shared_ptr<arrow::Schema>> schema_set;
+  for (size_t i = 0; i < context->num_recordbatches(); i++) {
+    schema_set.push_back(context->recordbatch(i)->schema());
+  }
+  uint64_t mmio_base = 0;
+  auto status = cache->Acquire(schema_set, &mmio_base);
+  if (!status.ok()) {
+    return status;
+  }
+  *out = std::make_shared<Kernel>(context, mmio_base);
+  return Status::OK();
+}
 
 bool Kernel::ImplementsSchemaSet(const std::vector<std::shared_ptr<arrow::Schema>> &schema_set) {
-  // TODO(johanpel): Implement checking if the kernel implements the same Schema, probably through some checksum
-  //  register. We need a hash function for Arrow Schema's for this, that doesn't take into account field names or
-  //  metadata, except the fletcher access mode.
-  FLETCHER_LOG(WARNING, "ImplementsSchemaSet is not implemented.");
-  return false;
+  uint32_t hash = 0;
+  if (!ReadMMIO(FLETCHER_REG_SCHEMA_HASH, &hash).ok()) {
+    return false;
+  }
+  return hash == SchemaSetHash(schema_set);
 }
 
 Status Kernel::Reset() {
-  auto status = context_->platform()->WriteMMIO(FLETCHER_REG_CONTROL, ctrl_reset);
+  auto status = WriteMMIO(FLETCHER_REG_CONTROL, ctrl_reset);
   if (status.ok()) {
-    return context_->platform()->WriteMMIO(FLETCHER_REG_CONTROL, 0);
+    return WriteMMIO(FLETCHER_REG_CONTROL, 0);
   } else {
     return status;
   }
 }
 
-Status Kernel::SetRange(size_t recordbatch_index, int32_t first, int32_t last) {
+Status Kernel::SetRange(size_t recordbatch_index, int64_t first, int64_t last) {
   if (first >= last) {
     FLETCHER_LOG(ERROR, "Row range invalid: [ " + std::to_string(first) + ", " + std::to_string(last) + " )");
     return Status::ERROR();
   }
+  auto iregs = IndexRegisters();
+  if ((iregs == 1) && (last > std::numeric_limits<uint32_t>::max())) {
+    return Status::ERROR("Row range [ " + std::to_string(first) + ", " + std::to_string(last)
+                         + " ) does not fit the 32-bit index registers of the kernel.");
+  }
 
-  Status ret;
-  if (!context_->platform()->WriteMMIO(FLETCHER_REG_SCHEMA + 2 * recordbatch_index,
-                                       static_cast<uint32_t>(first)).ok()) {
-    ret = Status::ERROR();
+  // Every index occupies one register per 32 bits, least significant word first.
+  std::vector<uint32_t> regs;
+  for (auto index : {first, last}) {
+    for (size_t w = 0; w < iregs; w++) {
+      regs.push_back(static_cast<uint32_t>(static_cast<uint64_t>(index) >> (32 * w)));
+    }
+  }
+  auto offset = 2 * iregs * recordbatch_index;
+  auto status = WriteMMIOBatch(FLETCHER_REG_SCHEMA + offset, regs.data(), regs.size());
+  if (!status.ok()) {
+    return status;
   }
-  if (!context_->platform()->WriteMMIO(FLETCHER_REG_SCHEMA + 2 * recordbatch_index + 1,
-                                       static_cast<uint32_t>(last)).ok()) {
-    ret = Status::ERROR();
+  // Keep the written metadata up to date, such that UpdateMetaData() compares against what the kernel holds.
+  if (offset + regs.size() <= metadata_.size()) {
+    std::copy(regs.begin(), regs.end(), metadata_.begin() + offset);
   }
   return Status::OK();
 }
 
-Status Kernel::SetArguments(const std::vector<uint32_t> &arguments) {
-  for (int i = 0; (size_t) i < arguments.size(); i++) {
-    context_->platform()->WriteMMIO(
-        FLETCHER_REG_SCHEMA + 2 * context_->num_recordbatches() + 2 * context_->num_buffers() + i, arguments[i]);
+Status Kernel::SetProjection(const std::vector<std::string> &fields) {
+  if (!projection) {
+    return Status::ERROR("Kernel has no field enable registers. Generate it with fletchgen --projection.");
+  }
+  // Every field that is not ignored by the hardware has an enable register, in order of the RecordBatches.
+  std::vector<uint32_t> regs;
+  std::vector<bool> found(fields.size(), false);
+  for (size_t i = 0; i < context_->num_recordbatches(); i++) {
+    auto schema = context_->recordbatch(i)->schema();
+    for (const auto &f : schema->fields()) {
+      if (GetBoolMeta(*f, meta::IGNORE, false)) {
+        continue;
+      }
+      auto it = std::find(fields.begin(), fields.end(), f->name());
+      if (it != fields.end()) {
+        found[it - fields.begin()] = true;
+      }
+      regs.push_back((fields.empty() || (it != fields.end())) ? 1 : 0);
+    }
   }
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!found[i]) {
+      return Status::ERROR("Projected field " + fields[i] + " does not exist in any RecordBatch.");
+    }
+  }
+  return WriteMMIOBatch(FLETCHER_REG_SCHEMA + MetaDataRegisters(), regs.data(), regs.size());
+}
 
-  return Status::OK();
+Status Kernel::SetArguments(const std::vector<uint32_t> &arguments) {
+  return WriteMMIOBatch(FLETCHER_REG_SCHEMA + MetaDataRegisters() + ProjectionRegisters(),
+                        arguments.data(),
+                        arguments.size());
 }
 
 Status Kernel::Start() {
@@ -73,92 +149,462 @@ Status Kernel::Start() {
     WriteMetaData();
   }
   FLETCHER_LOG(DEBUG, "Starting kernel.");
-  status = context_->platform()->WriteMMIO(FLETCHER_REG_CONTROL, ctrl_start);
+  if (completion_record_) {
+    completion_record_->Arm();
+  }
+  Timer timer;
+  timer.start();
+  status = WriteMMIO(FLETCHER_REG_CONTROL, ctrl_start);
   if (!status.ok())
     return status;
-  return context_->platform()->WriteMMIO(FLETCHER_REG_CONTROL, 0);
+  status = WriteMMIO(FLETCHER_REG_CONTROL, 0);
+  timer.stop();
+  context_->instrumentation().Record(Phase::START, timer);
+  launch_timer_.start_ = timer.stop_;
+  return status;
+}
+
+void Kernel::RecordCompletion(Timer *timer) {
+  // Completions that are awaited more than once, or without starting the kernel, are not recorded.
+  if (timer->start_ == Timer::time_point{}) return;
+  timer->stop();
+  context_->instrumentation().Record(Phase::COMPLETION, *timer);
+  *timer = Timer();
+}
+
+std::chrono::steady_clock::time_point Kernel::Deadline(unsigned int timeout_usec) {
+  if (timeout_usec == 0) return std::chrono::steady_clock::time_point{};
+  return std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_usec);
+}
+
+bool Kernel::Expired(const std::chrono::steady_clock::time_point &deadline) {
+  return (deadline != std::chrono::steady_clock::time_point{}) && (std::chrono::steady_clock::now() >= deadline);
+}
+
+Status Kernel::StartAsync(std::shared_future<Status> *completion,
+                          unsigned int poll_interval_usec,
+                          unsigned int timeout_usec) {
+  Status status = Start();
+  if (!status.ok()) {
+    return status;
+  }
+  Completion c;
+  c.poll_interval_usec = poll_interval_usec;
+  c.deadline = Deadline(timeout_usec);
+  c.timer = launch_timer_;
+  launch_timer_ = Timer();
+  *completion = c.promise.get_future().share();
+  {
+    std::lock_guard<std::mutex> lock(monitor_mutex_);
+    pending_.push_back(std::move(c));
+    // Start the monitor thread lazily, so synchronous users of the Kernel don't pay for it.
+    if (!monitor_.joinable()) {
+      monitor_ = std::thread(&Kernel::MonitorCompletions, this);
+    }
+  }
+  monitor_cv_.notify_one();
+  return Status::OK();
+}
+
+void Kernel::MonitorCompletions() {
+  PinThreadToNode(context_->platform()->numa_node());
+  std::unique_lock<std::mutex> lock(monitor_mutex_);
+  while (true) {
+    monitor_cv_.wait(lock, [this] { return monitor_stop_ || !pending_.empty(); });
+    if (monitor_stop_) {
+      break;
+    }
+    auto interval = pending_.front().poll_interval_usec;
+    auto deadline = pending_.front().deadline;
+    lock.unlock();
+
+    // Poll without holding the lock, so new completions can be queued in the meantime.
+    Status status;
+    bool done = false;
+    while (!done) {
+      status = IsDone(&done);
+      if (!status.ok() || done) break;
+      if (monitor_stop_) {
+        status = Status::ERROR("Kernel destructed before completion.");
+        break;
+      }
+      if (Expired(deadline)) {
+        FLETCHER_LOG(WARNING, "Kernel did not complete before its deadline. Cancelling kernel.");
+        status = Stop();
+        if (status.ok()) status = Status::TIMEOUT();
+        break;
+      }
+      if (interval > 0) Idle(interval);
+    }
+
+    lock.lock();
+    if (status.ok()) RecordCompletion(&pending_.front().timer);
+    pending_.front().promise.set_value(status);
+    pending_.pop_front();
+  }
 }
 
 Status Kernel::GetStatus(uint32_t *status_out) {
-  return context_->platform()->ReadMMIO(FLETCHER_REG_STATUS, status_out);
+  return ReadMMIO(FLETCHER_REG_STATUS, status_out);
 }
 
 Status Kernel::GetReturn(uint32_t *ret0, uint32_t *ret1) {
+  if (completion_record_ && completion_record_->Done()) {
+    auto record = completion_record_->Read();
+    *ret0 = static_cast<uint32_t>(record.result);
+    if (ret1 != nullptr) {
+      *ret1 = static_cast<uint32_t>(record.result >> 32);
+    }
+    return Status::OK();
+  }
   Status status;
-  status = context_->platform()->ReadMMIO(FLETCHER_REG_RETURN0, ret0);
+  status = ReadMMIO(FLETCHER_REG_RETURN0, ret0);
   if ((ret1 == nullptr) || (!status.ok())) {
     return status;
   }
-  status = context_->platform()->ReadMMIO(FLETCHER_REG_RETURN1, ret1);
+  status = ReadMMIO(FLETCHER_REG_RETURN1, ret1);
   return status;
 }
 
+Status Kernel::GetExecutionCycles(uint64_t *cycles) {
+  if (completion_record_ && completion_record_->Done()) {
+    *cycles = completion_record_->Read().cycles;
+    return Status::OK();
+  }
+  return context_->platform()->ReadMMIO64(mmio_base_ + FLETCHER_REG_CYCLES, cycles);
+}
+
+Status Kernel::GetClockFrequency(uint32_t *hz) {
+  return ReadMMIO(FLETCHER_REG_CLOCK_HZ, hz);
+}
+
+Status Kernel::GetExecutionTime(double *seconds) {
+  uint32_t hz = 0;
+  auto status = GetClockFrequency(&hz);
+  if (!status.ok()) {
+    return status;
+  }
+  if (hz == 0) {
+    return Status::ERROR("Kernel clock frequency is unknown. Generate the kernel with --kernel_clock_hz.");
+  }
+  uint64_t cycles = 0;
+  status = GetExecutionCycles(&cycles);
+  if (!status.ok()) {
+    return status;
+  }
+  *seconds = static_cast<double>(cycles) / hz;
+  return Status::OK();
+}
+
 Status Kernel::PollUntilDone() {
   return PollUntilDoneInterval(0);
 }
 
-Status Kernel::PollUntilDoneInterval(unsigned int poll_interval_usec) {
+Status Kernel::PollUntilDoneInterval(unsigned int poll_interval_usec, unsigned int timeout_usec) {
   bool done = false;
   uint32_t status = 0;
+  auto deadline = Deadline(timeout_usec);
   FLETCHER_LOG(DEBUG, "Polling kernel for completion.");
-  if (poll_interval_usec == 0) {
-    while (!done) {
-      context_->platform()->ReadMMIO(FLETCHER_REG_STATUS, &status);
+  while (true) {
+    if (completion_record_) {
+      done = completion_record_->Done();
+    } else {
+      ReadMMIO(FLETCHER_REG_STATUS, &status);
       done = (status & done_status_mask) == this->done_status;
     }
-  } else {
-    while (!done) {
-      context_->platform()->ReadMMIO(FLETCHER_REG_STATUS, &status);
-      done = (status & done_status_mask) == this->done_status;
-      if (done) break;
-      usleep(poll_interval_usec);
+    if (done) break;
+    if (Expired(deadline)) return Status::TIMEOUT();
+    if (poll_interval_usec > 0) usleep(poll_interval_usec);
+  }
+  RecordCompletion(&launch_timer_);
+  FLETCHER_LOG(DEBUG, "Kernel status done bit asserted.");
+  return Status::OK();
+}
+
+Status Kernel::IsDone(bool *done) {
+  if (completion_record_) {
+    *done = completion_record_->Done();
+    return Status::OK();
+  }
+  uint32_t status = 0;
+  auto result = ReadMMIO(FLETCHER_REG_STATUS, &status);
+  *done = (status & done_status_mask) == this->done_status;
+  return result;
+}
+
+void Kernel::Idle(unsigned int interval_usec) {
+  auto platform = context_->platform();
+  if (!platform->HasWaitForInterrupt() || !platform->WaitForInterrupt(interval_usec).ok()) {
+    usleep(interval_usec);
+  }
+}
+
+Status Kernel::WaitUntilDone(unsigned int spin_usec, unsigned int poll_interval_usec, unsigned int timeout_usec) {
+  bool done = false;
+  Status status;
+  auto deadline = Deadline(timeout_usec);
+  FLETCHER_LOG(DEBUG, "Waiting for kernel completion.");
+  if (completion_record_) {
+    // The record is checked in host memory, so there is no need for interrupts.
+    status = completion_record_->Wait(spin_usec, poll_interval_usec, timeout_usec);
+    if (status.ok()) {
+      RecordCompletion(&launch_timer_);
+    }
+    return status;
+  }
+  auto platform = context_->platform();
+  if (!platform->HasWaitForInterrupt()) {
+    // Spin for a short window, which gives the lowest latency for short kernels.
+    auto spin_end = std::chrono::steady_clock::now() + std::chrono::microseconds(spin_usec);
+    while (std::chrono::steady_clock::now() < spin_end) {
+      status = IsDone(&done);
+      if (!status.ok()) return status;
+      if (done) {
+        RecordCompletion(&launch_timer_);
+        return Status::OK();
+      }
     }
   }
+  // Then poll at an interval, or wait for interrupts.
+  while (true) {
+    status = IsDone(&done);
+    if (!status.ok()) return status;
+    if (done) break;
+    if (Expired(deadline)) return Status::TIMEOUT();
+    Idle(poll_interval_usec);
+  }
+  RecordCompletion(&launch_timer_);
   FLETCHER_LOG(DEBUG, "Kernel status done bit asserted.");
   return Status::OK();
 }
 
+Status Kernel::Cancel(unsigned int timeout_usec) {
+  // The kernel did not complete, so its launch is not recorded.
+  launch_timer_ = Timer();
+  return Stop(timeout_usec);
+}
+
+Status Kernel::Stop(unsigned int timeout_usec) {
+  FLETCHER_LOG(DEBUG, "Stopping kernel.");
+  auto status = WriteMMIO(FLETCHER_REG_CONTROL, ctrl_stop);
+  if (!status.ok()) {
+    return status;
+  }
+  status = WriteMMIO(FLETCHER_REG_CONTROL, 0);
+  if (!status.ok()) {
+    return status;
+  }
+  // Give the kernel the chance to unwind, after the outstanding bus transactions of its ArrayReaders and ArrayWriters
+  // have drained.
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_usec);
+  bool done = false;
+  while (true) {
+    status = IsDone(&done);
+    if (!status.ok() || done) {
+      return status;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) break;
+  }
+  FLETCHER_LOG(WARNING, "Kernel did not assert done after it was stopped. Resetting kernel.");
+  status = Reset();
+  return status.ok() ? Status::TIMEOUT() : status;
+}
+
+void Kernel::SetCompletionRecord(std::shared_ptr<CompletionRecord> record) {
+  completion_record_ = std::move(record);
+}
+
 std::shared_ptr<Context> Kernel::context() {
   return context_;
 }
 
-Status Kernel::WriteMetaData() {
-  Status status;
-  FLETCHER_LOG(DEBUG, "Writing context metadata to kernel.");
-
-  // Set the starting offset to the first schema-derived register index.
-  uint64_t offset = FLETCHER_REG_SCHEMA;
+Status Kernel::WriteMMIO(uint64_t offset, uint32_t value) {
+  return context_->platform()->WriteMMIO(mmio_base_ + offset, value);
+}
 
-  // Get the platform pointer.
+Status Kernel::WriteMMIOBatch(uint64_t offset, const uint32_t *values, size_t count) {
   auto platform = context_->platform();
+  if (!mmio64 || !platform->HasMMIO64()) {
+    return platform->WriteMMIOBatch(mmio_base_ + offset, values, count);
+  }
+  // Write a register that starts halfway a bus word on its own, and then every aligned pair with a single access.
+  offset += mmio_base_;
+  size_t i = 0;
+  if ((offset % 2 != 0) && (count > 0)) {
+    auto status = platform->WriteMMIO(offset, values[0]);
+    if (!status.ok()) {
+      return status;
+    }
+    i++;
+  }
+  for (; i + 1 < count; i += 2) {
+    auto status = platform->WriteMMIO64(offset + i, values[i] | static_cast<uint64_t>(values[i + 1]) << 32);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (i < count) {
+    return platform->WriteMMIO(offset + i, values[i]);
+  }
+  return Status::OK();
+}
+
+Status Kernel::ReadMMIO(uint64_t offset, uint32_t *value) {
+  return context_->platform()->ReadMMIO(mmio_base_ + offset, value);
+}
+
+size_t Kernel::IndexRegisters() const {
+  if (index_width != 0) {
+    return index_width / 32;
+  }
+  for (size_t i = 0; i < context_->num_recordbatches(); i++) {
+    if (HasLargeOffsets(*context_->recordbatch(i)->schema())) {
+      return 2;
+    }
+  }
+  return 1;
+}
+
+size_t Kernel::ProjectionRegisters() const {
+  if (!projection) {
+    return 0;
+  }
+  size_t result = 0;
+  for (size_t i = 0; i < context_->num_recordbatches(); i++) {
+    for (const auto &f : context_->recordbatch(i)->schema()->fields()) {
+      if (!GetBoolMeta(*f, meta::IGNORE, false)) {
+        result++;
+      }
+    }
+  }
+  return result;
+}
 
-  // Write RecordBatch ranges.
+/// @brief Return whether a buffer is the validity bitmap of a field.
+static bool IsValidity(const BufferMetadata &buffer) {
+  return !buffer.desc_.empty() && (buffer.desc_.back() == "validity");
+}
+
+size_t Kernel::AllValidRegisters() const {
+  if (!all_valid) {
+    return 0;
+  }
+  size_t result = 0;
+  for (size_t i = 0; i < context_->num_recordbatches(); i++) {
+    const auto &desc = context_->recordbatch_description(i);
+    if (desc.mode != Mode::READ) {
+      continue;
+    }
+    for (const auto &f : desc.fields) {
+      result += std::count_if(f.buffers.begin(), f.buffers.end(), IsValidity);
+    }
+  }
+  return result;
+}
+
+size_t Kernel::MetaDataRegisters() const {
+  // Metadata written on behalf of the Context may differ in size from that of the Context itself.
+  if (metadata_written) {
+    return metadata_.size();
+  }
+  return 2 * IndexRegisters() * context_->num_recordbatches() + 2 * context_->num_buffers() + AllValidRegisters();
+}
+
+void Kernel::GatherMetaData(std::vector<uint32_t> *regs) {
+  auto iregs = IndexRegisters();
+  regs->clear();
+  regs->reserve(2 * iregs * context_->num_recordbatches() + 2 * context_->num_buffers() + AllValidRegisters());
+
+  // RecordBatch ranges.
   for (size_t i = 0; i < context_->num_recordbatches(); i++) {
     auto rb = context_->recordbatch(i);
-    status = platform->WriteMMIO(offset, 0);               // First index
-    if (!status.ok()) return status;
-    offset++;
-    status = platform->WriteMMIO(offset, rb->num_rows());  // Last index (exclusive)
-    if (!status.ok()) return status;
-    offset++;
+    auto rows = static_cast<uint64_t>(rb->num_rows());
+    regs->insert(regs->end(), iregs, 0);                      // First index
+    for (size_t w = 0; w < iregs; w++) {
+      regs->push_back(static_cast<uint32_t>(rows >> (32 * w)));  // Last index (exclusive)
+    }
   }
 
-  // Write buffer addresses
+  // Buffer addresses
   for (size_t i = 0; i < context_->num_buffers(); i++) {
     // Get the device address
     auto device_buf = context_->device_buffer(i);
     dau_t address;
-    address.full = device_buf.device_address;
-    // Write the address
-    platform->WriteMMIO(offset, address.lo);
-    if (!status.ok()) return status;
-    offset++;
-    platform->WriteMMIO(offset, address.hi);
-    if (!status.ok()) return status;
-    offset++;
+    address.full = device_buf.kernel_address();
+    regs->push_back(address.lo);
+    regs->push_back(address.hi);
   }
+
+  // All valid flags. Validity bitmaps of fields without nulls are implicit, and have no device address.
+  if (all_valid) {
+    for (size_t i = 0; i < context_->num_recordbatches(); i++) {
+      const auto &desc = context_->recordbatch_description(i);
+      if (desc.mode != Mode::READ) {
+        continue;
+      }
+      for (const auto &f : desc.fields) {
+        for (const auto &b : f.buffers) {
+          if (IsValidity(b)) {
+            regs->push_back(b.implicit_ ? 1 : 0);
+          }
+        }
+      }
+    }
+  }
+}
+
+Status Kernel::WriteMetaData() {
+  FLETCHER_LOG(DEBUG, "Writing context metadata to kernel.");
+
+  // Gather all schema-derived registers, such that they can be written in one batch.
+  std::vector<uint32_t> regs;
+  GatherMetaData(&regs);
+  return WriteMetaData(regs);
+}
+
+Status Kernel::WriteMetaData(const std::vector<uint32_t> &regs) {
+  // Write the registers, starting at the first schema-derived register index.
+  Timer timer;
+  timer.start();
+  auto status = WriteMMIOBatch(FLETCHER_REG_SCHEMA, regs.data(), regs.size());
+  if (!status.ok()) return status;
+  timer.stop();
+  context_->instrumentation().Record(Phase::METADATA, timer);
+
+  metadata_ = regs;
   metadata_written = true;
   return Status::OK();
 }
 
+Status Kernel::UpdateMetaData() {
+  std::vector<uint32_t> regs;
+  GatherMetaData(&regs);
+  if (!metadata_written || (regs.size() != metadata_.size())) {
+    return WriteMetaData();
+  }
+
+  FLETCHER_LOG(DEBUG, "Updating context metadata of kernel.");
+  Timer timer;
+  timer.start();
+  // Write every run of consecutive changed registers in one batch.
+  size_t i = 0;
+  while (i < regs.size()) {
+    if (regs[i] == metadata_[i]) {
+      i++;
+      continue;
+    }
+    size_t run = i;
+    while ((i < regs.size()) && (regs[i] != metadata_[i])) {
+      i++;
+    }
+    auto status = WriteMMIOBatch(FLETCHER_REG_SCHEMA + run, &regs[run], i - run);
+    if (!status.ok()) return status;
+  }
+  timer.stop();
+  context_->instrumentation().Record(Phase::METADATA, timer);
+
+  metadata_ = std::move(regs);
+  return Status::OK();
+}
+
 }
@@ -0,0 +1,99 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "fletcher/mapped.h"
+
+#include <fletcher/common.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace fletcher {
+
+// Arrow uses this address for zero-size allocations.
+alignas(64) static uint8_t zero_size_area[1];
+
+/// The alignment Arrow requires of allocations.
+constexpr uintptr_t kAlignment = 64;
+
+Status MappedMemoryPool::Make(std::shared_ptr<MappedMemoryPool> *out, const std::shared_ptr<Platform> &platform) {
+  if (!platform->HasDeviceMap()) {
+    return Status::ERROR("Platform " + platform->name() + " does not support mapping device memory.");
+  }
+  *out = std::make_shared<MappedMemoryPool>(platform);
+  return Status::OK();
+}
+
+arrow::Status MappedMemoryPool::Allocate(int64_t size, uint8_t **out) {
+  if (size < 0) {
+    return arrow::Status::Invalid("Negative allocation size requested.");
+  }
+  if (size == 0) {
+    *out = zero_size_area;
+    return arrow::Status::OK();
+  }
+  da_t device_address = D_NULLPTR;
+  auto status = platform_->DeviceMalloc(&device_address, static_cast<size_t>(size));
+  if (!status.ok()) {
+    return arrow::Status::OutOfMemory("Could not allocate device memory: " + status.message);
+  }
+  status = platform_->DeviceMap(device_address, size, out);
+  if (status.ok() && (reinterpret_cast<uintptr_t>(*out) % kAlignment != 0)) {
+    platform_->DeviceUnmap(*out);
+    status = Status::ERROR("Mapped device memory is not aligned to " + std::to_string(kAlignment) + " bytes.");
+  }
+  if (!status.ok()) {
+    platform_->DeviceFree(device_address);
+    return arrow::Status::OutOfMemory("Could not map device memory: " + status.message);
+  }
+  auto allocated = bytes_allocated_ += size;
+  // Update the high-water mark.
+  auto max = max_memory_.load();
+  while ((allocated > max) && !max_memory_.compare_exchange_weak(max, allocated)) {}
+  return arrow::Status::OK();
+}
+
+arrow::Status MappedMemoryPool::Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) {
+  uint8_t *new_ptr = nullptr;
+  auto status = Allocate(new_size, &new_ptr);
+  if (!status.ok()) {
+    return status;
+  }
+  std::memcpy(new_ptr, *ptr, static_cast<size_t>(std::min(old_size, new_size)));
+  Free(*ptr, old_size);
+  *ptr = new_ptr;
+  return arrow::Status::OK();
+}
+
+void MappedMemoryPool::Free(uint8_t *buffer, int64_t size) {
+  if (buffer == zero_size_area) {
+    return;
+  }
+  da_t device_address = D_NULLPTR;
+  if (!platform_->IsDeviceMapped(buffer, size, &device_address)) {
+    FLETCHER_LOG(ERROR, "Could not free device memory that was not allocated by this pool.");
+    return;
+  }
+  auto status = platform_->DeviceUnmap(buffer);
+  if (status.ok()) {
+    status = platform_->DeviceFree(device_address);
+  }
+  if (!status.ok()) {
+    FLETCHER_LOG(ERROR, "Could not free mapped device memory. Status: " + status.message);
+  }
+  bytes_allocated_ -= size;
+}
+
+}  // namespace fletcher
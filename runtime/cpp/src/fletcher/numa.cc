@@ -0,0 +1,164 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/numa.h"
+
+#include <fletcher/common.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fletcher {
+
+// Flags and modes of the memory policy system calls, see get_mempolicy(2) and mbind(2). The system calls are used
+// directly, such that the run-time library does not depend on libnuma.
+#define FLETCHER_MPOL_BIND 2
+#define FLETCHER_MPOL_F_NODE 1
+#define FLETCHER_MPOL_F_ADDR 2
+
+int NumaNodeOf(const void *address) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, nullptr, 0, address, FLETCHER_MPOL_F_NODE | FLETCHER_MPOL_F_ADDR) != 0) {
+    return -1;
+  }
+  return node;
+#else
+  return -1;
+#endif
+}
+
+Status PinThreadToNode(int node) {
+  if (node < 0) {
+    return Status::OK();
+  }
+#if defined(__linux__)
+  // The CPUs of a node are listed as comma-separated ranges, e.g. 0-7,16-23.
+  auto path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+  std::ifstream file(path);
+  std::string list;
+  if (!file.good() || !std::getline(file, list)) {
+    return Status::ERROR("Could not read the CPUs of NUMA node " + std::to_string(node) + " from " + path);
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    auto dash = range.find('-');
+    auto first = std::stoi(range.substr(0, dash));
+    auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; (cpu <= last) && (cpu < CPU_SETSIZE); cpu++) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  if (CPU_COUNT(&set) == 0) {
+    return Status::ERROR("NUMA node " + std::to_string(node) + " has no CPUs.");
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    return Status::ERROR("Could not pin thread to NUMA node " + std::to_string(node) + ": " + std::strerror(errno));
+  }
+  return Status::OK();
+#else
+  return Status::ERROR("Pinning threads to NUMA nodes is not supported on this system.");
+#endif
+}
+
+bool IsNumaRemote(Platform *platform, const uint8_t *host_address) {
+  auto device_node = platform->numa_node();
+  if (device_node < 0) {
+    return false;
+  }
+  auto host_node = NumaNodeOf(host_address);
+  return (host_node >= 0) && (host_node != device_node);
+}
+
+namespace {
+
+/// A bounce buffer of a thread, bound to a NUMA node.
+struct BounceBuffer {
+  /// The memory of the buffer.
+  uint8_t *data = nullptr;
+  /// The node the buffer is bound to.
+  int node = -1;
+
+  ~BounceBuffer() {
+    if (data != nullptr) {
+      munmap(data, kNumaBounceBytes);
+    }
+  }
+
+  /// @brief Map the buffer, bound to a node.
+  Status Bind(int to_node) {
+    if ((data != nullptr) && (node == to_node)) {
+      return Status::OK();
+    }
+    if (data != nullptr) {
+      munmap(data, kNumaBounceBytes);
+      data = nullptr;
+    }
+    void *mem = mmap(nullptr, kNumaBounceBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      return Status::ERROR("Could not map a NUMA bounce buffer: " + std::string(std::strerror(errno)));
+    }
+#if defined(__linux__) && defined(SYS_mbind)
+    // Binding fails for nodes the kernel does not know. The buffer is then placed by the default policy.
+    unsigned long mask[16] = {0};  // NOLINT
+    auto bits = 8 * sizeof(mask[0]);
+    if (static_cast<size_t>(to_node) < bits * 16) {
+      mask[to_node / bits] |= 1ul << (to_node % bits);
+      if (syscall(SYS_mbind, mem, kNumaBounceBytes, FLETCHER_MPOL_BIND, mask, bits * 16, 0) != 0) {
+        FLETCHER_LOG(DEBUG, "Could not bind NUMA bounce buffer to node " << to_node << ".");
+      }
+    }
+#endif
+    data = static_cast<uint8_t *>(mem);
+    node = to_node;
+    return Status::OK();
+  }
+};
+
+}  // namespace
+
+Status NumaCopyHostToDevice(Platform *platform, const uint8_t *host_source, da_t device_destination, int64_t size) {
+  if ((size <= 0) || !IsNumaRemote(platform, host_source)) {
+    return platform->CopyHostToDevice(const_cast<uint8_t *>(host_source), device_destination, size);
+  }
+  thread_local BounceBuffer bounce;
+  auto status = bounce.Bind(platform->numa_node());
+  if (!status.ok()) {
+    return status;
+  }
+  for (int64_t offset = 0; offset < size; offset += kNumaBounceBytes) {
+    auto chunk = std::min(size - offset, static_cast<int64_t>(kNumaBounceBytes));
+    std::memcpy(bounce.data, host_source + offset, static_cast<size_t>(chunk));
+    status = platform->CopyHostToDevice(bounce.data, device_destination + static_cast<da_t>(offset), chunk);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace fletcher
@@ -0,0 +1,229 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/offload.h"
+
+#include <fletcher/arrow-recordbatch.h>
+#include <fletcher/timer.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fletcher {
+
+double Offloader::Model::DeviceCost(int64_t bytes) const {
+  return launch_ns + static_cast<double>(bytes) * (transfer_ns_per_byte + device_ns_per_byte);
+}
+
+double Offloader::Model::HostCost(int64_t bytes) const {
+  return static_cast<double>(bytes) * host_ns_per_byte;
+}
+
+int64_t Offloader::Model::BreakEven() const {
+  auto saving_per_byte = host_ns_per_byte - transfer_ns_per_byte - device_ns_per_byte;
+  if (saving_per_byte <= 0.0) {
+    return -1;
+  }
+  return static_cast<int64_t>(std::ceil(launch_ns / saving_per_byte));
+}
+
+std::string Offloader::Stats::ToString() const {
+  std::stringstream ss;
+  ss << "Offloader: " << device_runs << " device run(s) of " << device_bytes << " bytes, "
+     << host_runs << " host run(s) of " << host_bytes << " bytes" << std::endl;
+  ss << "  Launch   : " << model.launch_ns << " ns" << std::endl;
+  ss << "  Transfer : " << model.transfer_ns_per_byte << " ns/byte" << std::endl;
+  ss << "  Device   : " << model.device_ns_per_byte << " ns/byte" << std::endl;
+  ss << "  Host     : " << model.host_ns_per_byte << " ns/byte" << std::endl;
+  ss << "  Offload from " << model.BreakEven() << " bytes" << std::endl;
+  return ss.str();
+}
+
+Offloader::Offloader(std::shared_ptr<Platform> platform, LaunchFunction launch, HostFunction host, MemType mem_type,
+                     double smoothing)
+    : platform_(std::move(platform)),
+      launch_(std::move(launch)),
+      host_(std::move(host)),
+      mem_type_(mem_type),
+      smoothing_(smoothing) {}
+
+Status Offloader::Make(std::shared_ptr<Offloader> *out,
+                       const std::shared_ptr<Platform> &platform,
+                       LaunchFunction launch,
+                       HostFunction host,
+                       MemType mem_type,
+                       double smoothing) {
+  if (!launch || !host) {
+    return Status::ERROR("An Offloader requires both a launch function and a host implementation.");
+  }
+  if (!(smoothing > 0.0) || (smoothing > 1.0)) {
+    return Status::ERROR("Offloader smoothing must be in (0, 1].");
+  }
+  out->reset(new Offloader(platform, std::move(launch), std::move(host), mem_type, smoothing));
+  return Status::OK();
+}
+
+int64_t Offloader::BatchBytes(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches) {
+  int64_t result = 0;
+  for (const auto &batch : batches) {
+    RecordBatchDescription desc;
+    RecordBatchAnalyzer rba(&desc);
+    if (!rba.Analyze(*batch)) {
+      continue;
+    }
+    for (const auto &f : desc.fields) {
+      for (const auto &b : f.buffers) {
+        if (!b.implicit_) {
+          result += b.size_;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+Offloader::Target Offloader::DecideBytes(int64_t bytes) const {
+  const auto &model = stats_.model;
+  // Measure both targets before trusting the model.
+  if (model.device_samples == 0) {
+    return Target::DEVICE;
+  }
+  if (model.host_samples == 0) {
+    return Target::HOST;
+  }
+  return model.DeviceCost(bytes) <= model.HostCost(bytes) ? Target::DEVICE : Target::HOST;
+}
+
+void Offloader::Update(double *average, double value, uint64_t samples) const {
+  *average = samples == 0 ? value : (1.0 - smoothing_) * *average + smoothing_ * value;
+}
+
+Status Offloader::Decide(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, Target *target) {
+  auto bytes = BatchBytes(batches);
+  std::lock_guard<std::mutex> lock(mutex_);
+  *target = DecideBytes(bytes);
+  return Status::OK();
+}
+
+Status Offloader::Run(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, Target *target) {
+  auto bytes = BatchBytes(batches);
+  Target decision;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decision = DecideBytes(bytes);
+  }
+  if (target != nullptr) {
+    *target = decision;
+  }
+  return decision == Target::DEVICE ? RunDevice(batches, bytes) : RunHost(batches, bytes);
+}
+
+Status Offloader::RunOn(Target target, const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches) {
+  auto bytes = BatchBytes(batches);
+  return target == Target::DEVICE ? RunDevice(batches, bytes) : RunHost(batches, bytes);
+}
+
+/// @brief Return the total duration of some phases recorded by an Instrumentation, in nanoseconds.
+static double Total(const Instrumentation &instrumentation, const std::vector<Phase> &phases) {
+  double result = 0.0;
+  for (auto phase : phases) {
+    result += static_cast<double>(instrumentation.histogram(phase).total());
+  }
+  return result;
+}
+
+Status Offloader::RunDevice(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, int64_t bytes) {
+  std::shared_ptr<Context> context;
+  auto status = Context::Make(&context, platform_);
+  for (size_t i = 0; status.ok() && (i < batches.size()); i++) {
+    status = context->QueueRecordBatch(batches[i], mem_type_);
+  }
+  if (status.ok()) {
+    status = context->Enable();
+  }
+  Timer timer;
+  if (status.ok()) {
+    Kernel kernel(context);
+    timer.start();
+    status = launch_(&kernel);
+    timer.stop();
+  }
+  if (!status.ok()) {
+    return status;
+  }
+
+  // The Context instruments every phase of this run only.
+  const auto &instrumentation = context->instrumentation();
+  auto transfer_ns = Total(instrumentation, {Phase::ALLOC, Phase::COPY, Phase::PREPARE});
+  auto launch_ns = Total(instrumentation, {Phase::METADATA, Phase::START});
+  double kernel_ns;
+  if (instrumentation.histogram(Phase::COMPLETION).count() > 0) {
+    kernel_ns = Total(instrumentation, {Phase::COMPLETION});
+  } else {
+    // The launch function did not wait through the Kernel, so the kernel time is what remains of the launch.
+    auto launch_total = std::chrono::duration_cast<std::chrono::nanoseconds>(timer.stop_ - timer.start_).count();
+    kernel_ns = std::max(0.0, static_cast<double>(launch_total) - launch_ns);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &model = stats_.model;
+  Update(&model.launch_ns, launch_ns, model.device_samples);
+  if (bytes > 0) {
+    Update(&model.transfer_ns_per_byte, transfer_ns / static_cast<double>(bytes), model.device_samples);
+    Update(&model.device_ns_per_byte, kernel_ns / static_cast<double>(bytes), model.device_samples);
+  }
+  model.device_samples++;
+  stats_.device_runs++;
+  stats_.device_bytes += bytes;
+  return Status::OK();
+}
+
+Status Offloader::RunHost(const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches, int64_t bytes) {
+  Timer timer;
+  timer.start();
+  auto status = host_(batches);
+  timer.stop();
+  if (!status.ok()) {
+    return status;
+  }
+  auto host_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      timer.stop_ - timer.start_).count());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &model = stats_.model;
+  if (bytes > 0) {
+    Update(&model.host_ns_per_byte, host_ns / static_cast<double>(bytes), model.host_samples);
+    model.host_samples++;
+  }
+  stats_.host_runs++;
+  stats_.host_bytes += bytes;
+  return Status::OK();
+}
+
+void Offloader::SetModel(const Model &model) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.model = model;
+}
+
+Offloader::Stats Offloader::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+}  // namespace fletcher
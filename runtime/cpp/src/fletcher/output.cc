@@ -0,0 +1,258 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/output.h"
+
+#include <arrow/api.h>
+#include <fletcher/common.h>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fletcher {
+
+/// @brief Return the number of streams through which the kernel writes a field, or 0 if it is not supported.
+static size_t NumStreams(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST:return 2;
+    default:return dynamic_cast<const arrow::FixedWidthType *>(&type) != nullptr ? 1 : 0;
+  }
+}
+
+/// @brief Return the width in bits of the elements of the values buffer of a field.
+static int64_t ValueBits(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:return 8;
+    case arrow::Type::LIST:
+    case arrow::Type::LARGE_LIST:return ValueBits(*type.field(0)->type());
+    default: {
+      auto fixed = dynamic_cast<const arrow::FixedWidthType *>(&type);
+      return fixed != nullptr ? fixed->bit_width() : 0;
+    }
+  }
+}
+
+Status OutputCounter::Make(std::shared_ptr<OutputCounter> *counter,
+                           const std::shared_ptr<Kernel> &kernel,
+                           const std::string &manifest_path) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(counter, kernel, registers);
+}
+
+Status OutputCounter::Make(std::shared_ptr<OutputCounter> *counter,
+                           const std::shared_ptr<Kernel> &kernel,
+                           const std::vector<MmioRegister> &registers) {
+  std::shared_ptr<OutputCounter> result(new OutputCounter(kernel));
+  for (const auto &reg : registers) {
+    if (reg.function == "written") {
+      result->counts_.push_back(reg);
+    }
+  }
+  if (result->counts_.empty()) {
+    return Status::ERROR("Register manifest has no output count registers. "
+                         "Was the design generated with --output_counts?");
+  }
+  *counter = result;
+  return Status::OK();
+}
+
+Status OutputCounter::Read(std::vector<OutputBuffer> *buffers) {
+  auto context = kernel_->context();
+  size_t stream = 0;
+  size_t device_buffer = 0;
+  for (size_t i = 0; i < context->num_recordbatches(); i++) {
+    const auto &schema = *context->recordbatch(i)->schema();
+    const auto &desc = context->recordbatch_description(i);
+    for (size_t f = 0; f < desc.fields.size(); f++) {
+      const auto &field_desc = desc.fields[f];
+      const auto &field = *schema.field(static_cast<int>(f));
+      if ((desc.mode != Mode::WRITE) || GetBoolMeta(field, meta::IGNORE, false)) {
+        device_buffer += field_desc.buffers.size();
+        continue;
+      }
+      const auto &type = *field_desc.type_;
+      auto num_streams = NumStreams(type);
+      if (num_streams == 0) {
+        return Status::ERROR("Output counts of field " + field.name() + " of type " + type.ToString()
+                                 + " are not supported.");
+      }
+      if (stream + num_streams > counts_.size()) {
+        return Status::ERROR("Register manifest has fewer output count registers than the write-mode fields of the "
+                             "Context have streams.");
+      }
+      // The first stream counts the rows, the second stream the values of the lists or strings.
+      uint64_t counts[2] = {0, 0};
+      for (size_t s = 0; s < num_streams; s++) {
+        auto status = ReadRegister(kernel_.get(), counts_[stream++], &counts[s]);
+        if (!status.ok()) {
+          return status;
+        }
+      }
+      auto rows = static_cast<int64_t>(counts[0]);
+      auto values = static_cast<int64_t>(counts[num_streams - 1]);
+      bool large = (type.id() == arrow::Type::LARGE_STRING) || (type.id() == arrow::Type::LARGE_BINARY)
+          || (type.id() == arrow::Type::LARGE_LIST);
+
+      for (const auto &b : field_desc.buffers) {
+        auto index = device_buffer++;
+        if (b.implicit_) {
+          continue;
+        }
+        auto device_buf = context->device_buffer(index);
+        OutputBuffer out;
+        out.recordbatch = i;
+        out.device_buffer = index;
+        out.name = ToString(b.desc_);
+        const auto &kind = b.desc_.back();
+        // Strings have their values at the same level as their offsets, lists have them at the next level.
+        auto items = ((b.level_ > 0) || (kind == "values")) ? values : rows;
+        if (kind == "validity") {
+          out.written = (items + 7) / 8;
+        } else if (kind == "offsets") {
+          out.written = (rows + 1) * static_cast<int64_t>(large ? sizeof(int64_t) : sizeof(int32_t));
+        } else {
+          out.written = (items * ValueBits(type) + 7) / 8;
+        }
+        out.capacity = device_buf.host_visible() ? device_buf.size : std::max(device_buf.capacity, device_buf.size);
+        buffers->push_back(out);
+      }
+    }
+  }
+  if (stream != counts_.size()) {
+    return Status::ERROR("Register manifest has more output count registers than the write-mode fields of the "
+                         "Context have streams.");
+  }
+  return Status::OK();
+}
+
+Status OutputCounter::Run(const std::function<Status()> &launch,
+                          const std::function<Status(const std::vector<OutputBuffer> &)> &grow,
+                          std::vector<OutputBuffer> *buffers,
+                          size_t max_attempts) {
+  for (size_t attempt = 1;; attempt++) {
+    auto status = launch();
+    if (!status.ok()) {
+      return status;
+    }
+    buffers->clear();
+    status = Read(buffers);
+    if (!status.ok()) {
+      return status;
+    }
+    auto overflow = std::find_if(buffers->begin(), buffers->end(), [](const OutputBuffer &b) { return b.overflow(); });
+    if (overflow == buffers->end()) {
+      return Status::OK();
+    }
+    if (attempt >= max_attempts) {
+      return Status::ERROR("Kernel wrote " + std::to_string(overflow->written) + " bytes to output buffer "
+                               + overflow->name + " of " + std::to_string(overflow->capacity) + " bytes.");
+    }
+    status = grow(*buffers);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+}
+
+std::vector<std::string> OutputCounter::streams() const {
+  std::vector<std::string> result;
+  for (const auto &reg : counts_) {
+    result.push_back(reg.name);
+  }
+  return result;
+}
+
+Status ProgressCounter::Make(std::shared_ptr<ProgressCounter> *counter,
+                             const std::shared_ptr<Kernel> &kernel,
+                             const std::string &manifest_path) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(counter, kernel, registers);
+}
+
+Status ProgressCounter::Make(std::shared_ptr<ProgressCounter> *counter,
+                             const std::shared_ptr<Kernel> &kernel,
+                             const std::vector<MmioRegister> &registers) {
+  std::shared_ptr<ProgressCounter> result(new ProgressCounter(kernel));
+  for (const auto &reg : registers) {
+    if (reg.function == "progress") {
+      result->consumed_.push_back(reg);
+    }
+  }
+  if (result->consumed_.empty()) {
+    return Status::ERROR("Register manifest has no progress registers. Was the design generated with --progress?");
+  }
+  *counter = result;
+  return Status::OK();
+}
+
+Status ProgressCounter::Read(std::vector<RecordBatchProgress> *progress) {
+  auto context = kernel_->context();
+  size_t reg = 0;
+  for (size_t i = 0; i < context->num_recordbatches(); i++) {
+    const auto &desc = context->recordbatch_description(i);
+    if (desc.mode != Mode::READ) {
+      continue;
+    }
+    // RecordBatches of which every field is ignored have no streams to count.
+    const auto &fields = context->recordbatch(i)->schema()->fields();
+    if (std::all_of(fields.begin(), fields.end(), [](const std::shared_ptr<arrow::Field> &f) {
+      return GetBoolMeta(*f, meta::IGNORE, false);
+    })) {
+      continue;
+    }
+    if (reg >= consumed_.size()) {
+      return Status::ERROR("Register manifest has fewer progress registers than the Context has read-mode "
+                           "RecordBatches.");
+    }
+    uint64_t consumed = 0;
+    auto status = ReadRegister(kernel_.get(), consumed_[reg++], &consumed);
+    if (!status.ok()) {
+      return status;
+    }
+    progress->push_back({i, static_cast<int64_t>(consumed)});
+  }
+  if (reg != consumed_.size()) {
+    return Status::ERROR("Register manifest has more progress registers than the Context has read-mode "
+                         "RecordBatches.");
+  }
+  return Status::OK();
+}
+
+}  // namespace fletcher
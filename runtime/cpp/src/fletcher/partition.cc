@@ -0,0 +1,168 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/partition.h"
+
+#include <arrow/api.h>
+#include <fletcher/common.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fletcher {
+
+/// @brief Allocate a zero-initialized buffer.
+static Status AllocateZeroed(int64_t size, std::shared_ptr<arrow::Buffer> *out) {
+  auto result = arrow::AllocateBuffer(size);
+  if (!result.ok()) {
+    return Status::ERROR("Could not allocate partition buffer: " + result.status().ToString());
+  }
+  std::shared_ptr<arrow::Buffer> buffer = std::move(result).ValueOrDie();
+  std::memset(buffer->mutable_data(), 0, static_cast<size_t>(size));
+  *out = buffer;
+  return Status::OK();
+}
+
+/// @brief Allocate an array of some field that can hold a number of rows.
+static Status AllocateArray(const arrow::Field &field,
+                            int64_t rows,
+                            int64_t values,
+                            std::shared_ptr<arrow::Array> *out) {
+  std::vector<std::shared_ptr<arrow::Buffer>> buffers(1, nullptr);
+  if (field.nullable()) {
+    auto status = AllocateZeroed((rows + 7) / 8, &buffers[0]);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  const auto &type = field.type();
+  std::vector<int64_t> sizes;
+  switch (type->id()) {
+    case arrow::Type::STRING:
+    case arrow::Type::BINARY:sizes = {(rows + 1) * static_cast<int64_t>(sizeof(int32_t)), values};
+      break;
+    case arrow::Type::LARGE_STRING:
+    case arrow::Type::LARGE_BINARY:sizes = {(rows + 1) * static_cast<int64_t>(sizeof(int64_t)), values};
+      break;
+    default: {
+      auto fixed = std::dynamic_pointer_cast<arrow::FixedWidthType>(type);
+      if (fixed == nullptr) {
+        return Status::ERROR("Partitioned output field " + field.name() + " of type " + type->ToString()
+                                 + " is not supported.");
+      }
+      sizes = {(rows * fixed->bit_width() + 7) / 8};
+    }
+  }
+  for (auto size : sizes) {
+    std::shared_ptr<arrow::Buffer> buffer;
+    auto status = AllocateZeroed(size, &buffer);
+    if (!status.ok()) {
+      return status;
+    }
+    buffers.push_back(buffer);
+  }
+  auto null_count = field.nullable() ? arrow::kUnknownNullCount : 0;
+  *out = arrow::MakeArray(arrow::ArrayData::Make(type, rows, buffers, null_count));
+  return Status::OK();
+}
+
+Status PartitionedOutput::Make(std::shared_ptr<PartitionedOutput> *output,
+                               const std::shared_ptr<arrow::Schema> &schema,
+                               int64_t rows,
+                               int64_t values) {
+  std::vector<std::shared_ptr<arrow::Schema>> partitions;
+  if (!PartitionSchemas(schema, &partitions)) {
+    return Status::ERROR("Could not partition schema " + GetMeta(*schema, meta::NAME) + ".");
+  }
+  if (GetMeta(*partitions[0], meta::PARTITION).empty()) {
+    return Status::ERROR("Schema " + GetMeta(*schema, meta::NAME) + " has no partitioning metadata.");
+  }
+  std::shared_ptr<PartitionedOutput> result(new PartitionedOutput());
+  for (const auto &partition : partitions) {
+    std::vector<std::shared_ptr<arrow::Array>> columns;
+    for (const auto &field : partition->fields()) {
+      std::shared_ptr<arrow::Array> column;
+      auto status = AllocateArray(*field, rows, values, &column);
+      if (!status.ok()) {
+        return status;
+      }
+      columns.push_back(column);
+    }
+    result->recordbatches_.push_back(arrow::RecordBatch::Make(partition, rows, columns));
+  }
+  *output = result;
+  return Status::OK();
+}
+
+Status PartitionedOutput::Queue(Context *context, MemType mem_type) {
+  first_ = context->num_recordbatches();
+  for (const auto &rb : recordbatches_) {
+    auto status = context->QueueRecordBatch(rb, mem_type);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  queued_ = true;
+  return Status::OK();
+}
+
+Status PartitionedOutput::Read(Kernel *kernel,
+                               const std::vector<MmioRegister> &registers,
+                               std::vector<std::shared_ptr<arrow::RecordBatch>> *out) {
+  if (!queued_) {
+    return Status::ERROR("Partitions were not queued.");
+  }
+  out->clear();
+  for (size_t p = 0; p < recordbatches_.size(); p++) {
+    auto name = GetMeta(*recordbatches_[p]->schema(), meta::NAME) + "_rows";
+    auto reg = std::find_if(registers.begin(), registers.end(), [&name](const MmioRegister &r) {
+      return r.name == name;
+    });
+    if (reg == registers.end()) {
+      return Status::ERROR("Register manifest has no register " + name + ".");
+    }
+    uint64_t rows = 0;
+    auto status = ReadRegister(kernel, *reg, &rows);
+    if (!status.ok()) {
+      return status;
+    }
+    std::shared_ptr<arrow::RecordBatch> batch;
+    status = kernel->context()->ReadbackRecordBatch(first_ + p, &batch, static_cast<int64_t>(rows));
+    if (!status.ok()) {
+      return status;
+    }
+    out->push_back(batch);
+  }
+  return Status::OK();
+}
+
+Status PartitionedOutput::Read(Kernel *kernel,
+                               const std::string &manifest_path,
+                               std::vector<std::shared_ptr<arrow::RecordBatch>> *out) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Read(kernel, registers, out);
+}
+
+}  // namespace fletcher
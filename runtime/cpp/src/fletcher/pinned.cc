@@ -0,0 +1,77 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/pinned.h"
+
+#include <fletcher/common.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace fletcher {
+
+// Arrow uses this address for zero-size allocations.
+alignas(64) static uint8_t zero_size_area[1];
+
+Status PinnedMemoryPool::Make(std::shared_ptr<PinnedMemoryPool> *out, const std::shared_ptr<Platform> &platform) {
+  if (!platform->HasHostMalloc()) {
+    return Status::ERROR("Platform " + platform->name() + " does not support device-visible host memory.");
+  }
+  *out = std::make_shared<PinnedMemoryPool>(platform);
+  return Status::OK();
+}
+
+arrow::Status PinnedMemoryPool::Allocate(int64_t size, uint8_t **out) {
+  if (size < 0) {
+    return arrow::Status::Invalid("Negative allocation size requested.");
+  }
+  if (size == 0) {
+    *out = zero_size_area;
+    return arrow::Status::OK();
+  }
+  auto status = platform_->HostMalloc(out, size);
+  if (!status.ok()) {
+    return arrow::Status::OutOfMemory("Could not allocate device-visible host memory: " + status.message);
+  }
+  auto allocated = bytes_allocated_ += size;
+  // Update the high-water mark.
+  auto max = max_memory_.load();
+  while ((allocated > max) && !max_memory_.compare_exchange_weak(max, allocated)) {}
+  return arrow::Status::OK();
+}
+
+arrow::Status PinnedMemoryPool::Reallocate(int64_t old_size, int64_t new_size, uint8_t **ptr) {
+  uint8_t *new_ptr = nullptr;
+  auto status = Allocate(new_size, &new_ptr);
+  if (!status.ok()) {
+    return status;
+  }
+  std::memcpy(new_ptr, *ptr, static_cast<size_t>(std::min(old_size, new_size)));
+  Free(*ptr, old_size);
+  *ptr = new_ptr;
+  return arrow::Status::OK();
+}
+
+void PinnedMemoryPool::Free(uint8_t *buffer, int64_t size) {
+  if (buffer == zero_size_area) {
+    return;
+  }
+  auto status = platform_->HostFree(buffer);
+  if (!status.ok()) {
+    FLETCHER_LOG(ERROR, "Could not free device-visible host memory. Status: " + status.message);
+  }
+  bytes_allocated_ -= size;
+}
+
+}  // namespace fletcher
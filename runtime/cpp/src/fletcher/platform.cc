@@ -17,6 +17,11 @@
 #include <arrow/api.h>
 #include <fletcher/common.h>
 
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <utility>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <memory>
@@ -38,44 +43,263 @@ std::string Platform::name() {
   return std::string(buf);
 }
 
-Status Platform::Make(const std::string &name, std::shared_ptr<fletcher::Platform> *platform_out, bool quiet) {
+namespace {
+
+/// Process-wide cache of linked platform libraries and the autodetection result.
+struct Registry {
+  /// Mutex protecting the linked libraries.
+  std::mutex libraries_mutex;
+  /// Linked but uninitialized platforms by name and device. A nullptr means the library could not be linked.
+  std::map<std::pair<std::string, uint64_t>, std::shared_ptr<Platform>> libraries;
+  /// Mutex serializing autodetection.
+  std::mutex detect_mutex;
+  /// Whether autodetection has completed.
+  bool detected = false;
+  /// The name of the detected platform, or empty if none was found.
+  std::string detected_name;
+};
+
+Registry *GetRegistry() {
+  // Never destroyed, such that platforms may still be created and destroyed during static destruction.
+  static auto *registry = new Registry();
+  return registry;
+}
+
+}  // namespace
+
+std::shared_ptr<Platform> Platform::Open(const std::string &name, uint64_t device, bool quiet) {
+#ifdef FLETCHER_STATIC_PLATFORM
+  // Only the platform that is linked into the run-time is available, and its global state is shared by all devices.
+  if ((name != FLETCHER_STATIC_PLATFORM) || (device != 0)) {
+    if (!quiet) {
+      FLETCHER_LOG(WARNING, "Run-time was built for platform " FLETCHER_STATIC_PLATFORM " only. Cannot open platform "
+          + name + " for device " + std::to_string(device) + ".");
+    }
+    return nullptr;
+  }
+  auto library = std::make_shared<Platform>();
+  library->LinkStatic();
+  // The cached instance is never initialized, so it must not terminate the platform.
+  library->terminated = true;
+  library->device_ = device;
+  return library;
+#else
+  auto file = "libfletcher_" + name + DYLIB_EXT;
   // Attempt to open shared library
   void *handle = nullptr;
-  handle = dlopen(("libfletcher_" + name + DYLIB_EXT).c_str(), RTLD_NOW);
-
-  if (handle) {
-    // Create a new platform
-    *platform_out = std::make_shared<Platform>();
-    // Attempt to link the functions and return the result
-    return (*platform_out)->Link(handle, quiet);
+  if (device == 0) {
+    handle = dlopen(file.c_str(), RTLD_NOW);
   } else {
-    // Could not open shared library
-    platform_out = nullptr;
+#ifdef LM_ID_NEWLM
+    // Every other device gets its own copy of the library, and therefore of the global state of the platform.
+    handle = dlmopen(LM_ID_NEWLM, file.c_str(), RTLD_NOW);
+#else
+    if (!quiet) {
+      FLETCHER_LOG(WARNING, "Multiple devices per platform are not supported on this system.");
+    }
+    return nullptr;
+#endif
+  }
+  if (!handle) {
     if (!quiet) {
       FLETCHER_LOG(WARNING, dlerror());
     }
+    return nullptr;
+  }
+
+  // Attempt to link the functions
+  auto library = std::make_shared<Platform>();
+  auto status = library->Link(handle, quiet);
+  // The cached instance is never initialized, so it must not terminate the platform.
+  library->terminated = true;
+  if (!status.ok()) {
+    return nullptr;
+  }
+  library->device_ = device;
+  if (library->platformSetDevice != nullptr) {
+    status = Status(library->platformSetDevice(device));
+  } else if (device != 0) {
+    status = Status::ERROR("Platform " + name + " does not support selecting a device.");
+  }
+  if (!status.ok()) {
+    if (!quiet) {
+      FLETCHER_LOG(ERROR, status.message);
+    }
+    return nullptr;
+  }
+  return library;
+#endif
+}
+
+Status Platform::Make(const std::string &name, std::shared_ptr<fletcher::Platform> *platform_out, bool quiet) {
+  return Make(name, 0, platform_out, quiet);
+}
+
+Status Platform::Make(const std::string &name,
+                      uint64_t device,
+                      std::shared_ptr<fletcher::Platform> *platform_out,
+                      bool quiet) {
+  *platform_out = nullptr;
+  auto *registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->libraries_mutex);
+
+  auto lookup = [&](uint64_t d) {
+    auto cached = registry->libraries.find({name, d});
+    if (cached == registry->libraries.end()) {
+      cached = registry->libraries.emplace(std::make_pair(name, d), Open(name, d, quiet)).first;
+    }
+    return cached->second;
+  };
+
+  // The library of device 0 enumerates the devices.
+  auto library = lookup(0);
+  if (library == nullptr) {
+    // Could not open or link shared library
     return Status::NO_PLATFORM();
   }
+  if (device != 0) {
+    uint64_t count = 1;
+    if (library->platformGetDeviceCount != nullptr) {
+      auto status = Status(library->platformGetDeviceCount(&count));
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    if (device >= count) {
+      return Status::ERROR("Platform " + name + " has " + std::to_string(count) + " device(s), device "
+                               + std::to_string(device) + " does not exist.");
+    }
+    library = lookup(device);
+    if (library == nullptr) {
+      return Status::ERROR("Could not open platform " + name + " for device " + std::to_string(device) + ".");
+    }
+  }
+
+  // Create a new platform
+  *platform_out = std::make_shared<Platform>();
+  (*platform_out)->Link(*library);
+
+  // Pick up the run-time hints of the platform profile, if any.
+  const char *profile = std::getenv("FLETCHER_PLATFORM_PROFILE");
+  if ((profile != nullptr) && (*profile != '\0')) {
+    auto status = (*platform_out)->LoadProfile(profile);
+    if (!status.ok()) {
+      *platform_out = nullptr;
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status Platform::LoadProfile(const std::string &path) {
+  std::ifstream file(path);
+  if (!file.good()) {
+    return Status::ERROR("Could not open platform profile " + path + ".");
+  }
+  PlatformProfile profile;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    std::string value;
+    if (!(fields >> key) || (key[0] == '#')) {
+      continue;
+    }
+    if (!(fields >> value)) {
+      return Status::ERROR("Platform profile " + path + ": key " + key + " has no value.");
+    }
+    try {
+      if (key == "name") {
+        profile.name = value;
+      } else if (key == "buffer_alignment") {
+        profile.buffer_alignment = std::stoll(value);
+      } else if (key == "mem_type") {
+        if ((value != "any") && (value != "cache")) {
+          return Status::ERROR("Platform profile " + path + ": mem_type must be any or cache.");
+        }
+        profile.cache = value == "cache";
+      } else if (key == "spin_usec") {
+        profile.spin_usec = static_cast<unsigned int>(std::stoul(value));
+      } else if (key == "poll_interval_usec") {
+        profile.poll_interval_usec = static_cast<unsigned int>(std::stoul(value));
+      }
+    } catch (const std::exception &e) {
+      return Status::ERROR("Platform profile " + path + ": invalid value " + value + " of key " + key + ".");
+    }
+  }
+  if ((profile.buffer_alignment < 0) || ((profile.buffer_alignment & (profile.buffer_alignment - 1)) != 0)) {
+    return Status::ERROR("Platform profile " + path + ": buffer_alignment must be zero or a power of two.");
+  }
+  profile_ = profile;
+  return Status::OK();
+}
+
+Status Platform::DeviceCount(const std::string &name, uint64_t *count, bool quiet) {
+  std::shared_ptr<Platform> platform;
+  auto status = Make(name, &platform, quiet);
+  if (!status.ok()) {
+    return status;
+  }
+  *count = 1;
+  if (platform->platformGetDeviceCount != nullptr) {
+    return Status(platform->platformGetDeviceCount(count));
+  }
+  return Status::OK();
+}
+
+Status Platform::MakeAll(const std::string &name, std::vector<std::shared_ptr<Platform>> *platforms_out, bool quiet) {
+  platforms_out->clear();
+  uint64_t count = 0;
+  auto status = DeviceCount(name, &count, quiet);
+  if (!status.ok()) {
+    return status;
+  }
+  for (uint64_t d = 0; d < count; d++) {
+    std::shared_ptr<Platform> platform;
+    status = Make(name, d, &platform, quiet);
+    if (!status.ok()) {
+      platforms_out->clear();
+      return status;
+    }
+    platforms_out->push_back(platform);
+  }
+  return Status::OK();
 }
 
 Status Platform::Make(std::shared_ptr<fletcher::Platform> *platform_out, bool quiet) {
+  auto *registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->detect_mutex);
+
+  if (registry->detected) {
+    if (registry->detected_name.empty()) {
+      *platform_out = nullptr;
+      return Status::NO_PLATFORM();
+    }
+    return Make(registry->detected_name, platform_out, quiet);
+  }
+
   Status status = Status::NO_PLATFORM();
   if (!quiet) {
     FLETCHER_LOG(INFO, "Attempting to autodetect Fletcher hardware platform...");
   }
+#ifdef FLETCHER_STATIC_PLATFORM
+  std::vector<std::string> autodetect_platforms = {FLETCHER_STATIC_PLATFORM};
+#else
   std::vector<std::string> autodetect_platforms = {FLETCHER_AUTODETECT_PLATFORMS};
-  std::string logstr;
+#endif
   for (const auto &p : autodetect_platforms) {
     // Attempt to create platform
     status = Make(p, platform_out, quiet);
     if (status.ok()) {
       // We've found a working platform, use that.
-      return status;
+      registry->detected_name = p;
+      break;
     }
     if (!quiet && (p != autodetect_platforms.back())) {
       FLETCHER_LOG(INFO, "Attempting next platform...");
     }
   }
+  registry->detected = true;
   return status;
 }
 
@@ -96,6 +320,21 @@ Status Platform::Link(void *handle, bool quiet) {
     char *err = dlerror();
 
     if (err == nullptr) {
+      // Optional functions may be missing; clear any error they cause.
+      *reinterpret_cast<void **>((&platformWriteMMIOBatch)) = dlsym(handle, "platformWriteMMIOBatch");
+      *reinterpret_cast<void **>((&platformWriteMMIO64)) = dlsym(handle, "platformWriteMMIO64");
+      *reinterpret_cast<void **>((&platformReadMMIO64)) = dlsym(handle, "platformReadMMIO64");
+      *reinterpret_cast<void **>((&platformWaitForInterrupt)) = dlsym(handle, "platformWaitForInterrupt");
+      *reinterpret_cast<void **>((&platformHostMalloc)) = dlsym(handle, "platformHostMalloc");
+      *reinterpret_cast<void **>((&platformHostFree)) = dlsym(handle, "platformHostFree");
+      *reinterpret_cast<void **>((&platformDeviceMap)) = dlsym(handle, "platformDeviceMap");
+      *reinterpret_cast<void **>((&platformDeviceUnmap)) = dlsym(handle, "platformDeviceUnmap");
+      *reinterpret_cast<void **>((&platformCopyHostToDeviceV)) = dlsym(handle, "platformCopyHostToDeviceV");
+      *reinterpret_cast<void **>((&platformLoadImage)) = dlsym(handle, "platformLoadImage");
+      *reinterpret_cast<void **>((&platformGetDeviceCount)) = dlsym(handle, "platformGetDeviceCount");
+      *reinterpret_cast<void **>((&platformSetDevice)) = dlsym(handle, "platformSetDevice");
+      *reinterpret_cast<void **>((&platformGetNumaNode)) = dlsym(handle, "platformGetNumaNode");
+      dlerror();
       return Status::OK();
     } else {
       if (!quiet) {
@@ -109,7 +348,204 @@ Status Platform::Link(void *handle, bool quiet) {
   }
 }
 
+void Platform::Link(const Platform &other) {
+  platformInit = other.platformInit;
+  platformGetName = other.platformGetName;
+  platformWriteMMIO = other.platformWriteMMIO;
+  platformReadMMIO = other.platformReadMMIO;
+  platformDeviceMalloc = other.platformDeviceMalloc;
+  platformDeviceFree = other.platformDeviceFree;
+  platformCopyHostToDevice = other.platformCopyHostToDevice;
+  platformCopyDeviceToHost = other.platformCopyDeviceToHost;
+  platformPrepareHostBuffer = other.platformPrepareHostBuffer;
+  platformCacheHostBuffer = other.platformCacheHostBuffer;
+  platformTerminate = other.platformTerminate;
+  platformWriteMMIOBatch = other.platformWriteMMIOBatch;
+  platformWriteMMIO64 = other.platformWriteMMIO64;
+  platformReadMMIO64 = other.platformReadMMIO64;
+  platformWaitForInterrupt = other.platformWaitForInterrupt;
+  platformHostMalloc = other.platformHostMalloc;
+  platformHostFree = other.platformHostFree;
+  platformDeviceMap = other.platformDeviceMap;
+  platformDeviceUnmap = other.platformDeviceUnmap;
+  platformCopyHostToDeviceV = other.platformCopyHostToDeviceV;
+  platformLoadImage = other.platformLoadImage;
+  platformGetDeviceCount = other.platformGetDeviceCount;
+  platformSetDevice = other.platformSetDevice;
+  platformGetNumaNode = other.platformGetNumaNode;
+  device_ = other.device_;
+}
+
+#ifdef FLETCHER_STATIC_PLATFORM
+void Platform::LinkStatic() {
+  platformInit = &::platformInit;
+  platformGetName = &::platformGetName;
+  platformWriteMMIO = &::platformWriteMMIO;
+  platformReadMMIO = &::platformReadMMIO;
+  platformDeviceMalloc = &::platformDeviceMalloc;
+  platformDeviceFree = &::platformDeviceFree;
+  platformCopyHostToDevice = &::platformCopyHostToDevice;
+  platformCopyDeviceToHost = &::platformCopyDeviceToHost;
+  platformPrepareHostBuffer = &::platformPrepareHostBuffer;
+  platformCacheHostBuffer = &::platformCacheHostBuffer;
+  platformTerminate = &::platformTerminate;
+  // Optional functions the platform does not define are weak symbols with a null address.
+  platformWriteMMIOBatch = &::platformWriteMMIOBatch;
+  platformWriteMMIO64 = &::platformWriteMMIO64;
+  platformReadMMIO64 = &::platformReadMMIO64;
+  platformWaitForInterrupt = &::platformWaitForInterrupt;
+  platformHostMalloc = &::platformHostMalloc;
+  platformHostFree = &::platformHostFree;
+  platformDeviceMap = &::platformDeviceMap;
+  platformDeviceUnmap = &::platformDeviceUnmap;
+  platformCopyHostToDeviceV = &::platformCopyHostToDeviceV;
+  platformLoadImage = &::platformLoadImage;
+  platformGetDeviceCount = &::platformGetDeviceCount;
+  platformSetDevice = &::platformSetDevice;
+  platformGetNumaNode = &::platformGetNumaNode;
+}
+#endif
+
+int Platform::numa_node() {
+  int64_t node = -1;
+  if ((platformGetNumaNode == nullptr) || !Status(platformGetNumaNode(&node)).ok()) {
+    return -1;
+  }
+  return static_cast<int>(node);
+}
+
+Status Platform::WriteMMIOBatch(uint64_t offset, const uint32_t *values, size_t count) {
+  if (platformWriteMMIOBatch != nullptr) {
+    return Status(FLETCHER_PLATFORM_CALL(platformWriteMMIOBatch)(offset, values, count));
+  }
+  for (size_t i = 0; i < count; i++) {
+    auto stat = WriteMMIO(offset + i, values[i]);
+    if (!stat.ok()) {
+      return stat;
+    }
+  }
+  return Status::OK();
+}
+
+Status Platform::CopyHostToDeviceV(const fiov_t *iov, size_t count) {
+  if (platformCopyHostToDeviceV != nullptr) {
+    return Status(platformCopyHostToDeviceV(iov, count));
+  }
+  for (size_t i = 0; i < count; i++) {
+    auto stat = CopyHostToDevice(const_cast<uint8_t *>(iov[i].host_address), iov[i].device_address, iov[i].size);
+    if (!stat.ok()) {
+      return stat;
+    }
+  }
+  return Status::OK();
+}
+
+Status Platform::HostMalloc(uint8_t **host_address, int64_t size) {
+  if (!HasHostMalloc()) {
+    return Status::ERROR("Platform does not support device-visible host memory.");
+  }
+  da_t device_address = D_NULLPTR;
+  auto status = Status(platformHostMalloc(host_address, &device_address, size));
+  if (!status.ok()) {
+    return status;
+  }
+  std::lock_guard<std::mutex> lock(host_regions_mutex_);
+  host_regions_[*host_address] = {size, device_address};
+  return Status::OK();
+}
+
+Status Platform::HostFree(uint8_t *host_address) {
+  if (!HasHostMalloc()) {
+    return Status::ERROR("Platform does not support device-visible host memory.");
+  }
+  {
+    std::lock_guard<std::mutex> lock(host_regions_mutex_);
+    if (host_regions_.erase(host_address) == 0) {
+      return Status::ERROR("Host memory was not allocated with HostMalloc.");
+    }
+  }
+  return Status(platformHostFree(host_address));
+}
+
+bool Platform::FindRegion(const std::map<const uint8_t *, HostRegion> &regions,
+                          const uint8_t *host_address,
+                          int64_t size,
+                          da_t *device_address) {
+  if (regions.empty() || (host_address == nullptr)) {
+    return false;
+  }
+  // Find the last region that starts at or before the buffer.
+  auto it = regions.upper_bound(host_address);
+  if (it == regions.begin()) {
+    return false;
+  }
+  --it;
+  auto offset = host_address - it->first;
+  if (offset + size > it->second.size) {
+    return false;
+  }
+  *device_address = it->second.device_address + static_cast<da_t>(offset);
+  return true;
+}
+
+bool Platform::IsDeviceVisible(const uint8_t *host_address, int64_t size, da_t *device_address) {
+  std::lock_guard<std::mutex> lock(host_regions_mutex_);
+  return FindRegion(host_regions_, host_address, size, device_address);
+}
+
+Status Platform::DeviceMap(da_t device_address, int64_t size, uint8_t **host_address) {
+  if (!HasDeviceMap()) {
+    return Status::ERROR("Platform does not support mapping device memory.");
+  }
+  auto status = Status(platformDeviceMap(device_address, size, host_address));
+  if (!status.ok()) {
+    return status;
+  }
+  std::lock_guard<std::mutex> lock(host_regions_mutex_);
+  mapped_regions_[*host_address] = {size, device_address};
+  return Status::OK();
+}
+
+Status Platform::DeviceUnmap(uint8_t *host_address) {
+  if (!HasDeviceMap()) {
+    return Status::ERROR("Platform does not support mapping device memory.");
+  }
+  int64_t size = 0;
+  {
+    std::lock_guard<std::mutex> lock(host_regions_mutex_);
+    auto it = mapped_regions_.find(host_address);
+    if (it == mapped_regions_.end()) {
+      return Status::ERROR("Host memory was not mapped with DeviceMap.");
+    }
+    size = it->second.size;
+    mapped_regions_.erase(it);
+  }
+  return Status(platformDeviceUnmap(host_address, size));
+}
+
+bool Platform::IsDeviceMapped(const uint8_t *host_address, int64_t size, da_t *device_address) {
+  std::lock_guard<std::mutex> lock(host_regions_mutex_);
+  return FindRegion(mapped_regions_, host_address, size, device_address);
+}
+
+Status Platform::WriteMMIO64(uint64_t offset, uint64_t value) {
+  if (HasMMIO64() && (offset % 2 == 0)) {
+    return Status(FLETCHER_PLATFORM_CALL(platformWriteMMIO64)(offset, value));
+  }
+  dau_t parts;
+  parts.full = value;
+  auto stat = WriteMMIO(offset, parts.lo);
+  if (!stat.ok()) {
+    return stat;
+  }
+  return WriteMMIO(offset + 1, parts.hi);
+}
+
 Status Platform::ReadMMIO64(uint64_t offset, uint64_t *value) {
+  if (HasMMIO64() && (offset % 2 == 0)) {
+    return Status(FLETCHER_PLATFORM_CALL(platformReadMMIO64)(offset, value));
+  }
+
   freg_t hi, lo;
   Status stat;
 
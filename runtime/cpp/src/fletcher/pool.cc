@@ -0,0 +1,198 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/pool.h"
+
+#include <fletcher/common.h>
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+namespace fletcher {
+
+static inline int64_t AlignUp(int64_t value, int64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+double DeviceMemoryPool::Stats::fragmentation() const {
+  auto free_bytes = slab_bytes - allocated_bytes;
+  if (free_bytes <= 0) {
+    return 0.0;
+  }
+  return 1.0 - static_cast<double>(largest_free_region) / static_cast<double>(free_bytes);
+}
+
+std::string DeviceMemoryPool::Stats::ToString() const {
+  std::stringstream ss;
+  ss << "DeviceMemoryPool: " << num_slabs << " slab(s), " << slab_bytes << " bytes" << std::endl;
+  ss << "  Allocated       : " << allocated_bytes << " bytes in " << num_allocations << " region(s)" << std::endl;
+  ss << "  High-water mark : " << high_water_mark << " bytes" << std::endl;
+  ss << "  Free regions    : " << num_free_regions << ", largest " << largest_free_region << " bytes" << std::endl;
+  ss << "  Fragmentation   : " << fragmentation() << std::endl;
+  return ss.str();
+}
+
+DeviceMemoryPool::DeviceMemoryPool(std::shared_ptr<Platform> platform, int64_t slab_size, int64_t alignment)
+    : platform_(std::move(platform)), slab_size_(slab_size), alignment_(alignment) {}
+
+DeviceMemoryPool::~DeviceMemoryPool() {
+  if (!regions_.empty()) {
+    FLETCHER_LOG(WARNING, "DeviceMemoryPool destructed while " << regions_.size() << " region(s) are in use.");
+  }
+  for (const auto &slab : slabs_) {
+    auto status = platform_->DeviceFree(slab->address);
+    if (!status.ok()) {
+      FLETCHER_LOG(ERROR, "Could not free DeviceMemoryPool slab. Device memory may be corrupted. "
+                          "Status: " + status.message);
+    }
+  }
+}
+
+Status DeviceMemoryPool::Make(std::shared_ptr<DeviceMemoryPool> *out,
+                              const std::shared_ptr<Platform> &platform,
+                              int64_t slab_size,
+                              int64_t alignment) {
+  if ((alignment <= 0) || ((alignment & (alignment - 1)) != 0)) {
+    return Status::ERROR("DeviceMemoryPool alignment must be a power of two.");
+  }
+  if (slab_size <= 0) {
+    return Status::ERROR("DeviceMemoryPool slab size must be positive.");
+  }
+  *out = std::make_shared<DeviceMemoryPool>(platform, slab_size, alignment);
+  return Status::OK();
+}
+
+bool DeviceMemoryPool::AllocateFromSlabs(da_t *device_address, int64_t aligned_size) {
+  // First fit over all slabs.
+  for (auto &slab : slabs_) {
+    for (auto it = slab->free.begin(); it != slab->free.end(); ++it) {
+      auto offset = it->first;
+      auto free_size = it->second;
+      // Slabs may not be aligned themselves, so align the absolute device address.
+      auto start = static_cast<int64_t>(slab->address) + offset;
+      auto padding = AlignUp(start, alignment_) - start;
+      if (free_size < padding + aligned_size) {
+        continue;
+      }
+      // Split the free region into the padding, the new region and the remainder.
+      slab->free.erase(it);
+      if (padding > 0) {
+        slab->free[offset] = padding;
+      }
+      auto remainder = free_size - padding - aligned_size;
+      if (remainder > 0) {
+        slab->free[offset + padding + aligned_size] = remainder;
+      }
+      *device_address = static_cast<da_t>(start + padding);
+      regions_[*device_address] = {slab.get(), offset + padding, aligned_size};
+      allocated_bytes_ += aligned_size;
+      high_water_mark_ = std::max(high_water_mark_, allocated_bytes_);
+      return true;
+    }
+  }
+  return false;
+}
+
+Status DeviceMemoryPool::Allocate(da_t *device_address, int64_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto aligned_size = AlignUp(std::max<int64_t>(size, 1), alignment_);
+  if (AllocateFromSlabs(device_address, aligned_size)) {
+    return Status::OK();
+  }
+
+  // No free region fits, allocate a new slab. Reserve space for alignment padding.
+  std::unique_ptr<Slab> slab(new Slab);
+  slab->size = std::max(slab_size_, aligned_size + alignment_);
+  auto status = platform_->DeviceMalloc(&slab->address, static_cast<size_t>(slab->size));
+  if (!status.ok()) {
+    return status;
+  }
+  FLETCHER_LOG(DEBUG, "DeviceMemoryPool allocated slab of " << slab->size << " bytes.");
+  slab->free[0] = slab->size;
+  slabs_.push_back(std::move(slab));
+
+  // The new slab is guaranteed to fit the region.
+  if (!AllocateFromSlabs(device_address, aligned_size)) {
+    return Status::DEVICE_OUT_OF_MEMORY();
+  }
+  return Status::OK();
+}
+
+Status DeviceMemoryPool::Free(da_t device_address) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto r = regions_.find(device_address);
+  if (r == regions_.end()) {
+    return Status::ERROR("Device address was not allocated from this DeviceMemoryPool.");
+  }
+  auto &free = r->second.slab->free;
+  auto offset = r->second.offset;
+  auto size = r->second.size;
+  allocated_bytes_ -= size;
+  regions_.erase(r);
+
+  // Coalesce with the next free region.
+  auto next = free.lower_bound(offset);
+  if ((next != free.end()) && (next->first == offset + size)) {
+    size += next->second;
+    next = free.erase(next);
+  }
+  // Coalesce with the previous free region.
+  if (next != free.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return Status::OK();
+    }
+  }
+  free[offset] = size;
+  return Status::OK();
+}
+
+Status DeviceMemoryPool::Trim() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Status result = Status::OK();
+  for (auto it = slabs_.begin(); it != slabs_.end();) {
+    auto &slab = *it;
+    bool unused = (slab->free.size() == 1) && (slab->free.begin()->second == slab->size);
+    if (unused) {
+      auto status = platform_->DeviceFree(slab->address);
+      if (!status.ok()) {
+        result = status;
+      }
+      it = slabs_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return result;
+}
+
+DeviceMemoryPool::Stats DeviceMemoryPool::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats result;
+  result.num_slabs = slabs_.size();
+  result.allocated_bytes = allocated_bytes_;
+  result.high_water_mark = high_water_mark_;
+  result.num_allocations = regions_.size();
+  for (const auto &slab : slabs_) {
+    result.slab_bytes += slab->size;
+    result.num_free_regions += slab->free.size();
+    for (const auto &f : slab->free) {
+      result.largest_free_region = std::max(result.largest_free_region, f.second);
+    }
+  }
+  return result;
+}
+
+}  // namespace fletcher
@@ -0,0 +1,402 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/profiler.h"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fletcher {
+
+/// The suffixes of the counter register names, in the order of the StreamProfile counters.
+static const char *const kCounterNames[] = {"elements", "valids", "readies", "transfers", "packets", "cycles"};
+/// The number of counters of a stream profiler.
+static constexpr size_t kNumCounters = sizeof(kCounterNames) / sizeof(kCounterNames[0]);
+
+Status ParseRegisterManifest(std::istream *input, std::vector<MmioRegister> *registers) {
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(*input, line)) {
+    line_number++;
+    // Skip comments and empty lines.
+    auto first = line.find_first_not_of(" \t\r");
+    if ((first == std::string::npos) || (line[first] == '#')) {
+      continue;
+    }
+    std::stringstream ss(line);
+    MmioRegister reg;
+    if (!(ss >> reg.name >> reg.function >> reg.behavior >> reg.offset >> reg.index >> reg.width)) {
+      return Status::ERROR("Malformed register manifest line " + std::to_string(line_number) + ": " + line);
+    }
+    registers->push_back(reg);
+  }
+  return Status::OK();
+}
+
+Status ReadRegister(Kernel *kernel, const MmioRegister &reg, uint64_t *value) {
+  if (reg.index + reg.width > 64) {
+    return Status::ERROR("Register " + reg.name + " does not fit in 64 bits.");
+  }
+  auto platform = kernel->context()->platform();
+  uint64_t raw = 0;
+  uint32_t first = 0;
+  auto offset = kernel->mmio_base() + reg.offset;
+  if (kernel->mmio64 && platform->HasMMIO64() && (offset % 2 == 0) && (reg.index + reg.width > 32)) {
+    // Read both words with a single access, such that the counter does not change in between.
+    auto status = platform->ReadMMIO64(offset, &raw);
+    if (!status.ok()) {
+      return status;
+    }
+    first = 2;
+  }
+  for (uint32_t word = first; 32 * word < reg.index + reg.width; word++) {
+    uint32_t part = 0;
+    auto status = platform->ReadMMIO(offset + word, &part);
+    if (!status.ok()) {
+      return status;
+    }
+    raw |= static_cast<uint64_t>(part) << (32 * word);
+  }
+  raw >>= reg.index;
+  if (reg.width < 64) {
+    raw &= (1ull << reg.width) - 1;
+  }
+  *value = raw;
+  return Status::OK();
+}
+
+/// @brief Return a fraction, or zero if the denominator is zero.
+static inline double Ratio(uint64_t numerator, uint64_t denominator) {
+  return denominator > 0 ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+}
+
+double StreamProfile::elements_per_cycle() const { return Ratio(elements, cycles); }
+
+double StreamProfile::utilization() const { return Ratio(transfers, cycles); }
+
+double StreamProfile::backpressure() const { return valids > transfers ? Ratio(valids - transfers, valids) : 0.0; }
+
+double StreamProfile::starvation() const { return readies > transfers ? Ratio(readies - transfers, readies) : 0.0; }
+
+double StreamProfile::bandwidth(double clock_hz) const { return elements_per_cycle() * clock_hz; }
+
+Status Profiler::Make(std::shared_ptr<Profiler> *profiler,
+                      const std::shared_ptr<Kernel> &kernel,
+                      const std::string &manifest_path) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(profiler, kernel, registers);
+}
+
+Status Profiler::Make(std::shared_ptr<Profiler> *profiler,
+                      const std::shared_ptr<Kernel> &kernel,
+                      const std::vector<MmioRegister> &registers) {
+  std::shared_ptr<Profiler> result(new Profiler(kernel));
+  bool has_enable = false;
+  bool has_clear = false;
+  const std::string prefix = "Profile_";
+  for (const auto &reg : registers) {
+    if (reg.function != "profile") {
+      continue;
+    }
+    if (reg.name == prefix + "enable") {
+      result->enable_ = reg;
+      has_enable = true;
+    } else if (reg.name == prefix + "clear") {
+      result->clear_ = reg;
+      has_clear = true;
+    } else if (reg.name == prefix + "snapshot") {
+      result->snapshot_ = reg;
+      result->has_snapshot_ = true;
+    } else if (reg.name.compare(0, prefix.size(), prefix) == 0) {
+      // Counter registers are named Profile_<stream>_<counter>.
+      auto split = reg.name.rfind('_');
+      auto counter = reg.name.substr(split + 1);
+      auto name = reg.name.substr(prefix.size(), split - prefix.size());
+      size_t c = 0;
+      while ((c < kNumCounters) && (counter != kCounterNames[c])) {
+        c++;
+      }
+      if (c == kNumCounters) {
+        return Status::ERROR("Unknown profiler counter register " + reg.name);
+      }
+      if (result->streams_.empty() || (result->streams_.back().name != name)) {
+        result->streams_.push_back({name, std::vector<MmioRegister>(kNumCounters)});
+      }
+      result->streams_.back().counters[c] = reg;
+    }
+  }
+  if (!has_enable || !has_clear) {
+    return Status::ERROR("Register manifest has no profiler enable and clear registers. "
+                         "Was the design generated with profiling enabled?");
+  }
+  *profiler = result;
+  return Status::OK();
+}
+
+Status Profiler::WriteField(const MmioRegister &reg, uint32_t value) {
+  // Fletchgen gives every register its own address, so the other bits can be written as zero.
+  return kernel_->context()->platform()->WriteMMIO(kernel_->mmio_base() + reg.offset, value << reg.index);
+}
+
+Status Profiler::ReadField(const MmioRegister &reg, uint64_t *value) { return ReadRegister(kernel_.get(), reg, value); }
+
+Status Profiler::Clear() { return WriteField(clear_, 1); }
+
+Status Profiler::Start() { return WriteField(enable_, 1); }
+
+Status Profiler::Stop() { return WriteField(enable_, 0); }
+
+Status Profiler::Snapshot() {
+  if (!has_snapshot_) {
+    return Status::OK();
+  }
+  return WriteField(snapshot_, 1);
+}
+
+Status Profiler::Read(std::vector<StreamProfile> *profiles) {
+  auto snapshot_status = Snapshot();
+  if (!snapshot_status.ok()) {
+    return snapshot_status;
+  }
+  for (const auto &stream : streams_) {
+    StreamProfile profile;
+    profile.name = stream.name;
+    uint64_t *counters[] = {&profile.elements, &profile.valids, &profile.readies,
+                            &profile.transfers, &profile.packets, &profile.cycles};
+    for (size_t c = 0; c < kNumCounters; c++) {
+      // Counters that are not in the manifest remain zero.
+      if (stream.counters[c].width == 0) {
+        continue;
+      }
+      auto status = ReadField(stream.counters[c], counters[c]);
+      if (!status.ok()) {
+        return status;
+      }
+    }
+    profiles->push_back(profile);
+  }
+  return Status::OK();
+}
+
+Status Profiler::Run(const std::function<Status()> &launch, std::vector<StreamProfile> *profiles) {
+  auto status = Stop();
+  if (status.ok()) status = Clear();
+  if (status.ok()) status = Start();
+  if (!status.ok()) {
+    return status;
+  }
+  // Always stop the profilers, even if the launch failed.
+  auto launch_status = launch();
+  status = Stop();
+  if (!launch_status.ok()) {
+    return launch_status;
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return Read(profiles);
+}
+
+std::vector<std::string> Profiler::streams() const {
+  std::vector<std::string> result;
+  for (const auto &stream : streams_) {
+    result.push_back(stream.name);
+  }
+  return result;
+}
+
+Status BusTrace::Make(std::shared_ptr<BusTrace> *trace,
+                      const std::shared_ptr<Kernel> &kernel,
+                      const std::string &manifest_path) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(trace, kernel, registers);
+}
+
+Status BusTrace::Make(std::shared_ptr<BusTrace> *trace,
+                      const std::shared_ptr<Kernel> &kernel,
+                      const std::vector<MmioRegister> &registers) {
+  std::shared_ptr<BusTrace> result(new BusTrace(kernel));
+  std::pair<const char *, MmioRegister *> named[] = {
+      {"Trace_depth", &result->depth_}, {"Trace_enable", &result->enable_}, {"Trace_clear", &result->clear_},
+      {"Trace_index", &result->index_}, {"Trace_count", &result->count_}, {"Trace_dropped", &result->dropped_},
+      {"Trace_cycle", &result->cycle_}, {"Trace_port", &result->port_}, {"Trace_addr", &result->addr_},
+      {"Trace_len", &result->len_}};
+  const std::string port_prefix = "Trace_port_";
+  size_t found = 0;
+  for (const auto &reg : registers) {
+    if (reg.function != "trace") {
+      continue;
+    }
+    if (reg.name.compare(0, port_prefix.size(), port_prefix) == 0) {
+      // The bus ports are named by constant registers Trace_port_<port>, in the order of their index.
+      result->ports_.push_back({reg.name.substr(port_prefix.size()), reg});
+      continue;
+    }
+    for (auto &n : named) {
+      if (reg.name == n.first) {
+        *n.second = reg;
+        found++;
+      }
+    }
+  }
+  if (found != sizeof(named) / sizeof(named[0])) {
+    return Status::ERROR("Register manifest does not hold all bus trace registers. "
+                         "Was the design generated with --bus_trace?");
+  }
+  *trace = result;
+  return Status::OK();
+}
+
+Status BusTrace::WriteField(const MmioRegister &reg, uint32_t value) {
+  return kernel_->context()->platform()->WriteMMIO(kernel_->mmio_base() + reg.offset, value << reg.index);
+}
+
+Status BusTrace::Clear() { return WriteField(clear_, 1); }
+
+Status BusTrace::Start() { return WriteField(enable_, 1); }
+
+Status BusTrace::Stop() { return WriteField(enable_, 0); }
+
+Status BusTrace::Read(std::shared_ptr<arrow::RecordBatch> *out, uint64_t *dropped) {
+  uint64_t depth = 0;
+  uint64_t count = 0;
+  auto status = ReadRegister(kernel_.get(), depth_, &depth);
+  if (status.ok()) status = ReadRegister(kernel_.get(), count_, &count);
+  if (status.ok() && (dropped != nullptr)) status = ReadRegister(kernel_.get(), dropped_, dropped);
+  if (!status.ok()) {
+    return status;
+  }
+  if ((depth == 0) || ((depth & (depth - 1)) != 0)) {
+    return Status::ERROR("Bus trace depth " + std::to_string(depth) + " is not a power of two.");
+  }
+
+  std::vector<uint64_t> is_write(ports_.size());
+  for (size_t p = 0; p < ports_.size(); p++) {
+    status = ReadRegister(kernel_.get(), ports_[p].write, &is_write[p]);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  arrow::UInt64Builder cycles;
+  arrow::StringBuilder ports;
+  arrow::BooleanBuilder writes;
+  arrow::UInt64Builder addresses;
+  arrow::UInt32Builder lengths;
+  // Once the ring is full, it holds the last depth requests, of which the n-th request is held at index n % depth.
+  uint64_t first = count > depth ? count - depth : 0;
+  uint64_t wraps = 0;
+  uint64_t last_cycle = 0;
+  for (uint64_t n = first; n < count; n++) {
+    // The entry registers show the selected entry one cycle after it is selected, well before they can be read.
+    status = WriteField(index_, static_cast<uint32_t>(n & (depth - 1)));
+    uint64_t cycle = 0;
+    uint64_t port = 0;
+    uint64_t address = 0;
+    uint64_t length = 0;
+    if (status.ok()) status = ReadRegister(kernel_.get(), cycle_, &cycle);
+    if (status.ok()) status = ReadRegister(kernel_.get(), port_, &port);
+    if (status.ok()) status = ReadRegister(kernel_.get(), addr_, &address);
+    if (status.ok()) status = ReadRegister(kernel_.get(), len_, &length);
+    if (!status.ok()) {
+      return status;
+    }
+    if (port >= ports_.size()) {
+      return Status::ERROR("Bus trace entry holds unknown port index " + std::to_string(port) + ".");
+    }
+    // The cycle register wraps around, but requests are recorded in order.
+    if ((n > first) && (cycle < last_cycle)) {
+      wraps++;
+    }
+    last_cycle = cycle;
+    auto append = cycles.Append((wraps << cycle_.width) + cycle);
+    if (append.ok()) append = ports.Append(ports_[port].name);
+    if (append.ok()) append = writes.Append(is_write[port] != 0);
+    if (append.ok()) append = addresses.Append(address);
+    if (append.ok()) append = lengths.Append(static_cast<uint32_t>(length));
+    if (!append.ok()) {
+      return Status::ERROR("Could not append bus trace entry: " + append.ToString());
+    }
+  }
+
+  std::vector<std::shared_ptr<arrow::Array>> columns(5);
+  auto finish = cycles.Finish(&columns[0]);
+  if (finish.ok()) finish = ports.Finish(&columns[1]);
+  if (finish.ok()) finish = writes.Finish(&columns[2]);
+  if (finish.ok()) finish = addresses.Finish(&columns[3]);
+  if (finish.ok()) finish = lengths.Finish(&columns[4]);
+  if (!finish.ok()) {
+    return Status::ERROR("Could not finish bus trace: " + finish.ToString());
+  }
+  auto schema = arrow::schema({arrow::field("cycle", arrow::uint64(), false),
+                               arrow::field("port", arrow::utf8(), false),
+                               arrow::field("write", arrow::boolean(), false),
+                               arrow::field("address", arrow::uint64(), false),
+                               arrow::field("length", arrow::uint32(), false)});
+  *out = arrow::RecordBatch::Make(schema, static_cast<int64_t>(columns[0]->length()), columns);
+  return Status::OK();
+}
+
+std::vector<std::string> BusTrace::ports() const {
+  std::vector<std::string> result;
+  for (const auto &port : ports_) {
+    result.push_back(port.name);
+  }
+  return result;
+}
+
+std::string Profiler::ToString(const std::vector<StreamProfile> &profiles, double clock_hz) {
+  std::stringstream ss;
+  ss << std::setw(32) << "stream" << std::setw(14) << "elements" << std::setw(14) << "cycles"
+     << std::setw(12) << "elem/cycle" << std::setw(12) << "util [%]" << std::setw(12) << "bp [%]"
+     << std::setw(12) << "starve [%]";
+  if (clock_hz > 0.0) {
+    ss << std::setw(14) << "Melem/s";
+  }
+  ss << std::endl;
+  for (const auto &p : profiles) {
+    ss << std::setw(32) << p.name << std::setw(14) << p.elements << std::setw(14) << p.cycles
+       << std::fixed << std::setprecision(3) << std::setw(12) << p.elements_per_cycle()
+       << std::setprecision(1) << std::setw(12) << 100.0 * p.utilization()
+       << std::setw(12) << 100.0 * p.backpressure() << std::setw(12) << 100.0 * p.starvation();
+    if (clock_hz > 0.0) {
+      ss << std::setw(14) << p.bandwidth(clock_hz) / 1e6;
+    }
+    ss << std::endl;
+  }
+  return ss.str();
+}
+
+}  // namespace fletcher
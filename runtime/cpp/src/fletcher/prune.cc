@@ -0,0 +1,332 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/prune.h"
+
+#include <arrow/api.h>
+#include <arrow/util/byte_size.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef FLETCHER_PARQUET
+#include <arrow/io/file.h>
+#include <parquet/exception.h>
+#include <parquet/file_reader.h>
+#include <parquet/statistics.h>
+#endif
+
+namespace fletcher {
+
+/// @brief Compute the zone map of an array with values of some C type.
+template<typename T>
+static void ComputeValues(const arrow::Array &array, ZoneMap *out) {
+  const T *values = array.data()->GetValues<T>(1);
+  auto length = array.length();
+  T lo = std::numeric_limits<T>::max();
+  T hi = std::numeric_limits<T>::lowest();
+  if (array.null_count() == 0) {
+    // Without nulls, the compiler turns this loop into vector minimum and maximum instructions.
+    for (int64_t i = 0; i < length; i++) {
+      lo = std::min(lo, values[i]);
+      hi = std::max(hi, values[i]);
+    }
+    out->has_values = length > 0;
+  } else {
+    out->has_values = false;
+    for (int64_t i = 0; i < length; i++) {
+      if (array.IsValid(i)) {
+        lo = std::min(lo, values[i]);
+        hi = std::max(hi, values[i]);
+        out->has_values = true;
+      }
+    }
+  }
+  out->min = static_cast<int64_t>(lo);
+  out->max = static_cast<int64_t>(hi);
+}
+
+/// @brief Return whether zone maps of arrays of some type can be computed.
+static bool HasZoneMap(const arrow::DataType &type) {
+  switch (type.id()) {
+    case arrow::Type::INT8:
+    case arrow::Type::INT16:
+    case arrow::Type::INT32:
+    case arrow::Type::INT64:
+    case arrow::Type::UINT8:
+    case arrow::Type::UINT16:
+    case arrow::Type::UINT32:
+    case arrow::Type::UINT64:
+    case arrow::Type::DATE32:
+    case arrow::Type::DATE64:
+    case arrow::Type::TIME32:
+    case arrow::Type::TIME64:
+    case arrow::Type::TIMESTAMP: return true;
+    default: return false;
+  }
+}
+
+Status ZoneMap::Compute(const arrow::Array &array, ZoneMap *out) {
+  switch (array.type_id()) {
+    case arrow::Type::INT8: ComputeValues<int8_t>(array, out);
+      break;
+    case arrow::Type::INT16: ComputeValues<int16_t>(array, out);
+      break;
+    case arrow::Type::INT32:
+    case arrow::Type::DATE32:
+    case arrow::Type::TIME32: ComputeValues<int32_t>(array, out);
+      break;
+    case arrow::Type::INT64:
+    case arrow::Type::DATE64:
+    case arrow::Type::TIME64:
+    case arrow::Type::TIMESTAMP: ComputeValues<int64_t>(array, out);
+      break;
+    case arrow::Type::UINT8: ComputeValues<uint8_t>(array, out);
+      break;
+    case arrow::Type::UINT16: ComputeValues<uint16_t>(array, out);
+      break;
+    case arrow::Type::UINT32: ComputeValues<uint32_t>(array, out);
+      break;
+    case arrow::Type::UINT64: {
+      ZoneMap result;
+      ComputeValues<uint64_t>(array, &result);
+      if (result.has_values && (static_cast<uint64_t>(result.max) > std::numeric_limits<int64_t>::max())) {
+        return Status::ERROR("Zone map of uint64 array does not fit in int64.");
+      }
+      *out = result;
+      break;
+    }
+    default: return Status::ERROR("Cannot compute the zone map of an array of type " + array.type()->ToString());
+  }
+  return Status::OK();
+}
+
+bool Condition::MayMatch(const ZoneMap &zone_map) const {
+  if (!zone_map.has_values) {
+    return false;
+  }
+  switch (op) {
+    case Op::EQ: return (zone_map.min <= value) && (value <= zone_map.max);
+    case Op::NE: return (zone_map.min != value) || (zone_map.max != value);
+    case Op::LT: return zone_map.min < value;
+    case Op::LE: return zone_map.min <= value;
+    case Op::GT: return zone_map.max > value;
+    case Op::GE: return zone_map.max >= value;
+  }
+  return true;
+}
+
+#ifdef FLETCHER_PARQUET
+
+/// @brief Convert the statistics of a column chunk to a zone map. Returns false if they do not determine one.
+static bool ToZoneMap(const parquet::Statistics &stats, bool is_signed, ZoneMap *out) {
+  if (stats.HasNullCount() && (stats.num_values() == 0)) {
+    // All values of the column chunk are null.
+    *out = ZoneMap();
+    return true;
+  }
+  if (!stats.HasMinMax()) {
+    return false;
+  }
+  // Unsigned integers are stored in signed physical types, so their bits are reinterpreted.
+  if (stats.physical_type() == parquet::Type::INT32) {
+    const auto &typed = dynamic_cast<const parquet::Int32Statistics &>(stats);
+    if (is_signed) {
+      out->min = typed.min();
+      out->max = typed.max();
+    } else {
+      out->min = static_cast<uint32_t>(typed.min());
+      out->max = static_cast<uint32_t>(typed.max());
+    }
+  } else if (stats.physical_type() == parquet::Type::INT64) {
+    const auto &typed = dynamic_cast<const parquet::Int64Statistics &>(stats);
+    if (!is_signed && (typed.max() < 0)) {
+      // The maximum does not fit in an int64.
+      return false;
+    }
+    out->min = typed.min();
+    out->max = typed.max();
+  } else {
+    return false;
+  }
+  out->has_values = true;
+  return true;
+}
+
+Status ReadParquetZoneMaps(const std::string &file_name,
+                           const std::vector<std::string> &columns,
+                           std::vector<ZoneMaps> *out) {
+  auto opened = arrow::io::ReadableFile::Open(file_name);
+  if (!opened.ok()) {
+    return Status::ERROR("Could not open " + file_name + ": " + opened.status().ToString());
+  }
+  std::shared_ptr<parquet::FileMetaData> metadata;
+  try {
+    metadata = parquet::ReadMetaData(opened.ValueOrDie());
+  } catch (const parquet::ParquetException &e) {
+    return Status::ERROR("Could not read the metadata of " + file_name + ": " + e.what());
+  }
+
+  std::vector<int> indices;
+  std::vector<bool> is_signed;
+  for (const auto &column : columns) {
+    auto index = metadata->schema()->ColumnIndex(column);
+    if (index < 0) {
+      return Status::ERROR(file_name + " has no column " + column + ".");
+    }
+    auto logical_type = metadata->schema()->Column(index)->logical_type();
+    indices.push_back(index);
+    is_signed.push_back(!logical_type->is_int()
+                            || dynamic_cast<const parquet::IntLogicalType &>(*logical_type).is_signed());
+  }
+
+  out->clear();
+  for (int rg = 0; rg < metadata->num_row_groups(); rg++) {
+    auto row_group = metadata->RowGroup(rg);
+    ZoneMaps zone_maps;
+    for (size_t c = 0; c < columns.size(); c++) {
+      auto stats = row_group->ColumnChunk(indices[c])->statistics();
+      ZoneMap zone_map;
+      if ((stats != nullptr) && ToZoneMap(*stats, is_signed[c], &zone_map)) {
+        zone_maps[columns[c]] = zone_map;
+      }
+    }
+    out->push_back(zone_maps);
+  }
+  return Status::OK();
+}
+
+#else
+
+Status ReadParquetZoneMaps(const std::string &file_name, const std::vector<std::string> &, std::vector<ZoneMaps> *) {
+  return Status::ERROR("Could not read the zone maps of " + file_name + ": the Fletcher run-time library was built "
+                       "without Parquet support (FLETCHER_PARQUET).");
+}
+
+#endif
+
+Pruner::Pruner(std::shared_ptr<arrow::RecordBatchReader> reader,
+               std::vector<Condition> conditions,
+               std::vector<ZoneMaps> zone_maps)
+    : reader_(std::move(reader)), conditions_(std::move(conditions)), zone_maps_(std::move(zone_maps)) {}
+
+Status Pruner::Make(std::shared_ptr<Pruner> *out,
+                    const std::shared_ptr<arrow::RecordBatchReader> &reader,
+                    const std::vector<Condition> &conditions,
+                    const std::vector<ZoneMaps> &zone_maps) {
+  if (reader == nullptr) {
+    return Status::ERROR("Pruner requires a reader.");
+  }
+  for (const auto &c : conditions) {
+    auto field = reader->schema()->GetFieldByName(c.column);
+    if (field == nullptr) {
+      return Status::ERROR("Schema has no field " + c.column + " to prune on.");
+    }
+    if (!HasZoneMap(*field->type())) {
+      return Status::ERROR("Cannot prune on field " + c.column + " of type " + field->type()->ToString());
+    }
+  }
+  *out = std::make_shared<Pruner>(reader, conditions, zone_maps);
+  return Status::OK();
+}
+
+Status Pruner::MayMatch(const arrow::RecordBatch &batch, size_t index, bool *out) const {
+  ZoneMaps computed;
+  for (const auto &c : conditions_) {
+    const ZoneMap *zone_map = nullptr;
+    if (index < zone_maps_.size()) {
+      auto given = zone_maps_[index].find(c.column);
+      if (given != zone_maps_[index].end()) {
+        zone_map = &given->second;
+      }
+    }
+    if (zone_map == nullptr) {
+      auto cached = computed.find(c.column);
+      if (cached == computed.end()) {
+        ZoneMap result;
+        auto status = ZoneMap::Compute(*batch.GetColumnByName(c.column), &result);
+        if (!status.ok()) {
+          return status;
+        }
+        cached = computed.emplace(c.column, result).first;
+      }
+      zone_map = &cached->second;
+    }
+    if (!c.MayMatch(*zone_map)) {
+      *out = false;
+      return Status::OK();
+    }
+  }
+  *out = true;
+  return Status::OK();
+}
+
+Status Pruner::Next(std::shared_ptr<arrow::RecordBatch> *out) {
+  *out = nullptr;
+  while (true) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    auto read = reader_->ReadNext(&batch);
+    if (!read.ok()) {
+      return Status::ERROR("Could not read RecordBatch to prune: " + read.ToString());
+    }
+    if (batch == nullptr) {
+      return Status::OK();
+    }
+    bool match = true;
+    auto status = MayMatch(*batch, skipped_.size(), &match);
+    if (!status.ok()) {
+      return status;
+    }
+    skipped_.push_back(!match);
+    if (match) {
+      *out = batch;
+      return Status::OK();
+    }
+    num_skipped_++;
+    bytes_skipped_ += arrow::util::TotalBufferSize(*batch);
+  }
+}
+
+arrow::Status Pruner::ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) {
+  auto status = Next(batch);
+  if (!status.ok()) {
+    return arrow::Status::IOError(status.message);
+  }
+  return arrow::Status::OK();
+}
+
+Status Pruner::Expand(const arrow::UInt64Array &results, uint64_t skipped, std::shared_ptr<arrow::Array> *out) const {
+  if (static_cast<size_t>(results.length()) != skipped_.size() - num_skipped_) {
+    return Status::ERROR("Expected " + std::to_string(skipped_.size() - num_skipped_) + " results, but got "
+                             + std::to_string(results.length()) + ".");
+  }
+  arrow::UInt64Builder builder;
+  auto append = builder.Reserve(static_cast<int64_t>(skipped_.size()));
+  int64_t next = 0;
+  for (size_t i = 0; (i < skipped_.size()) && append.ok(); i++) {
+    append = builder.Append(skipped_[i] ? skipped : results.Value(next++));
+  }
+  if (append.ok()) {
+    append = builder.Finish(out);
+  }
+  if (!append.ok()) {
+    return Status::ERROR("Could not expand results: " + append.ToString());
+  }
+  return Status::OK();
+}
+
+}  // namespace fletcher
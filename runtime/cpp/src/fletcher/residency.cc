@@ -0,0 +1,229 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/residency.h"
+
+#include <fletcher/common.h>
+#include <sstream>
+#include <utility>
+
+#include "fletcher/numa.h"
+
+namespace fletcher {
+
+double ResidencyCache::Stats::hit_rate() const {
+  auto acquisitions = hits + misses;
+  if (acquisitions == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(hits) / static_cast<double>(acquisitions);
+}
+
+std::string ResidencyCache::Stats::ToString() const {
+  std::stringstream ss;
+  ss << "ResidencyCache: " << num_entries << " entries, " << resident_bytes << " bytes" << std::endl;
+  ss << "  Pinned    : " << num_pinned << " entries" << std::endl;
+  ss << "  Hits      : " << hits << std::endl;
+  ss << "  Misses    : " << misses << std::endl;
+  ss << "  Hit rate  : " << hit_rate() << std::endl;
+  ss << "  Evictions : " << evictions << std::endl;
+  ss << "  Bypasses  : " << bypasses << std::endl;
+  return ss.str();
+}
+
+ResidencyCache::ResidencyCache(std::shared_ptr<Platform> platform,
+                               int64_t budget,
+                               std::shared_ptr<DeviceMemoryPool> pool)
+    : platform_(std::move(platform)), budget_(budget), pool_(std::move(pool)) {}
+
+ResidencyCache::~ResidencyCache() {
+  size_t pinned = 0;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->pins > 0) {
+      pinned++;
+    }
+    auto next = std::next(it);
+    auto status = Erase(it);
+    if (!status.ok()) {
+      FLETCHER_LOG(ERROR, "Could not free ResidencyCache entry. Device memory may be corrupted. "
+                          "Status: " + status.message);
+    }
+    it = next;
+  }
+  if (pinned > 0) {
+    FLETCHER_LOG(WARNING, "ResidencyCache destructed while " << pinned << " entries are pinned.");
+  }
+}
+
+Status ResidencyCache::Make(std::shared_ptr<ResidencyCache> *out,
+                            const std::shared_ptr<Platform> &platform,
+                            int64_t budget,
+                            const std::shared_ptr<DeviceMemoryPool> &pool) {
+  if (budget <= 0) {
+    return Status::ERROR("ResidencyCache budget must be positive.");
+  }
+  if ((pool != nullptr) && (pool->platform() != platform)) {
+    return Status::ERROR("DeviceMemoryPool was created for a different platform.");
+  }
+  *out = std::make_shared<ResidencyCache>(platform, budget, pool);
+  return Status::OK();
+}
+
+Status ResidencyCache::Erase(EntryList::iterator entry) {
+  auto status = pool_ != nullptr ? pool_->Free(entry->device_address) : platform_->DeviceFree(entry->device_address);
+  if (!entry->stale) {
+    index_.erase({entry->host_address, entry->size});
+  }
+  by_device_.erase(entry->device_address);
+  resident_bytes_ -= entry->size;
+  entries_.erase(entry);
+  return status;
+}
+
+Status ResidencyCache::MakeRoom(int64_t size, bool *fits) {
+  // Walk from the least recently used entry, skipping pinned entries.
+  auto it = entries_.end();
+  while ((resident_bytes_ + size > budget_) && (it != entries_.begin())) {
+    --it;
+    if (it->pins > 0) {
+      continue;
+    }
+    auto victim = it++;
+    auto status = Erase(victim);
+    stats_.evictions++;
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  *fits = resident_bytes_ + size <= budget_;
+  return Status::OK();
+}
+
+Status ResidencyCache::Acquire(const uint8_t *host_address,
+                               int64_t size,
+                               const std::shared_ptr<const void> &owner,
+                               da_t *device_address) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  *device_address = D_NULLPTR;
+  auto found = index_.find({host_address, size});
+  if (found != index_.end()) {
+    auto entry = found->second;
+    entry->pins++;
+    entries_.splice(entries_.begin(), entries_, entry);
+    stats_.hits++;
+    *device_address = entry->device_address;
+    return Status::OK();
+  }
+
+  stats_.misses++;
+  bool fits = false;
+  auto status = MakeRoom(size, &fits);
+  if (!status.ok()) {
+    return status;
+  }
+  if (!fits) {
+    stats_.bypasses++;
+    return Status::OK();
+  }
+
+  // Copy while holding the mutex, such that no other thread can acquire the entry before it holds the data.
+  da_t address = D_NULLPTR;
+  status = pool_ != nullptr ? pool_->Allocate(&address, size) : platform_->DeviceMalloc(&address, size);
+  if (!status.ok()) {
+    return status;
+  }
+  status = NumaCopyHostToDevice(platform_.get(), host_address, address, size);
+  if (!status.ok()) {
+    if (pool_ != nullptr) {
+      pool_->Free(address);
+    } else {
+      platform_->DeviceFree(address);
+    }
+    return status;
+  }
+  entries_.push_front({host_address, size, address, owner, 1, false});
+  index_[{host_address, size}] = entries_.begin();
+  by_device_[address] = entries_.begin();
+  resident_bytes_ += size;
+  *device_address = address;
+  return Status::OK();
+}
+
+Status ResidencyCache::Release(da_t device_address) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = by_device_.find(device_address);
+  if ((found == by_device_.end()) || (found->second->pins == 0)) {
+    return Status::ERROR("Device address was not acquired from this ResidencyCache.");
+  }
+  auto entry = found->second;
+  entry->pins--;
+  if (entry->stale && (entry->pins == 0)) {
+    return Erase(entry);
+  }
+  return Status::OK();
+}
+
+Status ResidencyCache::Invalidate(const uint8_t *host_address) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Status result = Status::OK();
+  auto it = index_.lower_bound({host_address, 0});
+  while ((it != index_.end()) && (it->first.first == host_address)) {
+    auto entry = it->second;
+    it = index_.erase(it);
+    entry->stale = true;
+    if (entry->pins == 0) {
+      auto status = Erase(entry);
+      if (!status.ok()) {
+        result = status;
+      }
+    }
+  }
+  return result;
+}
+
+bool ResidencyCache::IsResident(const uint8_t *host_address, int64_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_.count({host_address, size}) > 0;
+}
+
+Status ResidencyCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Status result = Status::OK();
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto next = std::next(it);
+    if (it->pins == 0) {
+      auto status = Erase(it);
+      if (!status.ok()) {
+        result = status;
+      }
+    }
+    it = next;
+  }
+  return result;
+}
+
+ResidencyCache::Stats ResidencyCache::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Stats result = stats_;
+  result.resident_bytes = resident_bytes_;
+  result.num_entries = entries_.size();
+  for (const auto &e : entries_) {
+    if (e.pins > 0) {
+      result.num_pinned++;
+    }
+  }
+  return result;
+}
+
+}  // namespace fletcher
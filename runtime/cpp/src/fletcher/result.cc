@@ -0,0 +1,111 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/result.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fletcher {
+
+/// @brief Find a register of the result scratchpad.
+static Status FindRegister(const std::vector<MmioRegister> &registers, const std::string &name, MmioRegister *out) {
+  auto reg = std::find_if(registers.begin(), registers.end(), [&name](const MmioRegister &r) {
+    return r.name == name;
+  });
+  if (reg == registers.end()) {
+    return Status::ERROR("Register manifest has no register " + name + ". "
+                         "Was the design generated with --result_bytes?");
+  }
+  *out = *reg;
+  return Status::OK();
+}
+
+Status ResultBuffer::Make(std::shared_ptr<ResultBuffer> *out,
+                          const std::shared_ptr<Platform> &platform,
+                          const std::vector<MmioRegister> &registers,
+                          uint64_t mmio_base) {
+  MmioRegister address_reg;
+  MmioRegister bytes_reg;
+  auto status = FindRegister(registers, "result_address", &address_reg);
+  if (!status.ok()) {
+    return status;
+  }
+  status = FindRegister(registers, "result_bytes", &bytes_reg);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // The size of the scratchpad is a constant of the design.
+  uint32_t bytes = 0;
+  status = platform->ReadMMIO(mmio_base + bytes_reg.offset, &bytes);
+  if (!status.ok()) {
+    return status;
+  }
+  if (bytes == 0) {
+    return Status::ERROR("Result scratchpad has a size of zero bytes.");
+  }
+
+  std::shared_ptr<ResultBuffer> result(new ResultBuffer(platform));
+  status = platform->DeviceMalloc(&result->address_, bytes);
+  if (!status.ok()) {
+    return status;
+  }
+  result->host_.resize(bytes);
+  for (uint32_t word = 0; 32 * word < address_reg.width; word++) {
+    status = platform->WriteMMIO(mmio_base + address_reg.offset + word,
+                                 static_cast<uint32_t>(result->address_ >> (32 * word)));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  *out = result;
+  return Status::OK();
+}
+
+Status ResultBuffer::Make(std::shared_ptr<ResultBuffer> *out,
+                          const std::shared_ptr<Platform> &platform,
+                          const std::string &manifest_path,
+                          uint64_t mmio_base) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(out, platform, registers, mmio_base);
+}
+
+ResultBuffer::~ResultBuffer() {
+  if (address_ != D_NULLPTR) {
+    platform_->DeviceFree(address_);
+  }
+}
+
+Status ResultBuffer::Clear() {
+  std::fill(host_.begin(), host_.end(), 0);
+  return platform_->CopyHostToDevice(host_.data(), address_, host_.size());
+}
+
+Status ResultBuffer::Read() {
+  return platform_->CopyDeviceToHost(address_, host_.data(), host_.size());
+}
+
+}  // namespace fletcher
@@ -0,0 +1,201 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/ring.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fletcher {
+
+/// @brief Find a register of the descriptor ring.
+static Status FindRegister(const std::vector<MmioRegister> &registers, const std::string &name, MmioRegister *out) {
+  auto reg = std::find_if(registers.begin(), registers.end(), [&name](const MmioRegister &r) {
+    return r.name == name;
+  });
+  if (reg == registers.end()) {
+    return Status::ERROR("Register manifest has no register " + name + ". "
+                         "Was the design generated with --descriptor_ring?");
+  }
+  *out = *reg;
+  return Status::OK();
+}
+
+Status DescriptorRing::Make(std::shared_ptr<DescriptorRing> *out,
+                            const std::shared_ptr<Platform> &platform,
+                            const std::vector<MmioRegister> &registers,
+                            uint32_t size,
+                            uint64_t mmio_base) {
+  if (size < 2) {
+    return Status::ERROR("A descriptor ring must hold at least two descriptors.");
+  }
+  std::shared_ptr<DescriptorRing> result(new DescriptorRing(platform));
+  result->mmio_base_ = mmio_base;
+  result->size_ = size;
+  MmioRegister stride;
+  for (const auto &r : std::vector<std::pair<std::string, MmioRegister *>>{{"ring_enable", &result->enable_},
+                                                                          {"ring_base", &result->base_},
+                                                                          {"ring_size", &result->size_reg_},
+                                                                          {"ring_tail", &result->tail_reg_},
+                                                                          {"ring_head", &result->head_reg_},
+                                                                          {"ring_stride", &stride}}) {
+    auto status = FindRegister(registers, r.first, r.second);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  // The hardware determines the size of a descriptor, from the number of schema-derived registers and the bus width.
+  auto status = platform->ReadMMIO(mmio_base + stride.offset, &result->stride_);
+  if (!status.ok()) {
+    return status;
+  }
+  if (result->stride_ == 0) {
+    return Status::ERROR("Descriptor ring has a stride of zero bytes.");
+  }
+
+  // Descriptors are fetched in a single burst, so they must be aligned to their stride.
+  status = platform->DeviceMalloc(&result->address_, static_cast<size_t>(size) * result->stride_);
+  if (!status.ok()) {
+    return status;
+  }
+  if (result->address_ % result->stride_ != 0) {
+    return Status::ERROR("Descriptor ring at device address " + std::to_string(result->address_)
+                             + " is not aligned to its stride of " + std::to_string(result->stride_) + " bytes.");
+  }
+
+  status = result->Write(result->enable_, 0);
+  if (!status.ok()) return status;
+  status = result->Write(result->base_, result->address_);
+  if (!status.ok()) return status;
+  status = result->Write(result->size_reg_, size);
+  if (!status.ok()) return status;
+  status = result->Write(result->tail_reg_, 0);
+  if (!status.ok()) return status;
+  status = result->Write(result->enable_, 1);
+  if (!status.ok()) return status;
+
+  *out = result;
+  return Status::OK();
+}
+
+Status DescriptorRing::Make(std::shared_ptr<DescriptorRing> *out,
+                            const std::shared_ptr<Platform> &platform,
+                            const std::string &manifest_path,
+                            uint32_t size,
+                            uint64_t mmio_base) {
+  std::ifstream manifest(manifest_path);
+  if (!manifest.good()) {
+    return Status::ERROR("Could not open register manifest " + manifest_path);
+  }
+  std::vector<MmioRegister> registers;
+  auto status = ParseRegisterManifest(&manifest, &registers);
+  if (!status.ok()) {
+    return status;
+  }
+  return Make(out, platform, registers, size, mmio_base);
+}
+
+DescriptorRing::~DescriptorRing() {
+  if (address_ != D_NULLPTR) {
+    Write(enable_, 0);
+    platform_->DeviceFree(address_);
+  }
+}
+
+Status DescriptorRing::Write(const MmioRegister &reg, uint64_t value) {
+  for (uint32_t word = 0; 32 * word < reg.width; word++) {
+    auto status = platform_->WriteMMIO(mmio_base_ + reg.offset + word, static_cast<uint32_t>(value >> (32 * word)));
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status DescriptorRing::ReadHead(uint32_t *head) {
+  auto status = platform_->ReadMMIO(mmio_base_ + head_reg_.offset, head);
+  if (!status.ok()) {
+    return status;
+  }
+  if (*head >= size_) {
+    return Status::ERROR("Descriptor ring head " + std::to_string(*head) + " is out of range.");
+  }
+  return Status::OK();
+}
+
+Status DescriptorRing::Submit(Kernel *kernel, unsigned int poll_interval_usec) {
+  std::vector<uint32_t> regs;
+  kernel->GatherMetaData(&regs);
+  if (regs.size() * sizeof(uint32_t) > stride_) {
+    return Status::ERROR("Descriptor of " + std::to_string(regs.size()) + " registers does not fit in the stride of "
+                             + std::to_string(stride_) + " bytes of the descriptor ring.");
+  }
+
+  // Wait while the ring is full, i.e. while the next tail would equal the head.
+  auto next = (tail_ + 1) % size_;
+  while (true) {
+    uint32_t head = 0;
+    auto status = ReadHead(&head);
+    if (!status.ok()) {
+      return status;
+    }
+    if (head != next) {
+      break;
+    }
+    usleep(poll_interval_usec);
+  }
+
+  std::vector<uint8_t> desc(stride_, 0);
+  std::memcpy(desc.data(), regs.data(), regs.size() * sizeof(uint32_t));
+  auto status = platform_->CopyHostToDevice(desc.data(), address_ + static_cast<da_t>(tail_) * stride_, stride_);
+  if (!status.ok()) {
+    return status;
+  }
+  // Only bump the tail after the descriptor is in device memory.
+  tail_ = next;
+  return Write(tail_reg_, tail_);
+}
+
+Status DescriptorRing::Pending(uint32_t *pending) {
+  uint32_t head = 0;
+  auto status = ReadHead(&head);
+  if (!status.ok()) {
+    return status;
+  }
+  *pending = (tail_ + size_ - head) % size_;
+  return Status::OK();
+}
+
+Status DescriptorRing::Drain(unsigned int poll_interval_usec) {
+  while (true) {
+    uint32_t pending = 0;
+    auto status = Pending(&pending);
+    if (!status.ok()) {
+      return status;
+    }
+    if (pending == 0) {
+      return Status::OK();
+    }
+    usleep(poll_interval_usec);
+  }
+}
+
+}  // namespace fletcher
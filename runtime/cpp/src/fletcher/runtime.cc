@@ -0,0 +1,152 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fletcher/runtime.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fletcher/context.h"
+#include "fletcher/kernel.h"
+#include "fletcher/platform.h"
+
+struct FletcherPlatform {
+  std::shared_ptr<fletcher::Platform> platform;
+};
+
+struct FletcherContext {
+  std::shared_ptr<fletcher::Context> context;
+};
+
+struct FletcherKernel {
+  std::shared_ptr<fletcher::Kernel> kernel;
+};
+
+namespace {
+
+/// The message of the last error in this thread.
+thread_local std::string last_error;
+
+/// @brief Remember the message of a status and return its raw value.
+fstatus_t Return(const fletcher::Status &status) {
+  last_error = status.message;
+  return status.val;
+}
+
+/// @brief Return an error for a null handle.
+fstatus_t NullHandle() {
+  return Return(fletcher::Status::ERROR("Handle is NULL."));
+}
+
+}  // namespace
+
+extern "C" {
+
+const char *fletcherLastError(void) {
+  return last_error.c_str();
+}
+
+fstatus_t fletcherPlatformCreate(const char *name, fplatform_t *platform) {
+  std::shared_ptr<fletcher::Platform> result;
+  auto status = name != nullptr ? fletcher::Platform::Make(name, &result) : fletcher::Platform::Make(&result);
+  if (status.ok()) {
+    *platform = new FletcherPlatform{result};
+  }
+  return Return(status);
+}
+
+fstatus_t fletcherPlatformInit(fplatform_t platform, void *init_data) {
+  if (platform == nullptr) return NullHandle();
+  platform->platform->init_data = init_data;
+  return Return(platform->platform->Init());
+}
+
+void fletcherPlatformDestroy(fplatform_t platform) {
+  delete platform;
+}
+
+fstatus_t fletcherContextCreate(fplatform_t platform, fcontext_t *context) {
+  if (platform == nullptr) return NullHandle();
+  std::shared_ptr<fletcher::Context> result;
+  auto status = fletcher::Context::Make(&result, platform->platform);
+  if (status.ok()) {
+    *context = new FletcherContext{result};
+  }
+  return Return(status);
+}
+
+fstatus_t fletcherContextQueueArrowArray(fcontext_t context,
+                                         struct ArrowArray *array,
+                                         struct ArrowSchema *schema,
+                                         int mem_type) {
+  if (context == nullptr) return NullHandle();
+  auto type = mem_type == FLETCHER_MEM_CACHE ? fletcher::MemType::CACHE : fletcher::MemType::ANY;
+  return Return(context->context->QueueRecordBatch(array, schema, type));
+}
+
+fstatus_t fletcherContextEnable(fcontext_t context) {
+  if (context == nullptr) return NullHandle();
+  return Return(context->context->Enable());
+}
+
+fstatus_t fletcherContextExportArrowArray(fcontext_t context,
+                                          uint64_t index,
+                                          struct ArrowArray *array,
+                                          struct ArrowSchema *schema,
+                                          int64_t num_rows) {
+  if (context == nullptr) return NullHandle();
+  return Return(context->context->ExportRecordBatch(index, array, schema, num_rows));
+}
+
+void fletcherContextDestroy(fcontext_t context) {
+  delete context;
+}
+
+fstatus_t fletcherKernelCreate(fcontext_t context, uint64_t mmio_base, fkernel_t *kernel) {
+  if (context == nullptr) return NullHandle();
+  *kernel = new FletcherKernel{std::make_shared<fletcher::Kernel>(context->context, mmio_base)};
+  return Return(fletcher::Status::OK());
+}
+
+fstatus_t fletcherKernelReset(fkernel_t kernel) {
+  if (kernel == nullptr) return NullHandle();
+  return Return(kernel->kernel->Reset());
+}
+
+fstatus_t fletcherKernelWriteMetaData(fkernel_t kernel) {
+  if (kernel == nullptr) return NullHandle();
+  return Return(kernel->kernel->WriteMetaData());
+}
+
+fstatus_t fletcherKernelSetArguments(fkernel_t kernel, const uint32_t *arguments, uint64_t count) {
+  if (kernel == nullptr) return NullHandle();
+  return Return(kernel->kernel->SetArguments(std::vector<uint32_t>(arguments, arguments + count)));
+}
+
+fstatus_t fletcherKernelStart(fkernel_t kernel) {
+  if (kernel == nullptr) return NullHandle();
+  return Return(kernel->kernel->Start());
+}
+
+fstatus_t fletcherKernelWaitUntilDone(fkernel_t kernel, uint64_t poll_interval_usec) {
+  if (kernel == nullptr) return NullHandle();
+  return Return(kernel->kernel->PollUntilDoneInterval(static_cast<unsigned int>(poll_interval_usec)));
+}
+
+void fletcherKernelDestroy(fkernel_t kernel) {
+  delete kernel;
+}
+
+}  // extern "C"
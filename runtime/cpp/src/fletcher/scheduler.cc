@@ -0,0 +1,263 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/scheduler.h"
+
+#include <arrow/api.h>
+#include <fletcher/common.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+namespace fletcher {
+
+namespace {
+
+/// The estimated byte volume of the rows of a single column.
+struct ColumnCost {
+  /// The top-level offsets of a variable-length column, or nullptr for columns with a fixed number of bytes per row.
+  const int32_t *offsets = nullptr;
+  /// The number of bytes every row carries regardless of its number of child elements.
+  double bytes_per_row = 0.0;
+  /// The number of bytes of every child element.
+  double bytes_per_element = 0.0;
+};
+
+/// @brief Return the estimated number of bytes of the rows [0, row).
+double CumulativeCost(const std::vector<ColumnCost> &columns, int64_t row) {
+  double result = 0.0;
+  for (const auto &c : columns) {
+    result += c.bytes_per_row * static_cast<double>(row);
+    if (c.offsets != nullptr) {
+      result += c.bytes_per_element * static_cast<double>(c.offsets[row] - c.offsets[0]);
+    }
+  }
+  return result;
+}
+
+/// @brief Return the estimated byte volume of the rows of a column.
+ColumnCost EstimateCost(const FieldMetadata &field) {
+  ColumnCost result;
+  if (field.length == 0) {
+    return result;
+  }
+  auto id = field.type_->id();
+  bool variable = (id == arrow::Type::STRING) || (id == arrow::Type::BINARY) || (id == arrow::Type::LIST);
+  double row_bytes = 0.0;
+  double child_bytes = 0.0;
+  bool in_children = false;
+  for (const auto &b : field.buffers) {
+    if (b.implicit_) continue;
+    if (variable && !in_children && (b.desc_.back() == "offsets")) {
+      // The first offsets buffer holds the offsets of the rows. All buffers after it belong to child elements.
+      result.offsets = reinterpret_cast<const int32_t *>(b.raw_buffer_);
+      row_bytes += static_cast<double>(b.size_);
+      in_children = true;
+    } else if (in_children) {
+      child_bytes += static_cast<double>(b.size_);
+    } else {
+      row_bytes += static_cast<double>(b.size_);
+    }
+  }
+  result.bytes_per_row = row_bytes / static_cast<double>(field.length);
+  if (result.offsets != nullptr) {
+    auto elements = result.offsets[field.length] - result.offsets[0];
+    if (elements > 0) {
+      result.bytes_per_element = child_bytes / static_cast<double>(elements);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+Status SplitByBytes(const arrow::RecordBatch &batch, size_t num_ranges, std::vector<RowRange> *out) {
+  if (num_ranges == 0) {
+    return Status::ERROR("Cannot split RecordBatch into zero ranges.");
+  }
+  RecordBatchDescription desc;
+  RecordBatchAnalyzer analyzer(&desc);
+  if (!analyzer.Analyze(batch)) {
+    return Status::ERROR("Could not analyze RecordBatch.");
+  }
+  std::vector<ColumnCost> columns;
+  for (const auto &f : desc.fields) {
+    columns.push_back(EstimateCost(f));
+  }
+
+  auto num_rows = batch.num_rows();
+  auto total = CumulativeCost(columns, num_rows);
+  out->clear();
+  int64_t first = 0;
+  for (size_t i = 1; i <= num_ranges; i++) {
+    int64_t last = num_rows;
+    if (i < num_ranges) {
+      // Find the first row at which the cumulative cost reaches the target of this range. The cumulative cost is
+      // monotonic, so a binary search suffices.
+      auto target = total * static_cast<double>(i) / static_cast<double>(num_ranges);
+      int64_t lo = first;
+      int64_t hi = num_rows;
+      while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        if (CumulativeCost(columns, mid) < target) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      last = lo;
+    }
+    out->push_back({static_cast<int32_t>(first), static_cast<int32_t>(last)});
+    first = last;
+  }
+  return Status::OK();
+}
+
+Scheduler::Scheduler(std::shared_ptr<Context> context, size_t num_instances, uint64_t window_regs)
+    : context_(std::move(context)) {
+  for (size_t i = 0; i < num_instances; i++) {
+    kernels_.push_back(std::make_shared<Kernel>(context_, i * window_regs));
+    ranges_.push_back({0, 0});
+  }
+}
+
+Status Scheduler::Make(std::shared_ptr<Scheduler> *out,
+                       const std::shared_ptr<Context> &context,
+                       size_t num_instances,
+                       uint64_t window_regs) {
+  if (num_instances == 0) {
+    return Status::ERROR("Scheduler requires at least one kernel instance.");
+  }
+  *out = std::make_shared<Scheduler>(context, num_instances, window_regs);
+  return Status::OK();
+}
+
+Status Scheduler::Reset() {
+  for (const auto &k : kernels_) {
+    auto status = k->Reset();
+    if (!status.ok()) return status;
+  }
+  return Status::OK();
+}
+
+Status Scheduler::WriteMetaData() {
+  for (const auto &k : kernels_) {
+    auto status = k->WriteMetaData();
+    if (!status.ok()) return status;
+  }
+  return Status::OK();
+}
+
+Status Scheduler::SetArguments(const std::vector<uint32_t> &arguments) {
+  for (const auto &k : kernels_) {
+    auto status = k->SetArguments(arguments);
+    if (!status.ok()) return status;
+  }
+  return Status::OK();
+}
+
+Status Scheduler::Partition(size_t recordbatch_index) {
+  if (recordbatch_index >= context_->num_recordbatches()) {
+    return Status::ERROR("RecordBatch index " + std::to_string(recordbatch_index) + " out of bounds.");
+  }
+  auto num_rows = static_cast<int32_t>(context_->recordbatch(recordbatch_index)->num_rows());
+  auto n = static_cast<int32_t>(kernels_.size());
+  // Spread the remainder over the first instances.
+  std::vector<RowRange> ranges;
+  int32_t first = 0;
+  for (int32_t i = 0; i < n; i++) {
+    int32_t size = num_rows / n + (i < num_rows % n ? 1 : 0);
+    ranges.push_back({first, first + size});
+    first += size;
+  }
+  return SetRanges(recordbatch_index, ranges);
+}
+
+Status Scheduler::PartitionByBytes(size_t recordbatch_index) {
+  if (recordbatch_index >= context_->num_recordbatches()) {
+    return Status::ERROR("RecordBatch index " + std::to_string(recordbatch_index) + " out of bounds.");
+  }
+  std::vector<RowRange> ranges;
+  auto status = SplitByBytes(*context_->recordbatch(recordbatch_index), kernels_.size(), &ranges);
+  if (!status.ok()) return status;
+  return SetRanges(recordbatch_index, ranges);
+}
+
+Status Scheduler::Dispatch(size_t recordbatch_index, const std::vector<RowRange> &ranges) {
+  for (size_t launch = 0; launch < ranges.size(); launch += kernels_.size()) {
+    // Instances without a range in the last launch stay idle.
+    std::vector<RowRange> launch_ranges(kernels_.size(), RowRange{0, 0});
+    for (size_t i = 0; (i < kernels_.size()) && (launch + i < ranges.size()); i++) {
+      launch_ranges[i] = ranges[launch + i];
+    }
+    auto status = SetRanges(recordbatch_index, launch_ranges);
+    if (!status.ok()) return status;
+    status = Start();
+    if (!status.ok()) return status;
+    status = WaitUntilDone();
+    if (!status.ok()) return status;
+  }
+  return Status::OK();
+}
+
+Status Scheduler::SetRanges(size_t recordbatch_index, const std::vector<RowRange> &ranges) {
+  if (ranges.size() != kernels_.size()) {
+    return Status::ERROR("Expected " + std::to_string(kernels_.size()) + " row ranges, got "
+                             + std::to_string(ranges.size()) + ".");
+  }
+  // Metadata must be written first, because it resets the ranges to span the whole RecordBatch.
+  auto status = WriteMetaData();
+  if (!status.ok()) return status;
+  for (size_t i = 0; i < kernels_.size(); i++) {
+    ranges_[i] = ranges[i];
+    if (ranges[i].size() > 0) {
+      status = kernels_[i]->SetRange(recordbatch_index, ranges[i].first, ranges[i].last);
+      if (!status.ok()) return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status Scheduler::Start() {
+  FLETCHER_LOG(DEBUG, "Starting " << kernels_.size() << " kernel instance(s).");
+  for (size_t i = 0; i < kernels_.size(); i++) {
+    if (ranges_[i].size() > 0) {
+      auto status = kernels_[i]->Start();
+      if (!status.ok()) return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status Scheduler::WaitUntilDone(unsigned int spin_usec, unsigned int poll_interval_usec) {
+  // The done flags remain asserted, so waiting for the instances one after the other is sufficient.
+  for (size_t i = 0; i < kernels_.size(); i++) {
+    if (ranges_[i].size() > 0) {
+      auto status = kernels_[i]->WaitUntilDone(spin_usec, poll_interval_usec);
+      if (!status.ok()) return status;
+    }
+  }
+  return Status::OK();
+}
+
+Status Scheduler::Run(size_t recordbatch_index) {
+  auto status = Partition(recordbatch_index);
+  if (!status.ok()) return status;
+  status = Start();
+  if (!status.ok()) return status;
+  return WaitUntilDone();
+}
+
+}  // namespace fletcher
@@ -0,0 +1,166 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/sink.h"
+
+#include <arrow/ipc/api.h>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace fletcher {
+
+IpcSink::IpcSink(std::shared_ptr<arrow::ipc::RecordBatchWriter> writer, size_t capacity)
+    : writer_(std::move(writer)), capacity_(capacity) {
+  thread_ = std::thread(&IpcSink::Serialize, this);
+}
+
+IpcSink::~IpcSink() {
+  Close();
+}
+
+Status IpcSink::Make(std::shared_ptr<IpcSink> *out,
+                     const std::shared_ptr<arrow::ipc::RecordBatchWriter> &writer,
+                     size_t capacity) {
+  if (writer == nullptr) {
+    return Status::ERROR("IpcSink requires an IPC writer.");
+  }
+  if (capacity == 0) {
+    return Status::ERROR("IpcSink requires a capacity of at least one RecordBatch.");
+  }
+  *out = std::make_shared<IpcSink>(writer, capacity);
+  return Status::OK();
+}
+
+Status IpcSink::MakeStream(std::shared_ptr<IpcSink> *out,
+                           const std::shared_ptr<arrow::io::OutputStream> &sink,
+                           const std::shared_ptr<arrow::Schema> &schema,
+                           size_t capacity) {
+  auto writer = arrow::ipc::MakeStreamWriter(sink, schema);
+  if (!writer.ok()) {
+    return Status::ERROR("Could not create IPC stream writer: " + writer.status().ToString());
+  }
+  return Make(out, writer.ValueOrDie(), capacity);
+}
+
+Status IpcSink::MakeFile(std::shared_ptr<IpcSink> *out,
+                         const std::shared_ptr<arrow::io::OutputStream> &sink,
+                         const std::shared_ptr<arrow::Schema> &schema,
+                         size_t capacity) {
+  auto writer = arrow::ipc::MakeFileWriter(sink, schema);
+  if (!writer.ok()) {
+    return Status::ERROR("Could not create IPC file writer: " + writer.status().ToString());
+  }
+  return Make(out, writer.ValueOrDie(), capacity);
+}
+
+void IpcSink::Serialize() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    queued_cv_.wait(lock, [this]() { return closed_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+    // The RecordBatch stays queued while it is serialized, such that Flush() waits for it.
+    auto batch = pending_.front();
+    bool failed = !status_.ok();
+    lock.unlock();
+
+    // After a failure, the stream is broken, so the remaining RecordBatches are dropped.
+    arrow::Status result;
+    if (!failed) {
+      result = writer_->WriteRecordBatch(*batch);
+    }
+
+    lock.lock();
+    if (!failed) {
+      if (result.ok()) {
+        num_written_++;
+      } else {
+        status_ = Status::ERROR("Could not serialize RecordBatch: " + result.ToString());
+      }
+    }
+    pending_.pop_front();
+    written_cv_.notify_all();
+  }
+}
+
+Status IpcSink::WaitForCapacity() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (closed_) {
+    return Status::ERROR("IpcSink is closed.");
+  }
+  written_cv_.wait(lock, [this]() { return (pending_.size() < capacity_) || !status_.ok(); });
+  return status_;
+}
+
+Status IpcSink::Write(Context *context, size_t index, int64_t num_rows) {
+  // Wait before reading back, such that the readback does not run ahead of the serialization unbounded.
+  auto status = WaitForCapacity();
+  if (!status.ok()) {
+    return status;
+  }
+  std::shared_ptr<arrow::RecordBatch> batch;
+  status = context->ReadbackRecordBatch(index, &batch, num_rows);
+  if (!status.ok()) {
+    return status;
+  }
+  return Write(batch);
+}
+
+Status IpcSink::Write(const std::shared_ptr<arrow::RecordBatch> &batch) {
+  if (batch == nullptr) {
+    return Status::ERROR("RecordBatch is nullptr.");
+  }
+  auto status = WaitForCapacity();
+  if (!status.ok()) {
+    return status;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(batch);
+  }
+  queued_cv_.notify_all();
+  return Status::OK();
+}
+
+Status IpcSink::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  written_cv_.wait(lock, [this]() { return pending_.empty(); });
+  return status_;
+}
+
+Status IpcSink::Close() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    queued_cv_.notify_all();
+    // The serializer thread writes the pending RecordBatches before it returns.
+    thread_.join();
+    auto result = writer_->Close();
+    if (!result.ok() && status_.ok()) {
+      status_ = Status::ERROR("Could not close IPC writer: " + result.ToString());
+    }
+  }
+  return status_;
+}
+
+size_t IpcSink::num_written() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_written_;
+}
+
+}  // namespace fletcher
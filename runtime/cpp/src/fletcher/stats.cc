@@ -0,0 +1,170 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/stats.h"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "fletcher/trace.h"
+
+namespace fletcher {
+
+constexpr size_t Histogram::kNumBuckets;
+
+std::string ToString(Phase phase) {
+  switch (phase) {
+    case Phase::QUEUE: return "queue";
+    case Phase::ANALYZE: return "analyze";
+    case Phase::ALLOC: return "alloc";
+    case Phase::COPY: return "copy";
+    case Phase::PREPARE: return "prepare";
+    case Phase::METADATA: return "metadata";
+    case Phase::START: return "start";
+    case Phase::COMPLETION: return "completion";
+  }
+  return "unknown";
+}
+
+/// @brief Return the bucket of a duration, i.e. the number of bits required to represent it.
+static inline size_t BucketOf(uint64_t nanoseconds) {
+  size_t bucket = 0;
+  while ((nanoseconds != 0) && (bucket < Histogram::kNumBuckets - 1)) {
+    nanoseconds >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+Histogram::Histogram() {
+  for (auto &b : buckets_) {
+    b.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::Record(uint64_t nanoseconds) {
+  buckets_[BucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  total_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  auto current = max_.load(std::memory_order_relaxed);
+  while ((nanoseconds > current) && !max_.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+uint64_t Histogram::Percentile(double p) const {
+  auto n = count();
+  if (n == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(p * static_cast<double>(n)));
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      // Bucket i holds durations below 2^i, but never report more than the maximum.
+      uint64_t upper = (i == 0) ? 0 : ((i >= 64) ? UINT64_MAX : (1ull << i) - 1);
+      return upper < max() ? upper : max();
+    }
+  }
+  return max();
+}
+
+void Histogram::Reset() {
+  for (auto &b : buckets_) {
+    b.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  total_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+void Histogram::Merge(const Histogram &other) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  count_.fetch_add(other.count(), std::memory_order_relaxed);
+  total_.fetch_add(other.total(), std::memory_order_relaxed);
+  auto other_max = other.max();
+  auto current = max_.load(std::memory_order_relaxed);
+  while ((other_max > current) && !max_.compare_exchange_weak(current, other_max, std::memory_order_relaxed)) {}
+}
+
+std::string Stats::ToString() const {
+  std::stringstream ss;
+  ss << std::setw(12) << "phase" << std::setw(10) << "count" << std::setw(14) << "mean [ns]"
+     << std::setw(14) << "p50 [ns]" << std::setw(14) << "p99 [ns]" << std::setw(14) << "max [ns]" << std::endl;
+  for (size_t i = 0; i < kNumPhases; i++) {
+    const auto &p = phases[i];
+    ss << std::setw(12) << ::fletcher::ToString(static_cast<Phase>(i)) << std::setw(10) << p.count
+       << std::setw(14) << std::fixed << std::setprecision(0) << p.mean
+       << std::setw(14) << p.p50 << std::setw(14) << p.p99 << std::setw(14) << p.max << std::endl;
+  }
+  return ss.str();
+}
+
+std::string Stats::ToJSON() const {
+  std::stringstream ss;
+  ss << "{";
+  for (size_t i = 0; i < kNumPhases; i++) {
+    const auto &p = phases[i];
+    ss << (i > 0 ? "," : "") << "\"" << ::fletcher::ToString(static_cast<Phase>(i)) << "\":{\"count\":" << p.count
+       << ",\"mean_ns\":" << std::fixed << std::setprecision(1) << p.mean << ",\"p50_ns\":" << p.p50
+       << ",\"p99_ns\":" << p.p99 << ",\"max_ns\":" << p.max << "}";
+  }
+  ss << "}";
+  return ss.str();
+}
+
+Stats Instrumentation::GetStats() const {
+  Stats result;
+  for (size_t i = 0; i < kNumPhases; i++) {
+    const auto &h = histograms_[i];
+    auto &p = result.phases[i];
+    p.count = h.count();
+    p.mean = p.count > 0 ? static_cast<double>(h.total()) / static_cast<double>(p.count) : 0.0;
+    p.p50 = h.Percentile(0.5);
+    p.p99 = h.Percentile(0.99);
+    p.max = h.max();
+  }
+  return result;
+}
+
+void Instrumentation::Reset() {
+  for (auto &h : histograms_) {
+    h.Reset();
+  }
+}
+
+void Instrumentation::Merge(const Instrumentation &other) {
+  for (size_t i = 0; i < kNumPhases; i++) {
+    histograms_[i].Merge(other.histograms_[i]);
+  }
+}
+
+void Instrumentation::SetTracer(std::shared_ptr<Tracer> tracer) {
+  tracer_.store(tracer.get(), std::memory_order_relaxed);
+  tracer_owner_ = std::move(tracer);
+}
+
+void Instrumentation::Trace(Phase phase, const Timer &timer) {
+  auto tracer = tracer_.load(std::memory_order_relaxed);
+  if (tracer != nullptr) {
+    tracer->Record(phase, timer);
+  }
+}
+
+}  // namespace fletcher
@@ -0,0 +1,269 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/streaming.h"
+
+#include <arrow/api.h>
+#include <fletcher/common.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "fletcher/numa.h"
+
+namespace fletcher {
+
+StreamingContext::StreamingContext(std::shared_ptr<Platform> platform, size_t num_slots)
+    : Context(std::move(platform)), num_slots_(num_slots) {
+  transfer_thread_ = std::thread(&StreamingContext::TransferSlots, this);
+}
+
+StreamingContext::~StreamingContext() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  transfer_cv_.notify_all();
+  if (transfer_thread_.joinable()) {
+    transfer_thread_.join();
+  }
+  // Free the buffers of slots that were transferred but never became active. The buffers of the active slot are freed
+  // by the Context destructor.
+  for (const auto &slot : slots_) {
+    auto status = FreeBuffers(slot->buffers);
+    if (!status.ok()) {
+      FLETCHER_LOG(ERROR, "Could not properly free streaming context slot. Device memory may be corrupted. "
+                          "Status: " + status.message);
+    }
+  }
+}
+
+Status StreamingContext::Make(std::shared_ptr<StreamingContext> *context,
+                              const std::shared_ptr<Platform> &platform,
+                              size_t num_slots) {
+  if (num_slots == 0) {
+    return Status::ERROR("StreamingContext requires at least one slot.");
+  }
+  *context = std::make_shared<StreamingContext>(platform, num_slots);
+  return Status::OK();
+}
+
+Status StreamingContext::Make(std::shared_ptr<StreamingContext> *context,
+                              const std::shared_ptr<Platform> &platform,
+                              size_t num_slots,
+                              const std::shared_ptr<DeviceMemoryPool> &pool) {
+  if ((pool != nullptr) && (pool->platform() != platform)) {
+    return Status::ERROR("DeviceMemoryPool was created for a different platform.");
+  }
+  auto status = Make(context, platform, num_slots);
+  if (!status.ok()) {
+    return status;
+  }
+  (*context)->pool_ = pool;
+  return Status::OK();
+}
+
+Status StreamingContext::Push(const std::shared_ptr<arrow::RecordBatch> &record_batch, MemType mem_type) {
+  if (record_batch == nullptr) {
+    return Status::ERROR("RecordBatch is nullptr.");
+  }
+  if ((mem_type == MemType::ANY) && platform_->profile().cache) {
+    mem_type = MemType::CACHE;
+  }
+
+  auto slot = std::make_shared<Slot>();
+  // Split the fields of which the children are read in parallel, like fletchgen does. This does not copy any data.
+  if (!SplitParallelFields(record_batch, &slot->batch)) {
+    return Status::ERROR("Could not split the fields with parallel metadata of the RecordBatch.");
+  }
+  slot->mem_type = mem_type;
+  slot->transfer_status = slot->transferred.get_future();
+  auto status = Describe(*slot->batch, &slot->desc);
+  if (!status.ok()) {
+    return status;
+  }
+  // Arrange the columns by name in the order of the buffer address registers, if their layout is known.
+  if (buffer_layout_.count(slot->desc.name) > 0) {
+    status = ArrangeFields(&slot->batch, &slot->desc);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // The active slot, if any, also occupies device memory.
+    release_cv_.wait(lock, [this] {
+      return slots_.size() + (host_batches_.empty() ? 0 : 1) < num_slots_;
+    });
+    slots_.push_back(slot);
+  }
+  transfer_cv_.notify_one();
+  return Status::OK();
+}
+
+Status StreamingContext::PushFromFile(const std::string &file_name, MemType mem_type) {
+  Status status = Status::OK();
+  bool read = MapRecordBatchesFromFile(file_name, [&](const std::shared_ptr<arrow::RecordBatch> &rb) {
+    status = Push(rb, mem_type);
+    return status.ok();
+  });
+  if (!status.ok()) {
+    return status;
+  }
+  if (!read) {
+    return Status::ERROR("Could not read RecordBatches from " + file_name);
+  }
+  return Status::OK();
+}
+
+Status StreamingContext::Rotate() {
+  std::shared_ptr<Slot> next;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Release the active slot.
+    auto status = FreeBuffers(device_buffers_);
+    device_buffers_.clear();
+    for (size_t i = 0; i < host_batches_.size(); i++) {
+      Recycle(*host_batches_[i]->schema(), std::move(host_batch_desc_[i]));
+    }
+    host_batches_.clear();
+    host_batch_desc_.clear();
+    host_batch_memtype_.clear();
+    if (!status.ok()) {
+      return status;
+    }
+    if (slots_.empty()) {
+      return Status::ERROR("No RecordBatch was pushed to the StreamingContext.");
+    }
+    next = slots_.front();
+  }
+  release_cv_.notify_all();
+
+  // Wait for the transfer to finish without holding the lock.
+  auto status = next->transfer_status.get();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  slots_.pop_front();
+  next_transfer_--;
+  // Make the slot active. Also on failure, such that any partially enabled buffers are freed eventually.
+  host_batches_.push_back(next->batch);
+  host_batch_desc_.push_back(std::move(next->desc));
+  host_batch_memtype_.push_back(next->mem_type);
+  device_buffers_ = std::move(next->buffers);
+  return status;
+}
+
+Status StreamingContext::Run(arrow::RecordBatchReader *reader,
+                             Kernel *kernel,
+                             std::shared_ptr<arrow::Array> *results,
+                             MemType mem_type,
+                             const BatchCallback &callback) {
+  if ((reader == nullptr) || (kernel == nullptr)) {
+    return Status::ERROR("Reader or kernel is nullptr.");
+  }
+  if (kernel->context().get() != this) {
+    return Status::ERROR("Kernel was not constructed on this StreamingContext.");
+  }
+  if (num_slots_ < 2) {
+    return Status::ERROR("StreamingContext requires at least two slots to run a reader.");
+  }
+  if (num_pending() != 0) {
+    return Status::ERROR("StreamingContext still holds pushed RecordBatches.");
+  }
+
+  const auto &profile = platform()->profile();
+  arrow::UInt64Builder builder;
+  std::shared_ptr<arrow::RecordBatch> next;
+  auto read = reader->ReadNext(&next);
+  if (!read.ok()) {
+    return Status::ERROR("Could not read RecordBatch: " + read.ToString());
+  }
+  if (next != nullptr) {
+    auto status = Push(next, mem_type);
+    if (!status.ok()) return status;
+  }
+
+  for (size_t i = 0; next != nullptr; i++) {
+    auto status = Rotate();
+    if (!status.ok()) return status;
+
+    // Push the next RecordBatch, such that it is transferred while the kernel processes the active one.
+    read = reader->ReadNext(&next);
+    if (!read.ok()) {
+      return Status::ERROR("Could not read RecordBatch: " + read.ToString());
+    }
+    if (next != nullptr) {
+      status = Push(next, mem_type);
+      if (!status.ok()) return status;
+    }
+
+    status = kernel->UpdateMetaData();
+    if (!status.ok()) return status;
+    status = kernel->Start();
+    if (!status.ok()) return status;
+    status = kernel->WaitUntilDone(profile.spin_usec, profile.poll_interval_usec);
+    if (!status.ok()) return status;
+
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    status = kernel->GetReturn(&lo, &hi);
+    if (!status.ok()) return status;
+    auto append = builder.Append((static_cast<uint64_t>(hi) << 32) | lo);
+    if (!append.ok()) {
+      return Status::ERROR("Could not append kernel result: " + append.ToString());
+    }
+
+    if (callback) {
+      status = callback(i, kernel);
+      if (!status.ok()) return status;
+    }
+  }
+
+  if (results != nullptr) {
+    auto finish = builder.Finish(results);
+    if (!finish.ok()) {
+      return Status::ERROR("Could not finish kernel results: " + finish.ToString());
+    }
+  }
+  return Status::OK();
+}
+
+size_t StreamingContext::num_pending() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return slots_.size();
+}
+
+void StreamingContext::TransferSlots() {
+  PinThreadToNode(platform_->numa_node());
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    transfer_cv_.wait(lock, [this] { return stop_ || (next_transfer_ < slots_.size()); });
+    if (stop_) {
+      break;
+    }
+    auto slot = slots_[next_transfer_];
+    lock.unlock();
+
+    FLETCHER_LOG(DEBUG, "Transferring RecordBatch " << slot->desc.name << " to device.");
+    auto status = EnableBuffers(slot->desc, slot->mem_type, &slot->buffers, slot->batch);
+
+    lock.lock();
+    next_transfer_++;
+    slot->transferred.set_value(status);
+  }
+}
+
+}  // namespace fletcher
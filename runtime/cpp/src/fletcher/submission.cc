@@ -0,0 +1,218 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/submission.h"
+
+#include <fletcher/common.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "fletcher/numa.h"
+
+namespace fletcher {
+
+SubmissionQueue::SubmissionQueue(std::shared_ptr<Platform> platform, uint64_t mmio_base)
+    : platform_(std::move(platform)), mmio_base_(mmio_base) {
+  drain_thread_ = std::thread(&SubmissionQueue::Drain, this);
+}
+
+SubmissionQueue::~SubmissionQueue() {
+  stop_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_cv_.notify_one();
+  if (drain_thread_.joinable()) {
+    drain_thread_.join();
+  }
+}
+
+Status SubmissionQueue::Make(std::shared_ptr<SubmissionQueue> *out,
+                             const std::shared_ptr<Platform> &platform,
+                             uint64_t mmio_base) {
+  if (platform == nullptr) {
+    return Status::ERROR("Platform is nullptr.");
+  }
+  *out = std::make_shared<SubmissionQueue>(platform, mmio_base);
+  return Status::OK();
+}
+
+Status SubmissionQueue::Submit(const std::shared_ptr<Context> &context,
+                               LaunchFunction launch,
+                               std::shared_future<Status> *completion,
+                               Priority priority,
+                               int64_t chunk_rows) {
+  if (context == nullptr) {
+    return Status::ERROR("Context is nullptr.");
+  }
+  if (context->platform() != platform_) {
+    return Status::ERROR("Context was created on a different platform than the SubmissionQueue.");
+  }
+  if (static_cast<size_t>(priority) >= lanes_.size()) {
+    return Status::ERROR("Invalid priority class.");
+  }
+  if (chunk_rows < 0) {
+    return Status::ERROR("Number of rows of a chunk must not be negative.");
+  }
+  int64_t num_rows = 0;
+  if (chunk_rows > 0) {
+    for (size_t i = 0; i < context->num_recordbatches(); i++) {
+      auto rows = context->recordbatch(i)->num_rows();
+      if ((i > 0) && (rows != num_rows)) {
+        return Status::ERROR("Chunked launches require all RecordBatches of the Context to have the same number of "
+                             "rows.");
+      }
+      num_rows = rows;
+    }
+  }
+  if (stop_.load()) {
+    return Status::ERROR("SubmissionQueue is stopping.");
+  }
+  auto node = new Node;
+  node->context = context;
+  node->launch = std::move(launch);
+  // Launches that fit in a single chunk are launched over the full range of the RecordBatches.
+  node->chunk_rows = num_rows > chunk_rows ? chunk_rows : 0;
+  node->num_rows = num_rows;
+  if (completion != nullptr) {
+    *completion = node->promise.get_future().share();
+  }
+  num_pending_++;
+  Push(&lanes_[static_cast<size_t>(priority)], node);
+  // Only take the mutex if the drain thread may be waiting, such that producers do not contend while it is busy.
+  if (sleeping_.load()) {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_cv_.notify_one();
+  }
+  return Status::OK();
+}
+
+void SubmissionQueue::Push(Lane *lane, Node *node) {
+  node->next.store(nullptr, std::memory_order_relaxed);
+  auto prev = lane->head.exchange(node);
+  // Between the exchange and this store, the queue is not linked up to the new node yet. Pop() then returns nullptr.
+  prev->next.store(node, std::memory_order_release);
+}
+
+SubmissionQueue::Node *SubmissionQueue::Pop(Lane *lane) {
+  auto tail = lane->tail;
+  auto next = tail->next.load(std::memory_order_acquire);
+  if (tail == &lane->stub) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    lane->tail = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    lane->tail = next;
+    return tail;
+  }
+  if (tail != lane->head.load()) {
+    // A producer is pushing.
+    return nullptr;
+  }
+  // Put the stub back behind the last node, such that the last node can be removed.
+  Push(lane, &lane->stub);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    lane->tail = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+Status SubmissionQueue::Perform(Node *node, bool *complete) {
+  *complete = true;
+  if ((kernel_ == nullptr) || (kernel_->context() != node->context)) {
+    kernel_ = std::make_shared<Kernel>(node->context, mmio_base_);
+    kernel_->index_width = index_width;
+    kernel_->projection = projection;
+    kernel_->all_valid = all_valid;
+    kernel_->mmio64 = mmio64;
+  }
+  // This also restores the full range of the RecordBatches after a chunk of another launch in the same Context.
+  auto status = kernel_->UpdateMetaData();
+  if (!status.ok()) return status;
+  if (node->chunk_rows > 0) {
+    auto first = node->next_row;
+    auto last = std::min(first + node->chunk_rows, node->num_rows);
+    for (size_t i = 0; i < node->context->num_recordbatches(); i++) {
+      status = kernel_->SetRange(i, first, last);
+      if (!status.ok()) return status;
+    }
+    node->next_row = last;
+    *complete = last == node->num_rows;
+  }
+  if (node->launch) {
+    return node->launch(kernel_.get());
+  }
+  status = kernel_->Start();
+  if (!status.ok()) return status;
+  const auto &profile = kernel_->context()->platform()->profile();
+  return kernel_->WaitUntilDone(profile.spin_usec, profile.poll_interval_usec);
+}
+
+void SubmissionQueue::Drain() {
+  PinThreadToNode(platform_->numa_node());
+  auto empty = [this]() {
+    return std::all_of(lanes_.begin(), lanes_.end(), [](const Lane &lane) { return lane.empty(); });
+  };
+  while (true) {
+    // Take the next launch of the highest class that has one, continuing a chunked launch before popping a new one.
+    Lane *lane = nullptr;
+    Node *node = nullptr;
+    for (auto &l : lanes_) {
+      node = (l.partial != nullptr) ? l.partial : Pop(&l);
+      if (node != nullptr) {
+        lane = &l;
+        break;
+      }
+    }
+    if (node != nullptr) {
+      bool complete = true;
+      auto status = Perform(node, &complete);
+      if (status.ok() && !complete) {
+        // Check the higher classes again before the next chunk.
+        lane->partial = node;
+        continue;
+      }
+      lane->partial = nullptr;
+      node->promise.set_value(status);
+      num_pending_--;
+      delete node;
+      continue;
+    }
+    if (!empty()) {
+      // A producer has not finished pushing yet.
+      std::this_thread::yield();
+      continue;
+    }
+    if (stop_.load()) {
+      break;
+    }
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    sleeping_.store(true);
+    wake_cv_.wait(lock, [&]() { return stop_.load() || !empty(); });
+    sleeping_.store(false);
+  }
+  // Release the Context of the last launch.
+  kernel_.reset();
+}
+
+}  // namespace fletcher
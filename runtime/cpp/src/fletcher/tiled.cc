@@ -0,0 +1,228 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/tiled.h"
+
+#include <arrow/api.h>
+#include <fletcher/common.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+namespace fletcher {
+
+constexpr int64_t TiledContext::kTileAlignment;
+
+/// @brief Return the region of a bitmap that holds the bits [lo, hi).
+static inline std::pair<int64_t, int64_t> BitRegion(int64_t lo, int64_t hi) {
+  return {lo / 8, (hi + 7) / 8 - lo / 8};
+}
+
+TiledContext::TiledContext(std::shared_ptr<Platform> platform, int64_t tile_bytes)
+    : Context(std::move(platform)), tile_bytes_(tile_bytes) {}
+
+TiledContext::~TiledContext() {
+  // The device buffers point into the tile memory and were not allocated separately, so only the tile memory is freed.
+  if (tile_memory_ != D_NULLPTR) {
+    auto status = platform_->DeviceFree(tile_memory_);
+    if (!status.ok()) {
+      FLETCHER_LOG(ERROR, "Could not free tile memory. Status: " + status.message);
+    }
+  }
+}
+
+Status TiledContext::Make(std::shared_ptr<TiledContext> *context,
+                          const std::shared_ptr<Platform> &platform,
+                          int64_t tile_bytes) {
+  if (tile_bytes <= 0) {
+    return Status::ERROR("Tile size must be positive.");
+  }
+  auto result = std::make_shared<TiledContext>(platform, tile_bytes);
+  auto status = platform->DeviceMalloc(&result->tile_memory_, static_cast<size_t>(tile_bytes));
+  if (!status.ok()) {
+    return status;
+  }
+  *context = result;
+  return Status::OK();
+}
+
+Status TiledContext::Regions(int64_t first, int64_t last, std::vector<Region> *out) const {
+  out->clear();
+  for (const auto &f : host_batch_desc_[0].fields) {
+    auto id = f.type_->id();
+    auto values_type = (id == arrow::Type::LIST) ? f.type_->field(0)->type() : f.type_;
+    bool bytes = (id == arrow::Type::STRING) || (id == arrow::Type::BINARY);
+    auto fixed = std::dynamic_pointer_cast<arrow::FixedWidthType>(values_type);
+    if (!bytes && (fixed == nullptr)) {
+      return Status::ERROR("Tiled execution does not support type " + f.type_->ToString());
+    }
+    // The index range at the current level of the field. Offsets buffers determine the range of the next level.
+    int64_t lo = first;
+    int64_t hi = last;
+    for (const auto &b : f.buffers) {
+      Region r = {0, 0, false};
+      if (b.implicit_) {
+        out->push_back(r);
+        continue;
+      }
+      const auto &name = b.desc_.back();
+      // Regions are relative to the start of the buffer as addressed by the kernel. The description may only hold the
+      // part of the buffer covered by a slice, starting device_offset_ bytes after that.
+      auto origin = b.raw_buffer_ - b.device_offset_;
+      auto limit = b.device_offset_ + b.size_;
+      std::pair<int64_t, int64_t> region;
+      if (name == "validity") {
+        region = BitRegion(lo, hi);
+      } else if (name == "offsets") {
+        if (limit < static_cast<int64_t>((hi + 1) * sizeof(int32_t))) {
+          return Status::ERROR("Offsets buffer of field " + ToString(b.desc_) + " is too small.");
+        }
+        region = {lo * static_cast<int64_t>(sizeof(int32_t)), (hi - lo + 1) * static_cast<int64_t>(sizeof(int32_t))};
+        auto offsets = reinterpret_cast<const int32_t *>(origin);
+        lo = offsets[lo];
+        hi = offsets[hi];
+      } else if (name == "values") {
+        int64_t bits = bytes ? 8 : fixed->bit_width();
+        if (bits % 8 == 0) {
+          region = {lo * bits / 8, (hi - lo) * bits / 8};
+        } else {
+          region = BitRegion(lo, hi);
+        }
+      } else {
+        return Status::ERROR("Tiled execution does not support buffer " + ToString(b.desc_));
+      }
+      r.offset = region.first;
+      r.size = std::min(region.second, limit - region.first);
+      r.used = true;
+      out->push_back(r);
+    }
+  }
+  return Status::OK();
+}
+
+int64_t TiledContext::Footprint(const std::vector<Region> &regions) {
+  int64_t result = 0;
+  for (const auto &r : regions) {
+    if (r.used) {
+      result += (r.size + kTileAlignment - 1) / kTileAlignment * kTileAlignment;
+    }
+  }
+  return result;
+}
+
+Status TiledContext::Plan(std::vector<RowRange> *tiles) {
+  if (host_batches_.size() != 1) {
+    return Status::ERROR("TiledContext requires exactly one queued RecordBatch.");
+  }
+  auto num_rows = host_batches_[0]->num_rows();
+  std::vector<Region> regions;
+  tiles->clear();
+  int64_t first = 0;
+  while (first < num_rows) {
+    // Find the largest tile starting at the first row of which the buffers fit. The footprint grows with the number
+    // of rows, so a binary search suffices.
+    int64_t lo = first;
+    int64_t hi = num_rows;
+    while (lo < hi) {
+      auto mid = lo + (hi - lo + 1) / 2;
+      auto status = Regions(first, mid, &regions);
+      if (!status.ok()) return status;
+      if (Footprint(regions) <= tile_bytes_) {
+        lo = mid;
+      } else {
+        hi = mid - 1;
+      }
+    }
+    if (lo == first) {
+      return Status::ERROR("Row " + std::to_string(first) + " does not fit in a tile of "
+                               + std::to_string(tile_bytes_) + " bytes.");
+    }
+    tiles->push_back({static_cast<int32_t>(first), static_cast<int32_t>(lo)});
+    first = lo;
+  }
+  return Status::OK();
+}
+
+Status TiledContext::LoadTile(const RowRange &tile) {
+  std::vector<Region> regions;
+  auto status = Regions(tile.first, tile.last, &regions);
+  if (!status.ok()) return status;
+  if (Footprint(regions) > tile_bytes_) {
+    return Status::ERROR("Tile does not fit in the device memory of the context.");
+  }
+
+  const auto &desc = host_batch_desc_[0];
+  device_buffers_.clear();
+  std::vector<fiov_t> iov;
+  int64_t placement = 0;
+  size_t i = 0;
+  for (const auto &f : desc.fields) {
+    for (const auto &b : f.buffers) {
+      const auto &r = regions[i++];
+      DeviceBuffer device_buf(b.raw_buffer_, b.size_, MemType::CACHE, desc.mode);
+      if (r.used) {
+        auto device_region = tile_memory_ + static_cast<da_t>(placement);
+        // Offset the address, such that the kernel finds the first row of the tile at its index in the RecordBatch.
+        device_buf.device_address = device_region - static_cast<da_t>(r.offset);
+        if (r.size > 0) {
+          iov.push_back({b.raw_buffer_ - b.device_offset_ + r.offset, device_region, static_cast<uint64_t>(r.size)});
+        }
+        placement += (r.size + kTileAlignment - 1) / kTileAlignment * kTileAlignment;
+      }
+      device_buffers_.push_back(device_buf);
+    }
+  }
+
+  Timer timer;
+  timer.start();
+  status = platform_->CopyHostToDeviceV(iov.data(), iov.size());
+  timer.stop();
+  instrumentation_.Record(Phase::COPY, timer);
+  return status;
+}
+
+Status TiledContext::Run(Kernel *kernel, std::vector<TileResult> *results) {
+  if ((host_batches_.size() == 1) && (host_batch_desc_[0].mode != Mode::READ)) {
+    return Status::ERROR("Tiled execution supports RecordBatches with a read-mode Schema only.");
+  }
+  std::vector<RowRange> tiles;
+  auto status = Plan(&tiles);
+  if (!status.ok()) return status;
+  FLETCHER_LOG(DEBUG, "Processing RecordBatch in " << tiles.size() << " tile(s).");
+
+  const auto &profile = platform()->profile();
+  results->clear();
+  for (const auto &tile : tiles) {
+    status = LoadTile(tile);
+    if (!status.ok()) return status;
+    // Only the addresses of the buffers change between tiles.
+    status = kernel->UpdateMetaData();
+    if (!status.ok()) return status;
+    status = kernel->SetRange(0, tile.first, tile.last);
+    if (!status.ok()) return status;
+    status = kernel->Start();
+    if (!status.ok()) return status;
+    status = kernel->WaitUntilDone(profile.spin_usec, profile.poll_interval_usec);
+    if (!status.ok()) return status;
+    TileResult result = {tile, 0, 0};
+    status = kernel->GetReturn(&result.return0, &result.return1);
+    if (!status.ok()) return status;
+    results->push_back(result);
+  }
+  return Status::OK();
+}
+
+}  // namespace fletcher
@@ -0,0 +1,164 @@
+// Copyright 2018 Delft University of Technology
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fletcher/trace.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "fletcher/profiler.h"
+
+namespace fletcher {
+
+/// The identifier of the next Tracer. Identifiers are never reused, unlike addresses.
+static std::atomic<uint64_t> next_tracer_id(1);
+
+Tracer::Tracer(size_t capacity)
+    : id_(next_tracer_id.fetch_add(1, std::memory_order_relaxed)),
+      capacity_(capacity),
+      origin_(std::chrono::high_resolution_clock::now()) {}
+
+Status Tracer::Make(std::shared_ptr<Tracer> *tracer, size_t capacity) {
+  if (capacity == 0) {
+    return Status::ERROR("Tracer must be able to hold at least one span per thread.");
+  }
+  *tracer = std::make_shared<Tracer>(capacity);
+  return Status::OK();
+}
+
+Tracer::Ring *Tracer::LocalRing() {
+  // Threads usually record to a single Tracer, so the last ring is cached. Rings of other Tracers are looked up.
+  thread_local uint64_t last_id = 0;
+  thread_local Ring *last_ring = nullptr;
+  thread_local std::unordered_map<uint64_t, Ring *> rings;
+  if (last_id == id_) {
+    return last_ring;
+  }
+  auto it = rings.find(id_);
+  if (it == rings.end()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.emplace_back(new Ring(capacity_, static_cast<uint32_t>(rings_.size())));
+    it = rings.emplace(id_, rings_.back().get()).first;
+  }
+  last_id = id_;
+  last_ring = it->second;
+  return last_ring;
+}
+
+int64_t Tracer::Since(const Timer::time_point &t) const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin_).count();
+}
+
+void Tracer::Record(Phase phase, const Timer &timer) {
+  auto ring = LocalRing();
+  // Only the calling thread writes to its ring, so the count can be published after the span is written.
+  auto i = ring->recorded.load(std::memory_order_relaxed);
+  auto &span = ring->spans[i % capacity_];
+  span.phase = phase;
+  span.start = Since(timer.start_);
+  span.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(timer.stop_ - timer.start_).count();
+  span.thread = ring->thread;
+  ring->recorded.store(i + 1, std::memory_order_release);
+}
+
+void Tracer::Sample(const std::vector<StreamProfile> &profiles) {
+  auto time = Since(std::chrono::high_resolution_clock::now());
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &p : profiles) {
+    samples_.push_back({time, p.name, p.elements, p.transfers, p.valids, p.readies});
+  }
+}
+
+std::vector<Span> Tracer::spans() const {
+  std::vector<Span> result;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &ring : rings_) {
+      auto recorded = ring->recorded.load(std::memory_order_acquire);
+      auto held = std::min<uint64_t>(recorded, capacity_);
+      for (auto i = recorded - held; i < recorded; i++) {
+        result.push_back(ring->spans[i % capacity_]);
+      }
+    }
+  }
+  std::stable_sort(result.begin(), result.end(), [](const Span &a, const Span &b) { return a.start < b.start; });
+  return result;
+}
+
+void Tracer::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Rings stay registered with their threads, so they are emptied rather than removed.
+  for (auto &ring : rings_) {
+    ring->recorded.store(0, std::memory_order_relaxed);
+  }
+  samples_.clear();
+}
+
+/// @brief Return a time in nanoseconds as the microseconds of Chrome trace events.
+static std::string Microseconds(int64_t nanoseconds) {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3) << static_cast<double>(nanoseconds) / 1000.0;
+  return ss.str();
+}
+
+/// @brief Escape a string for use in JSON.
+static std::string Escape(const std::string &str) {
+  std::stringstream ss;
+  for (auto c : str) {
+    if ((c == '"') || (c == '\\')) {
+      ss << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+    } else {
+      ss << c;
+    }
+  }
+  return ss.str();
+}
+
+std::string Tracer::ToChromeJSON() const {
+  std::stringstream ss;
+  ss << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  ss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"fletcher\"}}";
+  for (const auto &s : spans()) {
+    ss << ",{\"name\":\"" << ToString(s.phase) << "\",\"cat\":\"fletcher\",\"ph\":\"X\",\"pid\":0,\"tid\":" << s.thread
+       << ",\"ts\":" << Microseconds(s.start) << ",\"dur\":" << Microseconds(s.duration) << "}";
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &s : samples_) {
+    ss << ",{\"name\":\"" << Escape(s.name) << "\",\"cat\":\"profile\",\"ph\":\"C\",\"pid\":0,\"ts\":"
+       << Microseconds(s.time) << ",\"args\":{\"elements\":" << s.elements << ",\"transfers\":" << s.transfers
+       << ",\"valids\":" << s.valids << ",\"readies\":" << s.readies << "}}";
+  }
+  ss << "]}";
+  return ss.str();
+}
+
+Status Tracer::WriteChromeTrace(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file.good()) {
+    return Status::ERROR("Could not open " + path + " to write the trace to.");
+  }
+  file << ToChromeJSON();
+  if (!file.good()) {
+    return Status::ERROR("Could not write the trace to " + path + ".");
+  }
+  return Status::OK();
+}
+
+}  // namespace fletcher
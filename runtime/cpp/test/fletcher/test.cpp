@@ -15,16 +15,50 @@
 #include <fletcher/fletcher.h>
 #include <arrow/api.h>
 #include <arrow/builder.h>
+#include <arrow/c/bridge.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
 #include <arrow/record_batch.h>
 #include <fletcher_echo.h>
+#include <fletcher/runtime.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <string>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
 #include <vector>
 #include <memory>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <fstream>
 
 #include "fletcher/platform.h"
 #include "fletcher/context.h"
+#include "fletcher/streaming.h"
+#include "fletcher/scheduler.h"
+#include "fletcher/pinned.h"
+#include "fletcher/tiled.h"
+#include "fletcher/pool.h"
+#include "fletcher/profiler.h"
+#include "fletcher/output.h"
+#include "fletcher/partition.h"
+#include "fletcher/submission.h"
+#include "fletcher/residency.h"
+#include "fletcher/devices.h"
+#include "fletcher/numa.h"
+#include "fletcher/ring.h"
+#include "fletcher/completion.h"
+#include "fletcher/result.h"
+#include "fletcher/offload.h"
+#include "fletcher/image.h"
+#include "fletcher/chunks.h"
+#include "fletcher/ingest.h"
+#include "fletcher/flight.h"
+#include "fletcher/sink.h"
+#include "fletcher/coalesce.h"
 
 TEST(Platform, NoPlatform) {
   std::shared_ptr<fletcher::Platform> platform;
@@ -52,6 +86,9 @@ TEST(Platform, EchoPlatform) {
 
   // MMIO:
   ASSERT_TRUE(platform->WriteMMIO(0, 0).ok());
+  uint32_t batch[4] = {1, 2, 3, 4};
+  ASSERT_TRUE(platform->HasWriteMMIOBatch());
+  ASSERT_TRUE(platform->WriteMMIOBatch(FLETCHER_REG_SCHEMA, batch, 4).ok());
   uint32_t val;
   ASSERT_TRUE(platform->ReadMMIO(0, &val).ok());
   uint64_t val64;
@@ -69,6 +106,62 @@ TEST(Platform, EchoPlatform) {
 
 }
 
+TEST(Platform, Profile) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform).ok());
+  ASSERT_TRUE(platform->profile().name.empty());
+
+  // The hardware keys of a profile generated by fletchgen are ignored.
+  const std::string path = "test_platform.profile";
+  {
+    std::ofstream file(path);
+    file << "# Fletchgen platform profile.\n"
+            "name alveo\n"
+            "bus_specs 64,512,8,1,64\n"
+            "buffer_alignment 4096\n"
+            "mem_type cache\n"
+            "spin_usec 10\n"
+            "poll_interval_usec 20\n";
+  }
+  ASSERT_TRUE(platform->LoadProfile(path).ok());
+  ASSERT_EQ(platform->profile().name, "alveo");
+  ASSERT_EQ(platform->profile().buffer_alignment, 4096);
+  ASSERT_TRUE(platform->profile().cache);
+  ASSERT_EQ(platform->profile().spin_usec, 10u);
+  ASSERT_EQ(platform->profile().poll_interval_usec, 20u);
+
+  // Contexts take their buffer alignment from the profile.
+  auto context = std::make_shared<fletcher::Context>(platform);
+  ASSERT_EQ(context->buffer_alignment(), 4096);
+
+  // RecordBatches of any memory type are cached, also when they are streamed.
+  ASSERT_TRUE(platform->Init().ok());
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto rb = arrow::RecordBatch::Make(arrow::schema({arrow::field("a", arrow::uint64(), false)}), 4, {a});
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->device_buffer(0).memory, fletcher::MemType::CACHE);
+  context.reset();
+  std::shared_ptr<fletcher::StreamingContext> streaming;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&streaming, platform, 2).ok());
+  ASSERT_TRUE(streaming->Push(rb).ok());
+  ASSERT_TRUE(streaming->Rotate().ok());
+  ASSERT_EQ(streaming->device_buffer(0).memory, fletcher::MemType::CACHE);
+  streaming.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+
+  {
+    std::ofstream file(path);
+    file << "buffer_alignment 100\n";
+  }
+  ASSERT_FALSE(platform->LoadProfile(path).ok());
+  ASSERT_FALSE(platform->LoadProfile("no_such.profile").ok());
+  std::remove(path.c_str());
+}
+
 TEST(Context, ContextFunctions) {
   std::shared_ptr<fletcher::Platform> platform;
   ASSERT_TRUE(fletcher::Platform::Make(&platform, false).ok());
@@ -131,3 +224,3050 @@ TEST(Context, ContextFunctions) {
   ASSERT_TRUE(context->Enable().ok());
   ASSERT_TRUE(platform->Terminate().ok());
 }
+
+TEST(Context, StreamingContext) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  for (uint64_t i = 0; i < 3; i++) {
+    arrow::UInt64Builder ba;
+    ASSERT_TRUE(ba.AppendValues({i, i + 1, i + 2, i + 3}).ok());
+    std::shared_ptr<arrow::Array> a;
+    ASSERT_TRUE(ba.Finish(&a).ok());
+    batches.push_back(arrow::RecordBatch::Make(schema, 4, {a}));
+  }
+
+  std::shared_ptr<fletcher::StreamingContext> context;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&context, platform, 3).ok());
+  // Nothing was pushed yet.
+  ASSERT_FALSE(context->Rotate().ok());
+
+  ASSERT_TRUE(context->Push(batches[0]).ok());
+  ASSERT_TRUE(context->Push(batches[1]).ok());
+  ASSERT_EQ(context->num_pending(), 2);
+  for (size_t i = 0; i < batches.size(); i++) {
+    ASSERT_TRUE(context->Rotate().ok());
+    ASSERT_EQ(context->recordbatch(0), batches[i]);
+    ASSERT_EQ(context->num_buffers(), 1);
+    // The echo platform copies into newly allocated memory.
+    auto buf = context->device_buffer(0);
+    ASSERT_FALSE(buf.host_visible());
+    ASSERT_EQ(std::memcmp(reinterpret_cast<const void *>(buf.device_address), buf.host_address, buf.size), 0);
+    if (i + 2 < batches.size()) {
+      ASSERT_TRUE(context->Push(batches[i + 2]).ok());
+    }
+  }
+  ASSERT_EQ(context->num_pending(), 0);
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, StreamingContextRun) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 100;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  for (uint64_t i = 0; i < 3; i++) {
+    arrow::UInt64Builder ba;
+    ASSERT_TRUE(ba.AppendValues(std::vector<uint64_t>(i + 1, i)).ok());
+    std::shared_ptr<arrow::Array> a;
+    ASSERT_TRUE(ba.Finish(&a).ok());
+    batches.push_back(arrow::RecordBatch::Make(schema, a->length(), {a}));
+  }
+  auto table = arrow::Table::FromRecordBatches(batches).ValueOrDie();
+
+  std::shared_ptr<fletcher::StreamingContext> context;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&context, platform, 2).ok());
+  fletcher::Kernel kernel(context);
+  // The echo model holds the values written to its registers, so the return registers hold this value for every run.
+  ASSERT_TRUE(platform->WriteMMIO(FLETCHER_REG_RETURN0, 7).ok());
+  ASSERT_TRUE(platform->WriteMMIO(FLETCHER_REG_RETURN0 + 1, 1).ok());
+
+  arrow::TableBatchReader reader(*table);
+  std::shared_ptr<arrow::Array> results;
+  size_t num_called = 0;
+  auto status = context->Run(&reader, &kernel, &results, fletcher::MemType::ANY,
+                             [&](size_t i, fletcher::Kernel *) {
+                               EXPECT_EQ(context->recordbatch(0), batches[i]);
+                               // The last index register holds the number of rows of the active RecordBatch.
+                               uint32_t last = 0;
+                               EXPECT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 1, &last).ok());
+                               EXPECT_EQ(last, i + 1);
+                               num_called++;
+                               return fletcher::Status::OK();
+                             });
+  ASSERT_TRUE(status.ok());
+  ASSERT_EQ(num_called, 3);
+  ASSERT_EQ(results->length(), 3);
+  auto values = std::static_pointer_cast<arrow::UInt64Array>(results);
+  for (int64_t i = 0; i < values->length(); i++) {
+    ASSERT_EQ(values->Value(i), (1ULL << 32) | 7);
+  }
+  ASSERT_EQ(context->num_pending(), 0);
+
+  // Kernels must run on the context itself.
+  std::shared_ptr<fletcher::Context> other;
+  ASSERT_TRUE(fletcher::Context::Make(&other, platform).ok());
+  fletcher::Kernel other_kernel(other);
+  arrow::TableBatchReader other_reader(*table);
+  ASSERT_FALSE(context->Run(&other_reader, &other_kernel).ok());
+
+  context.reset();
+  other.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, Ingest) {
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  // Unit i decodes into i + 1 values of i. Later units finish first, such that they are decoded out of order.
+  std::atomic<size_t> num_decoding(0);
+  std::atomic<size_t> max_decoding(0);
+  auto decode = [&](size_t unit, arrow::MemoryPool *pool, std::shared_ptr<arrow::RecordBatch> *out) {
+    auto decoding = ++num_decoding;
+    size_t max = max_decoding;
+    while ((decoding > max) && !max_decoding.compare_exchange_weak(max, decoding)) {}
+    std::this_thread::sleep_for(std::chrono::milliseconds(8 - unit % 4 * 2));
+    arrow::UInt64Builder ba(pool);
+    if (!ba.AppendValues(std::vector<uint64_t>(unit + 1, unit)).ok()) {
+      return fletcher::Status::ERROR("Could not append values.");
+    }
+    std::shared_ptr<arrow::Array> a;
+    if (!ba.Finish(&a).ok()) {
+      return fletcher::Status::ERROR("Could not finish array.");
+    }
+    *out = arrow::RecordBatch::Make(schema, a->length(), {a});
+    num_decoding--;
+    return fletcher::Status::OK();
+  };
+
+  std::shared_ptr<fletcher::Ingest> ingest;
+  ASSERT_FALSE(fletcher::Ingest::Make(&ingest, schema, 8, decode, 0).ok());
+  ASSERT_FALSE(fletcher::Ingest::Make(&ingest, schema, 8, decode, 4, 0).ok());
+  ASSERT_TRUE(fletcher::Ingest::Make(&ingest, schema, 8, decode, 4, 2).ok());
+  std::shared_ptr<arrow::RecordBatch> batch;
+  for (uint64_t i = 0; i < 8; i++) {
+    ASSERT_TRUE(ingest->Next(&batch).ok());
+    ASSERT_NE(batch, nullptr);
+    ASSERT_EQ(batch->num_rows(), i + 1);
+    ASSERT_EQ(std::static_pointer_cast<arrow::UInt64Array>(batch->column(0))->Value(0), i);
+  }
+  ASSERT_TRUE(ingest->Next(&batch).ok());
+  ASSERT_EQ(batch, nullptr);
+  // No more units than the capacity are decoded ahead of the RecordBatch returned last.
+  ASSERT_LE(max_decoding, 2);
+
+  // A failing unit is returned in order, after which decoding stops.
+  auto failing = [&](size_t unit, arrow::MemoryPool *pool, std::shared_ptr<arrow::RecordBatch> *out) {
+    if (unit == 2) {
+      return fletcher::Status::ERROR("Corrupt unit.");
+    }
+    return decode(unit, pool, out);
+  };
+  ASSERT_TRUE(fletcher::Ingest::Make(&ingest, schema, 8, failing, 4, 4).ok());
+  ASSERT_TRUE(ingest->Next(&batch).ok());
+  ASSERT_TRUE(ingest->Next(&batch).ok());
+  ASSERT_FALSE(ingest->Next(&batch).ok());
+  ASSERT_TRUE(ingest->Next(&batch).ok());
+  ASSERT_EQ(batch, nullptr);
+
+  // An Ingest feeds a StreamingContext.
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::StreamingContext> context;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&context, platform, 2).ok());
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(fletcher::Ingest::Make(&ingest, schema, 4, decode, 2, 2).ok());
+  std::shared_ptr<arrow::Array> results;
+  ASSERT_TRUE(context->Run(ingest.get(), &kernel, &results).ok());
+  ASSERT_EQ(results->length(), 4);
+
+  ingest.reset();
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, Coalescer) {
+  auto schema = arrow::schema({arrow::field("s", arrow::utf8(), false)});
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  for (int i = 0; i < 5; i++) {
+    arrow::StringBuilder bs;
+    ASSERT_TRUE(bs.AppendValues({std::to_string(i), "x", std::string(i, 'y')}).ok());
+    std::shared_ptr<arrow::Array> s;
+    ASSERT_TRUE(bs.Finish(&s).ok());
+    batches.push_back(arrow::RecordBatch::Make(schema, 3, {s}));
+  }
+  auto source = arrow::RecordBatchReader::Make(batches, schema).ValueOrDie();
+
+  // Two RecordBatches of three rows fit eight rows, a third one does not.
+  std::shared_ptr<fletcher::Coalescer> coalescer;
+  ASSERT_TRUE(fletcher::Coalescer::Make(&coalescer, source, 8).ok());
+  std::vector<std::shared_ptr<arrow::RecordBatch>> coalesced;
+  std::shared_ptr<arrow::RecordBatch> batch;
+  ASSERT_TRUE(coalescer->Next(&batch).ok());
+  while (batch != nullptr) {
+    coalesced.push_back(batch);
+    ASSERT_TRUE(coalescer->Next(&batch).ok());
+  }
+  ASSERT_EQ(coalesced.size(), 3);
+  ASSERT_EQ(coalescer->num_coalesced(), 3);
+  ASSERT_EQ(coalesced[0]->num_rows(), 6);
+  ASSERT_EQ(coalesced[2]->num_rows(), 3);
+  ASSERT_EQ(coalesced[2], batches[4]);
+  ASSERT_EQ(coalescer->parts(1), std::vector<int64_t>({3, 3}));
+
+  // The offsets of the strings are rebased.
+  auto s = std::static_pointer_cast<arrow::StringArray>(coalesced[1]->column(0));
+  ASSERT_EQ(s->GetString(3), "3");
+  ASSERT_EQ(s->GetString(5), "yyy");
+
+  // Results of a coalesced RecordBatch are sliced back into results of the original ones.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> split;
+  ASSERT_TRUE(coalescer->Split(1, coalesced[1], &split).ok());
+  ASSERT_EQ(split.size(), 2);
+  ASSERT_TRUE(split[1]->Equals(*batches[3]));
+  ASSERT_FALSE(coalescer->Split(0, batches[0], &split).ok());
+  ASSERT_FALSE(coalescer->Split(3, coalesced[0], &split).ok());
+
+  // A kernel is launched once for every coalesced RecordBatch.
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::StreamingContext> context;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&context, platform, 2).ok());
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(fletcher::Coalescer::Make(&coalescer, arrow::RecordBatchReader::Make(batches, schema).ValueOrDie(),
+                                        0, 0).ok());
+  std::shared_ptr<arrow::Array> results;
+  ASSERT_TRUE(context->Run(coalescer.get(), &kernel, &results).ok());
+  ASSERT_EQ(results->length(), 1);
+  ASSERT_EQ(coalescer->parts(0).size(), 5);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, Pruner) {
+  auto schema = arrow::schema({arrow::field("a", arrow::int32(), true)});
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  for (int32_t i = 0; i < 4; i++) {
+    arrow::Int32Builder builder;
+    for (int32_t j = 0; j < 10; j++) {
+      // The last RecordBatch only holds nulls.
+      if ((i == 3) || (j == 5)) {
+        ASSERT_TRUE(builder.AppendNull().ok());
+      } else {
+        ASSERT_TRUE(builder.Append(10 * i + j - 5).ok());
+      }
+    }
+    std::shared_ptr<arrow::Array> a;
+    ASSERT_TRUE(builder.Finish(&a).ok());
+    batches.push_back(arrow::RecordBatch::Make(schema, 10, {a}));
+  }
+
+  fletcher::ZoneMap zone_map;
+  ASSERT_TRUE(fletcher::ZoneMap::Compute(*batches[1]->column(0), &zone_map).ok());
+  ASSERT_TRUE(zone_map.has_values);
+  ASSERT_EQ(zone_map.min, 5);
+  ASSERT_EQ(zone_map.max, 14);
+  ASSERT_TRUE(fletcher::ZoneMap::Compute(*batches[0]->column(0)->Slice(6), &zone_map).ok());
+  ASSERT_EQ(zone_map.min, 1);
+  ASSERT_TRUE(fletcher::ZoneMap::Compute(*batches[3]->column(0), &zone_map).ok());
+  ASSERT_FALSE(zone_map.has_values);
+
+  // Only the second RecordBatch holds values in [12, 15). The zone map of the first one is given, and is trusted.
+  std::vector<fletcher::Condition> conditions = {{"a", fletcher::Condition::Op::GE, 12},
+                                                 {"a", fletcher::Condition::Op::LT, 15}};
+  std::vector<fletcher::ZoneMaps> given = {{{"a", {12, 12, true}}}};
+  std::shared_ptr<fletcher::Pruner> pruner;
+  ASSERT_FALSE(fletcher::Pruner::Make(&pruner, arrow::RecordBatchReader::Make(batches, schema).ValueOrDie(),
+                                      {{"b", fletcher::Condition::Op::EQ, 0}}).ok());
+  ASSERT_TRUE(fletcher::Pruner::Make(&pruner, arrow::RecordBatchReader::Make(batches, schema).ValueOrDie(),
+                                     conditions, given).ok());
+
+  // Skipped RecordBatches are never transferred, and get a synthesized result.
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::StreamingContext> context;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&context, platform, 2).ok());
+  fletcher::Kernel kernel(context);
+  std::shared_ptr<arrow::Array> results;
+  ASSERT_TRUE(context->Run(pruner.get(), &kernel, &results).ok());
+  ASSERT_EQ(results->length(), 2);
+  ASSERT_EQ(pruner->skipped(), std::vector<bool>({false, false, true, true}));
+  ASSERT_EQ(pruner->num_skipped(), 2);
+  ASSERT_GT(pruner->bytes_skipped(), 0);
+  std::shared_ptr<arrow::Array> expanded;
+  ASSERT_TRUE(pruner->Expand(*std::static_pointer_cast<arrow::UInt64Array>(results), 42, &expanded).ok());
+  ASSERT_EQ(expanded->length(), 4);
+  ASSERT_EQ(std::static_pointer_cast<arrow::UInt64Array>(expanded)->Value(3), 42);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, FlightService) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("a", arrow::uint64(), false)}),
+                                           "FlightService",
+                                           fletcher::Mode::READ);
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches;
+  for (uint64_t i = 0; i < 3; i++) {
+    arrow::UInt64Builder builder;
+    std::shared_ptr<arrow::Array> values;
+    ASSERT_TRUE(builder.AppendValues(std::vector<uint64_t>(i + 1, i)).ok());
+    ASSERT_TRUE(builder.Finish(&values).ok());
+    // Received RecordBatches do not hold Fletcher metadata.
+    batches.push_back(arrow::RecordBatch::Make(arrow::schema({arrow::field("a", arrow::uint64(), false)}),
+                                               i + 1,
+                                               {values}));
+  }
+
+  std::shared_ptr<fletcher::Context> plain;
+  ASSERT_TRUE(fletcher::Context::Make(&plain, platform).ok());
+  std::shared_ptr<fletcher::FlightService> service;
+  ASSERT_FALSE(fletcher::FlightService::Make(&service, std::make_shared<fletcher::Kernel>(plain), schema).ok());
+
+  std::shared_ptr<fletcher::StreamingContext> context;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&context, platform, 2).ok());
+  ASSERT_TRUE(fletcher::FlightService::Make(&service, std::make_shared<fletcher::Kernel>(context), schema).ok());
+
+  // Every RecordBatch results in a RecordBatch holding the return registers.
+  std::vector<size_t> indices;
+  auto writer = [&](size_t index, const std::shared_ptr<arrow::RecordBatch> &result) {
+    EXPECT_EQ(result->num_rows(), 1);
+    EXPECT_EQ(result->column(0)->type_id(), arrow::Type::UINT64);
+    indices.push_back(index);
+    return fletcher::Status::OK();
+  };
+  auto reader = arrow::RecordBatchReader::Make(batches).ValueOrDie();
+  ASSERT_TRUE(service->Process(reader.get(), writer).ok());
+  ASSERT_EQ(indices, std::vector<size_t>({0, 1, 2}));
+
+  // RecordBatches must match the Schema of the service.
+  auto other = arrow::RecordBatch::Make(arrow::schema({arrow::field("a", arrow::int32(), false)}),
+                                        0,
+                                        {arrow::MakeArrayOfNull(arrow::int32(), 0).ValueOrDie()});
+  reader = arrow::RecordBatchReader::Make({other}).ValueOrDie();
+  ASSERT_FALSE(service->Process(reader.get(), writer).ok());
+
+  service.reset();
+  context.reset();
+  plain.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, DeviceMemoryPool) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::shared_ptr<fletcher::DeviceMemoryPool> pool;
+  ASSERT_FALSE(fletcher::DeviceMemoryPool::Make(&pool, platform, 4096, 100).ok());
+  ASSERT_TRUE(fletcher::DeviceMemoryPool::Make(&pool, platform, 16384, 64).ok());
+
+  // Sub-allocate aligned regions from a single slab.
+  da_t a, b, c;
+  ASSERT_TRUE(pool->Allocate(&a, 100).ok());
+  ASSERT_TRUE(pool->Allocate(&b, 64).ok());
+  ASSERT_TRUE(pool->Allocate(&c, 1).ok());
+  ASSERT_EQ(a % 64, 0);
+  ASSERT_EQ(b % 64, 0);
+  ASSERT_EQ(c % 64, 0);
+  auto stats = pool->stats();
+  ASSERT_EQ(stats.num_slabs, 1);
+  ASSERT_EQ(stats.allocated_bytes, 128 + 64 + 64);
+
+  // Freed regions are coalesced and recycled.
+  ASSERT_TRUE(pool->Free(b).ok());
+  ASSERT_TRUE(pool->Free(a).ok());
+  da_t d;
+  ASSERT_TRUE(pool->Allocate(&d, 192).ok());
+  ASSERT_EQ(d, a);
+  ASSERT_FALSE(pool->Free(d + 1).ok());
+
+  // A region larger than the slab size causes a new slab.
+  da_t e;
+  ASSERT_TRUE(pool->Allocate(&e, 32768).ok());
+  stats = pool->stats();
+  ASSERT_EQ(stats.num_slabs, 2);
+  ASSERT_EQ(stats.high_water_mark, 192 + 64 + 32768);
+  ASSERT_TRUE(pool->Free(e).ok());
+  ASSERT_TRUE(pool->Trim().ok());
+  ASSERT_EQ(pool->stats().num_slabs, 1);
+
+  // Contexts recycle cached buffers through the pool.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+  for (int i = 0; i < 2; i++) {
+    std::shared_ptr<fletcher::Context> context;
+    ASSERT_TRUE(fletcher::Context::Make(&context, platform, pool).ok());
+    ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+    ASSERT_TRUE(context->Enable().ok());
+    ASSERT_EQ(pool->stats().num_allocations, 3);
+  }
+  ASSERT_EQ(pool->stats().num_allocations, 2);
+  ASSERT_EQ(pool->stats().num_slabs, 1);
+
+  ASSERT_TRUE(pool->Free(c).ok());
+  ASSERT_TRUE(pool->Free(d).ok());
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, Scheduler) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto batch = arrow::RecordBatch::Make(schema, 10, {a});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(batch).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  std::shared_ptr<fletcher::Scheduler> scheduler;
+  ASSERT_FALSE(fletcher::Scheduler::Make(&scheduler, context, 0).ok());
+  ASSERT_TRUE(fletcher::Scheduler::Make(&scheduler, context, 3).ok());
+  ASSERT_EQ(scheduler->num_instances(), 3);
+  for (size_t i = 0; i < 3; i++) {
+    ASSERT_EQ(scheduler->kernel(i)->mmio_base(), i * FLETCHER_INSTANCE_WINDOW_REGS);
+  }
+
+  // Rows are spread as evenly as possible.
+  ASSERT_TRUE(scheduler->Partition(0).ok());
+  ASSERT_EQ(scheduler->ranges()[0].first, 0);
+  ASSERT_EQ(scheduler->ranges()[0].last, 4);
+  ASSERT_EQ(scheduler->ranges()[1].first, 4);
+  ASSERT_EQ(scheduler->ranges()[1].last, 7);
+  ASSERT_EQ(scheduler->ranges()[2].first, 7);
+  ASSERT_EQ(scheduler->ranges()[2].last, 10);
+  ASSERT_FALSE(scheduler->Partition(1).ok());
+  ASSERT_FALSE(scheduler->SetRanges(0, {{0, 10}}).ok());
+
+  scheduler.reset();
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, SplitByBytes) {
+  // Fixed-width columns are split by rows.
+  auto fixed_schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto fixed = arrow::RecordBatch::Make(fixed_schema, 10, {a});
+
+  std::vector<fletcher::RowRange> ranges;
+  ASSERT_FALSE(fletcher::SplitByBytes(*fixed, 0, &ranges).ok());
+  ASSERT_TRUE(fletcher::SplitByBytes(*fixed, 2, &ranges).ok());
+  ASSERT_EQ(ranges.size(), 2);
+  ASSERT_EQ(ranges[0].first, 0);
+  ASSERT_EQ(ranges[0].last, 5);
+  ASSERT_EQ(ranges[1].first, 5);
+  ASSERT_EQ(ranges[1].last, 10);
+
+  // A single long string outweighs all other rows.
+  auto string_schema = arrow::schema({arrow::field("b", arrow::utf8(), false)});
+  arrow::StringBuilder bb;
+  ASSERT_TRUE(bb.Append(std::string(100, 'x')).ok());
+  for (int i = 0; i < 7; i++) {
+    ASSERT_TRUE(bb.Append("y").ok());
+  }
+  std::shared_ptr<arrow::Array> b;
+  ASSERT_TRUE(bb.Finish(&b).ok());
+  auto strings = arrow::RecordBatch::Make(string_schema, 8, {b});
+
+  ASSERT_TRUE(fletcher::SplitByBytes(*strings, 2, &ranges).ok());
+  ASSERT_EQ(ranges.size(), 2);
+  ASSERT_EQ(ranges[0].first, 0);
+  ASSERT_EQ(ranges[0].last, 1);
+  ASSERT_EQ(ranges[1].first, 1);
+  ASSERT_EQ(ranges[1].last, 8);
+}
+
+TEST(Context, PinnedMemoryPool) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  ASSERT_TRUE(platform->HasHostMalloc());
+
+  std::shared_ptr<fletcher::PinnedMemoryPool> pool;
+  ASSERT_TRUE(fletcher::PinnedMemoryPool::Make(&pool, platform).ok());
+
+  // Build a RecordBatch in device-visible host memory.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba(pool.get());
+  ASSERT_TRUE(ba.AppendValues({0, 1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto batch = arrow::RecordBatch::Make(schema, 4, {a});
+  ASSERT_GT(pool->bytes_allocated(), 0);
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(batch).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // The buffer is used in place, without allocation.
+  auto buf = context->device_buffer(0);
+  ASSERT_FALSE(buf.was_alloced);
+  ASSERT_TRUE(buf.host_visible());
+  ASSERT_EQ(buf.device_address, reinterpret_cast<da_t>(buf.host_address));
+
+  context.reset();
+  batch.reset();
+  a.reset();
+  ASSERT_EQ(pool->bytes_allocated(), 0);
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, MappedMemoryPool) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  ASSERT_TRUE(platform->HasDeviceMap());
+
+  std::shared_ptr<fletcher::MappedMemoryPool> pool;
+  ASSERT_TRUE(fletcher::MappedMemoryPool::Make(&pool, platform).ok());
+
+  // Build a RecordBatch in mapped device memory.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba(pool.get());
+  ASSERT_TRUE(ba.AppendValues({0, 1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto batch = arrow::RecordBatch::Make(schema, 4, {a});
+  ASSERT_GT(pool->bytes_allocated(), 0);
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(batch, fletcher::MemType::CACHE).ok());
+  ASSERT_EQ(context->GetQueueSizes().transfer, 0);
+  ASSERT_TRUE(context->Enable().ok());
+
+  // The buffer is resident already, so it is not copied.
+  auto buf = context->device_buffer(0);
+  ASSERT_FALSE(buf.was_alloced);
+  ASSERT_EQ(buf.device_address, reinterpret_cast<da_t>(buf.host_address));
+
+  context.reset();
+  batch.reset();
+  a.reset();
+  ASSERT_EQ(pool->bytes_allocated(), 0);
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ResidencyCache) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  // A dimension table of which the same values buffer is used by two fields.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("b", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({0, 1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto dim = arrow::RecordBatch::Make(schema, 4, {a, a});
+
+  std::shared_ptr<fletcher::ResidencyCache> cache;
+  ASSERT_TRUE(fletcher::ResidencyCache::Make(&cache, platform, 64).ok());
+
+  std::shared_ptr<fletcher::Context> first;
+  ASSERT_TRUE(fletcher::Context::Make(&first, platform).ok());
+  ASSERT_TRUE(first->SetResidencyCache(cache).ok());
+  ASSERT_TRUE(first->QueueRecordBatch(dim, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(first->Enable().ok());
+  // The shared buffer is copied once.
+  ASSERT_TRUE(first->device_buffer(0).resident);
+  ASSERT_EQ(first->device_buffer(0).device_address, first->device_buffer(1).device_address);
+  ASSERT_EQ(memcmp(a->data()->buffers[1]->data(),
+                   reinterpret_cast<const uint8_t *>(first->device_buffer(0).device_address),
+                   32), 0);
+  auto stats = cache->stats();
+  ASSERT_EQ(stats.misses, 1);
+  ASSERT_EQ(stats.hits, 1);
+  ASSERT_EQ(stats.resident_bytes, 32);
+  ASSERT_EQ(stats.num_pinned, 1);
+
+  // The buffer stays resident for the next Context.
+  auto address = first->device_buffer(0).device_address;
+  first.reset();
+  ASSERT_EQ(cache->stats().num_pinned, 0);
+  std::shared_ptr<fletcher::Context> second;
+  ASSERT_TRUE(fletcher::Context::Make(&second, platform).ok());
+  ASSERT_TRUE(second->SetResidencyCache(cache).ok());
+  ASSERT_TRUE(second->QueueRecordBatch(dim, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(second->Enable().ok());
+  ASSERT_EQ(second->device_buffer(0).device_address, address);
+  ASSERT_EQ(cache->stats().hits, 3);
+  second.reset();
+
+  // Another buffer that does not fit next to the resident one evicts it.
+  arrow::UInt64Builder bc;
+  ASSERT_TRUE(bc.AppendValues({4, 5, 6, 7, 8}).ok());
+  std::shared_ptr<arrow::Array> c;
+  ASSERT_TRUE(bc.Finish(&c).ok());
+  auto other = arrow::RecordBatch::Make(arrow::schema({arrow::field("c", arrow::uint64(), false)}), 5, {c});
+  std::shared_ptr<fletcher::Context> third;
+  ASSERT_TRUE(fletcher::Context::Make(&third, platform).ok());
+  ASSERT_TRUE(third->SetResidencyCache(cache).ok());
+  ASSERT_TRUE(third->QueueRecordBatch(other, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(third->Enable().ok());
+  stats = cache->stats();
+  ASSERT_EQ(stats.evictions, 1);
+  ASSERT_EQ(stats.resident_bytes, 40);
+
+  // While it is pinned, buffers that do not fit bypass the cache.
+  std::shared_ptr<fletcher::Context> fourth;
+  ASSERT_TRUE(fletcher::Context::Make(&fourth, platform).ok());
+  ASSERT_TRUE(fourth->SetResidencyCache(cache).ok());
+  ASSERT_TRUE(fourth->QueueRecordBatch(dim, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(fourth->Enable().ok());
+  ASSERT_FALSE(fourth->device_buffer(0).resident);
+  ASSERT_TRUE(fourth->device_buffer(0).was_alloced);
+  ASSERT_EQ(cache->stats().bypasses, 2);
+
+  fourth.reset();
+  third.reset();
+  cache.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, Stats) {
+  // Percentiles are upper bounds with power-of-two resolution.
+  fletcher::Histogram h;
+  ASSERT_EQ(h.Percentile(0.5), 0);
+  for (uint64_t i = 1; i <= 100; i++) {
+    h.Record(i * 1000);
+  }
+  ASSERT_EQ(h.count(), 100);
+  ASSERT_EQ(h.max(), 100000);
+  ASSERT_GE(h.Percentile(0.5), 50000);
+  ASSERT_LT(h.Percentile(0.5), 2 * 50000);
+  ASSERT_EQ(h.Percentile(0.99), 100000);
+  h.Reset();
+  ASSERT_EQ(h.count(), 0);
+
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::DeviceMemoryPool> pool;
+  ASSERT_TRUE(fletcher::DeviceMemoryPool::Make(&pool, platform).ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform, pool).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::ANY).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+
+  auto stats = context->GetStats();
+  ASSERT_EQ(stats[fletcher::Phase::QUEUE].count, 2);
+  ASSERT_EQ(stats[fletcher::Phase::ANALYZE].count, 2);
+  ASSERT_EQ(stats[fletcher::Phase::ALLOC].count, 1);
+  ASSERT_EQ(stats[fletcher::Phase::COPY].count, 1);
+  ASSERT_EQ(stats[fletcher::Phase::PREPARE].count, 1);
+  ASSERT_EQ(stats[fletcher::Phase::METADATA].count, 1);
+  ASSERT_EQ(stats[fletcher::Phase::COMPLETION].count, 0);
+  ASSERT_LE(stats[fletcher::Phase::QUEUE].p50, stats[fletcher::Phase::QUEUE].p99);
+  ASSERT_LE(stats[fletcher::Phase::QUEUE].p99, stats[fletcher::Phase::QUEUE].max);
+  ASSERT_FALSE(stats.ToString().empty());
+  ASSERT_NE(stats.ToJSON().find("\"queue\":{\"count\":2,"), std::string::npos);
+
+  // Statistics of multiple Contexts can be aggregated.
+  fletcher::Instrumentation total;
+  total.Merge(context->instrumentation());
+  total.Merge(context->instrumentation());
+  ASSERT_EQ(total.GetStats()[fletcher::Phase::QUEUE].count, 4);
+  ASSERT_EQ(total.GetStats()[fletcher::Phase::QUEUE].max, stats[fletcher::Phase::QUEUE].max);
+
+  context->ResetStats();
+  ASSERT_EQ(context->GetStats()[fletcher::Phase::QUEUE].count, 0);
+
+  context.reset();
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, Tracer) {
+  std::shared_ptr<fletcher::Tracer> tracer;
+  ASSERT_FALSE(fletcher::Tracer::Make(&tracer, 0).ok());
+  ASSERT_TRUE(fletcher::Tracer::Make(&tracer).ok());
+
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::DeviceMemoryPool> pool;
+  ASSERT_TRUE(fletcher::DeviceMemoryPool::Make(&pool, platform).ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+
+  // Every timed phase becomes a span, in order of their start.
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform, pool).ok());
+  context->SetTracer(tracer);
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+  auto spans = tracer->spans();
+  ASSERT_EQ(spans.size(), 5);
+  ASSERT_EQ(spans.back().phase, fletcher::Phase::METADATA);
+  for (size_t i = 1; i < spans.size(); i++) {
+    ASSERT_LE(spans[i - 1].start, spans[i].start);
+  }
+
+  // Profiler counters are merged into the timeline as counter events.
+  fletcher::StreamProfile profile;
+  profile.name = "a\"values";
+  profile.elements = 4;
+  tracer->Sample({profile});
+  auto json = tracer->ToChromeJSON();
+  ASSERT_NE(json.find("\"name\":\"queue\",\"cat\":\"fletcher\",\"ph\":\"X\""), std::string::npos);
+  ASSERT_NE(json.find("\"name\":\"a\\\"values\",\"cat\":\"profile\",\"ph\":\"C\""), std::string::npos);
+
+  // Without a tracer, nothing is recorded.
+  context->SetTracer(nullptr);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+  ASSERT_EQ(tracer->spans().size(), 5);
+  tracer->Clear();
+  ASSERT_TRUE(tracer->spans().empty());
+
+  // Full rings overwrite their oldest spans.
+  ASSERT_TRUE(fletcher::Tracer::Make(&tracer, 2).ok());
+  fletcher::Timer t;
+  for (auto phase : {fletcher::Phase::ALLOC, fletcher::Phase::COPY, fletcher::Phase::START}) {
+    t.start();
+    t.stop();
+    tracer->Record(phase, t);
+  }
+  spans = tracer->spans();
+  ASSERT_EQ(spans.size(), 2);
+  ASSERT_EQ(spans[0].phase, fletcher::Phase::COPY);
+  ASSERT_EQ(spans[1].phase, fletcher::Phase::START);
+
+  context.reset();
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ReplaceRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::DeviceMemoryPool> pool;
+  ASSERT_TRUE(fletcher::DeviceMemoryPool::Make(&pool, platform, 65536, 64).ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  auto make_batch = [&schema](uint64_t num_rows) {
+    arrow::UInt64Builder ba;
+    for (uint64_t i = 0; i < num_rows; i++) {
+      EXPECT_TRUE(ba.Append(i).ok());
+    }
+    std::shared_ptr<arrow::Array> arr;
+    EXPECT_TRUE(ba.Finish(&arr).ok());
+    return arrow::RecordBatch::Make(schema, num_rows, {arr});
+  };
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform, pool).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(make_batch(16), fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+  auto address = context->device_buffer(0).device_address;
+
+  // A smaller RecordBatch fits in the existing allocation.
+  auto small = make_batch(8);
+  ASSERT_TRUE(context->ReplaceRecordBatch(0, small).ok());
+  ASSERT_EQ(context->recordbatch(0), small);
+  ASSERT_EQ(context->device_buffer(0).device_address, address);
+  ASSERT_EQ(context->device_buffer(0).size, 8 * 8);
+  ASSERT_TRUE(kernel.UpdateMetaData().ok());
+
+  // A larger RecordBatch grows the allocation.
+  ASSERT_TRUE(context->ReplaceRecordBatch(0, make_batch(1024)).ok());
+  ASSERT_EQ(context->device_buffer(0).capacity, 1024 * 8);
+  ASSERT_EQ(pool->stats().num_allocations, 1);
+  ASSERT_TRUE(kernel.UpdateMetaData().ok());
+
+  // Replaced descriptions are refilled for the next RecordBatch of the same Schema.
+  auto again = make_batch(4);
+  ASSERT_TRUE(context->ReplaceRecordBatch(0, again).ok());
+  ASSERT_EQ(context->recordbatch_description(0).rows, 4);
+  ASSERT_EQ(context->recordbatch_description(0).fields[0].buffers.back().raw_buffer_,
+            again->column_data(0)->buffers[1]->data());
+  ASSERT_EQ(context->recordbatch_description(0).fields[0].buffers.back().size_, 4 * 8);
+  ASSERT_TRUE(context->ReplaceRecordBatch(0, make_batch(1024)).ok());
+  ASSERT_EQ(context->recordbatch_description(0).rows, 1024);
+
+  // RecordBatches with a different layout can not replace others.
+  auto other = arrow::schema({arrow::field("s", arrow::utf8(), false)});
+  arrow::StringBuilder bs;
+  ASSERT_TRUE(bs.Append("x").ok());
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(bs.Finish(&s).ok());
+  ASSERT_FALSE(context->ReplaceRecordBatch(0, arrow::RecordBatch::Make(other, 1, {s})).ok());
+  ASSERT_FALSE(context->ReplaceRecordBatch(1, small).ok());
+
+  context.reset();
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ReadbackRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("s", arrow::utf8(), false)}),
+                                           "Readback",
+                                           fletcher::Mode::WRITE);
+  arrow::StringBuilder bs;
+  ASSERT_TRUE(bs.AppendValues({"a", "bc"}).ok());
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(bs.Finish(&s).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 2, {s});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->num_buffers(), 2);
+
+  // Mimic a kernel writing two strings of one character.
+  int32_t offsets[] = {0, 1, 2};
+  char values[] = {'x', 'y', 'z'};
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(offsets),
+                                         context->device_buffer(0).device_address,
+                                         sizeof(offsets)).ok());
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(values),
+                                         context->device_buffer(1).device_address,
+                                         sizeof(values)).ok());
+
+  // Only the values that the offsets refer to are read back.
+  std::shared_ptr<arrow::RecordBatch> result;
+  ASSERT_TRUE(context->ReadbackRecordBatch(0, &result).ok());
+  auto sa = std::static_pointer_cast<arrow::StringArray>(result->column(0));
+  ASSERT_EQ(sa->GetString(0), "x");
+  ASSERT_EQ(sa->GetString(1), "y");
+  ASSERT_EQ(sa->value_data()->data()[2], 'c');
+  ASSERT_FALSE(context->ReadbackRecordBatch(1, &result).ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, IpcSink) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("a", arrow::uint64(), false)}),
+                                           "Sink",
+                                           fletcher::Mode::WRITE);
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  for (int i = 0; i < 3; i++) {
+    arrow::UInt64Builder ba;
+    ASSERT_TRUE(ba.AppendValues(std::vector<uint64_t>(4, 0)).ok());
+    std::shared_ptr<arrow::Array> a;
+    ASSERT_TRUE(ba.Finish(&a).ok());
+    ASSERT_TRUE(context->QueueRecordBatch(arrow::RecordBatch::Make(schema, 4, {a}), fletcher::MemType::CACHE).ok());
+  }
+  ASSERT_TRUE(context->Enable().ok());
+
+  // Mimic a kernel writing the row number times the index of the RecordBatch.
+  for (size_t i = 0; i < 3; i++) {
+    uint64_t values[] = {0, i, 2 * i, 3 * i};
+    ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(values),
+                                           context->device_buffer(i).device_address,
+                                           sizeof(values)).ok());
+  }
+
+  auto stream = arrow::io::BufferOutputStream::Create().ValueOrDie();
+  std::shared_ptr<fletcher::IpcSink> sink;
+  ASSERT_TRUE(fletcher::IpcSink::MakeStream(&sink, stream, schema).ok());
+  ASSERT_TRUE(sink->Write(context.get(), 0).ok());
+  ASSERT_TRUE(sink->Write(context.get(), 1).ok());
+  // The last RecordBatch is sliced to the rows the kernel wrote.
+  ASSERT_TRUE(sink->Write(context.get(), 2, 2).ok());
+  ASSERT_FALSE(sink->Write(context.get(), 3).ok());
+  ASSERT_TRUE(sink->Flush().ok());
+  ASSERT_EQ(sink->num_written(), 3);
+  ASSERT_TRUE(sink->Close().ok());
+  ASSERT_FALSE(sink->Write(context.get(), 0).ok());
+
+  auto buffer = stream->Finish().ValueOrDie();
+  auto reader = arrow::ipc::RecordBatchStreamReader::Open(std::make_shared<arrow::io::BufferReader>(buffer))
+      .ValueOrDie();
+  for (uint64_t i = 0; i < 3; i++) {
+    std::shared_ptr<arrow::RecordBatch> batch;
+    ASSERT_TRUE(reader->ReadNext(&batch).ok());
+    ASSERT_NE(batch, nullptr);
+    ASSERT_EQ(batch->num_rows(), i < 2 ? 4 : 2);
+    auto values = std::static_pointer_cast<arrow::UInt64Array>(batch->column(0));
+    for (int64_t r = 0; r < batch->num_rows(); r++) {
+      ASSERT_EQ(values->Value(r), static_cast<uint64_t>(r) * i);
+    }
+  }
+  std::shared_ptr<arrow::RecordBatch> end;
+  ASSERT_TRUE(reader->ReadNext(&end).ok());
+  ASSERT_EQ(end, nullptr);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, QueueDeviceRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("x", arrow::int64(), false)}),
+                                           "Filter",
+                                           fletcher::Mode::WRITE);
+  arrow::Int64Builder bx;
+  ASSERT_TRUE(bx.AppendValues({0, 0, 0, 0}).ok());
+  std::shared_ptr<arrow::Array> x;
+  ASSERT_TRUE(bx.Finish(&x).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {x});
+
+  std::shared_ptr<fletcher::Context> first;
+  ASSERT_TRUE(fletcher::Context::Make(&first, platform).ok());
+  ASSERT_TRUE(first->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+
+  // The output of the first kernel must be on the device.
+  std::shared_ptr<fletcher::Context> second;
+  ASSERT_TRUE(fletcher::Context::Make(&second, platform).ok());
+  ASSERT_FALSE(second->QueueDeviceRecordBatch(first, 0).ok());
+  ASSERT_TRUE(first->Enable().ok());
+
+  // Mimic the first kernel writing three rows.
+  int64_t values[] = {1, 2, 3};
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(values),
+                                         first->device_buffer(0).device_address,
+                                         sizeof(values)).ok());
+
+  ASSERT_FALSE(second->QueueDeviceRecordBatch(first, 1).ok());
+  ASSERT_FALSE(second->QueueDeviceRecordBatch(first, 0, 5).ok());
+  ASSERT_TRUE(second->QueueDeviceRecordBatch(first, 0, 3).ok());
+  ASSERT_EQ(second->recordbatch(0)->num_rows(), 3);
+  ASSERT_EQ(fletcher::GetMode(*second->recordbatch(0)->schema()), fletcher::Mode::READ);
+  ASSERT_EQ(fletcher::GetMeta(*second->recordbatch(0)->schema(), fletcher::meta::NAME), "Filter");
+
+  // Nothing is transferred to or allocated on the device for the second kernel.
+  auto sizes = second->GetQueueSizes();
+  ASSERT_EQ(sizes.transfer, 0);
+  ASSERT_EQ(sizes.allocate, 0);
+  ASSERT_TRUE(second->Enable().ok());
+  ASSERT_EQ(second->num_buffers(), first->num_buffers());
+  for (size_t i = 0; i < second->num_buffers(); i++) {
+    ASSERT_EQ(second->device_buffer(i).kernel_address(), first->device_buffer(i).kernel_address());
+    ASSERT_TRUE(second->device_buffer(i).borrowed);
+    ASSERT_FALSE(second->device_buffer(i).host_visible());
+    ASSERT_EQ(second->device_buffer(i).mode, fletcher::Mode::READ);
+  }
+  ASSERT_FALSE(second->ReplaceRecordBatch(0, rb).ok());
+
+  // Only write-mode RecordBatches can be chained.
+  std::shared_ptr<fletcher::Context> third;
+  ASSERT_TRUE(fletcher::Context::Make(&third, platform).ok());
+  ASSERT_FALSE(third->QueueDeviceRecordBatch(second, 0).ok());
+
+  // The second Context keeps the device buffers of the first alive.
+  first.reset();
+  int64_t read[3] = {0};
+  ASSERT_TRUE(platform->CopyDeviceToHost(second->device_buffer(0).device_address,
+                                         reinterpret_cast<uint8_t *>(read),
+                                         sizeof(read)).ok());
+  ASSERT_EQ(read[2], 3);
+
+  third.reset();
+  second.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ParallelEnable) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("s", arrow::utf8(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  arrow::StringBuilder bs;
+  ASSERT_TRUE(bs.AppendValues({"x", "yy", "zzz"}).ok());
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(bs.Finish(&s).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 3, {a, s});
+
+  std::shared_ptr<fletcher::Context> sequential;
+  std::shared_ptr<fletcher::Context> parallel;
+  ASSERT_TRUE(fletcher::Context::Make(&sequential, platform).ok());
+  ASSERT_TRUE(fletcher::Context::Make(&parallel, platform).ok());
+  parallel->SetTransferThreads(4);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(sequential->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+    ASSERT_TRUE(parallel->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  }
+  ASSERT_TRUE(sequential->Enable().ok());
+  ASSERT_TRUE(parallel->Enable().ok());
+
+  // The buffers are in the same order, regardless of the number of threads.
+  ASSERT_EQ(parallel->num_buffers(), sequential->num_buffers());
+  for (size_t i = 0; i < parallel->num_buffers(); i++) {
+    auto buf = parallel->device_buffer(i);
+    ASSERT_EQ(buf.host_address, sequential->device_buffer(i).host_address);
+    ASSERT_EQ(buf.size, sequential->device_buffer(i).size);
+    ASSERT_TRUE(buf.was_alloced);
+    ASSERT_EQ(memcmp(buf.host_address, reinterpret_cast<const uint8_t *>(buf.device_address), buf.size), 0);
+  }
+
+  sequential.reset();
+  parallel.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, SlicedRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("s", arrow::utf8(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  arrow::StringBuilder bs;
+  ASSERT_TRUE(bs.AppendValues({"w", "xx", "yyy", "zzzz"}).ok());
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(bs.Finish(&s).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {a, s})->Slice(1, 2);
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->num_buffers(), 3);
+
+  // Only the bytes covered by the slice are transferred.
+  auto values = context->device_buffer(0);
+  auto offsets = context->device_buffer(1);
+  auto chars = context->device_buffer(2);
+  ASSERT_EQ(values.size, 2 * sizeof(uint64_t));
+  ASSERT_EQ(offsets.size, 3 * sizeof(int32_t));
+  ASSERT_EQ(chars.size, 5);
+
+  // The kernel finds the first row of the slice at index zero, and the characters through the original offsets.
+  auto kernel_values = reinterpret_cast<const uint64_t *>(values.kernel_address());
+  ASSERT_EQ(kernel_values[0], 2);
+  ASSERT_EQ(kernel_values[1], 3);
+  auto kernel_offsets = reinterpret_cast<const int32_t *>(offsets.kernel_address());
+  auto kernel_chars = reinterpret_cast<const char *>(chars.kernel_address());
+  ASSERT_EQ(std::string(kernel_chars + kernel_offsets[0], kernel_chars + kernel_offsets[1]), "xx");
+  ASSERT_EQ(std::string(kernel_chars + kernel_offsets[1], kernel_chars + kernel_offsets[2]), "yyy");
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, QueueSizes) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("c", arrow::uint64(), true)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  arrow::UInt64Builder bc;
+  ASSERT_TRUE(bc.AppendValues({5, 6, 7, 8}).ok());
+  std::shared_ptr<arrow::Array> c;
+  ASSERT_TRUE(bc.Finish(&c).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {a, c});
+
+  // The validity bitmap of c holds no nulls, so it is not transferred. Regions of the pool are padded to 64 bytes.
+  std::shared_ptr<fletcher::DeviceMemoryPool> pool;
+  ASSERT_TRUE(fletcher::DeviceMemoryPool::Make(&pool, platform, 4096, 64).ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform, pool).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  std::vector<fletcher::FieldQueueSizes> fields;
+  auto predicted = context->GetQueueSizes(&fields);
+  ASSERT_EQ(fields.size(), 2);
+  ASSERT_EQ(fields[1].recordbatch, 0);
+  ASSERT_EQ(fields[1].field, "c");
+  ASSERT_EQ(fields[1].sizes.kernel, 32);
+  ASSERT_EQ(predicted.kernel, 64);
+  ASSERT_EQ(predicted.transfer, 64);
+  ASSERT_EQ(predicted.allocate, 128);
+  ASSERT_EQ(predicted.resident, 0);
+
+  // Once enabled, the sizes follow from the device buffers, and match the prediction.
+  ASSERT_TRUE(context->Enable().ok());
+  auto enabled = context->GetQueueSizes();
+  ASSERT_EQ(enabled.transfer, predicted.transfer);
+  ASSERT_EQ(enabled.allocate, predicted.allocate);
+  ASSERT_EQ(enabled.kernel, predicted.kernel);
+  context.reset();
+
+  // Buffers that are resident in a ResidencyCache need not be transferred.
+  std::shared_ptr<fletcher::ResidencyCache> cache;
+  ASSERT_TRUE(fletcher::ResidencyCache::Make(&cache, platform, 64).ok());
+  std::shared_ptr<fletcher::Context> first;
+  ASSERT_TRUE(fletcher::Context::Make(&first, platform).ok());
+  ASSERT_TRUE(first->SetResidencyCache(cache).ok());
+  ASSERT_TRUE(first->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_EQ(first->GetQueueSizes().transfer, 64);
+  ASSERT_TRUE(first->Enable().ok());
+  std::shared_ptr<fletcher::Context> second;
+  ASSERT_TRUE(fletcher::Context::Make(&second, platform).ok());
+  ASSERT_TRUE(second->SetResidencyCache(cache).ok());
+  ASSERT_TRUE(second->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  predicted = second->GetQueueSizes();
+  ASSERT_EQ(predicted.resident, 64);
+  ASSERT_EQ(predicted.transfer, 0);
+  ASSERT_EQ(predicted.allocate, 0);
+
+  second.reset();
+  first.reset();
+  cache.reset();
+  pool.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, BufferAlignment) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("s", arrow::utf8(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4, 5, 6, 7, 8}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  arrow::StringBuilder bs;
+  ASSERT_TRUE(bs.AppendValues({"w", "xx", "yyy", "zzzz", "w", "xx", "yyy", "zzzz"}).ok());
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(bs.Finish(&s).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 8, {a, s});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_FALSE(context->SetBufferAlignment(48).ok());
+  ASSERT_TRUE(context->SetBufferAlignment(64).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb->Slice(1, 2)).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_FALSE(context->SetBufferAlignment(32).ok());
+  ASSERT_EQ(context->num_buffers(), 6);
+
+  // The values of the whole RecordBatch are aligned and exactly 64 bytes, so they are prepared as usual.
+  auto values = context->device_buffer(0);
+  ASSERT_FALSE(values.staged);
+  ASSERT_EQ(values.capacity, values.size);
+
+  // The offsets and characters are not a multiple of 64 bytes, and the sliced buffers are misaligned as well, so they
+  // are staged and padded with zeros.
+  for (size_t i = 1; i < context->num_buffers(); i++) {
+    auto buf = context->device_buffer(i);
+    ASSERT_TRUE(buf.staged);
+    ASSERT_FALSE(buf.host_visible());
+    ASSERT_EQ(buf.capacity % 64, 0);
+    ASSERT_GE(buf.capacity, buf.size);
+    auto device = reinterpret_cast<const uint8_t *>(buf.device_address);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(device) % 64, 0);
+    ASSERT_EQ(memcmp(device, buf.host_address, buf.size), 0);
+    for (auto j = buf.size; j < buf.capacity; j++) {
+      ASSERT_EQ(device[j], 0);
+    }
+  }
+
+  // The kernel still finds the first row of the slice at index zero.
+  auto kernel_values = reinterpret_cast<const uint64_t *>(context->device_buffer(3).kernel_address());
+  ASSERT_EQ(kernel_values[0], 2);
+  ASSERT_EQ(kernel_values[1], 3);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ArrowCDataInterface) {
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+
+  // Batches imported by the Context use the exported buffers in place.
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  struct ArrowArray c_array;
+  struct ArrowSchema c_schema;
+  ASSERT_TRUE(arrow::ExportRecordBatch(*rb, &c_array, &c_schema).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(&c_array, &c_schema).ok());
+  ASSERT_EQ(c_array.release, nullptr);
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->device_buffer(0).host_address, arr->data()->buffers[1]->data());
+  ASSERT_TRUE(context->ExportRecordBatch(0, &c_array, &c_schema).ok());
+  auto imported = arrow::ImportRecordBatch(&c_array, &c_schema);
+  ASSERT_TRUE(imported.ok());
+  ASSERT_TRUE(imported.ValueOrDie()->Equals(*rb));
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+
+  // The same through the C API.
+  fplatform_t c_platform = nullptr;
+  fcontext_t c_context = nullptr;
+  fkernel_t c_kernel = nullptr;
+  ASSERT_EQ(fletcherPlatformCreate("echo", &c_platform), FLETCHER_STATUS_OK);
+  ASSERT_EQ(fletcherPlatformInit(c_platform, nullptr), FLETCHER_STATUS_OK);
+  ASSERT_EQ(fletcherContextCreate(c_platform, &c_context), FLETCHER_STATUS_OK);
+  ASSERT_TRUE(arrow::ExportRecordBatch(*rb, &c_array, &c_schema).ok());
+  ASSERT_EQ(fletcherContextQueueArrowArray(c_context, &c_array, &c_schema, FLETCHER_MEM_CACHE), FLETCHER_STATUS_OK);
+  ASSERT_EQ(fletcherContextEnable(c_context), FLETCHER_STATUS_OK);
+  ASSERT_EQ(fletcherKernelCreate(c_context, 0, &c_kernel), FLETCHER_STATUS_OK);
+  uint32_t args[] = {42};
+  ASSERT_EQ(fletcherKernelSetArguments(c_kernel, args, 1), FLETCHER_STATUS_OK);
+  ASSERT_NE(fletcherContextExportArrowArray(c_context, 1, &c_array, &c_schema, -1), FLETCHER_STATUS_OK);
+  ASSERT_NE(std::string(fletcherLastError()), "");
+  fletcherKernelDestroy(c_kernel);
+  fletcherContextDestroy(c_context);
+  fletcherPlatformDestroy(c_platform);
+}
+
+TEST(Context, LazyEnable) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  // A nullable field without nulls has an implicit validity buffer, and the hardware ignores the last field.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("n", arrow::uint64(), true),
+                               fletcher::WithMetaIgnore(*arrow::field("i", arrow::uint64(), false))});
+  std::vector<std::shared_ptr<arrow::Array>> columns;
+  for (int c = 0; c < 3; c++) {
+    arrow::UInt64Builder b;
+    ASSERT_TRUE(b.AppendValues({1, 2, 3}).ok());
+    std::shared_ptr<arrow::Array> arr;
+    ASSERT_TRUE(b.Finish(&arr).ok());
+    columns.push_back(arr);
+  }
+  auto rb = arrow::RecordBatch::Make(schema, 3, columns);
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // Buffers keep their position in the register map, but only the accessed ones are transferred.
+  ASSERT_EQ(context->num_buffers(), 4);
+  ASSERT_TRUE(context->device_buffer(0).was_alloced);
+  ASSERT_FALSE(context->device_buffer(1).was_alloced);
+  ASSERT_EQ(context->device_buffer(1).device_address, D_NULLPTR);
+  ASSERT_TRUE(context->device_buffer(2).was_alloced);
+  ASSERT_FALSE(context->device_buffer(3).was_alloced);
+  ASSERT_EQ(context->device_buffer(3).device_address, D_NULLPTR);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Platform, CopyHostToDeviceV) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  ASSERT_TRUE(platform->HasCopyHostToDeviceV());
+
+  uint8_t a[] = {1, 2, 3};
+  uint8_t b[] = {4, 5};
+  da_t da, db;
+  ASSERT_TRUE(platform->DeviceMalloc(&da, sizeof(a)).ok());
+  ASSERT_TRUE(platform->DeviceMalloc(&db, sizeof(b)).ok());
+  fiov_t iov[] = {{a, da, sizeof(a)}, {b, db, sizeof(b)}};
+  ASSERT_TRUE(platform->CopyHostToDeviceV(iov, 2).ok());
+  ASSERT_EQ(memcmp(reinterpret_cast<uint8_t *>(da), a, sizeof(a)), 0);
+  ASSERT_EQ(memcmp(reinterpret_cast<uint8_t *>(db), b, sizeof(b)), 0);
+
+  ASSERT_TRUE(platform->DeviceFree(da).ok());
+  ASSERT_TRUE(platform->DeviceFree(db).ok());
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Platform, Registry) {
+  std::shared_ptr<fletcher::Platform> a, b;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &a, false).ok());
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &b, false).ok());
+
+  // Instances are distinct but share the cached library.
+  ASSERT_NE(a, b);
+  ASSERT_EQ(a->platformInit, b->platformInit);
+  ASSERT_EQ(a->platformCopyHostToDeviceV, b->platformCopyHostToDeviceV);
+
+  // Failures are cached as well.
+  std::shared_ptr<fletcher::Platform> c;
+  ASSERT_EQ(fletcher::Platform::Make("DEADBEEF", &c), fletcher::Status::NO_PLATFORM());
+  ASSERT_EQ(fletcher::Platform::Make("DEADBEEF", &c), fletcher::Status::NO_PLATFORM());
+  ASSERT_EQ(c, nullptr);
+
+  // Autodetection yields the same platform every time.
+  std::shared_ptr<fletcher::Platform> d, e;
+  ASSERT_TRUE(fletcher::Platform::Make(&d).ok());
+  ASSERT_TRUE(fletcher::Platform::Make(&e).ok());
+  ASSERT_EQ(d->name(), e->name());
+}
+
+TEST(Platform, MultipleDevices) {
+  setenv("FLETCHER_ECHO_DEVICES", "2", 1);
+  uint64_t count = 0;
+  ASSERT_TRUE(fletcher::Platform::DeviceCount("echo", &count).ok());
+  ASSERT_EQ(count, 2);
+  std::shared_ptr<fletcher::Platform> missing;
+  ASSERT_FALSE(fletcher::Platform::Make("echo", 2, &missing).ok());
+  ASSERT_EQ(missing, nullptr);
+
+  std::vector<std::shared_ptr<fletcher::Platform>> platforms;
+  ASSERT_TRUE(fletcher::Platform::MakeAll("echo", &platforms).ok());
+  ASSERT_EQ(platforms.size(), 2);
+  ASSERT_EQ(platforms[0]->device(), 0);
+  ASSERT_EQ(platforms[1]->device(), 1);
+  for (const auto &p : platforms) {
+    ASSERT_TRUE(p->Init().ok());
+  }
+
+  // Acquisitions go to the least loaded device.
+  std::shared_ptr<fletcher::DevicePool> pool;
+  ASSERT_TRUE(fletcher::DevicePool::Make(&pool, platforms).ok());
+  size_t a = 0, b = 0, c = 0;
+  ASSERT_TRUE(pool->Acquire({}, &a).ok());
+  ASSERT_TRUE(pool->Acquire({}, &b).ok());
+  ASSERT_NE(a, b);
+  ASSERT_TRUE(pool->Release(a).ok());
+  ASSERT_TRUE(pool->Acquire({}, &c).ok());
+  ASSERT_EQ(c, a);
+  ASSERT_TRUE(pool->Release(b).ok());
+  ASSERT_TRUE(pool->Release(c).ok());
+  ASSERT_FALSE(pool->Release(c).ok());
+
+  // Acquisitions follow the data that is resident on a device.
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({0, 1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+  std::shared_ptr<fletcher::DevicePool> local;
+  ASSERT_TRUE(fletcher::DevicePool::Make(&local, platforms, fletcher::DevicePool::Policy::LOCALITY, 1024).ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(local->MakeContext(1, &context).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  context.reset();
+  ASSERT_TRUE(local->cache(1)->IsResident(arr->data()->buffers[1]->data(), 32));
+  size_t d = 0;
+  ASSERT_TRUE(local->Acquire({rb}, &d).ok());
+  ASSERT_EQ(d, 1);
+  ASSERT_TRUE(local->Release(d).ok());
+
+  ASSERT_TRUE(local->Run({rb}, [&](fletcher::Kernel *kernel) {
+    return kernel->context()->platform()->device() == 1 ? fletcher::Status::OK() : fletcher::Status::ERROR();
+  }).ok());
+  ASSERT_EQ(local->stats().devices[1].acquisitions, 2);
+  ASSERT_EQ(local->stats().devices[1].in_flight, 0);
+
+  local.reset();
+  pool.reset();
+  for (const auto &p : platforms) {
+    ASSERT_TRUE(p->Terminate().ok());
+  }
+  unsetenv("FLETCHER_ECHO_DEVICES");
+}
+
+TEST(Platform, NumaStaging) {
+  // A buffer that spans more than one bounce buffer.
+  std::vector<uint8_t> host(fletcher::kNumaBounceBytes + 100);
+  for (size_t i = 0; i < host.size(); i++) {
+    host[i] = static_cast<uint8_t>(i * 7);
+  }
+  // Pretend the device is attached to another node than the buffer.
+  auto node = fletcher::NumaNodeOf(host.data());
+  setenv("FLETCHER_ECHO_NUMA_NODE", std::to_string(node + 1).c_str(), 1);
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+  ASSERT_EQ(platform->numa_node(), node + 1);
+  ASSERT_EQ(fletcher::IsNumaRemote(platform.get(), host.data()), node >= 0);
+  ASSERT_TRUE(fletcher::PinThreadToNode(-1).ok());
+
+  da_t device = D_NULLPTR;
+  ASSERT_TRUE(platform->DeviceMalloc(&device, host.size()).ok());
+  ASSERT_TRUE(fletcher::NumaCopyHostToDevice(platform.get(), host.data(), device, host.size()).ok());
+  ASSERT_EQ(memcmp(host.data(), reinterpret_cast<const uint8_t *>(device), host.size()), 0);
+  ASSERT_TRUE(platform->DeviceFree(device).ok());
+  ASSERT_TRUE(platform->Terminate().ok());
+  unsetenv("FLETCHER_ECHO_NUMA_NODE");
+}
+
+TEST(Context, TiledContext) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false),
+                               arrow::field("s", arrow::utf8(), false)});
+  arrow::UInt64Builder ba;
+  arrow::StringBuilder bs;
+  for (uint64_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(ba.Append(i).ok());
+    ASSERT_TRUE(bs.Append(std::string(i % 7, 'x')).ok());
+  }
+  std::shared_ptr<arrow::Array> a;
+  std::shared_ptr<arrow::Array> s;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  ASSERT_TRUE(bs.Finish(&s).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 100, {a, s});
+
+  std::shared_ptr<fletcher::TiledContext> context;
+  ASSERT_FALSE(fletcher::TiledContext::Make(&context, platform, 0).ok());
+  ASSERT_TRUE(fletcher::TiledContext::Make(&context, platform, 512).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+
+  // The tiles are contiguous and cover all rows.
+  std::vector<fletcher::RowRange> tiles;
+  ASSERT_TRUE(context->Plan(&tiles).ok());
+  ASSERT_GT(tiles.size(), 1);
+  ASSERT_EQ(tiles.front().first, 0);
+  ASSERT_EQ(tiles.back().last, 100);
+  for (size_t i = 1; i < tiles.size(); i++) {
+    ASSERT_EQ(tiles[i].first, tiles[i - 1].last);
+  }
+
+  // The device addresses are offset such that rows are found at their index in the RecordBatch.
+  auto tile = tiles[1];
+  ASSERT_TRUE(context->LoadTile(tile).ok());
+  ASSERT_EQ(context->num_buffers(), 3);
+  auto values = reinterpret_cast<const uint64_t *>(context->device_buffer(0).device_address);
+  auto offsets = reinterpret_cast<const int32_t *>(context->device_buffer(1).device_address);
+  auto chars = reinterpret_cast<const char *>(context->device_buffer(2).device_address);
+  auto sa = std::static_pointer_cast<arrow::StringArray>(s);
+  for (int32_t i = tile.first; i < tile.last; i++) {
+    ASSERT_EQ(values[i], static_cast<uint64_t>(i));
+    ASSERT_EQ(offsets[i], sa->value_offset(i));
+    ASSERT_EQ(std::string(chars + offsets[i], offsets[i + 1] - offsets[i]), sa->GetString(i));
+  }
+
+  // Rows that do not fit can not be tiled.
+  std::shared_ptr<fletcher::TiledContext> small;
+  ASSERT_TRUE(fletcher::TiledContext::Make(&small, platform, 64).ok());
+  ASSERT_TRUE(small->QueueRecordBatch(rb).ok());
+  ASSERT_FALSE(small->Plan(&tiles).ok());
+
+  context.reset();
+  small.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, QueueRecordBatchesFromFile) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+  fletcher::WriteRecordBatchesToFile("test-runtime-map.rb", {rb});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_FALSE(context->QueueRecordBatchesFromFile("does-not-exist.rb").ok());
+  ASSERT_TRUE(context->QueueRecordBatchesFromFile("test-runtime-map.rb").ok());
+  ASSERT_EQ(context->num_recordbatches(), 1);
+  ASSERT_TRUE(context->recordbatch(0)->Equals(*rb));
+  ASSERT_TRUE(context->Enable().ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, CompressedRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  // The uncompressed length of four uint64 values, followed by an LZ4 frame.
+  std::vector<uint8_t> bytes = {32, 0, 0, 0, 0, 0, 0, 0, 0x04, 0x22, 0x4D, 0x18, 0x60, 0x40, 0x82, 0, 0, 0, 0};
+  auto buffer = std::make_shared<arrow::Buffer>(bytes.data(), bytes.size());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(fletcher::MakeCompressedArray(arrow::uint64(), 4, buffer, &arr));
+  auto schema = arrow::schema({fletcher::WithMetaCompression(*arrow::field("a", arrow::uint64(), false))});
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+
+  // Only the compressed bytes are made available to the device.
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_EQ(context->GetQueueSize(), bytes.size());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->device_buffer(0).size, static_cast<int64_t>(bytes.size()));
+
+  // Buffers that do not hold the uncompressed length of the values are rejected.
+  auto sliced = rb->Slice(1);
+  ASSERT_FALSE(context->QueueRecordBatch(sliced).ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, RunEndEncodedRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  arrow::UInt64Builder builder;
+  ASSERT_TRUE(builder.AppendValues({1, 1, 1, 1, 2, 2, 3, 3}).ok());
+  std::shared_ptr<arrow::Array> plain;
+  ASSERT_TRUE(builder.Finish(&plain).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(fletcher::RunEndEncode(plain, &arr));
+  auto schema = arrow::schema({fletcher::WithMetaRunEndEncoding(*arrow::field("a", arrow::uint64(), false))});
+  auto rb = arrow::RecordBatch::Make(schema, 8, {arr});
+
+  // Only the three runs are made available to the device.
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_EQ(context->GetQueueSize(), 3 * (sizeof(int32_t) + sizeof(uint64_t)));
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->device_buffer(0).size, 3 * static_cast<int64_t>(sizeof(int32_t)));
+  ASSERT_EQ(context->device_buffer(1).size, 3 * static_cast<int64_t>(sizeof(uint64_t)));
+
+  // Slices of run-end encoded columns are rejected.
+  auto sliced = rb->Slice(1);
+  ASSERT_FALSE(context->QueueRecordBatch(sliced).ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ParquetEncodedRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  // A data page of five nullable uint32 values, of which the second and fifth are null. The definition levels are a
+  // single bit-packed group, followed by the three non-null values.
+  std::vector<uint8_t> bytes = {2, 0, 0, 0, 3, 0x0D, 10, 0, 0, 0, 30, 0, 0, 0, 40, 0, 0, 0};
+  auto buffer = std::make_shared<arrow::Buffer>(bytes.data(), bytes.size());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(fletcher::MakeParquetPageArray(arrow::uint32(), 5, true, buffer, &arr));
+  ASSERT_EQ(arr->null_count(), 2);
+  auto schema = arrow::schema({fletcher::WithMetaParquetEncoding(*arrow::field("a", arrow::uint32(), true))});
+  auto rb = arrow::RecordBatch::Make(schema, 5, {arr});
+
+  // Only the page is made available to the device, without a validity bitmap.
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb, fletcher::MemType::CACHE).ok());
+  ASSERT_EQ(context->GetQueueSize(), bytes.size());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->num_buffers(), 1);
+  ASSERT_EQ(context->device_buffer(0).size, static_cast<int64_t>(bytes.size()));
+
+  // Slices of Parquet-encoded columns are rejected.
+  auto sliced = rb->Slice(1);
+  ASSERT_FALSE(context->QueueRecordBatch(sliced).ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, OnChipRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({fletcher::WithMetaOnChip(*arrow::field("lut", arrow::uint32(), false), 4)});
+  arrow::UInt32Builder builder;
+  ASSERT_TRUE(builder.AppendValues({1, 2, 3, 4, 5}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(builder.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 5, {arr});
+
+  // RecordBatches with more rows than the cache holds are rejected.
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_FALSE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb->Slice(0, 4)).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, Layout) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::stringstream manifest("# name function behavior register bit_index bit_width\n"
+                             "start default strobe 0 0 1\n"
+                             "S_firstidx batch control 4 0 32\n"
+                             "S_lastidx batch control 5 0 32\n"
+                             "S_a_values buffer control 6 0 64\n"
+                             "S_s_offsets buffer control 8 0 64\n"
+                             "S_s_values buffer control 10 0 64\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+
+  // The columns are in another order than the registers, and there is an extra column.
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("x", arrow::uint32(), false),
+                                                           arrow::field("s", arrow::utf8(), false),
+                                                           arrow::field("a", arrow::uint64(), false)}),
+                                           "S",
+                                           fletcher::Mode::READ);
+  arrow::UInt32Builder xb;
+  arrow::StringBuilder sb;
+  arrow::UInt64Builder ab;
+  ASSERT_TRUE(xb.AppendValues({1, 2}).ok());
+  ASSERT_TRUE(sb.AppendValues({"foo", "bar"}).ok());
+  ASSERT_TRUE(ab.AppendValues({3, 4}).ok());
+  std::shared_ptr<arrow::Array> x, s, a;
+  ASSERT_TRUE(xb.Finish(&x).ok());
+  ASSERT_TRUE(sb.Finish(&s).ok());
+  ASSERT_TRUE(ab.Finish(&a).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 2, {x, s, a});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->SetLayout(registers).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  auto queued = context->recordbatch(0);
+  ASSERT_EQ(queued->num_columns(), 2);
+  ASSERT_EQ(queued->schema()->field(0)->name(), "a");
+  ASSERT_EQ(queued->schema()->field(1)->name(), "s");
+  ASSERT_EQ(queued->column(0), a);
+  ASSERT_EQ(context->recordbatch_description(0).fields[0].buffers[0].desc_, std::vector<std::string>({"a", "values"}));
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->num_buffers(), 3u);
+  ASSERT_EQ(context->device_buffer(0).host_address, a->data()->buffers[1]->data());
+
+  // RecordBatches that lack a field of the kernel are rejected.
+  ASSERT_FALSE(context->QueueRecordBatch(rb->RemoveColumn(2).ValueOrDie()).ok());
+  ASSERT_EQ(context->num_recordbatches(), 1u);
+
+  // A replacement in yet another column order is arranged as well, such that its buffers map to the same registers.
+  auto reordered_schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("s", arrow::utf8(), false),
+                                                                     arrow::field("x", arrow::uint32(), false),
+                                                                     arrow::field("a", arrow::uint64(), false)}),
+                                                     "S",
+                                                     fletcher::Mode::READ);
+  std::shared_ptr<arrow::Array> s2, a2;
+  ASSERT_TRUE(sb.AppendValues({"baz", "qux"}).ok());
+  ASSERT_TRUE(ab.AppendValues({5, 6}).ok());
+  ASSERT_TRUE(sb.Finish(&s2).ok());
+  ASSERT_TRUE(ab.Finish(&a2).ok());
+  auto reordered = arrow::RecordBatch::Make(reordered_schema, 2, {s2, x, a2});
+  ASSERT_TRUE(context->ReplaceRecordBatch(0, reordered).ok());
+  ASSERT_EQ(context->recordbatch(0)->schema()->field(0)->name(), "a");
+  ASSERT_EQ(context->device_buffer(0).host_address, a2->data()->buffers[1]->data());
+  ASSERT_EQ(context->device_buffer(1).host_address, s2->data()->buffers[1]->data());
+  ASSERT_EQ(context->device_buffer(2).host_address, s2->data()->buffers[2]->data());
+  context.reset();
+
+  // Pushed RecordBatches are arranged, also when the column order changes between RecordBatches.
+  std::shared_ptr<fletcher::StreamingContext> streaming;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&streaming, platform, 3).ok());
+  ASSERT_TRUE(streaming->SetLayout(registers).ok());
+  ASSERT_TRUE(streaming->Push(rb).ok());
+  ASSERT_TRUE(streaming->Push(reordered).ok());
+  ASSERT_TRUE(streaming->Rotate().ok());
+  ASSERT_EQ(streaming->recordbatch(0)->num_columns(), 2);
+  ASSERT_EQ(streaming->device_buffer(0).host_address, a->data()->buffers[1]->data());
+  ASSERT_EQ(streaming->device_buffer(2).host_address, s->data()->buffers[2]->data());
+  ASSERT_TRUE(streaming->Rotate().ok());
+  ASSERT_EQ(streaming->device_buffer(0).host_address, a2->data()->buffers[1]->data());
+  ASSERT_EQ(streaming->device_buffer(2).host_address, s2->data()->buffers[2]->data());
+  streaming.reset();
+
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Context, ParallelRecordBatch) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto values_type = arrow::struct_({arrow::field("x", arrow::uint32(), false),
+                                     arrow::field("y", arrow::uint64(), false)});
+  auto schema = arrow::schema({fletcher::WithMetaParallel(
+      *arrow::field("points", arrow::list(arrow::field("point", values_type, false)), false))});
+  arrow::UInt32Builder xb;
+  arrow::UInt64Builder yb;
+  ASSERT_TRUE(xb.AppendValues({1, 2, 3}).ok());
+  ASSERT_TRUE(yb.AppendValues({4, 5, 6}).ok());
+  std::shared_ptr<arrow::Array> x, y, offsets;
+  ASSERT_TRUE(xb.Finish(&x).ok());
+  ASSERT_TRUE(yb.Finish(&y).ok());
+  arrow::Int32Builder ob;
+  ASSERT_TRUE(ob.AppendValues({0, 2, 3}).ok());
+  ASSERT_TRUE(ob.Finish(&offsets).ok());
+  auto values = std::make_shared<arrow::StructArray>(values_type, 3, arrow::ArrayVector{x, y});
+  auto list = arrow::ListArray::FromArrays(*offsets, *values).ValueOrDie();
+  auto rb = arrow::RecordBatch::Make(schema, 2, {list});
+
+  // The field is split into a list per child, which both read the offsets buffer.
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_EQ(context->recordbatch(0)->num_columns(), 2);
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->num_buffers(), 4u);
+  ASSERT_EQ(context->device_buffer(0).host_address, context->device_buffer(2).host_address);
+  context.reset();
+
+  // Pushed RecordBatches are split in the same way.
+  std::shared_ptr<fletcher::StreamingContext> streaming;
+  ASSERT_TRUE(fletcher::StreamingContext::Make(&streaming, platform, 2).ok());
+  ASSERT_TRUE(streaming->Push(rb).ok());
+  ASSERT_TRUE(streaming->Rotate().ok());
+  ASSERT_EQ(streaming->recordbatch(0)->num_columns(), 2);
+  ASSERT_EQ(streaming->num_buffers(), 4u);
+  ASSERT_EQ(streaming->device_buffer(0).host_address, streaming->device_buffer(2).host_address);
+  streaming.reset();
+
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, LargeIndices) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("s", arrow::large_utf8(), false)});
+  arrow::LargeStringBuilder bs;
+  ASSERT_TRUE(bs.AppendValues({"a", "bc", "def"}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(bs.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 3, {arr});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // Schemas with 64-bit offsets get 64-bit first and last index registers, least significant word first.
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 2, &value).ok());
+  ASSERT_EQ(value, 3);
+  ASSERT_TRUE(kernel.SetRange(0, 1, 0x100000002).ok());
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA, &value).ok());
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 2, &value).ok());
+  ASSERT_EQ(value, 2);
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 3, &value).ok());
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(kernel.SetArguments({42}).ok());
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 4 + 2 * context->num_buffers(), &value).ok());
+  ASSERT_EQ(value, 42);
+
+  // Kernels with 32-bit indices can not take ranges beyond 32 bits.
+  kernel.index_width = 32;
+  ASSERT_FALSE(kernel.SetRange(0, 0, 0x100000000).ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, Projection) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint32(), false),
+                               fletcher::WithMetaIgnore(*arrow::field("b", arrow::uint32(), false)),
+                               arrow::field("c", arrow::uint32(), false)});
+  arrow::UInt32Builder ba, bb, bc;
+  ASSERT_TRUE(ba.AppendValues({1, 2}).ok());
+  ASSERT_TRUE(bb.AppendValues({3, 4}).ok());
+  ASSERT_TRUE(bc.AppendValues({5, 6}).ok());
+  std::shared_ptr<arrow::Array> a, b, c;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  ASSERT_TRUE(bb.Finish(&b).ok());
+  ASSERT_TRUE(bc.Finish(&c).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 2, {a, b, c});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // Kernels without enable registers can not project fields.
+  fletcher::Kernel kernel(context);
+  ASSERT_FALSE(kernel.SetProjection({"a"}).ok());
+
+  // Every field that is not ignored has an enable register, right after the buffer addresses.
+  kernel.projection = true;
+  auto enable = FLETCHER_REG_SCHEMA + 2 + 2 * context->num_buffers();
+  ASSERT_TRUE(kernel.SetProjection({"c"}).ok());
+  uint32_t value = 1;
+  ASSERT_TRUE(platform->ReadMMIO(enable, &value).ok());
+  ASSERT_EQ(value, 0);
+  ASSERT_TRUE(platform->ReadMMIO(enable + 1, &value).ok());
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(kernel.SetProjection({}).ok());
+  ASSERT_TRUE(platform->ReadMMIO(enable, &value).ok());
+  ASSERT_EQ(value, 1);
+  ASSERT_FALSE(kernel.SetProjection({"d"}).ok());
+
+  // Custom registers follow the enable registers.
+  ASSERT_TRUE(kernel.SetArguments({42}).ok());
+  ASSERT_TRUE(platform->ReadMMIO(enable + 2, &value).ok());
+  ASSERT_EQ(value, 42);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, AllValid) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint32(), true),
+                               arrow::field("b", arrow::uint32(), true),
+                               arrow::field("c", arrow::uint32(), false)});
+  arrow::UInt32Builder ba, bb, bc;
+  ASSERT_TRUE(ba.AppendValues({1, 2}).ok());
+  ASSERT_TRUE(bb.Append(3).ok());
+  ASSERT_TRUE(bb.AppendNull().ok());
+  ASSERT_TRUE(bc.AppendValues({5, 6}).ok());
+  std::shared_ptr<arrow::Array> a, b, c;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  ASSERT_TRUE(bb.Finish(&b).ok());
+  ASSERT_TRUE(bc.Finish(&c).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 2, {a, b, c});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  // The validity bitmap of the field without nulls is not transferred to the device.
+  ASSERT_EQ(context->num_buffers(), 5u);
+  ASSERT_EQ(context->device_buffer(0).device_address, D_NULLPTR);
+  ASSERT_NE(context->device_buffer(2).device_address, D_NULLPTR);
+
+  // Every validity bitmap has an all valid register, right after the buffer addresses.
+  fletcher::Kernel kernel(context);
+  kernel.all_valid = true;
+  std::vector<uint32_t> regs;
+  kernel.GatherMetaData(&regs);
+  ASSERT_EQ(regs.size(), 2 + 2 * context->num_buffers() + 2);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+  auto flags = FLETCHER_REG_SCHEMA + 2 + 2 * context->num_buffers();
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(flags, &value).ok());
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(platform->ReadMMIO(flags + 1, &value).ok());
+  ASSERT_EQ(value, 0);
+
+  // Custom registers follow the all valid registers.
+  ASSERT_TRUE(kernel.SetArguments({42}).ok());
+  ASSERT_TRUE(platform->ReadMMIO(flags + 2, &value).ok());
+  ASSERT_EQ(value, 42);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, Mmio64) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  ASSERT_TRUE(platform->HasMMIO64());
+
+  // Register pairs are written with a single access, the lower register holding the lower bits.
+  ASSERT_TRUE(platform->WriteMMIO64(10, 0x0123456789ABCDEF).ok());
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(10, &value).ok());
+  ASSERT_EQ(value, 0x89ABCDEF);
+  ASSERT_TRUE(platform->ReadMMIO(11, &value).ok());
+  ASSERT_EQ(value, 0x01234567);
+  uint64_t value64 = 0;
+  ASSERT_TRUE(platform->ReadMMIO64(10, &value64).ok());
+  ASSERT_EQ(value64, 0x0123456789ABCDEF);
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint32(), false)});
+  arrow::UInt32Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 3, {a});
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // The metadata starts at an odd register, and is written as a single register followed by aligned pairs.
+  fletcher::Kernel kernel(context);
+  kernel.mmio64 = true;
+  std::vector<uint32_t> regs;
+  kernel.GatherMetaData(&regs);
+  ASSERT_TRUE(kernel.WriteMetaData().ok());
+  for (size_t i = 0; i < regs.size(); i++) {
+    ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + i, &value).ok());
+    ASSERT_EQ(value, regs[i]);
+  }
+  ASSERT_TRUE(kernel.SetArguments({1, 2, 3}).ok());
+  for (uint32_t i = 0; i < 3; i++) {
+    ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + regs.size() + i, &value).ok());
+    ASSERT_EQ(value, i + 1);
+  }
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, EchoModel) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 2000;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 4, {arr});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // Registers hold the values written to them, and the kernel completes after the modeled latency.
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(kernel.SetArguments({42}).ok());
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 2 + 2 * context->num_buffers(), &value).ok());
+  ASSERT_EQ(value, 42);
+  fletcher::Timer t;
+  t.start();
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone().ok());
+  t.stop();
+  ASSERT_GE(t.seconds(), 0.002);
+  ASSERT_EQ(context->GetStats()[fletcher::Phase::COMPLETION].count, 1);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, WaitUntilDone) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 2000;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  fletcher::Kernel kernel(context);
+  fletcher::Timer t;
+
+  // A kernel that completes within the spin window is noticed without waiting for a poll interval.
+  t.start();
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone(200000, 100000).ok());
+  t.stop();
+  ASSERT_GE(t.seconds(), 0.002);
+  ASSERT_LT(t.seconds(), 0.1);
+
+  // After the spin window, the status register is checked once every poll interval.
+  t.start();
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone(500, 100000).ok());
+  t.stop();
+  ASSERT_GE(t.seconds(), 0.1);
+
+  // Without a spin window, the kernel is polled right away.
+  t.start();
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone(0, 100000).ok());
+  t.stop();
+  ASSERT_GE(t.seconds(), 0.1);
+  ASSERT_EQ(context->GetStats()[fletcher::Phase::COMPLETION].count, 3);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+/// @brief A functional model of a kernel that sums a uint64 column, for the echo platform.
+static void SumKernel(uint32_t *regs, uint64_t instance, void *user_data) {
+  (void) instance;
+  *static_cast<int *>(user_data) += 1;
+  auto first = regs[FLETCHER_REG_SCHEMA];
+  auto last = regs[FLETCHER_REG_SCHEMA + 1];
+  auto values = reinterpret_cast<const uint64_t *>(regs[FLETCHER_REG_SCHEMA + 2]
+                                                   | static_cast<uint64_t>(regs[FLETCHER_REG_SCHEMA + 3]) << 32);
+  uint64_t sum = 0;
+  for (auto i = first; i < last; i++) {
+    sum += values[i];
+  }
+  regs[FLETCHER_REG_RETURN0] = static_cast<uint32_t>(sum);
+  regs[FLETCHER_REG_RETURN1] = static_cast<uint32_t>(sum >> 32);
+}
+
+TEST(Kernel, EchoFunctionalModel) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  int num_calls = 0;
+  InitOptions options = {};
+  options.kernel = SumKernel;
+  options.kernel_data = &num_calls;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4, (1ULL << 32)}).ok());
+  std::shared_ptr<arrow::Array> arr;
+  ASSERT_TRUE(ba.Finish(&arr).ok());
+  auto rb = arrow::RecordBatch::Make(schema, 5, {arr});
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(rb).ok());
+  ASSERT_TRUE(context->Enable().ok());
+
+  // The model runs on the buffers at the addresses written to the kernel, and is done when it returns.
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_EQ(num_calls, 1);
+  bool done = false;
+  ASSERT_TRUE(kernel.IsDone(&done).ok());
+  ASSERT_TRUE(done);
+  uint32_t ret0 = 0;
+  uint32_t ret1 = 0;
+  ASSERT_TRUE(kernel.GetReturn(&ret0, &ret1).ok());
+  ASSERT_EQ(ret0, 10);
+  ASSERT_EQ(ret1, 1);
+
+  // Only the range written to the kernel is processed.
+  ASSERT_TRUE(kernel.SetRange(0, 1, 3).ok());
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone().ok());
+  ASSERT_TRUE(kernel.GetReturn(&ret0, &ret1).ok());
+  ASSERT_EQ(ret0, 5);
+  ASSERT_EQ(ret1, 0);
+  ASSERT_EQ(num_calls, 2);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, ExecutionCycles) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 2000;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  fletcher::Kernel kernel(context);
+
+  uint32_t hz = 0;
+  ASSERT_TRUE(kernel.GetClockFrequency(&hz).ok());
+  ASSERT_EQ(hz, FLETCHER_ECHO_MODEL_CLOCK_HZ);
+  uint64_t cycles = 1;
+  ASSERT_TRUE(kernel.GetExecutionCycles(&cycles).ok());
+  ASSERT_EQ(cycles, 0);
+
+  // The cycles are counted from start until done, and exclude the time spent polling afterwards.
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone().ok());
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_TRUE(kernel.GetExecutionCycles(&cycles).ok());
+  ASSERT_NEAR(static_cast<double>(cycles), FLETCHER_ECHO_MODEL_CLOCK_HZ / 1000 * 2, 1.0);
+  double seconds = 0.0;
+  ASSERT_TRUE(kernel.GetExecutionTime(&seconds).ok());
+  ASSERT_DOUBLE_EQ(seconds, static_cast<double>(cycles) / hz);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, Cancel) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 1000000;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  fletcher::Kernel kernel(context);
+  uint32_t status = 0;
+
+  // The kernel keeps running after a wait times out, until it is cancelled.
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone(0, 100, 1000) == fletcher::Status::TIMEOUT());
+  ASSERT_TRUE(kernel.PollUntilDoneInterval(100, 1000) == fletcher::Status::TIMEOUT());
+  ASSERT_TRUE(kernel.GetStatus(&status).ok());
+  ASSERT_EQ(status, 1u << FLETCHER_REG_STATUS_BUSY);
+  ASSERT_TRUE(kernel.Cancel().ok());
+  ASSERT_TRUE(kernel.GetStatus(&status).ok());
+  ASSERT_EQ(status, 1u << FLETCHER_REG_STATUS_DONE);
+  ASSERT_EQ(context->GetStats()[fletcher::Phase::COMPLETION].count, 0);
+
+  // The monitor thread cancels kernels that miss their deadline.
+  std::shared_future<fletcher::Status> completion;
+  ASSERT_TRUE(kernel.StartAsync(&completion, 100, 1000).ok());
+  ASSERT_TRUE(completion.get() == fletcher::Status::TIMEOUT());
+  ASSERT_TRUE(kernel.GetStatus(&status).ok());
+  ASSERT_EQ(status, 1u << FLETCHER_REG_STATUS_DONE);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, ImplementsSchemaSet) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  fletcher::Kernel kernel(context);
+
+  auto read = fletcher::WithMetaRequired(*arrow::schema({arrow::field("a", arrow::uint64(), false)}),
+                                         "Read", fletcher::Mode::READ);
+  auto renamed = fletcher::WithMetaRequired(*arrow::schema({arrow::field("b", arrow::uint64(), false)}),
+                                            "Other", fletcher::Mode::READ);
+  auto write = fletcher::WithMetaRequired(*read, "Write", fletcher::Mode::WRITE);
+  // The echo model holds register values, so write the hash that a generated kernel would hold.
+  ASSERT_TRUE(platform->WriteMMIO(FLETCHER_REG_SCHEMA_HASH, fletcher::SchemaSetHash({read, write})).ok());
+  ASSERT_TRUE(kernel.ImplementsSchemaSet({read, write}));
+  ASSERT_TRUE(kernel.ImplementsSchemaSet({renamed, write}));
+  ASSERT_FALSE(kernel.ImplementsSchemaSet({write, read}));
+  ASSERT_FALSE(kernel.ImplementsSchemaSet({read}));
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, ImageCache) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  ASSERT_TRUE(platform->HasLoadImage());
+
+  auto a = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  auto b = arrow::schema({arrow::field("b", arrow::uint32(), false)});
+  auto c = arrow::schema({arrow::field("c", arrow::uint8(), false)});
+  std::shared_ptr<fletcher::ImageCache> cache;
+  ASSERT_TRUE(fletcher::ImageCache::Make(&cache, platform, 2).ok());
+  ASSERT_TRUE(cache->Register("a.bit", {a}).ok());
+  ASSERT_TRUE(cache->Register("b.bit", {b}).ok());
+  ASSERT_TRUE(cache->Register("c.bit", {c}).ok());
+  ASSERT_FALSE(cache->Register("other.bit", {a}).ok());
+
+  // The first region already holds the image for a.
+  ASSERT_TRUE(platform->WriteMMIO(FLETCHER_REG_SCHEMA_HASH, fletcher::SchemaSetHash({a})).ok());
+  uint64_t base = 1;
+  ASSERT_TRUE(cache->Acquire({a}, &base).ok());
+  ASSERT_EQ(base, 0);
+  ASSERT_EQ(cache->stats().loads, 0);
+  // An empty region is programmed before any image is evicted.
+  ASSERT_TRUE(cache->Acquire({b}, &base).ok());
+  ASSERT_EQ(base, FLETCHER_INSTANCE_WINDOW_REGS);
+  ASSERT_TRUE(cache->Acquire({a}, &base).ok());
+  ASSERT_EQ(base, 0);
+  // The least recently used image is evicted.
+  ASSERT_TRUE(cache->Acquire({c}, &base).ok());
+  ASSERT_EQ(base, FLETCHER_INSTANCE_WINDOW_REGS);
+  ASSERT_FALSE(cache->Acquire({arrow::schema({arrow::field("d", arrow::utf8())})}, &base).ok());
+
+  // Kernels are created on the region that holds the image for the RecordBatches of their context.
+  arrow::UInt8Builder builder;
+  ASSERT_TRUE(builder.AppendValues({1, 2, 3}).ok());
+  std::shared_ptr<arrow::Array> array;
+  ASSERT_TRUE(builder.Finish(&array).ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(arrow::RecordBatch::Make(c, 3, {array})).ok());
+  std::shared_ptr<fletcher::Kernel> kernel;
+  ASSERT_TRUE(fletcher::Kernel::Make(&kernel, context, cache.get()).ok());
+  ASSERT_EQ(kernel->mmio_base(), FLETCHER_INSTANCE_WINDOW_REGS);
+
+  auto stats = cache->stats();
+  ASSERT_EQ(stats.hits, 3);
+  ASSERT_EQ(stats.misses, 3);
+  ASSERT_EQ(stats.loads, 2);
+  ASSERT_EQ(stats.evictions, 1);
+
+  kernel.reset();
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, SubmissionQueue) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 100;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::shared_ptr<fletcher::SubmissionQueue> queue;
+  ASSERT_TRUE(fletcher::SubmissionQueue::Make(&queue, platform).ok());
+  ASSERT_FALSE(queue->Submit(nullptr).ok());
+
+  // Every thread prepares its own Context and submits launches that must not interleave with those of other threads.
+  constexpr uint32_t num_threads = 4;
+  constexpr uint32_t num_launches = 8;
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  std::vector<std::thread> threads;
+  std::atomic<uint32_t> num_ok{0};
+  for (uint32_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      arrow::UInt64Builder ba;
+      std::shared_ptr<arrow::Array> a;
+      if (!ba.AppendValues(std::vector<uint64_t>(t + 1, t)).ok() || !ba.Finish(&a).ok()) return;
+      std::shared_ptr<fletcher::Context> context;
+      if (!fletcher::Context::Make(&context, platform).ok()) return;
+      if (!context->QueueRecordBatch(arrow::RecordBatch::Make(schema, a->length(), {a})).ok()) return;
+      if (!context->Enable().ok()) return;
+
+      std::vector<std::shared_future<fletcher::Status>> completions(num_launches);
+      for (uint32_t l = 0; l < num_launches; l++) {
+        auto launch = [t, l, &platform](fletcher::Kernel *kernel) -> fletcher::Status {
+          auto status = kernel->SetArguments({t << 16 | l});
+          if (!status.ok()) return status;
+          status = kernel->Start();
+          if (!status.ok()) return status;
+          status = kernel->WaitUntilDone();
+          if (!status.ok()) return status;
+          // The metadata and arguments of this launch were not overwritten while it was running.
+          uint32_t last = 0;
+          uint32_t arg = 0;
+          platform->ReadMMIO(FLETCHER_REG_SCHEMA + 1, &last);
+          platform->ReadMMIO(FLETCHER_REG_SCHEMA + 4, &arg);
+          if ((last != t + 1) || (arg != (t << 16 | l))) {
+            return fletcher::Status::ERROR("Launch was interleaved with another launch.");
+          }
+          return fletcher::Status::OK();
+        };
+        if (!queue->Submit(context, launch, &completions[l]).ok()) return;
+      }
+      for (auto &c : completions) {
+        if (!c.get().ok()) return;
+      }
+      num_ok++;
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(num_ok.load(), num_threads);
+  ASSERT_EQ(queue->num_pending(), 0);
+
+  queue.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, SubmissionQueuePriority) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::shared_ptr<fletcher::SubmissionQueue> queue;
+  ASSERT_TRUE(fletcher::SubmissionQueue::Make(&queue, platform).ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues(std::vector<uint64_t>(10, 0)).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(arrow::RecordBatch::Make(schema, 10, {a})).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_FALSE(queue->Submit(context, nullptr, nullptr, fletcher::SubmissionQueue::Priority::LOW, -1).ok());
+
+  // Every launch records the range it was launched with. Launches are only performed by the drain thread.
+  std::vector<std::string> launches;
+  auto record = [&](const std::string &name) {
+    uint32_t first = 0;
+    uint32_t last = 0;
+    platform->ReadMMIO(FLETCHER_REG_SCHEMA, &first);
+    platform->ReadMMIO(FLETCHER_REG_SCHEMA + 1, &last);
+    launches.push_back(name + std::to_string(first) + "-" + std::to_string(last));
+    return fletcher::Status::OK();
+  };
+
+  // A bulk launch is chunked, and a latency-critical launch submitted during its first chunk is performed before the
+  // next chunk. Full-range launches in the same Context are not affected by the range of the chunks.
+  std::shared_future<fletcher::Status> high;
+  std::shared_future<fletcher::Status> low;
+  auto bulk = [&](fletcher::Kernel *) {
+    if (launches.empty()) {
+      queue->Submit(context, [&](fletcher::Kernel *) { return record("high"); }, &high,
+                    fletcher::SubmissionQueue::Priority::HIGH);
+    }
+    return record("low");
+  };
+  ASSERT_TRUE(queue->Submit(context, bulk, &low, fletcher::SubmissionQueue::Priority::LOW, 4).ok());
+  ASSERT_TRUE(low.get().ok());
+  ASSERT_TRUE(high.get().ok());
+  ASSERT_EQ(launches, std::vector<std::string>({"low0-4", "high0-10", "low4-8", "low8-10"}));
+  ASSERT_EQ(queue->num_pending(), 0);
+
+  queue.reset();
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, Profiler) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  auto kernel = std::make_shared<fletcher::Kernel>(context);
+
+  std::stringstream manifest("# name function behavior register bit_index bit_width\n"
+                             "start default strobe 0 0 1\n"
+                             "Profile_enable profile control 20 0 1\n"
+                             "Profile_clear profile strobe 21 0 1\n"
+                             "Profile_snapshot profile strobe 28 0 1\n"
+                             "Profile_a_0_elements profile status 22 0 32\n"
+                             "Profile_a_0_valids profile status 23 0 32\n"
+                             "Profile_a_0_readies profile status 24 0 32\n"
+                             "Profile_a_0_transfers profile status 25 0 32\n"
+                             "Profile_a_0_packets profile status 26 0 32\n"
+                             "Profile_a_0_cycles profile status 27 0 32\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  ASSERT_EQ(registers.size(), 10);
+  std::shared_ptr<fletcher::Profiler> profiler;
+  ASSERT_TRUE(fletcher::Profiler::Make(&profiler, kernel, registers).ok());
+  ASSERT_EQ(profiler->streams(), std::vector<std::string>({"a_0"}));
+
+  // The echo model holds register values, so the launch function plays the role of the profiled hardware.
+  std::vector<fletcher::StreamProfile> profiles;
+  ASSERT_TRUE(profiler->Run([&]() {
+    uint32_t enable = 0;
+    platform->ReadMMIO(20, &enable);
+    EXPECT_EQ(enable, 1);
+    const uint32_t counters[] = {64, 40, 20, 16, 1, 100};
+    return platform->WriteMMIOBatch(22, counters, 6);
+  }, &profiles).ok());
+  uint32_t enable = 1;
+  ASSERT_TRUE(platform->ReadMMIO(20, &enable).ok());
+  ASSERT_EQ(enable, 0);
+  // The counters are copied to the count registers before they are read.
+  uint32_t snapshot = 0;
+  ASSERT_TRUE(platform->ReadMMIO(28, &snapshot).ok());
+  ASSERT_EQ(snapshot, 1);
+  ASSERT_EQ(profiles.size(), 1);
+  ASSERT_EQ(profiles[0].elements, 64);
+  ASSERT_DOUBLE_EQ(profiles[0].elements_per_cycle(), 0.64);
+  ASSERT_DOUBLE_EQ(profiles[0].utilization(), 0.16);
+  ASSERT_DOUBLE_EQ(profiles[0].backpressure(), 0.6);
+  ASSERT_DOUBLE_EQ(profiles[0].starvation(), 0.2);
+  ASSERT_DOUBLE_EQ(profiles[0].bandwidth(1e6), 0.64e6);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, BusTrace) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  auto kernel = std::make_shared<fletcher::Kernel>(context);
+
+  std::stringstream manifest("# name function behavior register bit_index bit_width\n"
+                             "Trace_depth trace constant 20 0 32\n"
+                             "Trace_enable trace control 21 0 1\n"
+                             "Trace_clear trace strobe 22 0 1\n"
+                             "Trace_index trace control 23 0 32\n"
+                             "Trace_count trace status 24 0 32\n"
+                             "Trace_dropped trace status 25 0 32\n"
+                             "Trace_cycle trace status 26 0 32\n"
+                             "Trace_port trace status 27 0 32\n"
+                             "Trace_addr trace status 28 0 64\n"
+                             "Trace_len trace status 30 0 32\n"
+                             "Trace_port_a_bus trace constant 31 0 1\n"
+                             "Trace_port_b_bus trace constant 32 0 1\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::shared_ptr<fletcher::BusTrace> trace;
+  ASSERT_TRUE(fletcher::BusTrace::Make(&trace, kernel, registers).ok());
+  ASSERT_EQ(trace->ports(), std::vector<std::string>({"a_bus", "b_bus"}));
+  ASSERT_TRUE(trace->Start().ok());
+  uint32_t enable = 0;
+  ASSERT_TRUE(platform->ReadMMIO(21, &enable).ok());
+  ASSERT_EQ(enable, 1);
+
+  // The echo model holds register values, so every entry of the ring shows the same request. Six requests were
+  // recorded in a ring of four entries, so only the last four are still in the ring.
+  const uint32_t values[] = {4, 0, 0, 0, 6, 2, 100, 1, 0x1000, 0x1, 7, 0, 1};
+  ASSERT_TRUE(platform->WriteMMIOBatch(20, values, 13).ok());
+  std::shared_ptr<arrow::RecordBatch> entries;
+  uint64_t dropped = 0;
+  ASSERT_TRUE(trace->Read(&entries, &dropped).ok());
+  ASSERT_EQ(dropped, 2);
+  ASSERT_EQ(entries->num_rows(), 4);
+  ASSERT_EQ(entries->num_columns(), 5);
+  auto ports = std::static_pointer_cast<arrow::StringArray>(entries->column(1));
+  auto writes = std::static_pointer_cast<arrow::BooleanArray>(entries->column(2));
+  auto addresses = std::static_pointer_cast<arrow::UInt64Array>(entries->column(3));
+  auto lengths = std::static_pointer_cast<arrow::UInt32Array>(entries->column(4));
+  ASSERT_EQ(ports->GetString(0), "b_bus");
+  ASSERT_TRUE(writes->Value(0));
+  ASSERT_EQ(addresses->Value(0), 0x100001000ull);
+  ASSERT_EQ(lengths->Value(0), 7);
+  // The last recorded request, the sixth, is held at index 5 % 4.
+  uint32_t index = 0;
+  ASSERT_TRUE(platform->ReadMMIO(23, &index).ok());
+  ASSERT_EQ(index, 1);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, OutputCounter) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("s", arrow::utf8(), false)}),
+                                           "Output",
+                                           fletcher::Mode::WRITE);
+  auto make_batch = [&schema](const std::string &chars) {
+    arrow::StringBuilder bs;
+    EXPECT_TRUE(bs.AppendValues({chars, ""}).ok());
+    std::shared_ptr<arrow::Array> s;
+    EXPECT_TRUE(bs.Finish(&s).ok());
+    return arrow::RecordBatch::Make(schema, 2, {s});
+  };
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  // The host estimates the kernel writes two strings of at most four characters in total.
+  ASSERT_TRUE(context->QueueRecordBatch(make_batch("abcd"), fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  auto kernel = std::make_shared<fletcher::Kernel>(context);
+
+  std::stringstream manifest("start default strobe 0 0 1\n"
+                             "Written_s_0 written status 30 0 32\n"
+                             "Written_s_1 written status 31 0 32\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::shared_ptr<fletcher::OutputCounter> counter;
+  ASSERT_TRUE(fletcher::OutputCounter::Make(&counter, kernel, registers).ok());
+  ASSERT_EQ(counter->streams(), std::vector<std::string>({"Written_s_0", "Written_s_1"}));
+
+  // The echo model holds register values, so the launch function plays the role of the counting hardware. The kernel
+  // writes 4096 characters, so the first launch does not fit.
+  size_t launches = 0;
+  size_t grown = 0;
+  std::vector<fletcher::OutputBuffer> buffers;
+  auto launch = [&]() {
+    launches++;
+    const uint32_t counts[] = {2, 4096};
+    return platform->WriteMMIOBatch(30, counts, 2);
+  };
+  auto grow = [&](const std::vector<fletcher::OutputBuffer> &buffers) {
+    grown++;
+    EXPECT_EQ(buffers.size(), 2);
+    EXPECT_FALSE(buffers[0].overflow());
+    EXPECT_TRUE(buffers[1].overflow());
+    auto status = context->ReplaceRecordBatch(0, make_batch(std::string(buffers[1].written, 'x')));
+    if (!status.ok()) {
+      return status;
+    }
+    return kernel->UpdateMetaData();
+  };
+  ASSERT_TRUE(counter->Run(launch, grow, &buffers).ok());
+  ASSERT_EQ(launches, 2);
+  ASSERT_EQ(grown, 1);
+  ASSERT_EQ(buffers.size(), 2);
+  ASSERT_EQ(buffers[0].written, 3 * 4);
+  ASSERT_EQ(buffers[1].written, 4096);
+  ASSERT_GE(buffers[1].capacity, 4096);
+
+  // Output that still does not fit after the last attempt is an error.
+  auto larger = [&]() {
+    const uint32_t counts[] = {2, 8192};
+    return platform->WriteMMIOBatch(30, counts, 2);
+  };
+  ASSERT_FALSE(counter->Run(larger, grow, &buffers, 1).ok());
+  ASSERT_TRUE(buffers[1].overflow());
+  ASSERT_EQ(grown, 1);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, ProgressCounter) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto read = fletcher::WithMetaRequired(*arrow::schema({arrow::field("a", arrow::uint64(), false)}),
+                                         "Read",
+                                         fletcher::Mode::READ);
+  arrow::UInt64Builder ba;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3, 4, 5}).ok());
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.Finish(&a).ok());
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(arrow::RecordBatch::Make(read, 5, {a})).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  auto kernel = std::make_shared<fletcher::Kernel>(context);
+
+  std::shared_ptr<fletcher::ProgressCounter> counter;
+  std::stringstream none("start default strobe 0 0 1\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&none, &registers).ok());
+  ASSERT_FALSE(fletcher::ProgressCounter::Make(&counter, kernel, registers).ok());
+
+  std::stringstream manifest("Read_consumed progress status 40 0 32\n");
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  ASSERT_TRUE(fletcher::ProgressCounter::Make(&counter, kernel, registers).ok());
+
+  // The echo model holds register values, so the test plays the role of the counting hardware.
+  ASSERT_TRUE(platform->WriteMMIO(40, 3).ok());
+  std::vector<fletcher::RecordBatchProgress> progress;
+  ASSERT_TRUE(counter->Read(&progress).ok());
+  ASSERT_EQ(progress.size(), 1);
+  ASSERT_EQ(progress[0].recordbatch, 0);
+  ASSERT_EQ(progress[0].consumed, 3);
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, DescriptorRing) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::stringstream manifest("ring_enable ring control 50 0 1\n"
+                             "ring_base ring control 51 0 64\n"
+                             "ring_size ring control 53 0 32\n"
+                             "ring_tail ring control 54 0 32\n"
+                             "ring_head ring status 55 0 32\n"
+                             "ring_stride ring constant 56 0 32\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::shared_ptr<fletcher::DescriptorRing> ring;
+  ASSERT_FALSE(fletcher::DescriptorRing::Make(&ring, platform, {registers[0]}).ok());
+
+  // The echo model holds register values, so the constant stride and the head are written by the test.
+  ASSERT_TRUE(platform->WriteMMIO(56, 64).ok());
+  ASSERT_TRUE(fletcher::DescriptorRing::Make(&ring, platform, registers, 4).ok());
+  ASSERT_EQ(ring->stride(), 64);
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(50, &value).ok());
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(platform->ReadMMIO(51, &value).ok());
+  ASSERT_EQ(value, static_cast<uint32_t>(ring->address()));
+  ASSERT_TRUE(platform->ReadMMIO(53, &value).ok());
+  ASSERT_EQ(value, 4);
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3}).ok());
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(context->QueueRecordBatch(arrow::RecordBatch::Make(schema, 3, {a})).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  auto kernel = std::make_shared<fletcher::Kernel>(context);
+
+  // The descriptor holds the registers the kernel would otherwise write, and the tail is bumped past it.
+  ASSERT_TRUE(ring->Submit(kernel.get()).ok());
+  ASSERT_TRUE(platform->ReadMMIO(54, &value).ok());
+  ASSERT_EQ(value, 1);
+  std::vector<uint32_t> expected;
+  kernel->GatherMetaData(&expected);
+  std::vector<uint32_t> desc(16);
+  ASSERT_TRUE(platform->CopyDeviceToHost(ring->address(), reinterpret_cast<uint8_t *>(desc.data()), 64).ok());
+  ASSERT_EQ(expected.size(), 4);
+  ASSERT_TRUE(std::equal(expected.begin(), expected.end(), desc.begin()));
+  uint32_t pending = 0;
+  ASSERT_TRUE(ring->Pending(&pending).ok());
+  ASSERT_EQ(pending, 1);
+
+  // Mimic the hardware completing the batch.
+  ASSERT_TRUE(platform->WriteMMIO(55, 1).ok());
+  ASSERT_TRUE(ring->Drain().ok());
+
+  // The ring wraps around, and holds at most size - 1 pending descriptors.
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(ring->Submit(kernel.get()).ok());
+  }
+  ASSERT_TRUE(platform->ReadMMIO(54, &value).ok());
+  ASSERT_EQ(value, 0);
+  ASSERT_TRUE(ring->Pending(&pending).ok());
+  ASSERT_EQ(pending, 3);
+
+  // An out of range head is an error.
+  ASSERT_TRUE(platform->WriteMMIO(55, 4).ok());
+  ASSERT_FALSE(ring->Pending(&pending).ok());
+
+  ring.reset();
+  ASSERT_TRUE(platform->ReadMMIO(50, &value).ok());
+  ASSERT_EQ(value, 0);
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, CompletionRecord) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::stringstream manifest("completion_address completion control 64 0 64\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::shared_ptr<fletcher::CompletionRecord> record;
+  ASSERT_FALSE(fletcher::CompletionRecord::Make(&record, platform, std::vector<fletcher::MmioRegister>{}).ok());
+  ASSERT_TRUE(fletcher::CompletionRecord::Make(&record, platform, registers).ok());
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(64, &value).ok());
+  ASSERT_EQ(value, static_cast<uint32_t>(record->address()));
+  ASSERT_TRUE(platform->ReadMMIO(65, &value).ok());
+  ASSERT_EQ(value, static_cast<uint32_t>(record->address() >> 32));
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  fletcher::Kernel kernel(context);
+  kernel.SetCompletionRecord(record);
+
+  // The echo model asserts done right away, but the kernel is only done once the record is written.
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.WaitUntilDone(0, 100, 1000) == fletcher::Status::TIMEOUT());
+  ASSERT_TRUE(kernel.PollUntilDoneInterval(100, 1000) == fletcher::Status::TIMEOUT());
+
+  // Mimic the hardware writing the record.
+  fletcher::CompletionRecord::Record written{};
+  written.result = 0x0000000200000001ull;
+  written.cycles = 1234;
+  written.status = 1u << FLETCHER_REG_STATUS_DONE;
+  written.sequence = 1;
+  std::memcpy(record->host(), &written, sizeof(written));
+  ASSERT_TRUE(kernel.WaitUntilDone(0, 100, 1000).ok());
+  uint32_t ret0 = 0;
+  uint32_t ret1 = 0;
+  ASSERT_TRUE(kernel.GetReturn(&ret0, &ret1).ok());
+  ASSERT_EQ(ret0, 1u);
+  ASSERT_EQ(ret1, 2u);
+  uint64_t cycles = 0;
+  ASSERT_TRUE(kernel.GetExecutionCycles(&cycles).ok());
+  ASSERT_EQ(cycles, 1234u);
+
+  // The next run waits for the next sequence number.
+  ASSERT_TRUE(kernel.Start().ok());
+  ASSERT_TRUE(kernel.PollUntilDoneInterval(100, 1000) == fletcher::Status::TIMEOUT());
+  written.sequence = 2;
+  std::memcpy(record->host(), &written, sizeof(written));
+  ASSERT_TRUE(kernel.PollUntilDone().ok());
+
+  // Destroying the record disables the write-back.
+  kernel.SetCompletionRecord(nullptr);
+  record.reset();
+  ASSERT_TRUE(platform->ReadMMIO(64, &value).ok());
+  ASSERT_EQ(value, 0u);
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, ResultBuffer) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::stringstream manifest("result_address kernel control 60 0 64\n"
+                             "result_bytes kernel constant 62 0 32\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::shared_ptr<fletcher::ResultBuffer> result;
+  ASSERT_FALSE(fletcher::ResultBuffer::Make(&result, platform, {registers[0]}).ok());
+
+  // The echo model holds register values, so the constant size is written by the test.
+  ASSERT_FALSE(fletcher::ResultBuffer::Make(&result, platform, registers).ok());
+  ASSERT_TRUE(platform->WriteMMIO(62, 4096).ok());
+  ASSERT_TRUE(fletcher::ResultBuffer::Make(&result, platform, registers).ok());
+  ASSERT_EQ(result->size(), 4096);
+  uint32_t lo = 0;
+  uint32_t hi = 0;
+  ASSERT_TRUE(platform->ReadMMIO(60, &lo).ok());
+  ASSERT_TRUE(platform->ReadMMIO(61, &hi).ok());
+  ASSERT_EQ((static_cast<da_t>(hi) << 32) | lo, result->address());
+
+  // Mimic the kernel writing a histogram to the scratchpad, which is read back in one transfer.
+  ASSERT_TRUE(result->Clear().ok());
+  std::vector<uint32_t> histogram(1024);
+  for (size_t i = 0; i < histogram.size(); i++) {
+    histogram[i] = static_cast<uint32_t>(3 * i);
+  }
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(histogram.data()),
+                                         result->address(),
+                                         4096).ok());
+  fletcher::ResultSpan<uint32_t> values;
+  ASSERT_TRUE(result->Read(&values).ok());
+  ASSERT_EQ(values.size, histogram.size());
+  ASSERT_TRUE(std::equal(values.begin(), values.end(), histogram.begin()));
+  ASSERT_EQ(values[5], 15);
+
+  ASSERT_TRUE(result->Clear().ok());
+  ASSERT_TRUE(result->Read(&values).ok());
+  ASSERT_EQ(values[5], 0);
+
+  result.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, ChunkList) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  std::stringstream manifest("Chunks_chunks chunks control 60 0 64\n"
+                             "Chunks_num_chunks chunks control 62 0 32\n"
+                             "Chunks_chunk_stride chunks constant 63 0 32\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::shared_ptr<fletcher::ChunkList> chunks;
+  ASSERT_FALSE(fletcher::ChunkList::Make(&chunks, platform, {registers[2]}).ok());
+
+  // The echo model holds register values, so the constant stride is written by the test.
+  ASSERT_FALSE(fletcher::ChunkList::Make(&chunks, platform, registers).ok());
+  ASSERT_TRUE(platform->WriteMMIO(63, 64).ok());
+  ASSERT_TRUE(fletcher::ChunkList::Make(&chunks, platform, registers).ok());
+  ASSERT_EQ(chunks->num_lists(), 1);
+  ASSERT_EQ(chunks->stride(0), 64);
+
+  // Three RecordBatches of the same schema are the chunks of a single table.
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("a", arrow::uint64(), false)}),
+                                           "Chunks", fletcher::Mode::READ);
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  std::vector<int64_t> rows = {3, 2, 4};
+  for (auto n : rows) {
+    arrow::UInt64Builder ba;
+    std::shared_ptr<arrow::Array> a;
+    for (int64_t i = 0; i < n; i++) {
+      ASSERT_TRUE(ba.Append(static_cast<uint64_t>(i)).ok());
+    }
+    ASSERT_TRUE(ba.Finish(&a).ok());
+    ASSERT_TRUE(context->QueueRecordBatch(arrow::RecordBatch::Make(schema, n, {a})).ok());
+  }
+  ASSERT_TRUE(context->Enable().ok());
+  fletcher::Kernel kernel(context);
+  ASSERT_TRUE(chunks->WriteMetaData(&kernel).ok());
+
+  uint32_t value = 0;
+  ASSERT_TRUE(platform->ReadMMIO(60, &value).ok());
+  ASSERT_EQ(value, static_cast<uint32_t>(chunks->address(0)));
+  ASSERT_TRUE(platform->ReadMMIO(62, &value).ok());
+  ASSERT_EQ(value, 3);
+
+  // Every descriptor holds the range and the buffer address of its chunk.
+  std::vector<uint32_t> desc(48);
+  ASSERT_TRUE(platform->CopyDeviceToHost(chunks->address(0), reinterpret_cast<uint8_t *>(desc.data()), 192).ok());
+  for (size_t c = 0; c < rows.size(); c++) {
+    ASSERT_EQ(desc[16 * c], 0);
+    ASSERT_EQ(desc[16 * c + 1], rows[c]);
+    ASSERT_EQ(desc[16 * c + 2], static_cast<uint32_t>(context->device_buffer(c).kernel_address()));
+  }
+
+  // The RecordBatch registers hold the range of the table and the buffer address of its first chunk, and the kernel
+  // arguments follow them.
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 1, &value).ok());
+  ASSERT_EQ(value, 9);
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 2, &value).ok());
+  ASSERT_EQ(value, static_cast<uint32_t>(context->device_buffer(0).kernel_address()));
+  ASSERT_TRUE(kernel.SetArguments({42}).ok());
+  ASSERT_TRUE(platform->ReadMMIO(FLETCHER_REG_SCHEMA + 4, &value).ok());
+  ASSERT_EQ(value, 42);
+
+  chunks.reset();
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, Offloader) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  options.kernel_latency_usec = 1000;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = arrow::schema({arrow::field("a", arrow::uint64(), false)});
+  arrow::UInt64Builder ba;
+  std::shared_ptr<arrow::Array> a;
+  ASSERT_TRUE(ba.AppendValues({1, 2, 3}).ok());
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto small = arrow::RecordBatch::Make(schema, 3, {a});
+  ASSERT_TRUE(ba.AppendValues(std::vector<uint64_t>(1000, 1)).ok());
+  ASSERT_TRUE(ba.Finish(&a).ok());
+  auto large = arrow::RecordBatch::Make(schema, 1000, {a});
+  ASSERT_EQ(fletcher::Offloader::BatchBytes({small}), 24);
+  ASSERT_EQ(fletcher::Offloader::BatchBytes({small, large}), 8024);
+
+  int launches = 0;
+  int host_runs = 0;
+  std::shared_ptr<fletcher::Offloader> offloader;
+  auto launch = [&launches](fletcher::Kernel *kernel) -> fletcher::Status {
+    launches++;
+    auto status = kernel->Start();
+    return status.ok() ? kernel->WaitUntilDone() : status;
+  };
+  auto host = [&host_runs](const std::vector<std::shared_ptr<arrow::RecordBatch>> &batches) -> fletcher::Status {
+    host_runs++;
+    return fletcher::Status::OK();
+  };
+  ASSERT_FALSE(fletcher::Offloader::Make(&offloader, platform, launch, nullptr).ok());
+  ASSERT_TRUE(fletcher::Offloader::Make(&offloader, platform, launch, host).ok());
+
+  // Both targets are measured before the model is trusted.
+  fletcher::Offloader::Target target;
+  ASSERT_TRUE(offloader->Run({small}, &target).ok());
+  ASSERT_EQ(target, fletcher::Offloader::Target::DEVICE);
+  ASSERT_TRUE(offloader->Run({small}, &target).ok());
+  ASSERT_EQ(target, fletcher::Offloader::Target::HOST);
+  ASSERT_EQ(launches, 1);
+  ASSERT_EQ(host_runs, 1);
+  auto stats = offloader->stats();
+  ASSERT_EQ(stats.device_runs, 1);
+  ASSERT_EQ(stats.host_runs, 1);
+  ASSERT_GE(stats.model.device_ns_per_byte * 24, 1000000.0);
+
+  // The modeled kernel latency dwarfs the host time of a small batch.
+  ASSERT_TRUE(offloader->Decide({small}, &target).ok());
+  ASSERT_EQ(target, fletcher::Offloader::Target::HOST);
+
+  // With a model of a fast device, only batches past the break-even point are offloaded.
+  fletcher::Offloader::Model model;
+  model.launch_ns = 10000.0;
+  model.transfer_ns_per_byte = 0.25;
+  model.device_ns_per_byte = 0.25;
+  model.host_ns_per_byte = 2.5;
+  model.device_samples = 1;
+  model.host_samples = 1;
+  ASSERT_EQ(model.BreakEven(), 5000);
+  offloader->SetModel(model);
+  ASSERT_TRUE(offloader->Decide({small}, &target).ok());
+  ASSERT_EQ(target, fletcher::Offloader::Target::HOST);
+  ASSERT_TRUE(offloader->Decide({large}, &target).ok());
+  ASSERT_EQ(target, fletcher::Offloader::Target::DEVICE);
+  model.host_ns_per_byte = 0.5;
+  ASSERT_EQ(model.BreakEven(), -1);
+
+  ASSERT_TRUE(offloader->RunOn(fletcher::Offloader::Target::DEVICE, {large}).ok());
+  ASSERT_EQ(launches, 2);
+  ASSERT_EQ(offloader->stats().device_bytes, 8024);
+
+  offloader.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
+
+TEST(Kernel, PartitionedOutput) {
+  std::shared_ptr<fletcher::Platform> platform;
+  ASSERT_TRUE(fletcher::Platform::Make("echo", &platform, false).ok());
+  InitOptions options = {};
+  options.model = 1;
+  platform->init_data = &options;
+  ASSERT_TRUE(platform->Init().ok());
+
+  auto schema = fletcher::WithMetaRequired(*arrow::schema({arrow::field("key", arrow::uint32(), false),
+                                                           arrow::field("value", arrow::utf8(), false)}),
+                                           "Shuffle",
+                                           fletcher::Mode::WRITE);
+  std::shared_ptr<fletcher::PartitionedOutput> output;
+  ASSERT_FALSE(fletcher::PartitionedOutput::Make(&output, schema, 4, 16).ok());
+  ASSERT_TRUE(fletcher::PartitionedOutput::Make(&output, fletcher::WithMetaPartitions(*schema, 2, "key"), 4, 16).ok());
+  ASSERT_EQ(output->num_partitions(), 2);
+  ASSERT_EQ(output->recordbatches()[1]->num_rows(), 4);
+
+  std::shared_ptr<fletcher::Context> context;
+  ASSERT_TRUE(fletcher::Context::Make(&context, platform).ok());
+  ASSERT_TRUE(output->Queue(context.get(), fletcher::MemType::CACHE).ok());
+  ASSERT_TRUE(context->Enable().ok());
+  ASSERT_EQ(context->num_buffers(), 6);
+  auto kernel = std::make_shared<fletcher::Kernel>(context);
+
+  // Mimic a kernel writing a single row to the second partition. The echo model holds register values, so the row
+  // counts are written by the test.
+  uint32_t keys[] = {7};
+  int32_t offsets[] = {0, 2};
+  char values[] = {'a', 'b'};
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(keys),
+                                         context->device_buffer(3).device_address,
+                                         sizeof(keys)).ok());
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(offsets),
+                                         context->device_buffer(4).device_address,
+                                         sizeof(offsets)).ok());
+  ASSERT_TRUE(platform->CopyHostToDevice(reinterpret_cast<uint8_t *>(values),
+                                         context->device_buffer(5).device_address,
+                                         sizeof(values)).ok());
+  const uint32_t rows[] = {0, 1};
+  ASSERT_TRUE(platform->WriteMMIOBatch(40, rows, 2).ok());
+
+  std::stringstream manifest("start default strobe 0 0 1\n"
+                             "Shuffle_p0_rows kernel status 40 0 32\n"
+                             "Shuffle_p1_rows kernel status 41 0 32\n");
+  std::vector<fletcher::MmioRegister> registers;
+  ASSERT_TRUE(fletcher::ParseRegisterManifest(&manifest, &registers).ok());
+  std::vector<std::shared_ptr<arrow::RecordBatch>> partitions;
+  ASSERT_TRUE(output->Read(kernel.get(), registers, &partitions).ok());
+  ASSERT_EQ(partitions.size(), 2);
+  ASSERT_EQ(partitions[0]->num_rows(), 0);
+  ASSERT_EQ(partitions[1]->num_rows(), 1);
+  ASSERT_EQ(std::static_pointer_cast<arrow::UInt32Array>(partitions[1]->column(0))->Value(0), 7);
+  ASSERT_EQ(std::static_pointer_cast<arrow::StringArray>(partitions[1]->column(1))->GetString(0), "ab");
+  ASSERT_TRUE(partitions[1]->ValidateFull().ok());
+
+  // A kernel can not report more rows than a partition holds.
+  ASSERT_TRUE(platform->WriteMMIO(40, 5).ok());
+  ASSERT_FALSE(output->Read(kernel.get(), registers, &partitions).ok());
+
+  context.reset();
+  ASSERT_TRUE(platform->Terminate().ok());
+}
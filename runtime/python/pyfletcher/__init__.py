@@ -15,4 +15,4 @@
 name = "pyfletcher"
 
 import pyarrow
-from pyfletcher.lib import Platform, Kernel, Context
\ No newline at end of file
+from pyfletcher.lib import Platform, Kernel, Context, StreamingContext, DeviceBuffer, Completion
\ No newline at end of file
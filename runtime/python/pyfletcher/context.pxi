@@ -14,18 +14,80 @@
 
 import pyarrow as pa
 
+from cython.operator cimport dereference as deref
+from libcpp.memory cimport static_pointer_cast
+from cpython.buffer cimport PyBuffer_FillInfo
+
 cdef class DeviceBuffer():
-    """Python wrapper for Fletcher DeviceBuffer."""
+    """Python wrapper for Fletcher DeviceBuffer.
+
+    If the device accesses the host memory of the buffer directly, see `host_visible`, the buffer supports the Python
+    buffer protocol, such that its contents can be viewed without copying, e.g. with numpy.frombuffer().
+
+    """
     
     # The C++ device buffer this PyObject holds
     cdef CDeviceBuffer c_device_buffer 
+    # The context owning the buffer, kept alive as long as the buffer or any view on it exists
+    cdef Context context
 
     def __cinit__(self):
         self.c_device_buffer = CDeviceBuffer()
         
     # Construct from an existing CDeviceBuffer
-    cdef from_reference(self, CDeviceBuffer buf):
+    cdef from_reference(self, CDeviceBuffer buf, Context context=None):
         self.c_device_buffer = buf
+        self.context = context
+
+    @property
+    def host_address(self):
+        return <uintptr_t>self.c_device_buffer.host_address
+
+    @property
+    def device_address(self):
+        return self.c_device_buffer.device_address
+
+    @property
+    def size(self):
+        return self.c_device_buffer.size
+
+    @property
+    def host_visible(self):
+        """Whether the device accesses the host memory of this buffer directly, such that it can be viewed zero-copy."""
+        return self.c_device_buffer.host_visible()
+
+    def __getbuffer__(self, Py_buffer *buffer, int flags):
+        if not self.c_device_buffer.host_visible():
+            raise BufferError("DeviceBuffer is not host-visible. Use to_buffer() to copy it from the device.")
+        PyBuffer_FillInfo(buffer, self, <void *>self.c_device_buffer.host_address, self.c_device_buffer.size, 1, flags)
+
+    def __releasebuffer__(self, Py_buffer *buffer):
+        pass
+
+    def to_buffer(self):
+        """Return the contents of this buffer as a pyarrow.Buffer.
+
+        Host-visible buffers are wrapped without copying. Other buffers are copied from the device into a new buffer,
+        without holding the GIL.
+
+        Returns:
+            pyarrow.Buffer
+
+        """
+        cdef Status status
+        cdef uint8_t *dest
+        cdef CPlatform *platform
+        if self.c_device_buffer.host_visible():
+            return pa.foreign_buffer(self.host_address, self.size, base=self)
+        if self.context is None:
+            raise RuntimeError("DeviceBuffer does not belong to a Context.")
+        result = pa.allocate_buffer(self.size)
+        dest = <uint8_t *><uintptr_t>result.address
+        platform = self.context.context.get().platform().get()
+        with nogil:
+            status = platform.CopyDeviceToHost(self.c_device_buffer.device_address, dest, self.c_device_buffer.size)
+        check_fletcher_status(status)
+        return result
     
     
 cdef class Context():
@@ -38,8 +100,10 @@ cdef class Context():
     cdef:
         shared_ptr[CContext] context
 
-    def __cinit__(self, Platform platform):
-        check_fletcher_status(CContext.Make(&self.context, platform.platform))
+    def __cinit__(self, Platform platform, *args, **kwargs):
+        # Subclasses construct their own C++ context.
+        if type(self) is Context:
+            check_fletcher_status(CContext.Make(&self.context, platform.platform))
 
     cdef from_pointer(self, shared_ptr[CContext] context):
         self.context = context
@@ -63,7 +127,11 @@ cdef class Context():
         else:
             raise ValueError("mem_type argument can be only 'any' or 'cache'")
         
-        check_fletcher_status(self.context.get().QueueRecordBatch(pyarrow_unwrap_batch(record_batch), queue_mem_type))
+        cdef shared_ptr[CRecordBatch] batch = pyarrow_unwrap_batch(record_batch)
+        cdef Status status
+        with nogil:
+            status = self.context.get().QueueRecordBatch(batch, queue_mem_type)
+        check_fletcher_status(status)
 
     def get_queue_size(self):
         """Obtain the size (in bytes) of all buffers currently enqueued.
@@ -84,17 +152,93 @@ cdef class Context():
         return self.context.get().num_buffers()
 
     def get_device_buffer(self, size_t buffer_index):
-        """Get a list of device buffers
+        """Get a device buffer of this context.
 
         Args:
             buffer_index: Index of the buffer in this context.
 
         Returns:
+            DeviceBuffer, which keeps this context alive.
 
         """
-        cdef DeviceBuffer result = Context.__new__(Context)
-        result.from_reference(self.context.get().device_buffer(buffer_index))
+        if buffer_index >= self.context.get().num_buffers():
+            raise IndexError("Buffer index out of range.")
+        cdef DeviceBuffer result = DeviceBuffer.__new__(DeviceBuffer)
+        result.from_reference(self.context.get().device_buffer(buffer_index), self)
         return result
 
     def enable(self):
-        check_fletcher_status(self.context.get().Enable())
+        """Enable the device for all queued RecordBatches, copying them to the device if required.
+
+        Other Python threads keep running while the buffers are transferred.
+
+        """
+        cdef Status status
+        with nogil:
+            status = self.context.get().Enable()
+        check_fletcher_status(status)
+
+
+cdef class StreamingContext(Context):
+    """Python wrapper for Fletcher StreamingContext.
+
+    Transfers the next RecordBatch to the device while a Kernel processes the active one.
+
+    Args:
+        platform: Platform this context should run on.
+        num_slots: Number of RecordBatches that can be resident on the device. Must be at least 2 to run a Kernel.
+
+    """
+    cdef:
+        shared_ptr[CStreamingContext] streaming
+
+    def __cinit__(self, Platform platform, size_t num_slots=2):
+        check_fletcher_status(CStreamingContext.create(&self.streaming, platform.platform, num_slots))
+        self.context = static_pointer_cast[CContext, CStreamingContext](self.streaming)
+
+    def run(self, source, Kernel kernel, mem_type='any'):
+        """Run a Kernel on every RecordBatch of a pyarrow Table or RecordBatchReader.
+
+        The whole loop runs in C++ without holding the GIL. For every RecordBatch, the metadata of the Kernel is
+        updated, the Kernel is started and awaited, and its return registers are collected.
+
+        Args:
+            source: pyarrow.Table or pyarrow.RecordBatchReader to process. The Kernel must be constructed on this
+                    context.
+            kernel: Kernel to run.
+            mem_type (str): Memory type of the buffers, see Context.queue_record_batch().
+
+        Returns:
+            pyarrow.UInt64Array with the return registers of the Kernel for every RecordBatch, where return register 1
+            holds the upper 32 bits.
+
+        """
+        cdef MemType run_mem_type
+        cdef shared_ptr[CTable] table
+        cdef shared_ptr[CRecordBatchReader] reader
+        cdef shared_ptr[CArray] results
+        cdef Status status
+
+        if mem_type == "any":
+            run_mem_type = MemType.ANY
+        elif mem_type == "cache":
+            run_mem_type = MemType.CACHE
+        else:
+            raise ValueError("mem_type argument can be only 'any' or 'cache'")
+
+        if isinstance(source, pa.Table):
+            table = pyarrow_unwrap_table(source)
+            reader.reset(new CTableBatchReader(deref(table)))
+        elif isinstance(source, pa.RecordBatchReader):
+            reader = (<_RecordBatchReader>source).reader
+        else:
+            raise TypeError("source must be a pyarrow.Table or pyarrow.RecordBatchReader")
+
+        with nogil:
+            status = self.streaming.get().Run(reader.get(), kernel.Kernel.get(), &results, run_mem_type)
+        check_fletcher_status(status)
+        return pyarrow_wrap_array(results)
+
+    def num_pending(self):
+        """Return the number of RecordBatches that were pushed but are not yet active."""
+        return self.streaming.get().num_pending()
@@ -24,6 +24,14 @@ from libcpp.vector cimport vector
 from libcpp cimport bool as cpp_bool
 
 from pyarrow.lib cimport CRecordBatch, CSchema, pyarrow_unwrap_buffer, pyarrow_unwrap_schema, pyarrow_unwrap_batch
+from pyarrow.lib cimport CArray, CTable, CRecordBatchReader, pyarrow_unwrap_table, pyarrow_wrap_array
+from pyarrow.lib cimport TableBatchReader as CTableBatchReader, RecordBatchReader as _RecordBatchReader
+
+cdef extern from "<future>" namespace "std" nogil:
+    cdef cppclass shared_future[T]:
+        shared_future()
+        T get()
+        cpp_bool valid()
 
 cdef extern from "fletcher/fletcher.h" nogil:
     ctypedef unsigned long long fstatus_t
@@ -59,7 +67,9 @@ cdef extern from "fletcher/api.h" namespace "fletcher" nogil:
         Mode mode
         cpp_bool available_to_device
         cpp_bool was_alloced
+        cpp_bool pooled
         CDeviceBuffer()
+        cpp_bool host_visible()
 
     cdef cppclass CPlatform" fletcher::Platform":
         #Renamed create function because overloading of static functions causes errors
@@ -89,6 +99,7 @@ cdef extern from "fletcher/api.h" namespace "fletcher" nogil:
         uint64_t num_buffers()
         Status Enable()
         CDeviceBuffer device_buffer(size_t i)
+        shared_ptr[CPlatform] platform()
 
     cdef cppclass CKernel" fletcher::Kernel":
         # Control and status values
@@ -96,14 +107,25 @@ cdef extern from "fletcher/api.h" namespace "fletcher" nogil:
         uint32_t ctrl_reset
         uint32_t done_status
         uint32_t done_status_mask
+        cpp_bool projection
 
         CKernel(shared_ptr[CContext] context)
         cpp_bool ImplementsSchemaSet(const vector[shared_ptr[CSchema]] &schema)
         Status Reset()
-        Status SetRange(size_t recordbatch_index, int32_t first, int32_t last)
+        Status SetRange(size_t recordbatch_index, int64_t first, int64_t last)
+        Status SetProjection(const vector[cpp_string] &fields)
         Status SetArguments(vector[uint32_t] arguments)
         Status Start()
+        Status StartAsync(shared_future[Status] *completion, unsigned int poll_interval_usec, unsigned int timeout_usec)
         Status GetStatus(uint32_t *status)
         Status GetReturn(uint32_t *ret0, uint32_t *ret1)
-        Status PollUntilDoneInterval(unsigned int poll_interval_usec)
+        Status PollUntilDoneInterval(unsigned int poll_interval_usec, unsigned int timeout_usec)
+        Status WaitUntilDone(unsigned int spin_usec, unsigned int poll_interval_usec, unsigned int timeout_usec)
+        Status Cancel(unsigned int timeout_usec)
         shared_ptr[CContext] context()
+
+    cdef cppclass CStreamingContext" fletcher::StreamingContext"(CContext):
+        @staticmethod
+        Status create"Make"(shared_ptr[CStreamingContext] *context, const shared_ptr[CPlatform] &platform, size_t num_slots)
+        Status Run(CRecordBatchReader *reader, CKernel *kernel, shared_ptr[CArray] *results, MemType mem_type)
+        size_t num_pending()
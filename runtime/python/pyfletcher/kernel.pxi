@@ -20,6 +20,31 @@ cdef vector[shared_ptr[CSchema]] pyfletcher_unwrap_schemaset(schemaset):
 
   return result
 
+cdef class Completion:
+    """The completion of a Kernel started with Kernel.start_async().
+
+    Completions can be awaited in asyncio coroutines, such that multiple kernels can be driven concurrently::
+
+        await kernel.start_async()
+
+    """
+    cdef:
+        shared_future[Status] future
+
+    def result(self):
+        """Block until the kernel is done. Other Python threads keep running in the meantime."""
+        cdef Status status
+        if not self.future.valid():
+            raise RuntimeError("Completion does not belong to a started Kernel.")
+        with nogil:
+            status = self.future.get()
+        check_fletcher_status(status)
+
+    def __await__(self):
+        # Wait for the future on the default executor, such that the event loop stays responsive.
+        loop = asyncio.get_event_loop()
+        return loop.run_in_executor(None, self.result).__await__()
+
 cdef class Kernel:
     """Python wrapper for Fletcher Kernel.
 
@@ -68,6 +93,14 @@ cdef class Kernel:
     def done_status_mask(self, uint32_t value):
         self.Kernel.get().done_status_mask = value
 
+    @property
+    def projection(self):
+        return self.Kernel.get().projection
+
+    @projection.setter
+    def projection(self, bint value):
+        self.Kernel.get().projection = value
+
     def implements_schema(self, schemaset):
         """Check if this Kernel implements an operation on a specific set of Arrow schemas.
 
@@ -81,9 +114,12 @@ cdef class Kernel:
         return self.Kernel.get().ImplementsSchemaSet(pyfletcher_unwrap_schemaset(schemaset))
 
     def reset(self):
-        check_fletcher_status(self.Kernel.get().Reset())
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().Reset()
+        check_fletcher_status(status)
 
-    def set_range(self, size_t recordbatch_index, uint32_t first, uint32_t last):
+    def set_range(self, size_t recordbatch_index, int64_t first, int64_t last):
         """Set the first (inclusive) and last (exclusive) column to process.
 
         Args:
@@ -91,7 +127,26 @@ cdef class Kernel:
             last (int):
 
         """
-        check_fletcher_status(self.Kernel.get().SetRange(recordbatch_index, first, last))
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().SetRange(recordbatch_index, first, last)
+        check_fletcher_status(status)
+
+    def set_projection(self, list fields):
+        """Enable only a subset of the fields of all RecordBatches. Requires a kernel generated with --projection.
+
+        Args:
+            fields(:obj:`list` of :obj:`str`): The names of the fields to enable. When empty, all fields are enabled.
+
+        """
+        cdef vector[cpp_string] cpp_fields
+        for field in fields:
+            cpp_fields.push_back(field.encode())
+
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().SetProjection(cpp_fields)
+        check_fletcher_status(status)
 
     def set_arguments(self, list arguments):
         """Set the parameters of the Kernel.
@@ -104,15 +159,42 @@ cdef class Kernel:
         for argument in arguments:
             cpp_arguments.push_back(argument)
 
-        self.Kernel.get().SetArguments(cpp_arguments)
+        with nogil:
+            self.Kernel.get().SetArguments(cpp_arguments)
 
     def start(self):
-        check_fletcher_status(self.Kernel.get().Start())
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().Start()
+        check_fletcher_status(status)
+
+    def start_async(self, unsigned int poll_interval_usec=0, unsigned int timeout_usec=0):
+        """Start the Kernel and monitor its completion in the background.
+
+        The Kernel is cancelled when it is not done within the timeout, after which its completion raises an error.
+
+        Args:
+            poll_interval_usec (int): Polling interval of the completion monitor in microseconds.
+            timeout_usec (int): Time after which the Kernel is cancelled in microseconds, or 0 to wait indefinitely.
+
+        Returns:
+            Completion: The completion of the Kernel, which can be awaited or waited for with result().
+
+        """
+        cdef Completion completion = Completion.__new__(Completion)
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().StartAsync(&completion.future, poll_interval_usec, timeout_usec)
+        check_fletcher_status(status)
+        return completion
 
     def get_status(self):
-        cdef uint32_t status
-        check_fletcher_status(self.Kernel.get().GetStatus(&status))
-        return status
+        cdef uint32_t value
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().GetStatus(&value)
+        check_fletcher_status(status)
+        return value
 
     def get_return(self, np.dtype nptype):
         """Read the return registers.
@@ -127,8 +209,11 @@ cdef class Kernel:
         cdef uint32_t hi
         cdef uint32_t lo
         cdef uint64_t ret
+        cdef Status status
 
-        check_fletcher_status(self.Kernel.get().GetReturn(&lo, &hi))
+        with nogil:
+            status = self.Kernel.get().GetReturn(&lo, &hi)
+        check_fletcher_status(status)
         ret = (<uint64_t>hi << 32) + lo
 
         scalar = np.uint64(ret)
@@ -136,14 +221,52 @@ cdef class Kernel:
 
         return cast_scalar.item()
 
-    def poll_until_done(self, int poll_interval_usec=0):
+    def poll_until_done(self, unsigned int poll_interval_usec=0, unsigned int timeout_usec=0):
         """A blocking function that waits for the Kernel to finish.
 
         Args:
             poll_interval_usec (int): Polling interval in microseconds.
+            timeout_usec (int): Time after which waiting raises an error in microseconds, or 0 to wait indefinitely.
+
+        """
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().PollUntilDoneInterval(poll_interval_usec, timeout_usec)
+        check_fletcher_status(status)
+
+    def wait_until_done(self, unsigned int spin_usec=50, unsigned int poll_interval_usec=100,
+                        unsigned int timeout_usec=0):
+        """A blocking function that waits for the Kernel to finish with low latency and CPU usage.
+
+        Uses interrupts if the platform supports them, otherwise polls at full speed for a short window, and then at
+        an interval.
+
+        Args:
+            spin_usec (int): The window in which to poll at full speed, in microseconds.
+            poll_interval_usec (int): The polling interval after the spin window, or the interrupt timeout.
+            timeout_usec (int): Time after which waiting raises an error in microseconds, or 0 to wait indefinitely.
+                The Kernel keeps running afterwards, until it is cancelled.
+
+        """
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().WaitUntilDone(spin_usec, poll_interval_usec, timeout_usec)
+        check_fletcher_status(status)
+
+    def cancel(self, unsigned int timeout_usec=1000):
+        """Cancel the Kernel by asserting the stop bit of the control register.
+
+        Kernels generated by Fletchgen stop issuing new bus requests once stopped. A Kernel that does not assert done
+        within the timeout is reset, after which an error is raised.
+
+        Args:
+            timeout_usec (int): Time to wait for the Kernel to assert done after stopping it in microseconds.
 
         """
-        check_fletcher_status(self.Kernel.get().PollUntilDoneInterval(poll_interval_usec))
+        cdef Status status
+        with nogil:
+            status = self.Kernel.get().Cancel(timeout_usec)
+        check_fletcher_status(status)
 
     def get_context(self):
         """Get associated context.
@@ -15,6 +15,7 @@
 # distutils: language = c++
 # cython: language_level=3
 
+import asyncio
 import cython
 import pyarrow
 import numpy as np
@@ -46,7 +46,10 @@ cdef class Platform:
         return self.platform.get().name().decode("utf-8")
 
     def init(self):
-        check_fletcher_status(self.platform.get().Init())
+        cdef Status status
+        with nogil:
+            status = self.platform.get().Init()
+        check_fletcher_status(status)
 
     def write_mmio(self, uint64_t offset, uint32_t value):
         """Write to MMIO register.
@@ -56,7 +59,10 @@ cdef class Platform:
             value (int): Value to write.
 
         """
-        check_fletcher_status(self.platform.get().WriteMMIO(offset, value))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().WriteMMIO(offset, value)
+        check_fletcher_status(status)
 
     def read_mmio(self, uint64_t offset, str type="uint"):
         """Read from MMIO register.
@@ -71,7 +77,10 @@ cdef class Platform:
 
         """
         cdef uint32_t value
-        check_fletcher_status(self.platform.get().ReadMMIO(offset, &value))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().ReadMMIO(offset, &value)
+        check_fletcher_status(status)
 
         if type == "uint":
             return value
@@ -95,7 +104,10 @@ cdef class Platform:
 
         """
         cdef uint64_t value
-        check_fletcher_status(self.platform.get().ReadMMIO64(offset, &value))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().ReadMMIO64(offset, &value)
+        check_fletcher_status(status)
 
         if type == "uint":
             return value
@@ -117,7 +129,10 @@ cdef class Platform:
 
         """
         cdef da_t device_address
-        check_fletcher_status(self.platform.get().DeviceMalloc(&device_address, size))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().DeviceMalloc(&device_address, size)
+        check_fletcher_status(status)
 
         return device_address
 
@@ -128,7 +143,10 @@ cdef class Platform:
             device_address (int): Device address of the memory region.
 
         """
-        check_fletcher_status(self.platform.get().DeviceFree(device_address))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().DeviceFree(device_address)
+        check_fletcher_status(status)
 
     def copy_host_to_device(self, host_bytes, da_t device_destination, uint64_t size):
         """Copy a memory region from device memory to host memory.
@@ -142,7 +160,10 @@ cdef class Platform:
         cdef const uint8_t[:] host_source_view = host_bytes
         cdef const uint8_t *host_source = &host_source_view[0]
 
-        check_fletcher_status(self.platform.get().CopyHostToDevice(<uint8_t*>host_source, device_destination, size))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().CopyHostToDevice(<uint8_t*>host_source, device_destination, size)
+        check_fletcher_status(status)
 
     def copy_device_to_host(self, da_t device_source, uint64_t size, buffer=None):
         """Copy a memory region from device memory to host memory.
@@ -165,9 +186,15 @@ cdef class Platform:
         else:
             host_destination = pyarrow_unwrap_buffer(buffer).get().mutable_data()
 
-        check_fletcher_status(self.platform.get().CopyDeviceToHost(device_source, <uint8_t*>host_destination, size))
+        cdef Status status
+        with nogil:
+            status = self.platform.get().CopyDeviceToHost(device_source, <uint8_t*>host_destination, size)
+        check_fletcher_status(status)
 
         return buffer
 
     def terminate(self):
-        check_fletcher_status(self.platform.get().Terminate())
+        cdef Status status
+        with nogil:
+            status = self.platform.get().Terminate()
+        check_fletcher_status(status)
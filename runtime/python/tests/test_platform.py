@@ -12,6 +12,10 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import asyncio
+import os
+import threading
+
 import pyarrow as pa
 import pyfletcher as pf
 import numpy as np
@@ -94,5 +98,98 @@ def test_context():
     # Terminate
     platform.terminate()
 
+def test_device_buffer():
+    platform = pf.Platform("echo", False)
+    platform.init()
+
+    schema = pa.schema([pa.field("a", pa.uint64(), False)])
+    rb = pa.RecordBatch.from_arrays([pa.array([1, 2, 3, 4], type=pa.uint64())], schema)
+    context = pf.Context(platform)
+    context.queue_record_batch(rb)
+    context.enable()
+
+    buf = context.get_device_buffer(0)
+    assert buf.size == 32
+    # The echo platform copies buffers to newly allocated memory, so they can only be copied back.
+    assert not buf.host_visible
+    try:
+        memoryview(buf)
+        assert False
+    except BufferError:
+        pass
+    assert np.frombuffer(buf.to_buffer(), dtype=np.uint64).tolist() == [1, 2, 3, 4]
+
+    platform.terminate()
+
+def test_kernel_async():
+    # Let the echo platform model kernel completion, such that kernels are busy for a while.
+    os.environ["FLETCHER_ECHO_MODEL"] = "1"
+    os.environ["FLETCHER_ECHO_KERNEL_LATENCY_USEC"] = "20000"
+    platform = pf.Platform("echo", False)
+    platform.init()
+
+    schema = pa.schema([pa.field("a", pa.uint64(), False)])
+    rb = pa.RecordBatch.from_arrays([pa.array([1, 2, 3, 4], type=pa.uint64())], schema)
+    context = pf.Context(platform)
+    context.queue_record_batch(rb)
+    context.enable()
+    kernel = pf.Kernel(context)
+
+    # Other Python threads keep running while the kernel is polled.
+    ticks = []
+    stop = threading.Event()
+
+    def count():
+        while not stop.is_set():
+            ticks.append(1)
+            stop.wait(0.001)
+
+    counter = threading.Thread(target=count)
+    counter.start()
+    kernel.start()
+    kernel.poll_until_done()
+    stop.set()
+    counter.join()
+    assert len(ticks) > 1
+
+    # Completions can be awaited, such that an event loop can drive kernels while doing other work.
+    async def run():
+        completion = kernel.start_async(100)
+        other = asyncio.ensure_future(asyncio.sleep(0))
+        await completion
+        await other
+
+    asyncio.get_event_loop().run_until_complete(run())
+
+    del os.environ["FLETCHER_ECHO_MODEL"]
+    del os.environ["FLETCHER_ECHO_KERNEL_LATENCY_USEC"]
+    platform.terminate()
+
+def test_streaming_context():
+    os.environ["FLETCHER_ECHO_MODEL"] = "1"
+    platform = pf.Platform("echo", False)
+    platform.init()
+
+    schema = pa.schema([pa.field("a", pa.uint64(), False)])
+    batches = [pa.RecordBatch.from_arrays([pa.array([i] * (i + 1), type=pa.uint64())], schema) for i in range(3)]
+    table = pa.Table.from_batches(batches)
+
+    context = pf.StreamingContext(platform, 2)
+    kernel = pf.Kernel(context)
+    # The echo model holds the values written to its registers, so every run returns these values.
+    platform.write_mmio(2, 7)
+    platform.write_mmio(3, 1)
+
+    results = context.run(table, kernel)
+    assert results.type == pa.uint64()
+    assert results.to_pylist() == [(1 << 32) | 7] * 3
+    assert context.num_pending() == 0
+
+    reader = pa.RecordBatchReader.from_batches(schema, batches)
+    assert len(context.run(reader, kernel)) == 3
+
+    del os.environ["FLETCHER_ECHO_MODEL"]
+    platform.terminate()
+
 test_platform()
 # test_context()